@@ -0,0 +1,235 @@
+#include "benchmarks/cpp/benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <regex>
+#include <thread>
+#include <vector>
+
+namespace taichi {
+namespace lang {
+namespace {
+
+struct RegisteredBenchmark {
+  std::string name;
+  BenchmarkFunc func;
+};
+
+std::vector<RegisteredBenchmark> &get_registry() {
+  // Function-local, since the benchmarks register during static
+  // initialization.
+  static std::vector<RegisteredBenchmark> registry;
+  return registry;
+}
+
+std::unique_ptr<BenchmarkFixture> &current_fixture() {
+  static std::unique_ptr<BenchmarkFixture> fixture;
+  return fixture;
+}
+
+struct Options {
+  std::string filter{".*"};
+  std::string out;
+  double min_time{0.5};
+  bool list{false};
+};
+
+struct Result {
+  std::string name;
+  int64 iterations{0};
+  // Per iteration, in nanoseconds.
+  double real_time{0};
+  double cpu_time{0};
+  double items_per_second{0};
+  std::string skip_message;
+};
+
+bool parse_flag(const char *arg, const char *flag, std::string *value) {
+  const auto len = std::strlen(flag);
+  if (std::strncmp(arg, flag, len) != 0 || arg[len] != '=') {
+    return false;
+  }
+  *value = arg + len + 1;
+  return true;
+}
+
+Options parse_options(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (parse_flag(argv[i], "--benchmark_filter", &value)) {
+      options.filter = value;
+    } else if (parse_flag(argv[i], "--benchmark_out", &value)) {
+      options.out = value;
+    } else if (parse_flag(argv[i], "--benchmark_min_time", &value)) {
+      options.min_time = std::stod(value);
+    } else if (std::strcmp(argv[i], "--benchmark_list_tests") == 0) {
+      options.list = true;
+    } else {
+      TI_ERROR(
+          "Unknown flag {}, expected --benchmark_filter=REGEX, "
+          "--benchmark_out=FILE, --benchmark_min_time=SECONDS or "
+          "--benchmark_list_tests",
+          argv[i]);
+    }
+  }
+  return options;
+}
+
+Result run(const RegisteredBenchmark &benchmark, double min_time) {
+  Result result;
+  result.name = benchmark.name;
+  int64 iterations = 1;
+  while (true) {
+    BenchmarkState state(iterations);
+    benchmark.func(state);
+    if (!state.skip_message().empty()) {
+      result.skip_message = state.skip_message();
+      return result;
+    }
+    const double elapsed = state.real_time();
+    constexpr int64 kMaxIterations = 1000000000;
+    if (elapsed >= min_time || iterations >= kMaxIterations) {
+      result.iterations = state.iterations();
+      result.real_time = elapsed * 1e9 / iterations;
+      result.cpu_time = state.cpu_time() * 1e9 / iterations;
+      if (state.items_per_iteration() > 0 && elapsed > 0) {
+        result.items_per_second =
+            double(state.items_per_iteration()) * iterations / elapsed;
+      }
+      return result;
+    }
+    // Same as Google Benchmark: aim 40% past the minimum time, growing by
+    // at most 10x each round, since short runs predict poorly.
+    double multiplier = elapsed > 0 ? min_time * 1.4 / elapsed : 10.0;
+    multiplier = std::min(std::max(multiplier, 1.0), 10.0);
+    iterations = std::min(kMaxIterations,
+                          std::max(iterations + 1,
+                                   (int64)std::ceil(iterations * multiplier)));
+  }
+}
+
+void print_result(const Result &result, int name_width) {
+  if (!result.skip_message.empty()) {
+    fmt::print("{:<{}} SKIPPED: {}\n", result.name, name_width,
+               result.skip_message);
+    return;
+  }
+  fmt::print("{:<{}} {:>13.0f} ns {:>13.0f} ns {:>12}", result.name,
+             name_width, result.real_time, result.cpu_time, result.iterations);
+  if (result.items_per_second > 0) {
+    fmt::print(" {:>10.4g} items/s", result.items_per_second);
+  }
+  fmt::print("\n");
+}
+
+std::string escape_json(const std::string &s) {
+  std::string escaped;
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+void write_json(const std::string &filename,
+                const std::string &executable,
+                const std::vector<Result> &results) {
+  std::ofstream os(filename);
+  TI_ERROR_IF(!os, "Failed to open {}", filename);
+  const auto now = std::time(nullptr);
+  char date[64];
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+  os << "{\n  \"context\": {\n";
+  os << fmt::format("    \"date\": \"{}\",\n", date);
+  os << fmt::format("    \"executable\": \"{}\",\n", escape_json(executable));
+  os << fmt::format("    \"num_cpus\": {},\n",
+                    std::thread::hardware_concurrency());
+#if defined(NDEBUG)
+  os << "    \"library_build_type\": \"release\"\n";
+#else
+  os << "    \"library_build_type\": \"debug\"\n";
+#endif
+  os << "  },\n  \"benchmarks\": [";
+  for (std::size_t i = 0; i < results.size(); i++) {
+    const auto &r = results[i];
+    os << (i == 0 ? "\n" : ",\n") << "    {\n";
+    os << fmt::format("      \"name\": \"{}\",\n", escape_json(r.name));
+    os << fmt::format("      \"run_name\": \"{}\",\n", escape_json(r.name));
+    os << "      \"run_type\": \"iteration\",\n";
+    if (!r.skip_message.empty()) {
+      os << "      \"error_occurred\": true,\n";
+      os << fmt::format("      \"error_message\": \"{}\"\n",
+                        escape_json(r.skip_message));
+    } else {
+      os << fmt::format("      \"iterations\": {},\n", r.iterations);
+      os << fmt::format("      \"real_time\": {:.6e},\n", r.real_time);
+      os << fmt::format("      \"cpu_time\": {:.6e},\n", r.cpu_time);
+      if (r.items_per_second > 0) {
+        os << fmt::format("      \"items_per_second\": {:.6e},\n",
+                          r.items_per_second);
+      }
+      os << "      \"time_unit\": \"ns\"\n";
+    }
+    os << "    }";
+  }
+  os << "\n  ]\n}\n";
+}
+
+}  // namespace
+
+bool register_benchmark(const std::string &name, const BenchmarkFunc &func) {
+  get_registry().push_back({name, func});
+  return true;
+}
+
+BenchmarkFixture *get_current_fixture() {
+  return current_fixture().get();
+}
+
+void reset_current_fixture(std::unique_ptr<BenchmarkFixture> fixture) {
+  current_fixture() = std::move(fixture);
+}
+
+}  // namespace lang
+}  // namespace taichi
+
+int main(int argc, char **argv) {
+  using namespace taichi::lang;
+  const auto options = parse_options(argc, argv);
+  const std::regex filter(options.filter);
+  std::vector<const RegisteredBenchmark *> selected;
+  for (const auto &benchmark : get_registry()) {
+    if (std::regex_search(benchmark.name, filter)) {
+      selected.push_back(&benchmark);
+    }
+  }
+  if (options.list) {
+    for (const auto *benchmark : selected) {
+      fmt::print("{}\n", benchmark->name);
+    }
+    return 0;
+  }
+
+  int name_width = 10;
+  for (const auto *benchmark : selected) {
+    name_width = std::max(name_width, (int)benchmark->name.size());
+  }
+  fmt::print("{:<{}} {:>16} {:>16} {:>12}\n", "Benchmark", name_width, "Time",
+             "CPU", "Iterations");
+  fmt::print("{}\n", std::string(name_width + 47, '-'));
+  std::vector<Result> results;
+  for (const auto *benchmark : selected) {
+    results.push_back(run(*benchmark, options.min_time));
+    print_result(results.back(), name_width);
+  }
+  reset_current_fixture(nullptr);
+  if (!options.out.empty()) {
+    write_json(options.out, argv[0], results);
+  }
+  return 0;
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "taichi/common/core.h"
+
+namespace taichi {
+namespace lang {
+
+// A minimal harness in the style of Google Benchmark, whose JSON output it
+// also writes (--benchmark_out=FILE), so that the results can be compared
+// across builds with its tools/compare.py. A benchmark is a function that
+// times its loop body:
+//
+//   TI_BENCHMARK(ThreadPool_run) {
+//     ThreadPool pool(8);
+//     while (state.keep_running()) {
+//       pool.run(...);
+//     }
+//   }
+//
+// The number of iterations is increased until the loop runs for at least
+// --benchmark_min_time seconds.
+class BenchmarkState {
+ public:
+  explicit BenchmarkState(int64 max_iterations)
+      : max_iterations_(max_iterations) {
+  }
+
+  // Starts the timer on the first call, and stops it once the loop has run
+  // for |max_iterations| iterations.
+  bool keep_running() {
+    if (!started_) {
+      started_ = true;
+      resume_timing();
+    } else {
+      iterations_++;
+    }
+    if (iterations_ < max_iterations_ && skip_message_.empty()) {
+      return true;
+    }
+    pause_timing();
+    return false;
+  }
+
+  // Leaves the setup of an iteration out of the measured time.
+  void pause_timing() {
+    if (!running_) {
+      return;
+    }
+    real_time_ += std::chrono::duration<double>(Clock::now() - real_start_)
+                      .count();
+    cpu_time_ += double(std::clock() - cpu_start_) / CLOCKS_PER_SEC;
+    running_ = false;
+  }
+
+  void resume_timing() {
+    if (running_) {
+      return;
+    }
+    real_start_ = Clock::now();
+    cpu_start_ = std::clock();
+    running_ = true;
+  }
+
+  // The number of items processed by each iteration, for the items/s.
+  void set_items_per_iteration(int64 items) {
+    items_per_iteration_ = items;
+  }
+
+  // Skips the benchmark, e.g. if the device is not available. The loop
+  // should not be entered, or left at once.
+  void skip(const std::string &message) {
+    skip_message_ = message;
+  }
+
+  int64 iterations() const {
+    return iterations_;
+  }
+
+  // In seconds.
+  double real_time() const {
+    return real_time_;
+  }
+
+  double cpu_time() const {
+    return cpu_time_;
+  }
+
+  int64 items_per_iteration() const {
+    return items_per_iteration_;
+  }
+
+  const std::string &skip_message() const {
+    return skip_message_;
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  int64 max_iterations_{0};
+  int64 iterations_{0};
+  bool started_{false};
+  bool running_{false};
+  Clock::time_point real_start_;
+  std::clock_t cpu_start_{0};
+  double real_time_{0};
+  double cpu_time_{0};
+  int64 items_per_iteration_{0};
+  std::string skip_message_;
+};
+
+using BenchmarkFunc = std::function<void(BenchmarkState &)>;
+
+// Returns true, so that it can initialize a static variable.
+bool register_benchmark(const std::string &name, const BenchmarkFunc &func);
+
+// The state shared by the runs of a group of benchmarks, typically a Program,
+// which is expensive to create. Since only one Program can exist at a time,
+// so does only one fixture: getting a fixture of another type destroys the
+// current one. The benchmarks run in the order they are registered, so each
+// fixture is created once.
+class BenchmarkFixture {
+ public:
+  virtual ~BenchmarkFixture() = default;
+};
+
+BenchmarkFixture *get_current_fixture();
+
+void reset_current_fixture(std::unique_ptr<BenchmarkFixture> fixture);
+
+template <typename T>
+T &get_fixture() {
+  if (auto *fixture = dynamic_cast<T *>(get_current_fixture())) {
+    return *fixture;
+  }
+  reset_current_fixture(nullptr);
+  reset_current_fixture(std::make_unique<T>());
+  return static_cast<T &>(*get_current_fixture());
+}
+
+}  // namespace lang
+}  // namespace taichi
+
+#define TI_BENCHMARK(name)                                              \
+  static void ti_benchmark_##name(::taichi::lang::BenchmarkState &);    \
+  [[maybe_unused]] static const bool ti_benchmark_##name##_registered = \
+      ::taichi::lang::register_benchmark(#name, ti_benchmark_##name);   \
+  static void ti_benchmark_##name(::taichi::lang::BenchmarkState &state)
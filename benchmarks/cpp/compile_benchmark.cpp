@@ -0,0 +1,185 @@
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmarks/cpp/benchmark.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/program/program.h"
+
+namespace taichi {
+namespace lang {
+namespace {
+
+// The canned IR of the compile time benchmarks: a range-for over an external
+// array, with a long chain of arithmetic on a local variable. The chain has
+// work for most of the simplification passes: duplicate expressions for CSE,
+// identities for alg_simp, and redundant loads for cfg_optimization.
+//
+//   @ti.kernel
+//   def chain(a: ti.ext_arr(), n: ti.i32):
+//     for i in range(n):
+//       v = a[i]
+//       for k in ti.static(range(kChainLength)):
+//         v = (v * c[k] + v * c[k] + 0.0) * 1.0
+//       a[i] = v
+std::unique_ptr<Block> build_canned_ir(int chain_length) {
+  IRBuilder builder;
+  auto *array = builder.create_arg_load(/*arg_id=*/0, PrimitiveType::f32,
+                                        /*is_ptr=*/true);
+  auto *n = builder.create_arg_load(/*arg_id=*/1, PrimitiveType::i32,
+                                    /*is_ptr=*/false);
+  auto *loop = builder.create_range_for(builder.get_int32(0), n);
+  {
+    auto _ = builder.get_loop_guard(loop);
+    auto *index = builder.get_loop_index(loop);
+    auto *v = builder.create_local_var(PrimitiveType::f32);
+    builder.create_local_store(
+        v, builder.create_global_load(
+               builder.create_external_ptr(array, {index})));
+    for (int k = 0; k < chain_length; k++) {
+      auto *c = builder.get_float32(1.0f + k * 1e-3f);
+      auto *lhs = builder.create_mul(builder.create_local_load(v), c);
+      auto *rhs = builder.create_mul(builder.create_local_load(v), c);
+      auto *sum = builder.create_add(builder.create_add(lhs, rhs),
+                                     builder.get_float32(0));
+      builder.create_local_store(
+          v, builder.create_mul(sum, builder.get_float32(1)));
+    }
+    builder.create_global_store(builder.create_external_ptr(array, {index}),
+                                builder.create_local_load(v));
+  }
+  return builder.extract_ir();
+}
+
+class CompileFixture : public BenchmarkFixture {
+ public:
+  static constexpr int kChainLength = 256;
+
+  CompileFixture() : program_(Arch::x64) {
+    program_.materialize_runtime();
+    program_.add_snode_tree(
+        std::make_unique<SNode>(/*depth=*/0, SNodeType::root),
+        /*compile_only=*/false);
+    untyped_ir_ = build_canned_ir(kChainLength);
+    typed_ir_ = irpass::analysis::clone(untyped_ir_.get());
+    irpass::type_check(typed_ir_.get(), program_.config);
+  }
+
+  Program &program() {
+    return program_;
+  }
+
+  const CompileConfig &config() const {
+    return program_.config;
+  }
+
+  // A fresh copy of the canned IR, before or after the type check.
+  std::unique_ptr<IRNode> clone_ir(bool typed) const {
+    return irpass::analysis::clone(typed ? typed_ir_.get() : untyped_ir_.get());
+  }
+
+  std::unique_ptr<Kernel> make_kernel() {
+    auto kernel = std::make_unique<Kernel>(program_, clone_ir(/*typed=*/false),
+                                           "chain");
+    kernel->insert_arg(PrimitiveType::f32, /*is_external_array=*/true);
+    kernel->insert_arg(PrimitiveType::i32, /*is_external_array=*/false);
+    return kernel;
+  }
+
+ private:
+  Program program_;
+  std::unique_ptr<IRNode> untyped_ir_;
+  std::unique_ptr<IRNode> typed_ir_;
+};
+
+using PassFunc = std::function<void(IRNode *, CompileFixture &)>;
+
+// A single pass on a fresh copy of the canned IR.
+void run_pass(BenchmarkState &state, bool typed, const PassFunc &pass) {
+  auto &fixture = get_fixture<CompileFixture>();
+  while (state.keep_running()) {
+    state.pause_timing();
+    auto ir = fixture.clone_ir(typed);
+    state.resume_timing();
+    pass(ir.get(), fixture);
+    state.pause_timing();
+    ir.reset();
+    state.resume_timing();
+  }
+}
+
+[[maybe_unused]] const bool registered = [] {
+  const std::vector<std::pair<std::string, PassFunc>> typed_passes = {
+      {"simplify",
+       [](IRNode *ir, CompileFixture &f) {
+         irpass::simplify(ir, f.config());
+       }},
+      {"alg_simp",
+       [](IRNode *ir, CompileFixture &f) {
+         irpass::alg_simp(ir, f.config());
+       }},
+      {"whole_kernel_cse",
+       [](IRNode *ir, CompileFixture &) { irpass::whole_kernel_cse(ir); }},
+      {"die", [](IRNode *ir, CompileFixture &) { irpass::die(ir); }},
+      {"cfg_optimization",
+       [](IRNode *ir, CompileFixture &) {
+         irpass::cfg_optimization(ir, /*after_lower_access=*/false);
+       }},
+      {"full_simplify",
+       [](IRNode *ir, CompileFixture &f) {
+         irpass::full_simplify(
+             ir, f.config(),
+             {/*after_lower_access=*/false, /*program=*/&f.program()});
+       }},
+  };
+  register_benchmark("IRPass/type_check", [](BenchmarkState &state) {
+    run_pass(state, /*typed=*/false, [](IRNode *ir, CompileFixture &f) {
+      irpass::type_check(ir, f.config());
+    });
+  });
+  for (const auto &[name, pass] : typed_passes) {
+    register_benchmark("IRPass/" + name, [pass](BenchmarkState &state) {
+      run_pass(state, /*typed=*/true, pass);
+    });
+  }
+  return true;
+}();
+
+}  // namespace
+
+// All the passes from the canned IR to the offloaded tasks ready for codegen.
+TI_BENCHMARK(Kernel_lower) {
+  auto &fixture = get_fixture<CompileFixture>();
+  while (state.keep_running()) {
+    state.pause_timing();
+    auto kernel = fixture.make_kernel();
+    state.resume_timing();
+    kernel->lower();
+    state.pause_timing();
+    kernel.reset();
+    state.resume_timing();
+  }
+}
+
+// Lowering followed by the LLVM codegen, i.e. what the first launch of a
+// kernel pays for.
+TI_BENCHMARK(Kernel_compile) {
+  auto &fixture = get_fixture<CompileFixture>();
+  while (state.keep_running()) {
+    state.pause_timing();
+    auto kernel = fixture.make_kernel();
+    state.resume_timing();
+    kernel->compile();
+    state.pause_timing();
+    kernel.reset();
+    state.resume_timing();
+  }
+}
+
+}  // namespace lang
+}  // namespace taichi
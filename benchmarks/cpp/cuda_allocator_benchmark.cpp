@@ -0,0 +1,77 @@
+#include <memory>
+#include <vector>
+
+#include "benchmarks/cpp/benchmark.h"
+#include "taichi/platform/cuda/detect_cuda.h"
+#include "taichi/program/ndarray.h"
+#include "taichi/program/program.h"
+
+namespace taichi {
+namespace lang {
+namespace {
+
+class CudaFixture : public BenchmarkFixture {
+ public:
+  CudaFixture() : program_(Arch::cuda) {
+    program_.config.ndarray_use_cached_allocator = true;
+    program_.materialize_runtime();
+  }
+
+  Program *program() {
+    return &program_;
+  }
+
+ private:
+  Program program_;
+};
+
+// An ndarray of |size| bytes allocated and freed in a loop, which the
+// CudaCachingAllocator serves from the same cached block.
+void allocate_release(BenchmarkState &state, int size) {
+  if (!is_cuda_api_available()) {
+    state.skip("CUDA is not available");
+    return;
+  }
+  auto *program = get_fixture<CudaFixture>().program();
+  while (state.keep_running()) {
+    Ndarray ndarray(program, PrimitiveType::u8, {size});
+  }
+}
+
+// A burst of ndarrays of mixed sizes, freed in the reverse order, which
+// splits the cached blocks and merges them back.
+void allocate_release_mixed(BenchmarkState &state) {
+  if (!is_cuda_api_available()) {
+    state.skip("CUDA is not available");
+    return;
+  }
+  auto *program = get_fixture<CudaFixture>().program();
+  const std::vector<int> sizes = {256, 4096, 1 << 20, 64, 16 << 20, 512};
+  std::vector<std::unique_ptr<Ndarray>> ndarrays;
+  while (state.keep_running()) {
+    for (int size : sizes) {
+      ndarrays.push_back(
+          std::make_unique<Ndarray>(program, PrimitiveType::u8,
+                                    std::vector<int>{size}));
+    }
+    while (!ndarrays.empty()) {
+      ndarrays.pop_back();
+    }
+  }
+  state.set_items_per_iteration(sizes.size());
+}
+
+[[maybe_unused]] const bool registered = [] {
+  for (int size : {256, 1 << 20, 64 << 20}) {
+    register_benchmark(
+        fmt::format("CudaCachingAllocator_allocate_release/size:{}", size),
+        [size](BenchmarkState &state) { allocate_release(state, size); });
+  }
+  register_benchmark("CudaCachingAllocator_allocate_release_mixed",
+                     allocate_release_mixed);
+  return true;
+}();
+
+}  // namespace
+}  // namespace lang
+}  // namespace taichi
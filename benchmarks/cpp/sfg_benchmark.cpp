@@ -0,0 +1,167 @@
+#include <memory>
+#include <vector>
+
+#include "benchmarks/cpp/benchmark.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/statements.h"
+#include "taichi/program/async_engine.h"
+#include "taichi/program/program.h"
+
+namespace taichi {
+namespace lang {
+namespace {
+
+// A Program in async mode on x64, with the fields
+//
+//   ti.root.dense(ti.i, kN).place(x, y)
+//   ti.root.pointer(ti.i, kN // 16).dense(ti.i, 16).place(z)
+//
+// and kernels whose launches leave the StateFlowGraph something to optimize:
+// chains of element-wise range-fors to fuse, and repeated struct-fors over
+// |z| whose listgen tasks are redundant.
+class SFGFixture : public BenchmarkFixture {
+ public:
+  static constexpr int kN = 1 << 16;
+
+  SFGFixture() : program_(make_async_program()) {
+    // Only flushed by the benchmarks.
+    program_->config.async_flush_every = 0;
+    program_->materialize_runtime();
+    auto root = std::make_unique<SNode>(/*depth=*/0, SNodeType::root);
+    auto *dense = &root->dense(Axis(0), kN, false);
+    x_ = &dense->insert_children(SNodeType::place);
+    x_->dt = PrimitiveType::f32;
+    y_ = &dense->insert_children(SNodeType::place);
+    y_->dt = PrimitiveType::f32;
+    auto *pointer = &root->pointer(Axis(0), kN / 16, false);
+    z_ = &pointer->dense(Axis(0), 16, false).insert_children(SNodeType::place);
+    z_->dt = PrimitiveType::f32;
+    program_->add_snode_tree(std::move(root), /*compile_only=*/false);
+
+    inc_x_ = make_range_for_kernel("inc_x", x_, x_);
+    copy_x_to_y_ = make_range_for_kernel("copy_x_to_y", x_, y_);
+    inc_z_ = make_struct_for_kernel("inc_z");
+    // Compiles the tasks out of the measurements.
+    launch_batch(/*num_repeats=*/1);
+    flush();
+    program_->synchronize();
+  }
+
+  ~SFGFixture() override {
+    program_->synchronize();
+  }
+
+  // Returns the number of launches.
+  int launch_batch(int num_repeats) {
+    for (int i = 0; i < num_repeats; i++) {
+      for (auto *kernel : {inc_x_, inc_x_, copy_x_to_y_, inc_z_, inc_z_}) {
+        auto ctx = kernel->make_launch_context();
+        (*kernel)(ctx);
+      }
+    }
+    return num_repeats * 5;
+  }
+
+  // Optimizes the pending tasks, and hands them to the execution queue.
+  void flush() {
+    program_->async_engine->flush();
+  }
+
+  void synchronize() {
+    program_->synchronize();
+  }
+
+ private:
+  static std::unique_ptr<Program> make_async_program() {
+    // The async engine is created along with the program.
+    const bool async_mode = default_compile_config.async_mode;
+    default_compile_config.async_mode = true;
+    auto program = std::make_unique<Program>(Arch::x64);
+    default_compile_config.async_mode = async_mode;
+    return program;
+  }
+
+  // for i in range(kN):
+  //   dst[i] = src[i] + 1
+  Kernel *make_range_for_kernel(const std::string &name,
+                                SNode *src,
+                                SNode *dst) {
+    IRBuilder builder;
+    auto *loop =
+        builder.create_range_for(builder.get_int32(0), builder.get_int32(kN));
+    {
+      auto _ = builder.get_loop_guard(loop);
+      auto *index = builder.get_loop_index(loop);
+      auto *value = builder.create_global_load(
+          builder.create_global_ptr(src, {index}));
+      builder.create_global_store(
+          builder.create_global_ptr(dst, {index}),
+          builder.create_add(value, builder.get_float32(1)));
+    }
+    return add_kernel(builder, name);
+  }
+
+  // for i in z:
+  //   z[i] += 1
+  Kernel *make_struct_for_kernel(const std::string &name) {
+    IRBuilder builder;
+    auto *loop = builder.create_struct_for(z_);
+    {
+      auto _ = builder.get_loop_guard(loop);
+      auto *ptr = builder.create_global_ptr(z_, {builder.get_loop_index(loop)});
+      builder.create_global_store(
+          ptr, builder.create_add(builder.create_global_load(ptr),
+                                  builder.get_float32(1)));
+    }
+    return add_kernel(builder, name);
+  }
+
+  Kernel *add_kernel(IRBuilder &builder, const std::string &name) {
+    kernels_.push_back(
+        std::make_unique<Kernel>(*program_, builder.extract_ir(), name));
+    return kernels_.back().get();
+  }
+
+  std::unique_ptr<Program> program_;
+  SNode *x_{nullptr};
+  SNode *y_{nullptr};
+  SNode *z_{nullptr};
+  std::vector<std::unique_ptr<Kernel>> kernels_;
+  Kernel *inc_x_{nullptr};
+  Kernel *copy_x_to_y_{nullptr};
+  Kernel *inc_z_{nullptr};
+};
+
+// The optimization of the StateFlowGraph at a flush: activation demotion,
+// listgen and dead store elimination, and task fusion, followed by handing
+// the (cached) compiled tasks to the execution queue. Inserting the tasks
+// and running them are not measured.
+void optimize(BenchmarkState &state, int num_repeats) {
+  auto &fixture = get_fixture<SFGFixture>();
+  int num_launches = 0;
+  while (state.keep_running()) {
+    state.pause_timing();
+    num_launches = fixture.launch_batch(num_repeats);
+    state.resume_timing();
+    fixture.flush();
+    state.pause_timing();
+    fixture.synchronize();
+    state.resume_timing();
+  }
+  state.set_items_per_iteration(num_launches);
+}
+
+[[maybe_unused]] const bool registered = [] {
+  for (int num_repeats : {1, 10, 100}) {
+    register_benchmark(
+        fmt::format("StateFlowGraph_optimize/launches:{}", num_repeats * 5),
+        [num_repeats](BenchmarkState &state) {
+          optimize(state, num_repeats);
+        });
+  }
+  return true;
+}();
+
+}  // namespace
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,230 @@
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "benchmarks/cpp/benchmark.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/statements.h"
+#include "taichi/program/program.h"
+
+namespace taichi {
+namespace lang {
+namespace {
+
+// The sparse data structures of the LLVM runtime on x64, driven by kernels
+// built with IRBuilder:
+//
+//   ti.root.pointer(ti.i, kNumBlocks).dense(ti.i, kBlockSize).place(x)
+//   ti.root.dynamic(ti.i, kListCapacity, kChunkSize).place(l)
+//
+// The pointer cells are allocated and recycled by the NodeManager, and the
+// struct-fors over them run listgen, which fills the element lists with
+// ListManager::append().
+class SNodeFixture : public BenchmarkFixture {
+ public:
+  static constexpr int kNumBlocks = 4096;
+  static constexpr int kBlockSize = 16;
+  static constexpr int kListCapacity = 1 << 20;
+  static constexpr int kChunkSize = 1024;
+
+  SNodeFixture() : program_(Arch::x64) {
+    program_.materialize_runtime();
+    auto root = std::make_unique<SNode>(/*depth=*/0, SNodeType::root);
+    pointer_ = &root->pointer(Axis(0), kNumBlocks, false);
+    auto *block = &pointer_->dense(Axis(0), kBlockSize, false);
+    x_ = &block->insert_children(SNodeType::place);
+    x_->dt = PrimitiveType::f32;
+    dynamic_ = &root->dynamic(Axis(0), kListCapacity, kChunkSize, false);
+    auto *l = &dynamic_->insert_children(SNodeType::place);
+    l->dt = PrimitiveType::i32;
+    program_.add_snode_tree(std::move(root), /*compile_only=*/false);
+
+    for (int stride : {1, 16}) {
+      activate_kernels_[stride] = make_activate_kernel(stride);
+    }
+    deactivate_kernel_ = make_deactivate_kernel();
+    struct_for_kernel_ = make_struct_for_kernel();
+    for (int n : {1024, 65536}) {
+      append_kernels_[n] = make_append_kernel(n);
+    }
+    clear_list_kernel_ = make_clear_list_kernel();
+    // Compiles all the kernels out of the measurements.
+    activate(1);
+    struct_for();
+    deactivate_all();
+    for (auto &it : append_kernels_) {
+      append(it.first);
+    }
+    clear_list();
+  }
+
+  // Activates every |stride|-th block.
+  void activate(int stride) {
+    launch(activate_kernels_.at(stride));
+  }
+
+  void deactivate_all() {
+    launch(deactivate_kernel_);
+  }
+
+  void struct_for() {
+    launch(struct_for_kernel_);
+  }
+
+  void append(int n) {
+    launch(append_kernels_.at(n));
+  }
+
+  void clear_list() {
+    launch(clear_list_kernel_);
+  }
+
+ private:
+  // for i in range(kNumBlocks // stride):
+  //   x[i * stride * kBlockSize] = 1
+  Kernel *make_activate_kernel(int stride) {
+    IRBuilder builder;
+    auto *loop = builder.create_range_for(
+        builder.get_int32(0), builder.get_int32(kNumBlocks / stride));
+    {
+      auto _ = builder.get_loop_guard(loop);
+      auto *index = builder.create_mul(builder.get_loop_index(loop),
+                                       builder.get_int32(stride * kBlockSize));
+      builder.create_global_store(builder.create_global_ptr(x_, {index}),
+                                  builder.get_float32(1));
+    }
+    return add_kernel(builder, fmt::format("activate_{}", stride));
+  }
+
+  // for i in range(kNumBlocks):
+  //   ti.deactivate(x.parent().parent(), i * kBlockSize)
+  Kernel *make_deactivate_kernel() {
+    IRBuilder builder;
+    auto *loop = builder.create_range_for(builder.get_int32(0),
+                                          builder.get_int32(kNumBlocks));
+    {
+      auto _ = builder.get_loop_guard(loop);
+      auto *index = builder.create_mul(builder.get_loop_index(loop),
+                                       builder.get_int32(kBlockSize));
+      auto *ptr = builder.create_global_ptr(pointer_, {index});
+      builder.insert(Stmt::make_typed<SNodeOpStmt>(SNodeOpType::deactivate,
+                                                   pointer_, ptr));
+    }
+    return add_kernel(builder, "deactivate");
+  }
+
+  // for i in x:
+  //   x[i] += 1
+  Kernel *make_struct_for_kernel() {
+    IRBuilder builder;
+    auto *loop = builder.create_struct_for(x_);
+    {
+      auto _ = builder.get_loop_guard(loop);
+      auto *ptr = builder.create_global_ptr(x_, {builder.get_loop_index(loop)});
+      builder.create_global_store(
+          ptr, builder.create_add(builder.create_global_load(ptr),
+                                  builder.get_float32(1)));
+    }
+    return add_kernel(builder, "struct_for");
+  }
+
+  // for i in range(n):
+  //   ti.append(l.parent(), [], i)
+  Kernel *make_append_kernel(int n) {
+    IRBuilder builder;
+    auto *loop =
+        builder.create_range_for(builder.get_int32(0), builder.get_int32(n));
+    {
+      auto _ = builder.get_loop_guard(loop);
+      auto *ptr = builder.create_global_ptr(dynamic_, {});
+      builder.insert(Stmt::make_typed<SNodeOpStmt>(
+          SNodeOpType::append, dynamic_, ptr, builder.get_loop_index(loop)));
+    }
+    return add_kernel(builder, fmt::format("append_{}", n));
+  }
+
+  // ti.deactivate(l.parent(), [])
+  Kernel *make_clear_list_kernel() {
+    IRBuilder builder;
+    auto *ptr = builder.create_global_ptr(dynamic_, {});
+    builder.insert(Stmt::make_typed<SNodeOpStmt>(SNodeOpType::deactivate,
+                                                 dynamic_, ptr));
+    return add_kernel(builder, "clear_list");
+  }
+
+  Kernel *add_kernel(IRBuilder &builder, const std::string &name) {
+    kernels_.push_back(
+        std::make_unique<Kernel>(program_, builder.extract_ir(), name));
+    return kernels_.back().get();
+  }
+
+  static void launch(Kernel *kernel) {
+    auto ctx = kernel->make_launch_context();
+    (*kernel)(ctx);
+  }
+
+  Program program_;
+  SNode *pointer_{nullptr};
+  SNode *x_{nullptr};
+  SNode *dynamic_{nullptr};
+  std::vector<std::unique_ptr<Kernel>> kernels_;
+  std::unordered_map<int, Kernel *> activate_kernels_;
+  std::unordered_map<int, Kernel *> append_kernels_;
+  Kernel *deactivate_kernel_{nullptr};
+  Kernel *struct_for_kernel_{nullptr};
+  Kernel *clear_list_kernel_{nullptr};
+};
+
+// NodeManager::allocate() for each block, then the recycling of all of them
+// by the deactivation and the garbage collection.
+void allocate_recycle(BenchmarkState &state, int stride) {
+  auto &fixture = get_fixture<SNodeFixture>();
+  while (state.keep_running()) {
+    fixture.activate(stride);
+    fixture.deactivate_all();
+  }
+  state.set_items_per_iteration(SNodeFixture::kNumBlocks / stride);
+}
+
+// The struct-for over the active blocks, including the listgen tasks.
+void listgen(BenchmarkState &state, int stride) {
+  auto &fixture = get_fixture<SNodeFixture>();
+  fixture.activate(stride);
+  while (state.keep_running()) {
+    fixture.struct_for();
+  }
+  fixture.deactivate_all();
+  state.set_items_per_iteration(SNodeFixture::kNumBlocks / stride);
+}
+
+void dynamic_append(BenchmarkState &state, int n) {
+  auto &fixture = get_fixture<SNodeFixture>();
+  while (state.keep_running()) {
+    fixture.append(n);
+    state.pause_timing();
+    fixture.clear_list();
+    state.resume_timing();
+  }
+  state.set_items_per_iteration(n);
+}
+
+[[maybe_unused]] const bool registered = [] {
+  for (int stride : {1, 16}) {
+    register_benchmark(
+        fmt::format("NodeManager_allocate_recycle/stride:{}", stride),
+        [stride](BenchmarkState &state) { allocate_recycle(state, stride); });
+    register_benchmark(
+        fmt::format("ListManager_listgen/stride:{}", stride),
+        [stride](BenchmarkState &state) { listgen(state, stride); });
+  }
+  for (int n : {1024, 65536}) {
+    register_benchmark(
+        fmt::format("Dynamic_append/n:{}", n),
+        [n](BenchmarkState &state) { dynamic_append(state, n); });
+  }
+  return true;
+}();
+
+}  // namespace
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "benchmarks/cpp/benchmark.h"
+#include "taichi/system/threading.h"
+
+namespace taichi {
+namespace lang {
+namespace {
+
+void empty_task(void *, int, int) {
+}
+
+void count_task(void *ctx, int, int) {
+  ((std::atomic<int64> *)ctx)->fetch_add(1, std::memory_order_relaxed);
+}
+
+// The launch latency of a parallel loop: the wake-up of the workers, the
+// partitioning and the final barrier, with nothing to do in between.
+void run_empty(BenchmarkState &state, int splits) {
+  const int num_threads =
+      std::max(1, (int)std::thread::hardware_concurrency());
+  ThreadPool pool(num_threads);
+  while (state.keep_running()) {
+    pool.run(splits, num_threads, nullptr, empty_task);
+  }
+  state.set_items_per_iteration(splits);
+}
+
+[[maybe_unused]] const bool registered = [] {
+  for (int splits : {1, 64, 4096, 262144}) {
+    register_benchmark(
+        fmt::format("ThreadPool_run_empty/splits:{}", splits),
+        [splits](BenchmarkState &state) { run_empty(state, splits); });
+  }
+  return true;
+}();
+
+}  // namespace
+
+// Many tiny tasks contending on one cache line, which stresses the stealing.
+TI_BENCHMARK(ThreadPool_run_contended) {
+  const int num_threads =
+      std::max(1, (int)std::thread::hardware_concurrency());
+  ThreadPool pool(num_threads);
+  std::atomic<int64> counter{0};
+  constexpr int kSplits = 65536;
+  while (state.keep_running()) {
+    pool.run(kSplits, num_threads, &counter, count_task);
+  }
+  state.set_items_per_iteration(kSplits);
+}
+
+// The back-to-back launches of a single-threaded pool, i.e. the overhead
+// that is not parallelism.
+TI_BENCHMARK(ThreadPool_run_single_thread) {
+  ThreadPool pool(1);
+  while (state.keep_running()) {
+    pool.run(1, 1, nullptr, empty_task);
+  }
+}
+
+}  // namespace lang
+}  // namespace taichi
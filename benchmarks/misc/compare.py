@@ -0,0 +1,147 @@
+import argparse
+import itertools
+import json
+import os
+import random
+import sys
+
+
+def load_json(path):
+    with open(path) as f:
+        return json.load(f)
+
+
+def collect_items(obj, key, peak, results):
+    """Collects the results in |obj| and its nested dicts, under the keys
+    prefixed by |key|."""
+    if 'samples_ms' not in obj and 'elapsed_time_ms' not in obj:
+        for name, child in obj.items():
+            if isinstance(child, dict):
+                collect_items(child, key + (name, ), peak, results)
+        return
+    samples = obj.get('samples_ms', [obj['elapsed_time_ms']])
+    if 'dsize_byte' in obj:
+        results[key] = [
+            obj['dsize_byte'] / (ms * 1e-3) / 1e9 / peak for ms in samples
+        ]
+    else:
+        # Not normalized, e.g. compile times, of which higher is better.
+        results[key] = [1 / ms for ms in samples]
+
+
+def load_results(benchmark_dir):
+    """Returns {(arch, suite, case, ...): samples}, where the samples are
+    the performance of each trial, the higher the better. For the memory
+    bound cases, they are the achieved bandwidth as a fraction of the
+    measured peak bandwidth of the machine. The normalization lets a baseline
+    from one machine be compared with results from another."""
+    results = {}
+    info = load_json(os.path.join(benchmark_dir, '_info.json'))
+    for arch, suites in info['archs'].items():
+        for suite in suites:
+            suite_dir = os.path.join(benchmark_dir, arch, suite)
+            suite_info = load_json(os.path.join(suite_dir, '_info.json'))
+            # Results from before the peak was measured are not normalized.
+            peak = suite_info.get('peak_bandwidth_GBps', 1.0)
+            for case in suite_info['cases']:
+                case_results = load_json(
+                    os.path.join(suite_dir, case + '.json'))
+                collect_items(case_results, (arch, suite, case), peak,
+                              results)
+    return results
+
+
+def mean(samples):
+    return sum(samples) / len(samples)
+
+
+def permutation_test(baseline, current, max_permutations=10000):
+    """Returns the one-sided p-value of the current samples having a lower
+    mean than the baseline samples by chance, i.e. with the labels of the
+    samples shuffled. Makes no assumption on the distribution of the samples,
+    of which there are only a few per case."""
+    pooled = baseline + current
+    n = len(current)
+    observed = mean(baseline) - mean(current)
+    total = sum(pooled)
+
+    def diff(indices):
+        current_sum = sum(pooled[i] for i in indices)
+        return (total - current_sum) / len(baseline) - current_sum / n
+
+    num_combinations = 1
+    for i in range(n):
+        num_combinations = num_combinations * (len(pooled) - i) // (i + 1)
+    if num_combinations <= max_permutations:
+        combinations = itertools.combinations(range(len(pooled)), n)
+    else:
+        rng = random.Random(0)
+        combinations = (rng.sample(range(len(pooled)), n)
+                        for _ in range(max_permutations))
+        num_combinations = max_permutations
+    # Tolerates the rounding of the sums.
+    eps = 1e-12 * max(abs(observed), 1.0)
+    count = sum(1 for c in combinations if diff(c) >= observed - eps)
+    return count / num_combinations
+
+
+def compare(baseline, current, threshold, alpha):
+    """Returns [(key, change, p_value)] of the cases in both results, where
+    |change| is the relative change of the mean performance."""
+    changes = []
+    for key in sorted(baseline.keys() & current.keys()):
+        change = mean(current[key]) / mean(baseline[key]) - 1
+        if abs(change) < threshold:
+            continue
+        if change < 0:
+            p_value = permutation_test(baseline[key], current[key])
+        else:
+            p_value = permutation_test(current[key], baseline[key])
+        if p_value < alpha:
+            changes.append((key, change, p_value))
+    return changes
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description='Compares the results of run.py with a baseline, and '
+        'exits with 1 on any significant regression.')
+    parser.add_argument('baseline', help='The results directory of run.py')
+    parser.add_argument('current', help='The results directory of run.py')
+    parser.add_argument('-t',
+                        '--threshold',
+                        type=float,
+                        default=0.05,
+                        help='The relative change ignored as noise')
+    parser.add_argument('-a',
+                        '--alpha',
+                        type=float,
+                        default=0.05,
+                        help='The significance level of the changes')
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    baseline_info = load_json(os.path.join(args.baseline, '_info.json'))
+    current_info = load_json(os.path.join(args.current, '_info.json'))
+    print(f'baseline = {baseline_info["commit_hash"]}')
+    print(f'current = {current_info["commit_hash"]}')
+    if baseline_info.get('device') != current_info.get('device'):
+        print('The results are from different machines, only the memory '
+              'bound ones are normalized by the peak bandwidth of each.')
+
+    changes = compare(load_results(args.baseline),
+                      load_results(args.current), args.threshold, args.alpha)
+    regressions = [c for c in changes if c[1] < 0]
+    improvements = [c for c in changes if c[1] > 0]
+    for title, items in [('Regressions', regressions),
+                         ('Improvements', improvements)]:
+        print(f'{title}: {len(items)}')
+        for key, change, p_value in items:
+            print(f'  {".".join(key)}: {change:+.1%} (p = {p_value:.3f})')
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
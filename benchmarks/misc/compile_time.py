@@ -0,0 +1,120 @@
+import os
+import time
+
+from compile_time_cases import compile_time_cases_list
+from utils import arch_name, datatime_with_format, dump2json
+
+import taichi as ti
+from taichi.lang import impl
+
+
+class CompileTime:
+    suite_name = 'compiletime'
+    supported_archs = [ti.x64, ti.cuda]
+    test_cases = compile_time_cases_list
+    # Each trial compiles the kernels in a new program.
+    num_trials = 5
+
+    def __init__(self, arch):
+        self._arch = arch
+        self._cases_impl = [CaseImpl(case, arch) for case in self.test_cases]
+
+    def run(self):
+        for case in self._cases_impl:
+            case.run(self.num_trials)
+
+    def save_as_json(self, arch_dir='./'):
+        #folder of suite
+        suite_path = os.path.join(arch_dir, self.suite_name)
+        os.makedirs(suite_path)
+        cases = [case for case in self._cases_impl if case.supported]
+        info_dict = {
+            'cases': [case._name for case in cases],
+            'num_trials': self.num_trials
+        }
+        with open(os.path.join(suite_path, '_info.json'), 'w') as f:
+            print(dump2json(info_dict), file=f)
+        for case in cases:
+            case_path = os.path.join(suite_path, case._name + '.json')
+            with open(case_path, 'w') as f:
+                print(dump2json(case.get_results_dict()), file=f)
+
+    def save_as_markdown(self, arch_dir='./'):
+        current_time = datatime_with_format()
+        commit_hash = ti.core.get_commit_hash()  #[:8]
+        file_path = os.path.join(arch_dir, f'{self.suite_name}.md')
+        with open(file_path, 'w') as f:
+            lines = [
+                f'commit_hash: {commit_hash}\n', f'datatime: {current_time}\n'
+            ]
+            lines += self._get_markdown_lines()
+            for line in lines:
+                print(line, file=f)
+
+    def _get_markdown_lines(self):
+        lines = [
+            f'|{self.suite_name}.{arch_name(self._arch)}|min(ms)'
+            '|IR passes(ms)|backend(ms)|',
+            '|:--:|:--:|:--:|:--:|',
+        ]
+        for case in self._cases_impl:
+            lines += case.get_markdown_lines()
+        lines.append('')
+        return lines
+
+
+class CaseImpl:
+    def __init__(self, func, arch):
+        self._func = func
+        self._name = func.__name__
+        self._arch = arch
+        self.supported = True
+        self._samples_in_ms = []  #compile time of each trial
+        self._passes_in_ms = {}  #average of the trials
+        self._stages_in_ms = {}
+
+    def run(self, num_trials):
+        print(f'TestCase[{self._name}.{arch_name(self._arch)}]')
+        for trial in range(num_trials):
+            ti.init(arch=self._arch, profile_passes=True, offline_cache=False)
+            compile_all = self._func()
+            if compile_all is None:
+                self.supported = False
+                ti.reset()
+                return
+            # Leaves the fields out of the measurements.
+            impl.get_runtime().materialize()
+            ti.sync()
+            ti.clear_pass_profile_info()
+            start = time.perf_counter()
+            compile_all()
+            ti.sync()
+            self._samples_in_ms.append((time.perf_counter() - start) * 1000)
+            info = ti.query_pass_profile_info()
+            for records, result in [(info['passes'], self._passes_in_ms),
+                                    (info['stages'], self._stages_in_ms)]:
+                for name, record in records.items():
+                    result[name] = result.get(
+                        name, 0) + record['total_time'] * 1000 / num_trials
+            ti.reset()
+
+    def get_markdown_lines(self):
+        if not self.supported:
+            return []
+        backend = sum(time for name, time in self._stages_in_ms.items()
+                      if name.startswith('backend'))
+        values = [
+            min(self._samples_in_ms),
+            sum(self._passes_in_ms.values()), backend
+        ]
+        return [
+            f'|{self._name}|' + ''.join(f'{round(v, 2)}|' for v in values)
+        ]
+
+    def get_results_dict(self):
+        return {
+            'elapsed_time_ms': min(self._samples_in_ms),
+            'samples_ms': self._samples_in_ms,
+            'passes_ms': self._passes_in_ms,
+            'stages_ms': self._stages_in_ms
+        }
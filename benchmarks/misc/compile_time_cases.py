@@ -0,0 +1,226 @@
+import numpy as np
+
+import taichi as ti
+
+# Each case defines its fields and kernels in the current program, and
+# returns a function whose first call compiles them all, or None if the case
+# is not supported on the current arch. The fields are small, as only the
+# compilation is measured.
+
+
+def static_unroll():
+    n = 1024
+    num_unrolled = 512
+    x = ti.field(ti.f32, shape=n + num_unrolled)
+    y = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def static_unroll():
+        for i in range(n):
+            acc = 0.0
+            for k in ti.static(range(num_unrolled)):
+                acc = acc * 0.999 + x[i + k] * (k + 1)
+            y[i] = acc
+
+    return static_unroll
+
+
+def matrix_ops():
+    n = 64
+    a = ti.Matrix.field(8, 8, ti.f32, shape=n)
+    b = ti.Matrix.field(8, 8, ti.f32, shape=n)
+    c = ti.Matrix.field(4, 4, ti.f32, shape=n)
+
+    @ti.kernel
+    def matrix_ops():
+        for i in range(n):
+            m = a[i] @ b[i]
+            m = m @ m.transpose() + a[i]
+            b[i] = m @ a[i]
+            c[i] = c[i].inverse() @ c[i].transpose()
+
+    return matrix_ops
+
+
+def many_offloads():
+    n = 1024
+    num_loops = 64
+    x = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def many_offloads():
+        for k in ti.static(range(num_loops)):
+            for i in range(n):
+                x[i] = x[i] * 0.5 + k
+
+    return many_offloads
+
+
+def autodiff():
+    n = 1024
+    x = ti.field(ti.f32, shape=n, needs_grad=True)
+    y = ti.field(ti.f32, shape=n, needs_grad=True)
+    loss = ti.field(ti.f32, shape=(), needs_grad=True)
+
+    @ti.kernel
+    def autodiff():
+        for i in range(n):
+            v = x[i]
+            for k in ti.static(range(16)):
+                v = ti.sin(v) * ti.exp(-v * v) + ti.sqrt(v * v + 1.0)
+            y[i] = v
+            loss[None] += v * v
+
+    def compile_all():
+        autodiff()
+        autodiff.grad()
+
+    return compile_all
+
+
+def mesh_for():
+    if not ti.is_extension_supported(ti.cfg.arch, ti.extension.mesh):
+        return None
+    # Each cube of an n^3 grid is split into 6 tetrahedra.
+    n = 4
+
+    def vert(i, j, k):
+        return (i * (n + 1) + j) * (n + 1) + k
+
+    axes = ((1, 0, 0), (0, 1, 0), (0, 0, 1))
+    cells = []
+    for i in range(n):
+        for j in range(n):
+            for k in range(n):
+                for a, b in ((0, 1), (0, 2), (1, 0), (1, 2), (2, 0), (2, 1)):
+                    p = (i, j, k)
+                    q = tuple(u + v for u, v in zip(p, axes[a]))
+                    r = tuple(u + v for u, v in zip(q, axes[b]))
+                    cells.append([
+                        vert(*p),
+                        vert(*q),
+                        vert(*r),
+                        vert(i + 1, j + 1, k + 1)
+                    ])
+    x = np.array([[i, j, k] for i in range(n + 1) for j in range(n + 1)
+                  for k in range(n + 1)],
+                 dtype=np.float32)
+    meta = ti.Mesh.generate_meta(ti.MeshTopology.Tetrahedron,
+                                 np.array(cells, dtype=np.int32), x)
+    builder = ti.Mesh.Tet()
+    vec3 = ti.types.vector(3, ti.f32)
+    builder.verts.place({'x': vec3, 'f': vec3})
+    builder.cells.place({'vol': ti.f32})
+    builder.cells.link(builder.verts)
+    builder.verts.link(builder.cells)
+    model = builder.build(meta)
+
+    @ti.kernel
+    def mesh_for():
+        for c in model.cells:
+            p0 = c.verts[0].x
+            d = ti.Matrix.cols([
+                c.verts[1].x - p0, c.verts[2].x - p0, c.verts[3].x - p0
+            ])
+            c.vol = ti.abs(d.determinant()) / 6
+            for i in ti.static(range(4)):
+                c.verts[i].f += d @ c.verts[i].x * c.vol
+        for v in model.verts:
+            for i in range(v.cells.size):
+                v.f += v.cells[i].vol
+
+    return mesh_for
+
+
+def mpm88():
+    n_particles = 8192
+    n_grid = 128
+    dx = 1 / n_grid
+    dt = 2e-4
+    p_vol = (dx * 0.5)**2
+    p_mass = p_vol
+    gravity = 9.8
+    bound = 3
+    E = 400
+
+    x = ti.Vector.field(2, float, n_particles)
+    v = ti.Vector.field(2, float, n_particles)
+    C = ti.Matrix.field(2, 2, float, n_particles)
+    J = ti.field(float, n_particles)
+    grid_v = ti.Vector.field(2, float, (n_grid, n_grid))
+    grid_m = ti.field(float, (n_grid, n_grid))
+
+    # The substep of python/taichi/examples/simulation/mpm88.py.
+    @ti.kernel
+    def mpm88():
+        for i, j in grid_m:
+            grid_v[i, j] = [0, 0]
+            grid_m[i, j] = 0
+        for p in x:
+            Xp = x[p] / dx
+            base = int(Xp - 0.5)
+            fx = Xp - base
+            w = [0.5 * (1.5 - fx)**2, 0.75 - (fx - 1)**2, 0.5 * (fx - 0.5)**2]
+            stress = -dt * 4 * E * p_vol * (J[p] - 1) / dx**2
+            affine = ti.Matrix([[stress, 0], [0, stress]]) + p_mass * C[p]
+            for i, j in ti.static(ti.ndrange(3, 3)):
+                offset = ti.Vector([i, j])
+                dpos = (offset - fx) * dx
+                weight = w[i].x * w[j].y
+                grid_v[base +
+                       offset] += weight * (p_mass * v[p] + affine @ dpos)
+                grid_m[base + offset] += weight * p_mass
+        for i, j in grid_m:
+            if grid_m[i, j] > 0:
+                grid_v[i, j] /= grid_m[i, j]
+            grid_v[i, j].y -= dt * gravity
+            if i < bound and grid_v[i, j].x < 0:
+                grid_v[i, j].x = 0
+            if i > n_grid - bound and grid_v[i, j].x > 0:
+                grid_v[i, j].x = 0
+            if j < bound and grid_v[i, j].y < 0:
+                grid_v[i, j].y = 0
+            if j > n_grid - bound and grid_v[i, j].y > 0:
+                grid_v[i, j].y = 0
+        for p in x:
+            Xp = x[p] / dx
+            base = int(Xp - 0.5)
+            fx = Xp - base
+            w = [0.5 * (1.5 - fx)**2, 0.75 - (fx - 1)**2, 0.5 * (fx - 0.5)**2]
+            new_v = ti.Vector.zero(float, 2)
+            new_C = ti.Matrix.zero(float, 2, 2)
+            for i, j in ti.static(ti.ndrange(3, 3)):
+                offset = ti.Vector([i, j])
+                dpos = (offset - fx) * dx
+                weight = w[i].x * w[j].y
+                g_v = grid_v[base + offset]
+                new_v += weight * g_v
+                new_C += 4 * weight * g_v.outer_product(dpos) / dx**2
+            v[p] = new_v
+            x[p] += dt * v[p]
+            J[p] *= 1 + dt * new_C.trace()
+            C[p] = new_C
+
+    return mpm88
+
+
+def svd3x3():
+    n = 1024
+    F = ti.Matrix.field(3, 3, ti.f32, shape=n)
+
+    # The plasticity of python/taichi/examples/simulation/mpm99.py.
+    @ti.kernel
+    def svd3x3():
+        for p in F:
+            U, sig, V = ti.svd(F[p])
+            for d in ti.static(range(3)):
+                sig[d, d] = ti.min(ti.max(sig[d, d], 1 - 2.5e-2), 1 + 4.5e-3)
+            F[p] = U @ sig @ V.transpose()
+
+    return svd3x3
+
+
+compile_time_cases_list = [
+    static_unroll, matrix_ops, many_offloads, autodiff, mesh_for, mpm88,
+    svd3x3
+]
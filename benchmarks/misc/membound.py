@@ -1,7 +1,8 @@
 import os
 import time
 
-from membound_cases import memory_bound_cases_list
+from membound_cases import (memory_bound_cases_list, num_trials,
+                            stream_copy_bandwidth)
 from utils import (arch_name, datatime_with_format, dtype2str, dump2json,
                    geometric_mean, md_table_header, scaled_repeat_times,
                    size2str)
@@ -23,6 +24,7 @@ class MemoryBound:
 
     def __init__(self, arch):
         self._arch = arch
+        self._peak_bandwidth = None  #GB/s, measured by run()
         self._cases_impl = []
         for case in self.test_cases:
             for dtype in self.test_dtype_list:
@@ -31,6 +33,8 @@ class MemoryBound:
                 self._cases_impl.append(impl)
 
     def run(self):
+        self._peak_bandwidth = stream_copy_bandwidth(self._arch)
+        print(f'peak bandwidth = {round(self._peak_bandwidth, 2)} GB/s')
         for case in self._cases_impl:
             case.run()
 
@@ -49,7 +53,8 @@ class MemoryBound:
         file_path = os.path.join(arch_dir, file_name)
         with open(file_path, 'w') as f:
             lines = [
-                f'commit_hash: {commit_hash}\n', f'datatime: {current_time}\n'
+                f'commit_hash: {commit_hash}\n', f'datatime: {current_time}\n',
+                f'peak_bandwidth: {round(self._peak_bandwidth, 2)} GB/s\n'
             ]
             lines += self._get_markdown_lines()
             for line in lines:
@@ -64,7 +69,9 @@ class MemoryBound:
                 scaled_repeat_times(self._arch, size, self.basic_repeat_times)
                 for size in self.test_dsize_list
             ],
-            'evaluator': [func.__name__ for func in self.evaluator]
+            'evaluator': [func.__name__ for func in self.evaluator],
+            'num_trials': num_trials,
+            'peak_bandwidth_GBps': self._peak_bandwidth
         }
         info_path = os.path.join(suite_path, '_info.json')
         with open(info_path, 'w') as f:
@@ -77,7 +84,8 @@ class MemoryBound:
                 if impl._name != case.__name__:
                     continue
                 result_name = dtype2str(impl._test_dtype)
-                results_dict[result_name] = impl.get_results_dict()
+                results_dict[result_name] = impl.get_results_dict(
+                    self._peak_bandwidth)
             case_path = os.path.join(suite_path, (case.__name__ + '.json'))
             with open(case_path, 'w') as f:
                 case_str = dump2json(results_dict)
@@ -107,6 +115,7 @@ class CaseImpl:
         self._test_dtype = test_dtype
         self._test_dsize_list = test_dsize_list
         self._min_time_in_us = []  #test results
+        self._samples_in_ms = []  #min time of each trial
         self._evaluator = evaluator
 
     def run(self):
@@ -115,9 +124,10 @@ class CaseImpl:
             self._arch), dtype2str(self._test_dtype)))
         for test_dsize in self._test_dsize_list:
             print("test_dsize = %s" % (size2str(test_dsize)))
-            self._min_time_in_us.append(
-                self._func(self._arch, self._test_dtype, test_dsize,
-                           MemoryBound.basic_repeat_times))
+            samples = self._func(self._arch, self._test_dtype, test_dsize,
+                                 MemoryBound.basic_repeat_times)
+            self._samples_in_ms.append(samples)
+            self._min_time_in_us.append(min(samples))
             time.sleep(0.2)
         ti.reset()
 
@@ -130,18 +140,23 @@ class CaseImpl:
             for item in self._evaluator)
         return [string]
 
-    def get_results_dict(self):
+    def get_results_dict(self, peak_bandwidth):
         results_dict = {}
         for i in range(len(self._test_dsize_list)):
             dsize = self._test_dsize_list[i]
             repeat = scaled_repeat_times(self._arch, dsize,
                                          MemoryBound.basic_repeat_times)
             elapsed_time = self._min_time_in_us[i]
+            # Every case moves |dsize| bytes per launch.
+            bandwidth = dsize / (elapsed_time * 1e-3) / 1e9
             item_name = size2str(dsize).replace('.0', '')
             item_dict = {
                 'dsize_byte': dsize,
                 'repeat': repeat,
-                'elapsed_time_ms': elapsed_time
+                'elapsed_time_ms': elapsed_time,
+                'samples_ms': self._samples_in_ms[i],
+                'bandwidth_GBps': bandwidth,
+                'peak_fraction': bandwidth / peak_bandwidth
             }
             results_dict[item_name] = item_dict
         return results_dict
@@ -12,15 +12,46 @@ def init_const(x, dtype, num_elements):
     init_const(x, num_elements)
 
 
+# Independent trials of each case, so that a regression can be told from
+# noise by a significance test, see compare.py.
+num_trials = 5
+
+
 def membound_benchmark(func, num_elements, repeat):
+    """Returns the minimum kernel time (ms) of each trial of |repeat|
+    launches."""
     # compile the kernel first
     func(num_elements)
-    ti.clear_kernel_profile_info()
-    for i in range(repeat):
-        func(num_elements)
     kernelname = func.__name__
-    quering_result = ti.query_kernel_profile_info(kernelname)
-    return quering_result.min
+    samples = []
+    for trial in range(num_trials):
+        ti.clear_kernel_profile_info()
+        for i in range(repeat):
+            func(num_elements)
+        quering_result = ti.query_kernel_profile_info(kernelname)
+        samples.append(quering_result.min)
+    return samples
+
+
+def stream_copy_bandwidth(arch, dsize=256 * 1024 * 1024, repeat=10):
+    """Measures the peak memory bandwidth (GB/s) of |arch| with a copy of
+    |dsize| bytes, which the achieved bandwidth of the cases is normalized
+    by, so that results from different machines can be compared."""
+    ti.init(kernel_profiler=True, arch=arch)
+    num_elements = dsize // dtype_size(ti.f32)
+    x = ti.field(ti.f32, shape=num_elements)
+    y = ti.field(ti.f32, shape=num_elements)
+    init_const(x, ti.f32, num_elements)
+
+    @ti.kernel
+    def stream_copy(n: ti.i32):
+        for i in range(n):
+            y[i] = x[i]
+
+    min_time_ms = min(membound_benchmark(stream_copy, num_elements, repeat))
+    ti.reset()
+    # Read and written.
+    return 2 * dsize / (min_time_ms * 1e-3) / 1e9
 
 
 def fill(arch, dtype, dsize, repeat=10):
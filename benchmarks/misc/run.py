@@ -1,12 +1,14 @@
+import argparse
 import os
 import warnings
 
+from compile_time import CompileTime
 from membound import MemoryBound
-from utils import arch_name, datatime_with_format, dump2json
+from utils import arch_name, datatime_with_format, device_info, dump2json
 
 import taichi as ti
 
-benchmark_suites = [MemoryBound]
+benchmark_suites = [MemoryBound, CompileTime]
 benchmark_archs = [ti.x64, ti.cuda]
 
 
@@ -16,6 +18,7 @@ class BenchmarksInfo:
         self.pull_request_id = pull_request_id
         self.commit_hash = commit_hash
         self.datetime = []  #[start, end]
+        self.device = device_info()
         self.archs = {}
         # "archs": {
         #     "x64": ["memorybound"], #arch:[suites name]
@@ -60,9 +63,26 @@ class BenchmarkSuites:
             return False
 
 
-def main():
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description='Runs the benchmark suites, and saves the results as the '
+        'baseline that compare.py checks later results against.')
+    parser.add_argument('-o',
+                        '--output',
+                        default=os.path.join(os.getcwd(), 'results'),
+                        help='The directory of the results, which must not '
+                        'exist yet')
+    parser.add_argument('-a',
+                        '--archs',
+                        nargs='+',
+                        default=[arch_name(arch) for arch in benchmark_archs],
+                        help='The archs to run on, e.g. x64 cuda')
+    return parser.parse_args()
+
 
-    benchmark_dir = os.path.join(os.getcwd(), 'results')
+def main():
+    args = parse_args()
+    benchmark_dir = args.output
     os.makedirs(benchmark_dir)
 
     pull_request_id = os.environ.get('PULL_REQUEST_NUMBER')
@@ -74,6 +94,12 @@ def main():
     print(f'commit_hash = {commit_hash}')
 
     for arch in benchmark_archs:
+        if arch_name(arch) not in args.archs:
+            continue
+        if not ti.is_arch_supported(arch):
+            warnings.warn(f'Arch [{arch_name(arch)}] is not available.',
+                          UserWarning)
+            continue
         #init & run
         suites = BenchmarkSuites(arch)
         suites.run()
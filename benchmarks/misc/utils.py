@@ -1,5 +1,8 @@
 import datetime
 import json
+import os
+import platform
+import subprocess
 
 import jsbeautifier
 
@@ -45,6 +48,38 @@ def dump2json(obj):
     return jsbeautifier.beautify(json.dumps(obj2dict), options)
 
 
+def cpu_name():
+    try:
+        with open('/proc/cpuinfo') as f:
+            for line in f:
+                if line.startswith('model name'):
+                    return line.split(':', 1)[1].strip()
+    except OSError:
+        pass
+    return platform.processor()
+
+
+def gpu_names():
+    try:
+        output = subprocess.check_output(
+            ['nvidia-smi', '--query-gpu=name', '--format=csv,noheader'],
+            stderr=subprocess.DEVNULL)
+    except (OSError, subprocess.CalledProcessError):
+        return []
+    return [line.strip() for line in output.decode().splitlines()]
+
+
+def device_info():
+    """The machine the results were measured on, which a baseline from a
+    different machine can only be compared with after normalization."""
+    return {
+        'platform': platform.platform(),
+        'cpu': cpu_name(),
+        'cpu_count': os.cpu_count(),
+        'gpu': gpu_names()
+    }
+
+
 def size2str(size_in_byte):
     # for output string
     size_subsection = [(0.0, 'B'), (1024.0, 'KB'), (1048576.0, 'MB'),
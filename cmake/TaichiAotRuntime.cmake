@@ -0,0 +1,12 @@
+cmake_minimum_required(VERSION 3.0)
+
+# A C++ library for running Vulkan AOT modules, see
+# taichi/backends/vulkan/aot_runtime.h. It does not depend on Python.
+set(TAICHI_AOT_RUNTIME_NAME taichi_aot_runtime)
+
+if (NOT TI_WITH_VULKAN)
+    message(FATAL_ERROR "TI_BUILD_AOT_RUNTIME requires TI_WITH_VULKAN")
+endif()
+
+add_library(${TAICHI_AOT_RUNTIME_NAME} SHARED)
+target_link_libraries(${TAICHI_AOT_RUNTIME_NAME} taichi_isolated_core)
@@ -0,0 +1,21 @@
+cmake_minimum_required(VERSION 3.0)
+
+set(BENCHMARKS_NAME taichi_cpp_benchmarks)
+
+file(GLOB_RECURSE TAICHI_BENCHMARKS_SOURCE "benchmarks/cpp/*.cpp")
+
+include_directories(
+    ${PROJECT_SOURCE_DIR},
+)
+
+add_executable(${BENCHMARKS_NAME} ${TAICHI_BENCHMARKS_SOURCE})
+if (WIN32)
+    # Output the executable to bin/ instead of build/Debug/...
+    set(BENCHMARKS_OUTPUT_DIR "${CMAKE_CURRENT_SOURCE_DIR}/bin")
+    set_target_properties(${BENCHMARKS_NAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY ${BENCHMARKS_OUTPUT_DIR})
+    set_target_properties(${BENCHMARKS_NAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY_DEBUG ${BENCHMARKS_OUTPUT_DIR})
+    set_target_properties(${BENCHMARKS_NAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY_RELEASE ${BENCHMARKS_OUTPUT_DIR})
+    set_target_properties(${BENCHMARKS_NAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY_MINSIZEREL ${BENCHMARKS_OUTPUT_DIR})
+    set_target_properties(${BENCHMARKS_NAME} PROPERTIES RUNTIME_OUTPUT_DIRECTORY_RELWITHDEBINFO ${BENCHMARKS_OUTPUT_DIR})
+endif()
+target_link_libraries(${BENCHMARKS_NAME} taichi_isolated_core)
@@ -6,6 +6,7 @@ option(TI_WITH_CUDA_TOOLKIT "Build with the CUDA toolkit" OFF)
 option(TI_WITH_OPENGL "Build with the OpenGL backend" ON)
 option(TI_WITH_CC "Build with the C backend" ON)
 option(TI_WITH_VULKAN "Build with the Vulkan backend" OFF)
+option(TI_WITH_CHOLMOD "Build with the CHOLMOD sparse solver of SuiteSparse" OFF)
 
 
 if(UNIX AND NOT APPLE)
@@ -286,6 +287,18 @@ else()
     message(STATUS "TI_WITH_CUDA_TOOLKIT = OFF")
 endif()
 
+if (TI_WITH_CHOLMOD)
+    find_path(CHOLMOD_INCLUDE_DIR cholmod.h PATH_SUFFIXES suitesparse)
+    find_library(CHOLMOD_LIBRARY cholmod)
+    if(NOT CHOLMOD_INCLUDE_DIR OR NOT CHOLMOD_LIBRARY)
+        message(FATAL_ERROR "TI_WITH_CHOLMOD is ON but CHOLMOD not found")
+    endif()
+    message(STATUS "TI_WITH_CHOLMOD = ON")
+    set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -DTI_WITH_CHOLMOD")
+    target_include_directories(${CORE_LIBRARY_NAME} PRIVATE ${CHOLMOD_INCLUDE_DIR})
+    target_link_libraries(${CORE_LIBRARY_NAME} ${CHOLMOD_LIBRARY})
+endif()
+
 if (TI_WITH_OPENGL)
     add_subdirectory(external/SPIRV-Cross)
     target_include_directories(${CORE_LIBRARY_NAME} PRIVATE external/SPIRV-Cross)
@@ -339,7 +352,8 @@ if (NOT WIN32)
 	# OS X or BSD
     else()
         # Linux
-        target_link_libraries(${CORE_LIBRARY_NAME} stdc++fs X11)
+        # libX11 is loaded by the GUI when it creates a window, see x11.cpp.
+        target_link_libraries(${CORE_LIBRARY_NAME} stdc++fs)
         target_link_libraries(${CORE_LIBRARY_NAME} -static-libgcc -static-libstdc++)
         if (NOT TI_EXPORT_CORE) # expose api for CHI IR Builder
             target_link_libraries(${CORE_LIBRARY_NAME} -Wl,--version-script,${CMAKE_CURRENT_SOURCE_DIR}/misc/linker.map)
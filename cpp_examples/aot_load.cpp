@@ -0,0 +1,40 @@
+#ifdef TI_WITH_VULKAN
+#include <numeric>
+
+#include "taichi/backends/vulkan/aot_runtime.h"
+#include "taichi/backends/vulkan/vulkan_device_creator.h"
+#include "taichi/backends/vulkan/vulkan_loader.h"
+#include "taichi/backends/vulkan/vulkan_utils.h"
+
+// Runs the module written by aot_save() without a Program.
+void aot_load() {
+  using namespace taichi;
+  using namespace lang;
+  if (!vulkan::is_vulkan_api_available()) {
+    std::cout << "Vulkan is not available" << std::endl;
+    return;
+  }
+
+  vulkan::VulkanDeviceCreator::Params evd_params;
+  evd_params.api_version = vulkan::VulkanEnvSettings::kApiVersion();
+  auto device_creator =
+      std::make_unique<vulkan::VulkanDeviceCreator>(evd_params);
+
+  vulkan::AotRuntime::Params params;
+  params.module_path = ".";
+  params.device = device_creator->device();
+  vulkan::AotRuntime runtime(params);
+
+  RuntimeContext ctx{};
+  runtime.launch_kernel("init", &ctx);
+  runtime.launch_kernel("ret", &ctx);
+  runtime.synchronize();
+  std::cout << "ret: " << runtime.get_ret<int32>(0) << std::endl;
+
+  std::vector<int32> place(10);
+  runtime.read_field("place", place.data());
+  TI_ASSERT(std::accumulate(place.begin(), place.end(), 0) ==
+            runtime.get_ret<int32>(0));
+  std::cout << "done" << std::endl;
+}
+#endif  // TI_WITH_VULKAN
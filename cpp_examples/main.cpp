@@ -5,10 +5,16 @@
 void run_snode();
 void autograd();
 void aot_save();
+#ifdef TI_WITH_VULKAN
+void aot_load();
+#endif
 
 int main() {
   run_snode();
   autograd();
   aot_save();
+#ifdef TI_WITH_VULKAN
+  aot_load();
+#endif
   return 0;
 }
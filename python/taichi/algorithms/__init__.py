@@ -0,0 +1,2 @@
+from taichi.algorithms._algorithms import compact, exclusive_scan, sort
+from taichi.algorithms._cell_list import CellList
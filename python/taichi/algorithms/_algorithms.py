@@ -0,0 +1,373 @@
+from taichi.core.util import ti_core as _ti_core
+from taichi.lang import impl
+from taichi.lang._ndarray import Ndarray, ScalarNdarray
+from taichi.lang.field import ScalarField
+from taichi.lang.kernel_impl import kernel
+from taichi.snode.fields_builder import FieldsBuilder
+from taichi.types.annotations import any_arr, template
+
+import taichi as ti
+
+# The elements handled serially by one thread of the kernels.
+_BLOCK = 64
+# Below this, a prefix sum is done by a single thread.
+_MAX_SERIAL_SCAN = 1024
+_RADIX_BITS = 4
+_RADIX = 1 << _RADIX_BITS
+
+
+def _on_host():
+    return impl.current_cfg().arch in (_ti_core.Arch.x64,
+                                       _ti_core.Arch.arm64)
+
+
+def _check_array(arr, name):
+    if not isinstance(arr, (ScalarField, ScalarNdarray)) or len(
+            arr.shape) != 1:
+        raise ValueError(f'{name} must be a 1D scalar field or ndarray')
+
+
+class _HostArray:
+    """The host memory of an array on the CPU backends: that of an ndarray,
+    or a numpy copy of a field."""
+    def __init__(self, arr):
+        self._arr = arr
+        self.dtype = arr.dtype
+        if isinstance(arr, Ndarray):
+            impl.get_runtime().sync()
+            self._copy = None
+            self.ptr = arr.arr.data_ptr()
+        else:
+            self._copy = arr.to_numpy()
+            self.ptr = self._copy.ctypes.data
+
+    def write_back(self):
+        if self._copy is not None:
+            self._arr.from_numpy(self._copy)
+
+
+class _ScratchFields:
+    """The temporary fields of the kernels. They are kept across the calls,
+    and grown to powers of two, so that the kernels taking them are rarely
+    recompiled."""
+    def __init__(self):
+        self._prog = None
+        self._fields = {}
+
+    def get(self, name, dtype, n):
+        prog = impl.get_runtime().prog
+        if prog is not self._prog:
+            self._prog = prog
+            self._fields = {}
+        entry = self._fields.get((name, dtype))
+        if entry is None or entry[0].shape[0] < n:
+            if entry is not None:
+                entry[1].destroy()
+            capacity = 1
+            while capacity < n:
+                capacity *= 2
+            fb = FieldsBuilder()
+            f = ti.field(dtype)
+            fb.dense(ti.i, capacity).place(f)
+            entry = (f, fb.finalize())
+            self._fields[(name, dtype)] = entry
+        return entry[0]
+
+
+_scratch = _ScratchFields()
+
+
+@kernel
+def _load(src: any_arr(), dst: template(), n: ti.i32):
+    for i in range(n):
+        dst[i] = src[i]
+
+
+@kernel
+def _store(src: template(), dst: any_arr(), n: ti.i32):
+    for i in range(n):
+        dst[i] = src[i]
+
+
+def _as_field(arr, name):
+    """The array itself if it is a field, or a copy of it in a scratch field
+    if it is an ndarray."""
+    if isinstance(arr, ScalarField):
+        return arr
+    f = _scratch.get(name, arr.dtype, arr.shape[0])
+    _load(arr, f, arr.shape[0])
+    return f
+
+
+def _write_back(f, arr, n):
+    if f is not arr:
+        _store(f, arr, n)
+
+
+@kernel
+def _block_sums(a: template(), sums: template(), n: ti.i32):
+    for b in range((n + _BLOCK - 1) // _BLOCK):
+        s = ti.cast(0, sums.dtype)
+        for i in range(b * _BLOCK, ti.min((b + 1) * _BLOCK, n)):
+            s += a[i]
+        sums[b] = s
+
+
+@kernel
+def _serial_scan(a: template(), total: template(), n: ti.i32):
+    for _ in range(1):
+        s = ti.cast(0, a.dtype)
+        for i in range(n):
+            x = a[i]
+            a[i] = s
+            s += x
+        total[0] = s
+
+
+@kernel
+def _scan_blocks(a: template(), sums: template(), n: ti.i32):
+    for b in range((n + _BLOCK - 1) // _BLOCK):
+        s = sums[b]
+        for i in range(b * _BLOCK, ti.min((b + 1) * _BLOCK, n)):
+            x = a[i]
+            a[i] = s
+            s += x
+
+
+def _scan(a, n, total, level=0):
+    """Reduce then scan: the sums of the blocks of ``a``, their scan, and the
+    scan of each block starting from the sum of the blocks before it."""
+    if n <= _MAX_SERIAL_SCAN:
+        _serial_scan(a, total, n)
+        return
+    num_blocks = (n + _BLOCK - 1) // _BLOCK
+    sums = _scratch.get(f'scan_sums{level}', a.dtype, num_blocks)
+    _block_sums(a, sums, n)
+    _scan(sums, num_blocks, total, level + 1)
+    _scan_blocks(a, sums, n)
+
+
+@kernel
+def _encode_keys(keys: template(), bits: template(), n: ti.i32):
+    # Maps the keys to unsigned integers of the same order.
+    for i in range(n):
+        x = ti.bit_cast(keys[i], ti.u32)
+        sign = ti.cast(1, ti.u32) << 31
+        if ti.static(keys.dtype == ti.f32):
+            if x >> 31 != 0:
+                x = ~x
+            else:
+                x |= sign
+        elif ti.static(keys.dtype == ti.i32):
+            x ^= sign
+        bits[i] = x
+
+
+@kernel
+def _decode_keys(bits: template(), keys: template(), n: ti.i32):
+    for i in range(n):
+        x = bits[i]
+        sign = ti.cast(1, ti.u32) << 31
+        if ti.static(keys.dtype == ti.f32):
+            if x >> 31 != 0:
+                x ^= sign
+            else:
+                x = ~x
+        elif ti.static(keys.dtype == ti.i32):
+            x ^= sign
+        keys[i] = ti.bit_cast(x, keys.dtype)
+
+
+@kernel
+def _digit_counts(bits: template(), counts: template(), n: ti.i32,
+                  shift: ti.i32):
+    # Digit-major, so that their exclusive scan is where each block writes
+    # its keys of each digit. A block is only touched by its thread, which
+    # needs no atomics.
+    num_blocks = (n + _BLOCK - 1) // _BLOCK
+    for b in range(num_blocks):
+        for d in ti.static(range(_RADIX)):
+            counts[d * num_blocks + b] = 0
+        for i in range(b * _BLOCK, ti.min((b + 1) * _BLOCK, n)):
+            k = ti.cast((bits[i] >> shift) & (_RADIX - 1),
+                        ti.i32) * num_blocks + b
+            counts[k] = counts[k] + 1
+
+
+@kernel
+def _scatter_digits(src: template(), dst: template(), src_values: template(),
+                    dst_values: template(), offsets: template(), n: ti.i32,
+                    shift: ti.i32, has_values: template()):
+    num_blocks = (n + _BLOCK - 1) // _BLOCK
+    for b in range(num_blocks):
+        for i in range(b * _BLOCK, ti.min((b + 1) * _BLOCK, n)):
+            k = ti.cast((src[i] >> shift) & (_RADIX - 1),
+                        ti.i32) * num_blocks + b
+            j = offsets[k]
+            offsets[k] = j + 1
+            dst[j] = src[i]
+            if ti.static(has_values):
+                dst_values[j] = src_values[i]
+
+
+def _radix_sort(keys, values, n):
+    """A stable LSD radix sort of the first ``n`` elements of the fields."""
+    bits = [
+        _scratch.get('sort_bits0', ti.u32, n),
+        _scratch.get('sort_bits1', ti.u32, n)
+    ]
+    has_values = values is not None
+    if has_values:
+        vals = [values, _scratch.get('sort_values', values.dtype, n)]
+    else:
+        vals = bits
+    num_counts = _RADIX * ((n + _BLOCK - 1) // _BLOCK)
+    counts = _scratch.get('sort_counts', ti.i32, num_counts)
+    total = _scratch.get('scan_total', ti.i32, 1)
+    _encode_keys(keys, bits[0], n)
+    # An even number of passes, which ends in the first buffers.
+    for p in range(32 // _RADIX_BITS):
+        src, dst = p % 2, 1 - p % 2
+        _digit_counts(bits[src], counts, n, p * _RADIX_BITS)
+        _scan(counts, num_counts, total)
+        _scatter_digits(bits[src], bits[dst], vals[src], vals[dst], counts,
+                        n, p * _RADIX_BITS, has_values)
+    _decode_keys(bits[0], keys, n)
+
+
+@kernel
+def _block_counts(flags: template(), counts: template(), n: ti.i32):
+    for b in range((n + _BLOCK - 1) // _BLOCK):
+        c = 0
+        for i in range(b * _BLOCK, ti.min((b + 1) * _BLOCK, n)):
+            if flags[i] != 0:
+                c += 1
+        counts[b] = c
+
+
+@kernel
+def _scatter_flagged(src: template(), flags: template(), offsets: template(),
+                     dst: template(), n: ti.i32):
+    for b in range((n + _BLOCK - 1) // _BLOCK):
+        j = offsets[b]
+        for i in range(b * _BLOCK, ti.min((b + 1) * _BLOCK, n)):
+            if flags[i] != 0:
+                dst[j] = src[i]
+                j += 1
+
+
+def exclusive_scan(arr):
+    """Replaces a 1D array with its exclusive prefix sum.
+
+    Element ``i`` becomes the sum of the elements before it, so that the
+    first one becomes zero.
+
+    Args:
+        arr (Union[ScalarField, ScalarNdarray]): The array, of a numeric type.
+
+    Returns:
+        Union[int, float]: The sum of all the elements.
+    """
+    _check_array(arr, 'arr')
+    n = arr.shape[0]
+    if _on_host():
+        host = _HostArray(arr)
+        total = _ti_core.parallel_exclusive_scan(host.ptr, host.dtype, n)
+        host.write_back()
+        return total
+    if n == 0:
+        return 0
+    a = _as_field(arr, 'scan_data')
+    total = _scratch.get('scan_total', arr.dtype, 1)
+    _scan(a, n, total)
+    _write_back(a, arr, n)
+    return total[0]
+
+
+def sort(keys, values=None):
+    """Sorts a 1D array in ascending order, with a stable radix sort.
+
+    Args:
+        keys (Union[ScalarField, ScalarNdarray]): The keys. On the CPU
+            backends, they may be of any 32- or 64-bit numeric type. On the
+            others, of ``ti.i32``, ``ti.u32`` or ``ti.f32``.
+        values (Union[ScalarField, ScalarNdarray], optional): Permuted along
+            with the keys, e.g. the indices of the elements they come from.
+            Of a 32- or 64-bit type on the CPU backends.
+    """
+    _check_array(keys, 'keys')
+    n = keys.shape[0]
+    if values is not None:
+        _check_array(values, 'values')
+        if values.shape[0] != n:
+            raise ValueError('keys and values must be of the same length')
+    if _on_host():
+        host_keys = _HostArray(keys)
+        host_values = _HostArray(values) if values is not None else None
+        _ti_core.parallel_radix_sort(
+            host_keys.ptr, host_keys.dtype,
+            host_values.ptr if host_values else 0,
+            host_values.dtype if host_values else ti.i32, n)
+        host_keys.write_back()
+        if host_values:
+            host_values.write_back()
+        return
+    if keys.dtype not in (ti.i32, ti.u32, ti.f32):
+        raise ValueError(f'Sorting keys of {keys.dtype} is not supported on '
+                         f'{impl.current_cfg().arch}')
+    if n <= 1:
+        return
+    k = _as_field(keys, 'sort_keys')
+    v = _as_field(values, 'sort_values_in') if values is not None else None
+    _radix_sort(k, v, n)
+    _write_back(k, keys, n)
+    if values is not None:
+        _write_back(v, values, n)
+
+
+def compact(src, flags, dst):
+    """Copies the elements of a 1D array with a non-zero flag into another
+    one, keeping their order.
+
+    Args:
+        src (Union[ScalarField, ScalarNdarray]): The elements. Of a 32- or
+            64-bit type on the CPU backends.
+        flags (Union[ScalarField, ScalarNdarray]): The flags of the elements,
+            of ``ti.i32``.
+        dst (Union[ScalarField, ScalarNdarray]): Receives the flagged
+            elements. Of the type of ``src``, and at least as long.
+
+    Returns:
+        int: The number of elements copied.
+    """
+    for arr, name in ((src, 'src'), (flags, 'flags'), (dst, 'dst')):
+        _check_array(arr, name)
+    n = src.shape[0]
+    if flags.shape[0] != n or dst.shape[0] < n:
+        raise ValueError('flags must be as long as src, and dst at least as '
+                         'long')
+    if flags.dtype != ti.i32 or dst.dtype != src.dtype:
+        raise ValueError('flags must be of ti.i32, and dst of the type of src')
+    if _on_host():
+        host_src = _HostArray(src)
+        host_flags = _HostArray(flags)
+        host_dst = _HostArray(dst)
+        count = _ti_core.parallel_compact(host_src.ptr, host_src.dtype,
+                                          host_flags.ptr, host_dst.ptr, n)
+        host_dst.write_back()
+        return count
+    if n == 0:
+        return 0
+    s = _as_field(src, 'compact_src')
+    f = _as_field(flags, 'compact_flags')
+    d = dst if isinstance(dst, ScalarField) else _scratch.get(
+        'compact_dst', dst.dtype, n)
+    num_blocks = (n + _BLOCK - 1) // _BLOCK
+    counts = _scratch.get('compact_counts', ti.i32, num_blocks)
+    total = _scratch.get('scan_total', ti.i32, 1)
+    _block_counts(f, counts, n)
+    _scan(counts, num_blocks, total)
+    _scatter_flagged(s, f, counts, d, n)
+    count = total[0]
+    _write_back(d, dst, count)
+    return count
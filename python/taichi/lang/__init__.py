@@ -17,19 +17,23 @@ import taichi.lang.meta
 from taichi.core.util import locale_encode
 from taichi.core.util import ti_core as _ti_core
 from taichi.lang import _random, impl
+from taichi.lang._cuda_graph import CudaGraph
 from taichi.lang._ndarray import ScalarNdarray
+from taichi.lang._texture import Texture
 from taichi.lang.any_array import AnyArray, AnyArrayAccess
 from taichi.lang.enums import Layout
 from taichi.lang.exception import (InvalidOperationError,
                                    TaichiCompilationError, TaichiSyntaxError)
 from taichi.lang.expr import Expr, make_expr_group
 from taichi.lang.field import Field, ScalarField
+from taichi.lang.fwd_mode import FwdMode
 from taichi.lang.impl import (axes, begin_frontend_if,
                               begin_frontend_struct_for, call_internal,
                               chain_compare, current_cfg, expr_init,
                               expr_init_func, expr_init_list, field,
-                              get_runtime, global_subscript_with_offset,
-                              grouped, insert_expr_stmt_if_ti_func,
+                              from_dlpack, get_runtime,
+                              global_subscript_with_offset, grouped,
+                              insert_expr_stmt_if_ti_func,
                               local_subscript_with_offset,
                               materialize_callback, ndarray, one, root, static,
                               static_assert, static_print, stop_grad,
@@ -52,12 +56,13 @@ from taichi.lang.type_factory_impl import type_factory
 from taichi.lang.util import (cook_dtype, has_clangpp, has_pytorch,
                               is_taichi_class, python_scope, taichi_scope,
                               to_numpy_type, to_pytorch_type, to_taichi_type)
-from taichi.profiler import KernelProfiler, get_default_kernel_profiler
+from taichi.profiler import (KernelProfiler, LaunchProfiler,
+                             get_default_kernel_profiler)
 from taichi.profiler.kernelmetrics import (CuptiMetric, default_cupti_metrics,
                                            get_predefined_cupti_metrics)
 from taichi.snode.fields_builder import FieldsBuilder
 from taichi.tools.util import deprecated, get_traceback
-from taichi.types.annotations import any_arr, ext_arr, template
+from taichi.types.annotations import any_arr, ext_arr, field_handle, template
 from taichi.types.primitive_types import (f16, f32, f64, i32, i64,
                                           integer_types, u32, u64)
 
@@ -139,6 +144,8 @@ def print_kernel_profile_info(mode='count'):
     To enable this profiler, set ``kernel_profiler=True`` in ``ti.init()``.
     ``'count'`` mode: print the statistics (min,max,avg time) of launched kernels,
     ``'trace'`` mode: print the records of launched kernels with specific profiling metrics (time, memory load/store and core utilization etc.),
+    ``'roofline'`` mode: print the achieved bandwidth and FLOP/s of the offloaded tasks against the peaks of the GPU, and whether they are memory, compute or latency bound,
+    which needs the ``'roofline'`` metrics of ``ti.get_predefined_cupti_metrics()``,
     and defaults to ``'count'``.
 
     Args:
@@ -163,14 +170,228 @@ def print_kernel_profile_info(mode='count'):
         >>> ti.print_kernel_profile_info('trace')
 
     Note:
-        Currently the result of `KernelProfiler` could be incorrect on OpenGL
-        backend due to its lack of support for `ti.sync()`.
-
         For advanced mode of `KernelProfiler`, please visit https://docs.taichi.graphics/docs/lang/articles/misc/profiler#advanced-mode.
     """
     get_default_kernel_profiler().print_info(mode)
 
 
+def print_launch_profile_info():
+    """Print the percentiles of the overhead of launching kernels from Python.
+
+    To enable this profiler, set ``launch_profiler`` to the sampling interval
+    in ``ti.init()``, e.g. ``ti.init(launch_profiler=16)`` to time one in
+    every 16 launches. See :class:`~taichi.profiler.LaunchProfiler` for the
+    stages of a launch.
+    """
+    profiler = impl.get_runtime().launch_profiler
+    if profiler is None:
+        _ti_core.warn(
+            'use \'ti.init(launch_profiler=1)\' to turn on LaunchProfiler.')
+        return
+    profiler.print_info()
+
+
+def query_launch_profile_info():
+    """Query the percentiles of the overhead of launching kernels from Python.
+
+    Returns:
+        Dict[str, Dict[str, float]]: For each stage of a launch and
+        ``'total'``, the ``'p50'``, ``'p90'``, ``'p99'`` and ``'max'``
+        durations in microseconds, and the ``'count'`` of samples.
+    """
+    profiler = impl.get_runtime().launch_profiler
+    return profiler.query() if profiler is not None else {}
+
+
+def clear_launch_profile_info():
+    """Clear all LaunchProfiler records."""
+    profiler = impl.get_runtime().launch_profiler
+    if profiler is not None:
+        profiler.clear()
+
+
+def print_pass_profile_info():
+    """Print the compile-time cost of the IR passes.
+
+    To enable this profiler, set ``profile_passes=True`` in ``ti.init()``.
+    For each stage of the compilation pipeline, it prints the total, average
+    and maximum time spent, along with the number of IR statements after the
+    stage and the change it made. The iteration counts of the fixed-point
+    optimization loops and the time of the backend stages after the passes
+    are printed as well. The passes and stages are also recorded into the
+    timeline if ``timeline=True``, see ``ti.timeline_save()``.
+    """
+    impl.get_runtime().prog.print_pass_profile_info()
+
+
+def query_pass_profile_info():
+    """Query the records of the pass profiler, see
+    :func:`print_pass_profile_info`.
+
+    Returns:
+        dict: ``{'passes': {pass: record}, 'stages': {stage: record}}``, where
+        the stages are those of the backend after the IR passes, e.g. the LLVM
+        optimization and the emission of the LLVM IR, named along with the
+        arch. Each record has ``count``, ``total_time`` and ``max_time`` in
+        seconds, and the total statement counts before and after the pass,
+        ``stmts_before`` and ``stmts_after``.
+    """
+    return impl.get_runtime().prog.query_pass_profile_info()
+
+
+def clear_pass_profile_info():
+    """Clear all the records of the pass profiler."""
+    impl.get_runtime().prog.clear_pass_profile_info()
+
+
+def save_checkpoint(filename, compress=False, num_threads=0):
+    """Save the data of all the fields into a checkpoint file.
+
+    The data is written as it is in (device) memory, in chunks copied by
+    multiple threads, so that saving and restoring large fields is bounded by
+    the disk rather than by serialization. Only the CPU and CUDA backends, and
+    fields of dense and bitmasked SNodes are supported.
+
+    Args:
+        filename (str): The path of the checkpoint.
+        compress (bool): Whether to deflate the data, which saves space for
+            fields that are mostly zeros or inactive.
+        num_threads (int): The number of threads, 0 for one per CPU.
+    """
+    impl.get_runtime().materialize()
+    impl.get_runtime().prog.save_checkpoint(filename, compress, num_threads)
+
+
+def load_checkpoint(filename, num_threads=0):
+    """Restore the data of all the fields from a checkpoint file saved by
+    :func:`save_checkpoint`, in a program with the same fields.
+
+    An uncompressed checkpoint is memory-mapped, and copied to the device in
+    a single transfer.
+
+    Args:
+        filename (str): The path of the checkpoint.
+        num_threads (int): The number of threads, 0 for one per CPU.
+    """
+    impl.get_runtime().materialize()
+    impl.get_runtime().prog.load_checkpoint(filename, num_threads)
+
+
+def write_back_snode_trees(wait=True):
+    """Write the fields mapped from files back to the files.
+
+    With ``ti.init(arch=ti.cpu, cpu_snode_tree_file_dir=...)``, the fields
+    live in files created (and removed at exit) in that directory, e.g. on an
+    NVMe drive, so that they can be larger than the RAM. The OS reads the
+    pages in as the kernels touch them, reading ahead along the iteration
+    order of the dense struct-fors, and writes the modified pages back when
+    memory runs low. Writing them back after a pass over the data keeps the
+    modified pages from piling up.
+
+    Args:
+        wait (bool): Whether to wait for the writes to finish, or only to
+            start them.
+    """
+    impl.get_runtime().materialize()
+    impl.get_runtime().prog.write_back_snode_trees(wait)
+
+
+def query_huge_page_coverage():
+    """Query how much of the memory on CPUs is backed by huge pages.
+
+    With ``ti.init(arch=ti.cpu, cpu_huge_pages=True)``, the root buffers of
+    the fields, and the memory pool the dynamic SNodes and the ndarrays are
+    allocated from, are backed by transparent huge pages (2 MB on x86-64),
+    so that random accesses to large fields miss the TLB less often. The OS
+    backs the pages as they are touched, and only where it finds the
+    contiguous memory, hence the coverage may be partial.
+
+    Returns:
+        dict: ``huge_page_bytes``, the bytes backed by huge pages (only known
+        on Linux, 0 elsewhere), and ``total_bytes``, the bytes allocated.
+    """
+    impl.get_runtime().materialize()
+    huge_page_bytes, total_bytes = \
+        impl.get_runtime().prog.get_huge_page_coverage()
+    return {'huge_page_bytes': huge_page_bytes, 'total_bytes': total_bytes}
+
+
+def get_layout_advice():
+    """Suggest how to group the fields, based on how the kernels access them.
+
+    To enable the advisor, set ``layout_advisor=True`` in ``ti.init()``. Pairs
+    of fields placed in the same SNode that are rarely accessed by the same
+    task are suggested to be split (SoA), and pairs of fields with the same
+    shape in different SNodes that are almost always accessed together are
+    suggested to be grouped (AoS). The tasks are weighted by the launch
+    counts of their kernels.
+
+    Returns:
+        List[str]: The suggestions, the most frequently accessed fields first.
+    """
+    return list(impl.get_runtime().prog.get_layout_advice())
+
+
+def print_layout_advice():
+    """Print the suggestions of ``ti.get_layout_advice()``."""
+    impl.get_runtime().prog.print_layout_advice()
+
+
+def get_access_pattern_report():
+    """Report how the parallel tasks of the kernels access the fields.
+
+    To enable the report, set ``access_pattern_report=True`` in ``ti.init()``.
+    Each access to a dense field is classified as coalesced, strided or random
+    by how its address changes between neighboring threads, e.g. ``x[i, 0]``
+    in ``for i in range(n)`` is strided if ``x`` has a second dimension. The
+    estimated bytes moved from memory per byte used assume 32-byte memory
+    transactions. Only the kernels launched so far are reported.
+
+    Returns:
+        List[str]: One line per field accessed by a task, the kernels moving
+        the most unused bytes first.
+    """
+    return list(impl.get_runtime().prog.get_access_pattern_report())
+
+
+def print_access_pattern_report():
+    """Print the lines of ``ti.get_access_pattern_report()``."""
+    impl.get_runtime().prog.print_access_pattern_report()
+
+
+def get_stencil_footprint(field):
+    """Get where the struct-fors of the kernels compiled so far read a field
+    around their loop indices.
+
+    This is the halo a block of the field needs when the field is split into
+    blocks along its indices, e.g. across processes: after
+    ``y[i] = x[i - 1] + x[i + 2]`` in ``for i in y``, the footprint of ``x``
+    is ``[(-1, 2)]``. Only the kernels compiled so far are considered, so
+    call the stencil kernels once first.
+
+    Args:
+        field (Field): The field, whose components (of a matrix field) are
+            all considered.
+
+    Returns:
+        Optional[List[Tuple[int, int]]]: The lowest and highest offset in each
+        dimension, or None if a component of the field is read by no
+        struct-for, or not at the loop indices plus constants.
+    """
+    footprint = None
+    for var in field.vars:
+        component = impl.get_runtime().prog.get_stencil_footprint(
+            var.ptr.snode().id)
+        if component is None:
+            return None
+        if footprint is None:
+            footprint = component
+        else:
+            footprint = [(min(a[0], b[0]), max(a[1], b[1]))
+                         for a, b in zip(footprint, component)]
+    return [tuple(offsets) for offsets in footprint]
+
+
 def query_kernel_profile_info(name):
     """Query kernel elapsed time(min,avg,max) on devices using the kernel name.
 
@@ -209,12 +430,50 @@ def query_kernel_profile_info(name):
         [1] To get the correct result, query_kernel_profile_info() must be used in conjunction with
         clear_kernel_profile_info().
 
-        [2] Currently the result of `KernelProfiler` could be incorrect on OpenGL
-        backend due to its lack of support for `ti.sync()`.
+        [2] The tasks of the kernel, whose names start with the kernel name,
+        are added up.
     """
     return get_default_kernel_profiler().query_info(name)
 
 
+def query_kernel_attributes():
+    """Query the registers, memory and occupancy of the offloaded tasks launched
+    on CUDA, as reported by the CUDA driver.
+
+    To enable this profiler, set `kernel_profiler=True` in `ti.init`.
+    Register spills take local memory, as do the local arrays of the tasks,
+    and both cost memory bandwidth; `ti.init(gpu_max_reg=...)` trades
+    registers for occupancy.
+
+    Returns:
+        Dict[str, Dict[str, Union[int, float]]]: For each task launched since
+        the records were last cleared (the last launch if it ran several
+        times), the ``'registers'`` per thread, the ``'local_mem'`` bytes per
+        thread, the ``'shared_mem'`` bytes per block, the ``'block_size'``,
+        and the ``'occupancy'``, the fraction of the threads a multiprocessor
+        can hold that are active.
+    """
+    return get_default_kernel_profiler().query_attributes()
+
+
+def query_kernel_thread_stats():
+    """Query how evenly the threads of the CPU backends share the offloaded
+    tasks, to tune `cpu_max_num_threads` and the block sizes.
+
+    To enable this profiler, set `kernel_profiler=True` in `ti.init`. The
+    serial tasks, which do not use the thread pool, are left out.
+
+    Returns:
+        Dict[str, Dict[str, Union[int, float]]]: For each task launched since
+        the records were last cleared, the number of ``'launches'``, the most
+        ``'threads'`` that executed it, the mean and maximum ``'imbalance'``,
+        i.e. the busy time of the busiest thread over the mean one (1 if
+        balanced), and the mean and maximum ``'wakeup_latency'`` in
+        milliseconds, the longest time a worker took to start on a launch.
+    """
+    return get_default_kernel_profiler().query_thread_stats()
+
+
 def clear_kernel_profile_info():
     """Clear all KernelProfiler records."""
     get_default_kernel_profiler().clear_info()
@@ -333,6 +592,30 @@ def print_memory_profile_info():
     impl.get_runtime().prog.print_memory_profiler_info()
 
 
+def get_caching_allocator_stats():
+    """Returns the statistics of the caching allocator backing ndarrays.
+
+    The allocator is only used on CUDA, with `ndarray_use_cached_allocator`
+    enabled. On the other backends all the entries are zero.
+
+    Returns:
+        Dict[str, Union[int, float]]: Bytes allocated (current and peak),
+        reserved from and cached on top of the runtime memory, the largest
+        cached block, the number of cache hits and misses, and the
+        fragmentation of the cached memory in [0, 1).
+    """
+    impl.get_runtime().materialize()
+    stats = impl.get_runtime().prog.get_caching_allocator_stats()
+    return {
+        name: getattr(stats, name)
+        for name in [
+            'allocated_bytes', 'peak_allocated_bytes', 'reserved_bytes',
+            'cached_bytes', 'largest_cached_block_bytes', 'num_cache_hits',
+            'num_cache_misses', 'fragmentation'
+        ]
+    }
+
+
 extension = _ti_core.Extension
 
 
@@ -407,6 +690,7 @@ class _SpecialConfig:
         self.excepthook = False
         self.experimental_real_function = False
         self.short_circuit_operators = False
+        self.launch_profiler = 0
 
 
 def prepare_sandbox():
@@ -584,6 +868,7 @@ def init(arch=None,
     env_spec.add('excepthook')
     env_spec.add('experimental_real_function')
     env_spec.add('short_circuit_operators')
+    env_spec.add('launch_profiler', int)
 
     # compiler configurations (ti.cfg):
     for key in dir(ti.cfg):
@@ -598,8 +883,8 @@ def init(arch=None,
 
     if 'use_unified_memory' in unexpected_keys:
         _ti_core.warn(
-            f'"use_unified_memory" is a deprecated option, as taichi no longer have the option of using unified memory.'
-        )
+            '"use_unified_memory" is a deprecated option, please use '
+            '"cuda_unified_memory" to place the fields in unified memory.')
         del kwargs['use_unified_memory']
 
     if len(unexpected_keys):
@@ -615,6 +900,9 @@ def init(arch=None,
             spec_cfg.experimental_real_function
         impl.get_runtime().short_circuit_operators = \
             spec_cfg.short_circuit_operators
+        if spec_cfg.launch_profiler:
+            impl.get_runtime().launch_profiler = LaunchProfiler(
+                spec_cfg.launch_profiler)
         ti.set_logging_level(spec_cfg.log_level.lower())
         if spec_cfg.excepthook:
             # TODO(#1405): add a way to restore old excepthook
@@ -867,6 +1155,10 @@ def clear_all_gradients():
     """Set all fields' gradients to 0."""
     impl.get_runtime().materialize()
 
+    # The gradients of each node, which are cleared by memsets in a batch
+    # where possible, and by a kernel per node otherwise.
+    node_places = []
+
     def visit(node):
         places = []
         for _i in range(node.ptr.get_num_ch()):
@@ -875,15 +1167,72 @@ def clear_all_gradients():
                 visit(SNode(ch))
             else:
                 if not ch.is_primal():
-                    places.append(ch.get_expr())
-
-        places = tuple(places)
+                    places.append(ch)
         if places:
-            taichi.lang.meta.clear_gradients(places)
+            node_places.append(places)
 
     for root_fb in FieldsBuilder.finalized_roots():
         visit(root_fb)
 
+    places = [ch for chs in node_places for ch in chs]
+    left = set(impl.get_runtime().prog.fill_dense_fields(places, 0))
+    k = 0
+    for node in node_places:
+        exprs = tuple(ch.get_expr() for i, ch in enumerate(node, k)
+                      if i in left)
+        if exprs:
+            taichi.lang.meta.clear_gradients(exprs)
+        k += len(node)
+
+
+def discard(*fields):
+    """Declares that the current values of ``fields`` are not read again before
+    being overwritten.
+
+    In async mode, the pending stores to the fields are then eliminated, and
+    the sparse SNodes holding nothing but discarded fields are deactivated, so
+    that their memory is reused by the fields allocated later. Reading a
+    discarded field before writing it gives undefined values.
+
+    Args:
+        *fields (Union[Field, StructField]): The fields to discard.
+    """
+    impl.get_runtime().materialize()
+    places = {}
+    for f in fields:
+        if isinstance(f, StructField):
+            f = list(f.field_dict.values())
+        else:
+            f = [f]
+        for field in f:
+            for var in field.vars:
+                snode = var.ptr.snode()
+                places[snode.id] = snode
+    impl.get_runtime().prog.discard_values(list(places.values()))
+
+    SNodeType = _ti_core.SNodeType
+
+    def holds_discarded_only(node):
+        if node.type == SNodeType.place:
+            return node.id in places
+        return all(
+            holds_discarded_only(node.get_ch(i))
+            for i in range(node.get_num_ch()))
+
+    # The outermost sparse SNodes whose subtrees are discarded.
+    to_deactivate = {}
+    for place in places.values():
+        node, outermost = place, None
+        while node.parent is not None and holds_discarded_only(node.parent):
+            node = node.parent
+            if node.type in (SNodeType.pointer, SNodeType.hash,
+                             SNodeType.bitmasked, SNodeType.dynamic):
+                outermost = node
+        if outermost is not None:
+            to_deactivate[outermost.id] = outermost
+    for node in to_deactivate.values():
+        SNode(node).deactivate_all()
+
 
 def deactivate_all_snodes():
     """Recursively deactivate all SNodes."""
@@ -0,0 +1,65 @@
+from contextlib import contextmanager
+
+from taichi.core.util import ti_core as _ti_core
+from taichi.lang import impl
+
+
+class CudaGraph:
+    """Records a sequence of kernel calls into a CUDA graph, so that it can be
+    replayed with a single launch.
+
+    Only kernels without return values and without numpy/torch host arrays
+    can be recorded. Use ndarrays or fields to pass data in and out.
+
+    Example::
+
+        >>> graph = ti.CudaGraph()
+        >>> with graph.capture():  # The kernels are also run once
+        >>>     for _ in range(40):
+        >>>         substep(dt)
+        >>> graph.replay()  # Reruns the frame with the same arguments
+        >>> with graph.update():  # Runs the frame with new arguments
+        >>>     for _ in range(40):
+        >>>         substep(dt * 0.5)
+    """
+    def __init__(self):
+        if impl.current_cfg().arch != _ti_core.cuda:
+            raise RuntimeError('CUDA graphs are only available on CUDA')
+        if not hasattr(_ti_core, 'CudaGraph'):
+            raise RuntimeError('Taichi is not compiled with CUDA')
+        impl.get_runtime().materialize()
+        self.graph = _ti_core.CudaGraph()
+
+    @contextmanager
+    def _record(self, begin, end):
+        begin()
+        try:
+            yield self
+        except:
+            self.graph.reset()
+            raise
+        end()
+
+    def capture(self):
+        """Records the kernels called in the `with` block (replacing any
+        previously captured ones), and runs them once."""
+        return self._record(self.graph.begin_capture, self.graph.end_capture)
+
+    def update(self):
+        """Runs the captured graph with the arguments of the kernels called in
+        the `with` block. The same kernels must be called in the same order as
+        during capturing."""
+        return self._record(self.graph.begin_update, self.graph.end_update)
+
+    def replay(self):
+        """Runs the captured graph with the most recent arguments."""
+        self.graph.launch()
+
+    @property
+    def num_kernels(self):
+        """Number of the GPU kernels in the graph. A Taichi kernel may consist
+        of several GPU kernels, one per offloaded task."""
+        return self.graph.get_num_nodes()
+
+
+__all__ = ['CudaGraph']
@@ -0,0 +1,184 @@
+"""Exchanging arrays with other frameworks through DLPack, without copies.
+
+Only the DLPack structs that Taichi deals with are declared here. See
+https://github.com/dmlc/dlpack/blob/main/include/dlpack/dlpack.h.
+"""
+import ctypes
+
+import numpy as np
+from taichi.core.util import ti_core as _ti_core
+from taichi.lang import impl
+from taichi.lang.util import to_numpy_type, to_taichi_type
+
+
+class _DLDevice(ctypes.Structure):
+    _fields_ = [('device_type', ctypes.c_int32),
+                ('device_id', ctypes.c_int32)]
+
+
+class _DLDataType(ctypes.Structure):
+    _fields_ = [('code', ctypes.c_uint8), ('bits', ctypes.c_uint8),
+                ('lanes', ctypes.c_uint16)]
+
+
+class _DLTensor(ctypes.Structure):
+    """The DLTensor struct of DLPack, which begins every DLManagedTensor."""
+    _fields_ = [('data', ctypes.c_void_p), ('device', _DLDevice),
+                ('ndim', ctypes.c_int32), ('dtype', _DLDataType),
+                ('shape', ctypes.POINTER(ctypes.c_int64)),
+                ('strides', ctypes.POINTER(ctypes.c_int64)),
+                ('byte_offset', ctypes.c_uint64)]
+
+
+_DLManagedTensorDeleter = ctypes.CFUNCTYPE(None, ctypes.c_void_p)
+
+
+class _DLManagedTensor(ctypes.Structure):
+    _fields_ = [('dl_tensor', _DLTensor), ('manager_ctx', ctypes.c_void_p),
+                ('deleter', _DLManagedTensorDeleter)]
+
+
+_DL_CPU = 1
+_DL_CUDA = 2
+_DL_DTYPE_KINDS = {0: 'i', 1: 'u', 2: 'f'}
+_DL_DTYPE_CODES = {kind: code for code, kind in _DL_DTYPE_KINDS.items()}
+
+# The names are referenced by the capsules, so they must stay alive.
+_CAPSULE_NAME = ctypes.c_char_p(b'dltensor')
+
+# Declared as standalone prototypes rather than through the attributes of
+# ctypes.pythonapi, which are shared with every other user of ctypes.
+_PyCapsule_Destructor = ctypes.CFUNCTYPE(None, ctypes.c_void_p)
+_capsule_new = ctypes.PYFUNCTYPE(ctypes.py_object, ctypes.c_void_p,
+                                 ctypes.c_char_p, _PyCapsule_Destructor)(
+                                     ('PyCapsule_New', ctypes.pythonapi))
+_capsule_is_valid = ctypes.PYFUNCTYPE(ctypes.c_int, ctypes.py_object,
+                                      ctypes.c_char_p)(
+                                          ('PyCapsule_IsValid',
+                                           ctypes.pythonapi))
+_capsule_get_pointer = ctypes.PYFUNCTYPE(ctypes.c_void_p, ctypes.py_object,
+                                         ctypes.c_char_p)(
+                                             ('PyCapsule_GetPointer',
+                                              ctypes.pythonapi))
+# The destructor gets a capsule that is being deallocated, which must not be
+# wrapped in a py_object again.
+_raw_capsule_is_valid = ctypes.PYFUNCTYPE(ctypes.c_int, ctypes.c_void_p,
+                                          ctypes.c_char_p)(
+                                              ('PyCapsule_IsValid',
+                                               ctypes.pythonapi))
+_raw_capsule_get_pointer = ctypes.PYFUNCTYPE(ctypes.c_void_p, ctypes.c_void_p,
+                                             ctypes.c_char_p)(
+                                                 ('PyCapsule_GetPointer',
+                                                  ctypes.pythonapi))
+
+# Everything an exported tensor refers to, keyed by the address of its
+# DLManagedTensor. Entries are removed by the deleter.
+_exported_tensors = {}
+
+
+@_DLManagedTensorDeleter
+def _delete_managed_tensor(managed_tensor_ptr):
+    _exported_tensors.pop(managed_tensor_ptr, None)
+
+
+@_PyCapsule_Destructor
+def _destroy_capsule(capsule):
+    # A consumer renames the capsule and calls the deleter later on.
+    if _raw_capsule_is_valid(capsule, _CAPSULE_NAME):
+        _delete_managed_tensor(
+            _raw_capsule_get_pointer(capsule, _CAPSULE_NAME))
+
+
+def dlpack_device():
+    """Returns the DLPack (device_type, device_id) of the memory accessed by
+    the kernels of the current arch."""
+    arch = impl.current_cfg().arch
+    if arch == _ti_core.Arch.cuda:
+        return _DL_CUDA, 0
+    if arch in (_ti_core.Arch.x64, _ti_core.Arch.arm64):
+        return _DL_CPU, 0
+    raise RuntimeError(f"DLPack is not supported on {arch}")
+
+
+def to_dlpack(owner, data_ptr, dtype, shape, strides=None):
+    """Wraps |data_ptr| as a DLPack capsule.
+
+    Args:
+        owner: The object owning the memory, kept alive until the consumer
+            releases the capsule.
+        data_ptr (int): Address of the first element on the DLPack device.
+        dtype (DataType): Data type of the elements.
+        shape (Tuple[int]): Shape of the array.
+        strides (Optional[Tuple[int]]): Strides in elements, or None if the
+            array is compact and row-major.
+
+    Returns:
+        PyCapsule: A capsule named "dltensor".
+    """
+    # The device is checked first so that nothing is leaked on failure.
+    device = _DLDevice(*dlpack_device())
+    ndim = len(shape)
+    np_dtype = np.dtype(to_numpy_type(dtype))
+    managed_tensor = _DLManagedTensor()
+    shape_buffer = (ctypes.c_int64 * ndim)(*shape)
+    strides_buffer = None
+    tensor = managed_tensor.dl_tensor
+    tensor.data = data_ptr
+    tensor.device = device
+    tensor.ndim = ndim
+    tensor.dtype = _DLDataType(_DL_DTYPE_CODES[np_dtype.kind],
+                               np_dtype.itemsize * 8, 1)
+    tensor.shape = shape_buffer
+    if strides is not None:
+        strides_buffer = (ctypes.c_int64 * ndim)(*strides)
+        tensor.strides = strides_buffer
+    tensor.byte_offset = 0
+    managed_tensor.deleter = _delete_managed_tensor
+    managed_tensor_ptr = ctypes.addressof(managed_tensor)
+    _exported_tensors[managed_tensor_ptr] = (managed_tensor, shape_buffer,
+                                             strides_buffer, owner)
+    return _capsule_new(managed_tensor_ptr, _CAPSULE_NAME, _destroy_capsule)
+
+
+def get_dlpack_capsule(tensor):
+    """Returns the DLPack capsule of |tensor|, which is either a capsule or
+    supports __dlpack__()."""
+    if hasattr(tensor, '__dlpack__'):
+        return tensor.__dlpack__()
+    if type(tensor).__name__ == 'PyCapsule':
+        return tensor
+    raise TypeError(
+        f"{type(tensor)} is neither a DLPack capsule nor supports __dlpack__()")
+
+
+def parse_dlpack_capsule(capsule):
+    """Returns (data_ptr, dtype, shape) of the tensor in a DLPack capsule,
+    without consuming the capsule."""
+    if not _capsule_is_valid(capsule, _CAPSULE_NAME):
+        raise ValueError("The DLPack capsule has been consumed already")
+    tensor = _DLTensor.from_address(
+        _capsule_get_pointer(capsule, _CAPSULE_NAME))
+
+    expected_device = dlpack_device()[0]
+    if tensor.device.device_type != expected_device:
+        raise ValueError(
+            f"The DLPack tensor is on device type {tensor.device.device_type}, which can't be accessed by {impl.current_cfg().arch} without a copy"
+        )
+    dl_dtype = tensor.dtype
+    if dl_dtype.lanes != 1 or dl_dtype.code not in _DL_DTYPE_KINDS:
+        raise ValueError(f"Unsupported DLPack data type (code={dl_dtype.code}, "
+                         f"bits={dl_dtype.bits}, lanes={dl_dtype.lanes})")
+    dtype = to_taichi_type(
+        np.dtype(f'{_DL_DTYPE_KINDS[dl_dtype.code]}{dl_dtype.bits // 8}'))
+
+    shape = tuple(tensor.shape[i] for i in range(tensor.ndim))
+    if tensor.strides:
+        # Only compact row-major tensors can be viewed without a copy.
+        expected_stride = 1
+        for i in reversed(range(tensor.ndim)):
+            if shape[i] != 1 and tensor.strides[i] != expected_stride:
+                raise ValueError(
+                    "Only contiguous DLPack tensors can be viewed as ndarrays"
+                )
+            expected_stride *= shape[i]
+    return (tensor.data or 0) + tensor.byte_offset, dtype, shape
@@ -0,0 +1,230 @@
+"""Keeps the lowered IR of kernels in the offline cache, so that the kernels of
+a later run skip the Python frontend (the AST transformation and the lowering
+of the frontend IR) as long as nothing they depend on has changed.
+
+A kernel is looked up by a hash of its source, of the values of the globals it
+refers to (recursively through the Taichi functions it calls), of its template
+arguments, of the SNode trees and of the configuration. Editing a Taichi
+function thus only invalidates the kernels calling it, directly or not. The
+user modules a function refers to are hashed by the attributes it may access,
+e.g. a kernel calling ``utils.f()`` depends on ``utils.f`` only. A kernel
+referring to a value whose effect on the kernel cannot be told from such a hash
+(e.g. a numpy array, or an object of a user class) is not cached.
+"""
+
+import enum
+import hashlib
+import inspect
+import os
+import sys
+import sysconfig
+import types
+
+from taichi.core.util import ti_core as _ti_core
+from taichi.lang import impl
+from taichi.lang.field import Field
+from taichi.lang.snode import SNode
+from taichi.lang.struct import StructField
+
+# The modules a kernel may refer to, which are not edited between runs.
+_STABLE_MODULE_ROOTS = ('taichi', 'numpy')
+_STDLIB_DIR = os.path.normcase(sysconfig.get_paths()['stdlib'])
+
+
+class _Uncacheable(Exception):
+    pass
+
+
+def _is_stable_module(module):
+    root = module.__name__.split('.')[0]
+    if root in _STABLE_MODULE_ROOTS or root in sys.builtin_module_names:
+        return True
+    path = getattr(module, '__file__', None)
+    return path is not None and os.path.normcase(
+        os.path.abspath(path)).startswith(_STDLIB_DIR)
+
+
+# The sources of the functions and classes hashed so far, as the kernels of a
+# program often share most of their Taichi functions.
+_sources = {}
+
+
+def _get_source(obj):
+    # The code object changes when the function is redefined.
+    key = getattr(obj, '__code__', obj)
+    source = _sources.get(key)
+    if source is None:
+        try:
+            source = inspect.getsource(obj)
+        except (OSError, TypeError):
+            raise _Uncacheable() from None
+        _sources[key] = source
+    return source
+
+
+def _get_names(code):
+    """Returns the global and attribute names used by ``code``, including its
+    nested functions."""
+    names = set(code.co_names)
+    for const in code.co_consts:
+        if isinstance(const, types.CodeType):
+            names |= _get_names(const)
+    return names
+
+
+class _Fingerprinter:
+    def __init__(self):
+        self._seen = set()
+        # The names used by the function being hashed, see module().
+        self._names = set()
+
+    def function(self, func):
+        func = inspect.unwrap(func)
+        if id(func) in self._seen:
+            return 'seen'
+        self._seen.add(id(func))
+        closure_vars = inspect.getclosurevars(func)
+        values = {
+            **closure_vars.globals,
+            **closure_vars.nonlocals,
+            **closure_vars.builtins
+        }
+        outer_names = self._names
+        self._names = _get_names(func.__code__)
+        try:
+            return repr((_get_source(func), self.value_dict(values)))
+        finally:
+            self._names = outer_names
+
+    def module(self, module):
+        """Hashes the attributes of a user module that the current function may
+        access, i.e. those named in its code. The other attributes, e.g. the
+        functions of the module not called, do not affect the kernel."""
+        attrs = {
+            name: getattr(module, name)
+            for name in self._names if hasattr(module, name)
+        }
+        # Other functions may access other attributes of the same module.
+        key = (id(module), frozenset(attrs))
+        if key in self._seen:
+            return 'seen'
+        self._seen.add(key)
+        return repr(('module', module.__name__, self.value_dict(attrs)))
+
+    def value_dict(self, values):
+        return [(k, self.value(values[k])) for k in sorted(values)]
+
+    def value(self, v):
+        # pylint: disable=R0911,R0912
+        if v is None or isinstance(v, (bool, int, float, complex, str, bytes)):
+            return repr(v)
+        if isinstance(v, enum.Enum):
+            return str(v)
+        if isinstance(v, (tuple, list)):
+            return repr([self.value(e) for e in v])
+        if isinstance(v, dict):
+            return repr([(self.value(k), self.value(e)) for k, e in v.items()])
+        if isinstance(v, types.ModuleType):
+            if not _is_stable_module(v):
+                return self.module(v)
+            return f'module {v.__name__}'
+        if isinstance(v, StructField):
+            return repr(('StructField', self.value_dict(v.field_dict)))
+        if isinstance(v, Field):
+            return repr((type(v).__name__, getattr(v, 'n', None),
+                         getattr(v, 'm', None),
+                         [e.ptr.snode().id for e in v.vars]))
+        if isinstance(v, SNode):
+            return f'SNode {v.ptr.id}'
+        if isinstance(v, _ti_core.DataType):
+            return str(v)
+        module = getattr(v, '__module__', None) or ''
+        if module.split('.')[0] == 'taichi':
+            if callable(v) and hasattr(v, '__qualname__'):
+                return f'{module}.{v.__qualname__}'
+            if hasattr(v, '__dict__'):
+                # E.g. the compound types.
+                return repr((type(v).__qualname__, self.value_dict(vars(v))))
+            raise _Uncacheable()
+        if inspect.isfunction(v) or inspect.ismethod(v):
+            return self.function(v)
+        if getattr(type(v), '_data_oriented', False):
+            if id(v) in self._seen:
+                return 'seen'
+            self._seen.add(id(v))
+            return repr((_get_source(type(v)), self.value_dict(vars(v))))
+        raise _Uncacheable()
+
+
+def _cache_dir():
+    cfg = impl.current_cfg()
+    path = cfg.offline_cache_file_path
+    if not path:
+        path = os.path.join(_ti_core.get_repo_dir(), 'ticache')
+    return os.path.join(path, 'frontend')
+
+
+def get_key(kernel, args, arg_features):
+    """Returns the key of the lowered IR of ``kernel`` for ``args``, or None if
+    the kernel is not to be cached."""
+    cfg = impl.current_cfg()
+    if not cfg.offline_cache or \
+            kernel.autodiff_mode != _ti_core.AutodiffMode.none or \
+            (args is not None and arg_features is None):
+        return None
+    fingerprinter = _Fingerprinter()
+    try:
+        # The features of the template arguments hold their addresses.
+        features = [] if args is None else [
+            fingerprinter.value(args[i]) if i in
+            kernel.template_slot_locations else fingerprinter.value(feature)
+            for i, feature in enumerate(arg_features)
+        ]
+        parts = [
+            _ti_core.get_version_string(),
+            _ti_core.get_commit_hash(),
+            str(cfg.arch),
+            str(cfg.debug),
+            str(cfg.default_fp),
+            str(cfg.default_ip),
+            str(cfg.dynamic_index),
+            # Whether the ti.field_handle() arguments are taken like templates.
+            str(cfg.async_mode),
+            str(cfg.packed),
+            impl.get_runtime().prog.get_snode_trees_fingerprint(),
+            fingerprinter.function(kernel.func),
+            repr(features),
+        ]
+    except _Uncacheable:
+        return None
+    return hashlib.sha256('\0'.join(parts).encode()).hexdigest()
+
+
+def load(key, kernel_name):
+    """Returns the kernel cached under ``key``, or None."""
+    path = os.path.join(_cache_dir(), key + '.tir')
+    try:
+        with open(path, 'rb') as f:
+            data = f.read()
+    except OSError:
+        return None
+    return impl.get_runtime().prog.load_kernel(data, kernel_name)
+
+
+def store(key, taichi_kernel):
+    """Lowers ``taichi_kernel``, and caches its IR under ``key`` if it can be
+    restored."""
+    data = taichi_kernel.lower_ast_and_serialize()
+    if data is None:
+        return
+    cache_dir = _cache_dir()
+    path = os.path.join(cache_dir, key + '.tir')
+    tmp_path = f'{path}.{os.getpid()}.tmp'
+    try:
+        os.makedirs(cache_dir, exist_ok=True)
+        with open(tmp_path, 'wb') as f:
+            f.write(data)
+        # Concurrent runs may write the same entry.
+        os.replace(tmp_path, path)
+    except OSError:
+        pass
@@ -1,13 +1,19 @@
+import copy
+
 import numpy as np
 import taichi.lang
 from taichi.core.util import ti_core as _ti_core
 from taichi.lang import impl
+from taichi.lang._dlpack import (dlpack_device, get_dlpack_capsule,
+                                  parse_dlpack_capsule, to_dlpack)
 from taichi.lang.enums import Layout
-from taichi.lang.util import (cook_dtype, has_pytorch, python_scope,
+from taichi.lang.util import (cook_dtype, device_memory_callsite,
+                              has_pytorch, python_scope,
                               to_numpy_type, to_pytorch_type, to_taichi_type)
 
 if has_pytorch():
     import torch
+    import torch.utils.dlpack
 
 
 class Ndarray:
@@ -17,6 +23,14 @@ class Ndarray:
         dtype (DataType): Data type of each value.
         shape (Tuple[int]): Shape of the torch tensor.
     """
+    # The strides in elements of the underlying storage if this is a strided
+    # view, or None if it is contiguous.
+    strides = None
+    # The ndarray a view was sliced from, and the offset of the view into it
+    # in elements.
+    _view_root = None
+    _view_offset = 0
+
     def __init__(self, dtype, shape):
         self.host_accessor = None
         if impl.current_cfg().ndarray_use_torch:
@@ -29,8 +43,9 @@ class Ndarray:
                 self.arr = self.arr.cuda()
 
         else:
-            self.arr = _ti_core.Ndarray(impl.get_runtime().prog,
-                                        cook_dtype(dtype), shape)
+            with device_memory_callsite():
+                self.arr = _ti_core.Ndarray(impl.get_runtime().prog,
+                                            cook_dtype(dtype), shape)
 
     @property
     def shape(self):
@@ -226,6 +241,101 @@ class Ndarray:
         """
         raise NotImplementedError()
 
+    def _storage_strides(self):
+        if self.strides is not None:
+            return self.strides
+        return _contiguous_strides(tuple(self.arr.shape))
+
+    def _field_axes(self):
+        """The axes of the underlying storage holding the field dims."""
+        num_field_dims = len(self.shape)
+        if getattr(self, 'layout', Layout.AOS) == Layout.SOA:
+            first = len(self.arr.shape) - num_field_dims
+            return list(range(first, first + num_field_dims))
+        return list(range(num_field_dims))
+
+    @staticmethod
+    def _is_view_key(key):
+        if isinstance(key, slice):
+            return True
+        return isinstance(key, tuple) and any(
+            isinstance(k, slice) for k in key)
+
+    @python_scope
+    def _view(self, key):
+        """Slices the field dims into a view sharing the memory of this
+        ndarray. Integral indices drop their dims.
+
+        Kernels take the view like any ndarray, and index its memory by its
+        strides when it is not contiguous.
+        """
+        if impl.current_cfg().ndarray_use_torch:
+            raise ValueError(
+                'Views of ndarrays are not supported with ndarray_use_torch')
+        root = self._view_root if self._view_root is not None else self
+        if root.arr.data_ptr() == 0:
+            raise ValueError(
+                f'Views of ndarrays are not supported on {impl.current_cfg().arch}'
+            )
+        if not isinstance(key, tuple):
+            key = (key, )
+        field_axes = self._field_axes()
+        if len(key) > len(field_axes):
+            raise IndexError(
+                f'Too many indices: {len(key)} for {len(field_axes)} dims')
+        key = key + (slice(None), ) * (len(field_axes) - len(key))
+        arr_shape = list(self.arr.shape)
+        strides = list(self._storage_strides())
+        offset = self._view_offset
+        dropped = []
+        for axis, k in zip(field_axes, key):
+            n = arr_shape[axis]
+            if isinstance(k, slice):
+                start, stop, step = k.indices(n)
+                if step <= 0:
+                    raise ValueError(
+                        'Views of ndarrays only take positive steps')
+                offset += start * strides[axis]
+                arr_shape[axis] = len(range(start, stop, step))
+                strides[axis] *= step
+            else:
+                k = int(k)
+                if k < 0:
+                    k += n
+                if not 0 <= k < n:
+                    raise IndexError(f'Index {k} out of range for dim of {n}')
+                offset += k * strides[axis]
+                dropped.append(axis)
+        arr_shape = tuple(n for i, n in enumerate(arr_shape)
+                          if i not in dropped)
+        strides = tuple(s for i, s in enumerate(strides) if i not in dropped)
+        if strides == _contiguous_strides(arr_shape):
+            strides = None
+        elif 2 * len(arr_shape) > _ti_core.get_max_num_indices():
+            raise ValueError(
+                f'Strided views of ndarrays take at most {_ti_core.get_max_num_indices() // 2} dims'
+            )
+        ret = copy.copy(self)
+        ret.host_accessor = None
+        ret.arr = _ti_core.Ndarray(
+            impl.get_runtime().prog, root.arr.dtype, arr_shape,
+            root.arr.data_ptr() + offset * root.arr.element_size())
+        ret.strides = strides
+        ret._view_root = root
+        ret._view_offset = offset
+        return ret
+
+    def _root_key(self, key):
+        """Maps the indices into a view to the ones into its root."""
+        linear = self._view_offset
+        for k, stride in zip(key, self._storage_strides()):
+            linear += k * stride
+        root_key = []
+        for stride in _contiguous_strides(tuple(self._view_root.arr.shape)):
+            root_key.append(linear // stride)
+            linear %= stride
+        return tuple(root_key)
+
     def pad_key(self, key):
         if key is None:
             key = ()
@@ -234,11 +344,49 @@ class Ndarray:
         assert len(key) == len(self.arr.shape)
         return key
 
+    @python_scope
+    def __dlpack__(self, stream=None):
+        """Exports the underlying storage through DLPack, without a copy.
+
+        Args:
+            stream: Ignored. The kernels launched so far are synchronized
+                instead.
+
+        Returns:
+            PyCapsule: A DLPack capsule.
+        """
+        impl.get_runtime().sync()
+        if impl.current_cfg().ndarray_use_torch:
+            return torch.utils.dlpack.to_dlpack(self.arr)
+        if self.strides is not None:
+            raise ValueError('Strided views cannot be exported through DLPack')
+        return to_dlpack(self, self.arr.data_ptr(), self.arr.dtype,
+                         tuple(self.arr.shape))
+
+    def __dlpack_device__(self):
+        if impl.current_cfg().ndarray_use_torch:
+            return self.arr.__dlpack_device__()
+        return dlpack_device()
+
     def initialize_host_accessor(self):
         if self.host_accessor:
             return
         impl.get_runtime().materialize()
-        self.host_accessor = NdarrayHostAccessor(self.arr)
+        if self._view_root is None:
+            self.host_accessor = NdarrayHostAccessor(self.arr)
+        else:
+            self._view_root.initialize_host_accessor()
+            self.host_accessor = NdarrayViewHostAccessor(
+                self._view_root.host_accessor, self._root_key)
+
+
+def _contiguous_strides(shape):
+    strides = []
+    stride = 1
+    for n in reversed(shape):
+        strides.append(stride)
+        stride *= n
+    return tuple(reversed(strides))
 
 
 class ScalarNdarray(Ndarray):
@@ -268,6 +416,8 @@ class ScalarNdarray(Ndarray):
     def __getitem__(self, key):
         if impl.current_cfg().ndarray_use_torch:
             return self.arr.__getitem__(key)
+        if self._is_view_key(key):
+            return self._view(key)
         self.initialize_host_accessor()
         return self.host_accessor.getter(*self.pad_key(key))
 
@@ -291,6 +441,29 @@ class ScalarNdarray(Ndarray):
     def __repr__(self):
         return '<ti.ndarray>'
 
+    @classmethod
+    @python_scope
+    def from_dlpack(cls, tensor):
+        """Creates an ndarray sharing memory with a DLPack tensor.
+
+        See :func:`taichi.lang.impl.from_dlpack`.
+        """
+        capsule = get_dlpack_capsule(tensor)
+        data_ptr, dtype, shape = parse_dlpack_capsule(capsule)
+        ret = cls.__new__(cls)
+        ret.host_accessor = None
+        if impl.current_cfg().ndarray_use_torch:
+            assert has_pytorch(
+            ), "PyTorch must be available if you want to create a Taichi ndarray with PyTorch as its underlying storage."
+            ret.arr = torch.utils.dlpack.from_dlpack(capsule)
+        else:
+            ret.arr = _ti_core.Ndarray(impl.get_runtime().prog, dtype, shape,
+                                       data_ptr)
+            # The memory is released along with the capsule.
+            ret.dlpack_capsule = capsule
+        ret.dlpack_source = tensor
+        return ret
+
 
 class NdarrayHostAccessor:
     def __init__(self, ndarray):
@@ -318,6 +491,18 @@ class NdarrayHostAccessor:
         self.setter = setter
 
 
+class NdarrayViewHostAccessor:
+    def __init__(self, accessor, root_key):
+        def getter(*key):
+            return accessor.getter(*root_key(key))
+
+        def setter(value, *key):
+            accessor.setter(value, *root_key(key))
+
+        self.getter = getter
+        self.setter = setter
+
+
 class NdarrayHostAccess:
     """Class for accessing VectorNdarray/MatrixNdarray in Python scope.
     Args:
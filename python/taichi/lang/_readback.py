@@ -0,0 +1,72 @@
+import numpy as np
+from taichi.core.util import ti_core as _ti_core
+from taichi.lang import impl
+from taichi.lang.util import to_numpy_type
+
+
+class FieldReadback:
+    """The result of ``to_numpy_async()``: a copy of a field into host memory
+    that may still be in flight.
+
+    On CUDA, a kernel copies the field into a temporary device buffer, which is
+    then copied into pinned host memory without blocking, so that the kernels
+    launched afterwards (e.g. the next frame) run while the data comes back.
+    On the other backends, the data is copied when the readback is created.
+
+    Args:
+        shape (Tuple[int]): The shape of the result.
+        field_dtype (DataType): The data type of the field.
+        dtype (numpy.dtype): The data type of the result.
+        copy (Callable): Copies the field into its argument, a numpy array or
+            an ndarray of ``shape``.
+    """
+    def __init__(self, shape, field_dtype, dtype, copy):
+        self._shape = shape
+        self._dtype = dtype
+        self._field_dtype = field_dtype
+        self._readback = None
+        self._staging = None
+        self._result = None
+        cfg = impl.current_cfg()
+        if (cfg.arch == _ti_core.Arch.cuda
+                and hasattr(_ti_core, 'CudaReadback')
+                and not cfg.ndarray_use_torch):
+            # pylint: disable=C0415
+            from taichi.lang._ndarray import ScalarNdarray
+            self._staging = ScalarNdarray(field_dtype, shape)
+            copy(self._staging)
+            if cfg.async_mode:
+                impl.get_runtime().prog.async_flush()
+            arr = self._staging.arr
+            self._readback = _ti_core.CudaReadback(
+                arr.data_ptr(),
+                arr.element_size() * arr.nelement())
+        else:
+            arr = np.zeros(shape, dtype=dtype)
+            copy(arr)
+            impl.get_runtime().sync()
+            self._result = arr
+
+    def done(self):
+        """Returns whether the data has arrived, i.e. :meth:`result` would not
+        block."""
+        return self._result is not None or self._readback.is_ready()
+
+    def result(self):
+        """Waits for the data, and returns it as a numpy array."""
+        if self._result is None:
+            arr = np.empty(self._shape, dtype=to_numpy_type(self._field_dtype))
+            self._readback.copy_to(arr.ctypes.data, arr.nbytes)
+            if arr.dtype != np.dtype(self._dtype):
+                arr = arr.astype(self._dtype)
+            self._result = arr
+            # The pinned buffer goes back to the pool before the device
+            # buffer is freed.
+            self._readback = None
+            self._staging = None
+        return self._result
+
+    def __del__(self):
+        # The device buffer must outlive the copy from it.
+        if self._readback is not None:
+            self._readback.wait()
@@ -0,0 +1,145 @@
+import numpy as np
+from taichi.core.util import ti_core as _ti_core
+from taichi.lang import impl
+from taichi.lang.expr import Expr, make_expr_group
+from taichi.lang.matrix import Matrix, Vector
+from taichi.lang.ops import cast
+from taichi.lang.util import cook_dtype, python_scope, taichi_scope
+from taichi.types.primitive_types import f32, i32
+
+
+class Texture:
+    """An image of ``f32`` texels on the GPU, which kernels read through the
+    texture units of the hardware.
+
+    Compared to a field, the samples are filtered by the hardware, and the
+    texels are cached along the 2D or 3D neighborhoods of the image. Only
+    available on Vulkan.
+
+    Example::
+
+        >>> tex = ti.Texture(ti.f32, 4, (128, 128))
+        >>> tex.from_numpy(img)  # img.shape == (128, 128, 4)
+        >>>
+        >>> @ti.kernel
+        >>> def render(t: ti.texture(num_dimensions=2)):
+        >>>     for i, j in pixels:
+        >>>         uv = ti.Vector([i, j]) / 512.0
+        >>>         pixels[i, j] = t.sample_lod(uv, 0.0)
+        >>>
+        >>> render(tex)
+
+    Args:
+        dtype (DataType): The type of the channels, only ``ti.f32``.
+        num_channels (int): The number of channels, 1, 2 or 4.
+        arr_shape (Tuple[int]): The size of each of the 1 to 3 dimensions.
+    """
+    def __init__(self, dtype, num_channels, arr_shape):
+        if impl.current_cfg().arch != _ti_core.vulkan:
+            raise RuntimeError('Textures are only available on Vulkan')
+        self.dtype = cook_dtype(dtype)
+        self.num_channels = num_channels
+        self.shape = tuple(arr_shape)
+        impl.get_runtime().materialize()
+        # Owned by the program, and destroyed along with it.
+        self.tex = impl.get_runtime().prog.create_texture(
+            self.dtype, num_channels, list(self.shape))
+
+    def _host_axes(self):
+        # The first axis of the image is the innermost one on the device, so
+        # the axes of the arrays are reversed, except for the channels.
+        dim = len(self.shape)
+        return tuple(reversed(range(dim))) + (dim, )
+
+    @python_scope
+    def from_numpy(self, arr):
+        """Copies the texels from a numpy array.
+
+        Args:
+            arr (numpy.ndarray): The texels, of shape ``arr_shape +
+                (num_channels, )``. The last axis may be omitted with a
+                single channel.
+        """
+        arr = np.asarray(arr, dtype=np.float32)
+        if self.num_channels == 1 and arr.shape == self.shape:
+            arr = arr[..., np.newaxis]
+        expected = self.shape + (self.num_channels, )
+        if arr.shape != expected:
+            raise ValueError(
+                f'Expected an array of shape {expected}, got {arr.shape}')
+        arr = np.ascontiguousarray(arr.transpose(self._host_axes()))
+        self.tex.from_host(int(arr.ctypes.data))
+
+    @python_scope
+    def to_numpy(self):
+        """Copies the texels into a numpy array.
+
+        Returns:
+            numpy.ndarray: The texels, of shape
+            ``arr_shape + (num_channels, )``.
+        """
+        arr = np.zeros(tuple(reversed(self.shape)) + (self.num_channels, ),
+                       dtype=np.float32)
+        self.tex.to_host(int(arr.ctypes.data))
+        return np.ascontiguousarray(arr.transpose(self._host_axes()))
+
+
+class TextureSampler:
+    """A texture argument of a kernel, see :func:`~taichi.types.texture`.
+
+    The texels read are 4D vectors. The channels missing from the texture
+    read as 0, except for the 4th one, which reads as 1.
+
+    Args:
+        arg_id (int): The index of the argument.
+        num_dims (int): The number of dimensions of the texture.
+    """
+    def __init__(self, arg_id, num_dims):
+        self.arg_id = arg_id
+        self.num_dims = num_dims
+
+    def _read(self, op, coords, lod, dtype):
+        if isinstance(coords, Matrix):
+            coords = coords.entries
+        elif not isinstance(coords, (list, tuple)):
+            coords = [coords]
+        if len(coords) != self.num_dims:
+            raise ValueError(
+                f'Expected {self.num_dims} coordinates, got {len(coords)}')
+        args = [Expr(cast(c, dtype)) for c in coords]
+        args.append(Expr(cast(lod, dtype)))
+        return Vector([
+            Expr(
+                _ti_core.make_texture_op_expr(op, self.arg_id, self.num_dims,
+                                              make_expr_group(args), channel))
+            for channel in range(4)
+        ])
+
+    @taichi_scope
+    def sample_lod(self, uv, lod):
+        """Samples the texture with linear filtering.
+
+        The texture is clamped to its edges outside of ``[0, 1]``.
+
+        Args:
+            uv (Vector): The coordinates, normalized to ``[0, 1]``.
+            lod (float): The level of detail, 0 for the full image.
+
+        Returns:
+            Vector: The filtered texel.
+        """
+        return self._read(_ti_core.TextureOpType.sample_lod, uv, lod, f32)
+
+    @taichi_scope
+    def fetch(self, index, lod):
+        """Reads a texel without filtering.
+
+        Args:
+            index (Vector): The integer coordinates of the texel, which must
+                be inside of the texture.
+            lod (int): The level of detail, 0 for the full image.
+
+        Returns:
+            Vector: The texel.
+        """
+        return self._read(_ti_core.TextureOpType.fetch_texel, index, lod, i32)
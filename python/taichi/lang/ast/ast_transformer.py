@@ -385,11 +385,29 @@ class ASTTransformer(Builder):
                         ti.lang.kernel_arguments.decl_any_arr_arg(
                             to_taichi_type(ctx.arg_features[i][0]),
                             ctx.arg_features[i][1], ctx.arg_features[i][2],
-                            ctx.arg_features[i][3]))
+                            ctx.arg_features[i][3], ctx.arg_features[i][4]))
+                elif isinstance(ctx.func.argument_annotations[i],
+                                ti.texture):
+                    ctx.create_variable(
+                        arg.arg,
+                        ti.lang.kernel_arguments.decl_texture_arg(
+                            ctx.func.argument_annotations[i].num_dimensions))
                 else:
                     ctx.global_vars[
                         arg.arg] = ti.lang.kernel_arguments.decl_scalar_arg(
                             ctx.func.argument_annotations[i])
+            # The offsets of the fields taken by the ti.field_handle()
+            # arguments are declared after the other arguments.
+            kernel_arguments = ti.lang.kernel_arguments
+            for i, arg in enumerate(args.args):
+                if not isinstance(ctx.func.argument_annotations[i],
+                                  ti.field_handle):
+                    continue
+                field = ctx.argument_data[i]
+                if kernel_arguments.get_field_handle_layout(field) is not None:
+                    ctx.global_vars[
+                        arg.arg] = kernel_arguments.decl_field_handle_arg(
+                            field)
             # remove original args
             node.args.args = []
 
@@ -1,10 +1,62 @@
+import numbers
+
+import numpy as np
 import taichi.lang
 from taichi.core.util import ti_core as _ti_core
+from taichi.lang._readback import FieldReadback
 from taichi.lang.util import python_scope, to_numpy_type, to_pytorch_type
 
 import taichi as ti
 
 
+def _is_normal_dist(dtype, dist):
+    if dtype not in [ti.f16, ti.f32, ti.f64]:
+        raise TypeError(f'Cannot fill a field of {dtype} with random numbers')
+    if dist not in ['uniform', 'normal']:
+        raise ValueError(f'Unknown distribution "{dist}"')
+    return dist == 'normal'
+
+
+def _fill_bits(dtype, val):
+    """Returns the bits of ``val`` cast to ``dtype`` like in a kernel, or None
+    if the fill is left to a kernel."""
+    if dtype not in [
+            ti.f16, ti.f32, ti.f64, ti.i8, ti.i16, ti.i32, ti.i64, ti.u8,
+            ti.u16, ti.u32, ti.u64
+    ]:
+        return None
+    cfg = taichi.lang.impl.current_cfg()
+    # A kernel takes the constants in the default types first.
+    if isinstance(val, numbers.Integral):
+        default_type = cfg.default_ip
+    elif isinstance(val, numbers.Real):
+        default_type = cfg.default_fp
+    else:
+        return None
+    try:
+        val = np.array(val, dtype=to_numpy_type(default_type))
+    except OverflowError:
+        return None
+    val = val.astype(to_numpy_type(dtype)).reshape(1)
+    return int(val.view(f'u{val.itemsize}')[0])
+
+
+def _fill_dense(_vars, bits):
+    """Fills the field members ``_vars`` with the value of bits ``bits`` by
+    memsets where possible, see Program::fill_dense_fields().
+
+    Returns:
+        List[int]: The positions in ``_vars`` of the members left to a kernel.
+    """
+    runtime = taichi.lang.impl.get_runtime()
+    # The memsets are not recorded for the autodiff.
+    if runtime.target_tape or bits is None:
+        return list(range(len(_vars)))
+    runtime.materialize()
+    return runtime.prog.fill_dense_fields([v.ptr.snode() for v in _vars],
+                                          bits)
+
+
 class Field:
     """Taichi field with SNode implementation.
 
@@ -20,6 +72,7 @@ class Field:
         self.vars = _vars
         self.host_accessors = None
         self.grad = None
+        self.dual = None
 
     @property
     def snode(self):
@@ -92,6 +145,14 @@ class Field:
         """
         self.grad = grad
 
+    def set_dual(self, dual):
+        """Sets corresponding dual field (forward-mode autodiff).
+
+        Args:
+            dual (Field): Corresponding dual field.
+        """
+        self.dual = dual
+
     @python_scope
     def fill(self, val):
         """Fills `self` with a specific value.
@@ -101,6 +162,20 @@ class Field:
         """
         raise NotImplementedError()
 
+    @python_scope
+    def fill_random(self, dist='uniform'):
+        """Fills `self` with random numbers.
+
+        Unlike ``ti.random()`` in a kernel, the numbers are drawn by a
+        counter-based generator keyed by the element, so they do not depend on
+        the number of threads, and the normal ones are drawn in pairs.
+
+        Args:
+            dist (str): ``'uniform'`` for the uniform distribution over [0, 1),
+                or ``'normal'`` for the standard normal distribution.
+        """
+        raise NotImplementedError()
+
     @python_scope
     def to_numpy(self, dtype=None):
         """Converts `self` to a numpy array.
@@ -113,6 +188,21 @@ class Field:
         """
         raise NotImplementedError()
 
+    @python_scope
+    def to_numpy_async(self, dtype=None):
+        """Starts copying `self` to a numpy array without waiting for it.
+
+        The kernels launched afterwards may run while the data is copied, see
+        :class:`~taichi.lang._readback.FieldReadback`.
+
+        Args:
+            dtype (DataType, optional): The desired data type of the numpy array.
+
+        Returns:
+            FieldReadback: Call its ``result()`` to get the numpy array.
+        """
+        raise NotImplementedError()
+
     @python_scope
     def to_torch(self, device=None):
         """Converts `self` to a torch tensor.
@@ -158,7 +248,20 @@ class Field:
         """
         assert isinstance(other, Field)
         assert len(self.shape) == len(other.shape)
-        taichi.lang.meta.tensor_to_tensor(self, other)
+        if not self._copy_dense_from(other):
+            taichi.lang.meta.tensor_to_tensor(self, other)
+
+    def _copy_dense_from(self, other):
+        # A memcpy per member where possible, see Program::copy_dense_field().
+        runtime = taichi.lang.impl.get_runtime()
+        if runtime.target_tape or type(self) is not type(other) or getattr(
+                self, 'n', 1) != getattr(other, 'n', 1) or getattr(
+                    self, 'm', 1) != getattr(other, 'm', 1):
+            return False
+        runtime.materialize()
+        return all(
+            runtime.prog.copy_dense_field(dst.ptr.snode(), src.ptr.snode())
+            for dst, src in zip(self.vars, other.vars))
 
     @python_scope
     def __setitem__(self, key, value):
@@ -220,7 +323,13 @@ class ScalarField(Field):
 
     @python_scope
     def fill(self, val):
-        taichi.lang.meta.fill_tensor(self, val)
+        if _fill_dense(self.vars, _fill_bits(self.dtype, val)):
+            taichi.lang.meta.fill_tensor(self, val)
+
+    @python_scope
+    def fill_random(self, dist='uniform'):
+        taichi.lang.meta.fill_tensor_random(self,
+                                            _is_normal_dist(self.dtype, dist))
 
     @python_scope
     def to_numpy(self, dtype=None):
@@ -229,9 +338,17 @@ class ScalarField(Field):
         import numpy as np  # pylint: disable=C0415
         arr = np.zeros(shape=self.shape, dtype=dtype)
         taichi.lang.meta.tensor_to_ext_arr(self, arr)
-        ti.sync()
+        taichi.lang.impl.get_runtime().sync_host_read()
         return arr
 
+    @python_scope
+    def to_numpy_async(self, dtype=None):
+        if dtype is None:
+            dtype = to_numpy_type(self.dtype)
+        return FieldReadback(
+            self.shape, self.dtype, dtype,
+            lambda arr: taichi.lang.meta.tensor_to_ext_arr(self, arr))
+
     @python_scope
     def to_torch(self, device=None):
         import torch  # pylint: disable=C0415
@@ -241,7 +358,7 @@ class ScalarField(Field):
                           dtype=to_pytorch_type(self.dtype),
                           device=device)
         taichi.lang.meta.tensor_to_ext_arr(self, arr)
-        ti.sync()
+        taichi.lang.impl.get_runtime().sync_host_read()
         return arr
 
     @python_scope
@@ -258,6 +375,98 @@ class ScalarField(Field):
         taichi.lang.meta.ext_arr_to_tensor(arr, self)
         ti.sync()
 
+    @python_scope
+    def read_batch(self, indices):
+        """Reads many elements at once, in a single kernel launch.
+
+        This is much faster than reading the elements one by one with
+        ``x[i, j]``, each of which launches a kernel.
+
+        Args:
+            indices (numpy.ndarray): An integer array of shape (n, d), where d
+                is the number of dimensions of the field.
+
+        Returns:
+            numpy.ndarray: The n elements at the indices.
+        """
+        import numpy as np  # pylint: disable=C0415
+        indices = self._check_batch_indices(indices)
+        arr = np.zeros(shape=indices.shape[0],
+                       dtype=to_numpy_type(self.dtype))
+        if indices.shape[0] == 0:
+            return arr
+        taichi.lang.meta.tensor_gather_to_ext_arr(self, indices, arr)
+        taichi.lang.impl.get_runtime().sync_host_read()
+        return arr
+
+    @python_scope
+    def write_batch(self, indices, values):
+        """Writes many elements at once, in a single kernel launch.
+
+        The order of writes to the same element is undefined.
+
+        Args:
+            indices (numpy.ndarray): An integer array of shape (n, d), where d
+                is the number of dimensions of the field.
+            values (Union[numpy.ndarray, Number]): The n values to write, or
+                one value for all of them.
+        """
+        import numpy as np  # pylint: disable=C0415
+        indices = self._check_batch_indices(indices)
+        values = np.ascontiguousarray(np.broadcast_to(
+            np.asarray(values, dtype=to_numpy_type(self.dtype)),
+            (indices.shape[0], )))
+        if indices.shape[0] == 0:
+            return
+        taichi.lang.meta.ext_arr_scatter_to_tensor(indices, values, self)
+        ti.sync()
+
+    def _check_batch_indices(self, indices):
+        import numpy as np  # pylint: disable=C0415
+        if not self.shape:
+            raise ValueError("Batched accesses need a field with a shape")
+        indices = np.ascontiguousarray(indices, dtype=np.int32)
+        if indices.ndim != 2 or indices.shape[1] != len(self.shape):
+            raise ValueError(
+                f"Expected indices of shape (n, {len(self.shape)}) for a "
+                f"field of shape {self.shape}, got {indices.shape}")
+        return indices
+
+    @python_scope
+    def __dlpack__(self, stream=None):
+        """Exports the field through DLPack as a strided view, without a copy.
+
+        Only the fields of the CPU and CUDA backends whose ancestors are all
+        dense SNodes are supported, e.g. ``ti.field(ti.f32, shape=(4, 8))``,
+        and neither may any axis be split over multiple SNodes. The view is
+        valid until the SNode tree of the field is destroyed.
+
+        Args:
+            stream: Ignored. The kernels launched so far are synchronized
+                instead.
+
+        Returns:
+            PyCapsule: A DLPack capsule.
+        """
+        import numpy as np  # pylint: disable=C0415
+        from taichi.lang._dlpack import to_dlpack  # pylint: disable=C0415
+        runtime = taichi.lang.impl.get_runtime()
+        runtime.materialize()
+        runtime.sync()
+        data_ptr, shape, strides = runtime.prog.get_dense_field_layout(
+            self.vars[0].ptr.snode())
+        element_size = np.dtype(to_numpy_type(self.dtype)).itemsize
+        if any(stride % element_size != 0 for stride in strides):
+            raise ValueError(
+                "The field can't be viewed as an array: its strides are not "
+                "multiples of the element size")
+        return to_dlpack(self, data_ptr, self.dtype, tuple(shape),
+                         tuple(stride // element_size for stride in strides))
+
+    def __dlpack_device__(self):
+        from taichi.lang._dlpack import dlpack_device  # pylint: disable=C0415
+        return dlpack_device()
+
     @python_scope
     def __setitem__(self, key, value):
         self.initialize_host_accessors()
@@ -273,6 +482,26 @@ class ScalarField(Field):
         return '<ti.field>'
 
 
+class FieldHandleProxy(Field):
+    """A field taken by a ti.field_handle() argument, in the kernel. Its
+    elements are those of the field the kernel is compiled for, displaced by
+    the offsets of the field passed at launch time.
+
+    Args:
+        field (Field): The field the kernel is compiled for.
+        offsets (List[Expr]): The offsets of the members of the field passed
+            from those of ``field``, in elements.
+    """
+    def __init__(self, field, offsets):
+        super().__init__(field.vars)
+        self.field = field
+        self.offsets = offsets
+
+    def __getattr__(self, name):
+        # E.g. the shape of the elements of a matrix field.
+        return getattr(self.field, name)
+
+
 class SNodeHostAccessor:
     def __init__(self, snode):
         if _ti_core.is_real(snode.data_type()):
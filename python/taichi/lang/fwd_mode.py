@@ -0,0 +1,71 @@
+import numbers
+
+from taichi.lang import impl
+
+import taichi as ti
+
+
+class FwdMode:
+    """Context manager of forward-mode autodiff.
+
+    Inside the `with` statement, every call of a function decorated by
+    :func:`~taichi.lang.kernel_impl.kernel` runs its forward-mode variant,
+    which propagates the duals of the fields along with their values. On
+    entering, the dual of `param` is seeded with `seed`, so that on exit the
+    dual of `loss` holds the directional derivative of `loss` along `seed`
+    (a Jacobian-vector product).
+
+    Args:
+        loss (:class:`~taichi.lang.field.Field`): The output field, whose dual
+            must be allocated (``needs_dual=True``).
+        param (:class:`~taichi.lang.field.Field`): The input field, whose dual
+            must be allocated (``needs_dual=True``).
+        seed (Union[Number, numpy.ndarray], optional): The tangent of `param`,
+            either a scalar broadcast to all the elements or an array of the
+            same shape as `param`. Defaults to 1.
+        clear_gradients (bool): Before `with` body start, clear all gradients
+            and duals or not.
+
+    Example::
+
+        >>> x = ti.field(ti.f32, shape=(), needs_dual=True)
+        >>> y = ti.field(ti.f32, shape=(), needs_dual=True)
+        >>>
+        >>> @ti.kernel
+        >>> def compute():
+        >>>     y[None] = ti.sin(x[None])
+        >>>
+        >>> with ti.FwdMode(loss=y, param=x):
+        >>>     compute()
+        >>> print(y.dual[None])  # cos(x)
+    """
+    def __init__(self, loss, param, seed=None, clear_gradients=True):
+        self.runtime = impl.get_runtime()
+        self.loss = loss
+        self.param = param
+        self.seed = 1 if seed is None else seed
+        self.clear_gradients = clear_gradients
+
+    def __enter__(self):
+        assert self.runtime.fwd_mode_manager is None, \
+            "FwdMode cannot be nested."
+        self.runtime.materialize()
+        for f in (self.loss, self.param):
+            if not f.snode.ptr.has_dual():
+                raise RuntimeError(
+                    'Duals are not allocated, please use ti.field(..., needs_dual=True)'
+                    ' for all fields that are required by forward-mode autodiff.'
+                )
+        if self.clear_gradients:
+            ti.clear_all_gradients()
+        if isinstance(self.seed, numbers.Number):
+            self.param.dual.fill(self.seed)
+        else:
+            self.param.dual.from_numpy(self.seed)
+        self.runtime.fwd_mode_manager = self
+        return self
+
+    def __exit__(self, _type, value, tb):
+        self.runtime.fwd_mode_manager = None
+        # Reset the seed so that it does not leak into later computations.
+        self.param.dual.fill(0)
@@ -8,7 +8,7 @@ from taichi.lang._ndarray import ScalarNdarray
 from taichi.lang.any_array import AnyArray, AnyArrayAccess
 from taichi.lang.exception import InvalidOperationError
 from taichi.lang.expr import Expr, make_expr_group
-from taichi.lang.field import Field, ScalarField
+from taichi.lang.field import Field, FieldHandleProxy, ScalarField
 from taichi.lang.kernel_arguments import SparseMatrixProxy
 from taichi.lang.matrix import Matrix, MatrixField, _IntermediateMatrix
 from taichi.lang.mesh import (ConvType, MeshElementFieldProxy, MeshInstance,
@@ -167,6 +167,20 @@ def subscript(value, *_indices, skip_reordered=False):
         return subscript(value, *reordered_index, skip_reordered=True)
     if isinstance(value, SparseMatrixProxy):
         return value.subscript(*_indices)
+    if isinstance(value, FieldHandleProxy):
+        ptr = subscript(value.field, *_indices)
+
+        def displace(entry, offset):
+            return Expr(
+                _ti_core.global_subscript_with_offset(
+                    entry.ptr, make_expr_group(offset), [1], True))
+
+        if isinstance(ptr, Expr):
+            return displace(ptr, value.offsets[0])
+        return _IntermediateMatrix(ptr.n, ptr.m, [
+            displace(entry, offset)
+            for entry, offset in zip(ptr.entries, value.offsets)
+        ])
     if isinstance(value, Field):
         _var = value.get_field_members()[0].ptr
         if _var.snode() is None:
@@ -175,7 +189,7 @@ def subscript(value, *_indices, skip_reordered=False):
                     f"{_var.get_expr_name()} has not been placed.")
             else:
                 raise RuntimeError(
-                    f"Gradient {_var.get_expr_name()} has not been placed, check whether `needs_grad=True`"
+                    f"Gradient {_var.get_expr_name()} has not been placed, check whether `needs_grad=True` (or `needs_dual=True` for the dual)"
                 )
         field_dim = int(_var.get_attribute("dim"))
         if field_dim != index_dim:
@@ -300,6 +314,7 @@ class PyTaichi:
         self.materialize_callbacks = []
         self.compiled_functions = {}
         self.compiled_grad_functions = {}
+        self.compiled_forward_grad_functions = {}
         self.scope_stack = []
         self.inside_kernel = False
         self.current_kernel = None
@@ -309,12 +324,16 @@ class PyTaichi:
         self.default_fp = f32
         self.default_ip = i32
         self.target_tape = None
+        self.fwd_mode_manager = None
         self.grad_replaced = False
+        self.launch_profiler = None
         self.kernels = kernels or []
         self._signal_handler_registry = None
 
     def get_num_compiled_functions(self):
-        return len(self.compiled_functions) + len(self.compiled_grad_functions)
+        return len(self.compiled_functions) + len(
+            self.compiled_grad_functions) + len(
+                self.compiled_forward_grad_functions)
 
     def set_default_fp(self, fp):
         assert fp in [f16, f32, f64]
@@ -395,6 +414,13 @@ class PyTaichi:
         self.materialize()
         self.prog.synchronize()
 
+    def sync_host_read(self):
+        """Synchronizes before the host reads the output of the last kernel
+        launched by the calling thread, unless it is done already, see
+        ``cuda_fine_grained_host_sync``."""
+        self.materialize()
+        self.prog.synchronize_host_read()
+
 
 pytaichi = PyTaichi()
 
@@ -591,11 +617,23 @@ def create_field_member(dtype, name):
         x_grad.ptr.set_is_primal(False)
         x.ptr.set_grad(x_grad.ptr)
 
-    return x, x_grad
+        # dual
+        x_dual = Expr(_ti_core.make_id_expr(""))
+        x_dual.ptr = _ti_core.global_new(x_dual.ptr, dtype)
+        x_dual.ptr.set_name(name + ".dual")
+        x_dual.ptr.set_is_primal(False)
+        x.ptr.set_dual(x_dual.ptr)
+
+    return x, x_grad, x_dual
 
 
 @python_scope
-def field(dtype, shape=None, name="", offset=None, needs_grad=False):
+def field(dtype,
+          shape=None,
+          name="",
+          offset=None,
+          needs_grad=False,
+          needs_dual=False):
     """Defines a Taichi field
 
     A Taichi field can be viewed as an abstract N-dimensional array, hiding away
@@ -612,6 +650,8 @@ def field(dtype, shape=None, name="", offset=None, needs_grad=False):
         offset (Union[int, tuple[int]], optional): offset of the field domain
         needs_grad (bool, optional): whether this field participates in autodiff
             and thus needs an adjoint field to store the gradients.
+        needs_dual (bool, optional): whether this field participates in
+            forward-mode autodiff and thus needs a dual field.
 
     Example:
         The code below shows how a Taichi field can be declared and defined::
@@ -640,15 +680,19 @@ def field(dtype, shape=None, name="", offset=None, needs_grad=False):
 
     del _taichi_skip_traceback
 
-    x, x_grad = create_field_member(dtype, name)
-    x, x_grad = ScalarField(x), ScalarField(x_grad)
+    x, x_grad, x_dual = create_field_member(dtype, name)
+    x, x_grad, x_dual = ScalarField(x), ScalarField(x_grad), ScalarField(
+        x_dual)
     x.set_grad(x_grad)
+    x.set_dual(x_dual)
 
     if shape is not None:
         dim = len(shape)
         root.dense(index_nd(dim), shape).place(x, offset=offset)
         if needs_grad:
             root.dense(index_nd(dim), shape).place(x_grad)
+        if needs_dual:
+            root.dense(index_nd(dim), shape).place(x_dual)
     return x
 
 
@@ -670,6 +714,28 @@ def ndarray(dtype, shape):
     return ScalarNdarray(dtype, shape)
 
 
+@python_scope
+def from_dlpack(tensor):
+    """Creates a Taichi ndarray with scalar elements that shares memory with a
+    DLPack tensor. No data is copied, neither now nor when the ndarray is passed
+    to kernels.
+
+    Only the kernels of the CPU and CUDA backends can access the memory. It
+    must be on the host for the CPU backends, and on the current device for
+    CUDA. The tensor must be contiguous, and is kept alive by the ndarray.
+
+    Args:
+        tensor: A DLPack capsule, or any object with ``__dlpack__()``, such as
+            a PyTorch tensor.
+
+    Example::
+
+        >>> t = torch.zeros(16, 8, device='cuda')
+        >>> x = ti.from_dlpack(t)  # Kernels writing to x update t.
+    """
+    return ScalarNdarray.from_dlpack(tensor)
+
+
 @taichi_scope
 def ti_print(*_vars, sep=' ', end='\n'):
     def entry2content(_var):
@@ -922,9 +988,10 @@ def default_cfg():
     return _ti_core.default_compile_config()
 
 
-def call_internal(name, *args):
+def call_internal(name, *args, outputs=()):
     return expr_init(
-        _ti_core.insert_internal_func_call(name, make_expr_group(args)))
+        _ti_core.insert_internal_func_call(name, make_expr_group(args),
+                                           make_expr_group(outputs)))
 
 
 @taichi_scope
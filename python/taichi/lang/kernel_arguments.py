@@ -1,10 +1,12 @@
 import taichi.lang
 from taichi.core.util import ti_core as _ti_core
+from taichi.lang._texture import TextureSampler
 from taichi.lang.any_array import AnyArray
 from taichi.lang.enums import Layout
 from taichi.lang.expr import Expr
+from taichi.lang.field import FieldHandleProxy, ScalarField
 from taichi.lang.util import cook_dtype
-from taichi.types.primitive_types import u64
+from taichi.types.primitive_types import f64, i64, u64
 
 
 class SparseMatrixEntry:
@@ -14,14 +16,15 @@ class SparseMatrixEntry:
         self.j = j
 
     def augassign(self, value, op):
+        # The value is passed as f64 and stored in the dtype of the builder.
         if op == 'Add':
             taichi.lang.impl.call_internal("insert_triplet", self.ptr, self.i,
                                            self.j,
-                                           taichi.lang.impl.ti_float(value))
+                                           taichi.lang.ops.cast(value, f64))
         elif op == 'Sub':
             taichi.lang.impl.call_internal("insert_triplet", self.ptr, self.i,
                                            self.j,
-                                           -taichi.lang.impl.ti_float(value))
+                                           -taichi.lang.ops.cast(value, f64))
         else:
             assert False, f"Only operations '+=' and '-=' are supported on sparse matrices."
 
@@ -47,10 +50,10 @@ def decl_sparse_matrix():
     return SparseMatrixProxy(_ti_core.make_arg_load_expr(arg_id, ptr_type))
 
 
-def decl_any_arr_arg(dtype, dim, element_shape, layout):
+def decl_any_arr_arg(dtype, dim, element_shape, layout, is_strided=False):
     dtype = cook_dtype(dtype)
     element_dim = len(element_shape)
-    arg_id = _ti_core.decl_arr_arg(dtype, dim, element_shape)
+    arg_id = _ti_core.decl_arr_arg(dtype, dim, element_shape, is_strided)
     if layout == Layout.AOS:
         element_dim = -element_dim
     return AnyArray(
@@ -58,6 +61,57 @@ def decl_any_arr_arg(dtype, dim, element_shape, layout):
         element_shape, layout)
 
 
+def get_field_handle_layout(field):
+    """Returns the layout of a field taken by a ti.field_handle() argument, or
+    None if it is taken like a template.
+
+    Returns:
+        Tuple: The key of the layout, which the kernels are compiled for, and
+            the addresses and element sizes of the members of the field.
+    """
+    is_matrix = isinstance(field, taichi.lang.matrix.MatrixField)
+    # The matrices indexed dynamically address their entries from the first.
+    if not isinstance(field, ScalarField) and (
+            not is_matrix or taichi.lang.impl.current_cfg().dynamic_index):
+        return None
+    layout = getattr(field, '_field_handle_layout', False)
+    if layout is not False:
+        return layout
+    runtime = taichi.lang.impl.get_runtime()
+    runtime.materialize()
+    snodes = [v.ptr.snode() for v in field.get_field_members()]
+    if any(snode is None for snode in snodes):
+        return None
+    layout = None
+    members = [runtime.prog.get_field_handle_layout(s) for s in snodes]
+    if all(member is not None for member in members):
+        key = (type(field).__name__, getattr(field, 'n', None),
+               getattr(field, 'm', None),
+               tuple(member[0] for member in members))
+        layout = key, [member[1:] for member in members]
+    # A field keeps its layout once materialized.
+    field._field_handle_layout = layout
+    return layout
+
+
+def get_field_handle_offsets(field, bases):
+    """Returns the offsets of the members of ``field`` from the addresses
+    ``bases``, in elements."""
+    _, members = get_field_handle_layout(field)
+    return [(addr - base) // size
+            for (addr, size), base in zip(members, bases)]
+
+
+def decl_field_handle_arg(field):
+    offsets = [decl_scalar_arg(i64) for _ in field.get_field_members()]
+    return FieldHandleProxy(field, offsets)
+
+
+def decl_texture_arg(num_dims):
+    arg_id = _ti_core.decl_texture_arg(num_dims)
+    return TextureSampler(arg_id, num_dims)
+
+
 def decl_scalar_ret(dtype):
     dtype = cook_dtype(dtype)
     return _ti_core.decl_ret(dtype)
@@ -1,29 +1,39 @@
 import ast
 import functools
 import inspect
+import operator
 import re
 import sys
 import textwrap
+import threading
 
 import numpy as np
 import taichi.lang
 from taichi.core.util import ti_core as _ti_core
-from taichi.lang import impl, util
+from taichi.lang import _frontend_cache, impl, util
 from taichi.lang.ast import (ASTTransformerContext, KernelSimplicityASTChecker,
                              transform_tree)
 from taichi.lang.enums import Layout
 from taichi.lang.exception import TaichiSyntaxError
+from taichi.lang.kernel_arguments import (get_field_handle_layout,
+                                          get_field_handle_offsets)
 from taichi.lang.shell import _shell_pop_print, oinspect
-from taichi.lang.util import to_taichi_type
-from taichi.linalg.sparse_matrix import sparse_matrix_builder
+from taichi.lang.util import cook_dtype, to_taichi_type
 from taichi.tools.util import obsolete
-from taichi.types import any_arr, primitive_types, template
+from taichi.types import (any_arr, field_handle, primitive_types, template,
+                          texture)
 
 import taichi as ti
 
 if util.has_pytorch():
     import torch
 
+# Kernels may be launched from multiple Python threads, since the launches
+# release the GIL, but the AST transformation goes through the global state of
+# the runtime (e.g. ``runtime.current_kernel``), so one kernel is materialized
+# at a time.
+_materialize_lock = threading.RLock()
+
 
 def func(fn):
     """Marks a function as callable in Taichi-scope.
@@ -162,7 +172,8 @@ class Func:
             return self.func(*args)
 
         if impl.get_runtime().experimental_real_function:
-            if impl.get_runtime().current_kernel.is_grad:
+            if impl.get_runtime(
+            ).current_kernel.autodiff_mode != _ti_core.AutodiffMode.none:
                 raise TaichiSyntaxError(
                     "Real function in gradient kernels unsupported.")
             instance_id, _ = self.mapper.lookup(args)
@@ -192,8 +203,30 @@ class Func:
         tree, ctx = _get_tree_and_ctx(self, is_kernel=False, args=args)
         self.compiled[key.instance_id] = lambda: transform_tree(tree, ctx)
         self.taichi_functions[key.instance_id] = _ti_core.create_function(key)
-        self.taichi_functions[key.instance_id].set_function_body(
-            self.compiled[key.instance_id])
+        if impl.current_cfg().lazy_compilation:
+            # The body is only generated once the calls are inlined, i.e., when
+            # the kernel is compiled, so it is only done for the functions
+            # still called after the dead branches are removed.
+            kernel = impl.get_runtime().current_kernel
+
+            def func_body():
+                runtime = impl.get_runtime()
+                old_state = runtime.inside_kernel, runtime.current_kernel
+                runtime.inside_kernel = True
+                runtime.current_kernel = kernel
+                try:
+                    transform_tree(tree, ctx)
+                finally:
+                    runtime.inside_kernel, runtime.current_kernel = old_state
+
+            ret_types = []
+            if self.return_type is not None:
+                ret_types.append(cook_dtype(self.return_type))
+            self.taichi_functions[key.instance_id].set_function_body_lazily(
+                func_body, ret_types)
+        else:
+            self.taichi_functions[key.instance_id].set_function_body(
+                self.compiled[key.instance_id])
 
     def extract_arguments(self):
         sig = inspect.signature(self.func)
@@ -249,6 +282,10 @@ class TaichiCallableTemplateMapper:
 
     @staticmethod
     def extract_arg(arg, anno):
+        if isinstance(anno, field_handle):
+            layout = get_field_handle_layout(arg)
+            if layout is not None:
+                return layout[0]
         if isinstance(anno, template):
             if isinstance(arg, taichi.lang.snode.SNode):
                 return arg.ptr
@@ -266,20 +303,22 @@ class TaichiCallableTemplateMapper:
                 anno.check_element_dim(arg, 0)
                 anno.check_element_shape(())
                 anno.check_field_dim(len(arg.shape))
-                return arg.dtype, len(arg.shape), (), Layout.AOS
+                return arg.dtype, len(
+                    arg.shape), (), Layout.AOS, arg.strides is not None
             if isinstance(arg, taichi.lang.matrix.VectorNdarray):
                 anno.check_element_dim(arg, 1)
                 anno.check_element_shape((arg.n, ))
                 anno.check_field_dim(len(arg.shape))
                 anno.check_layout(arg)
-                return arg.dtype, len(arg.shape) + 1, (arg.n, ), arg.layout
+                return arg.dtype, len(arg.shape) + 1, (
+                    arg.n, ), arg.layout, arg.strides is not None
             if isinstance(arg, taichi.lang.matrix.MatrixNdarray):
                 anno.check_element_dim(arg, 2)
                 anno.check_element_shape((arg.n, arg.m))
                 anno.check_field_dim(len(arg.shape))
                 anno.check_layout(arg)
-                return arg.dtype, len(arg.shape) + 2, (arg.n,
-                                                       arg.m), arg.layout
+                return arg.dtype, len(arg.shape) + 2, (
+                    arg.n, arg.m), arg.layout, arg.strides is not None
             # external arrays
             element_dim = 0 if anno.element_dim is None else anno.element_dim
             layout = Layout.AOS if anno.layout is None else anno.layout
@@ -292,7 +331,10 @@ class TaichiCallableTemplateMapper:
             ) if element_dim == 0 else shape[:
                                              element_dim] if layout == Layout.SOA else shape[
                                                  -element_dim:]
-            return to_taichi_type(arg.dtype), len(shape), element_shape, layout
+            return to_taichi_type(
+                arg.dtype), len(shape), element_shape, layout, False
+        if isinstance(anno, texture):
+            anno.check_texture(arg)
         return type(arg).__name__,
 
     def extract(self, args):
@@ -340,12 +382,13 @@ def _get_global_vars(_func):
 class Kernel:
     counter = 0
 
-    def __init__(self, _func, is_grad, _classkernel=False):
+    def __init__(self, _func, autodiff_mode, _classkernel=False):
         self.func = _func
         self.kernel_counter = Kernel.counter
         Kernel.counter += 1
-        self.is_grad = is_grad
+        self.autodiff_mode = autodiff_mode
         self.grad = None
+        self.forward_grad = None
         self.argument_annotations = []
         self.argument_names = []
         self.return_type = None
@@ -353,20 +396,32 @@ class Kernel:
         _taichi_skip_traceback = 1
         self.extract_arguments()
         del _taichi_skip_traceback
+        if autodiff_mode != _ti_core.AutodiffMode.none:
+            # The gradients of the fields are not as far apart as the fields.
+            self.argument_annotations = [
+                template() if isinstance(anno, field_handle) else anno
+                for anno in self.argument_annotations
+            ]
         self.template_slot_locations = []
         for i, anno in enumerate(self.argument_annotations):
             if isinstance(anno, template):
                 self.template_slot_locations.append(i)
         self.mapper = TaichiCallableTemplateMapper(
             self.argument_annotations, self.template_slot_locations)
+        # The addresses of the members of the fields taken by the
+        # ti.field_handle() arguments of each instance, which the kernel is
+        # compiled for, by the argument positions.
+        self.field_handle_bases = {}
         impl.get_runtime().kernels.append(self)
         self.reset()
         self.kernel_cpp = None
 
     def reset(self):
         self.runtime = impl.get_runtime()
-        if self.is_grad:
+        if self.autodiff_mode == _ti_core.AutodiffMode.reverse:
             self.compiled_functions = self.runtime.compiled_grad_functions
+        elif self.autodiff_mode == _ti_core.AutodiffMode.forward:
+            self.compiled_functions = self.runtime.compiled_forward_grad_functions
         else:
             self.compiled_functions = self.runtime.compiled_functions
 
@@ -406,11 +461,11 @@ class Kernel:
                     raise KernelDefError(
                         'Taichi kernels parameters must be type annotated')
             else:
-                if isinstance(annotation, (template, any_arr)):
+                if isinstance(annotation, (template, any_arr, texture)):
                     pass
                 elif id(annotation) in primitive_types.type_ids:
                     pass
-                elif isinstance(annotation, sparse_matrix_builder):
+                elif isinstance(annotation, ti.linalg.sparse_matrix_builder):
                     pass
                 else:
                     _taichi_skip_traceback = 1
@@ -424,22 +479,46 @@ class Kernel:
         _taichi_skip_traceback = 1
         if key is None:
             key = (self.func, 0)
+        with _materialize_lock:
+            self._materialize(key, args, arg_features)
+
+    def _materialize(self, key, args, arg_features):
+        _taichi_skip_traceback = 1
         self.runtime.materialize()
         if key in self.compiled_functions:
             return
         grad_suffix = ""
-        if self.is_grad:
+        if self.autodiff_mode == _ti_core.AutodiffMode.reverse:
             grad_suffix = "_grad"
+        elif self.autodiff_mode == _ti_core.AutodiffMode.forward:
+            grad_suffix = "_forward_grad"
         kernel_name = f"{self.func.__name__}_c{self.kernel_counter}_{key[1]}{grad_suffix}"
         ti.trace(f"Compiling kernel {kernel_name}...")
 
+        field_handle_bases = {}
+        for i, anno in enumerate(self.argument_annotations):
+            if args is not None and isinstance(anno, field_handle):
+                layout = get_field_handle_layout(args[i])
+                if layout is not None:
+                    field_handle_bases[i] = [addr for addr, _ in layout[1]]
+        self.field_handle_bases[key] = field_handle_bases
+
+        cache_key = _frontend_cache.get_key(self, args, arg_features)
+        if cache_key is not None:
+            taichi_kernel = _frontend_cache.load(cache_key, kernel_name)
+            if taichi_kernel is not None:
+                self.kernel_cpp = taichi_kernel
+                self.compiled_functions[key] = self.get_function_body(
+                    taichi_kernel, field_handle_bases)
+                return
+
         tree, ctx = _get_tree_and_ctx(
             self,
             args=args,
             excluded_parameters=self.template_slot_locations,
             arg_features=arg_features)
 
-        if self.is_grad:
+        if self.autodiff_mode == _ti_core.AutodiffMode.reverse:
             KernelSimplicityASTChecker(self.func).visit(tree)
 
         # Do not change the name of 'taichi_ast_generator'
@@ -461,14 +540,20 @@ class Kernel:
                 self.runtime.current_kernel = None
 
         taichi_kernel = _ti_core.create_kernel(taichi_ast_generator,
-                                               kernel_name, self.is_grad)
+                                               kernel_name,
+                                               self.autodiff_mode)
+        if cache_key is not None:
+            _frontend_cache.store(cache_key, taichi_kernel)
 
         self.kernel_cpp = taichi_kernel
 
         assert key not in self.compiled_functions
-        self.compiled_functions[key] = self.get_function_body(taichi_kernel)
+        self.compiled_functions[key] = self.get_function_body(
+            taichi_kernel, field_handle_bases)
+
+    def get_function_body(self, t_kernel, field_handle_bases):
+        launch_profiler = self.runtime.launch_profiler
 
-    def get_function_body(self, t_kernel):
         # The actual function body
         def func__(*args):
             assert len(args) == len(
@@ -495,14 +580,16 @@ class Kernel:
                     if not isinstance(v, int):
                         raise KernelArgError(i, needed.to_string(), provided)
                     launch_ctx.set_arg_int(actual_argument_slot, int(v))
-                elif isinstance(needed, sparse_matrix_builder):
+                elif isinstance(needed, ti.linalg.sparse_matrix_builder):
                     # Pass only the base pointer of the ti.linalg.sparse_matrix_builder() argument
                     launch_ctx.set_arg_int(actual_argument_slot, v.get_addr())
                 elif isinstance(needed, any_arr) and (
                         self.match_ext_arr(v)
                         or isinstance(v, taichi.lang._ndarray.Ndarray)):
                     is_ndarray = False
+                    strides = None
                     if isinstance(v, taichi.lang._ndarray.Ndarray):
+                        strides = v.strides
                         v = v.arr
                         is_ndarray = True
                     has_external_arrays = True
@@ -569,25 +656,47 @@ class Kernel:
                     for ii, s in enumerate(shape):
                         launch_ctx.set_extra_arg_int(actual_argument_slot, ii,
                                                      s)
+                    if strides is not None:
+                        for ii, s in enumerate(strides):
+                            launch_ctx.set_extra_arg_int(
+                                actual_argument_slot,
+                                len(shape) + ii, s)
+                elif isinstance(needed, texture):
+                    if not isinstance(v, taichi.lang._texture.Texture):
+                        raise KernelArgError(i, 'texture', provided)
+                    launch_ctx.set_arg_texture(
+                        actual_argument_slot,
+                        int(v.tex.device_allocation_ptr()))
                 else:
                     raise ValueError(
                         f'Argument type mismatch. Expecting {needed}, got {type(v)}.'
                     )
                 actual_argument_slot += 1
+            # The offsets of the fields taken by the ti.field_handle()
+            # arguments are in the slots after the others.
+            for i, bases in field_handle_bases.items():
+                for offset in get_field_handle_offsets(args[i], bases):
+                    launch_ctx.set_arg_int(actual_argument_slot, offset)
+                    actual_argument_slot += 1
             # Both the class kernels and the plain-function kernels are unified now.
             # In both cases, |self.grad| is another Kernel instance that computes the
             # gradient. For class kernels, args[0] is always the kernel owner.
-            if not self.is_grad and self.runtime.target_tape and not self.runtime.grad_replaced:
+            if self.autodiff_mode == _ti_core.AutodiffMode.none and self.runtime.target_tape and not self.runtime.grad_replaced:
                 self.runtime.target_tape.insert(self, args)
 
+            if launch_profiler is not None:
+                launch_profiler.mark()
             t_kernel(launch_ctx)
+            if launch_profiler is not None:
+                launch_profiler.mark()
 
             ret = None
             ret_dt = self.return_type
             has_ret = ret_dt is not None
 
-            if has_ret or (ti.current_cfg().async_mode
-                           and has_external_arrays):
+            if has_ret:
+                impl.get_runtime().sync_host_read()
+            elif ti.current_cfg().async_mode and has_external_arrays:
                 ti.sync()
 
             if has_ret:
@@ -602,6 +711,8 @@ class Kernel:
 
             return ret
 
+        # For the bound launchers, see BoundKernelLauncher.
+        func__.taichi_kernel = t_kernel
         return func__
 
     @staticmethod
@@ -611,27 +722,226 @@ class Kernel:
             has_array = isinstance(v, torch.Tensor)
         return has_array
 
+    def bind(self, *args):
+        """Returns a launcher of this kernel, see :class:`BoundKernelLauncher`."""
+        return BoundKernelLauncher(self, args)
+
     def ensure_compiled(self, *args):
-        instance_id, arg_features = self.mapper.lookup(args)
-        key = (self.func, instance_id)
-        self.materialize(key=key, args=args, arg_features=arg_features)
+        with _materialize_lock:
+            instance_id, arg_features = self.mapper.lookup(args)
+            key = (self.func, instance_id)
+            self.materialize(key=key, args=args, arg_features=arg_features)
         return key
 
     # For small kernels (< 3us), the performance can be pretty sensitive to overhead in __call__
     # Thus this part needs to be fast. (i.e. < 3us on a 4 GHz x64 CPU)
     @_shell_pop_print
     def __call__(self, *args, **kwargs):
-        if self.is_grad and impl.current_cfg().opt_level == 0:
+        if self.autodiff_mode == _ti_core.AutodiffMode.none:
+            # Inside ti.FwdMode, a primal call runs its forward-mode variant,
+            # which computes the duals alongside the primal values.
+            if self.runtime.fwd_mode_manager and not self.runtime.grad_replaced:
+                return self.forward_grad(*args, **kwargs)
+        elif impl.current_cfg().opt_level == 0:
             ti.warn(
                 """opt_level = 1 is enforced to enable gradient computation."""
             )
             impl.current_cfg().opt_level = 1
         _taichi_skip_traceback = 1
         assert len(kwargs) == 0, 'kwargs not supported for Taichi kernels'
+        launch_profiler = self.runtime.launch_profiler
+        if launch_profiler is not None and launch_profiler.begin():
+            try:
+                num_compiled = len(self.compiled_functions)
+                key = self.ensure_compiled(*args)
+                if len(self.compiled_functions) != num_compiled:
+                    launch_profiler.discard()
+                launch_profiler.mark()
+                return self.compiled_functions[key](*args)
+            finally:
+                launch_profiler.end()
         key = self.ensure_compiled(*args)
         return self.compiled_functions[key](*args)
 
 
+class BoundKernelLauncher:
+    """Launches a kernel repeatedly, with less overhead than calling it.
+
+    Returned by ``kernel.bind(*args)``, which looks up the template instance of
+    the kernel for ``args`` once. The launcher is then called with the
+    non-template arguments of the kernel only::
+
+        @ti.kernel
+        def step(x: ti.template(), t: ti.f32, v: ti.any_arr()):
+            ...
+
+        launch = step.bind(x, 0.0, v)
+        for i in range(1000):
+            launch(i * 0.01, v)
+
+    The launch context is reused across the launches: all the scalar
+    arguments are set in one native call, and an array argument is only set
+    again when a different object is passed. Hence, unlike calling the kernel:
+
+    * The argument types are not checked.
+    * An array passed again must not have been reallocated, e.g. by an
+      in-place ``resize()``.
+    * Numpy arrays must be C-contiguous, and torch tensors must be on the
+      device of the Taichi arch, since copies are not made.
+    * The launches are not recorded by ``ti.Tape``, nor sampled by the
+      launch profiler.
+    """
+    def __init__(self, kernel, args):
+        _taichi_skip_traceback = 1
+        key = kernel.ensure_compiled(*args)
+        self._kernel = kernel
+        self._t_kernel = kernel.compiled_functions[key].taichi_kernel
+        self._arch = kernel.runtime.prog.config.arch
+        # The launcher takes the arguments in the order of their slots.
+        scalar_slots = []
+        self._array_slots = []
+        bound = []
+        for i, needed in enumerate(kernel.argument_annotations):
+            if isinstance(needed, template):
+                continue
+            slot = len(bound)
+            if id(needed) in primitive_types.real_type_ids or id(
+                    needed) in primitive_types.integer_type_ids:
+                scalar_slots.append(slot)
+            elif isinstance(needed, any_arr):
+                self._array_slots.append(slot)
+            else:
+                raise KernelDefError(
+                    f'Argument {i} of type {needed} is not supported by bound launchers'
+                )
+            bound.append(args[i])
+        self._num_args = len(bound)
+        if len(scalar_slots) == 1:
+            scalar_slot = scalar_slots[0]
+            self._get_scalars = lambda args: (args[scalar_slot], )
+        elif scalar_slots:
+            self._get_scalars = operator.itemgetter(*scalar_slots)
+        else:
+            self._get_scalars = lambda args: ()
+        # The offsets of the fields taken by the ti.field_handle() arguments
+        # are fixed at binding, in the slots after the others.
+        handle_offsets = []
+        for i, bases in kernel.field_handle_bases[key].items():
+            handle_offsets += get_field_handle_offsets(args[i], bases)
+        if handle_offsets:
+            scalar_slots += range(len(bound), len(bound) + len(handle_offsets))
+            get_scalars = self._get_scalars
+            handle_offsets = tuple(handle_offsets)
+            self._get_scalars = lambda args: get_scalars(args) + handle_offsets
+        self._launcher = self._t_kernel.make_bound_launcher(scalar_slots)
+        self._arrays = [None] * len(self._array_slots)
+        for j, slot in enumerate(self._array_slots):
+            self._set_array(j, slot, bound[slot])
+
+    def _set_array(self, j, slot, v):
+        arr = v
+        is_ndarray = isinstance(v, taichi.lang._ndarray.Ndarray)
+        if is_ndarray:
+            arr = v.arr
+        if is_ndarray and not self._kernel.runtime.prog.config.ndarray_use_torch:
+            self._launcher.set_arg_external_array(
+                slot, int(arr.device_allocation_ptr()),
+                arr.element_size() * arr.nelement(), True)
+        elif isinstance(arr, np.ndarray):
+            if not arr.flags.c_contiguous:
+                raise ValueError(
+                    'Bound launchers only take C-contiguous numpy arrays')
+            self._launcher.set_arg_external_array(slot, int(arr.ctypes.data),
+                                                  arr.nbytes, False)
+        elif util.has_pytorch() and isinstance(arr, torch.Tensor):
+            on_cuda = str(arr.device).startswith('cuda')
+            if on_cuda != (self._arch == _ti_core.Arch.cuda):
+                raise ValueError(
+                    f'Bound launchers only take torch tensors on the device of {self._arch}'
+                )
+            self._launcher.set_arg_external_array(
+                slot, int(arr.data_ptr()),
+                arr.element_size() * arr.nelement(), False)
+        else:
+            raise ValueError(
+                f'Argument type mismatch. Expecting an array, got {type(v)}.')
+        for ii, s in enumerate(arr.shape):
+            self._launcher.set_extra_arg_int(slot, ii, s)
+        if is_ndarray and v.strides is not None:
+            for ii, s in enumerate(v.strides):
+                self._launcher.set_extra_arg_int(slot, len(arr.shape) + ii, s)
+        # Also keeps the array alive.
+        self._arrays[j] = v
+
+    def _set_arrays(self, args):
+        if len(args) != self._num_args:
+            raise TypeError(
+                f'{self._num_args} arguments needed but {len(args)} provided')
+        arrays = self._arrays
+        for j, slot in enumerate(self._array_slots):
+            if args[slot] is not arrays[j]:
+                self._set_array(j, slot, args[slot])
+
+    def __call__(self, *args):
+        _taichi_skip_traceback = 1
+        self._set_arrays(args)
+        self._launcher.launch(self._get_scalars(args))
+
+        ret_dt = self._kernel.return_type
+        if ret_dt is None:
+            if self._arrays and ti.current_cfg().async_mode:
+                ti.sync()
+            return None
+        impl.get_runtime().sync_host_read()
+        if id(ret_dt) in primitive_types.integer_type_ids:
+            return self._t_kernel.get_ret_int(0)
+        return self._t_kernel.get_ret_float(0)
+
+    def launch_async(self, *args):
+        """Launches like calling the launcher, without waiting for the return
+        value.
+
+        Returns:
+            :class:`KernelFuture`: The return value, copied to the host once
+            the launch is done. On CUDA, the calling thread may launch the
+            next kernels meanwhile.
+        """
+        _taichi_skip_traceback = 1
+        ret_dt = self._kernel.return_type
+        if ret_dt is None:
+            raise KernelDefError(
+                'launch_async() is only for kernels with a return value')
+        self._set_arrays(args)
+        future = self._launcher.launch_async(self._get_scalars(args))
+        return KernelFuture(future,
+                            id(ret_dt) in primitive_types.integer_type_ids)
+
+
+class KernelFuture:
+    """The return value of a kernel launched by
+    :meth:`BoundKernelLauncher.launch_async`.
+
+    Example::
+
+        >>> launch = total.bind(x)
+        >>> futures = [launch.launch_async(x) for _ in range(4)]
+        >>> print([f.result() for f in futures])
+    """
+    def __init__(self, future, is_int):
+        self._future = future
+        self._is_int = is_int
+
+    def done(self):
+        """Whether :meth:`result` would return without waiting."""
+        return self._future.done()
+
+    def result(self):
+        """Waits for the launch if needed, and returns the value."""
+        if self._is_int:
+            return self._future.get_int(0)
+        return self._future.get_float(0)
+
+
 # For a Taichi class definition like below:
 #
 # @ti.data_oriented
@@ -672,10 +982,19 @@ def _kernel_impl(_func, level_of_class_stackframe, verbose=False):
 
     if verbose:
         print(f'kernel={_func.__name__} is_classkernel={is_classkernel}')
-    primal = Kernel(_func, is_grad=False, _classkernel=is_classkernel)
-    adjoint = Kernel(_func, is_grad=True, _classkernel=is_classkernel)
+    primal = Kernel(_func,
+                    autodiff_mode=_ti_core.AutodiffMode.none,
+                    _classkernel=is_classkernel)
+    adjoint = Kernel(_func,
+                     autodiff_mode=_ti_core.AutodiffMode.reverse,
+                     _classkernel=is_classkernel)
+    forward_grad = Kernel(_func,
+                          autodiff_mode=_ti_core.AutodiffMode.forward,
+                          _classkernel=is_classkernel)
     # Having |primal| contains |grad| makes the tape work.
     primal.grad = adjoint
+    # Having |primal| contains |forward_grad| makes ti.FwdMode work.
+    primal.forward_grad = forward_grad
 
     if is_classkernel:
         # For class kernels, their primal/adjoint callables are constructed
@@ -703,6 +1022,7 @@ def _kernel_impl(_func, level_of_class_stackframe, verbose=False):
             return primal(*args, **kwargs)
 
         wrapped.grad = adjoint
+        wrapped.bind = primal.bind
 
     wrapped._is_wrapped_kernel = True
     wrapped._is_classkernel = is_classkernel
@@ -770,6 +1090,11 @@ class _BoundedDifferentiableMethod:
         _taichi_skip_traceback = 1
         return self._adjoint(self._kernel_owner, *args, **kwargs)
 
+    def bind(self, *args):
+        if self._is_staticmethod:
+            return self._primal.bind(*args)
+        return self._primal.bind(self._kernel_owner, *args)
+
 
 def data_oriented(cls):
     """Marks a class as Taichi compatible.
@@ -1,5 +1,6 @@
 from taichi.core.util import ti_core as _ti_core
-from taichi.lang.impl import expr_init
+from taichi.lang.impl import (call_internal, current_cfg, expr_init,
+                              get_runtime)
 from taichi.lang.kernel_impl import func
 
 import taichi as ti
@@ -87,6 +88,14 @@ def svd2d(A, dt):
     return U, ti.Matrix([[s1, ti.cast(0, dt)], [ti.cast(0, dt), s2]], dt=dt), V
 
 
+def _svd3d_uses_runtime():
+    # The LLVM runtime has the SVD precompiled. It is not differentiable, so
+    # the gradient kernels keep the expansion.
+    kernel = get_runtime().current_kernel
+    return _ti_core.arch_uses_llvm(current_cfg().arch) and (
+        kernel is None or kernel.autodiff_mode == _ti_core.AutodiffMode.none)
+
+
 def svd3d(A, dt, iters=None):
     """Perform singular value decomposition (A=USV^T) for 3x3 matrix.
 
@@ -108,7 +117,16 @@ def svd3d(A, dt, iters=None):
             iters = 5
         else:
             iters = 8
-    if dt == ti.f32:
+    if _svd3d_uses_runtime():
+        # A call to the runtime compiles in a fraction of the time of the
+        # thousands of statements the expansion below takes.
+        rets = [expr_init(ti.cast(0, dt)) for _ in range(21)]
+        name = 'svd3x3_f32' if dt == ti.f32 else 'svd3x3_f64'
+        call_internal(name,
+                      *[ti.cast(e, dt) for e in A.entries],
+                      ti.cast(iters, ti.i32),
+                      outputs=rets)
+    elif dt == ti.f32:
         rets = _ti_core.sifakis_svd_f32(*inputs, iters)
     else:
         rets = _ti_core.sifakis_svd_f64(*inputs, iters)
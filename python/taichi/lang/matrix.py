@@ -8,10 +8,12 @@ from taichi.lang import expr, impl
 from taichi.lang import kernel_impl as kern_mod
 from taichi.lang import ops as ops_mod
 from taichi.lang._ndarray import Ndarray, NdarrayHostAccess
+from taichi.lang._readback import FieldReadback
 from taichi.lang.common_ops import TaichiOperations
 from taichi.lang.enums import Layout
 from taichi.lang.exception import TaichiSyntaxError
-from taichi.lang.field import Field, ScalarField, SNodeHostAccess
+from taichi.lang.field import (Field, ScalarField, SNodeHostAccess,
+                               _fill_bits, _fill_dense, _is_normal_dist)
 from taichi.lang.util import (cook_dtype, in_python_scope, python_scope,
                               taichi_scope, to_numpy_type, to_pytorch_type)
 from taichi.tools.util import deprecated, warning
@@ -815,6 +817,7 @@ class Matrix(TaichiOperations):
               name="",
               offset=None,
               needs_grad=False,
+              needs_dual=False,
               layout=Layout.AOS):
         """Construct a data container to hold all elements of the Matrix.
 
@@ -826,6 +829,7 @@ class Matrix(TaichiOperations):
             name (string, optional): The custom name of the field.
             offset (Union[int, tuple of int], optional): The coordinate offset of all elements in a field.
             needs_grad (bool, optional): Whether the Matrix need gradients.
+            needs_dual (bool, optional): Whether the Matrix need duals (forward-mode autodiff).
             layout (Layout, optional): The field layout, i.e., Array Of Structure (AOS) or Structure Of Array (SOA).
 
         Returns:
@@ -854,10 +858,12 @@ class Matrix(TaichiOperations):
         else:
             for _ in range(n * m):
                 entries.append(impl.create_field_member(dtype, name=name))
-        entries, entries_grad = zip(*entries)
-        entries, entries_grad = MatrixField(entries, n, m), MatrixField(
-            entries_grad, n, m)
+        entries, entries_grad, entries_dual = zip(*entries)
+        entries, entries_grad, entries_dual = MatrixField(
+            entries, n, m), MatrixField(entries_grad, n,
+                                        m), MatrixField(entries_dual, n, m)
         entries.set_grad(entries_grad)
+        entries.set_dual(entries_dual)
 
         if shape is None:
             assert offset is None, "shape cannot be None when offset is being set"
@@ -883,12 +889,20 @@ class Matrix(TaichiOperations):
                         ti.root.dense(impl.index_nd(dim),
                                       shape).place(ScalarField(e),
                                                    offset=offset)
+                if needs_dual:
+                    for e in entries_dual.get_field_members():
+                        ti.root.dense(impl.index_nd(dim),
+                                      shape).place(ScalarField(e),
+                                                   offset=offset)
             else:
                 ti.root.dense(impl.index_nd(dim), shape).place(entries,
                                                                offset=offset)
                 if needs_grad:
                     ti.root.dense(impl.index_nd(dim),
                                   shape).place(entries_grad, offset=offset)
+                if needs_dual:
+                    ti.root.dense(impl.index_nd(dim),
+                                  shape).place(entries_dual, offset=offset)
         return entries
 
     @classmethod
@@ -1132,6 +1146,11 @@ class MatrixField(Field):
         j = 0 if len(indices) == 1 else indices[1]
         return ScalarField(self.vars[i * self.m + j])
 
+    @python_scope
+    def fill_random(self, dist='uniform'):
+        taichi.lang.meta.fill_matrix_random(self,
+                                            _is_normal_dist(self.dtype, dist))
+
     @python_scope
     def fill(self, val):
         """Fills `self` with specific values.
@@ -1157,7 +1176,16 @@ class MatrixField(Field):
             val = tuple(val_tuple)
         assert len(val) == self.n
         assert len(val[0]) == self.m
-        taichi.lang.meta.fill_matrix(self, val)
+        # One batch of memsets per distinct value.
+        members = {}
+        for i in range(self.n):
+            for j in range(self.m):
+                members.setdefault(_fill_bits(self.dtype, val[i][j]),
+                                   []).append(self.vars[i * self.m + j])
+        if any(
+                _fill_dense(_vars, bits)
+                for bits, _vars in members.items()):
+            taichi.lang.meta.fill_matrix(self, val)
 
     @python_scope
     def to_numpy(self, keep_dims=False, as_vector=None, dtype=None):
@@ -1188,9 +1216,30 @@ class MatrixField(Field):
         shape_ext = (self.n, ) if as_vector else (self.n, self.m)
         arr = np.zeros(self.shape + shape_ext, dtype=dtype)
         taichi.lang.meta.matrix_to_ext_arr(self, arr, as_vector)
-        ti.sync()
+        impl.get_runtime().sync_host_read()
         return arr
 
+    @python_scope
+    def to_numpy_async(self, keep_dims=False, dtype=None):
+        """Starts copying the field instance to a NumPy array without waiting
+        for it, see :meth:`~taichi.lang.field.Field.to_numpy_async`.
+
+        Args:
+            keep_dims (bool, optional): See :meth:`to_numpy`.
+            dtype (DataType, optional): The desired data type of the numpy array.
+
+        Returns:
+            FieldReadback: Call its ``result()`` to get the numpy array.
+        """
+        if dtype is None:
+            dtype = to_numpy_type(self.dtype)
+        as_vector = self.m == 1 and not keep_dims
+        shape_ext = (self.n, ) if as_vector else (self.n, self.m)
+        return FieldReadback(
+            self.shape + shape_ext, self.dtype, dtype,
+            lambda arr: taichi.lang.meta.matrix_to_ext_arr(
+                self, arr, as_vector))
+
     def to_torch(self, device=None, keep_dims=False):
         """Converts the field instance to a PyTorch tensor.
 
@@ -1210,7 +1259,7 @@ class MatrixField(Field):
                           dtype=to_pytorch_type(self.dtype),
                           device=device)
         taichi.lang.meta.matrix_to_ext_arr(self, arr, as_vector)
-        ti.sync()
+        impl.get_runtime().sync_host_read()
         return arr
 
     @python_scope
@@ -1343,6 +1392,8 @@ class MatrixNdarray(Ndarray):
 
     @python_scope
     def __getitem__(self, key):
+        if self._is_view_key(key):
+            return self._view(key)
         key = () if key is None else (
             key, ) if isinstance(key, numbers.Number) else tuple(key)
         return Matrix(
@@ -1408,6 +1459,8 @@ class VectorNdarray(Ndarray):
 
     @python_scope
     def __getitem__(self, key):
+        if self._is_view_key(key):
+            return self._view(key)
         key = () if key is None else (
             key, ) if isinstance(key, numbers.Number) else tuple(key)
         return Vector(
@@ -1,4 +1,5 @@
 import json
+import os
 
 import numpy as np
 from taichi.core.util import ti_core as _ti_core
@@ -294,10 +295,7 @@ class MeshInstance:
 
 
 class MeshMetadata:
-    def __init__(self, filename):
-        with open(filename, "r") as fi:
-            data = json.loads(fi.read())
-
+    def __init__(self, data):
         self.num_patches = data["num_patches"]
 
         self.element_fields = {}
@@ -331,8 +329,13 @@ class MeshMetadata:
             rel_type = MeshRelationType(
                 relation_by_orders(from_order, to_order))
             self.relation_fields[rel_type] = {}
+            # The values are patch-local indices of the to-end elements,
+            # stored in 16 bits while the patches are small enough, which
+            # halves the topology reads of the mesh-fors.
+            to_max_num = self.max_num_per_patch[MeshElementType(to_order)]
             self.relation_fields[rel_type]["value"] = impl.field(
-                dtype=ti.i32, shape=len(relation["value"]))
+                dtype=ti.u16 if to_max_num <= 65536 else ti.i32,
+                shape=len(relation["value"]))
             if from_order <= to_order:
                 self.relation_fields[rel_type]["offset"] = impl.field(
                     dtype=ti.i32, shape=len(relation["offset"]))
@@ -447,7 +450,70 @@ class Mesh:
 
     @staticmethod
     def load_meta(filename):
-        return MeshMetadata(filename)
+        """Loads the mesh metadata from a JSON file, or from a binary cache
+        written by :func:`generate_meta`.
+        """
+        if filename.endswith(".json"):
+            with open(filename, "r") as fi:
+                data = json.loads(fi.read())
+        else:
+            data = _ti_core.PatchedMesh.load(filename).as_dict()
+        return MeshMetadata(data)
+
+    @staticmethod
+    def generate_meta(topology,
+                      cells,
+                      x,
+                      relations=None,
+                      max_elements_per_patch=256,
+                      cache_file=None,
+                      num_threads=None,
+                      sfc_order=False):
+        """Builds the mesh metadata from the vertex indices of the cells.
+
+        The edges (and the faces of tet meshes) are extracted, the cells are
+        partitioned into patches and the relations and index mappings of the
+        patches are built by a parallel C++ pipeline.
+
+        Args:
+            topology (MeshTopology): the mesh topology.
+            cells (numpy.ndarray): the vertex indices of the tetrahedra (or the
+                triangles), of shape (n, 4) (or (n, 3)).
+            x (numpy.ndarray): the vertex positions, of shape (num_verts, 3).
+            relations (List[MeshRelationType]): the relations to build, all of
+                them by default.
+            max_elements_per_patch (int): the maximum number of cells (or
+                triangles) per patch.
+            cache_file (str): if given, the metadata is loaded from this binary
+                file if it exists, and saved into it otherwise. It must end
+                with ``.tcb``, or ``.tcb.zip`` to compress it.
+            num_threads (int): the number of threads, all CPUs by default.
+            sfc_order (bool): whether to order the patches, and the elements
+                owned by each patch, along the Morton curve through the
+                element centroids rather than in the order of ``cells``, so
+                that the elements close in space are close in memory.
+                Regenerating the metadata from the current positions restores
+                the locality of a deforming mesh.
+        """
+        if cache_file is not None and os.path.exists(cache_file):
+            return Mesh.load_meta(cache_file)
+        top_order = 3 if topology == MeshTopology.Tetrahedron else 2
+        if relations is None:
+            relations = [
+                MeshRelationType(relation_by_orders(i, j))
+                for i in range(top_order + 1) for j in range(top_order + 1)
+            ]
+        x = np.asarray(x, dtype=np.float32).reshape(-1, 3)
+        patched = _ti_core.patch_mesh(topology, x.shape[0],
+                                      np.asarray(cells, dtype=np.int32),
+                                      relations, max_elements_per_patch,
+                                      num_threads or os.cpu_count() or 1,
+                                      x if sfc_order else np.zeros(
+                                          0, dtype=np.float32))
+        patched.set_x(x)
+        if cache_file is not None:
+            patched.save(cache_file)
+        return MeshMetadata(patched.as_dict())
 
 
 def TriMesh():
@@ -1,8 +1,12 @@
+import functools
+import math
+
 from taichi.core import get_os_name
+from taichi.core.util import ti_core as _ti_core
 from taichi.lang import impl
 from taichi.lang.expr import Expr
 from taichi.lang.field import ScalarField
-from taichi.lang.kernel_impl import kernel
+from taichi.lang.kernel_impl import func, kernel
 from taichi.types.annotations import any_arr, ext_arr, template
 
 import taichi as ti
@@ -16,6 +20,55 @@ def fill_tensor(tensor: template(), val: template()):
         tensor[I] = val
 
 
+def _counter_based_random(dtype):
+    # Keyed by the loop index instead of a per-thread state, see
+    # CompileConfig::counter_based_rand.
+    return impl.expr_init(Expr(_ti_core.make_rand_expr(dtype, True)))
+
+
+@func
+def _random_pair(dtype: template(), normal: template()):
+    u1 = _counter_based_random(dtype)
+    u2 = _counter_based_random(dtype)
+    v = ti.Vector([u1, u2])
+    if ti.static(normal):
+        # Box-Muller, using both outputs. 1 - u1 is in (0, 1].
+        r = ti.sqrt(-2 * ti.log(1 - u1))
+        v = ti.Vector(
+            [r * ti.cos(math.tau * u2), r * ti.sin(math.tau * u2)])
+    return v
+
+
+@kernel
+def fill_tensor_random(tensor: template(), normal: template()):
+    # A range-for over pairs of elements, which (unlike a struct-for) the CPU
+    # backend vectorizes.
+    shape = ti.static(tensor.shape)
+    n = ti.static(functools.reduce(lambda x, y: x * y, shape, 1))
+    for k in range((n + 1) // 2):
+        v = _random_pair(tensor.dtype, normal)
+        for h in ti.static(range(2)):
+            l = k * 2 + h
+            if ti.static(len(shape) == 0):
+                if ti.static(h == 0):
+                    tensor[None] = v[h]
+            elif l < n:
+                I = ti.Vector([0] * len(shape))
+                for d in ti.static(reversed(range(len(shape)))):
+                    I[d] = l % shape[d]
+                    l //= shape[d]
+                tensor[I] = v[h]
+
+
+@kernel
+def fill_matrix_random(mat: template(), normal: template()):
+    for I in ti.grouped(mat):
+        for p in ti.static(range(0, mat.n * mat.m, 2)):
+            v = _random_pair(mat.dtype, normal)
+            for h in ti.static(range(min(2, mat.n * mat.m - p))):
+                mat[I][(p + h) // mat.m, (p + h) % mat.m] = v[h]
+
+
 @kernel
 def fill_ndarray(ndarray: any_arr(), val: template()):
     for I in ti.grouped(ndarray):
@@ -52,6 +105,24 @@ def ndarray_matrix_to_ext_arr(ndarray: any_arr(), arr: ext_arr(),
                     arr[I, p, q] = ndarray[I][p, q]
 
 
+@kernel
+def tensor_gather_to_ext_arr(tensor: template(), indices: ext_arr(),
+                             arr: ext_arr()):
+    dim = ti.static(len(tensor.shape))
+    for n in range(indices.shape[0]):
+        I = ti.Vector([indices[n, k] for k in ti.static(range(dim))])
+        arr[n] = tensor[I]
+
+
+@kernel
+def ext_arr_scatter_to_tensor(indices: ext_arr(), arr: ext_arr(),
+                              tensor: template()):
+    dim = ti.static(len(tensor.shape))
+    for n in range(indices.shape[0]):
+        I = ti.Vector([indices[n, k] for k in ti.static(range(dim))])
+        tensor[I] = arr[n]
+
+
 @kernel
 def vector_to_fast_image(img: template(), out: ext_arr()):
     # FIXME: Why is ``for i, j in img:`` slower than:
@@ -187,3 +258,33 @@ def snode_deactivate(b: template()):
 def snode_deactivate_dynamic(b: template()):
     for I in ti.grouped(b.parent()):
         ti.deactivate(b, I)
+
+
+@func
+def count_active_cells(b: template(), base, cell_shape: template()):
+    count = 0
+    for J in ti.grouped(ti.ndrange(*cell_shape)):
+        count += ti.is_active(b, base + J)
+    return count
+
+
+@kernel
+def snode_occupancy(b: template(), cell_shape: template(),
+                    strides: template(), hist: ext_arr()):
+    # Bins the nodes of |b|, one per cell of its parent, by the fraction of
+    # their cells that are active. The index of the first cell of a node is
+    # the index of its parent cell times |strides|.
+    num_bins = hist.shape[0]
+    num_cells = ti.static(functools.reduce(lambda x, y: x * y, cell_shape))
+    if ti.static(len(strides) == 0):
+        for _ in range(1):
+            count = count_active_cells(b, ti.Vector([0] * len(cell_shape)),
+                                       cell_shape)
+            hist[min(count * num_bins // num_cells, num_bins - 1)] += 1
+    else:
+        for I in ti.grouped(b.parent()):
+            base = ti.Vector([0] * len(cell_shape))
+            for k in ti.static(range(len(strides))):
+                base[k] = I[k] * strides[k]
+            count = count_active_cells(b, base, cell_shape)
+            hist[min(count * num_bins // num_cells, num_bins - 1)] += 1
@@ -11,6 +11,7 @@ from taichi.lang.expr import Expr, make_expr_group
 from taichi.lang.field import Field
 from taichi.lang.snode import SNode
 from taichi.lang.util import cook_dtype, is_taichi_class, taichi_scope
+from taichi.types.primitive_types import f16, f32, i32
 
 unary_ops = []
 
@@ -955,3 +956,41 @@ def get_addr(f, indices):
 
     """
     return Expr(_ti_core.expr_get_addr(f.snode.ptr, make_expr_group(indices)))
+
+
+@taichi_scope
+def warp_mma_16x16x16(c, a, b, c_indices, a_indices, b_indices):
+    """Accumulate the product of two 16x16 f16 blocks into a 16x16 f32 block
+    on the tensor cores (CUDA only, compute capability 7.0 or higher).
+
+    For ``0 <= i, j < 16``, adds ``sum(a[ai + i, aj + k] * b[bi + k, bj + j]
+    for k in range(16))`` to ``c[ci + i, cj + j]``. The product is computed by
+    a warp together: the 32 threads of a warp must call this function at the
+    same point with the same arguments, e.g. from
+    ``for w, lane in ti.ndrange(n, 32)`` with the blocks picked by ``w``.
+
+    Args:
+        c (ti.field): A 2D f32 field.
+        a (ti.field): A 2D f16 field.
+        b (ti.field): A 2D f16 field.
+        c_indices, a_indices, b_indices (Union[list, ti.Vector()]): The first
+            elements of the blocks, whose indices are multiples of 16.
+
+    The fields are placed by a dense SNode row by row, as
+    ``ti.field(dtype, shape=(m, n))`` does, with ``m`` and ``n`` multiples of
+    16.
+    """
+    if impl.current_cfg().arch != _ti_core.Arch.cuda:
+        raise TaichiSyntaxError('ti.warp_mma_16x16x16 needs the CUDA backend')
+    for f, dt in ((c, f32), (a, f16), (b, f16)):
+        if not isinstance(f, Field) or f.dtype != dt or len(f.shape) != 2:
+            raise TaichiSyntaxError(
+                f'ti.warp_mma_16x16x16 takes 2D {dt} fields')
+
+    def block(f, indices, dt_bytes):
+        # The leading dimension includes the padding of the rows.
+        ld = (get_addr(f, [1, 0]) - get_addr(f, [0, 0])) // dt_bytes
+        return get_addr(f, indices), cast(ld, i32)
+
+    impl.call_internal('warp_mma_m16n16k16_f16_f32', *block(c, c_indices, 4),
+                       *block(a, a_indices, 2), *block(b, b_indices, 2))
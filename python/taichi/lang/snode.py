@@ -1,5 +1,7 @@
 import numbers
 
+import numpy as np
+
 # The reason we import just the taichi.core.util module, instead of the ti_core
 # object within it, is that ti_core is stateful. While in practice ti_core is
 # loaded during the import procedure, it's probably still good to delay the
@@ -25,21 +27,31 @@ class SNode:
     def __init__(self, ptr):
         self.ptr = ptr
 
-    def dense(self, axes, dimensions):
+    def dense(self, axes, dimensions, morton=False):
         """Adds a dense SNode as a child component of `self`.
 
         Args:
             axes (List[Axis]): Axes to activate.
             dimensions (Union[List[int], int]): Shape of each axis.
+            morton (bool): Whether to lay the cells out in Morton (Z-) order,
+                so that the neighbours of a cell along all the axes stay close
+                in memory, e.g. for the stencils in 3D. The cells are also
+                iterated in this order. Only supported by the CPU and CUDA
+                backends, and with power-of-two shapes in packed mode.
 
         Returns:
             The added :class:`~taichi.lang.SNode` instance.
         """
         if isinstance(dimensions, int):
             dimensions = [dimensions] * len(axes)
-        return SNode(
-            self.ptr.dense(axes, dimensions,
-                           impl.current_cfg().packed))
+        ptr = self.ptr.dense(axes, dimensions, impl.current_cfg().packed)
+        if morton:
+            if not _ti_core.arch_uses_llvm(impl.current_cfg().arch):
+                raise RuntimeError(
+                    'The Morton layout is only supported by the CPU and CUDA '
+                    'backends')
+            ptr.morton(True)
+        return SNode(ptr)
 
     def pointer(self, axes, dimensions):
         """Adds a pointer SNode as a child component of `self`.
@@ -57,23 +69,39 @@ class SNode:
             self.ptr.pointer(axes, dimensions,
                              impl.current_cfg().packed))
 
-    @staticmethod
-    def hash(axes, dimensions):
-        # original code is #def hash(self,axes, dimensions) without #@staticmethod   before fix pylint R0201
-        """Not supported."""
-        raise RuntimeError('hash not yet supported')
-        # if isinstance(dimensions, int):
-        #     dimensions = [dimensions] * len(axes)
-        # return SNode(self.ptr.hash(axes, dimensions,
-        #                            impl.current_cfg().packed))
-
-    def dynamic(self, axis, dimension, chunk_size=None):
+    def hash(self, axes, dimensions, capacity):
+        """Adds a hash SNode as a child component of `self`.
+
+        Unlike a pointer SNode, whose size grows with its shape, a hash SNode
+        only takes up memory for `capacity` cells, which makes it suitable
+        for huge and sparsely populated index spaces. Only supported on the
+        LLVM-based backends.
+
+        Args:
+            axes (List[Axis]): Axes to activate.
+            dimensions (Union[List[int], int]): Shape of each axis.
+            capacity (int): Maximum number of active cells in each container.
+
+        Returns:
+            The added :class:`~taichi.lang.SNode` instance.
+        """
+        if isinstance(dimensions, int):
+            dimensions = [dimensions] * len(axes)
+        return SNode(
+            self.ptr.hash(axes, dimensions, capacity,
+                          impl.current_cfg().packed))
+
+    def dynamic(self, axis, dimension, chunk_size=None, chunk_table=False):
         """Adds a dynamic SNode as a child component of `self`.
 
         Args:
             axis (List[Axis]): Axis to activate, must be 1.
             dimension (int): Shape of the axis.
             chunk_size (int): Chunk size.
+            chunk_table (bool): Whether each node keeps a table of its chunks,
+                which makes accessing an element O(1) instead of linear in the
+                number of chunks before it, at the cost of one pointer per
+                chunk in every node. Only affects the LLVM backends.
 
         Returns:
             The added :class:`~taichi.lang.SNode` instance.
@@ -83,7 +111,7 @@ class SNode:
             chunk_size = dimension
         return SNode(
             self.ptr.dynamic(axis[0], dimension, chunk_size,
-                             impl.current_cfg().packed))
+                             impl.current_cfg().packed, chunk_table))
 
     def bitmasked(self, axes, dimensions):
         """Adds a bitmasked SNode as a child component of `self`.
@@ -273,6 +301,55 @@ class SNode:
         runtime.materialize()
         return runtime.prog.get_snode_num_dynamically_allocated(self.ptr)
 
+    def memory_stats(self, num_bins=10):
+        """Gets the memory usage of the dynamically allocated nodes of `self`.
+
+        Only available on the LLVM backends.
+
+        Args:
+            num_bins (int): The number of bins of the occupancy histogram.
+
+        Returns:
+            Dict[str, Union[int, float, List[int]]]: The size of a node
+            ('element_size'), the chunks of nodes allocated ('num_chunks',
+            'elements_per_chunk', 'allocated_bytes'), the nodes ever
+            allocated, live, free for reuse and recycled since the last gc
+            ('num_reserved', 'num_live', 'num_free', 'num_recycled'), the
+            fraction of the allocated bytes not holding live nodes
+            ('fragmentation'), and for pointer, bitmasked and dynamic SNodes,
+            the number of nodes of `self`, one per cell of its parent, in each
+            of `num_bins` equal ranges of the fraction of their cells that are
+            active ('occupancy'). The last bin includes the full nodes.
+        """
+        runtime = impl.get_runtime()
+        runtime.materialize()
+        stats = runtime.prog.get_snode_memory_stats(self.ptr)
+        result = {
+            name: getattr(stats, name)
+            for name in [
+                'element_size', 'elements_per_chunk', 'num_chunks',
+                'num_reserved', 'num_free', 'num_recycled', 'num_live',
+                'allocated_bytes', 'fragmentation'
+            ]
+        }
+        SNodeType = _ti_core.SNodeType
+        if self.ptr.type in (SNodeType.pointer, SNodeType.bitmasked,
+                             SNodeType.dynamic):
+            # The hash SNodes are left out, since their nodes have far more
+            # cells than they can hold.
+            parent_shape = self.parent().shape
+            cell_shape = tuple(
+                n // parent_shape[i] if i < len(parent_shape) else n
+                for i, n in enumerate(self.shape))
+            strides = cell_shape[:len(parent_shape)]
+            if not impl.current_cfg().packed:
+                # The shapes are padded to powers of two.
+                strides = tuple(1 << (n - 1).bit_length() for n in strides)
+            hist = np.zeros(num_bins, dtype=np.int32)
+            taichi.lang.meta.snode_occupancy(self, cell_shape, strides, hist)
+            result['occupancy'] = hist.tolist()
+        return result
+
     @property
     def cell_size_bytes(self):
         runtime = impl.get_runtime()
@@ -285,7 +362,8 @@ class SNode:
         for c in ch:
             c.deactivate_all()
         SNodeType = _ti_core.SNodeType
-        if self.ptr.type == SNodeType.pointer or self.ptr.type == SNodeType.bitmasked:
+        if self.ptr.type in (SNodeType.pointer, SNodeType.hash,
+                             SNodeType.bitmasked):
             taichi.lang.meta.snode_deactivate(self)
         if self.ptr.type == SNodeType.dynamic:
             # Note that dynamic nodes are different from other sparse nodes:
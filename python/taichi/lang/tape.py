@@ -23,6 +23,15 @@ class TapeImpl:
     def grad(self):
         assert self.entered, "Before evaluating gradients tape must be entered."
         assert not self.gradient_evaluated, "Gradients of grad can be evaluated only once."
-        for func, args in reversed(self.calls):
-            func.grad(*args)
+        # In async mode, the adjoint kernels are optimized as one state flow
+        # graph, where they are fused, their dead stores (e.g. to gradients
+        # zeroed again later) eliminated and the independent ones run
+        # concurrently, instead of in batches of async_flush_every tasks.
+        prog = self.runtime.prog
+        prog.async_begin_batch()
+        try:
+            for func, args in reversed(self.calls):
+                func.grad(*args)
+        finally:
+            prog.async_end_batch()
         self.gradient_evaluated = True
@@ -1,5 +1,7 @@
 import functools
 import os
+import sys
+from contextlib import contextmanager
 
 import numpy as np
 from taichi.core.util import ti_core as _ti_core
@@ -89,6 +91,9 @@ def to_numpy_type(dt):
         return np.uint64
     if dt == ti.f16:
         return np.half
+    if dt == ti.bf16:
+        # numpy has no bfloat16, the values are widened to float32.
+        return np.float32
     assert False
 
 
@@ -119,6 +124,8 @@ def to_pytorch_type(dt):
         return torch.uint8
     if dt == ti.f16:
         return torch.float16
+    if dt == ti.bf16:
+        return torch.bfloat16
     if dt in (ti.u16, ti.u32, ti.u64):
         raise RuntimeError(
             f'PyTorch doesn\'t support {dt.to_string()} data type.')
@@ -179,6 +186,8 @@ def to_taichi_type(dt):
             return ti.u8
         if dt == torch.float16:
             return ti.f16
+        if dt == torch.bfloat16:
+            return ti.bf16
         if dt in (ti.u16, ti.u32, ti.u64):
             raise RuntimeError(
                 f'PyTorch doesn\'t support {dt.to_string()} data type.')
@@ -227,3 +236,30 @@ def python_scope(func):
         return func(*args, **kwargs)
 
     return wrapped
+
+
+_taichi_package_dir = os.path.dirname(
+    os.path.dirname(os.path.abspath(__file__)))
+
+
+@contextmanager
+def device_memory_callsite():
+    """Tags the device allocations made in its scope with the innermost line
+    of the user code on the stack, if ``ti.init(track_device_memory=True)``.
+    """
+    if not _ti_core.device_memory_tracker_enabled():
+        yield
+        return
+    frame = sys._getframe(1)
+    while frame is not None and (
+            frame.f_code.co_filename.startswith(_taichi_package_dir)
+            or frame.f_code.co_filename.endswith('contextlib.py')):
+        frame = frame.f_back
+    callsite = ''
+    if frame is not None:
+        callsite = f'{frame.f_code.co_filename}:{frame.f_lineno}'
+    _ti_core.push_device_memory_callsite(callsite)
+    try:
+        yield
+    finally:
+        _ti_core.pop_device_memory_callsite()
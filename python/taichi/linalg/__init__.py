@@ -1,3 +1,6 @@
+from taichi.linalg.matrixfree_solver import (CG, BiCGSTAB,
+                                             JacobiPreconditioner,
+                                             LinearOperator)
 from taichi.linalg.sparse_matrix import (SparseMatrix, SparseMatrixBuilder,
                                          sparse_matrix_builder)
 from taichi.linalg.sparse_solver import SparseSolver
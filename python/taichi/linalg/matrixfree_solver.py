@@ -0,0 +1,304 @@
+from taichi.lang.impl import field
+from taichi.lang.kernel_impl import kernel
+from taichi.types.annotations import template
+
+import taichi as ti
+
+
+class LinearOperator:
+    """A linear operator given by a kernel instead of a stored matrix.
+
+    Args:
+        matvec (Callable): a kernel ``matvec(x: ti.template(), Ax: ti.template())``
+            that writes the product of the operator and ``x`` into ``Ax``.
+            ``x`` and ``Ax`` are scalar fields of the same shape.
+    """
+    def __init__(self, matvec):
+        self._matvec = matvec
+
+    def matvec(self, x, Ax):
+        self._matvec(x, Ax)
+
+
+@kernel
+def _jacobi(diag: template(), r: template(), z: template()):
+    for I in ti.grouped(r):
+        z[I] = r[I] / diag[I]
+
+
+class JacobiPreconditioner(LinearOperator):
+    """The inverse of the diagonal of a matrix.
+
+    Args:
+        diag (Field): the diagonal of the matrix, in the shape of the vectors.
+    """
+    def __init__(self, diag):
+        super().__init__(lambda r, z: _jacobi(diag, r, z))
+
+
+@kernel
+def _copy(src: template(), dst: template()):
+    for I in ti.grouped(src):
+        dst[I] = src[I]
+
+
+@kernel
+def _dot(x: template(), y: template(), res: template()):
+    res[None] = 0
+    for I in ti.grouped(x):
+        res[None] += x[I] * y[I]
+
+
+@kernel
+def _init_residual(b: template(), Ax: template(), r: template(),
+                   rr: template(), bb: template()):
+    rr[None] = 0
+    bb[None] = 0
+    for I in ti.grouped(b):
+        r[I] = b[I] - Ax[I]
+        rr[None] += r[I] * r[I]
+        bb[None] += b[I] * b[I]
+
+
+@kernel
+def _cg_update_x_r(x: template(), r: template(), p: template(),
+                   Ap: template(), rz: template(), pAp: template(),
+                   rr: template()):
+    rr[None] = 0
+    for I in ti.grouped(x):
+        alpha = rz[None] / pAp[None]
+        x[I] += alpha * p[I]
+        r[I] -= alpha * Ap[I]
+        rr[None] += r[I] * r[I]
+
+
+@kernel
+def _cg_update_p(p: template(), z: template(), rz: template(),
+                 rz_new: template()):
+    for I in ti.grouped(p):
+        p[I] = z[I] + rz_new[None] / rz[None] * p[I]
+    rz[None] = rz_new[None]
+
+
+@kernel
+def _bicgstab_init(p: template(), v: template(), rho: template(),
+                   alpha: template(), omega: template()):
+    rho[None] = 1
+    alpha[None] = 1
+    omega[None] = 1
+    for I in ti.grouped(p):
+        p[I] = 0
+        v[I] = 0
+
+
+@kernel
+def _bicgstab_update_p(p: template(), r: template(), v: template(),
+                       rho: template(), rho_new: template(),
+                       alpha: template(), omega: template()):
+    for I in ti.grouped(p):
+        beta = rho_new[None] / rho[None] * alpha[None] / omega[None]
+        p[I] = r[I] + beta * (p[I] - omega[None] * v[I])
+    rho[None] = rho_new[None]
+
+
+@kernel
+def _bicgstab_update_s(r: template(), v: template(), s: template(),
+                       rho: template(), r_hat_v: template(),
+                       alpha: template(), ss: template()):
+    alpha[None] = rho[None] / r_hat_v[None]
+    ss[None] = 0
+    for I in ti.grouped(s):
+        s[I] = r[I] - alpha[None] * v[I]
+        ss[None] += s[I] * s[I]
+
+
+@kernel
+def _bicgstab_early_exit(x: template(), p_hat: template(), alpha: template()):
+    for I in ti.grouped(x):
+        x[I] += alpha[None] * p_hat[I]
+
+
+@kernel
+def _bicgstab_dot_t(t: template(), s: template(), ts: template(),
+                    tt: template()):
+    ts[None] = 0
+    tt[None] = 0
+    for I in ti.grouped(t):
+        ts[None] += t[I] * s[I]
+        tt[None] += t[I] * t[I]
+
+
+@kernel
+def _bicgstab_update_x_r(x: template(), r: template(), p_hat: template(),
+                         s_hat: template(), s: template(), t: template(),
+                         alpha: template(), omega: template(),
+                         ts: template(), tt: template(), rr: template()):
+    omega[None] = ts[None] / tt[None]
+    rr[None] = 0
+    for I in ti.grouped(x):
+        x[I] += alpha[None] * p_hat[I] + omega[None] * s_hat[I]
+        r[I] = s[I] - omega[None] * t[I]
+        rr[None] += r[I] * r[I]
+
+
+class _MatrixFreeSolver:
+    _vectors = ()
+    _scalars = ()
+
+    def __init__(self, A, tol=1e-6, max_iterations=0, M=None):
+        self.A = A
+        self.M = M
+        self.tol = tol
+        self.max_iterations = max_iterations
+        self.num_iterations = 0
+        self._workspace_key = None
+
+    def _allocate(self, b):
+        # The work vectors are reused as long as the shape and the data type
+        # of the right-hand side stay the same, so the kernels are compiled
+        # only once.
+        key = (b.shape, b.dtype)
+        if self._workspace_key == key:
+            return
+        self._workspace_key = key
+        for name in self._vectors:
+            setattr(self, name, field(b.dtype, shape=b.shape))
+        for name in self._scalars:
+            setattr(self, name, field(b.dtype, shape=()))
+
+    def _max_iterations(self, b):
+        if self.max_iterations > 0:
+            return self.max_iterations
+        n = 1
+        for dim in b.shape:
+            n *= dim
+        return n
+
+
+class CG(_MatrixFreeSolver):
+    """Conjugate gradient solver of symmetric positive definite systems.
+
+    The operator and the optional preconditioner are applied by kernels, and
+    the vectors stay in Taichi fields. Only the squared residual norm is read
+    back per iteration.
+
+    Args:
+        A (LinearOperator): the symmetric positive definite operator.
+        tol (float): the tolerance on the residual norm relative to the norm
+            of the right-hand side.
+        max_iterations (int): the maximum number of iterations, 0 for as many
+            as there are unknowns.
+        M (LinearOperator): an optional symmetric positive definite
+            preconditioner applying the inverse of an approximation of A,
+            e.g. :class:`JacobiPreconditioner`.
+    """
+    _vectors = ('r', 'p', 'Ap', 'z')
+    _scalars = ('rr', 'bb', 'rz', 'rz_new', 'pAp')
+
+    def solve(self, b, x):
+        """Solves A x = b, starting from the initial guess in ``x``.
+
+        Args:
+            b (Field): the right-hand side.
+            x (Field): the initial guess, overwritten by the solution.
+
+        Returns:
+            bool: True if the solver converged, False otherwise.
+        """
+        self._allocate(b)
+        self.A.matvec(x, self.Ap)
+        _init_residual(b, self.Ap, self.r, self.rr, self.bb)
+        z, rz_new = self.r, self.rr
+        if self.M is not None:
+            z, rz_new = self.z, self.rz_new
+            self.M.matvec(self.r, z)
+        _dot(self.r, z, self.rz)
+        _copy(z, self.p)
+
+        threshold = self.tol * self.tol * self.bb[None]
+        self.num_iterations = 0
+        if self.rr[None] <= threshold:
+            return True
+        for _ in range(self._max_iterations(b)):
+            self.A.matvec(self.p, self.Ap)
+            _dot(self.p, self.Ap, self.pAp)
+            _cg_update_x_r(x, self.r, self.p, self.Ap, self.rz, self.pAp,
+                           self.rr)
+            self.num_iterations += 1
+            if self.rr[None] <= threshold:
+                return True
+            if self.M is not None:
+                self.M.matvec(self.r, z)
+                _dot(self.r, z, rz_new)
+            _cg_update_p(self.p, z, self.rz, rz_new)
+        return False
+
+
+class BiCGSTAB(_MatrixFreeSolver):
+    """Stabilized biconjugate gradient solver of general square systems.
+
+    The operator and the optional preconditioner are applied by kernels, and
+    the vectors stay in Taichi fields. Only the squared residual norms are
+    read back per iteration.
+
+    Args:
+        A (LinearOperator): the operator.
+        tol (float): the tolerance on the residual norm relative to the norm
+            of the right-hand side.
+        max_iterations (int): the maximum number of iterations, 0 for as many
+            as there are unknowns.
+        M (LinearOperator): an optional right preconditioner applying the
+            inverse of an approximation of A, e.g.
+            :class:`JacobiPreconditioner`.
+    """
+    _vectors = ('r', 'r_hat', 'p', 'v', 's', 't', 'p_hat', 's_hat')
+    _scalars = ('rr', 'bb', 'rho', 'rho_new', 'alpha', 'omega', 'r_hat_v',
+                'ss', 'ts', 'tt')
+
+    def solve(self, b, x):
+        """Solves A x = b, starting from the initial guess in ``x``.
+
+        Args:
+            b (Field): the right-hand side.
+            x (Field): the initial guess, overwritten by the solution.
+
+        Returns:
+            bool: True if the solver converged, False otherwise.
+        """
+        self._allocate(b)
+        self.A.matvec(x, self.t)
+        _init_residual(b, self.t, self.r, self.rr, self.bb)
+        _copy(self.r, self.r_hat)
+        _bicgstab_init(self.p, self.v, self.rho, self.alpha, self.omega)
+        p_hat, s_hat = self.p, self.s
+        if self.M is not None:
+            p_hat, s_hat = self.p_hat, self.s_hat
+
+        threshold = self.tol * self.tol * self.bb[None]
+        self.num_iterations = 0
+        if self.rr[None] <= threshold:
+            return True
+        for _ in range(self._max_iterations(b)):
+            _dot(self.r_hat, self.r, self.rho_new)
+            _bicgstab_update_p(self.p, self.r, self.v, self.rho, self.rho_new,
+                               self.alpha, self.omega)
+            if self.M is not None:
+                self.M.matvec(self.p, p_hat)
+            self.A.matvec(p_hat, self.v)
+            _dot(self.r_hat, self.v, self.r_hat_v)
+            _bicgstab_update_s(self.r, self.v, self.s, self.rho,
+                               self.r_hat_v, self.alpha, self.ss)
+            self.num_iterations += 1
+            if self.ss[None] <= threshold:
+                _bicgstab_early_exit(x, p_hat, self.alpha)
+                return True
+            if self.M is not None:
+                self.M.matvec(self.s, s_hat)
+            self.A.matvec(s_hat, self.t)
+            _bicgstab_dot_t(self.t, self.s, self.ts, self.tt)
+            _bicgstab_update_x_r(x, self.r, p_hat, s_hat, self.s, self.t,
+                                 self.alpha, self.omega, self.ts, self.tt,
+                                 self.rr)
+            if self.rr[None] <= threshold:
+                return True
+        return False
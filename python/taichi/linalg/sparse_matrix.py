@@ -1,6 +1,8 @@
 import numpy as np
+import taichi.lang
 from taichi.core.util import ti_core as _ti_core
 from taichi.lang.field import Field
+from taichi.lang.util import cook_dtype
 from taichi.types.primitive_types import f32
 
 
@@ -13,12 +15,14 @@ class SparseMatrix:
         n (int): the first dimension of a sparse matrix.
         m (int): the second dimension of a sparse matrix.
         sm (SparseMatrix): another sparse matrix that will be built from.
+        dtype (DataType): the data type of the elements, ti.f32 or ti.f64.
     """
     def __init__(self, n=None, m=None, sm=None, dtype=f32):
         if sm is None:
             self.n = n
             self.m = m if m else n
-            self.matrix = _ti_core.create_sparse_matrix(n, m)
+            self.matrix = _ti_core.create_sparse_matrix(n, self.m,
+                                                        cook_dtype(dtype))
         else:
             self.n = sm.num_rows()
             self.m = sm.num_cols()
@@ -130,6 +134,8 @@ class SparseMatrixBuilder:
         num_rows (int): the first dimension of a sparse matrix.
         num_cols (int): the second dimension of a sparse matrix.
         max_num_triplets (int): the maximum number of triplets.
+        dtype (DataType): the data type of the elements, ti.f32 or ti.f64.
+            Only ti.f32 is supported on CUDA for now.
     """
     def __init__(self,
                  num_rows=None,
@@ -138,9 +144,10 @@ class SparseMatrixBuilder:
                  dtype=f32):
         self.num_rows = num_rows
         self.num_cols = num_cols if num_cols else num_rows
+        self.dtype = cook_dtype(dtype)
         if num_rows is not None:
             self.ptr = _ti_core.create_sparse_matrix_builder(
-                num_rows, num_cols, max_num_triplets)
+                num_rows, num_cols, max_num_triplets, self.dtype)
 
     def get_addr(self):
         """Get the address of the sparse matrix"""
@@ -151,10 +158,33 @@ class SparseMatrixBuilder:
         self.ptr.print_triplets()
 
     def build(self, dtype=f32, _format='CSR'):
-        """Create a sparse matrix using the triplets"""
-        sm = self.ptr.build()
+        """Create a sparse matrix using the triplets
+
+        The elements of the matrix are of the dtype of the builder.
+        On CUDA, the matrix is built on and stays in the device memory.
+        """
+        taichi_arch = taichi.lang.impl.get_runtime().prog.config.arch
+        if taichi_arch == _ti_core.Arch.cuda:
+            sm = self.ptr.build_cuda()
+        else:
+            sm = self.ptr.build()
         return SparseMatrix(sm=sm)
 
+    def rebuild(self, sparse_matrix):
+        """Refill a sparse matrix built before with the triplets
+
+        When the triplets fit in the sparsity pattern of the matrix, the
+        values are updated in place and ``SparseSolver`` skips the symbolic
+        analysis of the matrix on the next factorization. Entries of the
+        pattern without triplets are kept as zeros.
+
+        Args:
+            sparse_matrix (SparseMatrix): the matrix to refill, of the same
+                shape and dtype as the builder.
+        """
+        self.ptr.rebuild(sparse_matrix.matrix)
+        return sparse_matrix
+
 
 sparse_matrix_builder = SparseMatrixBuilder
 # Alias for :class:`SparseMatrixBuilder`
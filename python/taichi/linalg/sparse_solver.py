@@ -1,6 +1,7 @@
 import numpy as np
 import taichi.lang
 from taichi.core.util import ti_core as _ti_core
+from taichi.lang.util import cook_dtype
 from taichi.linalg import SparseMatrix
 from taichi.types.primitive_types import f32
 
@@ -11,16 +12,32 @@ class SparseSolver:
     Use this class to solve linear systems represented by sparse matrices.
 
     Args:
+        dtype (DataType): The data type of the matrices to solve, ti.f32 or
+            ti.f64.
         solver_type (str): The factorization type.
         ordering (str): The method for matrices re-ordering.
+
+    On CPU, "ParallelLLT" factorizes the symmetric positive definite systems
+    on the thread pool of the CPU backend, and "CholmodLLT" (f64 only, if
+    Taichi is built with CHOLMOD) with the supernodal Cholesky of CHOLMOD.
+
+    On CUDA, the symmetric positive definite systems ("LLT" and "LDLT") are
+    solved on the device by the conjugate gradient method, and ``ordering``
+    is ignored.
     """
     def __init__(self, dtype=f32, solver_type="LLT", ordering="AMD"):
-        solver_type_list = ["LLT", "LDLT", "LU"]
+        solver_type_list = ["LLT", "LDLT", "LU", "ParallelLLT", "CholmodLLT"]
         solver_ordering = ['AMD', 'COLAMD']
         if solver_type in solver_type_list and ordering in solver_ordering:
             taichi_arch = taichi.lang.impl.get_runtime().prog.config.arch
-            assert taichi_arch == _ti_core.Arch.x64 or taichi_arch == _ti_core.Arch.arm64, "SparseSolver only supports CPU for now."
-            self.solver = _ti_core.make_sparse_solver(solver_type, ordering)
+            if taichi_arch == _ti_core.Arch.cuda:
+                assert cook_dtype(dtype) == f32, "SparseSolver on CUDA only supports f32 for now."
+                assert solver_type in ("LLT", "LDLT"), "SparseSolver on CUDA only supports symmetric positive definite matrices (LLT, LDLT) for now."
+                self.solver = _ti_core.CuSparseSolver()
+                return
+            assert taichi_arch == _ti_core.Arch.x64 or taichi_arch == _ti_core.Arch.arm64, "SparseSolver only supports CPU and CUDA for now."
+            self.solver = _ti_core.make_sparse_solver(cook_dtype(dtype),
+                                                      solver_type, ordering)
         else:
             assert False, f"The solver type {solver_type} with {ordering} is not supported for now. Only {solver_type_list} with {solver_ordering} are supported."
 
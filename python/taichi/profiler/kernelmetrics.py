@@ -166,6 +166,43 @@ achieved_occupancy = CuptiMetric(
     header=' occupancy',
     val_format='   {:6.0f} ')
 
+# Roofline Metrics
+# The FP32 operations, an FFMA counting as two FLOPs.
+fp32_add = CuptiMetric(
+    name='smsp__sass_thread_inst_executed_op_fadd_pred_on.sum',
+    header='   fp32.add ',
+    val_format='  {:9.0f} ')
+
+fp32_mul = CuptiMetric(
+    name='smsp__sass_thread_inst_executed_op_fmul_pred_on.sum',
+    header='   fp32.mul ',
+    val_format='  {:9.0f} ')
+
+fp32_fma = CuptiMetric(
+    name='smsp__sass_thread_inst_executed_op_ffma_pred_on.sum',
+    header='   fp32.fma ',
+    val_format='  {:9.0f} ')
+
+# The peaks, in operations per cycle times cycles per second.
+dram_bytes_peak = CuptiMetric(name='dram__bytes.sum.peak_sustained',
+                              header=' global.peak ',
+                              val_format='{:8.0f} B/c ')
+
+dram_frequency = CuptiMetric(name='dram__cycles_elapsed.avg.per_second',
+                             header='  dram.freq ',
+                             val_format='{:7.0f} MHz ',
+                             scale=1.0 / 1000 / 1000)
+
+fp32_fma_peak = CuptiMetric(
+    name='sm__sass_thread_inst_executed_op_ffma_pred_on.sum.peak_sustained',
+    header='  fma.peak ',
+    val_format=' {:5.0f} /c ')
+
+sm_frequency = CuptiMetric(name='sm__cycles_elapsed.avg.per_second',
+                           header='    sm.freq ',
+                           val_format='{:7.0f} MHz ',
+                           scale=1.0 / 1000 / 1000)
+
 # metric suite: global load & store
 global_access = [
     dram_bytes_sum,
@@ -205,6 +242,20 @@ device_utilization = [
     l2_throughput,
 ]
 
+# metric suite: roofline, see KernelProfiler.print_info('roofline')
+roofline = [
+    dram_bytes_sum,
+    l2_hit_rate,
+    achieved_occupancy,
+    fp32_add,
+    fp32_mul,
+    fp32_fma,
+    dram_bytes_peak,
+    dram_frequency,
+    fp32_fma_peak,
+    sm_frequency,
+]
+
 # Predefined metrics suites
 predefined_cupti_metrics = {
     'global_access': global_access,
@@ -212,6 +263,7 @@ predefined_cupti_metrics = {
     'atomic_access': atomic_access,
     'cache_hit_rate': cache_hit_rate,
     'device_utilization': device_utilization,
+    'roofline': roofline,
 }
 
 
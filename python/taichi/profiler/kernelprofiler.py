@@ -2,7 +2,7 @@ from contextlib import contextmanager
 
 from taichi.core import ti_core as _ti_core
 from taichi.lang import impl
-from taichi.profiler.kernelmetrics import default_cupti_metrics
+from taichi.profiler.kernelmetrics import default_cupti_metrics, roofline
 
 import taichi as ti
 
@@ -109,6 +109,56 @@ class KernelProfiler:
         # TODO : query self.StatisticalResult in python scope
         return impl.get_runtime().prog.query_kernel_profile_info(name)
 
+    def query_attributes(self):
+        """For docsting of this function, see :func:`~taichi.lang.query_kernel_attributes`."""
+        if self._check_not_turned_on_with_warning_message():
+            return {}
+        self._update_records()
+        attributes = {}
+        for record in self._traced_records:
+            # Only the CUDA backend gets the attributes of the kernels.
+            if record.register_per_thread > 0:
+                attributes[record.name] = {
+                    'registers': record.register_per_thread,
+                    'local_mem': record.local_mem_per_thread,
+                    'shared_mem': record.shared_mem_per_block,
+                    'block_size': record.block_size,
+                    'occupancy': record.occupancy,
+                }
+        return attributes
+
+    def query_thread_stats(self):
+        """For docsting of this function, see :func:`~taichi.lang.query_kernel_thread_stats`."""
+        if self._check_not_turned_on_with_warning_message():
+            return {}
+        self._update_records()
+        stats = {}
+        for record in self._traced_records:
+            # Only the tasks run by the thread pool on CPU have them.
+            if record.num_threads == 0:
+                continue
+            task = stats.setdefault(
+                record.name, {
+                    'launches': 0,
+                    'threads': 0,
+                    'imbalance': 0.0,
+                    'max_imbalance': 0.0,
+                    'wakeup_latency': 0.0,
+                    'max_wakeup_latency': 0.0
+                })
+            task['launches'] += 1
+            task['threads'] = max(task['threads'], record.num_threads)
+            task['imbalance'] += record.imbalance_ratio
+            task['max_imbalance'] = max(task['max_imbalance'],
+                                        record.imbalance_ratio)
+            task['wakeup_latency'] += record.wakeup_latency_ms
+            task['max_wakeup_latency'] = max(task['max_wakeup_latency'],
+                                             record.wakeup_latency_ms)
+        for task in stats.values():
+            task['imbalance'] /= task['launches']
+            task['wakeup_latency'] /= task['launches']
+        return stats
+
     def set_metrics(self, metric_list=default_cupti_metrics):
         """For docsting of this function, see :func:`~taichi.lang.set_kernel_profile_metrics`."""
         if self._check_not_turned_on_with_warning_message():
@@ -138,6 +188,11 @@ class KernelProfiler:
     # mode of print_info
     COUNT = 'count'  # print the statistical results (min,max,avg time) of Taichi kernels.
     TRACE = 'trace'  # print the records of launched Taichi kernels with specific profiling metrics (time, memory load/store and core utilization etc.)
+    ROOFLINE = 'roofline'  # print the achieved bandwidth and FLOP/s of the offloaded tasks against the peaks of the device, and what bounds them.
+
+    # A task neither reaching this fraction of the peak bandwidth nor of the
+    # peak FLOP/s is considered latency bound.
+    ROOFLINE_SATURATION = 0.5
 
     def print_info(self, mode=COUNT):
         """Print the profiling results of Taichi kernels.
@@ -158,9 +213,12 @@ class KernelProfiler:
         #TRACE mode : print records of launched kernel
         elif mode == self.TRACE:
             self._print_kernel_info()
+        #ROOFLINE mode : print the roofline analysis of the offloaded tasks
+        elif mode == self.ROOFLINE:
+            self._print_roofline_info()
         else:
             raise ValueError(
-                f'Arg `mode` must be of type \'str\', and has the value \'count\' or \'trace\'.'
+                f'Arg `mode` must be of type \'str\', and has the value \'count\', \'trace\' or \'roofline\'.'
             )
 
         return None
@@ -275,14 +333,18 @@ class KernelProfiler:
         # there is no corresponding implementation in other backends yet.
         # Profiler dose not print invalid kernel attributes info for now.
         kernel_attribute_state = self._traced_records[0].register_per_thread > 0
+        # The thread pool on CPU.
+        thread_state = any(r.num_threads > 0 for r in self._traced_records)
 
         # headers
         table_header = self._make_table_header('trace')
         column_header = ('[  start.time | kernel.time |')  #default
         if kernel_attribute_state:
             column_header += (
-                '   regs  |   shared mem | grid size | block size | occupancy |'
+                '   regs  |  local mem |   shared mem | grid size | block size | occupancy |'
             )  #kernel_attributes
+        if thread_state:
+            column_header += ' threads | imbalance |    wakeup  |'
         for idx in range(values_num):
             column_header += metric_list[idx].header + '|'
         column_header = (column_header + '] Kernel name').replace("|]", "]")
@@ -300,11 +362,17 @@ class KernelProfiler:
             formatted_str = '[{:9.3f} ms |{:9.3f} ms |'  #default
             values = [fake_timestamp, record.kernel_time]  #default
             if kernel_attribute_state:
-                formatted_str += '    {:4d} | {:6d} bytes |    {:6d} |     {:6d} | {:2d} blocks |'
+                formatted_str += '    {:4d} | {:4d} bytes | {:6d} bytes |    {:6d} |     {:6d} |  {:6.1%}   |'
+                values += [
+                    record.register_per_thread, record.local_mem_per_thread,
+                    record.shared_mem_per_block, record.grid_size,
+                    record.block_size, record.occupancy
+                ]
+            if thread_state:
+                formatted_str += '  {:6d} |   {:6.2f}x | {:6.3f} ms |'
                 values += [
-                    record.register_per_thread, record.shared_mem_per_block,
-                    record.grid_size, record.block_size,
-                    record.active_blocks_per_multiprocessor
+                    record.num_threads, record.imbalance_ratio,
+                    record.wakeup_latency_ms
                 ]
             for idx in range(values_num):
                 formatted_str += metric_list[idx].format + '|'
@@ -327,6 +395,96 @@ class KernelProfiler:
         print(f"Number of records:  {len(self._traced_records)}")
         print(outer_partition_line)
 
+    def _print_roofline_info(self):
+        """Print the roofline analysis of the offloaded tasks, the most time consuming first.
+
+        The records are collected with the ``'roofline'`` metric suite, see
+        :func:`~taichi.lang.get_predefined_cupti_metrics`.
+        """
+        metric_names = [metric.name for metric in self._metric_list]
+        missing = [m.name for m in roofline if m.name not in metric_names]
+        if missing or not self._traced_records:
+            _ti_core.warn(
+                'Use ti.set_kernel_profile_metrics(ti.get_predefined_cupti_metrics(\'roofline\')) '
+                'and launch the kernels before printing the roofline.')
+            return
+
+        def value(record, metric):
+            return record.metric_values[metric_names.index(metric.name)]
+
+        # Sums over the launches of each task.
+        tasks = {}
+        for record in self._traced_records:
+            task = tasks.setdefault(
+                record.name, {
+                    'count': 0,
+                    'time': 0.0,
+                    'bytes': 0.0,
+                    'flops': 0.0,
+                    'l2_hit': 0.0,
+                    'occupancy': 0.0
+                })
+            task['count'] += 1
+            task['time'] += record.kernel_time
+            task['bytes'] += value(record, roofline[0])
+            task['l2_hit'] += value(record, roofline[1])
+            task['occupancy'] += value(record, roofline[2])
+            task['flops'] += value(record, roofline[3]) + value(
+                record, roofline[4]) + 2 * value(record, roofline[5])
+        last = self._traced_records[-1]
+        peak_bandwidth = value(last, roofline[6]) * value(last, roofline[7])
+        peak_flops = 2 * value(last, roofline[8]) * value(last, roofline[9])
+        total_time = sum(task['time'] for task in tasks.values())
+
+        table_header = self._make_table_header('roofline')
+        column_header = (
+            '[      %     total   count |  DRAM.avg     DRAM.BW L2.hit   occ. |'
+            '  GFLOP/s  FLOP/B | %peak.BW %peak.FLOP |    bound ] Kernel name')
+        peaks_line = (f'Peak DRAM bandwidth: {peak_bandwidth / 1e9:8.1f} GB/s'
+                      f'   Peak FP32: {peak_flops / 1e9:9.1f} GFLOP/s'
+                      f'   Ridge point: {peak_flops / peak_bandwidth:6.2f}'
+                      f' FLOP/B')
+        line_length = max(len(column_header), len(table_header))
+        outer_partition_line = '=' * line_length
+        inner_partition_line = '-' * line_length
+
+        print(outer_partition_line)
+        print(table_header)
+        print(outer_partition_line)
+        print(peaks_line)
+        print(inner_partition_line)
+        print(column_header)
+        print(inner_partition_line)
+        for name, task in sorted(tasks.items(),
+                                 key=lambda item: item[1]['time'],
+                                 reverse=True):
+            seconds = task['time'] / 1000.0
+            bandwidth = task['bytes'] / seconds if seconds > 0 else 0.0
+            flops = task['flops'] / seconds if seconds > 0 else 0.0
+            intensity = task['flops'] / task['bytes'] if task[
+                'bytes'] > 0 else float('inf')
+            bandwidth_fraction = bandwidth / peak_bandwidth
+            flops_fraction = flops / peak_flops
+            if max(bandwidth_fraction,
+                   flops_fraction) < self.ROOFLINE_SATURATION:
+                bound = 'latency'
+            elif bandwidth_fraction >= flops_fraction:
+                bound = 'memory'
+            else:
+                bound = 'compute'
+            print(
+                '[{:6.2f}% {:7.3f} s {:6d}x |{:7.1f} MB {:6.1f} GB/s {:5.1f}% {:5.1f}% |'
+                '{:9.1f} {:7.2f} | {:7.1f}% {:9.1f}% | {:>8} ] {}'.format(
+                    task['time'] / total_time * 100.0, seconds, task['count'],
+                    task['bytes'] / task['count'] / 1024 / 1024,
+                    bandwidth / 1e9, task['l2_hit'] / task['count'],
+                    task['occupancy'] / task['count'], flops / 1e9,
+                    intensity, bandwidth_fraction * 100.0,
+                    flops_fraction * 100.0, bound, name))
+        print(inner_partition_line)
+        print(f'Number of tasks: {len(tasks)}')
+        print(outer_partition_line)
+
 
 _ti_kernel_profiler = KernelProfiler()
 
@@ -0,0 +1,110 @@
+from collections import deque
+from time import perf_counter_ns
+
+
+class LaunchProfiler:
+    """Samples the overhead of launching Taichi kernels from Python.
+
+    Every ``sample_interval``-th launch is split into stages, each timed with
+    :func:`time.perf_counter_ns`:
+
+    * ``lookup``: mapping the arguments to the template instance of the
+      kernel, i.e. ``TaichiCallableTemplateMapper.lookup()``.
+    * ``set_args``: setting the arguments of the ``LaunchContextBuilder``.
+    * ``launch``: ``Kernel::operator()`` in C++, which returns once the
+      kernel is submitted, or done on the backends that run it synchronously.
+    * ``return``: reading the return value, and the remaining callbacks.
+
+    The launches that compile the kernel are left out. The unsampled launches
+    only pay for a counter, so this can be left on to track regressions.
+
+    To enable it, set ``launch_profiler`` to the sampling interval in
+    ``ti.init()``, e.g. ``ti.init(launch_profiler=16)``.
+    """
+    STAGES = ('lookup', 'set_args', 'launch', 'return')
+    PERCENTILES = (50, 90, 99)
+
+    def __init__(self, sample_interval=1, max_samples=100000):
+        self.sample_interval = max(int(sample_interval), 1)
+        self._countdown = 0
+        # The timestamps of the launch being sampled, None otherwise.
+        self._stamps = None
+        self._samples = {
+            stage: deque(maxlen=max_samples)
+            for stage in self.STAGES + ('total', )
+        }
+
+    def begin(self):
+        """Called at the start of every launch, returns whether it is sampled."""
+        self._countdown -= 1
+        if self._countdown > 0:
+            return False
+        self._countdown = self.sample_interval
+        self._stamps = [perf_counter_ns()]
+        return True
+
+    def mark(self):
+        """Ends a stage of the sampled launch."""
+        if self._stamps is not None:
+            self._stamps.append(perf_counter_ns())
+
+    def discard(self):
+        """Leaves the sampled launch out, e.g. because it compiled the kernel."""
+        self._stamps = None
+
+    def end(self):
+        """Ends the last stage, and records the sampled launch."""
+        stamps = self._stamps
+        if stamps is None:
+            return
+        self._stamps = None
+        stamps.append(perf_counter_ns())
+        if len(stamps) != len(self.STAGES) + 1:
+            # E.g. the launch raised before its arguments were set.
+            return
+        for i, stage in enumerate(self.STAGES):
+            self._samples[stage].append(stamps[i + 1] - stamps[i])
+        self._samples['total'].append(stamps[-1] - stamps[0])
+
+    def clear(self):
+        for samples in self._samples.values():
+            samples.clear()
+
+    def query(self):
+        """Returns the percentiles and the maximum of each stage in microseconds.
+
+        Returns:
+            Dict[str, Dict[str, float]]: For each stage and ``'total'``, the
+            ``'p50'``, ``'p90'``, ``'p99'`` and ``'max'`` durations, and the
+            ``'count'`` of samples.
+        """
+        result = {}
+        for stage, samples in self._samples.items():
+            ordered = sorted(samples)
+            stats = {'count': len(ordered)}
+            for p in self.PERCENTILES:
+                # Nearest rank
+                rank = max((p * len(ordered) + 99) // 100 - 1, 0)
+                stats[f'p{p}'] = ordered[rank] / 1000 if ordered else 0.0
+            stats['max'] = ordered[-1] / 1000 if ordered else 0.0
+            result[stage] = stats
+        return result
+
+    def print_info(self):
+        """Prints the percentiles of each stage."""
+        result = self.query()
+        column_header = '[   stage  |      p50       p90       p99       max ] us'
+        partition_line = '=' * len(column_header)
+        print(partition_line)
+        print(f'Launch Profiler (1 in {self.sample_interval} launches, '
+              f'{result["total"]["count"]} samples)')
+        print(partition_line)
+        print(column_header)
+        print('-' * len(column_header))
+        for stage, stats in result.items():
+            if stage == 'total':
+                print('-' * len(column_header))
+            print('[{:>9} | {:8.2f}  {:8.2f}  {:8.2f}  {:8.2f} ]'.format(
+                stage, stats['p50'], stats['p90'], stats['p99'],
+                stats['max']))
+        print(partition_line)
@@ -3,6 +3,7 @@ from typing import Any, Optional, Sequence, Union
 from taichi.core.util import ti_core as _ti_core
 from taichi.lang import impl, snode
 from taichi.lang.exception import InvalidOperationError
+from taichi.lang.util import device_memory_callsite
 from taichi.snode.snode_tree import SNodeTree
 from taichi.tools.util import warning
 
@@ -94,9 +95,12 @@ class FieldsBuilder:
         self._empty = False
         return self._root.pointer(indices, dimensions)
 
-    def hash(self, indices, dimensions):
+    def hash(self, indices: Union[Sequence[_Axis], _Axis],
+             dimensions: Union[Sequence[int], int], capacity: int):
         """Same as :func:`taichi.lang.snode.SNode.hash`"""
-        raise NotImplementedError()
+        self._check_not_finalized()
+        self._empty = False
+        return self._root.hash(indices, dimensions, capacity)
 
     def dynamic(self,
                 index: Union[Sequence[_Axis], _Axis],
@@ -159,10 +163,11 @@ class FieldsBuilder:
         if self._empty and raise_warning:
             warning("Finalizing an empty FieldsBuilder!")
         self._finalized = True
-        return SNodeTree(
-            _ti_core.finalize_snode_tree(_snode_registry, self._ptr,
-                                         impl.get_runtime().prog,
-                                         compile_only))
+        with device_memory_callsite():
+            return SNodeTree(
+                _ti_core.finalize_snode_tree(_snode_registry, self._ptr,
+                                             impl.get_runtime().prog,
+                                             compile_only))
 
     def _check_not_finalized(self):
         if self._finalized:
@@ -19,6 +19,12 @@ __all__ = [
     'dot_to_pdf',
     'obsolete',
     'get_kernel_stats',
+    'get_metrics',
+    'export_metrics',
+    'reset_metrics',
+    'get_device_memory_breakdown',
+    'print_device_memory_breakdown',
+    'reset_device_memory_peak',
     'get_traceback',
     'set_gdb_trigger',
     'print_profile_info',
@@ -181,3 +181,58 @@ def dot_to_pdf(dot, filepath):
 
 def get_kernel_stats():
     return _ti_core.get_kernel_stats()
+
+
+def get_metrics():
+    """Get the current values of the runtime metrics, e.g. the number of
+    kernel launches and compilations, the offline cache hits and misses, the
+    bytes copied between host and device, the bytes allocated by the memory
+    pools and the async engine flushes.
+
+    Returns:
+        Dict[str, float]: The values by metric name. A histogram contributes
+        its ``_count`` and ``_sum``.
+    """
+    return dict(_ti_core.get_metrics())
+
+
+def export_metrics():
+    """Export the runtime metrics in the OpenMetrics text format, which is
+    understood by Prometheus.
+
+    Returns:
+        str: The exposition, ending with ``# EOF``.
+    """
+    return _ti_core.export_metrics()
+
+
+def reset_metrics():
+    """Zero the runtime metrics."""
+    _ti_core.reset_metrics()
+
+
+def get_device_memory_breakdown():
+    """Get the live device allocations by origin, with
+    ``ti.init(track_device_memory=True)``.
+
+    Returns:
+        Dict[str, Any]: The ``'current_bytes'`` and ``'peak_bytes'`` allocated
+        from the devices, and the ``'allocations'``, the largest first. Each
+        has its ``'subsystem'`` (e.g. ``'snode_tree'`` or ``'ndarray'``), its
+        ``'name'``, the Python ``'callsite'`` creating it if any, its
+        ``'bytes'`` and ``'count'``, and whether it is ``'nested'`` in another
+        one, e.g. in the memory preallocated by the runtime on CUDA, and not
+        counted in the totals.
+    """
+    return _ti_core.get_device_memory_breakdown()
+
+
+def print_device_memory_breakdown():
+    """Print the live device allocations by origin, see
+    :func:`get_device_memory_breakdown`."""
+    print(_ti_core.get_device_memory_report(), end='')
+
+
+def reset_device_memory_peak():
+    """Restart the peak of the device memory from the current usage."""
+    _ti_core.reset_device_memory_peak()
@@ -91,6 +91,39 @@ Example::
 """
 
 
+class ArgTexture:
+    """Type annotation for textures, see :class:`~taichi.lang._texture.Texture`.
+
+    The argument is read in the kernel with ``sample_lod()`` and ``fetch()``.
+
+    Args:
+        num_dimensions (int): The number of dimensions of the texture, 1 to 3.
+    """
+    def __init__(self, num_dimensions):
+        if num_dimensions < 1 or num_dimensions > 3:
+            raise ValueError(
+                f"Textures have 1 to 3 dimensions, not {num_dimensions}")
+        self.num_dimensions = num_dimensions
+
+    def check_texture(self, arg):
+        if len(arg.shape) != self.num_dimensions:
+            raise ValueError(
+                f"Invalid argument into ti.texture() - required num_dimensions={self.num_dimensions}, but a texture of shape {arg.shape} is provided"
+            )
+
+
+texture = ArgTexture
+"""Alias for :class:`~taichi.types.annotations.ArgTexture`.
+
+Example::
+
+    >>> @ti.kernel
+    >>> def blur(t: ti.texture(num_dimensions=2)):
+    >>>     for i, j in x:
+    >>>         x[i, j] = t.sample_lod(ti.Vector([i + 0.5, j]) / n, 0.0)[0]
+"""
+
+
 class Template:
     """Type annotation for template kernel parameter.
 
@@ -109,4 +142,35 @@ template = Template
 """Alias for :class:`~taichi.types.annotations.Template`.
 """
 
-__all__ = ['ext_arr', 'any_arr', 'template']
+
+class FieldHandle(Template):
+    """Type annotation for a field taken by its layout rather than by identity.
+
+    A kernel is compiled for each field passed as a :func:`template` argument.
+    With this annotation, it is compiled once for all the fields of an SNode
+    tree with the same type, shape and strides, and a field is located at
+    launch time by its offset from the one the kernel was compiled with.
+
+    Only the scalar and matrix fields whose ancestors are all dense SNodes are
+    taken this way, on the CPU and CUDA backends out of async mode. The other
+    arguments are taken like templates, and so are all the arguments of the
+    gradient kernels. In the kernel, the gradients of such a field are not
+    accessible, nor is the field equal to the one passed.
+    """
+
+
+field_handle = FieldHandle
+"""Alias for :class:`~taichi.types.annotations.FieldHandle`.
+
+Example::
+
+    >>> @ti.kernel
+    >>> def scale(x: ti.field_handle(), k: ti.f32):
+    >>>     for I in ti.grouped(x):
+    >>>         x[I] *= k
+    >>>
+    >>> scale(a, 2.0)
+    >>> scale(b, 2.0)  # No compile if `b` is laid out like `a`.
+"""
+
+__all__ = ['ext_arr', 'any_arr', 'texture', 'template', 'field_handle']
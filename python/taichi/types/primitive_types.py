@@ -18,7 +18,17 @@ f64 = float64
 float16 = ti_core.DataType_f16
 f16 = float16
 
-real_types = [f16, f32, f64, float]
+bfloat16 = ti_core.DataType_bf16
+"""16-bit brain floating point data type, with the exponent range of float32.
+
+Values are stored in 16 bits and computed in float32. Only supported on the
+CPU and CUDA backends.
+"""
+bf16 = bfloat16
+"""Alias for :const:`~taichi.types.primitive_types.bfloat16`
+"""
+
+real_types = [f16, bf16, f32, f64, float]
 real_type_ids = [id(t) for t in real_types]
 
 # Integer types
@@ -70,6 +80,8 @@ __all__ = [
     'f64',
     'float16',
     'f16',
+    'bfloat16',
+    'bf16',
     'int8',
     'i8',
     'int16',
@@ -1,5 +1,6 @@
 from .staging_buffer import (copy_colors_to_vbo, copy_vertices_to_vbo,
-                             get_vbo_field, to_u8_rgba)
+                             get_vbo_field, mark_vbo_up_to_date, to_u8_rgba,
+                             vbo_is_up_to_date)
 from .utils import get_field_info
 
 
@@ -10,8 +11,16 @@ class Canvas:
     def set_background_color(self, color):
         self.canvas.set_background_color(color)
 
-    def set_image(self, img):
-        staging_img = to_u8_rgba(img)
+    def set_image(self, img, exposure=1.0, gamma=1.0, tone_map=False):
+        """Set the image to show on the whole canvas.
+
+        Args:
+            img: a taichi 2D Vector field of 3 or 4 components, either u8 or f32 in [0, 1].
+            exposure (float): the factor applied to the colors of an f32 image.
+            gamma (float): the colors of an f32 image are raised to the power of 1 / `gamma`, e.g. 2.2 to display linear colors.
+            tone_map (bool): map the colors of an f32 image from [0, inf) to [0, 1) with the Reinhard operator, after the exposure and before the gamma.
+        """
+        staging_img = to_u8_rgba(img, exposure, gamma, tone_map)
         info = get_field_info(staging_img)
         self.canvas.set_image(info)
 
@@ -29,10 +38,13 @@ class Canvas:
             per_vertex_color (Tuple[float]): a taichi 3D vector field, where each element indicate the RGB color of a vertex.
         """
         vbo = get_vbo_field(vertices)
-        copy_vertices_to_vbo(vbo, vertices)
         has_per_vertex_color = per_vertex_color is not None
-        if has_per_vertex_color:
-            copy_colors_to_vbo(vbo, per_vertex_color)
+        sources = (vertices, per_vertex_color)
+        if not vbo_is_up_to_date(vbo, sources):
+            copy_vertices_to_vbo(vbo, vertices)
+            if has_per_vertex_color:
+                copy_colors_to_vbo(vbo, per_vertex_color)
+            mark_vbo_up_to_date(vbo, sources)
         vbo_info = get_field_info(vbo)
         indices_info = get_field_info(indices)
         self.canvas.triangles(vbo_info, indices_info, has_per_vertex_color,
@@ -54,10 +66,13 @@ class Canvas:
             per_vertex_color (Tuple[float]): a taichi 3D vector field, where each element indicate the RGB color of a vertex.
         """
         vbo = get_vbo_field(vertices)
-        copy_vertices_to_vbo(vbo, vertices)
         has_per_vertex_color = per_vertex_color is not None
-        if has_per_vertex_color:
-            copy_colors_to_vbo(vbo, per_vertex_color)
+        sources = (vertices, per_vertex_color)
+        if not vbo_is_up_to_date(vbo, sources):
+            copy_vertices_to_vbo(vbo, vertices)
+            if has_per_vertex_color:
+                copy_colors_to_vbo(vbo, per_vertex_color)
+            mark_vbo_up_to_date(vbo, sources)
         vbo_info = get_field_info(vbo)
         indices_info = get_field_info(indices)
         self.canvas.lines(vbo_info, indices_info, has_per_vertex_color, color,
@@ -67,7 +82,8 @@ class Canvas:
                 centers,
                 radius,
                 color=(0.5, 0.5, 0.5),
-                per_vertex_color=None):
+                per_vertex_color=None,
+                max_drawn=None):
         """Declare a set of 2D circles inside the scene.
 
         Args:
@@ -75,14 +91,19 @@ class Canvas:
             radius (float): radius of the circles, relative to the height of the screen.
             color: a global color for the triangles as 3 floats representing RGB values. If `per_vertex_color` is provided, this is ignored.
             per_vertex_color (Tuple[float]): a taichi 3D vector field, where each element indicate the RGB color of a circle.
+            max_drawn (int): if provided, only about this many circles, evenly strided through `centers`, are drawn.
         """
         vbo = get_vbo_field(centers)
-        copy_vertices_to_vbo(vbo, centers)
         has_per_vertex_color = per_vertex_color is not None
-        if has_per_vertex_color:
-            copy_colors_to_vbo(vbo, per_vertex_color)
+        sources = (centers, per_vertex_color)
+        if not vbo_is_up_to_date(vbo, sources):
+            copy_vertices_to_vbo(vbo, centers)
+            if has_per_vertex_color:
+                copy_colors_to_vbo(vbo, per_vertex_color)
+            mark_vbo_up_to_date(vbo, sources)
         vbo_info = get_field_info(vbo)
-        self.canvas.circles(vbo_info, has_per_vertex_color, color, radius)
+        self.canvas.circles(vbo_info, has_per_vertex_color, color, radius,
+                            max_drawn or 0)
 
     def scene(self, scene):
         """Draw a 3D scene on the canvas"""
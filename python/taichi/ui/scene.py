@@ -7,7 +7,8 @@ from taichi.types.annotations import template
 from taichi.types.primitive_types import f32
 
 from .staging_buffer import (copy_colors_to_vbo, copy_normals_to_vbo,
-                             copy_vertices_to_vbo, get_vbo_field)
+                             copy_vertices_to_vbo, get_vbo_field,
+                             mark_vbo_up_to_date, vbo_is_up_to_date)
 from .utils import get_field_info
 
 normals_field_cache = {}
@@ -96,13 +97,16 @@ class Scene(_ti_core.PyScene):
             two_sided (bool): whether or not the triangles should be able to be seen from both sides.
         """
         vbo = get_vbo_field(vertices)
-        copy_vertices_to_vbo(vbo, vertices)
         has_per_vertex_color = per_vertex_color is not None
-        if has_per_vertex_color:
-            copy_colors_to_vbo(vbo, per_vertex_color)
-        if normals is None:
-            normals = gen_normals(vertices, indices)
-        copy_normals_to_vbo(vbo, normals)
+        sources = (vertices, indices, normals, per_vertex_color)
+        if not vbo_is_up_to_date(vbo, sources):
+            copy_vertices_to_vbo(vbo, vertices)
+            if has_per_vertex_color:
+                copy_colors_to_vbo(vbo, per_vertex_color)
+            if normals is None:
+                normals = gen_normals(vertices, indices)
+            copy_normals_to_vbo(vbo, normals)
+            mark_vbo_up_to_date(vbo, sources)
         vbo_info = get_field_info(vbo)
         indices_info = get_field_info(indices)
 
@@ -113,7 +117,8 @@ class Scene(_ti_core.PyScene):
                   centers,
                   radius,
                   color=(0.5, 0.5, 0.5),
-                  per_vertex_color=None):
+                  per_vertex_color=None,
+                  max_drawn=None):
         """Declare a set of particles within the scene.
 
         Args:
@@ -121,14 +126,19 @@ class Scene(_ti_core.PyScene):
             color: a global color for the particles as 3 floats representing RGB values. If `per_vertex_color` is provided, this is ignored.
             per_vertex_color (Tuple[float]): a taichi 3D vector field, where each element indicate the RGB color of a particle.
             two_sided (bool): whether or not the triangles should be able to be seen from both sides.
+            max_drawn (int): if provided, only about this many particles, evenly strided through `centers`, are drawn. This keeps huge particle sets interactive.
         """
         vbo = get_vbo_field(centers)
-        copy_vertices_to_vbo(vbo, centers)
         has_per_vertex_color = per_vertex_color is not None
-        if has_per_vertex_color:
-            copy_colors_to_vbo(vbo, per_vertex_color)
+        sources = (centers, per_vertex_color)
+        if not vbo_is_up_to_date(vbo, sources):
+            copy_vertices_to_vbo(vbo, centers)
+            if has_per_vertex_color:
+                copy_colors_to_vbo(vbo, per_vertex_color)
+            mark_vbo_up_to_date(vbo, sources)
         vbo_info = get_field_info(vbo)
-        super().particles(vbo_info, has_per_vertex_color, color, radius)
+        super().particles(vbo_info, has_per_vertex_color, color, radius,
+                          max_drawn or 0)
 
     def point_light(self, pos, color):  # pylint: disable=W0235
         super().point_light(pos, color)
@@ -1,3 +1,4 @@
+from taichi.lang import impl
 from taichi.lang.kernel_impl import kernel
 from taichi.lang.matrix import Vector
 from taichi.types.annotations import template
@@ -22,6 +23,32 @@ def get_vbo_field(vertices):
     return vbo_field_cache[vertices]
 
 
+# The source fields last copied into each VBO, with the write versions of
+# their SNode trees right after the copy. A VBO is not copied again until a
+# kernel may have written one of them, e.g. for the static parts of a scene.
+vbo_sources_cache = {}
+
+
+def get_field_version(f):
+    if f is None:
+        return None
+    return impl.get_runtime().prog.get_snode_tree_write_version(
+        f.snode.ptr.get_snode_tree_id())
+
+
+def vbo_is_up_to_date(vbo, sources):
+    if vbo not in vbo_sources_cache:
+        return False
+    cached_sources, cached_versions = vbo_sources_cache[vbo]
+    return all(a is b for a, b in zip(cached_sources, sources)) and \
+        cached_versions == tuple(get_field_version(f) for f in sources)
+
+
+def mark_vbo_up_to_date(vbo, sources):
+    vbo_sources_cache[vbo] = (sources,
+                              tuple(get_field_version(f) for f in sources))
+
+
 @kernel
 def copy_to_vbo(vbo: template(), src: template(), offset: template(),
                 num_components: template()):
@@ -83,10 +110,19 @@ def copy_colors_to_vbo(vbo, colors):
 
 @ti.kernel
 def copy_image_f32_to_u8(src: ti.template(), dst: ti.template(),
-                         num_components: ti.template()):
+                         num_components: ti.template(), exposure: ti.f32,
+                         inv_gamma: ti.f32, tone_map: ti.template()):
     for i, j in src:
         for k in ti.static(range(num_components)):
             c = src[i, j][k]
+            # The alpha is kept as is.
+            if ti.static(k < 3):
+                c = max(0.0, c * exposure)
+                if ti.static(tone_map):
+                    # Reinhard
+                    c = c / (1.0 + c)
+                if inv_gamma != 1.0:
+                    c = c**inv_gamma
             c = max(0.0, min(1.0, c))
             c = c * 255
             dst[i, j][k] = int(c)
@@ -105,7 +141,7 @@ def copy_image_u8_to_u8(src: ti.template(), dst: ti.template(),
 image_field_cache = {}
 
 
-def to_u8_rgba(image):
+def to_u8_rgba(image, exposure=1.0, gamma=1.0, tone_map=False):
     if not hasattr(image, 'n') or image.m != 1:
         raise Exception(
             f'the input image needs to be a Vector field (matrix with 1 column)'
@@ -117,6 +153,9 @@ def to_u8_rgba(image):
     if image.dtype == u8 and image.n == 4:
         # already in the desired format
         return image
+    if image.dtype == u8 and (exposure != 1.0 or gamma != 1.0 or tone_map):
+        raise Exception(
+            "exposure, gamma and tone mapping only apply to f32 images")
 
     if image not in image_field_cache:
         staging_img = Vector.field(4, u8, image.shape)
@@ -127,7 +166,8 @@ def to_u8_rgba(image):
     if image.dtype == u8:
         copy_image_u8_to_u8(image, staging_img, image.n)
     elif image.dtype == f32:
-        copy_image_f32_to_u8(image, staging_img, image.n)
+        copy_image_f32_to_u8(image, staging_img, image.n, exposure,
+                             1.0 / gamma, bool(tone_map))
     else:
         raise Exception("dtype of input image must either be u8 or f32")
     return staging_img
@@ -20,7 +20,12 @@ else:
         raise Exception("GGUI Not Available")
 
     class Window:
-        def __init__(self, name, res, vsync=False):
+        def __init__(self,
+                     name,
+                     res,
+                     vsync=False,
+                     show_window=True,
+                     frames_in_flight=2):
             err_no_ggui()
 
     class Scene:
@@ -15,14 +15,21 @@ class Window(_ti_core.PyWindow):
         name (str): name of the window.
         res (Tuple[Int]): resolution (width, height) of the window, in pixels.
         layout (vsync): whether or not vertical sync should be enabled.
+        frames_in_flight (int): the number of frames rendered ahead of
+            presentation, so that `show()` does not wait for the GPU.
     """
-    def __init__(self, name, res, vsync=False, show_window=True):
+    def __init__(self,
+                 name,
+                 res,
+                 vsync=False,
+                 show_window=True,
+                 frames_in_flight=2):
         package_path = str(pathlib.Path(__file__).parent.parent)
 
         ti_arch = default_cfg().arch
         is_packed = default_cfg().packed
         super().__init__(name, res, vsync, show_window, package_path, ti_arch,
-                         is_packed)
+                         is_packed, frames_in_flight)
 
     @property
     def running(self):
@@ -70,6 +77,17 @@ class Window(_ti_core.PyWindow):
         """Returns a canvas handle. See :class`~taichi.ui.canvas.Canvas` """
         return Canvas(super().get_canvas())
 
+    def start_video(self, filename, framerate=24, encoder='libx264'):
+        """Starts recording a video, which ffmpeg encodes as the frames are
+        written by `write_video_frame()`.
+
+        Args:
+            filename (str): the output video file, e.g. `out.mp4`.
+            framerate (int): frames per second of the video.
+            encoder (str): the ffmpeg video encoder, e.g. `h264_nvenc`.
+        """
+        super().start_video(filename, framerate, encoder)
+
     @property
     def GUI(self):
         """Returns a IMGUI handle. See :class`~taichi.ui.ui.Gui` """
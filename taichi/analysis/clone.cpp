@@ -99,6 +99,14 @@ class IRCloner : public IRVisitor {
     other_node = other;
   }
 
+  void visit(MeshForStmt *stmt) override {
+    generic_visit(stmt);
+    auto other = other_node->as<MeshForStmt>();
+    other_node = other->body.get();
+    stmt->body->accept(this);
+    other_node = other;
+  }
+
   void visit(OffloadedStmt *stmt) override {
     generic_visit(stmt);
     auto other = other_node->as<OffloadedStmt>();
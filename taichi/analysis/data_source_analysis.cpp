@@ -73,6 +73,8 @@ std::vector<Stmt *> get_store_destination(Stmt *store_stmt) {
     } else {
       return external_func->output_stmts;
     }
+  } else if (auto internal_func = store_stmt->cast<InternalFuncStmt>()) {
+    return internal_func->output_stmts;
   } else {
     return std::vector<Stmt *>();
   }
@@ -0,0 +1,125 @@
+#include "taichi/ir/ir.h"
+#include "taichi/ir/snode.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/statements.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+TLANG_NAMESPACE_BEGIN
+
+namespace irpass::analysis {
+
+namespace {
+
+// The size of a memory transaction of a GPU.
+constexpr int64 kTransactionBytes = 32;
+
+// The distance in bytes of the addresses of |place| at two indices one apart
+// along the physical |axis|, as linearized by ScalarPointerLowerer. Unknown if
+// the cells of the innermost SNode along |axis| are not stored contiguously.
+std::optional<int64> axis_stride_bytes(const SNode *place, int axis) {
+  for (auto *s = place->parent; s != nullptr; s = s->parent) {
+    if (!s->extractors[axis].active) {
+      continue;
+    }
+    if (s->type != SNodeType::dense && s->type != SNodeType::bitmasked) {
+      return std::nullopt;
+    }
+    int64 stride = s->cell_size_bytes;
+    for (int k = axis + 1; k < taichi_max_num_indices; k++) {
+      if (s->extractors[k].active) {
+        stride *= s->extractors[k].shape;
+      }
+    }
+    return stride;
+  }
+  return 0;
+}
+
+}  // namespace
+
+std::vector<GlobalAccessPattern> gather_access_patterns(IRNode *root) {
+  auto *offload = root->cast<OffloadedStmt>();
+  if (!offload) {
+    return {};
+  }
+  // The loop index that differs between consecutive threads.
+  int thread_index;
+  if (offload->task_type == OffloadedStmt::TaskType::range_for) {
+    thread_index = 0;
+  } else if (offload->task_type == OffloadedStmt::TaskType::struct_for) {
+    // The cells of the leaf block are assigned to the threads in order, so
+    // that the physically innermost index varies the fastest.
+    auto *snode = offload->snode;
+    thread_index = 0;
+    for (int i = 1; i < snode->num_active_indices; i++) {
+      if (snode->physical_index_position[i] >
+          snode->physical_index_position[thread_index]) {
+        thread_index = i;
+      }
+    }
+  } else {
+    return {};
+  }
+
+  using Kind = GlobalAccessPattern::Kind;
+  std::set<std::tuple<int, Kind, float64>> seen;
+  std::vector<GlobalAccessPattern> patterns;
+  gather_statements(offload->body.get(), [&](Stmt *s) {
+    auto *ptr = s->cast<GlobalPtrStmt>();
+    if (!ptr) {
+      return false;
+    }
+    auto *place = ptr->snodes[0];
+    if (!place->is_place() || !place->dt->is<PrimitiveType>() ||
+        !place->parent || place->parent->cell_size_bytes == 0) {
+      return false;
+    }
+    const int64 element_bytes = data_type_size(place->dt);
+    int64 stride = 0;
+    bool random = false;
+    for (int i = 0; i < (int)ptr->indices.size(); i++) {
+      auto diff = value_diff_loop_index(ptr->indices[i], offload, thread_index);
+      if (!diff.related()) {
+        random = true;
+        break;
+      }
+      if (diff.coeff == 0) {
+        continue;
+      }
+      auto axis_stride =
+          axis_stride_bytes(place, place->physical_index_position[i]);
+      if (!axis_stride) {
+        random = true;
+        break;
+      }
+      stride += std::abs(diff.coeff) * *axis_stride;
+    }
+    GlobalAccessPattern pattern;
+    pattern.snode = place;
+    if (random) {
+      pattern.kind = Kind::random;
+      stride = kTransactionBytes;
+    } else if (stride > element_bytes) {
+      pattern.kind = Kind::strided;
+    }
+    if (pattern.kind != Kind::coalesced) {
+      pattern.bytes_per_useful_byte =
+          std::max((float64)std::min(stride, kTransactionBytes) /
+                       element_bytes,
+                   1.0);
+    }
+    if (seen.emplace(place->id, pattern.kind, pattern.bytes_per_useful_byte)
+            .second) {
+      patterns.push_back(pattern);
+    }
+    return false;
+  });
+  return patterns;
+}
+
+}  // namespace irpass::analysis
+
+TLANG_NAMESPACE_END
@@ -40,6 +40,101 @@ gather_snode_read_writes(IRNode *root) {
   });
   return accessed;
 }
+
+namespace {
+
+// The SNode that |ptr| points into, or nullptr if it is not an SNode.
+SNode *pointed_snode(Stmt *ptr) {
+  while (true) {
+    if (auto *offset = ptr->cast<PtrOffsetStmt>()) {
+      ptr = offset->origin;
+    } else if (auto *offset = ptr->cast<IntegerOffsetStmt>()) {
+      ptr = offset->input;
+    } else {
+      break;
+    }
+  }
+  if (auto *get_ch = ptr->cast<GetChStmt>()) {
+    return get_ch->output_snode;
+  } else if (auto *lookup = ptr->cast<SNodeLookupStmt>()) {
+    return lookup->snode;
+  } else if (auto *global_ptr = ptr->cast<GlobalPtrStmt>()) {
+    return global_ptr->snodes[0];
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+SNodeTreeAccesses gather_snode_tree_accesses(IRNode *root) {
+  SNodeTreeAccesses result;
+  bool host_read = root->is<Block>();
+  auto read = [&](SNode *snode) {
+    result.read_trees.insert(snode->get_snode_tree_id());
+  };
+  auto write = [&](Stmt *ptr) {
+    if (auto *snode = pointed_snode(ptr)) {
+      result.written_trees.insert(snode->get_snode_tree_id());
+    } else if (ptr->is<GlobalTemporaryStmt>()) {
+      host_read = false;
+    } else if (!ptr->is<ExternalPtrStmt>() && !ptr->is<AllocaStmt>() &&
+               !ptr->is<ThreadLocalPtrStmt>() &&
+               !ptr->is<BlockLocalPtrStmt>()) {
+      result.writes_unknown = true;
+    }
+  };
+  gather_statements(root, [&](Stmt *stmt) {
+    if (auto *get_ch = stmt->cast<GetChStmt>()) {
+      read(get_ch->output_snode);
+    } else if (auto *lookup = stmt->cast<SNodeLookupStmt>()) {
+      read(lookup->snode);
+      if (lookup->activate) {
+        result.written_trees.insert(lookup->snode->get_snode_tree_id());
+      }
+    } else if (auto *global_ptr = stmt->cast<GlobalPtrStmt>()) {
+      for (auto *snode : global_ptr->snodes.data) {
+        read(snode);
+      }
+    } else if (auto *store = stmt->cast<GlobalStoreStmt>()) {
+      write(store->dest);
+    } else if (auto *atomic = stmt->cast<AtomicOpStmt>()) {
+      write(atomic->dest);
+    } else if (auto *store = stmt->cast<BitStructStoreStmt>()) {
+      write(store->ptr);
+    } else if (auto *op = stmt->cast<SNodeOpStmt>()) {
+      read(op->snode);
+      if (op->op_type != SNodeOpType::is_active &&
+          op->op_type != SNodeOpType::length &&
+          op->op_type != SNodeOpType::get_addr) {
+        result.written_trees.insert(op->snode->get_snode_tree_id());
+      }
+    } else if (stmt->is<GlobalTemporaryStmt>() || stmt->is<RandStmt>() ||
+               stmt->is<PrintStmt>() || stmt->is<AssertStmt>() ||
+               stmt->is<ExternalFuncCallStmt>() ||
+               stmt->is<InternalFuncStmt>() ||
+               stmt->is<AdStackAllocaStmt>()) {
+      host_read = false;
+    }
+    return false;
+  });
+  if (host_read) {
+    for (auto &stmt : root->as<Block>()->statements) {
+      auto *task = stmt->cast<OffloadedStmt>();
+      // The bounds of the other range-fors live in the global temporaries.
+      // The struct-fors use the element lists of the runtime.
+      if (task == nullptr ||
+          !(task->task_type == OffloadedStmt::TaskType::serial ||
+            (task->task_type == OffloadedStmt::TaskType::range_for &&
+             task->const_begin && task->const_end))) {
+        host_read = false;
+        break;
+      }
+    }
+  }
+  result.host_read =
+      host_read && result.written_trees.empty() && !result.writes_unknown;
+  return result;
+}
 }  // namespace irpass::analysis
 
 TLANG_NAMESPACE_END
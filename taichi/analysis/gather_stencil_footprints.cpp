@@ -0,0 +1,65 @@
+#include "taichi/ir/ir.h"
+#include "taichi/ir/snode.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/statements.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace irpass::analysis {
+
+std::unordered_map<SNode *, StencilFootprint> gather_stencil_footprints(
+    IRNode *root) {
+  std::unordered_map<SNode *, StencilFootprint> footprints;
+  auto offloads = gather_statements(root, [](Stmt *stmt) {
+    auto *offload = stmt->cast<OffloadedStmt>();
+    return offload &&
+           offload->task_type == OffloadedStmt::TaskType::struct_for;
+  });
+  for (auto *stmt : offloads) {
+    auto *offload = stmt->as<OffloadedStmt>();
+    const int num_loop_indices = offload->snode->num_active_indices;
+    gather_statements(offload->body.get(), [&](Stmt *s) {
+      auto *load = s->cast<GlobalLoadStmt>();
+      if (!load || !load->src->is<GlobalPtrStmt>()) {
+        return false;
+      }
+      auto *ptr = load->src->as<GlobalPtrStmt>();
+      auto &footprint = footprints[ptr->snodes[0]];
+      if (footprint.irregular) {
+        return false;
+      }
+      const int num_indices = (int)ptr->indices.size();
+      if (num_indices != num_loop_indices ||
+          (!footprint.offsets.empty() &&
+           (int)footprint.offsets.size() != num_indices)) {
+        footprint.irregular = true;
+        return false;
+      }
+      std::vector<std::pair<int, int>> offsets;
+      for (int i = 0; i < num_indices; i++) {
+        auto diff = value_diff_loop_index(ptr->indices[i], offload, i);
+        if (!diff.related() || diff.coeff != 1) {
+          footprint.irregular = true;
+          return false;
+        }
+        // The high end of a DiffRange is exclusive.
+        offsets.emplace_back(diff.low, diff.high - 1);
+      }
+      if (footprint.offsets.empty()) {
+        footprint.offsets = std::move(offsets);
+      } else {
+        for (int i = 0; i < num_indices; i++) {
+          auto &range = footprint.offsets[i];
+          range.first = std::min(range.first, offsets[i].first);
+          range.second = std::max(range.second, offsets[i].second);
+        }
+      }
+      return false;
+    });
+  }
+  return footprints;
+}
+
+}  // namespace irpass::analysis
+
+TLANG_NAMESPACE_END
@@ -4,6 +4,7 @@
 #include "taichi/ir/statements.h"
 #include "taichi/ir/visitors.h"
 #include <algorithm>
+#include <optional>
 
 TLANG_NAMESPACE_BEGIN
 
@@ -18,6 +19,10 @@ class LoopUniqueStmtSearcher : public BasicStmtVisitor {
   // the x-th loop index.
   std::unordered_map<Stmt *, int> loop_unique_;
 
+  // The inclusive bounds of the integer values known to be in a range, i.e.
+  // the constants and the indices of range-fors with constant bounds.
+  std::unordered_map<Stmt *, std::pair<int64, int64>> range_;
+
  public:
   // The number of loop indices of the top-level loop.
   // -1 means uninitialized.
@@ -30,8 +35,14 @@ class LoopUniqueStmtSearcher : public BasicStmtVisitor {
   }
 
   void visit(LoopIndexStmt *stmt) override {
-    if (stmt->loop->is<OffloadedStmt>())
+    if (auto offload = stmt->loop->cast<OffloadedStmt>()) {
       loop_unique_[stmt] = stmt->index;
+      if (offload->task_type == OffloadedStmt::TaskType::range_for &&
+          offload->const_begin && offload->const_end &&
+          offload->begin_value < offload->end_value) {
+        range_[stmt] = {offload->begin_value, offload->end_value - 1};
+      }
+    }
   }
 
   void visit(LoopUniqueStmt *stmt) override {
@@ -40,6 +51,9 @@ class LoopUniqueStmtSearcher : public BasicStmtVisitor {
 
   void visit(ConstStmt *stmt) override {
     loop_invariant_.insert(stmt);
+    if (auto value = get_int_const(stmt)) {
+      range_[stmt] = {*value, *value};
+    }
   }
 
   void visit(UnaryOpStmt *stmt) override {
@@ -79,6 +93,97 @@ class LoopUniqueStmtSearcher : public BasicStmtVisitor {
          stmt->op_type == BinaryOpType::bit_xor)) {
       loop_unique_[stmt] = loop_unique_[stmt->rhs];
     }
+
+    // Scaling by a constant is injective if it is odd, since it is then a
+    // bijection modulo 2^bits, or if it is non-zero and the product can't
+    // wrap around.
+    // loop-unique * const, const * loop-unique, loop-unique << const
+    // -> loop-unique
+    if (stmt->op_type == BinaryOpType::mul) {
+      if (loop_unique_.count(stmt->lhs) > 0 &&
+          is_injective_scaling(stmt->lhs, get_int_const(stmt->rhs),
+                               stmt->ret_type)) {
+        loop_unique_[stmt] = loop_unique_[stmt->lhs];
+      } else if (loop_unique_.count(stmt->rhs) > 0 &&
+                 is_injective_scaling(stmt->rhs, get_int_const(stmt->lhs),
+                                      stmt->ret_type)) {
+        loop_unique_[stmt] = loop_unique_[stmt->rhs];
+      }
+    } else if (stmt->op_type == BinaryOpType::bit_shl &&
+               loop_unique_.count(stmt->lhs) > 0) {
+      // Shifting left by 0 is the only odd scaling; the others need a range.
+      auto shift = get_int_const(stmt->rhs);
+      if (shift && *shift >= 0 && *shift < 62 &&
+          is_injective_scaling(stmt->lhs, (int64)1 << *shift,
+                               stmt->ret_type)) {
+        loop_unique_[stmt] = loop_unique_[stmt->lhs];
+      }
+    }
+
+    // The ranges of the sums and differences, to scale them afterwards.
+    auto lhs_range = range_.find(stmt->lhs);
+    auto rhs_range = range_.find(stmt->rhs);
+    if (lhs_range != range_.end() && rhs_range != range_.end() &&
+        is_signed(stmt->ret_type)) {
+      const auto [a_lo, a_hi] = lhs_range->second;
+      const auto [b_lo, b_hi] = rhs_range->second;
+      int64 lo, hi;
+      bool overflow = false;
+      if (stmt->op_type == BinaryOpType::add) {
+        overflow |= __builtin_add_overflow(a_lo, b_lo, &lo);
+        overflow |= __builtin_add_overflow(a_hi, b_hi, &hi);
+      } else if (stmt->op_type == BinaryOpType::sub) {
+        overflow |= __builtin_sub_overflow(a_lo, b_hi, &lo);
+        overflow |= __builtin_sub_overflow(a_hi, b_lo, &hi);
+      } else {
+        overflow = true;
+      }
+      if (!overflow && fits_in(lo, stmt->ret_type) &&
+          fits_in(hi, stmt->ret_type)) {
+        range_[stmt] = {lo, hi};
+      }
+    }
+  }
+
+  // Whether the signed integer type |dt| holds |value|.
+  static bool fits_in(int64 value, DataType dt) {
+    const int bits = data_type_size(dt) * 8;
+    if (bits >= 64) {
+      return true;
+    }
+    const int64 bound = (int64)1 << (bits - 1);
+    return -bound <= value && value < bound;
+  }
+
+  // Whether |x| * |factor| in the type |dt| takes distinct values for the
+  // distinct values of |x|.
+  bool is_injective_scaling(Stmt *x,
+                            std::optional<int64> factor,
+                            DataType dt) const {
+    if (!factor || *factor == 0 || !is_integral(dt)) {
+      return false;
+    }
+    if (*factor % 2 != 0) {
+      return true;
+    }
+    auto it = range_.find(x);
+    if (it == range_.end() || !is_signed(dt)) {
+      return false;
+    }
+    int64 lo, hi;
+    if (__builtin_mul_overflow(it->second.first, *factor, &lo) ||
+        __builtin_mul_overflow(it->second.second, *factor, &hi)) {
+      return false;
+    }
+    return fits_in(lo, dt) && fits_in(hi, dt);
+  }
+
+  static std::optional<int64> get_int_const(Stmt *stmt) {
+    auto const_stmt = stmt->cast<ConstStmt>();
+    if (!const_stmt || !is_integral(const_stmt->ret_type)) {
+      return std::nullopt;
+    }
+    return const_stmt->val[0].val_as_int64();
   }
 
   bool is_ptr_indices_loop_unique(GlobalPtrStmt *stmt) const {
@@ -0,0 +1,216 @@
+#include "taichi/ir/ir.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/frontend_ir.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/visitors.h"
+
+#include <vector>
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+// Positions of the statements in the order they are hashed, so that the
+// operands are hashed by the distance to their definitions rather than by
+// their ids.
+//
+// An open-addressing hash table, reused by the calls on a thread, which does
+// not allocate once it has grown to the size of the largest IR hashed.
+// Clearing it only bumps the generation of the valid slots.
+class StmtPositions {
+ public:
+  void clear() {
+    generation_++;
+    size_ = 0;
+  }
+
+  void insert(const Stmt *stmt, int position) {
+    if (2 * (size_ + 1) > slots_.size()) {
+      grow();
+    }
+    Slot &slot = find_slot(stmt);
+    if (slot.generation != generation_) {
+      slot = Slot{stmt, position, generation_};
+      size_++;
+    }
+  }
+
+  // Returns -1 if |stmt| is not inserted.
+  int find(const Stmt *stmt) const {
+    if (slots_.empty()) {
+      return -1;
+    }
+    const Slot &slot = const_cast<StmtPositions *>(this)->find_slot(stmt);
+    return slot.generation == generation_ ? slot.position : -1;
+  }
+
+ private:
+  struct Slot {
+    const Stmt *stmt{nullptr};
+    int position{0};
+    uint64 generation{0};
+  };
+
+  Slot &find_slot(const Stmt *stmt) {
+    const std::size_t mask = slots_.size() - 1;
+    std::size_t i = hash_combine(0, (uint64)(uintptr_t)stmt) & mask;
+    while (slots_[i].generation == generation_ && slots_[i].stmt != stmt) {
+      i = (i + 1) & mask;
+    }
+    return slots_[i];
+  }
+
+  void grow() {
+    std::vector<Slot> old_slots(std::max<std::size_t>(64, 2 * slots_.size()));
+    std::swap(old_slots, slots_);
+    for (const auto &slot : old_slots) {
+      if (slot.generation == generation_) {
+        find_slot(slot.stmt) = slot;
+      }
+    }
+  }
+
+  std::vector<Slot> slots_;
+  std::size_t size_{0};
+  // Starts from 1 so that the default slots are invalid.
+  uint64 generation_{1};
+};
+
+enum class StmtTypeId {
+#define PER_STATEMENT(x) x,
+#include "taichi/inc/statements.inc.h"
+#undef PER_STATEMENT
+};
+
+// Markers separating the parts of the IR, so that e.g. a statement at the end
+// of a block and one after it do not hash the same.
+constexpr uint64 kBlockBegin = 0x626567696eULL;
+constexpr uint64 kBlockEnd = 0x656e64ULL;
+constexpr uint64 kNoBlock = 0x6e6f6e65ULL;
+constexpr uint64 kNullOperand = 0x6e756c6cULL;
+constexpr uint64 kExternalOperand = 0x657874ULL;
+
+}  // namespace
+
+class IRHasher : public IRVisitor {
+ public:
+  IRHasher() {
+    allow_undefined_visitor = true;
+    invoke_default_visitor = false;
+  }
+
+  void visit(Block *stmt_list) override {
+    mix(kBlockBegin);
+    for (auto &stmt : stmt_list->statements) {
+      stmt->accept(this);
+    }
+    mix(kBlockEnd);
+  }
+
+#define PER_STATEMENT(x)          \
+  void visit(x *stmt) override {   \
+    hash_stmt(stmt, StmtTypeId::x); \
+    hash_blocks(stmt);             \
+  }
+#include "taichi/inc/statements.inc.h"
+#undef PER_STATEMENT
+
+  static uint64 run(IRNode *root) {
+    TI_ASSERT(root);
+    thread_local StmtPositions positions;
+    positions.clear();
+    IRHasher hasher(&positions);
+    root->accept(&hasher);
+    return hasher.hash_;
+  }
+
+ private:
+  explicit IRHasher(StmtPositions *positions) : IRHasher() {
+    positions_ = positions;
+  }
+
+  void mix(uint64 value) {
+    hash_ = hash_combine(hash_, value);
+  }
+
+  void hash_stmt(Stmt *stmt, StmtTypeId type_id) {
+    const int position = num_stmts_++;
+    positions_->insert(stmt, position);
+    mix((uint64)type_id);
+    mix(stmt->field_manager.hash());
+    const int num_operands = stmt->num_operands();
+    mix(num_operands);
+    for (int i = 0; i < num_operands; i++) {
+      Stmt *operand = stmt->operand(i);
+      if (operand == nullptr) {
+        mix(kNullOperand);
+        continue;
+      }
+      const int def_position = positions_->find(operand);
+      if (def_position == -1) {
+        // Defined outside of the root, so the id is the best we have.
+        mix(kExternalOperand);
+        mix(operand->id);
+      } else {
+        mix(position - def_position);
+      }
+    }
+  }
+
+  void hash_block(Block *block) {
+    if (block) {
+      block->accept(this);
+    } else {
+      mix(kNoBlock);
+    }
+  }
+
+  void hash_blocks(Stmt *stmt) {
+  }
+
+  void hash_blocks(IfStmt *stmt) {
+    hash_block(stmt->true_statements.get());
+    hash_block(stmt->false_statements.get());
+  }
+
+  void hash_blocks(WhileStmt *stmt) {
+    hash_block(stmt->body.get());
+  }
+
+  void hash_blocks(RangeForStmt *stmt) {
+    hash_block(stmt->body.get());
+  }
+
+  void hash_blocks(StructForStmt *stmt) {
+    hash_block(stmt->body.get());
+  }
+
+  void hash_blocks(MeshForStmt *stmt) {
+    hash_block(stmt->body.get());
+  }
+
+  void hash_blocks(FuncBodyStmt *stmt) {
+    hash_block(stmt->body.get());
+  }
+
+  void hash_blocks(OffloadedStmt *stmt) {
+    hash_block(stmt->tls_prologue.get());
+    hash_block(stmt->mesh_prologue.get());
+    hash_block(stmt->bls_prologue.get());
+    hash_block(stmt->body.get());
+    hash_block(stmt->bls_epilogue.get());
+    hash_block(stmt->tls_epilogue.get());
+  }
+
+  StmtPositions *positions_{nullptr};
+  int num_stmts_{0};
+  uint64 hash_{0};
+};
+
+namespace irpass::analysis {
+uint64 hash(IRNode *root) {
+  return IRHasher::run(root);
+}
+}  // namespace irpass::analysis
+
+TLANG_NAMESPACE_END
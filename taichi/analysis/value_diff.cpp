@@ -200,6 +200,17 @@ DiffRange value_diff_loop_index(Stmt *stmt, Stmt *loop, int index_id) {
   return diff.run();
 }
 
+DiffRange value_range(Stmt *stmt) {
+  TI_ASSERT(stmt->width() == 1);
+  // Not related to any loop, so that the indices of the range-fors are
+  // replaced with their bounds.
+  auto range = ValueDiffLoopIndex(stmt, 0, nullptr, 0).run();
+  if (range.related() && range.coeff != 0) {
+    return DiffRange();
+  }
+  return range;
+}
+
 DiffPtrResult value_diff_ptr_index(Stmt *val1, Stmt *val2) {
   if (val1 == val2) {
     return DiffPtrResult::make_certain(0);
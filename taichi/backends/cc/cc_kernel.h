@@ -23,10 +23,12 @@ class CCKernel {
         source_(source) {
   }
 
+  // The kernel is compiled along with the other pending ones on the next
+  // CCProgramImpl::relink().
   void compile();
   void launch(RuntimeContext *ctx);
-  std::string get_object() {
-    return obj_path_;
+  std::string const &get_source() const {
+    return source_;
   }
 
  private:
@@ -35,9 +37,6 @@ class CCKernel {
 
   std::string name_;
   std::string source_;
-
-  std::string src_path_;
-  std::string obj_path_;
 };
 
 }  // namespace cccp
@@ -23,7 +23,6 @@ class CCLayout {
  private:
   CCProgramImpl *cc_program_impl_{nullptr};
 
-  std::string src_path_;
   std::string obj_path_;
 };
 
@@ -1,11 +1,26 @@
 #include "taichi/backends/cc/cc_program.h"
 
+#include <cstdio>
+#include <functional>
+
+#include "taichi/util/io.h"
+
 using namespace taichi::lang::cccp;
 
 TLANG_NAMESPACE_BEGIN
 
 CCProgramImpl::CCProgramImpl(CompileConfig &config) : ProgramImpl(config) {
   this->config = &config;
+  if (config.offline_cache) {
+    auto path = config.offline_cache_file_path;
+    if (path.empty()) {
+      path = get_repo_dir() + "ticache";
+    }
+    object_cache_dir_ = fmt::format("{}/{}", path, arch_name(Arch::cc));
+  } else {
+    object_cache_dir_ = runtime_tmp_dir;
+  }
+  create_directories(object_cache_dir_);
   runtime_ = std::make_unique<CCRuntime>(this,
 #include "runtime/base.h"
                                          "\n",
@@ -62,10 +77,58 @@ void CCProgramImpl::materialize_snode_tree(
 }
 
 void CCProgramImpl::add_kernel(std::unique_ptr<CCKernel> kernel) {
+  pending_kernels_.push_back(kernel.get());
   kernels_.push_back(std::move(kernel));
   need_relink_ = true;
 }
 
+std::string CCProgramImpl::compile_to_object(std::string const &source) {
+  // The command is part of the key, since it determines the object code.
+  const auto &cmd = config->cc_compile_cmd;
+  const auto key = fmt::format("{:016x}", std::hash<std::string>{}(
+                                              cmd + "\n" + source));
+  const auto src_path = fmt::format("{}/{}.c", object_cache_dir_, key);
+  const auto obj_path = fmt::format("{}/{}.o", object_cache_dir_, key);
+  const auto full_source = fmt::format("/* {} */\n{}", cmd, source);
+
+  // Guard against hash collisions by comparing the whole source.
+  std::ifstream cached_src(src_path);
+  if (cached_src && std::ifstream(obj_path)) {
+    std::stringstream ss;
+    ss << cached_src.rdbuf();
+    if (ss.str() == full_source) {
+      TI_DEBUG("[cc] reusing cached object [{}]", obj_path);
+      return obj_path;
+    }
+  }
+
+  // Compile to temporary paths first, so that other processes sharing the
+  // cache never see a partially written object file.
+  const auto tmp_suffix = fmt::format(".{}.tmp", PID::get_pid());
+  std::ofstream(src_path + tmp_suffix) << full_source;
+  TI_DEBUG("[cc] compiling [{}]:\n{}\n", obj_path, source);
+  const int ret = execute(cmd, obj_path + tmp_suffix, src_path + tmp_suffix);
+  TI_ERROR_IF(ret != 0, "[cc] failed to compile [{}]", src_path + tmp_suffix);
+  std::rename((obj_path + tmp_suffix).c_str(), obj_path.c_str());
+  std::rename((src_path + tmp_suffix).c_str(), src_path.c_str());
+  return obj_path;
+}
+
+void CCProgramImpl::compile_pending_kernels() {
+  if (pending_kernels_.empty())
+    return;
+
+  std::stringstream source;
+  source << runtime_->header << "\n" << layout_->source << "\n";
+  for (auto *ker : pending_kernels_) {
+    source << ker->get_source() << "\n";
+  }
+  TI_DEBUG("[cc] compiling {} kernel(s) in one translation unit",
+           pending_kernels_.size());
+  kernel_objects_.push_back(compile_to_object(source.str()));
+  pending_kernels_.clear();
+}
+
 void CCKernel::compile() {
   if (!kernel_->is_evaluator)
     ActionRecorder::get_instance().record(
@@ -73,15 +136,6 @@ void CCKernel::compile() {
                               ActionArg("kernel_name", name_),
                               ActionArg("kernel_source", source_),
                           });
-
-  obj_path_ = fmt::format("{}/{}.o", runtime_tmp_dir, name_);
-  src_path_ = fmt::format("{}/{}.c", runtime_tmp_dir, name_);
-
-  std::ofstream(src_path_) << cc_program_impl_->get_runtime()->header << "\n"
-                           << cc_program_impl_->get_layout()->source << "\n"
-                           << source_;
-  TI_DEBUG("[cc] compiling [{}] -> [{}]:\n{}\n", name_, obj_path_, source_);
-  execute(cc_program_impl_->config->cc_compile_cmd, obj_path_, src_path_);
 }
 
 void CCRuntime::compile() {
@@ -91,12 +145,8 @@ void CCRuntime::compile() {
                                             ActionArg("runtime_source", source),
                                         });
 
-  obj_path_ = fmt::format("{}/_rti_runtime.o", runtime_tmp_dir);
-  src_path_ = fmt::format("{}/_rti_runtime.c", runtime_tmp_dir);
-
-  std::ofstream(src_path_) << header << "\n" << source;
-  TI_DEBUG("[cc] compiling runtime -> [{}]:\n{}\n", obj_path_, source);
-  execute(cc_program_impl_->config->cc_compile_cmd, obj_path_, src_path_);
+  TI_DEBUG("[cc] compiling runtime");
+  obj_path_ = cc_program_impl_->compile_to_object(header + "\n" + source);
 }
 
 void CCKernel::launch(RuntimeContext *ctx) {
@@ -122,18 +172,17 @@ size_t CCLayout::compile() {
                                             ActionArg("layout_source", source),
                                         });
 
-  obj_path_ = fmt::format("{}/_rti_root.o", runtime_tmp_dir);
-  src_path_ = fmt::format("{}/_rti_root.c", runtime_tmp_dir);
   auto dll_path = fmt::format("{}/libti_roottest.so", runtime_tmp_dir);
 
-  std::ofstream(src_path_) << cc_program_impl_->get_runtime()->header << "\n"
-                           << source << "\n"
-                           << "void *Ti_get_root_size(void) { \n"
-                           << "  return (void *) sizeof(struct Ti_S0root);\n"
-                           << "}\n";
+  std::stringstream root_source;
+  root_source << cc_program_impl_->get_runtime()->header << "\n"
+              << source << "\n"
+              << "void *Ti_get_root_size(void) { \n"
+              << "  return (void *) sizeof(struct Ti_S0root);\n"
+              << "}\n";
 
-  TI_DEBUG("[cc] compiling root struct -> [{}]:\n{}\n", obj_path_, source);
-  execute(cc_program_impl_->config->cc_compile_cmd, obj_path_, src_path_);
+  TI_DEBUG("[cc] compiling root struct");
+  obj_path_ = cc_program_impl_->compile_to_object(root_source.str());
 
   TI_DEBUG("[cc] linking root struct object [{}] -> [{}]", obj_path_, dll_path);
   execute(cc_program_impl_->config->cc_link_cmd, dll_path, obj_path_);
@@ -154,12 +203,13 @@ void CCProgramImpl::relink() {
   if (!need_relink_)
     return;
 
+  compile_pending_kernels();
   dll_path_ = fmt::format("{}/libti_program.so", runtime_tmp_dir);
 
   std::vector<std::string> objects;
   objects.push_back(runtime_->get_object());
-  for (auto const &ker : kernels_) {
-    objects.push_back(ker->get_object());
+  for (auto const &obj : kernel_objects_) {
+    objects.push_back(obj);
   }
 
   TI_DEBUG("[cc] linking shared object [{}] with [{}]", dll_path_,
@@ -72,13 +72,25 @@ class CCProgramImpl : public ProgramImpl {
   CCFuncEntryType *load_kernel(std::string const &name);
   void relink();
 
+  // Compiles |source| into an object file with cc_compile_cmd, unless an
+  // object file compiled from the same source with the same command is
+  // already cached. Returns the path to the object file.
+  std::string compile_to_object(std::string const &source);
+
   CCContext *update_context(RuntimeContext *ctx);
   void context_to_result_buffer();
 
  private:
   void add_kernel(std::unique_ptr<CCKernel> kernel);
+  // Compiles all the pending kernels in a single translation unit.
+  void compile_pending_kernels();
 
   std::vector<std::unique_ptr<CCKernel>> kernels_;
+  std::vector<CCKernel *> pending_kernels_;
+  std::vector<std::string> kernel_objects_;
+  // Holds the object files by the hash of their sources. This is the offline
+  // cache directory if the offline cache is enabled.
+  std::string object_cache_dir_;
   std::unique_ptr<CCContext> context_;
   std::unique_ptr<CCRuntime> runtime_;
   std::unique_ptr<CCLayout> layout_;
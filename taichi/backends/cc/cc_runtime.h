@@ -26,7 +26,6 @@ class CCRuntime {
 
  private:
   CCProgramImpl *cc_program_impl_{nullptr};
-  std::string src_path_;
   std::string obj_path_;
 };
 
@@ -31,6 +31,8 @@ class CCTransformer : public IRVisitor {
   LineAppender line_appender_;
   LineAppender line_appender_header_;
   bool is_top_level_{true};
+  // Whether we are in the body of an OpenMP parallel range-for.
+  bool is_parallel_{false};
   GetRootStmt *root_stmt_;
 
  public:
@@ -52,7 +54,7 @@ class CCTransformer : public IRVisitor {
     auto config = kernel_->program->config;
     config.demote_dense_struct_fors = true;
     irpass::compile_to_executable(ir, config, kernel_,
-                                  /*vectorize=*/false, kernel_->grad,
+                                  /*vectorize=*/false, kernel_->autodiff_mode,
                                   /*ad_use_stack=*/true, config.print_ir,
                                   /*lower_global_access*/ true);
   }
@@ -384,9 +386,24 @@ class CCTransformer : public IRVisitor {
     const auto op = cc_atomic_op_type_symbol(stmt->op_type);
     const auto type = stmt->dest->element_type().ptr_removed();
     auto var = define_var(cc_data_type_name(type), stmt->raw_name());
+    const bool is_min_max = (stmt->op_type == AtomicOpType::max ||
+                             stmt->op_type == AtomicOpType::min);
+    if (is_parallel_) {
+      emit("{};", var);
+      if (is_min_max) {
+        // OpenMP has no atomic min/max before 5.1.
+        emit("#pragma omp critical(Ti_atomic_min_max)");
+        emit("{{ {} = *{}; *{} = {}; }}", stmt->raw_name(), dest_ptr,
+             dest_ptr, invoke_libc(op, type, "*{}, {}", dest_ptr, src_name));
+      } else {
+        emit("#pragma omp atomic capture");
+        emit("{{ {} = *{}; *{} {}= {}; }}", stmt->raw_name(), dest_ptr,
+             dest_ptr, op, src_name);
+      }
+      return;
+    }
     emit("{} = *{};", var, dest_ptr);
-    if (stmt->op_type == AtomicOpType::max ||
-        stmt->op_type == AtomicOpType::min) {
+    if (is_min_max) {
       emit("*{} = {};", dest_ptr,
            invoke_libc(op, type, "*{}, {}", dest_ptr, src_name));
     } else {
@@ -421,12 +438,25 @@ class CCTransformer : public IRVisitor {
     stmt->body->accept(this);
   }
 
+  // The iterations of a range-for are independent, so it runs in parallel on
+  // all the cores. The pragma is ignored unless compiled with -fopenmp.
+  void emit_omp_parallel_for() {
+    const int num_threads = kernel_->program->config.cpu_max_num_threads;
+    if (num_threads > 0) {
+      emit("#pragma omp parallel for num_threads({})", num_threads);
+    } else {
+      emit("#pragma omp parallel for");
+    }
+  }
+
   void generate_range_for_kernel(OffloadedStmt *stmt) {
+    is_parallel_ = true;
     if (stmt->const_begin && stmt->const_end) {
       ScopedIndent _s(line_appender_);
       auto begin_value = stmt->begin_value;
       auto end_value = stmt->end_value;
       auto var = define_var("Ti_i32", stmt->raw_name());
+      emit_omp_parallel_for();
       emit("for ({} = {}; {} < {}; {} += {}) {{", var, begin_value,
            stmt->raw_name(), end_value, stmt->raw_name(), 1 /* stmt->step? */);
       stmt->body->accept(this);
@@ -449,11 +479,13 @@ class CCTransformer : public IRVisitor {
       } else {
         emit("{} = {};", end_var, stmt->end_value);
       }
+      emit_omp_parallel_for();
       emit("for ({} = {}; {} < {}; {} += {}) {{", var, begin_expr,
            stmt->raw_name(), end_expr, stmt->raw_name(), 1 /* stmt->step? */);
       stmt->body->accept(this);
       emit("}}");
     }
+    is_parallel_ = false;
   }
 
   void visit(OffloadedStmt *stmt) override {
@@ -2,4 +2,9 @@
 // clang-format off
 #include "taichi/util/macros.h"
 STR(
+
+__thread Ti_u16 Ti_rand_state[3];
+__thread Ti_i32 Ti_rand_seeded;
+Ti_i32 Ti_rand_num_threads;
+
 )
@@ -67,20 +67,40 @@ static inline Ti_f64 Ti_rsqrt(Ti_f64 x) {
 
 ) "\n" STR(
 
+// drand48() and mrand48() share one hidden state, which the OpenMP threads of
+// a range-for would race on. Each thread has its own state instead, defined in
+// base.c and seeded on first use with the index of the thread.
+extern __thread Ti_u16 Ti_rand_state[3];
+extern __thread Ti_i32 Ti_rand_seeded;
+extern Ti_i32 Ti_rand_num_threads;
+
+static inline Ti_u16 *Ti_rand_thread_state(void) {
+  if (!Ti_rand_seeded) {
+    Ti_i32 id = __atomic_fetch_add(&Ti_rand_num_threads, 1, __ATOMIC_RELAXED);
+    // The first thread starts from the default state of drand48().
+    Ti_rand_state[0] = 0x330E;
+    Ti_rand_state[1] = 0xABCD ^ (id & 0xFFFF);
+    Ti_rand_state[2] = 0x1234 ^ ((id >> 16) & 0xFFFF);
+    Ti_rand_seeded = 1;
+  }
+  return Ti_rand_state;
+}
+
 static inline Ti_i32 Ti_rand_i32(void) {
-  return mrand48();  // includes negative
+  return jrand48(Ti_rand_thread_state());  // includes negative
 }
 
 static inline Ti_i64 Ti_rand_i64(void) {
-  return ((Ti_i64) mrand48() << 32) | mrand48();
+  Ti_u16 *state = Ti_rand_thread_state();
+  return ((Ti_i64) jrand48(state) << 32) | (Ti_u32) jrand48(state);
 }
 
 static inline Ti_f64 Ti_rand_f64(void) {
-  return drand48();  // [0.0, 1.0)
+  return erand48(Ti_rand_thread_state());  // [0.0, 1.0)
 }
 
 static inline Ti_f32 Ti_rand_f32(void) {
-  return (Ti_f32) drand48();  // [0.0, 1.0)
+  return (Ti_f32) erand48(Ti_rand_thread_state());  // [0.0, 1.0)
 }
 
 // Copied from Metal:
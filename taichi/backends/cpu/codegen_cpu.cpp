@@ -6,6 +6,7 @@
 #include "taichi/util/io.h"
 #include "taichi/lang_util.h"
 #include "taichi/program/program.h"
+#include "taichi/ir/analysis.h"
 #include "taichi/ir/ir.h"
 #include "taichi/ir/statements.h"
 #include "taichi/util/statistics.h"
@@ -21,6 +22,11 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
   }
 
   void create_offload_range_for(OffloadedStmt *stmt) override {
+    if (should_vectorize_range_for(stmt)) {
+      create_offload_vectorized_range_for(stmt);
+      return;
+    }
+
     int step = 1;
 
     // In parallel for-loops reversing the order doesn't make sense.
@@ -54,10 +60,90 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
     create_call(
         "cpu_parallel_range_for",
         {get_arg(0), tlctx->get_constant(stmt->num_cpu_threads), begin, end,
-         tlctx->get_constant(step), tlctx->get_constant(stmt->block_dim),
+         tlctx->get_constant(step), get_range_for_block_dim(stmt, begin, end),
          tls_prologue, body, epilogue, tlctx->get_constant(stmt->tls_size)});
   }
 
+  llvm::Value *get_range_for_block_dim(OffloadedStmt *stmt,
+                                       llvm::Value *begin,
+                                       llvm::Value *end) {
+    llvm::Value *block_dim = tlctx->get_constant(stmt->block_dim);
+    if (prog->config.deterministic_reduction && stmt->tls_epilogue) {
+      // The TLS epilogue may store partial sums by task, see
+      // make_thread_local().
+      block_dim = create_call("cpu_deterministic_block_dim",
+                              {builder->CreateSub(end, begin), block_dim});
+    }
+    return block_dim;
+  }
+
+  bool should_vectorize_range_for(OffloadedStmt *stmt) {
+    return prog->config.cpu_vectorize_range_for && !stmt->reversed &&
+           is_innermost_loop(stmt);
+  }
+
+  // Unlike create_offload_range_for, the body function iterates over a whole
+  // block, so that the loop is visible to (and forcibly vectorized by) LLVM
+  // instead of being hidden behind a function pointer call in the runtime.
+  void create_offload_vectorized_range_for(OffloadedStmt *stmt) {
+    auto *tls_prologue = create_xlogue(stmt->tls_prologue);
+
+    llvm::Function *body;
+    {
+      auto guard = get_function_creation_guard(
+          {llvm::PointerType::get(get_runtime_type("RuntimeContext"), 0),
+           llvm::Type::getInt8PtrTy(*llvm_context),
+           tlctx->get_data_type<int>(), tlctx->get_data_type<int>()});
+
+      auto loop_var = create_entry_block_alloca(PrimitiveType::i32);
+      loop_vars_llvm[stmt].push_back(loop_var);
+      builder->CreateStore(get_arg(2), loop_var);
+
+      auto loop_test =
+          llvm::BasicBlock::Create(*llvm_context, "block_loop_test", func);
+      auto loop_body =
+          llvm::BasicBlock::Create(*llvm_context, "block_loop_body", func);
+      auto loop_inc =
+          llvm::BasicBlock::Create(*llvm_context, "block_loop_inc", func);
+      auto after_loop =
+          llvm::BasicBlock::Create(*llvm_context, "block_after_loop", func);
+      builder->CreateBr(loop_test);
+
+      builder->SetInsertPoint(loop_test);
+      auto cond = builder->CreateICmp(llvm::CmpInst::Predicate::ICMP_SLT,
+                                      builder->CreateLoad(loop_var), get_arg(3));
+      builder->CreateCondBr(cond, loop_body, after_loop);
+
+      {
+        // A continue stmt in the offloaded body jumps to the next index
+        // instead of returning, see visit(ContinueStmt *).
+        auto *old_loop_reentry = current_loop_reentry;
+        current_loop_reentry = loop_inc;
+        builder->SetInsertPoint(loop_body);
+        stmt->body->accept(this);
+        current_loop_reentry = old_loop_reentry;
+      }
+      builder->CreateBr(loop_inc);
+
+      builder->SetInsertPoint(loop_inc);
+      create_increment(loop_var, tlctx->get_constant(1));
+      auto *latch = builder->CreateBr(loop_test);
+      latch->setMetadata(llvm::LLVMContext::MD_loop,
+                         get_vectorize_loop_metadata(prog->config.simd_width));
+
+      builder->SetInsertPoint(after_loop);
+      body = guard.body;
+    }
+
+    llvm::Value *epilogue = create_xlogue(stmt->tls_epilogue);
+
+    auto [begin, end] = get_range_for_bounds(stmt);
+    create_call("cpu_parallel_block_range_for",
+                {get_arg(0), tlctx->get_constant(stmt->num_cpu_threads), begin,
+                 end, get_range_for_block_dim(stmt, begin, end), tls_prologue,
+                 body, epilogue, tlctx->get_constant(stmt->tls_size)});
+  }
+
   void create_offload_mesh_for(OffloadedStmt *stmt) override {
     auto *tls_prologue = create_mesh_xlogue(stmt->tls_prologue);
 
@@ -194,4 +280,9 @@ FunctionType CodeGenCPU::codegen() {
   return CodeGenLLVMCPU(kernel, ir).gen();
 }
 
+std::unique_ptr<LlvmModuleGenValue> CodeGenCPU::modulegen() {
+  TI_AUTO_PROF
+  return CodeGenLLVMCPU(kernel, ir).modulegen();
+}
+
 TLANG_NAMESPACE_END
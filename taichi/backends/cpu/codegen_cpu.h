@@ -6,12 +6,18 @@
 
 TLANG_NAMESPACE_BEGIN
 
+struct LlvmModuleGenValue;
+
 class CodeGenCPU : public KernelCodeGen {
  public:
   CodeGenCPU(Kernel *kernel, IRNode *ir = nullptr) : KernelCodeGen(kernel, ir) {
   }
 
   FunctionType codegen() override;
+
+#ifdef TI_WITH_LLVM
+  std::unique_ptr<LlvmModuleGenValue> modulegen();  // AOT Module Gen
+#endif
 };
 
 TLANG_NAMESPACE_END
@@ -1,5 +1,11 @@
 #include "taichi/backends/cpu/cpu_device.h"
 
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+#include "taichi/system/device_memory_tracker.h"
+
 namespace taichi {
 namespace lang {
 
@@ -14,6 +20,9 @@ DeviceAllocation CpuDevice::allocate_memory(const AllocParams &params) {
   AllocInfo info;
 
   auto vm = std::make_unique<VirtualMemoryAllocator>(params.size);
+  if (huge_pages_) {
+    vm->advise_huge_pages();
+  }
   info.ptr = vm->ptr;
   info.size = vm->size;
   info.use_cached = false;
@@ -24,9 +33,42 @@ DeviceAllocation CpuDevice::allocate_memory(const AllocParams &params) {
 
   allocations_.push_back(info);
   virtual_memories_[alloc.alloc_id] = std::move(vm);
+  DeviceMemoryTracker::get_instance().record_allocation(this, alloc.alloc_id,
+                                                        info.size);
   return alloc;
 }
 
+std::pair<std::size_t, std::size_t> CpuDevice::get_huge_page_coverage() {
+  // The start and the end of each range.
+  std::map<uint64, uint64> ranges;
+  std::size_t total_bytes = 0;
+  for (auto &[_, vm] : virtual_memories_) {
+    if (vm) {
+      ranges[(uint64)vm->ptr] = (uint64)vm->ptr + vm->size;
+      total_bytes += vm->size;
+    }
+  }
+  std::size_t huge_page_bytes = 0;
+#if defined(TI_PLATFORM_LINUX)
+  // The OS may split a range into several mappings, but does not merge it
+  // with the neighbouring ones as their flags differ.
+  std::ifstream smaps("/proc/self/smaps");
+  std::string line;
+  bool in_range = false;
+  while (std::getline(smaps, line)) {
+    unsigned long long begin, end, kb;
+    if (std::sscanf(line.c_str(), "%llx-%llx ", &begin, &end) == 2) {
+      auto it = ranges.upper_bound(begin);
+      in_range = it != ranges.begin() && begin < std::prev(it)->second;
+    } else if (in_range &&
+               std::sscanf(line.c_str(), "AnonHugePages: %llu kB", &kb) == 1) {
+      huge_page_bytes += kb * 1024;
+    }
+  }
+#endif
+  return {huge_page_bytes, total_bytes};
+}
+
 DeviceAllocation CpuDevice::allocate_memory_runtime(
     const LlvmRuntimeAllocParams &params) {
   AllocInfo info;
@@ -39,6 +81,9 @@ DeviceAllocation CpuDevice::allocate_memory_runtime(
   alloc.device = this;
 
   allocations_.push_back(info);
+  // Out of the memory pool of the runtime.
+  DeviceMemoryTracker::get_instance().record_allocation(
+      this, alloc.alloc_id, info.size, /*nested=*/true);
   return alloc;
 }
 
@@ -48,6 +93,12 @@ void CpuDevice::dealloc_memory(DeviceAllocation handle) {
   if (info.ptr == nullptr) {
     TI_ERROR("the DeviceAllocation is already deallocated");
   }
+  if (info.is_imported) {
+    release_imported_memory(handle);
+    return;
+  }
+  DeviceMemoryTracker::get_instance().record_deallocation(this,
+                                                          handle.alloc_id);
   if (!info.use_cached) {
     // Use at() to ensure that the memory is allocated, and not imported
     virtual_memories_.at(handle.alloc_id).reset();
@@ -59,15 +110,29 @@ DeviceAllocation CpuDevice::import_memory(void *ptr, size_t size) {
   AllocInfo info;
   info.ptr = ptr;
   info.size = size;
+  info.is_imported = true;
 
   DeviceAllocation alloc;
-  alloc.alloc_id = allocations_.size();
   alloc.device = this;
-
-  allocations_.push_back(info);
+  if (!free_imported_ids_.empty()) {
+    alloc.alloc_id = free_imported_ids_.back();
+    free_imported_ids_.pop_back();
+    allocations_[alloc.alloc_id] = info;
+  } else {
+    alloc.alloc_id = allocations_.size();
+    allocations_.push_back(info);
+  }
   return alloc;
 }
 
+void CpuDevice::release_imported_memory(DeviceAllocation handle) {
+  validate_device_alloc(handle);
+  AllocInfo &info = allocations_[handle.alloc_id];
+  TI_ASSERT(info.is_imported && info.ptr != nullptr);
+  info = AllocInfo();
+  free_imported_ids_.push_back(handle.alloc_id);
+}
+
 uint64 CpuDevice::fetch_result_uint64(int i, uint64 *result_buffer) {
   uint64 ret = result_buffer[i];
   return ret;
@@ -80,11 +80,22 @@ class CpuDevice : public Device {
   struct AllocInfo {
     void *ptr{nullptr};
     size_t size{0};
+    bool is_imported{false};
     bool use_cached{false};
   };
 
+  // With |huge_pages|, the memory allocated is backed by transparent huge
+  // pages where the OS supports them.
+  explicit CpuDevice(bool huge_pages = false) : huge_pages_(huge_pages) {
+  }
+
   AllocInfo get_alloc_info(DeviceAllocation handle);
 
+  // The bytes of the memory allocated by allocate_memory() that are backed by
+  // huge pages at the moment, and the bytes allocated. The former is only
+  // known on Linux, and 0 elsewhere.
+  std::pair<std::size_t, std::size_t> get_huge_page_coverage();
+
   ~CpuDevice() override{};
 
   DeviceAllocation allocate_memory(const AllocParams &params) override;
@@ -105,6 +116,10 @@ class CpuDevice : public Device {
   void unmap(DeviceAllocation alloc) override{TI_NOT_IMPLEMENTED};
 
   DeviceAllocation import_memory(void *ptr, size_t size);
+  // Forgets an allocation made by import_memory() without freeing the memory,
+  // which its importer owns. dealloc_memory() forwards imported allocations
+  // here.
+  void release_imported_memory(DeviceAllocation handle);
 
   void memcpy_internal(DevicePtr dst, DevicePtr src, uint64_t size) override{
       TI_NOT_IMPLEMENTED};
@@ -113,8 +128,11 @@ class CpuDevice : public Device {
 
  private:
   std::vector<AllocInfo> allocations_;
+  // The ids of the released imported allocations, reused by import_memory().
+  std::vector<uint32_t> free_imported_ids_;
   std::unordered_map<int, std::unique_ptr<VirtualMemoryAllocator>>
       virtual_memories_;
+  bool huge_pages_{false};
 
   void validate_device_alloc(DeviceAllocation alloc) {
     if (allocations_.size() <= alloc.alloc_id) {
@@ -0,0 +1,90 @@
+#include "taichi/backends/cpu/cpu_target.h"
+
+#include <memory>
+#include <vector>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/Module.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetRegistry.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+std::unique_ptr<llvm::MCSubtargetInfo> create_subtarget_info(
+    const CpuTarget &target) {
+  const auto triple = llvm::sys::getProcessTriple();
+  std::string err_str;
+  const auto *llvm_target = llvm::TargetRegistry::lookupTarget(triple, err_str);
+  TI_ERROR_UNLESS(llvm_target, err_str);
+  return std::unique_ptr<llvm::MCSubtargetInfo>(
+      llvm_target->createMCSubtargetInfo(triple, target.cpu, target.features));
+}
+
+}  // namespace
+
+CpuTarget get_cpu_target(const CompileConfig &config) {
+  CpuTarget target;
+  std::vector<std::string> features;
+  if (config.cpu_target.empty()) {
+    target.cpu = llvm::sys::getHostCPUName().str();
+    // Also the features that the CPU name does not imply, as
+    // JITTargetMachineBuilder::detectHost() does.
+    llvm::StringMap<bool> host_features;
+    if (llvm::sys::getHostCPUFeatures(host_features)) {
+      for (const auto &feature : host_features) {
+        features.push_back((feature.second ? "+" : "-") +
+                           feature.first().str());
+      }
+    }
+  } else {
+    target.cpu = config.cpu_target;
+    auto sti = create_subtarget_info(target);
+    TI_ERROR_IF(!sti || !sti->isCPUStringValid(target.cpu),
+                "Unknown CPU \"{}\" for {}", target.cpu,
+                llvm::sys::getProcessTriple());
+  }
+  if (!config.cpu_features.empty()) {
+    // The later features take precedence.
+    features.push_back(config.cpu_features);
+  }
+  target.features = fmt::format("{}", fmt::join(features, ","));
+  return target;
+}
+
+bool host_supports_cpu_target(const CpuTarget &target) {
+  llvm::StringMap<bool> host_features;
+  if (!llvm::sys::getHostCPUFeatures(host_features)) {
+    // The features cannot be detected on some hosts, which then only run the
+    // code compiled for themselves.
+    return target.cpu == llvm::sys::getHostCPUName() &&
+           target.features.empty();
+  }
+  auto sti = create_subtarget_info(target);
+  if (!sti || !sti->isCPUStringValid(target.cpu)) {
+    return false;
+  }
+  for (const auto &feature : host_features) {
+    if (!feature.second &&
+        sti->checkFeatures("+" + feature.first().str())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void set_module_cpu_target(llvm::Module *module, const CpuTarget &target) {
+  for (auto &f : *module) {
+    if (f.isDeclaration()) {
+      continue;
+    }
+    // An empty "target-features" still overrides the features of the target
+    // machine, so that only those of |target.cpu| are used.
+    f.addFnAttr("target-cpu", target.cpu);
+    f.addFnAttr("target-features", target.features);
+  }
+}
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+#include "taichi/llvm/llvm_fwd.h"
+#include "taichi/program/compile_config.h"
+
+TLANG_NAMESPACE_BEGIN
+
+// The CPU that the kernels are compiled for, in the terms of LLVM.
+struct CpuTarget {
+  // E.g. "skylake-avx512", "znver3" or "neoverse-n1".
+  std::string cpu;
+  // Features on top of those of |cpu|, e.g. "+avx512f,-avx512vl".
+  std::string features;
+};
+
+// The target selected by CompileConfig::cpu_target and cpu_features. Defaults
+// to the host CPU.
+CpuTarget get_cpu_target(const CompileConfig &config);
+
+// Whether the host CPU supports all the features of |target|, i.e. the code
+// compiled for |target| runs on this machine.
+bool host_supports_cpu_target(const CpuTarget &target);
+
+// Sets the "target-cpu" and "target-features" attributes of the functions in
+// |module|, from which LLVM selects the instructions it may use.
+void set_module_cpu_target(llvm::Module *module, const CpuTarget &target);
+
+TLANG_NAMESPACE_END
@@ -7,6 +7,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/JITSymbol.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/Orc/Core.h"
 #include "llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
@@ -27,6 +28,8 @@
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
@@ -35,11 +38,14 @@
 #include "llvm/Transforms/IPO.h"
 #endif
 
+#include "taichi/backends/cpu/cpu_target.h"
+#include "taichi/ir/pass_profiler.h"
 #include "taichi/lang_util.h"
 #include "taichi/program/program.h"
 #include "taichi/jit/jit_session.h"
 #include "taichi/util/file_sequence_writer.h"
 #include "taichi/llvm/llvm_program.h"
+#include "taichi/llvm/llvm_offline_cache.h"
 
 TLANG_NAMESPACE_BEGIN
 
@@ -69,8 +75,31 @@ std::pair<JITTargetMachineBuilder, llvm::DataLayout> get_host_target_info() {
   return std::make_pair(jtmb, data_layout);
 }
 
+JITTargetMachineBuilder with_codegen_opt_level(JITTargetMachineBuilder jtmb,
+                                                CodeGenOpt::Level level) {
+  jtmb.setCodeGenOptLevel(level);
+  return jtmb;
+}
+
 class JITSessionCPU;
 
+// Bridges LLVM's object cache interface to the Taichi offline cache. Modules
+// are looked up by their identifier, which JITSessionCPU::add_module() sets to
+// the offline cache key.
+class ObjectCacheCPU : public llvm::ObjectCache {
+ public:
+  explicit ObjectCacheCPU(JITSessionCPU *session) : session_(session) {
+  }
+
+  void notifyObjectCompiled(const llvm::Module *M,
+                            llvm::MemoryBufferRef obj) override;
+
+  std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *M) override;
+
+ private:
+  JITSessionCPU *session_;
+};
+
 class JITModuleCPU : public JITModule {
  private:
   JITSessionCPU *session_;
@@ -91,30 +120,46 @@ class JITModuleCPU : public JITModule {
 class JITSessionCPU : public JITSession {
  private:
   ExecutionSession es_;
+  JITTargetMachineBuilder jtmb_;
   RTDyldObjectLinkingLayer object_layer_;
   IRCompileLayer compile_layer_;
+  // Generates code without optimization, and bypasses the offline cache.
+  IRCompileLayer unoptimized_compile_layer_;
   DataLayout dl_;
   MangleAndInterner mangle_;
   std::mutex mut_;
   std::vector<llvm::orc::JITDylib *> all_libs_;
   int module_counter_;
   SectionMemoryManager *memory_manager_;
+  ObjectCacheCPU object_cache_;
 
  public:
-  JITSessionCPU(JITTargetMachineBuilder JTMB, DataLayout DL)
-      : object_layer_(es_,
+  JITSessionCPU(TaichiLLVMContext *tlctx,
+                CompileConfig *config,
+                JITTargetMachineBuilder JTMB,
+                DataLayout DL)
+      : JITSession(tlctx, config),
+        jtmb_(JTMB),
+        object_layer_(es_,
                       [&]() {
                         auto smgr = std::make_unique<SectionMemoryManager>();
                         memory_manager_ = smgr.get();
                         return smgr;
                       }),
-        compile_layer_(es_,
-                       object_layer_,
-                       std::make_unique<ConcurrentIRCompiler>(JTMB)),
+        compile_layer_(
+            es_,
+            object_layer_,
+            std::make_unique<ConcurrentIRCompiler>(JTMB, &object_cache_)),
+        unoptimized_compile_layer_(
+            es_,
+            object_layer_,
+            std::make_unique<ConcurrentIRCompiler>(
+                with_codegen_opt_level(JTMB, CodeGenOpt::None))),
         dl_(DL),
         mangle_(es_, this->dl_),
         module_counter_(0),
-        memory_manager_(nullptr) {
+        memory_manager_(nullptr),
+        object_cache_(this) {
     if (JTMB.getTargetTriple().isOSBinFormatCOFF()) {
       object_layer_.setOverrideObjectFlagsWithResponsibilityFlags(true);
       object_layer_.setAutoClaimResponsibilityForObjectSymbols(true);
@@ -132,31 +177,89 @@ class JITSessionCPU : public JITSession {
   }
 
   void global_optimize_module(llvm::Module *module) override {
-    global_optimize_module_cpu(module);
+    global_optimize_module_cpu(module, get_cpu_target(*config_));
   }
 
   JITModule *add_module(std::unique_ptr<llvm::Module> M, int max_reg) override {
     TI_ASSERT(max_reg == 0);  // No need to specify max_reg on CPUs
     TI_ASSERT(M);
-    global_optimize_module_cpu(M.get());
+    const auto target = get_cpu_target(*config_);
+    auto *cache = offline_cache();
+    std::string key;
+    if (cache || config_->soft_reset) {
+      // Key on the unoptimized module, so that a cache hit skips both the
+      // optimization passes and the machine code generation.
+      key = LlvmOfflineCache::make_key(M.get(), offline_cache_salt(target));
+    }
+    if (config_->soft_reset) {
+      if (auto *module = find_compiled_module(key)) {
+        return module;
+      }
+    }
+    JITModule *module = nullptr;
+    if (cache && cache->shared()) {
+      module = add_module_with_shared_cache(std::move(M), key, cache);
+    } else {
+      bool cached = false;
+      if (cache) {
+        M->setModuleIdentifier(key);
+        cached = cache->contains(key);
+      }
+      if (!cached) {
+        global_optimize_module_cpu(M.get(), target);
+      }
+      std::lock_guard<std::mutex> _(mut_);
+      auto &dylib = create_dylib();
+      auto *thread_safe_context =
+          tlctx_->get_this_thread_thread_safe_context();
+      cantFail(compile_layer_.add(
+          dylib,
+          llvm::orc::ThreadSafeModule(std::move(M), *thread_safe_context)));
+      module = add_jit_module(dylib);
+    }
+    if (config_->soft_reset) {
+      record_compiled_module(key, module);
+    }
+    return module;
+  }
+
+  JITModule *add_module_unoptimized(std::unique_ptr<llvm::Module> M) override {
+    TI_ASSERT(M);
+    // None of the LLVM passes run, and the always-inline runtime functions
+    // are simply called.
+    M->setDataLayout(dl_);
+    set_module_cpu_target(M.get(),
+                          get_cpu_target(*config_));
     std::lock_guard<std::mutex> _(mut_);
-    auto &dylib = es_.createJITDylib(fmt::format("{}", module_counter_));
-    dylib.addGenerator(
-        cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
-            dl_.getGlobalPrefix())));
-    auto *thread_safe_context = get_current_program()
-                                    .get_llvm_program_impl()
-                                    ->get_llvm_context(host_arch())
-                                    ->get_this_thread_thread_safe_context();
-    cantFail(compile_layer_.add(
+    auto &dylib = create_dylib();
+    auto *thread_safe_context =
+        tlctx_->get_this_thread_thread_safe_context();
+    cantFail(unoptimized_compile_layer_.add(
         dylib,
         llvm::orc::ThreadSafeModule(std::move(M), *thread_safe_context)));
-    all_libs_.push_back(&dylib);
-    auto new_module = std::make_unique<JITModuleCPU>(this, &dylib);
-    auto new_module_raw_ptr = new_module.get();
-    modules.push_back(std::move(new_module));
-    module_counter_++;
-    return new_module_raw_ptr;
+    return add_jit_module(dylib);
+  }
+
+  std::string compile_module_to_binary(std::unique_ptr<llvm::Module> M,
+                                      const std::string &target) override {
+    TI_ASSERT(M);
+    global_optimize_module_cpu(
+        M.get(), target.empty() ? get_cpu_target(*config_)
+                                : CpuTarget{target, ""});
+    // Same code generation as the JIT, without the offline cache.
+    ConcurrentIRCompiler compiler(jtmb_);
+    auto obj = cantFail(compiler(*M));
+    return obj->getBuffer().str();
+  }
+
+  JITModule *add_binary(const std::string &binary, int max_reg) override {
+    TI_ASSERT(max_reg == 0);  // No need to specify max_reg on CPUs
+    std::lock_guard<std::mutex> _(mut_);
+    auto &dylib = create_dylib();
+    cantFail(object_layer_.add(
+        dylib, llvm::MemoryBuffer::getMemBufferCopy(
+                   binary, fmt::format("aot_object_{}", module_counter_))));
+    return add_jit_module(dylib);
   }
 
   void *lookup(const std::string Name) override {
@@ -183,20 +286,84 @@ class JITSessionCPU : public JITSession {
     return (void *)(symbol->getAddress());
   }
 
+  LlvmOfflineCache *offline_cache() {
+    return get_offline_cache(host_arch());
+  }
+
  private:
-  static void global_optimize_module_cpu(llvm::Module *module);
+  std::string offline_cache_salt(const CpuTarget &target) const {
+    return fmt::format("{}/{}/{}/fast_math={}", llvm::sys::getProcessTriple(),
+                       target.cpu, target.features, config_->fast_math);
+  }
+
+  void global_optimize_module_cpu(llvm::Module *module,
+                                  const CpuTarget &cpu_target);
+
+  // Compiles |M| right away instead of on the first lookup, so that the
+  // other processes waiting for its entry are not held up until then.
+  JITModule *add_module_with_shared_cache(std::unique_ptr<llvm::Module> M,
+                                          const std::string &key,
+                                          LlvmOfflineCache *cache) {
+    std::string obj;
+    std::unique_ptr<LlvmOfflineCache::EntryLock> lock;
+    if (!cache->load_or_lock(key, obj, lock)) {
+      obj = compile_module_to_binary(std::move(M), /*target=*/"");
+      cache->store(key, obj);
+      lock.reset();
+    }
+    return add_binary(obj, /*max_reg=*/0);
+  }
+
+  // The two helpers below must be called with |mut_| held.
+  JITDylib &create_dylib() {
+    auto &dylib = es_.createJITDylib(fmt::format("{}", module_counter_));
+    dylib.addGenerator(
+        cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            dl_.getGlobalPrefix())));
+    return dylib;
+  }
+
+  JITModule *add_jit_module(JITDylib &dylib) {
+    all_libs_.push_back(&dylib);
+    auto new_module = std::make_unique<JITModuleCPU>(this, &dylib);
+    auto new_module_raw_ptr = new_module.get();
+    modules.push_back(std::move(new_module));
+    module_counter_++;
+    return new_module_raw_ptr;
+  }
 };
 
 void *JITModuleCPU::lookup_function(const std::string &name) {
   return session_->lookup_in_module(dylib_, name);
 }
 
-void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
+void ObjectCacheCPU::notifyObjectCompiled(const llvm::Module *M,
+                                          llvm::MemoryBufferRef obj) {
+  if (auto *cache = session_->offline_cache()) {
+    cache->store(M->getModuleIdentifier(), obj.getBuffer().str());
+  }
+}
+
+std::unique_ptr<llvm::MemoryBuffer> ObjectCacheCPU::getObject(
+    const llvm::Module *M) {
+  auto *cache = session_->offline_cache();
+  std::string obj;
+  if (!cache || !cache->load(M->getModuleIdentifier(), obj)) {
+    return nullptr;
+  }
+  return llvm::MemoryBuffer::getMemBufferCopy(obj, M->getModuleIdentifier());
+}
+
+void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module,
+                                               const CpuTarget &cpu_target) {
   TI_AUTO_PROF
   if (llvm::verifyModule(*module, &llvm::errs())) {
     module->print(llvm::errs(), nullptr);
     TI_ERROR("Module broken");
   }
+  // The machine code is generated by the target machine of the JIT, for the
+  // target of each function.
+  set_module_cpu_target(module, cpu_target);
 
   auto triple = get_host_target_info().first.getTargetTriple();
 
@@ -207,7 +374,7 @@ void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
 
   TargetOptions options;
   options.PrintMachineCode = false;
-  bool fast_math = get_current_program().config.fast_math;
+  bool fast_math = config_->fast_math;
   if (fast_math) {
     options.AllowFPOpFusion = FPOpFusion::Fast;
     options.UnsafeFPMath = 1;
@@ -227,10 +394,9 @@ void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
   legacy::FunctionPassManager function_pass_manager(module);
   legacy::PassManager module_pass_manager;
 
-  llvm::StringRef mcpu = llvm::sys::getHostCPUName();
   std::unique_ptr<TargetMachine> target_machine(target->createTargetMachine(
-      triple.str(), mcpu.str(), "", options, llvm::Reloc::PIC_,
-      llvm::CodeModel::Small, CodeGenOpt::Aggressive));
+      triple.str(), cpu_target.cpu, cpu_target.features, options,
+      llvm::Reloc::PIC_, llvm::CodeModel::Small, CodeGenOpt::Aggressive));
 
   TI_ERROR_UNLESS(target_machine.get(), "Could not allocate target machine!");
 
@@ -252,8 +418,12 @@ void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
   b.populateFunctionPassManager(function_pass_manager);
   b.populateModulePassManager(module_pass_manager);
 
+  const auto kernel_name = module->getModuleIdentifier();
+  const auto arch = arch_name(host_arch());
   {
     TI_PROFILER("llvm_function_pass");
+    ScopedCompileStage stage(kernel_name,
+                             fmt::format("LLVM function passes ({})", arch));
     function_pass_manager.doInitialization();
     for (llvm::Module::iterator i = module->begin(); i != module->end(); i++)
       function_pass_manager.run(*i);
@@ -263,10 +433,12 @@ void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
 
   {
     TI_PROFILER("llvm_module_pass");
+    ScopedCompileStage stage(kernel_name,
+                             fmt::format("LLVM module passes ({})", arch));
     module_pass_manager.run(*module);
   }
 
-  if (get_current_program().config.print_kernel_llvm_ir_optimized) {
+  if (config_->print_kernel_llvm_ir_optimized) {
     if (false) {
       TI_INFO("Functions with > 100 instructions in optimized LLVM IR:");
       TaichiLLVMContext::print_huge_functions(module);
@@ -278,10 +450,14 @@ void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
   }
 }
 
-std::unique_ptr<JITSession> create_llvm_jit_session_cpu(Arch arch) {
+std::unique_ptr<JITSession> create_llvm_jit_session_cpu(
+    TaichiLLVMContext *tlctx,
+    CompileConfig *config,
+    Arch arch) {
   TI_ASSERT(arch_is_cpu(arch));
   auto target_info = get_host_target_info();
-  return std::make_unique<JITSessionCPU>(target_info.first, target_info.second);
+  return std::make_unique<JITSessionCPU>(tlctx, config, target_info.first,
+                                         target_info.second);
 }
 
 TLANG_NAMESPACE_END
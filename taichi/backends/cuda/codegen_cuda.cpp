@@ -7,12 +7,17 @@
 #include "taichi/common/core.h"
 #include "taichi/util/io.h"
 #include "taichi/util/statistics.h"
+#include "taichi/ir/analysis.h"
 #include "taichi/ir/ir.h"
 #include "taichi/ir/statements.h"
 #include "taichi/program/program.h"
 #include "taichi/lang_util.h"
 #include "taichi/backends/cuda/cuda_driver.h"
 #include "taichi/backends/cuda/cuda_context.h"
+#include "taichi/backends/cuda/cuda_block_dim_tuner.h"
+#include "taichi/backends/cuda/cuda_host_read_tracker.h"
+#include "taichi/backends/cuda/cuda_pinned_memory_pool.h"
+#include "taichi/backends/cuda/cuda_print_buffer.h"
 #include "taichi/codegen/codegen_llvm.h"
 #include "taichi/llvm/llvm_program.h"
 
@@ -20,6 +25,34 @@ TLANG_NAMESPACE_BEGIN
 
 using namespace llvm;
 
+namespace {
+
+#ifdef TI_WITH_CUDA
+// Whether some external array argument lives on the device, e.g. an ndarray
+// or a PyTorch tensor, rather than in host memory.
+bool takes_device_arrays(const std::vector<Kernel::Arg> &args,
+                         RuntimeContext &context) {
+  for (int i = 0; i < (int)args.size(); i++) {
+    if (!args[i].is_external_array || args[i].size == 0) {
+      continue;
+    }
+    if (context.is_device_allocation[i]) {
+      return true;
+    }
+    unsigned int attr_val = 0;
+    uint32_t ret_code = CUDADriver::get_instance().mem_get_attribute.call(
+        &attr_val, CU_POINTER_ATTRIBUTE_MEMORY_TYPE,
+        context.get_arg<void *>(i));
+    if (ret_code == CUDA_SUCCESS && attr_val == CU_MEMORYTYPE_DEVICE) {
+      return true;
+    }
+  }
+  return false;
+}
+#endif
+
+}  // namespace
+
 // NVVM IR Spec:
 // https://docs.nvidia.com/cuda/archive/10.0/pdf/NVVM_IR_Specification.pdf
 
@@ -29,36 +62,78 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
 
   CodeGenLLVMCUDA(Kernel *kernel, IRNode *ir = nullptr)
       : CodeGenLLVM(kernel, ir) {
+#ifdef TI_WITH_CUDA
+    if (kernel->program->config.cuda_pack_small_tasks) {
+      CUDADriver::get_instance().device_get_attribute(
+          &packed_grid_dim_, CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT,
+          nullptr);
+    }
+#endif
+  }
+
+  void finalize_module() override {
+    for (auto &task : offloaded_tasks) {
+      llvm::Function *func = module->getFunction(task.name);
+      TI_ASSERT(func);
+      // Launch bounds would rule out the larger candidates of the tuner.
+      tlctx->mark_function_as_cuda_kernel(
+          func, tuned_tasks_.count(task.name) ? 0 : task.block_dim);
+    }
   }
 
   FunctionType compile_module_to_executable() override {
 #ifdef TI_WITH_CUDA
+    pack_small_tasks();
     eliminate_unused_functions();
+    finalize_module();
 
     auto offloaded_local = offloaded_tasks;
-    for (auto &task : offloaded_local) {
-      llvm::Function *func = module->getFunction(task.name);
-      TI_ASSERT(func);
-      tlctx->mark_function_as_cuda_kernel(func, task.block_dim);
-    }
 
     auto jit = kernel->program->get_llvm_program_impl()
                    ->get_llvm_context(Arch::cuda)
                    ->jit.get();
     auto cuda_module =
         jit->add_module(std::move(module), kernel->program->config.gpu_max_reg);
+    opt_in_shared_memory(cuda_module, offloaded_local);
 
-    return [offloaded_local, cuda_module,
+    auto accesses = irpass::analysis::gather_snode_tree_accesses(ir);
+    // The tasks packed into one kernel share a grid barrier, and the async
+    // engine defers the launches.
+    accesses.host_read &= !kernel->program->config.cuda_pack_small_tasks &&
+                          !kernel->program->config.async_mode;
+
+    return [offloaded_local, cuda_module, tuned_tasks = tuned_tasks_,
+            prefetched_snodes = prefetched_snodes_, accesses,
             kernel = this->kernel](RuntimeContext &context) {
       CUDAContext::get_instance().make_current();
       auto args = kernel->args;
       std::vector<void *> arg_buffers(args.size(), nullptr);
       std::vector<void *> device_buffers(args.size(), nullptr);
 
+      auto *host_reads = kernel->program->get_llvm_program_impl()
+                             ->get_cuda_host_read_tracker();
+      // Runs on the stream of |host_reads| if the kernel only reads the SNode
+      // trees. The arrays on the device may have pending writes of their own.
+      std::unique_ptr<CUDAHostReadTracker::HostRead> host_read;
+      if (host_reads) {
+        CUDAHostReadTracker::begin_launch();
+        if (accesses.host_read &&
+            CUDAContext::get_instance().get_graph() == nullptr &&
+            !takes_device_arrays(args, context)) {
+          host_read = host_reads->begin_host_read(accesses.read_trees);
+          context.result_buffer = host_read->get_result_buffer();
+        }
+      }
+
       // We could also use kernel->make_launch_context() to create
       // |ctx_builder|, but that implies the usage of Program's context. For the
       // sake of decoupling, let's not do that and explicitly set the context we
       // want to modify.
+      TI_ERROR_IF(CUDAContext::get_instance().get_graph() != nullptr &&
+                      !kernel->rets.empty(),
+                  "Kernel {} has a return value, which cannot be recorded "
+                  "into a CUDA graph.",
+                  kernel->name);
       Kernel::LaunchContextBuilder ctx_builder(kernel, &context);
       bool transferred = false;
       for (int i = 0; i < (int)args.size(); i++) {
@@ -84,9 +159,14 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
               //   host.
               // See CUDA driver API `cuPointerGetAttribute` for more details.
               transferred = true;
-              CUDADriver::get_instance().malloc(&device_buffers[i],
-                                                args[i].size);
-              CUDADriver::get_instance().memcpy_host_to_device(
+              if (host_read) {
+                device_buffers[i] =
+                    host_read->get_arg_buffer(i, args[i].size);
+              } else {
+                CUDADriver::get_instance().malloc(&device_buffers[i],
+                                                  args[i].size);
+              }
+              cuda_memcpy_host_to_device_staged(
                   (void *)device_buffers[i], arg_buffers[i], args[i].size);
             } else {
               device_buffers[i] = arg_buffers[i];
@@ -118,26 +198,59 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
         }
       }
       if (transferred) {
-        CUDADriver::get_instance().stream_synchronize(nullptr);
+        TI_ERROR_IF(CUDAContext::get_instance().get_graph() != nullptr,
+                    "Kernel {} takes host arrays, which cannot be recorded "
+                    "into a CUDA graph. Please use ndarrays instead.",
+                    kernel->name);
+        // The host reads copy on their own stream, and synchronize it.
+        if (!host_read) {
+          CUDADriver::get_instance().stream_synchronize(nullptr);
+        }
       }
 
+      auto *llvm_prog = kernel->program->get_llvm_program_impl();
+      auto *tuner = llvm_prog->get_cuda_block_dim_tuner();
+      // Prefetching cannot be recorded into a CUDA graph.
+      const bool prefetch = CUDAContext::get_instance().get_graph() == nullptr;
       for (auto task : offloaded_local) {
-        TI_TRACE("Launching kernel {}<<<{}, {}>>>", task.name, task.grid_dim,
-                 task.block_dim);
-        cuda_module->launch(task.name, task.grid_dim, task.block_dim, 0,
-                            {&context});
+        if (auto snode = prefetched_snodes.find(task.name);
+            prefetch && snode != prefetched_snodes.end()) {
+          llvm_prog->prefetch_snode_to_device(snode->second);
+        }
+        if (auto tuned = tuned_tasks.find(task.name);
+            tuner && tuned != tuned_tasks.end()) {
+          tuner->launch(cuda_module, task.name, tuned->second.num_threads,
+                        tuned->second.max_grid_dim, {&context});
+          continue;
+        }
+        TI_TRACE("Launching kernel {}<<<{}, {}, {}>>>", task.name,
+                 task.grid_dim, task.block_dim,
+                 task.dynamic_shared_array_bytes);
+        cuda_module->launch(task.name, task.grid_dim, task.block_dim,
+                            task.dynamic_shared_array_bytes, {&context});
       }
       // copy data back to host
       if (transferred) {
-        CUDADriver::get_instance().stream_synchronize(nullptr);
+        if (!host_read) {
+          CUDADriver::get_instance().stream_synchronize(nullptr);
+        }
         for (int i = 0; i < (int)args.size(); i++) {
           if (device_buffers[i] != arg_buffers[i]) {
-            CUDADriver::get_instance().memcpy_device_to_host(
+            cuda_memcpy_device_to_host_staged(
                 arg_buffers[i], (void *)device_buffers[i], args[i].size);
-            CUDADriver::get_instance().mem_free((void *)device_buffers[i]);
+            if (!host_read) {
+              CUDADriver::get_instance().mem_free((void *)device_buffers[i]);
+            }
           }
         }
       }
+      if (host_reads && !host_read) {
+        if (accesses.writes_unknown) {
+          host_reads->record_unknown_writes();
+        } else if (!accesses.written_trees.empty()) {
+          host_reads->record_writes(accesses.written_trees);
+        }
+      }
     };
 #else
     TI_ERROR("No CUDA");
@@ -174,8 +287,53 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
                                llvm::Type::getInt8PtrTy(*llvm_context)));
   }
 
+  // Stores a record into the ring buffer drained by the host: its format is
+  // registered in |print_buffer|, and each value is widened to 64 bits.
+  void print_to_buffer(CUDAPrintBuffer *print_buffer, PrintStmt *stmt) {
+    auto i64_type = llvm::Type::getInt64Ty(*llvm_context);
+    std::vector<CUDAPrintBuffer::FormatItem> items;
+    std::vector<llvm::Value *> words;
+    for (auto const &content : stmt->contents) {
+      if (std::holds_alternative<Stmt *>(content)) {
+        auto arg_stmt = std::get<Stmt *>(content);
+        auto dt = arg_stmt->ret_type;
+        auto value = llvm_val[arg_stmt];
+        if (is_real(dt)) {
+          value = builder->CreateFPExt(
+              value, llvm::Type::getDoubleTy(*llvm_context));
+          value = builder->CreateBitCast(value, i64_type);
+        } else if (is_signed(dt)) {
+          value = builder->CreateSExt(value, i64_type);
+        } else {
+          value = builder->CreateZExt(value, i64_type);
+        }
+        items.push_back(dt);
+        words.push_back(value);
+      } else {
+        items.push_back(std::get<std::string>(content));
+      }
+    }
+    const int format_id = print_buffer->register_format(items);
+    const int num_words = (int)words.size() + 1;
+    TI_ASSERT((std::size_t)num_words <= print_buffer->get_capacity());
+    auto pos = call("print_buffer_reserve", get_runtime(),
+                    tlctx->get_constant(num_words));
+    for (int i = 0; i < (int)words.size(); i++) {
+      call("print_buffer_write", get_runtime(), pos,
+           tlctx->get_constant(i + 1), words[i]);
+    }
+    const uint64 header = ((uint64)num_words << 32) | (uint64)(format_id + 1);
+    llvm_val[stmt] = call("print_buffer_commit", get_runtime(), pos,
+                          tlctx->get_constant(header));
+  }
+
   void visit(PrintStmt *stmt) override {
     TI_ASSERT(stmt->width() == 1);
+    if (auto *print_buffer = kernel->program->get_llvm_program_impl()
+                                 ->get_cuda_print_buffer()) {
+      print_to_buffer(print_buffer, stmt);
+      return;
+    }
     TI_ASSERT_INFO(stmt->contents.size() < 32,
                    "CUDA `print()` doesn't support more than 32 entries");
 
@@ -326,6 +484,55 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
                        {llvm_val[stmt->dest], llvm_val[stmt->val]});
   }
 
+  // Atomics whose old values are not used can be combined within a warp, see
+  // DEFINE_WARP_AGGREGATED_ATOMIC in runtime.cpp. Returns nullptr otherwise.
+  llvm::Value *warp_aggregated_atomic(AtomicOpStmt *stmt) {
+    if (!prog->config.cuda_warp_aggregated_atomics) {
+      return nullptr;
+    }
+    if (!used_atomics_) {
+      used_atomics_ = irpass::analysis::gather_used_atomics(ir);
+    }
+    if (used_atomics_->find(stmt) != used_atomics_->end()) {
+      return nullptr;
+    }
+    if (!stmt->val->ret_type->is<PrimitiveType>() ||
+        !stmt->dest->ret_type->as<PointerType>()
+             ->get_pointee_type()
+             ->is<PrimitiveType>()) {
+      return nullptr;
+    }
+    PrimitiveTypeID prim_type =
+        stmt->val->ret_type->cast<PrimitiveType>()->type;
+
+    std::unordered_map<PrimitiveTypeID,
+                       std::unordered_map<AtomicOpType, std::string>>
+        aggregated_atomics;
+
+    aggregated_atomics[PrimitiveTypeID::i32][AtomicOpType::add] =
+        "atomic_add_i32_warp_aggregated";
+    aggregated_atomics[PrimitiveTypeID::f32][AtomicOpType::add] =
+        "atomic_add_f32_warp_aggregated";
+    aggregated_atomics[PrimitiveTypeID::i32][AtomicOpType::min] =
+        "atomic_min_i32_warp_aggregated";
+    aggregated_atomics[PrimitiveTypeID::f32][AtomicOpType::min] =
+        "atomic_min_f32_warp_aggregated";
+    aggregated_atomics[PrimitiveTypeID::i32][AtomicOpType::max] =
+        "atomic_max_i32_warp_aggregated";
+    aggregated_atomics[PrimitiveTypeID::f32][AtomicOpType::max] =
+        "atomic_max_f32_warp_aggregated";
+
+    auto it = aggregated_atomics.find(prim_type);
+    if (it == aggregated_atomics.end() ||
+        it->second.find(stmt->op_type) == it->second.end()) {
+      return nullptr;
+    }
+    create_call(it->second.at(stmt->op_type),
+                {llvm_val[stmt->dest], llvm_val[stmt->val]});
+    // The old value is never used.
+    return llvm::UndefValue::get(tlctx->get_data_type(stmt->val->ret_type));
+  }
+
   llvm::Value *custom_type_atomic(AtomicOpStmt *stmt) {
     if (stmt->op_type != AtomicOpType::add) {
       return nullptr;
@@ -410,7 +617,8 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
   llvm::Value *atomic_op_using_cas(
       llvm::Value *output_address,
       llvm::Value *val,
-      std::function<llvm::Value *(llvm::Value *, llvm::Value *)> op) {
+      std::function<llvm::Value *(llvm::Value *, llvm::Value *)> op)
+      override {
     llvm::PointerType *output_address_type =
         llvm::dyn_cast<llvm::PointerType>(output_address->getType());
     TI_ASSERT(output_address_type != nullptr);
@@ -562,7 +770,11 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
     for (int l = 0; l < stmt->width(); l++) {
       llvm::Value *old_value;
 
-      if (llvm::Value *result = optimized_reduction(stmt)) {
+      if (llvm::Value *result = atomic_op_bf16(stmt)) {
+        old_value = result;
+      } else if (llvm::Value *result = optimized_reduction(stmt)) {
+        old_value = result;
+      } else if (llvm::Value *result = warp_aggregated_atomic(stmt)) {
         old_value = result;
       } else if (llvm::Value *result = custom_type_atomic(stmt)) {
         old_value = result;
@@ -708,25 +920,91 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
       current_task->end();
       current_task = nullptr;
     }
+    if (!stmt->gc_compact) {
+      return;
+    }
+    {
+      init_offloaded_task_function(stmt, "compact_begin");
+      call("node_gc_compact_begin", get_runtime(), snode_id);
+      finalize_offloaded_task_function();
+      current_task->grid_dim = 1;
+      current_task->block_dim = 1;
+      current_task->end();
+      current_task = nullptr;
+    }
+    {
+      init_offloaded_task_function(stmt, "compact");
+      call("node_gc_compact", get_context(),
+           builder->CreateBitCast(emit_struct_meta(stmt->snode),
+                                  llvm::Type::getInt8PtrTy(*llvm_context)),
+           tlctx->get_constant(stmt->num_cpu_threads));
+      finalize_offloaded_task_function();
+      current_task->grid_dim = prog->config.saturating_grid_dim;
+      current_task->block_dim = 64;
+      current_task->end();
+      current_task = nullptr;
+    }
+    {
+      init_offloaded_task_function(stmt, "compact_end");
+      call("node_gc_compact_end", get_runtime(), snode_id);
+      finalize_offloaded_task_function();
+      current_task->grid_dim = 1;
+      current_task->block_dim = 1;
+      current_task->end();
+      current_task = nullptr;
+    }
   }
 
   bool kernel_argument_by_val() const override {
     return true;  // on CUDA, pass the argument by value
   }
 
-  llvm::Value *create_intrinsic_load(const DataType &dtype,
-                                     llvm::Value *data_ptr) {
+  // A load of data not written by the current task, through the read-only
+  // data cache: the NVPTX backend emits ld.global.nc (__ldg) for the invariant
+  // loads from the global address space. |source| names the data in the
+  // report of the task, see report_read_only_loads().
+  llvm::Value *create_read_only_load(const DataType &dtype,
+                                     llvm::Value *data_ptr,
+                                     const std::string &source) {
+    read_only_loads_.insert(source);
     auto llvm_dtype = llvm_type(dtype);
-    auto llvm_dtype_ptr = llvm::PointerType::get(llvm_type(dtype), 0);
-    llvm::Intrinsic::ID intrin;
-    if (is_real(dtype)) {
-      intrin = llvm::Intrinsic::nvvm_ldg_global_f;
-    } else {
-      intrin = llvm::Intrinsic::nvvm_ldg_global_i;
+    auto *global_ptr = builder->CreateAddrSpaceCast(
+        data_ptr, llvm::PointerType::get(llvm_dtype, 1));
+    auto *load = builder->CreateLoad(llvm_dtype, global_ptr);
+    load->setMetadata(llvm::LLVMContext::MD_invariant_load,
+                      llvm::MDNode::get(*llvm_context, {}));
+    return load;
+  }
+
+  // Whether |offload| writes no external array. The external arrays are read
+  // through the read-only cache then, as they may alias each other.
+  static bool external_arrays_read_only(OffloadedStmt *offload) {
+    auto is_external = [](Stmt *ptr) {
+      if (auto *offset = ptr->cast<PtrOffsetStmt>()) {
+        ptr = offset->origin;
+      }
+      return ptr->is<ExternalPtrStmt>();
+    };
+    return irpass::analysis::gather_statements(
+               offload,
+               [&](Stmt *s) {
+                 if (auto *store = s->cast<GlobalStoreStmt>()) {
+                   return is_external(store->dest);
+                 }
+                 if (auto *atomic = s->cast<AtomicOpStmt>()) {
+                   return is_external(atomic->dest);
+                 }
+                 return s->is<ExternalFuncCallStmt>() ||
+                        s->is<FuncCallStmt>();
+               })
+        .empty();
+  }
+
+  void report_read_only_loads() {
+    if (!read_only_loads_.empty()) {
+      TI_TRACE("Task {} reads {} through the read-only cache",
+               current_task->name, fmt::join(read_only_loads_, ", "));
     }
-    return builder->CreateIntrinsic(
-        intrin, {llvm_dtype, llvm_dtype_ptr},
-        {data_ptr, tlctx->get_constant(data_type_size(dtype))});
   }
 
   void visit(GlobalLoadStmt *stmt) override {
@@ -738,6 +1016,7 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
       }
       if (should_cache_as_read_only) {
         auto dtype = stmt->ret_type;
+        const auto source = get_ch->output_snode->get_node_type_name_hinted();
         if (auto ptr_type = stmt->src->ret_type->as<PointerType>();
             ptr_type->is_bit_pointer()) {
           // Bit pointer case.
@@ -746,12 +1025,23 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
           // For CustomIntType "int_in_mem" refers to the type itself;
           // for CustomFloatType "int_in_mem" refers to the CustomIntType of the
           // digits.
-          if (auto cit = val_type->cast<CustomIntType>()) {
+          if (get_ch->input_snode->type == SNodeType::bit_struct) {
+            // Fetch the whole word through the read-only cache.
+            dtype = get_ch->input_snode->dt->as<BitStructType>()
+                        ->get_physical_type();
+            auto data = create_read_only_load(
+                dtype,
+                builder->CreateBitCast(llvm_val[get_ch->input_ptr],
+                                       llvm_ptr_type(dtype)),
+                source);
+            llvm_val[stmt] =
+                extract_bit_struct_member(data, get_ch->output_snode);
+          } else if (auto cit = val_type->cast<CustomIntType>()) {
             int_in_mem = val_type;
             dtype = cit->get_physical_type();
             auto [data_ptr, bit_offset] = load_bit_pointer(llvm_val[stmt->src]);
             data_ptr = builder->CreateBitCast(data_ptr, llvm_ptr_type(dtype));
-            auto data = create_intrinsic_load(dtype, data_ptr);
+            auto data = create_read_only_load(dtype, data_ptr, source);
             llvm_val[stmt] = extract_custom_int(data, bit_offset, int_in_mem);
           } else if (val_type->cast<CustomFloatType>()) {
             // TODO: support __ldg
@@ -763,17 +1053,55 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
           // Byte pointer case.
           // Issue an CUDA "__ldg" instruction so that data are cached in
           // the CUDA read-only data cache.
-          llvm_val[stmt] = create_intrinsic_load(dtype, llvm_val[stmt->src]);
+          if (ptr_type->get_pointee_type()->is_primitive(
+                  PrimitiveTypeID::bf16)) {
+            llvm_val[stmt] = bf16_to_f32(create_read_only_load(
+                PrimitiveType::u16, llvm_val[stmt->src], source));
+          } else {
+            llvm_val[stmt] =
+                create_read_only_load(dtype, llvm_val[stmt->src], source);
+          }
         }
       } else {
         CodeGenLLVM::visit(stmt);
       }
+    } else if (auto *ext = stmt->src->cast<ExternalPtrStmt>();
+               ext && external_arrays_read_only_ &&
+               !stmt->ret_type->is_primitive(PrimitiveTypeID::bf16)) {
+      auto *arg = ext->base_ptrs.data[0]->as<ArgLoadStmt>();
+      llvm_val[stmt] =
+          create_read_only_load(stmt->ret_type, llvm_val[stmt->src],
+                                fmt::format("arg {}", arg->arg_id));
     } else {
       CodeGenLLVM::visit(stmt);
     }
   }
 
   void create_bls_buffer(OffloadedStmt *stmt) {
+    if (stmt->bls_size > kMaxStaticSharedMemoryBytes) {
+#ifdef TI_WITH_CUDA
+      int max_bytes = 0;
+      CUDADriver::get_instance().device_get_attribute(
+          &max_bytes, CU_DEVICE_ATTRIBUTE_MAX_SHARED_MEMORY_PER_BLOCK_OPTIN,
+          nullptr);
+      TI_ERROR_IF(stmt->bls_size > (std::size_t)max_bytes,
+                  "(kernel={}) {} bytes of block-local storage exceed the {} "
+                  "bytes of shared memory per block of the device",
+                  kernel->name, stmt->bls_size, max_bytes);
+#endif
+      // The extern shared arrays all start at the dynamic shared memory.
+      bls_buffer = module->getGlobalVariable("bls_dynamic_buffer");
+      if (!bls_buffer) {
+        bls_buffer = new GlobalVariable(
+            *module,
+            llvm::ArrayType::get(llvm::Type::getInt8Ty(*llvm_context), 0),
+            false, llvm::GlobalValue::ExternalLinkage, nullptr,
+            "bls_dynamic_buffer", nullptr,
+            llvm::GlobalVariable::NotThreadLocal, 3 /*addrspace=shared*/);
+        bls_buffer->setAlignment(llvm::MaybeAlign(8));
+      }
+      return;
+    }
     auto type = llvm::ArrayType::get(llvm::Type::getInt8Ty(*llvm_context),
                                      stmt->bls_size);
     bls_buffer = new GlobalVariable(
@@ -796,12 +1124,17 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
       emit_cuda_gc(stmt);
     } else {
       init_offloaded_task_function(stmt);
+      external_arrays_read_only_ = external_arrays_read_only(stmt);
+      read_only_loads_.clear();
       if (stmt->task_type == Type::serial) {
         stmt->body->accept(this);
       } else if (stmt->task_type == Type::range_for) {
         create_offload_range_for(stmt);
       } else if (stmt->task_type == Type::struct_for) {
         create_offload_struct_for(stmt, true);
+        if (kernel->program->config.cuda_unified_memory) {
+          prefetched_snodes_[current_task->name] = stmt->snode;
+        }
       } else if (stmt->task_type == Type::mesh_for) {
         create_offload_mesh_for(stmt);
       } else if (stmt->task_type == Type::listgen) {
@@ -811,7 +1144,24 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
       }
       finalize_offloaded_task_function();
       current_task->grid_dim = stmt->grid_dim;
+      // The TLS epilogue may store partial sums by warp, see
+      // make_thread_local(). The partition of the iterations among the
+      // threads, and thus the partial sums, must not vary between launches.
+      const bool deterministic = stmt->task_type == Type::range_for &&
+                                 prog->config.deterministic_reduction &&
+                                 stmt->tls_epilogue;
       if (stmt->task_type == Type::range_for) {
+        // Leave the block size to the tuner unless the user has specified
+        // one. The grid-stride loop of the range-for works with any size.
+        const auto &config = kernel->program->config;
+        if (config.cuda_tune_block_dim && !deterministic &&
+            stmt->block_dim == Program::default_block_dim(config)) {
+          auto &tuned = tuned_tasks_[current_task->name];
+          tuned.num_threads = (stmt->const_begin && stmt->const_end)
+                                  ? stmt->end_value - stmt->begin_value
+                                  : -1;
+          tuned.max_grid_dim = stmt->grid_dim;
+        }
         if (stmt->const_begin && stmt->const_end) {
           int num_threads = stmt->end_value - stmt->begin_value;
           int grid_dim = ((num_threads % stmt->block_dim) == 0)
@@ -821,7 +1171,30 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
           current_task->grid_dim = std::min(stmt->grid_dim, grid_dim);
         }
       }
+      if (deterministic) {
+        const int max_grid_dim =
+            taichi_max_num_deterministic_reduction_slots * 32 / stmt->block_dim;
+        current_task->grid_dim =
+            std::max(1, std::min(current_task->grid_dim, max_grid_dim));
+      }
       current_task->block_dim = stmt->block_dim;
+      if (stmt->bls_size > kMaxStaticSharedMemoryBytes) {
+        current_task->dynamic_shared_array_bytes = stmt->bls_size;
+      }
+      report_read_only_loads();
+      // The read-only cache is not coherent with the writes of the tasks
+      // packed before.
+      if (packed_grid_dim_ > 0 && stmt->bls_size == 0 && !deterministic &&
+          read_only_loads_.empty() &&
+          !tuned_tasks_.count(current_task->name)) {
+        if (stmt->task_type == Type::serial) {
+          packable_tasks_[current_task->name] = /*serial=*/true;
+        } else if (stmt->task_type == Type::range_for && stmt->const_begin &&
+                   stmt->const_end &&
+                   current_task->grid_dim <= packed_grid_dim_) {
+          packable_tasks_[current_task->name] = /*serial=*/false;
+        }
+      }
       TI_ASSERT(current_task->grid_dim != 0);
       TI_ASSERT(current_task->block_dim != 0);
       current_task->end();
@@ -903,6 +1276,188 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
           llvm_val[stmt], llvm::Type::getHalfTy(*llvm_context));
     }
   }
+
+  void visit(InternalFuncStmt *stmt) override {
+    if (stmt->func_name == "warp_mma_m16n16k16_f16_f32") {
+      create_warp_mma(stmt);
+    } else {
+      CodeGenLLVM::visit(stmt);
+    }
+  }
+
+  // C += A B on the tensor cores, for the row-major 16x16 blocks A and B of
+  // f16 and C of f32. The args are the address and the leading dimension (in
+  // elements) of C, A and B in turn. The wmma instructions are executed by the
+  // 32 threads of a warp together, each holding a part of the fragments.
+  void create_warp_mma(InternalFuncStmt *stmt) {
+    TI_ASSERT(stmt->args.size() == 6);
+#ifdef TI_WITH_CUDA
+    TI_ERROR_IF(CUDAContext::get_instance().get_compute_capability() < 70,
+                "(kernel={}) Tensor cores need compute capability 7.0 or "
+                "higher",
+                kernel->name);
+#endif
+    auto *f16 = llvm::Type::getHalfTy(*llvm_context);
+    auto *f32 = llvm::Type::getFloatTy(*llvm_context);
+    auto get_ptr = [&](int arg, llvm::Type *element_type) {
+      return builder->CreateIntToPtr(llvm_val[stmt->args[arg]],
+                                     llvm::PointerType::get(element_type, 0));
+    };
+    auto *c_ptr = get_ptr(0, f32);
+    std::vector<llvm::Value *> mma_args;
+    auto load_fragment = [&](Intrinsic::ID intrin, llvm::Value *ptr,
+                             int ld_arg) {
+      auto *fragment = builder->CreateIntrinsic(
+          intrin, {ptr->getType()}, {ptr, llvm_val[stmt->args[ld_arg]]});
+      // Eight registers per thread for each of the fragments.
+      for (unsigned i = 0; i < 8; i++) {
+        mma_args.push_back(builder->CreateExtractValue(fragment, i));
+      }
+    };
+    load_fragment(Intrinsic::nvvm_wmma_m16n16k16_load_a_f16_row_stride,
+                  get_ptr(2, f16), 3);
+    load_fragment(Intrinsic::nvvm_wmma_m16n16k16_load_b_f16_row_stride,
+                  get_ptr(4, f16), 5);
+    load_fragment(Intrinsic::nvvm_wmma_m16n16k16_load_c_f32_row_stride, c_ptr,
+                  1);
+    auto *d = builder->CreateIntrinsic(
+        Intrinsic::nvvm_wmma_m16n16k16_mma_row_row_f32_f32, {}, mma_args);
+    std::vector<llvm::Value *> store_args{c_ptr};
+    for (unsigned i = 0; i < 8; i++) {
+      store_args.push_back(builder->CreateExtractValue(d, i));
+    }
+    store_args.push_back(llvm_val[stmt->args[1]]);
+    builder->CreateIntrinsic(
+        Intrinsic::nvvm_wmma_m16n16k16_store_d_f32_row_stride,
+        {c_ptr->getType()}, store_args);
+    llvm_val[stmt] = tlctx->get_constant(0);
+  }
+
+ private:
+  // Without opting in, a block gets at most 48 KB of shared memory. Larger BLS
+  // buffers are allocated at launch as dynamic shared memory, up to what the
+  // device allows (about 96 KB or more on sm_70+).
+  static constexpr std::size_t kMaxStaticSharedMemoryBytes = 48 * 1024;
+
+  // Lets the tasks with more than kMaxStaticSharedMemoryBytes of dynamic
+  // shared memory launch.
+  static void opt_in_shared_memory(JITModule *cuda_module,
+                                   const std::vector<OffloadedTask> &tasks) {
+#ifdef TI_WITH_CUDA
+    for (auto &task : tasks) {
+      if (task.dynamic_shared_array_bytes > kMaxStaticSharedMemoryBytes) {
+        CUDADriver::get_instance().kernel_set_attribute(
+            cuda_module->lookup_function(task.name),
+            CU_FUNC_ATTRIBUTE_MAX_DYNAMIC_SHARED_SIZE_BYTES,
+            (int)task.dynamic_shared_array_bytes);
+      }
+    }
+#endif
+  }
+
+  // Replaces each run of consecutive tasks in |packable_tasks_| with a single
+  // launch, see CompileConfig::cuda_pack_small_tasks.
+  void pack_small_tasks() {
+    std::vector<OffloadedTask> tasks;
+    std::vector<OffloadedTask> run;
+    auto flush_run = [&] {
+      if (run.size() > 1) {
+        tasks.push_back(create_packed_task(run));
+      } else {
+        tasks.insert(tasks.end(), run.begin(), run.end());
+      }
+      run.clear();
+    };
+    for (auto &task : offloaded_tasks) {
+      if (packable_tasks_.count(task.name)) {
+        run.push_back(task);
+      } else {
+        flush_run();
+        tasks.push_back(task);
+      }
+    }
+    flush_run();
+    offloaded_tasks = std::move(tasks);
+  }
+
+  // Creates a kernel running the tasks of |run| in order, with one block per
+  // SM, which are all resident at once, and a grid barrier between the
+  // tasks. The range-for tasks have grid-stride loops, so they run with any
+  // grid and block sizes, while the serial ones only run on the first thread.
+  OffloadedTask create_packed_task(const std::vector<OffloadedTask> &run) {
+    auto *i32_ty = llvm::Type::getInt32Ty(*llvm_context);
+    auto *func = llvm::Function::Create(
+        module->getFunction(run[0].name)->getFunctionType(),
+        llvm::Function::ExternalLinkage, run[0].name + "_packed",
+        module.get());
+    auto *barrier_ty = llvm::ArrayType::get(i32_ty, 2);
+    auto *barrier = new GlobalVariable(
+        *module, barrier_ty, false, llvm::GlobalValue::InternalLinkage,
+        llvm::ConstantAggregateZero::get(barrier_ty),
+        func->getName() + "_barrier", nullptr,
+        llvm::GlobalVariable::NotThreadLocal, 1 /*addrspace=global*/);
+
+    llvm::IRBuilder<> b(llvm::BasicBlock::Create(*llvm_context, "entry", func));
+    auto *context = func->getArg(0);
+    auto *barrier_ptr = b.CreateAddrSpaceCast(
+        b.CreateBitCast(barrier, llvm::PointerType::get(i32_ty, 1)),
+        llvm::PointerType::get(i32_ty, 0));
+    OffloadedTask packed = run[0];
+    packed.name = func->getName().str();
+    packed.grid_dim = packed_grid_dim_;
+    packed.block_dim = 0;
+    for (int i = 0; i < (int)run.size(); i++) {
+      if (i > 0) {
+        b.CreateCall(get_runtime_function("grid_barrier"), {barrier_ptr});
+      }
+      auto *task_func = module->getFunction(run[i].name);
+      if (packable_tasks_[run[i].name]) {
+        auto *first_thread = b.CreateICmpEQ(
+            b.CreateOr(
+                b.CreateIntrinsic(Intrinsic::nvvm_read_ptx_sreg_tid_x, {}, {}),
+                b.CreateIntrinsic(Intrinsic::nvvm_read_ptx_sreg_ctaid_x, {},
+                                  {})),
+            llvm::ConstantInt::get(i32_ty, 0));
+        auto *serial_bb =
+            llvm::BasicBlock::Create(*llvm_context, "serial_task", func);
+        auto *next_bb =
+            llvm::BasicBlock::Create(*llvm_context, "next_task", func);
+        b.CreateCondBr(first_thread, serial_bb, next_bb);
+        b.SetInsertPoint(serial_bb);
+        b.CreateCall(task_func, {context});
+        b.CreateBr(next_bb);
+        b.SetInsertPoint(next_bb);
+      } else {
+        b.CreateCall(task_func, {context});
+      }
+      packed.block_dim = std::max(packed.block_dim, run[i].block_dim);
+    }
+    b.CreateRetVoid();
+    return packed;
+  }
+
+  // The atomics whose old values are used, computed on demand.
+  std::unique_ptr<std::unordered_set<AtomicOpStmt *>> used_atomics_;
+
+  struct TunedTask {
+    // -1 if the range is only known on the device.
+    int num_threads{-1};
+    int max_grid_dim{0};
+  };
+  // The range-for tasks launched through CUDABlockDimTuner, by name.
+  std::unordered_map<std::string, TunedTask> tuned_tasks_;
+  // The SNodes the struct-for tasks iterate over, by name, see
+  // CompileConfig::cuda_unified_memory.
+  std::unordered_map<std::string, const SNode *> prefetched_snodes_;
+  // The tasks which may be packed into one launch with their neighbors, by
+  // name, and whether they are serial. See pack_small_tasks().
+  std::unordered_map<std::string, bool> packable_tasks_;
+  // One block per SM. Zero unless CompileConfig::cuda_pack_small_tasks.
+  int packed_grid_dim_{0};
+  // Whether the current task writes no external array.
+  bool external_arrays_read_only_{false};
+  // What the current task reads through the read-only cache.
+  std::set<std::string> read_only_loads_;
 };
 
 FunctionType CodeGenCUDA::codegen() {
@@ -910,4 +1465,9 @@ FunctionType CodeGenCUDA::codegen() {
   return CodeGenLLVMCUDA(kernel, ir).gen();
 }
 
+std::unique_ptr<LlvmModuleGenValue> CodeGenCUDA::modulegen() {
+  TI_AUTO_PROF
+  return CodeGenLLVMCUDA(kernel, ir).modulegen();
+}
+
 TLANG_NAMESPACE_END
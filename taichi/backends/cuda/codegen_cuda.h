@@ -6,6 +6,8 @@
 
 TLANG_NAMESPACE_BEGIN
 
+struct LlvmModuleGenValue;
+
 class CodeGenCUDA : public KernelCodeGen {
  public:
   CodeGenCUDA(Kernel *kernel, IRNode *ir = nullptr)
@@ -13,6 +15,10 @@ class CodeGenCUDA : public KernelCodeGen {
   }
 
   FunctionType codegen() override;
+
+#ifdef TI_WITH_LLVM
+  std::unique_ptr<LlvmModuleGenValue> modulegen();  // AOT Module Gen
+#endif
 };
 
 TLANG_NAMESPACE_END
@@ -0,0 +1,12 @@
+// clang-format off
+
+// Library management
+PER_CUBLAS_FUNCTION(create, cublasCreate_v2, void **);
+PER_CUBLAS_FUNCTION(destroy, cublasDestroy_v2, void *);
+
+// Level-1 BLAS
+PER_CUBLAS_FUNCTION(sdot, cublasSdot_v2, void *, int, const float *, int, const float *, int, float *);
+PER_CUBLAS_FUNCTION(saxpy, cublasSaxpy_v2, void *, int, const float *, const float *, int, float *, int);
+PER_CUBLAS_FUNCTION(sscal, cublasSscal_v2, void *, int, const float *, float *, int);
+PER_CUBLAS_FUNCTION(scopy, cublasScopy_v2, void *, int, const float *, int, float *, int);
+// clang-format on
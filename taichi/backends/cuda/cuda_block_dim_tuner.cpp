@@ -0,0 +1,158 @@
+#include "taichi/backends/cuda/cuda_block_dim_tuner.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+#include "taichi/backends/cuda/cuda_context.h"
+#include "taichi/backends/cuda/cuda_driver.h"
+#include "taichi/backends/cuda/cuda_types.h"
+#include "taichi/jit/jit_module.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+constexpr int kCandidateBlockDims[] = {32, 64, 128, 256, 512, 1024};
+
+int get_grid_dim(int num_threads, int block_dim, int max_grid_dim) {
+  if (num_threads < 0) {
+    return max_grid_dim;
+  }
+  const int grid_dim = (num_threads + block_dim - 1) / block_dim;
+  return std::min(max_grid_dim, std::max(grid_dim, 1));
+}
+
+}  // namespace
+
+CUDABlockDimTuner::CUDABlockDimTuner(int default_block_dim,
+                                     int max_block_dim,
+                                     const std::string &cache_file)
+    : default_block_dim_(default_block_dim), cache_file_(cache_file) {
+  for (int block_dim : kCandidateBlockDims) {
+    if (block_dim <= max_block_dim) {
+      candidates_.push_back(block_dim);
+    }
+  }
+  TI_ASSERT(!candidates_.empty());
+  auto guard = CUDAContext::get_instance().get_guard();
+  auto &driver = CUDADriver::get_instance();
+  driver.event_create(&start_event_, CU_EVENT_DEFAULT);
+  driver.event_create(&stop_event_, CU_EVENT_DEFAULT);
+  if (!cache_file_.empty()) {
+    load();
+  }
+}
+
+CUDABlockDimTuner::~CUDABlockDimTuner() {
+  auto guard = CUDAContext::get_instance().get_guard();
+  auto &driver = CUDADriver::get_instance();
+  driver.event_destroy(start_event_);
+  driver.event_destroy(stop_event_);
+}
+
+CUDABlockDimTuner::TaskState &CUDABlockDimTuner::get_state(
+    JITModule *module,
+    const std::string &task_name,
+    int num_threads) {
+  auto &state = tasks_[fmt::format("{}/{}", task_name, num_threads)];
+  if (state.candidates.empty()) {
+    // The register usage of the function may not allow the larger blocks.
+    int max_threads = 0;
+    CUDADriver::get_instance().kernel_get_attribute(
+        &max_threads,
+        CUfunction_attribute::CU_FUNC_ATTRIBUTE_MAX_THREADS_PER_BLOCK,
+        module->lookup_function(task_name));
+    for (int block_dim : candidates_) {
+      if (block_dim <= max_threads) {
+        state.candidates.push_back(block_dim);
+      }
+    }
+    if (state.candidates.empty()) {
+      state.candidates.push_back(std::min(default_block_dim_, max_threads));
+    }
+    state.min_time.assign(state.candidates.size(),
+                          std::numeric_limits<float>::max());
+    if (state.best_block_dim > max_threads) {
+      // Loaded from the cache, but the task has changed since then.
+      state.best_block_dim = 0;
+    }
+  }
+  return state;
+}
+
+void CUDABlockDimTuner::launch(JITModule *module,
+                               const std::string &task_name,
+                               int num_threads,
+                               int max_grid_dim,
+                               const std::vector<void *> &arg_pointers) {
+  auto &state = get_state(module, task_name, num_threads);
+  auto &context = CUDAContext::get_instance();
+  if (state.best_block_dim != 0 || context.get_graph() != nullptr) {
+    const int block_dim = state.best_block_dim != 0
+                              ? state.best_block_dim
+                              : std::min(default_block_dim_,
+                                         state.candidates.back());
+    module->launch(task_name,
+                   get_grid_dim(num_threads, block_dim, max_grid_dim),
+                   block_dim, 0, arg_pointers);
+    return;
+  }
+
+  const int num_candidates = state.candidates.size();
+  const int candidate = state.num_launches % num_candidates;
+  const int block_dim = state.candidates[candidate];
+  auto &driver = CUDADriver::get_instance();
+  driver.event_record(start_event_, context.get_stream());
+  module->launch(task_name, get_grid_dim(num_threads, block_dim, max_grid_dim),
+                 block_dim, 0, arg_pointers);
+  driver.event_record(stop_event_, context.get_stream());
+  driver.event_synchronize(stop_event_);
+  float time = 0;
+  driver.event_elapsed_time(&time, start_event_, stop_event_);
+  state.min_time[candidate] = std::min(state.min_time[candidate], time);
+
+  if (++state.num_launches == num_candidates * kNumRounds) {
+    const int best = std::min_element(state.min_time.begin(),
+                                      state.min_time.end()) -
+                     state.min_time.begin();
+    state.best_block_dim = state.candidates[best];
+    TI_TRACE("Tuned the block size of {} ({} threads): {} ({:.3f} ms)",
+             task_name, num_threads, state.best_block_dim,
+             state.min_time[best]);
+  }
+}
+
+void CUDABlockDimTuner::load() {
+  std::ifstream fin(cache_file_);
+  std::string key;
+  int block_dim;
+  while (fin >> key >> block_dim) {
+    tasks_[key].best_block_dim = block_dim;
+  }
+  TI_TRACE("Loaded {} tuned block sizes from {}", tasks_.size(), cache_file_);
+}
+
+void CUDABlockDimTuner::save() const {
+  if (cache_file_.empty()) {
+    return;
+  }
+  // Written to a temporary file first, so that concurrent processes never
+  // read a partially written one.
+  const auto tmp_file = fmt::format("{}.{}.tmp", cache_file_, PID::get_pid());
+  {
+    std::ofstream fout(tmp_file);
+    for (auto &[key, state] : tasks_) {
+      if (state.best_block_dim != 0) {
+        fout << key << ' ' << state.best_block_dim << '\n';
+      }
+    }
+  }
+  if (std::rename(tmp_file.c_str(), cache_file_.c_str()) != 0) {
+    TI_WARN("Failed to save the tuned block sizes to {}", cache_file_);
+    std::remove(tmp_file.c_str());
+  }
+}
+
+TLANG_NAMESPACE_END
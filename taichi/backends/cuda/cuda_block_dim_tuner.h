@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "taichi/common/core.h"
+
+TLANG_NAMESPACE_BEGIN
+
+class JITModule;
+
+/**
+ * Picks the block sizes of the CUDA range-for tasks by measuring them, see
+ * CompileConfig::cuda_tune_block_dim.
+ *
+ * The first launches of a task cycle through the candidate block sizes, each
+ * one timed with a pair of CUDA events on the current stream. Once every
+ * candidate has been measured kNumRounds times, the one with the smallest
+ * time is used for all the later launches. Timing a launch waits for it to
+ * finish, so only the tuning launches are synchronous.
+ *
+ * The tasks are identified by their names and their numbers of threads, since
+ * the best block size usually depends on the latter. The results are loaded
+ * from and saved to |cache_file| if it is not empty. Candidates above the
+ * maximum block size of the compiled function are skipped.
+ */
+class CUDABlockDimTuner {
+ public:
+  /**
+   * @param default_block_dim The block size of the launches that cannot be
+   * timed, i.e., those recorded into a CUDA graph before the task is tuned.
+   */
+  CUDABlockDimTuner(int default_block_dim,
+                    int max_block_dim,
+                    const std::string &cache_file);
+
+  ~CUDABlockDimTuner();
+
+  /**
+   * Launches the task @param task_name of @param module.
+   *
+   * @param num_threads The number of loop iterations, or -1 if it is only
+   * known on the device. The grid size is derived from it and the block size.
+   * @param max_grid_dim The grid size when @param num_threads is -1, and an
+   * upper bound otherwise.
+   */
+  void launch(JITModule *module,
+              const std::string &task_name,
+              int num_threads,
+              int max_grid_dim,
+              const std::vector<void *> &arg_pointers);
+
+  // Writes the finished results to the cache file.
+  void save() const;
+
+ private:
+  static constexpr int kNumRounds = 3;
+
+  struct TaskState {
+    // Empty until the task is first launched in this process.
+    std::vector<int> candidates;
+    // The smallest time per candidate, in milliseconds.
+    std::vector<float> min_time;
+    int num_launches{0};
+    // Set once the tuning has finished.
+    int best_block_dim{0};
+  };
+
+  TaskState &get_state(JITModule *module,
+                       const std::string &task_name,
+                       int num_threads);
+
+  void load();
+
+  const int default_block_dim_;
+  const std::string cache_file_;
+  std::vector<int> candidates_;
+  std::unordered_map<std::string, TaskState> tasks_;
+  void *start_event_{nullptr};
+  void *stop_event_{nullptr};
+};
+
+TLANG_NAMESPACE_END
@@ -7,31 +7,154 @@ namespace cuda {
 CudaCachingAllocator::CudaCachingAllocator(Device *device) : device_(device) {
 }
 
-uint64_t *CudaCachingAllocator::allocate(
-    const Device::LlvmRuntimeAllocParams &params) {
-  uint64_t *ret{nullptr};
-  auto size_aligned = taichi::iroundup(params.size, taichi_page_size);
-  auto it_blk = mem_blocks_.lower_bound(size_aligned);
-
-  if (it_blk != mem_blocks_.end()) {
-    size_t remaining_sz = it_blk->first - size_aligned;
-    if (remaining_sz > 0) {
-      TI_ASSERT(remaining_sz % taichi_page_size == 0);
-      auto remaining_head =
-          reinterpret_cast<uint8_t *>(it_blk->second) + size_aligned;
-      mem_blocks_.insert(
-          {remaining_sz, reinterpret_cast<uint64_t *>(remaining_head)});
+CudaCachingAllocator::~CudaCachingAllocator() {
+  // The memory itself belongs to the LLVM runtime.
+  for (auto *block : all_blocks_) {
+    delete block;
+  }
+}
+
+int CudaCachingAllocator::get_size_class(std::size_t size) {
+  return std::min((int)taichi::log2int(size / taichi_page_size),
+                  kNumSizeClasses - 1);
+}
+
+CudaCachingAllocator::Block *CudaCachingAllocator::find_free_block(
+    std::size_t size,
+    void *stream) {
+  Block key;
+  key.size = size;
+  key.stream = stream;
+  for (int c = get_size_class(size); c < kNumSizeClasses; c++) {
+    auto it = free_blocks_[c].lower_bound(&key);
+    if (it != free_blocks_[c].end() && (*it)->stream == stream) {
+      auto *block = *it;
+      free_blocks_[c].erase(it);
+      return block;
     }
-    ret = it_blk->second;
-    mem_blocks_.erase(it_blk);
+  }
+  return nullptr;
+}
+
+void CudaCachingAllocator::insert_free_block(Block *block) {
+  block->allocated = false;
+  free_blocks_[get_size_class(block->size)].insert(block);
+}
+
+void CudaCachingAllocator::erase_free_block(Block *block) {
+  free_blocks_[get_size_class(block->size)].erase(block);
+}
+
+void CudaCachingAllocator::merge_blocks(Block *prev, Block *block) {
+  TI_ASSERT(prev->ptr + prev->size == block->ptr);
+  prev->size += block->size;
+  prev->next = block->next;
+  if (block->next) {
+    block->next->prev = prev;
+  }
+  all_blocks_.erase(block);
+  delete block;
+}
+
+uint64_t *CudaCachingAllocator::allocate(
+    const Device::LlvmRuntimeAllocParams &params,
+    void *stream) {
+  std::lock_guard<std::mutex> _(mut_);
+  auto size_aligned = std::max(taichi::iroundup(params.size, taichi_page_size),
+                               taichi_page_size);
+  auto *block = find_free_block(size_aligned, stream);
+
+  if (block) {
+    stats_.num_cache_hits++;
+    stats_.cached_bytes -= block->size;
   } else {
-    ret = device_->allocate_llvm_runtime_memory_jit(params);
+    stats_.num_cache_misses++;
+    auto upstream_params = params;
+    if (size_aligned < kSmallRequestSize) {
+      upstream_params.size = kSmallSegmentSize;
+    } else {
+      upstream_params.size = size_aligned;
+    }
+    block = new Block;
+    block->ptr = reinterpret_cast<uint8_t *>(
+        device_->allocate_llvm_runtime_memory_jit(upstream_params));
+    block->size = upstream_params.size;
+    block->stream = stream;
+    all_blocks_.insert(block);
+    stats_.reserved_bytes += block->size;
+  }
+
+  size_t remaining_sz = block->size - size_aligned;
+  if (remaining_sz > 0) {
+    TI_ASSERT(remaining_sz % taichi_page_size == 0);
+    auto *remaining = new Block;
+    remaining->ptr = block->ptr + size_aligned;
+    remaining->size = remaining_sz;
+    remaining->stream = stream;
+    remaining->prev = block;
+    remaining->next = block->next;
+    if (block->next) {
+      block->next->prev = remaining;
+    }
+    block->next = remaining;
+    block->size = size_aligned;
+    all_blocks_.insert(remaining);
+    insert_free_block(remaining);
+    stats_.cached_bytes += remaining_sz;
   }
-  return ret;
+
+  block->allocated = true;
+  allocated_blocks_[block->ptr] = block;
+  stats_.allocated_bytes += block->size;
+  stats_.peak_allocated_bytes =
+      std::max(stats_.peak_allocated_bytes, stats_.allocated_bytes);
+  return reinterpret_cast<uint64_t *>(block->ptr);
 }
 
 void CudaCachingAllocator::release(size_t sz, uint64_t *ptr) {
-  mem_blocks_.insert({sz, ptr});
+  std::lock_guard<std::mutex> _(mut_);
+  auto it = allocated_blocks_.find(reinterpret_cast<uint8_t *>(ptr));
+  if (it == allocated_blocks_.end()) {
+    TI_ERROR("Releasing memory not allocated by the CudaCachingAllocator");
+  }
+  auto *block = it->second;
+  allocated_blocks_.erase(it);
+  stats_.allocated_bytes -= block->size;
+  stats_.cached_bytes += block->size;
+
+  if (block->next && !block->next->allocated &&
+      block->next->stream == block->stream) {
+    erase_free_block(block->next);
+    merge_blocks(block, block->next);
+  }
+  if (block->prev && !block->prev->allocated &&
+      block->prev->stream == block->stream) {
+    auto *prev = block->prev;
+    erase_free_block(prev);
+    merge_blocks(prev, block);
+    block = prev;
+  }
+  insert_free_block(block);
+}
+
+CachingAllocatorStats CudaCachingAllocator::get_stats() {
+  std::lock_guard<std::mutex> _(mut_);
+  auto stats = stats_;
+  stats.largest_cached_block_bytes = 0;
+  for (int c = kNumSizeClasses - 1; c >= 0; c--) {
+    for (auto *block : free_blocks_[c]) {
+      stats.largest_cached_block_bytes =
+          std::max(stats.largest_cached_block_bytes, block->size);
+    }
+    if (stats.largest_cached_block_bytes > 0) {
+      break;
+    }
+  }
+  if (stats.cached_bytes > 0) {
+    stats.fragmentation = 1.0 - (double)stats.largest_cached_block_bytes /
+                                    (double)stats.cached_bytes;
+  }
+  return stats;
 }
 
 }  // namespace cuda
@@ -4,21 +4,103 @@
 #include "taichi/common/core.h"
 #include "taichi/math/arithmetic.h"
 #include <stdint.h>
-#include <map>
+#include <mutex>
+#include <set>
+#include <unordered_map>
 
 namespace taichi {
 namespace lang {
 namespace cuda {
 
+struct CachingAllocatorStats {
+  // Bytes of the blocks handed out and not yet released
+  std::size_t allocated_bytes{0};
+  std::size_t peak_allocated_bytes{0};
+  // Bytes obtained from the upstream allocator, allocated or cached
+  std::size_t reserved_bytes{0};
+  std::size_t cached_bytes{0};
+  std::size_t largest_cached_block_bytes{0};
+  std::size_t num_cache_hits{0};
+  std::size_t num_cache_misses{0};
+  // 1 - largest_cached_block_bytes / cached_bytes, i.e. 0 means the cached
+  // memory is a single contiguous block.
+  double fragmentation{0};
+};
+
+/**
+ * A caching allocator on top of the memory of the LLVM runtime.
+ *
+ * Free blocks are binned by power-of-two size classes. A request takes the
+ * best fit in the smallest non-empty class that can hold it, and splits the
+ * remainder off. Released blocks are coalesced with free neighbours that were
+ * obtained from the same upstream allocation.
+ *
+ * A block released on a stream is only handed out again to requests on the
+ * same stream, so that its reuse is ordered after all the prior work using it
+ * without any synchronization.
+ *
+ * Thread safe.
+ */
 class CudaCachingAllocator {
  public:
   CudaCachingAllocator(Device *device);
 
-  uint64_t *allocate(const Device::LlvmRuntimeAllocParams &params);
+  ~CudaCachingAllocator();
+
+  uint64_t *allocate(const Device::LlvmRuntimeAllocParams &params,
+                     void *stream = nullptr);
   void release(size_t sz, uint64_t *ptr);
 
+  CachingAllocatorStats get_stats();
+
  private:
-  std::multimap<size_t, uint64_t *> mem_blocks_;
+  struct Block {
+    uint8_t *ptr{nullptr};
+    std::size_t size{0};
+    void *stream{nullptr};
+    bool allocated{false};
+    // Neighbours within the same upstream allocation
+    Block *prev{nullptr};
+    Block *next{nullptr};
+  };
+
+  struct BlockComparator {
+    bool operator()(const Block *a, const Block *b) const {
+      if (a->stream != b->stream) {
+        return a->stream < b->stream;
+      }
+      if (a->size != b->size) {
+        return a->size < b->size;
+      }
+      return a->ptr < b->ptr;
+    }
+  };
+
+  using FreeBlocks = std::set<Block *, BlockComparator>;
+
+  // Requests smaller than this are carved out of segments of
+  // |kSmallSegmentSize| bytes, so that churning small temporaries does not
+  // reach the upstream allocator.
+  static constexpr std::size_t kSmallRequestSize = 1 << 20;
+  static constexpr std::size_t kSmallSegmentSize = 2 << 20;
+  static constexpr int kNumSizeClasses = 48;
+
+  static int get_size_class(std::size_t size);
+
+  Block *find_free_block(std::size_t size, void *stream);
+
+  void insert_free_block(Block *block);
+
+  void erase_free_block(Block *block);
+
+  // Merges |block| into |prev|, keeping |prev|
+  void merge_blocks(Block *prev, Block *block);
+
+  FreeBlocks free_blocks_[kNumSizeClasses];
+  std::unordered_map<uint8_t *, Block *> allocated_blocks_;
+  std::set<Block *> all_blocks_;
+  CachingAllocatorStats stats_;
+  std::mutex mut_;
   Device *device_{nullptr};
 };
 
@@ -12,6 +12,10 @@
 
 TLANG_NAMESPACE_BEGIN
 
+namespace {
+thread_local void *current_stream = nullptr;
+}  // namespace
+
 CUDAContext::CUDAContext()
     : profiler_(nullptr), driver_(CUDADriver::get_instance_without_context()) {
   // CUDA initialization
@@ -108,17 +112,25 @@ void CUDAContext::launch(void *func,
   if (grid_dim > 0) {
     std::lock_guard<std::mutex> _(lock_);
     driver_.launch_kernel(func, grid_dim, 1, 1, block_dim, 1, 1,
-                          dynamic_shared_mem_bytes, nullptr,
+                          dynamic_shared_mem_bytes, current_stream,
                           arg_pointers.data(), nullptr);
   }
   if (profiler_)
     profiler_->stop(task_handle);
 
   if (debug_) {
-    driver_.stream_synchronize(nullptr);
+    driver_.stream_synchronize(current_stream);
   }
 }
 
+void CUDAContext::set_stream(void *stream) {
+  current_stream = stream;
+}
+
+void *CUDAContext::get_stream() const {
+  return current_stream;
+}
+
 CUDAContext::~CUDAContext() {
   // TODO: restore these?
   /*
@@ -15,6 +15,7 @@ TLANG_NAMESPACE_BEGIN
 // cases such as unit testing where many Taichi programs are created/destroyed.
 
 class CUDADriver;
+class CUDAGraph;
 
 class CUDAContext {
  private:
@@ -27,6 +28,7 @@ class CUDAContext {
   KernelProfilerBase *profiler_;
   CUDADriver &driver_;
   bool debug_;
+  CUDAGraph *graph_{nullptr};
 
  public:
   CUDAContext();
@@ -39,6 +41,10 @@ class CUDAContext {
     return dev_count_ != 0;
   }
 
+  int get_device_count() const {
+    return dev_count_;
+  }
+
   void launch(void *func,
               const std::string &task_name,
               std::vector<void *> arg_pointers,
@@ -54,6 +60,21 @@ class CUDAContext {
     debug_ = debug;
   }
 
+  // The CUDA graph being recorded, if any. See CUDAGraph.
+  void set_graph(CUDAGraph *graph) {
+    graph_ = graph;
+  }
+
+  CUDAGraph *get_graph() const {
+    return graph_;
+  }
+
+  // The stream that the kernels launched by the calling thread go to. nullptr
+  // (the default) is the legacy default stream.
+  void set_stream(void *stream);
+
+  void *get_stream() const;
+
   std::string get_mcpu() const {
     return mcpu_;
   }
@@ -1,5 +1,7 @@
 #include "taichi/backends/cuda/cuda_device.h"
 
+#include "taichi/system/device_memory_tracker.h"
+
 namespace taichi {
 namespace lang {
 
@@ -13,11 +15,16 @@ CudaDevice::AllocInfo CudaDevice::get_alloc_info(DeviceAllocation handle) {
 DeviceAllocation CudaDevice::allocate_memory(const AllocParams &params) {
   AllocInfo info;
 
-  if (params.host_read || params.host_write) {
-    CUDADriver::get_instance().malloc_managed(&info.ptr, params.size,
-                                              CU_MEM_ATTACH_GLOBAL);
-  } else {
-    CUDADriver::get_instance().malloc(&info.ptr, params.size);
+  try {
+    if (params.host_read || params.host_write) {
+      CUDADriver::get_instance().malloc_managed(&info.ptr, params.size,
+                                                CU_MEM_ATTACH_GLOBAL);
+    } else {
+      CUDADriver::get_instance().malloc(&info.ptr, params.size);
+    }
+  } catch (...) {
+    DeviceMemoryTracker::get_instance().report_allocation_failure(params.size);
+    throw;
   }
 
   info.size = params.size;
@@ -29,6 +36,62 @@ DeviceAllocation CudaDevice::allocate_memory(const AllocParams &params) {
   alloc.device = this;
 
   allocations_.push_back(info);
+  DeviceMemoryTracker::get_instance().record_allocation(this, alloc.alloc_id,
+                                                        info.size);
+  return alloc;
+}
+
+DeviceAllocation CudaDevice::allocate_memory_placed(
+    std::size_t size,
+    const std::vector<MemoryPlacement> &placements) {
+  auto &driver = CUDADriver::get_instance();
+  AllocInfo info;
+  driver.malloc_managed(&info.ptr, size, CU_MEM_ATTACH_GLOBAL);
+  for (const auto &p : placements) {
+    TI_ASSERT(p.offset + p.size <= size);
+    if (p.size == 0) {
+      continue;
+    }
+    auto *begin = (char *)info.ptr + p.offset;
+    driver.mem_advise(begin, p.size, CU_MEM_ADVISE_SET_PREFERRED_LOCATION,
+                      p.device);
+    driver.mem_advise(begin, p.size, CU_MEM_ADVISE_SET_ACCESSED_BY, 0);
+    driver.mem_prefetch_async(begin, p.size, p.device, nullptr);
+  }
+  driver.memset(info.ptr, 0, size);
+
+  info.size = size;
+  info.is_imported = false;
+  info.use_cached = false;
+
+  DeviceAllocation alloc;
+  alloc.alloc_id = allocations_.size();
+  alloc.device = this;
+
+  allocations_.push_back(info);
+  DeviceMemoryTracker::get_instance().record_allocation(this, alloc.alloc_id,
+                                                        info.size);
+  return alloc;
+}
+
+DeviceAllocation CudaDevice::allocate_memory_unified(std::size_t size) {
+  auto &driver = CUDADriver::get_instance();
+  AllocInfo info;
+  driver.malloc_managed(&info.ptr, size, CU_MEM_ATTACH_GLOBAL);
+  driver.mem_advise(info.ptr, size, CU_MEM_ADVISE_SET_ACCESSED_BY, 0);
+  driver.memset(info.ptr, 0, size);
+
+  info.size = size;
+  info.is_imported = false;
+  info.use_cached = false;
+
+  DeviceAllocation alloc;
+  alloc.alloc_id = allocations_.size();
+  alloc.device = this;
+
+  allocations_.push_back(info);
+  DeviceMemoryTracker::get_instance().record_allocation(this, alloc.alloc_id,
+                                                        info.size);
   return alloc;
 }
 
@@ -54,6 +117,9 @@ DeviceAllocation CudaDevice::allocate_memory_runtime(
   alloc.device = this;
 
   allocations_.push_back(info);
+  // Out of the memory preallocated by the runtime.
+  DeviceMemoryTracker::get_instance().record_allocation(
+      this, alloc.alloc_id, info.size, /*nested=*/true);
   return alloc;
 }
 
@@ -63,7 +129,12 @@ void CudaDevice::dealloc_memory(DeviceAllocation handle) {
   if (info.ptr == nullptr) {
     TI_ERROR("the DeviceAllocation is already deallocated");
   }
-  TI_ASSERT(!info.is_imported);
+  if (info.is_imported) {
+    release_imported_memory(handle);
+    return;
+  }
+  DeviceMemoryTracker::get_instance().record_deallocation(this,
+                                                          handle.alloc_id);
   if (info.use_cached) {
     if (caching_allocator_ == nullptr) {
       TI_ERROR("the CudaCachingAllocator is not initialized");
@@ -75,6 +146,13 @@ void CudaDevice::dealloc_memory(DeviceAllocation handle) {
   }
 }
 
+CachingAllocatorStats CudaDevice::get_caching_allocator_stats() {
+  if (caching_allocator_ == nullptr) {
+    return {};
+  }
+  return caching_allocator_->get_stats();
+}
+
 DeviceAllocation CudaDevice::import_memory(void *ptr, size_t size) {
   AllocInfo info;
   info.ptr = ptr;
@@ -82,13 +160,26 @@ DeviceAllocation CudaDevice::import_memory(void *ptr, size_t size) {
   info.is_imported = true;
 
   DeviceAllocation alloc;
-  alloc.alloc_id = allocations_.size();
   alloc.device = this;
-
-  allocations_.push_back(info);
+  if (!free_imported_ids_.empty()) {
+    alloc.alloc_id = free_imported_ids_.back();
+    free_imported_ids_.pop_back();
+    allocations_[alloc.alloc_id] = info;
+  } else {
+    alloc.alloc_id = allocations_.size();
+    allocations_.push_back(info);
+  }
   return alloc;
 }
 
+void CudaDevice::release_imported_memory(DeviceAllocation handle) {
+  validate_device_alloc(handle);
+  AllocInfo &info = allocations_[handle.alloc_id];
+  TI_ASSERT(info.is_imported && info.ptr != nullptr);
+  info = AllocInfo();
+  free_imported_ids_.push_back(handle.alloc_id);
+}
+
 uint64 CudaDevice::fetch_result_uint64(int i, uint64 *result_buffer) {
   CUDADriver::get_instance().stream_synchronize(nullptr);
   uint64 ret;
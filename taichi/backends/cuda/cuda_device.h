@@ -109,11 +109,38 @@ class CudaDevice : public Device {
       TI_NOT_IMPLEMENTED};
 
   DeviceAllocation import_memory(void *ptr, size_t size);
+  // Forgets an allocation made by import_memory() without freeing the memory,
+  // which its importer owns. dealloc_memory() forwards imported allocations
+  // here.
+  void release_imported_memory(DeviceAllocation handle);
+
+  // A byte range of an allocation that prefers to reside on |device|.
+  struct MemoryPlacement {
+    std::size_t offset{0};
+    std::size_t size{0};
+    int device{0};
+  };
+
+  // Allocates zero-initialized unified memory whose |placements| prefer to
+  // reside on the given devices. This is only a placement hint: the kernels
+  // on device 0 access the remote ranges directly instead of migrating them.
+  DeviceAllocation allocate_memory_placed(
+      std::size_t size,
+      const std::vector<MemoryPlacement> &placements);
+
+  // Allocates zero-initialized unified memory that may exceed the device
+  // memory. Device 0 keeps a mapping of the pages evicted to the host, and
+  // accesses them remotely until they are prefetched.
+  DeviceAllocation allocate_memory_unified(std::size_t size);
 
   Stream *get_compute_stream() override{TI_NOT_IMPLEMENTED};
 
+  CachingAllocatorStats get_caching_allocator_stats();
+
  private:
   std::vector<AllocInfo> allocations_;
+  // The ids of the released imported allocations, reused by import_memory().
+  std::vector<uint32_t> free_imported_ids_;
   void validate_device_alloc(DeviceAllocation alloc) {
     if (allocations_.size() <= alloc.alloc_id) {
       TI_ERROR("invalid DeviceAllocation");
@@ -15,6 +15,31 @@ std::string get_cuda_error_message(uint32 err) {
   return fmt::format("CUDA Error {}: {}", err_name_ptr, err_string_ptr);
 }
 
+std::string get_cusparse_error_message(uint32 err) {
+  return fmt::format("cuSPARSE status {}", err);
+}
+
+std::string get_cublas_error_message(uint32 err) {
+  return fmt::format("cuBLAS status {}", err);
+}
+
+namespace {
+
+std::unique_ptr<DynamicLoader> load_cuda_library(
+    const std::vector<std::string> &candidates) {
+  std::unique_ptr<DynamicLoader> loader;
+  for (auto &name : candidates) {
+    loader = std::make_unique<DynamicLoader>(name);
+    if (loader->loaded()) {
+      TI_TRACE("{} loaded.", name);
+      break;
+    }
+  }
+  return loader;
+}
+
+}  // namespace
+
 bool CUDADriver::detected() {
   return !disabled_by_env_ && cuda_version_valid_ && loader_->loaded();
 }
@@ -78,4 +103,66 @@ CUDADriver &CUDADriver::get_instance() {
   return get_instance_without_context();
 }
 
+CUSPARSEDriver::CUSPARSEDriver() {
+#if defined(TI_PLATFORM_LINUX)
+  loader_ = load_cuda_library(
+      {"libcusparse.so", "libcusparse.so.11", "libcusparse.so.10"});
+#elif defined(TI_PLATFORM_WINDOWS)
+  loader_ = load_cuda_library({"cusparse64_11.dll", "cusparse64_10.dll"});
+#else
+  static_assert(false, "Taichi CUDA driver supports only Windows and Linux.");
+#endif
+  if (!loader_->loaded()) {
+    TI_WARN("cuSPARSE not found.");
+    return;
+  }
+#define PER_CUSPARSE_FUNCTION(name, symbol_name, ...) \
+  name.set(loader_->load_function(#symbol_name));     \
+  name.set_lock(&lock_);                              \
+  name.set_names(#name, #symbol_name);                \
+  name.set_error_message_getter(get_cusparse_error_message);
+#include "taichi/backends/cuda/cusparse_functions.inc.h"
+#undef PER_CUSPARSE_FUNCTION
+}
+
+bool CUSPARSEDriver::detected() const {
+  return loader_->loaded();
+}
+
+CUSPARSEDriver &CUSPARSEDriver::get_instance() {
+  static CUSPARSEDriver *instance = new CUSPARSEDriver();
+  return *instance;
+}
+
+CUBLASDriver::CUBLASDriver() {
+#if defined(TI_PLATFORM_LINUX)
+  loader_ = load_cuda_library(
+      {"libcublas.so", "libcublas.so.11", "libcublas.so.10"});
+#elif defined(TI_PLATFORM_WINDOWS)
+  loader_ = load_cuda_library({"cublas64_11.dll", "cublas64_10.dll"});
+#else
+  static_assert(false, "Taichi CUDA driver supports only Windows and Linux.");
+#endif
+  if (!loader_->loaded()) {
+    TI_WARN("cuBLAS not found.");
+    return;
+  }
+#define PER_CUBLAS_FUNCTION(name, symbol_name, ...) \
+  name.set(loader_->load_function(#symbol_name));   \
+  name.set_lock(&lock_);                            \
+  name.set_names(#name, #symbol_name);              \
+  name.set_error_message_getter(get_cublas_error_message);
+#include "taichi/backends/cuda/cublas_functions.inc.h"
+#undef PER_CUBLAS_FUNCTION
+}
+
+bool CUBLASDriver::detected() const {
+  return loader_->loaded();
+}
+
+CUBLASDriver &CUBLASDriver::get_instance() {
+  static CUBLASDriver *instance = new CUBLASDriver();
+  return *instance;
+}
+
 TLANG_NAMESPACE_END
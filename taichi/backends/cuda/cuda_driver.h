@@ -25,24 +25,48 @@ TLANG_NAMESPACE_BEGIN
 // Driver constants from cuda.h
 
 constexpr uint32 CU_EVENT_DEFAULT = 0x0;
+constexpr uint32 CU_EVENT_DISABLE_TIMING = 0x2;
 constexpr uint32 CU_STREAM_DEFAULT = 0x0;
 constexpr uint32 CU_STREAM_NON_BLOCKING = 0x1;
 constexpr uint32 CU_MEM_ATTACH_GLOBAL = 0x1;
+constexpr uint32 CU_MEMHOSTREGISTER_READ_ONLY = 0x08;
 constexpr uint32 CU_MEM_ADVISE_SET_PREFERRED_LOCATION = 3;
+constexpr uint32 CU_MEM_ADVISE_SET_ACCESSED_BY = 5;
 constexpr uint32 CU_DEVICE_ATTRIBUTE_MAX_BLOCK_DIM_X = 2;
 constexpr uint32 CU_DEVICE_ATTRIBUTE_MAX_BLOCKS_PER_MULTIPROCESSOR = 106;
 constexpr uint32 CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT = 16;
+constexpr uint32 CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_MULTIPROCESSOR = 39;
 constexpr uint32 CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MAJOR = 75;
 constexpr uint32 CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MINOR = 76;
+constexpr uint32 CU_DEVICE_ATTRIBUTE_CONCURRENT_MANAGED_ACCESS = 89;
+constexpr uint32 CU_DEVICE_ATTRIBUTE_MAX_SHARED_MEMORY_PER_BLOCK_OPTIN = 97;
 constexpr uint32 CUDA_ERROR_ASSERT = 710;
 constexpr uint32 CU_JIT_MAX_REGISTERS = 0;
+constexpr uint32 CU_JIT_INPUT_PTX = 1;
+constexpr uint32 CU_JIT_INFO_LOG_BUFFER = 3;
+constexpr uint32 CU_JIT_INFO_LOG_BUFFER_SIZE_BYTES = 4;
+constexpr uint32 CU_JIT_LOG_VERBOSE = 12;
 constexpr uint32 CU_POINTER_ATTRIBUTE_MEMORY_TYPE = 2;
 constexpr uint32 CU_DEVICE_ATTRIBUTE_UNIFIED_ADDRESSING = 41;
 constexpr uint32 CUDA_SUCCESS = 0;
+constexpr uint32 CUDA_ERROR_NOT_READY = 600;
 constexpr uint32 CU_MEMORYTYPE_DEVICE = 2;
 
+// Library constants from cusparse.h and library_types.h
+
+constexpr uint32 CUSPARSE_INDEX_BASE_ZERO = 0;
+constexpr uint32 CUSPARSE_INDEX_32I = 2;
+constexpr uint32 CUSPARSE_OPERATION_NON_TRANSPOSE = 0;
+constexpr uint32 CUSPARSE_SPMV_ALG_DEFAULT = 0;
+constexpr uint32 CUDA_R_32F = 0;
+
 std::string get_cuda_error_message(uint32 err);
 
+// The CUDA libraries report their own status codes instead of the driver's.
+std::string get_cusparse_error_message(uint32 err);
+
+std::string get_cublas_error_message(uint32 err);
+
 template <typename... Args>
 class CUDADriverFunction {
  public:
@@ -70,8 +94,12 @@ class CUDADriverFunction {
     driver_lock_ = lock;
   }
 
+  void set_error_message_getter(std::string (*getter)(uint32)) {
+    error_message_getter_ = getter;
+  }
+
   std::string get_error_message(uint32 err) {
-    return get_cuda_error_message(err) +
+    return error_message_getter_(err) +
            fmt::format(" while calling {} ({})", name_, symbol_name_);
   }
 
@@ -93,6 +121,7 @@ class CUDADriverFunction {
   func_type *function_{nullptr};
   std::string name_, symbol_name_;
   std::mutex *driver_lock_{nullptr};
+  std::string (*error_message_getter_)(uint32){get_cuda_error_message};
 };
 
 class CUDADriver {
@@ -127,4 +156,44 @@ class CUDADriver {
   bool cuda_version_valid_{false};
 };
 
+// cuSPARSE and cuBLAS are loaded on first use, since most programs never need
+// them. Their functions must be called with the Taichi CUDA context current.
+class CUSPARSEDriver {
+ public:
+#define PER_CUSPARSE_FUNCTION(name, symbol_name, ...) \
+  CUDADriverFunction<__VA_ARGS__> name;
+#include "taichi/backends/cuda/cusparse_functions.inc.h"
+#undef PER_CUSPARSE_FUNCTION
+
+  bool detected() const;
+
+  static CUSPARSEDriver &get_instance();
+
+ private:
+  CUSPARSEDriver();
+
+  std::unique_ptr<DynamicLoader> loader_;
+
+  std::mutex lock_;
+};
+
+class CUBLASDriver {
+ public:
+#define PER_CUBLAS_FUNCTION(name, symbol_name, ...) \
+  CUDADriverFunction<__VA_ARGS__> name;
+#include "taichi/backends/cuda/cublas_functions.inc.h"
+#undef PER_CUBLAS_FUNCTION
+
+  bool detected() const;
+
+  static CUBLASDriver &get_instance();
+
+ private:
+  CUBLASDriver();
+
+  std::unique_ptr<DynamicLoader> loader_;
+
+  std::mutex lock_;
+};
+
 TLANG_NAMESPACE_END
@@ -17,38 +17,65 @@ PER_CUDA_FUNCTION(context_get_current, cuCtxGetCurrent, void **);
 
 // Stream management
 PER_CUDA_FUNCTION(stream_create, cuStreamCreate, void **, uint32);
+PER_CUDA_FUNCTION(stream_destroy, cuStreamDestroy_v2, void *);
+PER_CUDA_FUNCTION(stream_wait_event, cuStreamWaitEvent, void *, void *, uint32);
 
 // Memory management
 PER_CUDA_FUNCTION(memcpy_host_to_device, cuMemcpyHtoD_v2, void *, void *, std::size_t);
 PER_CUDA_FUNCTION(memcpy_device_to_host, cuMemcpyDtoH_v2, void *, void *, std::size_t);
 PER_CUDA_FUNCTION(memcpy_device_to_device, cuMemcpyDtoD_v2, void *, void *, std::size_t);
+PER_CUDA_FUNCTION(memcpy_device_to_device_async, cuMemcpyDtoDAsync_v2, void *, void *, std::size_t, void *);
 PER_CUDA_FUNCTION(memcpy_host_to_device_async, cuMemcpyHtoDAsync_v2, void *, void *, std::size_t, void *);
 PER_CUDA_FUNCTION(memcpy_device_to_host_async, cuMemcpyDtoHAsync_v2, void *, void *, std::size_t, void*);
 PER_CUDA_FUNCTION(malloc, cuMemAlloc_v2, void **, std::size_t);
 PER_CUDA_FUNCTION(malloc_managed, cuMemAllocManaged, void **, std::size_t, uint32);
 PER_CUDA_FUNCTION(memset, cuMemsetD8_v2, void *, uint8, std::size_t);
+PER_CUDA_FUNCTION(memset_d8_async, cuMemsetD8Async, void *, uint8, std::size_t, void *);
+PER_CUDA_FUNCTION(memset_d16_async, cuMemsetD16Async, void *, uint16, std::size_t, void *);
+PER_CUDA_FUNCTION(memset_d32_async, cuMemsetD32Async, void *, uint32, std::size_t, void *);
 PER_CUDA_FUNCTION(mem_free, cuMemFree_v2, void *);
 PER_CUDA_FUNCTION(mem_advise, cuMemAdvise, void *, std::size_t, uint32, uint32);
+PER_CUDA_FUNCTION(mem_prefetch_async, cuMemPrefetchAsync, void *, std::size_t, uint32, void *);
 PER_CUDA_FUNCTION(mem_get_info, cuMemGetInfo_v2, std::size_t *, std::size_t *);
 PER_CUDA_FUNCTION(mem_get_attribute, cuPointerGetAttribute, void *, uint32, void *);
+PER_CUDA_FUNCTION(mem_host_register, cuMemHostRegister_v2, void *, std::size_t, uint32);
+PER_CUDA_FUNCTION(mem_host_unregister, cuMemHostUnregister, void *);
+PER_CUDA_FUNCTION(mem_alloc_host, cuMemAllocHost_v2, void **, std::size_t);
+PER_CUDA_FUNCTION(mem_free_host, cuMemFreeHost, void *);
 
 // Module and kernels
 PER_CUDA_FUNCTION(module_get_function, cuModuleGetFunction, void **, void *, const char *);
 PER_CUDA_FUNCTION(module_load_data_ex, cuModuleLoadDataEx, void **, const char *,
                   uint32, uint32 *, void **)
+PER_CUDA_FUNCTION(module_load_data, cuModuleLoadData, void **, const void *);
+PER_CUDA_FUNCTION(link_create, cuLinkCreate_v2, uint32, uint32 *, void **, void **);
+PER_CUDA_FUNCTION(link_add_data, cuLinkAddData_v2, void *, uint32, void *, std::size_t, const char *, uint32, uint32 *, void **);
+PER_CUDA_FUNCTION(link_complete, cuLinkComplete, void *, void **, std::size_t *);
+PER_CUDA_FUNCTION(link_destroy, cuLinkDestroy, void *);
 PER_CUDA_FUNCTION(launch_kernel, cuLaunchKernel, void *, uint32, uint32, uint32,
                   uint32, uint32, uint32, uint32, void *, void **, void **);
 PER_CUDA_FUNCTION(kernel_get_attribute, cuFuncGetAttribute, int *, uint32, void *);
+PER_CUDA_FUNCTION(kernel_set_attribute, cuFuncSetAttribute, void *, uint32, int);
 PER_CUDA_FUNCTION(kernel_get_occupancy, cuOccupancyMaxActiveBlocksPerMultiprocessor, int *, void *, int, size_t);
 
 // Stream management
 PER_CUDA_FUNCTION(stream_synchronize, cuStreamSynchronize, void *);
 
+// Graph management
+PER_CUDA_FUNCTION(graph_create, cuGraphCreate, void **, uint32);
+PER_CUDA_FUNCTION(graph_destroy, cuGraphDestroy, void *);
+PER_CUDA_FUNCTION(graph_add_kernel_node, cuGraphAddKernelNode, void **, void *, void **, std::size_t, const CUDA_KERNEL_NODE_PARAMS *);
+PER_CUDA_FUNCTION(graph_instantiate, cuGraphInstantiate, void **, void *, void **, char *, std::size_t);
+PER_CUDA_FUNCTION(graph_exec_destroy, cuGraphExecDestroy, void *);
+PER_CUDA_FUNCTION(graph_exec_kernel_node_set_params, cuGraphExecKernelNodeSetParams, void *, void *, const CUDA_KERNEL_NODE_PARAMS *);
+PER_CUDA_FUNCTION(graph_launch, cuGraphLaunch, void *, void *);
+
 // Event management
 PER_CUDA_FUNCTION(event_create, cuEventCreate, void **, uint32)
 PER_CUDA_FUNCTION(event_destroy, cuEventDestroy, void *)
 PER_CUDA_FUNCTION(event_record, cuEventRecord, void *, void *)
 PER_CUDA_FUNCTION(event_synchronize, cuEventSynchronize, void *);
+PER_CUDA_FUNCTION(event_query, cuEventQuery, void *);
 PER_CUDA_FUNCTION(event_elapsed_time, cuEventElapsedTime, float *, void *, void *);
 
 // Vulkan interop
@@ -0,0 +1,159 @@
+#include "taichi/backends/cuda/cuda_graph.h"
+
+#include <atomic>
+
+#include "taichi/backends/cuda/cuda_context.h"
+#include "taichi/backends/cuda/cuda_driver.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+std::atomic<uint64> num_launches{0};
+
+CUDA_KERNEL_NODE_PARAMS make_kernel_node_params(
+    void *func,
+    const std::vector<void *> &arg_pointers,
+    unsigned grid_dim,
+    unsigned block_dim,
+    std::size_t dynamic_shared_mem_bytes) {
+  CUDA_KERNEL_NODE_PARAMS params;
+  params.func = func;
+  params.gridDimX = grid_dim;
+  params.gridDimY = 1;
+  params.gridDimZ = 1;
+  params.blockDimX = block_dim;
+  params.blockDimY = 1;
+  params.blockDimZ = 1;
+  params.sharedMemBytes = (unsigned int)dynamic_shared_mem_bytes;
+  // The parameters are copied into the node.
+  params.kernelParams = const_cast<void **>(arg_pointers.data());
+  params.extra = nullptr;
+  return params;
+}
+
+}  // namespace
+
+CUDAGraph::CUDAGraph() = default;
+
+CUDAGraph::~CUDAGraph() {
+  reset();
+}
+
+void CUDAGraph::set_recording(Mode mode) {
+  auto &context = CUDAContext::get_instance();
+  if (mode != Mode::idle) {
+    TI_ERROR_IF(context.get_graph() != nullptr,
+                "Another CUDA graph is being recorded");
+    context.set_graph(this);
+  } else {
+    context.set_graph(nullptr);
+  }
+  mode_ = mode;
+}
+
+void CUDAGraph::reset() {
+  if (is_recording()) {
+    set_recording(Mode::idle);
+  }
+  CUDAContext::get_instance().make_current();
+  auto &driver = CUDADriver::get_instance();
+  if (graph_exec_) {
+    driver.graph_exec_destroy(graph_exec_);
+    graph_exec_ = nullptr;
+  }
+  if (graph_) {
+    driver.graph_destroy(graph_);
+    graph_ = nullptr;
+  }
+  nodes_.clear();
+}
+
+void CUDAGraph::begin_capture() {
+  TI_ERROR_IF(is_recording(), "The CUDA graph is already being recorded");
+  reset();
+  CUDADriver::get_instance().graph_create(&graph_, 0);
+  set_recording(Mode::capturing);
+}
+
+void CUDAGraph::end_capture() {
+  TI_ERROR_IF(mode_ != Mode::capturing, "The CUDA graph is not being captured");
+  set_recording(Mode::idle);
+  if (nodes_.empty()) {
+    return;
+  }
+  CUDADriver::get_instance().graph_instantiate(&graph_exec_, graph_, nullptr,
+                                               nullptr, 0);
+  TI_TRACE("Instantiated a CUDA graph of {} kernels", nodes_.size());
+  launch();
+}
+
+void CUDAGraph::begin_update() {
+  TI_ERROR_IF(is_recording(), "The CUDA graph is already being recorded");
+  TI_ERROR_IF(graph_ == nullptr, "The CUDA graph has not been captured");
+  update_cursor_ = 0;
+  set_recording(Mode::updating);
+}
+
+void CUDAGraph::end_update() {
+  TI_ERROR_IF(mode_ != Mode::updating, "The CUDA graph is not being updated");
+  set_recording(Mode::idle);
+  TI_ERROR_IF(update_cursor_ != nodes_.size(),
+              "{} kernels were launched while updating a CUDA graph of {} "
+              "kernels",
+              update_cursor_, nodes_.size());
+  launch();
+}
+
+void CUDAGraph::launch() {
+  TI_ERROR_IF(is_recording(), "Cannot launch a CUDA graph being recorded");
+  if (graph_exec_ == nullptr) {
+    return;
+  }
+  CUDAContext::get_instance().make_current();
+  num_launches++;
+  CUDADriver::get_instance().graph_launch(graph_exec_, nullptr);
+}
+
+uint64 CUDAGraph::get_num_launches() {
+  return num_launches;
+}
+
+void CUDAGraph::record_launch(void *func,
+                              const std::string &task_name,
+                              const std::vector<void *> &arg_pointers,
+                              unsigned grid_dim,
+                              unsigned block_dim,
+                              std::size_t dynamic_shared_mem_bytes) {
+  // Like CUDAContext::launch(), which skips them, e.g. a range-for of zero
+  // iterations. A kernel node cannot have an empty grid.
+  if (grid_dim == 0) {
+    return;
+  }
+  auto params = make_kernel_node_params(func, arg_pointers, grid_dim,
+                                        block_dim, dynamic_shared_mem_bytes);
+  auto &driver = CUDADriver::get_instance();
+  if (mode_ == Mode::capturing) {
+    Node node;
+    node.func = func;
+    node.task_name = task_name;
+    // Serialize the tasks, just like the launches on the default stream.
+    void *dependency = nodes_.empty() ? nullptr : nodes_.back().node;
+    driver.graph_add_kernel_node(&node.node, graph_, &dependency,
+                                 dependency ? 1 : 0, &params);
+    nodes_.push_back(std::move(node));
+  } else {
+    TI_ASSERT(mode_ == Mode::updating);
+    TI_ERROR_IF(update_cursor_ >= nodes_.size(),
+                "More kernels launched than captured in the CUDA graph");
+    const auto &node = nodes_[update_cursor_];
+    TI_ERROR_IF(node.func != func,
+                "Launching {} while updating the CUDA graph, but {} was "
+                "captured",
+                task_name, node.task_name);
+    driver.graph_exec_kernel_node_set_params(graph_exec_, node.node, &params);
+    update_cursor_++;
+  }
+}
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "taichi/lang_util.h"
+
+TLANG_NAMESPACE_BEGIN
+
+/**
+ * Records the CUDA kernels launched by a sequence of Taichi kernel calls into a
+ * CUDA graph, so that the whole sequence can be submitted with a single launch.
+ *
+ * Usage:
+ *   graph.begin_capture();
+ *   ... kernel calls ...
+ *   graph.end_capture();  // Runs the captured kernels once
+ *   graph.launch();       // Runs them again with the same arguments
+ *   graph.begin_update();
+ *   ... the same kernel calls, with different arguments ...
+ *   graph.end_update();   // Updates the arguments and runs the graph
+ *
+ * While capturing or updating, the launches of offloaded tasks (i.e.
+ * JITModule::launch) are intercepted instead of being submitted. Runtime calls
+ * such as memory allocation are not affected.
+ */
+class CUDAGraph {
+ public:
+  CUDAGraph();
+
+  ~CUDAGraph();
+
+  void begin_capture();
+
+  void end_capture();
+
+  void begin_update();
+
+  void end_update();
+
+  void launch();
+
+  // Stops recording and drops the captured graph, e.g. after an error.
+  void reset();
+
+  bool is_recording() const {
+    return mode_ != Mode::idle;
+  }
+
+  std::size_t get_num_nodes() const {
+    return nodes_.size();
+  }
+
+  // The number of launches of all the graphs so far. The kernels of a graph
+  // are not tracked by CUDAHostReadTracker.
+  static uint64 get_num_launches();
+
+  // Called instead of launching a task while recording. Tasks with an empty
+  // grid are not recorded.
+  void record_launch(void *func,
+                     const std::string &task_name,
+                     const std::vector<void *> &arg_pointers,
+                     unsigned grid_dim,
+                     unsigned block_dim,
+                     std::size_t dynamic_shared_mem_bytes);
+
+ private:
+  enum class Mode { idle, capturing, updating };
+
+  struct Node {
+    void *node{nullptr};
+    void *func{nullptr};
+    std::string task_name;
+  };
+
+  void set_recording(Mode mode);
+
+  Mode mode_{Mode::idle};
+  void *graph_{nullptr};
+  void *graph_exec_{nullptr};
+  std::vector<Node> nodes_;
+  // The next node to update when |mode_| is Mode::updating
+  std::size_t update_cursor_{0};
+};
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,166 @@
+#include "taichi/backends/cuda/cuda_host_read_tracker.h"
+
+#include <algorithm>
+
+#include "taichi/backends/cuda/cuda_context.h"
+#include "taichi/backends/cuda/cuda_driver.h"
+#include "taichi/backends/cuda/cuda_graph.h"
+#include "taichi/inc/constants.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+struct ThreadState {
+  bool last_launch_was_host_read{false};
+  std::vector<uint64> results;
+};
+
+thread_local ThreadState thread_state;
+
+constexpr std::size_t kResultBufferSize =
+    sizeof(uint64) * taichi_result_buffer_entries;
+
+}  // namespace
+
+CUDAHostReadTracker::CUDAHostReadTracker() {
+  auto &driver = CUDADriver::get_instance();
+  // Does not wait for the legacy default stream implicitly.
+  driver.stream_create(&stream_, CU_STREAM_NON_BLOCKING);
+  driver.event_create(&legacy_event_, CU_EVENT_DISABLE_TIMING);
+  driver.malloc((void **)&result_buffer_, kResultBufferSize);
+  driver.mem_alloc_host((void **)&host_result_buffer_, kResultBufferSize);
+  num_graph_launches_ = CUDAGraph::get_num_launches();
+}
+
+CUDAHostReadTracker::~CUDAHostReadTracker() {
+  CUDAContext::get_instance().make_current();
+  auto &driver = CUDADriver::get_instance();
+  driver.stream_synchronize(stream_);
+  record_unknown_writes();
+  for (auto &[buffer, _] : arg_buffers_) {
+    if (buffer != nullptr) {
+      driver.mem_free(buffer);
+    }
+  }
+  driver.mem_free(result_buffer_);
+  driver.mem_free_host(host_result_buffer_);
+  driver.event_destroy(legacy_event_);
+  driver.stream_destroy(stream_);
+}
+
+void CUDAHostReadTracker::begin_launch() {
+  thread_state.last_launch_was_host_read = false;
+}
+
+void CUDAHostReadTracker::record_writes(const std::unordered_set<int> &trees) {
+  auto &driver = CUDADriver::get_instance();
+  void *stream = CUDAContext::get_instance().get_stream();
+  std::lock_guard<std::mutex> _(events_mut_);
+  for (int tree_id : trees) {
+    auto &event = write_events_[tree_id];
+    if (event == nullptr) {
+      driver.event_create(&event, CU_EVENT_DISABLE_TIMING);
+    }
+    driver.event_record(event, stream);
+  }
+}
+
+void CUDAHostReadTracker::record_unknown_writes() {
+  std::lock_guard<std::mutex> _(events_mut_);
+  forget_all_trees();
+}
+
+void CUDAHostReadTracker::forget_all_trees() {
+  for (auto &[_, event] : write_events_) {
+    CUDADriver::get_instance().event_destroy(event);
+  }
+  write_events_.clear();
+}
+
+void CUDAHostReadTracker::forget_tree(int tree_id) {
+  std::lock_guard<std::mutex> _(events_mut_);
+  if (auto it = write_events_.find(tree_id); it != write_events_.end()) {
+    CUDADriver::get_instance().event_destroy(it->second);
+    write_events_.erase(it);
+  }
+}
+
+std::unique_ptr<CUDAHostReadTracker::HostRead>
+CUDAHostReadTracker::begin_host_read(const std::unordered_set<int> &trees) {
+  return std::make_unique<HostRead>(this, trees);
+}
+
+bool CUDAHostReadTracker::last_launch_was_host_read() {
+  return thread_state.last_launch_was_host_read;
+}
+
+uint64 CUDAHostReadTracker::get_result(int i) {
+  TI_ASSERT(thread_state.last_launch_was_host_read);
+  return thread_state.results[i];
+}
+
+CUDAHostReadTracker::HostRead::HostRead(CUDAHostReadTracker *tracker,
+                                        const std::unordered_set<int> &trees)
+    : tracker_(tracker), lock_(tracker->read_mut_) {
+  auto &driver = CUDADriver::get_instance();
+  {
+    std::lock_guard<std::mutex> _(tracker->events_mut_);
+    // The writes of the graphs are not tracked.
+    const uint64 num_graph_launches = CUDAGraph::get_num_launches();
+    if (num_graph_launches != tracker->num_graph_launches_) {
+      tracker->num_graph_launches_ = num_graph_launches;
+      tracker->forget_all_trees();
+    }
+    bool wait_for_legacy = false;
+    for (int tree_id : trees) {
+      auto it = tracker->write_events_.find(tree_id);
+      if (it == tracker->write_events_.end()) {
+        wait_for_legacy = true;
+      } else {
+        driver.stream_wait_event(tracker->stream_, it->second, 0);
+      }
+    }
+    if (wait_for_legacy) {
+      driver.event_record(tracker->legacy_event_, nullptr);
+      driver.stream_wait_event(tracker->stream_, tracker->legacy_event_, 0);
+    }
+  }
+  auto &context = CUDAContext::get_instance();
+  old_stream_ = context.get_stream();
+  context.set_stream(tracker->stream_);
+}
+
+CUDAHostReadTracker::HostRead::~HostRead() {
+  auto &driver = CUDADriver::get_instance();
+  driver.memcpy_device_to_host_async(tracker_->host_result_buffer_,
+                                     tracker_->result_buffer_,
+                                     kResultBufferSize, tracker_->stream_);
+  driver.stream_synchronize(tracker_->stream_);
+  thread_state.results.assign(
+      tracker_->host_result_buffer_,
+      tracker_->host_result_buffer_ + taichi_result_buffer_entries);
+  thread_state.last_launch_was_host_read = true;
+  CUDAContext::get_instance().set_stream(old_stream_);
+}
+
+void *CUDAHostReadTracker::HostRead::get_arg_buffer(int arg_id,
+                                                   std::size_t size) {
+  auto &buffers = tracker_->arg_buffers_;
+  if ((int)buffers.size() <= arg_id) {
+    buffers.resize(arg_id + 1, {nullptr, 0});
+  }
+  auto &[buffer, capacity] = buffers[arg_id];
+  if (capacity < size) {
+    auto &driver = CUDADriver::get_instance();
+    if (buffer != nullptr) {
+      driver.mem_free(buffer);
+    }
+    // Grows geometrically, so that the buffers are seldom freed.
+    capacity = std::max(size, capacity * 2);
+    driver.malloc(&buffer, capacity);
+  }
+  return buffer;
+}
+
+TLANG_NAMESPACE_END
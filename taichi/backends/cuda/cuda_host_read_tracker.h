@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "taichi/lang_util.h"
+
+TLANG_NAMESPACE_BEGIN
+
+/**
+ * Tracks the last kernels writing each SNode tree on CUDA, so that the kernels
+ * reading the trees into host memory wait for those only, instead of for all
+ * the kernels launched so far. Used when
+ * CompileConfig::cuda_fine_grained_host_sync is set.
+ *
+ * An event is recorded after each launch on the trees the kernel writes, see
+ * irpass::analysis::gather_snode_tree_accesses(). A host read runs on a stream
+ * of its own, which waits for the events of the trees it reads, and for all
+ * the work submitted so far for the trees without one, e.g. those only
+ * written by the runtime. The ndarrays and the external arrays on the device
+ * are not tracked: the kernels taking them synchronize as usual.
+ *
+ * Usage:
+ *   auto host_read = tracker->begin_host_read(trees);  // Switches the stream
+ *   ... copy the arguments, launch the kernel ...
+ *   host_read.reset();  // Waits for the kernel, restores the stream
+ */
+class CUDAHostReadTracker {
+ public:
+  CUDAHostReadTracker();
+
+  ~CUDAHostReadTracker();
+
+  // Called at the beginning of each launch of the calling thread.
+  static void begin_launch();
+
+  // Records the kernels launched so far on the stream of the calling thread
+  // as the last writers of |trees|.
+  void record_writes(const std::unordered_set<int> &trees);
+
+  // Forgets the last writers of all the trees, e.g. after a kernel writing
+  // through a pointer whose SNode is unknown.
+  void record_unknown_writes();
+
+  // Called when the tree is destroyed, as its id may be reused.
+  void forget_tree(int tree_id);
+
+  class HostRead {
+   public:
+    HostRead(CUDAHostReadTracker *tracker,
+             const std::unordered_set<int> &trees);
+
+    // Waits for the kernel, and copies its return values into host memory.
+    ~HostRead();
+
+    // A device buffer of at least |size| bytes for the external array
+    // |arg_id|, kept across the host reads, as freeing device memory
+    // synchronizes the device.
+    void *get_arg_buffer(int arg_id, std::size_t size);
+
+    uint64 *get_result_buffer() const {
+      return tracker_->result_buffer_;
+    }
+
+   private:
+    CUDAHostReadTracker *tracker_;
+    std::unique_lock<std::mutex> lock_;
+    void *old_stream_{nullptr};
+  };
+
+  // Only one host read runs at a time.
+  std::unique_ptr<HostRead> begin_host_read(
+      const std::unordered_set<int> &trees);
+
+  // Whether the last launch of the calling thread was a host read, in which
+  // case it is done, and its return values are held by the thread.
+  static bool last_launch_was_host_read();
+
+  // The return value |i| of the last launch of the calling thread, which
+  // must be a host read.
+  static uint64 get_result(int i);
+
+ private:
+  // Requires |events_mut_|.
+  void forget_all_trees();
+
+  std::mutex events_mut_;
+  std::unordered_map<int, void *> write_events_;
+  uint64 num_graph_launches_{0};
+
+  std::mutex read_mut_;
+  void *stream_{nullptr};
+  // Recorded on the legacy default stream, for the trees without an event.
+  void *legacy_event_{nullptr};
+  std::vector<std::pair<void *, std::size_t>> arg_buffers_;
+  uint64 *result_buffer_{nullptr};
+  uint64 *host_result_buffer_{nullptr};
+};
+
+TLANG_NAMESPACE_END
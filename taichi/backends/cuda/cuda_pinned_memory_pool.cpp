@@ -0,0 +1,200 @@
+#include "taichi/backends/cuda/cuda_pinned_memory_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "taichi/backends/cuda/cuda_context.h"
+#include "taichi/backends/cuda/cuda_driver.h"
+#include "taichi/util/metrics.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+// Below this size, the fixed costs of staging outweigh the bandwidth gained.
+constexpr std::size_t kMinStagedSize = 1 << 20;
+constexpr std::size_t kStagingChunkSize = 4 << 20;
+constexpr std::size_t kNumStagingBuffers = 2;
+
+// Two pinned buffers from the pool, each with an event marking the end of the
+// last copy using it.
+class StagingBuffers {
+ public:
+  explicit StagingBuffers(std::size_t size) {
+    auto &pool = CUDAPinnedMemoryPool::get_instance();
+    for (std::size_t i = 0; i < kNumStagingBuffers; i++) {
+      buffers_[i] = (uint8 *)pool.allocate(size, &capacities_[i]);
+      CUDADriver::get_instance().event_create(&events_[i],
+                                              CU_EVENT_DISABLE_TIMING);
+    }
+  }
+
+  ~StagingBuffers() {
+    auto &pool = CUDAPinnedMemoryPool::get_instance();
+    for (std::size_t i = 0; i < kNumStagingBuffers; i++) {
+      CUDADriver::get_instance().event_destroy(events_[i]);
+      pool.release(buffers_[i], capacities_[i]);
+    }
+  }
+
+  uint8 *buffer(std::size_t i) {
+    return buffers_[i % kNumStagingBuffers];
+  }
+
+  void *event(std::size_t i) {
+    return events_[i % kNumStagingBuffers];
+  }
+
+ private:
+  uint8 *buffers_[kNumStagingBuffers];
+  std::size_t capacities_[kNumStagingBuffers];
+  void *events_[kNumStagingBuffers];
+};
+
+}  // namespace
+
+CUDAPinnedMemoryPool &CUDAPinnedMemoryPool::get_instance() {
+  // Never destroyed: the CUDA driver may be unloaded before the static
+  // destructors run, and the pinned memory is released at exit anyway.
+  static auto *pool = new CUDAPinnedMemoryPool();
+  return *pool;
+}
+
+void *CUDAPinnedMemoryPool::allocate(std::size_t size, std::size_t *capacity) {
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    auto it = cached_.lower_bound(size);
+    // Does not hand out a buffer much larger than needed.
+    if (it != cached_.end() && it->first <= 2 * size) {
+      *capacity = it->first;
+      void *ptr = it->second;
+      cached_bytes_ -= it->first;
+      cached_.erase(it);
+      return ptr;
+    }
+  }
+  void *ptr = nullptr;
+  CUDADriver::get_instance().mem_alloc_host(&ptr, size);
+  *capacity = size;
+  return ptr;
+}
+
+void CUDAPinnedMemoryPool::release(void *ptr, std::size_t capacity) {
+  std::vector<void *> evicted;
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    cached_.emplace(capacity, ptr);
+    cached_bytes_ += capacity;
+    // Evicts the smallest buffers, which are the cheapest to allocate again.
+    while (cached_bytes_ > kMaxCachedBytes) {
+      auto it = cached_.begin();
+      evicted.push_back(it->second);
+      cached_bytes_ -= it->first;
+      cached_.erase(it);
+    }
+  }
+  for (void *p : evicted) {
+    CUDADriver::get_instance().mem_free_host(p);
+  }
+}
+
+void CUDAPinnedMemoryPool::release_cached() {
+  std::multimap<std::size_t, void *> cached;
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    std::swap(cached, cached_);
+    cached_bytes_ = 0;
+  }
+  for (auto &it : cached) {
+    CUDADriver::get_instance().mem_free_host(it.second);
+  }
+}
+
+std::size_t CUDAPinnedMemoryPool::get_cached_bytes() {
+  std::lock_guard<std::mutex> _(mut_);
+  return cached_bytes_;
+}
+
+void cuda_memcpy_host_to_device_staged(void *dst,
+                                       const void *src,
+                                       std::size_t size) {
+  static auto &bytes = metrics().counter(
+      "taichi_host_to_device_bytes",
+      "Bytes copied from host to device for the kernel arguments.");
+  bytes.add(size);
+  auto &driver = CUDADriver::get_instance();
+  void *stream = CUDAContext::get_instance().get_stream();
+  if (size < kMinStagedSize) {
+    if (stream == nullptr) {
+      driver.memcpy_host_to_device(dst, const_cast<void *>(src), size);
+    } else {
+      // The synchronous copies are ordered after the whole legacy default
+      // stream.
+      driver.memcpy_host_to_device_async(dst, const_cast<void *>(src), size,
+                                         stream);
+      driver.stream_synchronize(stream);
+    }
+    return;
+  }
+  StagingBuffers staging(std::min(size, kStagingChunkSize));
+  for (std::size_t offset = 0, i = 0; offset < size;
+       offset += kStagingChunkSize, i++) {
+    const std::size_t n = std::min(kStagingChunkSize, size - offset);
+    if (i >= kNumStagingBuffers) {
+      // Waits for the DMA from this buffer, two chunks ago.
+      driver.event_synchronize(staging.event(i));
+    }
+    std::memcpy(staging.buffer(i), (const uint8 *)src + offset, n);
+    driver.memcpy_host_to_device_async((uint8 *)dst + offset,
+                                       staging.buffer(i), n, stream);
+    driver.event_record(staging.event(i), stream);
+  }
+  driver.stream_synchronize(stream);
+}
+
+void cuda_memcpy_device_to_host_staged(void *dst,
+                                       const void *src,
+                                       std::size_t size) {
+  static auto &bytes = metrics().counter(
+      "taichi_device_to_host_bytes",
+      "Bytes copied from device to host for the kernel arguments.");
+  bytes.add(size);
+  auto &driver = CUDADriver::get_instance();
+  void *stream = CUDAContext::get_instance().get_stream();
+  if (size < kMinStagedSize) {
+    if (stream == nullptr) {
+      driver.memcpy_device_to_host(dst, const_cast<void *>(src), size);
+    } else {
+      driver.memcpy_device_to_host_async(dst, const_cast<void *>(src), size,
+                                         stream);
+      driver.stream_synchronize(stream);
+    }
+    return;
+  }
+  StagingBuffers staging(std::min(size, kStagingChunkSize));
+  const std::size_t num_chunks =
+      (size + kStagingChunkSize - 1) / kStagingChunkSize;
+  auto enqueue = [&](std::size_t i) {
+    const std::size_t offset = i * kStagingChunkSize;
+    const std::size_t n = std::min(kStagingChunkSize, size - offset);
+    driver.memcpy_device_to_host_async(
+        staging.buffer(i), (uint8 *)const_cast<void *>(src) + offset, n,
+        stream);
+    driver.event_record(staging.event(i), stream);
+  };
+  enqueue(0);
+  for (std::size_t i = 0; i < num_chunks; i++) {
+    // The DMA of the next chunk overlaps with the host-side copy of this
+    // one. Its buffer was last copied out in the previous iteration.
+    if (i + 1 < num_chunks) {
+      enqueue(i + 1);
+    }
+    const std::size_t offset = i * kStagingChunkSize;
+    const std::size_t n = std::min(kStagingChunkSize, size - offset);
+    driver.event_synchronize(staging.event(i));
+    std::memcpy((uint8 *)dst + offset, staging.buffer(i), n);
+  }
+}
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+
+#include "taichi/lang_util.h"
+
+TLANG_NAMESPACE_BEGIN
+
+/**
+ * A pool of page-locked (pinned) host buffers for host<->device transfers.
+ *
+ * The copy engine reads and writes pinned memory directly, while a copy from
+ * or to pageable memory goes through a bounce buffer of the driver at about
+ * half the bandwidth. Page-locking memory takes far longer than the copies
+ * themselves, so the released buffers are kept for reuse, up to
+ * |kMaxCachedBytes| in total.
+ *
+ * Thread safe.
+ */
+class CUDAPinnedMemoryPool {
+ public:
+  static CUDAPinnedMemoryPool &get_instance();
+
+  // Returns a buffer of at least |size| bytes. Its actual size is stored into
+  // |capacity|, and must be passed to release().
+  void *allocate(std::size_t size, std::size_t *capacity);
+
+  void release(void *ptr, std::size_t capacity);
+
+  // Frees the cached buffers.
+  void release_cached();
+
+  std::size_t get_cached_bytes();
+
+ private:
+  static constexpr std::size_t kMaxCachedBytes = 256 << 20;
+
+  std::mutex mut_;
+  std::multimap<std::size_t, void *> cached_;
+  std::size_t cached_bytes_{0};
+};
+
+// Synchronous copies between pageable host memory and device memory, like
+// cuMemcpyHtoD/DtoH, staged through pinned buffers of the pool in chunks. The
+// host-side copy of a chunk overlaps with the DMA of the previous one. Small
+// copies go to the driver directly.
+void cuda_memcpy_host_to_device_staged(void *dst,
+                                       const void *src,
+                                       std::size_t size);
+
+void cuda_memcpy_device_to_host_staged(void *dst,
+                                       const void *src,
+                                       std::size_t size);
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,120 @@
+#include "taichi/backends/cuda/cuda_print_buffer.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "taichi/backends/cuda/cuda_context.h"
+#include "taichi/backends/cuda/cuda_driver.h"
+#include "taichi/ir/type_utils.h"
+#include "taichi/system/timer.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+constexpr double kPollIntervalUs = 1000;
+
+// Formats a printed value, stored by CodeGenLLVMCUDA::visit(PrintStmt *) as
+// the bits of a double for the real types, and sign- or zero-extended to 64
+// bits for the integral ones.
+std::string format_value(DataType dt, uint64 bits) {
+  const auto format = data_type_format(dt);
+  char buf[64];
+  if (is_real(dt)) {
+    float64 value;
+    std::memcpy(&value, &bits, sizeof(value));
+    std::snprintf(buf, sizeof(buf), format.c_str(), value);
+  } else if (dt->is_primitive(PrimitiveTypeID::i64)) {
+    std::snprintf(buf, sizeof(buf), format.c_str(), (long long)bits);
+  } else if (dt->is_primitive(PrimitiveTypeID::u64)) {
+    std::snprintf(buf, sizeof(buf), format.c_str(), (unsigned long long)bits);
+  } else if (is_signed(dt)) {
+    std::snprintf(buf, sizeof(buf), format.c_str(), (int)(int64)bits);
+  } else {
+    std::snprintf(buf, sizeof(buf), format.c_str(), (unsigned)bits);
+  }
+  return buf;
+}
+
+}  // namespace
+
+CUDAPrintBuffer::CUDAPrintBuffer(std::size_t size_in_bytes) {
+  capacity_ = size_in_bytes / sizeof(uint64) - 1;
+  TI_ASSERT(capacity_ > 0);
+  CUDAContext::get_instance().make_current();
+  CUDADriver::get_instance().mem_alloc_host(&buffer_, size_in_bytes);
+  std::memset(buffer_, 0, size_in_bytes);
+  thread_ = std::make_unique<std::thread>([this] {
+    while (!terminating_) {
+      Time::usleep(kPollIntervalUs);
+      drain();
+    }
+  });
+}
+
+CUDAPrintBuffer::~CUDAPrintBuffer() {
+  terminating_ = true;
+  thread_->join();
+  drain();
+  CUDADriver::get_instance().mem_free_host(buffer_);
+}
+
+int CUDAPrintBuffer::register_format(const std::vector<FormatItem> &items) {
+  std::lock_guard<std::mutex> _(formats_mut_);
+  for (int i = 0; i < (int)formats_.size(); i++) {
+    if (formats_[i] == items) {
+      return i;
+    }
+  }
+  formats_.push_back(items);
+  return (int)formats_.size() - 1;
+}
+
+void CUDAPrintBuffer::flush() {
+  drain();
+}
+
+void CUDAPrintBuffer::drain() {
+  std::lock_guard<std::mutex> _(drain_mut_);
+  auto *tail_ptr = (volatile uint64 *)buffer_;
+  auto *records = tail_ptr + 1;
+  uint64 tail = *tail_ptr;
+  std::string output;
+  while (true) {
+    const uint64 header = records[tail % capacity_];
+    if (header == 0) {
+      break;
+    }
+    // The words of the record were stored before its header.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64 num_words = header >> 32;
+    const int format_id = (int)(header & 0xffffffffu) - 1;
+    {
+      std::lock_guard<std::mutex> _(formats_mut_);
+      TI_ASSERT(format_id < (int)formats_.size());
+      uint64 i = 1;
+      for (const auto &item : formats_[format_id]) {
+        if (std::holds_alternative<std::string>(item)) {
+          output += std::get<std::string>(item);
+        } else {
+          output += format_value(std::get<DataType>(item),
+                                 records[(tail + i++) % capacity_]);
+        }
+      }
+      TI_ASSERT(i == num_words);
+    }
+    for (uint64 i = 0; i < num_words; i++) {
+      records[(tail + i) % capacity_] = 0;
+    }
+    tail += num_words;
+    // Frees the space of the record for the device.
+    std::atomic_thread_fence(std::memory_order_release);
+    *tail_ptr = tail;
+  }
+  if (!output.empty()) {
+    std::fputs(output.c_str(), stdout);
+    std::fflush(stdout);
+  }
+}
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "taichi/ir/type.h"
+#include "taichi/lang_util.h"
+
+TLANG_NAMESPACE_BEGIN
+
+/**
+ * A ring buffer of the records printed by the CUDA kernels, drained by a host
+ * thread, which replaces vprintf when CompileConfig::cuda_print_buffer_MB is
+ * set.
+ *
+ * vprintf writes into a fixed-size buffer of the driver, which is only
+ * flushed at the synchronization points, so the output past its size is lost.
+ * Here a record holds the id of its format, registered at codegen time, and
+ * one 64-bit word per printed value. The buffer lives in pinned host memory,
+ * which the kernels write through UVA, and the host thread formats and prints
+ * the records as they are committed. When the buffer is full, the printing
+ * threads wait for the host to free some space instead of dropping output.
+ *
+ * Layout, in 64-bit words: the tail (the number of words consumed by the
+ * host) followed by |capacity| words of records. The first word of a record
+ * is its header, (num_words << 32) | (format_id + 1), stored last by the
+ * device; the host zeroes the words of a record before consuming it. See
+ * print_buffer_reserve() in runtime.cpp for the device side.
+ *
+ * Thread safe.
+ */
+class CUDAPrintBuffer {
+ public:
+  // A string literal, or the type of a printed value.
+  using FormatItem = std::variant<std::string, DataType>;
+
+  explicit CUDAPrintBuffer(std::size_t size_in_bytes);
+
+  ~CUDAPrintBuffer();
+
+  // Returns the id of the format of the records printing |items|.
+  int register_format(const std::vector<FormatItem> &items);
+
+  // Prints the records committed so far. Called once the kernels are done.
+  void flush();
+
+  void *get_buffer() const {
+    return buffer_;
+  }
+
+  // The number of words of records the buffer holds.
+  std::size_t get_capacity() const {
+    return capacity_;
+  }
+
+ private:
+  void drain();
+
+  void *buffer_{nullptr};
+  std::size_t capacity_{0};
+
+  std::mutex formats_mut_;
+  std::vector<std::vector<FormatItem>> formats_;
+
+  // Serializes drain() between the host thread and flush().
+  std::mutex drain_mut_;
+  std::atomic<bool> terminating_{false};
+  std::unique_ptr<std::thread> thread_;
+};
+
+TLANG_NAMESPACE_END
@@ -11,6 +11,9 @@ TLANG_NAMESPACE_BEGIN
 // will not affect default toolkit (cuEvent)
 KernelProfilerCUDA::KernelProfilerCUDA(bool enable) {
   metric_list_.clear();
+  CUDADriver::get_instance().device_get_attribute(
+      &max_threads_per_multiprocessor_,
+      CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_MULTIPROCESSOR, nullptr);
   if (enable) {
     tool_ = ProfilingToolkit::event;
 #if defined(TI_WITH_CUDA_TOOLKIT)
@@ -70,31 +73,14 @@ void KernelProfilerCUDA::trace(KernelProfilerBase::TaskHandle &task_handle,
                                uint32_t grid_size,
                                uint32_t block_size,
                                uint32_t dynamic_smem_size) {
-  int register_per_thread = 0;
-  int static_shared_mem_per_block = 0;
-  int max_active_blocks_per_multiprocessor = 0;
-  CUDADriver::get_instance().kernel_get_attribute(
-      &register_per_thread, CUfunction_attribute::CU_FUNC_ATTRIBUTE_NUM_REGS,
-      kernel);
-  CUDADriver::get_instance().kernel_get_attribute(
-      &static_shared_mem_per_block,
-      CUfunction_attribute::CU_FUNC_ATTRIBUTE_SHARED_SIZE_BYTES, kernel);
-  CUDADriver::get_instance().kernel_get_occupancy(
-      &max_active_blocks_per_multiprocessor, kernel, block_size,
-      dynamic_smem_size);
+  KernelProfileTracedRecord record;
+  record.name = kernel_name;
+  get_kernel_attributes(record, kernel, grid_size, block_size,
+                        dynamic_smem_size);
 
   if (tool_ == ProfilingToolkit::event) {
     task_handle = event_toolkit_->start_with_handle(kernel_name);
   }
-  KernelProfileTracedRecord record;
-  record.name = kernel_name;
-  record.register_per_thread = register_per_thread;
-  record.shared_mem_per_block = static_shared_mem_per_block + dynamic_smem_size;
-  record.grid_size = grid_size;
-  record.block_size = block_size;
-  record.active_blocks_per_multiprocessor =
-      max_active_blocks_per_multiprocessor;
-
   traced_records_.push_back(record);
 }
 
@@ -153,30 +139,46 @@ bool KernelProfilerCUDA::record_kernel_attributes(void *kernel,
                                                   uint32_t grid_size,
                                                   uint32_t block_size,
                                                   uint32_t dynamic_smem_size) {
+  get_kernel_attributes(traced_records_.back(), kernel, grid_size, block_size,
+                        dynamic_smem_size);
+  return true;
+}
+
+void KernelProfilerCUDA::get_kernel_attributes(
+    KernelProfileTracedRecord &record,
+    void *kernel,
+    uint32_t grid_size,
+    uint32_t block_size,
+    uint32_t dynamic_smem_size) {
+  auto &driver = CUDADriver::get_instance();
   int register_per_thread = 0;
+  int local_mem_per_thread = 0;
   int static_shared_mem_per_block = 0;
   int max_active_blocks_per_multiprocessor = 0;
-
-  CUDADriver::get_instance().kernel_get_attribute(
-      &register_per_thread, CUfunction_attribute::CU_FUNC_ATTRIBUTE_NUM_REGS,
-      kernel);
-  CUDADriver::get_instance().kernel_get_attribute(
+  driver.kernel_get_attribute(&register_per_thread,
+                              CUfunction_attribute::CU_FUNC_ATTRIBUTE_NUM_REGS,
+                              kernel);
+  driver.kernel_get_attribute(
+      &local_mem_per_thread,
+      CUfunction_attribute::CU_FUNC_ATTRIBUTE_LOCAL_SIZE_BYTES, kernel);
+  driver.kernel_get_attribute(
       &static_shared_mem_per_block,
       CUfunction_attribute::CU_FUNC_ATTRIBUTE_SHARED_SIZE_BYTES, kernel);
-  CUDADriver::get_instance().kernel_get_occupancy(
-      &max_active_blocks_per_multiprocessor, kernel, block_size,
-      dynamic_smem_size);
-
-  KernelProfileTracedRecord &traced_record = traced_records_.back();
-  traced_record.register_per_thread = register_per_thread;
-  traced_record.shared_mem_per_block =
-      static_shared_mem_per_block + dynamic_smem_size;
-  traced_record.grid_size = grid_size;
-  traced_record.block_size = block_size;
-  traced_record.active_blocks_per_multiprocessor =
-      max_active_blocks_per_multiprocessor;
+  driver.kernel_get_occupancy(&max_active_blocks_per_multiprocessor, kernel,
+                              block_size, dynamic_smem_size);
 
-  return true;
+  record.register_per_thread = register_per_thread;
+  record.local_mem_per_thread = local_mem_per_thread;
+  record.shared_mem_per_block = static_shared_mem_per_block + dynamic_smem_size;
+  record.grid_size = grid_size;
+  record.block_size = block_size;
+  record.active_blocks_per_multiprocessor =
+      max_active_blocks_per_multiprocessor;
+  if (max_threads_per_multiprocessor_ > 0) {
+    record.occupancy = std::min(
+        1.0f, (float)(max_active_blocks_per_multiprocessor * block_size) /
+                  max_threads_per_multiprocessor_);
+  }
 }
 
 #else
@@ -304,16 +306,12 @@ void EventToolkit::update_timeline(
   if (Timelines::get_instance().get_enabled()) {
     auto &timeline = Timeline::get_this_thread_instance();
     for (auto &record : traced_records) {
-      // param of insert_event() :
-      // struct TimelineEvent @ taichi/taichi/system/timeline.h
-      timeline.insert_event({record.name, /*param_name=begin*/ true,
-                             base_time_ + record.time_since_base * 1e-3,
-                             "cuda"});
-      timeline.insert_event({record.name, /*param_name=begin*/ false,
-                             base_time_ + (record.time_since_base +
-                                           record.kernel_elapsed_time_in_ms) *
-                                              1e-3,
-                             "cuda"});
+      timeline.insert_span(
+          record.name, base_time_ + record.time_since_base * 1e-3,
+          base_time_ +
+              (record.time_since_base + record.kernel_elapsed_time_in_ms) *
+                  1e-3,
+          "cuda");
     }
   }
 }
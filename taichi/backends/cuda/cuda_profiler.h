@@ -48,6 +48,13 @@ class KernelProfilerCUDA : public KernelProfilerBase {
                                 uint32_t dynamic_smem_size);
 
  private:
+  // Fills in the registers, memory and occupancy of a launch of |kernel|.
+  void get_kernel_attributes(KernelProfileTracedRecord &record,
+                             void *kernel,
+                             uint32_t grid_size,
+                             uint32_t block_size,
+                             uint32_t dynamic_smem_size);
+
   ProfilingToolkit tool_ = ProfilingToolkit::undef;
   std::unique_ptr<EventToolkit> event_toolkit_{nullptr};
   // if(tool_ == ProfilingToolkit::cupti) event_toolkit_ = nullptr
@@ -56,6 +63,7 @@ class KernelProfilerCUDA : public KernelProfilerBase {
   // TODO : switch profiling toolkit at runtime
   std::vector<std::string> metric_list_;
   uint32_t records_size_after_sync_{0};
+  int max_threads_per_multiprocessor_{0};
 };
 
 // default profiling toolkit
@@ -0,0 +1,61 @@
+#include "taichi/backends/cuda/cuda_readback.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "taichi/backends/cuda/cuda_context.h"
+#include "taichi/backends/cuda/cuda_driver.h"
+#include "taichi/backends/cuda/cuda_pinned_memory_pool.h"
+
+TLANG_NAMESPACE_BEGIN
+
+CUDAReadback::CUDAReadback(uint64 device_ptr, std::size_t size)
+    : size_(size) {
+  auto &context = CUDAContext::get_instance();
+  context.make_current();
+  auto &driver = CUDADriver::get_instance();
+  host_buffer_ = CUDAPinnedMemoryPool::get_instance().allocate(
+      std::max<std::size_t>(size, 1), &capacity_);
+  driver.event_create(&event_, CU_EVENT_DISABLE_TIMING);
+  void *stream = context.get_stream();
+  if (size > 0) {
+    driver.memcpy_device_to_host_async(host_buffer_, (void *)device_ptr, size,
+                                       stream);
+  }
+  driver.event_record(event_, stream);
+}
+
+CUDAReadback::~CUDAReadback() {
+  CUDAContext::get_instance().make_current();
+  wait();
+  CUDADriver::get_instance().event_destroy(event_);
+  CUDAPinnedMemoryPool::get_instance().release(host_buffer_, capacity_);
+}
+
+bool CUDAReadback::is_ready() {
+  if (!done_) {
+    CUDAContext::get_instance().make_current();
+    const uint32 ret = CUDADriver::get_instance().event_query.call(event_);
+    TI_ERROR_IF(ret != CUDA_SUCCESS && ret != CUDA_ERROR_NOT_READY,
+                "cuEventQuery failed with error code {}", ret);
+    done_ = ret == CUDA_SUCCESS;
+  }
+  return done_;
+}
+
+void CUDAReadback::wait() {
+  if (!done_) {
+    CUDAContext::get_instance().make_current();
+    CUDADriver::get_instance().event_synchronize(event_);
+    done_ = true;
+  }
+}
+
+void CUDAReadback::copy_to(uint64 dst, std::size_t size) {
+  TI_ERROR_IF(size != size_, "Reading back {} bytes into a buffer of {} bytes",
+              size_, size);
+  wait();
+  std::memcpy((void *)dst, host_buffer_, size);
+}
+
+TLANG_NAMESPACE_END
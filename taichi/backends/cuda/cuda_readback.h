@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+
+#include "taichi/lang_util.h"
+
+TLANG_NAMESPACE_BEGIN
+
+/**
+ * Copies device memory into pinned host memory without blocking the host.
+ *
+ * The copy is enqueued on the stream of the calling thread (see
+ * CUDAContext::set_stream()), so it starts once the kernels launched before
+ * it are done, and the kernels launched after it may overlap with it.
+ *
+ * The pinned buffers come from CUDAPinnedMemoryPool, so that reading back a
+ * field every frame does not pay for page-locking host memory each time.
+ *
+ * Usage:
+ *   CUDAReadback readback(device_ptr, size);  // Returns immediately
+ *   ... launch the kernels of the next frame ...
+ *   readback.copy_to(host_ptr, size);  // Waits for the copy
+ */
+class CUDAReadback {
+ public:
+  CUDAReadback(uint64 device_ptr, std::size_t size);
+
+  // Waits for the copy if it is still in flight.
+  ~CUDAReadback();
+
+  bool is_ready();
+
+  void wait();
+
+  // Waits for the copy, then copies the data into |dst|, which holds |size|
+  // bytes.
+  void copy_to(uint64 dst, std::size_t size);
+
+  std::size_t get_size() const {
+    return size_;
+  }
+
+ private:
+  void *host_buffer_{nullptr};
+  std::size_t capacity_{0};
+  std::size_t size_{0};
+  void *event_{nullptr};
+  bool done_{false};
+};
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,146 @@
+#include "taichi/backends/cuda/cuda_stream_scheduler.h"
+
+#include <algorithm>
+
+#include "taichi/backends/cuda/cuda_context.h"
+#include "taichi/backends/cuda/cuda_driver.h"
+
+TLANG_NAMESPACE_BEGIN
+
+CUDAStreamScheduler::CUDAStreamScheduler(int num_streams) {
+  TI_ASSERT(num_streams > 0);
+  auto guard = CUDAContext::get_instance().get_guard();
+  auto &driver = CUDADriver::get_instance();
+  streams_.resize(num_streams);
+  join_events_.resize(num_streams);
+  for (int i = 0; i < num_streams; i++) {
+    driver.stream_create(&streams_[i], CU_STREAM_DEFAULT);
+    driver.event_create(&join_events_[i], CU_EVENT_DISABLE_TIMING);
+  }
+  stream_tails_.assign(num_streams, -1);
+  stream_busy_.assign(num_streams, false);
+  TI_TRACE("Created {} CUDA streams for the async engine", num_streams);
+}
+
+CUDAStreamScheduler::~CUDAStreamScheduler() {
+  synchronize();
+  auto guard = CUDAContext::get_instance().get_guard();
+  auto &driver = CUDADriver::get_instance();
+  for (auto *event : task_events_) {
+    driver.event_destroy(event);
+  }
+  for (auto *event : join_events_) {
+    driver.event_destroy(event);
+  }
+  for (auto *stream : streams_) {
+    driver.stream_destroy(stream);
+  }
+}
+
+void CUDAStreamScheduler::begin_batch(
+    std::vector<std::vector<int>> dependencies) {
+  join_streams();
+  dependencies_ = std::move(dependencies);
+  const int num_tasks = dependencies_.size();
+  has_dependents_.assign(num_tasks, false);
+  for (auto &deps : dependencies_) {
+    for (auto d : deps) {
+      has_dependents_[d] = true;
+    }
+  }
+  task_streams_.assign(num_tasks, -1);
+  std::fill(stream_tails_.begin(), stream_tails_.end(), -1);
+
+  if ((int)task_events_.size() < num_tasks) {
+    auto guard = CUDAContext::get_instance().get_guard();
+    // Events are reused across batches: a wait only depends on the state of
+    // the event at the time it is issued.
+    const int old_size = task_events_.size();
+    task_events_.resize(num_tasks);
+    for (int i = old_size; i < num_tasks; i++) {
+      CUDADriver::get_instance().event_create(&task_events_[i],
+                                              CU_EVENT_DISABLE_TIMING);
+    }
+  }
+}
+
+int CUDAStreamScheduler::pick_stream(int task_id) {
+  const auto &deps = dependencies_[task_id];
+  // Continue the chain of a dependency if possible.
+  for (auto it = deps.rbegin(); it != deps.rend(); ++it) {
+    const int s = task_streams_[*it];
+    if (stream_tails_[s] == *it) {
+      return s;
+    }
+  }
+  const int n = streams_.size();
+  for (int k = 0; k < n; k++) {
+    const int s = (next_stream_ + k) % n;
+    if (stream_tails_[s] == -1) {
+      next_stream_ = (s + 1) % n;
+      return s;
+    }
+  }
+  if (!deps.empty()) {
+    return task_streams_[deps.back()];
+  }
+  const int s = next_stream_;
+  next_stream_ = (next_stream_ + 1) % n;
+  return s;
+}
+
+void CUDAStreamScheduler::before_launch(int task_id) {
+  TI_ASSERT(task_id < (int)dependencies_.size());
+  const int s = pick_stream(task_id);
+  auto guard = CUDAContext::get_instance().get_guard();
+  for (auto d : dependencies_[task_id]) {
+    if (task_streams_[d] != s) {
+      CUDADriver::get_instance().stream_wait_event(streams_[s],
+                                                   task_events_[d], 0);
+    }
+  }
+  task_streams_[task_id] = s;
+  stream_tails_[s] = task_id;
+  stream_busy_[s] = true;
+  CUDAContext::get_instance().set_stream(streams_[s]);
+}
+
+void CUDAStreamScheduler::after_launch(int task_id) {
+  CUDAContext::get_instance().set_stream(nullptr);
+  if (has_dependents_[task_id]) {
+    auto guard = CUDAContext::get_instance().get_guard();
+    CUDADriver::get_instance().event_record(task_events_[task_id],
+                                            streams_[task_streams_[task_id]]);
+  }
+}
+
+void CUDAStreamScheduler::join_streams() {
+  const int n = streams_.size();
+  if (n == 1 || std::none_of(stream_busy_.begin(), stream_busy_.end(),
+                             [](bool busy) { return busy; })) {
+    return;
+  }
+  // Fan in to stream 0, then fan out.
+  auto guard = CUDAContext::get_instance().get_guard();
+  auto &driver = CUDADriver::get_instance();
+  for (int s = 1; s < n; s++) {
+    if (stream_busy_[s]) {
+      driver.event_record(join_events_[s], streams_[s]);
+      driver.stream_wait_event(streams_[0], join_events_[s], 0);
+    }
+  }
+  driver.event_record(join_events_[0], streams_[0]);
+  for (int s = 1; s < n; s++) {
+    driver.stream_wait_event(streams_[s], join_events_[0], 0);
+  }
+  std::fill(stream_busy_.begin(), stream_busy_.end(), false);
+}
+
+void CUDAStreamScheduler::synchronize() {
+  auto guard = CUDAContext::get_instance().get_guard();
+  for (auto *stream : streams_) {
+    CUDADriver::get_instance().stream_synchronize(stream);
+  }
+}
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+
+#include "taichi/program/async_engine.h"
+
+TLANG_NAMESPACE_BEGIN
+
+/**
+ * Maps the tasks of the async engine onto a pool of CUDA streams.
+ *
+ * A task is issued to the stream of one of its dependencies if it is the last
+ * task on that stream, so that chains of dependent tasks stay on one stream.
+ * Otherwise it goes to an idle stream (round-robin). The remaining
+ * dependencies on other streams become event waits. All the streams join at
+ * the beginning of each batch, since the dependency information does not cross
+ * batches.
+ *
+ * The streams are blocking ones, i.e. they are ordered with the operations on
+ * the legacy default stream, such as the synchronous memcpys and the runtime
+ * calls issued by the host thread.
+ */
+class CUDAStreamScheduler : public TaskStreamScheduler {
+ public:
+  explicit CUDAStreamScheduler(int num_streams);
+
+  ~CUDAStreamScheduler() override;
+
+  void begin_batch(std::vector<std::vector<int>> dependencies) override;
+
+  void before_launch(int task_id) override;
+
+  void after_launch(int task_id) override;
+
+  void synchronize() override;
+
+ private:
+  // Makes every stream wait for all the work issued so far.
+  void join_streams();
+
+  int pick_stream(int task_id);
+
+  std::vector<void *> streams_;
+  // Recorded at the end of the tasks that others depend on, indexed by task id.
+  std::vector<void *> task_events_;
+  // Recorded by join_streams(), one per stream.
+  std::vector<void *> join_events_;
+
+  // The dependencies of the current batch, see TaskStreamScheduler.
+  std::vector<std::vector<int>> dependencies_;
+  std::vector<bool> has_dependents_;
+  std::vector<int> task_streams_;
+  // The last task of the current batch issued to each stream, or -1.
+  std::vector<int> stream_tails_;
+  // Whether there's work on each stream since the last join.
+  std::vector<bool> stream_busy_;
+  int next_stream_{0};
+};
+
+TLANG_NAMESPACE_END
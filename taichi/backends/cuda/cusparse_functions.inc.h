@@ -0,0 +1,21 @@
+// clang-format off
+
+// Library management
+PER_CUSPARSE_FUNCTION(create, cusparseCreate, void **);
+PER_CUSPARSE_FUNCTION(destroy, cusparseDestroy, void *);
+
+// COO sorting and conversion
+PER_CUSPARSE_FUNCTION(coosort_buffer_size, cusparseXcoosort_bufferSizeExt, void *, int, int, int, const int *, const int *, std::size_t *);
+PER_CUSPARSE_FUNCTION(create_identity_permutation, cusparseCreateIdentityPermutation, void *, int, int *);
+PER_CUSPARSE_FUNCTION(coosort_by_row, cusparseXcoosortByRow, void *, int, int, int, int *, int *, int *, void *);
+PER_CUSPARSE_FUNCTION(gather, cusparseSgthr, void *, int, const float *, float *, const int *, uint32);
+PER_CUSPARSE_FUNCTION(coo2csr, cusparseXcoo2csr, void *, const int *, int, int, int *, uint32);
+
+// Sparse matrices and dense vectors (generic API)
+PER_CUSPARSE_FUNCTION(create_csr, cusparseCreateCsr, void **, int64, int64, int64, void *, void *, void *, uint32, uint32, uint32, uint32);
+PER_CUSPARSE_FUNCTION(destroy_sp_mat, cusparseDestroySpMat, void *);
+PER_CUSPARSE_FUNCTION(create_dn_vec, cusparseCreateDnVec, void **, int64, void *, uint32);
+PER_CUSPARSE_FUNCTION(destroy_dn_vec, cusparseDestroyDnVec, void *);
+PER_CUSPARSE_FUNCTION(spmv_buffer_size, cusparseSpMV_bufferSize, void *, uint32, const void *, void *, void *, const void *, void *, uint32, uint32, std::size_t *);
+PER_CUSPARSE_FUNCTION(spmv, cusparseSpMV, void *, uint32, const void *, void *, void *, const void *, void *, uint32, uint32, void *);
+// clang-format on
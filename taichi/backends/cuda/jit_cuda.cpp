@@ -1,17 +1,91 @@
 #include "taichi/backends/cuda/jit_cuda.h"
+#include "taichi/ir/pass_profiler.h"
+#include "taichi/llvm/llvm_offline_cache.h"
 
 TLANG_NAMESPACE_BEGIN
 
 #if defined(TI_WITH_CUDA)
 
+std::string cuda_mattrs();
+
+namespace {
+
+// The info log of the JIT, where ptxas lists the registers, spills and shared
+// memory of each function.
+class JITInfoLog {
+ public:
+  // Appends the options filling the log.
+  void add_options(int &num_options, uint32 *options, void **option_values) {
+    // The values of the integer options are passed in place of the pointers.
+    options[num_options] = CU_JIT_INFO_LOG_BUFFER;
+    option_values[num_options++] = buffer_;
+    options[num_options] = CU_JIT_INFO_LOG_BUFFER_SIZE_BYTES;
+    option_values[num_options++] = (void *)(std::uintptr_t)sizeof(buffer_);
+    options[num_options] = CU_JIT_LOG_VERBOSE;
+    option_values[num_options++] = (void *)(std::uintptr_t)1;
+  }
+
+  void report() const {
+    if (buffer_[0] != '\0') {
+      TI_DEBUG("CUDA JIT info:\n{}", buffer_);
+    }
+  }
+
+  static constexpr int kNumOptions = 3;
+
+ private:
+  char buffer_[16 * 1024]{};
+};
+
+}  // namespace
+
 JITModule *JITSessionCUDA ::add_module(std::unique_ptr<llvm::Module> M,
                                        int max_reg) {
-  auto ptx = compile_module_to_ptx(M);
-  if (get_current_program().config.print_kernel_nvptx) {
+  std::string ptx;
+  std::string cache_key;
+  auto *cache = get_offline_cache(Arch::cuda);
+  if (cache || config_->soft_reset) {
+    const auto salt = fmt::format(
+        "sm_{}/{}/fast_math={}",
+        CUDAContext::get_instance().get_compute_capability(), cuda_mattrs(),
+        config_->fast_math);
+    cache_key = LlvmOfflineCache::make_key(M.get(), salt);
+  }
+  // The PTX is loaded with |max_reg|, which the offline cache does not need.
+  const auto memo_key = fmt::format("{}/max_reg={}", cache_key, max_reg);
+  if (config_->soft_reset) {
+    if (auto *module = find_compiled_module(memo_key)) {
+      return module;
+    }
+  }
+  std::unique_ptr<LlvmOfflineCache::EntryLock> lock;
+  if (!cache || !cache->load_or_lock(cache_key, ptx, lock)) {
+    ptx = compile_module_to_ptx(M);
+    if (cache) {
+      cache->store(cache_key, ptx);
+    }
+    lock.reset();
+  }
+  if (config_->print_kernel_nvptx) {
     static FileSequenceWriter writer("taichi_kernel_nvptx_{:04d}.ptx",
                                      "module NVPTX");
     writer.write(ptx);
   }
+  auto *module = add_binary(ptx, max_reg);
+  if (config_->soft_reset) {
+    record_compiled_module(memo_key, module);
+  }
+  return module;
+}
+
+std::string JITSessionCUDA::compile_module_to_binary(
+    std::unique_ptr<llvm::Module> M,
+    const std::string &target) {
+  TI_ASSERT(target.empty());
+  return compile_module_to_ptx(M);
+}
+
+JITModule *JITSessionCUDA::add_binary(const std::string &ptx, int max_reg) {
   // TODO: figure out why using the guard leads to wrong tests results
   // auto context_guard = CUDAContext::get_instance().get_guard();
   CUDAContext::get_instance().make_current();
@@ -19,6 +93,25 @@ JITModule *JITSessionCUDA ::add_module(std::unique_ptr<llvm::Module> M,
   void *cuda_module;
   TI_TRACE("PTX size: {:.2f}KB", ptx.size() / 1024.0);
   auto t = Time::get_time();
+  if (auto *cache = get_offline_cache(Arch::cuda)) {
+    const auto key = LlvmOfflineCache::make_key(
+        ptx, fmt::format("cubin/sm_{}/max_reg={}",
+                         CUDAContext::get_instance().get_compute_capability(),
+                         max_reg));
+    std::string cubin;
+    std::unique_ptr<LlvmOfflineCache::EntryLock> lock;
+    if (!cache->load_or_lock(key, cubin, lock)) {
+      cubin = compile_ptx_to_cubin(ptx, max_reg);
+      cache->store(key, cubin);
+      lock.reset();
+    }
+    TI_TRACE("Loading module from a cubin...");
+    [[maybe_unused]] auto _ = CUDAContext::get_instance().get_lock_guard();
+    CUDADriver::get_instance().module_load_data(&cuda_module, cubin.data());
+    TI_TRACE("CUDA module load time : {}ms", (Time::get_time() - t) * 1000);
+    modules.push_back(std::make_unique<JITModuleCUDA>(cuda_module));
+    return modules.back().get();
+  }
   TI_TRACE("Loading module...");
   [[maybe_unused]] auto _ = CUDAContext::get_instance().get_lock_guard();
 
@@ -33,17 +126,50 @@ JITModule *JITSessionCUDA ::add_module(std::unique_ptr<llvm::Module> M,
     option_values[num_options] = &max_reg;
     num_options++;
   }
+  auto info_log = std::make_unique<JITInfoLog>();
+  info_log->add_options(num_options, options, option_values);
 
   TI_ASSERT(num_options <= max_num_options);
 
   CUDADriver::get_instance().module_load_data_ex(
       &cuda_module, ptx.c_str(), num_options, options, option_values);
+  info_log->report();
   TI_TRACE("CUDA module load time : {}ms", (Time::get_time() - t) * 1000);
   // cudaModules.push_back(cudaModule);
   modules.push_back(std::make_unique<JITModuleCUDA>(cuda_module));
   return modules.back().get();
 }
 
+std::string JITSessionCUDA::compile_ptx_to_cubin(const std::string &ptx,
+                                                 int max_reg) {
+  TI_AUTO_PROF
+  auto &driver = CUDADriver::get_instance();
+  int num_options = 0;
+  uint32 options[1 + JITInfoLog::kNumOptions];
+  void *option_values[1 + JITInfoLog::kNumOptions];
+  if (max_reg != 0) {
+    // The value of an integer option is passed in place of the pointer.
+    options[num_options] = CU_JIT_MAX_REGISTERS;
+    option_values[num_options] = (void *)(std::uintptr_t)max_reg;
+    num_options++;
+  }
+  auto info_log = std::make_unique<JITInfoLog>();
+  info_log->add_options(num_options, options, option_values);
+  void *link_state = nullptr;
+  driver.link_create(num_options, options, option_values, &link_state);
+  driver.link_add_data(link_state, CU_JIT_INPUT_PTX,
+                       const_cast<char *>(ptx.c_str()), ptx.size() + 1,
+                       "taichi_kernel", 0, nullptr, nullptr);
+  void *cubin = nullptr;
+  std::size_t cubin_size = 0;
+  driver.link_complete(link_state, &cubin, &cubin_size);
+  info_log->report();
+  // |cubin| is owned by the link state.
+  std::string ret((const char *)cubin, cubin_size);
+  driver.link_destroy(link_state);
+  return ret;
+}
+
 std::string cuda_mattrs() {
   return "+ptx63";
 }
@@ -81,7 +207,7 @@ std::string JITSessionCUDA::compile_module_to_ptx(
 
   using namespace llvm;
 
-  if (get_current_program().config.print_kernel_llvm_ir) {
+  if (config_->print_kernel_llvm_ir) {
     static FileSequenceWriter writer("taichi_kernel_cuda_llvm_ir_{:04d}.ll",
                                      "unoptimized LLVM IR (CUDA)");
     writer.write(module.get());
@@ -101,7 +227,7 @@ std::string JITSessionCUDA::compile_module_to_ptx(
       TargetRegistry::lookupTarget(triple.str(), err_str);
   TI_ERROR_UNLESS(target, err_str);
 
-  bool fast_math = get_current_program().config.fast_math;
+  bool fast_math = config_->fast_math;
 
   TargetOptions options;
   options.PrintMachineCode = 0;
@@ -194,8 +320,10 @@ std::string JITSessionCUDA::compile_module_to_ptx(
 
   TI_ERROR_IF(fail, "Failed to set up passes to emit PTX source\n");
 
+  const auto kernel_name = module->getModuleIdentifier();
   {
     TI_PROFILER("llvm_function_pass");
+    ScopedCompileStage stage(kernel_name, "LLVM function passes (cuda)");
     function_pass_manager.doInitialization();
     for (llvm::Module::iterator i = module->begin(); i != module->end(); i++)
       function_pass_manager.run(*i);
@@ -205,10 +333,12 @@ std::string JITSessionCUDA::compile_module_to_ptx(
 
   {
     TI_PROFILER("llvm_module_pass");
+    // Including the emission of the PTX.
+    ScopedCompileStage stage(kernel_name, "LLVM module passes (cuda)");
     module_pass_manager.run(*module);
   }
 
-  if (get_current_program().config.print_kernel_llvm_ir_optimized) {
+  if (config_->print_kernel_llvm_ir_optimized) {
     static FileSequenceWriter writer(
         "taichi_kernel_cuda_llvm_ir_optimized_{:04d}.ll",
         "optimized LLVM IR (CUDA)");
@@ -222,16 +352,22 @@ std::string JITSessionCUDA::compile_module_to_ptx(
   return buffer;
 }
 
-std::unique_ptr<JITSession> create_llvm_jit_session_cuda(Arch arch) {
+std::unique_ptr<JITSession> create_llvm_jit_session_cuda(
+    TaichiLLVMContext *tlctx,
+    CompileConfig *config,
+    Arch arch) {
   TI_ASSERT(arch == Arch::cuda);
   // https://docs.nvidia.com/cuda/nvvm-ir-spec/index.html#data-layout
   auto data_layout = llvm::DataLayout(
       "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-"
       "f64:64:64-v16:16:16-v32:32:32-v64:64:64-v128:128:128-n16:32:64");
-  return std::make_unique<JITSessionCUDA>(data_layout);
+  return std::make_unique<JITSessionCUDA>(tlctx, config, data_layout);
 }
 #else
-std::unique_ptr<JITSession> create_llvm_jit_session_cuda(Arch arch) {
+std::unique_ptr<JITSession> create_llvm_jit_session_cuda(
+    TaichiLLVMContext *tlctx,
+    CompileConfig *config,
+    Arch arch) {
   TI_NOT_IMPLEMENTED
 }
 #endif
@@ -20,6 +20,7 @@
 
 #include "taichi/backends/cuda/cuda_context.h"
 #include "taichi/backends/cuda/cuda_driver.h"
+#include "taichi/backends/cuda/cuda_graph.h"
 #include "taichi/jit/jit_session.h"
 #include "taichi/lang_util.h"
 #include "taichi/program/program.h"
@@ -60,7 +61,9 @@ class JITModuleCUDA : public JITModule {
 
   void call(const std::string &name,
             const std::vector<void *> &arg_pointers) override {
-    launch(name, 1, 1, 0, arg_pointers);
+    // Serial runtime functions are never recorded into CUDA graphs.
+    auto func = lookup_function(name);
+    CUDAContext::get_instance().launch(func, name, arg_pointers, 1, 1, 0);
   }
 
   void launch(const std::string &name,
@@ -69,6 +72,11 @@ class JITModuleCUDA : public JITModule {
               std::size_t dynamic_shared_mem_bytes,
               const std::vector<void *> &arg_pointers) override {
     auto func = lookup_function(name);
+    if (auto *graph = CUDAContext::get_instance().get_graph()) {
+      graph->record_launch(func, name, arg_pointers, grid_dim, block_dim,
+                           dynamic_shared_mem_bytes);
+      return;
+    }
     CUDAContext::get_instance().launch(func, name, arg_pointers, grid_dim,
                                        block_dim, dynamic_shared_mem_bytes);
   }
@@ -82,22 +90,41 @@ class JITSessionCUDA : public JITSession {
  public:
   llvm::DataLayout data_layout;
 
-  explicit JITSessionCUDA(llvm::DataLayout data_layout)
-      : data_layout(data_layout) {
+  JITSessionCUDA(TaichiLLVMContext *tlctx,
+                 CompileConfig *config,
+                 llvm::DataLayout data_layout)
+      : JITSession(tlctx, config), data_layout(data_layout) {
   }
 
   JITModule *add_module(std::unique_ptr<llvm::Module> M, int max_reg) override;
 
+  // |target| must be empty, the PTX is compiled for the current device.
+  std::string compile_module_to_binary(std::unique_ptr<llvm::Module> M,
+                                      const std::string &target) override;
+
+  // |ptx| is compiled for the device by the CUDA driver. With the offline
+  // cache, the resulting cubin is cached as well, so that neither the driver
+  // nor its compute cache compiles the PTX again.
+  JITModule *add_binary(const std::string &ptx, int max_reg) override;
+
   llvm::DataLayout get_data_layout() override {
     return data_layout;
   }
 
-  static std::string compile_module_to_ptx(
+  std::string compile_module_to_ptx(
       std::unique_ptr<llvm::Module> &module);
+
+  // Compiles |ptx| for the device of the current context with the linker of
+  // the CUDA driver.
+  static std::string compile_ptx_to_cubin(const std::string &ptx,
+                                          int max_reg);
 };
 
 #endif
 
-std::unique_ptr<JITSession> create_llvm_jit_session_cuda(Arch arch);
+std::unique_ptr<JITSession> create_llvm_jit_session_cuda(
+    TaichiLLVMContext *tlctx,
+    CompileConfig *config,
+    Arch arch);
 
 TLANG_NAMESPACE_END
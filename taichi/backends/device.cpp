@@ -32,9 +32,13 @@ Device::MemcpyCapability Device::check_memcpy_capability(DevicePtr dst,
 
 #if TI_WITH_VULKAN
 #if TI_WITH_LLVM
-  if (dynamic_cast<vulkan::VulkanDevice *>(dst.device) &&
-      dynamic_cast<cpu::CpuDevice *>(src.device)) {
-    // TODO: support direct copy if dst itself supports host write.
+  auto *vk_dev = dynamic_cast<vulkan::VulkanDevice *>(dst.device);
+  if (vk_dev && dynamic_cast<cpu::CpuDevice *>(src.device)) {
+    // On integrated GPUs the buffers are usually in host visible memory,
+    // which the host writes without a staging buffer and a GPU copy.
+    if (vk_dev->is_host_writable(dst)) {
+      return Device::MemcpyCapability::Direct;
+    }
     return Device::MemcpyCapability::RequiresStagingBuffer;
   }
 #endif
@@ -59,6 +63,13 @@ void Device::memcpy_direct(DevicePtr dst, DevicePtr src, uint64_t size) {
     return;
   }
   // Inter-device copy
+#if TI_WITH_VULKAN && TI_WITH_LLVM
+  if (dynamic_cast<vulkan::VulkanDevice *>(dst.device) &&
+      dynamic_cast<cpu::CpuDevice *>(src.device)) {
+    memcpy_cpu_to_vulkan(dst, src, size);
+    return;
+  }
+#endif
 #if TI_WITH_VULKAN && TI_WITH_CUDA
   if (dynamic_cast<vulkan::VulkanDevice *>(dst.device) &&
       dynamic_cast<cuda::CudaDevice *>(src.device)) {
@@ -101,6 +112,8 @@ void Device::print_all_cap() const {
       {DeviceCapability::vk_has_external_memory, "vk_has_external_memory"},
       {DeviceCapability::vk_has_surface, "vk_has_surface"},
       {DeviceCapability::vk_has_presentation, "vk_has_presentation"},
+      {DeviceCapability::vk_has_timeline_semaphore,
+       "vk_has_timeline_semaphore"},
       {DeviceCapability::spirv_version, "spirv_version"},
       {DeviceCapability::spirv_has_int8, "spirv_has_int8"},
       {DeviceCapability::spirv_has_int16, "spirv_has_int16"},
@@ -124,6 +137,11 @@ void Device::print_all_cap() const {
       {DeviceCapability::spirv_has_atomic_float64_minmax,
        "spirv_has_atomic_float64_minmax"},
       {DeviceCapability::spirv_has_variable_ptr, "spirv_has_variable_ptr"},
+      {DeviceCapability::spirv_has_subgroup_basic,
+       "spirv_has_subgroup_basic"},
+      {DeviceCapability::spirv_has_subgroup_vote, "spirv_has_subgroup_vote"},
+      {DeviceCapability::spirv_has_subgroup_arithmetic,
+       "spirv_has_subgroup_arithmetic"},
       {DeviceCapability::wide_lines, "wide_lines"},
   };
   for (auto &pair : caps_) {
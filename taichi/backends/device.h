@@ -19,6 +19,7 @@ enum class DeviceCapability : uint32_t {
   vk_has_external_memory,
   vk_has_surface,
   vk_has_presentation,
+  vk_has_timeline_semaphore,
   // SPIR-V Caps
   spirv_version,
   spirv_has_int8,
@@ -37,6 +38,10 @@ enum class DeviceCapability : uint32_t {
   spirv_has_atomic_float64_add,
   spirv_has_atomic_float64_minmax,
   spirv_has_variable_ptr,
+  // GroupNonUniform{,Vote,Arithmetic} in compute shaders
+  spirv_has_subgroup_basic,
+  spirv_has_subgroup_vote,
+  spirv_has_subgroup_arithmetic,
   // Graphics Caps,
   wide_lines
 };
@@ -86,8 +91,12 @@ struct DevicePtr : public DeviceAllocation {
 constexpr DeviceAllocation kDeviceNullAllocation{};
 constexpr DevicePtr kDeviceNullPtr{};
 
-// TODO: fill this with the required options
-struct ImageSamplerConfig {};
+enum class ImageSamplerAddressMode { repeat, clamp_to_edge };
+
+struct ImageSamplerConfig {
+  // How the coordinates outside of [0, 1] are mapped into the image.
+  ImageSamplerAddressMode address_mode{ImageSamplerAddressMode::repeat};
+};
 
 class ResourceBinder {
  public:
@@ -289,6 +298,11 @@ class CommandList {
   virtual void draw(uint32_t num_verticies, uint32_t start_vertex = 0) {
     TI_NOT_IMPLEMENTED
   }
+  // Makes the compute and transfer writes to the buffer visible to the vertex
+  // input and vertex shader stages. Must be recorded outside render passes.
+  virtual void vertex_buffer_barrier(DevicePtr ptr, size_t size) {
+    TI_NOT_IMPLEMENTED
+  }
   virtual void clear_color(float r, float g, float b, float a) {
     TI_NOT_IMPLEMENTED
   }
@@ -331,6 +345,11 @@ class CommandList {
                           const ImageCopyParams &params) {
     TI_NOT_IMPLEMENTED
   }
+  // Writes the GPU time once the preceding commands are done to the |index|-th
+  // timestamp of the device, see Device::get_timestamps().
+  virtual void write_timestamp(uint32_t index) {
+    TI_NOT_IMPLEMENTED
+  }
 };
 
 struct PipelineSourceDesc {
@@ -363,6 +382,14 @@ class Stream {
   virtual void submit_synced(CommandList *cmdlist) = 0;
 
   virtual void command_sync() = 0;
+
+  // Makes the work submitted to this stream from now on wait for the work
+  // submitted to |producer| so far. Falls back to a host side wait.
+  virtual void wait_for(Stream *producer) {
+    if (producer != this) {
+      producer->command_sync();
+    }
+  }
 };
 
 class Device {
@@ -457,6 +484,25 @@ class Device {
   // Each thraed will acquire its own stream
   virtual Stream *get_compute_stream() = 0;
 
+  // For host<->device and device<->device copies. Devices without a dedicated
+  // copy engine use the compute stream.
+  virtual Stream *get_transfer_stream() {
+    return get_compute_stream();
+  }
+
+  // The number of timestamps CommandList::write_timestamp() can write, or 0 if
+  // the device has no GPU timer.
+  virtual uint32_t get_num_timestamps() {
+    return 0;
+  }
+
+  // Timestamps [begin, begin + count) in nanoseconds, once the commands
+  // writing them are done. Only their differences are meaningful.
+  virtual std::vector<uint64_t> get_timestamps(uint32_t begin,
+                                               uint32_t count) {
+    TI_NOT_IMPLEMENTED
+  }
+
  private:
   std::unordered_map<DeviceCapability, uint32_t> caps_;
 };
@@ -500,6 +546,9 @@ struct SurfaceConfig {
   void *window_handle{nullptr};
   uint32_t width{1};
   uint32_t height{1};
+  // The number of frames that can be rendered ahead of presentation. The swap
+  // chain has at least one image more than this.
+  uint32_t frames_in_flight{2};
 };
 
 struct ImageParams {
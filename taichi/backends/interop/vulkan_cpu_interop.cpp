@@ -15,6 +15,24 @@ namespace lang {
 using namespace taichi::lang::vulkan;
 using namespace taichi::lang::cpu;
 
+void memcpy_cpu_to_vulkan(DevicePtr dst, DevicePtr src, uint64_t size) {
+  VulkanDevice *vk_dev = dynamic_cast<VulkanDevice *>(dst.device);
+  CpuDevice *cpu_dev = dynamic_cast<CpuDevice *>(src.device);
+
+  DeviceAllocation src_alloc(src);
+  CpuDevice::AllocInfo src_alloc_info = cpu_dev->get_alloc_info(src_alloc);
+  unsigned char *src_ptr = (unsigned char *)src_alloc_info.ptr + src.offset;
+
+  // The host writes are not ordered with the GPU, which may still be reading
+  // |dst| (e.g. drawing the previous frame).
+  vk_dev->get_compute_stream()->command_sync();
+  vk_dev->get_graphics_stream()->command_sync();
+
+  unsigned char *dst_ptr = (unsigned char *)(vk_dev->map_range(dst, size));
+  memcpy(dst_ptr, src_ptr, size);
+  vk_dev->unmap(dst);
+}
+
 void memcpy_cpu_to_vulkan_via_staging(DevicePtr dst,
                                       DevicePtr staging,
                                       DevicePtr src,
@@ -33,13 +51,28 @@ void memcpy_cpu_to_vulkan_via_staging(DevicePtr dst,
   memcpy(dst_ptr, src_ptr, size);
   vk_dev->unmap(staging);
 
-  auto stream = vk_dev->get_compute_stream();
+  // Runs on the copy engine if there is one, after the work issued so far.
+  auto stream = vk_dev->get_transfer_stream();
+  auto compute_stream = vk_dev->get_compute_stream();
+  const bool async_transfer = (stream != compute_stream);
+  if (async_transfer) {
+    stream->wait_for(compute_stream);
+    stream->wait_for(vk_dev->get_graphics_stream());
+  }
   auto cmd_list = stream->new_command_list();
   cmd_list->buffer_copy(dst, staging, size);
   stream->submit_synced(cmd_list.get());
+  if (async_transfer) {
+    compute_stream->wait_for(stream);
+    vk_dev->get_graphics_stream()->wait_for(stream);
+  }
 }
 
 #else
+void memcpy_cpu_to_vulkan(DevicePtr dst, DevicePtr src, uint64_t size) {
+  TI_NOT_IMPLEMENTED;
+}
+
 void memcpy_cpu_to_vulkan_via_staging(DevicePtr dst,
                                       DevicePtr stagin,
                                       DevicePtr src,
@@ -5,6 +5,10 @@
 namespace taichi {
 namespace lang {
 
+// Writes the memory of |dst| from the host, which requires it to be host
+// writable (see VulkanDevice::is_host_writable()).
+void memcpy_cpu_to_vulkan(DevicePtr dst, DevicePtr src, uint64_t size);
+
 void memcpy_cpu_to_vulkan_via_staging(DevicePtr dst,
                                       DevicePtr staging,
                                       DevicePtr src,
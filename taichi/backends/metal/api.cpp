@@ -1,5 +1,7 @@
 #include "taichi/backends/metal/api.h"
 
+#include <fstream>
+
 #include "taichi/backends/metal/constants.h"
 #include "taichi/util/environ_config.h"
 
@@ -97,17 +99,102 @@ nsobj_unique_ptr<MTLFunction> new_function_with_name(MTLLibrary *library,
 
 nsobj_unique_ptr<MTLComputePipelineState>
 new_compute_pipeline_state_with_function(MTLDevice *device,
-                                         MTLFunction *function) {
+                                         MTLFunction *function,
+                                         MTLBinaryArchive *archive,
+                                         bool *archive_updated) {
   id error_return = nullptr;
+  if (archive == nullptr) {
+    auto *pipeline_state = cast_call<MTLComputePipelineState *>(
+        device, "newComputePipelineStateWithFunction:error:", function,
+        &error_return);
+    if (pipeline_state == nullptr) {
+      mac::ns_log_object(error_return);
+    }
+    return wrap_as_nsobj_unique_ptr(pipeline_state);
+  }
+
+  // MTLPipelineOption
+  constexpr uint64_t kMtlPipelineOptionNone = 0;
+  constexpr uint64_t kMtlPipelineOptionFailOnBinaryArchiveMiss = 1 << 2;
+
+  id desc = clscall("MTLComputePipelineDescriptor", "alloc");
+  desc = call(desc, "init");
+  auto desc_cleanup = wrap_as_nsobj_unique_ptr(desc);
+  call(desc, "setComputeFunction:", function);
+  call(desc, "setBinaryArchives:",
+       clscall("NSArray", "arrayWithObject:", archive));
+  constexpr const char *kSelector =
+      "newComputePipelineStateWithDescriptor:options:reflection:error:";
   auto *pipeline_state = cast_call<MTLComputePipelineState *>(
-      device, "newComputePipelineStateWithFunction:error:", function,
+      device, kSelector, desc, kMtlPipelineOptionFailOnBinaryArchiveMiss,
+      nullptr, &error_return);
+  if (pipeline_state != nullptr) {
+    return wrap_as_nsobj_unique_ptr(pipeline_state);
+  }
+  pipeline_state = cast_call<MTLComputePipelineState *>(
+      device, kSelector, desc, kMtlPipelineOptionNone, nullptr,
       &error_return);
   if (pipeline_state == nullptr) {
     mac::ns_log_object(error_return);
+    return wrap_as_nsobj_unique_ptr(pipeline_state);
+  }
+  if (cast_call<bool>(archive,
+                      "addComputePipelineFunctionsWithDescriptor:error:", desc,
+                      &error_return)) {
+    if (archive_updated) {
+      *archive_updated = true;
+    }
+  } else {
+    mac::ns_log_object(error_return);
   }
   return wrap_as_nsobj_unique_ptr(pipeline_state);
 }
 
+nsobj_unique_ptr<MTLBinaryArchive> new_binary_archive(
+    MTLDevice *device,
+    const std::string &path) {
+  if (!cast_call<bool>(device, "respondsToSelector:",
+                       sel_getUid("newBinaryArchiveWithDescriptor:error:"))) {
+    return nullptr;
+  }
+  auto path_str = mac::wrap_string_as_ns_string(path);
+  id url = clscall("NSURL", "fileURLWithPath:", path_str.get());
+
+  id desc = clscall("MTLBinaryArchiveDescriptor", "alloc");
+  desc = call(desc, "init");
+  auto desc_cleanup = wrap_as_nsobj_unique_ptr(desc);
+  id error_return = nullptr;
+  MTLBinaryArchive *archive = nullptr;
+  if (std::ifstream(path).good()) {
+    call(desc, "setUrl:", url);
+    archive = cast_call<MTLBinaryArchive *>(
+        device, "newBinaryArchiveWithDescriptor:error:", desc, &error_return);
+    if (archive == nullptr) {
+      TI_WARN("Failed to load the Metal binary archive {}", path);
+      mac::ns_log_object(error_return);
+      call(desc, "setUrl:", nullptr);
+    }
+  }
+  if (archive == nullptr) {
+    archive = cast_call<MTLBinaryArchive *>(
+        device, "newBinaryArchiveWithDescriptor:error:", desc, &error_return);
+  }
+  return wrap_as_nsobj_unique_ptr(archive);
+}
+
+bool serialize_binary_archive(MTLBinaryArchive *archive,
+                              const std::string &path) {
+  auto path_str = mac::wrap_string_as_ns_string(path);
+  id url = clscall("NSURL", "fileURLWithPath:", path_str.get());
+  id error_return = nullptr;
+  if (!cast_call<bool>(archive, "serializeToURL:error:", url,
+                       &error_return)) {
+    mac::ns_log_object(error_return);
+    return false;
+  }
+  return true;
+}
+
 nsobj_unique_ptr<MTLBuffer> new_mtl_buffer_no_copy(MTLDevice *device,
                                                    void *ptr,
                                                    size_t length) {
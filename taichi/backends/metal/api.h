@@ -25,6 +25,7 @@ struct MTLBlitCommandEncoder;
 struct MTLFunction;
 struct MTLComputePipelineState;
 struct MTLBuffer;
+struct MTLBinaryArchive;
 
 #ifdef TI_PLATFORM_OSX
 
@@ -56,9 +57,26 @@ nsobj_unique_ptr<MTLLibrary> new_library_with_source(MTLDevice *device,
 nsobj_unique_ptr<MTLFunction> new_function_with_name(MTLLibrary *library,
                                                      const std::string &name);
 
+// If |archive| is not null, the pipeline is loaded from it when it is there.
+// Otherwise it is compiled and added to |archive|, and |*archive_updated| is
+// set.
 nsobj_unique_ptr<MTLComputePipelineState>
 new_compute_pipeline_state_with_function(MTLDevice *device,
-                                         MTLFunction *function);
+                                         MTLFunction *function,
+                                         MTLBinaryArchive *archive = nullptr,
+                                         bool *archive_updated = nullptr);
+
+// Opens the binary archive of compiled pipelines serialized at |path|, or
+// creates an empty one if there is none or it cannot be loaded (e.g. after an
+// OS update). Returns nullptr before macOS 11, which has no binary archives.
+//
+// The archive holds the GPU code of the pipelines. The MSL source is still
+// compiled into a library, as the functions of the pipelines come from it.
+nsobj_unique_ptr<MTLBinaryArchive> new_binary_archive(MTLDevice *device,
+                                                      const std::string &path);
+
+bool serialize_binary_archive(MTLBinaryArchive *archive,
+                              const std::string &path);
 
 inline void set_compute_pipeline_state(
     MTLComputeCommandEncoder *encoder,
@@ -143,6 +161,16 @@ inline void wait_until_completed(MTLCommandBuffer *cmd_buffer) {
   mac::call(cmd_buffer, "waitUntilCompleted");
 }
 
+// When the GPU started and finished executing |cmd_buffer|, in seconds. Only
+// valid once it is completed.
+inline double gpu_start_time(MTLCommandBuffer *cmd_buffer) {
+  return mac::cast_call<double>(cmd_buffer, "GPUStartTime");
+}
+
+inline double gpu_end_time(MTLCommandBuffer *cmd_buffer) {
+  return mac::cast_call<double>(cmd_buffer, "GPUEndTime");
+}
+
 inline void *mtl_buffer_contents(MTLBuffer *buffer) {
   return mac::cast_call<void *>(buffer, "contents");
 }
@@ -15,6 +15,7 @@
 #include "taichi/program/py_print_buffer.h"
 #include "taichi/util/action_recorder.h"
 #include "taichi/util/file_sequence_writer.h"
+#include "taichi/util/io.h"
 #include "taichi/util/str.h"
 
 #ifdef TI_PLATFORM_OSX
@@ -79,6 +80,63 @@ class BufferMemoryView {
   char *ptr_;
 };
 
+// A compute command encoder shared by all the Metal kernels of a single Taichi
+// kernel launch. Dispatches on the same encoder are executed serially, and each
+// of them sees the writes of the previous ones, so there is no need to end the
+// encoding pass between the tasks. Creating an encoder and rebinding all the
+// buffers for every task is a CPU bottleneck when there are many small tasks.
+// This class also skips redundant pipeline state and buffer bindings.
+class ComputeEncoder {
+ public:
+  ComputeEncoder(MTLCommandBuffer *command_buffer, const std::string &label)
+      : command_buffer_(command_buffer), label_(label) {
+  }
+
+  ~ComputeEncoder() {
+    if (encoder_ != nullptr) {
+      end_encoding(encoder_.get());
+    }
+  }
+
+  ComputeEncoder(const ComputeEncoder &) = delete;
+  ComputeEncoder &operator=(const ComputeEncoder &) = delete;
+
+  // The encoder is created lazily, so that a launch without any non-empty
+  // task does not encode anything.
+  MTLComputeCommandEncoder *get() {
+    if (encoder_ == nullptr) {
+      encoder_ = new_compute_command_encoder(command_buffer_);
+      TI_ASSERT(encoder_ != nullptr);
+      set_label(encoder_.get(), label_);
+    }
+    return encoder_.get();
+  }
+
+  void set_pipeline_state(MTLComputePipelineState *pipeline_state) {
+    if (pipeline_state != pipeline_state_) {
+      set_compute_pipeline_state(get(), pipeline_state);
+      pipeline_state_ = pipeline_state;
+    }
+  }
+
+  void set_buffer(MTLBuffer *buffer, int index) {
+    if (index >= bound_buffers_.size()) {
+      bound_buffers_.resize(index + 1, nullptr);
+    }
+    if (bound_buffers_[index] != buffer) {
+      set_mtl_buffer(get(), buffer, /*offset=*/0, index);
+      bound_buffers_[index] = buffer;
+    }
+  }
+
+ private:
+  MTLCommandBuffer *const command_buffer_;
+  const std::string label_;
+  nsobj_unique_ptr<MTLComputeCommandEncoder> encoder_{nullptr};
+  MTLComputePipelineState *pipeline_state_{nullptr};
+  std::vector<MTLBuffer *> bound_buffers_;
+};
+
 // MetalRuntime maintains a series of MTLBuffers that are shared across all the
 // Metal kernels mapped by a single Taichi kernel. This map stores those buffers
 // from their enum. Each CompiledMtlKernelBase can then decide which specific
@@ -95,15 +153,20 @@ class CompiledMtlKernelBase {
     const KernelAttributes *kernel_attribs;
     MTLDevice *device;
     MTLFunction *mtl_func;
+    // See new_compute_pipeline_state_with_function().
+    MTLBinaryArchive *binary_archive{nullptr};
+    bool *binary_archive_updated{nullptr};
   };
 
   explicit CompiledMtlKernelBase(Params &params)
       : kernel_attribs_(*params.kernel_attribs),
         config_(params.config),
         is_jit_evalutor_(params.is_jit_evaluator),
-        pipeline_state_(
-            new_compute_pipeline_state_with_function(params.device,
-                                                     params.mtl_func)) {
+        pipeline_state_(new_compute_pipeline_state_with_function(
+            params.device,
+            params.mtl_func,
+            params.binary_archive,
+            params.binary_archive_updated)) {
     TI_ASSERT(pipeline_state_ != nullptr);
   }
 
@@ -114,28 +177,23 @@ class CompiledMtlKernelBase {
   }
 
   virtual void launch(InputBuffersMap &input_buffers,
-                      MTLCommandBuffer *command_buffer) = 0;
+                      ComputeEncoder *encoder) = 0;
 
  protected:
   using BindBuffers = std::vector<std::pair<MTLBuffer *, BufferDescriptor>>;
 
-  void launch_if_not_empty(BindBuffers buffers,
-                           MTLCommandBuffer *command_buffer) {
+  void launch_if_not_empty(BindBuffers buffers, ComputeEncoder *encoder) {
     const int num_threads = kernel_attribs_.advisory_total_num_threads;
     if (num_threads == 0) {
       return;
     }
     TI_ASSERT(buffers.size() == kernel_attribs_.buffers.size());
-    auto encoder = new_compute_command_encoder(command_buffer);
-    TI_ASSERT(encoder != nullptr);
-
-    set_label(encoder.get(), kernel_attribs_.name);
-    set_compute_pipeline_state(encoder.get(), pipeline_state_.get());
+    encoder->set_pipeline_state(pipeline_state_.get());
 
     for (int bi = 0; bi < buffers.size(); ++bi) {
       auto &b = buffers[bi];
       TI_ASSERT(b.second == kernel_attribs_.buffers[bi]);
-      set_mtl_buffer(encoder.get(), b.first, /*offset=*/0, bi);
+      encoder->set_buffer(b.first, bi);
     }
 
     const auto tgs = get_thread_grid_settings(
@@ -161,9 +219,8 @@ class CompiledMtlKernelBase {
         "Dispatching Metal kernel {}, num_threadgroups={} "
         "num_threads_per_group={}",
         kernel_attribs_.name, tgs.num_threadgroups, tgs.num_threads_per_group);
-    dispatch_threadgroups(encoder.get(), tgs.num_threadgroups,
+    dispatch_threadgroups(encoder->get(), tgs.num_threadgroups,
                           tgs.num_threads_per_group);
-    end_encoding(encoder.get());
   }
 
   struct ThreadGridSettings {
@@ -211,14 +268,14 @@ class UserMtlKernel : public CompiledMtlKernelBase {
  public:
   using CompiledMtlKernelBase::CompiledMtlKernelBase;
   void launch(InputBuffersMap &input_buffers,
-              MTLCommandBuffer *command_buffer) override {
+              ComputeEncoder *encoder) override {
     // 0 is valid for |num_threads|!
     TI_ASSERT(kernel_attribs_.advisory_total_num_threads >= 0);
     BindBuffers buffers;
     for (const auto b : kernel_attribs_.buffers) {
       buffers.push_back({input_buffers.find(b)->second, b});
     }
-    launch_if_not_empty(std::move(buffers), command_buffer);
+    launch_if_not_empty(std::move(buffers), encoder);
   }
 };
 
@@ -240,7 +297,7 @@ class SparseRuntimeMtlKernelBase : public CompiledMtlKernelBase {
   }
 
   void launch(InputBuffersMap &input_buffers,
-              MTLCommandBuffer *command_buffer) override {
+              ComputeEncoder *encoder) override {
     BindBuffers buffers;
     for (const auto b : kernel_attribs_.buffers) {
       if (b.type() == BufferDescriptor::Type::Context) {
@@ -249,7 +306,7 @@ class SparseRuntimeMtlKernelBase : public CompiledMtlKernelBase {
         buffers.push_back({input_buffers.find(b)->second, b});
       }
     }
-    launch_if_not_empty(std::move(buffers), command_buffer);
+    launch_if_not_empty(std::move(buffers), encoder);
   }
 
  protected:
@@ -319,6 +376,8 @@ class CompiledTaichiKernel {
     MemoryPool *mem_pool;
     KernelProfilerBase *profiler;
     const CompileConfig *compile_config;
+    MTLBinaryArchive *binary_archive{nullptr};
+    bool *binary_archive_updated{nullptr};
   };
 
   CompiledTaichiKernel(Params params)
@@ -354,6 +413,8 @@ class CompiledTaichiKernel {
         kparams.config = params.compile_config;
         kparams.device = device;
         kparams.mtl_func = mtl_func.get();
+        kparams.binary_archive = params.binary_archive;
+        kparams.binary_archive_updated = params.binary_archive_updated;
         kparams.mem_pool = params.mem_pool;
         kernel = std::make_unique<ListgenOpMtlKernel>(kparams);
       } else if (ktype == KernelTaskType::gc) {
@@ -363,6 +424,8 @@ class CompiledTaichiKernel {
         kparams.config = params.compile_config;
         kparams.device = device;
         kparams.mtl_func = mtl_func.get();
+        kparams.binary_archive = params.binary_archive;
+        kparams.binary_archive_updated = params.binary_archive_updated;
         kparams.mem_pool = params.mem_pool;
         kernel = std::make_unique<GcOpMtlKernel>(kparams);
       } else {
@@ -372,6 +435,8 @@ class CompiledTaichiKernel {
         kparams.config = params.compile_config;
         kparams.device = device;
         kparams.mtl_func = mtl_func.get();
+        kparams.binary_archive = params.binary_archive;
+        kparams.binary_archive_updated = params.binary_archive_updated;
         kernel = std::make_unique<UserMtlKernel>(kparams);
       }
 
@@ -622,6 +687,26 @@ class KernelManager::Impl {
 
     init_runtime_buffer(compiled_runtime_module_);
     clear_print_assert_buffer();
+
+    if (config_->offline_cache) {
+      auto path = config_->offline_cache_file_path;
+      if (path.empty()) {
+        path = get_repo_dir() + "ticache";
+      }
+      path = fmt::format("{}/{}", path, arch_name(Arch::metal));
+      create_directories(path);
+      // The GPU code depends on the GPU, so each has its archive.
+      binary_archive_path_ =
+          fmt::format("{}/{:x}.bin", path,
+                      std::hash<std::string>{}(mtl_device_name(device_.get())));
+      binary_archive_ = new_binary_archive(device_.get(), binary_archive_path_);
+    }
+  }
+
+  ~Impl() {
+    if (binary_archive_ != nullptr && binary_archive_updated_) {
+      serialize_binary_archive(binary_archive_.get(), binary_archive_path_);
+    }
   }
 
   void add_compiled_snode_tree(const CompiledStructs &compiled_tree) {
@@ -670,6 +755,8 @@ class KernelManager::Impl {
     params.mem_pool = mem_pool_;
     params.profiler = profiler_;
     params.compile_config = config_;
+    params.binary_archive = binary_archive_.get();
+    params.binary_archive_updated = &binary_archive_updated_;
     compiled_taichi_kernels_[taichi_kernel_name] =
         std::make_unique<CompiledTaichiKernel>(params);
     TI_DEBUG("Registered Taichi kernel <{}>", taichi_kernel_name);
@@ -698,8 +785,25 @@ class KernelManager::Impl {
       input_buffers[BufferDescriptor::context()] = ctk.ctx_buffer.get();
     }
 
-    for (const auto &mk : ctk.compiled_mtl_kernels) {
-      mk->launch(input_buffers, cur_command_buffer_.get());
+    if (profiler_) {
+      // Each task goes into its own command buffer, whose GPU time is the
+      // task's.
+      for (const auto &mk : ctk.compiled_mtl_kernels) {
+        {
+          ComputeEncoder encoder(cur_command_buffer_.get(), taichi_kernel_name);
+          mk->launch(input_buffers, &encoder);
+        }
+        commit_command_buffer(cur_command_buffer_.get());
+        profiled_command_buffers_.push_back(
+            {mk->kernel_attribs()->name, std::move(cur_command_buffer_)});
+        create_new_command_buffer();
+      }
+    } else {
+      ComputeEncoder encoder(cur_command_buffer_.get(), taichi_kernel_name);
+      for (const auto &mk : ctk.compiled_mtl_kernels) {
+        mk->launch(input_buffers, &encoder);
+      }
+      // |encoder| ends encoding here, before any blit below.
     }
 
     const auto &used = ctk.ti_kernel_attribs.used_features;
@@ -997,13 +1101,17 @@ class KernelManager::Impl {
       end_encoding(encoder.get());
     }
     // Sync
-    if (profiler_)
-      profiler_->start("metal_synchronize");
     commit_command_buffer(cur_command_buffer_.get());
     wait_until_completed(cur_command_buffer_.get());
     create_new_command_buffer();
-    if (profiler_)
-      profiler_->stop();
+    // The command buffers of a queue complete in order, so the profiled ones
+    // are done as well.
+    for (const auto &pcb : profiled_command_buffers_) {
+      auto *cb = pcb.command_buffer.get();
+      profiler_->insert_record(pcb.task_name,
+                               (gpu_end_time(cb) - gpu_start_time(cb)) * 1e3);
+    }
+    profiled_command_buffers_.clear();
 
     // print_runtime_debug();
   }
@@ -1129,8 +1237,19 @@ class KernelManager::Impl {
   std::vector<CompiledStructs> compiled_snode_trees_;
   nsobj_unique_ptr<MTLDevice> device_{nullptr};
   nsobj_unique_ptr<MTLCommandQueue> command_queue_{nullptr};
+  // The compiled pipelines persisted across processes, with the offline
+  // cache only.
+  nsobj_unique_ptr<MTLBinaryArchive> binary_archive_{nullptr};
+  std::string binary_archive_path_;
+  bool binary_archive_updated_{false};
   nsobj_unique_ptr<MTLCommandBuffer> cur_command_buffer_{nullptr};
   std::size_t command_buffer_id_{0};
+  // The committed command buffers of the tasks timed for the profiler.
+  struct ProfiledCommandBuffer {
+    std::string task_name;
+    nsobj_unique_ptr<MTLCommandBuffer> command_buffer{nullptr};
+  };
+  std::vector<ProfiledCommandBuffer> profiled_command_buffers_;
   std::vector<SNodesRootBuffer> root_buffers_;
   std::unique_ptr<BufferMemoryView> global_tmps_mem_{nullptr};
   nsobj_unique_ptr<MTLBuffer> global_tmps_buffer_{nullptr};
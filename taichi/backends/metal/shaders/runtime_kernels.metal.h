@@ -37,7 +37,14 @@ STR(
                                 device byte *root_addr[[buffer(1)]],
                                 device int *args[[buffer(2)]],
                                 const uint utid_[[thread_position_in_grid]],
-                                const uint grid_size[[threads_per_grid]]) {
+                                const uint grid_size[[threads_per_grid]],
+                                const uint utid_in_tg_
+                                [[thread_position_in_threadgroup]]) {
+      // The active children of a threadgroup are appended to |child_list|
+      // with one atomic on the list, instead of one per child.
+      threadgroup atomic_int tg_num_children;
+      threadgroup int tg_children_begin;
+
       device Runtime *runtime =
           reinterpret_cast<device Runtime *>(runtime_addr);
       device MemoryAllocator *mem_alloc =
@@ -58,55 +65,81 @@ STR(
       // No need to put an upperbound here (same for listgen and struct-for).
       // Say the number of valid elements per child container is 5, which then
       // gets padded to 8 (POT). is_active() knows how to properly skip those.
-      for (int ii = utid_;; ii += grid_size) {
-        const int parent_idx = (ii / num_slots);
-        if (parent_idx >= parent_list.num_active()) {
-          // Since |parent_idx| increases monotonically, we can return directly
-          // once it goes beyond the number of active parent elements.
-          return;
-        }
-        const int child_idx = (ii % num_slots);
-        const auto parent_elem = parent_list.get<ListgenElement>(parent_idx);
-        device byte *parent_addr =
-            mtl_lgen_snode_addr(parent_elem, root_addr, runtime, mem_alloc);
-        if (is_active(parent_addr, parent_meta, child_idx)) {
-          ListgenElement child_elem;
-          if (parent_meta.type != SNodeMeta::Pointer) {
-            // Need to inherit |parent_elem|'s NodeManager settings. This means
-            // that the memory of the child cell will be part of that of the
-            // parent container.
-            //
-            // For example, denoting parent as Y, and child as Z:
-            //
-            // * Both Y and Z are `dense`: belonged_nodemgr.id = -1. This is the
-            //   simplest case, both Y and Z's memory location are known at
-            //   compile time. ==> Both live in the `root` buffer.
-            // * Y's parent (X) is a `pointer`: Y's NodeManager ID >= 0 (i.e.
-            //   |parent_elem.belonged_nodemgr| >= 0), Z inherits Y's
-            //   NodeManager settings. ==> Both Y and Z are in the memory
-            //   dynamically allocated for X.
-            // * Y is `dense`, but Z is a `pointer`: Z's memory location is
-            //   known at compile time! So Z itself still lives in the `root`
-            //   buffer! However, each Z cell stores the pointer allocated from
-            //   the runtime memory pool.
-            child_elem.belonged_nodemgr = parent_elem.belonged_nodemgr;
-            child_elem.mem_offset =
-                parent_elem.mem_offset + child_idx * child_stride;
-          } else {
-            child_elem.belonged_nodemgr.id = parent_snode_id;
-            child_elem.belonged_nodemgr.elem_idx =
-                SNodeRep_pointer::to_nodemgr_idx(parent_addr, child_idx);
-            // For `pointer` parent, |child_elem.belonged_nodemgr.elem_idx|
-            // has already encoded the memory offset for which this child cell
-            // belongs to. Therefore |mem_offset| is just 0.
-            child_elem.mem_offset = 0;
+      //
+      // |parent_list| is not modified by this kernel, so all the threads see
+      // the same number of cells. The loop runs over the threadgroups, so
+      // that all the threads of one take the same number of iterations and
+      // meet at the barriers below.
+      const int num_cells = parent_list.num_active() * num_slots;
+      for (int tg_ii = (utid_ - utid_in_tg_); tg_ii < num_cells;
+           tg_ii += grid_size) {
+        const int ii = tg_ii + utid_in_tg_;
+        bool child_active = false;
+        ListgenElement child_elem;
+        if (ii < num_cells) {
+          const int parent_idx = (ii / num_slots);
+          const int child_idx = (ii % num_slots);
+          const auto parent_elem = parent_list.get<ListgenElement>(parent_idx);
+          device byte *parent_addr =
+              mtl_lgen_snode_addr(parent_elem, root_addr, runtime, mem_alloc);
+          child_active = is_active(parent_addr, parent_meta, child_idx);
+          if (child_active) {
+            if (parent_meta.type != SNodeMeta::Pointer) {
+              // Need to inherit |parent_elem|'s NodeManager settings. This
+              // means that the memory of the child cell will be part of that
+              // of the parent container.
+              //
+              // For example, denoting parent as Y, and child as Z:
+              //
+              // * Both Y and Z are `dense`: belonged_nodemgr.id = -1. This is
+              //   the simplest case, both Y and Z's memory location are known
+              //   at compile time. ==> Both live in the `root` buffer.
+              // * Y's parent (X) is a `pointer`: Y's NodeManager ID >= 0 (i.e.
+              //   |parent_elem.belonged_nodemgr| >= 0), Z inherits Y's
+              //   NodeManager settings. ==> Both Y and Z are in the memory
+              //   dynamically allocated for X.
+              // * Y is `dense`, but Z is a `pointer`: Z's memory location is
+              //   known at compile time! So Z itself still lives in the `root`
+              //   buffer! However, each Z cell stores the pointer allocated
+              //   from the runtime memory pool.
+              child_elem.belonged_nodemgr = parent_elem.belonged_nodemgr;
+              child_elem.mem_offset =
+                  parent_elem.mem_offset + child_idx * child_stride;
+            } else {
+              child_elem.belonged_nodemgr.id = parent_snode_id;
+              child_elem.belonged_nodemgr.elem_idx =
+                  SNodeRep_pointer::to_nodemgr_idx(parent_addr, child_idx);
+              // For `pointer` parent, |child_elem.belonged_nodemgr.elem_idx|
+              // has already encoded the memory offset for which this child
+              // cell belongs to. Therefore |mem_offset| is just 0.
+              child_elem.mem_offset = 0;
+            }
+            child_elem.mem_offset += child_meta.mem_offset_in_parent;
+
+            refine_coordinates(parent_elem.coords,
+                               runtime->snode_extractors[parent_snode_id],
+                               child_idx, &(child_elem.coords));
           }
-          child_elem.mem_offset += child_meta.mem_offset_in_parent;
+        }
 
-          refine_coordinates(parent_elem.coords,
-                             runtime->snode_extractors[parent_snode_id],
-                             child_idx, &(child_elem.coords));
-          child_list.append(child_elem);
+        if (utid_in_tg_ == 0) {
+          atomic_store_explicit(&tg_num_children, 0,
+                                metal::memory_order_relaxed);
+        }
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+        int slot = 0;
+        if (child_active) {
+          slot = atomic_fetch_add_explicit(&tg_num_children, 1,
+                                           metal::memory_order_relaxed);
+        }
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+        if (utid_in_tg_ == 0) {
+          tg_children_begin = child_list.reserve_elems(atomic_load_explicit(
+              &tg_num_children, metal::memory_order_relaxed));
+        }
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+        if (child_active) {
+          child_list.write_reserved(tg_children_begin + slot, child_elem);
         }
       }
     }
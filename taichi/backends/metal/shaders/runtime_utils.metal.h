@@ -91,13 +91,21 @@ STR(
       template <typename T>
       void append(thread const T &elem) {
         device char *ptr = append();
-        thread char *elem_ptr = (thread char *)(&elem);
+        write(ptr, elem);
+      }
 
-        for (int i = 0; i < lm_data->element_stride; ++i) {
-          *ptr = *elem_ptr;
-          ++ptr;
-          ++elem_ptr;
-        }
+      // Reserves |n| consecutive elements at once, and returns the index of
+      // the first one. Their chunks are allocated by write_reserved().
+      inline int reserve_elems(int n) {
+        return atomic_fetch_add_explicit(&lm_data->next, n,
+                                         metal::memory_order_relaxed);
+      }
+
+      template <typename T>
+      void write_reserved(int elem_idx, thread const T &elem) {
+        const PtrOffset chunk_ptr_offs =
+            ensure_chunk(get_chunk_index(elem_idx));
+        write(get_elem_from_chunk(elem_idx, chunk_ptr_offs), elem);
       }
 
       device char *get_ptr(ReservedElemPtrOffset offs) {
@@ -117,6 +125,17 @@ STR(
       }
 
      private:
+      template <typename T>
+      void write(device char *ptr, thread const T &elem) {
+        thread char *elem_ptr = (thread char *)(&elem);
+
+        for (int i = 0; i < lm_data->element_stride; ++i) {
+          *ptr = *elem_ptr;
+          ++ptr;
+          ++elem_ptr;
+        }
+      }
+
       inline int get_chunk_index(int elem_idx) const {
         return elem_idx >> lm_data->log2_num_elems_per_chunk;
       }
@@ -410,12 +410,29 @@ class KernelGen : public IRVisitor {
         emit("atomicMax(_data_i32_[{} >> 2], {} + 1); // dynamic activate",
              get_snode_meta_address(stmt->snode),
              stmt->input_index->short_name());
+      } else if (stmt->snode->type == SNodeType::bitmasked) {
+        used.int32 = true;
+        emit("atomicOr({}, 1 << ({} & 31)); // bitmasked activate",
+             get_bitmask_word(stmt->snode, parent, stmt->input_index),
+             stmt->input_index->short_name());
       } else {
         TI_NOT_IMPLEMENTED
       }
     }
   }
 
+  // The mask word of the |index|-th cell of the bitmasked container at
+  // |container|, which follows the cells.
+  std::string get_bitmask_word(const SNode *snode,
+                               Stmt *container,
+                               Stmt *index) {
+    const auto &meta = struct_compiled_->snode_map.at(snode->node_type_name);
+    return fmt::format("_data_i32_[({} + {} + (({} >> 5) << 2)) >> 2]",
+                       container->short_name(),
+                       meta.stride - opengl_get_snode_meta_size(*snode),
+                       index->short_name());
+  }
+
   void visit(AssertStmt *stmt) override {
     // TODO: do the actual assert
     TI_WARN("Assert is not supported for OpenGL arch");
@@ -430,6 +447,11 @@ class KernelGen : public IRVisitor {
         used.int32 = true;
         emit("atomicMax(_data_i32_[{} >> 2], {} + 1); // dynamic activate",
              get_snode_meta_address(stmt->snode), stmt->val->short_name());
+      } else if (stmt->snode->type == SNodeType::bitmasked) {
+        used.int32 = true;
+        emit("atomicOr({}, 1 << ({} & 31)); // bitmasked activate",
+             get_bitmask_word(stmt->snode, stmt->ptr, stmt->val),
+             stmt->val->short_name());
       } else {
         TI_NOT_IMPLEMENTED
       }
@@ -442,6 +464,11 @@ class KernelGen : public IRVisitor {
         used.int32 = true;
         emit("_data_i32_[{} >> 2] = 0; // dynamic deactivate",
              get_snode_meta_address(stmt->snode), stmt->val->short_name());
+      } else if (stmt->snode->type == SNodeType::bitmasked) {
+        used.int32 = true;
+        emit("atomicAnd({}, ~(1 << ({} & 31))); // bitmasked deactivate",
+             get_bitmask_word(stmt->snode, stmt->ptr, stmt->val),
+             stmt->val->short_name());
       } else {
         TI_NOT_IMPLEMENTED
       }
@@ -455,6 +482,11 @@ class KernelGen : public IRVisitor {
         used.int32 = true;
         emit("int {} = int({} < _data_i32_[{} >> 2]);", stmt->short_name(),
              stmt->val->short_name(), get_snode_meta_address(stmt->snode));
+      } else if (stmt->snode->type == SNodeType::bitmasked) {
+        used.int32 = true;
+        emit("int {} = ({} >> ({} & 31)) & 1;", stmt->short_name(),
+             get_bitmask_word(stmt->snode, stmt->ptr, stmt->val),
+             stmt->val->short_name());
       } else {
         TI_NOT_IMPLEMENTED
       }
@@ -1122,8 +1154,9 @@ class KernelGen : public IRVisitor {
     } else if (stmt->task_type == Type::range_for) {
       generate_range_for_kernel(stmt);
     } else {
-      // struct_for is automatically lowered to ranged_for for dense snodes
-      // (#378). So we only need to support serial and range_for tasks.
+      // struct_for is automatically lowered to ranged_for for dense and
+      // bitmasked snodes (#378). So we only need to support serial and
+      // range_for tasks.
       TI_ERROR("[glsl] Unsupported offload type={} on OpenGL arch",
                stmt->task_name());
     }
@@ -1176,8 +1209,10 @@ void OpenglCodeGen::lower() {
   auto ir = kernel_->ir.get();
   auto &config = kernel_->program->config;
   config.demote_dense_struct_fors = true;
+  // There is no listgen in the GLSL runtime.
+  config.demote_bitmasked_struct_fors = true;
   irpass::compile_to_executable(ir, config, kernel_,
-                                /*vectorize=*/false, kernel_->grad,
+                                /*vectorize=*/false, kernel_->autodiff_mode,
                                 /*ad_use_stack=*/false, config.print_ir,
                                 /*lower_global_access=*/true,
                                 /*make_thread_local=*/config.make_thread_local);
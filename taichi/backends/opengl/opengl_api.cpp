@@ -35,6 +35,8 @@ int opengl_max_grid_dim = 1024;
 // TODO: Properly support setting GLES/GLSL in opengl backend
 // without this global static boolean.
 static bool kUseGles = false;
+// Set at most once in initialize_opengl below as well.
+static bool kBufferStorageSupported = false;
 
 #ifdef TI_WITH_OPENGL
 
@@ -217,6 +219,10 @@ bool initialize_opengl(bool use_gles, bool error_tolerance) {
 
   supported = std::make_optional<bool>(true);
   kUseGles = use_gles;
+  kBufferStorageSupported =
+      !use_gles && (GLAD_VERSION_MAJOR(opengl_version) > 4 ||
+                    (GLAD_VERSION_MAJOR(opengl_version) == 4 &&
+                     GLAD_VERSION_MINOR(opengl_version) >= 4));
   return true;
 }
 
@@ -362,7 +368,7 @@ OpenGlRuntime::~OpenGlRuntime() = default;
 void DeviceCompiledTaichiKernel::launch(RuntimeContext &ctx,
                                         Kernel *kernel,
                                         OpenGlRuntime *runtime) const {
-  uint8_t *args_buf_mapped = nullptr;
+  auto *device = static_cast<GLDevice *>(device_);
   auto args = kernel->args;
 
   // Prepare external arrays/ndarrays
@@ -386,12 +392,10 @@ void DeviceCompiledTaichiKernel::launch(RuntimeContext &ctx,
            /*export_sharing=*/false});
       item.second.total_size = args[i].size;
     }
-    void *host_ptr = (void *)ctx.args[i];
-    void *baseptr = device_->map(arr_bufs_[i]);
     if (program_.check_ext_arr_read(i)) {
-      std::memcpy((char *)baseptr, host_ptr, args[i].size);
+      device->write_buffer(arr_bufs_[i].get_ptr(0), (void *)ctx.args[i],
+                           args[i].size);
     }
-    device_->unmap(arr_bufs_[i]);
   }
   // clang-format off
   // Prepare argument buffer
@@ -402,17 +406,16 @@ void DeviceCompiledTaichiKernel::launch(RuntimeContext &ctx,
   // |...............taichi_opengl_ret_base.................|
   // |................taichi_opengl_external_arr_base..............|
   // clang-format on
+  const DeviceAllocation args_buf = args_bufs_[args_buf_index_];
+  args_buf_index_ = (args_buf_index_ + 1) % kNumArgsBuffers;
   if (program_.args_buf_size) {
-    args_buf_mapped = (uint8_t *)device_->map(args_buf_);
-    std::memcpy(args_buf_mapped, ctx.args,
-                program_.arg_count * sizeof(uint64_t));
+    device->write_buffer(args_buf.get_ptr(0), ctx.args,
+                         program_.arg_count * sizeof(uint64_t));
     if (program_.arr_args.size()) {
-      std::memcpy(
-          args_buf_mapped + size_t(taichi_opengl_extra_args_base),
-          ctx.extra_args,
+      device->write_buffer(
+          args_buf.get_ptr(taichi_opengl_extra_args_base), ctx.extra_args,
           size_t(program_.arg_count * taichi_max_num_indices) * sizeof(int));
     }
-    device_->unmap(args_buf_);
   }
 
   // Prepare runtime
@@ -426,6 +429,10 @@ void DeviceCompiledTaichiKernel::launch(RuntimeContext &ctx,
 
   auto cmdlist = device_->get_compute_stream()->new_command_list();
 
+  const int num_tasks = program_.tasks.size();
+  const bool timed = runtime->profiler &&
+                     2 * num_tasks <= device_->get_num_timestamps();
+
   // Kernel dispatch
   int i = 0;
   for (const auto &task : program_.tasks) {
@@ -436,7 +443,7 @@ void DeviceCompiledTaichiKernel::launch(RuntimeContext &ctx,
       binder->buffer(0, static_cast<int>(GLBufId::Root), core_bufs.root);
     binder->buffer(0, static_cast<int>(GLBufId::Gtmp), core_bufs.gtmp);
     if (program_.args_buf_size || program_.ret_buf_size)
-      binder->buffer(0, static_cast<int>(GLBufId::Args), args_buf_);
+      binder->buffer(0, static_cast<int>(GLBufId::Args), args_buf);
     // TODO: properly assert and throw if we bind more than allowed SSBOs.
     //       On most devices this number is 8. But I need to look up how
     //       to query this information so currently this is thrown from OpenGl.
@@ -453,7 +460,13 @@ void DeviceCompiledTaichiKernel::launch(RuntimeContext &ctx,
 
     cmdlist->bind_pipeline(compiled_pipeline_[i].get());
     cmdlist->bind_resources(binder);
+    if (timed) {
+      cmdlist->write_timestamp(2 * i);
+    }
     cmdlist->dispatch(task.num_groups, 1, 1);
+    if (timed) {
+      cmdlist->write_timestamp(2 * i + 1);
+    }
     cmdlist->memory_barrier();
     i++;
   }
@@ -465,6 +478,16 @@ void DeviceCompiledTaichiKernel::launch(RuntimeContext &ctx,
     device_->get_compute_stream()->submit(cmdlist.get());
   }
 
+  if (timed) {
+    // Waits for the tasks, as the timestamps are reused by the next launch.
+    auto timestamps = device_->get_timestamps(0, 2 * num_tasks);
+    for (int i = 0; i < num_tasks; i++) {
+      runtime->profiler->insert_record(
+          program_.tasks[i].name,
+          (timestamps[2 * i + 1] - timestamps[2 * i]) * 1e-6);
+    }
+  }
+
   // Data read-back
   if (program_.used.print) {
     dump_message_buffer(device_, runtime->impl->core_bufs.runtime,
@@ -485,10 +508,10 @@ void DeviceCompiledTaichiKernel::launch(RuntimeContext &ctx,
   }
 
   if (program_.ret_buf_size) {
-    uint8_t *baseptr = (uint8_t *)device_->map(args_buf_);
+    uint8_t *baseptr = (uint8_t *)device_->map(args_buf);
     memcpy(runtime->result_buffer, baseptr + taichi_opengl_ret_base,
            program_.ret_buf_size);
-    device_->unmap(args_buf_);
+    device_->unmap(args_buf);
   }
 }
 
@@ -497,10 +520,12 @@ DeviceCompiledTaichiKernel::DeviceCompiledTaichiKernel(
     Device *device)
     : device_(device), program_(std::move(program)) {
   if (program_.args_buf_size || program_.ret_buf_size) {
-    args_buf_ = device->allocate_memory({taichi_opengl_external_arr_base,
-                                         /*host_write=*/true,
-                                         /*host_read=*/true,
-                                         /*export_sharing=*/false});
+    for (auto &args_buf : args_bufs_) {
+      args_buf = device->allocate_memory({taichi_opengl_external_arr_base,
+                                          /*host_write=*/true,
+                                          /*host_read=*/true,
+                                          /*export_sharing=*/false});
+    }
   }
 
   for (auto &t : program_.tasks) {
@@ -548,6 +573,10 @@ void OpenGlRuntime::add_snode_tree(size_t size) {
   device->get_compute_stream()->submit_synced(cmdlist.get());
 }
 
+void OpenGlRuntime::set_program_binary_cache_dir(const std::string &dir) {
+  static_cast<GLDevice *>(device.get())->set_program_binary_cache_dir(dir);
+}
+
 bool is_opengl_api_available(bool use_gles) {
   if (get_environ_config("TI_ENABLE_OPENGL", 1) == 0)
     return false;
@@ -576,6 +605,10 @@ void OpenGlRuntime::add_snode_tree(size_t size) {
   TI_NOT_IMPLEMENTED;
 }
 
+void OpenGlRuntime::set_program_binary_cache_dir(const std::string &dir) {
+  TI_NOT_IMPLEMENTED;
+}
+
 bool is_opengl_api_available(bool use_gles) {
   return false;
 }
@@ -590,5 +623,9 @@ bool is_gles() {
   return kUseGles;
 }
 
+bool is_buffer_storage_supported() {
+  return kBufferStorageSupported;
+}
+
 }  // namespace opengl
 TLANG_NAMESPACE_END
@@ -24,6 +24,8 @@ namespace opengl {
 bool initialize_opengl(bool use_gles = false, bool error_tolerance = false);
 bool is_opengl_api_available(bool use_gles = false);
 bool is_gles();
+// Whether buffers can be persistently mapped (glBufferStorage, OpenGL 4.4+).
+bool is_buffer_storage_supported();
 
 #define PER_OPENGL_EXTENSION(x) extern bool opengl_extension_##x;
 #include "taichi/inc/opengl_extension.inc.h"
@@ -121,7 +123,11 @@ class DeviceCompiledTaichiKernel {
 
   std::vector<std::unique_ptr<Pipeline>> compiled_pipeline_;
 
-  DeviceAllocation args_buf_{kDeviceNullAllocation};
+  // The argument buffers are used in a round-robin fashion, so that the host
+  // rarely has to wait for a previous launch to write the arguments.
+  static constexpr int kNumArgsBuffers = 3;
+  DeviceAllocation args_bufs_[kNumArgsBuffers]{kDeviceNullAllocation};
+  mutable int args_buf_index_{0};
   DeviceAllocation ret_buf_{kDeviceNullAllocation};
   // Only saves numpy/torch cpu based external array since they don't have
   // DeviceAllocation.
@@ -60,6 +60,9 @@ inline int opengl_argument_address_shifter(DataType type) {
 inline int opengl_get_snode_meta_size(const SNode &snode) {
   if (snode.type == SNodeType::dynamic) {
     return sizeof(int);
+  } else if (snode.type == SNodeType::bitmasked) {
+    // One bit per cell, in 32-bit words.
+    return (int)((snode.num_cells_per_container + 31) / 32 * sizeof(int));
   } else {
     return 0;
   }
@@ -1,5 +1,10 @@
 #include "opengl_device.h"
 #include "opengl_api.h"
+#include "taichi/system/device_memory_tracker.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 
 namespace taichi {
 namespace lang {
@@ -85,10 +90,36 @@ std::unique_ptr<ResourceBinder::Bindings> GLResourceBinder::materialize() {
   return nullptr;
 }
 
+namespace {
+
+// The program binaries are specific to the driver, so they are keyed by it
+// along with the source.
+std::string get_program_binary_path(const std::string &dir,
+                                    const PipelineSourceDesc &desc) {
+  std::string key;
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    key += (const char *)glGetString(name);
+    key += '\n';
+  }
+  key.append((const char *)desc.data, desc.size);
+  return fmt::format("{}/{:016x}.bin", dir, std::hash<std::string>{}(key));
+}
+
+}  // namespace
+
 GLPipeline::GLPipeline(const PipelineSourceDesc &desc,
-                       const std::string &name) {
+                       const std::string &name,
+                       const std::string &binary_cache_dir) {
   TI_ASSERT(desc.type == PipelineSourceType::glsl_src);
 
+  std::string binary_path;
+  if (!binary_cache_dir.empty()) {
+    binary_path = get_program_binary_path(binary_cache_dir, desc);
+    if (load_program_binary(binary_path, desc)) {
+      return;
+    }
+  }
+
   GLuint shader_id;
   shader_id = glCreateShader(GL_COMPUTE_SHADER);
 
@@ -110,6 +141,10 @@ GLPipeline::GLPipeline(const PipelineSourceDesc &desc,
   check_opengl_error();
 
   program_id_ = glCreateProgram();
+  if (!binary_path.empty()) {
+    glProgramParameteri(program_id_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
   glAttachShader(program_id_, shader_id);
   glLinkProgram(program_id_);
   glGetProgramiv(program_id_, GL_LINK_STATUS, &status);
@@ -124,16 +159,96 @@ GLPipeline::GLPipeline(const PipelineSourceDesc &desc,
   check_opengl_error();
 
   glDeleteShader(shader_id);
+
+  if (!binary_path.empty()) {
+    store_program_binary(binary_path, desc);
+  }
 }
 
 GLPipeline::~GLPipeline() {
   glDeleteProgram(program_id_);
 }
 
+// The file holds the binary format, the size of the source and the source,
+// which guards against hash collisions, and the binary.
+bool GLPipeline::load_program_binary(const std::string &path,
+                                     const PipelineSourceDesc &desc) {
+  std::ifstream ifs(path, std::ios::binary);
+  if (!ifs) {
+    return false;
+  }
+  std::vector<char> data((std::istreambuf_iterator<char>(ifs)),
+                         std::istreambuf_iterator<char>());
+  const size_t header_size = sizeof(GLenum) + sizeof(uint64_t);
+  if (data.size() < header_size) {
+    return false;
+  }
+  GLenum format;
+  uint64_t source_size;
+  std::memcpy(&format, data.data(), sizeof(format));
+  std::memcpy(&source_size, data.data() + sizeof(format), sizeof(source_size));
+  if (source_size != desc.size ||
+      data.size() < header_size + source_size ||
+      std::memcmp(data.data() + header_size, desc.data, desc.size) != 0) {
+    return false;
+  }
+  const char *binary = data.data() + header_size + source_size;
+  const GLsizei binary_size = data.size() - header_size - source_size;
+
+  program_id_ = glCreateProgram();
+  glProgramBinary(program_id_, format, binary, binary_size);
+  int status = GL_FALSE;
+  glGetProgramiv(program_id_, GL_LINK_STATUS, &status);
+  if (status != GL_TRUE) {
+    // E.g. the driver was updated, which may also raise GL_INVALID_ENUM for
+    // the format.
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    glDeleteProgram(program_id_);
+    TI_TRACE("Rejected the cached program binary {}", path);
+    return false;
+  }
+  return true;
+}
+
+void GLPipeline::store_program_binary(const std::string &path,
+                                      const PipelineSourceDesc &desc) {
+  GLint binary_size = 0;
+  glGetProgramiv(program_id_, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+  if (binary_size <= 0) {
+    // The driver supports no binary format.
+    return;
+  }
+  std::vector<char> binary(binary_size);
+  GLenum format;
+  glGetProgramBinary(program_id_, binary_size, &binary_size, &format,
+                     binary.data());
+  check_opengl_error("glGetProgramBinary");
+
+  // Written aside and renamed, so that concurrent runs never read a partial
+  // file.
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream ofs(tmp_path, std::ios::binary);
+    const uint64_t source_size = desc.size;
+    ofs.write((const char *)&format, sizeof(format));
+    ofs.write((const char *)&source_size, sizeof(source_size));
+    ofs.write((const char *)desc.data, desc.size);
+    ofs.write(binary.data(), binary_size);
+    if (!ofs) {
+      return;
+    }
+  }
+  std::rename(tmp_path.c_str(), path.c_str());
+}
+
 ResourceBinder *GLPipeline::resource_binder() {
   return &binder_;
 }
 
+GLCommandList::GLCommandList(GLDevice *device) : device_(device) {
+}
+
 GLCommandList::~GLCommandList() {
 }
 
@@ -151,6 +266,7 @@ void GLCommandList::bind_resources(ResourceBinder *_binder) {
     cmd->buffer = buffer;
     cmd->index = binding;
     recorded_commands_.push_back(std::move(cmd));
+    used_buffers_.insert(buffer);
   }
 }
 
@@ -184,6 +300,8 @@ void GLCommandList::buffer_copy(DevicePtr dst, DevicePtr src, size_t size) {
   cmd->dst_offset = dst.offset;
   cmd->size = size;
   recorded_commands_.push_back(std::move(cmd));
+  used_buffers_.insert(src.alloc_id);
+  used_buffers_.insert(dst.alloc_id);
 }
 
 void GLCommandList::buffer_fill(DevicePtr ptr, size_t size, uint32_t data) {
@@ -193,6 +311,7 @@ void GLCommandList::buffer_fill(DevicePtr ptr, size_t size, uint32_t data) {
   cmd->size = size;
   cmd->data = data;
   recorded_commands_.push_back(std::move(cmd));
+  used_buffers_.insert(ptr.alloc_id);
 }
 
 void GLCommandList::dispatch(uint32_t x, uint32_t y, uint32_t z) {
@@ -258,22 +377,32 @@ void GLCommandList::image_to_buffer(DevicePtr dst_buf,
   TI_NOT_IMPLEMENTED;
 }
 
+void GLCommandList::write_timestamp(uint32_t index) {
+  auto cmd = std::make_unique<CmdWriteTimestamp>();
+  cmd->query = device_->timestamp_query(index);
+  recorded_commands_.push_back(std::move(cmd));
+}
+
 void GLCommandList::run_commands() {
   for (auto &cmd : recorded_commands_) {
     cmd->execute();
   }
 }
 
+GLStream::GLStream(GLDevice *device) : device_(device) {
+}
+
 GLStream::~GLStream() {
 }
 
 std::unique_ptr<CommandList> GLStream::new_command_list() {
-  return std::make_unique<GLCommandList>();
+  return std::make_unique<GLCommandList>(device_);
 }
 
 void GLStream::submit(CommandList *_cmdlist) {
   GLCommandList *cmdlist = static_cast<GLCommandList *>(_cmdlist);
   cmdlist->run_commands();
+  device_->track_gpu_usage(cmdlist->used_buffers());
 }
 
 void GLStream::submit_synced(CommandList *cmdlist) {
@@ -285,6 +414,9 @@ void GLStream::command_sync() {
 }
 
 GLDevice::~GLDevice() {
+  if (!timestamp_queries_.empty()) {
+    glDeleteQueries(timestamp_queries_.size(), timestamp_queries_.data());
+  }
 }
 
 DeviceAllocation GLDevice::allocate_memory(const AllocParams &params) {
@@ -293,39 +425,70 @@ DeviceAllocation GLDevice::allocate_memory(const AllocParams &params) {
   check_opengl_error("glGenBuffers");
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
   check_opengl_error("glBindBuffer");
-  glBufferData(GL_SHADER_STORAGE_BUFFER, params.size, nullptr, GL_DYNAMIC_READ);
-  check_opengl_error("glBufferData");
+
+  GLbitfield access = 0;
+  if (params.host_read) {
+    access |= GL_MAP_READ_BIT;
+  }
+  if (params.host_write) {
+    access |= GL_MAP_WRITE_BIT;
+  }
+
+  if (access && is_buffer_storage_supported()) {
+    // A coherent mapping needs no flush or unmap for the GPU to see the host
+    // writes, and vice versa once a fence has signaled.
+    access |= GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, params.size, nullptr,
+                    access | GL_DYNAMIC_STORAGE_BIT);
+    check_opengl_error("glBufferStorage");
+    void *mapped =
+        glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, params.size, access);
+    check_opengl_error("glMapBufferRange");
+    persistent_mappings_[buffer].ptr = (uint8_t *)mapped;
+  } else {
+    glBufferData(GL_SHADER_STORAGE_BUFFER, params.size, nullptr,
+                 GL_DYNAMIC_READ);
+    check_opengl_error("glBufferData");
+  }
 
   DeviceAllocation alloc;
   alloc.device = this;
   alloc.alloc_id = buffer;
 
-  if (params.host_read && params.host_write) {
-    buffer_to_access_[buffer] = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT;
-  } else if (params.host_read) {
-    buffer_to_access_[buffer] = GL_MAP_READ_BIT;
-  } else if (params.host_write) {
-    buffer_to_access_[buffer] = GL_MAP_WRITE_BIT;
+  if (access) {
+    buffer_to_access_[buffer] = access;
   }
 
+  DeviceMemoryTracker::get_instance().record_allocation(this, buffer,
+                                                        params.size);
   return alloc;
 }
 
 void GLDevice::dealloc_memory(DeviceAllocation handle) {
+  // Deleting a buffer also unmaps it.
+  persistent_mappings_.erase(handle.alloc_id);
+  buffer_to_access_.erase(handle.alloc_id);
   glDeleteBuffers(1, &handle.alloc_id);
   check_opengl_error("glDeleteBuffers");
+  DeviceMemoryTracker::get_instance().record_deallocation(this,
+                                                          handle.alloc_id);
 }
 
 std::unique_ptr<Pipeline> GLDevice::create_pipeline(
     const PipelineSourceDesc &src,
     std::string name) {
-  return std::make_unique<GLPipeline>(src, name);
+  return std::make_unique<GLPipeline>(src, name, program_binary_cache_dir_);
 }
 
 void *GLDevice::map_range(DevicePtr ptr, uint64_t size) {
   TI_ASSERT_INFO(
       buffer_to_access_.find(ptr.alloc_id) != buffer_to_access_.end(),
       "Buffer not created with host_read or write");
+  if (auto it = persistent_mappings_.find(ptr.alloc_id);
+      it != persistent_mappings_.end()) {
+    wait_for_gpu_usage(ptr.alloc_id);
+    return it->second.ptr + ptr.offset;
+  }
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, ptr.alloc_id);
   check_opengl_error("glBindBuffer");
   void *mapped = glMapBufferRange(GL_SHADER_STORAGE_BUFFER, ptr.offset, size,
@@ -335,6 +498,9 @@ void *GLDevice::map_range(DevicePtr ptr, uint64_t size) {
 }
 
 void *GLDevice::map(DeviceAllocation alloc) {
+  if (persistent_mappings_.count(alloc.alloc_id)) {
+    return map_range(alloc.get_ptr(0), /*size=*/0);
+  }
   int size = 0;
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, alloc.alloc_id);
   glGetBufferParameteriv(GL_SHADER_STORAGE_BUFFER, GL_BUFFER_SIZE, &size);
@@ -353,6 +519,9 @@ void *GLDevice::map(DeviceAllocation alloc) {
 }
 
 void GLDevice::unmap(DevicePtr ptr) {
+  if (persistent_mappings_.count(ptr.alloc_id)) {
+    return;
+  }
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, ptr.alloc_id);
   check_opengl_error("glBindBuffer");
   glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
@@ -360,12 +529,64 @@ void GLDevice::unmap(DevicePtr ptr) {
 }
 
 void GLDevice::unmap(DeviceAllocation alloc) {
+  if (persistent_mappings_.count(alloc.alloc_id)) {
+    return;
+  }
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, alloc.alloc_id);
   check_opengl_error("glBindBuffer");
   glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
   check_opengl_error("glUnmapBuffer");
 }
 
+void GLDevice::write_buffer(DevicePtr dst, const void *data, size_t size) {
+  if (auto it = persistent_mappings_.find(dst.alloc_id);
+      it != persistent_mappings_.end()) {
+    wait_for_gpu_usage(dst.alloc_id);
+    std::memcpy(it->second.ptr + dst.offset, data, size);
+    return;
+  }
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, dst.alloc_id);
+  check_opengl_error("glBindBuffer");
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, dst.offset, size, data);
+  check_opengl_error("glBufferSubData");
+}
+
+void GLDevice::track_gpu_usage(const std::unordered_set<GLuint> &buffers) {
+  std::shared_ptr<std::remove_pointer_t<GLsync>> fence{nullptr};
+  for (auto buffer : buffers) {
+    auto it = persistent_mappings_.find(buffer);
+    if (it == persistent_mappings_.end()) {
+      continue;
+    }
+    if (fence == nullptr) {
+      // Makes the shader writes visible through the persistent mappings.
+      glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+      check_opengl_error("glMemoryBarrier");
+      fence.reset(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0),
+                  [](GLsync sync) { glDeleteSync(sync); });
+      check_opengl_error("glFenceSync");
+    }
+    it->second.fence = fence;
+  }
+}
+
+void GLDevice::wait_for_gpu_usage(GLuint buffer) {
+  auto &fence = persistent_mappings_.at(buffer).fence;
+  if (fence == nullptr) {
+    return;
+  }
+  constexpr GLuint64 kTimeoutNs = 1000000000;
+  GLenum status;
+  do {
+    status = glClientWaitSync(fence.get(), GL_SYNC_FLUSH_COMMANDS_BIT,
+                              kTimeoutNs);
+  } while (status == GL_TIMEOUT_EXPIRED);
+  if (status == GL_WAIT_FAILED) {
+    check_opengl_error("glClientWaitSync");
+  }
+  fence = nullptr;
+}
+
 void GLDevice::memcpy_internal(DevicePtr dst, DevicePtr src, uint64_t size) {
   TI_ASSERT(dst.device == src.device);
   glBindBuffer(GL_COPY_WRITE_BUFFER, dst.alloc_id);
@@ -394,6 +615,30 @@ std::unique_ptr<Pipeline> GLDevice::create_raster_pipeline(
   return nullptr;
 }
 
+uint32_t GLDevice::get_num_timestamps() {
+  if (is_gles()) {
+    return 0;
+  }
+  if (timestamp_queries_.empty()) {
+    timestamp_queries_.resize(kNumTimestamps);
+    glGenQueries(kNumTimestamps, timestamp_queries_.data());
+    check_opengl_error("glGenQueries");
+  }
+  return kNumTimestamps;
+}
+
+std::vector<uint64_t> GLDevice::get_timestamps(uint32_t begin,
+                                               uint32_t count) {
+  std::vector<uint64_t> timestamps(count);
+  for (uint32_t i = 0; i < count; i++) {
+    // Waits for the query to be available.
+    glGetQueryObjectui64v(timestamp_queries_[begin + i], GL_QUERY_RESULT,
+                          &timestamps[i]);
+    check_opengl_error("glGetQueryObjectui64v");
+  }
+  return timestamps;
+}
+
 Stream *GLDevice::get_graphics_stream() {
   TI_NOT_IMPLEMENTED;
   return nullptr;
@@ -506,6 +751,11 @@ void GLCommandList::CmdDispatch::execute() {
   glDispatchCompute(x, y, z);
 }
 
+void GLCommandList::CmdWriteTimestamp::execute() {
+  glQueryCounter(query, GL_TIMESTAMP);
+  check_opengl_error("glQueryCounter");
+}
+
 }  // namespace opengl
 }  // namespace lang
 }  // namespace taichi
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <memory>
+#include <type_traits>
+#include <unordered_set>
+
 #include "taichi/backends/device.h"
 
 #include "glad/gl.h"
@@ -11,6 +15,8 @@ namespace opengl {
 
 void check_opengl_error(const std::string &msg = "OpenGL");
 
+class GLDevice;
+
 class GLResourceBinder : public ResourceBinder {
  public:
   ~GLResourceBinder() override;
@@ -61,7 +67,12 @@ class GLResourceBinder : public ResourceBinder {
 
 class GLPipeline : public Pipeline {
  public:
-  GLPipeline(const PipelineSourceDesc &desc, const std::string &name);
+  // If |binary_cache_dir| is not empty, the linked program is loaded from
+  // there when it was stored by an earlier run on the same driver, and
+  // stored there otherwise.
+  GLPipeline(const PipelineSourceDesc &desc,
+             const std::string &name,
+             const std::string &binary_cache_dir = "");
   ~GLPipeline() override;
 
   ResourceBinder *resource_binder() override;
@@ -71,12 +82,18 @@ class GLPipeline : public Pipeline {
   }
 
  private:
+  bool load_program_binary(const std::string &path,
+                           const PipelineSourceDesc &desc);
+  void store_program_binary(const std::string &path,
+                            const PipelineSourceDesc &desc);
+
   GLuint program_id_;
   GLResourceBinder binder_;
 };
 
 class GLCommandList : public CommandList {
  public:
+  explicit GLCommandList(GLDevice *device);
   ~GLCommandList() override;
 
   void bind_pipeline(Pipeline *p) override;
@@ -119,10 +136,16 @@ class GLCommandList : public CommandList {
                        DeviceAllocation src_img,
                        ImageLayout img_layout,
                        const BufferImageCopyParams &params) override;
+  void write_timestamp(uint32_t index) override;
 
   // GL only stuff
   void run_commands();
 
+  // The buffers referred to by the recorded commands
+  const std::unordered_set<GLuint> &used_buffers() const {
+    return used_buffers_;
+  }
+
  private:
   struct Cmd {
     virtual void execute() {
@@ -166,11 +189,19 @@ class GLCommandList : public CommandList {
     void execute() override;
   };
 
+  struct CmdWriteTimestamp : public Cmd {
+    GLuint query{0};
+    void execute() override;
+  };
+
+  GLDevice *device_{nullptr};
   std::vector<std::unique_ptr<Cmd>> recorded_commands_;
+  std::unordered_set<GLuint> used_buffers_;
 };
 
 class GLStream : public Stream {
  public:
+  explicit GLStream(GLDevice *device);
   ~GLStream() override;
 
   std::unique_ptr<CommandList> new_command_list() override;
@@ -178,6 +209,9 @@ class GLStream : public Stream {
   void submit_synced(CommandList *cmdlist) override;
 
   void command_sync() override;
+
+ private:
+  GLDevice *device_;
 };
 
 class GLDevice : public GraphicsDevice {
@@ -198,9 +232,24 @@ class GLDevice : public GraphicsDevice {
   void unmap(DevicePtr ptr) override;
   void unmap(DeviceAllocation alloc) override;
 
+  // Writes |size| bytes from |data| to |dst| without mapping the buffer. This
+  // writes to the persistent mapping if there is one, or uses glBufferSubData
+  // otherwise.
+  void write_buffer(DevicePtr dst, const void *data, size_t size);
+
+  // Called after the commands using |buffers| are issued, so that the host
+  // waits for them before accessing the persistently mapped ones.
+  void track_gpu_usage(const std::unordered_set<GLuint> &buffers);
+
   // Strictly intra device copy (synced)
   void memcpy_internal(DevicePtr dst, DevicePtr src, uint64_t size) override;
 
+  // Caches the binaries of the programs of the pipelines created from now on
+  // in |dir|, see GLPipeline.
+  void set_program_binary_cache_dir(const std::string &dir) {
+    program_binary_cache_dir_ = dir;
+  }
+
   // Each thraed will acquire its own stream
   Stream *get_compute_stream() override;
 
@@ -229,9 +278,34 @@ class GLDevice : public GraphicsDevice {
                        ImageLayout img_layout,
                        const BufferImageCopyParams &params) override;
 
+  // GL_TIMESTAMP queries, which GLES does not have.
+  uint32_t get_num_timestamps() override;
+  std::vector<uint64_t> get_timestamps(uint32_t begin,
+                                       uint32_t count) override;
+  GLuint timestamp_query(uint32_t index) const {
+    return timestamp_queries_[index];
+  }
+
  private:
-  GLStream stream_;
+  // Waits for the GPU work accessing the persistently mapped |buffer|.
+  void wait_for_gpu_usage(GLuint buffer);
+
+  // Host-visible buffers are persistently mapped if glBufferStorage is
+  // supported. Since mapping then no longer synchronizes implicitly, each of
+  // them keeps the fence of the last submission that used it.
+  struct PersistentMapping {
+    uint8_t *ptr{nullptr};
+    std::shared_ptr<std::remove_pointer_t<GLsync>> fence{nullptr};
+  };
+
+  static constexpr uint32_t kNumTimestamps = 1024;
+
+  GLStream stream_{this};
+  // Created on the first get_num_timestamps().
+  std::vector<GLuint> timestamp_queries_;
   std::unordered_map<GLuint, GLbitfield> buffer_to_access_;
+  std::unordered_map<GLuint, PersistentMapping> persistent_mappings_;
+  std::string program_binary_cache_dir_;
 };
 
 class GLSurface : public Surface {
@@ -8,6 +8,8 @@
 
 TLANG_NAMESPACE_BEGIN
 
+class KernelProfilerBase;
+
 namespace opengl {
 
 struct CompiledTaichiKernel;
@@ -24,8 +26,12 @@ struct OpenGlRuntime {
   DeviceCompiledTaichiKernel *keep(CompiledTaichiKernel &&program);
   // FIXME: Currently GLSL codegen only supports single root
   void add_snode_tree(size_t size);
+  // Caches the binaries of the compiled programs in |dir| across runs.
+  void set_program_binary_cache_dir(const std::string &dir);
 
   void *result_buffer;
+  // Times the tasks with the GPU timestamps, unless nullptr.
+  KernelProfilerBase *profiler{nullptr};
 };
 
 using SNodeId = std::string;
@@ -1,5 +1,6 @@
 #include "taichi/backends/opengl/opengl_program.h"
 #include "taichi/backends/opengl/aot_module_builder_impl.h"
+#include "taichi/util/io.h"
 using namespace taichi::lang::opengl;
 
 namespace taichi {
@@ -28,6 +29,18 @@ void OpenglProgramImpl::materialize_runtime(MemoryPool *memory_pool,
       sizeof(uint64) * taichi_result_buffer_entries, 8);
   opengl_runtime_ = std::make_unique<opengl::OpenGlRuntime>();
   opengl_runtime_->result_buffer = *result_buffer_ptr;
+  opengl_runtime_->profiler = profiler;
+  TI_WARN_IF(profiler && opengl_runtime_->device->get_num_timestamps() == 0,
+             "The device has no GPU timer, kernels are not profiled");
+  if (config->offline_cache) {
+    auto path = config->offline_cache_file_path;
+    if (path.empty()) {
+      path = get_repo_dir() + "ticache";
+    }
+    path = fmt::format("{}/{}", path, arch_name(Arch::opengl));
+    create_directories(path);
+    opengl_runtime_->set_program_binary_cache_dir(path);
+  }
 #else
   TI_NOT_IMPLEMENTED;
 #endif
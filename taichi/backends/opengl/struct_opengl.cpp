@@ -67,10 +67,13 @@ void OpenglStructCompiler::generate_types(const SNode &snode) {
     snode_info.stride = data_type_size(snode.dt);
   } else if (snode.type == SNodeType::dense ||
              snode.type == SNodeType::dynamic ||
+             snode.type == SNodeType::bitmasked ||
              snode.type == SNodeType::root) {
     int64 n = snode.num_cells_per_container;
     // the `length` field of a dynamic SNode is at it's end:
     // | x[0] | x[1] | x[2] | x[3] | ... | len |
+    // and so are the mask words of a bitmasked SNode:
+    // | x[0] | x[1] | ... | x[n - 1] | mask[0] | ... |
     int extension = opengl_get_snode_meta_size(snode);
     snode_info.length = n;
     snode_info.stride = snode_child_info.stride * n + extension;  // my stride
@@ -78,8 +81,8 @@ void OpenglStructCompiler::generate_types(const SNode &snode) {
   } else {
     TI_ERROR(
         "SNodeType={} not supported on OpenGL\n"
-        "Consider use ti.init(ti.cpu) or ti.init(ti.cuda) if you "
-        "want to use sparse data structures",
+        "Consider use ti.bitmasked, or ti.init(ti.cpu) or ti.init(ti.cuda) "
+        "if you want to use other sparse data structures",
         snode_type_name(snode.type));
     TI_NOT_IMPLEMENTED;
   }
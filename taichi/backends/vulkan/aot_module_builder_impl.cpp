@@ -13,6 +13,9 @@ AotModuleBuilderImpl::AotModuleBuilderImpl(
     const std::vector<CompiledSNodeStructs> &compiled_structs)
     : compiled_structs_(compiled_structs) {
   aot_target_device_ = std::make_unique<AotTargetDevice>(Arch::vulkan);
+  for (const auto &compiled : compiled_structs_) {
+    ti_aot_data_.root_buffer_size.push_back(compiled.root_size);
+  }
 }
 
 void AotModuleBuilderImpl::write_spv_file(
@@ -51,6 +54,8 @@ void AotModuleBuilderImpl::add_per_backend(const std::string &identifier,
   spirv::lower(kernel);
   auto compiled =
       run_codegen(kernel, aot_target_device_.get(), compiled_structs_);
+  // The loader looks kernels up by their identifier.
+  compiled.kernel_attribs.name = identifier;
   ti_aot_data_.kernels.push_back(compiled.kernel_attribs);
   ti_aot_data_.spirv_codes.push_back(compiled.task_spirv_source_codes);
 }
@@ -62,6 +67,40 @@ void AotModuleBuilderImpl::add_field_per_backend(const std::string &identifier,
                                                  std::vector<int> shape,
                                                  int row_num,
                                                  int column_num) {
+  const auto *dense_snode = rep_snode->parent;
+  TI_ASSERT_INFO(all_fields_are_dense_in_container(dense_snode),
+                 "AOT field {} must be placed under a dense SNode of the root",
+                 identifier);
+  int root_id = -1;
+  for (int i = 0; i < compiled_structs_.size(); ++i) {
+    if (compiled_structs_[i].root == dense_snode->parent) {
+      root_id = i;
+    }
+  }
+  TI_ASSERT(root_id != -1);
+  const auto &descs = compiled_structs_[root_id].snode_descriptors;
+  const auto &dense_desc = descs.at(dense_snode->id);
+
+  CompiledFieldData field_data;
+  field_data.field_name = identifier;
+  field_data.dtype = (int)dt->as<PrimitiveType>()->type;
+  field_data.dtype_name = data_type_name(dt);
+  field_data.shape = shape;
+  field_data.root_id = root_id;
+  field_data.mem_offset_in_root = dense_desc.mem_offset_in_parent_cell;
+  field_data.cell_stride = dense_desc.cell_stride;
+  // The components of a matrix field are consecutive children of the dense.
+  const int first = find_children_id(rep_snode);
+  const int num_members = is_scalar ? 1 : row_num * column_num;
+  for (int i = 0; i < num_members; ++i) {
+    const auto *member = dense_snode->ch[first + i].get();
+    field_data.member_offsets.push_back(
+        descs.at(member->id).mem_offset_in_parent_cell);
+  }
+  field_data.is_scalar = is_scalar;
+  field_data.row_num = row_num;
+  field_data.column_num = column_num;
+  ti_aot_data_.fields.push_back(field_data);
 }
 
 void AotModuleBuilderImpl::add_per_backend_tmpl(const std::string &identifier,
@@ -0,0 +1,56 @@
+#include "taichi/backends/vulkan/aot_module_loader_impl.h"
+
+#include <fstream>
+
+namespace taichi {
+namespace lang {
+namespace vulkan {
+
+AotModuleLoaderImpl::AotModuleLoaderImpl(const std::string &output_dir)
+    : output_dir_(output_dir) {
+  const std::string bin_path = fmt::format("{}/metadata.tcb", output_dir);
+  read_from_binary_file(ti_aot_data_, bin_path);
+}
+
+bool AotModuleLoaderImpl::get_kernel(const std::string &name,
+                                     VkRuntime::RegisterParams &kernel) {
+  for (const auto &k : ti_aot_data_.kernels) {
+    if (k.name != name) {
+      continue;
+    }
+    kernel.kernel_attribs = k;
+    kernel.task_spirv_source_codes.clear();
+    for (const auto &task : k.tasks_attribs) {
+      kernel.task_spirv_source_codes.push_back(read_spv_file(task.name));
+    }
+    return true;
+  }
+  return false;
+}
+
+const CompiledFieldData *AotModuleLoaderImpl::get_field(
+    const std::string &name) const {
+  for (const auto &f : ti_aot_data_.fields) {
+    if (f.field_name == name) {
+      return &f;
+    }
+  }
+  return nullptr;
+}
+
+std::vector<uint32_t> AotModuleLoaderImpl::read_spv_file(
+    const std::string &task_name) const {
+  const std::string spv_path = fmt::format("{}/{}.spv", output_dir_, task_name);
+  std::ifstream fs(spv_path, std::ios_base::binary | std::ios::ate);
+  TI_ERROR_IF(!fs.is_open(), "Cannot open {}", spv_path);
+  const size_t size = fs.tellg();
+  TI_ASSERT(size % sizeof(uint32_t) == 0);
+  std::vector<uint32_t> source_code(size / sizeof(uint32_t));
+  fs.seekg(0);
+  fs.read((char *)source_code.data(), size);
+  return source_code;
+}
+
+}  // namespace vulkan
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "taichi/backends/vulkan/aot_utils.h"
+#include "taichi/backends/vulkan/runtime.h"
+
+namespace taichi {
+namespace lang {
+namespace vulkan {
+
+/**
+ * Reads an AOT module dumped by AotModuleBuilderImpl from its directory.
+ */
+class AotModuleLoaderImpl {
+ public:
+  explicit AotModuleLoaderImpl(const std::string &output_dir);
+
+  /**
+   * Fills |kernel| with the kernel added as |name|, reading its SPIR-V from
+   * disk. Returns false if there is no such kernel.
+   */
+  bool get_kernel(const std::string &name, VkRuntime::RegisterParams &kernel);
+
+  /**
+   * Returns nullptr if there is no field added as |name|.
+   */
+  const CompiledFieldData *get_field(const std::string &name) const;
+
+  const std::vector<size_t> &get_root_buffer_sizes() const {
+    return ti_aot_data_.root_buffer_size;
+  }
+
+ private:
+  std::vector<uint32_t> read_spv_file(const std::string &task_name) const;
+
+  std::string output_dir_;
+  TaichiAotData ti_aot_data_;
+};
+
+}  // namespace vulkan
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,113 @@
+#include "taichi/backends/vulkan/aot_runtime.h"
+
+#include <cstring>
+
+namespace taichi {
+namespace lang {
+namespace vulkan {
+
+namespace {
+
+size_t get_num_cells(const CompiledFieldData &field) {
+  size_t num_cells = 1;
+  for (int s : field.shape) {
+    num_cells *= s;
+  }
+  return num_cells;
+}
+
+size_t get_member_size(const CompiledFieldData &field) {
+  return data_type_size(PrimitiveType::get(PrimitiveTypeID(field.dtype)));
+}
+
+}  // namespace
+
+AotRuntime::AotRuntime(const Params &params)
+    : device_(params.device),
+      loader_(params.module_path),
+      host_result_buffer_(taichi_result_buffer_entries, 0) {
+  VkRuntime::Params vk_params;
+  vk_params.host_result_buffer = host_result_buffer_.data();
+  vk_params.device = device_;
+  runtime_ = std::make_unique<VkRuntime>(std::move(vk_params));
+  for (size_t size : loader_.get_root_buffer_sizes()) {
+    runtime_->add_root_buffer(size);
+  }
+}
+
+void AotRuntime::launch_kernel(const std::string &name, RuntimeContext *ctx) {
+  auto it = kernels_.find(name);
+  if (it == kernels_.end()) {
+    VkRuntime::RegisterParams kernel;
+    TI_ERROR_IF(!loader_.get_kernel(name, kernel),
+                "Kernel {} is not in the AOT module", name);
+    it = kernels_.emplace(name, runtime_->register_taichi_kernel(kernel))
+             .first;
+  }
+  runtime_->launch_kernel(it->second, ctx);
+}
+
+void AotRuntime::read_field(const std::string &name, void *data) {
+  const auto &field = get_field(name);
+  const size_t num_cells = get_num_cells(field);
+  const size_t member_size = get_member_size(field);
+  const size_t size = num_cells * field.cell_stride;
+  auto staging = device_->allocate_memory_unique(
+      {size, /*host_write=*/false, /*host_read=*/true,
+       /*export_sharing=*/false, AllocUsage::Storage});
+  DevicePtr src = runtime_->get_snode_tree_device_ptr(field.root_id);
+  src.offset += field.mem_offset_in_root;
+  // The launches so far may still write to the field.
+  synchronize();
+  device_->memcpy_internal(staging->get_ptr(0), src, size);
+
+  const char *cells = reinterpret_cast<const char *>(device_->map(*staging));
+  char *dst = reinterpret_cast<char *>(data);
+  for (size_t i = 0; i < num_cells; ++i) {
+    for (size_t offset : field.member_offsets) {
+      std::memcpy(dst, cells + i * field.cell_stride + offset, member_size);
+      dst += member_size;
+    }
+  }
+  device_->unmap(*staging);
+}
+
+void AotRuntime::write_field(const std::string &name, const void *data) {
+  const auto &field = get_field(name);
+  const size_t num_cells = get_num_cells(field);
+  const size_t member_size = get_member_size(field);
+  const size_t size = num_cells * field.cell_stride;
+  auto staging = device_->allocate_memory_unique(
+      {size, /*host_write=*/true, /*host_read=*/true,
+       /*export_sharing=*/false, AllocUsage::Storage});
+  DevicePtr root = runtime_->get_snode_tree_device_ptr(field.root_id);
+  root.offset += field.mem_offset_in_root;
+  synchronize();
+  // The cells may hold other fields as well, so this is a read-modify-write.
+  device_->memcpy_internal(staging->get_ptr(0), root, size);
+
+  char *cells = reinterpret_cast<char *>(device_->map(*staging));
+  const char *src = reinterpret_cast<const char *>(data);
+  for (size_t i = 0; i < num_cells; ++i) {
+    for (size_t offset : field.member_offsets) {
+      std::memcpy(cells + i * field.cell_stride + offset, src, member_size);
+      src += member_size;
+    }
+  }
+  device_->unmap(*staging);
+  device_->memcpy_internal(root, staging->get_ptr(0), size);
+}
+
+void AotRuntime::synchronize() {
+  runtime_->synchronize();
+}
+
+const CompiledFieldData &AotRuntime::get_field(const std::string &name) const {
+  const auto *field = loader_.get_field(name);
+  TI_ERROR_IF(field == nullptr, "Field {} is not in the AOT module", name);
+  return *field;
+}
+
+}  // namespace vulkan
+}  // namespace lang
+}  // namespace taichi
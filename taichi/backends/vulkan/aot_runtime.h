@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "taichi/backends/vulkan/aot_module_loader_impl.h"
+#include "taichi/backends/vulkan/runtime.h"
+
+namespace taichi {
+namespace lang {
+namespace vulkan {
+
+/**
+ * Runs the kernels of an AOT module without a Program, i.e. without Python
+ * and without the compiler. The root buffers of the module are allocated up
+ * front; the pipelines of a kernel are created at its first launch.
+ */
+class AotRuntime {
+ public:
+  struct Params {
+    // The directory that AotModuleBuilderImpl::dump() wrote to.
+    std::string module_path;
+    Device *device{nullptr};
+  };
+
+  explicit AotRuntime(const Params &params);
+
+  /**
+   * Launches the kernel added as |name|. The scalar arguments are set with
+   * RuntimeContext::set_arg(). External arrays are passed as host pointers,
+   * with their shapes in RuntimeContext::extra_args, and are copied back
+   * once the launch is done.
+   */
+  void launch_kernel(const std::string &name, RuntimeContext *ctx);
+
+  /**
+   * The i-th return value of the last launch that has one.
+   */
+  template <typename T>
+  T get_ret(int i) const {
+    return taichi_union_cast_with_different_sizes<T>(host_result_buffer_[i]);
+  }
+
+  /**
+   * Copies the field added as |name| from/to |data|, in row-major order
+   * with the components of each element contiguous.
+   */
+  void read_field(const std::string &name, void *data);
+
+  void write_field(const std::string &name, const void *data);
+
+  void synchronize();
+
+  VkRuntime *get_vk_runtime() const {
+    return runtime_.get();
+  }
+
+ private:
+  const CompiledFieldData &get_field(const std::string &name) const;
+
+  Device *device_;
+  AotModuleLoaderImpl loader_;
+  std::vector<uint64> host_result_buffer_;
+  std::unique_ptr<VkRuntime> runtime_;
+  std::unordered_map<std::string, VkRuntime::KernelHandle> kernels_;
+};
+
+}  // namespace vulkan
+}  // namespace lang
+}  // namespace taichi
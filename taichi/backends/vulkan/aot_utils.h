@@ -8,6 +8,40 @@ namespace taichi {
 namespace lang {
 namespace vulkan {
 
+/**
+ * A dense field of an AOT module, laid out in its root buffer as
+ * root -> dense -> place(s).
+ */
+struct CompiledFieldData {
+  std::string field_name;
+  // A PrimitiveTypeID.
+  int dtype{0};
+  std::string dtype_name;
+  std::vector<int> shape;
+  int root_id{0};
+  // Offset of the dense cells in the root buffer, and stride between them.
+  size_t mem_offset_in_root{0};
+  size_t cell_stride{0};
+  // Offsets of the components (one for scalar fields, row_num * column_num
+  // for matrix fields) within a dense cell.
+  std::vector<size_t> member_offsets;
+  bool is_scalar{false};
+  int row_num{0};
+  int column_num{0};
+
+  TI_IO_DEF(field_name,
+            dtype,
+            dtype_name,
+            shape,
+            root_id,
+            mem_offset_in_root,
+            cell_stride,
+            member_offsets,
+            is_scalar,
+            row_num,
+            column_num);
+};
+
 /**
  * AOT module data for the vulkan backend.
  */
@@ -15,8 +49,11 @@ struct TaichiAotData {
   //   BufferMetaData metadata;
   std::vector<std::vector<std::vector<uint32_t>>> spirv_codes;
   std::vector<spirv::TaichiKernelAttributes> kernels;
+  std::vector<CompiledFieldData> fields;
+  // Sizes of the root buffers the kernels were compiled against.
+  std::vector<size_t> root_buffer_size;
 
-  TI_IO_DEF(kernels);
+  TI_IO_DEF(kernels, fields, root_buffer_size);
 };
 
 }  // namespace vulkan
@@ -1,5 +1,7 @@
 #include "taichi/backends/vulkan/runtime.h"
+#include "taichi/program/parallel_executor.h"
 #include "taichi/program/program.h"
+#include "taichi/system/timeline.h"
 
 #include <chrono>
 #include <array>
@@ -77,6 +79,10 @@ class HostDeviceContextBlitter {
       const auto dt = arg.dt;
       char *device_ptr = device_base + arg.offset_in_mem;
       do {
+        if (arg.is_texture) {
+          // Bound to the tasks, see CompiledTaichiKernel::command_list().
+          break;
+        }
         if (arg.is_array) {
           const void *host_ptr = host_ctx_->get_arg<void *>(i);
           std::memcpy(device_ptr, host_ptr, arg.stride);
@@ -118,24 +124,26 @@ class HostDeviceContextBlitter {
 #undef TO_DEVICE
   }
 
-  void device_to_host() {
+  // Whether device_to_host() has anything to copy back, i.e. whether the
+  // launch has to finish before returning to the host.
+  bool device_to_host_required() const {
     if (ctx_attribs_->empty()) {
-      return;
+      return false;
     }
-
-    bool require_sync = ctx_attribs_->rets().size() > 0;
-    if (!require_sync) {
-      for (int i = 0; i < ctx_attribs_->args().size(); ++i) {
-        const auto &arg = ctx_attribs_->args()[i];
-        if (arg.is_array) {
-          require_sync = true;
-        }
+    if (ctx_attribs_->rets().size() > 0) {
+      return true;
+    }
+    for (const auto &arg : ctx_attribs_->args()) {
+      if (arg.is_array) {
+        return true;
       }
     }
+    return false;
+  }
 
-    if (require_sync) {
-      device_->get_compute_stream()->command_sync();
-    } else {
+  // The launch must have finished.
+  void device_to_host() {
+    if (!device_to_host_required()) {
       return;
     }
 
@@ -244,7 +252,7 @@ CompiledTaichiKernel::CompiledTaichiKernel(const Params &ti_params)
       device_(ti_params.device) {
   input_buffers_[BufferType::GlobalTmps] = ti_params.global_tmps_buffer;
   input_buffers_[BufferType::ListGen] = ti_params.listgen_buffer;
-  for (int root = 0; root < ti_params.compiled_structs.size(); ++root) {
+  for (int root = 0; root < ti_params.root_buffers.size(); ++root) {
     BufferInfo buffer = {BufferType::Root, root};
     input_buffers_[buffer] = ti_params.root_buffers[root];
   }
@@ -265,13 +273,29 @@ CompiledTaichiKernel::CompiledTaichiKernel(const Params &ti_params)
   const auto &spirv_bins = ti_params.spirv_bins;
   TI_ASSERT(task_attribs.size() == spirv_bins.size());
 
-  for (int i = 0; i < task_attribs.size(); ++i) {
+  pipelines_.resize(task_attribs.size());
+  auto create_pipeline = [&](int i) {
     PipelineSourceDesc source_desc{PipelineSourceType::spirv_binary,
                                    (void *)spirv_bins[i].data(),
                                    spirv_bins[i].size() * sizeof(uint32_t)};
-    auto vp =
+    pipelines_[i] =
         ti_params.device->create_pipeline(source_desc, ti_kernel_attribs_.name);
-    pipelines_.push_back(std::move(vp));
+  };
+  // Compiling the shader modules into pipelines is most of the time of
+  // registering a kernel, and the tasks are independent (the pipeline cache
+  // is synchronized by the driver).
+  const int num_threads =
+      std::min(ti_params.num_compile_threads, (int)task_attribs.size());
+  if (num_threads > 1) {
+    ParallelExecutor workers("vk_pipeline_worker", num_threads);
+    for (int i = 0; i < task_attribs.size(); ++i) {
+      workers.enqueue([&create_pipeline, i]() { create_pipeline(i); });
+    }
+    workers.flush();
+  } else {
+    for (int i = 0; i < task_attribs.size(); ++i) {
+      create_pipeline(i);
+    }
   }
 }
 
@@ -291,7 +315,43 @@ DeviceAllocation *CompiledTaichiKernel::ctx_buffer_host() const {
   return ctx_buffer_host_.get();
 }
 
-void CompiledTaichiKernel::command_list(CommandList *cmdlist) const {
+void BufferHazardTracker::access(
+    CommandList *cmdlist,
+    const std::vector<DeviceAllocation *> &accessed,
+    const std::vector<DeviceAllocation *> &written) {
+  // RAW hazards, then WAR and WAW ones.
+  std::unordered_set<DeviceAllocation *> conflicts;
+  for (auto *alloc : accessed) {
+    if (written_.count(alloc)) {
+      conflicts.insert(alloc);
+    }
+  }
+  for (auto *alloc : written) {
+    if (accessed_.count(alloc)) {
+      conflicts.insert(alloc);
+    }
+  }
+  // The other buffers stay tracked, so that the commands which don't touch
+  // these can overlap.
+  for (auto *alloc : conflicts) {
+    cmdlist->buffer_barrier(*alloc);
+    accessed_.erase(alloc);
+    written_.erase(alloc);
+  }
+  accessed_.insert(accessed.begin(), accessed.end());
+  written_.insert(written.begin(), written.end());
+}
+
+void BufferHazardTracker::reset() {
+  accessed_.clear();
+  written_.clear();
+}
+
+void CompiledTaichiKernel::command_list(
+    CommandList *cmdlist,
+    BufferHazardTracker *tracker,
+    const RuntimeContext *host_ctx,
+    std::vector<std::string> *timed_tasks) const {
   const auto &task_attribs = ti_kernel_attribs_.tasks_attribs;
 
   for (int i = 0; i < task_attribs.size(); ++i) {
@@ -301,10 +361,34 @@ void CompiledTaichiKernel::command_list(CommandList *cmdlist) const {
                          attribs.advisory_num_threads_per_group - 1) /
                         attribs.advisory_num_threads_per_group;
     ResourceBinder *binder = vp->resource_binder();
+    std::vector<DeviceAllocation *> accessed, written;
     for (auto &bind : attribs.buffer_binds) {
       DeviceAllocation *alloc = input_buffers_.at(bind.buffer);
       if (alloc) {
         binder->rw_buffer(0, bind.binding, *alloc);
+        if (attribs.accessed_buffers.empty()) {
+          // No access info, e.g. from an older AOT module. Assume the worst.
+          accessed.push_back(alloc);
+          written.push_back(alloc);
+        }
+      }
+    }
+    for (const auto &bind : attribs.texture_binds) {
+      // The textures stay in the layout read by the shaders, see Texture.
+      const auto *texture = reinterpret_cast<const DeviceAllocation *>(
+          host_ctx->args[bind.arg_id]);
+      ImageSamplerConfig sampler_config;
+      sampler_config.address_mode = ImageSamplerAddressMode::clamp_to_edge;
+      binder->image(0, bind.binding, *texture, sampler_config);
+    }
+    for (const auto &buffer : attribs.accessed_buffers) {
+      if (auto *alloc = input_buffers_.at(buffer)) {
+        accessed.push_back(alloc);
+      }
+    }
+    for (const auto &buffer : attribs.written_buffers) {
+      if (auto *alloc = input_buffers_.at(buffer)) {
+        written.push_back(alloc);
       }
     }
 
@@ -312,22 +396,31 @@ void CompiledTaichiKernel::command_list(CommandList *cmdlist) const {
       for (auto &bind : attribs.buffer_binds) {
         if (bind.buffer.type == BufferType::ListGen) {
           // FIXME: properlly support multiple list
-          cmdlist->buffer_fill(input_buffers_.at(bind.buffer)->get_ptr(0),
-                               kListGenBufferSize,
+          auto *listgen_buffer = input_buffers_.at(bind.buffer);
+          tracker->access(cmdlist, {listgen_buffer}, {listgen_buffer});
+          cmdlist->buffer_fill(listgen_buffer->get_ptr(0), kListGenBufferSize,
                                /*data=*/0);
-          cmdlist->buffer_barrier(*input_buffers_.at(bind.buffer));
         }
       }
     }
 
+    tracker->access(cmdlist, accessed, written);
     cmdlist->bind_pipeline(vp);
     cmdlist->bind_resources(binder);
+    if (timed_tasks) {
+      cmdlist->write_timestamp(2 * timed_tasks->size());
+    }
     cmdlist->dispatch(group_x);
-    cmdlist->memory_barrier();
+    if (timed_tasks) {
+      cmdlist->write_timestamp(2 * timed_tasks->size() + 1);
+      timed_tasks->push_back(attribs.name);
+    }
   }
 
   const auto ctx_sz = ti_kernel_attribs_.ctx_attribs.total_bytes();
   if (!ti_kernel_attribs_.ctx_attribs.empty()) {
+    tracker->access(cmdlist, {ctx_buffer_.get(), ctx_buffer_host_.get()},
+                    {ctx_buffer_host_.get()});
     cmdlist->buffer_copy(ctx_buffer_host_->get_ptr(0), ctx_buffer_->get_ptr(0),
                          ctx_sz);
     cmdlist->buffer_barrier(*ctx_buffer_host_);
@@ -335,8 +428,13 @@ void CompiledTaichiKernel::command_list(CommandList *cmdlist) const {
 }
 
 VkRuntime::VkRuntime(const Params &params)
-    : device_(params.device), host_result_buffer_(params.host_result_buffer) {
+    : device_(params.device),
+      host_result_buffer_(params.host_result_buffer),
+      profiler_(params.profiler),
+      num_compile_threads_(params.num_compile_threads) {
   TI_ASSERT(host_result_buffer_ != nullptr);
+  TI_WARN_IF(profiler_ && device_->get_num_timestamps() == 0,
+             "The device has no GPU timer, kernels are not profiled");
   init_buffers();
 }
 
@@ -365,6 +463,8 @@ void VkRuntime::destroy_snode_tree(SNodeTree *snode_tree) {
   if (root_id == -1) {
     TI_ERROR("the tree to be destroyed cannot be found");
   }
+  // The recorded launches may still use the buffer.
+  synchronize();
   root_buffers_[root_id].reset();
 }
 
@@ -385,6 +485,7 @@ VkRuntime::KernelHandle VkRuntime::register_taichi_kernel(
   }
   params.global_tmps_buffer = global_tmps_buffer_.get();
   params.listgen_buffer = listgen_buffer_.get();
+  params.num_compile_threads = num_compile_threads_;
 
   for (int i = 0; i < reg_params.task_spirv_source_codes.size(); ++i) {
     const auto &spirv_src = reg_params.task_spirv_source_codes[i];
@@ -407,29 +508,72 @@ void VkRuntime::launch_kernel(KernelHandle handle, RuntimeContext *host_ctx) {
       ti_kernel->ctx_buffer_host());
   if (ctx_blitter) {
     TI_ASSERT(ti_kernel->ctx_buffer() != nullptr);
+    if (kernels_in_flight_.count(ti_kernel)) {
+      // An earlier launch of the same kernel still needs the context buffer.
+      synchronize();
+    }
     ctx_blitter->host_to_device();
+    kernels_in_flight_.insert(ti_kernel);
+  }
+
+  const int num_tasks = ti_kernel->ti_kernel_attribs().tasks_attribs.size();
+  const uint32_t num_timestamps = device_->get_num_timestamps();
+  const bool timed =
+      (profiler_ || Timelines::get_instance().get_enabled()) &&
+      2 * num_tasks <= num_timestamps;
+  if (timed && 2 * (timed_tasks_.size() + num_tasks) > num_timestamps) {
+    synchronize();
   }
 
+  // Consecutive launches go into the same command list, which is submitted
+  // once the host needs the results.
   if (!current_cmdlist_) {
     current_cmdlist_ = device_->get_compute_stream()->new_command_list();
   }
 
-  ti_kernel->command_list(current_cmdlist_.get());
+  ti_kernel->command_list(current_cmdlist_.get(), &hazard_tracker_, host_ctx,
+                          timed ? &timed_tasks_ : nullptr);
 
-  if (ctx_blitter) {
-    device_->get_compute_stream()->submit(current_cmdlist_.get());
+  if (ctx_blitter && ctx_blitter->device_to_host_required()) {
+    synchronize();
     ctx_blitter->device_to_host();
-
-    current_cmdlist_ = nullptr;
   }
 }
 
 void VkRuntime::synchronize() {
+  const float64 submit_time = Time::get_time();
   if (current_cmdlist_) {
     device_->get_compute_stream()->submit(current_cmdlist_.get());
     current_cmdlist_ = nullptr;
   }
   device_->get_compute_stream()->command_sync();
+  hazard_tracker_.reset();
+  kernels_in_flight_.clear();
+  if (!timed_tasks_.empty()) {
+    record_timed_tasks(submit_time);
+  }
+}
+
+void VkRuntime::record_timed_tasks(float64 submit_time) {
+  const int n = timed_tasks_.size();
+  auto timestamps = device_->get_timestamps(0, 2 * n);
+  // The device clock is not the host one, so the first task is placed at the
+  // submission, which it cannot precede.
+  const uint64_t base = timestamps[0];
+  const bool timeline_enabled = Timelines::get_instance().get_enabled();
+  auto &timeline = Timeline::get_this_thread_instance();
+  for (int i = 0; i < n; i++) {
+    const uint64_t begin = timestamps[2 * i] - base;
+    const uint64_t end = timestamps[2 * i + 1] - base;
+    if (profiler_) {
+      profiler_->insert_record(timed_tasks_[i], (end - begin) * 1e-6);
+    }
+    if (timeline_enabled) {
+      timeline.insert_span(timed_tasks_[i], submit_time + begin * 1e-9,
+                           submit_time + end * 1e-9, "vulkan");
+    }
+  }
+  timed_tasks_.clear();
 }
 
 Device *VkRuntime::get_ti_device() const {
@@ -462,11 +606,13 @@ void VkRuntime::add_root_buffer(size_t root_buffer_size) {
   if (root_buffer_size == 0) {
     root_buffer_size = 4;  // there might be empty roots
   }
+  // GGUI binds the fields as vertex and index buffers without copying them.
   std::unique_ptr<DeviceAllocationGuard> new_buffer =
       device_->allocate_memory_unique(
           {root_buffer_size,
            /*host_write=*/false, /*host_read=*/false,
-           /*export_sharing=*/false, AllocUsage::Storage});
+           /*export_sharing=*/false,
+           AllocUsage::Storage | AllocUsage::Vertex | AllocUsage::Index});
   Stream *stream = device_->get_compute_stream();
   auto cmdlist = stream->new_command_list();
   cmdlist->buffer_fill(new_buffer->get_ptr(0), root_buffer_size, /*data=*/0);
@@ -492,6 +638,7 @@ VkRuntime::RegisterParams run_codegen(
   params.device = device;
   params.enable_spv_opt =
       kernel->program->config.external_optimization_level > 0;
+  params.num_compile_threads = kernel->program->config.num_compile_threads;
   spirv::KernelCodegen codegen(params);
   VkRuntime::RegisterParams res;
   codegen.run(res.kernel_attribs, res.task_spirv_source_codes);
@@ -1,6 +1,7 @@
 #pragma once
 #include "taichi/lang_util.h"
 
+#include <unordered_set>
 #include <vector>
 
 #include "taichi/backends/device.h"
@@ -8,6 +9,7 @@
 #include "taichi/codegen/spirv/kernel_utils.h"
 #include "taichi/codegen/spirv/spirv_codegen.h"
 #include "taichi/program/compile_config.h"
+#include "taichi/program/kernel_profiler.h"
 #include "taichi/struct/snode_tree.h"
 #include "taichi/program/snode_expr_utils.h"
 
@@ -27,6 +29,30 @@ using BufferInfoHasher = TaskAttributes::BufferInfoHasher;
 using InputBuffersMap =
     std::unordered_map<BufferInfo, DeviceAllocation *, BufferInfoHasher>;
 
+/**
+ * Tracks the buffers accessed by the commands recorded since their last
+ * barrier, so that a buffer barrier is only recorded in front of a command
+ * that has a hazard on that buffer.
+ */
+class BufferHazardTracker {
+ public:
+  /**
+   * Records barriers into |cmdlist| for the buffers on which the next command
+   * conflicts with the earlier ones. The command accesses |accessed|, and
+   * writes to the subset |written| of those.
+   */
+  void access(CommandList *cmdlist,
+              const std::vector<DeviceAllocation *> &accessed,
+              const std::vector<DeviceAllocation *> &written);
+
+  // E.g. after the host waited for the device to be idle.
+  void reset();
+
+ private:
+  std::unordered_set<DeviceAllocation *> accessed_;
+  std::unordered_set<DeviceAllocation *> written_;
+};
+
 class CompiledTaichiKernel {
  public:
   struct Params {
@@ -38,6 +64,8 @@ class CompiledTaichiKernel {
     std::vector<DeviceAllocation *> root_buffers;
     DeviceAllocation *global_tmps_buffer{nullptr};
     DeviceAllocation *listgen_buffer{nullptr};
+    // The pipelines of the tasks are created on up to this many threads.
+    int num_compile_threads{1};
   };
 
   CompiledTaichiKernel(const Params &ti_params);
@@ -50,7 +78,13 @@ class CompiledTaichiKernel {
 
   DeviceAllocation *ctx_buffer_host() const;
 
-  void command_list(CommandList *cmdlist) const;
+  // Unless |timed_tasks| is null, each task is timed between a pair of device
+  // timestamps, and its name appended to |timed_tasks|, see VkRuntime. The
+  // textures are taken from the args of |host_ctx|.
+  void command_list(CommandList *cmdlist,
+                    BufferHazardTracker *tracker,
+                    const RuntimeContext *host_ctx,
+                    std::vector<std::string> *timed_tasks = nullptr) const;
 
  private:
   TaichiKernelAttributes ti_kernel_attribs_;
@@ -70,6 +104,8 @@ class VkRuntime {
   struct Params {
     uint64_t *host_result_buffer{nullptr};
     Device *device{nullptr};
+    KernelProfilerBase *profiler{nullptr};
+    int num_compile_threads{1};
   };
 
   explicit VkRuntime(const Params &params);
@@ -93,6 +129,10 @@ class VkRuntime {
 
   void materialize_snode_tree(SNodeTree *tree);
 
+  // Adds a zero-filled root buffer without an SNodeTree, e.g. for the root
+  // buffers of an AOT module.
+  void add_root_buffer(size_t root_buffer_size);
+
   void destroy_snode_tree(SNodeTree *snode_tree);
 
   void synchronize();
@@ -105,7 +145,10 @@ class VkRuntime {
 
  private:
   void init_buffers();
-  void add_root_buffer(size_t root_buffer_size);
+
+  // Adds the timed tasks to the kernel profiler and the timeline, once they
+  // are done.
+  void record_timed_tasks(float64 submit_time);
 
   Device *device_;
 
@@ -116,7 +159,16 @@ class VkRuntime {
   // FIXME: Support proper multiple lists
   std::unique_ptr<DeviceAllocationGuard> listgen_buffer_;
 
+  // The launches since the last synchronize() are recorded here.
   std::unique_ptr<CommandList> current_cmdlist_{nullptr};
+  BufferHazardTracker hazard_tracker_;
+  // The kernels whose context buffers are used by the recorded launches.
+  std::unordered_set<const CompiledTaichiKernel *> kernels_in_flight_;
+  KernelProfilerBase *const profiler_;
+  const int num_compile_threads_;
+  // The recorded tasks timed for the profiler or the timeline, the i-th one
+  // between the device timestamps 2i and 2i + 1.
+  std::vector<std::string> timed_tasks_;
 
   std::vector<std::unique_ptr<CompiledTaichiKernel>> ti_kernels_;
 
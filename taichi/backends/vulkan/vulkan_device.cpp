@@ -13,6 +13,7 @@
 #include "taichi/backends/vulkan/vulkan_loader.h"
 #include "taichi/backends/vulkan/vulkan_device.h"
 #include "taichi/common/logging.h"
+#include "taichi/system/device_memory_tracker.h"
 
 #include "spirv_reflect.h"
 
@@ -287,7 +288,7 @@ void VulkanPipeline::create_pipeline_layout() {
 
 void VulkanPipeline::create_compute_pipeline(const Params &params) {
   pipeline_ = vkapi::create_compute_pipeline(device_, 0, shader_stages_[0],
-                                             pipeline_layout_);
+                                             pipeline_layout_, params.cache);
 }
 
 void VulkanPipeline::create_graphics_pipeline(
@@ -445,47 +446,12 @@ VulkanResourceBinder::VulkanResourceBinder(VkPipelineBindPoint bind_point)
 }
 
 VulkanResourceBinder::~VulkanResourceBinder() {
-  for (auto &set_pair : sets_) {
-    Set &set = set_pair.second;
-    for (auto &binding_pair : set.bindings) {
-      VkSampler sampler = binding_pair.second.sampler;
-      if (sampler != VK_NULL_HANDLE) {
-        Device *dev = binding_pair.second.ptr.device;
-        vkDestroySampler(static_cast<VulkanDevice *>(dev)->vk_device(), sampler,
-                         kNoVkAllocCallbacks);
-      }
-    }
-  }
 }
 
 std::unique_ptr<ResourceBinder::Bindings> VulkanResourceBinder::materialize() {
   return std::unique_ptr<Bindings>();
 }
 
-VkSampler create_sampler(ImageSamplerConfig config, VkDevice device) {
-  VkSampler sampler = VK_NULL_HANDLE;
-
-  // todo: fill these using the information from the ImageSamplerConfig
-  VkSamplerCreateInfo sampler_info{};
-  sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-  sampler_info.magFilter = VK_FILTER_LINEAR;
-  sampler_info.minFilter = VK_FILTER_LINEAR;
-  sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-  sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-  sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-  sampler_info.anisotropyEnable = VK_FALSE;
-  sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-  sampler_info.unnormalizedCoordinates = VK_FALSE;
-  sampler_info.compareEnable = VK_FALSE;
-  sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
-  sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-
-  if (vkCreateSampler(device, &sampler_info, nullptr, &sampler) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create texture sampler!");
-  }
-  return sampler;
-}
-
 #define CHECK_SET_BINDINGS                                          \
   bool set_not_found = (sets_.find(set) == sets_.end());            \
   if (set_not_found) {                                              \
@@ -557,17 +523,13 @@ void VulkanResourceBinder::image(uint32_t set,
       TI_WARN("Overriding last binding");
     }
   }
-  if (bindings[binding].sampler != VK_NULL_HANDLE) {
-    Device *dev = bindings[binding].ptr.device;
-    vkDestroySampler(static_cast<VulkanDevice *>(dev)->vk_device(),
-                     bindings[binding].sampler, kNoVkAllocCallbacks);
-  }
   bindings[binding] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
                        alloc.get_ptr(0), VK_WHOLE_SIZE};
   if (alloc.device) {
+    // The samplers are owned by the device, since the command lists recorded
+    // with this binding may still be in flight when it is replaced.
     VulkanDevice *device = static_cast<VulkanDevice *>(alloc.device);
-    bindings[binding].sampler =
-        create_sampler(sampler_config, device->vk_device());
+    bindings[binding].sampler = device->get_sampler(sampler_config);
   }
 }
 
@@ -792,6 +754,39 @@ void VulkanCommandList::buffer_barrier(DeviceAllocation alloc) {
   buffer_barrier(DevicePtr{alloc, 0}, VK_WHOLE_SIZE);
 }
 
+void VulkanCommandList::vertex_buffer_barrier(DevicePtr ptr, size_t size) {
+  TI_ASSERT(ptr.device == ti_device_);
+
+  auto buffer = ti_device_->get_vkbuffer(ptr);
+
+  VkBufferMemoryBarrier barrier;
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.pNext = nullptr;
+  barrier.buffer = buffer->buffer;
+  barrier.offset = ptr.offset;
+  barrier.size = size;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.srcAccessMask =
+      (VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+  barrier.dstAccessMask =
+      (VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+       VK_ACCESS_SHADER_READ_BIT);
+
+  vkCmdPipelineBarrier(
+      buffer_->buffer,
+      /*srcStageMask=*/
+      VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      /*dstStageMask=*/VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+          VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+      /*srcStageMask=*/0, /*memoryBarrierCount=*/0, nullptr,
+      /*bufferMemoryBarrierCount=*/1,
+      /*pBufferMemoryBarriers=*/&barrier,
+      /*imageMemoryBarrierCount=*/0,
+      /*pImageMemoryBarriers=*/nullptr);
+  buffer_->refs.push_back(buffer);
+}
+
 void VulkanCommandList::memory_barrier() {
   VkMemoryBarrier barrier;
   barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
@@ -839,6 +834,14 @@ void VulkanCommandList::dispatch(uint32_t x, uint32_t y, uint32_t z) {
   vkCmdDispatch(buffer_->buffer, x, y, z);
 }
 
+void VulkanCommandList::write_timestamp(uint32_t index) {
+  VkQueryPool pool = ti_device_->timestamp_pool();
+  TI_ASSERT(pool != VK_NULL_HANDLE);
+  vkCmdResetQueryPool(buffer_->buffer, pool, index, 1);
+  vkCmdWriteTimestamp(buffer_->buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                      pool, index);
+}
+
 vkapi::IVkCommandBuffer VulkanCommandList::vk_command_buffer() {
   return buffer_;
 }
@@ -1134,6 +1137,17 @@ void VulkanDevice::init_vulkan_structs(Params &params) {
   compute_queue_family_index_ = params.compute_queue_family_index;
   graphics_queue_ = params.graphics_queue;
   graphics_queue_family_index_ = params.graphics_queue_family_index;
+  transfer_queue_ = params.transfer_queue;
+  transfer_queue_family_index_ = params.transfer_queue_family_index;
+
+  if (transfer_queue_ != VK_NULL_HANDLE) {
+    // Buffers are shared with the transfer queue without ownership transfers.
+    buffer_queue_families_ = {compute_queue_family_index_,
+                              transfer_queue_family_index_};
+    if (graphics_queue_family_index_ != compute_queue_family_index_) {
+      buffer_queue_families_.push_back(graphics_queue_family_index_);
+    }
+  }
 
   create_vma_allocator();
   new_descriptor_pool();
@@ -1143,10 +1157,22 @@ VulkanDevice::~VulkanDevice() {
   vkDeviceWaitIdle(device_);
 
   desc_pool_ = nullptr;
+  pipeline_cache_ = nullptr;
+
+  for (auto &[mode, sampler] : samplers_) {
+    vkDestroySampler(device_, sampler, kNoVkAllocCallbacks);
+  }
+  samplers_.clear();
 
   framebuffer_pools_.clear();
   renderpass_pools_.clear();
 
+  if (timestamp_pool_ != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(device_, timestamp_pool_, kNoVkAllocCallbacks);
+  }
+
+  staging_cache_.clear();
+
   vmaDestroyAllocator(allocator_);
   vmaDestroyAllocator(allocator_export_);
 }
@@ -1166,10 +1192,43 @@ std::unique_ptr<Pipeline> VulkanDevice::create_pipeline(
   params.code = {code};
   params.device = this;
   params.name = name;
+  params.cache = pipeline_cache_;
 
   return std::make_unique<VulkanPipeline>(params);
 }
 
+void VulkanDevice::init_pipeline_cache(const std::vector<uint8_t> &data) {
+  pipeline_cache_ = vkapi::create_pipeline_cache(
+      device_, /*flags=*/0, data.size(), data.empty() ? nullptr : data.data());
+}
+
+std::vector<uint8_t> VulkanDevice::get_pipeline_cache_data() const {
+  std::vector<uint8_t> data;
+  if (!pipeline_cache_) {
+    return data;
+  }
+  size_t size = 0;
+  vkGetPipelineCacheData(device_, pipeline_cache_->cache, &size, nullptr);
+  data.resize(size);
+  if (vkGetPipelineCacheData(device_, pipeline_cache_->cache, &size,
+                             data.data()) != VK_SUCCESS) {
+    data.clear();
+  }
+  data.resize(size);
+  return data;
+}
+
+std::string VulkanDevice::get_device_cache_key() const {
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physical_device_, &properties);
+  std::string key = fmt::format("{:08x}_{:08x}_{:08x}_", properties.vendorID,
+                                properties.deviceID, properties.driverVersion);
+  for (int i = 0; i < VK_UUID_SIZE; i++) {
+    key += fmt::format("{:02x}", properties.pipelineCacheUUID[i]);
+  }
+  return key;
+}
+
 // #define TI_VULKAN_DEBUG_ALLOCATIONS
 
 DeviceAllocation VulkanDevice::allocate_memory(const AllocParams &params) {
@@ -1178,13 +1237,36 @@ DeviceAllocation VulkanDevice::allocate_memory(const AllocParams &params) {
   handle.device = this;
   handle.alloc_id = alloc_cnt_++;
 
+  if (params.host_read || params.host_write) {
+    for (auto it = staging_cache_.begin(); it != staging_cache_.end(); ++it) {
+      const AllocParams &p = it->params;
+      if (p.size == params.size && p.host_read == params.host_read &&
+          p.host_write == params.host_write &&
+          p.export_sharing == params.export_sharing &&
+          p.usage == params.usage) {
+        staging_cache_bytes_ -= p.size;
+        allocations_[handle.alloc_id] = std::move(*it);
+        staging_cache_.erase(it);
+        DeviceMemoryTracker::get_instance().record_allocation(
+            this, handle.alloc_id, params.size);
+        return handle;
+      }
+    }
+  }
+
   allocations_[handle.alloc_id] = {};
   AllocationInternal &alloc = allocations_[handle.alloc_id];
+  alloc.params = params;
 
   VkBufferCreateInfo buffer_info{};
   buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   buffer_info.pNext = nullptr;
   buffer_info.size = params.size;
+  if (!buffer_queue_families_.empty()) {
+    buffer_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+    buffer_info.queueFamilyIndexCount = buffer_queue_families_.size();
+    buffer_info.pQueueFamilyIndices = buffer_queue_families_.data();
+  }
   // FIXME: How to express this in a backend-neutral way?
   buffer_info.usage =
       VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
@@ -1256,6 +1338,8 @@ DeviceAllocation VulkanDevice::allocate_memory(const AllocParams &params) {
            handle.alloc_id);
 #endif
 
+  DeviceMemoryTracker::get_instance().record_allocation(this, handle.alloc_id,
+                                                        params.size);
   return handle;
 }
 
@@ -1272,7 +1356,21 @@ void VulkanDevice::dealloc_memory(DeviceAllocation handle) {
            handle.alloc_id);
 #endif
 
+  const AllocParams &params = alloc.params;
+  if ((params.host_read || params.host_write) && !params.export_sharing &&
+      alloc.mapped == nullptr && params.size <= kStagingCacheBytes) {
+    staging_cache_bytes_ += params.size;
+    staging_cache_.push_front(std::move(alloc));
+    while (staging_cache_bytes_ > kStagingCacheBytes) {
+      staging_cache_bytes_ -= staging_cache_.back().params.size;
+      staging_cache_.pop_back();
+    }
+  }
+
   allocations_.erase(handle.alloc_id);
+  // The staging buffers kept for reuse are not counted.
+  DeviceMemoryTracker::get_instance().record_deallocation(this,
+                                                          handle.alloc_id);
 }
 
 void *VulkanDevice::map_range(DevicePtr ptr, uint64_t size) {
@@ -1319,10 +1417,21 @@ void VulkanDevice::unmap(DeviceAllocation alloc) {
   alloc_int.mapped = nullptr;
 }
 
+bool VulkanDevice::is_host_writable(DeviceAllocation alloc) {
+  AllocationInternal &alloc_int = allocations_.at(alloc.alloc_id);
+  VkMemoryPropertyFlags flags;
+  vmaGetMemoryTypeProperties(alloc_int.buffer->allocator,
+                             alloc_int.alloc_info.memoryType, &flags);
+  const VkMemoryPropertyFlags required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  return (flags & required) == required;
+}
+
 void VulkanDevice::memcpy_internal(DevicePtr dst,
                                    DevicePtr src,
                                    uint64_t size) {
-  // TODO: always create a queue specifically for transfer
+  // Stays on the compute queue, which the UI relies on being ordered with the
+  // graphics queue. See get_transfer_stream().
   Stream *stream = get_compute_stream();
   std::unique_ptr<CommandList> cmd = stream->new_command_list();
   cmd->buffer_copy(dst, src, size);
@@ -1353,6 +1462,65 @@ Stream *VulkanDevice::get_graphics_stream() {
   }
 }
 
+Stream *VulkanDevice::get_transfer_stream() {
+  if (transfer_queue_ == VK_NULL_HANDLE) {
+    return get_compute_stream();
+  }
+  auto tid = std::this_thread::get_id();
+  auto iter = transfer_stream_.find(tid);
+  if (iter == transfer_stream_.end()) {
+    transfer_stream_[tid] = std::make_unique<VulkanStream>(
+        *this, transfer_queue_, transfer_queue_family_index_);
+    return transfer_stream_.at(tid).get();
+  } else {
+    return iter->second.get();
+  }
+}
+
+uint32_t VulkanDevice::get_num_timestamps() {
+  if (!timestamp_pool_inited_) {
+    timestamp_pool_inited_ = true;
+    uint32_t num_families = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device_, &num_families,
+                                             nullptr);
+    std::vector<VkQueueFamilyProperties> families(num_families);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device_, &num_families,
+                                             families.data());
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device_, &properties);
+    if (families[compute_queue_family_index_].timestampValidBits > 0 &&
+        properties.limits.timestampPeriod > 0) {
+      VkQueryPoolCreateInfo info{};
+      info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+      info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+      info.queryCount = kNumTimestamps;
+      BAIL_ON_VK_BAD_RESULT(vkCreateQueryPool(device_, &info,
+                                              kNoVkAllocCallbacks,
+                                              &timestamp_pool_),
+                            "failed to create timestamp query pool");
+      timestamp_period_ = properties.limits.timestampPeriod;
+    }
+  }
+  return timestamp_pool_ != VK_NULL_HANDLE ? kNumTimestamps : 0;
+}
+
+std::vector<uint64_t> VulkanDevice::get_timestamps(uint32_t begin,
+                                                   uint32_t count) {
+  TI_ASSERT(timestamp_pool_ != VK_NULL_HANDLE &&
+            begin + count <= kNumTimestamps);
+  std::vector<uint64_t> timestamps(count);
+  BAIL_ON_VK_BAD_RESULT(
+      vkGetQueryPoolResults(device_, timestamp_pool_, begin, count,
+                            count * sizeof(uint64_t), timestamps.data(),
+                            sizeof(uint64_t),
+                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT),
+      "failed to get timestamps");
+  for (auto &t : timestamps) {
+    t = uint64_t(t * (double)timestamp_period_);
+  }
+  return timestamps;
+}
+
 std::unique_ptr<CommandList> VulkanStream::new_command_list() {
   vkapi::IVkCommandBuffer buffer =
       vkapi::allocate_command_buffer(command_pool_);
@@ -1371,42 +1539,117 @@ void VulkanStream::submit(CommandList *cmdlist_) {
   }
   */
 
-  VkSubmitInfo submit_info{};
-  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submit_info.commandBufferCount = 1;
-  submit_info.pCommandBuffers = &buffer->buffer;
-
   submitted_cmdbuffers_.push_back(buffer);
 
-  BAIL_ON_VK_BAD_RESULT(vkQueueSubmit(queue_, /*submitCount=*/1, &submit_info,
-                                      /*fence=*/VK_NULL_HANDLE),
-                        "failed to submit command buffer");
+  submit_internal(buffer, /*fence=*/VK_NULL_HANDLE);
 }
 
 void VulkanStream::submit_synced(CommandList *cmdlist) {
   vkapi::IVkCommandBuffer buffer =
       static_cast<VulkanCommandList *>(cmdlist)->finalize();
 
-  VkSubmitInfo submit_info{};
-  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submit_info.commandBufferCount = 1;
-  submit_info.pCommandBuffers = &buffer->buffer;
-
-  BAIL_ON_VK_BAD_RESULT(vkQueueSubmit(queue_, /*submitCount=*/1, &submit_info,
-                                      /*fence=*/cmd_sync_fence_->fence),
-                        "failed to submit command buffer");
+  submit_internal(buffer, /*fence=*/cmd_sync_fence_->fence);
 
   vkWaitForFences(device_.vk_device(), 1, &cmd_sync_fence_->fence, true,
                   UINT64_MAX);
   vkResetFences(device_.vk_device(), 1, &cmd_sync_fence_->fence);
 }
 
+void VulkanStream::submit_with_fence(CommandList *cmdlist, VkFence fence) {
+  vkapi::IVkCommandBuffer buffer =
+      static_cast<VulkanCommandList *>(cmdlist)->finalize();
+
+  submit_internal(buffer, fence);
+}
+
+void VulkanStream::submit_for_present(CommandList *cmdlist,
+                                      VkSemaphore wait_semaphore,
+                                      VkSemaphore signal_semaphore,
+                                      VkFence fence) {
+  vkapi::IVkCommandBuffer buffer =
+      static_cast<VulkanCommandList *>(cmdlist)->finalize();
+
+  submit_internal(buffer, fence, wait_semaphore, signal_semaphore);
+}
+
 void VulkanStream::command_sync() {
   vkQueueWaitIdle(queue_);
 
   submitted_cmdbuffers_.clear();
 }
 
+void VulkanStream::wait_for(Stream *producer) {
+  auto *other = static_cast<VulkanStream *>(producer);
+  if (other == this || other->timeline_value_ == 0) {
+    // Nothing submitted yet.
+    return;
+  }
+  if (timeline_ && other->timeline_) {
+    pending_waits_.emplace_back(other->timeline_, other->timeline_value_);
+  } else {
+    Stream::wait_for(producer);
+  }
+}
+
+void VulkanStream::submit_internal(vkapi::IVkCommandBuffer buffer,
+                                   VkFence fence,
+                                   VkSemaphore wait_semaphore,
+                                   VkSemaphore signal_semaphore) {
+  VkSubmitInfo submit_info{};
+  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit_info.commandBufferCount = 1;
+  submit_info.pCommandBuffers = &buffer->buffer;
+
+  std::vector<VkSemaphore> wait_semaphores;
+  std::vector<uint64_t> wait_values;
+  std::vector<VkPipelineStageFlags> wait_stages;
+  std::vector<VkSemaphore> signal_semaphores;
+  std::vector<uint64_t> signal_values;
+  VkTimelineSemaphoreSubmitInfoKHR timeline_info{};
+  uint64_t signal_value = timeline_value_ + 1;
+  if (timeline_) {
+    for (auto &[semaphore, value] : pending_waits_) {
+      wait_semaphores.push_back(semaphore->semaphore);
+      wait_values.push_back(value);
+      wait_stages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    }
+    signal_semaphores.push_back(timeline_->semaphore);
+    signal_values.push_back(signal_value);
+  }
+  // The values of binary semaphores are ignored, but there has to be one per
+  // semaphore when the timeline is chained.
+  if (wait_semaphore != VK_NULL_HANDLE) {
+    wait_semaphores.push_back(wait_semaphore);
+    wait_values.push_back(0);
+    wait_stages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+  }
+  if (signal_semaphore != VK_NULL_HANDLE) {
+    signal_semaphores.push_back(signal_semaphore);
+    signal_values.push_back(0);
+  }
+  if (timeline_) {
+    timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+    timeline_info.waitSemaphoreValueCount = wait_values.size();
+    timeline_info.pWaitSemaphoreValues = wait_values.data();
+    timeline_info.signalSemaphoreValueCount = signal_values.size();
+    timeline_info.pSignalSemaphoreValues = signal_values.data();
+    submit_info.pNext = &timeline_info;
+  }
+  submit_info.waitSemaphoreCount = wait_semaphores.size();
+  submit_info.pWaitSemaphores = wait_semaphores.data();
+  submit_info.pWaitDstStageMask = wait_stages.data();
+  submit_info.signalSemaphoreCount = signal_semaphores.size();
+  submit_info.pSignalSemaphores = signal_semaphores.data();
+
+  BAIL_ON_VK_BAD_RESULT(
+      vkQueueSubmit(queue_, /*submitCount=*/1, &submit_info, fence),
+      "failed to submit command buffer");
+
+  // Without timeline semaphores this only tells wait_for() that there's work.
+  timeline_value_ = signal_value;
+  pending_waits_.clear();
+}
+
 std::unique_ptr<Pipeline> VulkanDevice::create_raster_pipeline(
     const std::vector<PipelineSourceDesc> &src,
     const RasterParams &raster_params,
@@ -1739,6 +1982,39 @@ vkapi::IVkDescriptorSetLayout VulkanDevice::get_desc_set_layout(
   }
 }
 
+VkSampler VulkanDevice::get_sampler(const ImageSamplerConfig &config) {
+  std::lock_guard<std::mutex> lock(samplers_mut_);
+  auto it = samplers_.find(config.address_mode);
+  if (it != samplers_.end()) {
+    return it->second;
+  }
+
+  const VkSamplerAddressMode address_mode =
+      config.address_mode == ImageSamplerAddressMode::clamp_to_edge
+          ? VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE
+          : VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  VkSamplerCreateInfo sampler_info{};
+  sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  sampler_info.magFilter = VK_FILTER_LINEAR;
+  sampler_info.minFilter = VK_FILTER_LINEAR;
+  sampler_info.addressModeU = address_mode;
+  sampler_info.addressModeV = address_mode;
+  sampler_info.addressModeW = address_mode;
+  sampler_info.anisotropyEnable = VK_FALSE;
+  sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+  sampler_info.unnormalizedCoordinates = VK_FALSE;
+  sampler_info.compareEnable = VK_FALSE;
+  sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
+  sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+
+  VkSampler sampler = VK_NULL_HANDLE;
+  BAIL_ON_VK_BAD_RESULT(
+      vkCreateSampler(device_, &sampler_info, kNoVkAllocCallbacks, &sampler),
+      "failed to create texture sampler");
+  samplers_[config.address_mode] = sampler;
+  return sampler;
+}
+
 vkapi::IVkDescriptorSet VulkanDevice::alloc_desc_set(
     vkapi::IVkDescriptorSetLayout layout) {
   // TODO: Currently we assume the calling code has called get_desc_set_layout
@@ -1908,8 +2184,19 @@ VulkanSurface::VulkanSurface(VulkanDevice *device, const SurfaceConfig &config)
     sema_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
     sema_create_info.pNext = nullptr;
     sema_create_info.flags = 0;
-    vkCreateSemaphore(device->vk_device(), &sema_create_info,
-                      kNoVkAllocCallbacks, &image_available_);
+    // Signaled, so that the first wait on each frame returns immediately.
+    VkFenceCreateInfo fence_create_info{};
+    fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    frames_.resize(std::max(config.frames_in_flight, 1u));
+    for (auto &frame : frames_) {
+      vkCreateSemaphore(device->vk_device(), &sema_create_info,
+                        kNoVkAllocCallbacks, &frame.image_available);
+      vkCreateSemaphore(device->vk_device(), &sema_create_info,
+                        kNoVkAllocCallbacks, &frame.render_finished);
+      vkCreateFence(device->vk_device(), &fence_create_info,
+                    kNoVkAllocCallbacks, &frame.in_flight);
+    }
   } else {
     ImageParams params = {ImageDimension::d2D,
                           BufferFormat::rgba8,
@@ -1918,6 +2205,7 @@ VulkanSurface::VulkanSurface(VulkanDevice *device, const SurfaceConfig &config)
                           config.height,
                           1,
                           false};
+    image_format_ = params.format;
     // screenshot_image_ = device->create_image(params);
     swapchain_images_.push_back(device->create_image(params));
     swapchain_images_.push_back(device->create_image(params));
@@ -1983,7 +2271,15 @@ void VulkanSurface::create_swap_chain() {
   createInfo.pNext = nullptr;
   createInfo.flags = 0;
   createInfo.surface = surface_;
-  createInfo.minImageCount = capabilities.minImageCount;
+  // One image more than the frames in flight, so that acquiring the image for
+  // the next frame does not wait for the presentation of the previous ones,
+  // e.g. triple buffering with the default of two frames in flight.
+  uint32_t image_count = std::max(capabilities.minImageCount,
+                                  config_.frames_in_flight + 1);
+  if (capabilities.maxImageCount > 0) {
+    image_count = std::min(image_count, capabilities.maxImageCount);
+  }
+  createInfo.minImageCount = image_count;
   createInfo.imageFormat = surface_format.format;
   createInfo.imageColorSpace = surface_format.colorSpace;
   createInfo.imageExtent = extent;
@@ -2055,8 +2351,14 @@ int VulkanSurface::get_image_count() {
 
 VulkanSurface::~VulkanSurface() {
   if (config_.window_handle) {
+    vkDeviceWaitIdle(device_->vk_device());
     destroy_swap_chain();
-    vkDestroySemaphore(device_->vk_device(), image_available_, nullptr);
+    for (auto &frame : frames_) {
+      vkDestroySemaphore(device_->vk_device(), frame.image_available, nullptr);
+      vkDestroySemaphore(device_->vk_device(), frame.render_finished, nullptr);
+      vkDestroyFence(device_->vk_device(), frame.in_flight, nullptr);
+    }
+    frames_.clear();
     vkDestroySurfaceKHR(device_->vk_instance(), surface_, nullptr);
   } else {
     for (auto &img : swapchain_images_) {
@@ -2070,6 +2372,8 @@ VulkanSurface::~VulkanSurface() {
 }
 
 void VulkanSurface::resize(uint32_t width, uint32_t height) {
+  // The frames in flight may still render to the old images.
+  vkDeviceWaitIdle(device_->vk_device());
   destroy_swap_chain();
   create_swap_chain();
 }
@@ -2087,31 +2391,62 @@ DeviceAllocation VulkanSurface::get_target_image() {
   if (!config_.window_handle) {
     image_index_ = (image_index_ + 1) % swapchain_images_.size();
   } else {
+    // Waits for the frame that used these semaphores |frames_.size()| frames
+    // ago, which bounds how far rendering runs ahead of presentation.
+    Frame &frame = frames_[frame_index_];
+    vkWaitForFences(device_->vk_device(), 1, &frame.in_flight, VK_TRUE,
+                    UINT64_MAX);
+    frame.cmdlist = nullptr;
     vkAcquireNextImageKHR(device_->vk_device(), swapchain_, UINT64_MAX,
-                          image_available_, VK_NULL_HANDLE, &image_index_);
+                          frame.image_available, VK_NULL_HANDLE,
+                          &image_index_);
   }
 
   return swapchain_images_[image_index_];
 }
 
+void VulkanSurface::submit_frame(std::unique_ptr<CommandList> cmdlist) {
+  auto *stream = static_cast<VulkanStream *>(device_->get_graphics_stream());
+  if (!config_.window_handle) {
+    stream->submit_synced(cmdlist.get());
+    return;
+  }
+  Frame &frame = frames_[frame_index_];
+  vkResetFences(device_->vk_device(), 1, &frame.in_flight);
+  stream->submit_for_present(cmdlist.get(), frame.image_available,
+                             frame.render_finished, frame.in_flight);
+  frame.cmdlist = std::move(cmdlist);
+  last_frame_ = &frame;
+}
+
+void VulkanSurface::wait_for_last_frame() {
+  if (last_frame_) {
+    vkWaitForFences(device_->vk_device(), 1, &last_frame_->in_flight, VK_TRUE,
+                    UINT64_MAX);
+  }
+}
+
 BufferFormat VulkanSurface::image_format() {
   return image_format_;
 }
 
 void VulkanSurface::present_image() {
-  // TODO: In the future tie the wait semaphores.
-  // Currently we should just halt and wait on host before present
-  vkDeviceWaitIdle(device_->vk_device());
+  if (!config_.window_handle) {
+    return;
+  }
+  // Presents once the frame is rendered, without waiting for it on the host.
+  Frame &frame = frames_[frame_index_];
   VkPresentInfoKHR presentInfo{};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
   presentInfo.waitSemaphoreCount = 1;
-  presentInfo.pWaitSemaphores = &image_available_;
+  presentInfo.pWaitSemaphores = &frame.render_finished;
   presentInfo.swapchainCount = 1;
   presentInfo.pSwapchains = &swapchain_;
   presentInfo.pImageIndices = &image_index_;
   presentInfo.pResults = nullptr;
 
   vkQueuePresentKHR(device_->graphics_queue(), &presentInfo);
+  frame_index_ = (frame_index_ + 1) % frames_.size();
 }
 
 DeviceAllocation VulkanSurface::get_image_data() {
@@ -2178,6 +2513,26 @@ DeviceAllocation VulkanSurface::get_image_data() {
   return screenshot_buffer_;
 }
 
+std::unique_ptr<CommandList> VulkanSurface::copy_image_data(DevicePtr dst,
+                                                            VkFence fence) {
+  auto *stream = static_cast<VulkanStream *>(device_->get_graphics_stream());
+  DeviceAllocation img_alloc = swapchain_images_[image_index_];
+  auto [w, h] = get_size();
+
+  BufferImageCopyParams copy_params;
+  copy_params.image_extent.x = w;
+  copy_params.image_extent.y = h;
+  auto cmd_list = stream->new_command_list();
+  cmd_list->image_transition(img_alloc, ImageLayout::present_src,
+                             ImageLayout::transfer_src);
+  cmd_list->image_to_buffer(dst, img_alloc, ImageLayout::transfer_src,
+                            copy_params);
+  cmd_list->image_transition(img_alloc, ImageLayout::transfer_src,
+                             ImageLayout::present_src);
+  stream->submit_with_fence(cmd_list.get(), fence);
+  return cmd_list;
+}
+
 VulkanStream::VulkanStream(VulkanDevice &device,
                            VkQueue queue,
                            uint32_t queue_family_index)
@@ -2187,6 +2542,14 @@ VulkanStream::VulkanStream(VulkanDevice &device,
       queue_family_index);
 
   cmd_sync_fence_ = vkapi::create_fence(device_.vk_device(), 0);
+
+  if (device_.get_cap(DeviceCapability::vk_has_timeline_semaphore)) {
+    VkSemaphoreTypeCreateInfoKHR type_info{};
+    type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+    type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+    type_info.initialValue = 0;
+    timeline_ = vkapi::create_semaphore(device_.vk_device(), 0, &type_info);
+  }
 }
 
 VulkanStream::~VulkanStream() {
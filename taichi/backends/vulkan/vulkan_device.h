@@ -6,7 +6,9 @@
 
 #include <GLFW/glfw3.h>
 
+#include <list>
 #include <memory>
+#include <mutex>
 #include <optional>
 
 #include <taichi/backends/device.h>
@@ -196,6 +198,8 @@ class VulkanPipeline : public Pipeline {
     VulkanDevice *device{nullptr};
     std::vector<SpirvCodeView> code;
     std::string name{"Pipeline"};
+    // Optional, speeds up the creation of pipelines seen before.
+    vkapi::IVkPipelineCache cache{nullptr};
   };
 
   explicit VulkanPipeline(const Params &params);
@@ -291,6 +295,7 @@ class VulkanCommandList : public CommandList {
   void buffer_barrier(DevicePtr ptr, size_t size) override;
   void buffer_barrier(DeviceAllocation alloc) override;
   void memory_barrier() override;
+  void vertex_buffer_barrier(DevicePtr ptr, size_t size) override;
   void buffer_copy(DevicePtr dst, DevicePtr src, size_t size) override;
   void buffer_fill(DevicePtr ptr, size_t size, uint32_t data) override;
   void dispatch(uint32_t x, uint32_t y = 1, uint32_t z = 1) override;
@@ -334,6 +339,8 @@ class VulkanCommandList : public CommandList {
                   ImageLayout src_img_layout,
                   const ImageCopyParams &params) override;
 
+  void write_timestamp(uint32_t index) override;
+
   vkapi::IVkRenderPass current_renderpass();
 
   // Vulkan specific functions
@@ -370,6 +377,18 @@ class VulkanSurface : public Surface {
   void resize(uint32_t width, uint32_t height) override;
 
   DeviceAllocation get_image_data() override;
+  // Like get_image_data(), but copies the current image to |dst| without
+  // waiting: the copy is done once |fence| is signaled, and the returned
+  // command list has to be kept alive until then.
+  std::unique_ptr<CommandList> copy_image_data(DevicePtr dst, VkFence fence);
+
+  // Submits |cmdlist|, which renders to the image of get_target_image(), on
+  // the graphics stream. Unlike submit_synced() this does not wait for the
+  // commands: present_image() waits for them on the GPU instead.
+  void submit_frame(std::unique_ptr<CommandList> cmdlist);
+  // Waits until the GPU is done with the last frame submitted, e.g. before
+  // rewriting the buffers it reads.
+  void wait_for_last_frame();
 
  private:
   void create_swap_chain();
@@ -380,12 +399,24 @@ class VulkanSurface : public Surface {
   VulkanDevice *device_;
   VkSurfaceKHR surface_;
   VkSwapchainKHR swapchain_;
-  VkSemaphore image_available_;
   GLFWwindow *window_;
   BufferFormat image_format_;
 
   uint32_t image_index_{0};
 
+  // One per frame in flight. The fence of a frame is signaled once its
+  // commands are done, so that its semaphores and command list can be reused.
+  struct Frame {
+    VkSemaphore image_available{VK_NULL_HANDLE};
+    VkSemaphore render_finished{VK_NULL_HANDLE};
+    VkFence in_flight{VK_NULL_HANDLE};
+    std::unique_ptr<CommandList> cmdlist{nullptr};
+  };
+  std::vector<Frame> frames_;
+  uint32_t frame_index_{0};
+  // The frame submitted last, if any.
+  Frame *last_frame_{nullptr};
+
   std::vector<DeviceAllocation> swapchain_images_;
 
   // DeviceAllocation screenshot_image_{kDeviceNullAllocation};
@@ -411,14 +442,39 @@ class VulkanStream : public Stream {
   std::unique_ptr<CommandList> new_command_list() override;
   void submit(CommandList *cmdlist) override;
   void submit_synced(CommandList *cmdlist) override;
+  // Like submit(), but signals |fence| once |cmdlist| is done. The caller
+  // keeps |cmdlist| alive until then.
+  void submit_with_fence(CommandList *cmdlist, VkFence fence);
+  // Submits commands rendering to a swap chain image: they wait for the binary
+  // |wait_semaphore| before writing color attachments, and signal the binary
+  // |signal_semaphore| and |fence| once done. The caller keeps |cmdlist| alive
+  // until |fence| is signaled.
+  void submit_for_present(CommandList *cmdlist,
+                          VkSemaphore wait_semaphore,
+                          VkSemaphore signal_semaphore,
+                          VkFence fence);
 
   void command_sync() override;
 
+  void wait_for(Stream *producer) override;
+
  private:
+  void submit_internal(vkapi::IVkCommandBuffer buffer,
+                       VkFence fence,
+                       VkSemaphore wait_semaphore = VK_NULL_HANDLE,
+                       VkSemaphore signal_semaphore = VK_NULL_HANDLE);
+
   VulkanDevice &device_;
   VkQueue queue_;
   uint32_t queue_family_index_;
 
+  // Signaled with an increasing value by each submission, if the device
+  // supports timeline semaphores.
+  vkapi::IVkSemaphore timeline_{nullptr};
+  uint64_t timeline_value_{0};
+  // (semaphore, value) pairs the next submission waits for.
+  std::vector<std::pair<vkapi::IVkSemaphore, uint64_t>> pending_waits_;
+
   // Command pools are per-thread
   vkapi::IVkFence cmd_sync_fence_;
   vkapi::IVkCommandPool command_pool_;
@@ -435,6 +491,9 @@ class VulkanDevice : public GraphicsDevice {
     uint32_t compute_queue_family_index;
     VkQueue graphics_queue;
     uint32_t graphics_queue_family_index;
+    // VK_NULL_HANDLE if there's no dedicated transfer queue family.
+    VkQueue transfer_queue{VK_NULL_HANDLE};
+    uint32_t transfer_queue_family_index{0};
   };
 
   void init_vulkan_structs(Params &params);
@@ -454,11 +513,21 @@ class VulkanDevice : public GraphicsDevice {
   void unmap(DevicePtr ptr) override;
   void unmap(DeviceAllocation alloc) override;
 
+  // Whether the host can write the memory of the allocation directly, i.e.
+  // it is host visible and coherent. This is the case for most of the
+  // buffers on integrated GPUs, whose device memory is the host memory.
+  bool is_host_writable(DeviceAllocation alloc);
+
   // Strictly intra device copy
   void memcpy_internal(DevicePtr dst, DevicePtr src, uint64_t size) override;
 
   Stream *get_compute_stream() override;
   Stream *get_graphics_stream() override;
+  Stream *get_transfer_stream() override;
+
+  uint32_t get_num_timestamps() override;
+  std::vector<uint64_t> get_timestamps(uint32_t begin,
+                                       uint32_t count) override;
 
   std::unique_ptr<Pipeline> create_raster_pipeline(
       const std::vector<PipelineSourceDesc> &src,
@@ -522,6 +591,31 @@ class VulkanDevice : public GraphicsDevice {
       VulkanResourceBinder::Set &set);
   vkapi::IVkDescriptorSet alloc_desc_set(vkapi::IVkDescriptorSetLayout layout);
 
+  // Created on first use, and destroyed with the device.
+  VkSampler get_sampler(const ImageSamplerConfig &config);
+
+  /**
+   * Makes the compute pipelines created from now on go through a
+   * VkPipelineCache, initialized with |data| from get_pipeline_cache_data()
+   * of an earlier run. The driver ignores incompatible data.
+   */
+  void init_pipeline_cache(const std::vector<uint8_t> &data);
+
+  // Empty unless init_pipeline_cache() is called.
+  std::vector<uint8_t> get_pipeline_cache_data() const;
+
+  /**
+   * Identifies the device and driver, and thus the compatibility of the
+   * pipeline cache and the generated SPIR-V.
+   */
+  std::string get_device_cache_key() const;
+
+  // Created by get_num_timestamps(), VK_NULL_HANDLE if the compute queue has
+  // no timestamps.
+  VkQueryPool timestamp_pool() const {
+    return timestamp_pool_;
+  }
+
  private:
   void create_vma_allocator();
   void new_descriptor_pool();
@@ -538,19 +632,45 @@ class VulkanDevice : public GraphicsDevice {
   VkQueue graphics_queue_;
   uint32_t graphics_queue_family_index_;
 
+  VkQueue transfer_queue_{VK_NULL_HANDLE};
+  uint32_t transfer_queue_family_index_{0};
+
+  // The queue families that access the buffers concurrently. Empty if they
+  // are all used from the same family.
+  std::vector<uint32_t> buffer_queue_families_;
+
+  vkapi::IVkPipelineCache pipeline_cache_{nullptr};
+
+  static constexpr uint32_t kNumTimestamps = 4096;
+  VkQueryPool timestamp_pool_{VK_NULL_HANDLE};
+  bool timestamp_pool_inited_{false};
+  // Nanoseconds per timestamp tick.
+  float timestamp_period_{0};
+
   unordered_map<std::thread::id, std::unique_ptr<VulkanStream>> compute_stream_;
   unordered_map<std::thread::id, std::unique_ptr<VulkanStream>>
       graphics_stream_;
+  unordered_map<std::thread::id, std::unique_ptr<VulkanStream>>
+      transfer_stream_;
 
   // Memory allocation
   struct AllocationInternal {
     VmaAllocationInfo alloc_info;
     vkapi::IVkBuffer buffer;
     void *mapped{nullptr};
+    AllocParams params;
   };
 
   unordered_map<uint32_t, AllocationInternal> allocations_;
 
+  // The host visible buffers released by dealloc_memory(), most recent
+  // first. The staging buffers of the copies between the host and the device
+  // are allocated again and again with the same parameters (e.g. at every
+  // frame), so they are kept for reuse up to kStagingCacheBytes.
+  static constexpr size_t kStagingCacheBytes = 64 << 20;
+  std::list<AllocationInternal> staging_cache_;
+  size_t staging_cache_bytes_{0};
+
   uint32_t alloc_cnt_ = 0;
 
   // Images / Image views
@@ -580,6 +700,9 @@ class VulkanDevice : public GraphicsDevice {
                 VulkanResourceBinder::SetLayoutHasher>
       desc_set_layouts_;
   vkapi::IVkDescriptorPool desc_pool_{nullptr};
+
+  std::mutex samplers_mut_;
+  unordered_map<ImageSamplerAddressMode, VkSampler> samplers_;
 };
 
 VkFormat buffer_format_ti_to_vk(BufferFormat f);
@@ -112,6 +112,15 @@ VulkanQueueFamilyIndices find_queue_families(VkPhysicalDevice device,
   std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
   vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_family_count,
                                            queue_families.data());
+  for (int i = 0; i < (int)queue_family_count; ++i) {
+    const VkQueueFlags flags = queue_families[i].queueFlags;
+    if ((flags & VK_QUEUE_TRANSFER_BIT) &&
+        !(flags & (VK_QUEUE_COMPUTE_BIT | VK_QUEUE_GRAPHICS_BIT))) {
+      indices.transfer_family = i;
+      break;
+    }
+  }
+
   // TODO: What the heck is this?
   constexpr VkQueueFlags kFlagMask =
       (~(VK_QUEUE_TRANSFER_BIT | VK_QUEUE_SPARSE_BINDING_BIT));
@@ -198,6 +207,11 @@ VulkanDeviceCreator::VulkanDeviceCreator(
     params.graphics_queue = graphics_queue_;
     params.graphics_queue_family_index =
         queue_family_indices_.graphics_family.value();
+    params.transfer_queue = transfer_queue_;
+    if (queue_family_indices_.transfer_family.has_value()) {
+      params.transfer_queue_family_index =
+          queue_family_indices_.transfer_family.value();
+    }
     ti_device_->init_vulkan_structs(params);
   }
 }
@@ -355,6 +369,9 @@ void VulkanDeviceCreator::create_logical_device() {
   if (queue_family_indices_.graphics_family.has_value()) {
     unique_families.insert(queue_family_indices_.graphics_family.value());
   }
+  if (queue_family_indices_.transfer_family.has_value()) {
+    unique_families.insert(queue_family_indices_.transfer_family.value());
+  }
 
   float queue_priority = 1.0f;
   for (uint32_t queue_family : unique_families) {
@@ -382,6 +399,32 @@ void VulkanDeviceCreator::create_logical_device() {
     ti_device_->set_cap(DeviceCapability::spirv_version, 0x10300);
   }
 
+  // Subgroup operations are core in Vulkan 1.1 and SPIR-V 1.3
+  if (physical_device_properties.apiVersion >= VK_API_VERSION_1_1 &&
+      ti_device_->get_cap(DeviceCapability::vk_has_physical_features2)) {
+    VkPhysicalDeviceSubgroupProperties subgroup_properties{};
+    subgroup_properties.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+    VkPhysicalDeviceProperties2KHR properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &subgroup_properties;
+    vkGetPhysicalDeviceProperties2KHR(physical_device_, &properties2);
+
+    if (subgroup_properties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) {
+      const auto ops = subgroup_properties.supportedOperations;
+      if (ops & VK_SUBGROUP_FEATURE_BASIC_BIT) {
+        ti_device_->set_cap(DeviceCapability::spirv_has_subgroup_basic, true);
+      }
+      if (ops & VK_SUBGROUP_FEATURE_VOTE_BIT) {
+        ti_device_->set_cap(DeviceCapability::spirv_has_subgroup_vote, true);
+      }
+      if (ops & VK_SUBGROUP_FEATURE_ARITHMETIC_BIT) {
+        ti_device_->set_cap(DeviceCapability::spirv_has_subgroup_arithmetic,
+                            true);
+      }
+    }
+  }
+
   // Detect extensions
   std::vector<const char *> enabled_extensions;
 
@@ -395,6 +438,7 @@ void VulkanDeviceCreator::create_logical_device() {
   bool has_surface = false, has_swapchain = false;
 
   bool portability_subset_enabled = false;
+  bool has_timeline_semaphore_ext = false;
 
   for (auto &ext : extension_properties) {
     TI_TRACE("Vulkan device extension {} ({})", ext.extensionName,
@@ -430,6 +474,9 @@ void VulkanDeviceCreator::create_logical_device() {
       enabled_extensions.push_back(ext.extensionName);
     } else if (name == VK_KHR_SHADER_FLOAT16_INT8_EXTENSION_NAME) {
       enabled_extensions.push_back(ext.extensionName);
+    } else if (name == VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) {
+      has_timeline_semaphore_ext = true;
+      enabled_extensions.push_back(ext.extensionName);
     } else if (std::find(params_.additional_device_extensions.begin(),
                          params_.additional_device_extensions.end(),
                          name) != params_.additional_device_extensions.end()) {
@@ -485,6 +532,9 @@ void VulkanDeviceCreator::create_logical_device() {
   VkPhysicalDeviceFloat16Int8FeaturesKHR shader_f16_i8_feature{};
   shader_f16_i8_feature.sType =
       VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FLOAT16_INT8_FEATURES_KHR;
+  VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_semaphore_feature{};
+  timeline_semaphore_feature.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
 
   if (ti_device_->get_cap(DeviceCapability::vk_has_physical_features2)) {
     VkPhysicalDeviceFeatures2KHR features2{};
@@ -569,6 +619,18 @@ void VulkanDeviceCreator::create_logical_device() {
       pNextEnd = &shader_f16_i8_feature.pNext;
     }
 
+    // Timeline semaphore
+    if (has_timeline_semaphore_ext) {
+      features2.pNext = &timeline_semaphore_feature;
+      vkGetPhysicalDeviceFeatures2KHR(physical_device_, &features2);
+
+      if (timeline_semaphore_feature.timelineSemaphore) {
+        ti_device_->set_cap(DeviceCapability::vk_has_timeline_semaphore, true);
+        *pNextEnd = &timeline_semaphore_feature;
+        pNextEnd = &timeline_semaphore_feature.pNext;
+      }
+    }
+
     // TODO: add atomic min/max feature
   }
 
@@ -591,6 +653,10 @@ void VulkanDeviceCreator::create_logical_device() {
     vkGetDeviceQueue(device_, queue_family_indices_.graphics_family.value(), 0,
                      &graphics_queue_);
   }
+  if (queue_family_indices_.transfer_family.has_value()) {
+    vkGetDeviceQueue(device_, queue_family_indices_.transfer_family.value(), 0,
+                     &transfer_queue_);
+  }
 
   // Dump capabilities
   ti_device_->print_all_cap();
@@ -24,10 +24,10 @@ struct VulkanQueueFamilyIndices {
   std::optional<uint32_t> compute_family;
   std::optional<uint32_t> graphics_family;
   std::optional<uint32_t> present_family;
-  // TODO: While it is the case that all COMPUTE/GRAPHICS queue also support
-  // TRANSFER by default, maye there are some performance benefits to find a
-  // TRANSFER-dedicated queue family.
+  // A family that supports TRANSFER but neither COMPUTE nor GRAPHICS, i.e. a
+  // DMA engine. Copies submitted there can overlap with compute.
   // https://vulkan-tutorial.com/Vertex_buffers/Staging_buffer#page_Transfer-queue
+  std::optional<uint32_t> transfer_family;
 
   bool is_complete() const {
     return compute_family.has_value();
@@ -81,6 +81,7 @@ class VulkanDeviceCreator {
 
   VkQueue compute_queue_{VK_NULL_HANDLE};
   VkQueue graphics_queue_{VK_NULL_HANDLE};
+  VkQueue transfer_queue_{VK_NULL_HANDLE};
 
   VkSurfaceKHR surface_{VK_NULL_HANDLE};
 
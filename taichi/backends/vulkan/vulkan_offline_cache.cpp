@@ -0,0 +1,159 @@
+#include "taichi/backends/vulkan/vulkan_offline_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+
+#include "taichi/backends/vulkan/vulkan_device.h"
+#include "taichi/common/serialization.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/program/kernel.h"
+#include "taichi/system/profiler.h"
+#include "taichi/util/io.h"
+
+namespace taichi {
+namespace lang {
+namespace vulkan {
+
+namespace {
+
+constexpr char kEntryExtension[] = ".tic";
+
+struct CachedKernel {
+  TaichiKernelAttributes kernel_attribs;
+  std::vector<std::vector<uint32_t>> task_spirv_source_codes;
+
+  TI_IO_DEF(kernel_attribs, task_spirv_source_codes);
+};
+
+// 64-bit FNV-1a.
+uint64 fnv1a(const std::string &data) {
+  uint64 hash = 14695981039346656037ULL;
+  for (unsigned char c : data) {
+    hash = (hash ^ c) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+bool file_exists(const std::string &path) {
+  std::FILE *f = std::fopen(path.c_str(), "rb");
+  if (f == nullptr) {
+    return false;
+  }
+  std::fclose(f);
+  return true;
+}
+
+// Writes to a temporary file first, so that concurrent processes never observe
+// a partially written entry.
+template <typename Writer>
+void write_atomically(const std::string &path, const Writer &writer) {
+  const auto tmp_path = fmt::format("{}.{}.tmp", path, PID::get_pid());
+  writer(tmp_path);
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    TI_WARN("Failed to commit offline cache entry {}", path);
+    std::remove(tmp_path.c_str());
+  }
+}
+
+}  // namespace
+
+VkOfflineCache::VkOfflineCache(const std::string &path, VulkanDevice *device)
+    : path_(fmt::format("{}/{}", path, device->get_device_cache_key())),
+      device_(device) {
+  create_directories(path_);
+  std::vector<uint8_t> data;
+  const auto pipeline_cache_path = get_pipeline_cache_path();
+  if (!read_vector_from_disk(&data, pipeline_cache_path)) {
+    data.clear();
+  }
+  TI_TRACE("Loaded {} bytes of Vulkan pipeline cache from {}", data.size(),
+           pipeline_cache_path);
+  device_->init_pipeline_cache(data);
+}
+
+VkOfflineCache::~VkOfflineCache() {
+  auto data = device_->get_pipeline_cache_data();
+  if (data.empty()) {
+    return;
+  }
+  write_atomically(get_pipeline_cache_path(), [&](const std::string &path) {
+    write_vector_to_disk(&data, path);
+  });
+}
+
+std::string VkOfflineCache::make_kernel_key(
+    Kernel *kernel,
+    const std::vector<CompiledSNodeStructs> &compiled_structs) {
+  TI_AUTO_PROF;
+  std::string content;
+  irpass::print(kernel->ir.get(), &content);
+  for (const auto &arg : kernel->args) {
+    content += fmt::format("\narg {} {} {} {}", arg.dt->to_string(),
+                           arg.is_external_array, arg.total_dim,
+                           fmt::join(arg.element_shape, ","));
+  }
+  for (const auto &ret : kernel->rets) {
+    content += fmt::format("\nret {}", ret.dt->to_string());
+  }
+  // The codegen uses the layout of the SNode trees.
+  for (const auto &structs : compiled_structs) {
+    content += fmt::format("\nroot {} {}", structs.root->id, structs.root_size);
+    std::vector<int> ids;
+    for (const auto &[id, _] : structs.snode_descriptors) {
+      ids.push_back(id);
+    }
+    std::sort(ids.begin(), ids.end());
+    for (int id : ids) {
+      const auto &desc = structs.snode_descriptors.at(id);
+      content += fmt::format(
+          "\nsnode {} {} {} {} {}", id, desc.cell_stride,
+          desc.container_stride, desc.total_num_cells_from_root,
+          desc.mem_offset_in_parent_cell);
+    }
+  }
+  const auto &config = kernel->program->config;
+  content += fmt::format("\nconfig {} {}", config.external_optimization_level,
+                         config.fast_math);
+  content += get_version_string();
+  content += get_commit_hash();
+  // Two independent 64-bit hashes make collisions practically impossible.
+  return fmt::format("{:016x}{:016x}", fnv1a(content),
+                     (uint64)std::hash<std::string>{}(content));
+}
+
+std::string VkOfflineCache::get_kernel_path(const std::string &key) const {
+  return fmt::format("{}/{}{}", path_, key, kEntryExtension);
+}
+
+std::string VkOfflineCache::get_pipeline_cache_path() const {
+  return fmt::format("{}/pipeline_cache.bin", path_);
+}
+
+bool VkOfflineCache::load_kernel(const std::string &key,
+                                 VkRuntime::RegisterParams &params) {
+  const auto kernel_path = get_kernel_path(key);
+  if (!file_exists(kernel_path)) {
+    return false;
+  }
+  CachedKernel cached;
+  read_from_binary_file(cached, kernel_path);
+  params.kernel_attribs = std::move(cached.kernel_attribs);
+  params.task_spirv_source_codes = std::move(cached.task_spirv_source_codes);
+  TI_TRACE("Offline cache hit: {}", key);
+  return true;
+}
+
+void VkOfflineCache::store_kernel(const std::string &key,
+                                  const VkRuntime::RegisterParams &params) {
+  CachedKernel cached;
+  cached.kernel_attribs = params.kernel_attribs;
+  cached.task_spirv_source_codes = params.task_spirv_source_codes;
+  write_atomically(get_kernel_path(key), [&](const std::string &path) {
+    write_to_binary_file(cached, path);
+  });
+}
+
+}  // namespace vulkan
+}  // namespace lang
+}  // namespace taichi
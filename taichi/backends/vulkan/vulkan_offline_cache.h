@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+
+#include "taichi/backends/vulkan/runtime.h"
+
+namespace taichi {
+namespace lang {
+namespace vulkan {
+
+class VulkanDevice;
+
+/**
+ * An on-disk cache of the generated SPIR-V of kernels and of the
+ * VkPipelineCache, so that later runs skip both the SPIR-V codegen and most of
+ * the pipeline creation.
+ *
+ * The entries live in a directory per device and driver, see
+ * VulkanDevice::get_device_cache_key(). Kernels are keyed by their lowered IR
+ * plus everything else the codegen depends on.
+ */
+class VkOfflineCache {
+ public:
+  /**
+   * Loads the pipeline cache of |device| from |path|. It is written back when
+   * the VkOfflineCache is destroyed, which must happen before |device| is.
+   */
+  VkOfflineCache(const std::string &path, VulkanDevice *device);
+
+  ~VkOfflineCache();
+
+  /**
+   * Computes the cache key of |kernel|, which must be lowered already.
+   */
+  static std::string make_kernel_key(
+      Kernel *kernel,
+      const std::vector<CompiledSNodeStructs> &compiled_structs);
+
+  bool load_kernel(const std::string &key, VkRuntime::RegisterParams &params);
+
+  void store_kernel(const std::string &key,
+                    const VkRuntime::RegisterParams &params);
+
+ private:
+  std::string get_kernel_path(const std::string &key) const;
+
+  std::string get_pipeline_cache_path() const;
+
+  std::string path_;
+  VulkanDevice *device_;
+};
+
+}  // namespace vulkan
+}  // namespace lang
+}  // namespace taichi
@@ -1,5 +1,6 @@
 #include "taichi/backends/vulkan/vulkan_program.h"
 #include "taichi/backends/vulkan/aot_module_builder_impl.h"
+#include "taichi/backends/vulkan/vulkan_offline_cache.h"
 
 #include "GLFW/glfw3.h"
 
@@ -48,9 +49,23 @@ std::vector<std::string> get_required_device_extensions() {
 }
 }  // namespace
 
-FunctionType compile_to_executable(Kernel *kernel, VkRuntime *runtime) {
-  auto handle = runtime->register_taichi_kernel(std::move(run_codegen(
-      kernel, runtime->get_ti_device(), runtime->get_compiled_structs())));
+FunctionType compile_to_executable(Kernel *kernel,
+                                   VkRuntime *runtime,
+                                   VkOfflineCache *offline_cache) {
+  const auto &compiled_structs = runtime->get_compiled_structs();
+  VkRuntime::RegisterParams params;
+  std::string cache_key;
+  if (offline_cache) {
+    cache_key = VkOfflineCache::make_kernel_key(kernel, compiled_structs);
+  }
+  if (!offline_cache || !offline_cache->load_kernel(cache_key, params)) {
+    params =
+        run_codegen(kernel, runtime->get_ti_device(), compiled_structs);
+    if (offline_cache) {
+      offline_cache->store_kernel(cache_key, params);
+    }
+  }
+  auto handle = runtime->register_taichi_kernel(std::move(params));
   return [runtime, handle](RuntimeContext &ctx) {
     runtime->launch_kernel(handle, &ctx);
   };
@@ -59,7 +74,8 @@ FunctionType compile_to_executable(Kernel *kernel, VkRuntime *runtime) {
 FunctionType VulkanProgramImpl::compile(Kernel *kernel,
                                         OffloadedStmt *offloaded) {
   spirv::lower(kernel);
-  return compile_to_executable(kernel, vulkan_runtime_.get());
+  return compile_to_executable(kernel, vulkan_runtime_.get(),
+                               offline_cache_.get());
 }
 
 void VulkanProgramImpl::materialize_runtime(MemoryPool *memory_pool,
@@ -109,9 +125,21 @@ void VulkanProgramImpl::materialize_runtime(MemoryPool *memory_pool,
 
   embedded_device_ = std::make_unique<VulkanDeviceCreator>(evd_params);
 
+  if (config->offline_cache) {
+    auto path = config->offline_cache_file_path;
+    if (path.empty()) {
+      path = get_repo_dir() + "ticache";
+    }
+    offline_cache_ = std::make_unique<VkOfflineCache>(
+        fmt::format("{}/{}", path, arch_name(Arch::vulkan)),
+        embedded_device_->device());
+  }
+
   vulkan::VkRuntime::Params params;
   params.host_result_buffer = *result_buffer_ptr;
   params.device = embedded_device_->device();
+  params.profiler = profiler;
+  params.num_compile_threads = config->num_compile_threads;
   vulkan_runtime_ = std::make_unique<vulkan::VkRuntime>(std::move(params));
 }
 
@@ -145,6 +173,8 @@ std::unique_ptr<AotModuleBuilder> VulkanProgramImpl::make_aot_module_builder() {
 
 VulkanProgramImpl::~VulkanProgramImpl() {
   vulkan_runtime_.reset();
+  // Saves the pipeline cache, which needs the device.
+  offline_cache_.reset();
   embedded_device_.reset();
 }
 
@@ -23,6 +23,7 @@ namespace lang {
 
 namespace vulkan {
 class VulkanDeviceCreator;
+class VkOfflineCache;
 }
 
 class VulkanProgramImpl : public ProgramImpl {
@@ -82,6 +83,7 @@ class VulkanProgramImpl : public ProgramImpl {
  private:
   std::unique_ptr<vulkan::VulkanDeviceCreator> embedded_device_{nullptr};
   std::unique_ptr<vulkan::VkRuntime> vulkan_runtime_;
+  std::unique_ptr<vulkan::VkOfflineCache> offline_cache_{nullptr};
   std::vector<spirv::CompiledSNodeStructs> aot_compiled_snode_structs_;
 };
 }  // namespace lang
@@ -17,6 +17,9 @@ namespace {
 constexpr std::array<const char *, 5> kPreloadedFuncNames = {
     "wasm_materialize", "wasm_set_kernel_parameter_i32",
     "wasm_set_kernel_parameter_f32", "wasm_set_print_buffer", "wasm_print"};
+
+// Number of 32-bit lanes in a SIMD128 vector
+constexpr int kSimd128Lanes = 4;
 }
 
 class CodeGenLLVMWASM : public CodeGenLLVM {
@@ -26,7 +29,14 @@ class CodeGenLLVMWASM : public CodeGenLLVM {
   CodeGenLLVMWASM(Kernel *kernel,
                   IRNode *ir,
                   std::unique_ptr<llvm::Module> &&M = nullptr)
-      : CodeGenLLVM(kernel, ir, std::move(M)) {
+      // The preloaded runtime functions are exported from every kernel
+      // module, so they are cloned along with the rest of the struct module.
+      : CodeGenLLVM(kernel,
+                    ir,
+                    M ? std::move(M)
+                      : kernel->program->get_llvm_program_impl()
+                            ->get_llvm_context(kernel->arch)
+                            ->clone_struct_module()) {
     TI_AUTO_PROF
   }
 
@@ -86,7 +96,12 @@ class CodeGenLLVMWASM : public CodeGenLLVM {
       } else {
         create_increment(loop_var, tlctx->get_constant(-1));
       }
-      builder->CreateBr(loop_test);
+      auto *latch = builder->CreateBr(loop_test);
+      if (prog->config.wasm_simd128 && !stmt->reversed &&
+          is_innermost_loop(stmt)) {
+        latch->setMetadata(llvm::LLVMContext::MD_loop,
+                           get_vectorize_loop_metadata(kSimd128Lanes));
+      }
     }
 
     // next cfg
@@ -194,6 +209,29 @@ class CodeGenLLVMWASM : public CodeGenLLVM {
     return task_kernel_name;
   }
 
+  // Sets the WASM features on all the functions of the module, including the
+  // runtime ones. LLVM does not inline a function into a caller lacking some
+  // of its features.
+  void set_target_features() {
+    std::vector<std::string> features;
+    if (prog->config.wasm_simd128) {
+      features.push_back("+simd128");
+    }
+    if (prog->config.wasm_threads) {
+      features.push_back("+atomics");
+      features.push_back("+bulk-memory");
+    }
+    if (features.empty()) {
+      return;
+    }
+    const auto features_str = fmt::format("{}", fmt::join(features, ","));
+    for (auto &f : *module) {
+      if (!f.isDeclaration()) {
+        f.addFnAttr("target-features", features_str);
+      }
+    }
+  }
+
   void finalize_taichi_kernel_function() {
     builder->CreateRetVoid();
 
@@ -201,6 +239,8 @@ class CodeGenLLVMWASM : public CodeGenLLVM {
     builder->SetInsertPoint(entry_block);
     builder->CreateBr(func_body_bb);
 
+    set_target_features();
+
     if (prog->config.print_kernel_llvm_ir) {
       static FileSequenceWriter writer(
           "taichi_kernel_generic_llvm_ir_{:04d}.ll",
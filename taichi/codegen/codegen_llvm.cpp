@@ -1,11 +1,15 @@
 #ifdef TI_WITH_LLVM
 #include "taichi/codegen/codegen_llvm.h"
 
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/pass_profiler.h"
 #include "taichi/ir/statements.h"
 #include "taichi/struct/struct_llvm.h"
 #include "taichi/util/file_sequence_writer.h"
 
 #include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/Linker/Linker.h"
 
 TLANG_NAMESPACE_BEGIN
@@ -31,9 +35,9 @@ void OffloadedTask::operator()(RuntimeContext *context) {
   func(context);
 }
 
-void OffloadedTask::compile() {
+void OffloadedTask::compile(JITModule *module) {
   TI_ASSERT(!func);
-  auto kernel_symbol = codegen->tlctx->lookup_function_pointer(name);
+  auto kernel_symbol = module->lookup_function(name);
   TI_ASSERT_INFO(kernel_symbol, "Function not found");
 
   func = (task_fp_type)kernel_symbol;
@@ -124,9 +128,20 @@ CodeGenStmtGuard make_while_after_loop_guard(CodeGenLLVM *cg) {
 
 // CodeGenLLVM
 
-uint64 CodeGenLLVM::task_counter = 0;
+std::atomic<uint64> CodeGenLLVM::task_counter = 0;
 
 void CodeGenLLVM::visit(Block *stmt_list) {
+  if (current_offload && stmt_list == current_offload->body.get()) {
+    using Type = OffloadedStmt::TaskType;
+    const auto type = current_offload->task_type;
+    if (type == Type::serial || type == Type::range_for ||
+        type == Type::struct_for) {
+      // The body is emitted once per iteration. Left to the optimizer to
+      // remove when unused.
+      rand_counter = create_entry_block_alloca(PrimitiveType::u32);
+      builder->CreateStore(tlctx->get_constant((uint32)0), rand_counter);
+    }
+  }
   for (auto &stmt : stmt_list->statements) {
     stmt->accept(this);
   }
@@ -136,21 +151,16 @@ void CodeGenLLVM::visit(AllocaStmt *stmt) {
   if (stmt->ret_type->is<TensorType>()) {
     auto tensor_type = stmt->ret_type->cast<TensorType>();
     auto type = tlctx->get_data_type(tensor_type->get_element_type());
-    auto array_size = tlctx->get_constant(tensor_type->get_num_elements());
-    // Return type is [array_size x type]*.
-    llvm_val[stmt] = create_entry_block_alloca(type, 0, array_size);
+    auto array_type =
+        llvm::ArrayType::get(type, tensor_type->get_num_elements());
+    // Return type is [array_size x type]*. Unlike an array allocation, an
+    // aggregate can be split into registers by SROA when all the offsets
+    // into it are constant, which lets LLVM vectorize the element-wise
+    // matrix operations.
+    llvm_val[stmt] = create_entry_block_alloca(array_type);
     // Initialize as zero
-    for (int i = 0; i < tensor_type->get_num_elements(); ++i) {
-      auto origin_address = builder->CreatePtrToInt(
-          llvm_val[stmt], llvm::Type::getInt64Ty(*llvm_context));
-      int address_offset = i * data_type_size(tensor_type->get_element_type());
-      auto target_address = builder->CreateAdd(
-          origin_address, tlctx->get_constant((int64)address_offset));
-      auto target_ptr = builder->CreateIntToPtr(
-          target_address, llvm::PointerType::get(type, 0));
-      builder->CreateStore(
-          tlctx->get_constant(tensor_type->get_element_type(), 0), target_ptr);
-    }
+    builder->CreateStore(llvm::ConstantAggregateZero::get(array_type),
+                         llvm_val[stmt]);
   } else {
     TI_ASSERT(stmt->width() == 1);
     llvm_val[stmt] =
@@ -163,6 +173,11 @@ void CodeGenLLVM::visit(AllocaStmt *stmt) {
 }
 
 void CodeGenLLVM::visit(RandStmt *stmt) {
+  if (rand_counter &&
+      (stmt->counter_based || prog->config.counter_based_rand)) {
+    visit_counter_based_rand(stmt);
+    return;
+  }
   if (stmt->ret_type->is_primitive(PrimitiveTypeID::f16)) {
     // Promoting to f32 since there's no rand_f16 support in runtime.cpp.
     auto val_f32 = create_call("rand_f32", {get_context()});
@@ -175,6 +190,48 @@ void CodeGenLLVM::visit(RandStmt *stmt) {
   }
 }
 
+void CodeGenLLVM::visit_counter_based_rand(RandStmt *stmt) {
+  // The counter of Philox is the index of the iteration and the number of
+  // random numbers it has drawn. Unlike the thread index, the former does
+  // not depend on the schedule.
+  llvm::Value *index[3];
+  for (auto &i : index) {
+    i = tlctx->get_constant((uint32)0);
+  }
+  if (current_offload->task_type == OffloadedStmt::TaskType::range_for) {
+    index[0] = builder->CreateLoad(loop_vars_llvm[current_offload][0]);
+  } else if (current_offload->task_type ==
+             OffloadedStmt::TaskType::struct_for) {
+    const int num_indices = current_offload->snode->num_active_indices;
+    for (int k = 0; k < num_indices; k++) {
+      auto *coord = builder->CreateLoad(builder->CreateGEP(
+          current_coordinates, {tlctx->get_constant(0), tlctx->get_constant(0),
+                                tlctx->get_constant(k)}));
+      if (k < 3) {
+        index[k] = coord;
+      } else {
+        // The indices beyond the third are folded into it.
+        index[2] = builder->CreateAdd(
+            builder->CreateMul(index[2], tlctx->get_constant(0x9E3779B1)),
+            coord);
+      }
+    }
+  }
+  auto *counter = builder->CreateLoad(rand_counter);
+  create_increment(rand_counter, tlctx->get_constant((uint32)1));
+  std::vector<llvm::Value *> args = {get_context(), index[0], index[1],
+                                     index[2], counter};
+  if (stmt->ret_type->is_primitive(PrimitiveTypeID::f16)) {
+    // Promoting to f32 since there's no rand_f16 support in runtime.cpp.
+    llvm_val[stmt] = builder->CreateFPTrunc(
+        create_call("philox_rand_f32", args),
+        llvm::Type::getHalfTy(*llvm_context));
+  } else {
+    llvm_val[stmt] = create_call(
+        fmt::format("philox_rand_{}", data_type_name(stmt->ret_type)), args);
+  }
+}
+
 void CodeGenLLVM::emit_extra_unary(UnaryOpStmt *stmt) {
   auto input = llvm_val[stmt->operand];
   auto input_taichi_type = stmt->operand->ret_type;
@@ -239,6 +296,10 @@ std::unique_ptr<RuntimeObject> CodeGenLLVM::emit_struct_meta_object(
   } else if (snode->type == SNodeType::pointer) {
     meta = std::make_unique<RuntimeObject>("PointerMeta", this, builder.get());
     emit_struct_meta_base("Pointer", meta->ptr, snode);
+  } else if (snode->type == SNodeType::hash) {
+    meta = std::make_unique<RuntimeObject>("HashMeta", this, builder.get());
+    emit_struct_meta_base("Hash", meta->ptr, snode);
+    meta->call("set_capacity", tlctx->get_constant(snode->hash_capacity));
   } else if (snode->type == SNodeType::root) {
     meta = std::make_unique<RuntimeObject>("RootMeta", this, builder.get());
     emit_struct_meta_base("Root", meta->ptr, snode);
@@ -246,6 +307,7 @@ std::unique_ptr<RuntimeObject> CodeGenLLVM::emit_struct_meta_object(
     meta = std::make_unique<RuntimeObject>("DynamicMeta", this, builder.get());
     emit_struct_meta_base("Dynamic", meta->ptr, snode);
     meta->call("set_chunk_size", tlctx->get_constant(snode->chunk_size));
+    meta->call("set_chunk_table", tlctx->get_constant((int)snode->chunk_table));
   } else if (snode->type == SNodeType::bitmasked) {
     meta =
         std::make_unique<RuntimeObject>("BitmaskedMeta", this, builder.get());
@@ -267,7 +329,8 @@ void CodeGenLLVM::emit_struct_meta_base(const std::string &name,
         StructCompilerLLVM::get_llvm_body_type(module.get(), snode);
     auto element_ty = body_type->getArrayElementType();
     element_size = tlctx->get_type_size(element_ty);
-  } else if (snode->type == SNodeType::pointer) {
+  } else if (snode->type == SNodeType::pointer ||
+             snode->type == SNodeType::hash) {
     auto element_ty = StructCompilerLLVM::get_llvm_node_type(
         module.get(), snode->ch[0].get());
     element_size = tlctx->get_type_size(element_ty);
@@ -293,11 +356,19 @@ void CodeGenLLVM::emit_struct_meta_base(const std::string &name,
                              */
 
   std::vector<std::string> functions = {"lookup_element", "is_active",
-                                        "get_num_elements"};
+                                        "get_num_elements", "get_cell_index",
+                                        "next_active"};
 
   for (auto const &f : functions)
     common.set(f, get_runtime_function(fmt::format("{}_{}", name, f)));
 
+  if (snode->type == SNodeType::hash) {
+    // The listgen visits the slots of hash nodes rather than their cells.
+    common.set("lookup_element", get_runtime_function("Hash_lookup_slot"));
+    common.set("is_active", get_runtime_function("Hash_is_slot_active"));
+    common.set("next_active", get_runtime_function("Hash_next_active_slot"));
+  }
+
   // "from_parent_element", "refine_coordinates" are different for different
   // snodes, even if they have the same type.
   if (snode->parent)
@@ -316,7 +387,7 @@ CodeGenLLVM::CodeGenLLVM(Kernel *kernel,
     : LLVMModuleBuilder(
           module == nullptr ? kernel->program->get_llvm_program_impl()
                                   ->get_llvm_context(kernel->arch)
-                                  ->clone_struct_module()
+                                  ->new_kernel_module("kernel")
                             : std::move(module),
           kernel->program->get_llvm_program_impl()->get_llvm_context(
               kernel->arch)),
@@ -369,7 +440,18 @@ void CodeGenLLVM::visit(UnaryOpStmt *stmt) {
     llvm::CastInst::CastOps cast_op;
     auto from = stmt->operand->ret_type;
     auto to = stmt->cast_type;
-    if (from == to) {
+    if (to->is_primitive(PrimitiveTypeID::bf16)) {
+      // Round to bf16, but keep the value in f32 for computation.
+      auto f32 = llvm::Type::getFloatTy(*llvm_context);
+      auto val = llvm_val[stmt->operand];
+      if (is_integral(from)) {
+        val = is_signed(from) ? builder->CreateSIToFP(val, f32)
+                              : builder->CreateUIToFP(val, f32);
+      } else {
+        val = builder->CreateFPCast(val, f32);
+      }
+      llvm_val[stmt] = bf16_to_f32(f32_to_bf16(val));
+    } else if (from == to) {
       llvm_val[stmt] = llvm_val[stmt->operand];
     } else if (is_real(from) != is_real(to)) {
       if (is_real(from) && is_integral(to)) {
@@ -887,7 +969,9 @@ void CodeGenLLVM::visit(ContinueStmt *stmt) {
     }
     return false;
   };
-  if (stmt_in_off_range_for()) {
+  // Vectorized CPU range-fors iterate over a block inside the body function,
+  // in which case |current_loop_reentry| is set.
+  if (stmt_in_off_range_for() && current_loop_reentry == nullptr) {
     builder->CreateRetVoid();
   } else {
     TI_ASSERT(current_loop_reentry != nullptr);
@@ -929,6 +1013,32 @@ llvm::Value *CodeGenLLVM::cast_pointer(llvm::Value *val,
 
 void CodeGenLLVM::emit_list_gen(OffloadedStmt *listgen) {
   auto snode_child = listgen->snode;
+  if (listgen->listgen_source) {
+    // metas[0] is the source, and metas[num_levels] is |snode_child|.
+    std::vector<SNode *> path;
+    for (auto s = snode_child; s != listgen->listgen_source; s = s->parent) {
+      TI_ASSERT(s->parent);
+      path.push_back(s);
+    }
+    path.push_back(listgen->listgen_source);
+    std::reverse(path.begin(), path.end());
+    const int num_levels = (int)path.size() - 1;
+    auto meta_ptr_type =
+        llvm::PointerType::get(get_runtime_type("StructMeta"), 0);
+    auto metas = create_entry_block_alloca(
+        llvm::ArrayType::get(meta_ptr_type, path.size()));
+    for (int i = 0; i < (int)path.size(); i++) {
+      builder->CreateStore(
+          cast_pointer(emit_struct_meta(path[i]), "StructMeta"),
+          builder->CreateGEP(metas,
+                             {tlctx->get_constant(0), tlctx->get_constant(i)}));
+    }
+    call("element_listgen_fused", get_runtime(),
+         builder->CreateGEP(metas,
+                            {tlctx->get_constant(0), tlctx->get_constant(0)}),
+         tlctx->get_constant(num_levels));
+    return;
+  }
   auto snode_parent = listgen->snode->parent;
   auto meta_child = cast_pointer(emit_struct_meta(snode_child), "StructMeta");
   auto meta_parent = cast_pointer(emit_struct_meta(snode_parent), "StructMeta");
@@ -944,6 +1054,15 @@ void CodeGenLLVM::emit_list_gen(OffloadedStmt *listgen) {
 void CodeGenLLVM::emit_gc(OffloadedStmt *stmt) {
   auto snode = stmt->snode->id;
   call("node_gc", get_runtime(), tlctx->get_constant(snode));
+  if (stmt->gc_compact) {
+    call("node_gc_compact_begin", get_runtime(), tlctx->get_constant(snode));
+    // Spreads the containers over the CPU threads.
+    call("node_gc_compact", get_context(),
+         builder->CreateBitCast(emit_struct_meta(stmt->snode),
+                                llvm::Type::getInt8PtrTy(*llvm_context)),
+         tlctx->get_constant(stmt->num_cpu_threads));
+    call("node_gc_compact_end", get_runtime(), tlctx->get_constant(snode));
+  }
 }
 
 llvm::Value *CodeGenLLVM::create_call(llvm::Value *func,
@@ -1094,7 +1213,7 @@ void CodeGenLLVM::visit(ReturnStmt *stmt) {
     auto extended = builder->CreateZExt(
         builder->CreateBitCast(llvm_val[stmt->value], intermediate_type),
         dest_ty);
-    create_call("LLVMRuntime_store_result", {get_runtime(), extended});
+    create_call("RuntimeContext_store_result", {get_context(), extended});
   }
 }
 
@@ -1120,9 +1239,26 @@ void CodeGenLLVM::visit(AssertStmt *stmt) {
   // TODO: maybe let all asserts in a single offload share a single buffer?
   auto arguments = create_entry_block_alloca(argument_buffer_size);
 
+  llvm::BasicBlock *after_assert = nullptr;
+  if (stmt->deferred) {
+    // The arguments are only stored when the assertion fails, in a block
+    // marked as unlikely, so that the passing checks only cost a branch.
+    auto failed =
+        llvm::BasicBlock::Create(*llvm_context, "assert_failed", func);
+    after_assert =
+        llvm::BasicBlock::Create(*llvm_context, "after_assert", func);
+    llvm::MDBuilder md_builder(*llvm_context);
+    builder->CreateCondBr(
+        builder->CreateICmpNE(llvm_val[stmt->cond], tlctx->get_constant(0)),
+        after_assert, failed, md_builder.createBranchWeights(1 << 20, 1));
+    builder->SetInsertPoint(failed);
+  }
+
   std::vector<llvm::Value *> args;
   args.emplace_back(get_runtime());
-  args.emplace_back(llvm_val[stmt->cond]);
+  if (!stmt->deferred) {
+    args.emplace_back(llvm_val[stmt->cond]);
+  }
   args.emplace_back(builder->CreateGlobalStringPtr(stmt->text));
 
   for (int i = 0; i < stmt->args.size(); i++) {
@@ -1149,7 +1285,13 @@ void CodeGenLLVM::visit(AssertStmt *stmt) {
   args.emplace_back(builder->CreateGEP(
       arguments, {tlctx->get_constant(0), tlctx->get_constant(0)}));
 
-  llvm_val[stmt] = create_call("taichi_assert_format", args);
+  if (stmt->deferred) {
+    llvm_val[stmt] = create_call("taichi_record_error", args);
+    builder->CreateBr(after_assert);
+    builder->SetInsertPoint(after_assert);
+  } else {
+    llvm_val[stmt] = create_call("taichi_assert_format", args);
+  }
 }
 
 void CodeGenLLVM::visit(SNodeOpStmt *stmt) {
@@ -1216,6 +1358,55 @@ llvm::Value *CodeGenLLVM::atomic_op_using_cas(
   return old_val;
 }
 
+llvm::Value *CodeGenLLVM::f32_to_bf16(llvm::Value *val) {
+  auto i32 = llvm::Type::getInt32Ty(*llvm_context);
+  auto bits = builder->CreateBitCast(val, i32);
+  // Round to nearest even: add 0x7fff plus the lowest kept bit, then
+  // truncate. NaNs are kept quiet instead of being rounded to infinity.
+  auto lsb = builder->CreateAnd(builder->CreateLShr(bits, 16),
+                                llvm::ConstantInt::get(i32, 1));
+  auto rounded = builder->CreateAdd(
+      bits, builder->CreateAdd(lsb, llvm::ConstantInt::get(i32, 0x7fff)));
+  auto quiet_nan =
+      builder->CreateOr(bits, llvm::ConstantInt::get(i32, 0x400000));
+  bits = builder->CreateSelect(builder->CreateFCmpUNO(val, val), quiet_nan,
+                               rounded);
+  return builder->CreateTrunc(builder->CreateLShr(bits, 16),
+                              llvm::Type::getInt16Ty(*llvm_context));
+}
+
+llvm::Value *CodeGenLLVM::bf16_to_f32(llvm::Value *bits) {
+  auto i32 = llvm::Type::getInt32Ty(*llvm_context);
+  return builder->CreateBitCast(
+      builder->CreateShl(builder->CreateZExt(bits, i32), 16),
+      llvm::Type::getFloatTy(*llvm_context));
+}
+
+llvm::Value *CodeGenLLVM::atomic_op_bf16(AtomicOpStmt *stmt) {
+  auto dst_type = stmt->dest->ret_type->as<PointerType>()->get_pointee_type();
+  if (!dst_type->is_primitive(PrimitiveTypeID::bf16)) {
+    return nullptr;
+  }
+  std::function<llvm::Value *(llvm::Value *, llvm::Value *)> op;
+  if (stmt->op_type == AtomicOpType::add) {
+    op = [&](auto v1, auto v2) { return builder->CreateFAdd(v1, v2); };
+  } else if (stmt->op_type == AtomicOpType::min) {
+    op = [&](auto v1, auto v2) { return builder->CreateMinNum(v1, v2); };
+  } else if (stmt->op_type == AtomicOpType::max) {
+    op = [&](auto v1, auto v2) { return builder->CreateMaxNum(v1, v2); };
+  } else {
+    TI_NOT_IMPLEMENTED
+  }
+  // The CAS loop works on the 16-bit storage; the update itself is in f32.
+  llvm::Value *old_bits = nullptr;
+  atomic_op_using_cas(llvm_val[stmt->dest], llvm_val[stmt->val],
+                      [&](llvm::Value *bits, llvm::Value *val) {
+                        old_bits = bits;
+                        return f32_to_bf16(op(bf16_to_f32(bits), val));
+                      });
+  return bf16_to_f32(old_bits);
+}
+
 void CodeGenLLVM::visit(AtomicOpStmt *stmt) {
   // auto mask = stmt->parent->mask();
   // TODO: deal with mask when vectorized
@@ -1223,7 +1414,9 @@ void CodeGenLLVM::visit(AtomicOpStmt *stmt) {
   TI_ASSERT(stmt->width() == 1);
   for (int l = 0; l < stmt->width(); l++) {
     llvm::Value *old_value;
-    if (stmt->op_type == AtomicOpType::add) {
+    if (llvm::Value *result = atomic_op_bf16(stmt)) {
+      old_value = result;
+    } else if (stmt->op_type == AtomicOpType::add) {
       auto dst_type =
           stmt->dest->ret_type->as<PointerType>()->get_pointee_type();
       if (dst_type->is<PrimitiveType>() && is_integral(stmt->val->ret_type)) {
@@ -1335,8 +1528,14 @@ void CodeGenLLVM::visit(GlobalStoreStmt *stmt) {
     auto *cit = pointee_type->as<CustomIntType>();
     store_value = llvm_val[stmt->val];
     store_custom_int(llvm_val[stmt->dest], cit, store_value, /*atomic=*/true);
+  } else if (ptr_type->get_pointee_type()->is_primitive(
+                 PrimitiveTypeID::bf16)) {
+    builder->CreateStore(f32_to_bf16(llvm_val[stmt->val]),
+                         llvm_val[stmt->dest]);
   } else {
-    builder->CreateStore(llvm_val[stmt->val], llvm_val[stmt->dest]);
+    annotate_alias_scope(
+        builder->CreateStore(llvm_val[stmt->val], llvm_val[stmt->dest]),
+        stmt->dest);
   }
 }
 
@@ -1344,7 +1543,16 @@ void CodeGenLLVM::visit(GlobalLoadStmt *stmt) {
   int width = stmt->width();
   TI_ASSERT(width == 1);
   auto ptr_type = stmt->src->ret_type->as<PointerType>();
-  if (ptr_type->is_bit_pointer()) {
+  auto get_ch = stmt->src->cast<GetChStmt>();
+  if (get_ch && get_ch->input_snode->type == SNodeType::bit_struct) {
+    // Load the whole word rather than going through the bit pointer.
+    auto physical_type =
+        get_ch->input_snode->dt->as<BitStructType>()->get_physical_type();
+    auto bit_struct_val = builder->CreateLoad(builder->CreateBitCast(
+        llvm_val[get_ch->input_ptr], llvm_ptr_type(physical_type)));
+    llvm_val[stmt] =
+        extract_bit_struct_member(bit_struct_val, get_ch->output_snode);
+  } else if (ptr_type->is_bit_pointer()) {
     auto val_type = ptr_type->get_pointee_type();
     if (val_type->is<CustomIntType>()) {
       llvm_val[stmt] = load_as_custom_int(llvm_val[stmt->src], val_type);
@@ -1354,9 +1562,15 @@ void CodeGenLLVM::visit(GlobalLoadStmt *stmt) {
     } else {
       TI_NOT_IMPLEMENTED
     }
+  } else if (ptr_type->get_pointee_type()->is_primitive(
+                 PrimitiveTypeID::bf16)) {
+    llvm_val[stmt] = bf16_to_f32(builder->CreateLoad(
+        llvm::Type::getInt16Ty(*llvm_context), llvm_val[stmt->src]));
   } else {
-    llvm_val[stmt] = builder->CreateLoad(tlctx->get_data_type(stmt->ret_type),
-                                         llvm_val[stmt->src]);
+    auto *load = builder->CreateLoad(tlctx->get_data_type(stmt->ret_type),
+                                     llvm_val[stmt->src]);
+    annotate_alias_scope(load, stmt->src);
+    llvm_val[stmt] = load;
   }
 }
 
@@ -1506,6 +1720,7 @@ void CodeGenLLVM::visit(SNodeLookupStmt *stmt) {
     llvm_val[stmt] = builder->CreateGEP(parent, llvm_val[stmt->input_index]);
   } else if (snode->type == SNodeType::dense ||
              snode->type == SNodeType::pointer ||
+             snode->type == SNodeType::hash ||
              snode->type == SNodeType::dynamic ||
              snode->type == SNodeType::bitmasked) {
     if (stmt->activate) {
@@ -1550,14 +1765,15 @@ void CodeGenLLVM::visit(GetChStmt *stmt) {
 }
 
 void CodeGenLLVM::visit(PtrOffsetStmt *stmt) {
-  auto origin_address = builder->CreatePtrToInt(
-      llvm_val[stmt->origin], llvm::Type::getInt64Ty(*llvm_context));
-  auto address_offset = builder->CreateSExt(
-      llvm_val[stmt->offset], llvm::Type::getInt64Ty(*llvm_context));
-  auto target_address = builder->CreateAdd(origin_address, address_offset);
+  // A byte offset from the origin rather than integer arithmetic on the
+  // address, so that the alias analysis can still trace the pointer back
+  // to its origin.
+  auto origin = builder->CreateBitCast(llvm_val[stmt->origin],
+                                       llvm::Type::getInt8PtrTy(*llvm_context));
+  auto ptr = builder->CreateGEP(origin, llvm_val[stmt->offset]);
   auto dt = stmt->ret_type.ptr_removed();
-  llvm_val[stmt] = builder->CreateIntToPtr(
-      target_address, llvm::PointerType::get(tlctx->get_data_type(dt), 0));
+  llvm_val[stmt] = builder->CreateBitCast(
+      ptr, llvm::PointerType::get(tlctx->get_data_type(dt), 0));
 }
 
 void CodeGenLLVM::visit(ExternalPtrStmt *stmt) {
@@ -1566,14 +1782,11 @@ void CodeGenLLVM::visit(ExternalPtrStmt *stmt) {
   auto argload = stmt->base_ptrs[0]->as<ArgLoadStmt>();
   auto arg_id = argload->arg_id;
   int num_indices = stmt->indices.size();
-  std::vector<llvm::Value *> sizes(num_indices);
-
-  for (int i = 0; i < num_indices; i++) {
-    auto raw_arg = create_call(
+  auto get_extra_arg = [&](int i) {
+    return create_call(
         "RuntimeContext_get_extra_args",
         {get_context(), tlctx->get_constant(arg_id), tlctx->get_constant(i)});
-    sizes[i] = raw_arg;
-  }
+  };
 
   auto dt = stmt->ret_type.ptr_removed();
   auto base = builder->CreateBitCast(
@@ -1581,9 +1794,19 @@ void CodeGenLLVM::visit(ExternalPtrStmt *stmt) {
       llvm::PointerType::get(tlctx->get_data_type(dt), 0));
 
   auto linear_index = tlctx->get_constant(0);
-  for (int i = 0; i < num_indices; i++) {
-    linear_index = builder->CreateMul(linear_index, sizes[i]);
-    linear_index = builder->CreateAdd(linear_index, llvm_val[stmt->indices[i]]);
+  if (kernel->args[arg_id].is_strided) {
+    // The strides follow the shape in the extra args.
+    for (int i = 0; i < num_indices; i++) {
+      auto offset = builder->CreateMul(llvm_val[stmt->indices[i]],
+                                       get_extra_arg(num_indices + i));
+      linear_index = builder->CreateAdd(linear_index, offset);
+    }
+  } else {
+    for (int i = 0; i < num_indices; i++) {
+      linear_index = builder->CreateMul(linear_index, get_extra_arg(i));
+      linear_index =
+          builder->CreateAdd(linear_index, llvm_val[stmt->indices[i]]);
+    }
   }
 
   llvm_val[stmt] = builder->CreateGEP(base, linear_index);
@@ -1601,14 +1824,15 @@ std::string CodeGenLLVM::init_offloaded_task_function(OffloadedStmt *stmt,
                                                       std::string suffix) {
   current_loop_reentry = nullptr;
   current_while_after_loop = nullptr;
+  rand_counter = nullptr;
 
   task_function_type =
       llvm::FunctionType::get(llvm::Type::getVoidTy(*llvm_context),
                               {llvm::PointerType::get(context_ty, 0)}, false);
 
-  auto task_kernel_name = fmt::format("{}_{}_{}{}", kernel_name, task_counter,
-                                      stmt->task_name(), suffix);
-  task_counter += 1;
+  auto task_kernel_name =
+      fmt::format("{}_{}_{}{}", kernel_name, task_counter.fetch_add(1),
+                  stmt->task_name(), suffix);
   func = llvm::Function::Create(task_function_type,
                                 llvm::Function::ExternalLinkage,
                                 task_kernel_name, module.get());
@@ -1673,6 +1897,82 @@ std::tuple<llvm::Value *, llvm::Value *> CodeGenLLVM::get_range_for_bounds(
   return std::tuple(begin, end);
 }
 
+bool CodeGenLLVM::is_innermost_loop(OffloadedStmt *stmt) {
+  return irpass::analysis::gather_statements(stmt->body.get(), [](Stmt *s) {
+           return s->is<RangeForStmt>() || s->is<StructForStmt>() ||
+                  s->is<MeshForStmt>() || s->is<WhileStmt>();
+         })
+      .empty();
+}
+
+void CodeGenLLVM::annotate_alias_scope(llvm::Instruction *inst, Stmt *ptr) {
+  // Different place SNodes never share memory, nor do SNodes and external
+  // arrays. External arrays are not assumed to be distinct from each other,
+  // since the same array may be passed twice. Pointers offset from their
+  // origin (e.g. into another element of a matrix field) are left alone.
+  const int kExternal = -1;
+  int key;
+  if (auto *get_ch = ptr->cast<GetChStmt>()) {
+    key = get_ch->output_snode->id;
+  } else if (auto *global_ptr = ptr->cast<GlobalPtrStmt>()) {
+    key = global_ptr->snodes[0]->id;
+  } else if (ptr->is<ExternalPtrStmt>()) {
+    key = kExternal;
+  } else {
+    return;
+  }
+  llvm::MDBuilder md_builder(*llvm_context);
+  if (!alias_scope_domain) {
+    alias_scope_domain = md_builder.createAnonymousAliasScopeDomain("taichi");
+  }
+  llvm::MDNode *scope = nullptr;
+  std::vector<llvm::Metadata *> other_scopes;
+  for (auto &[k, s] : alias_scopes) {
+    if (k == key) {
+      scope = s;
+    } else {
+      other_scopes.push_back(s);
+    }
+  }
+  if (!scope) {
+    scope = md_builder.createAnonymousAliasScope(alias_scope_domain);
+    alias_scopes.emplace_back(key, scope);
+  }
+  inst->setMetadata(llvm::LLVMContext::MD_alias_scope,
+                    llvm::MDNode::get(*llvm_context, {scope}));
+  // The accesses annotated earlier might not list |scope|, but LLVM needs
+  // only one of two accesses to list the scope of the other one.
+  if (!other_scopes.empty()) {
+    inst->setMetadata(llvm::LLVMContext::MD_noalias,
+                      llvm::MDNode::get(*llvm_context, other_scopes));
+  }
+}
+
+llvm::MDNode *CodeGenLLVM::get_vectorize_loop_metadata(int width) {
+  auto *true_md = llvm::ConstantAsMetadata::get(builder->getTrue());
+  std::vector<llvm::Metadata *> operands;
+  operands.push_back(nullptr);  // Self-reference, filled below
+  operands.push_back(llvm::MDNode::get(
+      *llvm_context,
+      {llvm::MDString::get(*llvm_context, "llvm.loop.vectorize.enable"),
+       true_md}));
+  if (width > 1) {
+    operands.push_back(llvm::MDNode::get(
+        *llvm_context,
+        {llvm::MDString::get(*llvm_context, "llvm.loop.vectorize.width"),
+         llvm::ConstantAsMetadata::get(builder->getInt32(width))}));
+  }
+  // Fold the remainder of a block into a masked vector iteration.
+  operands.push_back(llvm::MDNode::get(
+      *llvm_context,
+      {llvm::MDString::get(*llvm_context,
+                           "llvm.loop.vectorize.predicate.enable"),
+       true_md}));
+  auto *loop_id = llvm::MDNode::getDistinct(*llvm_context, operands);
+  loop_id->replaceOperandWith(0, loop_id);
+  return loop_id;
+}
+
 void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
   using namespace llvm;
   // TODO: instead of constructing tons of LLVM IR, writing the logic in
@@ -1799,6 +2099,11 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
 
     builder->CreateBr(loop_test_bb);
 
+    // Serial loops over bitmasked nodes skip to the next active cell, a mask
+    // word at a time.
+    const bool skip_inactive =
+        !spmd && leaf_block->type == SNodeType::bitmasked;
+
     {
       // loop_test:
       //   if (loop_index < upper_bound)
@@ -1807,6 +2112,12 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
       //     goto func_exit
 
       builder->SetInsertPoint(loop_test_bb);
+      if (skip_inactive) {
+        builder->CreateStore(
+            call(leaf_block, element.get("element"), "next_active",
+                 {builder->CreateLoad(loop_index), upper_bound}),
+            loop_index);
+      }
       auto cond =
           builder->CreateICmp(llvm::CmpInst::Predicate::ICMP_SLT,
                               builder->CreateLoad(loop_index), upper_bound);
@@ -1820,8 +2131,13 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
     // initialize the coordinates
     auto new_coordinates = create_entry_block_alloca(physical_coordinate_ty);
 
-    create_call(refine, {parent_coordinates, new_coordinates,
-                         builder->CreateLoad(loop_index)});
+    // The elements of a hash node are its slots, each holding one cell.
+    llvm::Value *cell_index = builder->CreateLoad(loop_index);
+    if (leaf_block->type == SNodeType::hash) {
+      cell_index = call(leaf_block, element.get("element"), "get_cell_index",
+                        {cell_index});
+    }
+    create_call(refine, {parent_coordinates, new_coordinates, cell_index});
 
     // One more refine step is needed for bit_arrays to make final coordinates
     // non-consecutive, since each thread will process multiple
@@ -1873,7 +2189,7 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
       }
     }
 
-    if (snode->type == SNodeType::bitmasked ||
+    if ((snode->type == SNodeType::bitmasked && !skip_inactive) ||
         snode->type == SNodeType::pointer) {
       // test whether the current voxel is active or not
       auto is_active = call(snode, element.get("element"), "is_active",
@@ -1881,6 +2197,12 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
       is_active =
           builder->CreateTrunc(is_active, llvm::Type::getInt1Ty(*llvm_context));
       exec_cond = builder->CreateAnd(exec_cond, is_active);
+    } else if (snode->type == SNodeType::hash) {
+      auto is_active = call(snode, element.get("element"), "is_slot_active",
+                            {builder->CreateLoad(loop_index)});
+      is_active =
+          builder->CreateTrunc(is_active, llvm::Type::getInt1Ty(*llvm_context));
+      exec_cond = builder->CreateAnd(exec_cond, is_active);
     }
 
     builder->CreateCondBr(exec_cond, struct_for_body_bb, body_tail_bb);
@@ -1919,11 +2241,19 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
     }
   }
 
-  int list_element_size = std::min(leaf_block->max_num_elements(),
+  const int64 leaf_num_elements = leaf_block->type == SNodeType::hash
+                                      ? leaf_block->hash_capacity
+                                      : leaf_block->max_num_elements();
+  int list_element_size = std::min(leaf_num_elements,
                                    (int64)taichi_listgen_max_element_size);
   int num_splits = std::max(1, list_element_size / stmt->block_dim);
 
-  auto struct_for_func = get_runtime_function("parallel_struct_for");
+  // The BLS prologue loads a whole element, so it's not split.
+  const bool dynamic = arch_is_gpu(current_arch()) &&
+                       prog->config.cuda_dynamic_struct_for &&
+                       !stmt->bls_prologue;
+  auto struct_for_func = get_runtime_function(
+      dynamic ? "gpu_parallel_struct_for_dynamic" : "parallel_struct_for");
 
   if (arch_is_gpu(current_arch())) {
     // Note that on CUDA local array allocation must have a compile-time
@@ -1964,13 +2294,34 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
     struct_for_func = patched_struct_for_func;
   }
   // Loop over nodes in the element list, in parallel
-  create_call(
-      struct_for_func,
-      {get_context(), tlctx->get_constant(leaf_block->id),
-       tlctx->get_constant(list_element_size), tlctx->get_constant(num_splits),
-       body, tlctx->get_constant(stmt->tls_size),
-       tlctx->get_constant(stmt->num_cpu_threads)});
-  // TODO: why do we need num_cpu_threads on GPUs?
+  if (dynamic) {
+    // The work item claimed by a block, in shared memory.
+    auto i32_ty = llvm::Type::getInt32Ty(*llvm_context);
+    auto claim = new GlobalVariable(
+        *module, i32_ty, false, llvm::GlobalValue::InternalLinkage,
+        llvm::UndefValue::get(i32_ty), "struct_for_claim", nullptr,
+        llvm::GlobalVariable::NotThreadLocal, 3 /*addrspace=shared*/);
+    create_call(
+        struct_for_func,
+        {get_context(), tlctx->get_constant(leaf_block->id),
+         tlctx->get_constant(list_element_size),
+         tlctx->get_constant(num_splits), body,
+         builder->CreateAddrSpaceCast(claim,
+                                      llvm::PointerType::get(i32_ty, 0))});
+  } else {
+    // Prefetching is done by the CPU block helper only.
+    const int prefetch_distance =
+        prog->config.cpu_struct_for_prefetch_distance;
+    create_call(
+        struct_for_func,
+        {get_context(), tlctx->get_constant(leaf_block->id),
+         tlctx->get_constant(list_element_size),
+         tlctx->get_constant(num_splits), body,
+         tlctx->get_constant(stmt->tls_size),
+         tlctx->get_constant(stmt->num_cpu_threads),
+         tlctx->get_constant(prefetch_distance)});
+    // TODO: why do we need num_cpu_threads on GPUs?
+  }
 
   current_coordinates = nullptr;
   parent_coordinates = nullptr;
@@ -2067,6 +2418,35 @@ void CodeGenLLVM::visit(BlockLocalPtrStmt *stmt) {
 
 void CodeGenLLVM::visit(ClearListStmt *stmt) {
   auto snode_child = stmt->snode;
+  // The number of elements of a dynamic SNode changes without activating or
+  // deactivating any cell, so its lists are always regenerated.
+  std::vector<int> ancestors;
+  bool cached = prog->config.cache_element_lists && !prog->config.async_mode;
+  for (auto s = snode_child; s; s = s->parent) {
+    if (s->type == SNodeType::dynamic) {
+      cached = false;
+    }
+    if (s != snode_child) {
+      ancestors.push_back(s->id);
+    }
+  }
+  if (cached) {
+    auto ids = create_entry_block_alloca(
+        llvm::ArrayType::get(llvm::Type::getInt32Ty(*llvm_context),
+                             ancestors.size()));
+    for (int i = 0; i < (int)ancestors.size(); i++) {
+      builder->CreateStore(
+          tlctx->get_constant(ancestors[i]),
+          builder->CreateGEP(ids,
+                             {tlctx->get_constant(0), tlctx->get_constant(i)}));
+    }
+    call("clear_list_if_outdated", get_runtime(),
+         cast_pointer(emit_struct_meta(snode_child), "StructMeta"),
+         builder->CreateGEP(ids,
+                            {tlctx->get_constant(0), tlctx->get_constant(0)}),
+         tlctx->get_constant((int)ancestors.size()));
+    return;
+  }
   auto snode_parent = stmt->snode->parent;
   auto meta_child = cast_pointer(emit_struct_meta(snode_child), "StructMeta");
   auto meta_parent = cast_pointer(emit_struct_meta(snode_parent), "StructMeta");
@@ -2078,6 +2458,9 @@ void CodeGenLLVM::visit(InternalFuncStmt *stmt) {
   for (auto s : stmt->args) {
     args.push_back(llvm_val[s]);
   }
+  for (auto s : stmt->output_stmts) {
+    args.push_back(llvm_val[s]);
+  }
   llvm_val[stmt] = create_call(stmt->func_name, args);
 }
 
@@ -2085,6 +2468,17 @@ void CodeGenLLVM::visit(AdStackAllocaStmt *stmt) {
   TI_ASSERT(stmt->width() == 1);
   TI_ASSERT_INFO(stmt->max_size > 0,
                  "Adaptive autodiff stack's size should have been determined.");
+  if (stmt->max_size <=
+      (std::size_t)prog->config.ad_stack_max_size_in_registers) {
+    auto &regs = ad_stack_registers[stmt];
+    regs.size = create_entry_block_alloca(PrimitiveType::i32);
+    for (int i = 0; i < (int)stmt->max_size; i++) {
+      regs.primal.push_back(create_entry_block_alloca(stmt->ret_type));
+      regs.adjoint.push_back(create_entry_block_alloca(stmt->ret_type));
+    }
+    builder->CreateStore(tlctx->get_constant(0), regs.size);
+    return;
+  }
   auto type = llvm::ArrayType::get(llvm::Type::getInt8Ty(*llvm_context),
                                    stmt->size_in_bytes());
   auto alloca = create_entry_block_alloca(type, sizeof(int64));
@@ -2093,12 +2487,57 @@ void CodeGenLLVM::visit(AdStackAllocaStmt *stmt) {
   call("stack_init", llvm_val[stmt]);
 }
 
+llvm::Value *CodeGenLLVM::load_ad_stack_slot(
+    const std::vector<llvm::Value *> &slots,
+    llvm::Value *index) {
+  llvm::Value *value = builder->CreateLoad(slots[0]);
+  for (int i = 1; i < (int)slots.size(); i++) {
+    value = builder->CreateSelect(
+        builder->CreateICmpEQ(index, tlctx->get_constant(i)),
+        builder->CreateLoad(slots[i]), value);
+  }
+  return value;
+}
+
+void CodeGenLLVM::store_ad_stack_slot(const std::vector<llvm::Value *> &slots,
+                                      llvm::Value *index,
+                                      llvm::Value *value) {
+  // Storing to every slot (most of them their own value) keeps the stores
+  // unconditional, so that the slots stay promotable to registers.
+  for (int i = 0; i < (int)slots.size(); i++) {
+    builder->CreateStore(
+        builder->CreateSelect(
+            builder->CreateICmpEQ(index, tlctx->get_constant(i)), value,
+            builder->CreateLoad(slots[i])),
+        slots[i]);
+  }
+}
+
 void CodeGenLLVM::visit(AdStackPopStmt *stmt) {
+  if (auto it = ad_stack_registers.find(stmt->stack);
+      it != ad_stack_registers.end()) {
+    auto size = it->second.size;
+    builder->CreateStore(
+        builder->CreateSub(builder->CreateLoad(size), tlctx->get_constant(1)),
+        size);
+    return;
+  }
   call("stack_pop", llvm_val[stmt->stack]);
 }
 
 void CodeGenLLVM::visit(AdStackPushStmt *stmt) {
   auto stack = stmt->stack->as<AdStackAllocaStmt>();
+  if (auto it = ad_stack_registers.find(stack);
+      it != ad_stack_registers.end()) {
+    auto &regs = it->second;
+    auto top = builder->CreateLoad(regs.size);
+    builder->CreateStore(builder->CreateAdd(top, tlctx->get_constant(1)),
+                         regs.size);
+    store_ad_stack_slot(regs.primal, top, llvm_val[stmt->v]);
+    store_ad_stack_slot(regs.adjoint, top,
+                        tlctx->get_constant(stack->ret_type, 0));
+    return;
+  }
   call("stack_push", llvm_val[stack], tlctx->get_constant(stack->max_size),
        tlctx->get_constant(stack->element_size_in_bytes()));
   auto primal_ptr = call("stack_top_primal", llvm_val[stack],
@@ -2111,6 +2550,14 @@ void CodeGenLLVM::visit(AdStackPushStmt *stmt) {
 
 void CodeGenLLVM::visit(AdStackLoadTopStmt *stmt) {
   auto stack = stmt->stack->as<AdStackAllocaStmt>();
+  if (auto it = ad_stack_registers.find(stack);
+      it != ad_stack_registers.end()) {
+    auto &regs = it->second;
+    auto top = builder->CreateSub(builder->CreateLoad(regs.size),
+                                  tlctx->get_constant(1));
+    llvm_val[stmt] = load_ad_stack_slot(regs.primal, top);
+    return;
+  }
   auto primal_ptr = call("stack_top_primal", llvm_val[stack],
                          tlctx->get_constant(stack->element_size_in_bytes()));
   primal_ptr = builder->CreateBitCast(
@@ -2121,6 +2568,14 @@ void CodeGenLLVM::visit(AdStackLoadTopStmt *stmt) {
 
 void CodeGenLLVM::visit(AdStackLoadTopAdjStmt *stmt) {
   auto stack = stmt->stack->as<AdStackAllocaStmt>();
+  if (auto it = ad_stack_registers.find(stack);
+      it != ad_stack_registers.end()) {
+    auto &regs = it->second;
+    auto top = builder->CreateSub(builder->CreateLoad(regs.size),
+                                  tlctx->get_constant(1));
+    llvm_val[stmt] = load_ad_stack_slot(regs.adjoint, top);
+    return;
+  }
   auto adjoint = call("stack_top_adjoint", llvm_val[stack],
                       tlctx->get_constant(stack->element_size_in_bytes()));
   adjoint = builder->CreateBitCast(
@@ -2130,13 +2585,23 @@ void CodeGenLLVM::visit(AdStackLoadTopAdjStmt *stmt) {
 
 void CodeGenLLVM::visit(AdStackAccAdjointStmt *stmt) {
   auto stack = stmt->stack->as<AdStackAllocaStmt>();
+  TI_ASSERT(is_real(stmt->v->ret_type));
+  if (auto it = ad_stack_registers.find(stack);
+      it != ad_stack_registers.end()) {
+    auto &regs = it->second;
+    auto top = builder->CreateSub(builder->CreateLoad(regs.size),
+                                  tlctx->get_constant(1));
+    auto old_val = load_ad_stack_slot(regs.adjoint, top);
+    store_ad_stack_slot(regs.adjoint, top,
+                        builder->CreateFAdd(old_val, llvm_val[stmt->v]));
+    return;
+  }
   auto adjoint_ptr = call("stack_top_adjoint", llvm_val[stack],
                           tlctx->get_constant(stack->element_size_in_bytes()));
   adjoint_ptr = builder->CreateBitCast(
       adjoint_ptr,
       llvm::PointerType::get(tlctx->get_data_type(stack->ret_type), 0));
   auto old_val = builder->CreateLoad(adjoint_ptr);
-  TI_ASSERT(is_real(stmt->v->ret_type));
   auto new_val = builder->CreateFAdd(old_val, llvm_val[stmt->v]);
   builder->CreateStore(new_val, adjoint_ptr);
 }
@@ -2219,6 +2684,7 @@ void CodeGenLLVM::visit(MeshPatchIndexStmt *stmt) {
 }
 
 void CodeGenLLVM::eliminate_unused_functions() {
+  tlctx->link_struct_functions(module.get());
   TaichiLLVMContext::eliminate_unused_functions(
       module.get(), [&](std::string func_name) {
         for (auto &task : offloaded_tasks) {
@@ -2229,35 +2695,101 @@ void CodeGenLLVM::eliminate_unused_functions() {
       });
 }
 
+namespace {
+
+// For taichi ndarrays, context.args saves pointer to its |DeviceAllocation|,
+// CPU backend actually want to use the raw ptr here.
+void set_ndarray_host_ptrs(Kernel *kernel, RuntimeContext &context) {
+  auto &args = kernel->args;
+  for (int i = 0; i < (int)args.size(); i++) {
+    if (args[i].is_external_array && context.is_device_allocation[i] &&
+        args[i].size > 0) {
+      DeviceAllocation *ptr =
+          static_cast<DeviceAllocation *>(context.get_arg<void *>(i));
+      uint64 host_ptr = (uint64)kernel->program->get_llvm_program_impl()
+                            ->get_ndarray_alloc_info_ptr(*ptr);
+      context.set_arg(i, host_ptr);
+      context.set_device_allocation(i, false);
+    }
+  }
+}
+
+// The tasks of a kernel compiled in tiers, shared by its launcher and the
+// background compilation of the optimized version.
+struct TieredTasks {
+  std::vector<OffloadedTask> unoptimized;
+  std::vector<OffloadedTask::task_fp_type> optimized;
+  std::atomic<bool> optimized_ready{false};
+  int num_launches{0};
+  std::string bitcode;
+};
+
+}  // namespace
+
 FunctionType CodeGenLLVM::compile_module_to_executable() {
   TI_AUTO_PROF
   eliminate_unused_functions();
 
-  tlctx->add_module(std::move(module));
+  if (prog->config.cpu_tiered_jit_launches > 0) {
+    return compile_module_to_tiered_executable();
+  }
+
+  auto *jit_module = tlctx->add_module(std::move(module));
 
   for (auto &task : offloaded_tasks) {
-    task.compile();
+    task.compile(jit_module);
   }
   auto offloaded_tasks_local = offloaded_tasks;
   auto kernel_name_ = kernel_name;
   return [offloaded_tasks_local, kernel_name_,
           kernel = this->kernel](RuntimeContext &context) {
     TI_TRACE("Launching kernel {}", kernel_name_);
-    auto args = kernel->args;
-    // For taichi ndarrays, context.args saves pointer to its
-    // |DeviceAllocation|, CPU backend actually want to use the raw ptr here.
-    for (int i = 0; i < (int)args.size(); i++) {
-      if (args[i].is_external_array && context.is_device_allocation[i] &&
-          args[i].size > 0) {
-        DeviceAllocation *ptr =
-            static_cast<DeviceAllocation *>(context.get_arg<void *>(i));
-        uint64 host_ptr = (uint64)kernel->program->get_llvm_program_impl()
-                              ->get_ndarray_alloc_info_ptr(*ptr);
-        context.set_arg(i, host_ptr);
-        context.set_device_allocation(i, false);
+    set_ndarray_host_ptrs(kernel, context);
+    for (auto task : offloaded_tasks_local) {
+      task(&context);
+    }
+  };
+}
+
+FunctionType CodeGenLLVM::compile_module_to_tiered_executable() {
+  TI_AUTO_PROF
+  auto tiered = std::make_shared<TieredTasks>();
+  {
+    llvm::raw_string_ostream os(tiered->bitcode);
+    llvm::WriteBitcodeToFile(*module, os);
+  }
+  auto *jit_module = tlctx->add_module_unoptimized(std::move(module));
+
+  for (auto &task : offloaded_tasks) {
+    task.compile(jit_module);
+  }
+  tiered->unoptimized = offloaded_tasks;
+  const int hot_launches = prog->config.cpu_tiered_jit_launches;
+  auto kernel_name_ = kernel_name;
+  return [tiered, hot_launches, kernel_name_, tlctx = this->tlctx,
+          kernel = this->kernel](RuntimeContext &context) {
+    TI_TRACE("Launching kernel {}", kernel_name_);
+    set_ndarray_host_ptrs(kernel, context);
+    if (tiered->optimized_ready.load(std::memory_order_acquire)) {
+      for (auto func : tiered->optimized) {
+        func(&context);
       }
+      return;
     }
-    for (auto task : offloaded_tasks_local) {
+    if (++tiered->num_launches == hot_launches) {
+      // The kernel is hot. Keeps launching the unoptimized tasks until the
+      // optimized ones are compiled.
+      tlctx->add_module_in_background(
+          std::move(tiered->bitcode), [tiered](JITModule *module) {
+            for (auto &task : tiered->unoptimized) {
+              tiered->optimized.push_back(
+                  (OffloadedTask::task_fp_type)module->lookup_function(
+                      task.name));
+            }
+            tiered->optimized_ready.store(true, std::memory_order_release);
+          });
+    }
+    for (auto task : tiered->unoptimized) {
       task(&context);
     }
   };
@@ -2333,6 +2865,8 @@ llvm::Value *CodeGenLLVM::emit_struct_meta(SNode *snode) {
 
 void CodeGenLLVM::emit_to_module() {
   TI_AUTO_PROF
+  ScopedCompileStage stage(
+      kernel_name, fmt::format("emit LLVM IR ({})", arch_name(kernel->arch)));
   ir->accept(this);
 }
 
@@ -2341,6 +2875,19 @@ FunctionType CodeGenLLVM::gen() {
   return compile_module_to_executable();
 }
 
+std::unique_ptr<LlvmModuleGenValue> CodeGenLLVM::modulegen() {
+  TI_AUTO_PROF
+  emit_to_module();
+  eliminate_unused_functions();
+  finalize_module();
+  auto ret = std::make_unique<LlvmModuleGenValue>();
+  for (const auto &task : offloaded_tasks) {
+    ret->tasks.push_back({task.name, task.block_dim, task.grid_dim});
+  }
+  ret->module = std::move(module);
+  return ret;
+}
+
 llvm::Value *CodeGenLLVM::create_xlogue(std::unique_ptr<Block> &block) {
   llvm::Value *xlogue;
 
@@ -2,11 +2,13 @@
 #pragma once
 #ifdef TI_WITH_LLVM
 
+#include <atomic>
 #include <set>
 #include <unordered_map>
 
 #include "taichi/ir/ir.h"
 #include "taichi/program/program.h"
+#include "taichi/llvm/llvm_aot_data.h"
 #include "taichi/llvm/llvm_codegen_utils.h"
 
 TLANG_NAMESPACE_BEGIN
@@ -22,6 +24,9 @@ class OffloadedTask {
 
   int block_dim;
   int grid_dim;
+  // The shared memory allocated at launch, for the BLS buffers which do not
+  // fit in the static shared memory on CUDA.
+  std::size_t dynamic_shared_array_bytes{0};
 
   OffloadedTask(CodeGenLLVM *codegen);
 
@@ -29,11 +34,20 @@ class OffloadedTask {
 
   void end();
 
-  void compile();
+  // Looks up the task in @param module, which holds the kernel. Not in the
+  // whole JIT session, whose modules may be shared by several programs, see
+  // CompileConfig::soft_reset.
+  void compile(JITModule *module);
 
   void operator()(RuntimeContext *context);
 };
 
+// A kernel emitted for AOT compilation, not yet added to a JIT session.
+struct LlvmModuleGenValue {
+  std::unique_ptr<llvm::Module> module;
+  std::vector<LlvmOffloadedTask> tasks;
+};
+
 class FunctionCreationGuard {
  public:
   CodeGenLLVM *mb;
@@ -49,7 +63,7 @@ class FunctionCreationGuard {
 
 class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
  public:
-  static uint64 task_counter;
+  static std::atomic<uint64> task_counter;
 
   Kernel *kernel;
   IRNode *ir;
@@ -62,6 +76,9 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
   llvm::Value *parent_coordinates{nullptr};
   llvm::Value *block_corner_coordinates{nullptr};
   llvm::GlobalVariable *bls_buffer{nullptr};
+  // The number of random numbers drawn by the current iteration of the
+  // offloaded loop, see visit_counter_based_rand().
+  llvm::Value *rand_counter{nullptr};
   // Mainly for supporting continue stmt
   llvm::BasicBlock *current_loop_reentry;
   // Mainly for supporting break stmt
@@ -77,6 +94,22 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   std::unordered_map<const Stmt *, std::vector<llvm::Value *>> loop_vars_llvm;
 
+  // An AD-stack of at most CompileConfig::ad_stack_max_size_in_registers
+  // entries, kept in a scalar alloca per entry instead of a byte array, so
+  // that the entries are promoted to registers. The top entry is then
+  // selected by comparing its index with each slot.
+  struct AdStackRegisters {
+    llvm::Value *size{nullptr};
+    std::vector<llvm::Value *> primal;
+    std::vector<llvm::Value *> adjoint;
+  };
+  std::unordered_map<const Stmt *, AdStackRegisters> ad_stack_registers;
+
+  // The alias scopes of the global memory accessed by the kernel, in the order
+  // of creation, see annotate_alias_scope().
+  llvm::MDNode *alias_scope_domain{nullptr};
+  std::vector<std::pair<int, llvm::MDNode *>> alias_scopes;
+
   using IRVisitor::visit;
   using LLVMModuleBuilder::call;
 
@@ -122,10 +155,21 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   void eliminate_unused_functions();
 
+  // Backend-specific touches to the module before it is compiled.
+  virtual void finalize_module() {
+  }
+
   virtual FunctionType compile_module_to_executable();
 
+  // Adds the module without optimizing it, and optimizes it in the background
+  // once the kernel is launched CompileConfig::cpu_tiered_jit_launches times.
+  FunctionType compile_module_to_tiered_executable();
+
   virtual FunctionType gen();
 
+  // AOT Module Gen
+  std::unique_ptr<LlvmModuleGenValue> modulegen();
+
   // For debugging only
   virtual llvm::Value *create_print(std::string tag,
                                     DataType dt,
@@ -168,6 +212,8 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   void visit(RandStmt *stmt) override;
 
+  void visit_counter_based_rand(RandStmt *stmt);
+
   llvm::Value *cast_int(llvm::Value *input_val, Type *from, Type *to);
 
   virtual void emit_extra_unary(UnaryOpStmt *stmt);
@@ -270,6 +316,12 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   llvm::Value *load_custom_float(Stmt *ptr_stmt);
 
+  // Decodes |member| of a bit_struct from the physical word |bit_struct_val|.
+  // The bit offsets are constants, so the decodes of sibling members share
+  // a single load of the word and can be vectorized together.
+  llvm::Value *extract_bit_struct_member(llvm::Value *bit_struct_val,
+                                         SNode *member);
+
   void visit(GlobalLoadStmt *stmt) override;
 
   void visit(ElementShuffleStmt *stmt) override;
@@ -310,6 +362,19 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
   std::tuple<llvm::Value *, llvm::Value *> get_range_for_bounds(
       OffloadedStmt *stmt);
 
+  // Whether the loop of |stmt| has no nested loops. LLVM only vectorizes
+  // innermost loops.
+  static bool is_innermost_loop(OffloadedStmt *stmt);
+
+  // Loop metadata forcing LLVM to vectorize a loop with |width| lanes (or a
+  // width of its choice if |width| <= 1).
+  llvm::MDNode *get_vectorize_loop_metadata(int width);
+
+  // Tells LLVM that |inst|, a load or a store through |ptr|, does not alias
+  // the accesses to the other place SNodes, or to external arrays if |ptr|
+  // points into a SNode, so that it can hoist and vectorize around it.
+  void annotate_alias_scope(llvm::Instruction *inst, Stmt *ptr);
+
   virtual void create_offload_range_for(OffloadedStmt *stmt) = 0;
 
   virtual void create_offload_mesh_for(OffloadedStmt *stmt) {
@@ -352,6 +417,15 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   void visit(AdStackAccAdjointStmt *stmt) override;
 
+  // Returns the value of the entry of |slots| at |index|.
+  llvm::Value *load_ad_stack_slot(const std::vector<llvm::Value *> &slots,
+                                  llvm::Value *index);
+
+  // Stores |value| to the entry of |slots| at |index|.
+  void store_ad_stack_slot(const std::vector<llvm::Value *> &slots,
+                           llvm::Value *index,
+                           llvm::Value *value);
+
   void visit(RangeAssumptionStmt *stmt) override;
 
   void visit(LoopUniqueStmt *stmt) override;
@@ -377,11 +451,21 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   llvm::Value *get_exponent_offset(llvm::Value *exponent, CustomFloatType *cft);
 
-  llvm::Value *atomic_op_using_cas(
+  // A compare-and-swap loop on a 16-bit |dest|, updated with |op|.
+  virtual llvm::Value *atomic_op_using_cas(
       llvm::Value *dest,
       llvm::Value *val,
       std::function<llvm::Value *(llvm::Value *, llvm::Value *)> op);
 
+  // bf16 values are stored as i16 and converted to f32 on load, since LLVM
+  // 10 has no bfloat type.
+  llvm::Value *f32_to_bf16(llvm::Value *val);
+
+  llvm::Value *bf16_to_f32(llvm::Value *bits);
+
+  // Atomics on a bf16 destination, or nullptr for other destinations.
+  llvm::Value *atomic_op_bf16(AtomicOpStmt *stmt);
+
   ~CodeGenLLVM() override = default;
 };
 
@@ -669,6 +669,21 @@ llvm::Value *CodeGenLLVM::load_custom_float(Stmt *ptr_stmt) {
   }
 }
 
+llvm::Value *CodeGenLLVM::extract_bit_struct_member(
+    llvm::Value *bit_struct_val,
+    SNode *member) {
+  auto bit_offset = tlctx->get_constant(member->bit_offset);
+  if (auto cft = member->dt->cast<CustomFloatType>()) {
+    if (cft->get_exponent_type()) {
+      return reconstruct_float_from_bit_struct(bit_struct_val, member);
+    }
+    auto digits = extract_custom_int(bit_struct_val, bit_offset,
+                                     cft->get_digits_type());
+    return reconstruct_custom_float(digits, cft);
+  }
+  return extract_custom_int(bit_struct_val, bit_offset, member->dt);
+}
+
 TLANG_NAMESPACE_END
 
 #endif  // #ifdef TI_WITH_LLVM
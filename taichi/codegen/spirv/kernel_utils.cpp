@@ -59,6 +59,7 @@ KernelContextAttributes::KernelContextAttributes(const Kernel &kernel)
                data_type_name(aa.dt));
     }
     aa.is_array = ka.is_external_array;
+    aa.is_texture = ka.is_texture;
     // For array, |ka.size| is #elements * elements_size
     aa.stride = aa.is_array ? ka.size : dt_bytes;
     aa.index = arg_attribs_vec_.size();
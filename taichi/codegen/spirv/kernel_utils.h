@@ -72,6 +72,14 @@ struct TaskAttributes {
     TI_IO_DEF(buffer, binding);
   };
 
+  // A texture argument of the kernel, bound as a combined image sampler.
+  struct TextureBind {
+    int arg_id{0};
+    int binding{0};
+
+    TI_IO_DEF(arg_id, binding);
+  };
+
   std::string name;
   // Total number of threads to launch (i.e. threads per grid). Note that this
   // is only advisory, because eventually this number is also determined by the
@@ -99,6 +107,13 @@ struct TaskAttributes {
     TI_IO_DEF(begin, end, const_begin, const_end);
   };
   std::vector<BufferBind> buffer_binds;
+  // Bound after |buffer_binds|, in the same descriptor set.
+  std::vector<TextureBind> texture_binds;
+  // The buffers in |buffer_binds| that the task actually accesses, and the
+  // subset of them that it may write to. The runtime uses them to omit the
+  // barriers between independent tasks.
+  std::vector<BufferInfo> accessed_buffers;
+  std::vector<BufferInfo> written_buffers;
   // Only valid when |task_type| is range_for.
   std::optional<RangeForAttributes> range_for_attribs;
 
@@ -111,6 +126,9 @@ struct TaskAttributes {
             advisory_num_threads_per_group,
             task_type,
             buffer_binds,
+            texture_binds,
+            accessed_buffers,
+            written_buffers,
             range_for_attribs);
 };
 
@@ -154,7 +172,13 @@ class KernelContextAttributes {
   /**
    * This is mostly the same as Kernel::Arg, with device specific attributes.
    */
-  struct ArgAttributes : public AttribsBase {};
+  struct ArgAttributes : public AttribsBase {
+    // Textures are bound to the tasks instead, see TaskAttributes. Their
+    // slots in the context buffer are unused.
+    bool is_texture{false};
+
+    TI_IO_DEF(stride, offset_in_mem, index, is_array, is_texture);
+  };
 
   /**
    * This is mostly the same as Kernel::Ret, with device specific attributes.
@@ -36,9 +36,16 @@ class StructCompiler {
         snode_descriptors_.find(ch_snode->id)
             ->second.mem_offset_in_parent_cell = child_offset;
       }
+      if (sn->type == SNodeType::pointer) {
+        // Deactivation clears the cell word by word.
+        cell_stride = (cell_stride + 3) / 4 * 4;
+      }
       sn_desc.cell_stride = cell_stride;
 
-      if (sn->type == SNodeType::bitmasked) {
+      // Pointers have no node allocator here. Their cells are reserved
+      // densely, and tracked with a bitmask just like a bitmasked SNode.
+      if (sn->type == SNodeType::bitmasked ||
+          sn->type == SNodeType::pointer) {
         size_t num_cells = sn_desc.cells_per_container_pot();
         size_t bitmask_num_words =
             num_cells % 32 == 0 ? (num_cells / 32) : (num_cells / 32 + 1);
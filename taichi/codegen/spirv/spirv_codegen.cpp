@@ -1,10 +1,15 @@
 #include "taichi/codegen/spirv/spirv_codegen.h"
 
+#include <map>
 #include <string>
+#include <tuple>
+#include <unordered_set>
 #include <vector>
 
 #include "taichi/program/program.h"
 #include "taichi/program/kernel.h"
+#include "taichi/program/async_engine.h"
+#include "taichi/ir/analysis.h"
 #include "taichi/ir/statements.h"
 #include "taichi/ir/ir.h"
 #include "taichi/util/line_appender.h"
@@ -115,6 +120,15 @@ class TaskCodegen : public IRVisitor {
     // the task IR.
     emit_headers();
 
+    for (const auto &bb : task_attribs_.buffer_binds) {
+      if (accessed_buffers_.count(bb.buffer)) {
+        task_attribs_.accessed_buffers.push_back(bb.buffer);
+      }
+      if (written_buffers_.count(bb.buffer)) {
+        task_attribs_.written_buffers.push_back(bb.buffer);
+      }
+    }
+
     Result res;
     res.spirv_code = ir_->finalize();
     res.task_attribs = std::move(task_attribs_);
@@ -265,6 +279,9 @@ class TaskCodegen : public IRVisitor {
 
     auto buffer = get_buffer_value(BufferInfo(BufferType::Root, root_id),
                                    PrimitiveType::u32);
+    if (op != ActivationOp::query) {
+      written_buffers_.insert(BufferInfo(BufferType::Root, root_id));
+    }
     auto bitmask_word_ptr =
         ir_->make_value(spv::OpShiftLeftLogical, ptr_dt, bitmask_word_index,
                         ir_->uint_immediate_number(ir_->u32_type(), 2));
@@ -299,12 +316,72 @@ class TaskCodegen : public IRVisitor {
     }
   }
 
+  // Pointer SNodes are only emulated: with no node allocator, their cells are
+  // reserved densely like a bitmasked SNode's and save no memory.
+  static bool has_bitmask(const SNode *sn) {
+    return sn->type == SNodeType::bitmasked || sn->type == SNodeType::pointer;
+  }
+
+  // Zeros the |input_index|-th cell of the container at |parent_ptr|, so that
+  // a deactivated pointer cell reads as zeros once it is activated again.
+  void clear_cell(spirv::Value parent_ptr,
+                  int root_id,
+                  const SNode *sn,
+                  spirv::Value input_index) {
+    const auto &snode_descs = compiled_structs_[root_id].snode_descriptors;
+    const auto &desc = snode_descs.at(sn->id);
+    TI_ASSERT(desc.cell_stride % 4 == 0);
+    if (desc.cell_stride == 0) {
+      return;
+    }
+
+    auto buffer = get_buffer_value(BufferInfo(BufferType::Root, root_id),
+                                   PrimitiveType::u32);
+    auto cell_ptr = ir_->add(
+        parent_ptr, ir_->mul(input_index, make_pointer(desc.cell_stride)));
+    auto begin_word = ir_->make_value(
+        spv::OpShiftRightLogical, ir_->u32_type(),
+        ir_->cast(ir_->u32_type(), cell_ptr),
+        ir_->uint_immediate_number(ir_->u32_type(), 2));
+    auto end_word = ir_->add(
+        begin_word,
+        ir_->uint_immediate_number(ir_->u32_type(), desc.cell_stride / 4));
+
+    spirv::Label init_label = ir_->current_label();
+    spirv::Label head_label = ir_->new_label();
+    spirv::Label body_label = ir_->new_label();
+    spirv::Label merge_label = ir_->new_label();
+    ir_->make_inst(spv::OpBranch, head_label);
+
+    // for (word = begin_word; word < end_word; word++)
+    ir_->start_label(head_label);
+    spirv::PhiValue word = ir_->make_phi(ir_->u32_type(), 2);
+    word.set_incoming(0, begin_word, init_label);
+    auto loop_cond = ir_->make_value(spv::OpULessThan, ir_->bool_type(), word,
+                                     end_word);
+    ir_->make_inst(spv::OpLoopMerge, merge_label, body_label,
+                   spv::LoopControlMaskNone);
+    ir_->make_inst(spv::OpBranchConditional, loop_cond, body_label,
+                   merge_label);
+    {
+      ir_->start_label(body_label);
+      auto word_ptr = ir_->struct_array_access(ir_->u32_type(), buffer, word);
+      ir_->store_variable(word_ptr,
+                          ir_->uint_immediate_number(ir_->u32_type(), 0));
+      auto next_word =
+          ir_->add(word, ir_->uint_immediate_number(ir_->u32_type(), 1));
+      word.set_incoming(1, next_word, ir_->current_label());
+      ir_->make_inst(spv::OpBranch, head_label);
+    }
+    ir_->start_label(merge_label);
+  }
+
   void visit(SNodeOpStmt *stmt) override {
     const int root_id = snode_to_root_.at(stmt->snode->id);
     std::string parent = stmt->ptr->raw_name();
     spirv::Value parent_val = ir_->query_value(parent);
 
-    if (stmt->snode->type == SNodeType::bitmasked) {
+    if (has_bitmask(stmt->snode)) {
       spirv::Value input_index_val =
           ir_->cast(parent_val.stype, ir_->query_value(stmt->val->raw_name()));
 
@@ -319,6 +396,9 @@ class TaskCodegen : public IRVisitor {
       } else if (stmt->op_type == SNodeOpType::deactivate) {
         bitmasked_activation(ActivationOp::deactivate, parent_val, root_id,
                              stmt->snode, input_index_val);
+        if (stmt->snode->type == SNodeType::pointer) {
+          clear_cell(parent_val, root_id, stmt->snode, input_index_val);
+        }
       } else if (stmt->op_type == SNodeOpType::activate) {
         bitmasked_activation(ActivationOp::activate, parent_val, root_id,
                              stmt->snode, input_index_val);
@@ -349,7 +429,7 @@ class TaskCodegen : public IRVisitor {
     if (stmt->activate) {
       if (sn->type == SNodeType::dense) {
         // Do nothing
-      } else if (sn->type == SNodeType::bitmasked) {
+      } else if (has_bitmask(sn)) {
         spirv::Value input_index_val =
             ir_->query_value(stmt->input_index->raw_name());
         bitmasked_activation(ActivationOp::activate, parent_val, root_id, sn,
@@ -379,6 +459,8 @@ class TaskCodegen : public IRVisitor {
     spirv::Value val;
     spirv::Value global_tmp =
         get_buffer_value(BufferType::GlobalTmps, PrimitiveType::u32);
+    // The RNG states live in the global temporaries.
+    written_buffers_.insert(BufferType::GlobalTmps);
     if (stmt->element_type()->is_primitive(PrimitiveTypeID::i32)) {
       val = ir_->rand_i32(global_tmp);
     } else if (stmt->element_type()->is_primitive(PrimitiveTypeID::u32)) {
@@ -461,12 +543,30 @@ class TaskCodegen : public IRVisitor {
     }
   }
 
+  void visit(ThreadLocalPtrStmt *stmt) override {
+    // The TLS buffer of the LLVM backends becomes one function-local variable
+    // per offset, which the driver can keep in registers.
+    auto it = tls_variables_.find(stmt->offset);
+    if (it == tls_variables_.end()) {
+      auto type = ir_->get_primitive_type(stmt->ret_type.ptr_removed());
+      it = tls_variables_.emplace(stmt->offset, ir_->alloca_variable(type))
+               .first;
+    }
+    ir_->register_value(stmt->raw_name(), it->second);
+  }
+
   void visit(GlobalStoreStmt *stmt) override {
     TI_ASSERT(stmt->width() == 1);
+    if (stmt->dest->is<ThreadLocalPtrStmt>()) {
+      ir_->store_variable(ir_->query_value(stmt->dest->raw_name()),
+                          ir_->query_value(stmt->val->raw_name()));
+      return;
+    }
     const auto dt = stmt->val->element_type();
     const auto &primitive_buffer_type = ir_->get_primitive_buffer_type(dt);
 
     spirv::Value buffer_ptr = at_buffer(stmt->dest, dt);
+    written_buffers_.insert(ptr_to_buffers_.at(stmt->dest));
     spirv::Value val = ir_->query_value(stmt->val->raw_name());
 
     auto buffer_typed_value =
@@ -480,6 +580,13 @@ class TaskCodegen : public IRVisitor {
   void visit(GlobalLoadStmt *stmt) override {
     TI_ASSERT(stmt->width() == 1);
     auto dt = stmt->element_type();
+    if (stmt->src->is<ThreadLocalPtrStmt>()) {
+      ir_->register_value(
+          stmt->raw_name(),
+          ir_->load_variable(ir_->query_value(stmt->src->raw_name()),
+                             ir_->get_primitive_type(dt)));
+      return;
+    }
     const auto &primitive_buffer_type = ir_->get_primitive_buffer_type(dt);
 
     spirv::Value buffer_ptr = at_buffer(stmt->src, dt);
@@ -528,6 +635,7 @@ class TaskCodegen : public IRVisitor {
     spirv::Value buffer_val = ir_->struct_array_access(
         ir_->i32_type(),
         get_buffer_value(BufferType::Context, PrimitiveType::i32), idx_val);
+    written_buffers_.insert(BufferType::Context);
     spirv::Value val = ir_->query_value(stmt->value->raw_name());
     ir_->store_variable(buffer_val,
                         ir_->make_value(spv::OpBitcast, ir_->i32_type(), val));
@@ -541,6 +649,30 @@ class TaskCodegen : public IRVisitor {
     ptr_to_buffers_[stmt] = BufferType::GlobalTmps;
   }
 
+  void visit(TextureOpStmt *stmt) override {
+    // The channels of a texel are read by separate statements, which share
+    // a single read of the texture unit within a block.
+    auto key = std::make_tuple(stmt->parent, int(stmt->op), stmt->arg_id,
+                               stmt->args);
+    auto it = texel_value_map_.find(key);
+    if (it == texel_value_map_.end()) {
+      spirv::Value texture = get_texture_value(stmt->arg_id, stmt->num_dims);
+      std::vector<spirv::Value> coords;
+      for (int i = 0; i < stmt->num_dims; i++) {
+        coords.push_back(ir_->query_value(stmt->args[i]->raw_name()));
+      }
+      spirv::Value lod = ir_->query_value(stmt->args.back()->raw_name());
+      spirv::Value texel = stmt->op == TextureOpType::sample_lod
+                               ? ir_->sample_texture(texture, coords, lod)
+                               : ir_->fetch_texel(texture, coords, lod);
+      it = texel_value_map_.emplace(key, texel).first;
+    }
+    spirv::Value val = ir_->make_value(spv::OpCompositeExtract,
+                                       ir_->f32_type(), it->second,
+                                       uint32_t(stmt->channel));
+    ir_->register_value(stmt->raw_name(), val);
+  }
+
   void visit(ExternalTensorShapeAlongAxisStmt *stmt) override {
     const auto name = stmt->raw_name();
     const auto arg_id = stmt->arg_id;
@@ -899,6 +1031,7 @@ class TaskCodegen : public IRVisitor {
   void visit(AtomicOpStmt *stmt) override {
     TI_ASSERT(stmt->width() == 1);
     const auto dt = stmt->dest->element_type().ptr_removed();
+    written_buffers_.insert(ptr_to_buffers_.at(stmt->dest));
 
     spirv::Value addr_ptr;
 
@@ -923,6 +1056,19 @@ class TaskCodegen : public IRVisitor {
     auto ret_type = ir_->get_primitive_type(dt);
     spirv::Value data = ir_->query_value(stmt->val->raw_name());
 
+    spirv::Value do_atomic;
+    const bool aggregated = subgroup_aggregate(stmt, data, do_atomic);
+    spirv::Label atomic_merge_label;
+    if (aggregated) {
+      spirv::Label atomic_label = ir_->new_label();
+      atomic_merge_label = ir_->new_label();
+      ir_->make_inst(spv::OpSelectionMerge, atomic_merge_label,
+                     spv::SelectionControlMaskNone);
+      ir_->make_inst(spv::OpBranchConditional, do_atomic, atomic_label,
+                     atomic_merge_label);
+      ir_->start_label(atomic_label);
+    }
+
     spirv::Value val;
     if (is_real(dt)) {
       spv::Op atomic_fp_op;
@@ -990,9 +1136,93 @@ class TaskCodegen : public IRVisitor {
     } else {
       TI_NOT_IMPLEMENTED
     }
+    if (aggregated) {
+      // |val| has no users, so it doesn't matter that it's only defined in
+      // this branch.
+      ir_->make_inst(spv::OpBranch, atomic_merge_label);
+      ir_->start_label(atomic_merge_label);
+    }
     ir_->register_value(stmt->raw_name(), val);
   }
 
+  // Combines the atomics of a subgroup, like the warp reductions on CUDA, if
+  // the old value is unused. When all the active invocations update the same
+  // address, |data| becomes the subgroup-wide reduction and |do_atomic| is
+  // only true for one invocation. Otherwise every invocation does its own
+  // atomic. Returns false if the atomic can't be combined.
+  bool subgroup_aggregate(AtomicOpStmt *stmt,
+                          spirv::Value &data,
+                          spirv::Value &do_atomic) {
+    if (!device_->get_cap(DeviceCapability::spirv_has_subgroup_basic) ||
+        !device_->get_cap(DeviceCapability::spirv_has_subgroup_vote) ||
+        !device_->get_cap(DeviceCapability::spirv_has_subgroup_arithmetic)) {
+      return false;
+    }
+    const auto dt = stmt->dest->element_type().ptr_removed();
+    const bool is_f32 = dt->is_primitive(PrimitiveTypeID::f32);
+    const bool is_i32 = dt->is_primitive(PrimitiveTypeID::i32);
+    const bool is_u32 = dt->is_primitive(PrimitiveTypeID::u32);
+    if (!is_f32 && !is_i32 && !is_u32) {
+      return false;
+    }
+    if (!used_atomics_) {
+      used_atomics_ = irpass::analysis::gather_used_atomics(task_ir_);
+    }
+    if (used_atomics_->count(stmt)) {
+      return false;
+    }
+
+    spv::Op op;
+    switch (stmt->op_type) {
+      case AtomicOpType::add:
+      case AtomicOpType::sub:
+        // The sum of the operands is subtracted in the latter case.
+        op = is_f32 ? spv::OpGroupNonUniformFAdd : spv::OpGroupNonUniformIAdd;
+        break;
+      case AtomicOpType::min:
+        op = is_f32   ? spv::OpGroupNonUniformFMin
+             : is_i32 ? spv::OpGroupNonUniformSMin
+                      : spv::OpGroupNonUniformUMin;
+        break;
+      case AtomicOpType::max:
+        op = is_f32   ? spv::OpGroupNonUniformFMax
+             : is_i32 ? spv::OpGroupNonUniformSMax
+                      : spv::OpGroupNonUniformUMax;
+        break;
+      case AtomicOpType::bit_and:
+        op = spv::OpGroupNonUniformBitwiseAnd;
+        break;
+      case AtomicOpType::bit_or:
+        op = spv::OpGroupNonUniformBitwiseOr;
+        break;
+      case AtomicOpType::bit_xor:
+        op = spv::OpGroupNonUniformBitwiseXor;
+        break;
+      default:
+        return false;
+    }
+    if (is_f32 && (op == spv::OpGroupNonUniformBitwiseAnd ||
+                   op == spv::OpGroupNonUniformBitwiseOr ||
+                   op == spv::OpGroupNonUniformBitwiseXor)) {
+      return false;
+    }
+
+    spirv::Value scope =
+        ir_->int_immediate_number(ir_->i32_type(), spv::ScopeSubgroup);
+    spirv::Value ptr_val = ir_->query_value(stmt->dest->raw_name());
+    spirv::Value uniform = ir_->make_value(spv::OpGroupNonUniformAllEqual,
+                                           ir_->bool_type(), scope, ptr_val);
+    spirv::Value reduced = ir_->make_value(op, data.stype, scope,
+                                           spv::GroupOperationReduce, data);
+    spirv::Value elected = ir_->make_value(spv::OpGroupNonUniformElect,
+                                           ir_->bool_type(), scope);
+    data = ir_->make_value(spv::OpSelect, data.stype, uniform, reduced, data);
+    do_atomic = ir_->make_value(
+        spv::OpLogicalOr, ir_->bool_type(),
+        ir_->make_value(spv::OpLogicalNot, ir_->bool_type(), uniform), elected);
+    return true;
+  }
+
   void visit(IfStmt *if_stmt) override {
     spirv::Value cond_v = ir_->query_value(if_stmt->cond->raw_name());
     spirv::Value cond =
@@ -1032,6 +1262,8 @@ class TaskCodegen : public IRVisitor {
   void visit(RangeForStmt *for_stmt) override {
     TI_ASSERT(for_stmt->width() == 1);
     auto loop_var_name = for_stmt->raw_name();
+    generate_tls_prologue(stmt);
+
     // Must get init label after making value(to make sure they are correct)
     spirv::Label init_label = ir_->current_label();
     spirv::Label head_label = ir_->new_label();
@@ -1172,6 +1404,9 @@ class TaskCodegen : public IRVisitor {
           }
         }
       }
+      for (const auto &tb : task_attribs_.texture_binds) {
+        buffers.push_back(texture_value_map_.at(tb.arg_id));
+      }
     }
     ir_->commit_kernel_function(kernel_function_, "main", buffers,
                                 group_size);  // kernel entry
@@ -1338,11 +1573,28 @@ class TaskCodegen : public IRVisitor {
 
     // loop merge
     ir_->start_label(merge_label);
+    generate_tls_epilogue(stmt);
 
     ir_->make_inst(spv::OpReturn);
     ir_->make_inst(spv::OpFunctionEnd);
   }
 
+  // Every invocation accumulates its share of the grid-stride loop in
+  // function-local variables, and adds it to the global destination once in
+  // the epilogue. The epilogue runs in uniform control flow, so its atomics
+  // are combined across the subgroup before reaching memory.
+  void generate_tls_prologue(OffloadedStmt *stmt) {
+    if (stmt->tls_prologue) {
+      stmt->tls_prologue->accept(this);
+    }
+  }
+
+  void generate_tls_epilogue(OffloadedStmt *stmt) {
+    if (stmt->tls_epilogue) {
+      stmt->tls_epilogue->accept(this);
+    }
+  }
+
   void generate_listgen_kernel(OffloadedStmt *stmt) {
     task_attribs_.name = task_name_;
     task_attribs_.task_type = OffloadedTaskType::listgen;
@@ -1390,7 +1642,7 @@ class TaskCodegen : public IRVisitor {
 
     ir_->start_function(kernel_function_);
 
-    if (snode->type == SNodeType::bitmasked) {
+    if (has_bitmask(snode)) {
       task_attribs_.advisory_total_num_threads = total_num_cells;
       int num_cells = snode->num_cells_per_container;
 
@@ -1400,6 +1652,7 @@ class TaskCodegen : public IRVisitor {
 
       auto listgen_buffer =
           get_buffer_value(BufferInfo(BufferType::ListGen), PrimitiveType::i32);
+      written_buffers_.insert(BufferType::ListGen);
       auto invoc_index = ir_->get_global_invocation_id(0);
 
       auto container_ptr = make_pointer(0);
@@ -1523,6 +1776,7 @@ class TaskCodegen : public IRVisitor {
 
     auto loop_index_var = ir_->alloca_variable(ir_->u32_type());
     ir_->store_variable(loop_index_var, invoc_index);
+    generate_tls_prologue(stmt);
 
     ir_->make_inst(spv::OpBranch, loop_head);
     ir_->start_label(loop_head);
@@ -1555,6 +1809,7 @@ class TaskCodegen : public IRVisitor {
       ir_->make_inst(spv::OpBranch, loop_head);
     }
     ir_->start_label(loop_merge);
+    generate_tls_epilogue(stmt);
 
     ir_->make_inst(spv::OpReturn);       // return;
     ir_->make_inst(spv::OpFunctionEnd);  // } Close kernel
@@ -1586,6 +1841,7 @@ class TaskCodegen : public IRVisitor {
 
   spirv::Value get_buffer_value(BufferInfo buffer, DataType dt) {
     auto type = ir_->get_primitive_buffer_type(dt);
+    accessed_buffers_.insert(buffer);
     auto key = std::make_pair(buffer, type.id);
 
     const auto it = buffer_value_map_.find(key);
@@ -1605,6 +1861,7 @@ class TaskCodegen : public IRVisitor {
 
   spirv::Value get_buffer_value_alias(BufferInfo buffer, DataType dt) {
     auto type = ir_->get_primitive_type(dt);
+    accessed_buffers_.insert(buffer);
     auto key = std::make_pair(buffer, type.id);
 
     const auto it = buffer_value_map_.find(key);
@@ -1622,6 +1879,21 @@ class TaskCodegen : public IRVisitor {
     return buffer_value;
   }
 
+  spirv::Value get_texture_value(int arg_id, int num_dims) {
+    const auto it = texture_value_map_.find(arg_id);
+    if (it != texture_value_map_.end()) {
+      return it->second;
+    }
+    // The textures are bound after the buffers.
+    const int binding = task_attribs_.buffer_binds.size() +
+                        task_attribs_.texture_binds.size();
+    task_attribs_.texture_binds.push_back({arg_id, binding});
+    spirv::Value texture_value = ir_->texture_argument(num_dims, 0, binding);
+    ir_->debug(spv::OpName, texture_value, fmt::format("texture_{}", arg_id));
+    texture_value_map_[arg_id] = texture_value;
+    return texture_value;
+  }
+
   spirv::Value make_pointer(size_t offset) {
     if (use_64bit_pointers) {
       // This is hacky, should check out how to encode uint64 values in spirv
@@ -1694,6 +1966,13 @@ class TaskCodegen : public IRVisitor {
       buffer_value_map_;
   std::unordered_map<BufferInfo, uint32_t, BufferInfoHasher>
       buffer_binding_map_;
+  // Maps the arg id of a texture to its variable
+  std::unordered_map<int, spirv::Value> texture_value_map_;
+  // Maps (block, op, arg id, args) of the texture reads to their texels
+  std::map<std::tuple<Block *, int, int, std::vector<Stmt *>>, spirv::Value>
+      texel_value_map_;
+  // Maps the offsets of the thread-local storage to their variables
+  std::unordered_map<std::size_t, spirv::Value> tls_variables_;
   spirv::Value kernel_function_;
   spirv::Label kernel_return_label_;
   bool gen_label_{false};
@@ -1715,6 +1994,10 @@ class TaskCodegen : public IRVisitor {
   std::unordered_map<int, GetRootStmt *>
       root_stmts_;  // maps root id to get root stmt
   std::unordered_map<const Stmt *, BufferInfo> ptr_to_buffers_;
+  std::unique_ptr<std::unordered_set<AtomicOpStmt *>> used_atomics_{nullptr};
+  std::unordered_set<BufferInfo, BufferInfoHasher> accessed_buffers_;
+  // A superset of the buffers the task writes to.
+  std::unordered_set<BufferInfo, BufferInfoHasher> written_buffers_;
 };
 }  // namespace
 
@@ -1740,20 +2023,29 @@ static void spriv_message_consumer(spv_message_level_t level,
 
 KernelCodegen::KernelCodegen(const Params &params)
     : params_(params), ctx_attribs_(*params.kernel) {
-  spirv_opt_ = std::make_unique<spvtools::Optimizer>(SPV_ENV_VULKAN_1_2);
-  spirv_opt_->SetMessageConsumer(spriv_message_consumer);
-  if (params.enable_spv_opt)
-    spirv_opt_->RegisterPerformancePasses();
+  spirv_opt_ = create_spirv_opt();
   spirv_opt_options_.set_run_validator(false);
 
   spirv_tools_ = std::make_unique<spvtools::SpirvTools>(SPV_ENV_VULKAN_1_2);
 }
 
+std::unique_ptr<spvtools::Optimizer> KernelCodegen::create_spirv_opt() const {
+  auto spirv_opt = std::make_unique<spvtools::Optimizer>(SPV_ENV_VULKAN_1_2);
+  spirv_opt->SetMessageConsumer(spriv_message_consumer);
+  if (params_.enable_spv_opt)
+    spirv_opt->RegisterPerformancePasses();
+  return spirv_opt;
+}
+
 void KernelCodegen::run(TaichiKernelAttributes &kernel_attribs,
                         std::vector<std::vector<uint32_t>> &generated_spirv) {
   auto *root = params_.kernel->ir->as<Block>();
   auto &tasks = root->statements;
-  for (int i = 0; i < tasks.size(); ++i) {
+  const int num_tasks = tasks.size();
+  std::vector<TaskAttributes> tasks_attribs(num_tasks);
+  std::vector<std::vector<uint32_t>> optimized_spvs(num_tasks);
+
+  auto compile_task = [&](int i, spvtools::Optimizer *spirv_opt) {
     TaskCodegen::Params tp;
     tp.task_ir = tasks[i]->as<OffloadedStmt>();
     tp.task_id_in_kernel = i;
@@ -1765,11 +2057,11 @@ void KernelCodegen::run(TaichiKernelAttributes &kernel_attribs,
     TaskCodegen cgen(tp);
     auto task_res = cgen.run();
 
-    std::vector<uint32_t> optimized_spv;
+    auto &optimized_spv = optimized_spvs[i];
 
     TI_WARN_IF(
-        !spirv_opt_->Run(task_res.spirv_code.data(), task_res.spirv_code.size(),
-                         &optimized_spv, spirv_opt_options_),
+        !spirv_opt->Run(task_res.spirv_code.data(), task_res.spirv_code.size(),
+                        &optimized_spv, spirv_opt_options_),
         "SPIRV optimization failed");
 
     TI_TRACE("SPIRV-Tools-opt: binary size, before={}, after={}",
@@ -1789,8 +2081,30 @@ void KernelCodegen::run(TaichiKernelAttributes &kernel_attribs,
     fout.close();
 #endif
 
-    kernel_attribs.tasks_attribs.push_back(std::move(task_res.task_attribs));
-    generated_spirv.push_back(std::move(optimized_spv));
+    tasks_attribs[i] = std::move(task_res.task_attribs);
+  };
+
+  const int num_threads = std::min(params_.num_compile_threads, num_tasks);
+  if (num_threads > 1) {
+    // The tasks are independent after offloading. Each worker uses its own
+    // optimizer, since spvtools::Optimizer is not meant to be shared.
+    ParallelExecutor workers("spirv_compilation_worker", num_threads);
+    for (int i = 0; i < num_tasks; ++i) {
+      workers.enqueue([this, i, &compile_task]() {
+        auto spirv_opt = create_spirv_opt();
+        compile_task(i, spirv_opt.get());
+      });
+    }
+    workers.flush();
+  } else {
+    for (int i = 0; i < num_tasks; ++i) {
+      compile_task(i, spirv_opt_.get());
+    }
+  }
+
+  for (int i = 0; i < num_tasks; ++i) {
+    kernel_attribs.tasks_attribs.push_back(std::move(tasks_attribs[i]));
+    generated_spirv.push_back(std::move(optimized_spvs[i]));
   }
   kernel_attribs.ctx_attribs = std::move(ctx_attribs_);
   kernel_attribs.name = params_.ti_kernel_name;
@@ -1800,11 +2114,12 @@ void KernelCodegen::run(TaichiKernelAttributes &kernel_attribs,
 void lower(Kernel *kernel) {
   auto &config = kernel->program->config;
   config.demote_dense_struct_fors = true;
-  irpass::compile_to_executable(kernel->ir.get(), config, kernel,
-                                /*vectorize=*/false, kernel->grad,
-                                /*ad_use_stack=*/false, config.print_ir,
-                                /*lower_global_access=*/true,
-                                /*make_thread_local=*/false);
+  irpass::compile_to_executable(
+      kernel->ir.get(), config, kernel,
+      /*vectorize=*/false, kernel->autodiff_mode,
+      /*ad_use_stack=*/false, config.print_ir,
+      /*lower_global_access=*/true,
+      /*make_thread_local=*/config.make_thread_local);
 }
 
 }  // namespace spirv
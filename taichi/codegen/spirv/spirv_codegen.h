@@ -25,6 +25,8 @@ class KernelCodegen {
     std::vector<CompiledSNodeStructs> compiled_structs;
     Device *device;
     bool enable_spv_opt{true};
+    // Number of threads used to generate the tasks of the kernel.
+    int num_compile_threads{1};
   };
 
   explicit KernelCodegen(const Params &params);
@@ -33,6 +35,8 @@ class KernelCodegen {
            std::vector<std::vector<uint32_t>> &generated_spirv);
 
  private:
+  std::unique_ptr<spvtools::Optimizer> create_spirv_opt() const;
+
   Params params_;
   KernelContextAttributes ctx_attribs_;
 
@@ -54,6 +54,22 @@ void IRBuilder::init_header() {
         */
   }
 
+  if (device_->get_cap(cap::spirv_has_subgroup_basic)) {
+    ib_.begin(spv::OpCapability)
+        .add(spv::CapabilityGroupNonUniform)
+        .commit(&header_);
+  }
+  if (device_->get_cap(cap::spirv_has_subgroup_vote)) {
+    ib_.begin(spv::OpCapability)
+        .add(spv::CapabilityGroupNonUniformVote)
+        .commit(&header_);
+  }
+  if (device_->get_cap(cap::spirv_has_subgroup_arithmetic)) {
+    ib_.begin(spv::OpCapability)
+        .add(spv::CapabilityGroupNonUniformArithmetic)
+        .commit(&header_);
+  }
+
   if (device_->get_cap(cap::spirv_has_int8)) {
     ib_.begin(spv::OpCapability).add(spv::CapabilityInt8).commit(&header_);
   }
@@ -105,7 +121,14 @@ std::vector<uint32_t> IRBuilder::finalize() {
   // set bound
   const int bound_loc = 3;
   header_[bound_loc] = id_counter_;
-  data.insert(data.end(), header_.begin(), header_.end());
+  // The capabilities found to be needed while building the module go after
+  // the 5 words of the header, before the extensions.
+  const int header_words = 5;
+  data.insert(data.end(), header_.begin(), header_.begin() + header_words);
+  if (use_sampled_1d_) {
+    ib_.begin(spv::OpCapability).add(spv::CapabilitySampled1D).commit(&data);
+  }
+  data.insert(data.end(), header_.begin() + header_words, header_.end());
   data.insert(data.end(), entry_.begin(), entry_.end());
   data.insert(data.end(), exec_mode_.begin(), exec_mode_.end());
   data.insert(data.end(), debug_.begin(), debug_.end());
@@ -154,6 +177,7 @@ void IRBuilder::init_pre_defs() {
       .add(t_v3_uint_)
       .add_seq(t_uint32_, 3)
       .commit(&global_);
+  vector_type_tbl_[std::make_pair(t_uint32_.id, 3U)] = t_v3_uint_;
 
   // pre-defined constants
   const_i32_zero_ = int_immediate_number(t_int32_, 0);
@@ -365,6 +389,22 @@ SType IRBuilder::get_struct_array_type(const SType &value_type,
   return struct_type;
 }
 
+SType IRBuilder::get_vector_type(const SType &elem_type, uint32_t num_elems) {
+  auto key = std::make_pair(elem_type.id, num_elems);
+  auto it = vector_type_tbl_.find(key);
+  if (it != vector_type_tbl_.end()) {
+    return it->second;
+  }
+  SType t;
+  t.id = id_counter_++;
+  t.dt = elem_type.dt;
+  ib_.begin(spv::OpTypeVector)
+      .add_seq(t, elem_type, num_elems)
+      .commit(&global_);
+  vector_type_tbl_[key] = t;
+  return t;
+}
+
 Value IRBuilder::buffer_argument(const SType &value_type,
                                  uint32_t descriptor_set,
                                  uint32_t binding) {
@@ -390,6 +430,92 @@ Value IRBuilder::buffer_argument(const SType &value_type,
   return val;
 }
 
+SType IRBuilder::get_image_type(int num_dims) {
+  TI_ASSERT(num_dims >= 1 && num_dims <= 3);
+  SType &t = t_image_[num_dims - 1];
+  if (t.id == 0) {
+    const spv::Dim dims[] = {spv::Dim1D, spv::Dim2D, spv::Dim3D};
+    t.id = id_counter_++;
+    // Not a depth image, not arrayed, single sampled, used with a sampler.
+    ib_.begin(spv::OpTypeImage)
+        .add_seq(t, t_fp32_, dims[num_dims - 1], 0, 0, 0, 1,
+                 spv::ImageFormatUnknown)
+        .commit(&global_);
+  }
+  return t;
+}
+
+SType IRBuilder::get_sampled_image_type(int num_dims) {
+  SType &t = t_sampled_image_[num_dims - 1];
+  if (t.id == 0) {
+    SType image_type = get_image_type(num_dims);
+    t.id = id_counter_++;
+    ib_.begin(spv::OpTypeSampledImage)
+        .add_seq(t, image_type)
+        .commit(&global_);
+  }
+  return t;
+}
+
+Value IRBuilder::texture_argument(int num_dims,
+                                  uint32_t descriptor_set,
+                                  uint32_t binding) {
+  if (num_dims == 1) {
+    use_sampled_1d_ = true;
+  }
+  SType ptr_type = get_pointer_type(get_sampled_image_type(num_dims),
+                                    spv::StorageClassUniformConstant);
+  Value val = new_value(ptr_type, ValueKind::kVariablePtr);
+  ib_.begin(spv::OpVariable)
+      .add_seq(ptr_type, val, spv::StorageClassUniformConstant)
+      .commit(&global_);
+
+  this->decorate(spv::OpDecorate, val, spv::DecorationDescriptorSet,
+                 descriptor_set);
+  this->decorate(spv::OpDecorate, val, spv::DecorationBinding, binding);
+  return val;
+}
+
+Value IRBuilder::make_texture_coords(const SType &elem_type,
+                                     const std::vector<Value> &coords) {
+  if (coords.size() == 1) {
+    return coords[0];
+  }
+  SType vec_type = get_vector_type(elem_type, coords.size());
+  Value val = new_value(vec_type, ValueKind::kNormal);
+  ib_.begin(spv::OpCompositeConstruct).add_seq(vec_type, val);
+  for (const auto &c : coords) {
+    ib_.add(c);
+  }
+  ib_.commit(&function_);
+  return val;
+}
+
+Value IRBuilder::sample_texture(Value texture_var,
+                                const std::vector<Value> &coords,
+                                Value lod) {
+  const int num_dims = coords.size();
+  Value sampled_image =
+      load_variable(texture_var, get_sampled_image_type(num_dims));
+  Value coord = make_texture_coords(t_fp32_, coords);
+  return make_value(spv::OpImageSampleExplicitLod,
+                    get_vector_type(t_fp32_, 4), sampled_image, coord,
+                    spv::ImageOperandsLodMask, lod);
+}
+
+Value IRBuilder::fetch_texel(Value texture_var,
+                             const std::vector<Value> &coords,
+                             Value lod) {
+  const int num_dims = coords.size();
+  Value sampled_image =
+      load_variable(texture_var, get_sampled_image_type(num_dims));
+  Value image =
+      make_value(spv::OpImage, get_image_type(num_dims), sampled_image);
+  Value coord = make_texture_coords(t_int32_, coords);
+  return make_value(spv::OpImageFetch, get_vector_type(t_fp32_, 4), image,
+                    coord, spv::ImageOperandsLodMask, lod);
+}
+
 Value IRBuilder::struct_array_access(const SType &res_type,
                                      Value buffer,
                                      Value index) {
@@ -318,6 +318,8 @@ class IRBuilder {
                          spv::StorageClass storage_class);
   // Get a struct{ value_type[num_elems] } type
   SType get_struct_array_type(const SType &value_type, uint32_t num_elems);
+  // Get the vector type of |num_elems| elements of elem_type
+  SType get_vector_type(const SType &elem_type, uint32_t num_elems);
 
   // Declare buffer argument of function
   Value buffer_argument(const SType &value_type,
@@ -325,6 +327,20 @@ class IRBuilder {
                         uint32_t binding);
   Value struct_array_access(const SType &res_type, Value buffer, Value index);
 
+  // Declare a texture argument of f32 texels, bound as a combined image
+  // sampler
+  Value texture_argument(int num_dims,
+                         uint32_t descriptor_set,
+                         uint32_t binding);
+  // Sample the texture at the normalized f32 |coords|, returning a vec4
+  Value sample_texture(Value texture_var,
+                       const std::vector<Value> &coords,
+                       Value lod);
+  // Read the texel at the i32 |coords| without filtering, returning a vec4
+  Value fetch_texel(Value texture_var,
+                    const std::vector<Value> &coords,
+                    Value lod);
+
   // Declare a new function
   // NOTE: only support void kernel function, i.e. main
   Value new_function() {
@@ -480,6 +496,12 @@ class IRBuilder {
 
   Value get_const_(const SType &dtype, const uint64_t *pvalue, bool cache);
   SType declare_primitive_type(DataType dt);
+  // The image and sampled image types of the f32 textures
+  SType get_image_type(int num_dims);
+  SType get_sampled_image_type(int num_dims);
+  // A vector of |coords|, or the coordinate itself in 1D
+  Value make_texture_coords(const SType &elem_type,
+                            const std::vector<Value> &coords);
 
   void init_random_function(Value global_tmp_);
 
@@ -522,8 +544,15 @@ class IRBuilder {
   Value _rand_z_;
   Value _rand_w_;  // per-thread local variable
 
+  // Texture types, by the number of dimensions minus one
+  std::array<SType, 3> t_image_;
+  std::array<SType, 3> t_sampled_image_;
+  bool use_sampled_1d_{false};
+
   // map from value to its pointer type
   std::map<std::pair<uint32_t, spv::StorageClass>, SType> pointer_type_tbl_;
+  // map from (element type, number of elements) to the vector type
+  std::map<std::pair<uint32_t, uint32_t>, SType> vector_type_tbl_;
   // map from constant int to its value
   std::map<std::pair<uint32_t, uint64_t>, Value> const_tbl_;
   // map from raw_name(string) to Value
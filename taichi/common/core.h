@@ -239,6 +239,34 @@ void write(std::string fn, const uint8 *data, std::size_t len);
 void write(const std::string &fn, const std::string &data);
 std::vector<uint8> read(const std::string fn, bool verbose = false);
 
+// The maximum size of |len| bytes after compress().
+std::size_t compress_bound(std::size_t len);
+// Deflates |len| bytes of |data| into |dst|, which holds at least
+// compress_bound(len) bytes. Returns the compressed size.
+std::size_t compress(const uint8 *data,
+                     std::size_t len,
+                     uint8 *dst,
+                     std::size_t dst_capacity,
+                     int level);
+// Inflates |len| bytes of |data| into |dst|, which must receive exactly
+// |dst_len| bytes.
+void decompress(const uint8 *data,
+                std::size_t len,
+                uint8 *dst,
+                std::size_t dst_len);
+
+// Writes |data| into |fn| (*.tcb.pz) as deflated chunks of |chunk_size| bytes,
+// compressed by |num_threads| threads (one per CPU if 0) and streamed to the
+// file in order, so that only a batch of chunks is held in memory.
+void write_chunked(const std::string &fn,
+                   const uint8 *data,
+                   std::size_t len,
+                   int level = 6,
+                   int num_threads = 0,
+                   std::size_t chunk_size = 4 << 20);
+// Reads a file written by write_chunked(), inflating the chunks in parallel.
+std::vector<uint8> read_chunked(const std::string &fn, int num_threads = 0);
+
 }  // namespace zip
 
 //******************************************************************************
@@ -5,8 +5,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -218,8 +220,24 @@ class Serializer {
   };
 };
 
-inline std::vector<uint8_t> read_data_from_file(const std::string &fn) {
+// Reads the rest of |f|, in blocks of growing sizes.
+inline std::vector<uint8_t> read_data_from_file(std::FILE *f) {
   std::vector<uint8_t> data;
+  std::size_t length = 0;
+  while (true) {
+    data.resize(std::max<std::size_t>(data.size() * 2, 1 << 16));
+    const std::size_t limit = data.size() - length;
+    const std::size_t length_tmp = fread(&data[length], 1, limit, f);
+    length += length_tmp;
+    if (length_tmp < limit) {
+      break;
+    }
+  }
+  data.resize(length);
+  return data;
+}
+
+inline std::vector<uint8_t> read_data_from_file(const std::string &fn) {
   std::FILE *f = fopen(fn.c_str(), "rb");
   if (f == nullptr) {
     TI_ERROR("Cannot open file: {}", fn);
@@ -229,22 +247,14 @@ inline std::vector<uint8_t> read_data_from_file(const std::string &fn) {
     std::fclose(f);
     // Read zip file, e.g. particles.tcb.zip
     return zip::read(fn);
+  } else if (ends_with(fn, ".pz")) {
+    std::fclose(f);
+    // Read chunked compressed file, e.g. particles.tcb.pz
+    return zip::read_chunked(fn);
   } else {
     // Read uncompressed file, e.g. particles.tcb
-    assert(f != nullptr);
-    std::size_t length = 0;
-    while (true) {
-      size_t limit = 1 << 8;
-      data.resize(data.size() + limit);
-      void *ptr = reinterpret_cast<void *>(&data[length]);
-      size_t length_tmp = fread(ptr, sizeof(uint8_t), limit, f);
-      length += length_tmp;
-      if (length_tmp < limit) {
-        break;
-      }
-    }
+    auto data = read_data_from_file(f);
     std::fclose(f);
-    data.resize(length);
     return data;
   }
 }
@@ -261,11 +271,15 @@ inline void write_data_to_file(const std::string &fn,
   if (ends_with(fn, ".tcb.zip")) {
     std::fclose(f);
     zip::write(fn, data, size);
+  } else if (ends_with(fn, ".tcb.pz")) {
+    std::fclose(f);
+    zip::write_chunked(fn, data, size);
   } else if (ends_with(fn, ".tcb")) {
     fwrite(data, sizeof(uint8_t), size, f);
     std::fclose(f);
   } else {
-    TI_ERROR("File must end with .tcb or .tcb.zip. [Filename = {}]", fn);
+    TI_ERROR("File must end with .tcb, .tcb.zip or .tcb.pz. [Filename = {}]",
+             fn);
   }
 }
 
@@ -284,6 +298,13 @@ class BinarySerializer : public Serializer {
   std::size_t head;
   std::size_t preserved;
 
+  // File mode: |data| buffers the bytes from offset |flushed| until they are
+  // written to |file|.
+  std::FILE *file{nullptr};
+  std::size_t flushed{0};
+  std::fpos_t file_begin;
+  static constexpr std::size_t kFileBufferSize = 1 << 20;
+
   using Base = Serializer;
   using Base::assets;
 
@@ -324,6 +345,25 @@ class BinarySerializer : public Serializer {
     this->operator()("", n);
   }
 
+  // Streams the output into |file| at its current position, instead of
+  // holding all of it in memory. The file must be seekable, and stays open
+  // after finalize().
+  template <bool writing_ = writing>
+  typename std::enable_if<writing_, void>::type initialize(std::FILE *file) {
+    std::size_t n = 0;
+    head = 0;
+    preserved = 0;
+    c_data = nullptr;
+    this->file = file;
+    flushed = 0;
+    data.clear();
+    data.reserve(kFileBufferSize);
+    if (std::fgetpos(file, &file_begin) != 0) {
+      TI_ERROR("Failed to get the position of the file");
+    }
+    this->operator()("", n);
+  }
+
   template <bool writing_ = writing>
   typename std::enable_if<!writing_, void>::type initialize(
       void *raw_data,
@@ -344,6 +384,16 @@ class BinarySerializer : public Serializer {
     if (writing) {
       if (c_data) {
         *reinterpret_cast<std::size_t *>(&c_data[0]) = head;
+      } else if (file) {
+        flush();
+        std::fpos_t end;
+        bool ok = std::fgetpos(file, &end) == 0 &&
+                  std::fsetpos(file, &file_begin) == 0 &&
+                  std::fwrite(&head, sizeof(head), 1, file) == 1 &&
+                  std::fsetpos(file, &end) == 0;
+        if (!ok) {
+          TI_ERROR("Failed to write the serialized data to the file");
+        }
       } else {
         *reinterpret_cast<std::size_t *>(&data[0]) = head;
       }
@@ -363,6 +413,48 @@ class BinarySerializer : public Serializer {
   }
 
  private:
+  void flush() {
+    if (!data.empty() &&
+        std::fwrite(data.data(), 1, data.size(), file) != data.size()) {
+      TI_ERROR("Failed to write the serialized data to the file");
+    }
+    flushed += data.size();
+    data.clear();
+  }
+
+  void write_bytes(const void *src, std::size_t size) {
+    std::size_t new_size = head + size;
+    if (c_data) {
+      if (new_size > preserved) {
+        TI_CRITICAL("Preserved Buffer (size {}) Overflow.", preserved);
+      }
+      std::memcpy(&c_data[head], src, size);
+    } else if (file) {
+      if (data.size() + size > kFileBufferSize) {
+        flush();
+      }
+      if (size > kFileBufferSize) {
+        // Large arrays go to the file without being copied.
+        if (std::fwrite(src, 1, size, file) != size) {
+          TI_ERROR("Failed to write the serialized data to the file");
+        }
+        flushed += size;
+      } else {
+        data.insert(data.end(), (const uint8_t *)src,
+                    (const uint8_t *)src + size);
+      }
+    } else {
+      data.resize(new_size);
+      std::memcpy(&data[head], src, size);
+    }
+    head = new_size;
+  }
+
+  void read_bytes(void *dst, std::size_t size) {
+    std::memcpy(dst, &c_data[head], size);
+    head += size;
+  }
+
   // std::string
   void process(const std::string &val_) {
     auto &val = get_writable(val_);
@@ -407,27 +499,10 @@ class BinarySerializer : public Serializer {
     static_assert(!std::is_volatile<T>::value, "T cannot be volatile");
     static_assert(!std::is_pointer<T>::value, "T cannot be pointer");
     if (writing) {
-      std::size_t new_size = head + sizeof(T);
-      if (c_data) {
-        if (new_size > preserved) {
-          TI_CRITICAL("Preserved Buffer (size {}) Overflow.", preserved);
-        }
-        //*reinterpret_cast<typename type::remove_cvref_t<T> *>(&c_data[head]) =
-        //    val;
-        std::memcpy(&c_data[head], &val, sizeof(T));
-      } else {
-        data.resize(new_size);
-        //*reinterpret_cast<typename type::remove_cvref_t<T> *>(&data[head]) =
-        //    val;
-        std::memcpy(&data[head], &val, sizeof(T));
-      }
+      write_bytes(&val, sizeof(T));
     } else {
-      // get_writable(val) =
-      //    *reinterpret_cast<typename std::remove_reference<T>::type *>(
-      //        &c_data[head]);
-      std::memcpy(&get_writable(val), &c_data[head], sizeof(T));
+      read_bytes(&get_writable(val), sizeof(T));
     }
-    head += sizeof(T);
   }
 
   template <typename T>
@@ -538,8 +613,20 @@ class BinarySerializer : public Serializer {
       this->process(n);
       val.resize(n);
     }
-    for (std::size_t i = 0; i < val.size(); i++) {
-      this->process(val[i]);
+    if constexpr (is_elementary_type_v<T> && !std::is_same_v<T, bool>) {
+      // The same bytes as processing the elements one by one, in one copy.
+      if (val.empty()) {
+        return;
+      }
+      if (writing) {
+        write_bytes(val.data(), sizeof(T) * val.size());
+      } else {
+        read_bytes(val.data(), sizeof(T) * val.size());
+      }
+    } else {
+      for (std::size_t i = 0; i < val.size(); i++) {
+        this->process(val[i]);
+      }
     }
   }
 
@@ -884,6 +971,19 @@ void read_from_binary_file(T &t, const std::string &file_name) {
 template <typename T>
 void write_to_binary_file(const T &t, const std::string &file_name) {
   BinaryOutputSerializer writer;
+  if (ends_with(file_name, ".tcb")) {
+    // Uncompressed files are streamed, without a copy of the whole output.
+    std::FILE *f = std::fopen(file_name.c_str(), "wb");
+    if (f == nullptr) {
+      TI_ERROR("Cannot open file [{}] for writing.", file_name);
+      return;
+    }
+    writer.initialize(f);
+    writer(t);
+    writer.finalize();
+    std::fclose(f);
+    return;
+  }
   writer.initialize();
   writer(t);
   writer.finalize();
@@ -1,9 +1,105 @@
 #include "taichi/gui/gui.h"
 
+#include <thread>
+
+#include "taichi/system/threading.h"
+
 TI_NAMESPACE_BEGIN
 
 Vector2 Canvas::Line::vertices[128];
 
+namespace {
+
+constexpr int kTileSize = 64;
+
+// The pixels [x0, x1] x [y0, y1].
+struct PixelRect {
+  int x0, y0, x1, y1;
+
+  bool empty() const {
+    return x0 > x1 || y0 > y1;
+  }
+
+  PixelRect intersect(const PixelRect &o) const {
+    return {std::max(x0, o.x0), std::max(y0, o.y0), std::min(x1, o.x1),
+            std::min(y1, o.y1)};
+  }
+};
+
+// Draws |n| primitives in tiles of kTileSize x kTileSize pixels, which are
+// rasterized in parallel on |pool|. |bounds(i)| returns the pixels primitive i
+// may cover, and |draw(i, rect)| draws the part of it within |rect|. Each tile
+// draws its primitives in order, so that they blend the same as when drawn
+// one by one.
+template <typename Bounds, typename Draw>
+void rasterize_tiled(ThreadPool *pool,
+                     const Array2D<Vector4> &img,
+                     int n,
+                     const Bounds &bounds,
+                     const Draw &draw) {
+  const PixelRect canvas_rect{0, 0, img.get_width() - 1,
+                              img.get_height() - 1};
+  const int tiles_x = (img.get_width() + kTileSize - 1) / kTileSize;
+  const int tiles_y = (img.get_height() + kTileSize - 1) / kTileSize;
+  const int num_tiles = tiles_x * tiles_y;
+
+  std::vector<PixelRect> rects(n);
+  auto for_each_tile = [&](const PixelRect &rect, auto &&func) {
+    for (int tx = rect.x0 / kTileSize; tx <= rect.x1 / kTileSize; tx++) {
+      for (int ty = rect.y0 / kTileSize; ty <= rect.y1 / kTileSize; ty++) {
+        func(tx * tiles_y + ty);
+      }
+    }
+  };
+  // Bins the primitives in CSR form: tile t draws the primitives
+  // prims[offset[t], offset[t + 1]).
+  std::vector<int> offset(num_tiles + 1, 0);
+  for (int i = 0; i < n; i++) {
+    rects[i] = bounds(i).intersect(canvas_rect);
+    if (!rects[i].empty()) {
+      for_each_tile(rects[i], [&](int t) { offset[t + 1]++; });
+    }
+  }
+  for (int t = 0; t < num_tiles; t++) {
+    offset[t + 1] += offset[t];
+  }
+  std::vector<int> prims(offset[num_tiles]);
+  std::vector<int> next(offset.begin(), offset.end() - 1);
+  for (int i = 0; i < n; i++) {
+    if (!rects[i].empty()) {
+      for_each_tile(rects[i], [&](int t) { prims[next[t]++] = i; });
+    }
+  }
+
+  parallel_for_blocks(pool, num_tiles, 1, [&](int begin, int end) {
+    for (int t = begin; t < end; t++) {
+      const int x0 = t / tiles_y * kTileSize;
+      const int y0 = t % tiles_y * kTileSize;
+      const PixelRect tile{x0, y0, x0 + kTileSize - 1, y0 + kTileSize - 1};
+      for (int k = offset[t]; k < offset[t + 1]; k++) {
+        const int i = prims[k];
+        draw(i, rects[i].intersect(tile));
+      }
+    }
+  });
+}
+
+}  // namespace
+
+Canvas::~Canvas() {
+}
+
+ThreadPool *Canvas::get_thread_pool() {
+  if (!thread_pool_) {
+    thread_pool_ = std::make_unique<ThreadPool>(
+        std::max(1, (int)std::thread::hardware_concurrency()));
+  }
+  return thread_pool_.get();
+}
+
+// The batched primitives are drawn like Canvas::triangle(), Line::stroke()
+// and Circle::finish(). The inner loops run along columns, which are
+// contiguous in |img|, without branches, so that they vectorize.
 void Canvas::triangles_batched(int n,
                                std::size_t a_,
                                std::size_t b_,
@@ -14,14 +110,40 @@ void Canvas::triangles_batched(int n,
   auto b = (real *)b_;
   auto c = (real *)c_;
   auto color_arr = (uint32 *)color_array;
+  struct Triangle {
+    Vector2 a, b, c;
+  };
+  std::vector<Triangle> tris(n);
   for (int i = 0; i < n; i++) {
-    auto clr = color_single;
-    if (color_arr) {
-      clr = color_arr[i];
-    }
-    triangle_single(a[i * 2], a[i * 2 + 1], b[i * 2], b[i * 2 + 1], c[i * 2],
-                    c[i * 2 + 1], clr);
+    tris[i] = {transform(Vector2(a[i * 2], a[i * 2 + 1])),
+               transform(Vector2(b[i * 2], b[i * 2 + 1])),
+               transform(Vector2(c[i * 2], c[i * 2 + 1]))};
   }
+  auto bounds = [&](int i) {
+    const auto &t = tris[i];
+    // The pixels whose centers may be inside.
+    return PixelRect{(int)std::floor(min(t.a.x, min(t.b.x, t.c.x))),
+                     (int)std::floor(min(t.a.y, min(t.b.y, t.c.y))),
+                     (int)std::ceil(max(t.a.x, max(t.b.x, t.c.x))) - 1,
+                     (int)std::ceil(max(t.a.y, max(t.b.y, t.c.y))) - 1};
+  };
+  auto draw = [&](int i, const PixelRect &rect) {
+    const auto &[ta, tb, tc] = tris[i];
+    const auto color = color_from_hex(color_arr ? color_arr[i] : color_single);
+    for (int x = rect.x0; x <= rect.x1; x++) {
+      for (int y = rect.y0; y <= rect.y1; y++) {
+        Vector2 pixel(x + 0.5_f, y + 0.5_f);
+        bool inside_a = cross(pixel - ta, tb - ta) <= 0;
+        bool inside_b = cross(pixel - tb, tc - tb) <= 0;
+        bool inside_c = cross(pixel - tc, ta - tc) <= 0;
+        // Either winding order.
+        if ((inside_a == inside_b) && (inside_a == inside_c)) {
+          img[x][y] = color;
+        }
+      }
+    }
+  };
+  rasterize_tiled(get_thread_pool(), img, n, bounds, draw);
 }
 
 void Canvas::paths_batched(int n,
@@ -35,19 +157,47 @@ void Canvas::paths_batched(int n,
   auto b = (real *)b_;
   auto color_arr = (uint32 *)color_array;
   auto radius_arr = (real *)radius_array;
+  struct Segment {
+    Vector2 a, b;
+  };
+  std::vector<Segment> segments(n);
   for (int i = 0; i < n; i++) {
-    auto r = radius_single;
-    if (radius_arr) {
-      r = radius_arr[i];
-    }
-    auto clr = color_single;
-    if (color_arr) {
-      clr = color_arr[i];
-    }
     // FIXME: path_single seems not displaying correct without the 1e-6 term:
-    path_single(a[i * 2], a[i * 2 + 1], b[i * 2] + 1e-6 * (i % 18 + 6),
-                b[i * 2 + 1], clr, r);
+    segments[i] = {transform(Vector2(a[i * 2], a[i * 2 + 1])),
+                   transform(Vector2(b[i * 2] + 1e-6 * (i % 18 + 6),
+                                     b[i * 2 + 1]))};
   }
+  auto bounds = [&](int i) {
+    const auto r = radius_arr ? radius_arr[i] : radius_single;
+    auto a_i = (segments[i].a + Vector2(0.5_f)).template cast<int>();
+    auto b_i = (segments[i].b + Vector2(0.5_f)).template cast<int>();
+    auto radius_i = (int)std::ceil(r + 0.5_f);
+    return PixelRect{std::min(a_i.x, b_i.x) - radius_i,
+                     std::min(a_i.y, b_i.y) - radius_i,
+                     std::max(a_i.x, b_i.x) + radius_i,
+                     std::max(a_i.y, b_i.y) + radius_i};
+  };
+  auto draw = [&](int i, const PixelRect &rect) {
+    const auto r = radius_arr ? radius_arr[i] : radius_single;
+    const auto color = color_from_hex(color_arr ? color_arr[i] : color_single);
+    const auto [sa, sb] = segments[i];
+    auto direction = normalized(sb - sa);
+    auto l = length(sb - sa);
+    auto tangent = Vector2(-direction.y, direction.x);
+    for (int x = rect.x0; x <= rect.x1; x++) {
+      for (int y = rect.y0; y <= rect.y1; y++) {
+        auto pixel_coord = Vector2(x + 0.5_f, y + 0.5_f) - sa;
+        auto u = dot(tangent, pixel_coord);
+        auto v = dot(direction, pixel_coord);
+        v = v > 0 ? std::max(0.0_f, v - l) : v;
+        real dist = std::sqrt(u * u + v * v);
+        auto alpha = color.w * clamp(r - dist);
+        auto &dest = img[x][y];
+        dest = lerp(alpha, dest, color);
+      }
+    }
+  };
+  rasterize_tiled(get_thread_pool(), img, n, bounds, draw);
 }
 
 void Canvas::circles_batched(int n,
@@ -59,17 +209,33 @@ void Canvas::circles_batched(int n,
   auto x = (real *)x_;
   auto color_arr = (uint32 *)color_array;
   auto radius_arr = (real *)radius_array;
+  std::vector<Vector2> centers(n);
   for (int i = 0; i < n; i++) {
-    auto r = radius_single;
-    if (radius_arr) {
-      r = radius_arr[i];
-    }
-    auto c = color_single;
-    if (color_arr) {
-      c = color_arr[i];
-    }
-    circle(x[i * 2], x[i * 2 + 1]).radius(r).color(c).finish();
+    centers[i] = transform(Vector2(x[i * 2], x[i * 2 + 1]));
   }
+  auto bounds = [&](int i) {
+    const auto r = radius_arr ? radius_arr[i] : radius_single;
+    const auto center = centers[i];
+    return PixelRect{(int)std::ceil(center.x - r), (int)std::ceil(center.y - r),
+                     (int)std::floor(center.x + r),
+                     (int)std::floor(center.y + r)};
+  };
+  auto draw = [&](int i, const PixelRect &rect) {
+    const auto r = radius_arr ? radius_arr[i] : radius_single;
+    const auto color = color_from_hex(color_arr ? color_arr[i] : color_single);
+    const auto center = centers[i];
+    for (int px = rect.x0; px <= rect.x1; px++) {
+      const real dx = center.x - px;
+      auto *column = img[px];
+      for (int py = rect.y0; py <= rect.y1; py++) {
+        const real dy = center.y - py;
+        real dist = std::sqrt(dx * dx + dy * dy);
+        auto alpha = color.w * clamp(r - dist);
+        column[py] = lerp(alpha, column[py], color);
+      }
+    }
+  };
+  rasterize_tiled(get_thread_pool(), img, n, bounds, draw);
 }
 
 void Canvas::circle_single(real x, real y, uint32 color, real radius) {
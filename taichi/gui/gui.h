@@ -3,6 +3,7 @@
 #include "taichi/math/math.h"
 #include "taichi/system/timer.h"
 #include "taichi/program/kernel_profiler.h"
+#include "taichi/system/threading.h"
 
 #include <atomic>
 #include <ctime>
@@ -425,12 +426,17 @@ class Canvas {
     clear(color_from_hex(c));
   }
 
-  ~Canvas() {
-  }
+  ~Canvas();
 
   void set_identity_transform_matrix() {
     transform_matrix = Matrix3(1);
   }
+
+ private:
+  // Rasterizes the batched primitives in parallel, created on first use.
+  ThreadPool *get_thread_pool();
+
+  std::unique_ptr<ThreadPool> thread_pool_;
 };
 
 #if defined(TI_GUI_X11)
@@ -6,6 +6,8 @@
 #include <X11/Xutil.h>
 #include <cstdlib>
 
+#include "taichi/system/dynamic_loader.h"
+
 // Undo terrible unprefixed macros in X.h
 #ifdef None
 #undef None
@@ -16,6 +18,65 @@
 
 TI_NAMESPACE_BEGIN
 
+namespace {
+
+// libX11 is loaded when the first window is created instead of being linked,
+// so that importing taichi does not load it and its dependencies.
+class X11Library {
+ public:
+  static X11Library &get_instance() {
+    static X11Library instance;
+    return instance;
+  }
+
+  decltype(&::XChangeProperty) change_property;
+  decltype(&::XCloseDisplay) close_display;
+  decltype(&::XCreateImage) create_image;
+  decltype(&::XCreateSimpleWindow) create_simple_window;
+  decltype(&::XInternAtom) intern_atom;
+  decltype(&::XKeysymToString) keysym_to_string;
+  decltype(&::XLookupKeysym) lookup_keysym;
+  decltype(&::XMapWindow) map_window;
+  decltype(&::XNextEvent) next_event;
+  decltype(&::XOpenDisplay) open_display;
+  decltype(&::XPending) pending;
+  decltype(&::XPutImage) put_image;
+  decltype(&::XSelectInput) select_input;
+  decltype(&::XSetWMProtocols) set_wm_protocols;
+  decltype(&::XStoreName) store_name;
+
+ private:
+  X11Library() : loader_("libX11.so.6") {
+    TI_ERROR_IF(!loader_.loaded(),
+                "Taichi fails to create a window: libX11 is not found."
+                " Consider using the `ti.GUI(show_gui=False)` option, see"
+                " https://docs.taichi.graphics/lang/articles/misc/gui");
+    loader_.load_function("XChangeProperty", change_property);
+    loader_.load_function("XCloseDisplay", close_display);
+    loader_.load_function("XCreateImage", create_image);
+    loader_.load_function("XCreateSimpleWindow", create_simple_window);
+    loader_.load_function("XInternAtom", intern_atom);
+    loader_.load_function("XKeysymToString", keysym_to_string);
+    loader_.load_function("XLookupKeysym", lookup_keysym);
+    loader_.load_function("XMapWindow", map_window);
+    loader_.load_function("XNextEvent", next_event);
+    loader_.load_function("XOpenDisplay", open_display);
+    loader_.load_function("XPending", pending);
+    loader_.load_function("XPutImage", put_image);
+    loader_.load_function("XSelectInput", select_input);
+    loader_.load_function("XSetWMProtocols", set_wm_protocols);
+    loader_.load_function("XStoreName", store_name);
+  }
+
+  DynamicLoader loader_;
+};
+
+X11Library &x11() {
+  return X11Library::get_instance();
+}
+
+}  // namespace
+
 class CXImage {
  public:
   XImage *image;
@@ -26,8 +87,9 @@ class CXImage {
   CXImage(Display *display, Visual *visual, int width, int height)
       : width(width), height(height) {
     image_data.resize(width * height * 4);
-    image = XCreateImage(display, visual, 24, ZPixmap, 0,
-                         (char *)image_data.data(), width, height, 32, 0);
+    image = x11().create_image(display, visual, 24, ZPixmap, 0,
+                               (char *)image_data.data(), width, height,
+                               32, 0);
     TI_ASSERT((void *)image->data == image_data.data());
   }
 
@@ -37,8 +99,8 @@ class CXImage {
           int width,
           int height)
       : width(width), height(height) {
-    image = XCreateImage(display, visual, 24, ZPixmap, 0, (char *)fast_data,
-                         width, height, 32, 0);
+    image = x11().create_image(display, visual, 24, ZPixmap, 0,
+                               (char *)fast_data, width, height, 32, 0);
     TI_ASSERT((void *)image->data == fast_data);
   }
 
@@ -61,11 +123,11 @@ class CXImage {
 };
 
 static std::string lookup_keysym(XEvent *ev) {
-  int key = XLookupKeysym(&ev->xkey, 0);
+  int key = x11().lookup_keysym(&ev->xkey, 0);
   if (isascii(key))
     return std::string(1, key);
   else
-    return XKeysymToString(key);
+    return x11().keysym_to_string(key);
 }
 
 static std::string lookup_button(XEvent *ev) {
@@ -82,9 +144,9 @@ static std::string lookup_button(XEvent *ev) {
 }
 
 void GUI::process_event() {
-  while (XPending((Display *)display)) {
+  while (x11().pending((Display *)display)) {
     XEvent ev;
-    XNextEvent((Display *)display, &ev);
+    x11().next_event((Display *)display, &ev);
     switch (ev.type) {
       case Expose:
         break;
@@ -146,37 +208,40 @@ void GUI::process_event() {
 }
 
 void GUI::create_window() {
-  display = XOpenDisplay(nullptr);
+  display = x11().open_display(nullptr);
   TI_ASSERT_INFO(display,
                  "Taichi fails to create a window."
                  " This is probably due to the lack of an X11 GUI environment."
                  " Consider using the `ti.GUI(show_gui=False)` option, see"
                  " https://docs.taichi.graphics/lang/articles/misc/gui");
   visual = DefaultVisual(display, 0);
-  window =
-      XCreateSimpleWindow((Display *)display, RootWindow((Display *)display, 0),
-                          0, 0, width, height, 1, 0, 0);
+  window = x11().create_simple_window(
+      (Display *)display, RootWindow((Display *)display, 0), 0, 0, width,
+      height, 1, 0, 0);
   TI_ASSERT_INFO(window, "failed to create X window");
 
   if (fullscreen) {
     // https://stackoverflow.com/questions/9083273/x11-fullscreen-window-opengl
-    Atom atoms[2] = {
-        XInternAtom((Display *)display, "_NET_WM_STATE_FULLSCREEN", False), 0};
-    Atom wmstate = XInternAtom((Display *)display, "_NET_WM_STATE", False);
-    XChangeProperty((Display *)display, window, wmstate, XA_ATOM, 32,
-                    PropModeReplace, (unsigned char *)atoms, 1);
+    Atom atoms[2] = {x11().intern_atom((Display *)display,
+                                       "_NET_WM_STATE_FULLSCREEN", False),
+                     0};
+    Atom wmstate =
+        x11().intern_atom((Display *)display, "_NET_WM_STATE", False);
+    x11().change_property((Display *)display, window, wmstate, XA_ATOM, 32,
+                          PropModeReplace, (unsigned char *)atoms, 1);
   }
 
-  XSelectInput((Display *)display, window,
-               ButtonPressMask | ExposureMask | KeyPressMask | KeyReleaseMask |
-                   ButtonPress | ButtonReleaseMask | EnterWindowMask |
-                   LeaveWindowMask | PointerMotionMask);
+  x11().select_input((Display *)display, window,
+                     ButtonPressMask | ExposureMask | KeyPressMask |
+                         KeyReleaseMask | ButtonPress | ButtonReleaseMask |
+                         EnterWindowMask | LeaveWindowMask |
+                         PointerMotionMask);
   wmDeleteMessage = std::vector<char>(sizeof(Atom));
   *(Atom *)wmDeleteMessage.data() =
-      XInternAtom((Display *)display, "WM_DELETE_WINDOW", False);
-  XSetWMProtocols((Display *)display, window, (Atom *)wmDeleteMessage.data(),
-                  1);
-  XMapWindow((Display *)display, window);
+      x11().intern_atom((Display *)display, "WM_DELETE_WINDOW", False);
+  x11().set_wm_protocols((Display *)display, window,
+                         (Atom *)wmDeleteMessage.data(), 1);
+  x11().map_window((Display *)display, window);
   if (!fast_gui)
     img = new CXImage((Display *)display, (Visual *)visual, width, height);
   else
@@ -187,17 +252,17 @@ void GUI::create_window() {
 void GUI::redraw() {
   if (!fast_gui)
     img->set_data(buffer);
-  XPutImage((Display *)display, window, DefaultGC(display, 0), img->image, 0, 0,
-            0, 0, width, height);
+  x11().put_image((Display *)display, window, DefaultGC(display, 0),
+                  img->image, 0, 0, 0, 0, width, height);
 }
 
 void GUI::set_title(std::string title) {
-  XStoreName((Display *)display, window, title.c_str());
+  x11().store_name((Display *)display, window, title.c_str());
 }
 
 GUI::~GUI() {
   if (show_gui) {
-    XCloseDisplay((Display *)display);
+    x11().close_display((Display *)display);
     delete img;
   }
 }
@@ -25,6 +25,12 @@ constexpr std::size_t taichi_result_buffer_error_id = 1;
 constexpr std::size_t taichi_result_buffer_runtime_query_id = 2;
 
 constexpr int taichi_listgen_max_element_size = 1024;
+// The maximum number of SNode levels walked by a fused listgen task.
+constexpr int taichi_listgen_max_fused_levels = 8;
+// The deterministic reductions of a task, and the partial sums of each, see
+// CompileConfig::deterministic_reduction.
+constexpr int taichi_max_num_deterministic_reductions = 8;
+constexpr int taichi_max_num_deterministic_reduction_slots = 2048;
 
 template <typename T, typename G>
 T taichi_union_cast_with_different_sizes(G g) {
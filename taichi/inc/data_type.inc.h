@@ -1,4 +1,5 @@
 PER_TYPE(f16)
+PER_TYPE(bf16)  // storage only, computed in f32
 PER_TYPE(f32)
 PER_TYPE(f64)
 PER_TYPE(i8)
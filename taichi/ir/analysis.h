@@ -103,6 +103,55 @@ std::unordered_set<Stmt *> detect_loops_with_continue(IRNode *root);
 std::unordered_set<SNode *> gather_deactivations(IRNode *root);
 std::pair<std::unordered_set<SNode *>, std::unordered_set<SNode *>>
 gather_snode_read_writes(IRNode *root);
+
+/**
+ * The SNode trees accessed by the offloaded tasks of a kernel, after lowering.
+ * |host_read| is set if the kernel only reads the trees and touches nothing
+ * else shared with the kernels running alongside it, e.g. the global
+ * temporaries, the element lists or the random states, so that it may run on
+ * another stream once the last writers of |read_trees| are done.
+ */
+struct SNodeTreeAccesses {
+  std::unordered_set<int> read_trees;
+  std::unordered_set<int> written_trees;
+  // Some write goes through a pointer whose SNode is unknown.
+  bool writes_unknown{false};
+  bool host_read{false};
+};
+
+SNodeTreeAccesses gather_snode_tree_accesses(IRNode *root);
+
+/**
+ * Where the struct-for tasks read a place SNode, relative to their loop
+ * indices: the lowest and highest offset in each dimension. Irregular if some
+ * read is not at the loop indices plus constants.
+ */
+struct StencilFootprint {
+  std::vector<std::pair<int, int>> offsets;
+  bool irregular{false};
+};
+
+std::unordered_map<SNode *, StencilFootprint> gather_stencil_footprints(
+    IRNode *root);
+
+/**
+ * How the consecutive threads of a parallel task access a place SNode, i.e.
+ * the distance of their addresses in the innermost loop index of the task.
+ */
+struct GlobalAccessPattern {
+  enum class Kind { coalesced, strided, random };
+  SNode *snode{nullptr};
+  Kind kind{Kind::coalesced};
+  // The estimated bytes moved from memory per byte used, assuming 32-byte
+  // memory transactions: 1 when coalesced, up to 32 / element size.
+  float64 bytes_per_useful_byte{1};
+};
+
+/**
+ * The patterns of the accesses to the dense place SNodes in the offloaded
+ * task @param root, one per place SNode and pattern. Empty for serial tasks.
+ */
+std::vector<GlobalAccessPattern> gather_access_patterns(IRNode *root);
 std::vector<Stmt *> gather_statements(IRNode *root,
                                       const std::function<bool(Stmt *)> &test);
 void gather_uniquely_accessed_bit_structs(IRNode *root, AnalysisManager *amgr);
@@ -112,6 +161,21 @@ std::unique_ptr<std::unordered_set<AtomicOpStmt *>> gather_used_atomics(
     IRNode *root);
 std::vector<Stmt *> get_load_pointers(Stmt *load_stmt);
 
+/**
+ * Hashes the structure of the IR, i.e., the types, the fields and the
+ * operands of the statements, and the blocks containing them, in a single
+ * pass. Two roots satisfying same_statements() have the same hash, whatever
+ * the ids of their statements, and the hash is the same across processes
+ * (except for the fields only identified by their addresses, e.g. meshes),
+ * so that it can key the on-disk caches.
+ *
+ * Only supports the CHI IR, i.e., the IR after lowering.
+ *
+ * @param root
+ *   The root to hash.
+ */
+uint64 hash(IRNode *root);
+
 /**
  * Get all input SNode value states of an offloaded task with control-flow
  * graph analysis.
@@ -201,6 +265,13 @@ bool same_value(
 
 DiffRange value_diff_loop_index(Stmt *stmt, Stmt *loop, int index_id);
 
+/**
+ * The range [low, high) of the values of |stmt|, with a coeff of 0. Only
+ * known, i.e. related(), when the values depend on nothing but constants and
+ * the indices of range-fors with constant bounds.
+ */
+DiffRange value_range(Stmt *stmt);
+
 /**
  * Result of the value_diff_ptr_index pass.
  */
@@ -0,0 +1,405 @@
+#include "taichi/ir/arithmetic_interpretor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "taichi/ir/statements.h"
+#include "taichi/ir/type_utils.h"
+
+namespace taichi {
+namespace lang {
+
+namespace {
+
+int bit_width(DataType dt) {
+  return data_type_size(dt) * 8;
+}
+
+// The value of an integral constant, sign-extended to 64 bits for the signed
+// types and zero-extended for the unsigned ones.
+uint64 get_bits(const TypedConstant &c) {
+  return is_signed(c.dt) ? (uint64)c.val_int() : c.val_uint();
+}
+
+// The low bits of |bits| interpreted as a signed integer of the width of
+// |dt|.
+int64 as_signed(DataType dt, uint64 bits) {
+  return bit_width(dt) == 32 ? (int64)(int32)(uint32)bits : (int64)bits;
+}
+
+uint64 as_unsigned(DataType dt, uint64 bits) {
+  return bit_width(dt) == 32 ? (uint64)(uint32)bits : bits;
+}
+
+// Truncates |bits| to |dt|.
+TypedConstant make_integral(DataType dt, uint64 bits) {
+  if (is_signed(dt)) {
+    return TypedConstant(dt, as_signed(dt, bits));
+  }
+  return TypedConstant(dt, as_unsigned(dt, bits));
+}
+
+template <typename T>
+T get_real(const TypedConstant &c) {
+  return (T)c.val_float();
+}
+
+TypedConstant make_bool(bool value) {
+  // Comparisons produce -1 for true, like the sign extension of an i1.
+  return TypedConstant(PrimitiveType::i32, value ? -1 : 0);
+}
+
+template <typename T>
+std::optional<T> evaluate_real(UnaryOpType op, T x, bool has_libm) {
+  switch (op) {
+    case UnaryOpType::neg:
+      return -x;
+    case UnaryOpType::abs:
+      return std::abs(x);
+    case UnaryOpType::sqrt:
+      return std::sqrt(x);
+    case UnaryOpType::rsqrt:
+      return T(1) / std::sqrt(x);
+    case UnaryOpType::round:
+      return std::round(x);
+    case UnaryOpType::floor:
+      return std::floor(x);
+    case UnaryOpType::ceil:
+      return std::ceil(x);
+    case UnaryOpType::sgn:
+      return x > 0 ? T(1) : (x < 0 ? T(-1) : T(0));
+    default:
+      break;
+  }
+  if (!has_libm) {
+    return std::nullopt;
+  }
+  switch (op) {
+    case UnaryOpType::sin:
+      return std::sin(x);
+    case UnaryOpType::asin:
+      return std::asin(x);
+    case UnaryOpType::cos:
+      return std::cos(x);
+    case UnaryOpType::acos:
+      return std::acos(x);
+    case UnaryOpType::tan:
+      return std::tan(x);
+    case UnaryOpType::tanh:
+      return std::tanh(x);
+    case UnaryOpType::exp:
+      return std::exp(x);
+    case UnaryOpType::log:
+      return std::log(x);
+    default:
+      return std::nullopt;
+  }
+}
+
+template <typename T>
+std::optional<T> evaluate_real(BinaryOpType op, T a, T b, bool has_libm) {
+  switch (op) {
+    case BinaryOpType::add:
+      return a + b;
+    case BinaryOpType::sub:
+      return a - b;
+    case BinaryOpType::mul:
+      return a * b;
+    case BinaryOpType::div:
+    case BinaryOpType::truediv:
+      return a / b;
+    case BinaryOpType::floordiv:
+      return std::floor(a / b);
+    case BinaryOpType::max:
+      return std::fmax(a, b);
+    case BinaryOpType::min:
+      return std::fmin(a, b);
+    case BinaryOpType::atan2:
+      return has_libm ? std::optional<T>(std::atan2(a, b)) : std::nullopt;
+    case BinaryOpType::pow:
+      return has_libm ? std::optional<T>(std::pow(a, b)) : std::nullopt;
+    default:
+      return std::nullopt;
+  }
+}
+
+template <typename T>
+std::optional<bool> compare(BinaryOpType op, T a, T b) {
+  switch (op) {
+    case BinaryOpType::cmp_lt:
+      return a < b;
+    case BinaryOpType::cmp_le:
+      return a <= b;
+    case BinaryOpType::cmp_gt:
+      return a > b;
+    case BinaryOpType::cmp_ge:
+      return a >= b;
+    case BinaryOpType::cmp_eq:
+      return a == b;
+    case BinaryOpType::cmp_ne:
+      // An ordered comparison, which is false if either side is a NaN.
+      if constexpr (std::is_floating_point_v<T>) {
+        if (std::isnan(a) || std::isnan(b)) {
+          return false;
+        }
+      }
+      return a != b;
+    default:
+      return std::nullopt;
+  }
+}
+
+// |dt| is the type of |a| and the result. |b| is of |dt| as well, except for
+// the shifts, where it is the amount.
+std::optional<uint64> evaluate_integral(BinaryOpType op,
+                                        DataType dt,
+                                        uint64 a,
+                                        uint64 b) {
+  const int width = bit_width(dt);
+  const int64 sa = as_signed(dt, a), sb = as_signed(dt, b);
+  const uint64 ua = as_unsigned(dt, a), ub = as_unsigned(dt, b);
+  const int64 min_value = width == 32 ? std::numeric_limits<int32>::min()
+                                      : std::numeric_limits<int64>::min();
+  switch (op) {
+    case BinaryOpType::add:
+      return a + b;
+    case BinaryOpType::sub:
+      return a - b;
+    case BinaryOpType::mul:
+      return a * b;
+    case BinaryOpType::div:
+    case BinaryOpType::mod:
+    case BinaryOpType::floordiv: {
+      // Signed on all the integral types, like the generated sdiv and srem.
+      if (sb == 0 || (sa == min_value && sb == -1)) {
+        return std::nullopt;
+      }
+      if (op == BinaryOpType::div) {
+        return (uint64)(sa / sb);
+      } else if (op == BinaryOpType::mod) {
+        return (uint64)(sa % sb);
+      }
+      if (!is_signed(dt)) {
+        return std::nullopt;
+      }
+      int64 q = sa / sb;
+      if ((sa < 0) != (sb < 0) && q * sb != sa) {
+        q--;
+      }
+      return (uint64)q;
+    }
+    case BinaryOpType::bit_and:
+      return a & b;
+    case BinaryOpType::bit_or:
+      return a | b;
+    case BinaryOpType::bit_xor:
+      return a ^ b;
+    case BinaryOpType::bit_shl:
+    case BinaryOpType::bit_sar:
+    case BinaryOpType::bit_shr:
+      if ((int64)b < 0 || (int64)b >= width) {
+        return std::nullopt;
+      }
+      if (op == BinaryOpType::bit_shl) {
+        return a << b;
+      } else if (op == BinaryOpType::bit_sar && is_signed(dt)) {
+        return (uint64)(sa >> b);
+      }
+      return ua >> b;
+    case BinaryOpType::max:
+      return is_signed(dt) ? (uint64)std::max(sa, sb) : std::max(ua, ub);
+    case BinaryOpType::min:
+      return is_signed(dt) ? (uint64)std::min(sa, sb) : std::min(ua, ub);
+    case BinaryOpType::pow: {
+      if (!is_signed(dt) || sb < 0) {
+        return std::nullopt;
+      }
+      uint64 result = 1, base = a;
+      for (uint64 n = ub; n; n >>= 1) {
+        if (n & 1) {
+          result *= base;
+        }
+        base *= base;
+      }
+      return result;
+    }
+    default:
+      return std::nullopt;
+  }
+}
+
+std::optional<TypedConstant> cast_value(const TypedConstant &x,
+                                        DataType to) {
+  const DataType from = x.dt;
+  if (is_integral(from) && is_integral(to)) {
+    return make_integral(to, get_bits(x));
+  } else if (is_integral(from)) {
+    const uint64 bits = get_bits(x);
+    if (to->is_primitive(PrimitiveTypeID::f32)) {
+      return TypedConstant(to, is_signed(from) ? (float32)(int64)bits
+                                               : (float32)bits);
+    }
+    return TypedConstant(to, is_signed(from) ? (float64)(int64)bits
+                                             : (float64)bits);
+  } else if (is_real(to)) {
+    if (to->is_primitive(PrimitiveTypeID::f32)) {
+      return TypedConstant(to, (float32)x.val_float());
+    }
+    return TypedConstant(to, x.val_float());
+  }
+  // The conversions out of the range of the integral type are undefined.
+  const float64 value = std::trunc(x.val_float());
+  const float64 limit = std::ldexp(1.0, bit_width(to) - is_signed(to));
+  const float64 lower = is_signed(to) ? -limit : 0.0;
+  if (std::isnan(value) || value < lower || value >= limit) {
+    return std::nullopt;
+  }
+  if (is_signed(to)) {
+    return make_integral(to, (uint64)(int64)value);
+  }
+  return make_integral(to, (uint64)value);
+}
+
+}  // namespace
+
+bool ArithmeticInterpretor::is_supported_type(DataType dt) {
+  // ConstStmt of `bad` types like `i8` is not supported by LLVM.
+  // Discussion:
+  // https://github.com/taichi-dev/taichi/pull/839#issuecomment-625902727
+  return dt->is_primitive(PrimitiveTypeID::i32) ||
+         dt->is_primitive(PrimitiveTypeID::i64) ||
+         dt->is_primitive(PrimitiveTypeID::u32) ||
+         dt->is_primitive(PrimitiveTypeID::u64) ||
+         dt->is_primitive(PrimitiveTypeID::f32) ||
+         dt->is_primitive(PrimitiveTypeID::f64);
+}
+
+std::optional<TypedConstant> ArithmeticInterpretor::evaluate(
+    const UnaryOpStmt *stmt,
+    const TypedConstant &operand) const {
+  const DataType dt = operand.dt;
+  const DataType ret_type = stmt->ret_type;
+  if (!is_supported_type(dt) || !is_supported_type(ret_type)) {
+    return std::nullopt;
+  }
+  const auto op = stmt->op_type;
+  if (op == UnaryOpType::cast_value) {
+    return cast_value(operand, stmt->cast_type);
+  } else if (op == UnaryOpType::cast_bits) {
+    if (data_type_size(dt) != data_type_size(stmt->cast_type)) {
+      return std::nullopt;
+    }
+    TypedConstant result(stmt->cast_type);
+    result.value_bits = operand.value_bits;
+    if (data_type_size(dt) == 4) {
+      // Only the low bits of the union are those of a 32-bit operand.
+      result.value_bits &= 0xffffffffu;
+    }
+    return result;
+  }
+  if (ret_type != dt) {
+    if (!(op == UnaryOpType::logic_not && is_integral(ret_type))) {
+      return std::nullopt;
+    }
+  }
+  const bool has_libm = arch_is_cpu(arch_);
+  if (dt->is_primitive(PrimitiveTypeID::f32)) {
+    if (auto r = evaluate_real<float32>(op, get_real<float32>(operand),
+                                        has_libm)) {
+      return TypedConstant(dt, *r);
+    }
+    return std::nullopt;
+  } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
+    if (auto r = evaluate_real<float64>(op, get_real<float64>(operand),
+                                        has_libm)) {
+      return TypedConstant(dt, *r);
+    }
+    return std::nullopt;
+  }
+  const uint64 bits = get_bits(operand);
+  // The runtime only has the abs and logic_not of i32.
+  const bool is_i32 = dt->is_primitive(PrimitiveTypeID::i32);
+  switch (op) {
+    case UnaryOpType::neg:
+      return make_integral(dt, 0 - bits);
+    case UnaryOpType::bit_not:
+      return make_integral(dt, ~bits);
+    case UnaryOpType::abs:
+      if (!is_i32) {
+        return std::nullopt;
+      }
+      return make_integral(dt, (int64)bits < 0 ? 0 - bits : bits);
+    case UnaryOpType::logic_not:
+      if (!is_i32) {
+        return std::nullopt;
+      }
+      return make_integral(ret_type, bits == 0);
+    default:
+      return std::nullopt;
+  }
+}
+
+std::optional<TypedConstant> ArithmeticInterpretor::evaluate(
+    const BinaryOpStmt *stmt,
+    const TypedConstant &lhs,
+    const TypedConstant &rhs) const {
+  const DataType dt = lhs.dt;
+  const DataType ret_type = stmt->ret_type;
+  if (!is_supported_type(dt) || !is_supported_type(rhs.dt) ||
+      !is_supported_type(ret_type)) {
+    return std::nullopt;
+  }
+  const auto op = stmt->op_type;
+  const bool is_shift = op == BinaryOpType::bit_shl ||
+                        op == BinaryOpType::bit_sar ||
+                        op == BinaryOpType::bit_shr;
+  if (!is_shift && rhs.dt != dt) {
+    return std::nullopt;
+  }
+  if (is_comparison(op)) {
+    std::optional<bool> r;
+    if (dt->is_primitive(PrimitiveTypeID::f32)) {
+      r = compare(op, get_real<float32>(lhs), get_real<float32>(rhs));
+    } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
+      r = compare(op, get_real<float64>(lhs), get_real<float64>(rhs));
+    } else if (is_signed(dt)) {
+      r = compare(op, lhs.val_int(), rhs.val_int());
+    } else {
+      r = compare(op, lhs.val_uint(), rhs.val_uint());
+    }
+    if (!r || !ret_type->is_primitive(PrimitiveTypeID::i32)) {
+      return std::nullopt;
+    }
+    return make_bool(*r);
+  }
+  if (ret_type != dt) {
+    return std::nullopt;
+  }
+  const bool has_libm = arch_is_cpu(arch_);
+  if (dt->is_primitive(PrimitiveTypeID::f32)) {
+    if (auto r = evaluate_real<float32>(op, get_real<float32>(lhs),
+                                        get_real<float32>(rhs), has_libm)) {
+      return TypedConstant(dt, *r);
+    }
+    return std::nullopt;
+  } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
+    if (auto r = evaluate_real<float64>(op, get_real<float64>(lhs),
+                                        get_real<float64>(rhs), has_libm)) {
+      return TypedConstant(dt, *r);
+    }
+    return std::nullopt;
+  }
+  if (is_real(rhs.dt)) {
+    return std::nullopt;
+  }
+  if (auto r = evaluate_integral(op, dt, get_bits(lhs), get_bits(rhs))) {
+    return make_integral(dt, *r);
+  }
+  return std::nullopt;
+}
+
+}  // namespace lang
+}  // namespace taichi
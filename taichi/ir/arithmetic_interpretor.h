@@ -0,0 +1,48 @@
+#pragma once
+
+#include <optional>
+
+#include "taichi/ir/type.h"
+#include "taichi/program/arch.h"
+
+namespace taichi {
+namespace lang {
+
+class BinaryOpStmt;
+class UnaryOpStmt;
+
+/**
+ * Evaluates the arithmetic of the IR on constants, on the host, with the
+ * semantics of the code generated for |arch|. Used by constant folding.
+ *
+ * The integral operations wrap around like the generated code. The real ones
+ * are done in the precision of their type. The math functions of libm (sin,
+ * exp, pow, ...) are only evaluated when |arch| is a CPU, whose runtime calls
+ * the very same functions; the GPUs have their own implementations, which
+ * may differ in the last bits.
+ *
+ * std::nullopt is returned when the result is undefined in the generated
+ * code (e.g. a division by zero, or a shift by the width of the type or
+ * more), or for the types and operations which are not supported.
+ */
+class ArithmeticInterpretor {
+ public:
+  explicit ArithmeticInterpretor(Arch arch) : arch_(arch) {
+  }
+
+  std::optional<TypedConstant> evaluate(const UnaryOpStmt *stmt,
+                                        const TypedConstant &operand) const;
+
+  std::optional<TypedConstant> evaluate(const BinaryOpStmt *stmt,
+                                        const TypedConstant &lhs,
+                                        const TypedConstant &rhs) const;
+
+  // The types of the constants which can be evaluated.
+  static bool is_supported_type(DataType dt);
+
+ private:
+  Arch arch_;
+};
+
+}  // namespace lang
+}  // namespace taichi
@@ -6,10 +6,25 @@
 #include "taichi/ir/analysis.h"
 #include "taichi/ir/statements.h"
 #include "taichi/system/profiler.h"
+#include "taichi/util/bit.h"
 
 namespace taichi {
 namespace lang {
 
+namespace {
+
+// Converts a bitset over the indices of |stmts| back to a set of statements.
+void to_stmt_set(const bit::Bitset &bits,
+                 const std::vector<Stmt *> &stmts,
+                 std::unordered_set<Stmt *> &result) {
+  result.clear();
+  for (int i = bits.find_first_one(); i != -1; i = bits.lower_bound(i + 1)) {
+    result.insert(stmts[i]);
+  }
+}
+
+}  // namespace
+
 CFGNode::CFGNode(Block *block,
                  int begin_location,
                  int end_location,
@@ -438,6 +453,7 @@ bool CFGNode::dead_store_elimination(bool after_lower_access) {
         // Do not eliminate AllocaStmt and AdStackAllocaStmt here.
         if (!stmt->is<AllocaStmt>() && !stmt->is<AdStackAllocaStmt>() &&
             !stmt->is<ExternalFuncCallStmt>() &&
+            !stmt->is<InternalFuncStmt>() &&
             !may_contain_variable(live_in_this_node, store_ptr) &&
             (contain_variable(killed_in_this_node, store_ptr) ||
              !may_contain_variable(live_out, store_ptr))) {
@@ -616,8 +632,6 @@ void ControlFlowGraph::print_graph_structure() const {
 void ControlFlowGraph::reaching_definition_analysis(bool after_lower_access) {
   TI_AUTO_PROF;
   const int num_nodes = size();
-  std::queue<CFGNode *> to_visit;
-  std::unordered_map<CFGNode *, bool> in_queue;
   TI_ASSERT(nodes[start_node]->empty());
   nodes[start_node]->reach_gen.clear();
   nodes[start_node]->reach_kill.clear();
@@ -643,53 +657,85 @@ void ControlFlowGraph::reaching_definition_analysis(bool after_lower_access) {
     if (i != start_node) {
       nodes[i]->reaching_definition_analysis(after_lower_access);
     }
-    nodes[i]->reach_in.clear();
-    nodes[i]->reach_out = nodes[i]->reach_gen;
-    to_visit.push(nodes[i].get());
-    in_queue[nodes[i].get()] = true;
+  }
+
+  // Number the definitions, so that the sets of definitions in the worklist
+  // algorithm are bitsets.
+  std::vector<Stmt *> defs;
+  std::unordered_map<Stmt *, int> def_ids;
+  for (int i = 0; i < num_nodes; i++) {
+    for (auto stmt : nodes[i]->reach_gen) {
+      if (def_ids.emplace(stmt, (int)defs.size()).second) {
+        defs.push_back(stmt);
+      }
+    }
+  }
+  const int num_defs = defs.size();
+  std::unordered_map<CFGNode *, int> node_ids;
+  std::vector<bit::Bitset> gen(num_nodes, bit::Bitset(num_defs));
+  for (int i = 0; i < num_nodes; i++) {
+    node_ids[nodes[i].get()] = i;
+    for (auto stmt : nodes[i]->reach_gen) {
+      gen[i][def_ids[stmt]] = true;
+    }
+  }
+  std::vector<bit::Bitset> in(num_nodes, bit::Bitset(num_defs));
+  std::vector<bit::Bitset> out = gen;
+  // Whether a definition reaching a node survives it is only computed the
+  // first time the definition reaches the node.
+  std::vector<bit::Bitset> evaluated(num_nodes, bit::Bitset(num_defs));
+  std::vector<bit::Bitset> preserved(num_nodes, bit::Bitset(num_defs));
+  auto killed_by = [&](CFGNode *node, Stmt *stmt) {
+    auto store_ptrs = irpass::analysis::get_store_destination(stmt);
+    if (store_ptrs.empty()) {  // the case of a global pointer
+      return node->reach_kill_variable(stmt);
+    }
+    for (auto store_ptr : store_ptrs) {
+      if (!node->reach_kill_variable(store_ptr)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  std::queue<int> to_visit;
+  std::vector<bool> in_queue(num_nodes, true);
+  for (int i = 0; i < num_nodes; i++) {
+    to_visit.push(i);
   }
 
   // The worklist algorithm.
   while (!to_visit.empty()) {
-    auto now = to_visit.front();
+    const int now = to_visit.front();
     to_visit.pop();
     in_queue[now] = false;
 
-    now->reach_in.clear();
-    for (auto prev_node : now->prev) {
-      now->reach_in.insert(prev_node->reach_out.begin(),
-                           prev_node->reach_out.end());
+    bit::Bitset new_in(num_defs);
+    for (auto prev_node : nodes[now]->prev) {
+      new_in |= out[node_ids[prev_node]];
     }
-    auto old_out = std::move(now->reach_out);
-    now->reach_out = now->reach_gen;
-    for (auto stmt : now->reach_in) {
-      auto store_ptrs = irpass::analysis::get_store_destination(stmt);
-      bool killed;
-      if (store_ptrs.empty()) {  // the case of a global pointer
-        killed = now->reach_kill_variable(stmt);
-      } else {
-        killed = true;
-        for (auto store_ptr : store_ptrs) {
-          if (!now->reach_kill_variable(store_ptr)) {
-            killed = false;
-            break;
-          }
-        }
-      }
-      if (!killed) {
-        now->reach_out.insert(stmt);
-      }
+    for (int d : evaluated[now].or_eq_get_update_list(new_in)) {
+      preserved[now][d] = !killed_by(nodes[now].get(), defs[d]);
     }
-    if (now->reach_out != old_out) {
+    auto new_out = gen[now] | (new_in & preserved[now]);
+    in[now] = std::move(new_in);
+    if (new_out != out[now]) {
       // changed
-      for (auto next_node : now->next) {
-        if (!in_queue[next_node]) {
-          to_visit.push(next_node);
-          in_queue[next_node] = true;
+      out[now] = std::move(new_out);
+      for (auto next_node : nodes[now]->next) {
+        const int next = node_ids[next_node];
+        if (!in_queue[next]) {
+          to_visit.push(next);
+          in_queue[next] = true;
         }
       }
     }
   }
+
+  for (int i = 0; i < num_nodes; i++) {
+    to_stmt_set(in[i], defs, nodes[i]->reach_in);
+    to_stmt_set(out[i], defs, nodes[i]->reach_out);
+  }
 }
 
 void ControlFlowGraph::live_variable_analysis(
@@ -697,8 +743,6 @@ void ControlFlowGraph::live_variable_analysis(
     const std::optional<LiveVarAnalysisConfig> &config_opt) {
   TI_AUTO_PROF;
   const int num_nodes = size();
-  std::queue<CFGNode *> to_visit;
-  std::unordered_map<CFGNode *, bool> in_queue;
   TI_ASSERT(nodes[final_node]->empty());
   nodes[final_node]->live_gen.clear();
   nodes[final_node]->live_kill.clear();
@@ -733,45 +777,79 @@ void ControlFlowGraph::live_variable_analysis(
       }
     }
   }
-  for (int i = num_nodes - 1; i >= 0; i--) {
-    // push into the queue in reversed order to make it slightly faster
+  for (int i = 0; i < num_nodes; i++) {
     if (i != final_node) {
       nodes[i]->live_variable_analysis(after_lower_access);
     }
-    nodes[i]->live_out.clear();
-    nodes[i]->live_in = nodes[i]->live_gen;
-    to_visit.push(nodes[i].get());
-    in_queue[nodes[i].get()] = true;
+  }
+
+  // Number the variables, so that the sets of variables in the worklist
+  // algorithm are bitsets.
+  std::vector<Stmt *> vars;
+  std::unordered_map<Stmt *, int> var_ids;
+  for (int i = 0; i < num_nodes; i++) {
+    for (auto stmt : nodes[i]->live_gen) {
+      if (var_ids.emplace(stmt, (int)vars.size()).second) {
+        vars.push_back(stmt);
+      }
+    }
+  }
+  const int num_vars = vars.size();
+  std::unordered_map<CFGNode *, int> node_ids;
+  std::vector<bit::Bitset> gen(num_nodes, bit::Bitset(num_vars));
+  for (int i = 0; i < num_nodes; i++) {
+    node_ids[nodes[i].get()] = i;
+    for (auto stmt : nodes[i]->live_gen) {
+      gen[i][var_ids[stmt]] = true;
+    }
+  }
+  std::vector<bit::Bitset> in = gen;
+  std::vector<bit::Bitset> out(num_nodes, bit::Bitset(num_vars));
+  // Whether a variable live at the end of a node is killed by it is only
+  // computed the first time the variable is live there.
+  std::vector<bit::Bitset> evaluated(num_nodes, bit::Bitset(num_vars));
+  std::vector<bit::Bitset> preserved(num_nodes, bit::Bitset(num_vars));
+
+  std::queue<int> to_visit;
+  std::vector<bool> in_queue(num_nodes, true);
+  for (int i = num_nodes - 1; i >= 0; i--) {
+    // push into the queue in reversed order to make it slightly faster
+    to_visit.push(i);
   }
 
   // The worklist algorithm.
   while (!to_visit.empty()) {
-    auto now = to_visit.front();
+    const int now = to_visit.front();
     to_visit.pop();
     in_queue[now] = false;
 
-    now->live_out.clear();
-    for (auto next_node : now->next) {
-      now->live_out.insert(next_node->live_in.begin(),
-                           next_node->live_in.end());
+    bit::Bitset new_out(num_vars);
+    for (auto next_node : nodes[now]->next) {
+      new_out |= in[node_ids[next_node]];
     }
-    auto old_in = std::move(now->live_in);
-    now->live_in = now->live_gen;
-    for (auto stmt : now->live_out) {
-      if (!CFGNode::contain_variable(now->live_kill, stmt)) {
-        now->live_in.insert(stmt);
-      }
+    for (int v : evaluated[now].or_eq_get_update_list(new_out)) {
+      preserved[now][v] =
+          !CFGNode::contain_variable(nodes[now]->live_kill, vars[v]);
     }
-    if (now->live_in != old_in) {
+    auto new_in = gen[now] | (new_out & preserved[now]);
+    out[now] = std::move(new_out);
+    if (new_in != in[now]) {
       // changed
-      for (auto prev_node : now->prev) {
-        if (!in_queue[prev_node]) {
-          to_visit.push(prev_node);
-          in_queue[prev_node] = true;
+      in[now] = std::move(new_in);
+      for (auto prev_node : nodes[now]->prev) {
+        const int prev = node_ids[prev_node];
+        if (!in_queue[prev]) {
+          to_visit.push(prev);
+          in_queue[prev] = true;
         }
       }
     }
   }
+
+  for (int i = 0; i < num_nodes; i++) {
+    to_stmt_set(in[i], vars, nodes[i]->live_in);
+    to_stmt_set(out[i], vars, nodes[i]->live_out);
+  }
 }
 
 void ControlFlowGraph::simplify_graph() {
@@ -146,7 +146,7 @@ void RandExpression::type_check() {
 }
 
 void RandExpression::flatten(FlattenContext *ctx) {
-  auto ran = std::make_unique<RandStmt>(dt);
+  auto ran = std::make_unique<RandStmt>(dt, counter_based);
   ctx->push_back(std::move(ran));
   stmt = ctx->back_stmt();
 }
@@ -187,6 +187,8 @@ void UnaryOpExpression::type_check() {
         fmt::format("'{}' takes real inputs only, however '{}' is provided",
                     unary_op_type_name(type), operand->ret_type->to_string()));
   ret_type = is_cast() ? cast_type : operand->ret_type;
+  if (ret_type->is_primitive(PrimitiveTypeID::bf16))
+    ret_type = PrimitiveType::f32;
 }
 
 bool UnaryOpExpression::is_cast() const {
@@ -281,6 +283,9 @@ void InternalFuncCallExpression::type_check() {
     TI_ASSERT_TYPE_CHECKED(arg);
     // no arg type compatibility check for now due to lack of specification
   }
+  for (auto &output : outputs) {
+    TI_ASSERT_TYPE_CHECKED(output);
+  }
   // internal func calls have default return type
   ret_type = PrimitiveType::i32;
 }
@@ -291,7 +296,13 @@ void InternalFuncCallExpression::flatten(FlattenContext *ctx) {
     args[i]->flatten(ctx);
     args_stmts[i] = args[i]->stmt;
   }
-  ctx->push_back<InternalFuncStmt>(func_name, args_stmts);
+  std::vector<Stmt *> output_stmts;
+  for (auto &s : outputs) {
+    TI_ASSERT_INFO(s.is<IdExpression>(),
+                   "internal func call outputs must be local variables.");
+    output_stmts.push_back(s.cast<IdExpression>()->flatten_noload(ctx));
+  }
+  ctx->push_back<InternalFuncStmt>(func_name, args_stmts, output_stmts);
   stmt = ctx->back_stmt();
 }
 
@@ -370,7 +381,8 @@ void GlobalPtrExpression::type_check() {
                         "provided as index {}",
                         expr->ret_type->to_string(), i));
     }
-    ret_type = var.cast<ExternalTensorExpression>()->dt;
+    ret_type =
+        var.cast<ExternalTensorExpression>()->dt->get_compute_type();
   } else {
     TI_ERROR("Invalid GlobalPtrExpression");
   }
@@ -741,6 +753,39 @@ void ExternalTensorShapeAlongAxisExpression::flatten(FlattenContext *ctx) {
   stmt = ctx->back_stmt();
 }
 
+void TextureOpExpression::type_check() {
+  if (args.size() != num_dims + 1) {
+    throw TaichiTypeError(
+        fmt::format("'{}' of a {}D texture takes {} coordinates and a level "
+                    "of detail, however {} arguments are provided",
+                    texture_op_type_name(op), num_dims, num_dims,
+                    args.size()));
+  }
+  const DataType expected = op == TextureOpType::sample_lod
+                                ? PrimitiveType::f32
+                                : PrimitiveType::i32;
+  for (auto &arg : args) {
+    TI_ASSERT_TYPE_CHECKED(arg);
+    if (arg->ret_type != expected) {
+      throw TaichiTypeError(fmt::format(
+          "'{}' takes {} arguments, however '{}' is provided",
+          texture_op_type_name(op), expected->to_string(),
+          arg->ret_type->to_string()));
+    }
+  }
+  ret_type = PrimitiveType::f32;
+}
+
+void TextureOpExpression::flatten(FlattenContext *ctx) {
+  std::vector<Stmt *> args_stmts(args.size());
+  for (int i = 0; i < (int)args.size(); ++i) {
+    args[i]->flatten(ctx);
+    args_stmts[i] = args[i]->stmt;
+  }
+  ctx->push_back<TextureOpStmt>(op, arg_id, num_dims, args_stmts, channel);
+  stmt = ctx->back_stmt();
+}
+
 void FuncCallExpression::type_check() {
   for (auto &arg : args.exprs) {
     TI_ASSERT_TYPE_CHECKED(arg);
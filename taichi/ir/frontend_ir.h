@@ -262,8 +262,10 @@ class ArgLoadExpression : public Expression {
 class RandExpression : public Expression {
  public:
   DataType dt;
+  bool counter_based;
 
-  RandExpression(DataType dt) : dt(dt) {
+  RandExpression(DataType dt, bool counter_based = false)
+      : dt(dt), counter_based(counter_based) {
   }
 
   void type_check() override;
@@ -357,10 +359,13 @@ class InternalFuncCallExpression : public Expression {
  public:
   std::string func_name;
   std::vector<Expr> args;
+  // Local variables written by the function through pointers.
+  std::vector<Expr> outputs;
 
   InternalFuncCallExpression(const std::string &func_name,
-                             const std::vector<Expr> &args_)
-      : func_name(func_name) {
+                             const std::vector<Expr> &args_,
+                             const std::vector<Expr> &outputs = {})
+      : func_name(func_name), outputs(outputs) {
     for (auto &a : args_) {
       args.push_back(load_if_ptr(a));
     }
@@ -377,6 +382,10 @@ class InternalFuncCallExpression : public Expression {
       }
       args[i]->serialize(ss);
     }
+    for (auto &s : outputs) {
+      ss << ", out ";
+      s->serialize(ss);
+    }
     ss << ')';
   }
 
@@ -471,6 +480,7 @@ class GlobalVariableExpression : public Expression {
   TypedConstant ambient_value;
   bool is_primal;
   Expr adjoint;
+  Expr dual;
 
   GlobalVariableExpression(DataType dt, const Identifier &ident)
       : ident(ident), dt(dt) {
@@ -778,6 +788,42 @@ class ExternalTensorShapeAlongAxisExpression : public Expression {
   void flatten(FlattenContext *ctx) override;
 };
 
+// A channel of a texture read, see TextureOpStmt.
+class TextureOpExpression : public Expression {
+ public:
+  TextureOpType op;
+  int arg_id;
+  int num_dims;
+  std::vector<Expr> args;
+  int channel;
+
+  TextureOpExpression(TextureOpType op,
+                      int arg_id,
+                      int num_dims,
+                      const std::vector<Expr> &args_,
+                      int channel)
+      : op(op), arg_id(arg_id), num_dims(num_dims), channel(channel) {
+    for (auto &a : args_) {
+      args.push_back(load_if_ptr(a));
+    }
+  }
+
+  void type_check() override;
+
+  void serialize(std::ostream &ss) override {
+    ss << "texture_" << texture_op_type_name(op) << '(';
+    for (int i = 0; i < args.size(); i++) {
+      if (i != 0) {
+        ss << ", ";
+      }
+      args[i]->serialize(ss);
+    }
+    ss << ", arg_id=" << arg_id << ", channel=" << channel << ')';
+  }
+
+  void flatten(FlattenContext *ctx) override;
+};
+
 class FuncCallExpression : public Expression {
  public:
   Function *func;
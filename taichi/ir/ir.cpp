@@ -7,6 +7,7 @@
 // #include "taichi/ir/analysis.h"
 #include "taichi/ir/statements.h"
 #include "taichi/ir/transforms.h"
+#include "taichi/ir/type_utils.h"
 
 namespace taichi {
 namespace lang {
@@ -83,6 +84,50 @@ class StatementTypeNameVisitor : public IRVisitor {
 #undef PER_STATEMENT
 };
 
+uint64 hash_combine(uint64 seed, uint64 value) {
+  // The finalizer of MurmurHash3, so that every bit of |value| affects every
+  // bit of the result.
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+uint64 stable_hash(const std::string &str) {
+  // 64-bit FNV-1a.
+  uint64 ret = 0xcbf29ce484222325ULL;
+  for (char c : str) {
+    ret = (ret ^ (uint8)c) * 0x100000001b3ULL;
+  }
+  return ret;
+}
+
+uint64 stable_hash(const DataType &dt) {
+  // The address of the type is unique in a process but not across them.
+  if (auto primitive = dt->cast<PrimitiveType>()) {
+    return hash_combine(1, (uint64)primitive->type);
+  } else if (auto pointer = dt->cast<PointerType>()) {
+    return hash_combine(2, stable_hash(DataType(pointer->get_pointee_type())));
+  } else {
+    // The custom types are rare enough to go through their names.
+    return hash_combine(3, stable_hash(dt->to_string()));
+  }
+}
+
+uint64 stable_hash(const TypedConstant &val) {
+  uint64 bits = val.value_bits;
+  const int size = val.dt->is<PrimitiveType>() ? data_type_size(val.dt) : 8;
+  if (size <= 0) {
+    bits = 0;
+  } else if (size < 8) {
+    // The bits past the size of the type are left uninitialized.
+    bits &= (1ULL << (size * 8)) - 1;
+  }
+  return hash_combine(stable_hash(val.dt), bits);
+}
+
 int StmtFieldSNode::get_snode_id(SNode *snode) {
   if (snode == nullptr)
     return -1;
@@ -98,6 +143,10 @@ bool StmtFieldSNode::equal(const StmtField *other_generic) const {
   }
 }
 
+uint64 StmtFieldSNode::hash() const {
+  return (uint64)(int64)get_snode_id(snode_);
+}
+
 bool StmtFieldMemoryAccessOptions::equal(const StmtField *other_generic) const {
   if (auto other =
           dynamic_cast<const StmtFieldMemoryAccessOptions *>(other_generic)) {
@@ -108,6 +157,19 @@ bool StmtFieldMemoryAccessOptions::equal(const StmtField *other_generic) const {
   }
 }
 
+uint64 StmtFieldMemoryAccessOptions::hash() const {
+  // Sums the hashes of the entries, which are iterated in no specific order.
+  uint64 ret = 0;
+  for (const auto &[snode, flags] : opt_.get_all()) {
+    uint64 flags_hash = 0;
+    for (auto flag : flags) {
+      flags_hash += hash_combine(0, (uint64)flag);
+    }
+    ret += hash_combine(StmtFieldSNode::get_snode_id(snode), flags_hash);
+  }
+  return ret;
+}
+
 bool StmtFieldManager::equal(StmtFieldManager &other) const {
   if (fields.size() != other.fields.size()) {
     return false;
@@ -121,6 +183,14 @@ bool StmtFieldManager::equal(StmtFieldManager &other) const {
   return true;
 }
 
+uint64 StmtFieldManager::hash() const {
+  uint64 ret = fields.size();
+  for (const auto &field : fields) {
+    ret = hash_combine(ret, field->hash());
+  }
+  return ret;
+}
+
 std::atomic<int> Stmt::instance_id_counter(0);
 
 Stmt::Stmt() : field_manager(this), fields_registered(false) {
@@ -209,6 +279,7 @@ IRNode *Stmt::get_parent() const {
 
 std::vector<Stmt *> Stmt::get_operands() const {
   std::vector<Stmt *> ret;
+  ret.reserve(num_operands());
   for (int i = 0; i < num_operands(); i++) {
     ret.push_back(*operands[i]);
   }
@@ -228,6 +299,12 @@ void Stmt::mark_fields_registered() {
   fields_registered = true;
 }
 
+void Stmt::unregister_fields() {
+  operands.clear();
+  field_manager.fields.clear();
+  fields_registered = false;
+}
+
 bool Stmt::has_operand(Stmt *stmt) const {
   for (int i = 0; i < num_operands(); i++) {
     if (*operands[i] == stmt) {
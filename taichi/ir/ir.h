@@ -14,6 +14,7 @@
 #include "taichi/ir/mesh.h"
 #include "taichi/ir/type_factory.h"
 #include "taichi/util/short_name.h"
+#include "taichi/util/small_vector.h"
 
 namespace taichi {
 namespace lang {
@@ -31,6 +32,11 @@ struct CompileConfig;
 enum class SNodeAccessFlag : int { block_local, read_only, mesh_local };
 std::string snode_access_flag_name(SNodeAccessFlag type);
 
+// Which derivatives a kernel computes besides its primal values: none, the
+// dual values of forward-mode autodiff, or the adjoints of reverse-mode
+// autodiff.
+enum class AutodiffMode : int { none, forward, reverse };
+
 class MemoryAccessOptions {
  public:
   void add_flag(SNode *snode, SNodeAccessFlag flag) {
@@ -58,8 +64,8 @@ class MemoryAccessOptions {
     options_.clear();
   }
 
-  std::unordered_map<SNode *, std::unordered_set<SNodeAccessFlag>> get_all()
-      const {
+  const std::unordered_map<SNode *, std::unordered_set<SNodeAccessFlag>>
+      &get_all() const {
     return options_;
   }
 
@@ -383,12 +389,51 @@ struct LaneAttribute {
   }
 };
 
+// Hashes of the values of the statement fields. Unlike std::hash, they are
+// stable across processes, so that the hashes of the IR can key the on-disk
+// caches. See irpass::analysis::hash().
+uint64 hash_combine(uint64 seed, uint64 value);
+
+uint64 stable_hash(const std::string &str);
+
+uint64 stable_hash(const DataType &dt);
+
+uint64 stable_hash(const TypedConstant &val);
+
+template <typename T>
+uint64 stable_hash(const T &val) {
+  if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+    return (uint64)val;
+  } else if constexpr (std::is_floating_point_v<T>) {
+    float64 val64 = val;
+    uint64 bits;
+    std::memcpy(&bits, &val64, sizeof(bits));
+    return bits;
+  } else if constexpr (std::is_pointer_v<T>) {
+    // E.g. meshes and functions, which are only identified by their addresses
+    // within a process.
+    return (uint64)(uintptr_t)val;
+  } else if constexpr (is_specialization<T, std::unordered_set>::value) {
+    // Sums the hashes of the elements, which are iterated in no specific
+    // order.
+    uint64 ret = val.size();
+    for (const auto &elem : val) {
+      ret += hash_combine(0, stable_hash(elem));
+    }
+    return ret;
+  } else {
+    static_assert(!std::is_same_v<T, T>, "No stable hash for the type.");
+  }
+}
+
 class StmtField {
  public:
   StmtField() = default;
 
   virtual bool equal(const StmtField *other) const = 0;
 
+  virtual uint64 hash() const = 0;
+
   virtual ~StmtField() = default;
 };
 
@@ -423,6 +468,14 @@ class StmtFieldNumeric final : public StmtField {
       return false;
     }
   }
+
+  uint64 hash() const override {
+    if (std::holds_alternative<T *>(value_)) {
+      return stable_hash(*std::get<T *>(value_));
+    } else {
+      return stable_hash(std::get<T>(value_));
+    }
+  }
 };
 
 class StmtFieldSNode final : public StmtField {
@@ -436,6 +489,8 @@ class StmtFieldSNode final : public StmtField {
   static int get_snode_id(SNode *snode);
 
   bool equal(const StmtField *other_generic) const override;
+
+  uint64 hash() const override;
 };
 
 class StmtFieldMemoryAccessOptions final : public StmtField {
@@ -448,6 +503,8 @@ class StmtFieldMemoryAccessOptions final : public StmtField {
   }
 
   bool equal(const StmtField *other_generic) const override;
+
+  uint64 hash() const override;
 };
 
 class StmtFieldManager {
@@ -455,7 +512,8 @@ class StmtFieldManager {
   Stmt *stmt_;
 
  public:
-  std::vector<std::unique_ptr<StmtField>> fields;
+  // Most statements have a few fields, held inline.
+  SmallVector<std::unique_ptr<StmtField>, 4> fields;
 
   StmtFieldManager(Stmt *stmt) : stmt_(stmt) {
   }
@@ -475,6 +533,8 @@ class StmtFieldManager {
   }
 
   bool equal(StmtFieldManager &other) const;
+
+  uint64 hash() const;
 };
 
 #define TI_STMT_DEF_FIELDS(...) TI_IO_DEF(__VA_ARGS__)
@@ -484,7 +544,8 @@ class StmtFieldManager {
 
 class Stmt : public IRNode {
  protected:
-  std::vector<Stmt **> operands;
+  // Most statements have a few operands, held inline.
+  SmallVector<Stmt **, 4> operands;
 
  public:
   StmtFieldManager field_manager;
@@ -545,6 +606,9 @@ class Stmt : public IRNode {
   void register_operand(Stmt *&stmt);
   int locate_operand(Stmt **stmt);
   void mark_fields_registered();
+  // Drops the registered operands and fields, for the fields to be registered
+  // again once they are overwritten (e.g. by the IR deserializer).
+  void unregister_fields();
 
   bool has_operand(Stmt *stmt) const;
 
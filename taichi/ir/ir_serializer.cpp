@@ -0,0 +1,784 @@
+#include "taichi/ir/ir_serializer.h"
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
+
+#include "taichi/ir/snode.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/type_factory.h"
+#include "taichi/util/meta.h"
+
+namespace taichi {
+namespace lang {
+
+namespace {
+
+constexpr uint32 kMagic = 0x49484354;  // "TCHI"
+// Bump when the format, or the fields of a statement below, change.
+constexpr uint32 kVersion = 2;
+
+// The statements which can be serialized. Their position in the list is the
+// kind written out, so that new ones go at the end.
+#define TI_SERIALIZABLE_STMTS(PER_STMT)      \
+  PER_STMT(RangeForStmt)                     \
+  PER_STMT(StructForStmt)                    \
+  PER_STMT(IfStmt)                           \
+  PER_STMT(WhileStmt)                        \
+  PER_STMT(WhileControlStmt)                 \
+  PER_STMT(ContinueStmt)                     \
+  PER_STMT(FuncBodyStmt)                     \
+  PER_STMT(ReturnStmt)                       \
+  PER_STMT(ArgLoadStmt)                      \
+  PER_STMT(ExternalPtrStmt)                  \
+  PER_STMT(PtrOffsetStmt)                    \
+  PER_STMT(ConstStmt)                        \
+  PER_STMT(AllocaStmt)                       \
+  PER_STMT(UnaryOpStmt)                      \
+  PER_STMT(BinaryOpStmt)                     \
+  PER_STMT(TernaryOpStmt)                    \
+  PER_STMT(PrintStmt)                        \
+  PER_STMT(RandStmt)                         \
+  PER_STMT(GlobalLoadStmt)                   \
+  PER_STMT(GlobalStoreStmt)                  \
+  PER_STMT(AtomicOpStmt)                     \
+  PER_STMT(LocalStoreStmt)                   \
+  PER_STMT(SNodeOpStmt)                      \
+  PER_STMT(RangeAssumptionStmt)              \
+  PER_STMT(LoopUniqueStmt)                   \
+  PER_STMT(AssertStmt)                       \
+  PER_STMT(ExternalFuncCallStmt)             \
+  PER_STMT(ExternalTensorShapeAlongAxisStmt) \
+  PER_STMT(TextureOpStmt)                    \
+  PER_STMT(AdStackAllocaStmt)                \
+  PER_STMT(AdStackLoadTopStmt)               \
+  PER_STMT(AdStackLoadTopAdjStmt)            \
+  PER_STMT(AdStackPopStmt)                   \
+  PER_STMT(AdStackPushStmt)                  \
+  PER_STMT(AdStackAccAdjointStmt)            \
+  PER_STMT(GetRootStmt)                      \
+  PER_STMT(IntegerOffsetStmt)                \
+  PER_STMT(BitExtractStmt)                   \
+  PER_STMT(LinearizeStmt)                    \
+  PER_STMT(SNodeLookupStmt)                  \
+  PER_STMT(GetChStmt)                        \
+  PER_STMT(LocalLoadStmt)                    \
+  PER_STMT(GlobalPtrStmt)                    \
+  PER_STMT(ElementShuffleStmt)               \
+  PER_STMT(OffloadedStmt)                    \
+  PER_STMT(MeshPatchIndexStmt)               \
+  PER_STMT(LoopIndexStmt)                    \
+  PER_STMT(LoopLinearIndexStmt)              \
+  PER_STMT(GlobalThreadIndexStmt)            \
+  PER_STMT(BlockCornerIndexStmt)             \
+  PER_STMT(BlockDimStmt)                     \
+  PER_STMT(GlobalTemporaryStmt)              \
+  PER_STMT(ClearListStmt)                    \
+  PER_STMT(ThreadLocalPtrStmt)               \
+  PER_STMT(BlockLocalPtrStmt)                \
+  PER_STMT(InternalFuncStmt)                 \
+  PER_STMT(BitStructStoreStmt)
+
+enum class StmtKind : uint16 {
+#define PER_STMT(x) x,
+  TI_SERIALIZABLE_STMTS(PER_STMT)
+#undef PER_STMT
+};
+
+enum class TypeTag : uint8 {
+  null,
+  primitive,
+  pointer,
+  vector,
+  tensor,
+  custom_int,
+  custom_float,
+};
+
+template <typename T>
+constexpr bool kAlwaysFalse = false;
+
+template <typename T>
+constexpr bool is_stmt_pointer_v =
+    std::is_pointer_v<T> && std::is_base_of_v<Stmt, std::remove_pointer_t<T>>;
+
+// The blocks of the container statements, which are not among their fields.
+std::vector<std::unique_ptr<Block> *> get_blocks(Stmt *stmt) {
+  if (auto s = stmt->cast<RangeForStmt>()) {
+    return {&s->body};
+  } else if (auto s = stmt->cast<StructForStmt>()) {
+    return {&s->block_initialization, &s->body, &s->block_finalization};
+  } else if (auto s = stmt->cast<IfStmt>()) {
+    return {&s->true_statements, &s->false_statements};
+  } else if (auto s = stmt->cast<WhileStmt>()) {
+    return {&s->body};
+  } else if (auto s = stmt->cast<FuncBodyStmt>()) {
+    return {&s->body};
+  } else if (auto s = stmt->cast<OffloadedStmt>()) {
+    return {&s->tls_prologue, &s->mesh_prologue, &s->bls_prologue,
+            &s->body,         &s->bls_epilogue,  &s->tls_epilogue};
+  }
+  return {};
+}
+
+class IRBinaryWriter {
+ public:
+  std::vector<uint8> data;
+  // Cleared when the IR holds anything that cannot be written out.
+  bool supported{true};
+
+  // Called by Stmt::io() for each field.
+  template <typename T>
+  void operator()(const char *key, const T &value) {
+    write(value);
+  }
+
+  void write_block(Block *block) {
+    write((uint64)block->statements.size());
+    for (auto &stmt : block->statements) {
+      write_stmt(stmt.get());
+    }
+  }
+
+  template <typename T>
+  void write(const T &value) {
+    if constexpr (is_specialization<T, std::vector>::value ||
+                  is_specialization<T, std::unordered_set>::value) {
+      write((uint64)value.size());
+      for (const auto &element : value) {
+        write(element);
+      }
+    } else if constexpr (is_specialization<T, LaneAttribute>::value) {
+      write(value.data);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      write((uint64)value.size());
+      write_bytes(value.data(), value.size());
+    } else if constexpr (std::is_same_v<T,
+                                        std::variant<Stmt *, std::string>>) {
+      write((uint8)value.index());
+      std::visit([this](const auto &v) { write(v); }, value);
+    } else if constexpr (is_stmt_pointer_v<T>) {
+      write_stmt_ref(value);
+    } else if constexpr (std::is_same_v<T, SNode *>) {
+      write((int32)(value ? value->id : -1));
+    } else if constexpr (std::is_same_v<T, LocalAddress>) {
+      write(value.var);
+      write(value.offset);
+    } else if constexpr (std::is_same_v<T, VectorElement>) {
+      write(value.stmt);
+      write(value.index);
+    } else if constexpr (std::is_same_v<T, MemoryAccessOptions>) {
+      const auto &options = value.get_all();
+      write((uint64)options.size());
+      for (const auto &[snode, flags] : options) {
+        write(snode);
+        write(flags);
+      }
+    } else if constexpr (std::is_same_v<T, DataType>) {
+      write_type(value);
+    } else if constexpr (std::is_same_v<T, TypedConstant>) {
+      write(value.dt);
+      write(value.value_bits);
+    } else if constexpr (std::is_same_v<T, Callable::Arg> ||
+                         std::is_same_v<T, Callable::Ret>) {
+      value.io(*this);
+    } else if constexpr (std::is_same_v<T, void *>) {
+      // Host pointers (e.g. into shared objects) do not outlive the process.
+      if (value != nullptr) {
+        supported = false;
+      }
+    } else if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>) {
+      write_bytes(&value, sizeof(T));
+    } else {
+      static_assert(kAlwaysFalse<T>, "Field type not serializable");
+    }
+  }
+
+ private:
+  std::unordered_map<const Stmt *, int32> stmt_index_;
+
+  void write_bytes(const void *ptr, std::size_t size) {
+    auto *bytes = (const uint8 *)ptr;
+    data.insert(data.end(), bytes, bytes + size);
+  }
+
+  void write_stmt_ref(const Stmt *stmt) {
+    if (stmt == nullptr) {
+      write((int32)-1);
+      return;
+    }
+    auto it = stmt_index_.find(stmt);
+    if (it == stmt_index_.end()) {
+      // Defined outside of the IR being serialized.
+      supported = false;
+      write((int32)-1);
+      return;
+    }
+    write(it->second);
+  }
+
+  void write_type(const Type *type) {
+    if (type == nullptr) {
+      write(TypeTag::null);
+    } else if (auto t = type->cast<PrimitiveType>()) {
+      write(TypeTag::primitive);
+      write(t->type);
+    } else if (auto t = type->cast<PointerType>()) {
+      write(TypeTag::pointer);
+      write_type(t->get_pointee_type());
+      write(t->is_bit_pointer());
+    } else if (auto t = type->cast<VectorType>()) {
+      write(TypeTag::vector);
+      write(t->get_num_elements());
+      write_type(t->get_element_type());
+    } else if (auto t = type->cast<TensorType>()) {
+      write(TypeTag::tensor);
+      write(t->get_shape());
+      write_type(t->get_element_type());
+    } else if (auto t = type->cast<CustomIntType>()) {
+      write(TypeTag::custom_int);
+      write(t->get_num_bits());
+      write(t->get_is_signed());
+      write_type(const_cast<CustomIntType *>(t)->get_compute_type());
+    } else if (auto t = type->cast<CustomFloatType>()) {
+      auto *float_type = const_cast<CustomFloatType *>(t);
+      write(TypeTag::custom_float);
+      write_type(float_type->get_digits_type());
+      write_type(float_type->get_exponent_type());
+      write_type(float_type->get_compute_type());
+      write(float_type->get_scale());
+    } else {
+      // The bit struct and bit array types are not unique by their members,
+      // but belong to the SNodes they were made for.
+      supported = false;
+    }
+  }
+
+  void write_stmt(Stmt *stmt) {
+    if (!supported) {
+      return;
+    }
+    if (auto offload = stmt->cast<OffloadedStmt>();
+        offload && offload->task_type == OffloadedTaskType::mesh_for) {
+      // Holds the mesh and its per-task locals.
+      supported = false;
+      return;
+    }
+    stmt_index_[stmt] = (int32)stmt_index_.size();
+#define PER_STMT(x)                 \
+  if (typeid(*stmt) == typeid(x)) { \
+    write(StmtKind::x);             \
+    write(stmt->id);                \
+    write(stmt->ret_type);          \
+    stmt->as<x>()->io(*this);       \
+  } else
+    TI_SERIALIZABLE_STMTS(PER_STMT) {
+      supported = false;
+      return;
+    }
+#undef PER_STMT
+    for (auto *block : get_blocks(stmt)) {
+      write(*block != nullptr);
+      if (*block) {
+        write_block(block->get());
+      }
+    }
+  }
+};
+
+class IRBinaryReader {
+ public:
+  // Cleared when the data is malformed.
+  bool ok{true};
+
+  IRBinaryReader(const std::vector<uint8> &data,
+                 const std::function<SNode *(int)> &get_snode)
+      : data_(data), get_snode_(get_snode) {
+    // The operands the statements are constructed with before their fields
+    // are read, satisfying the checks of the constructors.
+    placeholder_ = std::make_unique<ArgLoadStmt>(0, PrimitiveType::i32);
+    placeholder_alloca_ = std::make_unique<AllocaStmt>(PrimitiveType::i32);
+    placeholder_stack_ =
+        std::make_unique<AdStackAllocaStmt>(PrimitiveType::i32, 1);
+  }
+
+  // Called by Stmt::io() for each field.
+  template <typename T>
+  void operator()(const char *key, const T &value) {
+    read(const_cast<T &>(value));
+  }
+
+  bool at_end() const {
+    return pos_ == data_.size();
+  }
+
+  std::unique_ptr<Block> read_block() {
+    auto block = std::make_unique<Block>();
+    auto num_stmts = read_size();
+    for (uint64 i = 0; ok && i < num_stmts; i++) {
+      if (auto stmt = read_stmt()) {
+        block->insert(std::move(stmt));
+      }
+    }
+    return block;
+  }
+
+  template <typename T>
+  T read_value() {
+    T value{};
+    read(value);
+    return value;
+  }
+
+  template <typename T>
+  void read(T &value) {
+    if constexpr (is_specialization<T, std::vector>::value) {
+      auto size = read_size();
+      value.clear();
+      for (uint64 i = 0; ok && i < size; i++) {
+        auto element = make_element<typename T::value_type>();
+        read(element);
+        value.push_back(element);
+      }
+    } else if constexpr (is_specialization<T, std::unordered_set>::value) {
+      auto size = read_size();
+      value.clear();
+      for (uint64 i = 0; ok && i < size; i++) {
+        value.insert(read_value<typename T::value_type>());
+      }
+    } else if constexpr (is_specialization<T, LaneAttribute>::value) {
+      read(value.data);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      auto size = read_size();
+      if (ok) {
+        value.assign((const char *)data_.data() + pos_, size);
+        pos_ += size;
+      }
+    } else if constexpr (std::is_same_v<T,
+                                        std::variant<Stmt *, std::string>>) {
+      auto index = read_value<uint8>();
+      if (index == 0) {
+        value = read_stmt_ref();
+      } else if (index == 1) {
+        value = read_value<std::string>();
+      } else {
+        ok = false;
+      }
+    } else if constexpr (is_stmt_pointer_v<T>) {
+      auto *stmt = read_stmt_ref();
+      value = dynamic_cast<T>(stmt);
+      if (stmt != nullptr && value == nullptr) {
+        ok = false;
+      }
+    } else if constexpr (std::is_same_v<T, SNode *>) {
+      auto id = read_value<int32>();
+      value = id >= 0 && ok ? get_snode_(id) : nullptr;
+      if (id >= 0 && value == nullptr) {
+        ok = false;
+      }
+    } else if constexpr (std::is_same_v<T, LocalAddress>) {
+      read(value.var);
+      read(value.offset);
+    } else if constexpr (std::is_same_v<T, VectorElement>) {
+      read(value.stmt);
+      read(value.index);
+    } else if constexpr (std::is_same_v<T, MemoryAccessOptions>) {
+      value.clear();
+      auto size = read_size();
+      for (uint64 i = 0; ok && i < size; i++) {
+        auto *snode = read_value<SNode *>();
+        auto flags = read_value<std::unordered_set<SNodeAccessFlag>>();
+        for (auto flag : flags) {
+          value.add_flag(snode, flag);
+        }
+      }
+    } else if constexpr (std::is_same_v<T, DataType>) {
+      value = read_type();
+    } else if constexpr (std::is_same_v<T, TypedConstant>) {
+      read(value.dt);
+      read(value.value_bits);
+    } else if constexpr (std::is_same_v<T, Callable::Arg> ||
+                         std::is_same_v<T, Callable::Ret>) {
+      value.io(*this);
+    } else if constexpr (std::is_same_v<T, void *>) {
+      value = nullptr;
+    } else if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>) {
+      read_bytes(&value, sizeof(T));
+    } else {
+      static_assert(kAlwaysFalse<T>, "Field type not serializable");
+    }
+  }
+
+  std::unique_ptr<Stmt> read_stmt() {
+    auto kind = read_value<StmtKind>();
+    auto id = read_value<int>();
+    auto ret_type = read_value<DataType>();
+    if (!ok) {
+      return nullptr;
+    }
+    std::unique_ptr<Stmt> stmt;
+    switch (kind) {
+#define PER_STMT(x)          \
+  case StmtKind::x:          \
+    stmt = read_fields<x>(); \
+    break;
+      TI_SERIALIZABLE_STMTS(PER_STMT)
+#undef PER_STMT
+      default:
+        ok = false;
+    }
+    if (!ok) {
+      return nullptr;
+    }
+    stmt->id = id;
+    stmt->ret_type = ret_type;
+    stmts_.push_back(stmt.get());
+    for (auto *block : get_blocks(stmt.get())) {
+      if (read_value<bool>()) {
+        *block = read_block();
+        (*block)->parent_stmt = stmt.get();
+      } else {
+        block->reset();
+      }
+    }
+    if (!ok) {
+      return nullptr;
+    }
+    return stmt;
+  }
+
+ private:
+  const std::vector<uint8> &data_;
+  std::size_t pos_{0};
+  const std::function<SNode *(int)> &get_snode_;
+  // The statements read so far, in the order of their definitions.
+  std::vector<Stmt *> stmts_;
+  std::unique_ptr<Stmt> placeholder_;
+  std::unique_ptr<Stmt> placeholder_alloca_;
+  std::unique_ptr<Stmt> placeholder_stack_;
+
+  void read_bytes(void *ptr, std::size_t size) {
+    if (!ok || size > data_.size() - pos_) {
+      ok = false;
+      std::memset(ptr, 0, size);
+      return;
+    }
+    std::memcpy(ptr, data_.data() + pos_, size);
+    pos_ += size;
+  }
+
+  // The size of a container, each element of which takes a byte at least.
+  uint64 read_size() {
+    auto size = read_value<uint64>();
+    if (size > data_.size() - pos_) {
+      ok = false;
+      return 0;
+    }
+    return size;
+  }
+
+  Stmt *read_stmt_ref() {
+    auto index = read_value<int32>();
+    if (index == -1) {
+      return nullptr;
+    }
+    if (index < 0 || index >= (int32)stmts_.size()) {
+      ok = false;
+      return nullptr;
+    }
+    return stmts_[index];
+  }
+
+  template <typename T>
+  T make_element() {
+    if constexpr (std::is_same_v<T, LocalAddress>) {
+      return LocalAddress(placeholder_alloca_.get(), 0);
+    } else {
+      return T();
+    }
+  }
+
+  DataType read_type() {
+    auto &factory = TypeFactory::get_instance();
+    auto tag = read_value<TypeTag>();
+    if (!ok) {
+      return PrimitiveType::unknown;
+    }
+    switch (tag) {
+      case TypeTag::null:
+        return DataType(nullptr);
+      case TypeTag::primitive: {
+        auto id = read_value<PrimitiveTypeID>();
+        if ((int)id < 0 || (int)id > (int)PrimitiveTypeID::unknown) {
+          ok = false;
+        }
+        if (!ok) {
+          return PrimitiveType::unknown;
+        }
+        return factory.get_primitive_type(id);
+      }
+      case TypeTag::pointer: {
+        auto pointee = read_type();
+        auto is_bit_pointer = read_value<bool>();
+        if (!ok) {
+          return PrimitiveType::unknown;
+        }
+        return factory.get_pointer_type(pointee, is_bit_pointer);
+      }
+      case TypeTag::vector: {
+        auto num_elements = read_value<int>();
+        auto element = read_type();
+        if (!ok) {
+          return PrimitiveType::unknown;
+        }
+        return factory.get_vector_type(num_elements, element);
+      }
+      case TypeTag::tensor: {
+        auto shape = read_value<std::vector<int>>();
+        auto element = read_type();
+        if (!ok) {
+          return PrimitiveType::unknown;
+        }
+        return factory.get_tensor_type(shape, element);
+      }
+      case TypeTag::custom_int: {
+        auto num_bits = read_value<int>();
+        auto is_signed = read_value<bool>();
+        auto compute_type = read_type();
+        if (!ok) {
+          return PrimitiveType::unknown;
+        }
+        return factory.get_custom_int_type(num_bits, is_signed, compute_type);
+      }
+      case TypeTag::custom_float: {
+        auto digits_type = read_type();
+        auto exponent_type = read_type();
+        auto compute_type = read_type();
+        auto scale = read_value<float64>();
+        if (!ok) {
+          return PrimitiveType::unknown;
+        }
+        return factory.get_custom_float_type(digits_type, exponent_type,
+                                             compute_type, scale);
+      }
+      default:
+        ok = false;
+        return PrimitiveType::unknown;
+    }
+  }
+
+  // Constructs a statement of type T to read the fields into. The few whose
+  // constructors depend on their fields read them ahead.
+  template <typename T>
+  std::unique_ptr<T> make_stmt() {
+    auto *ph = placeholder_.get();
+    if constexpr (std::is_same_v<T, RangeForStmt>) {
+      return std::make_unique<T>(ph, ph, std::make_unique<Block>(), 0, 0, 0, 0,
+                                 false);
+    } else if constexpr (std::is_same_v<T, StructForStmt>) {
+      return std::make_unique<T>(nullptr, std::make_unique<Block>(), 0, 0, 0,
+                                 0);
+    } else if constexpr (std::is_same_v<T, WhileStmt>) {
+      return std::make_unique<T>(std::make_unique<Block>());
+    } else if constexpr (std::is_same_v<T, FuncBodyStmt>) {
+      return std::make_unique<T>("", nullptr);
+    } else if constexpr (std::is_same_v<T, IfStmt> ||
+                         std::is_same_v<T, ReturnStmt> ||
+                         std::is_same_v<T, GlobalLoadStmt> ||
+                         std::is_same_v<T, LoopLinearIndexStmt>) {
+      return std::make_unique<T>(ph);
+    } else if constexpr (std::is_same_v<T, WhileControlStmt>) {
+      return std::make_unique<T>(nullptr, ph);
+    } else if constexpr (std::is_same_v<T, ContinueStmt> ||
+                         std::is_same_v<T, GetRootStmt> ||
+                         std::is_same_v<T, MeshPatchIndexStmt> ||
+                         std::is_same_v<T, GlobalThreadIndexStmt> ||
+                         std::is_same_v<T, BlockDimStmt>) {
+      return std::make_unique<T>();
+    } else if constexpr (std::is_same_v<T, ArgLoadStmt>) {
+      return std::make_unique<T>(0, PrimitiveType::i32);
+    } else if constexpr (std::is_same_v<T, ExternalPtrStmt>) {
+      return std::make_unique<T>(LaneAttribute<Stmt *>(ph),
+                                 std::vector<Stmt *>());
+    } else if constexpr (std::is_same_v<T, PtrOffsetStmt>) {
+      read_value<DataType>();
+      auto *origin = read_stmt_ref();
+      auto *offset = read_stmt_ref();
+      if (!ok || origin == nullptr ||
+          !(origin->is<GlobalPtrStmt>() ||
+            ((origin->is<AllocaStmt>() || origin->is<GlobalTemporaryStmt>()) &&
+             origin->ret_type->is<TensorType>()))) {
+        ok = false;
+        return nullptr;
+      }
+      return std::make_unique<T>(origin, offset);
+    } else if constexpr (std::is_same_v<T, ConstStmt>) {
+      return std::make_unique<T>(
+          LaneAttribute<TypedConstant>(TypedConstant(0)));
+    } else if constexpr (std::is_same_v<T, AllocaStmt> ||
+                         std::is_same_v<T, RandStmt>) {
+      return std::make_unique<T>(PrimitiveType::i32);
+    } else if constexpr (std::is_same_v<T, UnaryOpStmt>) {
+      return std::make_unique<T>(UnaryOpType::neg, ph);
+    } else if constexpr (std::is_same_v<T, BinaryOpStmt>) {
+      return std::make_unique<T>(BinaryOpType::add, ph, ph);
+    } else if constexpr (std::is_same_v<T, TernaryOpStmt>) {
+      return std::make_unique<T>(TernaryOpType::select, ph, ph, ph);
+    } else if constexpr (std::is_same_v<T, PrintStmt>) {
+      return std::make_unique<T>(std::vector<PrintStmt::EntryType>());
+    } else if constexpr (std::is_same_v<T, GlobalStoreStmt>) {
+      return std::make_unique<T>(ph, ph);
+    } else if constexpr (std::is_same_v<T, AtomicOpStmt>) {
+      return std::make_unique<T>(AtomicOpType::add, ph, ph);
+    } else if constexpr (std::is_same_v<T, LocalStoreStmt>) {
+      return std::make_unique<T>(placeholder_alloca_.get(), ph);
+    } else if constexpr (std::is_same_v<T, SNodeOpStmt>) {
+      return std::make_unique<T>(SNodeOpType::undefined, nullptr, ph, nullptr);
+    } else if constexpr (std::is_same_v<T, RangeAssumptionStmt>) {
+      return std::make_unique<T>(ph, ph, 0, 0);
+    } else if constexpr (std::is_same_v<T, LoopUniqueStmt>) {
+      return std::make_unique<T>(ph, std::vector<SNode *>());
+    } else if constexpr (std::is_same_v<T, AssertStmt>) {
+      return std::make_unique<T>(ph, "", std::vector<Stmt *>());
+    } else if constexpr (std::is_same_v<T, ExternalFuncCallStmt>) {
+      return std::make_unique<T>(T::SHARED_OBJECT, nullptr, "", "", "",
+                                 std::vector<Stmt *>(), std::vector<Stmt *>());
+    } else if constexpr (std::is_same_v<T, ExternalTensorShapeAlongAxisStmt>) {
+      return std::make_unique<T>(0, 0);
+    } else if constexpr (std::is_same_v<T, TextureOpStmt>) {
+      return std::make_unique<T>(TextureOpType::sample_lod, 0, 1,
+                                 std::vector<Stmt *>{ph, ph}, 0);
+    } else if constexpr (std::is_same_v<T, AdStackAllocaStmt>) {
+      return std::make_unique<T>(PrimitiveType::i32, 1);
+    } else if constexpr (std::is_same_v<T, AdStackLoadTopStmt> ||
+                         std::is_same_v<T, AdStackLoadTopAdjStmt> ||
+                         std::is_same_v<T, AdStackPopStmt>) {
+      return std::make_unique<T>(placeholder_stack_.get());
+    } else if constexpr (std::is_same_v<T, AdStackPushStmt> ||
+                         std::is_same_v<T, AdStackAccAdjointStmt>) {
+      return std::make_unique<T>(placeholder_stack_.get(), ph);
+    } else if constexpr (std::is_same_v<T, IntegerOffsetStmt>) {
+      return std::make_unique<T>(ph, 0);
+    } else if constexpr (std::is_same_v<T, BitExtractStmt>) {
+      return std::make_unique<T>(ph, 0, 0);
+    } else if constexpr (std::is_same_v<T, LinearizeStmt>) {
+      return std::make_unique<T>(std::vector<Stmt *>(), std::vector<int>());
+    } else if constexpr (std::is_same_v<T, SNodeLookupStmt>) {
+      return std::make_unique<T>(nullptr, ph, ph, false);
+    } else if constexpr (std::is_same_v<T, GetChStmt>) {
+      read_value<DataType>();
+      auto *input_ptr = read_stmt_ref();
+      read_value<SNode *>();
+      read_value<SNode *>();
+      auto chid = read_value<int>();
+      auto is_bit_vectorized = read_value<bool>();
+      auto *lookup =
+          input_ptr ? input_ptr->cast<SNodeLookupStmt>() : nullptr;
+      if (!ok || lookup == nullptr || lookup->snode == nullptr || chid < 0 ||
+          chid >= (int)lookup->snode->ch.size()) {
+        ok = false;
+        return nullptr;
+      }
+      return std::make_unique<T>(input_ptr, chid, is_bit_vectorized);
+    } else if constexpr (std::is_same_v<T, LocalLoadStmt>) {
+      return std::make_unique<T>(LaneAttribute<LocalAddress>(
+          LocalAddress(placeholder_alloca_.get(), 0)));
+    } else if constexpr (std::is_same_v<T, GlobalPtrStmt>) {
+      read_value<DataType>();
+      auto snodes = read_value<LaneAttribute<SNode *>>();
+      if (!ok || snodes.size() != 1 || snodes[0] == nullptr) {
+        ok = false;
+        return nullptr;
+      }
+      return std::make_unique<T>(snodes, std::vector<Stmt *>());
+    } else if constexpr (std::is_same_v<T, ElementShuffleStmt>) {
+      return std::make_unique<T>(
+          LaneAttribute<VectorElement>(VectorElement(ph, 0)));
+    } else if constexpr (std::is_same_v<T, OffloadedStmt>) {
+      return std::make_unique<T>(OffloadedTaskType::serial, Arch::x64);
+    } else if constexpr (std::is_same_v<T, LoopIndexStmt> ||
+                         std::is_same_v<T, BlockCornerIndexStmt>) {
+      return std::make_unique<T>(ph, 0);
+    } else if constexpr (std::is_same_v<T, GlobalTemporaryStmt> ||
+                         std::is_same_v<T, ThreadLocalPtrStmt>) {
+      return std::make_unique<T>(0, PrimitiveType::i32);
+    } else if constexpr (std::is_same_v<T, ClearListStmt>) {
+      return std::make_unique<T>(nullptr);
+    } else if constexpr (std::is_same_v<T, BlockLocalPtrStmt>) {
+      return std::make_unique<T>(ph, PrimitiveType::i32);
+    } else if constexpr (std::is_same_v<T, InternalFuncStmt>) {
+      return std::make_unique<T>("", std::vector<Stmt *>());
+    } else if constexpr (std::is_same_v<T, BitStructStoreStmt>) {
+      return std::make_unique<T>(ph, std::vector<int>(), std::vector<Stmt *>());
+    } else {
+      static_assert(kAlwaysFalse<T>, "Statement not serializable");
+    }
+  }
+
+  template <typename T>
+  std::unique_ptr<Stmt> read_fields() {
+    auto begin = pos_;
+    auto stmt = make_stmt<T>();
+    if (!ok) {
+      return nullptr;
+    }
+    pos_ = begin;
+    stmt->io(*this);
+    // The fields were overwritten, the vectors of operands included, so they
+    // are registered again.
+    stmt->unregister_fields();
+    stmt->mark_fields_registered();
+    stmt->io(stmt->field_manager);
+    return stmt;
+  }
+};
+
+}  // namespace
+
+std::optional<std::vector<uint8>> serialize_ir_binary(
+    Block *root,
+    const std::vector<Callable::Arg> &args,
+    const std::vector<Callable::Ret> &rets) {
+  IRBinaryWriter writer;
+  writer.write(kMagic);
+  writer.write(kVersion);
+  writer.write(args);
+  writer.write(rets);
+  writer.write_block(root);
+  if (!writer.supported) {
+    return std::nullopt;
+  }
+  return std::move(writer.data);
+}
+
+std::unique_ptr<Block> deserialize_ir_binary(
+    const std::vector<uint8> &data,
+    const std::function<SNode *(int)> &get_snode,
+    std::vector<Callable::Arg> *args,
+    std::vector<Callable::Ret> *rets) {
+  IRBinaryReader reader(data, get_snode);
+  if (reader.read_value<uint32>() != kMagic ||
+      reader.read_value<uint32>() != kVersion) {
+    return nullptr;
+  }
+  auto read_args = reader.read_value<std::vector<Callable::Arg>>();
+  auto read_rets = reader.read_value<std::vector<Callable::Ret>>();
+  auto block = reader.read_block();
+  if (!reader.ok || !reader.at_end()) {
+    return nullptr;
+  }
+  if (args) {
+    *args = std::move(read_args);
+  }
+  if (rets) {
+    *rets = std::move(read_rets);
+  }
+  return block;
+}
+
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "taichi/common/core.h"
+#include "taichi/program/callable.h"
+
+namespace taichi {
+namespace lang {
+
+class Block;
+class SNode;
+
+/**
+ * A compact binary form of CHI IR, to keep the IR of a kernel out of memory
+ * (or on disk) and bring it back without running the frontend again.
+ *
+ * The fields of the statements are the ones declared by TI_STMT_DEF_FIELDS,
+ * together with the id, the return type and the blocks of each statement.
+ * Statements are referenced by their order of definition and SNodes by their
+ * ids, so the IR must be deserialized against the same SNode trees.
+ *
+ * The frontend statements, the mesh statements, function calls and the
+ * external calls into shared objects hold pointers that cannot be written
+ * out, as do the quantized bit struct and bit array types; IR containing them
+ * is not serialized.
+ */
+
+// Returns std::nullopt if |root| holds IR that cannot be serialized. |args|
+// and |rets|, those of the callable owning the IR, are serialized along.
+std::optional<std::vector<uint8>> serialize_ir_binary(
+    Block *root,
+    const std::vector<Callable::Arg> &args = {},
+    const std::vector<Callable::Ret> &rets = {});
+
+// Returns nullptr if |data| is not IR serialized by this version of Taichi,
+// or if |get_snode| returns nullptr for an SNode referenced by the IR. The
+// arguments and return values are stored into |args| and |rets| if given.
+std::unique_ptr<Block> deserialize_ir_binary(
+    const std::vector<uint8> &data,
+    const std::function<SNode *(int)> &get_snode,
+    std::vector<Callable::Arg> *args = nullptr,
+    std::vector<Callable::Ret> *rets = nullptr);
+
+}  // namespace lang
+}  // namespace taichi
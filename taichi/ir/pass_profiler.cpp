@@ -0,0 +1,146 @@
+#include "taichi/ir/pass_profiler.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "taichi/system/timeline.h"
+#include "taichi/system/timer.h"
+
+TLANG_NAMESPACE_BEGIN
+
+PassProfiler &PassProfiler::get_instance() {
+  static auto instance = new PassProfiler();
+  return *instance;
+}
+
+void PassProfiler::record_pass(const std::string &kernel_name,
+                               const std::string &pass,
+                               float64 begin,
+                               float64 end,
+                               int stmts_before,
+                               int stmts_after) {
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    auto &rec = passes_[pass];
+    rec.count++;
+    rec.total_time += end - begin;
+    rec.max_time = std::max(rec.max_time, end - begin);
+    rec.stmts_before += stmts_before;
+    rec.stmts_after += stmts_after;
+  }
+  auto &timeline = Timeline::get_this_thread_instance();
+  const auto name = fmt::format("[{}] {} ({} -> {} stmts)", kernel_name, pass,
+                                stmts_before, stmts_after);
+  timeline.insert_event({name, true, begin, timeline.get_name()});
+  timeline.insert_event({name, false, end, timeline.get_name()});
+}
+
+void PassProfiler::record_stage(const std::string &kernel_name,
+                                const std::string &stage,
+                                float64 begin,
+                                float64 end) {
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    auto &rec = stages_[stage];
+    rec.count++;
+    rec.total_time += end - begin;
+    rec.max_time = std::max(rec.max_time, end - begin);
+  }
+  auto &timeline = Timeline::get_this_thread_instance();
+  const auto name = fmt::format("[{}] {}", kernel_name, stage);
+  timeline.insert_event({name, true, begin, timeline.get_name()});
+  timeline.insert_event({name, false, end, timeline.get_name()});
+}
+
+void PassProfiler::record_iterations(const std::string &loop, int iterations) {
+  std::lock_guard<std::mutex> _(mut_);
+  auto &rec = loops_[loop];
+  rec.count++;
+  rec.total_iterations += iterations;
+  rec.max_iterations = std::max(rec.max_iterations, iterations);
+}
+
+void PassProfiler::print() {
+  std::lock_guard<std::mutex> _(mut_);
+  std::vector<std::pair<std::string, PassRecord>> passes(passes_.begin(),
+                                                         passes_.end());
+  std::sort(passes.begin(), passes.end(), [](const auto &a, const auto &b) {
+    return a.second.total_time > b.second.total_time;
+  });
+  float64 total_time = 0;
+  for (auto &p : passes) {
+    total_time += p.second.total_time;
+  }
+  fmt::print("{:=^90}\n", " Pass Profiler ");
+  fmt::print("{:>10} {:>6} {:>10} {:>10} {:>12} {:>12}  {}\n", "total[ms]",
+             "calls", "avg[ms]", "max[ms]", "avg stmts", "avg delta",
+             "pass");
+  for (auto &[name, rec] : passes) {
+    const float64 avg_before = (float64)rec.stmts_before / rec.count;
+    const float64 avg_after = (float64)rec.stmts_after / rec.count;
+    fmt::print("{:>10.3f} {:>6} {:>10.3f} {:>10.3f} {:>12.1f} {:>+12.1f}  {}\n",
+               rec.total_time * 1000, rec.count,
+               rec.total_time * 1000 / rec.count, rec.max_time * 1000,
+               avg_after, avg_after - avg_before, name);
+  }
+  fmt::print("{:>10.3f} in total\n", total_time * 1000);
+  if (!stages_.empty()) {
+    fmt::print("{:-^90}\n", " Backend stages ");
+    fmt::print("{:>10} {:>6} {:>10} {:>10}  {}\n", "total[ms]", "calls",
+               "avg[ms]", "max[ms]", "stage");
+    for (auto &[name, rec] : stages_) {
+      fmt::print("{:>10.3f} {:>6} {:>10.3f} {:>10.3f}  {}\n",
+                 rec.total_time * 1000, rec.count,
+                 rec.total_time * 1000 / rec.count, rec.max_time * 1000, name);
+    }
+  }
+  if (!loops_.empty()) {
+    fmt::print("{:-^90}\n", " Fixed-point loops ");
+    fmt::print("{:>10} {:>10} {:>10}  {}\n", "runs", "avg iters", "max iters",
+               "loop");
+    for (auto &[name, rec] : loops_) {
+      fmt::print("{:>10} {:>10.2f} {:>10}  {}\n", rec.count,
+                 (float64)rec.total_iterations / rec.count, rec.max_iterations,
+                 name);
+    }
+  }
+  fmt::print("{:=^90}\n", "");
+}
+
+std::map<std::string, PassProfiler::PassRecord>
+PassProfiler::get_pass_records() {
+  std::lock_guard<std::mutex> _(mut_);
+  return passes_;
+}
+
+std::map<std::string, PassProfiler::PassRecord>
+PassProfiler::get_stage_records() {
+  std::lock_guard<std::mutex> _(mut_);
+  return stages_;
+}
+
+void PassProfiler::clear() {
+  std::lock_guard<std::mutex> _(mut_);
+  passes_.clear();
+  stages_.clear();
+  loops_.clear();
+}
+
+ScopedCompileStage::ScopedCompileStage(const std::string &kernel_name,
+                                       const std::string &stage)
+    : enabled_(PassProfiler::get_instance().get_enabled()) {
+  if (enabled_) {
+    kernel_name_ = kernel_name;
+    stage_ = stage;
+    begin_ = Time::get_time();
+  }
+}
+
+ScopedCompileStage::~ScopedCompileStage() {
+  if (enabled_) {
+    PassProfiler::get_instance().record_stage(kernel_name_, stage_, begin_,
+                                              Time::get_time());
+  }
+}
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "taichi/common/core.h"
+
+TLANG_NAMESPACE_BEGIN
+
+// Collects the compile-time cost of the IR passes, and of the stages of the
+// backends after them. Enabled by CompileConfig::profile_passes.
+class PassProfiler {
+ public:
+  struct PassRecord {
+    int count{0};
+    float64 total_time{0};
+    float64 max_time{0};
+    int64 stmts_before{0};
+    int64 stmts_after{0};
+  };
+
+  static PassProfiler &get_instance();
+
+  // Records one run of |pass| on |kernel_name|. |stmts_before| and
+  // |stmts_after| are the statement counts of the IR around the pass.
+  // The run is also inserted into the timeline of this thread.
+  void record_pass(const std::string &kernel_name,
+                   const std::string &pass,
+                   float64 begin,
+                   float64 end,
+                   int stmts_before,
+                   int stmts_after);
+
+  // Records one run of the backend stage |stage| on |kernel_name|, e.g. the
+  // LLVM optimization. The statement counts of the records are zero.
+  void record_stage(const std::string &kernel_name,
+                    const std::string &stage,
+                    float64 begin,
+                    float64 end);
+
+  // Records that the fixed-point loop |loop| converged after |iterations|.
+  void record_iterations(const std::string &loop, int iterations);
+
+  void print();
+
+  std::map<std::string, PassRecord> get_pass_records();
+
+  std::map<std::string, PassRecord> get_stage_records();
+
+  void clear();
+
+  bool get_enabled() const {
+    return enabled_;
+  }
+
+  void set_enabled(bool enabled) {
+    enabled_ = enabled;
+  }
+
+ private:
+  struct LoopRecord {
+    int count{0};
+    int64 total_iterations{0};
+    int max_iterations{0};
+  };
+
+  std::mutex mut_;
+  std::map<std::string, PassRecord> passes_;
+  std::map<std::string, PassRecord> stages_;
+  std::map<std::string, LoopRecord> loops_;
+  bool enabled_{false};
+};
+
+// Records the time between its construction and destruction as a backend
+// stage into the PassProfiler, if it is enabled.
+class ScopedCompileStage {
+ public:
+  ScopedCompileStage(const std::string &kernel_name, const std::string &stage);
+
+  ~ScopedCompileStage();
+
+ private:
+  std::string kernel_name_;
+  std::string stage_;
+  float64 begin_{0};
+  bool enabled_{false};
+};
+
+TLANG_NAMESPACE_END
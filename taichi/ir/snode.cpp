@@ -16,6 +16,9 @@ SNode &SNode::insert_children(SNodeType t) {
   auto new_ch = std::make_unique<SNode>(depth + 1, t);
   new_ch->parent = this;
   new_ch->is_path_all_dense = (is_path_all_dense && !new_ch->need_activation());
+  new_ch->is_path_all_dense_or_bitmasked =
+      (is_path_all_dense_or_bitmasked &&
+       (!new_ch->need_activation() || t == SNodeType::bitmasked));
   for (int i = 0; i < taichi_max_num_indices; i++) {
     new_ch->extractors[i].num_elements_from_root *=
         extractors[i].num_elements_from_root;
@@ -41,11 +44,6 @@ SNode &SNode::create_node(std::vector<Axis> axes,
     sizes = std::vector<int>(axes.size(), sizes[0]);
   }
 
-  if (type == SNodeType::hash)
-    TI_ASSERT_INFO(depth == 0,
-                   "hashed node must be child of root due to initialization "
-                   "memset limitation.");
-
   auto &new_node = insert_children(type);
   for (int i = 0; i < (int)axes.size(); i++) {
     TI_ASSERT(sizes[i] > 0);
@@ -125,9 +123,24 @@ SNode &SNode::create_node(std::vector<Axis> axes,
   return new_node;
 }
 
-SNode &SNode::dynamic(const Axis &expr, int n, int chunk_size, bool packed) {
+SNode &SNode::dynamic(const Axis &expr,
+                      int n,
+                      int chunk_size,
+                      bool packed,
+                      bool chunk_table) {
   auto &snode = create_node({expr}, {n}, SNodeType::dynamic, packed);
   snode.chunk_size = chunk_size;
+  snode.chunk_table = chunk_table;
+  return snode;
+}
+
+SNode &SNode::hash(const std::vector<Axis> &axes,
+                   const std::vector<int> &sizes,
+                   int capacity,
+                   bool packed) {
+  TI_ASSERT(capacity > 0);
+  auto &snode = create_node(axes, sizes, SNodeType::hash, packed);
+  snode.hash_capacity = capacity;
   return snode;
 }
 
@@ -168,6 +181,35 @@ SNode *SNode::get_least_sparse_ancestor() const {
   return result;
 }
 
+SNode &SNode::morton(bool val) {
+  if (val) {
+    TI_ERROR_IF(type != SNodeType::dense,
+                "Only dense SNodes can have the Morton layout, got {}",
+                get_node_type_name_hinted());
+    for (int i = 0; i < taichi_max_num_indices; i++) {
+      TI_ERROR_IF(extractors[i].shape != (1 << extractors[i].num_bits),
+                  "The Morton layout of {} needs power-of-two shapes, got {}",
+                  get_node_type_name_hinted(), extractors[i].shape);
+    }
+  }
+  _morton = val;
+  return *this;
+}
+
+int SNode::morton_bit_position(int axis, int bit) const {
+  TI_ASSERT(0 <= bit && bit < extractors[axis].num_bits);
+  int pos = 0;
+  for (int b = 0; b < bit; b++) {
+    for (int i = 0; i < taichi_max_num_indices; i++) {
+      pos += (int)(b < extractors[i].num_bits);
+    }
+  }
+  for (int i = taichi_max_num_indices - 1; i > axis; i--) {
+    pos += (int)(bit < extractors[i].num_bits);
+  }
+  return pos;
+}
+
 int SNode::shape_along_axis(int i) const {
   const auto &extractor = extractors[physical_index_position[i]];
   return extractor.num_elements_from_root;
@@ -272,11 +314,23 @@ SNode *SNode::get_grad() const {
   return grad_info->grad_snode();
 }
 
+bool SNode::has_dual() const {
+  return is_primal() && (grad_info->dual_snode() != nullptr);
+}
+
+SNode *SNode::get_dual() const {
+  TI_ASSERT(has_dual());
+  return grad_info->dual_snode();
+}
+
 void SNode::set_snode_tree_id(int id) {
   snode_tree_id_ = id;
+  for (auto &c : ch) {
+    c->set_snode_tree_id(id);
+  }
 }
 
-int SNode::get_snode_tree_id() {
+int SNode::get_snode_tree_id() const {
   return snode_tree_id_;
 }
 
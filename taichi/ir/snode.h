@@ -91,6 +91,10 @@ class SNode {
     virtual ~GradInfoProvider() = default;
     virtual bool is_primal() const = 0;
     virtual SNode *grad_snode() const = 0;
+    // The SNode holding the dual values of forward-mode autodiff.
+    virtual SNode *dual_snode() const {
+      return nullptr;
+    }
 
     template <typename T>
     T *cast() {
@@ -122,7 +126,10 @@ class SNode {
   int total_num_bits{0};
   int total_bit_start{0};
   int chunk_size{0};
+  bool chunk_table{false};  // for dynamic only, LLVM backends only
+  int hash_capacity{0};  // for hash only
   std::size_t cell_size_bytes{0};
+  std::size_t offset_bytes_in_parent_cell{0};  // LLVM backends only
   PrimitiveType *physical_type{nullptr};  // for bit_struct and bit_array only
   DataType dt;
   bool has_ambient{false};
@@ -146,6 +153,10 @@ class SNode {
   // Whether the path from root to |this| contains only `dense` SNodes.
   bool is_path_all_dense{true};
 
+  // Whether the path from root to |this| contains only `dense` and
+  // `bitmasked` SNodes, i.e. all the cells have fixed addresses.
+  bool is_path_all_dense_or_bitmasked{true};
+
   SNode();
 
   SNode(int depth, SNodeType t);
@@ -216,18 +227,22 @@ class SNode {
     return SNode::bitmasked(std::vector<Axis>{axis}, size, packed);
   }
 
+  // |capacity| is the maximum number of cells that can be activated in each
+  // container, which can be much smaller than the number of cells.
   SNode &hash(const std::vector<Axis> &axes,
               const std::vector<int> &sizes,
-              bool packed) {
-    return create_node(axes, sizes, SNodeType::hash, packed);
-  }
+              int capacity,
+              bool packed);
 
-  SNode &hash(const std::vector<Axis> &axes, int sizes, bool packed) {
-    return create_node(axes, std::vector<int>{sizes}, SNodeType::hash, packed);
+  SNode &hash(const std::vector<Axis> &axes,
+              int sizes,
+              int capacity,
+              bool packed) {
+    return hash(axes, std::vector<int>{sizes}, capacity, packed);
   }
 
-  SNode &hash(const Axis &axis, int size, bool packed) {
-    return hash(std::vector<Axis>{axis}, size, packed);
+  SNode &hash(const Axis &axis, int size, int capacity, bool packed) {
+    return hash(std::vector<Axis>{axis}, size, capacity, packed);
   }
 
   std::string type_name() {
@@ -245,12 +260,21 @@ class SNode {
 
   void set_index_offsets(std::vector<int> index_offsets);
 
-  SNode &dynamic(const Axis &expr, int n, int chunk_size, bool packed);
+  SNode &dynamic(const Axis &expr,
+                 int n,
+                 int chunk_size,
+                 bool packed,
+                 bool chunk_table = false);
 
-  SNode &morton(bool val = true) {
-    _morton = val;
-    return *this;
-  }
+  // Lays the cells of a dense SNode out in Morton (Z-) order, interleaving
+  // the bits of the indices, so that the neighbours of a cell along all the
+  // axes stay close in memory. The shapes must be powers of two.
+  SNode &morton(bool val = true);
+
+  // The position in the linear index of a cell with the Morton layout of the
+  // |bit|-th bit of the index along the (physical) |axis|. The bits are taken
+  // from the lowest up, those of the last axis first.
+  int morton_bit_position(int axis, int bit) const;
 
   int child_id(SNode *c) {
     for (int i = 0; i < (int)ch.size(); i++) {
@@ -282,6 +306,10 @@ class SNode {
 
   SNode *get_grad() const;
 
+  bool has_dual() const;
+
+  SNode *get_dual() const;
+
   SNode *get_least_sparse_ancestor() const;
 
   std::string get_name() const {
@@ -323,9 +351,10 @@ class SNode {
 
   // SNodeTree part
 
+  // Also sets the id of the descendants.
   void set_snode_tree_id(int id);
 
-  int get_snode_tree_id();
+  int get_snode_tree_id() const;
 
  private:
   int snode_tree_id_{0};
@@ -137,6 +137,19 @@ ExternalTensorShapeAlongAxisStmt::ExternalTensorShapeAlongAxisStmt(int axis,
   TI_STMT_REG_FIELDS;
 }
 
+TextureOpStmt::TextureOpStmt(TextureOpType op,
+                             int arg_id,
+                             int num_dims,
+                             const std::vector<Stmt *> &args,
+                             int channel)
+    : op(op), arg_id(arg_id), num_dims(num_dims), args(args), channel(channel) {
+  TI_ASSERT(1 <= num_dims && num_dims <= 3);
+  TI_ASSERT(args.size() == num_dims + 1);
+  TI_ASSERT(0 <= channel && channel < 4);
+  ret_type = PrimitiveType::f32;
+  TI_STMT_REG_FIELDS;
+}
+
 LoopUniqueStmt::LoopUniqueStmt(Stmt *input, const std::vector<SNode *> &covers)
     : input(input) {
   for (const auto &sn : covers) {
@@ -388,6 +401,8 @@ std::string OffloadedStmt::task_type_name(TaskType tt) {
 std::unique_ptr<Stmt> OffloadedStmt::clone() const {
   auto new_stmt = std::make_unique<OffloadedStmt>(task_type, device);
   new_stmt->snode = snode;
+  new_stmt->listgen_source = listgen_source;
+  new_stmt->gc_compact = gc_compact;
   new_stmt->begin_offset = begin_offset;
   new_stmt->end_offset = end_offset;
   new_stmt->const_begin = const_begin;
@@ -157,7 +157,12 @@ class ArgLoadStmt : public Stmt {
  */
 class RandStmt : public Stmt {
  public:
-  RandStmt(const DataType &dt) {
+  // Always use the counter-based generator on the LLVM backends, regardless
+  // of CompileConfig::counter_based_rand.
+  bool counter_based;
+
+  RandStmt(const DataType &dt, bool counter_based = false)
+      : counter_based(counter_based) {
     ret_type = dt;
     TI_STMT_REG_FIELDS;
   }
@@ -170,7 +175,7 @@ class RandStmt : public Stmt {
     return false;
   }
 
-  TI_STMT_DEF_FIELDS(ret_type);
+  TI_STMT_DEF_FIELDS(ret_type, counter_based);
   TI_DEFINE_ACCEPT_AND_CLONE
 };
 
@@ -382,6 +387,37 @@ class ExternalTensorShapeAlongAxisStmt : public Stmt {
   TI_DEFINE_ACCEPT_AND_CLONE
 };
 
+/**
+ * Reads the |channel|-th channel of the texture passed as the |arg_id|-th
+ * argument, which has |num_dims| dimensions. |args| are the coordinates
+ * followed by the level of detail:
+ * - sample_lod: the normalized f32 coordinates, filtered by the sampler.
+ * - fetch_texel: the i32 coordinates of a texel, unfiltered.
+ * Textures are read-only in kernels, so the reads can be reordered and
+ * eliminated freely.
+ */
+class TextureOpStmt : public Stmt {
+ public:
+  TextureOpType op;
+  int arg_id;
+  int num_dims;
+  std::vector<Stmt *> args;
+  int channel;
+
+  TextureOpStmt(TextureOpType op,
+                int arg_id,
+                int num_dims,
+                const std::vector<Stmt *> &args,
+                int channel);
+
+  bool has_global_side_effect() const override {
+    return false;
+  }
+
+  TI_STMT_DEF_FIELDS(ret_type, op, arg_id, num_dims, args, channel);
+  TI_DEFINE_ACCEPT_AND_CLONE
+};
+
 /**
  * An assertion.
  * If |cond| is false, print the formatted |text| with |args|, and terminate
@@ -392,6 +428,9 @@ class AssertStmt : public Stmt {
   Stmt *cond;
   std::string text;
   std::vector<Stmt *> args;
+  // A deferred assertion only records its failure, which is reported at the
+  // next synchronization, and lets the thread carry on.
+  bool deferred{false};
 
   AssertStmt(Stmt *cond,
              const std::string &text,
@@ -401,7 +440,7 @@ class AssertStmt : public Stmt {
     TI_STMT_REG_FIELDS;
   }
 
-  TI_STMT_DEF_FIELDS(cond, text, args);
+  TI_STMT_DEF_FIELDS(cond, text, args, deferred);
   TI_DEFINE_ACCEPT_AND_CLONE
 };
 
@@ -1113,6 +1152,13 @@ class OffloadedStmt : public Stmt {
   TaskType task_type;
   Arch device;
   SNode *snode{nullptr};
+  // For listgen tasks, the ancestor of |snode| whose list the list of |snode|
+  // is generated from. Null means the parent, otherwise the levels in between
+  // are walked by the same task.
+  SNode *listgen_source{nullptr};
+  // For gc tasks, whether the live nodes of |snode| are also moved to the
+  // front of its NodeManager, so that the chunks behind can be released.
+  bool gc_compact{false};
   std::size_t begin_offset{0};
   std::size_t end_offset{0};
   bool const_begin{false};
@@ -1172,6 +1218,8 @@ class OffloadedStmt : public Stmt {
                      task_type,
                      device,
                      snode,
+                     listgen_source,
+                     gc_compact,
                      begin_offset,
                      end_offset,
                      const_begin,
@@ -1387,11 +1435,14 @@ class InternalFuncStmt : public Stmt {
  public:
   std::string func_name;
   std::vector<Stmt *> args;
+  // Local variables the function writes, passed after |args| as pointers.
+  std::vector<Stmt *> output_stmts;
 
   explicit InternalFuncStmt(const std::string &func_name,
                             const std::vector<Stmt *> &args,
+                            const std::vector<Stmt *> &output_stmts = {},
                             Type *ret_type = nullptr)
-      : func_name(func_name), args(args) {
+      : func_name(func_name), args(args), output_stmts(output_stmts) {
     if (ret_type == nullptr) {
       this->ret_type =
           TypeFactory::create_vector_or_scalar_type(1, PrimitiveType::i32);
@@ -1401,7 +1452,7 @@ class InternalFuncStmt : public Stmt {
     TI_STMT_REG_FIELDS;
   }
 
-  TI_STMT_DEF_FIELDS(ret_type, func_name, args);
+  TI_STMT_DEF_FIELDS(ret_type, func_name, args, output_stmts);
   TI_DEFINE_ACCEPT_AND_CLONE
 };
 
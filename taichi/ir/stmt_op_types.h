@@ -75,5 +75,9 @@ enum class SNodeOpType : int {
 
 std::string snode_op_type_name(SNodeOpType type);
 
+enum class TextureOpType : int { sample_lod, fetch_texel };
+
+std::string texture_op_type_name(TextureOpType type);
+
 }  // namespace lang
 }  // namespace taichi
@@ -8,6 +8,7 @@
 #include "taichi/ir/control_flow_graph.h"
 #include "taichi/ir/ir.h"
 #include "taichi/ir/pass.h"
+#include "taichi/transforms/auto_block_local.h"
 #include "taichi/transforms/check_out_of_bound.h"
 #include "taichi/transforms/constant_fold.h"
 #include "taichi/transforms/inlining.h"
@@ -66,6 +67,9 @@ std::unique_ptr<ScratchPads> initialize_scratch_pad(OffloadedStmt *root);
 void make_block_local(IRNode *root,
                       const CompileConfig &config,
                       const MakeBlockLocalPass::Args &args);
+void auto_block_local(IRNode *root,
+                      const CompileConfig &config,
+                      const AutoBlockLocalPass::Args &args);
 void make_mesh_thread_local(IRNode *root,
                             const CompileConfig &config,
                             const MakeBlockLocalPass::Args &args);
@@ -82,6 +86,7 @@ bool lower_access(IRNode *root,
                   const LowerAccessPass::Args &args);
 void auto_diff(IRNode *root,
                const CompileConfig &config,
+               AutodiffMode autodiff_mode,
                bool use_stack = false);
 /**
  * Determine all adaptive AD-stacks' size. This pass is idempotent, i.e.,
@@ -118,11 +123,17 @@ bool replace_and_insert_statements(
 bool replace_statements(IRNode *root,
                         std::function<bool(Stmt *)> filter,
                         std::function<Stmt *(Stmt *)> finder);
-void demote_dense_struct_fors(IRNode *root, bool packed);
+void demote_dense_struct_fors(IRNode *root,
+                              bool packed,
+                              bool demote_bitmasked = false);
+void tile_dense_struct_fors(IRNode *root, int tile_size);
 void demote_no_access_mesh_fors(IRNode *root);
 bool demote_atomics(IRNode *root, const CompileConfig &config);
 void reverse_segments(IRNode *root);  // for autograd
 void detect_read_only(IRNode *root);
+bool fuse_offloads(IRNode *root, const CompileConfig &config);
+bool hoist_uniform_values(IRNode *root);
+bool unroll_inner_loops(IRNode *root, const CompileConfig &config);
 void optimize_bit_struct_stores(IRNode *root,
                                 const CompileConfig &config,
                                 AnalysisManager *amgr);
@@ -150,7 +161,7 @@ void compile_to_offloads(IRNode *ir,
                          Kernel *kernel,
                          bool verbose,
                          bool vectorize,
-                         bool grad,
+                         AutodiffMode autodiff_mode,
                          bool ad_use_stack,
                          bool start_from_ast);
 
@@ -168,7 +179,7 @@ void compile_to_executable(IRNode *ir,
                            const CompileConfig &config,
                            Kernel *kernel,
                            bool vectorize,
-                           bool grad,
+                           AutodiffMode autodiff_mode,
                            bool ad_use_stack,
                            bool verbose,
                            bool lower_global_access = true,
@@ -68,6 +68,13 @@ std::string PrimitiveType::to_string() const {
   return data_type_name(DataType(const_cast<PrimitiveType *>(this)));
 }
 
+Type *PrimitiveType::get_compute_type() {
+  if (type == PrimitiveTypeID::bf16) {
+    return PrimitiveType::f32;
+  }
+  return this;
+}
+
 std::string PointerType::to_string() const {
   if (is_bit_pointer_) {
     // "^" for bit-level pointers
@@ -121,9 +121,8 @@ class PrimitiveType : public Type {
 
   std::string to_string() const override;
 
-  Type *get_compute_type() override {
-    return this;
-  }
+  // bf16 is a storage type: its values are loaded into and computed in f32.
+  Type *get_compute_type() override;
 
   static DataType get(PrimitiveTypeID type);
 };
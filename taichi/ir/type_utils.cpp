@@ -59,6 +59,8 @@ int data_type_size(DataType t) {
   if (false) {
   } else if (t->is_primitive(PrimitiveTypeID::f16))
     return 2;
+  else if (t->is_primitive(PrimitiveTypeID::bf16))
+    return 2;
   else if (t->is_primitive(PrimitiveTypeID::gen))
     return 0;
   else if (t->is_primitive(PrimitiveTypeID::unknown))
@@ -79,6 +79,7 @@ inline bool is_custom_type(DataType dt) {
 
 inline bool is_real(DataType dt) {
   return dt->is_primitive(PrimitiveTypeID::f16) ||
+         dt->is_primitive(PrimitiveTypeID::bf16) ||
          dt->is_primitive(PrimitiveTypeID::f32) ||
          dt->is_primitive(PrimitiveTypeID::f64) || dt->is<CustomFloatType>();
 }
@@ -2,22 +2,34 @@
 
 #ifdef TI_WITH_LLVM
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Module.h"
+#include "taichi/program/program.h"
 #endif
+#include "taichi/llvm/llvm_offline_cache.h"
+#include "taichi/util/metrics.h"
 
 TLANG_NAMESPACE_BEGIN
 
 #ifdef TI_WITH_LLVM
-std::unique_ptr<JITSession> create_llvm_jit_session_cpu(Arch arch);
-std::unique_ptr<JITSession> create_llvm_jit_session_cuda(Arch arch);
+std::unique_ptr<JITSession> create_llvm_jit_session_cpu(
+    TaichiLLVMContext *tlctx,
+    CompileConfig *config,
+    Arch arch);
+std::unique_ptr<JITSession> create_llvm_jit_session_cuda(
+    TaichiLLVMContext *tlctx,
+    CompileConfig *config,
+    Arch arch);
 #endif
 
-std::unique_ptr<JITSession> JITSession::create(Arch arch) {
+std::unique_ptr<JITSession> JITSession::create(TaichiLLVMContext *tlctx,
+                                               CompileConfig *config,
+                                               Arch arch) {
 #ifdef TI_WITH_LLVM
   if (arch_is_cpu(arch)) {
-    return create_llvm_jit_session_cpu(arch);
+    return create_llvm_jit_session_cpu(tlctx, config, arch);
   } else if (arch == Arch::cuda) {
 #if defined(TI_WITH_CUDA)
-    return create_llvm_jit_session_cuda(arch);
+    return create_llvm_jit_session_cuda(tlctx, config, arch);
 #else
     TI_NOT_IMPLEMENTED
 #endif
@@ -32,9 +44,63 @@ std::size_t JITSession::get_type_size(llvm::Type *type) {
   return get_data_layout().getTypeAllocSize(type);
 }
 
+std::size_t JITSession::get_struct_element_offset(llvm::StructType *type,
+                                                  int index) {
+  return get_data_layout().getStructLayout(type)->getElementOffset(index);
+}
+
 llvm::DataLayout JITSession::get_data_layout() {
   TI_NOT_IMPLEMENTED
 }
+
+JITModule *JITSession::add_module_unoptimized(
+    std::unique_ptr<llvm::Module> M) {
+  return add_module(std::move(M));
+}
+
+LlvmOfflineCache *JITSession::get_offline_cache(Arch arch) {
+  std::lock_guard<std::mutex> _(offline_cache_mut_);
+  if (!offline_cache_initialized_) {
+    offline_cache_initialized_ = true;
+    const auto &config = *config_;
+    if (config.offline_cache) {
+      auto path = config.offline_cache_file_path;
+      if (path.empty()) {
+        path = get_repo_dir() + "ticache/llvm";
+      }
+      offline_cache_ = std::make_unique<LlvmOfflineCache>(
+          fmt::format("{}/{}", path, arch_name(arch)),
+          (std::size_t)config.offline_cache_max_size_MB * 1024 * 1024,
+          config.offline_cache_shared);
+    }
+  }
+  return offline_cache_.get();
+}
+
+JITModule *JITSession::find_compiled_module(const std::string &key) {
+  std::lock_guard<std::mutex> _(compiled_modules_mut_);
+  auto it = compiled_modules_.find(key);
+  if (it == compiled_modules_.end()) {
+    return nullptr;
+  }
+  static auto &reuses = metrics().counter(
+      "taichi_jit_module_reuses",
+      "Modules reused from the JIT sessions retained by soft_reset.");
+  reuses.add();
+  return it->second;
+}
+
+void JITSession::record_compiled_module(const std::string &key,
+                                        JITModule *module) {
+  std::lock_guard<std::mutex> _(compiled_modules_mut_);
+  compiled_modules_.emplace(key, module);
+}
 #endif
 
+JITSession::JITSession(TaichiLLVMContext *tlctx, CompileConfig *config)
+    : tlctx_(tlctx), config_(config) {
+}
+
+JITSession::~JITSession() = default;
+
 TLANG_NAMESPACE_END
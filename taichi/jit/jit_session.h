@@ -2,6 +2,8 @@
 
 #include <memory>
 #include <functional>
+#include <mutex>
+#include <unordered_map>
 
 #include "taichi/llvm/llvm_fwd.h"
 #include "taichi/lang_util.h"
@@ -9,21 +11,58 @@
 
 TLANG_NAMESPACE_BEGIN
 
+class LlvmOfflineCache;
+class TaichiLLVMContext;
+struct CompileConfig;
+
 // Backend JIT compiler for all archs
 
 class JITSession {
  protected:
   std::vector<std::unique_ptr<JITModule>> modules;
+  // Owned by the program of this session. Not get_current_program(), since
+  // several programs may live side by side.
+  TaichiLLVMContext *tlctx_;
+  CompileConfig *config_;
+
+  // Returns nullptr if the offline cache is disabled. Created lazily, since
+  // the config may still change after the session is constructed.
+  LlvmOfflineCache *get_offline_cache(Arch arch);
+
+  // The module added earlier under |key|, or nullptr. Only used with
+  // CompileConfig::soft_reset, so that the programs sharing this session do
+  // not JIT identical modules again.
+  JITModule *find_compiled_module(const std::string &key);
+
+  void record_compiled_module(const std::string &key, JITModule *module);
 
  public:
-  JITSession() {
-  }
+  JITSession(TaichiLLVMContext *tlctx, CompileConfig *config);
 
   virtual JITModule *add_module(std::unique_ptr<llvm::Module> M,
                                 int max_reg = 0) = 0;
 
+  // Adds |M| without optimizing it, so that it compiles much faster into
+  // slower code. Backends without such a mode optimize it as usual.
+  virtual JITModule *add_module_unoptimized(std::unique_ptr<llvm::Module> M);
+
   // virtual void remove_module(JITModule *module) = 0;
 
+  // Compiles |M| ahead of time to the binary this session loads, i.e. an
+  // object file on CPUs and PTX on CUDA. On CPUs, |target| is the LLVM name of
+  // the CPU to compile for, see CompileConfig::cpu_target. Empty means the
+  // target of the JIT.
+  virtual std::string compile_module_to_binary(std::unique_ptr<llvm::Module> M,
+                                               const std::string &target) {
+    TI_NOT_IMPLEMENTED
+  }
+
+  // Loads a binary produced by compile_module_to_binary(), skipping the LLVM
+  // optimization and code generation.
+  virtual JITModule *add_binary(const std::string &binary, int max_reg = 0) {
+    TI_NOT_IMPLEMENTED
+  }
+
   virtual void *lookup(const std::string Name) {
     TI_NOT_IMPLEMENTED
   }
@@ -32,12 +71,29 @@ class JITSession {
 
   std::size_t get_type_size(llvm::Type *type);
 
-  static std::unique_ptr<JITSession> create(Arch arch);
+  std::size_t get_struct_element_offset(llvm::StructType *type, int index);
+
+  static std::unique_ptr<JITSession> create(TaichiLLVMContext *tlctx,
+                                            CompileConfig *config,
+                                            Arch arch);
 
   virtual void global_optimize_module(llvm::Module *module) {
   }
 
-  virtual ~JITSession() = default;
+  // Called when the session is handed over to a new program, see
+  // TaichiLLVMContext::rebind().
+  void set_config(CompileConfig *config) {
+    config_ = config;
+  }
+
+  virtual ~JITSession();
+
+ private:
+  std::unique_ptr<LlvmOfflineCache> offline_cache_{nullptr};
+  bool offline_cache_initialized_{false};
+  std::mutex offline_cache_mut_;
+  std::unordered_map<std::string, JITModule *> compiled_modules_;
+  std::mutex compiled_modules_mut_;
 };
 
 TLANG_NAMESPACE_END
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "taichi/common/core.h"
+#include "taichi/common/serialization.h"
+#include "taichi/program/arch.h"
+#include "taichi/program/compile_config.h"
+
+namespace taichi {
+namespace lang {
+
+struct LlvmOffloadedTask {
+  std::string name;
+  int block_dim{0};
+  int grid_dim{0};
+
+  TI_IO_DEF(name, block_dim, grid_dim);
+};
+
+struct LlvmCompiledKernel {
+  // In launch order.
+  std::vector<LlvmOffloadedTask> tasks;
+  // The number of kernel arguments, whose ndarrays are unwrapped to raw
+  // pointers at launch.
+  int num_args{0};
+  // An object file on CPUs, PTX on CUDA.
+  std::string binary;
+  // The object files for LlvmAotData::cpu_variants, in the same order.
+  std::vector<std::string> variant_binaries;
+
+  TI_IO_DEF(tasks, num_args, binary, variant_binaries);
+};
+
+struct LlvmCompiledFieldData {
+  std::string field_name;
+  std::string dtype_name;
+  int snode_tree_id{0};
+  std::vector<int> shape;
+  bool is_scalar{false};
+  int row_num{0};
+  int column_num{0};
+
+  TI_IO_DEF(field_name,
+            dtype_name,
+            snode_tree_id,
+            shape,
+            is_scalar,
+            row_num,
+            column_num);
+};
+
+struct LlvmAotData {
+  int arch{0};
+  // See get_llvm_aot_target().
+  std::string target;
+  // See CompileConfig::cpu_aot_variants.
+  std::vector<std::string> cpu_variants;
+  std::unordered_map<std::string, LlvmCompiledKernel> kernels;
+  std::unordered_map<std::string, LlvmCompiledKernel> kernel_tmpls;
+  std::vector<LlvmCompiledFieldData> fields;
+
+  TI_IO_DEF(arch, target, cpu_variants, kernels, kernel_tmpls, fields);
+};
+
+// The target the binaries of |config.arch| are compiled for, i.e.
+// "<process triple>/<CPU name>[/<CPU features>]" on CPUs, see
+// CompileConfig::cpu_target.
+std::string get_llvm_aot_target(const CompileConfig &config);
+
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,108 @@
+#include "taichi/llvm/llvm_aot_module_builder.h"
+
+#include "llvm/Support/Host.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include "taichi/backends/cpu/codegen_cpu.h"
+#include "taichi/codegen/codegen_llvm.h"
+#include "taichi/llvm/llvm_program.h"
+#if defined(TI_WITH_CUDA)
+#include "taichi/backends/cuda/codegen_cuda.h"
+#include "taichi/backends/cuda/cuda_context.h"
+#endif
+
+namespace taichi {
+namespace lang {
+
+std::string get_llvm_aot_target(const CompileConfig &config) {
+  if (arch_is_cpu(config.arch)) {
+    auto target = fmt::format("{}/{}", llvm::sys::getProcessTriple(),
+                              config.cpu_target.empty()
+                                  ? llvm::sys::getHostCPUName().str()
+                                  : config.cpu_target);
+    if (!config.cpu_features.empty()) {
+      target += "/" + config.cpu_features;
+    }
+    return target;
+  }
+#if defined(TI_WITH_CUDA)
+  if (config.arch == Arch::cuda) {
+    return fmt::format("sm_{}",
+                       CUDAContext::get_instance().get_compute_capability());
+  }
+#endif
+  TI_NOT_IMPLEMENTED
+}
+
+LlvmAotModuleBuilder::LlvmAotModuleBuilder(LlvmProgramImpl *prog)
+    : prog_(prog) {
+  const auto arch = prog_->config->arch;
+  aot_data_.arch = (int)arch;
+  aot_data_.target = get_llvm_aot_target(*prog_->config);
+  if (arch_is_cpu(arch) && !prog_->config->cpu_aot_variants.empty()) {
+    aot_data_.cpu_variants =
+        split_string(prog_->config->cpu_aot_variants, ",");
+  }
+}
+
+void LlvmAotModuleBuilder::dump(const std::string &output_dir,
+                                const std::string &filename) const {
+  TI_WARN_IF(!filename.empty(),
+             "Filename prefix is ignored on the LLVM backends.");
+  // No JSON twin as on OpenGL, since the binaries are not text.
+  const std::string bin_path = fmt::format("{}/metadata.tcb", output_dir);
+  write_to_binary_file(aot_data_, bin_path);
+}
+
+LlvmCompiledKernel LlvmAotModuleBuilder::compile_kernel(Kernel *kernel) {
+  const auto arch = prog_->config->arch;
+  std::unique_ptr<LlvmModuleGenValue> gen;
+  if (arch_is_cpu(arch)) {
+    gen = CodeGenCPU(kernel).modulegen();
+  } else {
+#if defined(TI_WITH_CUDA)
+    TI_ASSERT(arch == Arch::cuda);
+    gen = CodeGenCUDA(kernel).modulegen();
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  }
+  LlvmCompiledKernel compiled;
+  compiled.tasks = std::move(gen->tasks);
+  compiled.num_args = (int)kernel->args.size();
+  auto *jit = prog_->get_llvm_context(arch)->jit.get();
+  for (const auto &cpu : aot_data_.cpu_variants) {
+    compiled.variant_binaries.push_back(
+        jit->compile_module_to_binary(llvm::CloneModule(*gen->module), cpu));
+  }
+  compiled.binary = jit->compile_module_to_binary(std::move(gen->module), "");
+  return compiled;
+}
+
+void LlvmAotModuleBuilder::add_per_backend(const std::string &identifier,
+                                           Kernel *kernel) {
+  aot_data_.kernels[identifier] = compile_kernel(kernel);
+}
+
+void LlvmAotModuleBuilder::add_field_per_backend(const std::string &identifier,
+                                                 const SNode *rep_snode,
+                                                 bool is_scalar,
+                                                 DataType dt,
+                                                 std::vector<int> shape,
+                                                 int row_num,
+                                                 int column_num) {
+  // The compiled kernels address the fields through the SNode trees of the
+  // program, so only the description of the field is recorded.
+  aot_data_.fields.push_back({identifier, dt.to_string(),
+                              rep_snode->get_snode_tree_id(), shape,
+                              is_scalar, row_num, column_num});
+}
+
+void LlvmAotModuleBuilder::add_per_backend_tmpl(const std::string &identifier,
+                                                const std::string &key,
+                                                Kernel *kernel) {
+  aot_data_.kernel_tmpls[identifier + "|" + key] = compile_kernel(kernel);
+}
+
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "taichi/llvm/llvm_aot_data.h"
+#include "taichi/program/aot_module_builder.h"
+
+namespace taichi {
+namespace lang {
+
+class LlvmProgramImpl;
+
+// Compiles kernels ahead of time to object files on CPUs and PTX on CUDA, for
+// the host and GPU of this machine. See LlvmAotModuleLoader for loading them.
+class LlvmAotModuleBuilder : public AotModuleBuilder {
+ public:
+  explicit LlvmAotModuleBuilder(LlvmProgramImpl *prog);
+
+  void dump(const std::string &output_dir,
+            const std::string &filename) const override;
+
+ protected:
+  void add_per_backend(const std::string &identifier, Kernel *kernel) override;
+  void add_field_per_backend(const std::string &identifier,
+                             const SNode *rep_snode,
+                             bool is_scalar,
+                             DataType dt,
+                             std::vector<int> shape,
+                             int row_num,
+                             int column_num) override;
+  void add_per_backend_tmpl(const std::string &identifier,
+                            const std::string &key,
+                            Kernel *kernel) override;
+
+ private:
+  LlvmCompiledKernel compile_kernel(Kernel *kernel);
+
+  LlvmProgramImpl *prog_{nullptr};
+  LlvmAotData aot_data_;
+};
+
+}  // namespace lang
+}  // namespace taichi
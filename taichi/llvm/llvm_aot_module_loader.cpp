@@ -0,0 +1,140 @@
+#include "taichi/llvm/llvm_aot_module_loader.h"
+
+#include "llvm/Support/Host.h"
+
+#include "taichi/backends/cpu/cpu_target.h"
+#include "taichi/llvm/llvm_program.h"
+#if defined(TI_WITH_CUDA)
+#include "taichi/backends/cuda/cuda_context.h"
+#endif
+
+namespace taichi {
+namespace lang {
+
+namespace {
+// Same as the JIT compiled kernels, see
+// CodeGenLLVM::compile_module_to_executable().
+void unwrap_ndarrays(LlvmProgramImpl *prog,
+                     RuntimeContext &context,
+                     int num_args) {
+  for (int i = 0; i < num_args; i++) {
+    if (context.is_device_allocation[i]) {
+      DeviceAllocation *ptr =
+          static_cast<DeviceAllocation *>(context.get_arg<void *>(i));
+      context.set_arg(i, (uint64)prog->get_ndarray_alloc_info_ptr(*ptr));
+      context.set_device_allocation(i, false);
+    }
+  }
+}
+}  // namespace
+
+LlvmAotModuleLoader::LlvmAotModuleLoader(LlvmProgramImpl *prog,
+                                         const std::string &output_dir)
+    : prog_(prog) {
+  const std::string bin_path = fmt::format("{}/metadata.tcb", output_dir);
+  read_from_binary_file(aot_data_, bin_path);
+  const auto arch = prog_->config->arch;
+  TI_ERROR_IF(aot_data_.arch != (int)arch,
+              "AOT module {} is built for {}, but the program runs on {}",
+              output_dir, arch_name((Arch)aot_data_.arch), arch_name(arch));
+  // PTX is compiled by the CUDA driver, so it runs on newer GPUs as well.
+  if (arch_is_cpu(arch)) {
+    // See get_llvm_aot_target().
+    const auto target = split_string(aot_data_.target, "/");
+    const auto triple = llvm::sys::getProcessTriple();
+    TI_ERROR_IF(target.size() < 2 || target[0] != triple,
+                "AOT module {} is built for {}, but the host is {}",
+                output_dir, aot_data_.target, triple);
+    // Dispatches on the features of the host CPU.
+    for (int i = 0; i < (int)aot_data_.cpu_variants.size(); i++) {
+      if (host_supports_cpu_target({aot_data_.cpu_variants[i], ""})) {
+        cpu_variant_ = i;
+        break;
+      }
+    }
+    if (cpu_variant_ < 0) {
+      const CpuTarget default_target{target[1],
+                                     target.size() > 2 ? target[2] : ""};
+      TI_ERROR_IF(!host_supports_cpu_target(default_target),
+                  "AOT module {} is built for {}, which the host CPU {} does "
+                  "not support",
+                  output_dir, aot_data_.target,
+                  llvm::sys::getHostCPUName().str());
+    }
+  }
+}
+
+FunctionType LlvmAotModuleLoader::get_kernel(const std::string &name) {
+  if (auto it = loaded_kernels_.find(name); it != loaded_kernels_.end()) {
+    return it->second;
+  }
+  auto it = aot_data_.kernels.find(name);
+  if (it == aot_data_.kernels.end()) {
+    return nullptr;
+  }
+  return loaded_kernels_[name] = load_kernel(it->second);
+}
+
+FunctionType LlvmAotModuleLoader::get_kernel_template(
+    const std::string &identifier,
+    const std::string &key) {
+  const auto name = identifier + "|" + key;
+  if (auto it = loaded_kernels_.find(name); it != loaded_kernels_.end()) {
+    return it->second;
+  }
+  auto it = aot_data_.kernel_tmpls.find(name);
+  if (it == aot_data_.kernel_tmpls.end()) {
+    return nullptr;
+  }
+  return loaded_kernels_[name] = load_kernel(it->second);
+}
+
+FunctionType LlvmAotModuleLoader::load_kernel(
+    const LlvmCompiledKernel &compiled) {
+  TI_AUTO_PROF
+  const auto arch = prog_->config->arch;
+  auto *jit = prog_->get_llvm_context(arch)->jit.get();
+  const int max_reg = arch == Arch::cuda ? prog_->config->gpu_max_reg : 0;
+  auto *jit_module =
+      jit->add_binary(cpu_variant_ >= 0
+                          ? compiled.variant_binaries[cpu_variant_]
+                          : compiled.binary,
+                      max_reg);
+  auto *prog = prog_;
+  const int num_args = compiled.num_args;
+
+  if (arch_is_cpu(arch)) {
+    using task_fp_type = int32 (*)(void *);
+    std::vector<task_fp_type> funcs;
+    for (const auto &task : compiled.tasks) {
+      funcs.push_back((task_fp_type)jit_module->lookup_function(task.name));
+    }
+    return [prog, funcs, num_args](RuntimeContext &context) {
+      context.runtime = prog->get_llvm_runtime();
+      unwrap_ndarrays(prog, context, num_args);
+      for (auto func : funcs) {
+        func(&context);
+      }
+    };
+  }
+#if defined(TI_WITH_CUDA)
+  TI_ASSERT(arch == Arch::cuda);
+  auto tasks = compiled.tasks;
+  return [prog, jit_module, tasks, num_args](RuntimeContext &context) {
+    CUDAContext::get_instance().make_current();
+    context.runtime = prog->get_llvm_runtime();
+    unwrap_ndarrays(prog, context, num_args);
+    for (const auto &task : tasks) {
+      TI_TRACE("Launching kernel {}<<<{}, {}>>>", task.name, task.grid_dim,
+               task.block_dim);
+      jit_module->launch(task.name, task.grid_dim, task.block_dim, 0,
+                         {&context});
+    }
+  };
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
+
+}  // namespace lang
+}  // namespace taichi
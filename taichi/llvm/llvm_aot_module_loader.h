@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "taichi/llvm/llvm_aot_data.h"
+#include "taichi/lang_util.h"
+
+namespace taichi {
+namespace lang {
+
+class LlvmProgramImpl;
+
+// Loads the kernels compiled by LlvmAotModuleBuilder, without running the
+// LLVM optimization or code generation.
+//
+// The compiled kernels address the fields through the SNode trees of the
+// program, so |prog| must have materialized the same SNode trees as the
+// program that built the module.
+class LlvmAotModuleLoader {
+ public:
+  LlvmAotModuleLoader(LlvmProgramImpl *prog, const std::string &output_dir);
+
+  // Returns nullptr if there is no such kernel. The binary of a kernel is
+  // loaded on the first query.
+  //
+  // The returned function sets the runtime of the context and unwraps its
+  // ndarrays. External arrays must already be raw pointers on the device.
+  FunctionType get_kernel(const std::string &name);
+
+  FunctionType get_kernel_template(const std::string &identifier,
+                                   const std::string &key);
+
+  const std::vector<LlvmCompiledFieldData> &get_fields() const {
+    return aot_data_.fields;
+  }
+
+ private:
+  FunctionType load_kernel(const LlvmCompiledKernel &compiled);
+
+  LlvmProgramImpl *prog_{nullptr};
+  LlvmAotData aot_data_;
+  // The index of the CPU variant loaded, see LlvmAotData::cpu_variants. -1
+  // means the default binaries.
+  int cpu_variant_{-1};
+  std::unordered_map<std::string, FunctionType> loaded_kernels_;
+};
+
+}  // namespace lang
+}  // namespace taichi
@@ -90,6 +90,9 @@ class LLVMModuleBuilder {
 
   llvm::Function *get_runtime_function(const std::string &name) {
     auto f = module->getFunction(name);
+    if (!f) {
+      f = tlctx->declare_struct_function(module.get(), name);
+    }
     if (!f) {
       TI_ERROR("LLVMRuntime function {} not found.", name);
     }
@@ -38,6 +38,7 @@
 #include "taichi/lang_util.h"
 #include "taichi/jit/jit_session.h"
 #include "taichi/common/task.h"
+#include "taichi/program/parallel_executor.h"
 #include "taichi/util/environ_config.h"
 #include "llvm_context.h"
 
@@ -48,6 +49,8 @@
 #include <unistd.h>
 #endif
 
+#include <unordered_set>
+
 #if defined(TI_WITH_CUDA)
 #include "taichi/backends/cuda/cuda_context.h"
 #endif
@@ -57,7 +60,8 @@ namespace lang {
 
 using namespace llvm;
 
-TaichiLLVMContext::TaichiLLVMContext(Arch arch) : arch_(arch) {
+TaichiLLVMContext::TaichiLLVMContext(CompileConfig *config, Arch arch)
+    : arch_(arch) {
   TI_TRACE("Creating Taichi llvm context for arch: {}", arch_name(arch));
   main_thread_id_ = std::this_thread::get_id();
   main_thread_data_ = get_this_thread_data();
@@ -91,11 +95,13 @@ TaichiLLVMContext::TaichiLLVMContext(Arch arch) : arch_(arch) {
     TI_NOT_IMPLEMENTED
 #endif
   }
-  jit = JITSession::create(arch);
+  jit = JITSession::create(this, config, arch);
   TI_TRACE("Taichi llvm context created.");
 }
 
 TaichiLLVMContext::~TaichiLLVMContext() {
+  // Waits for the modules being compiled in the background, which use |jit|.
+  background_compile_worker_.reset();
 }
 
 llvm::Type *TaichiLLVMContext::get_data_type(DataType dt) {
@@ -122,6 +128,9 @@ llvm::Type *TaichiLLVMContext::get_data_type(DataType dt) {
     return llvm::Type::getInt64Ty(*ctx);
   } else if (dt->is_primitive(PrimitiveTypeID::f16)) {
     return llvm::Type::getHalfTy(*ctx);
+  } else if (dt->is_primitive(PrimitiveTypeID::bf16)) {
+    // bf16 is stored as its bits, see CodeGenLLVM::bf16_to_f32.
+    return llvm::Type::getInt16Ty(*ctx);
   } else {
     TI_INFO(data_type_name(dt));
     TI_NOT_IMPLEMENTED
@@ -259,6 +268,16 @@ void TaichiLLVMContext::init_runtime_jit_module() {
   update_runtime_jit_module(clone_runtime_module());
 }
 
+void TaichiLLVMContext::rebind(CompileConfig *config) {
+  background_compile_worker_.reset();
+  jit->set_config(config);
+  main_thread_id_ = std::this_thread::get_id();
+  main_thread_data_ = get_this_thread_data();
+  main_thread_data_->struct_module = nullptr;
+  // The struct modules of the other threads are cloned again.
+  main_thread_data_->struct_module_version = ++struct_module_version_;
+}
+
 // Note: runtime_module = init_module < struct_module
 
 std::unique_ptr<llvm::Module> TaichiLLVMContext::clone_runtime_module() {
@@ -362,6 +381,8 @@ std::unique_ptr<llvm::Module> TaichiLLVMContext::clone_module(
                     Intrinsic::nvvm_shfl_sync_down_i32);
     patch_intrinsic("cuda_shfl_down_sync_f32",
                     Intrinsic::nvvm_shfl_sync_down_f32);
+    patch_intrinsic("cuda_shfl_sync_i32", Intrinsic::nvvm_shfl_sync_idx_i32);
+    patch_intrinsic("cuda_shfl_sync_f32", Intrinsic::nvvm_shfl_sync_idx_f32);
 
     patch_intrinsic("cuda_match_any_sync_i32",
                     Intrinsic::nvvm_match_any_sync_i32);
@@ -445,16 +466,153 @@ std::unique_ptr<llvm::Module> TaichiLLVMContext::clone_struct_module() {
   return llvm::CloneModule(*struct_module);
 }
 
-void TaichiLLVMContext::set_struct_module(
-    const std::unique_ptr<llvm::Module> &module) {
+std::unique_ptr<llvm::Module> TaichiLLVMContext::new_kernel_module(
+    const std::string &name) {
+  auto struct_module = get_this_thread_struct_module();
+  TI_ASSERT(struct_module);
+  auto module =
+      std::make_unique<llvm::Module>(name, struct_module->getContext());
+  module->setDataLayout(struct_module->getDataLayout());
+  module->setTargetTriple(struct_module->getTargetTriple());
+  return module;
+}
+
+llvm::Function *TaichiLLVMContext::declare_struct_function(
+    llvm::Module *module,
+    const std::string &name) {
+  auto *f = get_this_thread_struct_module()->getFunction(name);
+  if (!f || f->isDeclaration()) {
+    return nullptr;
+  }
+  auto *decl = llvm::Function::Create(
+      f->getFunctionType(), llvm::Function::ExternalLinkage, name, *module);
+  decl->setAttributes(f->getAttributes());
+  return decl;
+}
+
+void TaichiLLVMContext::link_struct_functions(llvm::Module *module) {
+  TI_AUTO_PROF
+  using namespace llvm;
+  auto struct_module = get_this_thread_struct_module();
+  std::vector<std::string> imported;
+  std::vector<const GlobalValue *> worklist;
+  std::unordered_set<const GlobalValue *> needed;
+  auto add = [&](const GlobalValue *gv) {
+    if (needed.insert(gv).second) {
+      worklist.push_back(gv);
+    }
+  };
+  for (auto &f : *module) {
+    if (!f.isDeclaration()) {
+      continue;
+    }
+    auto *def = struct_module->getFunction(f.getName());
+    if (def && !def->isDeclaration()) {
+      imported.push_back(f.getName().str());
+      add(def);
+    }
+  }
+  if (imported.empty()) {
+    return;
+  }
+  // Computes the closure of the globals referenced by the imported functions,
+  // so that only those are cloned.
+  std::vector<const Constant *> constants;
+  auto visit_constant = [&](const Constant *c) {
+    constants.push_back(c);
+    while (!constants.empty()) {
+      auto *cur = constants.back();
+      constants.pop_back();
+      if (auto *gv = dyn_cast<GlobalValue>(cur)) {
+        add(gv);
+        continue;
+      }
+      for (auto &op : cur->operands()) {
+        if (auto *c_op = dyn_cast<Constant>(op.get())) {
+          constants.push_back(c_op);
+        }
+      }
+    }
+  };
+  while (!worklist.empty()) {
+    auto *gv = worklist.back();
+    worklist.pop_back();
+    if (auto *f = dyn_cast<Function>(gv)) {
+      for (auto &bb : *f) {
+        for (auto &inst : bb) {
+          for (auto &op : inst.operands()) {
+            if (auto *c = dyn_cast<Constant>(op.get())) {
+              visit_constant(c);
+            }
+          }
+        }
+      }
+      if (f->hasPersonalityFn()) {
+        visit_constant(f->getPersonalityFn());
+      }
+    } else if (auto *var = dyn_cast<GlobalVariable>(gv)) {
+      if (var->hasInitializer()) {
+        visit_constant(var->getInitializer());
+      }
+    } else if (auto *alias = dyn_cast<GlobalAlias>(gv)) {
+      visit_constant(alias->getAliasee());
+    }
+  }
+  ValueToValueMapTy vmap;
+  auto definitions =
+      CloneModule(*struct_module, vmap, [&](const GlobalValue *gv) {
+        return needed.count(gv) > 0;
+      });
+  if (Linker::linkModules(*module, std::move(definitions),
+                          Linker::LinkOnlyNeeded)) {
+    TI_ERROR("Failed to link the runtime functions into {}.",
+             module->getName().str());
+  }
+  for (const auto &name : imported) {
+    auto *f = module->getFunction(name);
+    TI_ASSERT(f);
+    f->removeFnAttr(Attribute::OptimizeNone);
+    f->removeFnAttr(Attribute::NoInline);
+    f->addFnAttr(Attribute::AlwaysInline);
+  }
+}
+
+std::unique_ptr<llvm::Module> TaichiLLVMContext::new_struct_module(
+    const std::vector<std::string> &runtime_functions) {
+  TI_AUTO_PROF
+  TI_ASSERT(std::this_thread::get_id() == main_thread_id_);
+  auto data = get_this_thread_data();
+  if (!data->struct_module) {
+    data->struct_module = clone_runtime_module();
+  }
+  auto *base = data->struct_module.get();
+  auto module = std::make_unique<llvm::Module>("struct", base->getContext());
+  module->setDataLayout(base->getDataLayout());
+  module->setTargetTriple(base->getTargetTriple());
+  for (const auto &name : runtime_functions) {
+    auto *f = base->getFunction(name);
+    TI_ASSERT_INFO(f, "LLVMRuntime function {} not found.", name);
+    llvm::Function::Create(f->getFunctionType(),
+                           llvm::Function::ExternalLinkage, name, *module);
+  }
+  return module;
+}
+
+void TaichiLLVMContext::add_struct_module(
+    std::unique_ptr<llvm::Module> module) {
+  TI_AUTO_PROF
+  TI_ASSERT(std::this_thread::get_id() == main_thread_id_);
   auto data = get_this_thread_data();
   TI_ASSERT(module);
+  TI_ASSERT(data->struct_module);
   if (llvm::verifyModule(*module, &llvm::errs())) {
     module->print(llvm::errs(), nullptr);
     TI_ERROR("module broken");
   }
-  // TODO: Move this after ``if (!arch_is_cpu(arch))``.
-  data->struct_module = llvm::CloneModule(*module);
+  if (llvm::Linker::linkModules(*data->struct_module, std::move(module))) {
+    TI_ERROR("Failed to link the SNode tree module.");
+  }
+  data->struct_module_version = ++struct_module_version_;
 }
 
 template <typename T>
@@ -520,6 +678,12 @@ std::size_t TaichiLLVMContext::get_type_size(llvm::Type *type) {
   return jit->get_type_size(type);
 }
 
+std::size_t TaichiLLVMContext::get_struct_element_offset(
+    llvm::StructType *type,
+    int index) {
+  return jit->get_struct_element_offset(type, index);
+}
+
 void TaichiLLVMContext::mark_inline(llvm::Function *f) {
   for (auto &B : *f)
     for (auto &I : B) {
@@ -570,6 +734,33 @@ JITModule *TaichiLLVMContext::add_module(std::unique_ptr<llvm::Module> module) {
   return jit->add_module(std::move(module));
 }
 
+JITModule *TaichiLLVMContext::add_module_unoptimized(
+    std::unique_ptr<llvm::Module> module) {
+  return jit->add_module_unoptimized(std::move(module));
+}
+
+void TaichiLLVMContext::add_module_in_background(
+    std::string bitcode,
+    std::function<void(JITModule *)> on_added) {
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    if (!background_compile_worker_) {
+      background_compile_worker_ =
+          std::make_unique<ParallelExecutor>("background_compile", 1);
+    }
+  }
+  background_compile_worker_->enqueue(
+      [this, bitcode = std::move(bitcode), on_added = std::move(on_added)]() {
+        auto module = parseBitcodeFile(
+            llvm::MemoryBufferRef(bitcode, "background_module"),
+            *get_this_thread_context());
+        if (!module) {
+          TI_ERROR("Failed to parse the module compiled in the background.");
+        }
+        on_added(add_module(std::move(module.get())));
+      });
+}
+
 void TaichiLLVMContext::insert_nvvm_annotation(llvm::Function *func,
                                                std::string key,
                                                int val) {
@@ -665,9 +856,11 @@ TaichiLLVMContext::get_this_thread_thread_safe_context() {
 
 llvm::Module *TaichiLLVMContext::get_this_thread_struct_module() {
   ThreadLocalData *data = get_this_thread_data();
-  if (!data->struct_module) {
+  const int version = struct_module_version_.load();
+  if (!data->struct_module || data->struct_module_version != version) {
     data->struct_module = clone_module_to_this_thread_context(
         main_thread_data_->struct_module.get());
+    data->struct_module_version = version;
   }
   return data->struct_module.get();
 }
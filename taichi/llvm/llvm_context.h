@@ -5,6 +5,7 @@
 // and invoking compiled functions (kernels).
 // Designed to be multithreaded for parallel compilation.
 
+#include <atomic>
 #include <mutex>
 #include <functional>
 #include <thread>
@@ -18,6 +19,7 @@ namespace taichi {
 namespace lang {
 
 class JITSessionCPU;
+class ParallelExecutor;
 
 /**
  * Manages an LLVMContext for Taichi's usage.
@@ -30,6 +32,8 @@ class TaichiLLVMContext {
         nullptr};
     std::unique_ptr<llvm::Module> runtime_module{nullptr};
     std::unique_ptr<llvm::Module> struct_module{nullptr};
+    // See |struct_module_version_|.
+    int struct_module_version{0};
   };
 
  public:
@@ -37,7 +41,7 @@ class TaichiLLVMContext {
   // main_thread is defined to be the thread that runs the initializer
   JITModule *runtime_jit_module{nullptr};
 
-  TaichiLLVMContext(Arch arch);
+  TaichiLLVMContext(CompileConfig *config, Arch arch);
 
   virtual ~TaichiLLVMContext();
 
@@ -54,6 +58,18 @@ class TaichiLLVMContext {
    */
   void init_runtime_jit_module();
 
+  /**
+   * Hands this context over to a new program, see CompileConfig::soft_reset.
+   * Waits for the modules being compiled in the background, which report to
+   * the old program, drops the SNode trees of the struct module, and makes the
+   * calling thread the main thread. The JITted modules, including
+   * |runtime_jit_module|, are kept.
+   *
+   * @param config The config of the new program, or nullptr while the
+   * context is retained between two programs.
+   */
+  void rebind(CompileConfig *config);
+
   /**
    * Clones the LLVM module containing the JIT compiled SNode structs.
    *
@@ -62,11 +78,53 @@ class TaichiLLVMContext {
   std::unique_ptr<llvm::Module> clone_struct_module();
 
   /**
-   * Updates the LLVM module of the JIT compiled SNode structs.
+   * Creates an empty module for a kernel. The runtime functions it calls are
+   * only declared (see declare_struct_function()), and their definitions are
+   * imported by link_struct_functions() once the kernel is generated, which
+   * is much cheaper than cloning the whole struct module.
+   *
+   * @param name Name of the new module.
+   * @return The new module, in the context of this thread.
+   */
+  std::unique_ptr<llvm::Module> new_kernel_module(const std::string &name);
+
+  /**
+   * Declares in @param module a function of the struct module, with the same
+   * signature.
    *
-   * @param module Module containg the JIT compiled SNode structs.
+   * @param name Name of the function.
+   * @return The declaration, or nullptr if the struct module does not define
+   * the function.
+   */
+  llvm::Function *declare_struct_function(llvm::Module *module,
+                                          const std::string &name);
+
+  /**
+   * Imports into @param module the definitions of the functions it declares
+   * from the struct module, along with everything they reference. The
+   * imported functions that @param module called directly are forced inline,
+   * as if the whole struct module had been cloned.
    */
-  void set_struct_module(const std::unique_ptr<llvm::Module> &module);
+  void link_struct_functions(llvm::Module *module);
+
+  /**
+   * Creates an empty module for the types and accessors of a new SNode tree.
+   *
+   * @param runtime_functions Names of the runtime functions to declare in the
+   * new module, so that the accessors can call them.
+   * @return The new module, in the context of this thread.
+   */
+  std::unique_ptr<llvm::Module> new_struct_module(
+      const std::vector<std::string> &runtime_functions);
+
+  /**
+   * Appends a new SNode tree to the LLVM module of the JIT compiled SNode
+   * structs. Only @param module is verified, and the existing struct module is
+   * extended in place instead of being rebuilt.
+   *
+   * @param module Module created by new_struct_module().
+   */
+  void add_struct_module(std::unique_ptr<llvm::Module> module);
 
   /**
    * Clones the LLVM module compiled from llvm/runtime.cpp
@@ -79,6 +137,23 @@ class TaichiLLVMContext {
 
   JITModule *add_module(std::unique_ptr<llvm::Module> module);
 
+  /**
+   * Adds @param module to the JIT session without optimizing it. It compiles
+   * much faster than with add_module(), into slower code.
+   */
+  JITModule *add_module_unoptimized(std::unique_ptr<llvm::Module> module);
+
+  /**
+   * Adds a module to the JIT session on a background thread, with the usual
+   * optimization. Can be called from any thread.
+   *
+   * @param bitcode The module, serialized with llvm::WriteBitcodeToFile().
+   * @param on_added Called on the background thread with the new JITModule.
+   */
+  void add_module_in_background(
+      std::string bitcode,
+      std::function<void(JITModule *)> on_added);
+
   virtual void *lookup_function_pointer(const std::string &name) {
     return jit->lookup(name);
   }
@@ -104,6 +179,8 @@ class TaichiLLVMContext {
 
   std::size_t get_type_size(llvm::Type *type);
 
+  std::size_t get_struct_element_offset(llvm::StructType *type, int index);
+
   template <typename T>
   llvm::Value *get_constant(T t);
 
@@ -153,6 +230,11 @@ class TaichiLLVMContext {
   ThreadLocalData *main_thread_data_{nullptr};
   std::mutex mut_;
   std::mutex thread_map_mut_;
+  // Incremented by each add_struct_module(). The struct modules of the other
+  // threads are cloned again once they are outdated.
+  std::atomic<int> struct_module_version_{0};
+  // Created by the first add_module_in_background().
+  std::unique_ptr<ParallelExecutor> background_compile_worker_{nullptr};
 };
 
 std::unique_ptr<llvm::Module> module_from_bitcode_file(std::string bitcode_path,
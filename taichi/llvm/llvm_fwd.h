@@ -3,6 +3,7 @@
 namespace llvm {
 class LLVMContext;
 class Type;
+class StructType;
 class Value;
 class Module;
 class Function;
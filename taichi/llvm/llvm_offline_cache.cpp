@@ -0,0 +1,210 @@
+#include "taichi/llvm/llvm_offline_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "taichi/common/core.h"
+#include "taichi/util/metrics.h"
+
+namespace taichi {
+namespace lang {
+
+namespace {
+constexpr char kEntryExtension[] = ".tic";
+constexpr char kLockExtension[] = ".lock";
+// A lock held longer is assumed to be left behind by a process that died or
+// failed to compile, and is broken. The entry may then be compiled twice,
+// which is harmless.
+constexpr auto kLockTimeout = std::chrono::minutes(2);
+constexpr auto kLockPollInterval = std::chrono::milliseconds(10);
+}  // namespace
+
+LlvmOfflineCache::EntryLock::~EntryLock() {
+  llvm::sys::fs::remove(path_);
+}
+
+LlvmOfflineCache::LlvmOfflineCache(const std::string &path,
+                                   std::size_t max_size_bytes,
+                                   bool shared)
+    : path_(path), max_size_bytes_(max_size_bytes), shared_(shared) {
+  if (auto ec = llvm::sys::fs::create_directories(path_)) {
+    TI_WARN("Failed to create offline cache directory {}: {}", path_,
+            ec.message());
+  }
+}
+
+std::string LlvmOfflineCache::make_key(llvm::Module *module,
+                                       const std::string &salt) {
+  TI_AUTO_PROF
+  std::string bitcode;
+  {
+    llvm::raw_string_ostream sos(bitcode);
+    llvm::WriteBitcodeToFile(*module, sos);
+  }
+  return make_key(bitcode, salt);
+}
+
+std::string LlvmOfflineCache::make_key(const std::string &data,
+                                       const std::string &salt) {
+  llvm::SHA1 hasher;
+  hasher.update(data);
+  hasher.update(salt);
+  // The runtime module is embedded in every kernel module, but the compiler
+  // that produced this cache entry is part of the key as well.
+  hasher.update(get_version_string());
+  hasher.update(get_commit_hash());
+  return llvm::toHex(hasher.final(), /*LowerCase=*/true);
+}
+
+std::string LlvmOfflineCache::get_entry_path(const std::string &key) const {
+  return fmt::format("{}/{}{}", path_, key, kEntryExtension);
+}
+
+bool LlvmOfflineCache::contains(const std::string &key) {
+  std::lock_guard<std::mutex> _(mut_);
+  return llvm::sys::fs::exists(get_entry_path(key));
+}
+
+bool LlvmOfflineCache::load(const std::string &key, std::string &data) {
+  std::lock_guard<std::mutex> _(mut_);
+  const auto entry_path = get_entry_path(key);
+  static auto &hits = metrics().counter("taichi_offline_cache_hits",
+                                        "Offline cache entries loaded.");
+  static auto &misses = metrics().counter(
+      "taichi_offline_cache_misses", "Offline cache entries not found.");
+  auto buffer = llvm::MemoryBuffer::getFile(entry_path);
+  if (!buffer) {
+    misses.add();
+    return false;
+  }
+  hits.add();
+  data = (*buffer)->getBuffer().str();
+  // Refresh the modification time so that the LRU eviction keeps hot entries.
+  int fd = -1;
+  if (!llvm::sys::fs::openFileForReadWrite(entry_path, fd,
+                                           llvm::sys::fs::CD_OpenExisting,
+                                           llvm::sys::fs::OF_None)) {
+    auto now = std::chrono::system_clock::now();
+    llvm::sys::fs::setLastAccessAndModificationTime(fd, now, now);
+    llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+  }
+  TI_TRACE("Offline cache hit: {}", key);
+  return true;
+}
+
+void LlvmOfflineCache::store(const std::string &key, const std::string &data) {
+  std::lock_guard<std::mutex> _(mut_);
+  const auto entry_path = get_entry_path(key);
+  // Write to a temporary file first so that concurrent processes never observe
+  // a partially written entry.
+  const auto tmp_path =
+      fmt::format("{}.{}.tmp", entry_path, PID::get_pid());
+  {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(tmp_path, ec, llvm::sys::fs::OF_None);
+    if (ec) {
+      TI_WARN("Failed to write offline cache entry {}: {}", tmp_path,
+              ec.message());
+      return;
+    }
+    os << data;
+  }
+  if (auto ec = llvm::sys::fs::rename(tmp_path, entry_path)) {
+    TI_WARN("Failed to commit offline cache entry {}: {}", entry_path,
+            ec.message());
+    llvm::sys::fs::remove(tmp_path);
+    return;
+  }
+  evict_if_needed();
+}
+
+bool LlvmOfflineCache::load_or_lock(const std::string &key,
+                                    std::string &data,
+                                    std::unique_ptr<EntryLock> &lock) {
+  if (!shared_) {
+    return load(key, data);
+  }
+  const auto lock_path = get_entry_path(key) + kLockExtension;
+  while (true) {
+    if (load(key, data)) {
+      return true;
+    }
+    int fd = -1;
+    if (!llvm::sys::fs::openFileForWrite(lock_path, fd,
+                                         llvm::sys::fs::CD_CreateNew)) {
+      llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+      lock = std::make_unique<EntryLock>(lock_path);
+      // The entry may have been stored right before the lock was released.
+      if (load(key, data)) {
+        lock.reset();
+        return true;
+      }
+      return false;
+    }
+    llvm::sys::fs::file_status status;
+    if (!llvm::sys::fs::status(lock_path, status) &&
+        std::chrono::system_clock::now() -
+                status.getLastModificationTime() >
+            kLockTimeout) {
+      TI_WARN("Breaking the stale offline cache lock {}", lock_path);
+      llvm::sys::fs::remove(lock_path);
+      continue;
+    }
+    std::this_thread::sleep_for(kLockPollInterval);
+  }
+}
+
+void LlvmOfflineCache::evict_if_needed() {
+  if (max_size_bytes_ == 0) {
+    return;
+  }
+  struct Entry {
+    std::string path;
+    std::size_t size;
+    llvm::sys::TimePoint<> mtime;
+  };
+  std::vector<Entry> entries;
+  std::size_t total_size = 0;
+  std::error_code ec;
+  for (llvm::sys::fs::directory_iterator it(path_, ec), end;
+       it != end && !ec; it.increment(ec)) {
+    if (!llvm::StringRef(it->path()).endswith(kEntryExtension)) {
+      continue;
+    }
+    auto status = it->status();
+    if (!status) {
+      continue;
+    }
+    entries.push_back(
+        {it->path(), status->getSize(), status->getLastModificationTime()});
+    total_size += status->getSize();
+  }
+  if (total_size <= max_size_bytes_) {
+    return;
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) { return a.mtime < b.mtime; });
+  for (const auto &e : entries) {
+    if (total_size <= max_size_bytes_) {
+      break;
+    }
+    if (!llvm::sys::fs::remove(e.path)) {
+      TI_TRACE("Offline cache evicted {}", e.path);
+      total_size -= e.size;
+    }
+  }
+}
+
+}  // namespace lang
+}  // namespace taichi
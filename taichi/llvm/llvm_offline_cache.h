@@ -0,0 +1,108 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "taichi/lang_util.h"
+#include "taichi/llvm/llvm_fwd.h"
+
+namespace taichi {
+namespace lang {
+
+/**
+ * A content-addressed on-disk cache for JIT compiled LLVM modules.
+ *
+ * Each entry is a single file named after the hash of the (unoptimized) LLVM
+ * module plus a salt describing everything else that affects the generated
+ * code (arch, compiler config, runtime version, target CPU/GPU). The payload is
+ * backend-specific, e.g. an object file on CPUs and PTX on CUDA.
+ *
+ * A shared cache is used by many processes at once, e.g. the workers of a
+ * node in a directory under /dev/shm. Each missing entry is then created by a
+ * single process, while the others wait for it, see load_or_lock().
+ *
+ * Thread safe.
+ */
+class LlvmOfflineCache {
+ public:
+  /**
+   * @param path Directory to store the cached entries in. Created on demand.
+   * @param max_size_bytes Soft limit of the total size of the entries. The
+   * least recently used entries are evicted when it is exceeded. 0 means
+   * unlimited.
+   * @param shared Whether the processes creating the same entries coordinate
+   * through lock files, see CompileConfig::offline_cache_shared.
+   */
+  LlvmOfflineCache(const std::string &path,
+                   std::size_t max_size_bytes,
+                   bool shared);
+
+  /**
+   * Held by the process creating an entry of a shared cache. Removes the lock
+   * file when destroyed, normally after the entry is stored.
+   */
+  class EntryLock {
+   public:
+    explicit EntryLock(const std::string &path) : path_(path) {
+    }
+
+    ~EntryLock();
+
+   private:
+    std::string path_;
+  };
+
+  /**
+   * Computes the cache key of @param module.
+   *
+   * @param salt Extra information to be hashed together with the module.
+   */
+  static std::string make_key(llvm::Module *module, const std::string &salt);
+
+  /**
+   * Computes the cache key of a binary compiled from @param data, e.g. of a
+   * cubin compiled from PTX.
+   */
+  static std::string make_key(const std::string &data,
+                              const std::string &salt);
+
+  bool contains(const std::string &key);
+
+  bool load(const std::string &key, std::string &data);
+
+  void store(const std::string &key, const std::string &data);
+
+  /**
+   * Loads the entry @param key like load(). When it is missing from a shared
+   * cache, either waits for the process creating it, or makes the calling
+   * process that one, by setting @param lock. If the lock of another process
+   * is held for too long, e.g. because the process died, it is broken.
+   *
+   * @return Whether the entry was loaded into @param data.
+   */
+  bool load_or_lock(const std::string &key,
+                    std::string &data,
+                    std::unique_ptr<EntryLock> &lock);
+
+  const std::string &path() const {
+    return path_;
+  }
+
+  bool shared() const {
+    return shared_;
+  }
+
+ private:
+  std::string get_entry_path(const std::string &key) const;
+
+  void evict_if_needed();
+
+  std::string path_;
+  std::size_t max_size_bytes_;
+  bool shared_;
+  std::mutex mut_;
+};
+
+}  // namespace lang
+}  // namespace taichi
@@ -7,6 +7,10 @@
 #include "taichi/runtime/llvm/mem_request.h"
 #include "taichi/util/str.h"
 #include "taichi/codegen/codegen.h"
+#include "taichi/llvm/llvm_aot_module_builder.h"
+#include "taichi/program/async_engine.h"
+#include "taichi/system/device_memory_tracker.h"
+#include "taichi/system/numa.h"
 #include "taichi/ir/statements.h"
 #include "taichi/backends/cpu/cpu_device.h"
 #include "taichi/backends/cuda/cuda_device.h"
@@ -17,6 +21,11 @@
 #include "taichi/backends/cuda/cuda_driver.h"
 #include "taichi/backends/cuda/codegen_cuda.h"
 #include "taichi/backends/cuda/cuda_context.h"
+#include "taichi/backends/cuda/cuda_block_dim_tuner.h"
+#include "taichi/backends/cuda/cuda_host_read_tracker.h"
+#include "taichi/backends/cuda/cuda_pinned_memory_pool.h"
+#include "taichi/backends/cuda/cuda_print_buffer.h"
+#include "taichi/util/io.h"
 #endif
 
 namespace taichi {
@@ -26,11 +35,102 @@ void assert_failed_host(const char *msg) {
   TI_ERROR("Assertion failure: {}", msg);
 }
 
+// The LLVM contexts kept by the last program finalized with
+// CompileConfig::soft_reset, for the next program with the same key.
+struct RetainedLlvmContexts {
+  std::string key;
+  std::unique_ptr<TaichiLLVMContext> host;
+  std::unique_ptr<TaichiLLVMContext> device;
+};
+
+RetainedLlvmContexts &get_retained_llvm_contexts() {
+  // Never destroyed, as LLVM may be torn down first at exit.
+  static auto *contexts = new RetainedLlvmContexts();
+  return *contexts;
+}
+
+// The options the contexts depend on besides those they read from the config
+// of their program each time a module is added.
+std::string get_llvm_contexts_key(const CompileConfig &config) {
+  return fmt::format("{}/{}/{}/{}/{}", arch_name(config.arch),
+                     config.offline_cache, config.offline_cache_file_path,
+                     config.offline_cache_max_size_MB,
+                     config.offline_cache_shared);
+}
+
+// Hands the retained |context| over to the program of |config| if they are
+// compatible. Returns nullptr otherwise, and the context is destroyed.
+std::unique_ptr<TaichiLLVMContext> adopt_retained_llvm_context(
+    std::unique_ptr<TaichiLLVMContext> RetainedLlvmContexts::*context,
+    CompileConfig *config) {
+  auto &retained = get_retained_llvm_contexts();
+  auto adopted = std::move(retained.*context);
+  if (adopted == nullptr || !config->soft_reset ||
+      retained.key != get_llvm_contexts_key(*config)) {
+    return nullptr;
+  }
+  adopted->rebind(config);
+  return adopted;
+}
+
 void *taichi_allocate_aligned(MemoryPool *memory_pool,
                               std::size_t size,
                               std::size_t alignment) {
   return memory_pool->allocate(size, alignment);
 }
+
+#if defined(TI_WITH_CUDA)
+// Returns how many of the first |requested| devices can hold a part of the
+// SNode trees, i.e. support concurrent access to unified memory.
+int get_num_placement_devices(int requested) {
+  auto &driver = CUDADriver::get_instance();
+  const int count =
+      std::min(requested, CUDAContext::get_instance().get_device_count());
+  for (int i = 0; i < count; i++) {
+    void *device = nullptr;
+    int concurrent_managed_access = 0;
+    driver.device_get(&device, (void *)(std::size_t)i);
+    driver.device_get_attribute(&concurrent_managed_access,
+                                CU_DEVICE_ATTRIBUTE_CONCURRENT_MANAGED_ACCESS,
+                                device);
+    if (!concurrent_managed_access) {
+      return i;
+    }
+  }
+  return count;
+}
+
+// Places the dense children of |root| on |num_devices| devices, in contiguous
+// ranges along their outermost axis. The other children stay on device 0.
+std::vector<cuda::CudaDevice::MemoryPlacement> get_root_buffer_placement(
+    const SNode *root,
+    int num_devices) {
+  std::vector<cuda::CudaDevice::MemoryPlacement> placements;
+  for (const auto &ch : root->ch) {
+    if (ch->type != SNodeType::dense || ch->is_bit_level) {
+      continue;
+    }
+    int axis = 0;
+    while (axis < taichi_max_num_indices && !ch->extractors[axis].active) {
+      axis++;
+    }
+    if (axis == taichi_max_num_indices) {
+      continue;
+    }
+    const int64 num_slices = ch->extractors[axis].shape;
+    const std::size_t slice_size =
+        ch->cell_size_bytes * (ch->max_num_elements() / num_slices);
+    for (int d = 0; d < num_devices; d++) {
+      const int64 begin = num_slices * d / num_devices;
+      const int64 end = num_slices * (d + 1) / num_devices;
+      placements.push_back(
+          {ch->offset_bytes_in_parent_cell + begin * slice_size,
+           (end - begin) * slice_size, d});
+    }
+  }
+  return placements;
+}
+#endif
 }  // namespace
 
 LlvmProgramImpl::LlvmProgramImpl(CompileConfig &config_,
@@ -54,14 +154,32 @@ LlvmProgramImpl::LlvmProgramImpl(CompileConfig &config_,
       TI_WARN("Falling back to {}.", arch_name(host_arch()));
     }
   }
+#if defined(TI_WITH_CUDA)
+  if (config_.arch == Arch::cuda && config_.cuda_num_devices > 1) {
+    const int num_devices = get_num_placement_devices(config_.cuda_num_devices);
+    if (num_devices < config_.cuda_num_devices) {
+      TI_WARN(
+          "Only {} of the requested {} CUDA devices can hold SNode trees "
+          "(concurrent managed access is required).",
+          num_devices, config_.cuda_num_devices);
+      config_.cuda_num_devices = std::max(num_devices, 1);
+    }
+  }
+#endif
 
   snode_tree_buffer_manager_ = std::make_unique<SNodeTreeBufferManager>(this);
 
-  thread_pool_ = std::make_unique<ThreadPool>(config->cpu_max_num_threads);
+  thread_pool_ = std::make_unique<ThreadPool>(config->cpu_max_num_threads,
+                                              config->cpu_numa_aware);
 
   preallocated_device_buffer_ = nullptr;
   llvm_runtime_ = nullptr;
-  llvm_context_host_ = std::make_unique<TaichiLLVMContext>(host_arch());
+  llvm_context_host_ =
+      adopt_retained_llvm_context(&RetainedLlvmContexts::host, config);
+  if (llvm_context_host_ == nullptr) {
+    llvm_context_host_ =
+        std::make_unique<TaichiLLVMContext>(config, host_arch());
+  }
   if (config_.arch == Arch::cuda) {
 #if defined(TI_WITH_CUDA)
     int num_SMs;
@@ -88,12 +206,15 @@ LlvmProgramImpl::LlvmProgramImpl(CompileConfig &config_,
 
   if (arch_is_cpu(config->arch)) {
     config_.max_block_dim = 1024;
-    device_ = std::make_shared<cpu::CpuDevice>();
+    device_ = std::make_shared<cpu::CpuDevice>(config->cpu_huge_pages);
   }
 
   if (config->kernel_profiler && runtime_mem_info_) {
     runtime_mem_info_->set_profiler(profiler);
   }
+  if (config->kernel_profiler && profiler && arch_is_cpu(config->arch)) {
+    profiler->set_thread_pool(thread_pool_.get());
+  }
 #if defined(TI_WITH_CUDA)
   if (config_.arch == Arch::cuda) {
     if (config_.kernel_profiler) {
@@ -107,16 +228,25 @@ LlvmProgramImpl::LlvmProgramImpl(CompileConfig &config_,
 #endif
 }
 
+LlvmProgramImpl::~LlvmProgramImpl() = default;
+
 void LlvmProgramImpl::initialize_host() {
   // Note this cannot be placed inside LlvmProgramImpl constructor, see doc
   // string for init_runtime_jit_module() for more details.
-  llvm_context_host_->init_runtime_jit_module();
+  if (llvm_context_host_->runtime_jit_module == nullptr) {
+    llvm_context_host_->init_runtime_jit_module();
+  }
 }
 
 void LlvmProgramImpl::maybe_initialize_cuda_llvm_context() {
   if (config->arch == Arch::cuda && llvm_context_device_ == nullptr) {
-    llvm_context_device_ = std::make_unique<TaichiLLVMContext>(Arch::cuda);
-    llvm_context_device_->init_runtime_jit_module();
+    llvm_context_device_ =
+        adopt_retained_llvm_context(&RetainedLlvmContexts::device, config);
+    if (llvm_context_device_ == nullptr) {
+      llvm_context_device_ =
+          std::make_unique<TaichiLLVMContext>(config, Arch::cuda);
+      llvm_context_device_->init_runtime_jit_module();
+    }
   }
 }
 
@@ -125,29 +255,65 @@ FunctionType LlvmProgramImpl::compile(Kernel *kernel,
   if (!kernel->lowered()) {
     kernel->lower();
   }
+  if (offloaded == nullptr && config->num_compile_threads > 1) {
+    if (auto func = compile_offloads_in_parallel(kernel)) {
+      return func;
+    }
+  }
   auto codegen = KernelCodeGen::create(kernel->arch, kernel, offloaded);
   return codegen->codegen();
 }
 
+FunctionType LlvmProgramImpl::compile_offloads_in_parallel(Kernel *kernel) {
+  auto &offloads = kernel->ir->as<Block>()->statements;
+  if (offloads.size() <= 1) {
+    return nullptr;
+  }
+  if (config->arch == Arch::cuda) {
+    // Each per-task launcher transfers host external arrays on its own, which
+    // would multiply the host <-> device traffic.
+    for (const auto &arg : kernel->args) {
+      if (arg.is_external_array) {
+        return nullptr;
+      }
+    }
+  }
+  if (!compilation_workers_) {
+    compilation_workers_ = std::make_unique<ParallelExecutor>(
+        "compilation_worker", config->num_compile_threads);
+  }
+  TI_AUTO_PROF
+  std::vector<FunctionType> funcs(offloads.size());
+  for (int i = 0; i < (int)offloads.size(); i++) {
+    auto *offloaded = offloads[i]->as<OffloadedStmt>();
+    compilation_workers_->enqueue([kernel, offloaded, func = &funcs[i]]() {
+      // CodeGenLLVM works on the LLVM context of the current thread, see
+      // TaichiLLVMContext::get_this_thread_context().
+      auto codegen = KernelCodeGen::create(kernel->arch, kernel, offloaded);
+      *func = codegen->codegen();
+    });
+  }
+  compilation_workers_->flush();
+  return [funcs = std::move(funcs)](RuntimeContext &context) {
+    for (auto &func : funcs) {
+      func(context);
+    }
+  };
+}
+
 void LlvmProgramImpl::synchronize() {
   if (config->arch == Arch::cuda) {
 #if defined(TI_WITH_CUDA)
     CUDADriver::get_instance().stream_synchronize(nullptr);
+    if (cuda_print_buffer_ != nullptr) {
+      cuda_print_buffer_->flush();
+    }
 #else
     TI_ERROR("No CUDA support");
 #endif
   }
 }
 
-std::unique_ptr<llvm::Module>
-LlvmProgramImpl::clone_struct_compiler_initial_context(
-    const std::vector<std::unique_ptr<SNodeTree>> &snode_trees_,
-    TaichiLLVMContext *tlctx) {
-  if (!snode_trees_.empty())
-    return tlctx->clone_struct_module();
-  return tlctx->clone_runtime_module();
-}
-
 void LlvmProgramImpl::initialize_llvm_runtime_snodes(const SNodeTree *tree,
                                                      StructCompiler *scomp,
                                                      uint64 *result_buffer) {
@@ -172,23 +338,78 @@ void LlvmProgramImpl::initialize_llvm_runtime_snodes(const SNodeTree *tree,
   std::size_t rounded_size =
       taichi::iroundup(scomp->root_size, taichi_page_size);
 
-  Ptr root_buffer = snode_tree_buffer_manager_->allocate(
-      runtime_jit, llvm_runtime_, rounded_size, taichi_page_size, tree->id(),
-      result_buffer);
-
+  Ptr root_buffer = nullptr;
   DeviceAllocation alloc{kDeviceNullAllocation};
+  VirtualMemoryAllocator *file_backed = nullptr;
+
+  if (config->arch == Arch::cuda && config->cuda_num_devices > 1) {
+#if defined(TI_WITH_CUDA)
+    // Roots spread over the devices live outside of the memory pool of the
+    // runtime.
+    alloc = cuda_device()->allocate_memory_placed(
+        rounded_size,
+        get_root_buffer_placement(tree->root(), config->cuda_num_devices));
+    root_buffer = (Ptr)cuda_device()->get_alloc_info(alloc).ptr;
+    managed_snode_trees_.insert(tree->id());
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  } else if (config->arch == Arch::cuda && config->cuda_unified_memory) {
+#if defined(TI_WITH_CUDA)
+    alloc = cuda_device()->allocate_memory_unified(rounded_size);
+    root_buffer = (Ptr)cuda_device()->get_alloc_info(alloc).ptr;
+    managed_snode_trees_.insert(tree->id());
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  } else if (arch_is_cpu(config->arch) &&
+             !config->cpu_snode_tree_file_dir.empty()) {
+    auto vm = std::make_unique<VirtualMemoryAllocator>(
+        rounded_size, config->cpu_snode_tree_file_dir);
+    if (config->cpu_huge_pages) {
+      // Only honored by the file systems supporting huge pages, e.g. tmpfs.
+      vm->advise_huge_pages();
+    }
+    root_buffer = (Ptr)vm->ptr;
+    file_backed = vm.get();
+    file_backed_snode_trees_[tree->id()] = std::move(vm);
+  } else if (arch_is_cpu(config->arch)) {
+    // A range of its own, reserved but not committed, so that the pages are
+    // only backed once touched, and all of them are returned to the OS when
+    // the tree is destroyed. Carving the roots out of the memory pool would
+    // fragment it as trees are created and destroyed.
+    Device::AllocParams params;
+    params.size = rounded_size;
+    alloc = cpu_device()->allocate_memory(params);
+    root_buffer = (Ptr)cpu_device()->get_alloc_info(alloc).ptr;
+    managed_snode_trees_.insert(tree->id());
+  } else {
+    root_buffer = snode_tree_buffer_manager_->allocate(
+        runtime_jit, llvm_runtime_, rounded_size, taichi_page_size, tree->id(),
+        result_buffer);
+  }
 
   if (config->arch == Arch::cuda) {
 #if defined(TI_WITH_CUDA)
-    alloc = cuda_device()->import_memory(root_buffer, rounded_size);
+    if (alloc == kDeviceNullAllocation) {
+      alloc = cuda_device()->import_memory(root_buffer, rounded_size);
+    }
 #else
     TI_NOT_IMPLEMENTED
 #endif
   } else {
-    alloc = cpu_device()->import_memory(root_buffer, rounded_size);
+    if (alloc == kDeviceNullAllocation) {
+      alloc = cpu_device()->import_memory(root_buffer, rounded_size);
+    }
+    // Touching all the pages of a file would read it in whole.
+    if (config->cpu_numa_aware && !file_backed) {
+      numa_first_touch(thread_pool_.get(), root_buffer, rounded_size,
+                       config->cpu_max_num_threads);
+    }
   }
 
   snode_tree_allocs_[tree->id()] = alloc;
+  snode_tree_buffer_sizes_[tree->id()] = scomp->root_size;
 
   bool all_dense = config->demote_dense_struct_fors;
   for (int i = 0; i < (int)snodes.size(); i++) {
@@ -200,6 +421,12 @@ void LlvmProgramImpl::initialize_llvm_runtime_snodes(const SNodeTree *tree,
     }
   }
 
+  // The dense struct-fors iterate over the roots of dense trees in address
+  // order.
+  if (file_backed && all_dense) {
+    file_backed->advise_sequential();
+  }
+
   runtime_jit->call<void *, std::size_t, int, int, int, std::size_t, Ptr>(
       "runtime_initialize_snodes", llvm_runtime_, scomp->root_size, root_id,
       (int)snodes.size(), tree->id(), rounded_size, root_buffer, all_dense);
@@ -209,8 +436,9 @@ void LlvmProgramImpl::initialize_llvm_runtime_snodes(const SNodeTree *tree,
       const auto snode_id = snodes[i]->id;
       std::size_t node_size;
       auto element_size = snodes[i]->cell_size_bytes;
-      if (snodes[i]->type == SNodeType::pointer) {
-        // pointer. Allocators are for single elements
+      if (snodes[i]->type == SNodeType::pointer ||
+          snodes[i]->type == SNodeType::hash) {
+        // pointer and hash. Allocators are for single elements
         node_size = element_size;
       } else {
         // dynamic. Allocators are for the chunks
@@ -233,18 +461,19 @@ void LlvmProgramImpl::compile_snode_tree_types(
     SNodeTree *tree,
     std::vector<std::unique_ptr<SNodeTree>> &snode_trees) {
   auto *const root = tree->root();
+  // Only the new tree is compiled here. It is appended to the struct module
+  // of the previous trees, so that adding a field does not clone (and verify)
+  // the whole runtime module again.
+  auto *tlctx = get_llvm_context(config->arch);
+  auto module = tlctx->new_struct_module(
+      StructCompilerLLVM::get_called_runtime_functions());
   if (arch_is_cpu(config->arch)) {
-    auto host_module = clone_struct_compiler_initial_context(
-        snode_trees, llvm_context_host_.get());
-    struct_compiler_ = std::make_unique<StructCompilerLLVM>(
-        host_arch(), this, std::move(host_module));
-
+    struct_compiler_ = std::make_unique<StructCompilerLLVM>(host_arch(), this,
+                                                            std::move(module));
   } else {
     TI_ASSERT(config->arch == Arch::cuda);
-    auto device_module = clone_struct_compiler_initial_context(
-        snode_trees, llvm_context_device_.get());
-    struct_compiler_ = std::make_unique<StructCompilerLLVM>(
-        Arch::cuda, this, std::move(device_module));
+    struct_compiler_ = std::make_unique<StructCompilerLLVM>(Arch::cuda, this,
+                                                            std::move(module));
   }
   struct_compiler_->run(*root);
 }
@@ -257,6 +486,54 @@ void LlvmProgramImpl::materialize_snode_tree(
   initialize_llvm_runtime_snodes(tree, struct_compiler_.get(), result_buffer);
 }
 
+void LlvmProgramImpl::destroy_snode_tree(SNodeTree *snode_tree) {
+  snode_tree_buffer_sizes_.erase(snode_tree->id());
+#if defined(TI_WITH_CUDA)
+  if (cuda_host_read_tracker_ != nullptr) {
+    cuda_host_read_tracker_->forget_tree(snode_tree->id());
+  }
+#endif
+  if (file_backed_snode_trees_.erase(snode_tree->id()) > 0) {
+    return;
+  }
+  if (managed_snode_trees_.erase(snode_tree->id()) > 0) {
+    device_->dealloc_memory(snode_tree_allocs_[snode_tree->id()]);
+    return;
+  }
+  snode_tree_buffer_manager_->destroy(snode_tree);
+}
+
+void LlvmProgramImpl::write_back_snode_trees(bool wait) {
+  for (auto &[_, vm] : file_backed_snode_trees_) {
+    vm->write_back(wait);
+  }
+}
+
+std::pair<std::size_t, std::size_t> LlvmProgramImpl::get_huge_page_coverage() {
+  if (!arch_is_cpu(config->arch)) {
+    return {0, 0};
+  }
+  return cpu_device()->get_huge_page_coverage();
+}
+
+uint64 LlvmProgramImpl::fetch_return_value(int i, uint64 *result_buffer) {
+#if defined(TI_WITH_CUDA)
+  if (last_launch_was_host_read()) {
+    return CUDAHostReadTracker::get_result(i);
+  }
+#endif
+  return fetch_result_uint64(i, result_buffer);
+}
+
+bool LlvmProgramImpl::last_launch_was_host_read() {
+#if defined(TI_WITH_CUDA)
+  return cuda_host_read_tracker_ != nullptr &&
+         CUDAHostReadTracker::last_launch_was_host_read();
+#else
+  return false;
+#endif
+}
+
 uint64 LlvmProgramImpl::fetch_result_uint64(int i, uint64 *result_buffer) {
   // TODO: We are likely doing more synchronization than necessary. Simplify the
   // sync logic when we fetch the result.
@@ -291,6 +568,55 @@ std::size_t LlvmProgramImpl::get_snode_num_dynamically_allocated(
                                            result_buffer, data_list);
 }
 
+SNodeMemoryStats LlvmProgramImpl::get_snode_memory_stats(
+    SNode *snode,
+    uint64 *result_buffer) {
+  TI_ASSERT(arch_uses_llvm(config->arch));
+
+  SNodeMemoryStats stats;
+  auto node_allocator =
+      runtime_query<void *>("LLVMRuntime_get_node_allocators", result_buffer,
+                            llvm_runtime_, snode->id);
+  if (!node_allocator) {
+    return stats;
+  }
+  auto data_list = runtime_query<void *>("NodeManager_get_data_list",
+                                         result_buffer, node_allocator);
+  auto free_list = runtime_query<void *>("NodeManager_get_free_list",
+                                         result_buffer, node_allocator);
+  auto recycled_list = runtime_query<void *>("NodeManager_get_recycled_list",
+                                             result_buffer, node_allocator);
+  auto free_list_used = runtime_query<int32>("NodeManager_get_free_list_used",
+                                             result_buffer, node_allocator);
+
+  stats.element_size = runtime_query<int32>("ListManager_get_element_size",
+                                            result_buffer, data_list);
+  stats.elements_per_chunk =
+      runtime_query<int32>("ListManager_get_max_num_elements_per_chunk",
+                           result_buffer, data_list);
+  stats.num_chunks = runtime_query<int32>("ListManager_get_num_active_chunks",
+                                          result_buffer, data_list);
+  stats.num_reserved = runtime_query<int32>("ListManager_get_num_elements",
+                                            result_buffer, data_list);
+  // The free list is consumed from |free_list_used| on.
+  stats.num_free = std::max(
+      runtime_query<int32>("ListManager_get_num_elements", result_buffer,
+                           free_list) -
+          free_list_used,
+      0);
+  stats.num_recycled = runtime_query<int32>("ListManager_get_num_elements",
+                                            result_buffer, recycled_list);
+  stats.num_live = stats.num_reserved - stats.num_free - stats.num_recycled;
+  stats.allocated_bytes = (std::size_t)stats.num_chunks *
+                          stats.elements_per_chunk * stats.element_size;
+  if (stats.allocated_bytes > 0) {
+    stats.fragmentation =
+        1.0 - (double)stats.num_live * stats.element_size /
+                  stats.allocated_bytes;
+  }
+  return stats;
+}
+
 void LlvmProgramImpl::print_list_manager_info(void *list_manager,
                                               uint64 *result_buffer) {
   auto list_manager_len = runtime_query<int32>("ListManager_get_num_elements",
@@ -314,18 +640,32 @@ void LlvmProgramImpl::print_list_manager_info(void *list_manager,
       size_MB);
 }
 
+uint64 *LlvmProgramImpl::allocate_result_buffer(MemoryPool *memory_pool) {
+  const std::size_t size = sizeof(uint64) * taichi_result_buffer_entries;
+  uint64 *result_buffer = nullptr;
+  if (config->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    CUDADriver::get_instance().malloc((void **)&result_buffer, size);
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  } else {
+    result_buffer = (uint64 *)memory_pool->allocate(size, 8);
+  }
+  return result_buffer;
+}
+
 void LlvmProgramImpl::materialize_runtime(MemoryPool *memory_pool,
                                           KernelProfilerBase *profiler,
                                           uint64 **result_buffer_ptr) {
   maybe_initialize_cuda_llvm_context();
+  memory_pool_ = memory_pool;
 
   std::size_t prealloc_size = 0;
   TaichiLLVMContext *tlctx = nullptr;
   if (config->arch == Arch::cuda) {
 #if defined(TI_WITH_CUDA)
-    CUDADriver::get_instance().malloc(
-        (void **)result_buffer_ptr,
-        sizeof(uint64) * taichi_result_buffer_entries);
+    *result_buffer_ptr = allocate_result_buffer(memory_pool);
     const auto total_mem = runtime_mem_info_->get_total_memory();
     if (config->device_memory_fraction == 0) {
       TI_ASSERT(config->device_memory_GB > 0);
@@ -340,6 +680,7 @@ void LlvmProgramImpl::materialize_runtime(MemoryPool *memory_pool,
 
     Device::AllocParams preallocated_device_buffer_alloc_params;
     preallocated_device_buffer_alloc_params.size = prealloc_size;
+    DeviceMemoryTracker::Scope scope("runtime", "preallocated buffer");
     preallocated_device_buffer_alloc_ =
         cuda_device()->allocate_memory(preallocated_device_buffer_alloc_params);
     cuda::CudaDevice::AllocInfo preallocated_device_buffer_alloc_info =
@@ -353,8 +694,7 @@ void LlvmProgramImpl::materialize_runtime(MemoryPool *memory_pool,
     TI_NOT_IMPLEMENTED
 #endif
   } else {
-    *result_buffer_ptr = (uint64 *)memory_pool->allocate(
-        sizeof(uint64) * taichi_result_buffer_entries, 8);
+    *result_buffer_ptr = allocate_result_buffer(memory_pool);
     tlctx = llvm_context_host_.get();
   }
   auto *const runtime_jit = tlctx->runtime_jit_module;
@@ -422,6 +762,37 @@ void LlvmProgramImpl::materialize_runtime(MemoryPool *memory_pool,
   }
 }
 
+LLVMRuntime *LlvmProgramImpl::get_llvm_runtime(Arch arch) {
+  if (!arch_is_cpu(arch) || arch_is_cpu(config->arch)) {
+    return get_llvm_runtime();
+  }
+  std::lock_guard<std::mutex> _(host_llvm_runtime_mut_);
+  if (host_llvm_runtime_ == nullptr) {
+    // The memory pool of CUDA programs allocates host memory, see
+    // UnifiedAllocator. The host runtime has no SNode trees: it runs the
+    // kernels over ndarrays only.
+    TI_ASSERT(memory_pool_ != nullptr);
+    auto *result_buffer = (uint64 *)memory_pool_->allocate(
+        sizeof(uint64) * taichi_result_buffer_entries, 8);
+    auto *const runtime_jit = llvm_context_host_->runtime_jit_module;
+    runtime_jit->call<void *, void *, std::size_t, void *, int, int, void *,
+                      void *, void *>(
+        "runtime_initialize", result_buffer, memory_pool_, std::size_t(0),
+        (void *)nullptr, config->random_seed * 1048576,
+        config->cpu_max_num_threads, (void *)&taichi_allocate_aligned,
+        (void *)std::printf, (void *)std::vsnprintf);
+    host_llvm_runtime_ =
+        (void *)result_buffer[taichi_result_buffer_ret_value_id];
+    runtime_jit->call<void *, void *, void *>(
+        "LLVMRuntime_initialize_thread_pool", host_llvm_runtime_,
+        thread_pool_.get(), (void *)ThreadPool::static_run);
+    runtime_jit->call<void *, void *>("LLVMRuntime_set_assert_failed",
+                                      host_llvm_runtime_,
+                                      (void *)assert_failed_host);
+  }
+  return static_cast<LLVMRuntime *>(host_llvm_runtime_);
+}
+
 void LlvmProgramImpl::check_runtime_error(uint64 *result_buffer) {
   synchronize();
   auto tlctx = llvm_context_host_.get();
@@ -474,10 +845,30 @@ void LlvmProgramImpl::finalize() {
   if (runtime_mem_info_)
     runtime_mem_info_->set_profiler(nullptr);
 #if defined(TI_WITH_CUDA)
+  if (cuda_block_dim_tuner_ != nullptr) {
+    cuda_block_dim_tuner_->save();
+    cuda_block_dim_tuner_.reset();
+  }
+  cuda_print_buffer_.reset();
+  cuda_host_read_tracker_.reset();
   if (preallocated_device_buffer_ != nullptr) {
     cuda_device()->dealloc_memory(preallocated_device_buffer_alloc_);
   }
+  if (config->arch == Arch::cuda) {
+    CUDAPinnedMemoryPool::get_instance().release_cached();
+  }
 #endif
+  if (config->soft_reset) {
+    // Replaces the contexts retained by an earlier program, if any.
+    auto &retained = get_retained_llvm_contexts();
+    retained.key = get_llvm_contexts_key(*config);
+    retained.host = std::move(llvm_context_host_);
+    retained.host->rebind(nullptr);
+    retained.device = std::move(llvm_context_device_);
+    if (retained.device != nullptr) {
+      retained.device->rebind(nullptr);
+    }
+  }
 }
 
 void LlvmProgramImpl::print_memory_profiler_info(
@@ -564,11 +955,128 @@ cpu::CpuDevice *LlvmProgramImpl::cpu_device() {
   return static_cast<cpu::CpuDevice *>(device_.get());
 }
 
+std::unique_ptr<AotModuleBuilder> LlvmProgramImpl::make_aot_module_builder() {
+  TI_ERROR_IF(!arch_is_cpu(config->arch) && config->arch != Arch::cuda,
+              "AOT is not supported on {}", arch_name(config->arch));
+  return std::make_unique<LlvmAotModuleBuilder>(this);
+}
+
 DevicePtr LlvmProgramImpl::get_snode_tree_device_ptr(int tree_id) {
   DeviceAllocation tree_alloc = snode_tree_allocs_[tree_id];
   return tree_alloc.get_ptr();
 }
 
+std::size_t LlvmProgramImpl::get_snode_tree_buffer_size(int tree_id) {
+  auto it = snode_tree_buffer_sizes_.find(tree_id);
+  return it == snode_tree_buffer_sizes_.end() ? 0 : it->second;
+}
+
+Ptr LlvmProgramImpl::get_snode_tree_root_ptr(int tree_id) {
+  const auto &alloc = snode_tree_allocs_.at(tree_id);
+  if (config->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    return (Ptr)cuda_device()->get_alloc_info(alloc).ptr;
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  }
+  return (Ptr)cpu_device()->get_alloc_info(alloc).ptr;
+}
+
+void LlvmProgramImpl::prefetch_snode_to_device(const SNode *snode) {
+#if defined(TI_WITH_CUDA)
+  if (!config->cuda_unified_memory || config->cuda_num_devices > 1) {
+    return;
+  }
+  const int tree_id = snode->get_snode_tree_id();
+  if (managed_snode_trees_.count(tree_id) == 0) {
+    return;
+  }
+  // The cells of a dense child of the root are contiguous in the root buffer.
+  // The deeper sparse SNodes live in the memory pool of the runtime.
+  while (snode->parent && snode->parent->type != SNodeType::root) {
+    snode = snode->parent;
+  }
+  if (snode->type != SNodeType::dense) {
+    return;
+  }
+  const std::size_t size = snode->cell_size_bytes * snode->max_num_elements();
+  auto &driver = CUDADriver::get_instance();
+  std::size_t free_bytes = 0, total_bytes = 0;
+  driver.mem_get_info(&free_bytes, &total_bytes);
+  // Prefetching a range that does not fit would evict its own beginning.
+  // Such ranges are migrated on demand, or accessed over the bus.
+  if (size > total_bytes / 2) {
+    return;
+  }
+  driver.mem_prefetch_async(
+      get_snode_tree_root_ptr(tree_id) + snode->offset_bytes_in_parent_cell,
+      size, 0, CUDAContext::get_instance().get_stream());
+#endif
+}
+
+void *LlvmProgramImpl::get_snode_tree_host_ptr(int tree_id) {
+  if (config->arch == Arch::cuda) {
+    return nullptr;
+  }
+  return get_snode_tree_root_ptr(tree_id);
+}
+
+void LlvmProgramImpl::read_snode_tree_buffer(int tree_id,
+                                             std::size_t offset,
+                                             void *dst,
+                                             std::size_t size) {
+  auto *root = get_snode_tree_root_ptr(tree_id);
+  if (config->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    auto _ = CUDAContext::get_instance().get_guard();
+    cuda_memcpy_device_to_host_staged(dst, root + offset, size);
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  } else {
+    std::memcpy(dst, root + offset, size);
+  }
+}
+
+void LlvmProgramImpl::write_snode_tree_buffer(int tree_id,
+                                              std::size_t offset,
+                                              const void *src,
+                                              std::size_t size) {
+  auto *root = get_snode_tree_root_ptr(tree_id);
+  if (config->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    auto _ = CUDAContext::get_instance().get_guard();
+    auto &driver = CUDADriver::get_instance();
+    // Pinning the source lets the copy engine read it directly, e.g. from a
+    // memory-mapped file, instead of through a staging buffer of the driver.
+    // Small copies are not worth the pinning, and the staged copy is the
+    // fallback if the driver can not pin the memory.
+    constexpr std::size_t kMinPinnedSize = 4 << 20;
+    const uint64 begin = (uint64)src / taichi_page_size * taichi_page_size;
+    const uint64 end = iroundup((uint64)src + size, (uint64)taichi_page_size);
+    const bool pinned =
+        size >= kMinPinnedSize &&
+        driver.mem_host_register.call((void *)begin, end - begin,
+                                      CU_MEMHOSTREGISTER_READ_ONLY) == 0;
+    if (pinned) {
+      driver.memcpy_host_to_device(root + offset, const_cast<void *>(src),
+                                   size);
+      driver.mem_host_unregister((void *)begin);
+    } else {
+      cuda_memcpy_host_to_device_staged(root + offset, src, size);
+    }
+    if (auto *tracker = get_cuda_host_read_tracker()) {
+      tracker->record_writes({tree_id});
+    }
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  } else {
+    std::memcpy(root + offset, src, size);
+  }
+}
+
 DeviceAllocation LlvmProgramImpl::allocate_memory_ndarray(
     std::size_t alloc_size,
     uint64 *result_buffer) {
@@ -579,6 +1087,12 @@ DeviceAllocation LlvmProgramImpl::allocate_memory_ndarray(
     tlctx = llvm_context_host_.get();
   }
 
+  if (config->arch == Arch::cuda && config->cpu_gpu_co_execution) {
+    // In unified memory, so that the CPU can run a part of the kernels too.
+    return get_compute_device()->allocate_memory(
+        {alloc_size, /*host_write=*/true, /*host_read=*/true,
+         /*export_sharing=*/false, AllocUsage::Storage});
+  }
   return get_compute_device()->allocate_memory_runtime(
       {{alloc_size, /*host_write=*/false, /*host_read=*/false,
         /*export_sharing=*/false, AllocUsage::Storage},
@@ -588,10 +1102,98 @@ DeviceAllocation LlvmProgramImpl::allocate_memory_ndarray(
        result_buffer});
 }
 
+DeviceAllocation LlvmProgramImpl::import_memory_ndarray(void *ptr,
+                                                        std::size_t size) {
+  if (config->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    return cuda_device()->import_memory(ptr, size);
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  } else {
+    return cpu_device()->import_memory(ptr, size);
+  }
+}
+
+cuda::CachingAllocatorStats LlvmProgramImpl::get_caching_allocator_stats() {
+#if defined(TI_WITH_CUDA)
+  if (config->arch == Arch::cuda) {
+    return cuda_device()->get_caching_allocator_stats();
+  }
+#endif
+  return {};
+}
+
 std::shared_ptr<Device> LlvmProgramImpl::get_device_shared() {
   return device_;
 }
 
+CUDABlockDimTuner *LlvmProgramImpl::get_cuda_block_dim_tuner() {
+#if defined(TI_WITH_CUDA)
+  if (config->arch != Arch::cuda || !config->cuda_tune_block_dim) {
+    return nullptr;
+  }
+  if (!cuda_block_dim_tuner_) {
+    std::string cache_file;
+    if (config->offline_cache) {
+      auto path = config->offline_cache_file_path;
+      if (path.empty()) {
+        path = get_repo_dir() + "ticache/llvm";
+      }
+      path = fmt::format("{}/{}", path, arch_name(Arch::cuda));
+      create_directories(path);
+      cache_file = fmt::format(
+          "{}/block_dims_sm{}.txt", path,
+          CUDAContext::get_instance().get_compute_capability());
+    }
+    cuda_block_dim_tuner_ = std::make_shared<CUDABlockDimTuner>(
+        Program::default_block_dim(*config), config->max_block_dim, cache_file);
+  }
+  return cuda_block_dim_tuner_.get();
+#else
+  return nullptr;
+#endif
+}
+
+CUDAHostReadTracker *LlvmProgramImpl::get_cuda_host_read_tracker() {
+#if defined(TI_WITH_CUDA)
+  if (config->arch != Arch::cuda || !config->cuda_fine_grained_host_sync) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> _(cuda_host_read_tracker_mut_);
+  if (!cuda_host_read_tracker_) {
+    auto _ = CUDAContext::get_instance().get_guard();
+    cuda_host_read_tracker_ = std::make_shared<CUDAHostReadTracker>();
+  }
+  return cuda_host_read_tracker_.get();
+#else
+  return nullptr;
+#endif
+}
+
+CUDAPrintBuffer *LlvmProgramImpl::get_cuda_print_buffer() {
+#if defined(TI_WITH_CUDA)
+  if (config->arch != Arch::cuda || config->cuda_print_buffer_MB <= 0) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> _(cuda_print_buffer_mut_);
+  if (!cuda_print_buffer_) {
+    cuda_print_buffer_ = std::make_shared<CUDAPrintBuffer>(
+        (std::size_t)config->cuda_print_buffer_MB << 20);
+    auto *runtime_jit = llvm_context_device_->runtime_jit_module;
+    runtime_jit->call<void *, void *>("LLVMRuntime_set_print_buffer",
+                                      llvm_runtime_,
+                                      cuda_print_buffer_->get_buffer());
+    runtime_jit->call<void *, uint64>(
+        "LLVMRuntime_set_print_buffer_capacity", llvm_runtime_,
+        (uint64)cuda_print_buffer_->get_capacity());
+  }
+  return cuda_print_buffer_.get();
+#else
+  return nullptr;
+#endif
+}
+
 uint64_t *LlvmProgramImpl::get_ndarray_alloc_info_ptr(DeviceAllocation &alloc) {
   if (config->arch == Arch::cuda) {
 #if defined(TI_WITH_CUDA)
@@ -603,5 +1205,216 @@ uint64_t *LlvmProgramImpl::get_ndarray_alloc_info_ptr(DeviceAllocation &alloc) {
     return (uint64_t *)cpu_device()->get_alloc_info(alloc).ptr;
   }
 }
+
+bool LlvmProgramImpl::has_dense_field_layout(const SNode *snode,
+                                             std::string *reason) {
+  auto fail = [&](const std::string &why) {
+    if (reason) {
+      *reason = why;
+    }
+    return false;
+  };
+  if (snode->type != SNodeType::place) {
+    return fail("it is not a place SNode");
+  }
+  std::vector<bool> axis_taken(taichi_max_num_indices, false);
+  for (auto *s = snode->parent; s->type != SNodeType::root; s = s->parent) {
+    if (s->type != SNodeType::dense) {
+      return fail(
+          fmt::format("{} is not dense", s->get_node_type_name_hinted()));
+    }
+    if (s->_morton) {
+      return fail(fmt::format("{} is in the Morton order",
+                              s->get_node_type_name_hinted()));
+    }
+    for (int i = 0; i < taichi_max_num_indices; i++) {
+      if (!s->extractors[i].active) {
+        continue;
+      }
+      // An axis split over several SNodes is not strided.
+      if (axis_taken[i]) {
+        return fail(fmt::format("axis {} is split over multiple SNodes", i));
+      }
+      axis_taken[i] = true;
+    }
+  }
+  return true;
+}
+
+DenseFieldLayout LlvmProgramImpl::get_dense_field_layout(SNode *snode) {
+  std::string reason;
+  TI_ERROR_IF(!has_dense_field_layout(snode, &reason),
+              "{} can't be viewed as an array: {}",
+              snode->get_node_type_name_hinted(), reason);
+  const int num_indices = snode->num_active_indices;
+  DenseFieldLayout layout;
+  layout.shape.resize(num_indices);
+  layout.strides.assign(num_indices, 0);
+  int64 offset = snode->offset_bytes_in_parent_cell;
+  SNode *s = snode->parent;
+  for (; s->type != SNodeType::root; s = s->parent) {
+    offset += s->offset_bytes_in_parent_cell;
+    for (int k = 0; k < num_indices; k++) {
+      const int i = snode->physical_index_position[k];
+      if (s->extractors[i].active) {
+        layout.strides[k] =
+            (int64)s->cell_size_bytes * s->extractors[i].acc_shape;
+      }
+    }
+  }
+  for (int k = 0; k < num_indices; k++) {
+    layout.shape[k] = snode->shape_along_axis(k);
+  }
+  DeviceAllocation tree_alloc = snode_tree_allocs_[s->get_snode_tree_id()];
+  layout.data_ptr =
+      (intptr_t)get_ndarray_alloc_info_ptr(tree_alloc) + (intptr_t)offset;
+  return layout;
+}
+
+std::optional<std::pair<Ptr, std::size_t>>
+LlvmProgramImpl::get_contiguous_elements(SNode *snode) {
+  // The kernels launched asynchronously are not ordered with the memsets.
+  if (config->async_mode || !has_dense_field_layout(snode) ||
+      !snode->dt->is<PrimitiveType>()) {
+    return std::nullopt;
+  }
+  auto layout = get_dense_field_layout(snode);
+  std::vector<std::pair<int64, int>> axes;
+  for (int k = 0; k < (int)layout.shape.size(); k++) {
+    if (layout.shape[k] > 1) {
+      axes.emplace_back(layout.strides[k], layout.shape[k]);
+    }
+  }
+  // Whatever the order of the axes, the elements are contiguous if each
+  // stride is the extent of the smaller ones.
+  std::sort(axes.begin(), axes.end());
+  int64 size = data_type_size(snode->dt);
+  for (auto &[stride, extent] : axes) {
+    if (stride != size) {
+      return std::nullopt;
+    }
+    size *= extent;
+  }
+  return std::make_pair((Ptr)layout.data_ptr, (std::size_t)size);
+}
+
+std::vector<int> LlvmProgramImpl::fill_dense_fields(
+    const std::vector<SNode *> &snodes,
+    uint64 bits) {
+  // A run of |width|-byte words.
+  struct Fill {
+    Ptr begin;
+    std::size_t size;
+    int width;
+    uint64 word;
+  };
+  auto low_bytes = [](uint64 word, int width) {
+    return width == 8 ? word : word & ((1ULL << (width * 8)) - 1);
+  };
+  std::vector<int> left;
+  std::vector<Fill> fills;
+  std::unordered_set<int> trees;
+  for (int i = 0; i < (int)snodes.size(); i++) {
+    auto range = get_contiguous_elements(snodes[i]);
+    int width = data_type_size(snodes[i]->dt);
+    uint64 word = low_bytes(bits, width);
+    // Narrows the word while its halves are equal, e.g. down to a byte for
+    // zero, so that the fills of different types may merge.
+    while (width > 1 && low_bytes(word, width / 2) == word >> (width * 4)) {
+      width /= 2;
+      word = low_bytes(word, width);
+    }
+    if (!range || (config->arch == Arch::cuda && width > 4)) {
+      left.push_back(i);
+      continue;
+    }
+    fills.push_back({range->first, range->second, width, word});
+    trees.insert(snodes[i]->get_snode_tree_id());
+  }
+  std::sort(fills.begin(), fills.end(), [](const Fill &a, const Fill &b) {
+    return a.begin < b.begin;
+  });
+  std::vector<Fill> merged;
+  for (auto &fill : fills) {
+    Fill *last = merged.empty() ? nullptr : &merged.back();
+    if (last && last->begin + last->size == fill.begin &&
+        last->width == fill.width && last->word == fill.word) {
+      last->size += fill.size;
+    } else {
+      merged.push_back(fill);
+    }
+  }
+
+  if (config->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    auto _ = CUDAContext::get_instance().get_guard();
+    auto &driver = CUDADriver::get_instance();
+    void *stream = CUDAContext::get_instance().get_stream();
+    for (auto &fill : merged) {
+      const std::size_t n = fill.size / fill.width;
+      if (fill.width == 1) {
+        driver.memset_d8_async(fill.begin, (uint8)fill.word, n, stream);
+      } else if (fill.width == 2) {
+        driver.memset_d16_async(fill.begin, (uint16)fill.word, n, stream);
+      } else {
+        driver.memset_d32_async(fill.begin, (uint32)fill.word, n, stream);
+      }
+    }
+    if (auto *tracker = get_cuda_host_read_tracker()) {
+      tracker->record_writes(trees);
+    }
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  } else {
+    for (auto &fill : merged) {
+      const std::size_t n = fill.size / fill.width;
+      if (fill.width == 1) {
+        std::memset(fill.begin, (int)fill.word, n);
+      } else if (fill.width == 2) {
+        std::fill_n((uint16 *)fill.begin, n, (uint16)fill.word);
+      } else if (fill.width == 4) {
+        std::fill_n((uint32 *)fill.begin, n, (uint32)fill.word);
+      } else {
+        std::fill_n((uint64 *)fill.begin, n, fill.word);
+      }
+    }
+  }
+  return left;
+}
+
+bool LlvmProgramImpl::copy_dense_field(SNode *dst, SNode *src) {
+  if (dst->dt != src->dt || dst->index_offsets != src->index_offsets) {
+    return false;
+  }
+  auto dst_range = get_contiguous_elements(dst);
+  auto src_range = get_contiguous_elements(src);
+  if (!dst_range || !src_range) {
+    return false;
+  }
+  // The same element at the same offset in both ranges.
+  auto dst_layout = get_dense_field_layout(dst);
+  auto src_layout = get_dense_field_layout(src);
+  if (dst_layout.shape != src_layout.shape ||
+      dst_layout.strides != src_layout.strides) {
+    return false;
+  }
+  if (config->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    auto _ = CUDAContext::get_instance().get_guard();
+    CUDADriver::get_instance().memcpy_device_to_device_async(
+        dst_range->first, src_range->first, dst_range->second,
+        CUDAContext::get_instance().get_stream());
+    if (auto *tracker = get_cuda_host_read_tracker()) {
+      tracker->record_writes({dst->get_snode_tree_id()});
+    }
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  } else {
+    std::memmove(dst_range->first, src_range->first, dst_range->second);
+  }
+  return true;
+}
 }  // namespace lang
 }  // namespace taichi
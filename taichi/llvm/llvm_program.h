@@ -6,21 +6,31 @@
 #include "taichi/llvm/llvm_context.h"
 #include "taichi/runtime/runtime.h"
 #include "taichi/system/threading.h"
+#include "taichi/system/virtual_memory.h"
 #include "llvm/IR/Module.h"
 #include "taichi/struct/struct.h"
 #include "taichi/struct/struct_llvm.h"
 #include "taichi/program/snode_expr_utils.h"
 #include "taichi/system/memory_pool.h"
 #include "taichi/program/program_impl.h"
+#include "taichi/program/snode_memory_stats.h"
+#include "taichi/backends/cuda/cuda_caching_allocator.h"
 #define TI_RUNTIME_HOST
 #include "taichi/program/context.h"
 #undef TI_RUNTIME_HOST
 
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_set>
 
 namespace taichi {
 namespace lang {
 class StructCompiler;
+class ParallelExecutor;
+class CUDABlockDimTuner;
+class CUDAPrintBuffer;
+class CUDAHostReadTracker;
 
 namespace cuda {
 class CudaDevice;
@@ -30,10 +40,23 @@ namespace cpu {
 class CpuDevice;
 }
 
+/**
+ * The elements of a field as a strided array, see
+ * LlvmProgramImpl::get_dense_field_layout().
+ */
+struct DenseFieldLayout {
+  intptr_t data_ptr{0};
+  std::vector<int> shape;
+  // In bytes.
+  std::vector<int64> strides;
+};
+
 class LlvmProgramImpl : public ProgramImpl {
  public:
   LlvmProgramImpl(CompileConfig &config, KernelProfilerBase *profiler);
 
+  ~LlvmProgramImpl() override;
+
   void initialize_host();
 
   /**
@@ -55,8 +78,23 @@ class LlvmProgramImpl : public ProgramImpl {
     return static_cast<LLVMRuntime *>(llvm_runtime_);
   }
 
+  /**
+   * Returns the runtime of the kernels compiled for |arch|. On CUDA, the
+   * kernels compiled for the host CPU (see CoExecutedRangeFor) run on a
+   * separate runtime in host memory, which is initialized on demand.
+   */
+  LLVMRuntime *get_llvm_runtime(Arch arch);
+
   FunctionType compile(Kernel *kernel, OffloadedStmt *offloaded) override;
 
+  /**
+   * Generates code for each offloaded task of @param kernel on
+   * |compilation_workers_|, and returns a function launching them in order.
+   *
+   * @return nullptr if @param kernel is not worth compiling in parallel.
+   */
+  FunctionType compile_offloads_in_parallel(Kernel *kernel);
+
   void compile_snode_tree_types(
       SNodeTree *tree,
       std::vector<std::unique_ptr<SNodeTree>> &snode_trees) override;
@@ -72,6 +110,18 @@ class LlvmProgramImpl : public ProgramImpl {
         fetch_result_uint64(i, result_buffer));
   }
 
+  // Reads the return values of the last launch of the calling thread, which
+  // wrote them into |result_buffer| unless it was a host read.
+  uint64 fetch_return_value(int i, uint64 *result_buffer);
+
+  bool last_launch_was_host_read() override;
+
+  /**
+   * Allocates a buffer for the return values of the kernels, in device memory
+   * on CUDA.
+   */
+  uint64 *allocate_result_buffer(MemoryPool *memory_pool);
+
   /**
    * Initializes the runtime system for LLVM based backends.
    */
@@ -83,14 +133,18 @@ class LlvmProgramImpl : public ProgramImpl {
       SNode *snode,
       uint64 *result_buffer) override;
 
-  void destroy_snode_tree(SNodeTree *snode_tree) override {
-    snode_tree_buffer_manager_->destroy(snode_tree);
-  }
+  void destroy_snode_tree(SNodeTree *snode_tree) override;
 
   void print_memory_profiler_info(
       std::vector<std::unique_ptr<SNodeTree>> &snode_trees_,
       uint64 *result_buffer);
 
+  /**
+   * Reads the node allocator of @param snode. All zeros if the SNode is
+   * statically allocated.
+   */
+  SNodeMemoryStats get_snode_memory_stats(SNode *snode, uint64 *result_buffer);
+
   void synchronize() override;
 
   void check_runtime_error(uint64 *result_buffer);
@@ -100,15 +154,90 @@ class LlvmProgramImpl : public ProgramImpl {
   DeviceAllocation allocate_memory_ndarray(std::size_t alloc_size,
                                            uint64 *result_buffer) override;
 
+  DeviceAllocation import_memory_ndarray(void *ptr, std::size_t size) override;
+
   uint64_t *get_ndarray_alloc_info_ptr(DeviceAllocation &alloc);
 
+  /**
+   * Describes where the elements of a place SNode are, if its ancestors are
+   * all dense and each axis is only split by one of them. The data pointer is
+   * a host address on the CPU backends, and a device address on CUDA.
+   */
+  DenseFieldLayout get_dense_field_layout(SNode *snode);
+
+  /**
+   * Tests if get_dense_field_layout() supports |snode|. If not, |reason| is
+   * set to why, unless it is null.
+   */
+  static bool has_dense_field_layout(const SNode *snode,
+                                     std::string *reason = nullptr);
+
+  /**
+   * Fills the elements of the place SNodes |snodes| with the low bytes of
+   * |bits|, as many as the size of their data types, by memsets on the stream
+   * of the calling thread instead of a kernel. The fills of adjacent SNodes
+   * are merged, e.g. when clearing the gradients.
+   *
+   * Only the SNodes whose elements fill a range of the root buffer by
+   * themselves are filled. On CUDA, the pattern must also repeat every 4
+   * bytes.
+   *
+   * @return The positions in |snodes| of the SNodes left to a kernel.
+   */
+  std::vector<int> fill_dense_fields(const std::vector<SNode *> &snodes,
+                                     uint64 bits);
+
+  /**
+   * Copies the elements of the place SNode |src| into |dst| by a memcpy on the
+   * stream of the calling thread, if both have the same data type and the
+   * same layout, and their elements fill a range of the root buffer by
+   * themselves.
+   *
+   * @return false, doing nothing, otherwise.
+   */
+  bool copy_dense_field(SNode *dst, SNode *src);
+
+  /**
+   * Statistics of the caching allocator backing ndarrays on CUDA. All zeros on
+   * the other archs.
+   */
+  cuda::CachingAllocatorStats get_caching_allocator_stats();
+
   std::shared_ptr<Device> get_device_shared() override;
 
- private:
-  std::unique_ptr<llvm::Module> clone_struct_compiler_initial_context(
-      const std::vector<std::unique_ptr<SNodeTree>> &snode_trees_,
-      TaichiLLVMContext *tlctx);
+  /**
+   * The tuner of the block sizes of the CUDA range-for tasks, created on
+   * first use.
+   *
+   * @return nullptr unless CompileConfig::cuda_tune_block_dim is set on CUDA.
+   */
+  CUDABlockDimTuner *get_cuda_block_dim_tuner();
+
+  /**
+   * The ring buffer the CUDA kernels print into, created on first use.
+   *
+   * @return nullptr unless CompileConfig::cuda_print_buffer_MB is set on CUDA.
+   */
+  CUDAPrintBuffer *get_cuda_print_buffer();
+
+  /**
+   * The last writers of the SNode trees, which the kernels reading the trees
+   * into host memory wait for, created on first use.
+   *
+   * @return nullptr unless CompileConfig::cuda_fine_grained_host_sync is set
+   * on CUDA.
+   */
+  CUDAHostReadTracker *get_cuda_host_read_tracker();
+
+  /**
+   * Migrates the part of the root buffer holding |snode| to the device ahead
+   * of a struct-for over it, on the stream of the calling thread. Does nothing
+   * unless the tree lives in unified memory, see
+   * CompileConfig::cuda_unified_memory.
+   */
+  void prefetch_snode_to_device(const SNode *snode);
 
+ private:
   /**
    * Initializes the SNodes for LLVM based backends.
    */
@@ -138,29 +267,81 @@ class LlvmProgramImpl : public ProgramImpl {
 
   void print_list_manager_info(void *list_manager, uint64 *result_buffer);
 
-  std::unique_ptr<AotModuleBuilder> make_aot_module_builder() override {
-    TI_NOT_IMPLEMENTED;
-  }
+  std::unique_ptr<AotModuleBuilder> make_aot_module_builder() override;
 
   Device *get_compute_device() override {
     return device_.get();
   }
 
+  ThreadPool *get_thread_pool() {
+    return thread_pool_.get();
+  }
+
   DevicePtr get_snode_tree_device_ptr(int tree_id) override;
 
+  std::size_t get_snode_tree_buffer_size(int tree_id) override;
+
+  void *get_snode_tree_host_ptr(int tree_id) override;
+
+  void read_snode_tree_buffer(int tree_id,
+                              std::size_t offset,
+                              void *dst,
+                              std::size_t size) override;
+
+  void write_snode_tree_buffer(int tree_id,
+                               std::size_t offset,
+                               const void *src,
+                               std::size_t size) override;
+
+  void write_back_snode_trees(bool wait) override;
+
+  std::pair<std::size_t, std::size_t> get_huge_page_coverage() override;
+
  private:
+  Ptr get_snode_tree_root_ptr(int tree_id);
+
+  // The address and the size of the range of the root buffer holding the
+  // elements of the place SNode |snode| and nothing else, if any.
+  std::optional<std::pair<Ptr, std::size_t>> get_contiguous_elements(
+      SNode *snode);
+
   std::unique_ptr<TaichiLLVMContext> llvm_context_host_{nullptr};
   std::unique_ptr<TaichiLLVMContext> llvm_context_device_{nullptr};
   std::unique_ptr<ThreadPool> thread_pool_{nullptr};
+  // Created on demand, see CompileConfig::num_compile_threads.
+  std::unique_ptr<ParallelExecutor> compilation_workers_{nullptr};
   std::unique_ptr<Runtime> runtime_mem_info_{nullptr};
   std::unique_ptr<SNodeTreeBufferManager> snode_tree_buffer_manager_{nullptr};
   std::unique_ptr<StructCompiler> struct_compiler_{nullptr};
+  // See get_cuda_block_dim_tuner(). Only created in the builds with CUDA.
+  std::shared_ptr<CUDABlockDimTuner> cuda_block_dim_tuner_{nullptr};
+  // See get_cuda_print_buffer(). Only created in the builds with CUDA.
+  std::shared_ptr<CUDAPrintBuffer> cuda_print_buffer_{nullptr};
+  // The kernels may be compiled in parallel.
+  std::mutex cuda_print_buffer_mut_;
+  // See get_cuda_host_read_tracker(). Only created in the builds with CUDA.
+  std::shared_ptr<CUDAHostReadTracker> cuda_host_read_tracker_{nullptr};
+  std::mutex cuda_host_read_tracker_mut_;
   void *llvm_runtime_{nullptr};
+  // See get_llvm_runtime(Arch). Only created on CUDA.
+  void *host_llvm_runtime_{nullptr};
+  std::mutex host_llvm_runtime_mut_;
+  MemoryPool *memory_pool_{nullptr};
   void *preallocated_device_buffer_{nullptr};  // TODO: move to memory allocator
 
   DeviceAllocation preallocated_device_buffer_alloc_{kDeviceNullAllocation};
 
   std::unordered_map<int, DeviceAllocation> snode_tree_allocs_;
+  // The root sizes of the trees, i.e. the part of the allocations in use.
+  std::unordered_map<int, std::size_t> snode_tree_buffer_sizes_;
+  // The trees whose roots are allocated by the device outside of the memory
+  // pool: in virtual memory on the CPUs, and in unified memory on CUDA (see
+  // CompileConfig::cuda_num_devices and cuda_unified_memory).
+  std::unordered_set<int> managed_snode_trees_;
+  // The trees whose roots are mapped files on the CPUs, see
+  // CompileConfig::cpu_snode_tree_file_dir.
+  std::unordered_map<int, std::unique_ptr<VirtualMemoryAllocator>>
+      file_backed_snode_trees_;
 
   std::shared_ptr<Device> device_{nullptr};
   cuda::CudaDevice *cuda_device();
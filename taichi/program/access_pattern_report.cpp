@@ -0,0 +1,119 @@
+#include "taichi/program/access_pattern_report.h"
+
+#include <algorithm>
+
+#include "taichi/ir/snode.h"
+#include "taichi/ir/statements.h"
+#include "taichi/program/kernel.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+using irpass::analysis::GlobalAccessPattern;
+
+std::string field_name(const SNode *snode) {
+  if (snode->name.empty()) {
+    return snode->get_node_type_name_hinted();
+  }
+  return fmt::format("{} ({})", snode->name,
+                     snode->get_node_type_name_hinted());
+}
+
+std::string kind_name(GlobalAccessPattern::Kind kind) {
+  switch (kind) {
+    case GlobalAccessPattern::Kind::coalesced:
+      return "coalesced";
+    case GlobalAccessPattern::Kind::strided:
+      return "strided";
+    default:
+      return "random";
+  }
+}
+
+}  // namespace
+
+void AccessPatternReport::record_tasks(const Kernel *kernel, IRNode *root) {
+  std::vector<TaskRecord> tasks;
+  auto record_task = [&](IRNode *task) {
+    auto patterns = irpass::analysis::gather_access_patterns(task);
+    if (!patterns.empty()) {
+      tasks.push_back(
+          {OffloadedStmt::task_type_name(task->as<OffloadedStmt>()->task_type),
+           std::move(patterns)});
+    }
+  };
+  if (auto block = root->cast<Block>()) {
+    for (auto &stmt : block->statements) {
+      record_task(stmt.get());
+    }
+  } else {
+    record_task(root);
+  }
+  std::lock_guard<std::mutex> _(mut_);
+  auto &record = kernels_[kernel];
+  record.name = kernel->get_name();
+  for (auto &task : tasks) {
+    record.tasks.push_back(std::move(task));
+  }
+}
+
+void AccessPatternReport::record_launch(const Kernel *kernel) {
+  std::lock_guard<std::mutex> _(mut_);
+  if (auto it = kernels_.find(kernel); it != kernels_.end()) {
+    it->second.launches++;
+  }
+}
+
+std::vector<std::string> AccessPatternReport::get_report() {
+  std::lock_guard<std::mutex> _(mut_);
+  struct Entry {
+    std::string name;
+    float64 waste;
+    std::vector<std::string> lines;
+  };
+  std::vector<Entry> entries;
+  for (auto &[kernel, record] : kernels_) {
+    if (record.launches == 0 || record.tasks.empty()) {
+      continue;
+    }
+    Entry entry{record.name, 0, {}};
+    for (int i = 0; i < (int)record.tasks.size(); i++) {
+      auto &task = record.tasks[i];
+      for (auto &p : task.patterns) {
+        entry.waste += (p.bytes_per_useful_byte - 1) * record.launches;
+        entry.lines.push_back(fmt::format(
+            "{} (task {}, {}, {} launches): {} {}, {:.1f} bytes per useful "
+            "byte",
+            record.name, i, task.type, record.launches, field_name(p.snode),
+            kind_name(p.kind), p.bytes_per_useful_byte));
+      }
+    }
+    entries.push_back(std::move(entry));
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) {
+              return a.waste != b.waste ? a.waste > b.waste : a.name < b.name;
+            });
+  std::vector<std::string> result;
+  for (auto &entry : entries) {
+    for (auto &line : entry.lines) {
+      result.push_back(std::move(line));
+    }
+  }
+  return result;
+}
+
+void AccessPatternReport::print() {
+  const auto report = get_report();
+  fmt::print("{:=^80}\n", " Access Pattern Report ");
+  if (report.empty()) {
+    fmt::print("No parallel accesses to dense fields.\n");
+  }
+  for (auto &line : report) {
+    fmt::print("* {}\n", line);
+  }
+  fmt::print("{:=^80}\n", "");
+}
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "taichi/common/core.h"
+#include "taichi/ir/analysis.h"
+
+TLANG_NAMESPACE_BEGIN
+
+class IRNode;
+class Kernel;
+
+/**
+ * Reports how the parallel tasks of each kernel access the fields: coalesced,
+ * strided or random, along with the estimated bytes moved from memory per
+ * byte used. Enabled by CompileConfig::access_pattern_report.
+ *
+ * The estimate is static, based on the linearized layout of the fields and on
+ * how the indices depend on the loop index that differs between neighboring
+ * threads. The kernels wasting the most bandwidth are listed first.
+ */
+class AccessPatternReport {
+ public:
+  /**
+   * Records the access patterns of the tasks in @param root, which belong to
+   * @param kernel. In the async mode, the tasks are recorded one by one.
+   *
+   * @param root The offloaded IR, before the global pointers are lowered.
+   */
+  void record_tasks(const Kernel *kernel, IRNode *root);
+
+  void record_launch(const Kernel *kernel);
+
+  // One line per access pattern of a task, grouped by kernel.
+  std::vector<std::string> get_report();
+
+  void print();
+
+ private:
+  struct TaskRecord {
+    std::string type;
+    std::vector<irpass::analysis::GlobalAccessPattern> patterns;
+  };
+
+  struct KernelRecord {
+    std::string name;
+    std::vector<TaskRecord> tasks;
+    int64 launches{0};
+  };
+
+  std::mutex mut_;
+  std::unordered_map<const Kernel *, KernelRecord> kernels_;
+};
+
+TLANG_NAMESPACE_END
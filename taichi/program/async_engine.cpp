@@ -1,11 +1,13 @@
 #include "taichi/program/async_engine.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "taichi/program/kernel.h"
 #include "taichi/system/timeline.h"
 #include "taichi/backends/cpu/codegen_cpu.h"
 #include "taichi/util/testing.h"
+#include "taichi/util/metrics.h"
 #include "taichi/util/statistics.h"
 #include "taichi/ir/analysis.h"
 #include "taichi/ir/statements.h"
@@ -17,107 +19,6 @@
 
 TLANG_NAMESPACE_BEGIN
 
-ParallelExecutor::ParallelExecutor(const std::string &name, int num_threads)
-    : name_(name),
-      num_threads_(num_threads),
-      status_(ExecutorStatus::uninitialized),
-      running_threads_(0) {
-  {
-    auto _ = std::lock_guard<std::mutex>(mut_);
-
-    for (int i = 0; i < num_threads; i++) {
-      threads_.emplace_back([this]() { this->worker_loop(); });
-    }
-
-    status_ = ExecutorStatus::initialized;
-  }
-  init_cv_.notify_all();
-}
-
-ParallelExecutor::~ParallelExecutor() {
-  // TODO: We should have a new ExecutorStatus, e.g. shutting_down, to prevent
-  // new tasks from being enqueued during shut down.
-  flush();
-  {
-    auto _ = std::lock_guard<std::mutex>(mut_);
-    status_ = ExecutorStatus::finalized;
-  }
-  // Signal the workers that they need to shutdown.
-  worker_cv_.notify_all();
-  for (auto &th : threads_) {
-    th.join();
-  }
-}
-
-void ParallelExecutor::enqueue(const TaskType &func) {
-  {
-    std::lock_guard<std::mutex> _(mut_);
-    task_queue_.push_back(func);
-  }
-  worker_cv_.notify_all();
-}
-
-void ParallelExecutor::flush() {
-  std::unique_lock<std::mutex> lock(mut_);
-  while (!flush_cv_cond()) {
-    flush_cv_.wait(lock);
-  }
-}
-
-bool ParallelExecutor::flush_cv_cond() {
-  return (task_queue_.empty() && running_threads_ == 0);
-}
-
-void ParallelExecutor::worker_loop() {
-  TI_DEBUG("Starting worker thread.");
-  auto thread_id = thread_counter_++;
-
-  std::string thread_name = name_;
-  if (num_threads_ != 1)
-    thread_name += fmt::format("_{}", thread_id);
-  Timeline::get_this_thread_instance().set_name(thread_name);
-
-  {
-    std::unique_lock<std::mutex> lock(mut_);
-    while (status_ == ExecutorStatus::uninitialized) {
-      init_cv_.wait(lock);
-    }
-  }
-
-  TI_DEBUG("Worker thread initialized and running.");
-  bool done = false;
-  while (!done) {
-    bool notify_flush_cv = false;
-    {
-      std::unique_lock<std::mutex> lock(mut_);
-      while (task_queue_.empty() && status_ == ExecutorStatus::initialized) {
-        worker_cv_.wait(lock);
-      }
-      // So long as |task_queue| is not empty, we keep running.
-      if (!task_queue_.empty()) {
-        auto task = task_queue_.front();
-        running_threads_++;
-        task_queue_.pop_front();
-        lock.unlock();
-
-        // Run the task
-        task();
-
-        lock.lock();
-        running_threads_--;
-      }
-      notify_flush_cv = flush_cv_cond();
-      if (status_ == ExecutorStatus::finalized && task_queue_.empty()) {
-        done = true;
-      }
-    }
-    if (notify_flush_cv) {
-      // It is fine to notify |flush_cv_| while nobody is waiting on it.
-      flush_cv_.notify_one();
-    }
-  }
-}
-
 void ExecutionQueue::enqueue(const TaskLaunchRecord &ker) {
   auto h = ker.ir_handle.hash();
   auto *stmt = ker.stmt();
@@ -139,12 +40,13 @@ void ExecutionQueue::enqueue(const TaskLaunchRecord &ker) {
     async_func = &(compiled_funcs_.at(h));
   }
   if (needs_compile) {
-    // Later the IR passes will change |stmt|, so we must clone it.
-    auto cloned_stmt = ker.ir_handle.clone();
+    // Later the IR passes will change |stmt|, so we must clone it. The clone
+    // is owned by the compilation task, and freed once compiled.
+    std::shared_ptr<IRNode> cloned_stmt = ker.ir_handle.clone();
     stmt = cloned_stmt->as<OffloadedStmt>();
 
     compilation_workers.enqueue(
-        [kernel_name, async_func, stmt, kernel, this]() {
+        [kernel_name, async_func, stmt, cloned_stmt, kernel, this]() {
           TI_TIMELINE(kernel_name);
           // Final lowering
           using namespace irpass;
@@ -162,20 +64,40 @@ void ExecutionQueue::enqueue(const TaskLaunchRecord &ker) {
           auto func = this->compile_to_backend_(*kernel, stmt);
           async_func->set(func);
         });
-    ir_bank_->insert_to_trash_bin(std::move(cloned_stmt));
   }
 
-  launch_worker.enqueue(
-      [kernel_name, async_func, context = ker.context]() mutable {
-        TI_TIMELINE(kernel_name);
-        auto func = async_func->get();
-        func(context);
-      });
+  launch_worker.enqueue([kernel_name, async_func, context = ker.context,
+                         scheduler = stream_scheduler_.get(),
+                         task_id = batch_task_id_++]() mutable {
+    TI_TIMELINE(kernel_name);
+    auto func = async_func->get();
+    if (scheduler) {
+      scheduler->before_launch(task_id);
+    }
+    func(context);
+    if (scheduler) {
+      scheduler->after_launch(task_id);
+    }
+  });
+}
+
+void ExecutionQueue::begin_batch(std::vector<std::vector<int>> dependencies) {
+  batch_task_id_ = 0;
+  if (!stream_scheduler_) {
+    return;
+  }
+  launch_worker.enqueue([scheduler = stream_scheduler_.get(),
+                         dependencies = std::move(dependencies)]() mutable {
+    scheduler->begin_batch(std::move(dependencies));
+  });
 }
 
 void ExecutionQueue::synchronize() {
   TI_AUTO_PROF;
   launch_worker.flush();
+  if (stream_scheduler_) {
+    stream_scheduler_->synchronize();
+  }
 }
 
 ExecutionQueue::ExecutionQueue(
@@ -187,6 +109,11 @@ ExecutionQueue::ExecutionQueue(
       compile_to_backend_(compile_to_backend) {
 }
 
+ExecutionQueue::~ExecutionQueue() {
+  // The pending launches may still refer to |stream_scheduler_|.
+  launch_worker.flush();
+}
+
 AsyncEngine::AsyncEngine(const CompileConfig *const config,
                          const BackendExecCompilationFunc &compile_to_backend)
     : queue(&ir_bank_, compile_to_backend),
@@ -194,6 +121,9 @@ AsyncEngine::AsyncEngine(const CompileConfig *const config,
       sfg(std::make_unique<StateFlowGraph>(this, &ir_bank_, config)) {
   Timeline::get_this_thread_instance().set_name("host");
   ir_bank_.set_sfg(sfg.get());
+  if (config->async_pipeline) {
+    sfg_worker_ = std::make_unique<ParallelExecutor>("sfg", 1);
+  }
 }
 
 void AsyncEngine::launch(Kernel *kernel, RuntimeContext &context) {
@@ -201,6 +131,30 @@ void AsyncEngine::launch(Kernel *kernel, RuntimeContext &context) {
     kernel->lower(/*to_executable=*/false);
   }
 
+  if (!sfg_worker_) {
+    insert_tasks(kernel, context);
+    if ((config_->async_flush_every > 0) && (batch_depth_ == 0) &&
+        (sfg->num_pending_tasks() >= config_->async_flush_every)) {
+      TI_TRACE("Async flushing {} tasks", sfg->num_pending_tasks());
+      flush();
+    }
+    return;
+  }
+
+  rethrow_sfg_worker_exception();
+  auto block = dynamic_cast<Block *>(kernel->ir.get());
+  TI_ASSERT(block);
+  num_tasks_since_flush_ += block->statements.size();
+  run_on_sfg_worker(
+      [this, kernel, context]() mutable { insert_tasks(kernel, context); });
+  if ((config_->async_flush_every > 0) && (batch_depth_ == 0) &&
+      (num_tasks_since_flush_ >= config_->async_flush_every)) {
+    TI_TRACE("Async flushing {} tasks", num_tasks_since_flush_);
+    flush();
+  }
+}
+
+void AsyncEngine::insert_tasks(Kernel *kernel, RuntimeContext &context) {
   auto block = dynamic_cast<Block *>(kernel->ir.get());
   TI_ASSERT(block);
 
@@ -222,16 +176,62 @@ void AsyncEngine::launch(Kernel *kernel, RuntimeContext &context) {
     records.push_back(rec);
   }
   sfg->insert_tasks(records, config_->async_listgen_fast_filtering);
-  if ((config_->async_flush_every > 0) &&
-      (sfg->num_pending_tasks() >= config_->async_flush_every)) {
-    TI_TRACE("Async flushing {} tasks", sfg->num_pending_tasks());
-    flush();
+}
+
+void AsyncEngine::discard(Kernel *kernel, const std::vector<SNode *> &snodes) {
+  if (!sfg_worker_) {
+    insert_discard_task(kernel, snodes);
+    return;
+  }
+  rethrow_sfg_worker_exception();
+  run_on_sfg_worker(
+      [this, kernel, snodes]() { insert_discard_task(kernel, snodes); });
+}
+
+void AsyncEngine::insert_discard_task(Kernel *kernel,
+                                      const std::vector<SNode *> &snodes) {
+  auto block = dynamic_cast<Block *>(kernel->ir.get());
+  TI_ASSERT(block && block->statements.size() == 1);
+  std::vector<int> snode_ids;
+  for (auto *snode : snodes) {
+    TI_ASSERT(snode->type == SNodeType::place);
+    snode_ids.push_back(snode->id);
+  }
+  std::sort(snode_ids.begin(), snode_ids.end());
+  snode_ids.erase(std::unique(snode_ids.begin(), snode_ids.end()),
+                  snode_ids.end());
+  // The tasks share the same (empty) IR, and are told apart by their metas,
+  // so each set of SNodes gets a handle of its own.
+  uint64 hash = std::hash<std::string>{}("discard");
+  for (int id : snode_ids) {
+    hash = hash * 100000007UL + id;
+  }
+  IRHandle tmp_ir_handle(block->statements[0].get(), 0);
+  auto cloned_offs = tmp_ir_handle.clone();
+  irpass::re_id(cloned_offs.get());
+  ir_bank_.insert(std::move(cloned_offs), hash);
+  IRHandle handle(ir_bank_.find(IRHandle(nullptr, hash)), hash);
+
+  TaskLaunchRecord rec(RuntimeContext{}, kernel, handle);
+  auto *meta = get_task_meta(&ir_bank_, rec);
+  if (!meta->discard) {
+    meta->name = "discard";
+    meta->discard = true;
+    for (auto *snode : snodes) {
+      meta->output_states.insert(
+          ir_bank_.get_async_state(snode, AsyncState::Type::value));
+      meta->element_wise[snode] = true;
+    }
+    // Never fused, or the fused task would lose the metas above.
+    ir_bank_.fusion_meta_bank_[handle] = TaskFusionMeta();
   }
+  sfg->insert_tasks({rec}, /*filter_listgen=*/false);
 }
 
 void AsyncEngine::synchronize() {
   TI_AUTO_PROF;
   flush();
+  wait_for_sfg_worker();
   queue.synchronize();
 
   sync_counter_++;
@@ -240,7 +240,87 @@ void AsyncEngine::synchronize() {
   cur_sync_sfg_debug_per_stage_counts_.clear();
 }
 
+void AsyncEngine::begin_batch() {
+  batch_depth_++;
+}
+
+void AsyncEngine::end_batch() {
+  TI_ASSERT(batch_depth_ > 0);
+  if (--batch_depth_ == 0) {
+    flush();
+  }
+}
+
 void AsyncEngine::flush() {
+  static auto &flushes =
+      metrics().counter("taichi_async_flushes", "Async engine flushes.");
+  flushes.add();
+  if (!sfg_worker_) {
+    optimize_and_enqueue();
+    return;
+  }
+  TI_AUTO_PROF;
+  rethrow_sfg_worker_exception();
+  num_tasks_since_flush_ = 0;
+  {
+    // Bound the number of batches in flight, so that the host thread does not
+    // run arbitrarily far ahead of the SFG worker.
+    std::unique_lock<std::mutex> lock(pipeline_mut_);
+    pipeline_cv_.wait(lock, [this] {
+      return num_pending_flushes_ < kMaxPendingFlushes;
+    });
+    num_pending_flushes_++;
+  }
+  run_on_sfg_worker([this]() {
+    auto finish_flush = [this]() {
+      {
+        std::lock_guard<std::mutex> _(pipeline_mut_);
+        num_pending_flushes_--;
+      }
+      pipeline_cv_.notify_all();
+    };
+    try {
+      optimize_and_enqueue();
+    } catch (...) {
+      finish_flush();
+      throw;
+    }
+    finish_flush();
+  });
+}
+
+void AsyncEngine::wait_for_sfg_worker() {
+  if (sfg_worker_) {
+    sfg_worker_->flush();
+    rethrow_sfg_worker_exception();
+  }
+}
+
+void AsyncEngine::run_on_sfg_worker(const std::function<void()> &func) {
+  sfg_worker_->enqueue([this, func]() {
+    try {
+      func();
+    } catch (...) {
+      std::lock_guard<std::mutex> _(pipeline_mut_);
+      if (!sfg_worker_exception_) {
+        sfg_worker_exception_ = std::current_exception();
+      }
+    }
+  });
+}
+
+void AsyncEngine::rethrow_sfg_worker_exception() {
+  std::exception_ptr exception;
+  {
+    std::lock_guard<std::mutex> _(pipeline_mut_);
+    std::swap(exception, sfg_worker_exception_);
+  }
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+void AsyncEngine::optimize_and_enqueue() {
   TI_AUTO_PROF;
   TI_AUTO_TIMELINE;
 
@@ -250,6 +330,21 @@ void AsyncEngine::flush() {
   sfg->sort_node_edges();
   TI_TRACE("Synchronizing SFG of {} nodes ({} pending)", sfg->size(),
            sfg->num_pending_tasks());
+  std::vector<TaskLaunchRecord> records;
+  ScheduleSignature signature;
+  if (config_->async_memoize_schedules) {
+    records = sfg->get_records();
+    signature.reserve(records.size() + 1);
+    signature.emplace_back(records.size() - sfg->num_pending_tasks(),
+                           nullptr);
+    for (const auto &rec : records) {
+      signature.emplace_back(rec.ir_handle.hash(), rec.kernel);
+    }
+    if (replay_schedule(records, signature)) {
+      flush_counter_++;
+      return;
+    }
+  }
   debug_sfg("initial");
   if (config_->debug) {
     sfg->verify();
@@ -293,8 +388,14 @@ void AsyncEngine::flush() {
   debug_sfg("final");
   {
     TI_TIMELINE("enqueue");
-    auto tasks = sfg->extract_to_execute();
+    std::vector<std::vector<int>> dependencies;
+    auto tasks = sfg->extract_to_execute(
+        queue.has_stream_scheduler() ? &dependencies : nullptr);
     TI_TRACE("Ended up with {} nodes", tasks.size());
+    if (config_->async_memoize_schedules) {
+      memoize_schedule(records, std::move(signature), tasks, dependencies);
+    }
+    queue.begin_batch(std::move(dependencies));
     for (auto &task : tasks) {
       queue.enqueue(task);
     }
@@ -302,6 +403,86 @@ void AsyncEngine::flush() {
   flush_counter_++;
 }
 
+namespace {
+
+uint64 hash_signature(
+    const std::vector<std::pair<uint64, const Kernel *>> &signature) {
+  uint64 hash = 0;
+  for (const auto &[ir_hash, kernel] : signature) {
+    hash = hash * 100000007UL + ir_hash;
+    hash = hash * 100000007UL + (uint64)kernel;
+  }
+  return hash;
+}
+
+}  // namespace
+
+bool AsyncEngine::replay_schedule(const std::vector<TaskLaunchRecord> &records,
+                                  const ScheduleSignature &signature) {
+  auto it = schedules_.find(hash_signature(signature));
+  if (it == schedules_.end() || it->second.signature != signature) {
+    return false;
+  }
+  TI_AUTO_TIMELINE;
+  stat.add("num_replayed_schedules");
+  static auto &replays = metrics().counter(
+      "taichi_async_replayed_schedules",
+      "Async flushes whose memoized schedule was replayed.");
+  replays.add();
+  const auto &schedule = it->second;
+  auto make_records = [&](const std::vector<std::pair<int, IRHandle>> &refs) {
+    std::vector<TaskLaunchRecord> result;
+    result.reserve(refs.size());
+    for (const auto &[i, ir_handle] : refs) {
+      result.push_back(records[i]);
+      result.back().ir_handle = ir_handle;
+    }
+    return result;
+  };
+  sfg->reset_to_executed(make_records(schedule.retained));
+  queue.begin_batch(schedule.dependencies);
+  for (auto &task : make_records(schedule.tasks)) {
+    queue.enqueue(task);
+  }
+  return true;
+}
+
+void AsyncEngine::memoize_schedule(
+    const std::vector<TaskLaunchRecord> &records,
+    ScheduleSignature signature,
+    const std::vector<TaskLaunchRecord> &tasks,
+    std::vector<std::vector<int>> dependencies) {
+  // The optimizations keep the records of the tasks they modify, see
+  // TaskLaunchRecord::id.
+  std::unordered_map<int, int> positions;
+  for (int i = 0; i < (int)records.size(); i++) {
+    positions[records[i].id] = i;
+  }
+  auto make_refs = [&](const std::vector<TaskLaunchRecord> &derived,
+                       std::vector<std::pair<int, IRHandle>> &refs) {
+    for (const auto &rec : derived) {
+      auto it = positions.find(rec.id);
+      if (it == positions.end()) {
+        return false;
+      }
+      refs.emplace_back(it->second, rec.ir_handle);
+    }
+    return true;
+  };
+  Schedule schedule;
+  if (!make_refs(tasks, schedule.tasks) ||
+      !make_refs(sfg->get_records(), schedule.retained)) {
+    return;
+  }
+  schedule.dependencies = std::move(dependencies);
+  if (schedules_.size() >= kMaxSchedules) {
+    schedules_.clear();
+  }
+  const auto hash = hash_signature(signature);
+  schedule.signature = std::move(signature);
+  schedules_[hash] = std::move(schedule);
+}
+
 void AsyncEngine::debug_sfg(const std::string &stage) {
   TI_TRACE("Ran {}, counter={}", stage, cur_sync_sfg_debug_counter_);
   auto prefix = config_->async_opt_intermediate_file;
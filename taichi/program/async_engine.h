@@ -1,6 +1,9 @@
+#pragma once
+
 #include <atomic>
 #include <condition_variable>
 #include <deque>
+#include <exception>
 #include <functional>
 #include <future>
 #include <mutex>
@@ -14,62 +17,31 @@
 #undef TI_RUNTIME_HOST
 #include "taichi/program/async_utils.h"
 #include "taichi/program/ir_bank.h"
+#include "taichi/program/parallel_executor.h"
 #include "taichi/program/state_flow_graph.h"
 
 TLANG_NAMESPACE_BEGIN
 
 // TODO(yuanming-hu): split into multiple files
 
-class ParallelExecutor {
+// Spreads the tasks of a flush over multiple device queues (e.g. CUDA
+// streams), so that the tasks with no dependency between them can run
+// concurrently. All the methods but synchronize() are called on the launcher
+// thread.
+class TaskStreamScheduler {
  public:
-  using TaskType = std::function<void()>;
-
-  explicit ParallelExecutor(const std::string &name, int num_threads);
-  ~ParallelExecutor();
-
-  void enqueue(const TaskType &func);
-
-  void flush();
+  virtual ~TaskStreamScheduler() = default;
 
-  int get_num_threads() {
-    return num_threads_;
-  }
+  // |dependencies[i]| lists the tasks of the new batch that task i must wait
+  // for. The tasks of the previous batches must all be waited for.
+  virtual void begin_batch(std::vector<std::vector<int>> dependencies) = 0;
 
- private:
-  enum class ExecutorStatus {
-    uninitialized,
-    initialized,
-    finalized,
-  };
+  // The device work of task |task_id| is issued between these two calls.
+  virtual void before_launch(int task_id) = 0;
+  virtual void after_launch(int task_id) = 0;
 
-  void worker_loop();
-
-  // Must be called while holding |mut|.
-  bool flush_cv_cond();
-
-  std::string name_;
-  int num_threads_;
-  std::atomic<int> thread_counter_{0};
-  std::mutex mut_;
-
-  // All guarded by |mut|
-  ExecutorStatus status_;
-  std::vector<std::thread> threads_;
-  std::deque<TaskType> task_queue_;
-  int running_threads_;
-
-  // Used to signal the workers that they can start polling from |task_queue|.
-  std::condition_variable init_cv_;
-  // Used by |this| to instruct the worker thread that there is an event:
-  // * task being enqueued
-  // * shutting down
-  std::condition_variable worker_cv_;
-  // Used by a worker thread to unblock the caller from waiting for a flush.
-  //
-  // TODO: Instead of having this as a member variable, we can enqueue a
-  // callback upon flush(). The flush() will then block waiting for that
-  // callback to be executed?
-  std::condition_variable flush_cv_;
+  // Blocks until all the issued work is done.
+  virtual void synchronize() = 0;
 };
 
 // Compiles the offloaded and optimized IR to the target backend's executable.
@@ -87,8 +59,22 @@ class ExecutionQueue {
   explicit ExecutionQueue(IRBank *ir_bank,
                           const BackendExecCompilationFunc &compile_to_backend);
 
+  ~ExecutionQueue();
+
+  // Tasks enqueued after this call, until the next one, form a batch whose
+  // dependencies are described by |dependencies| (see TaskStreamScheduler).
+  void begin_batch(std::vector<std::vector<int>> dependencies);
+
   void enqueue(const TaskLaunchRecord &ker);
 
+  void set_stream_scheduler(std::unique_ptr<TaskStreamScheduler> scheduler) {
+    stream_scheduler_ = std::move(scheduler);
+  }
+
+  bool has_stream_scheduler() const {
+    return stream_scheduler_ != nullptr;
+  }
+
   void compile_task() {
   }
 
@@ -125,6 +111,9 @@ class ExecutionQueue {
 
   IRBank *ir_bank_;  // not owned
   BackendExecCompilationFunc compile_to_backend_;
+  std::unique_ptr<TaskStreamScheduler> stream_scheduler_;
+  // Index of the next task in the current batch
+  int batch_task_id_{0};
 };
 
 // An engine for asynchronous execution and optimization
@@ -146,16 +135,79 @@ class AsyncEngine {
 
   void launch(Kernel *kernel, RuntimeContext &context);
 
+  // Inserts a task declaring that the values of the place SNodes |snodes| are
+  // not read before being written again, so that the pending stores to them
+  // are eliminated. |kernel| holds a single empty serial task, see
+  // Program::discard_values().
+  void discard(Kernel *kernel, const std::vector<SNode *> &snodes);
+
   // Flush the tasks only.
   void flush();
+
+  // Between these, the launches are not flushed every
+  // CompileConfig::async_flush_every tasks, so that the whole batch, e.g. the
+  // backward pass of a ti.Tape, is optimized as one graph. end_batch() flushes
+  // once the outermost batch ends.
+  void begin_batch();
+  void end_batch();
   // Flush the tasks and block waiting for the GPU device to complete.
   void synchronize();
 
+  // With |async_pipeline|, |sfg| is owned by the SFG worker thread. This blocks
+  // until the worker is idle, so that |sfg| can be inspected.
+  void wait_for_sfg_worker();
+
   void debug_sfg(const std::string &suffix);
 
  private:
+  // Inserts the offloaded tasks of a launch into |sfg|.
+  void insert_tasks(Kernel *kernel, RuntimeContext &context);
+
+  void insert_discard_task(Kernel *kernel, const std::vector<SNode *> &snodes);
+
+  // Optimizes |sfg| and hands the resulting tasks to |queue|.
+  void optimize_and_enqueue();
+
+  void run_on_sfg_worker(const std::function<void()> &func);
+
+  // Rethrows (on the host thread) an exception raised on the SFG worker.
+  void rethrow_sfg_worker_exception();
+
+  // The SFG optimization of a batch overlaps with the compilation and launch
+  // of the previous one anyway, so there is little point in queuing more.
+  static constexpr int kMaxPendingFlushes = 2;
+
   IRBank ir_bank_;
 
+  // The tasks of |sfg| before a flush is optimized, i.e. the retained tasks
+  // then the pending ones, which determine the outcome of the optimization.
+  // The first element holds the number of retained tasks.
+  using ScheduleSignature = std::vector<std::pair<uint64, const Kernel *>>;
+
+  // A flush memoized with CompileConfig::async_memoize_schedules. Each task
+  // refers to the position of the record it derives from in the signature,
+  // whose launch context it takes, along with its possibly fused IR.
+  struct Schedule {
+    ScheduleSignature signature;
+    std::vector<std::pair<int, IRHandle>> tasks;
+    std::vector<std::vector<int>> dependencies;
+    // The tasks retained in |sfg| after the flush.
+    std::vector<std::pair<int, IRHandle>> retained;
+  };
+
+  // Returns false if the flush of |records| is not memoized.
+  bool replay_schedule(const std::vector<TaskLaunchRecord> &records,
+                       const ScheduleSignature &signature);
+
+  void memoize_schedule(const std::vector<TaskLaunchRecord> &records,
+                        ScheduleSignature signature,
+                        const std::vector<TaskLaunchRecord> &tasks,
+                        std::vector<std::vector<int>> dependencies);
+
+  // Keyed by the hash of Schedule::signature. Cleared when full.
+  std::unordered_map<uint64, Schedule> schedules_;
+  static constexpr std::size_t kMaxSchedules = 64;
+
   struct KernelMeta {
     // OffloadedCachedData holds some data that needs to be computed once for
     // each offloaded task of a kernel. Especially, it holds a cloned offloaded
@@ -174,7 +226,20 @@ class AsyncEngine {
   // How many times we have synchronized
   int sync_counter_{0};
   int cur_sync_sfg_debug_counter_{0};
+  // The number of nested begin_batch() calls not ended yet.
+  int batch_depth_{0};
   std::unordered_map<std::string, int> cur_sync_sfg_debug_per_stage_counts_;
+
+  // Pipelined mode only. Accessed by the host thread only.
+  int num_tasks_since_flush_{0};
+  // Guards |num_pending_flushes_| and |sfg_worker_exception_|.
+  std::mutex pipeline_mut_;
+  std::condition_variable pipeline_cv_;
+  int num_pending_flushes_{0};
+  std::exception_ptr sfg_worker_exception_{nullptr};
+  // Inserts the tasks into |sfg|, and optimizes and enqueues them on flushes.
+  // Declared last so that it is destructed (and drained) first.
+  std::unique_ptr<ParallelExecutor> sfg_worker_;
 };
 
 TLANG_NAMESPACE_END
@@ -236,6 +236,18 @@ TaskMeta *get_task_meta(IRBank *ir_bank, const TaskLaunchRecord &t) {
       auto as = ir_bank->get_async_state(t.kernel);
       meta.input_states.insert(as);
       meta.output_states.insert(as);
+      meta.has_untracked_side_effects = true;
+    }
+    if (stmt->is<ExternalPtrStmt>() || stmt->is<RandStmt>() ||
+        stmt->is<PrintStmt>() || stmt->is<AssertStmt>()) {
+      meta.has_untracked_side_effects = true;
+    }
+    if (auto internal_func = stmt->cast<InternalFuncStmt>()) {
+      // The deterministic reductions of all the tasks share the slots of the
+      // runtime for their partial sums.
+      if (internal_func->func_name.rfind("deterministic_reduce_", 0) == 0) {
+        meta.has_untracked_side_effects = true;
+      }
     }
     if (auto clear_list = stmt->cast<ClearListStmt>()) {
       meta.output_states.insert(
@@ -217,6 +217,16 @@ struct TaskMeta {
 
   // element_wise[s] OR loop_unique[s] covers s => surjective access on s
 
+  // True if the task accesses memory that is not modeled by the states above,
+  // e.g. external arrays, the RNG states of the runtime, or the global
+  // temporaries buffer shared by all the kernels.
+  bool has_untracked_side_effects{false};
+
+  // True for the tasks of Program::discard_values(), which launch nothing:
+  // they only end the lifetimes of the values in |output_states|, so that the
+  // stores to them before the task are dead.
+  bool discard{false};
+
   void print() const;
 };
 
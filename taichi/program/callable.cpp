@@ -15,9 +15,20 @@ int Callable::insert_ret(const DataType &dt) {
 }
 int Callable::insert_arr_arg(const DataType &dt,
                              int total_dim,
-                             std::vector<int> element_shape) {
+                             std::vector<int> element_shape,
+                             bool is_strided) {
   args.emplace_back(dt->get_compute_type(), true, /*size=*/0, total_dim,
                     element_shape);
+  args.back().is_strided = is_strided;
+  return (int)args.size() - 1;
+}
+
+int Callable::insert_texture_arg(int num_dims) {
+  // A texture is bound to the kernel through its DeviceAllocation, whose
+  // address is passed like that of an ndarray.
+  args.emplace_back(PrimitiveType::f32, /*is_external_array=*/false,
+                    /*size=*/0, num_dims);
+  args.back().is_texture = true;
   return (int)args.size() - 1;
 }
 
@@ -22,6 +22,11 @@ class Callable {
     std::size_t size{0};  // TODO: size is runtime information, maybe remove?
     std::size_t total_dim{0};             // total dim of array
     std::vector<int> element_shape = {};  // shape of each element
+    // Whether the array is a strided view, whose strides (in elements) follow
+    // its shape in the extra args.
+    bool is_strided{false};
+    // For texture args, whose number of dimensions is |total_dim|
+    bool is_texture{false};
 
     explicit Arg(const DataType &dt = PrimitiveType::unknown,
                  bool is_external_array = false,
@@ -34,6 +39,14 @@ class Callable {
           total_dim(total_dim),
           element_shape(std::move(element_shape)) {
     }
+
+    TI_IO_DEF(dt,
+              is_external_array,
+              size,
+              total_dim,
+              element_shape,
+              is_strided,
+              is_texture);
   };
 
   struct Ret {
@@ -41,6 +54,8 @@ class Callable {
 
     explicit Ret(const DataType &dt = PrimitiveType::unknown) : dt(dt) {
     }
+
+    TI_IO_DEF(dt);
   };
 
   std::vector<Arg> args;
@@ -52,7 +67,10 @@ class Callable {
 
   int insert_arr_arg(const DataType &dt,
                      int total_dim,
-                     std::vector<int> element_shape);
+                     std::vector<int> element_shape,
+                     bool is_strided = false);
+
+  int insert_texture_arg(int num_dims);
 
   int insert_ret(const DataType &dt);
 
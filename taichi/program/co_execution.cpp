@@ -0,0 +1,295 @@
+#include "taichi/program/co_execution.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/type_utils.h"
+#include "taichi/ir/visitors.h"
+#include "taichi/program/kernel.h"
+#include "taichi/program/program.h"
+#include "taichi/system/timer.h"
+
+#if defined(TI_WITH_CUDA)
+#include "taichi/backends/cuda/cuda_context.h"
+#include "taichi/backends/cuda/cuda_driver.h"
+#endif
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+// Below this, the synchronization costs more than the CPU saves.
+constexpr int64 kMinIterations = 1 << 16;
+constexpr float64 kMinGpuShare = 0.05;
+constexpr float64 kMaxGpuShare = 0.95;
+
+// Whether the body of a range-for can run on the host as well: it may only
+// access the ndarrays, without atomics or any call into the runtime.
+class CoExecutionChecker : public BasicStmtVisitor {
+ public:
+  using BasicStmtVisitor::visit;
+
+  CoExecutionChecker() {
+    allow_undefined_visitor = true;
+    invoke_default_visitor = true;
+  }
+
+  void visit(Stmt *stmt) override {
+    if (!(stmt->is<ConstStmt>() || stmt->is<ArgLoadStmt>() ||
+          stmt->is<ExternalPtrStmt>() ||
+          stmt->is<ExternalTensorShapeAlongAxisStmt>() ||
+          stmt->is<GlobalLoadStmt>() || stmt->is<GlobalStoreStmt>() ||
+          stmt->is<AllocaStmt>() || stmt->is<LocalLoadStmt>() ||
+          stmt->is<LocalStoreStmt>() || stmt->is<BinaryOpStmt>() ||
+          stmt->is<UnaryOpStmt>() || stmt->is<TernaryOpStmt>() ||
+          stmt->is<LoopIndexStmt>() || stmt->is<WhileControlStmt>() ||
+          stmt->is<ContinueStmt>())) {
+      supported_ = false;
+    }
+  }
+
+  void visit(StructForStmt *stmt) override {
+    supported_ = false;
+  }
+
+  void visit(MeshForStmt *stmt) override {
+    supported_ = false;
+  }
+
+  static bool run(IRNode *root) {
+    CoExecutionChecker checker;
+    root->accept(&checker);
+    return checker.supported_;
+  }
+
+ private:
+  bool supported_{true};
+};
+
+// The statements before the loop, which compute its bounds.
+bool is_host_evaluable(Stmt *stmt) {
+  return stmt->is<ConstStmt>() || stmt->is<ArgLoadStmt>() ||
+         stmt->is<ExternalTensorShapeAlongAxisStmt>() ||
+         stmt->is<BinaryOpStmt>() || stmt->is<UnaryOpStmt>();
+}
+
+#if defined(TI_WITH_CUDA)
+bool supports_concurrent_managed_access() {
+  auto &driver = CUDADriver::get_instance();
+  void *device = nullptr;
+  int concurrent_managed_access = 0;
+  driver.device_get(&device, (void *)(std::size_t)0);
+  driver.device_get_attribute(&concurrent_managed_access,
+                              CU_DEVICE_ATTRIBUTE_CONCURRENT_MANAGED_ACCESS,
+                              device);
+  return concurrent_managed_access != 0;
+}
+#endif
+
+}  // namespace
+
+std::unique_ptr<CoExecutedRangeFor> CoExecutedRangeFor::create(Kernel *kernel,
+                                                               IRNode *ir) {
+#if defined(TI_WITH_CUDA)
+  if (!kernel->rets.empty() ||
+      (int)kernel->args.size() >= taichi_max_num_args_total) {
+    return nullptr;
+  }
+  RangeForStmt *loop = nullptr;
+  for (auto &stmt : ir->as<Block>()->statements) {
+    if (auto *range_for = stmt->cast<RangeForStmt>()) {
+      if (loop != nullptr) {
+        return nullptr;
+      }
+      loop = range_for;
+    } else if (!is_host_evaluable(stmt.get())) {
+      return nullptr;
+    }
+  }
+  if (loop == nullptr || loop->strictly_serialized ||
+      !CoExecutionChecker::run(loop->body.get())) {
+    return nullptr;
+  }
+  if (!supports_concurrent_managed_access()) {
+    TI_WARN(
+        "Kernel {} is not co-executed: the GPU does not support concurrent "
+        "access to unified memory.",
+        kernel->name);
+    return nullptr;
+  }
+  return std::unique_ptr<CoExecutedRangeFor>(
+      new CoExecutedRangeFor(kernel, irpass::analysis::clone(ir)));
+#else
+  return nullptr;
+#endif
+}
+
+CoExecutedRangeFor::CoExecutedRangeFor(Kernel *kernel,
+                                       std::unique_ptr<IRNode> ir)
+    : kernel_(kernel), ir_(std::move(ir)) {
+  for (auto &stmt : ir_->as<Block>()->statements) {
+    if (auto *range_for = stmt->cast<RangeForStmt>()) {
+      loop_ = range_for;
+    }
+  }
+  split_arg_id_ = (int)kernel_->args.size();
+  gpu_kernel_ = make_variant(/*on_gpu=*/true);
+  cpu_kernel_ = make_variant(/*on_gpu=*/false);
+#if defined(TI_WITH_CUDA)
+  auto &driver = CUDADriver::get_instance();
+  driver.event_create(&gpu_start_event_, CU_EVENT_DEFAULT);
+  driver.event_create(&gpu_stop_event_, CU_EVENT_DEFAULT);
+#endif
+}
+
+CoExecutedRangeFor::~CoExecutedRangeFor() {
+#if defined(TI_WITH_CUDA)
+  auto &driver = CUDADriver::get_instance();
+  driver.event_destroy(gpu_start_event_);
+  driver.event_destroy(gpu_stop_event_);
+#endif
+}
+
+std::unique_ptr<Kernel> CoExecutedRangeFor::make_variant(bool on_gpu) {
+  auto ir = irpass::analysis::clone(ir_.get());
+  auto *block = ir->as<Block>();
+  const int loop_index = ir_->as<Block>()->locate(loop_);
+  auto *loop = block->statements[loop_index]->as<RangeForStmt>();
+  auto *split = block->insert(
+      Stmt::make<ArgLoadStmt>(split_arg_id_, PrimitiveType::i32), loop_index);
+  if (on_gpu) {
+    loop->end = split;
+  } else {
+    loop->begin = split;
+  }
+
+  auto variant = std::make_unique<Kernel>(
+      *kernel_->program, std::move(ir),
+      fmt::format("{}_co_{}", kernel_->name, on_gpu ? "gpu" : "cpu"));
+  variant->args = kernel_->args;
+  variant->insert_arg(PrimitiveType::i32, /*is_array=*/false);
+  variant->set_arch(on_gpu ? Arch::cuda : host_arch());
+  return variant;
+}
+
+std::optional<int64> CoExecutedRangeFor::evaluate(Stmt *stmt,
+                                                  RuntimeContext &ctx) const {
+  if (auto *c = stmt->cast<ConstStmt>()) {
+    if (!is_integral(c->ret_type)) {
+      return std::nullopt;
+    }
+    return c->val[0].val_as_int64();
+  } else if (auto *arg = stmt->cast<ArgLoadStmt>()) {
+    if (arg->is_ptr) {
+      return std::nullopt;
+    } else if (arg->ret_type->is_primitive(PrimitiveTypeID::i32)) {
+      return ctx.get_arg<int32>(arg->arg_id);
+    } else if (arg->ret_type->is_primitive(PrimitiveTypeID::i64)) {
+      return ctx.get_arg<int64>(arg->arg_id);
+    }
+    return std::nullopt;
+  } else if (auto *shape = stmt->cast<ExternalTensorShapeAlongAxisStmt>()) {
+    return ctx.extra_args[shape->arg_id][shape->axis];
+  } else if (auto *bin = stmt->cast<BinaryOpStmt>()) {
+    const auto lhs = evaluate(bin->lhs, ctx);
+    const auto rhs = evaluate(bin->rhs, ctx);
+    if (!lhs || !rhs) {
+      return std::nullopt;
+    }
+    switch (bin->op_type) {
+      case BinaryOpType::add:
+        return *lhs + *rhs;
+      case BinaryOpType::sub:
+        return *lhs - *rhs;
+      case BinaryOpType::mul:
+        return *lhs * *rhs;
+      default:
+        return std::nullopt;
+    }
+  } else if (auto *un = stmt->cast<UnaryOpStmt>()) {
+    if (un->op_type == UnaryOpType::cast_value && is_integral(un->cast_type)) {
+      return evaluate(un->operand, ctx);
+    }
+  }
+  return std::nullopt;
+}
+
+void CoExecutedRangeFor::update_gpu_share() {
+#if defined(TI_WITH_CUDA)
+  if (!has_last_launch_ || last_gpu_iterations_ == 0 ||
+      last_cpu_iterations_ == 0) {
+    return;
+  }
+  float gpu_time_ms = 0;
+  CUDADriver::get_instance().event_elapsed_time(
+      &gpu_time_ms, gpu_start_event_, gpu_stop_event_);
+  const float64 gpu_rate =
+      last_gpu_iterations_ / std::max<float64>(gpu_time_ms * 1e-3, 1e-9);
+  const float64 cpu_rate =
+      last_cpu_iterations_ / std::max<float64>(last_cpu_time_, 1e-9);
+  // Both sides finish at the same time when the iterations follow the rates.
+  // Smoothed, since the timings of a single launch are noisy.
+  const float64 target = gpu_rate / (gpu_rate + cpu_rate);
+  gpu_share_ = std::clamp(0.5 * gpu_share_ + 0.5 * target, kMinGpuShare,
+                          kMaxGpuShare);
+#endif
+}
+
+bool CoExecutedRangeFor::launch(RuntimeContext &ctx) {
+#if defined(TI_WITH_CUDA)
+  for (int i = 0; i < (int)kernel_->args.size(); i++) {
+    // The host arrays are copied to the device and back around the launches,
+    // which would race between the two sides.
+    if (kernel_->args[i].is_external_array && !ctx.is_device_allocation[i]) {
+      return false;
+    }
+  }
+  const auto begin = evaluate(loop_->begin, ctx);
+  const auto end = evaluate(loop_->end, ctx);
+  if (!begin || !end || *end - *begin < kMinIterations) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> _(launch_mut_);
+  // The CPU may only touch the ndarrays once the previous kernels are done.
+  kernel_->program->synchronize();
+  update_gpu_share();
+  const int64 split = std::clamp<int64>(
+      *begin + (int64)std::llround((*end - *begin) * gpu_share_), *begin,
+      *end);
+  for (auto *variant : {gpu_kernel_.get(), cpu_kernel_.get()}) {
+    for (int i = 0; i < (int)kernel_->args.size(); i++) {
+      variant->args[i].size = kernel_->args[i].size;
+    }
+  }
+
+  auto &driver = CUDADriver::get_instance();
+  void *stream = CUDAContext::get_instance().get_stream();
+  {
+    RuntimeContext gpu_ctx = ctx;
+    gpu_ctx.set_arg(split_arg_id_, (int32)split);
+    Kernel::LaunchContextBuilder builder(gpu_kernel_.get(), &gpu_ctx);
+    driver.event_record(gpu_start_event_, stream);
+    (*gpu_kernel_)(builder);
+    driver.event_record(gpu_stop_event_, stream);
+  }
+  {
+    RuntimeContext cpu_ctx = ctx;
+    cpu_ctx.set_arg(split_arg_id_, (int32)split);
+    Kernel::LaunchContextBuilder builder(cpu_kernel_.get(), &cpu_ctx);
+    const auto start = Time::get_time();
+    (*cpu_kernel_)(builder);
+    last_cpu_time_ = Time::get_time() - start;
+  }
+  last_gpu_iterations_ = split - *begin;
+  last_cpu_iterations_ = *end - split;
+  has_last_launch_ = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+TLANG_NAMESPACE_END
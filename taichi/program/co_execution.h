@@ -0,0 +1,79 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "taichi/lang_util.h"
+
+TLANG_NAMESPACE_BEGIN
+
+class IRNode;
+class Kernel;
+class RangeForStmt;
+class Stmt;
+struct RuntimeContext;
+
+/**
+ * Runs the iterations of a CUDA kernel made of a single range-for on both the
+ * GPU and the CPU threads at the same time. Enabled by
+ * CompileConfig::cpu_gpu_co_execution.
+ *
+ * Two variants of the kernel are compiled, each with an extra argument: the
+ * first iteration of the CPU. The GPU variant runs the iterations before it,
+ * and the host CPU variant the ones after it. The split follows the
+ * throughput of both sides in the previous launch, measured with CUDA events
+ * on the GPU and the wall clock on the CPU.
+ *
+ * Only the kernels whose loop accesses nothing but ndarrays, which are then
+ * in unified memory, and has no atomics, random numbers, prints, assertions
+ * or returns are co-executed. The bounds of the loop must be computable on
+ * the host from the arguments.
+ */
+class CoExecutedRangeFor {
+ public:
+  // Returns nullptr if |kernel| cannot be co-executed. |ir| is the kernel
+  // right after lowering the AST.
+  static std::unique_ptr<CoExecutedRangeFor> create(Kernel *kernel,
+                                                    IRNode *ir);
+
+  ~CoExecutedRangeFor();
+
+  // Launches the kernel on both sides. Thread safe. Returns false if it is not worth it
+  // for the arguments in |ctx|, and the kernel is to be launched as usual.
+  bool launch(RuntimeContext &ctx);
+
+ private:
+  CoExecutedRangeFor(Kernel *kernel, std::unique_ptr<IRNode> ir);
+
+  std::unique_ptr<Kernel> make_variant(bool on_gpu);
+
+  std::optional<int64> evaluate(Stmt *stmt, RuntimeContext &ctx) const;
+
+  // Updates |gpu_share_| with the timings of the previous launch, whose GPU
+  // part must be done.
+  void update_gpu_share();
+
+  Kernel *kernel_;
+  std::unique_ptr<IRNode> ir_;
+  RangeForStmt *loop_{nullptr};
+  std::unique_ptr<Kernel> gpu_kernel_;
+  std::unique_ptr<Kernel> cpu_kernel_;
+  int split_arg_id_{-1};
+
+  // Serializes the launches, which share the state below.
+  std::mutex launch_mut_;
+
+  // The fraction of the iterations run by the GPU.
+  float64 gpu_share_{0.8};
+  // The previous launch.
+  int64 last_gpu_iterations_{0};
+  int64 last_cpu_iterations_{0};
+  float64 last_cpu_time_{0};
+  bool has_last_launch_{false};
+  // Surround the GPU part of a launch.
+  void *gpu_start_event_{nullptr};
+  void *gpu_stop_event_{nullptr};
+};
+
+TLANG_NAMESPACE_END
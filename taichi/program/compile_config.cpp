@@ -23,6 +23,7 @@ CompileConfig::CompileConfig() {
   debug = false;
   cfg_optimization = true;
   check_out_of_bound = false;
+  check_out_of_bound_deferred = false;
   lazy_compilation = true;
   serial_schedule = false;
   simplify_before_lower_access = true;
@@ -44,6 +45,7 @@ CompileConfig::CompileConfig() {
   make_thread_local = true;
   make_block_local = true;
   detect_read_only = true;
+  fuse_offloads = false;
   ndarray_use_torch = true;
   ndarray_use_cached_allocator = true;
 
@@ -63,8 +65,8 @@ CompileConfig::CompileConfig() {
   device_memory_fraction = 0.0;
 
   // C backend options:
-  cc_compile_cmd = "gcc -Wc99-c11-compat -c -o '{}' '{}' -O3";
-  cc_link_cmd = "gcc -shared -fPIC -o '{}' '{}'";
+  cc_compile_cmd = "gcc -Wc99-c11-compat -fopenmp -c -o '{}' '{}' -O3";
+  cc_link_cmd = "gcc -shared -fPIC -fopenmp -o '{}' '{}'";
 }
 
 TLANG_NAMESPACE_END
@@ -10,7 +10,13 @@ struct CompileConfig {
   bool debug;
   bool cfg_optimization;
   bool check_out_of_bound;
+  // Check the field accesses without aborting the kernels: the first
+  // out-of-bound access is recorded, redirected to the first element, and
+  // reported at the next synchronization. Implies check_out_of_bound.
+  bool check_out_of_bound_deferred;
   int simd_width;
+  // Compiles the kernels on their first launch, and generates the bodies of
+  // the real functions only when their calls are inlined.
   bool lazy_compilation;
   int opt_level;
   int external_optimization_level;
@@ -27,12 +33,37 @@ struct CompileConfig {
   bool simplify_after_lower_access;
   bool move_loop_invariant_outside_if;
   bool demote_dense_struct_fors;
+  // Also demote the struct-fors over paths of `dense` and `bitmasked` SNodes,
+  // into range-fors over all the cells skipping the inactive ones. Set by the
+  // backends without listgen.
+  bool demote_bitmasked_struct_fors{false};
+  // Generate the lists of the struct-fors over SNodes deeper than the
+  // children of the root in one listgen task, instead of one per level.
+  // Only applies to the CPU and CUDA backends.
+  bool fuse_listgen{false};
+  // Keep the element lists between the struct-fors, and skip their listgen
+  // while no ancestor has activated or deactivated a cell. Only applies to
+  // the CPU and CUDA backends, outside of the async mode.
+  bool cache_element_lists{false};
+  // Move the live nodes of the pointer SNodes to the front of their
+  // NodeManagers when garbage collecting, and release the chunks left empty.
+  // Only applies to the CPU and CUDA backends, outside of the async mode.
+  bool compact_gc{false};
   bool advanced_optimization;
   bool constant_folding;
   bool use_llvm;
   bool verbose_kernel_launches;
   bool kernel_profiler;
   bool timeline{false};
+  // Records the live device allocations with where they come from, see
+  // DeviceMemoryTracker.
+  bool track_device_memory{false};
+  // Records the time and the IR size of each compilation pass.
+  bool profile_passes{false};
+  // Records which fields the tasks access together, see LayoutAdvisor.
+  bool layout_advisor{false};
+  // Records how the tasks access the fields, see AccessPatternReport.
+  bool access_pattern_report{false};
   bool verbose;
   bool fast_math;
   bool async_mode;
@@ -41,6 +72,10 @@ struct CompileConfig {
   bool make_thread_local;
   bool make_block_local;
   bool detect_read_only;
+  bool fuse_offloads;
+  // Move the expensive computations that are the same in every iteration of
+  // a parallel loop into a serial task in front of it.
+  bool hoist_uniform_values{false};
   bool ndarray_use_torch;
   bool ndarray_use_cached_allocator;
   DataType default_fp;
@@ -53,21 +88,158 @@ struct CompileConfig {
   // The default size when the Taichi compiler is unable to automatically
   // determine the autodiff stack size.
   int default_ad_stack_size{32};
+  // The AD-stacks of at most this many entries are kept in registers instead
+  // of the (on GPUs, local) memory. Each access then costs a comparison per
+  // entry.
+  int ad_stack_max_size_in_registers{8};
+  // Checkpoint the serial loops inside the parallel loops of an autodiff
+  // kernel: keep the values on the AD-stacks only every this many iterations
+  // and recompute the rest in the reversed loop. A loop of N iterations then
+  // needs about N / interval + interval entries on its AD-stacks instead of N.
+  // 0 disables checkpointing.
+  int ad_checkpoint_interval{0};
+  // Also cache the adjoints of the block_local SNodes of a struct-for in BLS
+  // in its gradient kernel, so that the adjoint contributions are reduced
+  // per block instead of each going through a global atomic.
+  bool ad_block_local_adjoint{true};
+  // Unroll the innermost serial range-fors with constant bounds by this
+  // factor. Loops of at most this many iterations are unrolled completely.
+  // 0 disables unrolling.
+  int unroll_inner_loop_factor{0};
+  // Compile a variant of a kernel with its scalar arguments constant-folded
+  // once it is launched this many times in a row with the same values. Only
+  // applies to the CPU, CUDA and Metal backends. 0 disables it.
+  int kernel_specialization_launches{0};
+  // Compile the CPU kernels without LLVM optimization first, so that they
+  // launch sooner, and recompile a kernel with full optimization on a
+  // background thread once it is launched this many times. 0 disables it.
+  int cpu_tiered_jit_launches{0};
+  // The struct-fors on CPU prefetch the node data of the element this many
+  // elements ahead in the list, i.e. the cell of a pointer or dynamic SNode
+  // the thread visits next. 0 disables it.
+  int cpu_struct_for_prefetch_distance{4};
 
   int saturating_grid_dim;
   int max_block_dim;
   int cpu_max_num_threads;
+  // Number of threads used to run the passes after offloading and to
+  // generate code for the offloaded tasks of a kernel. Setting 1 effectively
+  // means serial compilation.
+  int num_compile_threads{1};
+  // Pin the CPU workers in NUMA node order and first-touch the SNode root
+  // buffers in parallel, so that memory is local to the threads accessing it.
+  bool cpu_numa_aware{false};
+  // If set, the root buffers of the SNode trees on CPUs are files mapped from
+  // this directory (e.g. on an NVMe drive) instead of anonymous memory, so
+  // that trees larger than the RAM are paged in and out by the OS.
+  std::string cpu_snode_tree_file_dir;
+  // Back the SNode roots, the memory pool (and thus the dynamic SNodes and
+  // the ndarrays) on CPUs with transparent huge pages.
+  bool cpu_huge_pages{false};
+  // Emit the innermost range-for loops on CPUs so that LLVM vectorizes them
+  // with |simd_width| lanes.
+  bool cpu_vectorize_range_for{false};
+  // Iterate dense struct-fors on CPUs in tiles of this many indices along each
+  // axis, instead of in plain linear order. 0 disables tiling.
+  int cpu_struct_for_tile_size{0};
+  // Cache the fields that struct-fors access as stencils of their indices in
+  // BLS without ti.block_local(), when the reuse of their elements within a
+  // block pays off. The decisions are reported if |verbose| is set.
+  bool auto_block_local{false};
+  // Upper bound of the thread-local BLS buffer of a CPU task. Struct-fors
+  // needing more block-local storage than this do not use BLS.
+  int cpu_bls_max_size_bytes{32 * 1024};
+  // Make the float additions of the range-fors into 0-D fields (or into
+  // elements at constant indices) bitwise reproducible: each CPU task, or each
+  // warp on CUDA, keeps its partial sum in a slot of its own, and the last one
+  // to finish adds the slots up in order. LLVM backends only.
+  bool deterministic_reduction{false};
+  // The LLVM name of the CPU to generate code for, like -march, e.g.
+  // "skylake-avx512", "znver3" or "neoverse-n1". Empty means the host CPU.
+  std::string cpu_target;
+  // LLVM target features added to or removed from those of |cpu_target|,
+  // e.g. "+avx512f,-avx512vl" or "+sve".
+  std::string cpu_features;
+  // Comma-separated LLVM CPU names, most preferred first. The LLVM AOT
+  // modules also contain the kernels compiled for each of these CPUs, and the
+  // loader picks the first one that the host supports.
+  std::string cpu_aot_variants;
+  // Emit the WASM kernels with the SIMD128 feature, and let LLVM vectorize
+  // their innermost range-for loops.
+  bool wasm_simd128{false};
+  // Emit the WASM kernels with the atomics and bulk-memory features, so that
+  // they can work on a shared memory (SharedArrayBuffer) across threads.
+  bool wasm_threads{false};
   int random_seed;
+  // Generate the random numbers with Philox-4x32-10 keyed by (seed, launch,
+  // loop index, call), instead of the per-thread xorshift states. The results
+  // then do not depend on the number of threads or the schedule.
+  bool counter_based_rand{false};
 
   // LLVM backend options:
   bool print_struct_llvm_ir;
   bool print_kernel_llvm_ir;
   bool print_kernel_llvm_ir_optimized;
   bool print_kernel_nvptx;
+  // Persist JIT compiled kernels on disk and reuse them across processes.
+  bool offline_cache{false};
+  // Defaults to ~/.taichi/ticache/llvm when left empty.
+  std::string offline_cache_file_path;
+  // Setting 0 effectively means unlimited
+  int offline_cache_max_size_MB{1024};
+  // The offline cache is shared by many processes at once, e.g. the workers
+  // of a node with offline_cache_file_path under /dev/shm. Each module is
+  // then compiled by one of them, while the others wait for its entry.
+  bool offline_cache_shared{false};
+  // Keeps the LLVM contexts when the program is finalized, i.e. the JIT
+  // sessions, the runtime modules and the kernels JITted so far, for the next
+  // program with the same arch and offline cache options. The kernels
+  // compiled again to identical modules are then not JITted again.
+  bool soft_reset{false};
 
   // CUDA backend options:
   float64 device_memory_GB;
   float64 device_memory_fraction;
+  // Number of GPUs the memory of the dense children of the SNode roots is
+  // spread over, to hold larger fields. This only places the memory: all the
+  // kernels, including the struct-fors, run on device 0 and access the
+  // remote slices through unified memory, and the pointer SNodes stay on
+  // device 0.
+  int cuda_num_devices{1};
+  // Back the root buffers of SNode trees with unified memory instead of the
+  // preallocated device memory, so that the fields may outgrow the GPU. The
+  // struct-fors prefetch the part of the root buffer they iterate over.
+  bool cuda_unified_memory{false};
+  // Combine the atomics of a warp that update the same address and whose old
+  // values are unused (sm_70+).
+  bool cuda_warp_aggregated_atomics{true};
+  // Benchmark the candidate block sizes of the range-for tasks which use the
+  // default block_dim on their first launches, and keep the fastest. The
+  // results are persisted next to the offline cache if that is enabled.
+  bool cuda_tune_block_dim{false};
+  // If nonzero, the size of the ring buffer the kernels print into, drained
+  // by a host thread, see CUDAPrintBuffer. Otherwise print() uses vprintf.
+  int cuda_print_buffer_MB{0};
+  // Split the iterations of the kernels made of a single range-for over
+  // ndarrays between the GPU and the CPU threads, which run them at the same
+  // time. The share of the GPU adapts to the throughput of both sides. The
+  // ndarrays are then allocated in unified memory. See CoExecutedRangeFor.
+  bool cpu_gpu_co_execution{false};
+  // Let the blocks of the struct-fors claim the parts of the elements from
+  // a queue instead of a static slice of the element list, which balances
+  // the lists of very uneven elements, e.g. the particles in a grid. Not
+  // applied to the struct-fors using BLS.
+  bool cuda_dynamic_struct_for{false};
+  // Launch the consecutive serial tasks and small range-for tasks of a
+  // kernel as one kernel, with one block per SM and a grid barrier between
+  // the tasks, instead of one launch each. The barrier assumes that a
+  // kernel is not running on several streams at once.
+  bool cuda_pack_small_tasks{false};
+  // Let the kernels that only read the SNode trees into host memory, e.g.
+  // to_numpy() and the field accessors, wait for the last kernels writing
+  // the trees they read instead of for all the kernels launched so far. They
+  // run on a stream of their own, see CUDAHostReadTracker.
+  bool cuda_fine_grained_host_sync{false};
 
   // C backend options:
   std::string cc_compile_cmd;
@@ -90,6 +262,15 @@ struct CompileConfig {
   int async_flush_every{50};
   // Setting 0 effectively means unlimited
   int async_max_fuse_per_task{1};
+  // Number of CUDA streams the independent tasks of a flush are spread over.
+  int async_cuda_num_streams{1};
+  // Insert and optimize the tasks on a worker thread, so that the host thread
+  // does not block in flushes.
+  bool async_pipeline{false};
+  // Replay the schedule of an earlier flush instead of optimizing the graph
+  // again, when the same tasks are launched after the same retained tasks,
+  // e.g. in each frame of a steady-state loop.
+  bool async_memoize_schedules{false};
 
   bool quant_opt_store_fusion{true};
   bool quant_opt_atomic_demotion{true};
@@ -102,6 +283,10 @@ struct CompileConfig {
   bool mesh_localize_from_end_mapping{false};
   bool mesh_localize_all_attr_mappings{false};
   bool demote_no_access_mesh_fors{true};
+  // Upper bound of the thread-local buffer staging the mappings and
+  // attributes of a patch in a CPU mesh-for, about the L2 cache of a core.
+  // The mappings and attributes that do not fit are read from the fields.
+  int cpu_mesh_bls_max_size_bytes{256 * 1024};
 
   CompileConfig();
 };
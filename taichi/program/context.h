@@ -22,8 +22,19 @@ struct RuntimeContext {
   uint64 args[taichi_max_num_args_total];
   int32 extra_args[taichi_max_num_args_extra][taichi_max_num_indices];
   int32 cpu_thread_id;
+  // The index of the block of iterations run by a CPU range-for task, and the
+  // number of blocks.
+  int32 cpu_task_id{0};
+  int32 cpu_num_tasks{0};
   // |is_device_allocation| is true iff args[i] is a DeviceAllocation*.
   bool is_device_allocation[taichi_max_num_args_total]{false};
+  // The key of the counter-based random number generator, set per launch. See
+  // CompileConfig::counter_based_rand.
+  uint32 rand_seed{0};
+  uint32 rand_launch_id{0};
+  // Where the LLVM kernels store their return values, which is specific to
+  // the launching thread. See Program::get_thread_result_buffer().
+  uint64 *result_buffer{nullptr};
 
   static constexpr size_t extra_args_size = sizeof(extra_args);
 
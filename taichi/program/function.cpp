@@ -32,6 +32,29 @@ void Function::set_function_body(std::unique_ptr<IRNode> func_body) {
                                   /*start_from_ast=*/false);
 }
 
+void Function::set_function_body_lazily(
+    const std::function<void()> &func,
+    const std::vector<DataType> &ret_types) {
+  std::lock_guard<std::mutex> _(lazy_body_mut_);
+  lazy_body_ = func;
+  rets.clear();
+  for (const auto &dt : ret_types) {
+    insert_ret(dt);
+  }
+}
+
+void Function::materialize_body() {
+  std::lock_guard<std::mutex> _(lazy_body_mut_);
+  if (!lazy_body_) {
+    return;
+  }
+  auto func = std::move(lazy_body_);
+  lazy_body_ = nullptr;
+  // Declared again by the body.
+  rets.clear();
+  set_function_body(func);
+}
+
 std::string Function::get_name() const {
   return func_key.get_full_name();
 }
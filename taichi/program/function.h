@@ -1,5 +1,7 @@
 #pragma once
 
+#include <mutex>
+
 #include "taichi/program/callable.h"
 #include "taichi/program/function_key.h"
 
@@ -21,7 +23,22 @@ class Function : public Callable {
   // Set the function body to a CHI IR.
   void set_function_body(std::unique_ptr<IRNode> func_body);
 
+  // Same as set_function_body(func), except that |func| is only called when
+  // the body is needed, i.e., when a call to the function is inlined. The
+  // functions only called from the code removed as dead before inlining are
+  // thus never compiled. |ret_types| are the types of the return values,
+  // which the call sites need before that.
+  void set_function_body_lazily(const std::function<void()> &func,
+                                const std::vector<DataType> &ret_types);
+
+  // Generates the body set by set_function_body_lazily() if it is not yet.
+  void materialize_body();
+
   [[nodiscard]] std::string get_name() const override;
+
+ private:
+  std::mutex lazy_body_mut_;
+  std::function<void()> lazy_body_;
 };
 
 }  // namespace lang
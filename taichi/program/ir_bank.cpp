@@ -13,21 +13,13 @@ namespace {
 
 uint64 hash(IRNode *stmt) {
   TI_ASSERT(stmt);
-  // TODO: upgrade this using IR comparisons
-  std::string serialized;
-  irpass::re_id(stmt);
-  irpass::print(stmt, &serialized);
+  uint64 ret = irpass::analysis::hash(stmt);
 
   // TODO: separate kernel from IR template
   auto *kernel = stmt->get_kernel();
   if (!kernel->args.empty()) {
     // We need to record the kernel's name if it has arguments.
-    serialized += stmt->get_kernel()->name;
-  }
-
-  uint64 ret = 0;
-  for (uint64 i = 0; i < serialized.size(); i++) {
-    ret = ret * 100000007UL + (uint64)serialized[i];
+    ret = hash_combine(ret, stable_hash(kernel->name));
   }
   return ret;
 }
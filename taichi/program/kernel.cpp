@@ -1,14 +1,22 @@
 #include "taichi/program/kernel.h"
 
+#include <algorithm>
+
 #include "taichi/backends/cuda/cuda_driver.h"
+#include "taichi/backends/cuda/cuda_readback.h"
 #include "taichi/codegen/codegen.h"
 #include "taichi/common/task.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir_serializer.h"
 #include "taichi/ir/statements.h"
 #include "taichi/ir/transforms.h"
 #include "taichi/program/async_engine.h"
+#include "taichi/program/co_execution.h"
 #include "taichi/program/extension.h"
 #include "taichi/program/program.h"
+#include "taichi/system/timeline.h"
 #include "taichi/util/action_recorder.h"
+#include "taichi/util/metrics.h"
 #include "taichi/util/statistics.h"
 
 #ifdef TI_WITH_LLVM
@@ -19,11 +27,73 @@ TLANG_NAMESPACE_BEGIN
 
 class Function;
 
+namespace {
+
+// Converts a return value of type |dt|, stored in the bits of |ret|.
+float64 ret_as_float64(DataType dt, uint64 ret) {
+  dt = dt->get_compute_type();
+  if (dt->is_primitive(PrimitiveTypeID::f32)) {
+    return (float64)taichi_union_cast_with_different_sizes<float32>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
+    return (float64)taichi_union_cast_with_different_sizes<float64>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::i32)) {
+    return (float64)taichi_union_cast_with_different_sizes<int32>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::i64)) {
+    return (float64)taichi_union_cast_with_different_sizes<int64>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::i8)) {
+    return (float64)taichi_union_cast_with_different_sizes<int8>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::i16)) {
+    return (float64)taichi_union_cast_with_different_sizes<int16>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::u8)) {
+    return (float64)taichi_union_cast_with_different_sizes<uint8>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::u16)) {
+    return (float64)taichi_union_cast_with_different_sizes<uint16>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::u32)) {
+    return (float64)taichi_union_cast_with_different_sizes<uint32>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::u64)) {
+    return (float64)taichi_union_cast_with_different_sizes<uint64>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::f16)) {
+    // use f32 to interact with python
+    return (float64)taichi_union_cast_with_different_sizes<float32>(ret);
+  } else {
+    TI_NOT_IMPLEMENTED
+  }
+}
+
+int64 ret_as_int64(DataType dt, uint64 ret) {
+  dt = dt->get_compute_type();
+  if (dt->is_primitive(PrimitiveTypeID::i32)) {
+    return (int64)taichi_union_cast_with_different_sizes<int32>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::i64)) {
+    return (int64)taichi_union_cast_with_different_sizes<int64>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::i8)) {
+    return (int64)taichi_union_cast_with_different_sizes<int8>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::i16)) {
+    return (int64)taichi_union_cast_with_different_sizes<int16>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::u8)) {
+    return (int64)taichi_union_cast_with_different_sizes<uint8>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::u16)) {
+    return (int64)taichi_union_cast_with_different_sizes<uint16>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::u32)) {
+    return (int64)taichi_union_cast_with_different_sizes<uint32>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::u64)) {
+    return (int64)taichi_union_cast_with_different_sizes<uint64>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::f32)) {
+    return (int64)taichi_union_cast_with_different_sizes<float32>(ret);
+  } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
+    return (int64)taichi_union_cast_with_different_sizes<float64>(ret);
+  } else {
+    TI_NOT_IMPLEMENTED
+  }
+}
+
+}  // namespace
+
 Kernel::Kernel(Program &program,
                const std::function<void()> &func,
                const std::string &primal_name,
-               bool grad)
-    : grad(grad), lowered_(false) {
+               AutodiffMode autodiff_mode)
+    : autodiff_mode(autodiff_mode), lowered_(false) {
   this->program = &program;
 #ifdef TI_WITH_LLVM
   if (auto *llvm_program_impl = program.get_llvm_program_impl()) {
@@ -48,8 +118,10 @@ Kernel::Kernel(Program &program,
 
   arch = program.config.arch;
 
-  if (!grad) {
+  if (autodiff_mode == AutodiffMode::none) {
     name = primal_name;
+  } else if (autodiff_mode == AutodiffMode::forward) {
+    name = primal_name + "_forward_grad";
   } else {
     name = primal_name + "_grad";
   }
@@ -61,8 +133,8 @@ Kernel::Kernel(Program &program,
 Kernel::Kernel(Program &program,
                std::unique_ptr<IRNode> &&ir,
                const std::string &primal_name,
-               bool grad)
-    : grad(grad), lowered_(false) {
+               AutodiffMode autodiff_mode)
+    : autodiff_mode(autodiff_mode), lowered_(false) {
   this->ir = std::move(ir);
   this->program = &program;
   is_accessor = false;
@@ -73,8 +145,10 @@ Kernel::Kernel(Program &program,
 
   arch = program.config.arch;
 
-  if (!grad) {
+  if (autodiff_mode == AutodiffMode::none) {
     name = primal_name;
+  } else if (autodiff_mode == AutodiffMode::forward) {
+    name = primal_name + "_forward_grad";
   } else {
     name = primal_name + "_grad";
   }
@@ -83,6 +157,8 @@ Kernel::Kernel(Program &program,
     compile();
 }
 
+Kernel::~Kernel() = default;
+
 void Kernel::compile() {
   CurrentCallableGuard _(program, this);
   compiled_ = program->compile(*this);
@@ -107,9 +183,24 @@ void Kernel::lower(bool to_executable) {
     std::cout << std::flush;
   }
 
+  const bool specializable = supports_specialization();
+  const bool co_executable = supports_co_execution();
+  if (specializable || co_executable) {
+    // Keep the IR before any optimization, so that the specializations and
+    // the co-executed variants can be compiled from there.
+    irpass::lower_ast(ir.get());
+    ir_is_ast_ = false;
+    if (co_executable) {
+      co_execution_ = CoExecutedRangeFor::create(this, ir.get());
+    }
+    if (specializable && !co_execution_) {
+      generic_ir_ = irpass::analysis::clone(ir.get());
+    }
+  }
+
   if (to_executable) {
     irpass::compile_to_executable(
-        ir.get(), config, this, /*vectorize*/ arch_is_cpu(arch), grad,
+        ir.get(), config, this, /*vectorize*/ arch_is_cpu(arch), autodiff_mode,
         /*ad_use_stack=*/true, verbose, /*lower_global_access=*/to_executable,
         /*make_thread_local=*/config.make_thread_local,
         /*make_block_local=*/
@@ -118,7 +209,7 @@ void Kernel::lower(bool to_executable) {
         /*start_from_ast=*/ir_is_ast_);
   } else {
     irpass::compile_to_offloads(ir.get(), config, this, verbose,
-                                /*vectorize=*/arch_is_cpu(arch), grad,
+                                /*vectorize=*/arch_is_cpu(arch), autodiff_mode,
                                 /*ad_use_stack=*/true,
                                 /*start_from_ast=*/ir_is_ast_);
   }
@@ -126,17 +217,82 @@ void Kernel::lower(bool to_executable) {
   lowered_ = true;
 }
 
+std::optional<std::vector<uint8>> Kernel::lower_ast_and_serialize() {
+  // Reverse-mode autodiff starts from the AST, and the specializations and
+  // the co-executed variants are made while lowering it.
+  if (!ir_is_ast_ || lowered_ || autodiff_mode != AutodiffMode::none ||
+      supports_specialization() || supports_co_execution()) {
+    return std::nullopt;
+  }
+  CurrentCallableGuard _(program, this);
+  irpass::lower_ast(ir.get());
+  ir_is_ast_ = false;
+  return serialize_ir_binary(ir->as<Block>(), args, rets);
+}
+
 void Kernel::operator()(LaunchContextBuilder &ctx_builder) {
+  TI_TIMELINE(name);
+  static auto &launches =
+      metrics().counter("taichi_kernel_launches", "Kernel launches.");
+  launches.add();
+  if (ctx_builder.get_creation_time() > 0) {
+    // Setting the arguments, which is most of the launch overhead in Python.
+    auto &timeline = Timeline::get_this_thread_instance();
+    timeline.insert_span(name + " (set args)",
+                         ctx_builder.get_creation_time(), Time::get_time(),
+                         timeline.get_name());
+  }
+  auto &ctx = ctx_builder.get_context();
+  ctx.rand_seed = program->config.random_seed;
+  ctx.rand_launch_id = program->num_rand_launches++;
+  ctx.result_buffer = program->get_thread_result_buffer();
+
+  auto *advisor = program->layout_advisor.get();
+  auto *report = program->access_pattern_report.get();
   if (!program->config.async_mode || this->is_evaluator) {
-    if (!compiled_) {
-      compile();
+    auto *target = this;
+    {
+      std::lock_guard<std::mutex> _(launch_mut_);
+      if (!compiled_) {
+        compile();
+      }
+      if (generic_ir_) {
+        target = get_specialization(ctx_builder.get_context());
+        if (!target->compiled_) {
+          target->compile();
+        }
+      }
+      if (!target->snode_tree_writes_gathered_) {
+        const auto accesses =
+            irpass::analysis::gather_snode_tree_accesses(target->ir.get());
+        target->written_snode_trees_.assign(accesses.written_trees.begin(),
+                                            accesses.written_trees.end());
+        target->writes_unknown_snode_trees_ = accesses.writes_unknown;
+        target->snode_tree_writes_gathered_ = true;
+      }
+    }
+    if (!target->written_snode_trees_.empty() ||
+        target->writes_unknown_snode_trees_) {
+      program->record_snode_tree_writes(target->written_snode_trees_,
+                                        target->writes_unknown_snode_trees_);
+    }
+
+    if (target == this && co_execution_ &&
+        co_execution_->launch(ctx_builder.get_context())) {
+      return;
     }
 
-    for (auto &offloaded : ir->as<Block>()->statements) {
+    for (auto &offloaded : target->ir->as<Block>()->statements) {
       account_for_offloaded(offloaded->as<OffloadedStmt>());
     }
+    if (advisor) {
+      advisor->record_launch(target);
+    }
+    if (report) {
+      report->record_launch(target);
+    }
 
-    compiled_(ctx_builder.get_context());
+    target->compiled_(ctx_builder.get_context());
 
     program->sync = (program->sync && arch_is_cpu(arch));
     // Note that Kernel::arch may be different from program.config.arch
@@ -146,7 +302,15 @@ void Kernel::operator()(LaunchContextBuilder &ctx_builder) {
     }
   } else {
     program->sync = false;
+    // The tasks are not known until the async engine runs them.
+    program->record_snode_tree_writes({}, /*unknown=*/true);
     program->async_engine->launch(this, ctx_builder.get_context());
+    if (advisor) {
+      advisor->record_launch(this);
+    }
+    if (report) {
+      report->record_launch(this);
+    }
     // Note that Kernel::arch may be different from program.config.arch
     if (program->config.debug && arch_is_cpu(arch) &&
         arch_is_cpu(program->config.arch)) {
@@ -168,6 +332,9 @@ Kernel::LaunchContextBuilder::LaunchContextBuilder(Kernel *kernel)
     : kernel_(kernel),
       owned_ctx_(std::make_unique<RuntimeContext>()),
       ctx_(owned_ctx_.get()) {
+  if (Timelines::get_instance().get_enabled()) {
+    creation_time_ = Time::get_time();
+  }
 }
 
 void Kernel::LaunchContextBuilder::set_arg_float(int arg_id, float64 d) {
@@ -201,7 +368,8 @@ void Kernel::LaunchContextBuilder::set_arg_float(int arg_id, float64 d) {
     ctx_->set_arg(arg_id, (uint32)d);
   } else if (dt->is_primitive(PrimitiveTypeID::u64)) {
     ctx_->set_arg(arg_id, (uint64)d);
-  } else if (dt->is_primitive(PrimitiveTypeID::f16)) {
+  } else if (dt->is_primitive(PrimitiveTypeID::f16) ||
+             dt->is_primitive(PrimitiveTypeID::bf16)) {
     // use f32 to interact with python
     ctx_->set_arg(arg_id, (float32)d);
   } else {
@@ -266,6 +434,15 @@ void Kernel::LaunchContextBuilder::set_arg_external_array(
   ctx_->set_device_allocation(arg_id, is_device_allocation);
 }
 
+void Kernel::LaunchContextBuilder::set_arg_texture(int arg_id,
+                                                   uint64 alloc_ptr) {
+  TI_ASSERT_INFO(kernel_->args[arg_id].is_texture,
+                 "Assigning a texture to a non-texture argument is not "
+                 "allowed.");
+  ctx_->set_arg(arg_id, alloc_ptr);
+  ctx_->set_device_allocation(arg_id, true);
+}
+
 void Kernel::LaunchContextBuilder::set_arg_raw(int arg_id, uint64 d) {
   TI_ASSERT_INFO(!kernel_->args[arg_id].is_external_array,
                  "Assigning scalar value to external (numpy) array argument is "
@@ -283,67 +460,126 @@ void Kernel::LaunchContextBuilder::set_arg_raw(int arg_id, uint64 d) {
 RuntimeContext &Kernel::LaunchContextBuilder::get_context() {
 #ifdef TI_WITH_LLVM
   if (auto *llvm_program_impl = kernel_->program->get_llvm_program_impl()) {
-    ctx_->runtime = llvm_program_impl->get_llvm_runtime();
+    ctx_->runtime = llvm_program_impl->get_llvm_runtime(kernel_->arch);
   }
 #endif
   return *ctx_;
 }
 
-float64 Kernel::get_ret_float(int i) {
-  auto dt = rets[i].dt->get_compute_type();
-  if (dt->is_primitive(PrimitiveTypeID::f32)) {
-    return (float64)program->fetch_result<float32>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
-    return (float64)program->fetch_result<float64>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::i32)) {
-    return (float64)program->fetch_result<int32>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::i64)) {
-    return (float64)program->fetch_result<int64>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::i8)) {
-    return (float64)program->fetch_result<int8>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::i16)) {
-    return (float64)program->fetch_result<int16>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::u8)) {
-    return (float64)program->fetch_result<uint8>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::u16)) {
-    return (float64)program->fetch_result<uint16>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::u32)) {
-    return (float64)program->fetch_result<uint32>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::u64)) {
-    return (float64)program->fetch_result<uint64>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::f16)) {
-    // use f32 to interact with python
-    return (float64)program->fetch_result<float32>(i);
-  } else {
-    TI_NOT_IMPLEMENTED
+Kernel::BoundLauncher::BoundLauncher(Kernel *kernel,
+                                     const std::vector<int> &scalar_arg_ids)
+    : kernel_(kernel), builder_(kernel), scalar_arg_ids_(scalar_arg_ids) {
+  for (int arg_id : scalar_arg_ids_) {
+    TI_ASSERT(!kernel_->args[arg_id].is_external_array);
+    scalar_is_real_.push_back(is_real(kernel_->args[arg_id].dt));
   }
 }
 
-int64 Kernel::get_ret_int(int i) {
-  auto dt = rets[i].dt->get_compute_type();
-  if (dt->is_primitive(PrimitiveTypeID::i32)) {
-    return (int64)program->fetch_result<int32>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::i64)) {
-    return (int64)program->fetch_result<int64>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::i8)) {
-    return (int64)program->fetch_result<int8>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::i16)) {
-    return (int64)program->fetch_result<int16>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::u8)) {
-    return (int64)program->fetch_result<uint8>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::u16)) {
-    return (int64)program->fetch_result<uint16>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::u32)) {
-    return (int64)program->fetch_result<uint32>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::u64)) {
-    return (int64)program->fetch_result<uint64>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::f32)) {
-    return (int64)program->fetch_result<float32>(i);
-  } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
-    return (int64)program->fetch_result<float64>(i);
+void Kernel::BoundLauncher::begin_launch() {
+  if (Timelines::get_instance().get_enabled()) {
+    builder_.creation_time_ = Time::get_time();
+  }
+}
+
+void Kernel::BoundLauncher::set_scalar_float(int i, float64 d) {
+  builder_.set_arg_float(scalar_arg_ids_[i], d);
+}
+
+void Kernel::BoundLauncher::set_scalar_int(int i, int64 d) {
+  builder_.set_arg_int(scalar_arg_ids_[i], d);
+}
+
+void Kernel::BoundLauncher::set_arg_external_array(int arg_id,
+                                                   uint64 ptr,
+                                                   uint64 size,
+                                                   bool is_device_allocation) {
+  ExternalArray array{arg_id, ptr, size, is_device_allocation};
+  auto it = std::find_if(
+      external_arrays_.begin(), external_arrays_.end(),
+      [arg_id](const ExternalArray &a) { return a.arg_id == arg_id; });
+  if (it == external_arrays_.end()) {
+    external_arrays_.push_back(array);
   } else {
-    TI_NOT_IMPLEMENTED
+    *it = array;
+  }
+}
+
+void Kernel::BoundLauncher::set_extra_arg_int(int i, int j, int32 d) {
+  builder_.set_extra_arg_int(i, j, d);
+}
+
+void Kernel::BoundLauncher::launch() {
+  for (const auto &array : external_arrays_) {
+    // This also restores the size of the array in |kernel_->args|, which the
+    // other launches of the kernel may have changed.
+    builder_.set_arg_external_array(array.arg_id, array.ptr, array.size,
+                                    array.is_device_allocation);
+  }
+  (*kernel_)(builder_);
+}
+
+std::unique_ptr<Kernel::ReturnFuture> Kernel::BoundLauncher::launch_async() {
+  launch();
+  return std::make_unique<ReturnFuture>(kernel_);
+}
+
+Kernel::ReturnFuture::ReturnFuture(Kernel *kernel)
+    : kernel_(kernel), values_(kernel->rets.size()) {
+  auto *program = kernel->program;
+#if defined(TI_WITH_CUDA)
+  if (kernel->arch == Arch::cuda && !program->config.async_mode &&
+      !program->last_launch_was_host_read()) {
+    // Each thread launches on its own stream into its own result buffer,
+    // which is only overwritten by its next launches.
+    readback_ = std::make_unique<CUDAReadback>(
+        (uint64)program->get_thread_result_buffer(),
+        values_.size() * sizeof(uint64));
+    return;
+  }
+#endif
+  program->synchronize_host_read();
+  for (int i = 0; i < (int)values_.size(); i++) {
+    values_[i] = program->fetch_result_uint64(i);
+  }
+}
+
+Kernel::ReturnFuture::~ReturnFuture() = default;
+
+bool Kernel::ReturnFuture::done() {
+#if defined(TI_WITH_CUDA)
+  if (readback_) {
+    return readback_->is_ready();
+  }
+#endif
+  return true;
+}
+
+void Kernel::ReturnFuture::wait() {
+#if defined(TI_WITH_CUDA)
+  if (readback_) {
+    readback_->copy_to((uint64)values_.data(),
+                       values_.size() * sizeof(uint64));
+    readback_.reset();
   }
+#endif
+}
+
+int64 Kernel::ReturnFuture::get_int(int i) {
+  wait();
+  return ret_as_int64(kernel_->rets[i].dt, values_[i]);
+}
+
+float64 Kernel::ReturnFuture::get_float(int i) {
+  wait();
+  return ret_as_float64(kernel_->rets[i].dt, values_[i]);
+}
+
+float64 Kernel::get_ret_float(int i) {
+  return ret_as_float64(rets[i].dt, program->fetch_result_uint64(i));
+}
+
+int64 Kernel::get_ret_int(int i) {
+  return ret_as_int64(rets[i].dt, program->fetch_result_uint64(i));
 }
 
 void Kernel::set_arch(Arch arch) {
@@ -382,6 +618,107 @@ std::string Kernel::get_name() const {
   return name;
 }
 
+namespace {
+
+// At most this many specializations are compiled for each kernel.
+constexpr int kMaxNumSpecializations = 4;
+
+bool is_specializable_arg(const Kernel::Arg &arg) {
+  if (arg.is_external_array) {
+    return false;
+  }
+  return arg.dt->is_primitive(PrimitiveTypeID::i32) ||
+         arg.dt->is_primitive(PrimitiveTypeID::i64) ||
+         arg.dt->is_primitive(PrimitiveTypeID::f32) ||
+         arg.dt->is_primitive(PrimitiveTypeID::f64);
+}
+
+}  // namespace
+
+bool Kernel::supports_specialization() const {
+  const auto &config = program->config;
+  // The specializations are compiled lazily, after their arguments are set.
+  if (config.kernel_specialization_launches <= 0 ||
+      !config.lazy_compilation || config.async_mode || !ir_is_ast_ ||
+      autodiff_mode != AutodiffMode::none || is_accessor || is_evaluator) {
+    return false;
+  }
+  return std::any_of(args.begin(), args.end(), is_specializable_arg);
+}
+
+bool Kernel::supports_co_execution() const {
+  const auto &config = program->config;
+  return config.cpu_gpu_co_execution && arch == Arch::cuda &&
+         config.lazy_compilation && !config.async_mode && ir_is_ast_ &&
+         autodiff_mode == AutodiffMode::none && !is_accessor && !is_evaluator;
+}
+
+Kernel *Kernel::get_specialization(RuntimeContext &ctx) {
+  std::vector<uint64> values;
+  for (int i = 0; i < (int)args.size(); i++) {
+    if (is_specializable_arg(args[i])) {
+      values.push_back(ctx.get_arg_as_uint64(i));
+    }
+  }
+  for (auto &[key, kernel] : specializations_) {
+    if (key == values) {
+      stat.add("launched_specializations", 1.0);
+      return kernel.get();
+    }
+  }
+  if (values == last_specializable_args_) {
+    num_identical_launches_++;
+  } else {
+    last_specializable_args_ = values;
+    num_identical_launches_ = 1;
+  }
+  if (num_identical_launches_ <
+          program->config.kernel_specialization_launches ||
+      (int)specializations_.size() >= kMaxNumSpecializations) {
+    return this;
+  }
+  specializations_.emplace_back(std::move(values), make_specialization(ctx));
+  stat.add("compiled_specializations", 1.0);
+  stat.add("launched_specializations", 1.0);
+  return specializations_.back().second.get();
+}
+
+std::unique_ptr<Kernel> Kernel::make_specialization(RuntimeContext &ctx) {
+  auto specialized_ir = irpass::analysis::clone(generic_ir_.get());
+  irpass::replace_and_insert_statements(
+      specialized_ir.get(),
+      /*filter=*/
+      [&](Stmt *s) {
+        auto arg_load = s->cast<ArgLoadStmt>();
+        return arg_load && !arg_load->is_ptr &&
+               is_specializable_arg(args[arg_load->arg_id]);
+      },
+      /*generator=*/
+      [&](Stmt *s) {
+        const int arg_id = s->as<ArgLoadStmt>()->arg_id;
+        const auto dt = args[arg_id].dt;
+        TypedConstant value;
+        if (dt->is_primitive(PrimitiveTypeID::i32)) {
+          value = TypedConstant(ctx.get_arg<int32>(arg_id));
+        } else if (dt->is_primitive(PrimitiveTypeID::i64)) {
+          value = TypedConstant(ctx.get_arg<int64>(arg_id));
+        } else if (dt->is_primitive(PrimitiveTypeID::f32)) {
+          value = TypedConstant(ctx.get_arg<float32>(arg_id));
+        } else {
+          value = TypedConstant(ctx.get_arg<float64>(arg_id));
+        }
+        return Stmt::make<ConstStmt>(LaneAttribute<TypedConstant>(value));
+      });
+  auto kernel = std::make_unique<Kernel>(
+      *program, std::move(specialized_ir),
+      fmt::format("{}_specialized{}", name, specializations_.size()));
+  kernel->args = args;
+  kernel->rets = rets;
+  kernel->arch = arch;
+  TI_TRACE("Specializing kernel {} on its scalar arguments", name);
+  return kernel;
+}
+
 // static
 bool Kernel::supports_lowering(Arch arch) {
   return arch_is_cpu(arch) || (arch == Arch::cuda) || (arch == Arch::metal);
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <mutex>
+#include <optional>
+
 #include "taichi/lang_util.h"
 #include "taichi/ir/snode.h"
 #include "taichi/ir/ir.h"
@@ -8,6 +11,8 @@
 
 TLANG_NAMESPACE_BEGIN
 
+class CoExecutedRangeFor;
+class CUDAReadback;
 class Program;
 
 class Kernel : public Callable {
@@ -18,7 +23,37 @@ class Kernel : public Callable {
 
   bool is_accessor{false};
   bool is_evaluator{false};
-  bool grad{false};
+  AutodiffMode autodiff_mode{AutodiffMode::none};
+
+  class BoundLauncher;
+
+  // The return values of a launch, copied into host memory once the launch
+  // is done, without the launching thread waiting for it on CUDA. Created
+  // right after the launch, on its thread. See BoundLauncher::launch_async().
+  class ReturnFuture {
+   public:
+    explicit ReturnFuture(Kernel *kernel);
+
+    ~ReturnFuture();
+
+    ReturnFuture(const ReturnFuture &) = delete;
+    ReturnFuture &operator=(const ReturnFuture &) = delete;
+
+    // Whether the values are available, i.e. get_*() would not block.
+    bool done();
+
+    void wait();
+
+    int64 get_int(int i);
+
+    float64 get_float(int i);
+
+   private:
+    Kernel *kernel_;
+    // On CUDA, copies the values into |values_| once they are used.
+    std::unique_ptr<CUDAReadback> readback_;
+    std::vector<uint64> values_;
+  };
 
   class LaunchContextBuilder {
    public:
@@ -45,9 +80,20 @@ class Kernel : public Callable {
     // This ignores the underlying kernel's |arg_id|-th arg type.
     void set_arg_raw(int arg_id, uint64 d);
 
+    // |alloc_ptr| is the address of the DeviceAllocation of the texture.
+    void set_arg_texture(int arg_id, uint64 alloc_ptr);
+
     RuntimeContext &get_context();
 
+    // When the arguments started to be set, if the timeline is enabled, and 0
+    // otherwise.
+    float64 get_creation_time() const {
+      return creation_time_;
+    }
+
    private:
+    friend class BoundLauncher;
+
     Kernel *kernel_;
     std::unique_ptr<RuntimeContext> owned_ctx_;
     // |ctx_| *almost* always points to |owned_ctx_|. However, it is possible
@@ -55,17 +101,74 @@ class Kernel : public Callable {
     // |owned_ctx_| will be nullptr.
     // Invariant: |ctx_| will never be nullptr.
     RuntimeContext *ctx_;
+    float64 creation_time_{0};
+  };
+
+  // Launches this kernel repeatedly with one RuntimeContext, for the bound
+  // launchers in Python, see Kernel.bind() in kernel_impl.py. The scalar
+  // arguments are set before each launch, while the external arrays are
+  // kept. Since launching may rewrite the external arrays in the context,
+  // e.g. to the device copies of host arrays on CUDA, they are set again
+  // before each launch from the values cached here.
+  class BoundLauncher {
+   public:
+    BoundLauncher(Kernel *kernel, const std::vector<int> &scalar_arg_ids);
+
+    int num_scalars() const {
+      return (int)scalar_arg_ids_.size();
+    }
+
+    bool scalar_is_real(int i) const {
+      return scalar_is_real_[i];
+    }
+
+    // Starts setting the arguments of the next launch, for the timeline.
+    void begin_launch();
+
+    // Sets the |i|-th of the |scalar_arg_ids| passed to the constructor.
+    void set_scalar_float(int i, float64 d);
+
+    void set_scalar_int(int i, int64 d);
+
+    void set_arg_external_array(int arg_id,
+                                uint64 ptr,
+                                uint64 size,
+                                bool is_device_allocation);
+
+    void set_extra_arg_int(int i, int j, int32 d);
+
+    void launch();
+
+    // Launches, and returns the future return values instead of waiting for
+    // them.
+    std::unique_ptr<ReturnFuture> launch_async();
+
+   private:
+    struct ExternalArray {
+      int arg_id{0};
+      uint64 ptr{0};
+      uint64 size{0};
+      bool is_device_allocation{false};
+    };
+
+    Kernel *kernel_;
+    LaunchContextBuilder builder_;
+    std::vector<int> scalar_arg_ids_;
+    std::vector<bool> scalar_is_real_;
+    std::vector<ExternalArray> external_arrays_;
   };
 
   Kernel(Program &program,
          const std::function<void()> &func,
          const std::string &name = "",
-         bool grad = false);
+         AutodiffMode autodiff_mode = AutodiffMode::none);
 
   Kernel(Program &program,
          std::unique_ptr<IRNode> &&ir,
          const std::string &name = "",
-         bool grad = false);
+         AutodiffMode autodiff_mode = AutodiffMode::none);
+
+  ~Kernel() override;
 
   bool lowered() const {
     return lowered_;
@@ -81,6 +184,15 @@ class Kernel : public Callable {
    */
   void lower(bool to_executable = true);
 
+  /**
+   * Lowers the frontend AST of this kernel to CHI IR, and serializes it with
+   * the arguments and return values (see ir_serializer.h), so that later runs
+   * can skip the frontend with Program::load_kernel().
+   *
+   * @return std::nullopt if this kernel cannot be restored that way.
+   */
+  std::optional<std::vector<uint8>> lower_ast_and_serialize();
+
   void operator()(LaunchContextBuilder &ctx_builder);
 
   LaunchContextBuilder make_launch_context();
@@ -103,6 +215,19 @@ class Kernel : public Callable {
   static bool supports_lowering(Arch arch);
 
  private:
+  // Profile-guided specialization on the scalar arguments, see
+  // CompileConfig::kernel_specialization_launches.
+  bool supports_specialization() const;
+
+  // Returns the kernel to launch for the arguments in |ctx|: either a
+  // specialization of this kernel, or this kernel itself.
+  Kernel *get_specialization(RuntimeContext &ctx);
+
+  std::unique_ptr<Kernel> make_specialization(RuntimeContext &ctx);
+
+  // See CompileConfig::cpu_gpu_co_execution.
+  bool supports_co_execution() const;
+
   // True if |ir| is a frontend AST. False if it's already offloaded to CHI IR.
   bool ir_is_ast_{false};
   // The closure that, if invoked, lauches the backend kernel (shader)
@@ -111,6 +236,26 @@ class Kernel : public Callable {
   // lower inital AST all the way down to a bunch of
   // OffloadedStmt for async execution
   bool lowered_{false};
+
+  // The IR right after lowering the AST, from which the specializations are
+  // compiled. Null if this kernel is never specialized.
+  std::unique_ptr<IRNode> generic_ir_;
+  // The specializable arguments of the last launches, and how many
+  // consecutive launches they have been the same.
+  std::vector<uint64> last_specializable_args_;
+  int num_identical_launches_{0};
+  std::vector<std::pair<std::vector<uint64>, std::unique_ptr<Kernel>>>
+      specializations_;
+  // Null unless this kernel is co-executed on the CPU and GPU.
+  std::unique_ptr<CoExecutedRangeFor> co_execution_;
+  // Serializes compiling this kernel and picking its specialization, which
+  // happen on the launching threads.
+  std::mutex launch_mut_;
+  // The SNode trees the compiled kernel may write, gathered on its first
+  // launch, see Program::record_snode_tree_writes().
+  bool snode_tree_writes_gathered_{false};
+  std::vector<int> written_snode_trees_;
+  bool writes_unknown_snode_trees_{false};
 };
 
 TLANG_NAMESPACE_END
@@ -3,6 +3,7 @@
 #include "taichi/system/timer.h"
 #include "taichi/backends/cuda/cuda_driver.h"
 #include "taichi/backends/cuda/cuda_profiler.h"
+#include "taichi/system/threading.h"
 #include "taichi/system/timeline.h"
 
 TLANG_NAMESPACE_BEGIN
@@ -34,6 +35,27 @@ void KernelProfilerBase::profiler_stop(KernelProfilerBase *profiler) {
   profiler->stop();
 }
 
+void KernelProfilerBase::insert_record(const std::string &kernel_name,
+                                       double elapsed_ms) {
+  // trace record
+  KernelProfileTracedRecord record;
+  record.name = kernel_name;
+  record.kernel_elapsed_time_in_ms = elapsed_ms;
+  traced_records_.push_back(record);
+  // count record
+  auto it =
+      std::find_if(statistical_results_.begin(), statistical_results_.end(),
+                   [&](KernelProfileStatisticalResult &r) {
+                     return r.name == kernel_name;
+                   });
+  if (it == statistical_results_.end()) {
+    statistical_results_.emplace_back(kernel_name);
+    it = std::prev(statistical_results_.end());
+  }
+  it->insert_record(elapsed_ms);
+  total_time_ms_ += elapsed_ms;
+}
+
 // TODO : deprecated
 void KernelProfilerBase::query(const std::string &kernel_name,
                                int &counter,
@@ -79,36 +101,49 @@ class DefaultProfiler : public KernelProfilerBase {
     statistical_results_.clear();
   }
 
+  void set_thread_pool(ThreadPool *thread_pool) override {
+    thread_pool_ = thread_pool;
+    thread_pool_->set_profiling(true);
+  }
+
   void start(const std::string &kernel_name) override {
+    if (thread_pool_) {
+      // E.g. the jobs of the sparse matrices, not of a task.
+      thread_pool_->fetch_job_profiles();
+    }
     start_t_ = Time::get_time();
     event_name_ = kernel_name;
   }
 
   void stop() override {
-    auto t = Time::get_time() - start_t_;
+    const auto end_t = Time::get_time();
+    auto t = end_t - start_t_;
     auto ms = t * 1000.0;
-    // trace record
-    KernelProfileTracedRecord record;
-    record.name = event_name_;
-    record.kernel_elapsed_time_in_ms = ms;
-    traced_records_.push_back(record);
-    // count record
-    auto it =
-        std::find_if(statistical_results_.begin(), statistical_results_.end(),
-                     [&](KernelProfileStatisticalResult &r) {
-                       return r.name == event_name_;
-                     });
-    if (it == statistical_results_.end()) {
-      statistical_results_.emplace_back(event_name_);
-      it = std::prev(statistical_results_.end());
+    // The device time on the CPU backends, which run the kernels on the
+    // launching thread.
+    Timeline::get_this_thread_instance().insert_span(event_name_, start_t_,
+                                                     end_t, "kernels");
+    insert_record(event_name_, ms);
+    if (thread_pool_) {
+      // Serial tasks do not use the pool. A struct-for may run several jobs,
+      // whose worst imbalance and wake-up are kept.
+      auto &record = traced_records_.back();
+      for (auto &job : thread_pool_->fetch_job_profiles()) {
+        record.num_threads =
+            std::max(record.num_threads, (int)job.threads.size());
+        record.imbalance_ratio = std::max(record.imbalance_ratio,
+                                          (float)job.get_imbalance_ratio());
+        record.wakeup_latency_ms =
+            std::max(record.wakeup_latency_ms,
+                     (float)(job.get_max_wakeup_latency() * 1000.0));
+      }
     }
-    it->insert_record(ms);
-    total_time_ms_ += ms;
   }
 
  private:
   double start_t_;
   std::string event_name_;
+  ThreadPool *thread_pool_{nullptr};
 };
 
 }  // namespace
@@ -123,6 +158,8 @@ std::unique_ptr<KernelProfilerBase> make_profiler(Arch arch, bool enable) {
     TI_NOT_IMPLEMENTED;
 #endif
   } else {
+    // On Vulkan, Metal and OpenGL, the runtime times the tasks on the GPU and
+    // calls insert_record() instead of start() and stop().
     return std::make_unique<DefaultProfiler>();
   }
 }
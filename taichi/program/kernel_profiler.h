@@ -10,15 +10,29 @@
 #include <memory>
 #include <regex>
 
+namespace taichi {
+class ThreadPool;
+}  // namespace taichi
+
 TLANG_NAMESPACE_BEGIN
 
 struct KernelProfileTracedRecord {
   // kernel attributes
   int register_per_thread{0};
+  // Spilled registers and local arrays.
+  int local_mem_per_thread{0};
   int shared_mem_per_block{0};
   int grid_size{0};
   int block_size{0};
   int active_blocks_per_multiprocessor{0};
+  // The fraction of the threads a multiprocessor can hold that are active.
+  float occupancy{0.0};
+  // On the CPU backends: the threads of the ThreadPool that executed the
+  // task, the busy time of the busiest one over the mean one, and the longest
+  // time a worker took to start on it. See ThreadPool::JobProfile.
+  int num_threads{0};
+  float imbalance_ratio{0.0};
+  float wakeup_latency_ms{0.0};
   // kernel time
   float kernel_elapsed_time_in_ms{0.0};
   float time_since_base{0.0};        // for Timeline
@@ -57,6 +71,10 @@ class KernelProfilerBase {
     return false;
   };  // public API for all backend, do not use TI_NOT_IMPLEMENTED;
 
+  // Profiles the jobs of the pool running the tasks on the CPU backends.
+  virtual void set_thread_pool(ThreadPool *thread_pool) {
+  }
+
   virtual void clear() = 0;
 
   virtual void sync() = 0;
@@ -76,6 +94,10 @@ class KernelProfilerBase {
 
   static void profiler_stop(KernelProfilerBase *profiler);
 
+  // Adds a kernel, or a task of it, timed by the backend itself, e.g. with
+  // the timestamp queries of the GPU on Vulkan, Metal and OpenGL.
+  void insert_record(const std::string &kernel_name, double elapsed_ms);
+
   void query(const std::string &kernel_name,
              int &counter,
              double &min,
@@ -0,0 +1,173 @@
+#include "taichi/program/layout_advisor.h"
+
+#include <algorithm>
+#include <map>
+#include <unordered_set>
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/snode.h"
+#include "taichi/ir/statements.h"
+#include "taichi/program/kernel.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+// Fields accessed together at least this often are worth grouping.
+constexpr float64 kGroupRatio = 0.9;
+// Grouped fields accessed together at most this often are worth splitting.
+constexpr float64 kSplitRatio = 0.25;
+
+std::string field_name(const SNode *snode) {
+  if (snode->name.empty()) {
+    return snode->get_node_type_name_hinted();
+  }
+  return fmt::format("{} ({})", snode->name,
+                     snode->get_node_type_name_hinted());
+}
+
+bool can_be_regrouped(const SNode *snode) {
+  const auto type = snode->parent ? snode->parent->type : SNodeType::undefined;
+  return type == SNodeType::dense || type == SNodeType::pointer ||
+         type == SNodeType::bitmasked;
+}
+
+bool same_shape(const SNode *a, const SNode *b) {
+  if (a->num_active_indices != b->num_active_indices) {
+    return false;
+  }
+  for (int i = 0; i < a->num_active_indices; i++) {
+    if (a->shape_along_axis(i) != b->shape_along_axis(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+void LayoutAdvisor::record_tasks(const Kernel *kernel, IRNode *root) {
+  std::vector<std::vector<SNode *>> tasks;
+  auto record_task = [&](IRNode *task) {
+    const auto [reads, writes] =
+        irpass::analysis::gather_snode_read_writes(task);
+    std::unordered_set<SNode *> accessed(reads.begin(), reads.end());
+    accessed.insert(writes.begin(), writes.end());
+    std::vector<SNode *> fields;
+    for (auto *snode : accessed) {
+      if (snode->is_place() && can_be_regrouped(snode)) {
+        fields.push_back(snode);
+      }
+    }
+    if (!fields.empty()) {
+      std::sort(fields.begin(), fields.end(),
+                [](SNode *a, SNode *b) { return a->id < b->id; });
+      tasks.push_back(std::move(fields));
+    }
+  };
+  if (auto block = root->cast<Block>()) {
+    for (auto &stmt : block->statements) {
+      record_task(stmt.get());
+    }
+  } else {
+    record_task(root);
+  }
+  std::lock_guard<std::mutex> _(mut_);
+  auto &record = kernels_[kernel];
+  record.name = kernel->get_name();
+  for (auto &fields : tasks) {
+    record.tasks.push_back(std::move(fields));
+  }
+}
+
+void LayoutAdvisor::record_launch(const Kernel *kernel) {
+  std::lock_guard<std::mutex> _(mut_);
+  if (auto it = kernels_.find(kernel); it != kernels_.end()) {
+    it->second.launches++;
+  }
+}
+
+std::vector<std::string> LayoutAdvisor::get_advice() {
+  std::lock_guard<std::mutex> _(mut_);
+  // The number of task launches accessing each field, and each pair of
+  // fields.
+  std::unordered_map<SNode *, int64> weights;
+  std::map<std::pair<SNode *, SNode *>, int64> pair_weights;
+  for (auto &[kernel, record] : kernels_) {
+    if (record.launches == 0) {
+      continue;
+    }
+    for (auto &fields : record.tasks) {
+      for (int i = 0; i < (int)fields.size(); i++) {
+        weights[fields[i]] += record.launches;
+        for (int j = i + 1; j < (int)fields.size(); j++) {
+          pair_weights[{fields[i], fields[j]}] += record.launches;
+        }
+      }
+    }
+  }
+
+  struct Advice {
+    int64 weight;
+    std::string message;
+  };
+  std::vector<Advice> advice;
+  std::vector<SNode *> fields;
+  for (auto &w : weights) {
+    fields.push_back(w.first);
+  }
+  std::sort(fields.begin(), fields.end(),
+            [](SNode *a, SNode *b) { return a->id < b->id; });
+  for (int i = 0; i < (int)fields.size(); i++) {
+    for (int j = i + 1; j < (int)fields.size(); j++) {
+      auto *a = fields[i], *b = fields[j];
+      int64 together = 0;
+      if (auto it = pair_weights.find({a, b}); it != pair_weights.end()) {
+        together = it->second;
+      }
+      const int64 max_weight = std::max(weights[a], weights[b]);
+      const float64 ratio = (float64)together / max_weight;
+      if (a->parent == b->parent) {
+        if (ratio <= kSplitRatio) {
+          advice.push_back(
+              {max_weight,
+               fmt::format("Place {} and {} in separate SNodes (SoA): they "
+                           "share {} but only {:.0f}% of the task launches "
+                           "accessing them access both",
+                           field_name(a), field_name(b),
+                           a->parent->get_node_type_name_hinted(),
+                           ratio * 100)});
+        }
+      } else if (ratio >= kGroupRatio && same_shape(a, b)) {
+        advice.push_back(
+            {max_weight,
+             fmt::format("Place {} and {} in the same SNode (AoS): {:.0f}% of "
+                         "the task launches accessing them access both",
+                         field_name(a), field_name(b), ratio * 100)});
+      }
+    }
+  }
+  std::stable_sort(advice.begin(), advice.end(),
+                   [](const Advice &a, const Advice &b) {
+                     return a.weight > b.weight;
+                   });
+  std::vector<std::string> result;
+  for (auto &a : advice) {
+    result.push_back(std::move(a.message));
+  }
+  return result;
+}
+
+void LayoutAdvisor::print() {
+  const auto advice = get_advice();
+  fmt::print("{:=^80}\n", " Layout Advisor ");
+  if (advice.empty()) {
+    fmt::print("No suggestions.\n");
+  }
+  for (auto &line : advice) {
+    fmt::print("* {}\n", line);
+  }
+  fmt::print("{:=^80}\n", "");
+}
+
+TLANG_NAMESPACE_END
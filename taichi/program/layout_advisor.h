@@ -0,0 +1,54 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "taichi/common/core.h"
+
+TLANG_NAMESPACE_BEGIN
+
+class IRNode;
+class Kernel;
+class SNode;
+
+/**
+ * Suggests how to group the fields, based on which ones the offloaded tasks
+ * access together. Enabled by CompileConfig::layout_advisor.
+ *
+ * Each task is weighted by the number of launches of its kernel. Two fields
+ * placed side by side (AoS) but mostly accessed apart waste memory bandwidth,
+ * while two fields with the same shape but in different places (SoA) that are
+ * always accessed together may benefit from a shared cache line.
+ */
+class LayoutAdvisor {
+ public:
+  /**
+   * Records the fields accessed by the tasks in @param root, which belong to
+   * @param kernel. In the async mode, the tasks are recorded one by one.
+   *
+   * @param root The offloaded IR, before the global pointers are lowered.
+   */
+  void record_tasks(const Kernel *kernel, IRNode *root);
+
+  void record_launch(const Kernel *kernel);
+
+  // One line per suggestion, the most frequently accessed fields first.
+  std::vector<std::string> get_advice();
+
+  void print();
+
+ private:
+  struct KernelRecord {
+    std::string name;
+    // The place SNodes accessed by each task.
+    std::vector<std::vector<SNode *>> tasks;
+    int64 launches{0};
+  };
+
+  std::mutex mut_;
+  std::unordered_map<const Kernel *, KernelRecord> kernels_;
+};
+
+TLANG_NAMESPACE_END
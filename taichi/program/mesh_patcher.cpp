@@ -0,0 +1,607 @@
+#include "taichi/program/mesh_patcher.h"
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <numeric>
+#include <unordered_map>
+
+#include "taichi/system/threading.h"
+
+namespace taichi {
+namespace lang {
+namespace mesh {
+
+namespace {
+
+// The elements handled by one task of the parallel loops.
+constexpr int kElementsPerTask = 4096;
+// The number of local elements of the patches is padded to a multiple of
+// this, like the metadata generated by the offline patcher.
+constexpr int kPatchSizeAlignment = 32;
+
+// A relation between global elements, in CSR form.
+struct Csr {
+  std::vector<int> offset{0};
+  std::vector<int> value;
+
+  int size(int i) const {
+    return offset[i + 1] - offset[i];
+  }
+
+  const int *begin(int i) const {
+    return value.data() + offset[i];
+  }
+
+  const int *end(int i) const {
+    return value.data() + offset[i + 1];
+  }
+};
+
+Csr make_fixed_csr(std::vector<int> value, int n, int to_size) {
+  Csr csr;
+  csr.offset.resize(n + 1);
+  for (int i = 0; i <= n; i++) {
+    csr.offset[i] = i * to_size;
+  }
+  csr.value = std::move(value);
+  return csr;
+}
+
+// Returns the relation from the |num_to| elements of |rel| targets back to
+// its sources, with the sources of each element in ascending order.
+Csr invert(const Csr &rel, int num_to) {
+  Csr inv;
+  inv.offset.assign(num_to + 1, 0);
+  for (int v : rel.value) {
+    inv.offset[v + 1]++;
+  }
+  std::partial_sum(inv.offset.begin(), inv.offset.end(), inv.offset.begin());
+  inv.value.resize(rel.value.size());
+  std::vector<int> next(inv.offset.begin(), inv.offset.end() - 1);
+  for (int i = 0; i + 1 < (int)rel.offset.size(); i++) {
+    for (auto it = rel.begin(i); it != rel.end(i); ++it) {
+      inv.value[next[*it]++] = i;
+    }
+  }
+  return inv;
+}
+
+// Converts per-element lists into CSR form.
+Csr flatten(ThreadPool *pool, const std::vector<std::vector<int>> &lists) {
+  Csr csr;
+  const int n = lists.size();
+  csr.offset.resize(n + 1);
+  for (int i = 0; i < n; i++) {
+    csr.offset[i + 1] = csr.offset[i] + (int)lists[i].size();
+  }
+  csr.value.resize(csr.offset[n]);
+  parallel_for_blocks(pool, n, kElementsPerTask, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      std::copy(lists[i].begin(), lists[i].end(),
+                csr.value.begin() + csr.offset[i]);
+    }
+  });
+  return csr;
+}
+
+// The elements reached through |a| then |b|, excluding the element itself.
+Csr compose_same_order(ThreadPool *pool, const Csr &a, const Csr &b) {
+  const int n = a.offset.size() - 1;
+  std::vector<std::vector<int>> lists(n);
+  parallel_for_blocks(pool, n, kElementsPerTask, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      auto &list = lists[i];
+      for (auto x = a.begin(i); x != a.end(i); ++x) {
+        for (auto y = b.begin(*x); y != b.end(*x); ++y) {
+          if (*y != i) {
+            list.push_back(*y);
+          }
+        }
+      }
+      std::sort(list.begin(), list.end());
+      list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+  });
+  return flatten(pool, lists);
+}
+
+// Deduplicates the sub-elements listed by |local_verts| (lists of local
+// vertex indices of the top elements). Returns the vertices of each new
+// element, in the order of its first top element, and fills |top_to_elem|
+// with the element of each (top element, local sub-element) slot.
+template <int N>
+std::vector<int> extract_elements(
+    ThreadPool *pool,
+    const std::vector<int> &cells,
+    int verts_per_top,
+    const std::vector<std::array<int, N>> &local_verts,
+    std::vector<int> &top_to_elem) {
+  const int num_top = cells.size() / verts_per_top;
+  const int num_local = local_verts.size();
+  const int num_slots = num_top * num_local;
+  using Key = std::pair<std::array<int, N>, int>;
+  std::vector<Key> keys(num_slots);
+  parallel_for_blocks(pool, num_top, kElementsPerTask, [&](int begin,
+                                                           int end) {
+    for (int t = begin; t < end; t++) {
+      for (int j = 0; j < num_local; j++) {
+        auto &key = keys[t * num_local + j];
+        for (int k = 0; k < N; k++) {
+          key.first[k] = cells[t * verts_per_top + local_verts[j][k]];
+        }
+        std::sort(key.first.begin(), key.first.end());
+        key.second = t * num_local + j;
+      }
+    }
+  });
+  std::sort(keys.begin(), keys.end());
+  std::vector<int> elem_verts;
+  top_to_elem.resize(num_slots);
+  int num_elems = 0;
+  for (int i = 0; i < num_slots; i++) {
+    if (i == 0 || keys[i].first != keys[i - 1].first) {
+      // The first slot of a group is the one of the lowest top element.
+      int t = keys[i].second / num_local, j = keys[i].second % num_local;
+      for (int k = 0; k < N; k++) {
+        elem_verts.push_back(cells[t * verts_per_top + local_verts[j][k]]);
+      }
+      num_elems++;
+    }
+    top_to_elem[keys[i].second] = num_elems - 1;
+  }
+  return elem_verts;
+}
+
+// The Morton codes of the centroids of the elements whose vertices are
+// listed by |verts|, on a grid of 2^10 cells per axis over the bounding box
+// of the vertex positions |x|.
+std::vector<uint32> morton_codes(ThreadPool *pool,
+                                 const std::vector<float32> &x,
+                                 const Csr &verts) {
+  constexpr int kBitsPerAxis = 10;
+  std::array<float32, 3> lo, hi;
+  for (int d = 0; d < 3; d++) {
+    lo[d] = hi[d] = x.empty() ? 0 : x[d];
+  }
+  for (int i = 0; i < (int)x.size(); i++) {
+    lo[i % 3] = std::min(lo[i % 3], x[i]);
+    hi[i % 3] = std::max(hi[i % 3], x[i]);
+  }
+  const int n = verts.offset.size() - 1;
+  std::vector<uint32> codes(n);
+  parallel_for_blocks(pool, n, kElementsPerTask, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      uint32 code = 0;
+      for (int d = 0; d < 3; d++) {
+        float32 c = 0;
+        for (auto v = verts.begin(i); v != verts.end(i); ++v) {
+          c += x[*v * 3 + d];
+        }
+        c /= std::max(verts.size(i), 1);
+        const float32 extent = hi[d] - lo[d];
+        uint32 cell = 0;
+        if (extent > 0) {
+          cell = std::min((uint32)((c - lo[d]) / extent * (1 << kBitsPerAxis)),
+                          (uint32)(1 << kBitsPerAxis) - 1);
+        }
+        // The bits of the last axis are the lowest of each round.
+        for (int b = 0; b < kBitsPerAxis; b++) {
+          code |= ((cell >> b) & 1u) << (b * 3 + 2 - d);
+        }
+      }
+      codes[i] = code;
+    }
+  });
+  return codes;
+}
+
+// Greedily grows connected regions of at most |max_size| top elements over
+// |adjacency|. A new region is seeded from the frontier of the previous one,
+// so that consecutive patches stay close to each other, or from the first
+// element left in |seed_order| (the input order if empty).
+std::vector<int> partition(const Csr &adjacency,
+                           int max_size,
+                           const std::vector<int> &seed_order,
+                           int &num_patches) {
+  const int n = adjacency.offset.size() - 1;
+  std::vector<int> patch_of(n, -1);
+  std::deque<int> frontier;
+  int next_seed = 0;
+  num_patches = 0;
+  while (true) {
+    int seed = -1;
+    while (!frontier.empty() && seed == -1) {
+      if (patch_of[frontier.front()] == -1) {
+        seed = frontier.front();
+      }
+      frontier.pop_front();
+    }
+    while (seed == -1 && next_seed < n) {
+      const int t = seed_order.empty() ? next_seed : seed_order[next_seed];
+      if (patch_of[t] == -1) {
+        seed = t;
+      }
+      next_seed++;
+    }
+    if (seed == -1) {
+      break;
+    }
+    const int patch = num_patches++;
+    std::deque<int> queue{seed};
+    patch_of[seed] = patch;
+    int size = 1;
+    while (!queue.empty()) {
+      int t = queue.front();
+      queue.pop_front();
+      for (auto it = adjacency.begin(t); it != adjacency.end(t); ++it) {
+        if (patch_of[*it] != -1) {
+          continue;
+        }
+        if (size < max_size) {
+          patch_of[*it] = patch;
+          queue.push_back(*it);
+          size++;
+        } else {
+          frontier.push_back(*it);
+        }
+      }
+    }
+  }
+  return patch_of;
+}
+
+// The elements of one patch, owned ones first.
+struct PatchElements {
+  std::array<std::vector<int>, 4> elems;
+  std::array<std::unordered_map<int, int>, 4> local;
+
+  void add(int order, int global) {
+    if (local[order].emplace(global, (int)elems[order].size()).second) {
+      elems[order].push_back(global);
+    }
+  }
+};
+
+}  // namespace
+
+void PatchedMesh::save(const std::string &filename) const {
+  write_to_binary_file(*this, filename);
+}
+
+PatchedMesh PatchedMesh::load(const std::string &filename) {
+  PatchedMesh mesh;
+  read_from_binary_file(mesh, filename);
+  TI_ERROR_IF(mesh.version != kVersion,
+              "The mesh cache {} is of version {}, expected {}.", filename,
+              mesh.version, kVersion);
+  return mesh;
+}
+
+PatchedMesh patch_mesh(MeshTopology topology,
+                       int num_verts,
+                       const std::vector<int> &cells,
+                       const std::vector<MeshRelationType> &relations,
+                       int max_elements_per_patch,
+                       int num_threads,
+                       const std::vector<float32> &sfc_x) {
+  TI_AUTO_PROF;
+  const int top = topology == MeshTopology::Tetrahedron ? 3 : 2;
+  const int verts_per_top = top + 1;
+  TI_ERROR_IF(cells.size() % verts_per_top != 0,
+              "The number of cell indices must be a multiple of {}.",
+              verts_per_top);
+  TI_ERROR_IF(max_elements_per_patch <= 0,
+              "The patch size must be positive.");
+  TI_ERROR_IF(!sfc_x.empty() && (int)sfc_x.size() != num_verts * 3,
+              "Expected 3 coordinates per vertex, got {} for {} vertices.",
+              sfc_x.size(), num_verts);
+  for (auto rel : relations) {
+    TI_ERROR_IF(from_end_element_order(rel) > top ||
+                    to_end_element_order(rel) > top,
+                "Relation {} is not available on this mesh.",
+                relation_type_name(rel));
+  }
+  std::unique_ptr<ThreadPool> thread_pool;
+  if (num_threads > 1) {
+    thread_pool = std::make_unique<ThreadPool>(num_threads);
+  }
+  ThreadPool *pool = thread_pool.get();
+
+  // num[o]: the number of elements of order o.
+  // down[o][p]: the elements of order p < o of each element of order o.
+  std::array<int, 4> num{};
+  std::array<std::array<Csr, 4>, 4> down;
+  const int num_top = cells.size() / verts_per_top;
+  num[0] = num_verts;
+  num[top] = num_top;
+  down[top][0] = make_fixed_csr(cells, num_top, verts_per_top);
+
+  std::vector<std::array<int, 2>> local_edges;
+  for (int a = 0; a < verts_per_top; a++) {
+    for (int b = a + 1; b < verts_per_top; b++) {
+      local_edges.push_back({a, b});
+    }
+  }
+  std::vector<int> top_to_edge;
+  auto edge_verts = extract_elements<2>(pool, cells, verts_per_top,
+                                        local_edges, top_to_edge);
+  num[1] = edge_verts.size() / 2;
+  down[1][0] = make_fixed_csr(std::move(edge_verts), num[1], 2);
+  down[top][1] = make_fixed_csr(std::move(top_to_edge), num_top,
+                                local_edges.size());
+
+  if (top == 3) {
+    // Face j of a cell is the one opposite to its vertex j.
+    std::vector<std::array<int, 3>> local_faces;
+    for (int j = 0; j < 4; j++) {
+      std::array<int, 3> face;
+      for (int k = 0, n = 0; k < 4; k++) {
+        if (k != j) {
+          face[n++] = k;
+        }
+      }
+      local_faces.push_back(face);
+    }
+    std::vector<int> cell_to_face;
+    auto face_verts =
+        extract_elements<3>(pool, cells, 4, local_faces, cell_to_face);
+    num[2] = face_verts.size() / 3;
+    down[2][0] = make_fixed_csr(std::move(face_verts), num[2], 3);
+    // The edges of a face, found among the edges of one of its cells.
+    const Csr &cell_edges = down[3][1];
+    std::vector<int> face_to_edge(num[2] * 3);
+    parallel_for_blocks(pool, num_top, kElementsPerTask, [&](int begin,
+                                                             int end) {
+      for (int c = begin; c < end; c++) {
+        for (int j = 0; j < 4; j++) {
+          int f = cell_to_face[c * 4 + j];
+          for (int e = 0, n = 0; e < (int)local_edges.size(); e++) {
+            if (local_edges[e][0] != j && local_edges[e][1] != j) {
+              // Faces shared by two cells get the same edges from both.
+              face_to_edge[f * 3 + n++] = cell_edges.begin(c)[e];
+            }
+          }
+        }
+      }
+    });
+    down[2][1] = make_fixed_csr(std::move(face_to_edge), num[2], 3);
+    down[3][2] = make_fixed_csr(std::move(cell_to_face), num_top, 4);
+  }
+
+  // up[o][p]: the elements of order p > o incident to each element of order
+  // o, in ascending order.
+  std::array<std::array<Csr, 4>, 4> up;
+  for (int o = 0; o <= top; o++) {
+    for (int p = o + 1; p <= top; p++) {
+      up[o][p] = invert(down[p][o], num[o]);
+    }
+  }
+  // Vertices share an edge, edges a vertex, faces an edge, cells a face.
+  std::array<Csr, 4> same;
+  same[0] = compose_same_order(pool, up[0][1], down[1][0]);
+  same[1] = compose_same_order(pool, down[1][0], up[0][1]);
+  same[2] = compose_same_order(pool, down[2][1], up[1][2]);
+  if (top == 3) {
+    same[3] = compose_same_order(pool, down[3][2], up[2][3]);
+  }
+  auto global_relation = [&](int from, int to) -> const Csr & {
+    return from > to ? down[from][to] : from < to ? up[from][to] : same[from];
+  };
+
+  // The Morton codes of the elements of each order along the space-filling
+  // curve, if any.
+  std::array<std::vector<uint32>, 4> codes;
+  std::vector<int> seed_order;
+  if (!sfc_x.empty()) {
+    std::vector<int> verts(num_verts);
+    std::iota(verts.begin(), verts.end(), 0);
+    codes[0] = morton_codes(pool, sfc_x,
+                            make_fixed_csr(std::move(verts), num_verts, 1));
+    for (int o = 1; o <= top; o++) {
+      codes[o] = morton_codes(pool, sfc_x, down[o][0]);
+    }
+    seed_order.resize(num_top);
+    std::iota(seed_order.begin(), seed_order.end(), 0);
+    std::stable_sort(
+        seed_order.begin(), seed_order.end(),
+        [&](int a, int b) { return codes[top][a] < codes[top][b]; });
+  }
+
+  // Partition the top elements into patches, sharing a face (an edge for
+  // triangle meshes) with one another, and assign the lower-order elements
+  // to the patch of their incident top element of the lowest index.
+  PatchedMesh result;
+  result.topology = topology;
+  int num_patches = 0;
+  std::array<std::vector<int>, 4> owner;
+  owner[top] =
+      partition(same[top], max_elements_per_patch, seed_order, num_patches);
+  result.num_patches = num_patches;
+  for (int o = 0; o < top; o++) {
+    owner[o].resize(num[o]);
+    const Csr &incident = up[o][top];
+    parallel_for_blocks(pool, num[o], kElementsPerTask, [&](int begin,
+                                                            int end) {
+      for (int i = begin; i < end; i++) {
+        // Isolated vertices go to the first patch.
+        owner[o][i] = incident.size(i) ? owner[top][*incident.begin(i)] : 0;
+      }
+    });
+  }
+
+  // The owned elements of each patch, in ascending order, or along the
+  // space-filling curve.
+  std::array<Csr, 4> owned;
+  for (int o = 0; o <= top; o++) {
+    Csr patch_to_owner;
+    patch_to_owner.offset.resize(num[o] + 1);
+    std::iota(patch_to_owner.offset.begin(), patch_to_owner.offset.end(), 0);
+    patch_to_owner.value = owner[o];
+    owned[o] = invert(patch_to_owner, num_patches);
+    if (!codes[o].empty()) {
+      auto &rel = owned[o];
+      parallel_for_blocks(pool, num_patches, 1, [&](int begin, int end) {
+        for (int p = begin; p < end; p++) {
+          std::stable_sort(
+              rel.value.begin() + rel.offset[p],
+              rel.value.begin() + rel.offset[p + 1],
+              [&](int a, int b) { return codes[o][a] < codes[o][b]; });
+        }
+      });
+    }
+  }
+
+  std::vector<bool> requested(16, false);
+  for (auto rel : relations) {
+    requested[int(rel)] = true;
+  }
+  std::vector<PatchElements> patches(num_patches);
+  parallel_for_blocks(pool, num_patches, 1, [&](int begin, int end) {
+    for (int p = begin; p < end; p++) {
+      auto &patch = patches[p];
+      for (int o = 0; o <= top; o++) {
+        for (auto it = owned[o].begin(p); it != owned[o].end(p); ++it) {
+          patch.add(o, *it);
+        }
+      }
+      // The closure of the owned top elements.
+      for (auto t = owned[top].begin(p); t != owned[top].end(p); ++t) {
+        for (int o = 0; o < top; o++) {
+          for (auto it = down[top][o].begin(*t); it != down[top][o].end(*t);
+               ++it) {
+            patch.add(o, *it);
+          }
+        }
+      }
+      // The neighbors of the owned elements in the relations stored in CSR
+      // form.
+      for (int from = 0; from <= top; from++) {
+        for (int to = from; to <= top; to++) {
+          if (!requested[int(relation_by_orders(from, to))]) {
+            continue;
+          }
+          const Csr &rel = global_relation(from, to);
+          for (auto it = owned[from].begin(p); it != owned[from].end(p);
+               ++it) {
+            for (auto n = rel.begin(*it); n != rel.end(*it); ++n) {
+              patch.add(to, *n);
+            }
+          }
+        }
+      }
+      // The lower-order elements of all the elements of the patch, from the
+      // highest order down, so that the ghosts added on the way are closed
+      // too.
+      for (int from = top; from > 0; from--) {
+        for (int to = from - 1; to >= 0; to--) {
+          if (!requested[int(relation_by_orders(from, to))]) {
+            continue;
+          }
+          const Csr &rel = down[from][to];
+          for (int i = 0; i < (int)patch.elems[from].size(); i++) {
+            int e = patch.elems[from][i];
+            for (auto n = rel.begin(e); n != rel.end(e); ++n) {
+              patch.add(to, *n);
+            }
+          }
+        }
+      }
+    }
+  });
+
+  for (int o = 0; o <= top; o++) {
+    auto &element = result.elements[MeshElementType(o)];
+    element.num = num[o];
+    element.owned_offsets.assign(num_patches + 1, 0);
+    element.total_offsets.assign(num_patches + 1, 0);
+    int max_total = 0;
+    for (int p = 0; p < num_patches; p++) {
+      int total = patches[p].elems[o].size();
+      element.owned_offsets[p + 1] =
+          element.owned_offsets[p] + owned[o].size(p);
+      element.total_offsets[p + 1] = element.total_offsets[p] + total;
+      max_total = std::max(max_total, total);
+    }
+    element.max_num_per_patch =
+        (max_total + kPatchSizeAlignment - 1) / kPatchSizeAlignment *
+        kPatchSizeAlignment;
+    // The owned elements of the patches are contiguous in the reordered
+    // index space.
+    element.g2r.resize(num[o]);
+    element.l2g.resize(element.total_offsets[num_patches]);
+    element.l2r.resize(element.l2g.size());
+    parallel_for_blocks(pool, num_patches, 1, [&](int begin, int end) {
+      for (int p = begin; p < end; p++) {
+        for (int i = 0; i < owned[o].size(p); i++) {
+          element.g2r[owned[o].begin(p)[i]] = element.owned_offsets[p] + i;
+        }
+      }
+    });
+    parallel_for_blocks(pool, num_patches, 1, [&](int begin, int end) {
+      for (int p = begin; p < end; p++) {
+        const auto &elems = patches[p].elems[o];
+        for (int i = 0; i < (int)elems.size(); i++) {
+          element.l2g[element.total_offsets[p] + i] = elems[i];
+          element.l2r[element.total_offsets[p] + i] = element.g2r[elems[i]];
+        }
+      }
+    });
+  }
+
+  for (auto rel_type : relations) {
+    const int from = from_end_element_order(rel_type);
+    const int to = to_end_element_order(rel_type);
+    const Csr &rel = global_relation(from, to);
+    auto &relation = result.relations[rel_type];
+    const auto &from_element = result.elements[MeshElementType(from)];
+    if (from > to) {
+      const int to_size = rel.size(0);
+      relation.value.resize(from_element.total_offsets[num_patches] * to_size);
+      parallel_for_blocks(pool, num_patches, 1, [&](int begin, int end) {
+        for (int p = begin; p < end; p++) {
+          const auto &patch = patches[p];
+          int base = from_element.total_offsets[p] * to_size;
+          for (int e : patch.elems[from]) {
+            for (auto n = rel.begin(e); n != rel.end(e); ++n) {
+              relation.value[base++] = patch.local[to].at(*n);
+            }
+          }
+        }
+      });
+    } else {
+      // One offset per owned element plus one per patch.
+      std::vector<int> value_offsets(num_patches + 1, 0);
+      for (int p = 0; p < num_patches; p++) {
+        int count = 0;
+        for (auto it = owned[from].begin(p); it != owned[from].end(p); ++it) {
+          count += rel.size(*it);
+        }
+        value_offsets[p + 1] = value_offsets[p] + count;
+      }
+      relation.value.resize(value_offsets[num_patches]);
+      relation.offset.resize(from_element.owned_offsets[num_patches] +
+                             num_patches);
+      parallel_for_blocks(pool, num_patches, 1, [&](int begin, int end) {
+        for (int p = begin; p < end; p++) {
+          const auto &patch = patches[p];
+          int k = value_offsets[p];
+          int offset_base = p + from_element.owned_offsets[p];
+          for (int i = 0; i < owned[from].size(p); i++) {
+            int e = owned[from].begin(p)[i];
+            relation.offset[offset_base + i] = k;
+            for (auto n = rel.begin(e); n != rel.end(e); ++n) {
+              relation.value[k++] = patch.local[to].at(*n);
+            }
+          }
+          relation.offset[offset_base + owned[from].size(p)] = k;
+        }
+      });
+    }
+  }
+  return result;
+}
+
+}  // namespace mesh
+}  // namespace lang
+}  // namespace taichi
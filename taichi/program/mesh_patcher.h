@@ -0,0 +1,94 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "taichi/common/core.h"
+#include "taichi/common/serialization.h"
+#include "taichi/ir/mesh.h"
+
+namespace taichi {
+namespace lang {
+namespace mesh {
+
+// The patched mesh consumed by ti.Mesh, in the layout of the JSON metadata:
+//
+// - The top elements (cells of tet meshes, faces of triangle meshes) are
+//   partitioned into patches. Every other element is owned by the patch of
+//   its incident top element of the lowest index.
+// - The elements of a patch are its owned elements followed by the ghost
+//   elements its relations refer to. |l2g| maps the patch-local index plus
+//   the total offset of the patch to the global index. In the reordered index
+//   space, the owned elements of each patch are contiguous.
+// - A relation from higher to lower order elements stores |to_size| local
+//   indices per element of the patches. The other relations store the local
+//   indices of the neighbors of the owned elements in CSR form, with one
+//   extra offset per patch.
+struct PatchedMesh {
+  struct Element {
+    int num{0};
+    int max_num_per_patch{0};
+    std::vector<int> owned_offsets;
+    std::vector<int> total_offsets;
+    std::vector<int> l2g;
+    std::vector<int> l2r;
+    std::vector<int> g2r;
+
+    TI_IO_DEF(num,
+              max_num_per_patch,
+              owned_offsets,
+              total_offsets,
+              l2g,
+              l2r,
+              g2r);
+  };
+
+  struct Relation {
+    std::vector<int> value;
+    // Empty for the relations from higher to lower order elements.
+    std::vector<int> offset;
+
+    TI_IO_DEF(value, offset);
+  };
+
+  // Bumped whenever the layout changes, to invalidate the cache files.
+  static constexpr int kVersion = 1;
+
+  int version{kVersion};
+  MeshTopology topology{MeshTopology::Tetrahedron};
+  int num_patches{0};
+  std::map<MeshElementType, Element> elements;
+  std::map<MeshRelationType, Relation> relations;
+  // The vertex positions, 3 per vertex, if any.
+  std::vector<float32> x;
+
+  TI_IO_DEF(version, topology, num_patches, elements, relations, x);
+
+  // A binary cache of the patched mesh. |filename| must end with .tcb, or
+  // .tcb.zip for a compressed one.
+  void save(const std::string &filename) const;
+  static PatchedMesh load(const std::string &filename);
+};
+
+// Extracts the edges (and the faces of tet meshes) from |cells|, which holds
+// the vertex indices of the top elements, partitions the top elements into
+// patches of at most |max_elements_per_patch| elements by growing connected
+// regions, and builds the index mappings and |relations| of the patches.
+// The work is spread over |num_threads| threads.
+//
+// If the vertex positions |sfc_x| (3 per vertex) are given, the patches are
+// seeded, and the owned elements of each patch ordered, along the Morton
+// curve through the centroids of the elements instead of in the input order,
+// so that the elements close in space are close in the reordered index space.
+PatchedMesh patch_mesh(MeshTopology topology,
+                       int num_verts,
+                       const std::vector<int> &cells,
+                       const std::vector<MeshRelationType> &relations,
+                       int max_elements_per_patch,
+                       int num_threads,
+                       const std::vector<float32> &sfc_x = {});
+
+}  // namespace mesh
+}  // namespace lang
+}  // namespace taichi
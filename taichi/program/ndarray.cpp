@@ -1,6 +1,7 @@
 #include <numeric>
 #include "taichi/program/ndarray.h"
 #include "taichi/program/program.h"
+#include "taichi/system/device_memory_tracker.h"
 
 namespace taichi {
 namespace lang {
@@ -17,6 +18,9 @@ Ndarray::Ndarray(Program *prog,
                                 std::multiplies<>())),
       element_size_(data_type_size(dtype)),
       device_(prog->get_device_shared()) {
+  DeviceMemoryTracker::Scope scope(
+      "ndarray", fmt::format("{} {}", data_type_name(dtype),
+                             fmt::join(shape, "x")));
   ndarray_alloc_ = prog->allocate_memory_ndarray(nelement_ * element_size_,
                                                  prog->result_buffer);
 #ifdef TI_WITH_LLVM
@@ -30,7 +34,29 @@ Ndarray::Ndarray(Program *prog,
 #endif
 }
 
+Ndarray::Ndarray(Program *prog,
+                 const DataType type,
+                 const std::vector<int> &shape,
+                 intptr_t data_ptr)
+    : dtype(type),
+      shape(shape),
+      num_active_indices(shape.size()),
+      nelement_(std::accumulate(std::begin(shape),
+                                std::end(shape),
+                                1,
+                                std::multiplies<>())),
+      element_size_(data_type_size(dtype)),
+      device_(prog->get_device_shared()) {
+  ndarray_alloc_ = prog->import_memory_ndarray(
+      reinterpret_cast<void *>(data_ptr), nelement_ * element_size_);
+  TI_ERROR_IF(ndarray_alloc_ == kDeviceNullAllocation,
+              "Zero-copy ndarrays are not supported on {}",
+              arch_name(prog->config.arch));
+  data_ptr_ = reinterpret_cast<uint64_t *>(data_ptr);
+}
+
 Ndarray::~Ndarray() {
+  // Imported memory is only released from the device, not freed.
   if (device_) {
     device_->dealloc_memory(ndarray_alloc_);
   }
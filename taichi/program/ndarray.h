@@ -23,6 +23,16 @@ class Ndarray {
                    const DataType type,
                    const std::vector<int> &shape);
 
+  /**
+   * Creates an ndarray on top of |data_ptr| without copying. The memory is
+   * owned by the caller and must outlive the ndarray. It has to be host memory
+   * on the CPU backends, and device memory on CUDA.
+   */
+  explicit Ndarray(Program *prog,
+                   const DataType type,
+                   const std::vector<int> &shape,
+                   intptr_t data_ptr);
+
   DataType dtype;
   std::vector<int> shape;
   int num_active_indices{0};
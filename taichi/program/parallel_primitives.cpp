@@ -0,0 +1,331 @@
+#include "taichi/program/parallel_primitives.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "taichi/ir/type_utils.h"
+#include "taichi/system/threading.h"
+
+namespace taichi {
+namespace lang {
+
+namespace {
+
+// The elements handled by one task, at least.
+constexpr int64 kMinBlockSize = 1 << 14;
+constexpr int kRadixBits = 8;
+constexpr int kRadix = 1 << kRadixBits;
+
+// [0, n) cut into contiguous blocks, a few per thread so that the work
+// stealing can even them out.
+class Blocks {
+ public:
+  Blocks(ThreadPool *pool, int64 n) : n_(n) {
+    const int64 num_threads = pool ? pool->get_max_num_threads() : 1;
+    size_ = std::max(kMinBlockSize,
+                     (n + 4 * num_threads - 1) / (4 * num_threads));
+    count_ = (int)std::max<int64>(1, (n + size_ - 1) / size_);
+  }
+
+  int count() const {
+    return count_;
+  }
+
+  // Runs body(block, begin, end) on every block.
+  template <typename Func>
+  void run(ThreadPool *pool, const Func &body) const {
+    parallel_for_blocks(pool, count_, 1, [&](int first, int last) {
+      for (int b = first; b < last; b++) {
+        body(b, b * size_, std::min((b + 1) * size_, n_));
+      }
+    });
+  }
+
+ private:
+  int64 n_;
+  int64 size_;
+  int count_;
+};
+
+template <typename U>
+constexpr U kSignBit = U(1) << (sizeof(U) * 8 - 1);
+
+// Maps the keys to unsigned integers of the same order.
+template <typename K, typename U>
+U encode_key(K key) {
+  U bits;
+  std::memcpy(&bits, &key, sizeof(bits));
+  if constexpr (std::is_floating_point_v<K>) {
+    return (bits & kSignBit<U>) ? ~bits : (bits | kSignBit<U>);
+  } else if constexpr (std::is_signed_v<K>) {
+    return bits ^ kSignBit<U>;
+  } else {
+    return bits;
+  }
+}
+
+template <typename K, typename U>
+K decode_key(U bits) {
+  if constexpr (std::is_floating_point_v<K>) {
+    bits = (bits & kSignBit<U>) ? (bits ^ kSignBit<U>) : ~bits;
+  } else if constexpr (std::is_signed_v<K>) {
+    bits ^= kSignBit<U>;
+  }
+  K key;
+  std::memcpy(&key, &bits, sizeof(key));
+  return key;
+}
+
+template <typename T>
+T *typed(void *ptr) {
+  return reinterpret_cast<T *>(ptr);
+}
+
+}  // namespace
+
+template <typename T>
+T exclusive_scan(ThreadPool *pool, T *data, int64 n) {
+  // Reduce then scan: the sums of the blocks, their scan, and the scan of
+  // each block starting from the sum of the blocks before it.
+  const Blocks blocks(pool, n);
+  std::vector<T> sums(blocks.count());
+  blocks.run(pool, [&](int b, int64 begin, int64 end) {
+    T sum = 0;
+    for (int64 i = begin; i < end; i++) {
+      sum += data[i];
+    }
+    sums[b] = sum;
+  });
+  T total = 0;
+  for (auto &sum : sums) {
+    const T x = sum;
+    sum = total;
+    total += x;
+  }
+  blocks.run(pool, [&](int b, int64 begin, int64 end) {
+    T sum = sums[b];
+    for (int64 i = begin; i < end; i++) {
+      const T x = data[i];
+      data[i] = sum;
+      sum += x;
+    }
+  });
+  return total;
+}
+
+template <typename K, typename V>
+void radix_sort(ThreadPool *pool, K *keys, V *values, int64 n) {
+  static_assert(sizeof(K) == 4 || sizeof(K) == 8);
+  using U = std::conditional_t<sizeof(K) == 4, uint32, uint64>;
+  if (n <= 1) {
+    return;
+  }
+  const Blocks blocks(pool, n);
+  const int num_blocks = blocks.count();
+  std::vector<U> keys_buffers[2] = {std::vector<U>(n), std::vector<U>(n)};
+  std::vector<V> values_buffer(values ? n : 0);
+  U *src = keys_buffers[0].data(), *dst = keys_buffers[1].data();
+  V *values_src = values, *values_dst = values_buffer.data();
+  blocks.run(pool, [&](int b, int64 begin, int64 end) {
+    for (int64 i = begin; i < end; i++) {
+      src[i] = encode_key<K, U>(keys[i]);
+    }
+  });
+
+  // Digit-major, so that their exclusive scan is where each block writes its
+  // keys of each digit.
+  std::vector<int64> offsets((std::size_t)kRadix * num_blocks);
+  for (int shift = 0; shift < (int)sizeof(U) * 8; shift += kRadixBits) {
+    blocks.run(pool, [&](int b, int64 begin, int64 end) {
+      for (int d = 0; d < kRadix; d++) {
+        offsets[d * num_blocks + b] = 0;
+      }
+      for (int64 i = begin; i < end; i++) {
+        offsets[((src[i] >> shift) & (kRadix - 1)) * num_blocks + b]++;
+      }
+    });
+    // A digit shared by all the keys would leave them in place.
+    bool uniform = false;
+    for (int d = 0; d < kRadix && !uniform; d++) {
+      int64 count = 0;
+      for (int b = 0; b < num_blocks; b++) {
+        count += offsets[d * num_blocks + b];
+      }
+      uniform = count == n;
+    }
+    if (uniform) {
+      continue;
+    }
+    exclusive_scan<int64>(nullptr, offsets.data(), (int64)offsets.size());
+    blocks.run(pool, [&](int b, int64 begin, int64 end) {
+      for (int64 i = begin; i < end; i++) {
+        const int64 j =
+            offsets[((src[i] >> shift) & (kRadix - 1)) * num_blocks + b]++;
+        dst[j] = src[i];
+        if (values) {
+          values_dst[j] = values_src[i];
+        }
+      }
+    });
+    std::swap(src, dst);
+    std::swap(values_src, values_dst);
+  }
+
+  blocks.run(pool, [&](int b, int64 begin, int64 end) {
+    for (int64 i = begin; i < end; i++) {
+      keys[i] = decode_key<K, U>(src[i]);
+    }
+    if (values && values_src != values) {
+      std::copy(values_src + begin, values_src + end, values + begin);
+    }
+  });
+}
+
+template <typename T>
+int64 compact(ThreadPool *pool,
+              const T *data,
+              const int32 *flags,
+              T *out,
+              int64 n) {
+  const Blocks blocks(pool, n);
+  std::vector<int64> offsets(blocks.count());
+  blocks.run(pool, [&](int b, int64 begin, int64 end) {
+    int64 count = 0;
+    for (int64 i = begin; i < end; i++) {
+      count += flags[i] != 0;
+    }
+    offsets[b] = count;
+  });
+  const int64 total =
+      exclusive_scan<int64>(nullptr, offsets.data(), (int64)offsets.size());
+  blocks.run(pool, [&](int b, int64 begin, int64 end) {
+    int64 j = offsets[b];
+    for (int64 i = begin; i < end; i++) {
+      if (flags[i] != 0) {
+        out[j++] = data[i];
+      }
+    }
+  });
+  return total;
+}
+
+#define TI_INSTANTIATE_SCAN(T) \
+  template T exclusive_scan<T>(ThreadPool *, T *, int64);
+TI_INSTANTIATE_SCAN(int32)
+TI_INSTANTIATE_SCAN(int64)
+TI_INSTANTIATE_SCAN(uint32)
+TI_INSTANTIATE_SCAN(uint64)
+TI_INSTANTIATE_SCAN(float32)
+TI_INSTANTIATE_SCAN(float64)
+#undef TI_INSTANTIATE_SCAN
+
+#define TI_INSTANTIATE_SORT(K)                                            \
+  template void radix_sort<K, uint32>(ThreadPool *, K *, uint32 *, int64); \
+  template void radix_sort<K, uint64>(ThreadPool *, K *, uint64 *, int64);
+TI_INSTANTIATE_SORT(int32)
+TI_INSTANTIATE_SORT(int64)
+TI_INSTANTIATE_SORT(uint32)
+TI_INSTANTIATE_SORT(uint64)
+TI_INSTANTIATE_SORT(float32)
+TI_INSTANTIATE_SORT(float64)
+#undef TI_INSTANTIATE_SORT
+
+template int64 compact<uint32>(ThreadPool *,
+                               const uint32 *,
+                               const int32 *,
+                               uint32 *,
+                               int64);
+template int64 compact<uint64>(ThreadPool *,
+                               const uint64 *,
+                               const int32 *,
+                               uint64 *,
+                               int64);
+
+TypedConstant exclusive_scan(ThreadPool *pool,
+                             void *data,
+                             DataType dt,
+                             int64 n) {
+  if (dt->is_primitive(PrimitiveTypeID::i32)) {
+    return TypedConstant(exclusive_scan(pool, typed<int32>(data), n));
+  } else if (dt->is_primitive(PrimitiveTypeID::i64)) {
+    return TypedConstant(exclusive_scan(pool, typed<int64>(data), n));
+  } else if (dt->is_primitive(PrimitiveTypeID::u32)) {
+    return TypedConstant(exclusive_scan(pool, typed<uint32>(data), n));
+  } else if (dt->is_primitive(PrimitiveTypeID::u64)) {
+    return TypedConstant(exclusive_scan(pool, typed<uint64>(data), n));
+  } else if (dt->is_primitive(PrimitiveTypeID::f32)) {
+    return TypedConstant(exclusive_scan(pool, typed<float32>(data), n));
+  } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
+    return TypedConstant(exclusive_scan(pool, typed<float64>(data), n));
+  }
+  TI_ERROR("Prefix sums of {} are not supported.", data_type_name(dt));
+}
+
+namespace {
+
+template <typename K>
+void radix_sort_keys(ThreadPool *pool,
+                     K *keys,
+                     void *values,
+                     DataType values_type,
+                     int64 n) {
+  if (values == nullptr) {
+    radix_sort<K, uint32>(pool, keys, nullptr, n);
+    return;
+  }
+  const int size = data_type_size(values_type);
+  if (size == 4) {
+    radix_sort(pool, keys, typed<uint32>(values), n);
+  } else if (size == 8) {
+    radix_sort(pool, keys, typed<uint64>(values), n);
+  } else {
+    TI_ERROR("Sorting values of {} is not supported.",
+             data_type_name(values_type));
+  }
+}
+
+}  // namespace
+
+void radix_sort(ThreadPool *pool,
+                void *keys,
+                DataType keys_type,
+                void *values,
+                DataType values_type,
+                int64 n) {
+  if (keys_type->is_primitive(PrimitiveTypeID::i32)) {
+    radix_sort_keys(pool, typed<int32>(keys), values, values_type, n);
+  } else if (keys_type->is_primitive(PrimitiveTypeID::i64)) {
+    radix_sort_keys(pool, typed<int64>(keys), values, values_type, n);
+  } else if (keys_type->is_primitive(PrimitiveTypeID::u32)) {
+    radix_sort_keys(pool, typed<uint32>(keys), values, values_type, n);
+  } else if (keys_type->is_primitive(PrimitiveTypeID::u64)) {
+    radix_sort_keys(pool, typed<uint64>(keys), values, values_type, n);
+  } else if (keys_type->is_primitive(PrimitiveTypeID::f32)) {
+    radix_sort_keys(pool, typed<float32>(keys), values, values_type, n);
+  } else if (keys_type->is_primitive(PrimitiveTypeID::f64)) {
+    radix_sort_keys(pool, typed<float64>(keys), values, values_type, n);
+  } else {
+    TI_ERROR("Sorting keys of {} is not supported.",
+             data_type_name(keys_type));
+  }
+}
+
+int64 compact(ThreadPool *pool,
+              const void *data,
+              DataType dt,
+              const int32 *flags,
+              void *out,
+              int64 n) {
+  const int size = data_type_size(dt);
+  if (size == 4) {
+    return compact(pool, (const uint32 *)data, flags, typed<uint32>(out), n);
+  } else if (size == 8) {
+    return compact(pool, (const uint64 *)data, flags, typed<uint64>(out), n);
+  }
+  TI_ERROR("Compacting {} is not supported.", data_type_name(dt));
+}
+
+}  // namespace lang
+}  // namespace taichi
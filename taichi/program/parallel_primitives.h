@@ -0,0 +1,57 @@
+#pragma once
+
+#include "taichi/common/core.h"
+#include "taichi/ir/type.h"
+
+namespace taichi {
+
+class ThreadPool;
+
+namespace lang {
+
+// Parallel building blocks on arrays in host memory: prefix sums, radix sort
+// and stream compaction. They run on |pool| if it is not null, and serially
+// otherwise. Used by the CPU path of ti.algorithms and by
+// SparseMatrixBuilder::build().
+
+// Replaces |data| with its exclusive prefix sum, and returns the total.
+template <typename T>
+T exclusive_scan(ThreadPool *pool, T *data, int64 n);
+
+// Sorts |keys| in ascending order with a stable LSD radix sort. |values|, if
+// not null, is permuted along with the keys. K is an integral or a real type,
+// V any type of 4 or 8 bytes.
+template <typename K, typename V>
+void radix_sort(ThreadPool *pool, K *keys, V *values, int64 n);
+
+// Copies the elements of |data| whose flag is non-zero into |out|, keeping
+// their order, and returns how many were copied. |out| must not overlap
+// |data|.
+template <typename T>
+int64 compact(ThreadPool *pool,
+              const T *data,
+              const int32 *flags,
+              T *out,
+              int64 n);
+
+// The same on untyped buffers, for the Python bindings. The element types are
+// given as DataTypes, and |values_type| is ignored if |values| is null.
+TypedConstant exclusive_scan(ThreadPool *pool,
+                             void *data,
+                             DataType dt,
+                             int64 n);
+void radix_sort(ThreadPool *pool,
+                void *keys,
+                DataType keys_type,
+                void *values,
+                DataType values_type,
+                int64 n);
+int64 compact(ThreadPool *pool,
+              const void *data,
+              DataType dt,
+              const int32 *flags,
+              void *out,
+              int64 n);
+
+}  // namespace lang
+}  // namespace taichi
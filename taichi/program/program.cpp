@@ -2,6 +2,7 @@
 
 #include "program.h"
 
+#include "taichi/ir/analysis.h"
 #include "taichi/ir/statements.h"
 #include "taichi/program/extension.h"
 #include "taichi/backends/cpu/codegen_cpu.h"
@@ -13,12 +14,16 @@
 #include "taichi/backends/metal/metal_program.h"
 #include "taichi/backends/cc/cc_program.h"
 #include "taichi/platform/cuda/detect_cuda.h"
+#include "taichi/system/device_memory_tracker.h"
 #include "taichi/system/unified_allocator.h"
 #include "taichi/system/timeline.h"
 #include "taichi/ir/snode.h"
+#include "taichi/ir/pass_profiler.h"
 #include "taichi/ir/frontend_ir.h"
+#include "taichi/ir/ir_serializer.h"
 #include "taichi/program/async_engine.h"
 #include "taichi/program/snode_expr_utils.h"
+#include "taichi/util/metrics.h"
 #include "taichi/util/statistics.h"
 #include "taichi/math/arithmetic.h"
 #ifdef TI_WITH_LLVM
@@ -32,12 +37,17 @@
 #include "taichi/backends/vulkan/vulkan_program.h"
 #include "taichi/backends/vulkan/vulkan_loader.h"
 #endif
+#if defined(TI_WITH_CUDA)
+#include "taichi/backends/cuda/cuda_stream_scheduler.h"
+#endif
 
 #if defined(TI_ARCH_x64)
 // For _MM_SET_FLUSH_ZERO_MODE
 #include <xmmintrin.h>
 #endif
 
+#include <numeric>
+
 namespace taichi {
 namespace lang {
 Program *current_program = nullptr;
@@ -67,7 +77,7 @@ Program::Program(Arch desired_arch)
   config = default_compile_config;
   config.arch = desired_arch;
   // TODO: allow users to run in debug mode without out-of-bound checks
-  if (config.debug)
+  if (config.debug || config.check_out_of_bound_deferred)
     config.check_out_of_bound = true;
 
   profiler = make_profiler(config.arch, config.kernel_profiler);
@@ -107,12 +117,12 @@ Program::Program(Arch desired_arch)
   compute_device = program_impl_->get_compute_device();
   // Must have handled all the arch fallback logic by this point.
   memory_pool_ = std::make_unique<MemoryPool>(config.arch, compute_device);
-  TI_ASSERT_INFO(num_instances_ == 0, "Only one instance at a time");
   total_compilation_time_ = 0;
-  num_instances_ += 1;
-  SNode::counter = 0;
-  TI_ASSERT(current_program == nullptr);
-  current_program = this;
+  // The SNode ids stay unique among the programs alive side by side.
+  if (num_instances_++ == 0) {
+    SNode::counter = 0;
+  }
+  make_current();
   if (arch_uses_llvm(config.arch)) {
 #if TI_WITH_LLVM
     static_cast<LlvmProgramImpl *>(program_impl_.get())->initialize_host();
@@ -133,6 +143,18 @@ Program::Program(Arch desired_arch)
         &config, [this](Kernel &kernel, OffloadedStmt *offloaded) {
           return this->compile(kernel, offloaded);
         });
+    if (config.async_cuda_num_streams > 1) {
+      if (config.arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+        async_engine->queue.set_stream_scheduler(
+            std::make_unique<CUDAStreamScheduler>(
+                config.async_cuda_num_streams));
+#endif
+      } else {
+        TI_WARN("async_cuda_num_streams is ignored on arch={}",
+                arch_name(config.arch));
+      }
+    }
   }
 
   if (!is_extension_supported(config.arch, Extension::assertion)) {
@@ -140,12 +162,22 @@ Program::Program(Arch desired_arch)
       TI_WARN("Out-of-bound access checking is not supported on arch={}",
               arch_name(config.arch));
       config.check_out_of_bound = false;
+      config.check_out_of_bound_deferred = false;
     }
   }
 
   stat.clear();
 
   Timelines::get_instance().set_enabled(config.timeline);
+  DeviceMemoryTracker::get_instance().clear();
+  DeviceMemoryTracker::get_instance().set_enabled(config.track_device_memory);
+  PassProfiler::get_instance().set_enabled(config.profile_passes);
+  if (config.layout_advisor) {
+    layout_advisor = std::make_unique<LayoutAdvisor>();
+  }
+  if (config.access_pattern_report) {
+    access_pattern_report = std::make_unique<AccessPatternReport>();
+  }
 
   TI_TRACE("Program ({}) arch={} initialized.", fmt::ptr(this),
            arch_name(config.arch));
@@ -169,13 +201,26 @@ Function *Program::create_function(const FunctionKey &func_key) {
 FunctionType Program::compile(Kernel &kernel, OffloadedStmt *offloaded) {
   auto start_t = Time::get_time();
   TI_AUTO_PROF;
+  // Everything after compile_to_offloads(), which is profiled per pass.
+  ScopedCompileStage stage(kernel.get_name(),
+                           fmt::format("backend ({})", arch_name(config.arch)));
   auto ret = program_impl_->compile(&kernel, offloaded);
   TI_ASSERT(ret);
-  total_compilation_time_ += Time::get_time() - start_t;
+  const auto elapsed = Time::get_time() - start_t;
+  total_compilation_time_ += elapsed;
+  static auto &compilations = metrics().counter(
+      "taichi_kernel_compilations", "Kernels (or async tasks) compiled.");
+  static auto &compile_seconds = metrics().histogram(
+      "taichi_kernel_compile_seconds",
+      "Backend compilation time of a kernel (or async task).",
+      {0.001, 0.01, 0.1, 1, 10});
+  compilations.add();
+  compile_seconds.observe(elapsed);
   return ret;
 }
 
 void Program::materialize_runtime() {
+  DeviceMemoryTracker::Scope scope("runtime");
   program_impl_->materialize_runtime(memory_pool_.get(), profiler.get(),
                                      &result_buffer);
 }
@@ -185,11 +230,38 @@ void Program::destroy_snode_tree(SNodeTree *snode_tree) {
   program_impl_->destroy_snode_tree(snode_tree);
 }
 
+namespace {
+// The tree and the names of the first few fields placed in it.
+std::string snode_tree_memory_tag(SNode *root, int id) {
+  std::vector<std::string> names;
+  std::function<void(SNode *)> visit = [&](SNode *snode) {
+    if (snode->type == SNodeType::place && !snode->name.empty()) {
+      names.push_back(snode->name);
+    }
+    for (auto &ch : snode->ch) {
+      visit(ch.get());
+    }
+  };
+  visit(root);
+  constexpr int kMaxNumNames = 4;
+  if (names.size() > kMaxNumNames) {
+    names.resize(kMaxNumNames);
+    names.push_back("...");
+  }
+  if (names.empty()) {
+    return fmt::format("tree {}", id);
+  }
+  return fmt::format("tree {} ({})", id, fmt::join(names, ", "));
+}
+}  // namespace
+
 SNodeTree *Program::add_snode_tree(std::unique_ptr<SNode> root,
                                    bool compile_only) {
   const int id = snode_trees_.size();
   auto tree = std::make_unique<SNodeTree>(id, std::move(root));
   tree->root()->set_snode_tree_id(id);
+  DeviceMemoryTracker::Scope scope("snode_tree",
+                                   snode_tree_memory_tag(tree->root(), id));
   if (compile_only) {
     program_impl_->compile_snode_tree_types(tree.get(), snode_trees_);
   } else {
@@ -197,6 +269,8 @@ SNodeTree *Program::add_snode_tree(std::unique_ptr<SNode> root,
                                           result_buffer);
   }
   snode_trees_.push_back(std::move(tree));
+  // Zero-filled when materialized.
+  record_snode_tree_writes({id}, /*unknown=*/false);
 
   return snode_trees_[id].get();
 }
@@ -205,6 +279,26 @@ SNode *Program::get_snode_root(int tree_id) {
   return snode_trees_[tree_id]->root();
 }
 
+void Program::record_snode_tree_writes(const std::vector<int> &trees,
+                                       bool unknown) {
+  std::lock_guard<std::mutex> _(write_versions_mut_);
+  last_write_version_++;
+  for (int tree_id : trees) {
+    snode_tree_write_versions_[tree_id] = last_write_version_;
+  }
+  if (unknown) {
+    unknown_write_version_ = last_write_version_;
+  }
+}
+
+uint64 Program::get_snode_tree_write_version(int tree_id) {
+  std::lock_guard<std::mutex> _(write_versions_mut_);
+  auto it = snode_tree_write_versions_.find(tree_id);
+  const uint64 version =
+      it == snode_tree_write_versions_.end() ? 0 : it->second;
+  return std::max(version, unknown_write_version_);
+}
+
 void Program::check_runtime_error() {
 #ifdef TI_WITH_LLVM
   TI_ASSERT(arch_uses_llvm(config.arch));
@@ -226,6 +320,58 @@ void Program::synchronize() {
     }
     sync = true;
   }
+  // The deferred checks are only reported here, instead of synchronizing
+  // after each launch like in debug mode.
+  if (config.check_out_of_bound_deferred && arch_uses_llvm(config.arch)) {
+    check_runtime_error();
+  }
+}
+
+void Program::synchronize_host_read() {
+  if (!last_launch_was_host_read()) {
+    synchronize();
+  }
+}
+
+std::vector<int> Program::fill_dense_fields(const std::vector<SNode *> &snodes,
+                                           uint64 bits) {
+  std::vector<int> left(snodes.size());
+  std::iota(left.begin(), left.end(), 0);
+#ifdef TI_WITH_LLVM
+  if (arch_uses_llvm(config.arch)) {
+    left = get_llvm_program_impl()->fill_dense_fields(snodes, bits);
+    if (left.size() < snodes.size()) {
+      sync = sync && arch_is_cpu(config.arch);
+    }
+  }
+#endif
+  return left;
+}
+
+bool Program::copy_dense_field(SNode *dst, SNode *src) {
+#ifdef TI_WITH_LLVM
+  if (arch_uses_llvm(config.arch) &&
+      get_llvm_program_impl()->copy_dense_field(dst, src)) {
+    sync = sync && arch_is_cpu(config.arch);
+    return true;
+  }
+#endif
+  return false;
+}
+
+void Program::discard_values(const std::vector<SNode *> &snodes) {
+  if (!config.async_mode || snodes.empty()) {
+    return;
+  }
+  if (discard_kernel_ == nullptr) {
+    auto block = std::make_unique<Block>();
+    block->insert(std::make_unique<OffloadedStmt>(OffloadedTaskType::serial,
+                                                  config.arch));
+    kernels.emplace_back(
+        std::make_unique<Kernel>(*this, std::move(block), "discard"));
+    discard_kernel_ = kernels.back().get();
+  }
+  async_engine->discard(discard_kernel_, snodes);
 }
 
 void Program::async_flush() {
@@ -236,10 +382,150 @@ void Program::async_flush() {
   async_engine->flush();
 }
 
+void Program::async_begin_batch() {
+  if (config.async_mode) {
+    async_engine->begin_batch();
+  }
+}
+
+void Program::async_end_batch() {
+  if (config.async_mode) {
+    async_engine->end_batch();
+  }
+}
+
 int Program::get_snode_tree_size() {
   return snode_trees_.size();
 }
 
+namespace {
+void collect_snodes(SNode *snode, std::unordered_map<int, SNode *> &snodes) {
+  snodes[snode->id] = snode;
+  for (auto &ch : snode->ch) {
+    collect_snodes(ch.get(), snodes);
+  }
+}
+
+void describe_snode(const SNode *snode, std::string &out) {
+  out += fmt::format("{}:{}:{}:{}", snode->id, snode_type_name(snode->type),
+                     snode->dt->to_string(), snode->num_active_indices);
+  for (int i = 0; i < taichi_max_num_indices; i++) {
+    out += fmt::format(",{}", snode->extractors[i].num_elements_from_root);
+  }
+  if (snode->_morton) {
+    out += ":morton";
+  }
+  out += "(";
+  for (auto &ch : snode->ch) {
+    describe_snode(ch.get(), out);
+  }
+  out += ")";
+}
+}  // namespace
+
+void Program::record_stencil_footprints(IRNode *root) {
+  auto footprints = irpass::analysis::gather_stencil_footprints(root);
+  std::lock_guard<std::mutex> _(stencil_footprints_mut_);
+  for (auto &[snode, footprint] : footprints) {
+    auto [it, inserted] = stencil_footprints_.try_emplace(snode->id);
+    auto &merged = it->second;
+    if (footprint.irregular || (!inserted && !merged.has_value())) {
+      merged = std::nullopt;
+    } else if (inserted) {
+      merged = footprint.offsets;
+    } else {
+      for (int i = 0; i < (int)merged->size(); i++) {
+        (*merged)[i].first =
+            std::min((*merged)[i].first, footprint.offsets[i].first);
+        (*merged)[i].second =
+            std::max((*merged)[i].second, footprint.offsets[i].second);
+      }
+    }
+  }
+}
+
+std::optional<std::vector<std::pair<int, int>>> Program::get_stencil_footprint(
+    int snode_id) {
+  std::lock_guard<std::mutex> _(stencil_footprints_mut_);
+  auto it = stencil_footprints_.find(snode_id);
+  if (it == stencil_footprints_.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+std::string Program::get_snode_trees_fingerprint() {
+  std::string fingerprint;
+  for (auto &tree : snode_trees_) {
+    describe_snode(tree->root(), fingerprint);
+  }
+  return fingerprint;
+}
+
+Kernel *Program::load_kernel(const std::vector<uint8> &data,
+                             const std::string &name) {
+  // The arguments are restored after the kernel is created, which must not
+  // compile it yet.
+  if (!config.lazy_compilation) {
+    return nullptr;
+  }
+  std::unordered_map<int, SNode *> snodes;
+  for (auto &tree : snode_trees_) {
+    collect_snodes(tree->root(), snodes);
+  }
+  auto get_snode = [&](int id) -> SNode * {
+    auto it = snodes.find(id);
+    return it == snodes.end() ? nullptr : it->second;
+  };
+  std::vector<Callable::Arg> args;
+  std::vector<Callable::Ret> rets;
+  auto ir = deserialize_ir_binary(data, get_snode, &args, &rets);
+  if (!ir) {
+    return nullptr;
+  }
+  auto kernel = std::make_unique<Kernel>(*this, std::move(ir), name);
+  kernel->args = std::move(args);
+  kernel->rets = std::move(rets);
+  kernels.emplace_back(std::move(kernel));
+  return kernels.back().get();
+}
+
+namespace {
+std::vector<const SNodeTree *> get_checkpoint_trees(
+    ProgramImpl *program_impl,
+    const std::vector<std::unique_ptr<SNodeTree>> &snode_trees) {
+  std::vector<const SNodeTree *> trees;
+  for (const auto &tree : snode_trees) {
+    if (tree != nullptr &&
+        program_impl->get_snode_tree_buffer_size(tree->id()) > 0) {
+      trees.push_back(tree.get());
+    }
+  }
+  return trees;
+}
+}  // namespace
+
+void Program::save_checkpoint(const std::string &filename,
+                              const CheckpointOptions &options) {
+  TI_ERROR_IF(!arch_uses_llvm(config.arch),
+              "Checkpoints are not supported on {}", arch_name(config.arch));
+  synchronize();
+  save_snode_trees(program_impl_.get(),
+                   get_checkpoint_trees(program_impl_.get(), snode_trees_),
+                   filename, options);
+}
+
+void Program::load_checkpoint(const std::string &filename, int num_threads) {
+  TI_ERROR_IF(!arch_uses_llvm(config.arch),
+              "Checkpoints are not supported on {}", arch_name(config.arch));
+  synchronize();
+  load_snode_trees(program_impl_.get(),
+                   get_checkpoint_trees(program_impl_.get(), snode_trees_),
+                   filename, num_threads);
+  synchronize();
+  record_snode_tree_writes({}, /*unknown=*/true);
+}
+
 std::string capitalize_first(std::string s) {
   s[0] = std::toupper(s[0]);
   return s;
@@ -427,11 +713,32 @@ Kernel &Program::get_ndarray_writer(Ndarray *ndarray) {
   return ker;
 }
 
+uint64 *Program::get_thread_result_buffer() {
+  if (!arch_uses_llvm(config.arch)) {
+    return result_buffer;
+  }
+  std::lock_guard<std::mutex> _(thread_result_buffers_mut_);
+  auto &buffer = thread_result_buffers_[std::this_thread::get_id()];
+  if (!buffer) {
+    if (thread_result_buffers_.size() == 1) {
+      buffer = result_buffer;
+    } else {
+#ifdef TI_WITH_LLVM
+      buffer = static_cast<LlvmProgramImpl *>(program_impl_.get())
+                   ->allocate_result_buffer(memory_pool_.get());
+#else
+      TI_NOT_IMPLEMENTED
+#endif
+    }
+  }
+  return buffer;
+}
+
 uint64 Program::fetch_result_uint64(int i) {
   if (arch_uses_llvm(config.arch)) {
 #ifdef TI_WITH_LLVM
     return static_cast<LlvmProgramImpl *>(program_impl_.get())
-        ->fetch_result<uint64>(i, result_buffer);
+        ->fetch_return_value(i, get_thread_result_buffer());
 #else
     TI_NOT_IMPLEMENTED
 #endif
@@ -440,6 +747,8 @@ uint64 Program::fetch_result_uint64(int i) {
 }
 
 void Program::finalize() {
+  // Does not throw the errors of the deferred checks while finalizing.
+  config.check_out_of_bound_deferred = false;
   synchronize();
   if (async_engine)
     async_engine = nullptr;  // Finalize the async engine threads before
@@ -481,7 +790,11 @@ void Program::finalize() {
   }
 
   synchronize();
-  current_program = nullptr;
+  // The images of the textures are destroyed before their device.
+  textures_.clear();
+  if (current_program == this) {
+    current_program = nullptr;
+  }
   memory_pool_->terminate();
 
   if (arch_uses_llvm(config.arch)) {
@@ -497,6 +810,14 @@ void Program::finalize() {
   TI_TRACE("Program ({}) finalized_.", fmt::ptr(this));
 }
 
+Texture *Program::create_texture(const DataType type,
+                                 int num_channels,
+                                 const std::vector<int> &shape) {
+  textures_.push_back(
+      std::make_unique<Texture>(this, type, num_channels, shape));
+  return textures_.back().get();
+}
+
 int Program::default_block_dim(const CompileConfig &config) {
   if (arch_is_cpu(config.arch)) {
     return config.default_cpu_block_dim;
@@ -522,6 +843,17 @@ std::size_t Program::get_snode_num_dynamically_allocated(SNode *snode) {
                                                             result_buffer);
 }
 
+SNodeMemoryStats Program::get_snode_memory_stats(SNode *snode) {
+#ifdef TI_WITH_LLVM
+  TI_ERROR_IF(!arch_uses_llvm(config.arch),
+              "SNode memory stats are only available on the LLVM backends");
+  return static_cast<LlvmProgramImpl *>(program_impl_.get())
+      ->get_snode_memory_stats(snode, result_buffer);
+#else
+  TI_ERROR("Llvm disabled");
+#endif
+}
+
 Program::~Program() {
   if (!finalized_)
     finalize();
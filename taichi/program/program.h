@@ -5,6 +5,9 @@
 #include <functional>
 #include <optional>
 #include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 #define TI_RUNTIME_HOST
 #include "taichi/ir/ir.h"
@@ -17,9 +20,14 @@
 #include "taichi/program/function.h"
 #include "taichi/program/kernel.h"
 #include "taichi/program/kernel_profiler.h"
+#include "taichi/program/layout_advisor.h"
+#include "taichi/program/access_pattern_report.h"
 #include "taichi/program/snode_expr_utils.h"
+#include "taichi/program/snode_memory_stats.h"
 #include "taichi/program/snode_rw_accessors_bank.h"
+#include "taichi/program/snode_tree_checkpoint.h"
 #include "taichi/program/ndarray_rw_accessors_bank.h"
+#include "taichi/program/texture.h"
 #include "taichi/program/context.h"
 #include "taichi/runtime/runtime.h"
 #include "taichi/struct/snode_tree.h"
@@ -32,48 +40,8 @@
 namespace taichi {
 namespace lang {
 
-struct JITEvaluatorId {
-  std::thread::id thread_id;
-  // Note that on certain backends (e.g. CUDA), functions created in one
-  // thread cannot be used in another. Hence the thread_id member.
-  int op;
-  DataType ret, lhs, rhs;
-  bool is_binary;
-
-  UnaryOpType unary_op() const {
-    TI_ASSERT(!is_binary);
-    return (UnaryOpType)op;
-  }
-
-  BinaryOpType binary_op() const {
-    TI_ASSERT(is_binary);
-    return (BinaryOpType)op;
-  }
-
-  bool operator==(const JITEvaluatorId &o) const {
-    return thread_id == o.thread_id && op == o.op && ret == o.ret &&
-           lhs == o.lhs && rhs == o.rhs && is_binary == o.is_binary;
-  }
-};
-
-}  // namespace lang
-}  // namespace taichi
-
-namespace std {
-template <>
-struct hash<taichi::lang::JITEvaluatorId> {
-  std::size_t operator()(
-      taichi::lang::JITEvaluatorId const &id) const noexcept {
-    return ((std::size_t)id.op | (id.ret.hash() << 8) | (id.lhs.hash() << 16) |
-            (id.rhs.hash() << 24) | ((std::size_t)id.is_binary << 31)) ^
-           (std::hash<std::thread::id>{}(id.thread_id) << 32);
-  }
-};
-}  // namespace std
-
-namespace taichi {
-namespace lang {
-
+// The program the frontend builds kernels for. Several programs, e.g. one on
+// the CPU and one on CUDA, may live side by side; see Program::make_current().
 extern Program *current_program;
 
 TI_FORCE_INLINE Program &get_current_program() {
@@ -102,7 +70,11 @@ class Program {
   using Kernel = taichi::lang::Kernel;
   Callable *current_callable{nullptr};
   CompileConfig config;
-  bool sync{false};  // device/host synchronized?
+  // Device/host synchronized? Kernels may be launched from multiple threads.
+  std::atomic<bool> sync{false};
+  // The number of kernel launches so far, which keys the counter-based random
+  // numbers of each launch.
+  std::atomic<uint32> num_rand_launches{0};
 
   uint64 *result_buffer{nullptr};  // Note result_buffer is used by all backends
 
@@ -112,10 +84,11 @@ class Program {
 
   std::unique_ptr<KernelProfilerBase> profiler{nullptr};
 
-  std::unordered_map<JITEvaluatorId, std::unique_ptr<Kernel>>
-      jit_evaluator_cache;
-  std::mutex jit_evaluator_cache_mut;
-  std::atomic<uint32_t> jit_evaluator_id{0};
+  // Created if CompileConfig::layout_advisor is set.
+  std::unique_ptr<LayoutAdvisor> layout_advisor{nullptr};
+
+  // Created if CompileConfig::access_pattern_report is set.
+  std::unique_ptr<AccessPatternReport> access_pattern_report{nullptr};
 
   // Note: for now we let all Programs share a single TypeFactory for smooth
   // migration. In the future each program should have its own copy.
@@ -128,6 +101,17 @@ class Program {
 
   ~Program();
 
+  /**
+   * Makes this program the one the frontend builds kernels and fields for.
+   * A new program is current until another one is made current.
+   *
+   * The kernels and fields of each program keep running on it regardless,
+   * with its own config, ProgramImpl and memory pool.
+   */
+  void make_current() {
+    current_program = this;
+  }
+
   struct KernelProfilerQueryResult {
     int counter{0};
     double min{0.0};
@@ -137,12 +121,15 @@ class Program {
 
   KernelProfilerQueryResult query_kernel_profile_info(const std::string &name) {
     KernelProfilerQueryResult query_result;
+    synchronize();
     profiler->query(name, query_result.counter, query_result.min,
                     query_result.max, query_result.avg);
     return query_result;
   }
 
   void clear_kernel_profile_info() {
+    // So that the pending kernels are not recorded after clearing.
+    synchronize();
     profiler->clear();
   }
 
@@ -160,10 +147,24 @@ class Program {
 
   void synchronize();
 
+  // Whether the last launch of the calling thread ran to completion on a
+  // stream of its own. See CompileConfig::cuda_fine_grained_host_sync.
+  bool last_launch_was_host_read() {
+    return program_impl_ && program_impl_->last_launch_was_host_read();
+  }
+
+  // Synchronizes before the host reads the output of the last launch of the
+  // calling thread, unless that launch is already done.
+  void synchronize_host_read();
+
   // See AsyncEngine::flush().
   // Only useful when async mode is enabled.
   void async_flush();
 
+  // See AsyncEngine::begin_batch(). No-ops when async mode is disabled.
+  void async_begin_batch();
+  void async_end_batch();
+
   /**
    * Materializes the runtime.
    */
@@ -171,18 +172,103 @@ class Program {
 
   int get_snode_tree_size();
 
+  /**
+   * Describes the structure of all the SNode trees: the ids, types, data
+   * types and shapes of their SNodes. Kernels referring to the SNodes by id
+   * (see ir_serializer.h) can be reused while this stays the same.
+   */
+  std::string get_snode_trees_fingerprint();
+
+  /**
+   * Merges the stencil footprints of the struct-for tasks in |root| into
+   * those of the kernels compiled so far. See get_stencil_footprint().
+   */
+  void record_stencil_footprints(IRNode *root);
+
+  /**
+   * Where the struct-fors of the kernels compiled so far read the place SNode
+   * |snode_id| around their loop indices: the lowest and highest offset in
+   * each dimension, i.e. the halo a block of the field needs when the field
+   * is split along its indices. std::nullopt if the SNode is read by no
+   * struct-for, or not at constant offsets.
+   */
+  std::optional<std::vector<std::pair<int, int>>> get_stencil_footprint(
+      int snode_id);
+
+  /**
+   * Writes the SNode trees mapped from files back to the files, or only starts
+   * to unless |wait|. See CompileConfig::cpu_snode_tree_file_dir.
+   */
+  void write_back_snode_trees(bool wait) {
+    synchronize();
+    program_impl_->write_back_snode_trees(wait);
+  }
+
+  /**
+   * The bytes of the memory allocated by the device that are backed by huge
+   * pages, and the bytes allocated. See CompileConfig::cpu_huge_pages.
+   */
+  std::pair<std::size_t, std::size_t> get_huge_page_coverage() {
+    return program_impl_->get_huge_page_coverage();
+  }
+
+  /**
+   * Fills the dense fields |snodes| with the value of bits |bits| without
+   * launching a kernel where possible. See
+   * LlvmProgramImpl::fill_dense_fields().
+   *
+   * @return The positions in |snodes| of the fields left to a kernel.
+   */
+  std::vector<int> fill_dense_fields(const std::vector<SNode *> &snodes,
+                                     uint64 bits);
+
+  /**
+   * Copies the dense field |src| into |dst| without launching a kernel if
+   * possible.
+   *
+   * @return Whether the field was copied.
+   */
+  bool copy_dense_field(SNode *dst, SNode *src);
+
+  /**
+   * Declares that the values of the place SNodes |snodes| are not read again
+   * before being written, so that the async engine eliminates the pending
+   * stores to them. A no-op out of async mode.
+   */
+  void discard_values(const std::vector<SNode *> &snodes);
+
+  /**
+   * Saves the data of all the SNode trees into |filename|. See
+   * snode_tree_checkpoint.h for the format and the supported SNodes.
+   */
+  void save_checkpoint(const std::string &filename,
+                       const CheckpointOptions &options);
+
+  /**
+   * Restores the data of all the SNode trees from |filename|.
+   */
+  void load_checkpoint(const std::string &filename, int num_threads);
+
   void visualize_layout(const std::string &fn);
 
   Kernel &kernel(const std::function<void()> &body,
                  const std::string &name = "",
-                 bool grad = false) {
+                 AutodiffMode autodiff_mode = AutodiffMode::none) {
     // Expr::set_allow_store(true);
-    auto func = std::make_unique<Kernel>(*this, body, name, grad);
+    auto func = std::make_unique<Kernel>(*this, body, name, autodiff_mode);
     // Expr::set_allow_store(false);
     kernels.emplace_back(std::move(func));
     return *kernels.back();
   }
 
+  /**
+   * Creates a kernel from the IR serialized by
+   * Kernel::lower_ast_and_serialize().
+   *
+   * @return nullptr if |data| cannot be loaded into this program.
+   */
+  Kernel *load_kernel(const std::vector<uint8> &data, const std::string &name);
+
   Function *create_function(const FunctionKey &func_key);
 
   // TODO: This function is doing two things: 1) compiling CHI IR, and 2)
@@ -201,6 +287,26 @@ class Program {
 
   Kernel &get_ndarray_writer(Ndarray *ndarray);
 
+  /**
+   * Creates a texture on the graphics device, which lives until the program
+   * is finalized. Only supported on Vulkan.
+   */
+  Texture *create_texture(const DataType type,
+                          int num_channels,
+                          const std::vector<int> &shape);
+
+  /**
+   * Returns the buffer receiving the return values of the kernels launched by
+   * the calling thread, so that the threads launching kernels concurrently do
+   * not overwrite each other's. The first thread to ask uses
+   * |result_buffer|.
+   *
+   * Only the LLVM backends store the return values per thread. The others
+   * always use |result_buffer|.
+   */
+  uint64 *get_thread_result_buffer();
+
+  // Reads the return values of the kernels launched by the calling thread.
   uint64 fetch_result_uint64(int i);
 
   template <typename T>
@@ -235,6 +341,9 @@ class Program {
   // Returns zero if the SNode is statically allocated
   std::size_t get_snode_num_dynamically_allocated(SNode *snode);
 
+  // LLVM backends only
+  SNodeMemoryStats get_snode_memory_stats(SNode *snode);
+
   inline SNodeGlobalVarExprMap *get_snode_to_glb_var_exprs() {
     return &snode_to_glb_var_exprs_;
   }
@@ -277,6 +386,14 @@ class Program {
    */
   SNode *get_snode_root(int tree_id);
 
+  // Called on each launch of a kernel that may write |trees|, or some tree
+  // it cannot tell if |unknown|.
+  void record_snode_tree_writes(const std::vector<int> &trees, bool unknown);
+
+  // Increases whenever a kernel launched may write the tree, so that e.g.
+  // GGUI uploads a field only when it may have changed.
+  uint64 get_snode_tree_write_version(int tree_id);
+
   std::unique_ptr<AotModuleBuilder> make_aot_module_builder(Arch arch);
 
   LlvmProgramImpl *get_llvm_program_impl();
@@ -303,6 +420,10 @@ class Program {
     return program_impl_->allocate_memory_ndarray(alloc_size, result_buffer);
   }
 
+  DeviceAllocation import_memory_ndarray(void *ptr, std::size_t size) {
+    return program_impl_->import_memory_ndarray(ptr, size);
+  }
+
  private:
   // SNode information that requires using Program.
   SNodeGlobalVarExprMap snode_to_glb_var_exprs_;
@@ -312,6 +433,7 @@ class Program {
   std::vector<std::unique_ptr<SNodeTree>> snode_trees_;
 
   std::vector<std::unique_ptr<Function>> functions_;
+  std::vector<std::unique_ptr<Texture>> textures_;
   std::unordered_map<FunctionKey, Function *> function_map_;
 
   std::unique_ptr<ProgramImpl> program_impl_;
@@ -319,7 +441,23 @@ class Program {
   static std::atomic<int> num_instances_;
   bool finalized_{false};
 
+  std::mutex stencil_footprints_mut_;
+  // By SNode id, std::nullopt if some read is not at constant offsets.
+  std::unordered_map<int, std::optional<std::vector<std::pair<int, int>>>>
+      stencil_footprints_;
+
+  std::mutex thread_result_buffers_mut_;
+  std::unordered_map<std::thread::id, uint64 *> thread_result_buffers_;
+
+  std::mutex write_versions_mut_;
+  uint64 last_write_version_{0};
+  // By SNode tree id.
+  std::unordered_map<int, uint64> snode_tree_write_versions_;
+  // Of the last kernel writing an unknown tree.
+  uint64 unknown_write_version_{0};
   std::unique_ptr<MemoryPool> memory_pool_{nullptr};
+  // Owned by |kernels|, see discard_values().
+  Kernel *discard_kernel_{nullptr};
 };
 
 }  // namespace lang
@@ -79,10 +79,80 @@ class ProgramImpl {
     return kDeviceNullPtr;
   }
 
+  /**
+   * The size in bytes of the root buffer of the SNode tree |tree_id|, or 0 if
+   * the backend can not copy it, see read_snode_tree_buffer().
+   */
+  virtual std::size_t get_snode_tree_buffer_size(int tree_id) {
+    return 0;
+  }
+
+  /**
+   * The root buffer of |tree_id| if it lives in host memory, nullptr
+   * otherwise.
+   */
+  virtual void *get_snode_tree_host_ptr(int tree_id) {
+    return nullptr;
+  }
+
+  /**
+   * Copies |size| bytes at |offset| of the root buffer of |tree_id| into host
+   * memory. May be called from multiple threads at a time.
+   */
+  virtual void read_snode_tree_buffer(int tree_id,
+                                      std::size_t offset,
+                                      void *dst,
+                                      std::size_t size) {
+    TI_NOT_IMPLEMENTED;
+  }
+
+  /**
+   * Copies |size| bytes of host memory to |offset| of the root buffer of
+   * |tree_id|. May be called from multiple threads at a time.
+   */
+  virtual void write_snode_tree_buffer(int tree_id,
+                                       std::size_t offset,
+                                       const void *src,
+                                       std::size_t size) {
+    TI_NOT_IMPLEMENTED;
+  }
+
+  /**
+   * Writes the SNode trees backed by files back to the files, or only starts
+   * to unless |wait|. See CompileConfig::cpu_snode_tree_file_dir.
+   */
+  virtual void write_back_snode_trees(bool wait) {
+  }
+
+  /**
+   * The bytes allocated by the device that are backed by huge pages, and the
+   * bytes allocated. See CompileConfig::cpu_huge_pages.
+   */
+  virtual std::pair<std::size_t, std::size_t> get_huge_page_coverage() {
+    return {0, 0};
+  }
+
+  /**
+   * Whether the last launch of the calling thread was a host read, which is
+   * done once the launch returns. See
+   * CompileConfig::cuda_fine_grained_host_sync.
+   */
+  virtual bool last_launch_was_host_read() {
+    return false;
+  }
+
   virtual DeviceAllocation allocate_memory_ndarray(std::size_t alloc_size,
                                                    uint64 *result_buffer) {
     return kDeviceNullAllocation;
   }
+
+  /**
+   * Wraps memory owned by the caller as a DeviceAllocation, for ndarrays that
+   * don't own their storage. Returns kDeviceNullAllocation if unsupported.
+   */
+  virtual DeviceAllocation import_memory_ndarray(void *ptr, std::size_t size) {
+    return kDeviceNullAllocation;
+  }
   virtual ~ProgramImpl() {
   }
 
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+
+namespace taichi {
+namespace lang {
+
+/**
+ * The memory of the dynamically allocated nodes of an SNode, see
+ * Program::get_snode_memory_stats().
+ */
+struct SNodeMemoryStats {
+  int element_size{0};
+  int elements_per_chunk{0};
+  int num_chunks{0};
+  // Nodes ever allocated, i.e. the length of the data list.
+  int num_reserved{0};
+  // Deallocated nodes in the free list, which are reused first.
+  int num_free{0};
+  // Nodes deactivated since the last gc, which join the free list in the next
+  // one.
+  int num_recycled{0};
+  int num_live{0};
+  std::size_t allocated_bytes{0};
+  // The fraction of the allocated bytes not holding live nodes.
+  double fragmentation{0};
+};
+
+}  // namespace lang
+}  // namespace taichi
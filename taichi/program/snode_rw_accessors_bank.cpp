@@ -1,6 +1,11 @@
 #include "taichi/program/snode_rw_accessors_bank.h"
 
+#include <cstring>
+
 #include "taichi/program/program.h"
+#ifdef TI_WITH_LLVM
+#include "taichi/llvm/llvm_program.h"
+#endif
 
 namespace taichi {
 namespace lang {
@@ -13,8 +18,53 @@ void set_kernel_args(const std::vector<int> &I,
     launch_ctx->set_arg_int(i, I[i]);
   }
 }
+
+// The types that TypedConstant can hold.
+bool is_host_accessible_type(DataType dt) {
+  for (auto id : {PrimitiveTypeID::f32, PrimitiveTypeID::f64,
+                  PrimitiveTypeID::i8, PrimitiveTypeID::i16,
+                  PrimitiveTypeID::i32, PrimitiveTypeID::i64,
+                  PrimitiveTypeID::u8, PrimitiveTypeID::u16,
+                  PrimitiveTypeID::u32, PrimitiveTypeID::u64}) {
+    if (dt->is_primitive(id)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+TypedConstant load_host(DataType dt, const void *addr) {
+  TypedConstant value(dt);
+  std::memcpy(&value.value_bits, addr, data_type_size(dt));
+  return value;
+}
+
+template <typename T>
+void store_host(DataType dt, void *addr, T val) {
+  TypedConstant value(dt, val);
+  std::memcpy(addr, &value.value_bits, data_type_size(dt));
+}
 }  // namespace
 
+SNodeRwAccessorsBank::HostLayout SNodeRwAccessorsBank::compute_host_layout(
+    SNode *snode) {
+  HostLayout layout;
+#ifdef TI_WITH_LLVM
+  if (!arch_is_cpu(program_->config.arch) ||
+      !is_host_accessible_type(snode->dt) ||
+      !LlvmProgramImpl::has_dense_field_layout(snode)) {
+    return layout;
+  }
+  auto dense_layout =
+      program_->get_llvm_program_impl()->get_dense_field_layout(snode);
+  layout.available = true;
+  layout.data = (uint8 *)dense_layout.data_ptr;
+  layout.shape = std::move(dense_layout.shape);
+  layout.strides = std::move(dense_layout.strides);
+#endif
+  return layout;
+}
+
 SNodeRwAccessorsBank::Accessors SNodeRwAccessorsBank::get(SNode *snode) {
   auto &kernels = snode_to_kernels_[snode];
   if (kernels.reader == nullptr) {
@@ -23,6 +73,10 @@ SNodeRwAccessorsBank::Accessors SNodeRwAccessorsBank::get(SNode *snode) {
   if (kernels.writer == nullptr) {
     kernels.writer = &(program_->get_snode_writer(snode));
   }
+  if (!kernels.host_layout_computed) {
+    kernels.host_layout = compute_host_layout(snode);
+    kernels.host_layout_computed = true;
+  }
   return Accessors(snode, kernels, program_);
 }
 
@@ -32,12 +86,40 @@ SNodeRwAccessorsBank::Accessors::Accessors(const SNode *snode,
     : snode_(snode),
       prog_(prog),
       reader_(kernels.reader),
-      writer_(kernels.writer) {
+      writer_(kernels.writer),
+      host_layout_(&kernels.host_layout) {
   TI_ASSERT(reader_ != nullptr);
   TI_ASSERT(writer_ != nullptr);
 }
+
+void *SNodeRwAccessorsBank::Accessors::host_address(
+    const std::vector<int> &I) const {
+  if (!host_layout_->available) {
+    return nullptr;
+  }
+  const auto &offsets = snode_->index_offsets;
+  auto *addr = host_layout_->data;
+  for (int i = 0; i < snode_->num_active_indices; i++) {
+    // Like GlobalPtrExpression::flatten(), from the logical index of a field
+    // declared with offset= to the cell.
+    const int index = offsets.empty() ? I[i] : I[i] - offsets[i];
+    // Out-of-bound accesses are left to the kernels, which report them in
+    // debug mode.
+    if (index < 0 || index >= host_layout_->shape[i]) {
+      return nullptr;
+    }
+    addr += index * host_layout_->strides[i];
+  }
+  return addr;
+}
+
 void SNodeRwAccessorsBank::Accessors::write_float(const std::vector<int> &I,
                                                   float64 val) {
+  if (auto *addr = host_address(I)) {
+    prog_->synchronize();
+    store_host(snode_->dt, addr, val);
+    return;
+  }
   auto launch_ctx = writer_->make_launch_context();
   set_kernel_args(I, snode_->num_active_indices, &launch_ctx);
   launch_ctx.set_arg_float(snode_->num_active_indices, val);
@@ -46,11 +128,14 @@ void SNodeRwAccessorsBank::Accessors::write_float(const std::vector<int> &I,
 }
 
 float64 SNodeRwAccessorsBank::Accessors::read_float(const std::vector<int> &I) {
-  prog_->synchronize();
+  if (auto *addr = host_address(I)) {
+    prog_->synchronize();
+    return load_host(snode_->dt, addr).val_cast_to_float64();
+  }
   auto launch_ctx = reader_->make_launch_context();
   set_kernel_args(I, snode_->num_active_indices, &launch_ctx);
   (*reader_)(launch_ctx);
-  prog_->synchronize();
+  prog_->synchronize_host_read();
   auto ret = reader_->get_ret_float(0);
   return ret;
 }
@@ -58,6 +143,11 @@ float64 SNodeRwAccessorsBank::Accessors::read_float(const std::vector<int> &I) {
 // for int32 and int64
 void SNodeRwAccessorsBank::Accessors::write_int(const std::vector<int> &I,
                                                 int64 val) {
+  if (auto *addr = host_address(I)) {
+    prog_->synchronize();
+    store_host(snode_->dt, addr, val);
+    return;
+  }
   auto launch_ctx = writer_->make_launch_context();
   set_kernel_args(I, snode_->num_active_indices, &launch_ctx);
   launch_ctx.set_arg_int(snode_->num_active_indices, val);
@@ -66,11 +156,14 @@ void SNodeRwAccessorsBank::Accessors::write_int(const std::vector<int> &I,
 }
 
 int64 SNodeRwAccessorsBank::Accessors::read_int(const std::vector<int> &I) {
-  prog_->synchronize();
+  if (auto *addr = host_address(I)) {
+    prog_->synchronize();
+    return load_host(snode_->dt, addr).val_as_int64();
+  }
   auto launch_ctx = reader_->make_launch_context();
   set_kernel_args(I, snode_->num_active_indices, &launch_ctx);
   (*reader_)(launch_ctx);
-  prog_->synchronize();
+  prog_->synchronize_host_read();
   auto ret = reader_->get_ret_int(0);
   return ret;
 }
@@ -18,9 +18,22 @@ class Program;
  */
 class SNodeRwAccessorsBank {
  private:
+  // Where the elements are in host memory, so that they can be accessed
+  // without launching the kernels. Only available on the CPU backends, for
+  // dense fields of primitive types.
+  struct HostLayout {
+    bool available{false};
+    uint8 *data{nullptr};
+    std::vector<int> shape;
+    // In bytes.
+    std::vector<int64> strides;
+  };
+
   struct RwKernels {
     Kernel *reader{nullptr};
     Kernel *writer{nullptr};
+    bool host_layout_computed{false};
+    HostLayout host_layout;
   };
 
  public:
@@ -40,10 +53,15 @@ class SNodeRwAccessorsBank {
     uint64 read_uint(const std::vector<int> &I);
 
    private:
+    // Returns the host address of the element at |I|, or nullptr if it has to
+    // be accessed through the kernels.
+    void *host_address(const std::vector<int> &I) const;
+
     const SNode *snode_;
     Program *prog_;
     Kernel *reader_;
     Kernel *writer_;
+    const HostLayout *host_layout_;
   };
 
   explicit SNodeRwAccessorsBank(Program *program) : program_(program) {
@@ -52,6 +70,8 @@ class SNodeRwAccessorsBank {
   Accessors get(SNode *snode);
 
  private:
+  HostLayout compute_host_layout(SNode *snode);
+
   Program *const program_;
   std::unordered_map<const SNode *, RwKernels> snode_to_kernels_;
 };
@@ -0,0 +1,368 @@
+#include "taichi/program/snode_tree_checkpoint.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+
+#include "taichi/math/arithmetic.h"
+#include "taichi/program/program_impl.h"
+#include "taichi/struct/snode_tree.h"
+#include "taichi/system/threading.h"
+
+#if defined(TI_PLATFORM_UNIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <cstdio>
+#endif
+
+namespace taichi {
+namespace lang {
+namespace {
+
+constexpr char kMagic[8] = {'T', 'I', 'C', 'K', 'P', 'T', '\0', '\0'};
+constexpr uint32 kVersion = 1;
+constexpr uint32 kFlagCompressed = 1;
+constexpr std::size_t kAlignment = 4096;
+
+struct FileHeader {
+  char magic[8];
+  uint32 version{kVersion};
+  uint32 num_trees{0};
+  uint64 trees_offset{0};
+};
+
+struct TreeHeader {
+  int32 tree_id{0};
+  uint32 flags{0};
+  uint64 layout_hash{0};
+  uint64 buffer_size{0};
+  uint64 chunk_size{0};
+  uint64 num_chunks{0};
+  uint64 chunks_offset{0};
+};
+
+struct ChunkEntry {
+  uint64 offset{0};
+  uint64 stored_size{0};
+};
+
+class CheckpointFile {
+ public:
+  CheckpointFile(const std::string &filename, bool write)
+      : filename_(filename) {
+#if defined(TI_PLATFORM_UNIX)
+    fd_ = write ? open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)
+                : open(filename.c_str(), O_RDONLY);
+    TI_ERROR_IF(fd_ < 0, "Failed to open {}: {}", filename,
+                std::strerror(errno));
+#else
+    file_ = std::fopen(filename.c_str(), write ? "wb" : "rb");
+    TI_ERROR_IF(file_ == nullptr, "Failed to open {}", filename);
+#endif
+  }
+
+  ~CheckpointFile() {
+#if defined(TI_PLATFORM_UNIX)
+    if (mapped_ != nullptr) {
+      munmap(mapped_, mapped_size_);
+    }
+    close(fd_);
+#else
+    std::fclose(file_);
+#endif
+  }
+
+  void write_at(uint64 offset, const void *data, std::size_t size) {
+#if defined(TI_PLATFORM_UNIX)
+    auto *p = (const char *)data;
+    while (size > 0) {
+      const auto n = pwrite(fd_, p, size, offset);
+      TI_ERROR_IF(n < 0, "Failed to write {}: {}", filename_,
+                  std::strerror(errno));
+      p += n;
+      offset += n;
+      size -= n;
+    }
+#else
+    std::lock_guard<std::mutex> _(mut_);
+    TI_ERROR_IF(_fseeki64(file_, offset, SEEK_SET) != 0 ||
+                    std::fwrite(data, 1, size, file_) != size,
+                "Failed to write {}", filename_);
+#endif
+  }
+
+  void read_at(uint64 offset, void *data, std::size_t size) {
+    TI_ERROR_IF(offset + size > get_size(), "{} is truncated", filename_);
+#if defined(TI_PLATFORM_UNIX)
+    auto *p = (char *)data;
+    while (size > 0) {
+      const auto n = pread(fd_, p, size, offset);
+      TI_ERROR_IF(n <= 0, "Failed to read {}: {}", filename_,
+                  std::strerror(errno));
+      p += n;
+      offset += n;
+      size -= n;
+    }
+#else
+    std::lock_guard<std::mutex> _(mut_);
+    TI_ERROR_IF(_fseeki64(file_, offset, SEEK_SET) != 0 ||
+                    std::fread(data, 1, size, file_) != size,
+                "Failed to read {}", filename_);
+#endif
+  }
+
+  uint64 get_size() {
+#if defined(TI_PLATFORM_UNIX)
+    struct stat st;
+    TI_ERROR_IF(fstat(fd_, &st) != 0, "Failed to stat {}", filename_);
+    return st.st_size;
+#else
+    std::lock_guard<std::mutex> _(mut_);
+    _fseeki64(file_, 0, SEEK_END);
+    return _ftelli64(file_);
+#endif
+  }
+
+  // The whole file mapped into memory, or nullptr if it can not be mapped.
+  const uint8 *map() {
+#if defined(TI_PLATFORM_UNIX)
+    if (mapped_ == nullptr && get_size() > 0) {
+      mapped_size_ = get_size();
+      void *p = mmap(nullptr, mapped_size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+      mapped_ = p == MAP_FAILED ? nullptr : p;
+    }
+    return (const uint8 *)mapped_;
+#else
+    return nullptr;
+#endif
+  }
+
+ private:
+  std::string filename_;
+#if defined(TI_PLATFORM_UNIX)
+  int fd_{-1};
+  void *mapped_{nullptr};
+  std::size_t mapped_size_{0};
+#else
+  std::FILE *file_{nullptr};
+  std::mutex mut_;
+#endif
+};
+
+int get_num_threads(int num_threads) {
+  if (num_threads > 0) {
+    return num_threads;
+  }
+  return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+void describe_layout(const SNode *snode, std::string *out) {
+  TI_ERROR_IF(snode->type == SNodeType::pointer ||
+                  snode->type == SNodeType::dynamic ||
+                  snode->type == SNodeType::hash,
+              "Checkpoints do not support {} SNodes, such as {}",
+              snode_type_name(snode->type), snode->get_node_type_name_hinted());
+  *out += fmt::format("{}:{}:{}", snode_type_name(snode->type),
+                      snode->num_cells_per_container, snode->cell_size_bytes);
+  if (snode->type == SNodeType::place) {
+    *out += ":" + snode->dt->to_string();
+  }
+  *out += "(";
+  for (const auto &ch : snode->ch) {
+    describe_layout(ch.get(), out);
+  }
+  *out += ")";
+}
+
+// FNV-1a of the layout, which is stable across platforms and runs, unlike
+// std::hash.
+uint64 get_layout_hash(const SNode *root) {
+  std::string layout;
+  describe_layout(root, &layout);
+  uint64 hash = 14695981039346656037ULL;
+  for (char c : layout) {
+    hash = (hash ^ (uint8)c) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+}  // namespace
+
+void save_snode_trees(ProgramImpl *program,
+                      const std::vector<const SNodeTree *> &trees,
+                      const std::string &filename,
+                      const CheckpointOptions &options) {
+  TI_ERROR_IF(options.chunk_size == 0 || options.chunk_size % kAlignment != 0,
+              "The chunk size must be a multiple of {}", kAlignment);
+  const int num_threads = get_num_threads(options.num_threads);
+  CheckpointFile file(filename, /*write=*/true);
+  // Per thread: the staging buffer of the chunks on devices, and the
+  // compressed chunk.
+  std::vector<std::vector<uint8>> staging(num_threads);
+  std::vector<std::vector<uint8>> compressed(num_threads);
+  std::vector<TreeHeader> headers;
+  std::vector<std::vector<ChunkEntry>> tables;
+  uint64 end = sizeof(FileHeader);
+  for (const auto *tree : trees) {
+    TreeHeader header;
+    header.tree_id = tree->id();
+    header.flags = options.compress ? kFlagCompressed : 0;
+    header.layout_hash = get_layout_hash(tree->root());
+    header.buffer_size = program->get_snode_tree_buffer_size(tree->id());
+    header.chunk_size = options.chunk_size;
+    header.num_chunks =
+        (header.buffer_size + header.chunk_size - 1) / header.chunk_size;
+    const auto *host =
+        (const uint8 *)program->get_snode_tree_host_ptr(tree->id());
+    std::vector<ChunkEntry> table(header.num_chunks);
+    const uint64 base = iroundup(end, (uint64)kAlignment);
+    std::atomic<uint64> next_offset{end};
+    auto save_chunk = [&](int thread_id, int i) {
+      const uint64 begin = (uint64)i * header.chunk_size;
+      const std::size_t size =
+          std::min(header.chunk_size, header.buffer_size - begin);
+      const uint8 *data = host != nullptr ? host + begin : nullptr;
+      if (data == nullptr) {
+        auto &buffer = staging[thread_id];
+        buffer.resize(header.chunk_size);
+        program->read_snode_tree_buffer(tree->id(), begin, buffer.data(),
+                                        size);
+        data = buffer.data();
+      }
+      auto &entry = table[i];
+      if (options.compress) {
+        auto &buffer = compressed[thread_id];
+        buffer.resize(zip::compress_bound(header.chunk_size));
+        entry.stored_size =
+            zip::compress(data, size, buffer.data(), buffer.size(),
+                          options.compression_level);
+        entry.offset = next_offset.fetch_add(entry.stored_size);
+        data = buffer.data();
+      } else {
+        entry.stored_size = size;
+        entry.offset = base + begin;
+      }
+      file.write_at(entry.offset, data, entry.stored_size);
+    };
+    parallel_for_threads(num_threads, (int)header.num_chunks, save_chunk);
+    end = options.compress ? next_offset.load() : base + header.buffer_size;
+    headers.push_back(header);
+    tables.push_back(std::move(table));
+  }
+  for (std::size_t i = 0; i < headers.size(); i++) {
+    headers[i].chunks_offset = end;
+    const auto size = tables[i].size() * sizeof(ChunkEntry);
+    file.write_at(end, tables[i].data(), size);
+    end += size;
+  }
+  FileHeader file_header;
+  std::memcpy(file_header.magic, kMagic, sizeof(kMagic));
+  file_header.num_trees = headers.size();
+  file_header.trees_offset = end;
+  file.write_at(end, headers.data(), headers.size() * sizeof(TreeHeader));
+  // Written last, so that an interrupted save does not leave a valid file.
+  file.write_at(0, &file_header, sizeof(file_header));
+}
+
+void load_snode_trees(ProgramImpl *program,
+                      const std::vector<const SNodeTree *> &trees,
+                      const std::string &filename,
+                      int num_threads) {
+  num_threads = get_num_threads(num_threads);
+  CheckpointFile file(filename, /*write=*/false);
+  FileHeader file_header;
+  file.read_at(0, &file_header, sizeof(file_header));
+  TI_ERROR_IF(std::memcmp(file_header.magic, kMagic, sizeof(kMagic)) != 0,
+              "{} is not a checkpoint", filename);
+  TI_ERROR_IF(file_header.version != kVersion,
+              "{} is a checkpoint of version {}, expected {}", filename,
+              file_header.version, kVersion);
+  TI_ERROR_IF(file_header.num_trees != trees.size(),
+              "{} holds {} SNode trees, while the program has {}", filename,
+              file_header.num_trees, trees.size());
+  std::vector<TreeHeader> headers(file_header.num_trees);
+  file.read_at(file_header.trees_offset, headers.data(),
+               headers.size() * sizeof(TreeHeader));
+  const uint64 file_size = file.get_size();
+  const uint8 *mapped = file.map();
+  std::vector<std::vector<uint8>> staging(num_threads);
+  std::vector<std::vector<uint8>> compressed(num_threads);
+  for (std::size_t t = 0; t < trees.size(); t++) {
+    const auto &header = headers[t];
+    const auto *tree = trees[t];
+    TI_ERROR_IF(
+        header.tree_id != tree->id() ||
+            header.layout_hash != get_layout_hash(tree->root()) ||
+            header.buffer_size !=
+                program->get_snode_tree_buffer_size(tree->id()),
+        "The layout of SNode tree {} differs from the one saved in {}",
+        tree->id(), filename);
+    std::vector<ChunkEntry> table(header.num_chunks);
+    file.read_at(header.chunks_offset, table.data(),
+                 table.size() * sizeof(ChunkEntry));
+    for (const auto &entry : table) {
+      TI_ERROR_IF(entry.offset + entry.stored_size > file_size,
+                  "{} is truncated", filename);
+    }
+    auto *host = (uint8 *)program->get_snode_tree_host_ptr(tree->id());
+    const bool is_compressed = header.flags & kFlagCompressed;
+    if (!is_compressed && host == nullptr && mapped != nullptr &&
+        !table.empty()) {
+      // The chunks are contiguous: a single copy from the mapped file, which
+      // the device reads directly if its pages can be pinned.
+      program->write_snode_tree_buffer(tree->id(), 0, mapped + table[0].offset,
+                                       header.buffer_size);
+      continue;
+    }
+    auto load_chunk = [&](int thread_id, int i) {
+      const auto &entry = table[i];
+      const uint64 begin = (uint64)i * header.chunk_size;
+      const std::size_t size =
+          std::min(header.chunk_size, header.buffer_size - begin);
+      if (!is_compressed) {
+        TI_ERROR_IF(entry.stored_size != size, "{} is corrupted", filename);
+      }
+      const uint8 *stored = mapped != nullptr ? mapped + entry.offset : nullptr;
+      if (!is_compressed && host != nullptr) {
+        if (stored != nullptr) {
+          std::memcpy(host + begin, stored, size);
+        } else {
+          file.read_at(entry.offset, host + begin, size);
+        }
+        return;
+      }
+      if (stored == nullptr) {
+        auto &buffer =
+            is_compressed ? compressed[thread_id] : staging[thread_id];
+        buffer.resize(entry.stored_size);
+        file.read_at(entry.offset, buffer.data(), entry.stored_size);
+        stored = buffer.data();
+      }
+      const uint8 *data = stored;
+      if (is_compressed) {
+        uint8 *dst = host;
+        if (dst != nullptr) {
+          dst += begin;
+        } else {
+          staging[thread_id].resize(header.chunk_size);
+          dst = staging[thread_id].data();
+        }
+        zip::decompress(stored, entry.stored_size, dst, size);
+        if (host != nullptr) {
+          return;
+        }
+        data = dst;
+      }
+      program->write_snode_tree_buffer(tree->id(), begin, data, size);
+    };
+    parallel_for_threads(num_threads, (int)header.num_chunks, load_chunk);
+  }
+}
+
+}  // namespace lang
+}  // namespace taichi
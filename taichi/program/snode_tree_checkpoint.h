@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "taichi/common/core.h"
+
+namespace taichi {
+namespace lang {
+
+class ProgramImpl;
+class SNodeTree;
+
+struct CheckpointOptions {
+  // Deflates each chunk, at |compression_level| from 1 (fastest) to 9.
+  bool compress{false};
+  int compression_level{1};
+  // The threads copying, compressing and writing the chunks. 0 for one per
+  // CPU.
+  int num_threads{0};
+  // A multiple of 4 KB.
+  std::size_t chunk_size{64 << 20};
+};
+
+// A checkpoint holds the root buffers of SNode trees, copied as they are in
+// (device) memory, in chunks that are written and read by multiple threads:
+//
+//   [file header] [chunks of tree 0] [chunks of tree 1] ...
+//   [chunk table of tree 0] [chunk table of tree 1] ... [tree headers]
+//
+// The uncompressed chunks of a tree are contiguous and page-aligned, so that
+// a tree on a device is restored from the memory-mapped file by a single
+// copy, without staging it in host memory.
+//
+// Only trees whose data lives in their root buffers are supported, i.e.
+// dense, bitmasked and quantized SNodes, including the activity of the
+// bitmasked ones. The cells of pointer, dynamic and hash SNodes are
+// allocated by the NodeManagers of the runtime, whose addresses would not be
+// valid in another program.
+
+// Saves the root buffers of |trees| into |filename|. The caller must
+// synchronize the program first.
+void save_snode_trees(ProgramImpl *program,
+                      const std::vector<const SNodeTree *> &trees,
+                      const std::string &filename,
+                      const CheckpointOptions &options);
+
+// Restores the root buffers of |trees| from |filename|, which must have been
+// saved from trees of the same ids and layouts.
+void load_snode_trees(ProgramImpl *program,
+                      const std::vector<const SNodeTree *> &trees,
+                      const std::string &filename,
+                      int num_threads);
+
+}  // namespace lang
+}  // namespace taichi
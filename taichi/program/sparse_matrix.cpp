@@ -1,46 +1,225 @@
 #include "taichi/program/sparse_matrix.h"
 
+#include <algorithm>
 #include <sstream>
 
 #include "Eigen/Dense"
 #include "Eigen/SparseLU"
 
+#include "taichi/ir/type_utils.h"
+#include "taichi/program/parallel_primitives.h"
+#include "taichi/system/threading.h"
+
+#if defined(TI_WITH_CUDA)
+#include "taichi/backends/cuda/cuda_context.h"
+#include "taichi/backends/cuda/cuda_driver.h"
+#endif
+
 namespace taichi {
 namespace lang {
 
+namespace {
+
+// The rows (or columns) handled by one task of the parallel operations.
+constexpr int kRowsPerTask = 1024;
+
+}  // namespace
+
+#if defined(TI_WITH_CUDA)
+namespace {
+
+void *cusparse_handle() {
+  static void *handle = [] {
+    auto &cusparse = CUSPARSEDriver::get_instance();
+    TI_ERROR_IF(!cusparse.detected(),
+                "cuSPARSE is required by sparse matrices on CUDA.");
+    void *h = nullptr;
+    cusparse.create(&h);
+    return h;
+  }();
+  return handle;
+}
+
+}  // namespace
+#endif
+
 SparseMatrixBuilder::SparseMatrixBuilder(int rows,
                                          int cols,
-                                         int max_num_triplets)
-    : rows_(rows), cols_(cols), max_num_triplets_(max_num_triplets) {
-  data_.reserve(max_num_triplets * 3);
-  data_base_ptr_ = get_data_base_ptr();
+                                         int max_num_triplets,
+                                         DataType dtype,
+                                         Arch arch,
+                                         ThreadPool *thread_pool)
+    : max_num_triplets_(max_num_triplets),
+      rows_(rows),
+      cols_(cols),
+      dtype_(dtype),
+      arch_(arch),
+      thread_pool_(thread_pool) {
+  TI_ERROR_IF(!dtype->is_primitive(PrimitiveTypeID::f32) &&
+                  !dtype->is_primitive(PrimitiveTypeID::f64),
+              "SparseMatrix only supports f32 and f64, got {}.",
+              data_type_name(dtype));
+  value_size_ = data_type_size(dtype);
+  // Rows and columns take one uint32 each, values one or two.
+  auto num_words = max_num_triplets_ * (2 + value_size_ / sizeof(uint32));
+  if (arch_ == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    TI_ERROR_IF(value_size_ != sizeof(float32),
+                "SparseMatrix on CUDA only supports f32 for now.");
+    auto guard = CUDAContext::get_instance().get_guard();
+    auto &driver = CUDADriver::get_instance();
+    driver.malloc(&data_base_ptr_,
+                  std::max(num_words, uint64(1)) * sizeof(uint32));
+    driver.malloc(&device_header_, 4 * sizeof(uint64));
+    clear();
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  } else {
+    data_.resize(num_words);
+    data_base_ptr_ = get_data_base_ptr();
+  }
+}
+
+SparseMatrixBuilder::~SparseMatrixBuilder() {
+#if defined(TI_WITH_CUDA)
+  if (arch_ == Arch::cuda) {
+    auto guard = CUDAContext::get_instance().get_guard();
+    CUDADriver::get_instance().mem_free(data_base_ptr_);
+    CUDADriver::get_instance().mem_free(device_header_);
+  }
+#endif
 }
 
 void *SparseMatrixBuilder::get_data_base_ptr() {
   return data_.data();
 }
 
+uint64 SparseMatrixBuilder::get_addr() {
+  return arch_ == Arch::cuda ? (uint64)device_header_ : (uint64)this;
+}
+
+template <typename T>
+T SparseMatrixBuilder::get_value(int64 i) const {
+  auto values = (const T *)(data_.data() + 2 * max_num_triplets_);
+  return values[i];
+}
+
 void SparseMatrixBuilder::print_triplets() {
+  if (arch_ == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    auto guard = CUDAContext::get_instance().get_guard();
+    auto &driver = CUDADriver::get_instance();
+    driver.memcpy_device_to_host(&num_triplets_, device_header_,
+                                 sizeof(uint64));
+    // On CUDA, data_ is only used to stage the triplets for printing.
+    data_.resize(max_num_triplets_ * 3);
+    driver.memcpy_device_to_host(data_.data(), data_base_ptr_,
+                                 data_.size() * sizeof(uint32));
+#endif
+  }
   fmt::print("n={}, m={}, num_triplets={} (max={})", rows_, cols_,
              num_triplets_, max_num_triplets_);
   for (int64 i = 0; i < num_triplets_; i++) {
-    fmt::print("({}, {}) val={}", data_[i * 3], data_[i * 3 + 1],
-               taichi_union_cast<float32>(data_[i * 3 + 2]));
+    fmt::print("({}, {}) val={}", data_[i], data_[max_num_triplets_ + i],
+               value_size_ == sizeof(float64) ? get_value<float64>(i)
+                                              : get_value<float32>(i));
   }
   fmt::print("\n");
 }
 
-SparseMatrix SparseMatrixBuilder::build() {
+template <typename T>
+std::vector<Eigen::Triplet<T>> SparseMatrixBuilder::get_triplets() const {
+  std::vector<Eigen::Triplet<T>> triplets;
+  triplets.reserve(num_triplets_);
+  for (int i = 0; i < num_triplets_; i++) {
+    triplets.emplace_back(data_[i], data_[max_num_triplets_ + i],
+                          get_value<T>(i));
+  }
+  return triplets;
+}
+
+template <typename T>
+SparseMatrix<T> SparseMatrixBuilder::build() {
+  TI_ERROR_IF(arch_ == Arch::cuda,
+              "Sparse matrices on CUDA are built with build_cuda().");
+  TI_ASSERT(value_size_ == sizeof(T));
   TI_ASSERT(built_ == false);
   built_ = true;
-  using T = Eigen::Triplet<float32>;
-  std::vector<T> triplets;
-  for (int i = 0; i < num_triplets_; i++) {
-    triplets.push_back(T(data_[i * 3], data_[i * 3 + 1],
-                         taichi_union_cast<float32>(data_[i * 3 + 2])));
+  // The triplets are sorted by column and row with a parallel radix sort, and
+  // the duplicates summed into the compressed columns.
+  const int n = (int)num_triplets_;
+  std::vector<int64> keys(n);
+  std::vector<uint32> ids(n);
+  parallel_for_blocks(thread_pool_, n, kRowsPerTask, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      keys[i] = (int64)data_[max_num_triplets_ + i] * rows_ + data_[i];
+      ids[i] = i;
+    }
+  });
+  radix_sort(thread_pool_, keys.data(), ids.data(), n);
+  std::vector<int> outer(cols_ + 1, 0);
+  std::vector<int> inner;
+  std::vector<T> values;
+  inner.reserve(n);
+  values.reserve(n);
+  for (int k = 0; k < n; k++) {
+    const T value = get_value<T>(ids[k]);
+    if (k > 0 && keys[k] == keys[k - 1]) {
+      values.back() += value;
+    } else {
+      inner.push_back((int)(keys[k] % rows_));
+      values.push_back(value);
+      outer[keys[k] / rows_ + 1]++;
+    }
   }
-  SparseMatrix sm(rows_, cols_);
-  sm.get_matrix().setFromTriplets(triplets.begin(), triplets.end());
+  for (int j = 0; j < cols_; j++) {
+    outer[j + 1] += outer[j];
+  }
+  typename SparseMatrix<T>::EigenMatrix matrix(
+      Eigen::Map<const typename SparseMatrix<T>::EigenMatrix>(
+          rows_, cols_, (int)inner.size(), outer.data(), inner.data(),
+          values.data()));
+  clear();
+  return SparseMatrix<T>(matrix, thread_pool_);
+}
+
+template <typename T>
+void SparseMatrixBuilder::rebuild(SparseMatrix<T> &sm) {
+  TI_ERROR_IF(arch_ == Arch::cuda,
+              "Sparse matrices on CUDA are built with build_cuda().");
+  TI_ASSERT(value_size_ == sizeof(T));
+  TI_ERROR_IF(sm.num_rows() != rows_ || sm.num_cols() != cols_,
+              "Cannot rebuild a {}x{} sparse matrix from a {}x{} builder.",
+              sm.num_rows(), sm.num_cols(), rows_, cols_);
+  auto triplets = get_triplets<T>();
+  if (!sm.update_values(triplets)) {
+    sm.set_from_triplets(triplets);
+  }
+  clear();
+}
+
+template SparseMatrix<float32> SparseMatrixBuilder::build<float32>();
+template SparseMatrix<float64> SparseMatrixBuilder::build<float64>();
+template void SparseMatrixBuilder::rebuild<float32>(SparseMatrix<float32> &);
+template void SparseMatrixBuilder::rebuild<float64>(SparseMatrix<float64> &);
+
+std::unique_ptr<CuSparseMatrix> SparseMatrixBuilder::build_cuda() {
+  TI_ASSERT(arch_ == Arch::cuda);
+  TI_ASSERT(built_ == false);
+  built_ = true;
+  auto sm = std::make_unique<CuSparseMatrix>(rows_, cols_);
+#if defined(TI_WITH_CUDA)
+  {
+    auto guard = CUDAContext::get_instance().get_guard();
+    CUDADriver::get_instance().memcpy_device_to_host(
+        &num_triplets_, device_header_, sizeof(uint64));
+  }
+  auto data = (int32 *)data_base_ptr_;
+  sm->build_csr_from_coo(data, data + max_num_triplets_,
+                         (float32 *)(data + 2 * max_num_triplets_),
+                         num_triplets_);
+#endif
   clear();
   return sm;
 }
@@ -48,84 +227,403 @@ SparseMatrix SparseMatrixBuilder::build() {
 void SparseMatrixBuilder::clear() {
   built_ = false;
   num_triplets_ = 0;
+#if defined(TI_WITH_CUDA)
+  if (arch_ == Arch::cuda) {
+    // Reset the device copy of num_triplets_, data_base_ptr_,
+    // max_num_triplets_ and value_size_, which are laid out contiguously.
+    auto guard = CUDAContext::get_instance().get_guard();
+    CUDADriver::get_instance().memcpy_host_to_device(
+        device_header_, &num_triplets_, 4 * sizeof(uint64));
+  }
+#endif
 }
 
-SparseMatrix::SparseMatrix(Eigen::SparseMatrix<float32> &matrix) {
+template <typename T>
+SparseMatrix<T>::SparseMatrix(EigenMatrix &matrix, ThreadPool *thread_pool)
+    : thread_pool_(thread_pool) {
   this->matrix_ = matrix;
 }
 
-SparseMatrix::SparseMatrix(int rows, int cols) : matrix_(rows, cols) {
+template <typename T>
+SparseMatrix<T>::SparseMatrix(int rows, int cols, ThreadPool *thread_pool)
+    : matrix_(rows, cols), thread_pool_(thread_pool) {
 }
 
-const std::string SparseMatrix::to_string() const {
+template <typename T>
+const std::string SparseMatrix<T>::to_string() const {
   Eigen::IOFormat clean_fmt(4, 0, ", ", "\n", "[", "]");
   // Note that the code below first converts the sparse matrix into a dense one.
   // https://stackoverflow.com/questions/38553335/how-can-i-print-in-console-a-formatted-sparse-matrix-with-eigen
   std::ostringstream ostr;
-  ostr << Eigen::MatrixXf(matrix_).format(clean_fmt);
+  ostr << Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>(matrix_).format(
+      clean_fmt);
   return ostr.str();
 }
 
-const int SparseMatrix::num_rows() const {
+template <typename T>
+const int SparseMatrix<T>::num_rows() const {
   return matrix_.rows();
 }
-const int SparseMatrix::num_cols() const {
+
+template <typename T>
+const int SparseMatrix<T>::num_cols() const {
   return matrix_.cols();
 }
 
-Eigen::SparseMatrix<float32> &SparseMatrix::get_matrix() {
+template <typename T>
+typename SparseMatrix<T>::EigenMatrix &SparseMatrix<T>::get_matrix() {
+  // The caller may change the pattern.
+  invalidate_pattern();
   return matrix_;
 }
 
-const Eigen::SparseMatrix<float32> &SparseMatrix::get_matrix() const {
+template <typename T>
+const typename SparseMatrix<T>::EigenMatrix &SparseMatrix<T>::get_matrix()
+    const {
   return matrix_;
 }
 
-SparseMatrix operator+(const SparseMatrix &sm1, const SparseMatrix &sm2) {
-  Eigen::SparseMatrix<float32> res(sm1.matrix_ + sm2.matrix_);
-  return SparseMatrix(res);
+template <typename T>
+uint64 SparseMatrix<T>::pattern_hash() const {
+  if (!pattern_hash_.has_value()) {
+    // FNV-1a over the dimensions and the (column, row) of the nonzeros.
+    uint64 hash = 14695981039346656037ULL;
+    auto combine = [&](uint64 v) {
+      hash ^= v;
+      hash *= 1099511628211ULL;
+    };
+    combine(matrix_.rows());
+    combine(matrix_.cols());
+    for (int j = 0; j < matrix_.outerSize(); j++) {
+      for (typename EigenMatrix::InnerIterator it(matrix_, j); it; ++it) {
+        combine(((uint64)j << 32) | (uint32)it.row());
+      }
+    }
+    pattern_hash_ = hash;
+  }
+  return pattern_hash_.value();
 }
 
-SparseMatrix operator-(const SparseMatrix &sm1, const SparseMatrix &sm2) {
-  Eigen::SparseMatrix<float32> res(sm1.matrix_ - sm2.matrix_);
-  return SparseMatrix(res);
+template <typename T>
+void SparseMatrix<T>::invalidate_pattern() {
+  pattern_hash_.reset();
+  row_index_.reset();
 }
 
-SparseMatrix operator*(float scale, const SparseMatrix &sm) {
-  Eigen::SparseMatrix<float32> res(scale * sm.matrix_);
-  return SparseMatrix(res);
+template <typename T>
+void SparseMatrix<T>::set_from_triplets(
+    const std::vector<Eigen::Triplet<T>> &triplets) {
+  invalidate_pattern();
+  matrix_.setFromTriplets(triplets.begin(), triplets.end());
 }
 
-SparseMatrix operator*(const SparseMatrix &sm, float scale) {
-  return scale * sm;
+template <typename T>
+bool SparseMatrix<T>::update_values(
+    const std::vector<Eigen::Triplet<T>> &triplets) {
+  // Compressing keeps the pattern.
+  matrix_.makeCompressed();
+  const auto outer = matrix_.outerIndexPtr();
+  const auto inner = matrix_.innerIndexPtr();
+  auto values = matrix_.valuePtr();
+  std::fill(values, values + matrix_.nonZeros(), T(0));
+  for (const auto &t : triplets) {
+    // The row indices of a column are sorted.
+    auto begin = inner + outer[t.col()], end = inner + outer[t.col() + 1];
+    auto it = std::lower_bound(begin, end, t.row());
+    if (it == end || *it != t.row()) {
+      return false;
+    }
+    values[it - inner] += t.value();
+  }
+  return true;
 }
 
-SparseMatrix operator*(const SparseMatrix &sm1, const SparseMatrix &sm2) {
-  Eigen::SparseMatrix<float32> res(sm1.matrix_.cwiseProduct(sm2.matrix_));
-  return SparseMatrix(res);
+template <typename T>
+const typename SparseMatrix<T>::RowIndex &SparseMatrix<T>::get_row_index() {
+  if (row_index_ == nullptr) {
+    // A counting sort of the entries by row.
+    matrix_.makeCompressed();
+    const int rows = matrix_.rows(), nnz = matrix_.nonZeros();
+    const auto outer = matrix_.outerIndexPtr();
+    const auto inner = matrix_.innerIndexPtr();
+    auto index = std::make_shared<RowIndex>();
+    index->row_ptr.assign(rows + 1, 0);
+    index->col_ind.resize(nnz);
+    index->value_ids.resize(nnz);
+    for (int k = 0; k < nnz; k++) {
+      index->row_ptr[inner[k] + 1]++;
+    }
+    for (int i = 0; i < rows; i++) {
+      index->row_ptr[i + 1] += index->row_ptr[i];
+    }
+    std::vector<int> next(index->row_ptr.begin(), index->row_ptr.end() - 1);
+    for (int j = 0; j < matrix_.cols(); j++) {
+      for (int k = outer[j]; k < outer[j + 1]; k++) {
+        int pos = next[inner[k]]++;
+        index->col_ind[pos] = j;
+        index->value_ids[pos] = k;
+      }
+    }
+    row_index_ = std::move(index);
+  }
+  return *row_index_;
 }
 
-SparseMatrix SparseMatrix::matmul(const SparseMatrix &sm) {
-  Eigen::SparseMatrix<float32> res(matrix_ * sm.matrix_);
-  return SparseMatrix(res);
+template <typename T>
+SparseMatrix<T> SparseMatrix<T>::matmul(const SparseMatrix &sm) {
+  TI_ASSERT(num_cols() == sm.num_rows());
+  if (thread_pool_ == nullptr) {
+    EigenMatrix res(matrix_ * sm.matrix_);
+    return SparseMatrix(res, thread_pool_);
+  }
+  // The columns of the product are independent. Each one is accumulated as
+  // (row, value) pairs, which are sorted and merged, so that the memory used
+  // is proportional to the work rather than to the number of rows.
+  const int cols = sm.num_cols();
+  std::vector<std::vector<std::pair<int, T>>> res_cols(cols);
+  parallel_for_blocks(
+      thread_pool_, cols, kRowsPerTask, [&](int begin, int end) {
+        for (int j = begin; j < end; j++) {
+          auto &col = res_cols[j];
+          for (typename EigenMatrix::InnerIterator b(sm.matrix_, j); b; ++b) {
+            for (typename EigenMatrix::InnerIterator a(matrix_, b.row()); a;
+                 ++a) {
+              col.emplace_back(a.row(), a.value() * b.value());
+            }
+          }
+          std::sort(col.begin(), col.end(), [](const auto &x, const auto &y) {
+            return x.first < y.first;
+          });
+          int n = 0;
+          for (int k = 0; k < (int)col.size(); k++) {
+            if (n > 0 && col[n - 1].first == col[k].first) {
+              col[n - 1].second += col[k].second;
+            } else {
+              col[n++] = col[k];
+            }
+          }
+          col.resize(n);
+        }
+      });
+  std::vector<int> outer(cols + 1, 0);
+  for (int j = 0; j < cols; j++) {
+    outer[j + 1] = outer[j] + (int)res_cols[j].size();
+  }
+  std::vector<int> inner(outer[cols]);
+  std::vector<T> values(outer[cols]);
+  parallel_for_blocks(
+      thread_pool_, cols, kRowsPerTask, [&](int begin, int end) {
+        for (int j = begin; j < end; j++) {
+          for (int k = 0; k < (int)res_cols[j].size(); k++) {
+            inner[outer[j] + k] = res_cols[j][k].first;
+            values[outer[j] + k] = res_cols[j][k].second;
+          }
+        }
+      });
+  EigenMatrix res(Eigen::Map<const EigenMatrix>(
+      num_rows(), cols, outer[cols], outer.data(), inner.data(),
+      values.data()));
+  return SparseMatrix(res, thread_pool_);
 }
 
-Eigen::VectorXf SparseMatrix::mat_vec_mul(
-    const Eigen::Ref<const Eigen::VectorXf> &b) {
-  return matrix_ * b;
+template <typename T>
+typename SparseMatrix<T>::EigenVector SparseMatrix<T>::mat_vec_mul(
+    const Eigen::Ref<const EigenVector> &b) {
+  TI_ASSERT(b.size() == num_cols());
+  if (thread_pool_ == nullptr) {
+    return matrix_ * b;
+  }
+  // Row-parallel over a CSR view of the matrix, which is kept as long as the
+  // pattern does not change.
+  const auto &index = get_row_index();
+  const auto values = matrix_.valuePtr();
+  EigenVector res(num_rows());
+  parallel_for_blocks(
+      thread_pool_, num_rows(), kRowsPerTask, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+          T sum = 0;
+          for (int k = index.row_ptr[i]; k < index.row_ptr[i + 1]; k++) {
+            sum += values[index.value_ids[k]] * b[index.col_ind[k]];
+          }
+          res[i] = sum;
+        }
+      });
+  return res;
 }
 
-SparseMatrix SparseMatrix::transpose() {
-  Eigen::SparseMatrix<float32> res(matrix_.transpose());
-  return SparseMatrix(res);
+template <typename T>
+SparseMatrix<T> SparseMatrix<T>::transpose() {
+  EigenMatrix res(matrix_.transpose());
+  return SparseMatrix(res, thread_pool_);
 }
 
-float32 SparseMatrix::get_element(int row, int col) {
+template <typename T>
+T SparseMatrix<T>::get_element(int row, int col) {
   return matrix_.coeff(row, col);
 }
 
-void SparseMatrix::set_element(int row, int col, float32 value) {
+template <typename T>
+void SparseMatrix<T>::set_element(int row, int col, T value) {
+  auto nnz = matrix_.nonZeros();
   matrix_.coeffRef(row, col) = value;
+  if (matrix_.nonZeros() != nnz) {
+    invalidate_pattern();
+  }
+}
+
+template class SparseMatrix<float32>;
+template class SparseMatrix<float64>;
+
+CuSparseMatrix::CuSparseMatrix(int rows, int cols) : rows_(rows), cols_(cols) {
+}
+
+CuSparseMatrix::~CuSparseMatrix() {
+#if defined(TI_WITH_CUDA)
+  auto guard = CUDAContext::get_instance().get_guard();
+  auto &driver = CUDADriver::get_instance();
+  if (matrix_)
+    CUSPARSEDriver::get_instance().destroy_sp_mat(matrix_);
+  for (void *ptr : {(void *)csr_row_ptr_, (void *)csr_col_ind_,
+                    (void *)csr_values_, spmv_buffer_}) {
+    if (ptr)
+      driver.mem_free(ptr);
+  }
+#endif
+}
+
+void CuSparseMatrix::build_csr_from_coo(int32 *coo_rows,
+                                        int32 *coo_cols,
+                                        float32 *coo_values,
+                                        int nnz) {
+#if defined(TI_WITH_CUDA)
+  TI_ASSERT(matrix_ == nullptr);
+  auto guard = CUDAContext::get_instance().get_guard();
+  auto &driver = CUDADriver::get_instance();
+  auto &cusparse = CUSPARSEDriver::get_instance();
+  auto handle = cusparse_handle();
+  nnz_ = nnz;
+  driver.malloc((void **)&csr_row_ptr_, (rows_ + 1) * sizeof(int32));
+  driver.malloc((void **)&csr_col_ind_, std::max(nnz, 1) * sizeof(int32));
+  driver.malloc((void **)&csr_values_, std::max(nnz, 1) * sizeof(float32));
+  if (nnz > 0) {
+    // Sort the triplets by row, and apply the same permutation to the values.
+    std::size_t buffer_size = 0;
+    cusparse.coosort_buffer_size(handle, rows_, cols_, nnz, coo_rows, coo_cols,
+                                 &buffer_size);
+    void *buffer = nullptr;
+    int32 *permutation = nullptr;
+    driver.malloc(&buffer, std::max(buffer_size, std::size_t(1)));
+    driver.malloc((void **)&permutation, nnz * sizeof(int32));
+    cusparse.create_identity_permutation(handle, nnz, permutation);
+    cusparse.coosort_by_row(handle, rows_, cols_, nnz, coo_rows, coo_cols,
+                            permutation, buffer);
+    cusparse.gather(handle, nnz, coo_values, csr_values_, permutation,
+                    CUSPARSE_INDEX_BASE_ZERO);
+    driver.memcpy_device_to_device(csr_col_ind_, coo_cols,
+                                   nnz * sizeof(int32));
+    cusparse.coo2csr(handle, coo_rows, nnz, rows_, csr_row_ptr_,
+                     CUSPARSE_INDEX_BASE_ZERO);
+    driver.mem_free(buffer);
+    driver.mem_free(permutation);
+  } else {
+    driver.memset(csr_row_ptr_, 0, (rows_ + 1) * sizeof(int32));
+  }
+  cusparse.create_csr(&matrix_, rows_, cols_, nnz, csr_row_ptr_, csr_col_ind_,
+                      csr_values_, CUSPARSE_INDEX_32I, CUSPARSE_INDEX_32I,
+                      CUSPARSE_INDEX_BASE_ZERO, CUDA_R_32F);
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
+
+const int CuSparseMatrix::num_rows() const {
+  return rows_;
+}
+
+const int CuSparseMatrix::num_cols() const {
+  return cols_;
+}
+
+const std::string CuSparseMatrix::to_string() const {
+#if defined(TI_WITH_CUDA)
+  std::vector<int32> row_ptr(rows_ + 1), col_ind(nnz_);
+  std::vector<float32> values(nnz_);
+  {
+    auto guard = CUDAContext::get_instance().get_guard();
+    auto &driver = CUDADriver::get_instance();
+    driver.memcpy_device_to_host(row_ptr.data(), csr_row_ptr_,
+                                 row_ptr.size() * sizeof(int32));
+    if (nnz_ > 0) {
+      driver.memcpy_device_to_host(col_ind.data(), csr_col_ind_,
+                                   nnz_ * sizeof(int32));
+      driver.memcpy_device_to_host(values.data(), csr_values_,
+                                   nnz_ * sizeof(float32));
+    }
+  }
+  using T = Eigen::Triplet<float32>;
+  std::vector<T> triplets;
+  for (int i = 0; i < rows_; i++) {
+    for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++) {
+      triplets.push_back(T(i, col_ind[k], values[k]));
+    }
+  }
+  SparseMatrix<float32> sm(rows_, cols_);
+  sm.get_matrix().setFromTriplets(triplets.begin(), triplets.end());
+  return sm.to_string();
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
+
+void CuSparseMatrix::spmv(const float32 *x, float32 *y) const {
+#if defined(TI_WITH_CUDA)
+  auto guard = CUDAContext::get_instance().get_guard();
+  auto &driver = CUDADriver::get_instance();
+  auto &cusparse = CUSPARSEDriver::get_instance();
+  auto handle = cusparse_handle();
+  void *vec_x = nullptr, *vec_y = nullptr;
+  cusparse.create_dn_vec(&vec_x, cols_, (void *)x, CUDA_R_32F);
+  cusparse.create_dn_vec(&vec_y, rows_, y, CUDA_R_32F);
+  float32 alpha = 1, beta = 0;
+  std::size_t buffer_size = 0;
+  cusparse.spmv_buffer_size(handle, CUSPARSE_OPERATION_NON_TRANSPOSE, &alpha,
+                            matrix_, vec_x, &beta, vec_y, CUDA_R_32F,
+                            CUSPARSE_SPMV_ALG_DEFAULT, &buffer_size);
+  if (buffer_size > spmv_buffer_size_) {
+    if (spmv_buffer_)
+      driver.mem_free(spmv_buffer_);
+    driver.malloc(&spmv_buffer_, buffer_size);
+    spmv_buffer_size_ = buffer_size;
+  }
+  cusparse.spmv(handle, CUSPARSE_OPERATION_NON_TRANSPOSE, &alpha, matrix_,
+                vec_x, &beta, vec_y, CUDA_R_32F, CUSPARSE_SPMV_ALG_DEFAULT,
+                spmv_buffer_);
+  cusparse.destroy_dn_vec(vec_x);
+  cusparse.destroy_dn_vec(vec_y);
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
+
+Eigen::VectorXf CuSparseMatrix::mat_vec_mul(
+    const Eigen::Ref<const Eigen::VectorXf> &b) {
+#if defined(TI_WITH_CUDA)
+  TI_ASSERT(b.size() == cols_);
+  auto guard = CUDAContext::get_instance().get_guard();
+  auto &driver = CUDADriver::get_instance();
+  float32 *x = nullptr, *y = nullptr;
+  driver.malloc((void **)&x, std::max(cols_, 1) * sizeof(float32));
+  driver.malloc((void **)&y, std::max(rows_, 1) * sizeof(float32));
+  driver.memcpy_host_to_device(x, (void *)b.data(), cols_ * sizeof(float32));
+  spmv(x, y);
+  Eigen::VectorXf res(rows_);
+  driver.memcpy_device_to_host(res.data(), y, rows_ * sizeof(float32));
+  driver.mem_free(x);
+  driver.mem_free(y);
+  return res;
+#else
+  TI_NOT_IMPLEMENTED
+#endif
 }
 
 }  // namespace lang
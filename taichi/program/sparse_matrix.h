@@ -2,64 +2,200 @@
 
 #include "taichi/common/core.h"
 #include "taichi/inc/constants.h"
+#include "taichi/ir/type.h"
+#include "taichi/program/arch.h"
 #include "Eigen/Sparse"
 
+#include <optional>
+
 namespace taichi {
+
+class ThreadPool;
+
 namespace lang {
 
+template <typename T>
 class SparseMatrix;
+class CuSparseMatrix;
 
+// The triplets are stored as three arrays (rows, columns, values) of
+// max_num_triplets entries each. The values are of the builder's dtype (f32 or
+// f64). On CUDA, they live in device memory and the matrix is built on the
+// device.
 class SparseMatrixBuilder {
  public:
-  SparseMatrixBuilder(int rows, int cols, int max_num_triplets);
+  // The matrices built on CPU run their operations on |thread_pool| if it is
+  // not null.
+  SparseMatrixBuilder(int rows,
+                      int cols,
+                      int max_num_triplets,
+                      DataType dtype,
+                      Arch arch,
+                      ThreadPool *thread_pool = nullptr);
+  SparseMatrixBuilder(const SparseMatrixBuilder &) = delete;
+  SparseMatrixBuilder &operator=(const SparseMatrixBuilder &) = delete;
+  ~SparseMatrixBuilder();
 
   void *get_data_base_ptr();
 
+  // The address passed to the kernels, where insert_triplet() finds the
+  // triplet count, the triplet buffer, its capacity and the value size.
+  uint64 get_addr();
+
+  DataType get_dtype() const {
+    return dtype_;
+  }
+
   void print_triplets();
 
-  SparseMatrix build();
+  // T must match the dtype of the builder.
+  template <typename T>
+  SparseMatrix<T> build();
+
+  // Refills |sm| with the triplets. If they fit in the sparsity pattern of
+  // |sm|, the values are updated in place and the pattern is kept, so that
+  // solvers can skip the symbolic analysis. The entries of the pattern
+  // without triplets become explicit zeros.
+  template <typename T>
+  void rebuild(SparseMatrix<T> &sm);
+
+  std::unique_ptr<CuSparseMatrix> build_cuda();
 
   void clear();
 
  private:
+  template <typename T>
+  T get_value(int64 i) const;
+
+  template <typename T>
+  std::vector<Eigen::Triplet<T>> get_triplets() const;
+
+  // The layout of the first four members is read by insert_triplet() in the
+  // LLVM runtime.
   uint64 num_triplets_{0};
   void *data_base_ptr_{nullptr};
+  uint64 max_num_triplets_{0};
+  uint64 value_size_{0};
   std::vector<uint32> data_;
   int rows_{0};
   int cols_{0};
-  uint64 max_num_triplets_{0};
   bool built_{false};
+  DataType dtype_;
+  Arch arch_;
+  ThreadPool *thread_pool_{nullptr};
+  // The device copy of the first four members, on CUDA.
+  void *device_header_{nullptr};
 };
 
+// SpMV and SpGEMM run on the thread pool of the matrix, if any. The
+// operands of a binary operation share the pool of the left one.
+template <typename T>
 class SparseMatrix {
  public:
+  using Scalar = T;
+  using EigenMatrix = Eigen::SparseMatrix<T, Eigen::ColMajor>;
+  using EigenVector = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+
   SparseMatrix() = delete;
-  SparseMatrix(int rows, int cols);
-  SparseMatrix(Eigen::SparseMatrix<float32> &matrix);
+  SparseMatrix(int rows, int cols, ThreadPool *thread_pool = nullptr);
+  SparseMatrix(EigenMatrix &matrix, ThreadPool *thread_pool = nullptr);
 
   const int num_rows() const;
   const int num_cols() const;
   const std::string to_string() const;
-  Eigen::SparseMatrix<float32> &get_matrix();
-  const Eigen::SparseMatrix<float32> &get_matrix() const;
-  float32 get_element(int row, int col);
-  void set_element(int row, int col, float32 value);
+  EigenMatrix &get_matrix();
+  const EigenMatrix &get_matrix() const;
+  T get_element(int row, int col);
+  void set_element(int row, int col, T value);
+
+  // A hash of the dimensions and of the positions of the nonzeros.
+  uint64 pattern_hash() const;
+  void set_from_triplets(const std::vector<Eigen::Triplet<T>> &triplets);
+  // Overwrites the values with the sums of the triplets, keeping the
+  // sparsity pattern. Returns false, leaving the values unspecified, if a
+  // triplet is outside of the pattern.
+  bool update_values(const std::vector<Eigen::Triplet<T>> &triplets);
 
   friend SparseMatrix operator+(const SparseMatrix &sm1,
-                                const SparseMatrix &sm2);
+                                const SparseMatrix &sm2) {
+    EigenMatrix res(sm1.matrix_ + sm2.matrix_);
+    return SparseMatrix(res, sm1.thread_pool_);
+  }
   friend SparseMatrix operator-(const SparseMatrix &sm1,
-                                const SparseMatrix &sm2);
-  friend SparseMatrix operator*(float scale, const SparseMatrix &sm);
-  friend SparseMatrix operator*(const SparseMatrix &sm, float scale);
+                                const SparseMatrix &sm2) {
+    EigenMatrix res(sm1.matrix_ - sm2.matrix_);
+    return SparseMatrix(res, sm1.thread_pool_);
+  }
+  friend SparseMatrix operator*(T scale, const SparseMatrix &sm) {
+    EigenMatrix res(scale * sm.matrix_);
+    return SparseMatrix(res, sm.thread_pool_);
+  }
+  friend SparseMatrix operator*(const SparseMatrix &sm, T scale) {
+    return scale * sm;
+  }
   friend SparseMatrix operator*(const SparseMatrix &sm1,
-                                const SparseMatrix &sm2);
+                                const SparseMatrix &sm2) {
+    EigenMatrix res(sm1.matrix_.cwiseProduct(sm2.matrix_));
+    return SparseMatrix(res, sm1.thread_pool_);
+  }
   SparseMatrix matmul(const SparseMatrix &sm);
-  Eigen::VectorXf mat_vec_mul(const Eigen::Ref<const Eigen::VectorXf> &b);
+  EigenVector mat_vec_mul(const Eigen::Ref<const EigenVector> &b);
 
   SparseMatrix transpose();
 
  private:
-  Eigen::SparseMatrix<float32, Eigen::ColMajor> matrix_;
+  // A CSR view of the compressed column storage, for the row-parallel SpMV.
+  // value_ids[k] is the position in the CSC values of the k-th CSR entry.
+  struct RowIndex {
+    std::vector<int> row_ptr;
+    std::vector<int> col_ind;
+    std::vector<int> value_ids;
+  };
+
+  void invalidate_pattern();
+  const RowIndex &get_row_index();
+
+  EigenMatrix matrix_;
+  ThreadPool *thread_pool_{nullptr};
+  // Both are computed on demand and dropped when the pattern may change.
+  mutable std::optional<uint64> pattern_hash_;
+  std::shared_ptr<const RowIndex> row_index_;
+};
+
+// A CSR matrix resident on a CUDA device, backed by cuSPARSE. Duplicated
+// triplets are kept as separate entries, which cuSPARSE sums in SpMV.
+class CuSparseMatrix {
+ public:
+  CuSparseMatrix(int rows, int cols);
+  CuSparseMatrix(const CuSparseMatrix &) = delete;
+  CuSparseMatrix &operator=(const CuSparseMatrix &) = delete;
+  ~CuSparseMatrix();
+
+  // Sorts the COO arrays (device pointers) in place and compresses them.
+  void build_csr_from_coo(int32 *coo_rows,
+                          int32 *coo_cols,
+                          float32 *coo_values,
+                          int nnz);
+
+  const int num_rows() const;
+  const int num_cols() const;
+  const std::string to_string() const;
+
+  // y = A x, where x and y are device pointers.
+  void spmv(const float32 *x, float32 *y) const;
+  Eigen::VectorXf mat_vec_mul(const Eigen::Ref<const Eigen::VectorXf> &b);
+
+ private:
+  int rows_{0};
+  int cols_{0};
+  int nnz_{0};
+  int32 *csr_row_ptr_{nullptr};
+  int32 *csr_col_ind_{nullptr};
+  float32 *csr_values_{nullptr};
+  // cusparseSpMatDescr_t
+  void *matrix_{nullptr};
+  mutable void *spmv_buffer_{nullptr};
+  mutable std::size_t spmv_buffer_size_{0};
 };
 }  // namespace lang
 }  // namespace taichi
@@ -1,15 +1,29 @@
 #include "sparse_solver.h"
 
+#include <atomic>
+#include <cmath>
 #include <unordered_map>
 
-#define MAKE_SOLVER(type, order)                                              \
-  {                                                                           \
-    {#type, #order}, []() -> std::unique_ptr<SparseSolver> {                  \
-      using T =                                                               \
-          Eigen::Simplicial##type<Eigen::SparseMatrix<float32>, Eigen::Lower, \
-                                  Eigen::order##Ordering<int>>;               \
-      return std::make_unique<EigenSparseSolver<T>>();                        \
-    }                                                                         \
+#include "Eigen/OrderingMethods"
+#include "taichi/system/threading.h"
+
+#if defined(TI_WITH_CHOLMOD)
+#include "Eigen/CholmodSupport"
+#endif
+
+#if defined(TI_WITH_CUDA)
+#include "taichi/backends/cuda/cuda_context.h"
+#include "taichi/backends/cuda/cuda_driver.h"
+#endif
+
+#define MAKE_SOLVER(type, order)                                          \
+  {                                                                       \
+    {#type, #order}, []() -> std::unique_ptr<SparseSolver<T>> {           \
+      using Solver =                                                      \
+          Eigen::Simplicial##type<Eigen::SparseMatrix<T>, Eigen::Lower,   \
+                                  Eigen::order##Ordering<int>>;           \
+      return std::make_unique<EigenSparseSolver<T, Solver>>();            \
+    }                                                                     \
   }
 
 namespace {
@@ -26,39 +40,352 @@ struct pair_hash {
 namespace taichi {
 namespace lang {
 
-template <class EigenSolver>
-bool EigenSparseSolver<EigenSolver>::compute(const SparseMatrix &sm) {
-  solver_.compute(sm.get_matrix());
+template <typename T, class EigenSolver>
+void EigenSparseSolver<T, EigenSolver>::analyze_pattern_if_changed(
+    const SparseMatrix<T> &sm) {
+  auto hash = sm.pattern_hash();
+  if (analyzed_pattern_hash_ != hash) {
+    solver_.analyzePattern(sm.get_matrix());
+    analyzed_pattern_hash_ = hash;
+  }
+}
+
+template <typename T, class EigenSolver>
+bool EigenSparseSolver<T, EigenSolver>::compute(const SparseMatrix<T> &sm) {
+  analyze_pattern_if_changed(sm);
+  solver_.factorize(sm.get_matrix());
   if (solver_.info() != Eigen::Success) {
     return false;
   } else
     return true;
 }
-template <class EigenSolver>
-void EigenSparseSolver<EigenSolver>::analyze_pattern(const SparseMatrix &sm) {
-  solver_.analyzePattern(sm.get_matrix());
+template <typename T, class EigenSolver>
+void EigenSparseSolver<T, EigenSolver>::analyze_pattern(
+    const SparseMatrix<T> &sm) {
+  analyze_pattern_if_changed(sm);
 }
 
-template <class EigenSolver>
-void EigenSparseSolver<EigenSolver>::factorize(const SparseMatrix &sm) {
+template <typename T, class EigenSolver>
+void EigenSparseSolver<T, EigenSolver>::factorize(const SparseMatrix<T> &sm) {
+  analyze_pattern_if_changed(sm);
   solver_.factorize(sm.get_matrix());
 }
 
-template <class EigenSolver>
-Eigen::VectorXf EigenSparseSolver<EigenSolver>::solve(
-    const Eigen::Ref<const Eigen::VectorXf> &b) {
+template <typename T, class EigenSolver>
+typename SparseSolver<T>::EigenVector EigenSparseSolver<T, EigenSolver>::solve(
+    const Eigen::Ref<const EigenVector> &b) {
   return solver_.solve(b);
 }
 
-template <class EigenSolver>
-bool EigenSparseSolver<EigenSolver>::info() {
+template <typename T, class EigenSolver>
+bool EigenSparseSolver<T, EigenSolver>::info() {
   return solver_.info() == Eigen::Success;
 }
 
-std::unique_ptr<SparseSolver> make_sparse_solver(const std::string &solver_type,
-                                                 const std::string &ordering) {
+template <typename T>
+ParallelSparseLLT<T>::ParallelSparseLLT(const std::string &ordering,
+                                        ThreadPool *thread_pool)
+    : ordering_(ordering), thread_pool_(thread_pool) {
+}
+
+template <typename T>
+typename ParallelSparseLLT<T>::EigenMatrix
+ParallelSparseLLT<T>::get_ordered_lower(const SparseMatrix<T> &sm) const {
+  EigenMatrix lower(sm.num_rows(), sm.num_cols());
+  lower.template selfadjointView<Eigen::Lower>() =
+      sm.get_matrix().template selfadjointView<Eigen::Lower>().twistedBy(
+          perm_);
+  return lower;
+}
+
+template <typename T>
+void ParallelSparseLLT<T>::analyze_pattern_if_changed(
+    const SparseMatrix<T> &sm) {
+  auto hash = sm.pattern_hash();
+  if (analyzed_pattern_hash_ == hash) {
+    return;
+  }
+  analyzed_pattern_hash_ = hash;
+  const int n = sm.num_rows();
+  TI_ASSERT(n == sm.num_cols());
+
+  // The same ordering as Eigen's SimplicialLLT.
+  Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> perm_inv;
+  EigenMatrix symmetric =
+      sm.get_matrix().template selfadjointView<Eigen::Lower>();
+  if (ordering_ == "COLAMD") {
+    Eigen::COLAMDOrdering<int>()(symmetric, perm_inv);
+  } else {
+    TI_ASSERT(ordering_ == "AMD");
+    Eigen::AMDOrdering<int>()(symmetric, perm_inv);
+  }
+  perm_ = perm_inv.inverse();
+  const EigenMatrix upper = get_ordered_lower(sm).transpose();
+
+  // The elimination tree, by Liu's algorithm with path compression.
+  std::vector<int> parent(n, -1), ancestor(n, -1);
+  for (int k = 0; k < n; k++) {
+    for (typename EigenMatrix::InnerIterator it(upper, k); it; ++it) {
+      int i = it.row();
+      while (i != -1 && i < k) {
+        const int next = ancestor[i];
+        ancestor[i] = k;
+        if (next == -1) {
+          parent[i] = k;
+        }
+        i = next;
+      }
+    }
+  }
+
+  // The pattern of row k of L is the subtree of the tree rooted at k and
+  // reached from the nonzeros of row k of the matrix.
+  std::vector<int> mark(n, -1), col_counts(n, 1);
+  row_ptr_.assign(1, 0);
+  row_cols_.clear();
+  for (int k = 0; k < n; k++) {
+    mark[k] = k;
+    for (typename EigenMatrix::InnerIterator it(upper, k); it; ++it) {
+      for (int j = it.row(); mark[j] != k; j = parent[j]) {
+        mark[j] = k;
+        row_cols_.push_back(j);
+        col_counts[j]++;
+      }
+    }
+    row_ptr_.push_back((int)row_cols_.size());
+  }
+  col_ptr_.assign(n + 1, 0);
+  for (int j = 0; j < n; j++) {
+    col_ptr_[j + 1] = col_ptr_[j] + col_counts[j];
+  }
+  // Rows by increasing index in each column, after the diagonal.
+  row_ind_.resize(col_ptr_[n]);
+  row_value_ids_.resize(row_cols_.size());
+  std::vector<int> next(n);
+  for (int j = 0; j < n; j++) {
+    row_ind_[col_ptr_[j]] = j;
+    next[j] = col_ptr_[j] + 1;
+  }
+  for (int k = 0; k < n; k++) {
+    for (int e = row_ptr_[k]; e < row_ptr_[k + 1]; e++) {
+      const int j = row_cols_[e];
+      row_value_ids_[e] = next[j];
+      row_ind_[next[j]++] = k;
+    }
+  }
+  values_.assign(row_ind_.size(), 0);
+
+  // The parents follow their children, so the heights are final in order.
+  std::vector<int> heights(n, 0);
+  int num_levels = n > 0 ? 1 : 0;
+  for (int j = 0; j < n; j++) {
+    if (parent[j] != -1) {
+      heights[parent[j]] = std::max(heights[parent[j]], heights[j] + 1);
+      num_levels = std::max(num_levels, heights[parent[j]] + 1);
+    }
+  }
+  level_ptr_.assign(num_levels + 1, 0);
+  for (int j = 0; j < n; j++) {
+    level_ptr_[heights[j] + 1]++;
+  }
+  for (int l = 0; l < num_levels; l++) {
+    level_ptr_[l + 1] += level_ptr_[l];
+  }
+  level_cols_.resize(n);
+  std::vector<int> level_next(level_ptr_.begin(), level_ptr_.end() - 1);
+  for (int j = 0; j < n; j++) {
+    level_cols_[level_next[heights[j]]++] = j;
+  }
+  TI_TRACE("ParallelSparseLLT: {} rows, {} nonzeros in L, {} levels", n,
+           row_ind_.size(), num_levels);
+}
+
+template <typename T>
+bool ParallelSparseLLT<T>::factorize_column(int j,
+                                            const EigenMatrix &lower,
+                                            T *work) {
+  const int begin = col_ptr_[j];
+  const int end = col_ptr_[j + 1];
+  for (int p = begin; p < end; p++) {
+    work[row_ind_[p]] = 0;
+  }
+  for (typename EigenMatrix::InnerIterator it(lower, j); it; ++it) {
+    work[it.row()] = it.value();
+  }
+  // work -= L(j:n, k) * L(j, k) for the columns k < j of row j, which are all
+  // factorized already.
+  for (int e = row_ptr_[j]; e < row_ptr_[j + 1]; e++) {
+    const int k = row_cols_[e];
+    const int pos = row_value_ids_[e];
+    const T l_jk = values_[pos];
+    for (int q = pos; q < col_ptr_[k + 1]; q++) {
+      work[row_ind_[q]] -= values_[q] * l_jk;
+    }
+  }
+  const T diagonal = work[j];
+  if (!(diagonal > 0)) {
+    return false;
+  }
+  const T l_jj = std::sqrt(diagonal);
+  values_[begin] = l_jj;
+  for (int p = begin + 1; p < end; p++) {
+    values_[p] = work[row_ind_[p]] / l_jj;
+  }
+  return true;
+}
+
+template <typename T>
+bool ParallelSparseLLT<T>::compute(const SparseMatrix<T> &sm) {
+  factorize(sm);
+  return success_;
+}
+
+template <typename T>
+void ParallelSparseLLT<T>::analyze_pattern(const SparseMatrix<T> &sm) {
+  analyze_pattern_if_changed(sm);
+}
+
+template <typename T>
+void ParallelSparseLLT<T>::factorize(const SparseMatrix<T> &sm) {
+  analyze_pattern_if_changed(sm);
+  const int n = sm.num_rows();
+  const EigenMatrix lower = get_ordered_lower(sm);
+  const int num_threads =
+      thread_pool_ ? thread_pool_->get_max_num_threads() : 1;
+  std::atomic<bool> success{true};
+  for (int l = 0; l + 1 < (int)level_ptr_.size(); l++) {
+    const int *cols = level_cols_.data() + level_ptr_[l];
+    const int num_cols = level_ptr_[l + 1] - level_ptr_[l];
+    // A few blocks per thread to balance the columns of different costs.
+    const int block_size = std::max(1, num_cols / (num_threads * 8));
+    parallel_for_blocks(thread_pool_, num_cols, block_size,
+                        [&](int begin, int end) {
+                          thread_local std::vector<T> work;
+                          if ((int)work.size() < n) {
+                            work.resize(n);
+                          }
+                          for (int c = begin; c < end; c++) {
+                            if (!factorize_column(cols[c], lower,
+                                                  work.data())) {
+                              success.store(false, std::memory_order_relaxed);
+                            }
+                          }
+                        });
+  }
+  success_ = success.load();
+}
+
+template <typename T>
+typename SparseSolver<T>::EigenVector ParallelSparseLLT<T>::solve(
+    const Eigen::Ref<const EigenVector> &b) {
+  const int n = (int)col_ptr_.size() - 1;
+  TI_ASSERT(b.size() == n);
+  const Eigen::Map<const Eigen::SparseMatrix<T, Eigen::ColMajor, int>> l(
+      n, n, (int)values_.size(), col_ptr_.data(), row_ind_.data(),
+      values_.data());
+  EigenVector x = perm_ * b;
+  l.template triangularView<Eigen::Lower>().solveInPlace(x);
+  l.transpose().template triangularView<Eigen::Upper>().solveInPlace(x);
+  return perm_.inverse() * x;
+}
+
+template <typename T>
+bool ParallelSparseLLT<T>::info() {
+  return success_;
+}
+
+template class ParallelSparseLLT<float32>;
+template class ParallelSparseLLT<float64>;
+
+CuSparseSolver::CuSparseSolver(int max_iterations, float32 tolerance)
+    : max_iterations_(max_iterations), tolerance_(tolerance) {
+}
+
+CuSparseSolver::~CuSparseSolver() = default;
+
+bool CuSparseSolver::compute(const CuSparseMatrix &sm) {
+  TI_ASSERT(sm.num_rows() == sm.num_cols());
+  matrix_ = &sm;
+  return true;
+}
+
+void CuSparseSolver::analyze_pattern(const CuSparseMatrix &sm) {
+  // Nothing to analyze for an iterative solver.
+}
+
+void CuSparseSolver::factorize(const CuSparseMatrix &sm) {
+  compute(sm);
+}
+
+Eigen::VectorXf CuSparseSolver::solve(
+    const Eigen::Ref<const Eigen::VectorXf> &b) {
+#if defined(TI_WITH_CUDA)
+  TI_ASSERT(matrix_ != nullptr);
+  const int n = matrix_->num_rows();
+  TI_ASSERT(b.size() == n);
+  auto guard = CUDAContext::get_instance().get_guard();
+  auto &driver = CUDADriver::get_instance();
+  auto &cublas = CUBLASDriver::get_instance();
+  TI_ERROR_IF(!cublas.detected(), "cuBLAS is required by CuSparseSolver.");
+  static void *handle = [&] {
+    void *h = nullptr;
+    cublas.create(&h);
+    return h;
+  }();
+
+  // x: solution, r: residual, p: search direction, ap: A p
+  float32 *x, *r, *p, *ap;
+  for (auto vec : {&x, &r, &p, &ap}) {
+    driver.malloc((void **)vec, std::max(n, 1) * sizeof(float32));
+  }
+  driver.memset(x, 0, n * sizeof(float32));
+  driver.memcpy_host_to_device(r, (void *)b.data(), n * sizeof(float32));
+  driver.memcpy_device_to_device(p, r, n * sizeof(float32));
+
+  float32 rr = 0;
+  cublas.sdot(handle, n, r, 1, r, 1, &rr);
+  const float32 threshold = tolerance_ * tolerance_ * rr;
+  const int max_iterations = max_iterations_ > 0 ? max_iterations_ : n;
+  success_ = rr <= threshold;
+  for (int k = 0; k < max_iterations && !success_; k++) {
+    matrix_->spmv(p, ap);
+    float32 pap = 0;
+    cublas.sdot(handle, n, p, 1, ap, 1, &pap);
+    float32 alpha = rr / pap, neg_alpha = -alpha;
+    cublas.saxpy(handle, n, &alpha, p, 1, x, 1);
+    cublas.saxpy(handle, n, &neg_alpha, ap, 1, r, 1);
+    float32 rr_new = 0;
+    cublas.sdot(handle, n, r, 1, r, 1, &rr_new);
+    success_ = rr_new <= threshold;
+    // p = r + beta * p
+    float32 beta = rr_new / rr, one = 1;
+    cublas.sscal(handle, n, &beta, p, 1);
+    cublas.saxpy(handle, n, &one, r, 1, p, 1);
+    rr = rr_new;
+  }
+
+  Eigen::VectorXf res(n);
+  driver.memcpy_device_to_host(res.data(), x, n * sizeof(float32));
+  for (auto vec : {x, r, p, ap}) {
+    driver.mem_free(vec);
+  }
+  return res;
+#else
+  TI_NOT_IMPLEMENTED
+#endif
+}
+
+bool CuSparseSolver::info() {
+  return success_;
+}
+
+template <typename T>
+std::unique_ptr<SparseSolver<T>> make_sparse_solver(
+    const std::string &solver_type,
+    const std::string &ordering,
+    ThreadPool *thread_pool) {
   using key_type = std::pair<std::string, std::string>;
-  using func_type = std::unique_ptr<SparseSolver> (*)();
+  using func_type = std::unique_ptr<SparseSolver<T>> (*)();
   static const std::unordered_map<key_type, func_type, pair_hash>
       solver_factory = {
           MAKE_SOLVER(LLT, AMD),
@@ -73,11 +400,33 @@ std::unique_ptr<SparseSolver> make_sparse_solver(const std::string &solver_type,
     auto solver_func = solver_factory.at(solver_key);
     return solver_func();
   } else if (solver_type == "LU") {
-    using LU = Eigen::SparseLU<Eigen::SparseMatrix<float32>>;
-    return std::make_unique<EigenSparseSolver<LU>>();
+    using LU = Eigen::SparseLU<Eigen::SparseMatrix<T>>;
+    return std::make_unique<EigenSparseSolver<T, LU>>();
+  } else if (solver_type == "ParallelLLT") {
+    return std::make_unique<ParallelSparseLLT<T>>(ordering, thread_pool);
+  } else if (solver_type == "CholmodLLT") {
+#if defined(TI_WITH_CHOLMOD)
+    if constexpr (std::is_same_v<T, float64>) {
+      using Cholmod =
+          Eigen::CholmodSupernodalLLT<Eigen::SparseMatrix<T>, Eigen::Lower>;
+      return std::make_unique<EigenSparseSolver<T, Cholmod>>();
+    }
+    TI_ERROR("CholmodLLT only supports f64.");
+#else
+    TI_ERROR("CholmodLLT requires building Taichi with TI_WITH_CHOLMOD=ON.");
+#endif
   } else
     TI_ERROR("Not supported sparse solver type: {}", solver_type);
 }
 
+template std::unique_ptr<SparseSolver<float32>> make_sparse_solver<float32>(
+    const std::string &solver_type,
+    const std::string &ordering,
+    ThreadPool *thread_pool);
+template std::unique_ptr<SparseSolver<float64>> make_sparse_solver<float64>(
+    const std::string &solver_type,
+    const std::string &ordering,
+    ThreadPool *thread_pool);
+
 }  // namespace lang
 }  // namespace taichi
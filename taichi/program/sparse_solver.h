@@ -5,32 +5,129 @@
 namespace taichi {
 namespace lang {
 
+template <typename T>
 class SparseSolver {
  public:
+  using EigenVector = typename SparseMatrix<T>::EigenVector;
+
   virtual ~SparseSolver() = default;
-  virtual bool compute(const SparseMatrix &sm) = 0;
-  virtual void analyze_pattern(const SparseMatrix &sm) = 0;
-  virtual void factorize(const SparseMatrix &sm) = 0;
-  virtual Eigen::VectorXf solve(const Eigen::Ref<const Eigen::VectorXf> &b) = 0;
+  virtual bool compute(const SparseMatrix<T> &sm) = 0;
+  virtual void analyze_pattern(const SparseMatrix<T> &sm) = 0;
+  virtual void factorize(const SparseMatrix<T> &sm) = 0;
+  virtual EigenVector solve(const Eigen::Ref<const EigenVector> &b) = 0;
   virtual bool info() = 0;
 };
 
-template <class EigenSolver>
-class EigenSparseSolver : public SparseSolver {
+// The symbolic analysis is skipped when the pattern hash of the matrix is
+// the same as at the previous analysis, so that compute() and factorize() on
+// matrices rebuilt with the same pattern only redo the numeric factorization.
+template <typename T, class EigenSolver>
+class EigenSparseSolver : public SparseSolver<T> {
  private:
   EigenSolver solver_;
+  std::optional<uint64> analyzed_pattern_hash_;
+
+  void analyze_pattern_if_changed(const SparseMatrix<T> &sm);
 
  public:
+  using EigenVector = typename SparseSolver<T>::EigenVector;
+
   ~EigenSparseSolver() override = default;
-  bool compute(const SparseMatrix &sm) override;
-  void analyze_pattern(const SparseMatrix &sm) override;
-  void factorize(const SparseMatrix &sm) override;
-  Eigen::VectorXf solve(const Eigen::Ref<const Eigen::VectorXf> &b) override;
+  bool compute(const SparseMatrix<T> &sm) override;
+  void analyze_pattern(const SparseMatrix<T> &sm) override;
+  void factorize(const SparseMatrix<T> &sm) override;
+  EigenVector solve(const Eigen::Ref<const EigenVector> &b) override;
   bool info() override;
 };
 
-std::unique_ptr<SparseSolver> make_sparse_solver(const std::string &solver_type,
-                                                 const std::string &ordering);
+// Cholesky (LLT) factorization of symmetric positive definite matrices on a
+// ThreadPool. The analysis orders the matrix (AMD or COLAMD), builds its
+// elimination tree and the pattern of L, and groups the columns by their
+// height in the tree. A column only depends on its descendants, which are
+// lower, so the columns of a group are factorized in parallel (left-looking),
+// one group after the other. The parallelism runs out towards the root, so
+// wide and shallow trees, e.g. of meshes ordered by AMD, scale best.
+//
+// Like EigenSparseSolver, the analysis is skipped while the pattern hash of
+// the matrix is the same.
+template <typename T>
+class ParallelSparseLLT : public SparseSolver<T> {
+ public:
+  using EigenVector = typename SparseSolver<T>::EigenVector;
+
+  // Runs serially if |thread_pool| is null.
+  ParallelSparseLLT(const std::string &ordering, ThreadPool *thread_pool);
+
+  ~ParallelSparseLLT() override = default;
+  bool compute(const SparseMatrix<T> &sm) override;
+  void analyze_pattern(const SparseMatrix<T> &sm) override;
+  void factorize(const SparseMatrix<T> &sm) override;
+  EigenVector solve(const Eigen::Ref<const EigenVector> &b) override;
+  bool info() override;
+
+ private:
+  using EigenMatrix = typename SparseMatrix<T>::EigenMatrix;
+
+  void analyze_pattern_if_changed(const SparseMatrix<T> &sm);
+
+  // The lower triangle of the ordered matrix.
+  EigenMatrix get_ordered_lower(const SparseMatrix<T> &sm) const;
+
+  // |work| has one entry per row. Returns false if the matrix is not
+  // positive definite.
+  bool factorize_column(int j, const EigenMatrix &lower, T *work);
+
+  std::string ordering_;
+  ThreadPool *thread_pool_{nullptr};
+  std::optional<uint64> analyzed_pattern_hash_;
+  Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> perm_;
+  // L in compressed columns, with the diagonal first in each column.
+  std::vector<int> col_ptr_;
+  std::vector<int> row_ind_;
+  std::vector<T> values_;
+  // The strictly lower entries of each row of L, by column, with their
+  // positions in |values_|.
+  std::vector<int> row_ptr_;
+  std::vector<int> row_cols_;
+  std::vector<int> row_value_ids_;
+  // The columns grouped by their height in the elimination tree.
+  std::vector<int> level_ptr_;
+  std::vector<int> level_cols_;
+  bool success_{false};
+};
+
+// Conjugate gradient solver of symmetric positive definite CuSparseMatrix
+// systems on CUDA, built on cuSPARSE SpMV and cuBLAS. Only the right-hand side,
+// the solution and a few scalars per iteration cross the PCIe bus.
+class CuSparseSolver {
+ public:
+  // max_iterations = 0 runs at most as many iterations as there are rows.
+  explicit CuSparseSolver(int max_iterations = 0, float32 tolerance = 1e-6f);
+  ~CuSparseSolver();
+
+  bool compute(const CuSparseMatrix &sm);
+  void analyze_pattern(const CuSparseMatrix &sm);
+  void factorize(const CuSparseMatrix &sm);
+  Eigen::VectorXf solve(const Eigen::Ref<const Eigen::VectorXf> &b);
+  bool info();
+
+ private:
+  const CuSparseMatrix *matrix_{nullptr};
+  int max_iterations_{0};
+  float32 tolerance_{0};
+  bool success_{false};
+};
+
+// T is float32 or float64. |solver_type| is one of:
+//  - "LLT", "LDLT" and "LU", the single-threaded solvers of Eigen;
+//  - "ParallelLLT", a ParallelSparseLLT on |thread_pool|;
+//  - "CholmodLLT", the supernodal Cholesky of CHOLMOD, for float64 only and if
+//    built with TI_WITH_CHOLMOD. It ignores |ordering|.
+template <typename T>
+std::unique_ptr<SparseSolver<T>> make_sparse_solver(
+    const std::string &solver_type,
+    const std::string &ordering,
+    ThreadPool *thread_pool = nullptr);
 
 }  // namespace lang
 }  // namespace taichi
@@ -253,6 +253,8 @@ StateFlowGraph::StateFlowGraph(AsyncEngine *engine,
   initial_node_->node_id = 0;
   initial_node_->input_edges.node_id = 0;
   initial_node_->output_edges.node_id = 0;
+  initial_node_->ancestors = bit::Bitset(1);
+  initial_node_->ancestors[0] = true;
   initial_node_->mark_executed();
 }
 
@@ -294,6 +296,7 @@ void StateFlowGraph::clear() {
             initial_node_);
   latest_state_readers_.clear();
   first_pending_task_index_ = 1;
+  ancestors_up_to_date_ = true;
 
   // Do not clear task_name_to_launch_ids_.
 }
@@ -313,6 +316,13 @@ void StateFlowGraph::mark_pending_tasks_as_executed() {
   nodes_ = std::move(new_nodes);
   first_pending_task_index_ = nodes_.size();
   reid_nodes();
+  // Paths between pending tasks never go through executed ones, so the
+  // ancestors of the executed tasks don't matter.
+  for (auto &node : nodes_) {
+    node->ancestors = bit::Bitset(node->node_id + 1);
+    node->ancestors[node->node_id] = true;
+  }
+  ancestors_up_to_date_ = true;
 }
 
 void StateFlowGraph::insert_tasks(const std::vector<TaskLaunchRecord> &records,
@@ -375,16 +385,32 @@ void StateFlowGraph::insert_tasks(const std::vector<TaskLaunchRecord> &records,
 }
 
 void StateFlowGraph::insert_node(std::unique_ptr<StateFlowGraph::Node> &&node) {
+  const int id = nodes_.size();
+  node->node_id = id;
+  node->input_edges.node_id = id;
+  node->output_edges.node_id = id;
+  if (ancestors_up_to_date_) {
+    node->ancestors = bit::Bitset(id + 1);
+    node->ancestors[id] = true;
+  }
+  // All the edges inserted here point to |node|, so its ancestors can be
+  // computed right away.
+  auto insert_input_edge = [&](Node *from, AsyncState state) {
+    insert_edge(from, node.get(), state);
+    // The ancestors of |from| are already included if |from| is.
+    if (ancestors_up_to_date_ && !node->ancestors[from->node_id]) {
+      node->ancestors.or_eq_prefix(from->ancestors);
+    }
+  };
   for (auto input_state : node->meta->input_states) {
-    insert_edge(latest_state_owner_[input_state.unique_id], node.get(),
-                input_state);
+    insert_input_edge(latest_state_owner_[input_state.unique_id], input_state);
   }
   for (auto output_state : node->meta->output_states) {
     if (get_or_insert(latest_state_readers_, output_state).empty()) {
       if (latest_state_owner_[output_state.unique_id] != initial_node_) {
         // insert a WAW dependency edge
-        insert_edge(latest_state_owner_[output_state.unique_id], node.get(),
-                    output_state);
+        insert_input_edge(latest_state_owner_[output_state.unique_id],
+                          output_state);
       } else {
         insert(latest_state_readers_, output_state, initial_node_);
       }
@@ -392,7 +418,7 @@ void StateFlowGraph::insert_node(std::unique_ptr<StateFlowGraph::Node> &&node) {
     latest_state_owner_[output_state.unique_id] = node.get();
     for (auto *d : get_or_insert(latest_state_readers_, output_state)) {
       // insert a WAR dependency edge
-      insert_edge(d, node.get(), output_state);
+      insert_input_edge(d, output_state);
     }
     get_or_insert(latest_state_readers_, output_state).clear();
   }
@@ -538,37 +564,52 @@ StateFlowGraph::compute_transitive_closure(int begin, int end) {
   TI_AUTO_PROF;
   using bit::Bitset;
   const int n = end - begin;
+  if (!ancestors_up_to_date_) {
+    recompute_ancestors();
+  }
   auto nodes = get_pending_tasks(begin, end);
+  const int offset = first_pending_task_index_ + begin;
 
   auto has_path = std::vector<Bitset>(n);
   auto has_path_reverse = std::vector<Bitset>(n);
   // has_path[i][j] denotes if there is a path from i to j.
   // has_path_reverse[i][j] denotes if there is a path from j to i.
+  // Any path between two nodes in the range stays in the range, since the
+  // pending nodes are in topological order.
   for (int i = 0; i < n; i++) {
+    TI_ASSERT(nodes[i]->node_id == offset + i);
+    has_path_reverse[i] = nodes[i]->ancestors.slice(offset, offset + n);
     has_path[i] = Bitset(n);
-    has_path[i][i] = true;
-    has_path_reverse[i] = Bitset(n);
-    has_path_reverse[i][i] = true;
-  }
-  for (int i = n - 1; i >= 0; i--) {
-    for (auto &edge : nodes[i]->input_edges.get_all_edges()) {
-      auto tmp_id = edge.second->pending_node_id - begin;
-      if (tmp_id >= 0 && tmp_id < n) {
-        TI_ASSERT(tmp_id < i);
-        has_path[tmp_id] |= has_path[i];
-      }
+  }
+  for (int j = 0; j < n; j++) {
+    for (int i = has_path_reverse[j].find_first_one(); i != -1;
+         i = has_path_reverse[j].lower_bound(i + 1)) {
+      has_path[i][j] = true;
     }
   }
-  for (int i = 0; i < n; i++) {
-    for (auto &edge : nodes[i]->output_edges.get_all_edges()) {
-      auto tmp_id = edge.second->pending_node_id - begin;
-      if (tmp_id >= 0 && tmp_id < n) {
-        TI_ASSERT(tmp_id > i);
-        has_path_reverse[tmp_id] |= has_path_reverse[i];
+  return std::make_pair(std::move(has_path), std::move(has_path_reverse));
+}
+
+void StateFlowGraph::recompute_ancestors() {
+  TI_AUTO_PROF;
+  reid_nodes();
+  for (auto &node : nodes_) {
+    const int id = node->node_id;
+    node->ancestors = bit::Bitset(id + 1);
+    node->ancestors[id] = true;
+    if (node->executed()) {
+      // See mark_pending_tasks_as_executed().
+      continue;
+    }
+    for (auto &edge : node->input_edges.get_all_edges()) {
+      auto *from = edge.second;
+      TI_ASSERT(from->node_id < id);
+      if (!node->ancestors[from->node_id]) {
+        node->ancestors.or_eq_prefix(from->ancestors);
       }
     }
   }
-  return std::make_pair(std::move(has_path), std::move(has_path_reverse));
+  ancestors_up_to_date_ = true;
 }
 
 std::unordered_set<int> StateFlowGraph::fuse_range(int begin, int end) {
@@ -877,18 +918,91 @@ void StateFlowGraph::rebuild_graph(bool sort) {
   sort_node_edges();
 }
 
-std::vector<TaskLaunchRecord> StateFlowGraph::extract_to_execute() {
+std::vector<TaskLaunchRecord> StateFlowGraph::extract_to_execute(
+    std::vector<std::vector<int>> *dependencies) {
   TI_AUTO_PROF;
+  if (dependencies) {
+    reid_pending_nodes();
+  }
   auto nodes = get_pending_tasks();
   std::vector<TaskLaunchRecord> tasks;
   tasks.reserve(nodes.size());
-  for (auto &node : nodes) {
-    if (!node->rec.empty()) {
+  if (dependencies) {
+    dependencies->clear();
+    dependencies->reserve(nodes.size());
+  }
+  // The tasks to wait for, per pending node. A node without a task launch
+  // record, or discarding values, forwards its own dependencies to its
+  // successors.
+  auto launches = [](const Node *node) {
+    return !node->rec.empty() && !node->meta->discard;
+  };
+  std::vector<std::vector<int>> node_deps(nodes.size());
+  std::vector<int> task_ids(nodes.size(), -1);
+  int last_untracked_task = -1;
+  for (int i = 0; i < (int)nodes.size(); i++) {
+    auto *node = nodes[i];
+    if (dependencies) {
+      auto &deps = node_deps[i];
+      for (auto &edge : node->input_edges.get_all_edges()) {
+        auto *from = edge.second;
+        if (!from->pending()) {
+          continue;
+        }
+        // Pending nodes are in topological order, see reid_pending_nodes().
+        TI_ASSERT(from->pending_node_id < i);
+        if (!launches(nodes[from->pending_node_id])) {
+          const auto &inherited = node_deps[from->pending_node_id];
+          deps.insert(deps.end(), inherited.begin(), inherited.end());
+        } else {
+          deps.push_back(task_ids[from->pending_node_id]);
+        }
+      }
+      if (launches(node) && node->meta->has_untracked_side_effects) {
+        if (last_untracked_task >= 0) {
+          deps.push_back(last_untracked_task);
+        }
+        last_untracked_task = (int)tasks.size();
+      }
+      std::sort(deps.begin(), deps.end());
+      deps.erase(std::unique(deps.begin(), deps.end()), deps.end());
+    }
+    if (launches(node)) {
+      task_ids[i] = (int)tasks.size();
       tasks.push_back(node->rec);
+      if (dependencies) {
+        dependencies->push_back(node_deps[i]);
+      }
     }
   }
   mark_pending_tasks_as_executed();
-  rebuild_graph(/*sort=*/false);
+  reset_to_executed(get_records());
+  return tasks;
+}
+
+std::vector<TaskLaunchRecord> StateFlowGraph::get_records() const {
+  std::vector<TaskLaunchRecord> records;
+  records.reserve(nodes_.size());
+  for (int i = 1; i < (int)nodes_.size(); i++) {
+    if (!nodes_[i]->rec.empty()) {
+      records.push_back(nodes_[i]->rec);
+    }
+  }
+  return records;
+}
+
+void StateFlowGraph::reset_to_executed(
+    const std::vector<TaskLaunchRecord> &records) {
+  TI_AUTO_PROF;
+  clear();
+  insert_tasks(records, /*filter_listgen=*/false);
+  for (int i = 1; i < (int)nodes_.size(); i++) {
+    nodes_[i]->mark_executed();
+  }
+  first_pending_task_index_ = nodes_.size();
+  reid_nodes();
+  reid_pending_nodes();
+  sort_node_edges();
   for (int i = 0; i < first_pending_task_index_; ++i) {
     // The reason we do this is that, upon the next launch, we could insert
     // edges to these executed but retained nodes. To allow for insertion, we
@@ -896,7 +1010,6 @@ std::vector<TaskLaunchRecord> StateFlowGraph::extract_to_execute() {
     nodes_[i]->input_edges.unsort_edges();
     nodes_[i]->output_edges.unsort_edges();
   }
-  return tasks;
 }
 
 void StateFlowGraph::print() {
@@ -1065,6 +1178,7 @@ std::string StateFlowGraph::dump_dot(const std::optional<std::string> &rankdir,
 void StateFlowGraph::topo_sort_nodes() {
   TI_AUTO_PROF
   // Only sort pending tasks.
+  ancestors_up_to_date_ = false;
   const auto previous_size = nodes_.size();
   std::deque<std::unique_ptr<Node>> queue;
   std::vector<int> degrees_in(num_pending_tasks());
@@ -1160,6 +1274,7 @@ void StateFlowGraph::replace_reference(StateFlowGraph::Node *node_a,
                                        StateFlowGraph::Node *node_b,
                                        bool only_output_edges) {
   TI_AUTO_PROF
+  ancestors_up_to_date_ = false;
   // replace all edges to node A with new ones to node B
   for (auto &edge : node_a->output_edges.get_all_edges()) {
     // Find all nodes C that points to A
@@ -1203,6 +1318,7 @@ void StateFlowGraph::delete_nodes(
   TI_AUTO_PROF
   std::vector<std::unique_ptr<Node>> new_nodes_;
   std::unordered_set<Node *> nodes_to_delete;
+  ancestors_up_to_date_ = false;
 
   for (auto &i : indices_to_delete) {
     TI_ASSERT(nodes_[i]->pending());
@@ -1242,6 +1358,10 @@ bool StateFlowGraph::optimize_dead_store() {
 
   auto nodes = get_pending_tasks();
   for (auto &task : nodes) {
+    if (task->meta->discard) {
+      // Nothing to erase, and its WAW edges end the stores before it.
+      continue;
+    }
     // Dive into this task and erase dead stores
     std::set<const SNode *> store_eliminable_snodes;
     // Try to find unnecessary output state
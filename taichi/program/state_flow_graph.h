@@ -179,6 +179,10 @@ class StateFlowGraph {
     // For executed tasks (including the initial node), pending_node_id is -1.
     int pending_node_id{0};
 
+    // Bit i is set iff nodes_[i] is this node or one of its ancestors. Only
+    // meaningful when StateFlowGraph::ancestors_up_to_date_ is true.
+    bit::Bitset ancestors;
+
     // Performance hits
     // * std::unordered_multimap: Slow on clang + libc++, see #1855
     // * std::unordered_map<., std::unordered_set<.>>: slow due to frequent
@@ -271,6 +275,8 @@ class StateFlowGraph {
   void insert_edge(Node *from, Node *to, AsyncState state);
 
   // Compute transitive closure for tasks in get_pending_tasks()[begin, end).
+  // This is sliced from the ancestors maintained by insert_node(), unless the
+  // graph has been modified in another way since the last clear().
   std::pair<std::vector<bit::Bitset>, std::vector<bit::Bitset>>
   compute_transitive_closure(int begin, int end);
 
@@ -306,7 +312,20 @@ class StateFlowGraph {
   void rebuild_graph(bool sort);
 
   // Extract all tasks to execute.
-  std::vector<TaskLaunchRecord> extract_to_execute();
+  //
+  // If |dependencies| is not null, (*dependencies)[i] is filled with the
+  // indices of the extracted tasks that the i-th task must wait for. Tasks
+  // from earlier extractions are not included.
+  std::vector<TaskLaunchRecord> extract_to_execute(
+      std::vector<std::vector<int>> *dependencies = nullptr);
+
+  // The records of all the nodes but the initial one, i.e. of the executed
+  // tasks retained, then of the pending tasks.
+  std::vector<TaskLaunchRecord> get_records() const;
+
+  // Replaces the graph by the executed tasks |records|, as left by
+  // extract_to_execute(), e.g. when a memoized flush is replayed.
+  void reset_to_executed(const std::vector<TaskLaunchRecord> &records);
 
   std::size_t size() const {
     return nodes_.size();
@@ -335,6 +354,10 @@ class StateFlowGraph {
 #endif
 
  private:
+  // Recomputes Node::ancestors from scratch. The pending nodes must be in
+  // topological order.
+  void recompute_ancestors();
+
   std::vector<std::unique_ptr<Node>> nodes_;
   Node *initial_node_;  // The initial node holds all the initial states.
   int first_pending_task_index_;
@@ -346,6 +369,9 @@ class StateFlowGraph {
   std::unordered_map<SNode *, bool> list_up_to_date_;
   [[maybe_unused]] AsyncEngine *engine_;
   const CompileConfig *const config_;
+  // Whether Node::ancestors is valid for all the nodes. Inserting a node keeps
+  // it valid. Other modifications invalidate it until the next clear().
+  bool ancestors_up_to_date_{true};
 };
 
 TLANG_NAMESPACE_END
@@ -0,0 +1,122 @@
+#include <cstring>
+#include <numeric>
+
+#include "taichi/program/texture.h"
+#include "taichi/program/program.h"
+#include "taichi/system/device_memory_tracker.h"
+
+namespace taichi {
+namespace lang {
+
+namespace {
+
+BufferFormat get_texture_format(int num_channels) {
+  TI_ERROR_IF(num_channels != 1 && num_channels != 2 && num_channels != 4,
+              "Textures have 1, 2 or 4 channels, not {}", num_channels);
+  return num_channels == 1   ? BufferFormat::r32f
+         : num_channels == 2 ? BufferFormat::rg32f
+                             : BufferFormat::rgba32f;
+}
+
+}  // namespace
+
+Texture::Texture(Program *prog,
+                 const DataType type,
+                 int num_channels,
+                 const std::vector<int> &shape)
+    : dtype(type),
+      num_channels(num_channels),
+      shape(shape),
+      prog_(prog),
+      nelement_(std::accumulate(std::begin(shape),
+                                std::end(shape),
+                                1,
+                                std::multiplies<>())) {
+  TI_ERROR_IF(prog->config.arch != Arch::vulkan,
+              "Textures are only supported on Vulkan");
+  TI_ERROR_IF(dtype != PrimitiveType::f32, "Textures only support f32");
+  TI_ERROR_IF(shape.empty() || shape.size() > 3,
+              "Textures have 1 to 3 dimensions, not {}", shape.size());
+  device_ = static_cast<GraphicsDevice *>(prog->get_graphics_device());
+  TI_ASSERT(device_);
+
+  ImageParams params;
+  params.dimension = shape.size() == 1   ? ImageDimension::d1D
+                     : shape.size() == 2 ? ImageDimension::d2D
+                                         : ImageDimension::d3D;
+  params.format = get_texture_format(num_channels);
+  params.initial_layout = ImageLayout::undefined;
+  params.x = shape[0];
+  params.y = shape.size() > 1 ? shape[1] : 1;
+  params.z = shape.size() > 2 ? shape[2] : 1;
+  texture_alloc_ = device_->create_image(params);
+  // Kernels may sample the texture before anything is copied into it.
+  device_->image_transition(texture_alloc_, ImageLayout::undefined,
+                            ImageLayout::shader_read);
+}
+
+Texture::~Texture() {
+  device_->destroy_image(texture_alloc_);
+}
+
+BufferImageCopyParams Texture::copy_params() const {
+  BufferImageCopyParams params;
+  params.image_extent.x = shape[0];
+  params.image_extent.y = shape.size() > 1 ? shape[1] : 1;
+  params.image_extent.z = shape.size() > 2 ? shape[2] : 1;
+  return params;
+}
+
+void Texture::from_host(intptr_t data_ptr) {
+  const std::size_t size = nelement_ * num_channels * sizeof(float32);
+  Device::AllocParams alloc_params;
+  alloc_params.size = size;
+  alloc_params.host_write = true;
+  DeviceMemoryTracker::Scope scope("texture", "staging");
+  auto staging = device_->allocate_memory(alloc_params);
+  std::memcpy(device_->map(staging), reinterpret_cast<void *>(data_ptr), size);
+  device_->unmap(staging);
+
+  // The kernels in flight may be sampling the texture.
+  prog_->synchronize();
+  device_->image_transition(texture_alloc_, ImageLayout::shader_read,
+                            ImageLayout::transfer_dst);
+  device_->buffer_to_image(texture_alloc_, staging.get_ptr(0),
+                           ImageLayout::transfer_dst, copy_params());
+  device_->image_transition(texture_alloc_, ImageLayout::transfer_dst,
+                            ImageLayout::shader_read);
+  device_->dealloc_memory(staging);
+}
+
+void Texture::to_host(intptr_t data_ptr) {
+  const std::size_t size = nelement_ * num_channels * sizeof(float32);
+  Device::AllocParams alloc_params;
+  alloc_params.size = size;
+  alloc_params.host_read = true;
+  DeviceMemoryTracker::Scope scope("texture", "staging");
+  auto staging = device_->allocate_memory(alloc_params);
+
+  prog_->synchronize();
+  device_->image_transition(texture_alloc_, ImageLayout::shader_read,
+                            ImageLayout::transfer_src);
+  device_->image_to_buffer(staging.get_ptr(0), texture_alloc_,
+                           ImageLayout::transfer_src, copy_params());
+  device_->image_transition(texture_alloc_, ImageLayout::transfer_src,
+                            ImageLayout::shader_read);
+
+  std::memcpy(reinterpret_cast<void *>(data_ptr), device_->map(staging), size);
+  device_->unmap(staging);
+  device_->dealloc_memory(staging);
+}
+
+intptr_t Texture::get_device_allocation_ptr_as_int() const {
+  // Like ndarrays, the kernels are given the address of the DeviceAllocation.
+  return reinterpret_cast<intptr_t>(&texture_alloc_);
+}
+
+std::size_t Texture::get_nelement() const {
+  return nelement_;
+}
+
+}  // namespace lang
+}  // namespace taichi
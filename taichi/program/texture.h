@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "taichi/ir/type_utils.h"
+#include "taichi/backends/device.h"
+
+namespace taichi {
+namespace lang {
+
+class Program;
+
+/**
+ * An image on the graphics device, which kernels read through the texture
+ * units of the hardware, see TextureOpStmt.
+ *
+ * The texels are f32 and have 1, 2 or 4 channels. Between the copies from
+ * and to the host, the image stays in the layout read by the shaders.
+ * Textures are owned by the Program, see Program::create_texture().
+ */
+class Texture {
+ public:
+  explicit Texture(Program *prog,
+                   const DataType type,
+                   int num_channels,
+                   const std::vector<int> &shape);
+
+  DataType dtype;
+  int num_channels{1};
+  std::vector<int> shape;
+
+  // |data_ptr| points to the contiguous texels, with the channels innermost
+  // and the last axis of |shape| outermost.
+  void from_host(intptr_t data_ptr);
+  void to_host(intptr_t data_ptr);
+
+  intptr_t get_device_allocation_ptr_as_int() const;
+  std::size_t get_nelement() const;
+  ~Texture();
+
+ private:
+  BufferImageCopyParams copy_params() const;
+
+  Program *prog_{nullptr};
+  GraphicsDevice *device_{nullptr};
+  DeviceAllocation texture_alloc_{kDeviceNullAllocation};
+  std::size_t nelement_{1};
+};
+
+}  // namespace lang
+}  // namespace taichi
@@ -133,10 +133,12 @@ struct PyScene {
   void particles(FieldInfo vbo,
                  bool has_per_vertex_color,
                  py::tuple color_,
-                 float radius) {
+                 float radius,
+                 int max_drawn) {
     RenderableInfo renderable_info;
     renderable_info.vbo = vbo;
     renderable_info.has_per_vertex_color = has_per_vertex_color;
+    renderable_info.max_drawn_vertices = max_drawn;
 
     ParticlesInfo info;
     info.renderable_info = renderable_info;
@@ -215,10 +217,12 @@ struct PyCanvas {
   void circles(FieldInfo vbo,
                bool has_per_vertex_color,
                py::tuple color_,
-               float radius) {
+               float radius,
+               int max_drawn) {
     RenderableInfo renderable_info;
     renderable_info.vbo = vbo;
     renderable_info.has_per_vertex_color = has_per_vertex_color;
+    renderable_info.max_drawn_vertices = max_drawn;
 
     CirclesInfo info;
     info.renderable_info = renderable_info;
@@ -238,10 +242,11 @@ struct PyWindow {
            bool show_window,
            std::string package_path,
            Arch ti_arch,
-           bool is_packed_mode) {
-    AppConfig config = {name,    res[0].cast<int>(), res[1].cast<int>(),
-                        vsync,   show_window,        package_path,
-                        ti_arch, is_packed_mode};
+           bool is_packed_mode,
+           int frames_in_flight) {
+    AppConfig config = {name,           res[0].cast<int>(), res[1].cast<int>(),
+                        vsync,          show_window,        package_path,
+                        ti_arch,        is_packed_mode,     frames_in_flight};
     // todo: support other ggui backends
     window = std::make_unique<vulkan::Window>(config);
   }
@@ -250,6 +255,20 @@ struct PyWindow {
     window->write_image(filename);
   }
 
+  void start_video(const std::string &filename,
+                   int framerate,
+                   const std::string &encoder) {
+    window->start_video(filename, framerate, encoder);
+  }
+
+  void write_video_frame() {
+    window->write_video_frame();
+  }
+
+  void end_video() {
+    window->end_video();
+  }
+
   void show() {
     window->show();
   }
@@ -311,10 +330,13 @@ void export_ggui(py::module &m) {
 
   py::class_<PyWindow>(m, "PyWindow")
       .def(py::init<std::string, py::tuple, bool, bool, std::string, Arch,
-                    bool>())
+                    bool, int>())
       .def("get_canvas", &PyWindow::get_canvas)
       .def("show", &PyWindow::show)
       .def("write_image", &PyWindow::write_image)
+      .def("start_video", &PyWindow::start_video)
+      .def("write_video_frame", &PyWindow::write_video_frame)
+      .def("end_video", &PyWindow::end_video)
       .def("is_pressed", &PyWindow::is_pressed)
       .def("get_cursor_pos", &PyWindow::py_get_cursor_pos)
       .def("is_running", &PyWindow::is_running)
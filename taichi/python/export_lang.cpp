@@ -19,6 +19,7 @@
 #include "taichi/program/snode_rw_accessors_bank.h"
 #include "taichi/program/ndarray.h"
 #include "taichi/program/ndarray_rw_accessors_bank.h"
+#include "taichi/program/parallel_primitives.h"
 #include "taichi/common/interface.h"
 #include "taichi/python/export.h"
 #include "taichi/gui/gui.h"
@@ -30,11 +31,15 @@
 #include "taichi/program/sparse_matrix.h"
 #include "taichi/program/sparse_solver.h"
 #include "taichi/ir/mesh.h"
+#include "taichi/ir/pass_profiler.h"
+#include "taichi/program/mesh_patcher.h"
 
 #include "taichi/program/kernel_profiler.h"
 
 #if defined(TI_WITH_CUDA)
 #include "taichi/backends/cuda/cuda_context.h"
+#include "taichi/backends/cuda/cuda_graph.h"
+#include "taichi/backends/cuda/cuda_readback.h"
 #endif
 
 TI_NAMESPACE_BEGIN
@@ -71,6 +76,46 @@ NdarrayRwAccessorsBank::Accessors get_ndarray_rw_accessors(Ndarray *ndarray) {
   return get_current_program().get_ndarray_rw_accessors_bank().get(ndarray);
 }
 
+// The thread pool of the CPU backends, on which the sparse matrix operations
+// and the parallel primitives run.
+ThreadPool *get_cpu_thread_pool() {
+  auto &program = get_current_program();
+#ifdef TI_WITH_LLVM
+  if (arch_is_cpu(program.config.arch))
+    return program.get_llvm_program_impl()->get_thread_pool();
+#endif
+  return nullptr;
+}
+
+template <typename T>
+void export_sparse_matrix(py::module &m, const std::string &suffix) {
+  using Matrix = SparseMatrix<T>;
+  py::class_<Matrix>(m, ("SparseMatrix" + suffix).c_str())
+      .def("to_string", &Matrix::to_string)
+      .def(py::self + py::self, py::return_value_policy::reference_internal)
+      .def(py::self - py::self, py::return_value_policy::reference_internal)
+      .def(T() * py::self, py::return_value_policy::reference_internal)
+      .def(py::self * T(), py::return_value_policy::reference_internal)
+      .def(py::self * py::self, py::return_value_policy::reference_internal)
+      .def("matmul", &Matrix::matmul,
+           py::return_value_policy::reference_internal)
+      .def("mat_vec_mul", &Matrix::mat_vec_mul)
+      .def("transpose", &Matrix::transpose,
+           py::return_value_policy::reference_internal)
+      .def("get_element", &Matrix::get_element)
+      .def("set_element", &Matrix::set_element)
+      .def("num_rows", &Matrix::num_rows)
+      .def("num_cols", &Matrix::num_cols)
+      .def("pattern_hash", &Matrix::pattern_hash);
+
+  py::class_<SparseSolver<T>>(m, ("SparseSolver" + suffix).c_str())
+      .def("compute", &SparseSolver<T>::compute)
+      .def("analyze_pattern", &SparseSolver<T>::analyze_pattern)
+      .def("factorize", &SparseSolver<T>::factorize)
+      .def("solve", &SparseSolver<T>::solve)
+      .def("info", &SparseSolver<T>::info);
+}
+
 TLANG_NAMESPACE_END
 
 TI_NAMESPACE_BEGIN
@@ -85,6 +130,7 @@ void export_lang(py::module &m) {
       .export_values();
 
   m.def("arch_name", arch_name);
+  m.def("arch_uses_llvm", arch_uses_llvm);
   m.def("arch_from_name", arch_from_name);
 
   py::enum_<SNodeType>(m, "SNodeType", py::arithmetic())
@@ -138,6 +184,8 @@ void export_lang(py::module &m) {
       .def_readwrite("debug", &CompileConfig::debug)
       .def_readwrite("cfg_optimization", &CompileConfig::cfg_optimization)
       .def_readwrite("check_out_of_bound", &CompileConfig::check_out_of_bound)
+      .def_readwrite("check_out_of_bound_deferred",
+                     &CompileConfig::check_out_of_bound_deferred)
       .def_readwrite("print_accessor_ir", &CompileConfig::print_accessor_ir)
       .def_readwrite("print_evaluator_ir", &CompileConfig::print_evaluator_ir)
       .def_readwrite("use_llvm", &CompileConfig::use_llvm)
@@ -150,6 +198,14 @@ void export_lang(py::module &m) {
       .def_readwrite("print_kernel_llvm_ir_optimized",
                      &CompileConfig::print_kernel_llvm_ir_optimized)
       .def_readwrite("print_kernel_nvptx", &CompileConfig::print_kernel_nvptx)
+      .def_readwrite("offline_cache", &CompileConfig::offline_cache)
+      .def_readwrite("offline_cache_file_path",
+                     &CompileConfig::offline_cache_file_path)
+      .def_readwrite("offline_cache_max_size_MB",
+                     &CompileConfig::offline_cache_max_size_MB)
+      .def_readwrite("offline_cache_shared",
+                     &CompileConfig::offline_cache_shared)
+      .def_readwrite("soft_reset", &CompileConfig::soft_reset)
       .def_readwrite("simplify_before_lower_access",
                      &CompileConfig::simplify_before_lower_access)
       .def_readwrite("simplify_after_lower_access",
@@ -165,29 +221,93 @@ void export_lang(py::module &m) {
       .def_readwrite("saturating_grid_dim", &CompileConfig::saturating_grid_dim)
       .def_readwrite("max_block_dim", &CompileConfig::max_block_dim)
       .def_readwrite("cpu_max_num_threads", &CompileConfig::cpu_max_num_threads)
+      .def_readwrite("num_compile_threads", &CompileConfig::num_compile_threads)
+      .def_readwrite("cpu_numa_aware", &CompileConfig::cpu_numa_aware)
+      .def_readwrite("cpu_snode_tree_file_dir",
+                     &CompileConfig::cpu_snode_tree_file_dir)
+      .def_readwrite("cpu_huge_pages", &CompileConfig::cpu_huge_pages)
+      .def_readwrite("cpu_vectorize_range_for",
+                     &CompileConfig::cpu_vectorize_range_for)
+      .def_readwrite("simd_width", &CompileConfig::simd_width)
+      .def_readwrite("cpu_struct_for_tile_size",
+                     &CompileConfig::cpu_struct_for_tile_size)
+      .def_readwrite("auto_block_local", &CompileConfig::auto_block_local)
+      .def_readwrite("cpu_bls_max_size_bytes",
+                     &CompileConfig::cpu_bls_max_size_bytes)
+      .def_readwrite("deterministic_reduction",
+                     &CompileConfig::deterministic_reduction)
+      .def_readwrite("wasm_simd128", &CompileConfig::wasm_simd128)
+      .def_readwrite("wasm_threads", &CompileConfig::wasm_threads)
       .def_readwrite("random_seed", &CompileConfig::random_seed)
+      .def_readwrite("counter_based_rand", &CompileConfig::counter_based_rand)
       .def_readwrite("verbose_kernel_launches",
                      &CompileConfig::verbose_kernel_launches)
       .def_readwrite("verbose", &CompileConfig::verbose)
       .def_readwrite("demote_dense_struct_fors",
                      &CompileConfig::demote_dense_struct_fors)
+      .def_readwrite("fuse_listgen", &CompileConfig::fuse_listgen)
+      .def_readwrite("cache_element_lists",
+                     &CompileConfig::cache_element_lists)
+      .def_readwrite("compact_gc", &CompileConfig::compact_gc)
       .def_readwrite("kernel_profiler", &CompileConfig::kernel_profiler)
       .def_readwrite("timeline", &CompileConfig::timeline)
+      .def_readwrite("track_device_memory",
+                     &CompileConfig::track_device_memory)
+      .def_readwrite("profile_passes", &CompileConfig::profile_passes)
+      .def_readwrite("layout_advisor", &CompileConfig::layout_advisor)
+      .def_readwrite("access_pattern_report",
+                     &CompileConfig::access_pattern_report)
       .def_readwrite("default_fp", &CompileConfig::default_fp)
       .def_readwrite("default_ip", &CompileConfig::default_ip)
       .def_readwrite("device_memory_GB", &CompileConfig::device_memory_GB)
       .def_readwrite("device_memory_fraction",
                      &CompileConfig::device_memory_fraction)
+      .def_readwrite("cuda_num_devices", &CompileConfig::cuda_num_devices)
+      .def_readwrite("cuda_unified_memory",
+                     &CompileConfig::cuda_unified_memory)
+      .def_readwrite("cuda_warp_aggregated_atomics",
+                     &CompileConfig::cuda_warp_aggregated_atomics)
+      .def_readwrite("cuda_tune_block_dim", &CompileConfig::cuda_tune_block_dim)
+      .def_readwrite("cuda_print_buffer_MB",
+                     &CompileConfig::cuda_print_buffer_MB)
+      .def_readwrite("cpu_gpu_co_execution",
+                     &CompileConfig::cpu_gpu_co_execution)
+      .def_readwrite("cuda_dynamic_struct_for",
+                     &CompileConfig::cuda_dynamic_struct_for)
+      .def_readwrite("cuda_pack_small_tasks",
+                     &CompileConfig::cuda_pack_small_tasks)
+      .def_readwrite("cuda_fine_grained_host_sync",
+                     &CompileConfig::cuda_fine_grained_host_sync)
       .def_readwrite("fast_math", &CompileConfig::fast_math)
       .def_readwrite("advanced_optimization",
                      &CompileConfig::advanced_optimization)
       .def_readwrite("ad_stack_size", &CompileConfig::ad_stack_size)
+      .def_readwrite("ad_stack_max_size_in_registers",
+                     &CompileConfig::ad_stack_max_size_in_registers)
+      .def_readwrite("ad_checkpoint_interval",
+                     &CompileConfig::ad_checkpoint_interval)
+      .def_readwrite("ad_block_local_adjoint",
+                     &CompileConfig::ad_block_local_adjoint)
       .def_readwrite("async_mode", &CompileConfig::async_mode)
       .def_readwrite("dynamic_index", &CompileConfig::dynamic_index)
       .def_readwrite("flatten_if", &CompileConfig::flatten_if)
       .def_readwrite("make_thread_local", &CompileConfig::make_thread_local)
       .def_readwrite("make_block_local", &CompileConfig::make_block_local)
       .def_readwrite("detect_read_only", &CompileConfig::detect_read_only)
+      .def_readwrite("fuse_offloads", &CompileConfig::fuse_offloads)
+      .def_readwrite("hoist_uniform_values",
+                     &CompileConfig::hoist_uniform_values)
+      .def_readwrite("unroll_inner_loop_factor",
+                     &CompileConfig::unroll_inner_loop_factor)
+      .def_readwrite("kernel_specialization_launches",
+                     &CompileConfig::kernel_specialization_launches)
+      .def_readwrite("cpu_tiered_jit_launches",
+                     &CompileConfig::cpu_tiered_jit_launches)
+      .def_readwrite("cpu_struct_for_prefetch_distance",
+                     &CompileConfig::cpu_struct_for_prefetch_distance)
+      .def_readwrite("cpu_target", &CompileConfig::cpu_target)
+      .def_readwrite("cpu_features", &CompileConfig::cpu_features)
+      .def_readwrite("cpu_aot_variants", &CompileConfig::cpu_aot_variants)
       .def_readwrite("ndarray_use_torch", &CompileConfig::ndarray_use_torch)
       .def_readwrite("ndarray_use_cached_allocator",
                      &CompileConfig::ndarray_use_cached_allocator)
@@ -208,6 +328,11 @@ void export_lang(py::module &m) {
       .def_readwrite("async_flush_every", &CompileConfig::async_flush_every)
       .def_readwrite("async_max_fuse_per_task",
                      &CompileConfig::async_max_fuse_per_task)
+      .def_readwrite("async_cuda_num_streams",
+                     &CompileConfig::async_cuda_num_streams)
+      .def_readwrite("async_pipeline", &CompileConfig::async_pipeline)
+      .def_readwrite("async_memoize_schedules",
+                     &CompileConfig::async_memoize_schedules)
       .def_readwrite("quant_opt_store_fusion",
                      &CompileConfig::quant_opt_store_fusion)
       .def_readwrite("quant_opt_atomic_demotion",
@@ -226,7 +351,9 @@ void export_lang(py::module &m) {
       .def_readwrite("mesh_localize_all_attr_mappings",
                      &CompileConfig::mesh_localize_all_attr_mappings)
       .def_readwrite("demote_no_access_mesh_fors",
-                     &CompileConfig::demote_no_access_mesh_fors);
+                     &CompileConfig::demote_no_access_mesh_fors)
+      .def_readwrite("cpu_mesh_bls_max_size_bytes",
+                     &CompileConfig::cpu_mesh_bls_max_size_bytes);
 
   m.def("reset_default_compile_config",
         [&]() { default_compile_config = CompileConfig(); });
@@ -245,6 +372,8 @@ void export_lang(py::module &m) {
   py::class_<KernelProfileTracedRecord>(m, "KernelProfileTracedRecord")
       .def_readwrite("register_per_thread",
                      &KernelProfileTracedRecord::register_per_thread)
+      .def_readwrite("local_mem_per_thread",
+                     &KernelProfileTracedRecord::local_mem_per_thread)
       .def_readwrite("shared_mem_per_block",
                      &KernelProfileTracedRecord::shared_mem_per_block)
       .def_readwrite("grid_size", &KernelProfileTracedRecord::grid_size)
@@ -252,6 +381,12 @@ void export_lang(py::module &m) {
       .def_readwrite(
           "active_blocks_per_multiprocessor",
           &KernelProfileTracedRecord::active_blocks_per_multiprocessor)
+      .def_readwrite("occupancy", &KernelProfileTracedRecord::occupancy)
+      .def_readwrite("num_threads", &KernelProfileTracedRecord::num_threads)
+      .def_readwrite("imbalance_ratio",
+                     &KernelProfileTracedRecord::imbalance_ratio)
+      .def_readwrite("wakeup_latency_ms",
+                     &KernelProfileTracedRecord::wakeup_latency_ms)
       .def_readwrite("kernel_time",
                      &KernelProfileTracedRecord::kernel_elapsed_time_in_ms)
       .def_readwrite("base_time", &KernelProfileTracedRecord::time_since_base)
@@ -259,11 +394,44 @@ void export_lang(py::module &m) {
       .def_readwrite("metric_values",
                      &KernelProfileTracedRecord::metric_values);
 
+  py::class_<cuda::CachingAllocatorStats>(m, "CachingAllocatorStats")
+      .def_readonly("allocated_bytes",
+                    &cuda::CachingAllocatorStats::allocated_bytes)
+      .def_readonly("peak_allocated_bytes",
+                    &cuda::CachingAllocatorStats::peak_allocated_bytes)
+      .def_readonly("reserved_bytes",
+                    &cuda::CachingAllocatorStats::reserved_bytes)
+      .def_readonly("cached_bytes", &cuda::CachingAllocatorStats::cached_bytes)
+      .def_readonly("largest_cached_block_bytes",
+                    &cuda::CachingAllocatorStats::largest_cached_block_bytes)
+      .def_readonly("num_cache_hits",
+                    &cuda::CachingAllocatorStats::num_cache_hits)
+      .def_readonly("num_cache_misses",
+                    &cuda::CachingAllocatorStats::num_cache_misses)
+      .def_readonly("fragmentation",
+                    &cuda::CachingAllocatorStats::fragmentation);
+
+  py::class_<SNodeMemoryStats>(m, "SNodeMemoryStats")
+      .def_readonly("element_size", &SNodeMemoryStats::element_size)
+      .def_readonly("elements_per_chunk", &SNodeMemoryStats::elements_per_chunk)
+      .def_readonly("num_chunks", &SNodeMemoryStats::num_chunks)
+      .def_readonly("num_reserved", &SNodeMemoryStats::num_reserved)
+      .def_readonly("num_free", &SNodeMemoryStats::num_free)
+      .def_readonly("num_recycled", &SNodeMemoryStats::num_recycled)
+      .def_readonly("num_live", &SNodeMemoryStats::num_live)
+      .def_readonly("allocated_bytes", &SNodeMemoryStats::allocated_bytes)
+      .def_readonly("fragmentation", &SNodeMemoryStats::fragmentation);
+
   py::class_<Program>(m, "Program")
       .def(py::init<>())
+      .def("make_current", &Program::make_current)
       .def_readonly("config", &Program::config)
       .def("sync_kernel_profiler",
-           [](Program *program) { program->profiler->sync(); })
+           [](Program *program) {
+             // The GPU timed kernels are recorded once they are done.
+             program->synchronize();
+             program->profiler->sync();
+           })
       .def("query_kernel_profile_info",
            [](Program *program, const std::string &name) {
              return program->query_kernel_profile_info(name);
@@ -288,22 +456,162 @@ void export_lang(py::module &m) {
            [](Program *, const std::string &fn) {
              Timelines::get_instance().save(fn);
            })
+      .def("print_pass_profile_info",
+           [](Program *) { PassProfiler::get_instance().print(); })
+      .def("clear_pass_profile_info",
+           [](Program *) { PassProfiler::get_instance().clear(); })
+      .def("query_pass_profile_info",
+           [](Program *) {
+             auto &profiler = PassProfiler::get_instance();
+             auto to_dict = [](const auto &records) {
+               py::dict result;
+               for (const auto &[name, rec] : records) {
+                 py::dict d;
+                 d["count"] = rec.count;
+                 d["total_time"] = rec.total_time;
+                 d["max_time"] = rec.max_time;
+                 d["stmts_before"] = rec.stmts_before;
+                 d["stmts_after"] = rec.stmts_after;
+                 result[py::str(name)] = d;
+               }
+               return result;
+             };
+             py::dict result;
+             result["passes"] = to_dict(profiler.get_pass_records());
+             result["stages"] = to_dict(profiler.get_stage_records());
+             return result;
+           })
+      .def("get_layout_advice",
+           [](Program *program) {
+             TI_ERROR_IF(!program->layout_advisor,
+                         "Please set layout_advisor=True in ti.init()");
+             return program->layout_advisor->get_advice();
+           })
+      .def("get_stencil_footprint", &Program::get_stencil_footprint)
+      .def("write_back_snode_trees", &Program::write_back_snode_trees)
+      .def("get_huge_page_coverage", &Program::get_huge_page_coverage)
+      .def("print_layout_advice",
+           [](Program *program) {
+             TI_ERROR_IF(!program->layout_advisor,
+                         "Please set layout_advisor=True in ti.init()");
+             program->layout_advisor->print();
+           })
+      .def("get_access_pattern_report",
+           [](Program *program) {
+             TI_ERROR_IF(!program->access_pattern_report,
+                         "Please set access_pattern_report=True in ti.init()");
+             return program->access_pattern_report->get_report();
+           })
+      .def("print_access_pattern_report",
+           [](Program *program) {
+             TI_ERROR_IF(!program->access_pattern_report,
+                         "Please set access_pattern_report=True in ti.init()");
+             program->access_pattern_report->print();
+           })
       .def("print_memory_profiler_info", &Program::print_memory_profiler_info)
       .def("finalize", &Program::finalize)
       .def("get_total_compilation_time", &Program::get_total_compilation_time)
       .def("visualize_layout", &Program::visualize_layout)
       .def("get_snode_num_dynamically_allocated",
            &Program::get_snode_num_dynamically_allocated)
+      .def("get_snode_memory_stats", &Program::get_snode_memory_stats)
+      .def("get_caching_allocator_stats",
+           [](Program *program) -> cuda::CachingAllocatorStats {
+#ifdef TI_WITH_LLVM
+             if (arch_uses_llvm(program->config.arch)) {
+               return program->get_llvm_program_impl()
+                   ->get_caching_allocator_stats();
+             }
+#endif
+             return {};
+           })
+      .def("get_dense_field_layout",
+           [](Program *program, SNode *snode) {
+             TI_ERROR_IF(!arch_uses_llvm(program->config.arch),
+                         "Fields can't be viewed as arrays on {}",
+                         arch_name(program->config.arch));
+#ifdef TI_WITH_LLVM
+             auto layout =
+                 program->get_llvm_program_impl()->get_dense_field_layout(
+                     snode);
+             return py::make_tuple(layout.data_ptr, layout.shape,
+                                   layout.strides);
+#else
+             TI_NOT_IMPLEMENTED
+#endif
+           })
+      .def("get_field_handle_layout",
+           [](Program *program, SNode *snode) -> py::object {
+             // The layout of a place SNode taken by a ti.field_handle()
+             // argument, which the kernels are compiled for, and the address
+             // of its first element. None if its elements are not found by
+             // strides alone, or the kernels track their SNodes.
+#ifdef TI_WITH_LLVM
+             if (arch_uses_llvm(program->config.arch) &&
+                 !program->config.async_mode &&
+                 snode->dt->is<PrimitiveType>() &&
+                 LlvmProgramImpl::has_dense_field_layout(snode)) {
+               auto layout =
+                   program->get_llvm_program_impl()->get_dense_field_layout(
+                       snode);
+               const int size = data_type_size(snode->dt);
+               // Hashable, as the key of the kernel instances.
+               auto key = py::make_tuple(
+                   snode->get_snode_tree_id(), snode->dt->to_string(),
+                   py::tuple(py::cast(layout.shape)),
+                   py::tuple(py::cast(layout.strides)),
+                   py::tuple(py::cast(snode->index_offsets)),
+                   layout.data_ptr % size);
+               return py::make_tuple(key, layout.data_ptr, size);
+             }
+#endif
+             return py::none();
+           })
+      .def("fill_dense_fields", &Program::fill_dense_fields)
+      .def("copy_dense_field", &Program::copy_dense_field)
+      .def("discard_values", &Program::discard_values)
       .def("benchmark_rebuild_graph",
            [](Program *program) {
+             program->async_engine->wait_for_sfg_worker();
              program->async_engine->sfg->benchmark_rebuild_graph();
            })
       .def("synchronize", &Program::synchronize)
+      .def("synchronize_host_read", &Program::synchronize_host_read)
       .def("async_flush", &Program::async_flush)
+      .def("async_begin_batch", &Program::async_begin_batch)
+      .def("async_end_batch", &Program::async_end_batch)
       .def("materialize_runtime", &Program::materialize_runtime)
       .def("make_aot_module_builder", &Program::make_aot_module_builder)
       .def("get_snode_tree_size", &Program::get_snode_tree_size)
+      .def("get_snode_trees_fingerprint",
+           &Program::get_snode_trees_fingerprint)
+      .def(
+          "load_kernel",
+          [](Program *program, const py::bytes &data,
+             const std::string &name) {
+            std::string bytes = data;
+            return program->load_kernel(
+                std::vector<uint8>(bytes.begin(), bytes.end()), name);
+          },
+          py::return_value_policy::reference)
+      .def(
+          "save_checkpoint",
+          [](Program *program, const std::string &filename, bool compress,
+             int num_threads) {
+            CheckpointOptions options;
+            options.compress = compress;
+            options.num_threads = num_threads;
+            program->save_checkpoint(filename, options);
+          },
+          py::arg("filename"), py::arg("compress") = false,
+          py::arg("num_threads") = 0)
+      .def("load_checkpoint", &Program::load_checkpoint, py::arg("filename"),
+           py::arg("num_threads") = 0)
       .def("get_snode_root", &Program::get_snode_root,
+           py::return_value_policy::reference)
+      .def("get_snode_tree_write_version",
+           &Program::get_snode_tree_write_version)
+      .def("create_texture", &Program::create_texture,
            py::return_value_policy::reference);
 
   py::class_<AotModuleBuilder>(m, "AotModuleBuilder")
@@ -312,6 +620,26 @@ void export_lang(py::module &m) {
       .def("add_kernel_template", &AotModuleBuilder::add_kernel_template)
       .def("dump", &AotModuleBuilder::dump);
 
+#if defined(TI_WITH_CUDA)
+  py::class_<CUDAGraph>(m, "CudaGraph")
+      .def(py::init<>())
+      .def("begin_capture", &CUDAGraph::begin_capture)
+      .def("end_capture", &CUDAGraph::end_capture)
+      .def("begin_update", &CUDAGraph::begin_update)
+      .def("end_update", &CUDAGraph::end_update)
+      .def("launch", &CUDAGraph::launch)
+      .def("reset", &CUDAGraph::reset)
+      .def("is_recording", &CUDAGraph::is_recording)
+      .def("get_num_nodes", &CUDAGraph::get_num_nodes);
+
+  py::class_<CUDAReadback>(m, "CudaReadback")
+      .def(py::init<uint64, std::size_t>())
+      .def("is_ready", &CUDAReadback::is_ready)
+      .def("wait", &CUDAReadback::wait)
+      .def("copy_to", &CUDAReadback::copy_to)
+      .def("get_size", &CUDAReadback::get_size);
+#endif
+
   m.def("get_current_program", get_current_program,
         py::return_value_policy::reference);
 
@@ -337,9 +665,11 @@ void export_lang(py::module &m) {
           py::return_value_policy::reference)
       .def("hash",
            (SNode & (SNode::*)(const std::vector<Axis> &,
-                               const std::vector<int> &, bool))(&SNode::hash),
+                               const std::vector<int> &, int,
+                               bool))(&SNode::hash),
            py::return_value_policy::reference)
       .def("dynamic", &SNode::dynamic, py::return_value_policy::reference)
+      .def("morton", &SNode::morton, py::return_value_policy::reference)
       .def("bitmasked",
            (SNode & (SNode::*)(const std::vector<Axis> &,
                                const std::vector<int> &,
@@ -354,6 +684,7 @@ void export_lang(py::module &m) {
            })
       .def("data_type", [](SNode *snode) { return snode->dt; })
       .def("name", [](SNode *snode) { return snode->name; })
+      .def("get_snode_tree_id", &SNode::get_snode_tree_id)
       .def("get_num_ch",
            [](SNode *snode) -> int { return (int)snode->ch.size(); })
       .def(
@@ -378,6 +709,7 @@ void export_lang(py::module &m) {
              return get_snode_rw_accessors(snode).read_float(I);
            })
       .def("has_grad", &SNode::has_grad)
+      .def("has_dual", &SNode::has_dual)
       .def("is_primal", &SNode::is_primal)
       .def("is_place", &SNode::is_place)
       .def("get_expr",
@@ -414,6 +746,8 @@ void export_lang(py::module &m) {
 
   py::class_<Ndarray>(m, "Ndarray")
       .def(py::init<Program *, const DataType &, const std::vector<int> &>())
+      .def(py::init<Program *, const DataType &, const std::vector<int> &,
+                    intptr_t>())
       .def("data_ptr", &Ndarray::get_data_ptr_as_int)
       .def("device_allocation_ptr", &Ndarray::get_device_allocation_ptr_as_int)
       .def("element_size", &Ndarray::get_element_size)
@@ -441,28 +775,96 @@ void export_lang(py::module &m) {
       .def_readonly("dtype", &Ndarray::dtype)
       .def_readonly("shape", &Ndarray::shape);
 
+  py::class_<Texture>(m, "Texture")
+      .def("device_allocation_ptr", &Texture::get_device_allocation_ptr_as_int)
+      .def("nelement", &Texture::get_nelement)
+      .def("from_host", &Texture::from_host)
+      .def("to_host", &Texture::to_host)
+      .def_readonly("dtype", &Texture::dtype)
+      .def_readonly("num_channels", &Texture::num_channels)
+      .def_readonly("shape", &Texture::shape);
+
   py::class_<Kernel>(m, "Kernel")
       .def("get_ret_int", &Kernel::get_ret_int)
       .def("get_ret_float", &Kernel::get_ret_float)
       .def("make_launch_context", &Kernel::make_launch_context)
+      .def("lower_ast_and_serialize",
+           [](Kernel *kernel) -> std::optional<py::bytes> {
+             auto data = kernel->lower_ast_and_serialize();
+             if (!data) {
+               return std::nullopt;
+             }
+             return py::bytes(reinterpret_cast<const char *>(data->data()),
+                              data->size());
+           })
+      .def("make_bound_launcher",
+           [](Kernel *kernel, const std::vector<int> &scalar_arg_ids) {
+             return std::make_unique<Kernel::BoundLauncher>(kernel,
+                                                            scalar_arg_ids);
+           })
       .def("__call__",
            [](Kernel *kernel, Kernel::LaunchContextBuilder &launch_ctx) {
              py::gil_scoped_release release;
              kernel->operator()(launch_ctx);
            });
 
+  // All the scalar arguments in one call, see BoundKernelLauncher in
+  // kernel_impl.py.
+  auto set_scalars = [](Kernel::BoundLauncher *launcher,
+                        const py::tuple &scalars) {
+    TI_ASSERT(scalars.size() == launcher->num_scalars());
+    launcher->begin_launch();
+    for (int i = 0; i < launcher->num_scalars(); i++) {
+      if (launcher->scalar_is_real(i)) {
+        launcher->set_scalar_float(i, scalars[i].cast<float64>());
+      } else {
+        launcher->set_scalar_int(i, scalars[i].cast<int64>());
+      }
+    }
+  };
+  py::class_<Kernel::BoundLauncher>(m, "KernelBoundLauncher")
+      .def("set_arg_external_array",
+           &Kernel::BoundLauncher::set_arg_external_array)
+      .def("set_extra_arg_int", &Kernel::BoundLauncher::set_extra_arg_int)
+      .def("launch",
+           [set_scalars](Kernel::BoundLauncher *launcher,
+                         const py::tuple &scalars) {
+             set_scalars(launcher, scalars);
+             py::gil_scoped_release release;
+             launcher->launch();
+           })
+      .def("launch_async",
+           [set_scalars](Kernel::BoundLauncher *launcher,
+                         const py::tuple &scalars) {
+             set_scalars(launcher, scalars);
+             py::gil_scoped_release release;
+             return launcher->launch_async();
+           });
+
+  py::class_<Kernel::ReturnFuture>(m, "KernelReturnFuture")
+      .def("done", &Kernel::ReturnFuture::done)
+      .def("wait",
+           [](Kernel::ReturnFuture *future) {
+             py::gil_scoped_release release;
+             future->wait();
+           })
+      .def("get_int", &Kernel::ReturnFuture::get_int)
+      .def("get_float", &Kernel::ReturnFuture::get_float);
+
   py::class_<Kernel::LaunchContextBuilder>(m, "KernelLaunchContext")
       .def("set_arg_int", &Kernel::LaunchContextBuilder::set_arg_int)
       .def("set_arg_float", &Kernel::LaunchContextBuilder::set_arg_float)
       .def("set_arg_external_array",
            &Kernel::LaunchContextBuilder::set_arg_external_array)
+      .def("set_arg_texture", &Kernel::LaunchContextBuilder::set_arg_texture)
       .def("set_extra_arg_int",
            &Kernel::LaunchContextBuilder::set_extra_arg_int);
 
   py::class_<Function>(m, "Function")
       .def("set_function_body",
            py::overload_cast<const std::function<void()> &>(
-               &Function::set_function_body));
+               &Function::set_function_body))
+      .def("set_function_body_lazily", &Function::set_function_body_lazily);
 
   py::class_<Expr> expr(m, "Expr");
   expr.def("serialize", [](Expr *expr) { return expr->serialize(); })
@@ -487,6 +889,7 @@ void export_lang(py::module &m) {
              expr->cast<GlobalVariableExpression>()->is_primal = v;
            })
       .def("set_grad", &Expr::set_grad)
+      .def("set_dual", &Expr::set_dual)
       .def("set_attribute", &Expr::set_attribute)
       .def("get_ret_type", &Expr::get_ret_type)
       .def("type_check", &Expr::type_check)
@@ -558,8 +961,10 @@ void export_lang(py::module &m) {
   });
 
   m.def("insert_internal_func_call",
-        [&](const std::string &func_name, const ExprGroup &args) {
-          return Expr::make<InternalFuncCallExpression>(func_name, args.exprs);
+        [&](const std::string &func_name, const ExprGroup &args,
+            const ExprGroup &outputs) {
+          return Expr::make<InternalFuncCallExpression>(func_name, args.exprs,
+                                                        outputs.exprs);
         });
 
   m.def("begin_frontend_while", [&](const Expr &cond) {
@@ -782,7 +1187,8 @@ void export_lang(py::module &m) {
 
   m.def("make_id_expr", Expr::make<IdExpression, std::string>);
 
-  m.def("make_rand_expr", Expr::make<RandExpression, const DataType &>);
+  m.def("make_rand_expr", Expr::make<RandExpression, const DataType &, bool>,
+        py::arg("dt"), py::arg("counter_based") = false);
 
   m.def("make_const_expr_i32", Expr::make<ConstExpression, int32>);
   m.def("make_const_expr_i64", Expr::make<ConstExpression, int64>);
@@ -800,6 +1206,17 @@ void export_lang(py::module &m) {
         Expr::make<BinaryOpExpression, const BinaryOpType &, const Expr &,
                    const Expr &>);
 
+  py::enum_<TextureOpType>(m, "TextureOpType", py::arithmetic())
+      .value("sample_lod", TextureOpType::sample_lod)
+      .value("fetch_texel", TextureOpType::fetch_texel)
+      .export_values();
+  m.def("make_texture_op_expr",
+        [&](const TextureOpType &op, int arg_id, int num_dims,
+            const ExprGroup &args, int channel) {
+          return Expr::make<TextureOpExpression>(op, arg_id, num_dims,
+                                                 args.exprs, channel);
+        });
+
   auto &&unary = py::enum_<UnaryOpType>(m, "UnaryOpType", py::arithmetic());
   for (int t = 0; t <= (int)UnaryOpType::undefined; t++)
     unary.value(unary_op_type_name(UnaryOpType(t)).c_str(), UnaryOpType(t));
@@ -871,12 +1288,17 @@ void export_lang(py::module &m) {
                                                     mesh_idx, to_type);
   });
 
+  py::enum_<AutodiffMode>(m, "AutodiffMode", py::arithmetic())
+      .value("none", AutodiffMode::none)
+      .value("forward", AutodiffMode::forward)
+      .value("reverse", AutodiffMode::reverse);
+
   m.def(
       "create_kernel",
       [&](const std::function<void()> &body, const std::string &name,
-          bool grad) -> Kernel * {
+          AutodiffMode autodiff_mode) -> Kernel * {
         py::gil_scoped_release release;
-        return &get_current_program().kernel(body, name, grad);
+        return &get_current_program().kernel(body, name, autodiff_mode);
       },
       py::return_value_policy::reference);
   m.def("get_relation_access",
@@ -896,8 +1318,8 @@ void export_lang(py::module &m) {
   m.def(
       "create_kernel",
       [&](const std::function<void()> &body, const std::string &name,
-          bool grad) -> Kernel * {
-        return &get_current_program().kernel(body, name, grad);
+          AutodiffMode autodiff_mode) -> Kernel * {
+        return &get_current_program().kernel(body, name, autodiff_mode);
       },
       py::return_value_policy::reference);
 
@@ -924,11 +1346,20 @@ void export_lang(py::module &m) {
         dt, is_external_array);
   });
 
-  m.def("decl_arr_arg",
-        [&](const DataType &dt, int total_dim, std::vector<int> shape) {
-          return get_current_program().current_callable->insert_arr_arg(
-              dt, total_dim, shape);
-        });
+  m.def(
+      "decl_arr_arg",
+      [&](const DataType &dt, int total_dim, std::vector<int> shape,
+          bool is_strided) {
+        return get_current_program().current_callable->insert_arr_arg(
+            dt, total_dim, shape, is_strided);
+      },
+      py::arg("dt"), py::arg("total_dim"), py::arg("shape"),
+      py::arg("is_strided") = false);
+
+  m.def("decl_texture_arg", [&](int num_dims) {
+    return get_current_program().current_callable->insert_texture_arg(
+        num_dims);
+  });
 
   m.def("decl_ret", [&](const DataType &dt) {
     return get_current_program().current_callable->insert_ret(dt);
@@ -1083,14 +1514,18 @@ void export_lang(py::module &m) {
     }
   });
 
-  m.def("print_sfg",
-        []() { return get_current_program().async_engine->sfg->print(); });
+  m.def("print_sfg", []() {
+    auto *engine = get_current_program().async_engine.get();
+    engine->wait_for_sfg_worker();
+    return engine->sfg->print();
+  });
   m.def(
       "dump_dot",
       [](std::optional<std::string> rankdir, int embed_states_threshold) {
         // https://pybind11.readthedocs.io/en/stable/advanced/functions.html#allow-prohibiting-none-arguments
-        return get_current_program().async_engine->sfg->dump_dot(
-            rankdir, embed_states_threshold);
+        auto *engine = get_current_program().async_engine.get();
+        engine->wait_for_sfg_worker();
+        return engine->sfg->dump_dot(rankdir, embed_states_threshold);
       },
       py::arg("rankdir").none(true), py::arg("embed_states_threshold"));
 
@@ -1127,47 +1562,93 @@ void export_lang(py::module &m) {
 
   py::class_<SparseMatrixBuilder>(m, "SparseMatrixBuilder")
       .def("print_triplets", &SparseMatrixBuilder::print_triplets)
-      .def("build", &SparseMatrixBuilder::build)
-      .def("get_addr", [](SparseMatrixBuilder *mat) { return uint64(mat); });
+      .def("build",
+           [](SparseMatrixBuilder *builder) -> py::object {
+             if (builder->get_dtype()->is_primitive(PrimitiveTypeID::f64))
+               return py::cast(builder->build<float64>());
+             return py::cast(builder->build<float32>());
+           })
+      .def("rebuild", &SparseMatrixBuilder::rebuild<float32>)
+      .def("rebuild", &SparseMatrixBuilder::rebuild<float64>)
+      .def("build_cuda", &SparseMatrixBuilder::build_cuda)
+      .def("get_addr", &SparseMatrixBuilder::get_addr);
 
   m.def("create_sparse_matrix_builder",
-        [](int n, int m, uint64 max_num_entries) {
+        [](int n, int m, uint64 max_num_entries, DataType dtype) {
+          auto arch = get_current_program().config.arch;
+          TI_ERROR_IF(!arch_is_cpu(arch) && arch != Arch::cuda,
+                      "SparseMatrix only supports CPU and CUDA for now.");
+          return std::make_unique<SparseMatrixBuilder>(
+              n, m, max_num_entries, dtype, arch,
+              get_cpu_thread_pool());
+        });
+
+  export_sparse_matrix<float32>(m, "f32");
+  export_sparse_matrix<float64>(m, "f64");
+
+  m.def("create_sparse_matrix",
+        [](int n, int m, DataType dtype) -> py::object {
           TI_ERROR_IF(!arch_is_cpu(get_current_program().config.arch),
                       "SparseMatrix only supports CPU for now.");
-          return SparseMatrixBuilder(n, m, max_num_entries);
+          if (dtype->is_primitive(PrimitiveTypeID::f64))
+            return py::cast(
+                SparseMatrix<float64>(n, m, get_cpu_thread_pool()));
+          TI_ERROR_IF(!dtype->is_primitive(PrimitiveTypeID::f32),
+                      "SparseMatrix only supports f32 and f64.");
+          return py::cast(
+              SparseMatrix<float32>(n, m, get_cpu_thread_pool()));
         });
 
-  py::class_<SparseMatrix>(m, "SparseMatrix")
-      .def("to_string", &SparseMatrix::to_string)
-      .def(py::self + py::self, py::return_value_policy::reference_internal)
-      .def(py::self - py::self, py::return_value_policy::reference_internal)
-      .def(float() * py::self, py::return_value_policy::reference_internal)
-      .def(py::self * float(), py::return_value_policy::reference_internal)
-      .def(py::self * py::self, py::return_value_policy::reference_internal)
-      .def("matmul", &SparseMatrix::matmul,
-           py::return_value_policy::reference_internal)
-      .def("mat_vec_mul", &SparseMatrix::mat_vec_mul)
-      .def("transpose", &SparseMatrix::transpose,
-           py::return_value_policy::reference_internal)
-      .def("get_element", &SparseMatrix::get_element)
-      .def("set_element", &SparseMatrix::set_element)
-      .def("num_rows", &SparseMatrix::num_rows)
-      .def("num_cols", &SparseMatrix::num_cols);
-
-  m.def("create_sparse_matrix", [](int n, int m) {
-    TI_ERROR_IF(!arch_is_cpu(get_current_program().config.arch),
-                "SparseMatrix only supports CPU for now.");
-    return SparseMatrix(n, m);
-  });
-
-  py::class_<SparseSolver>(m, "SparseSolver")
-      .def("compute", &SparseSolver::compute)
-      .def("analyze_pattern", &SparseSolver::analyze_pattern)
-      .def("factorize", &SparseSolver::factorize)
-      .def("solve", &SparseSolver::solve)
-      .def("info", &SparseSolver::info);
+  py::class_<CuSparseMatrix>(m, "CuSparseMatrix")
+      .def("to_string", &CuSparseMatrix::to_string)
+      .def("mat_vec_mul", &CuSparseMatrix::mat_vec_mul)
+      .def("num_rows", &CuSparseMatrix::num_rows)
+      .def("num_cols", &CuSparseMatrix::num_cols);
+
+  m.def("make_sparse_solver",
+        [](DataType dtype, const std::string &solver_type,
+           const std::string &ordering) -> py::object {
+          if (dtype->is_primitive(PrimitiveTypeID::f64))
+            return py::cast(make_sparse_solver<float64>(
+                solver_type, ordering, get_cpu_thread_pool()));
+          TI_ERROR_IF(!dtype->is_primitive(PrimitiveTypeID::f32),
+                      "SparseSolver only supports f32 and f64.");
+          return py::cast(make_sparse_solver<float32>(solver_type, ordering,
+                                                      get_cpu_thread_pool()));
+        });
 
-  m.def("make_sparse_solver", &make_sparse_solver);
+  // The solver keeps a pointer to the matrix it is computed with.
+  py::class_<CuSparseSolver>(m, "CuSparseSolver")
+      .def(py::init<int, float32>(), py::arg("max_iterations") = 0,
+           py::arg("tolerance") = 1e-6f)
+      .def("compute", &CuSparseSolver::compute, py::keep_alive<1, 2>())
+      .def("analyze_pattern", &CuSparseSolver::analyze_pattern)
+      .def("factorize", &CuSparseSolver::factorize, py::keep_alive<1, 2>())
+      .def("solve", &CuSparseSolver::solve)
+      .def("info", &CuSparseSolver::info);
+
+  // The host arrays of ti.algorithms on the CPU backends.
+  m.def("parallel_exclusive_scan",
+        [](uint64 data, DataType dt, int64 n) -> py::object {
+          auto total =
+              exclusive_scan(get_cpu_thread_pool(), (void *)data, dt, n);
+          if (is_real(dt))
+            return py::cast(total.val_cast_to_float64());
+          if (is_signed(dt))
+            return py::cast(total.val_int());
+          return py::cast(total.val_uint());
+        });
+  m.def("parallel_radix_sort", [](uint64 keys, DataType keys_type,
+                                  uint64 values, DataType values_type,
+                                  int64 n) {
+    radix_sort(get_cpu_thread_pool(), (void *)keys, keys_type, (void *)values,
+               values_type, n);
+  });
+  m.def("parallel_compact",
+        [](uint64 data, DataType dt, uint64 flags, uint64 out, int64 n) {
+          return compact(get_cpu_thread_pool(), (const void *)data, dt,
+                         (const int32 *)flags, (void *)out, n);
+        });
 
   // Mesh Class
   // Mesh related.
@@ -1276,6 +1757,76 @@ void export_lang(py::module &m) {
           mesh_ptr.ptr->relations.insert(
               std::pair(type, mesh::MeshLocalRelation(value, offset)));
         });
+
+  auto to_numpy = [](const auto &vec) {
+    using T = typename std::decay_t<decltype(vec)>::value_type;
+    return py::array_t<T>(vec.size(), vec.data());
+  };
+  py::class_<mesh::PatchedMesh>(m, "PatchedMesh")
+      .def_readonly("topology", &mesh::PatchedMesh::topology)
+      .def_readonly("num_patches", &mesh::PatchedMesh::num_patches)
+      .def("set_x",
+           [](mesh::PatchedMesh &patched,
+              py::array_t<float32, py::array::c_style | py::array::forcecast>
+                  x) {
+             patched.x.assign(x.data(), x.data() + x.size());
+           })
+      .def("save", &mesh::PatchedMesh::save)
+      .def_static("load", &mesh::PatchedMesh::load)
+      // The metadata in the layout of the JSON files, with numpy arrays.
+      .def("as_dict", [to_numpy](const mesh::PatchedMesh &patched) {
+        py::dict data;
+        data["num_patches"] = patched.num_patches;
+        py::list elements;
+        for (const auto &[type, element] : patched.elements) {
+          py::dict e;
+          e["order"] = mesh::element_order(type);
+          e["num"] = element.num;
+          e["max_num_per_patch"] = element.max_num_per_patch;
+          e["owned_offsets"] = to_numpy(element.owned_offsets);
+          e["total_offsets"] = to_numpy(element.total_offsets);
+          e["l2g_mapping"] = to_numpy(element.l2g);
+          e["l2r_mapping"] = to_numpy(element.l2r);
+          e["g2r_mapping"] = to_numpy(element.g2r);
+          elements.append(e);
+        }
+        data["elements"] = elements;
+        py::list relations;
+        for (const auto &[type, relation] : patched.relations) {
+          int from_order = mesh::from_end_element_order(type);
+          int to_order = mesh::to_end_element_order(type);
+          py::dict r;
+          r["from_order"] = from_order;
+          r["to_order"] = to_order;
+          r["value"] = to_numpy(relation.value);
+          if (from_order <= to_order) {
+            r["offset"] = to_numpy(relation.offset);
+          }
+          relations.append(r);
+        }
+        data["relations"] = relations;
+        py::dict attrs;
+        attrs["x"] = to_numpy(patched.x);
+        data["attrs"] = attrs;
+        return data;
+      });
+
+  m.def("patch_mesh",
+        [](mesh::MeshTopology topology, int num_verts,
+           py::array_t<int, py::array::c_style | py::array::forcecast> cells,
+           const std::vector<mesh::MeshRelationType> &relations,
+           int max_elements_per_patch, int num_threads,
+           py::array_t<float32, py::array::c_style | py::array::forcecast>
+               sfc_x) {
+          std::vector<int> cell_indices(cells.data(),
+                                        cells.data() + cells.size());
+          std::vector<float32> positions(sfc_x.data(),
+                                         sfc_x.data() + sfc_x.size());
+          py::gil_scoped_release release;
+          return mesh::patch_mesh(topology, num_verts, cell_indices, relations,
+                                  max_elements_per_patch, num_threads,
+                                  positions);
+        });
 }
 
 TI_NAMESPACE_END
@@ -19,6 +19,8 @@
 #include "taichi/system/dynamic_loader.h"
 #include "taichi/system/hacked_signal_handler.h"
 #include "taichi/system/profiler.h"
+#include "taichi/system/device_memory_tracker.h"
+#include "taichi/util/metrics.h"
 #include "taichi/util/statistics.h"
 #if defined(TI_WITH_CUDA)
 #include "taichi/backends/cuda/cuda_driver.h"
@@ -158,6 +160,41 @@ void export_misc(py::module &m) {
   m.def(
       "get_kernel_stats", []() -> Statistics & { return stat; },
       py::return_value_policy::reference);
+  m.def("get_metrics", []() { return metrics().get_values(); });
+  m.def("export_metrics", []() { return metrics().to_openmetrics(); });
+  m.def("reset_metrics", []() { metrics().reset(); });
+
+  m.def("device_memory_tracker_enabled", []() {
+    return DeviceMemoryTracker::get_instance().get_enabled();
+  });
+  m.def("push_device_memory_callsite", [](const std::string &callsite) {
+    DeviceMemoryTracker::push_tag({"", "", callsite});
+  });
+  m.def("pop_device_memory_callsite",
+        []() { DeviceMemoryTracker::pop_tag(); });
+  m.def("get_device_memory_breakdown", []() {
+    auto &tracker = DeviceMemoryTracker::get_instance();
+    py::list allocations;
+    for (auto &usage : tracker.get_breakdown()) {
+      py::dict d;
+      d["subsystem"] = usage.tag.subsystem;
+      d["name"] = usage.tag.name;
+      d["callsite"] = usage.tag.callsite;
+      d["nested"] = usage.nested;
+      d["bytes"] = usage.bytes;
+      d["count"] = usage.count;
+      allocations.append(d);
+    }
+    py::dict result;
+    result["current_bytes"] = tracker.get_current_bytes();
+    result["peak_bytes"] = tracker.get_peak_bytes();
+    result["allocations"] = allocations;
+    return result;
+  });
+  m.def("get_device_memory_report",
+        []() { return DeviceMemoryTracker::get_instance().get_report(); });
+  m.def("reset_device_memory_peak",
+        []() { DeviceMemoryTracker::get_instance().reset_peak(); });
 
   py::class_<HackedSignalRegister>(m, "HackedSignalRegister").def(py::init<>());
 }
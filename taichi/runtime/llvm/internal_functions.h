@@ -24,19 +24,54 @@ i32 insert_triplet(RuntimeContext *context,
                    int64 base_ptr_,
                    int i,
                    int j,
-                   float value) {
+                   float64 value) {
   auto base_ptr = (int64 *)base_ptr_;
 
+  // See SparseMatrixBuilder for the layout.
   int64 *num_triplets = base_ptr;
   auto data_base_ptr = *(int32 **)(base_ptr + 1);
+  auto max_num_triplets = base_ptr[2];
+  auto value_size = base_ptr[3];
 
   auto triplet_id = atomic_add_i64(num_triplets, 1);
-  data_base_ptr[triplet_id * 3] = i;
-  data_base_ptr[triplet_id * 3 + 1] = j;
-  data_base_ptr[triplet_id * 3 + 2] = taichi_union_cast<int32>(value);
+  data_base_ptr[triplet_id] = i;
+  data_base_ptr[max_num_triplets + triplet_id] = j;
+  auto values = data_base_ptr + 2 * max_num_triplets;
+  if (value_size == sizeof(float64)) {
+    ((float64 *)values)[triplet_id] = value;
+  } else {
+    ((float32 *)values)[triplet_id] = (float32)value;
+  }
   return 0;
 }
 
+// The outputs are U, V (both row-major) and the singular values of A.
+#define DEFINE_SVD3X3(T)                                                    \
+  i32 svd3x3_##T(RuntimeContext *context, T a00, T a01, T a02, T a10,       \
+                 T a11, T a12, T a20, T a21, T a22, i32 iters, T *u00,      \
+                 T *u01, T *u02, T *u10, T *u11, T *u12, T *u20, T *u21,    \
+                 T *u22, T *v00, T *v01, T *v02, T *v10, T *v11, T *v12,    \
+                 T *v20, T *v21, T *v22, T *sigma0, T *sigma1, T *sigma2) { \
+    const T a[9] = {a00, a01, a02, a10, a11, a12, a20, a21, a22};          \
+    T u[9], v[9], sigma[3];                                                 \
+    Svd3x3<T>::svd(a, iters, u, v, sigma);                                  \
+    T *u_out[9] = {u00, u01, u02, u10, u11, u12, u20, u21, u22};            \
+    T *v_out[9] = {v00, v01, v02, v10, v11, v12, v20, v21, v22};            \
+    for (int i = 0; i < 9; i++) {                                           \
+      *u_out[i] = u[i];                                                     \
+      *v_out[i] = v[i];                                                     \
+    }                                                                       \
+    *sigma0 = sigma[0];                                                     \
+    *sigma1 = sigma[1];                                                     \
+    *sigma2 = sigma[2];                                                     \
+    return 0;                                                               \
+  }
+
+DEFINE_SVD3X3(f32)
+DEFINE_SVD3X3(f64)
+
+#undef DEFINE_SVD3X3
+
 i32 test_internal_func_args(RuntimeContext *context,
                             float32 i,
                             float32 j,
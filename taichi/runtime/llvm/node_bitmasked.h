@@ -17,7 +17,10 @@ void Bitmasked_activate(Ptr meta, Ptr node, int i) {
   auto num_elements = Bitmasked_get_num_elements(meta, node);
   auto data_section_size = element_size * num_elements;
   auto mask_begin = (u32 *)(node + data_section_size);
-  atomic_or_u32(&mask_begin[i / 32], 1UL << (i % 32));
+  const u32 bit = 1UL << (i % 32);
+  if ((atomic_or_u32(&mask_begin[i / 32], bit) & bit) == 0) {
+    mark_topology_changed(smeta);
+  }
 }
 
 void Bitmasked_deactivate(Ptr meta, Ptr node, int i) {
@@ -26,7 +29,10 @@ void Bitmasked_deactivate(Ptr meta, Ptr node, int i) {
   auto num_elements = Bitmasked_get_num_elements(meta, node);
   auto data_section_size = element_size * num_elements;
   auto mask_begin = (u32 *)(node + data_section_size);
-  atomic_and_u32(&mask_begin[i / 32], ~(1UL << (i % 32)));
+  const u32 bit = 1UL << (i % 32);
+  if (atomic_and_u32(&mask_begin[i / 32], ~bit) & bit) {
+    mark_topology_changed(smeta);
+  }
 }
 
 i32 Bitmasked_is_active(Ptr meta, Ptr node, int i) {
@@ -41,3 +47,27 @@ i32 Bitmasked_is_active(Ptr meta, Ptr node, int i) {
 Ptr Bitmasked_lookup_element(Ptr meta, Ptr node, int i) {
   return node + ((StructMeta *)meta)->element_size * i;
 }
+
+i32 Bitmasked_get_cell_index(Ptr meta, Ptr node, int i) {
+  return i;
+}
+
+// Skips the inactive cells a mask word at a time.
+i32 Bitmasked_next_active(Ptr meta, Ptr node, int i, int end) {
+  auto smeta = (StructMeta *)meta;
+  auto element_size = StructMeta_get_element_size(smeta);
+  auto num_elements = Bitmasked_get_num_elements(meta, node);
+  auto data_section_size = element_size * num_elements;
+  auto mask_begin = (u32 *)(node + data_section_size);
+  while (i < end) {
+    // The bits of cell |i| and of the cells after it in the same word.
+    const u32 word = mask_begin[i / 32] >> (i % 32);
+    if (word != 0) {
+      // Unlike cttz_i32, which is only patched on GPUs, this is lowered to
+      // llvm.cttz on every backend.
+      return min_i32(i + __builtin_ctz(word), end);
+    }
+    i = (i / 32 + 1) * 32;
+  }
+  return end;
+}
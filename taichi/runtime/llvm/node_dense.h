@@ -22,3 +22,11 @@ i32 Dense_is_active(Ptr meta, Ptr node, int i) {
 Ptr Dense_lookup_element(Ptr meta, Ptr node, int i) {
   return node + ((StructMeta *)meta)->element_size * i;
 }
+
+i32 Dense_get_cell_index(Ptr meta, Ptr node, int i) {
+  return i;
+}
+
+i32 Dense_next_active(Ptr meta, Ptr node, int i, int end) {
+  return i;
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+// Each chunk begins with a pointer to the next one, followed by |chunk_size|
+// elements. With a chunk table, the pointers to all the chunks are instead
+// kept in the node, starting at |ptr|, so that any element is found in O(1).
 struct DynamicNode {
   i32 lock;
   i32 n;
@@ -9,21 +12,19 @@ struct DynamicNode {
 // Specialized Attributes and functions
 struct DynamicMeta : public StructMeta {
   int chunk_size;
+  i32 chunk_table;
 };
 
 STRUCT_FIELD(DynamicMeta, chunk_size);
+STRUCT_FIELD(DynamicMeta, chunk_table);
 
-void Dynamic_activate(Ptr meta_, Ptr node_, int i) {
-  auto meta = (DynamicMeta *)(meta_);
-  auto node = (DynamicNode *)(node_);
-  // We need to not only update node->n, but also make sure the chunk containing
-  // element i is allocated.
-  atomic_max_i32(&node->n, i + 1);
-  int chunk_start = 0;
-  auto p_chunk_ptr = &node->ptr;
+// Returns the chunk holding element |i|. The chunks up to it are allocated if
+// |allocate| is true, otherwise they must exist.
+Ptr Dynamic_get_chunk(DynamicMeta *meta, DynamicNode *node, int i,
+                      bool allocate) {
   auto chunk_size = meta->chunk_size;
-  while (true) {
-    if (*p_chunk_ptr == nullptr) {
+  auto allocate_chunk = [&](Ptr *p_chunk_ptr) {
+    if (allocate && *p_chunk_ptr == nullptr) {
       locked_task(Ptr(&node->lock), [&] {
         if (*p_chunk_ptr == nullptr) {
           auto rt = meta->context->runtime;
@@ -32,23 +33,58 @@ void Dynamic_activate(Ptr meta_, Ptr node_, int i) {
         }
       });
     }
+  };
+  if (meta->chunk_table) {
+    auto p_chunk_ptr = &node->ptr + i / chunk_size;
+    allocate_chunk(p_chunk_ptr);
+    return *p_chunk_ptr;
+  }
+  int chunk_start = 0;
+  auto p_chunk_ptr = &node->ptr;
+  while (true) {
+    allocate_chunk(p_chunk_ptr);
     if (i < chunk_start + chunk_size) {
-      return;
+      return *p_chunk_ptr;
     }
     p_chunk_ptr = (Ptr *)*p_chunk_ptr;
     chunk_start += chunk_size;
   }
 }
 
+Ptr Dynamic_get_element_in_chunk(DynamicMeta *meta, Ptr chunk, int i) {
+  return chunk + sizeof(Ptr) + (i % meta->chunk_size) * meta->element_size;
+}
+
+void Dynamic_activate(Ptr meta_, Ptr node_, int i) {
+  auto meta = (DynamicMeta *)(meta_);
+  auto node = (DynamicNode *)(node_);
+  // We need to not only update node->n, but also make sure the chunk containing
+  // element i is allocated.
+  atomic_max_i32(&node->n, i + 1);
+  Dynamic_get_chunk(meta, node, i, true);
+}
+
 void Dynamic_deactivate(Ptr meta_, Ptr node_) {
   auto meta = (DynamicMeta *)(meta_);
   auto node = (DynamicNode *)(node_);
   if (node->n > 0) {
     locked_task(Ptr(&node->lock), [&] {
       node->n = 0;
-      auto p_chunk_ptr = &node->ptr;
       auto rt = meta->context->runtime;
       auto alloc = rt->node_allocators[meta->snode_id];
+      if (meta->chunk_table) {
+        auto num_chunks =
+            (meta->max_num_elements + meta->chunk_size - 1) / meta->chunk_size;
+        for (int i = 0; i < num_chunks; i++) {
+          auto p_chunk_ptr = &node->ptr + i;
+          if (*p_chunk_ptr) {
+            alloc->recycle(*p_chunk_ptr);
+            *p_chunk_ptr = nullptr;
+          }
+        }
+        return;
+      }
+      auto p_chunk_ptr = &node->ptr;
       while (*p_chunk_ptr) {
         alloc->recycle(*p_chunk_ptr);
         p_chunk_ptr = (Ptr *)*p_chunk_ptr;
@@ -61,28 +97,9 @@ void Dynamic_deactivate(Ptr meta_, Ptr node_) {
 i32 Dynamic_append(Ptr meta_, Ptr node_, i32 data) {
   auto meta = (DynamicMeta *)(meta_);
   auto node = (DynamicNode *)(node_);
-  auto chunk_size = meta->chunk_size;
   auto i = atomic_add_i32(&node->n, 1);
-  int chunk_start = 0;
-  auto p_chunk_ptr = &node->ptr;
-  while (true) {
-    if (*p_chunk_ptr == nullptr) {
-      locked_task(Ptr(&node->lock), [&] {
-        if (*p_chunk_ptr == nullptr) {
-          auto rt = meta->context->runtime;
-          auto alloc = rt->node_allocators[meta->snode_id];
-          *p_chunk_ptr = alloc->allocate();
-        }
-      });
-    }
-    if (i < chunk_start + chunk_size) {
-      *(i32 *)(*p_chunk_ptr + sizeof(Ptr) +
-               (i - chunk_start) * meta->element_size) = data;
-      break;
-    }
-    p_chunk_ptr = (Ptr *)(*p_chunk_ptr);
-    chunk_start += chunk_size;
-  }
+  auto chunk = Dynamic_get_chunk(meta, node, i, true);
+  *(i32 *)Dynamic_get_element_in_chunk(meta, chunk, i) = data;
   return i;
 }
 
@@ -95,18 +112,8 @@ Ptr Dynamic_lookup_element(Ptr meta_, Ptr node_, int i) {
   auto meta = (DynamicMeta *)(meta_);
   auto node = (DynamicNode *)(node_);
   if (Dynamic_is_active(meta_, node_, i)) {
-    int chunk_start = 0;
-    auto chunk_ptr = node->ptr;
-    auto chunk_size = meta->chunk_size;
-    while (true) {
-      if (i < chunk_start + chunk_size) {
-        auto addr =
-            chunk_ptr + sizeof(Ptr) + (i - chunk_start) * meta->element_size;
-        return addr;
-      }
-      chunk_ptr = *(Ptr *)chunk_ptr;
-      chunk_start += chunk_size;
-    }
+    auto chunk = Dynamic_get_chunk(meta, node, i, false);
+    return Dynamic_get_element_in_chunk(meta, chunk, i);
   } else {
     return (meta->context->runtime)->ambient_elements[meta->snode_id];
   }
@@ -116,3 +123,12 @@ i32 Dynamic_get_num_elements(Ptr meta_, Ptr node_) {
   auto node = (DynamicNode *)(node_);
   return node->n;
 }
+
+i32 Dynamic_get_cell_index(Ptr meta, Ptr node, int i) {
+  return i;
+}
+
+i32 Dynamic_next_active(Ptr meta, Ptr node_, int i, int end) {
+  auto node = (DynamicNode *)(node_);
+  return i < node->n ? i : end;
+}
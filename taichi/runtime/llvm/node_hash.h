@@ -0,0 +1,177 @@
+#pragma once
+
+// A hash node is an open-addressing hash table with linear probing, which maps
+// the active cells of a potentially huge index space to their children. Its
+// size is proportional to its capacity rather than to its number of cells.
+//
+// Layout: u64 keys[capacity], Ptr children[capacity]
+//
+// A key is the index of the cell plus one, so that zero marks an empty slot.
+// Keys are inserted with a CAS and never removed: a deactivated cell keeps its
+// slot with a null child, which keeps the probing sequences intact and is
+// reused when the cell is activated again.
+//
+// The listgen visits the slots rather than the cells, so |lookup_element|,
+// |is_active| and |get_num_elements| in the StructMeta of a hash node work
+// on slots. The codegen calls the functions below with cell indices.
+
+// Specialized Attributes and functions
+struct HashMeta : public StructMeta {
+  i32 capacity;
+};
+
+STRUCT_FIELD(HashMeta, capacity);
+
+i32 Hash_get_num_elements(Ptr meta, Ptr node) {
+  return ((HashMeta *)meta)->capacity;
+}
+
+volatile u64 *Hash_get_keys(Ptr node) {
+  return (volatile u64 *)node;
+}
+
+volatile Ptr *Hash_get_children(Ptr meta, Ptr node) {
+  return (volatile Ptr *)(node + 8 * ((HashMeta *)meta)->capacity);
+}
+
+i32 Hash_get_initial_slot(i32 capacity, int i) {
+  // Multiplicative hashing, which spreads out the neighbouring cells.
+  return (i32)(((u32)i * 2654435761u) % (u32)capacity);
+}
+
+// Returns the slot of cell |i|, or -1 if the cell has never been activated.
+i32 Hash_find_slot(Ptr meta, Ptr node, int i) {
+  auto capacity = ((HashMeta *)meta)->capacity;
+  auto keys = Hash_get_keys(node);
+  const u64 key = (u64)i + 1;
+  i32 slot = Hash_get_initial_slot(capacity, i);
+  for (int probe = 0; probe < capacity; probe++) {
+    const u64 k = keys[slot];
+    if (k == key) {
+      return slot;
+    }
+    if (k == 0) {
+      return -1;
+    }
+    slot = slot + 1 == capacity ? 0 : slot + 1;
+  }
+  return -1;
+}
+
+// Returns the slot of cell |i|, inserting the cell if needed.
+i32 Hash_insert_slot(Ptr meta, Ptr node, int i) {
+  auto capacity = ((HashMeta *)meta)->capacity;
+  auto keys = Hash_get_keys(node);
+  const u64 key = (u64)i + 1;
+  i32 slot = Hash_get_initial_slot(capacity, i);
+  for (int probe = 0; probe < capacity; probe++) {
+    u64 k = keys[slot];
+    if (k == 0) {
+      // |k| is updated to the key inserted by another thread on failure.
+      __atomic_compare_exchange_n(&keys[slot], &k, key, false,
+                                  std::memory_order::memory_order_seq_cst,
+                                  std::memory_order::memory_order_seq_cst);
+      if (k == 0) {
+        return slot;
+      }
+    }
+    if (k == key) {
+      return slot;
+    }
+    slot = slot + 1 == capacity ? 0 : slot + 1;
+  }
+  taichi_assert_runtime(((StructMeta *)meta)->context->runtime, false,
+                        "Hash SNode is full.");
+  return -1;
+}
+
+void Hash_activate(Ptr meta_, Ptr node, int i) {
+  auto meta = (StructMeta *)meta_;
+  auto slot = Hash_insert_slot(meta_, node, i);
+  if (slot < 0) {
+    return;
+  }
+  volatile Ptr *child = Hash_get_children(meta_, node) + slot;
+  if (*child == nullptr) {
+    // The cuda_ calls will return 0 or do noop on CPUs
+    u32 mask = cuda_active_mask();
+    if (is_representative(mask, (u64)child)) {
+      auto rt = meta->context->runtime;
+      auto alloc = rt->node_allocators[meta->snode_id];
+      auto allocated = alloc->allocate();
+      u64 expected = 0;
+      if (!__atomic_compare_exchange_n(
+              (volatile u64 *)child, &expected, (u64)allocated, false,
+              std::memory_order::memory_order_seq_cst,
+              std::memory_order::memory_order_seq_cst)) {
+        // Another warp has activated the cell in the meantime.
+        alloc->recycle(allocated);
+      } else {
+        mark_topology_changed(meta);
+      }
+    }
+    warp_barrier(mask);
+  }
+}
+
+void Hash_deactivate(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i);
+  if (slot < 0) {
+    return;
+  }
+  auto child = (volatile u64 *)(Hash_get_children(meta, node) + slot);
+  auto old_child = atomic_exchange_u64(child, 0);
+  if (old_child != 0) {
+    auto smeta = (StructMeta *)meta;
+    auto rt = smeta->context->runtime;
+    auto alloc = rt->node_allocators[smeta->snode_id];
+    alloc->recycle((Ptr)old_child);
+    mark_topology_changed(smeta);
+  }
+}
+
+i32 Hash_is_active(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i);
+  return slot >= 0 && Hash_get_children(meta, node)[slot] != nullptr;
+}
+
+Ptr Hash_lookup_element(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i);
+  Ptr data_ptr = nullptr;
+  if (slot >= 0) {
+    data_ptr = Hash_get_children(meta, node)[slot];
+  }
+  if (data_ptr == nullptr) {
+    auto smeta = (StructMeta *)meta;
+    auto context = smeta->context;
+    data_ptr = (context->runtime)->ambient_elements[smeta->snode_id];
+  }
+  return data_ptr;
+}
+
+i32 Hash_get_cell_index(Ptr meta, Ptr node, int slot) {
+  // -1 for the empty slots, which are skipped as inactive.
+  return (i32)(Hash_get_keys(node)[slot] - 1);
+}
+
+i32 Hash_is_slot_active(Ptr meta, Ptr node, int slot) {
+  return Hash_get_children(meta, node)[slot] != nullptr;
+}
+
+Ptr Hash_lookup_slot(Ptr meta, Ptr node, int slot) {
+  return Hash_get_children(meta, node)[slot];
+}
+
+i32 Hash_next_active(Ptr meta, Ptr node, int i, int end) {
+  while (i < end && !Hash_is_active(meta, node, i)) {
+    i++;
+  }
+  return i;
+}
+
+i32 Hash_next_active_slot(Ptr meta, Ptr node, int slot, int end) {
+  while (slot < end && !Hash_is_slot_active(meta, node, slot)) {
+    slot++;
+  }
+  return slot;
+}
@@ -57,6 +57,7 @@ void Pointer_activate(Ptr meta_, Ptr node, int i) {
             // TODO: Not sure if we really need atomic_exchange here,
             // just to be safe.
             atomic_exchange_u64((u64 *)data_ptr, allocated);
+            mark_topology_changed(meta);
           },
           [&]() { return *data_ptr == nullptr; });
     }
@@ -76,11 +77,17 @@ void Pointer_deactivate(Ptr meta, Ptr node, int i) {
         auto alloc = rt->node_allocators[smeta->snode_id];
         alloc->recycle(data_ptr);
         data_ptr = nullptr;
+        mark_topology_changed(smeta);
       }
     });
   }
 }
 
+Ptr *Pointer_get_child_slot(Ptr meta, Ptr node, int i) {
+  auto num_elements = Pointer_get_num_elements(meta, node);
+  return (Ptr *)(node + 8 * (num_elements + i));
+}
+
 i32 Pointer_is_active(Ptr meta, Ptr node, int i) {
   auto num_elements = Pointer_get_num_elements(meta, node);
   auto data_ptr = *(Ptr *)(node + 8 * (num_elements + i));
@@ -97,3 +104,14 @@ Ptr Pointer_lookup_element(Ptr meta, Ptr node, int i) {
   }
   return data_ptr;
 }
+
+i32 Pointer_get_cell_index(Ptr meta, Ptr node, int i) {
+  return i;
+}
+
+i32 Pointer_next_active(Ptr meta, Ptr node, int i, int end) {
+  while (i < end && !Pointer_is_active(meta, node, i)) {
+    i++;
+  }
+  return i;
+}
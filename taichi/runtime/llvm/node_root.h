@@ -21,3 +21,11 @@ Ptr Root_lookup_element(Ptr meta, Ptr node, int i) {
 i32 Root_get_num_elements(Ptr meta, Ptr node) {
   return 1;
 }
+
+i32 Root_get_cell_index(Ptr meta, Ptr node, int i) {
+  return i;
+}
+
+i32 Root_next_active(Ptr meta, Ptr node, int i, int end) {
+  return i;
+}
@@ -35,6 +35,11 @@ using host_vsnprintf_type = int (*)(char *,
                                     std::va_list);
 using vm_allocator_type = void *(*)(void *, std::size_t, std::size_t);
 using RangeForTaskFunc = void(RuntimeContext *, const char *tls, int i);
+// Executes the iterations [begin, end) of a range-for.
+using BlockRangeForTaskFunc = void(RuntimeContext *,
+                                   const char *tls,
+                                   int begin,
+                                   int end);
 using MeshForTaskFunc = void(RuntimeContext *, const char *tls, uint32_t i);
 using parallel_for_type = void (*)(void *thread_pool,
                                    int splits,
@@ -355,6 +360,34 @@ int32 RuntimeContext_get_extra_args(RuntimeContext *ctx, int32 i, int32 j) {
 
 #include "taichi/runtime/llvm/atomic.h"
 
+extern "C" {
+int32 cuda_compute_capability();
+uint32 cuda_active_mask();
+int32 cttz_i32(i32 val);
+i32 cuda_match_any_sync_i64(i32 mask, i64 value);
+i32 cuda_shfl_sync_i32(u32 mask, i32 val, i32 src_lane, int width);
+}
+
+// Equivalent to atomic_add_i32(dest, 1), but on CUDA the lanes of a warp that
+// increment the same counter are combined into a single atomic. This avoids
+// serializing millions of threads on the hot counters of the node allocators.
+i32 atomic_inc_i32_warp_aggregated(i32 *dest) {
+#if ARCH_cuda
+  // match.any requires sm_70+
+  if (cuda_compute_capability() >= 70) {
+    const u32 mask = cuda_match_any_sync_i64(cuda_active_mask(), (i64)dest);
+    const i32 leader = cttz_i32(mask);
+    const i32 rank = __builtin_popcount(mask & ((1u << warp_idx()) - 1));
+    i32 base = 0;
+    if (warp_idx() == leader) {
+      base = atomic_add_i32(dest, __builtin_popcount(mask));
+    }
+    return cuda_shfl_sync_i32(mask, base, leader, 31) + rank;
+  }
+#endif
+  return atomic_add_i32(dest, 1);
+}
+
 // These structures are accessible by both the LLVM backend and this C++ runtime
 // file here (for building complex runtime functions in C++)
 
@@ -378,6 +411,15 @@ struct StructMeta {
                              PhysicalCoordinates *refined_coord,
                              int index);
 
+  // The index of the cell of the i-th element visited by the listgen, which
+  // is only different from i for hash nodes.
+  i32 (*get_cell_index)(Ptr, Ptr, int i);
+
+  // The first active element of the node in [i, end), or an index no less
+  // than |end| if there is none. Bitmasked
+  // nodes scan their masks a word at a time.
+  i32 (*next_active)(Ptr, Ptr, int i, int end);
+
   RuntimeContext *context;
 };
 
@@ -389,6 +431,20 @@ STRUCT_FIELD(StructMeta, lookup_element);
 STRUCT_FIELD(StructMeta, from_parent_element);
 STRUCT_FIELD(StructMeta, refine_coordinates);
 STRUCT_FIELD(StructMeta, is_active);
+STRUCT_FIELD(StructMeta, get_cell_index);
+STRUCT_FIELD(StructMeta, next_active);
+
+// The first active element of |node| from |j| on, among the ones visited with
+// a stride of |step|.
+i32 next_active_element(StructMeta *meta, Ptr node, int j, int end, int step) {
+  if (step == 1) {
+    return meta->next_active((Ptr)meta, node, j, end);
+  }
+  while (j < end && !meta->is_active((Ptr)meta, node, j)) {
+    j += step;
+  }
+  return j;
+}
 STRUCT_FIELD(StructMeta, context);
 
 struct LLVMRuntime;
@@ -445,7 +501,7 @@ struct ListManager {
   void append(void *data_ptr);
 
   i32 reserve_new_element() {
-    auto i = atomic_add_i32(&num_elements, 1);
+    auto i = atomic_inc_i32_warp_aggregated(&num_elements);
     auto chunk_id = i >> log2chunk_num_elements;
     touch_chunk(chunk_id);
     return i;
@@ -460,6 +516,8 @@ struct ListManager {
 
   void touch_chunk(int chunk_id);
 
+  void release_chunks(i32 n);
+
   i32 get_num_active_chunks() {
     i32 counter = 0;
     for (int i = 0; i < max_num_chunks; i++) {
@@ -567,6 +625,8 @@ struct LLVMRuntime {
   Ptr allocate_aligned(std::size_t size, std::size_t alignment);
   Ptr request_allocate_aligned(std::size_t size, std::size_t alignment);
   Ptr allocate_from_buffer(std::size_t size, std::size_t alignment);
+  void release_chunk(Ptr chunk, std::size_t size);
+  Ptr reuse_chunk(std::size_t size);
   Ptr profiler;
   void (*profiler_start)(Ptr, Ptr);
   void (*profiler_stop)(Ptr);
@@ -583,8 +643,41 @@ struct LLVMRuntime {
 
   i64 total_requested_memory;
 
+  // Set by the nodes when the activity of their cells changes, and folded
+  // into the epochs of the SNodes when an element list is checked.
+  i32 topology_dirty[taichi_max_num_snodes];
+  u64 topology_epochs[taichi_max_num_snodes];
+  // The sum of the epochs of the ancestors of an SNode when its element list
+  // was generated, zero if the list has to be regenerated.
+  u64 element_list_stamps[taichi_max_num_snodes];
+  // Whether the listgen of an SNode is skipped, set by the clear_list tasks.
+  i32 element_list_up_to_date[taichi_max_num_snodes];
+  // The work queues of the struct-fors balanced dynamically on CUDA, see
+  // gpu_parallel_struct_for_dynamic: the next work item to claim, and how
+  // many blocks are done with the launch.
+  i32 struct_for_queue_heads[taichi_max_num_snodes];
+  i32 struct_for_queue_blocks_done[taichi_max_num_snodes];
+
+  // The zero-filled chunks released by the compacting GC, linked through
+  // their first bytes. The memory pool can't take them back, so they are
+  // reused by the ListManagers allocating chunks of the same size.
+  Ptr released_chunks;
+  i32 released_chunks_lock;
+
   Ptr wasm_print_buffer = nullptr;
 
+  // The ring buffer of the printed records on CUDA, see CUDAPrintBuffer, and
+  // the number of words reserved in it so far.
+  Ptr print_buffer;
+  u64 print_buffer_capacity;
+  i64 print_buffer_head;
+
+  // The partial sums of the deterministic reductions, by reduction and slot,
+  // and the number of slots written so far for each reduction, see
+  // deterministic_reduce_add_*.
+  f64 *deterministic_reduction_partials;
+  i32 deterministic_reduction_counters[taichi_max_num_deterministic_reductions];
+
   template <typename T>
   void set_result(std::size_t i, T t) {
     static_assert(sizeof(T) <= sizeof(uint64));
@@ -612,6 +705,8 @@ STRUCT_FIELD(LLVMRuntime, host_vsnprintf);
 STRUCT_FIELD(LLVMRuntime, profiler);
 STRUCT_FIELD(LLVMRuntime, profiler_start);
 STRUCT_FIELD(LLVMRuntime, profiler_stop);
+STRUCT_FIELD(LLVMRuntime, print_buffer);
+STRUCT_FIELD(LLVMRuntime, print_buffer_capacity);
 
 // NodeManager of node S (hash, pointer) managers the memory allocation of S_ch
 // It makes use of three ListManagers.
@@ -625,6 +720,8 @@ struct NodeManager {
 
   ListManager *free_list, *recycled_list, *data_list;
   i32 recycle_list_size_backup;
+  // The number of live nodes during a compaction.
+  i32 num_live_nodes;
 
   using list_data_type = i32;
 
@@ -652,7 +749,7 @@ struct NodeManager {
   }
 
   Ptr allocate() {
-    int old_cursor = atomic_add_i32(&free_list_used, 1);
+    int old_cursor = atomic_inc_i32_warp_aggregated(&free_list_used);
     i32 l;
     if (old_cursor >= free_list->size()) {
       // running out of free list. allocate new.
@@ -692,6 +789,53 @@ struct NodeManager {
     }
     recycled_list->clear();
   }
+
+  // Called after a gc. Keeps the free slots below the number of live nodes at
+  // the front of the free list, to receive the nodes above it.
+  void compact_begin() {
+    num_live_nodes = data_list->size() - free_list->size();
+    i32 n = 0;
+    for (int i = 0; i < free_list->size(); i++) {
+      auto idx = free_list->get<list_data_type>(i);
+      if (idx < num_live_nodes) {
+        free_list->get<list_data_type>(n++) = idx;
+      }
+    }
+    free_list->resize(n);
+    free_list_used = 0;
+  }
+
+  // Moves the node referenced by |slot| into a free slot if it is above the
+  // number of live nodes.
+  void compact(Ptr *slot) {
+    if (locate(*slot) < num_live_nodes) {
+      return;
+    }
+    auto cursor = atomic_add_i32(&free_list_used, 1);
+    auto ptr = data_list->get_element_ptr(
+        free_list->get<list_data_type>(cursor));
+    std::memcpy(ptr, *slot, element_size);
+    std::memset(*slot, 0, element_size);
+    *slot = ptr;
+  }
+
+  void compact_end() {
+    if (free_list_used < free_list->size()) {
+      // Some nodes were not reachable from the walked containers, e.g. the
+      // children of a deactivated pointer. They are dropped, but their memory
+      // has to be zero-filled before being reused.
+      for (int i = num_live_nodes; i < data_list->size(); i++) {
+        std::memset(data_list->get_element_ptr(i), 0, element_size);
+      }
+    }
+    // The free slots left stay in the free list.
+    data_list->resize(num_live_nodes);
+    data_list->release_chunks(num_live_nodes);
+    // The element lists may point to the moved nodes.
+    for (int i = 0; i < taichi_max_num_snodes; i++) {
+      runtime->element_list_stamps[i] = 0;
+    }
+  }
 };
 
 extern "C" {
@@ -700,6 +844,14 @@ void LLVMRuntime_store_result(LLVMRuntime *runtime, u64 ret) {
   runtime->set_result(taichi_result_buffer_ret_value_id, ret);
 }
 
+void RuntimeContext_store_result(RuntimeContext *ctx, u64 ret) {
+  if (ctx->result_buffer) {
+    ctx->result_buffer[taichi_result_buffer_ret_value_id] = ret;
+  } else {
+    LLVMRuntime_store_result(ctx->runtime, ret);
+  }
+}
+
 void LLVMRuntime_profiler_start(LLVMRuntime *runtime, Ptr kernel_name) {
   runtime->profiler_start(runtime->profiler, kernel_name);
 }
@@ -751,15 +903,14 @@ void taichi_assert(RuntimeContext *context, i32 test, const char *msg) {
   taichi_assert_runtime(context->runtime, test, msg);
 }
 
-void taichi_assert_format(LLVMRuntime *runtime,
-                          i32 test,
-                          const char *format,
-                          int num_arguments,
-                          uint64 *arguments) {
+// Stores the error message of the first failing assertion, retrieved by
+// LlvmProgramImpl::check_runtime_error().
+void taichi_record_error(LLVMRuntime *runtime,
+                         const char *format,
+                         int num_arguments,
+                         uint64 *arguments) {
   mark_force_no_inline();
 
-  if (!enable_assert || test != 0)
-    return;
   if (!runtime->error_code) {
     locked_task(&runtime->error_message_lock, [&] {
       if (!runtime->error_code) {
@@ -776,6 +927,18 @@ void taichi_assert_format(LLVMRuntime *runtime,
       }
     });
   }
+}
+
+void taichi_assert_format(LLVMRuntime *runtime,
+                          i32 test,
+                          const char *format,
+                          int num_arguments,
+                          uint64 *arguments) {
+  mark_force_no_inline();
+
+  if (!enable_assert || test != 0)
+    return;
+  taichi_record_error(runtime, format, num_arguments, arguments);
 #if ARCH_cuda
   // Kill this CUDA thread.
   asm("exit;");
@@ -842,6 +1005,39 @@ Ptr LLVMRuntime::allocate(std::size_t size) {
   return allocate_aligned(size, 1);
 }
 
+void LLVMRuntime::release_chunk(Ptr chunk, std::size_t size) {
+  if (size < sizeof(Ptr) + sizeof(std::size_t)) {
+    return;
+  }
+  atomic_add_i64(&total_requested_memory, -(i64)size);
+  locked_task(&released_chunks_lock, [&] {
+    *(Ptr *)chunk = released_chunks;
+    *(std::size_t *)(chunk + sizeof(Ptr)) = size;
+    released_chunks = chunk;
+  });
+}
+
+Ptr LLVMRuntime::reuse_chunk(std::size_t size) {
+  if (released_chunks == nullptr) {
+    return nullptr;
+  }
+  Ptr ret = nullptr;
+  locked_task(&released_chunks_lock, [&] {
+    for (Ptr *p = &released_chunks; *p; p = (Ptr *)*p) {
+      if (*(std::size_t *)(*p + sizeof(Ptr)) == size) {
+        ret = *p;
+        *p = *(Ptr *)ret;
+        break;
+      }
+    }
+  });
+  if (ret) {
+    atomic_add_i64(&total_requested_memory, size);
+    std::memset(ret, 0, sizeof(Ptr) + sizeof(std::size_t));
+  }
+  return ret;
+}
+
 Ptr LLVMRuntime::request_allocate_aligned(std::size_t size,
                                           std::size_t alignment) {
   atomic_add_i64(&total_requested_memory, size);
@@ -872,6 +1068,32 @@ void runtime_memory_allocate_aligned(LLVMRuntime *runtime,
                       runtime->allocate_aligned(size, alignment));
 }
 
+// Reserves |num_words| words of the print buffer for a record, waiting for
+// the host to consume the records in the way. Returns the position of the
+// record, to be passed to print_buffer_write() and print_buffer_commit().
+i64 print_buffer_reserve(LLVMRuntime *runtime, i32 num_words) {
+  auto pos = atomic_add_i64(&runtime->print_buffer_head, num_words);
+  auto tail = (volatile u64 *)runtime->print_buffer;
+  while (pos + num_words - *tail > runtime->print_buffer_capacity) {
+    system_memfence();
+  }
+  return pos;
+}
+
+void print_buffer_write(LLVMRuntime *runtime, i64 pos, i32 offset, u64 value) {
+  auto records = (u64 *)runtime->print_buffer + 1;
+  records[(pos + offset) % runtime->print_buffer_capacity] = value;
+}
+
+// Publishes the record to the host. The header is stored last, see
+// CUDAPrintBuffer for its layout.
+void print_buffer_commit(LLVMRuntime *runtime, i64 pos, u64 header) {
+  auto records = (volatile u64 *)runtime->print_buffer + 1;
+  system_memfence();
+  records[pos % runtime->print_buffer_capacity] = header;
+  system_memfence();
+}
+
 void runtime_get_mem_req_queue(LLVMRuntime *runtime) {
   runtime->set_result(taichi_result_buffer_ret_value_id,
                       runtime->mem_req_queue);
@@ -915,6 +1137,11 @@ void runtime_initialize(
   runtime->memory_pool = memory_pool;
 
   runtime->total_requested_memory = 0;
+  runtime->released_chunks = nullptr;
+  runtime->released_chunks_lock = 0;
+  runtime->print_buffer = nullptr;
+  runtime->print_buffer_capacity = 0;
+  runtime->print_buffer_head = 0;
 
   // runtime->allocate ready to use
   runtime->mem_req_queue = (MemRequestQueue *)runtime->allocate_aligned(
@@ -923,6 +1150,12 @@ void runtime_initialize(
   runtime->temporaries = (Ptr)runtime->allocate_aligned(
       taichi_global_tmp_buffer_size, taichi_page_size);
 
+  runtime->deterministic_reduction_partials =
+      (f64 *)runtime->allocate_aligned(
+          sizeof(f64) * taichi_max_num_deterministic_reductions *
+              taichi_max_num_deterministic_reduction_slots,
+          taichi_page_size);
+
   runtime->num_rand_states = num_rand_states;
   runtime->rand_states = (RandState *)runtime->allocate_aligned(
       sizeof(RandState) * runtime->num_rand_states, taichi_page_size);
@@ -951,6 +1184,12 @@ void runtime_initialize_snodes(LLVMRuntime *runtime,
     // TODO: some SNodes do not actually need an element list.
     runtime->element_lists[i] =
         runtime->create<ListManager>(runtime, sizeof(Element), 1024 * 64);
+    runtime->topology_dirty[i] = 0;
+    runtime->topology_epochs[i] = 0;
+    runtime->element_list_stamps[i] = 0;
+    runtime->element_list_up_to_date[i] = 0;
+    runtime->struct_for_queue_heads[i] = 0;
+    runtime->struct_for_queue_blocks_done[i] = 0;
   }
   Element elem;
   elem.loop_bounds[0] = 0;
@@ -1015,6 +1254,14 @@ i32 cuda_shfl_down_sync_i32(u32 mask, i32 val, i32 delta, int width) {
   return 0;
 }
 
+i32 cuda_shfl_sync_i32(u32 mask, i32 val, i32 src_lane, int width) {
+  return 0;
+}
+
+f32 cuda_shfl_sync_f32(u32 mask, f32 val, i32 src_lane, int width) {
+  return 0;
+}
+
 i32 cuda_shfl_down_i32(i32 delta, i32 val, int width) {
   return 0;
 }
@@ -1131,11 +1378,167 @@ DEFINE_REDUCTION(and, i32);
 DEFINE_REDUCTION(or, i32);
 DEFINE_REDUCTION(xor, i32);
 
+// Unlike reduce_*, the lanes calling these may update different addresses.
+// On CUDA (sm_70+), the active lanes of a warp updating the same address are
+// grouped with match.any, their values are combined with a tree reduction
+// among the peers, and only the lowest peer issues the atomic. The old value is
+// not returned.
+#if ARCH_cuda
+#define DEFINE_WARP_AGGREGATED_ATOMIC(op, dtype)                            \
+  void atomic_##op##_##dtype##_warp_aggregated(dtype *dest, dtype val) {    \
+    if (cuda_compute_capability() < 70) {                                  \
+      atomic_##op##_##dtype(dest, val);                                     \
+      return;                                                               \
+    }                                                                       \
+    const u32 active = cuda_active_mask();                                  \
+    const i32 lane = warp_idx();                                            \
+    u32 peers = cuda_match_any_sync_i64(active, (i64)dest);                 \
+    const i32 leader = cttz_i32(peers);                                     \
+    /* The rank of this lane among its peers */                             \
+    u32 rank = __builtin_popcount(peers & ((1u << lane) - 1));              \
+    /* Only the peers above this lane contribute to its value */            \
+    peers &= 0xFFFFFFFEu << lane;                                           \
+    while (cuda_ballot_sync(active, peers != 0) != 0) {                     \
+      const i32 next = peers != 0 ? cttz_i32(peers) : lane;                 \
+      /* All the active lanes have to take part in the shuffle */           \
+      const dtype other =                                                   \
+          cuda_shfl_sync_##dtype(active, val, next, 31);                    \
+      if (peers != 0) {                                                     \
+        val = op_##op##_##dtype(val, other);                                \
+      }                                                                     \
+      /* Lanes with an odd rank have been consumed by a lower peer */       \
+      peers &= ~(u32)cuda_ballot_sync(active, rank & 1);                    \
+      rank >>= 1;                                                           \
+    }                                                                       \
+    if (lane == leader) {                                                   \
+      atomic_##op##_##dtype(dest, val);                                     \
+    }                                                                       \
+  }
+#else
+#define DEFINE_WARP_AGGREGATED_ATOMIC(op, dtype)                          \
+  void atomic_##op##_##dtype##_warp_aggregated(dtype *dest, dtype val) {  \
+    atomic_##op##_##dtype(dest, val);                                     \
+  }
+#endif
+
+DEFINE_WARP_AGGREGATED_ATOMIC(add, i32);
+DEFINE_WARP_AGGREGATED_ATOMIC(add, f32);
+
+DEFINE_WARP_AGGREGATED_ATOMIC(min, i32);
+DEFINE_WARP_AGGREGATED_ATOMIC(min, f32);
+
+DEFINE_WARP_AGGREGATED_ATOMIC(max, i32);
+DEFINE_WARP_AGGREGATED_ATOMIC(max, f32);
+
+// The deterministic reductions, see CompileConfig::deterministic_reduction.
+// The TLS epilogue of each CPU task, or of each thread on CUDA, calls
+// deterministic_reduce_add_* with its partial sum of the reduction |id|. The
+// partial sums of a warp are combined with shuffles in a fixed tree order, and
+// every CPU task or warp stores its partial sum to a slot of its own. The last
+// one to arrive adds the slots up in order into |*sum|, and returns 1.
+#define DEFINE_DETERMINISTIC_REDUCTION_ARRIVE(dtype)                         \
+  i32 deterministic_reduction_arrive_##dtype(LLVMRuntime *runtime, i32 id,   \
+                                             i32 slot, i32 num_slots,        \
+                                             dtype val, dtype *sum) {        \
+    /* Not cached, as the other slots are written by other blocks */         \
+    volatile f64 *partials =                                                 \
+        runtime->deterministic_reduction_partials +                          \
+        id * taichi_max_num_deterministic_reduction_slots;                   \
+    /* The number of slots is bounded by the code generators */              \
+    partials[slot] = (f64)val;                                               \
+    grid_memfence();                                                         \
+    i32 *counter = &runtime->deterministic_reduction_counters[id];           \
+    if (atomic_add_i32(counter, 1) != num_slots - 1) {                       \
+      return 0;                                                              \
+    }                                                                        \
+    grid_memfence();                                                         \
+    dtype result = 0;                                                        \
+    for (int i = 0; i < num_slots; i++) {                                    \
+      result += (dtype)partials[i];                                          \
+    }                                                                        \
+    *sum = result;                                                           \
+    /* Ready for the next launch */                                          \
+    *counter = 0;                                                            \
+    return 1;                                                                \
+  }
+
+DEFINE_DETERMINISTIC_REDUCTION_ARRIVE(f32);
+DEFINE_DETERMINISTIC_REDUCTION_ARRIVE(f64);
+
+#if ARCH_cuda
+f64 warp_reduce_add_f64(f64 val) {
+  for (int offset = 16; offset > 0; offset /= 2) {
+    // There is no 64-bit shuffle: the halves are shuffled separately.
+    const u64 bits = taichi_union_cast<u64>(val);
+    const i32 lo = cuda_shfl_down_sync_i32(0xFFFFFFFF, (i32)bits, offset, 31);
+    const i32 hi =
+        cuda_shfl_down_sync_i32(0xFFFFFFFF, (i32)(bits >> 32), offset, 31);
+    val += taichi_union_cast<f64>(((u64)(u32)hi << 32) | (u32)lo);
+  }
+  return val;
+}
+
+#define DEFINE_DETERMINISTIC_REDUCTION(dtype)                               \
+  i32 deterministic_reduce_add_##dtype(RuntimeContext *context, i32 id,     \
+                                       dtype val, dtype *sum) {             \
+    val = warp_reduce_add_##dtype(val);                                     \
+    if (warp_idx() != 0) {                                                  \
+      return 0;                                                             \
+    }                                                                       \
+    const i32 warps_per_block =                                             \
+        (block_dim() + warp_size() - 1) / warp_size();                      \
+    return deterministic_reduction_arrive_##dtype(                          \
+        context->runtime, id,                                               \
+        block_idx() * warps_per_block + thread_idx() / warp_size(),         \
+        grid_dim() * warps_per_block, val, sum);                            \
+  }
+#else
+#define DEFINE_DETERMINISTIC_REDUCTION(dtype)                               \
+  i32 deterministic_reduce_add_##dtype(RuntimeContext *context, i32 id,     \
+                                       dtype val, dtype *sum) {             \
+    return deterministic_reduction_arrive_##dtype(                          \
+        context->runtime, id, context->cpu_task_id, context->cpu_num_tasks, \
+        val, sum);                                                          \
+  }
+#endif
+
+DEFINE_DETERMINISTIC_REDUCTION(f32);
+DEFINE_DETERMINISTIC_REDUCTION(f64);
+
 // "Element", "component" are different concepts
 
 void clear_list(LLVMRuntime *runtime, StructMeta *parent, StructMeta *child) {
   auto child_list = runtime->element_lists[child->snode_id];
   child_list->clear();
+  runtime->element_list_stamps[child->snode_id] = 0;
+  runtime->element_list_up_to_date[child->snode_id] = 0;
+}
+
+// Clears the element list of |child| unless none of its ancestors, whose ids
+// are in |ancestors|, has activated or deactivated a cell since the list was
+// generated. In that case the listgen of |child| is skipped.
+void clear_list_if_outdated(LLVMRuntime *runtime,
+                            StructMeta *child,
+                            i32 *ancestors,
+                            int num_ancestors) {
+  // The epochs only grow, so does their sum.
+  u64 stamp = 1;
+  for (int i = 0; i < num_ancestors; i++) {
+    auto id = ancestors[i];
+    if (runtime->topology_dirty[id]) {
+      runtime->topology_dirty[id] = 0;
+      runtime->topology_epochs[id]++;
+    }
+    stamp += runtime->topology_epochs[id];
+  }
+  auto id = child->snode_id;
+  if (runtime->element_list_stamps[id] == stamp) {
+    runtime->element_list_up_to_date[id] = 1;
+    return;
+  }
+  runtime->element_lists[id]->clear();
+  runtime->element_list_stamps[id] = stamp;
+  runtime->element_list_up_to_date[id] = 0;
 }
 
 /*
@@ -1150,6 +1553,9 @@ void element_listgen_root(LLVMRuntime *runtime,
                           StructMeta *child) {
   // If there's just one element in the parent list, we need to use the blocks
   // (instead of threads) to split the parent container
+  if (runtime->element_list_up_to_date[child->snode_id]) {
+    return;
+  }
   auto parent_list = runtime->element_lists[parent->snode_id];
   auto child_list = runtime->element_lists[child->snode_id];
   // Cache the func pointers here for better compiler optimization
@@ -1197,13 +1603,16 @@ void element_listgen_root(LLVMRuntime *runtime,
 void element_listgen_nonroot(LLVMRuntime *runtime,
                              StructMeta *parent,
                              StructMeta *child) {
+  if (runtime->element_list_up_to_date[child->snode_id]) {
+    return;
+  }
   auto parent_list = runtime->element_lists[parent->snode_id];
   int num_parent_elements = parent_list->size();
   auto child_list = runtime->element_lists[child->snode_id];
   // Cache the func pointers here for better compiler optimization
   auto parent_refine_coordinates = parent->refine_coordinates;
-  auto parent_is_active = parent->is_active;
   auto parent_lookup_element = parent->lookup_element;
+  auto parent_get_cell_index = parent->get_cell_index;
   auto child_get_num_elements = child->get_num_elements;
   auto child_from_parent_element = child->from_parent_element;
 #if ARCH_cuda
@@ -1223,26 +1632,116 @@ void element_listgen_nonroot(LLVMRuntime *runtime,
     auto element = parent_list->get<Element>(i);
     int j_lower = element.loop_bounds[0] + j_start;
     int j_higher = element.loop_bounds[1];
-    for (int j = j_lower; j < j_higher; j += j_step) {
+    for (int j = next_active_element(parent, element.element, j_lower,
+                                     j_higher, j_step);
+         j < j_higher; j = next_active_element(parent, element.element,
+                                               j + j_step, j_higher, j_step)) {
       PhysicalCoordinates refined_coord;
-      parent_refine_coordinates(&element.pcoord, &refined_coord, j);
-      if (parent_is_active((Ptr)parent, element.element, j)) {
-        auto ch_element =
-            parent_lookup_element((Ptr)parent, element.element, j);
-        ch_element = child_from_parent_element((Ptr)ch_element);
-        auto ch_num_elements = child_get_num_elements((Ptr)child, ch_element);
-        auto ch_element_size =
-            std::min(ch_num_elements, taichi_listgen_max_element_size);
-        for (int ch_lower = 0; ch_lower < ch_num_elements;
-             ch_lower += ch_element_size) {
-          Element elem;
-          elem.element = ch_element;
-          elem.loop_bounds[0] = ch_lower;
-          elem.loop_bounds[1] =
-              std::min(ch_lower + ch_element_size, ch_num_elements);
-          elem.pcoord = refined_coord;
-          child_list->append(&elem);
+      parent_refine_coordinates(
+          &element.pcoord, &refined_coord,
+          parent_get_cell_index((Ptr)parent, element.element, j));
+      auto ch_element = parent_lookup_element((Ptr)parent, element.element, j);
+      ch_element = child_from_parent_element((Ptr)ch_element);
+      auto ch_num_elements = child_get_num_elements((Ptr)child, ch_element);
+      auto ch_element_size =
+          std::min(ch_num_elements, taichi_listgen_max_element_size);
+      for (int ch_lower = 0; ch_lower < ch_num_elements;
+           ch_lower += ch_element_size) {
+        Element elem;
+        elem.element = ch_element;
+        elem.loop_bounds[0] = ch_lower;
+        elem.loop_bounds[1] =
+            std::min(ch_lower + ch_element_size, ch_num_elements);
+        elem.pcoord = refined_coord;
+        child_list->append(&elem);
+      }
+    }
+  }
+}
+
+// Generates the list of |metas[num_levels]| from the list of |metas[0]| in a
+// single task. The active cells of the levels in between are walked
+// depth-first instead of being appended to their own lists, which saves a
+// launch and a pass over a list per level.
+void element_listgen_fused(LLVMRuntime *runtime,
+                           StructMeta **metas,
+                           int num_levels) {
+  if (runtime->element_list_up_to_date[metas[num_levels]->snode_id]) {
+    return;
+  }
+  auto parent = metas[0];
+  auto parent_list = runtime->element_lists[parent->snode_id];
+  int num_parent_elements = parent_list->size();
+  auto leaf_list = runtime->element_lists[metas[num_levels]->snode_id];
+#if ARCH_cuda
+  // Each block processes a slice of a parent container
+  int i_start = block_idx();
+  int i_step = grid_dim();
+  // Each thread processes an element of the parent container
+  int j_start = thread_idx();
+  int j_step = block_dim();
+#else
+  int i_start = 0;
+  int i_step = 1;
+  int j_start = 0;
+  int j_step = 1;
+#endif
+  // The container being walked at each level, its coordinates, and the next
+  // and the end of its elements.
+  Ptr nodes[taichi_listgen_max_fused_levels + 1];
+  PhysicalCoordinates coords[taichi_listgen_max_fused_levels + 1];
+  int cursors[taichi_listgen_max_fused_levels + 1];
+  int num_elements[taichi_listgen_max_fused_levels + 1];
+  // Enters the container holding the |j|-th element of |nodes[level]|.
+  auto descend = [&](int level, Ptr node, PhysicalCoordinates *coord, int j) {
+    auto meta = metas[level];
+    auto child = metas[level + 1];
+    meta->refine_coordinates(coord, &coords[level + 1],
+                             meta->get_cell_index((Ptr)meta, node, j));
+    auto ch_element = meta->lookup_element((Ptr)meta, node, j);
+    nodes[level + 1] = child->from_parent_element((Ptr)ch_element);
+    cursors[level + 1] = 0;
+    num_elements[level + 1] =
+        child->get_num_elements((Ptr)child, nodes[level + 1]);
+  };
+  for (int i = i_start; i < num_parent_elements; i += i_step) {
+    auto element = parent_list->get<Element>(i);
+    int j_lower = element.loop_bounds[0] + j_start;
+    int j_higher = element.loop_bounds[1];
+    for (int j = next_active_element(parent, element.element, j_lower,
+                                     j_higher, j_step);
+         j < j_higher; j = next_active_element(parent, element.element,
+                                               j + j_step, j_higher, j_step)) {
+      descend(0, element.element, &element.pcoord, j);
+      int level = 1;
+      while (level > 0) {
+        if (level == num_levels) {
+          auto ch_num_elements = num_elements[level];
+          auto ch_element_size =
+              std::min(ch_num_elements, taichi_listgen_max_element_size);
+          for (int ch_lower = 0; ch_lower < ch_num_elements;
+               ch_lower += ch_element_size) {
+            Element elem;
+            elem.element = nodes[level];
+            elem.loop_bounds[0] = ch_lower;
+            elem.loop_bounds[1] =
+                std::min(ch_lower + ch_element_size, ch_num_elements);
+            elem.pcoord = coords[level];
+            leaf_list->append(&elem);
+          }
+          level--;
+          continue;
         }
+        auto meta = metas[level];
+        int k = meta->next_active((Ptr)meta, nodes[level], cursors[level],
+                                  num_elements[level]);
+        if (k >= num_elements[level]) {
+          level--;
+          continue;
+        }
+        cursors[level] = k + 1;
+        descend(level, nodes[level], &coords[level], k);
+        level++;
       }
     }
   }
@@ -1257,6 +1756,8 @@ struct cpu_block_task_helper_context {
   int element_size;
   int element_split;
   std::size_t tls_buffer_size;
+  int list_tail;
+  int prefetch_distance;
 };
 
 // TODO: To enforce inlining, we need to create in LLVM a new function that
@@ -1277,6 +1778,17 @@ void cpu_struct_for_block_helper(void *ctx_, int thread_id, int i) {
   upper = std::min(upper, e.loop_bounds[1]);
   alignas(8) char tls_buffer[ctx->tls_buffer_size];
 
+  // The threads run consecutive tasks, so the element |prefetch_distance|
+  // ahead is most likely one this thread takes next. The cells of pointer and
+  // dynamic SNodes are allocated out of order, which the hardware prefetchers
+  // cannot follow.
+  const int next_id = element_id + ctx->prefetch_distance;
+  if (ctx->prefetch_distance > 0 && part_id == 0 &&
+      next_id < ctx->list_tail) {
+    __builtin_prefetch(ctx->list->get<Element>(next_id).element, /*rw=*/0,
+                       /*locality=*/3);
+  }
+
   RuntimeContext this_thread_context = *ctx->context;
   this_thread_context.cpu_thread_id = thread_id;
   if (lower < upper) {
@@ -1291,7 +1803,8 @@ void parallel_struct_for(RuntimeContext *context,
                          int element_split,
                          BlockTask *task,
                          std::size_t tls_buffer_size,
-                         int num_threads) {
+                         int num_threads,
+                         int prefetch_distance) {
   auto list = (context->runtime)->element_lists[snode_id];
   auto list_tail = list->size();
 #if ARCH_cuda
@@ -1323,12 +1836,88 @@ void parallel_struct_for(RuntimeContext *context,
   ctx.element_size = element_size;
   ctx.element_split = element_split;
   ctx.tls_buffer_size = tls_buffer_size;
+  ctx.list_tail = list_tail;
+  ctx.prefetch_distance = prefetch_distance;
   auto runtime = context->runtime;
   runtime->parallel_for(runtime->thread_pool, list_tail * element_split,
                         num_threads, &ctx, cpu_struct_for_block_helper);
 #endif
 }
 
+// Like parallel_struct_for on CUDA, but the blocks claim the work items, i.e.
+// the |element_split| parts of each element, one at a time from a queue
+// instead of a static slice of the list. The blocks done with the light
+// elements then take over the parts of the heavy ones. |claim| is an i32 in
+// the shared memory of the block, through which thread 0 hands out the item.
+void gpu_parallel_struct_for_dynamic(RuntimeContext *context,
+                                     int snode_id,
+                                     int element_size,
+                                     int element_split,
+                                     BlockTask *task,
+                                     i32 *claim) {
+#if ARCH_cuda
+  auto runtime = context->runtime;
+  auto list = runtime->element_lists[snode_id];
+  const i32 num_items = list->size() * element_split;
+  // Patched during codegen, see parallel_struct_for.
+  alignas(8) char tls_buffer[1];
+  const auto part_size = (element_size + element_split - 1) / element_split;
+  while (true) {
+    if (thread_idx() == 0) {
+      *claim = atomic_add_i32(&runtime->struct_for_queue_heads[snode_id], 1);
+    }
+    block_barrier();
+    const i32 i = *claim;
+    // Thread 0 may only overwrite the claim once all the threads read it.
+    block_barrier();
+    if (i >= num_items)
+      break;
+    auto &e = list->get<Element>(i / element_split);
+    int lower = e.loop_bounds[0] + i % element_split * part_size;
+    int upper = std::min(lower + part_size, e.loop_bounds[1]);
+    if (lower < upper)
+      task(context, tls_buffer, &e, lower, upper);
+  }
+  // The queue is empty once every block has seen it so, and the last of them
+  // resets it for the next launch.
+  if (thread_idx() == 0) {
+    grid_memfence();
+    if (atomic_add_i32(&runtime->struct_for_queue_blocks_done[snode_id], 1) ==
+        grid_dim() - 1) {
+      runtime->struct_for_queue_heads[snode_id] = 0;
+      runtime->struct_for_queue_blocks_done[snode_id] = 0;
+    }
+  }
+#endif
+}
+
+// Waits until all the threads of the grid reach the barrier, between the
+// tasks packed into one launch on CUDA, see
+// CompileConfig::cuda_pack_small_tasks. All the blocks must be resident.
+// |state| holds the number of blocks arrived, then the number of barriers
+// passed, both zero-initialized.
+void grid_barrier(i32 *state) {
+#if ARCH_cuda
+  block_barrier();
+  if (thread_idx() == 0) {
+    auto generation = (volatile i32 *)&state[1];
+    // Read before arriving, since the last block bumps it.
+    const i32 passed = *generation;
+    grid_memfence();
+    if (atomic_add_i32(&state[0], 1) == grid_dim() - 1) {
+      state[0] = 0;
+      grid_memfence();
+      atomic_add_i32(&state[1], 1);
+    } else {
+      while (*generation == passed) {
+      }
+    }
+    grid_memfence();
+  }
+  block_barrier();
+#endif
+}
+
 using range_for_xlogue = void (*)(RuntimeContext *, /*TLS*/ char *tls_base);
 using mesh_for_xlogue = void (*)(RuntimeContext *,
                                  /*TLS*/ char *tls_base,
@@ -1344,19 +1933,39 @@ struct range_task_helper_context {
   int end;
   int block_size;
   int step;
+  int num_tasks;
 };
 
+int cpu_adaptive_block_dim(int num_items, int num_threads) {
+  // ensure each thread has at least ~32 tasks for load balancing
+  // and each task has at least 512 items to amortize scheduler overhead
+  return std::min(512, std::max(1, num_items / (num_threads * 32)));
+}
+
+// The block size of a CPU range-for with deterministic reductions: it does not
+// depend on the number of threads, and there are no more tasks than slots for
+// the partial sums. See deterministic_reduce_add_*.
+int cpu_deterministic_block_dim(int num_items, int block_dim) {
+  constexpr int kMinBlockDim = 64;
+  constexpr int kMaxNumTasks = taichi_max_num_deterministic_reduction_slots;
+  return std::max(block_dim == 0 ? kMinBlockDim : block_dim,
+                  (num_items + kMaxNumTasks - 1) / kMaxNumTasks);
+}
+
 void cpu_parallel_range_for_task(void *range_context,
                                  int thread_id,
                                  int task_id) {
   auto ctx = *(range_task_helper_context *)range_context;
+  RuntimeContext this_thread_context = *ctx.context;
+  this_thread_context.cpu_thread_id = thread_id;
+  this_thread_context.cpu_task_id = task_id;
+  this_thread_context.cpu_num_tasks = ctx.num_tasks;
+
   alignas(8) char tls_buffer[ctx.tls_size];
   auto tls_ptr = &tls_buffer[0];
   if (ctx.prologue)
-    ctx.prologue(ctx.context, tls_ptr);
+    ctx.prologue(&this_thread_context, tls_ptr);
 
-  RuntimeContext this_thread_context = *ctx.context;
-  this_thread_context.cpu_thread_id = thread_id;
   if (ctx.step == 1) {
     int block_start = ctx.begin + task_id * ctx.block_size;
     int block_end = std::min(block_start + ctx.block_size, ctx.end);
@@ -1371,7 +1980,7 @@ void cpu_parallel_range_for_task(void *range_context,
     }
   }
   if (ctx.epilogue)
-    ctx.epilogue(ctx.context, tls_ptr);
+    ctx.epilogue(&this_thread_context, tls_ptr);
 }
 
 void cpu_parallel_range_for(RuntimeContext *context,
@@ -1398,17 +2007,76 @@ void cpu_parallel_range_for(RuntimeContext *context,
     exit(-1);
   }
   if (block_dim == 0) {
-    // adaptive block dim
-    auto num_items = (ctx.end - ctx.begin) / std::abs(step);
-    // ensure each thread has at least ~32 tasks for load balancing
-    // and each task has at least 512 items to amortize scheduler overhead
-    block_dim = std::min(512, std::max(1, num_items / (num_threads * 32)));
+    block_dim = cpu_adaptive_block_dim((ctx.end - ctx.begin) / std::abs(step),
+                                       num_threads);
   }
   ctx.block_size = block_dim;
+  ctx.num_tasks = (end - begin + block_dim - 1) / block_dim;
   auto runtime = context->runtime;
-  runtime->parallel_for(runtime->thread_pool,
-                        (end - begin + block_dim - 1) / block_dim, num_threads,
-                        &ctx, cpu_parallel_range_for_task);
+  runtime->parallel_for(runtime->thread_pool, ctx.num_tasks, num_threads, &ctx,
+                        cpu_parallel_range_for_task);
+}
+
+struct block_range_task_helper_context {
+  RuntimeContext *context;
+  range_for_xlogue prologue{nullptr};
+  BlockRangeForTaskFunc *body{nullptr};
+  range_for_xlogue epilogue{nullptr};
+  std::size_t tls_size{1};
+  int begin;
+  int end;
+  int block_size;
+  int num_tasks;
+};
+
+void cpu_parallel_block_range_for_task(void *range_context,
+                                       int thread_id,
+                                       int task_id) {
+  auto ctx = *(block_range_task_helper_context *)range_context;
+  RuntimeContext this_thread_context = *ctx.context;
+  this_thread_context.cpu_thread_id = thread_id;
+  this_thread_context.cpu_task_id = task_id;
+  this_thread_context.cpu_num_tasks = ctx.num_tasks;
+
+  alignas(8) char tls_buffer[ctx.tls_size];
+  auto tls_ptr = &tls_buffer[0];
+  if (ctx.prologue)
+    ctx.prologue(&this_thread_context, tls_ptr);
+
+  int block_start = ctx.begin + task_id * ctx.block_size;
+  int block_end = std::min(block_start + ctx.block_size, ctx.end);
+  ctx.body(&this_thread_context, tls_ptr, block_start, block_end);
+  if (ctx.epilogue)
+    ctx.epilogue(&this_thread_context, tls_ptr);
+}
+
+// Same as cpu_parallel_range_for with step = 1, except that |body| iterates
+// over a whole block itself, so that the loop can be vectorized by LLVM.
+void cpu_parallel_block_range_for(RuntimeContext *context,
+                                  int num_threads,
+                                  int begin,
+                                  int end,
+                                  int block_dim,
+                                  range_for_xlogue prologue,
+                                  BlockRangeForTaskFunc *body,
+                                  range_for_xlogue epilogue,
+                                  std::size_t tls_size) {
+  block_range_task_helper_context ctx;
+  ctx.context = context;
+  ctx.prologue = prologue;
+  ctx.tls_size = tls_size;
+  ctx.body = body;
+  ctx.epilogue = epilogue;
+  ctx.begin = begin;
+  ctx.end = end;
+  if (block_dim == 0) {
+    block_dim = cpu_adaptive_block_dim(end - begin, num_threads);
+  }
+  ctx.block_size = block_dim;
+  ctx.num_tasks = (end - begin + block_dim - 1) / block_dim;
+  auto runtime = context->runtime;
+  runtime->parallel_for(runtime->thread_pool, ctx.num_tasks, num_threads, &ctx,
+                        cpu_parallel_block_range_for_task);
 }
 
 void gpu_parallel_range_for(RuntimeContext *context,
@@ -1479,10 +2147,10 @@ void cpu_parallel_mesh_for(RuntimeContext *context,
   ctx.epilogue = epilogue;
   ctx.num_patches = num_patches;
   if (block_dim == 0) {
-    // adaptive block dim
-    // ensure each thread has at least ~32 tasks for load balancing
-    // and each task has at least 512 items to amortize scheduler overhead
-    block_dim = std::min(512, std::max(1, num_patches / (num_threads * 32)));
+    // Neighboring patches share their ghost elements, so each task processes
+    // a run of consecutive patches to find those still in the cache. ~8 runs
+    // per thread leave enough room for load balancing.
+    block_dim = std::min(512, std::max(1, num_patches / (num_threads * 8)));
   }
   ctx.block_size = block_dim;
   auto runtime = context->runtime;
@@ -1516,11 +2184,18 @@ i32 linear_thread_idx(RuntimeContext *context) {
 #endif
 }
 
+// Called by the nodes when a cell is activated or deactivated, which
+// invalidates the element lists of their descendants.
+void mark_topology_changed(StructMeta *meta) {
+  meta->context->runtime->topology_dirty[meta->snode_id] = 1;
+}
+
 #include "node_dense.h"
 #include "node_dynamic.h"
 #include "node_pointer.h"
 #include "node_root.h"
 #include "node_bitmasked.h"
+#include "node_hash.h"
 
 void ListManager::touch_chunk(int chunk_id) {
   taichi_assert_runtime(runtime, chunk_id < max_num_chunks,
@@ -1530,14 +2205,27 @@ void ListManager::touch_chunk(int chunk_id) {
       // may have been allocated during lock contention
       if (!chunks[chunk_id]) {
         grid_memfence();
-        auto chunk_ptr = runtime->request_allocate_aligned(
-            max_num_elements_per_chunk * element_size, 4096);
+        const auto chunk_size = max_num_elements_per_chunk * element_size;
+        auto chunk_ptr = runtime->reuse_chunk(chunk_size);
+        if (chunk_ptr == nullptr) {
+          chunk_ptr = runtime->request_allocate_aligned(chunk_size, 4096);
+        }
         atomic_exchange_u64((u64 *)&chunks[chunk_id], (u64)chunk_ptr);
       }
     });
   }
 }
 
+// Releases the chunks holding no element below |n|.
+void ListManager::release_chunks(i32 n) {
+  const auto chunk_size = max_num_elements_per_chunk * element_size;
+  for (int i = (n + max_num_elements_per_chunk - 1) >> log2chunk_num_elements;
+       i < max_num_chunks && chunks[i]; i++) {
+    runtime->release_chunk(chunks[i], chunk_size);
+    chunks[i] = nullptr;
+  }
+}
+
 void ListManager::append(void *data_ptr) {
   auto ptr = allocate();
   std::memcpy(ptr, data_ptr, element_size);
@@ -1552,6 +2240,65 @@ void node_gc(LLVMRuntime *runtime, int snode_id) {
   runtime->node_allocators[snode_id]->gc_serial();
 }
 
+void node_gc_compact_begin(LLVMRuntime *runtime, int snode_id) {
+  runtime->node_allocators[snode_id]->compact_begin();
+}
+
+// Moves the children of the |j_start|-th, (|j_start| + |j_step|)-th, ...
+// cells of |element| to the front of |allocator|.
+void node_gc_compact_element(Ptr meta,
+                             NodeManager *allocator,
+                             const Element &element,
+                             int j_start,
+                             int j_step) {
+  for (int j = element.loop_bounds[0] + j_start; j < element.loop_bounds[1];
+       j += j_step) {
+    auto slot = Pointer_get_child_slot(meta, element.element, j);
+    if (*slot != nullptr) {
+      allocator->compact(slot);
+    }
+  }
+}
+
+struct gc_compact_task_helper_context {
+  Ptr meta;
+  NodeManager *allocator;
+  ListManager *list;
+};
+
+void cpu_node_gc_compact_task(void *ctx_, int thread_id, int i) {
+  auto ctx = (gc_compact_task_helper_context *)ctx_;
+  node_gc_compact_element(ctx->meta, ctx->allocator,
+                          ctx->list->get<Element>(i), 0, 1);
+}
+
+// Walks the containers of a pointer SNode in its element list, and moves their
+// children to the front of its NodeManager.
+void node_gc_compact(RuntimeContext *context, Ptr meta, int num_threads) {
+  LLVMRuntime *runtime = context->runtime;
+  auto snode_id = ((StructMeta *)meta)->snode_id;
+  auto allocator = runtime->node_allocators[snode_id];
+  auto list = runtime->element_lists[snode_id];
+#if ARCH_cuda
+  for (int i = block_idx(); i < list->size(); i += grid_dim()) {
+    node_gc_compact_element(meta, allocator, list->get<Element>(i),
+                            thread_idx(), block_dim());
+  }
+#else
+  // One container per task, as in parallel_struct_for.
+  gc_compact_task_helper_context ctx;
+  ctx.meta = meta;
+  ctx.allocator = allocator;
+  ctx.list = list;
+  runtime->parallel_for(runtime->thread_pool, list->size(), num_threads, &ctx,
+                        cpu_node_gc_compact_task);
+#endif
+}
+
+void node_gc_compact_end(LLVMRuntime *runtime, int snode_id) {
+  runtime->node_allocators[snode_id]->compact_end();
+}
+
 void gc_parallel_0(RuntimeContext *context, int snode_id) {
   LLVMRuntime *runtime = context->runtime;
   auto allocator = runtime->node_allocators[snode_id];
@@ -1676,6 +2423,61 @@ i32 rand_i32(RuntimeContext *context) {
 i64 rand_i64(RuntimeContext *context) {
   return rand_u64(context);
 }
+
+// Philox-4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+// 3", SC'11). The result only depends on the key, i.e. the seed and the
+// launch, and the counter, i.e. the loop index |i0, i1, i2| of the calling
+// iteration and the number |n| of random numbers it has drawn before.
+void philox4x32_10(RuntimeContext *context,
+                   u32 i0,
+                   u32 i1,
+                   u32 i2,
+                   u32 n,
+                   u32 *out) {
+  u32 c0 = i0, c1 = i1, c2 = i2, c3 = n;
+  u32 k0 = context->rand_seed, k1 = context->rand_launch_id;
+  for (int round = 0; round < 10; round++) {
+    const u64 p0 = (u64)0xD2511F53u * c0;
+    const u64 p1 = (u64)0xCD9E8D57u * c2;
+    c0 = (u32)(p1 >> 32) ^ c1 ^ k0;
+    c1 = (u32)p1;
+    c2 = (u32)(p0 >> 32) ^ c3 ^ k1;
+    c3 = (u32)p0;
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
+  }
+  out[0] = c0;
+  out[1] = c1;
+}
+
+u32 philox_rand_u32(RuntimeContext *context, u32 i0, u32 i1, u32 i2, u32 n) {
+  u32 out[2];
+  philox4x32_10(context, i0, i1, i2, n, out);
+  return out[0];
+}
+
+u64 philox_rand_u64(RuntimeContext *context, u32 i0, u32 i1, u32 i2, u32 n) {
+  u32 out[2];
+  philox4x32_10(context, i0, i1, i2, n, out);
+  return ((u64)out[0] << 32) + out[1];
+}
+
+f32 philox_rand_f32(RuntimeContext *context, u32 i0, u32 i1, u32 i2, u32 n) {
+  return philox_rand_u32(context, i0, i1, i2, n) * (1.0f / 4294967296.0f);
+}
+
+f64 philox_rand_f64(RuntimeContext *context, u32 i0, u32 i1, u32 i2, u32 n) {
+  return philox_rand_u64(context, i0, i1, i2, n) *
+         (1.0 / 18446744073709551616.0);
+}
+
+i32 philox_rand_i32(RuntimeContext *context, u32 i0, u32 i1, u32 i2, u32 n) {
+  return philox_rand_u32(context, i0, i1, i2, n);
+}
+
+i64 philox_rand_i64(RuntimeContext *context, u32 i0, u32 i1, u32 i2, u32 n) {
+  return philox_rand_u64(context, i0, i1, i2, n);
+}
 };
 
 struct printf_helper {
@@ -1719,6 +2521,7 @@ void taichi_printf(LLVMRuntime *runtime, const char *format, Args &&... args) {
 }
 
 #include "locked_task.h"
+#include "svd3x3.h"
 
 extern "C" {  // local stack operations
 
@@ -0,0 +1,209 @@
+#pragma once
+
+// The singular value decomposition of 3x3 matrices behind ti.svd, following
+// McAdams et al., "Computing the Singular Value Decomposition of 3x3 matrices
+// with minimal branching and elementary floating point operations", which is
+// also what taichi/math/svd.h expands into the IR on the other backends.
+//
+// The eigenvectors V of A^T A are found with Jacobi sweeps of approximate
+// Givens rotations accumulated in a quaternion, the columns of B = AV are
+// sorted by norm, and B = U Sigma is a QR decomposition by Givens rotations.
+// U and V are rotations, and the last singular value may be negative.
+
+#if ARCH_cuda
+extern "C" {
+f32 __nv_sqrtf(f32 x);
+f64 __nv_sqrt(f64 x);
+}
+#endif
+
+// std::sqrt is a call to libm, which does not exist on the GPU.
+inline f32 svd_sqrt(f32 x) {
+#if ARCH_cuda
+  return __nv_sqrtf(x);
+#else
+  return std::sqrt(x);
+#endif
+}
+
+inline f64 svd_sqrt(f64 x) {
+#if ARCH_cuda
+  return __nv_sqrt(x);
+#else
+  return std::sqrt(x);
+#endif
+}
+
+template <typename T>
+struct Svd3x3 {
+  // The rotation angle is pi/4 when the approximation is off too much.
+  static constexpr T kFourGammaSquared = 5.82842712474619;
+  static constexpr T kSinePiOverEight = 0.3826834323650897;
+  static constexpr T kCosinePiOverEight = 0.9238795325112867;
+  // The columns of B shorter than this are taken as zero in the QR.
+  static constexpr T kEpsilon = sizeof(T) == 4 ? 1e-6 : 1e-12;
+
+  static T rsqrt(T x) {
+    return T(1) / svd_sqrt(x);
+  }
+
+  static void cond_swap(bool c, T &x, T &y) {
+    T z = x;
+    x = c ? y : x;
+    y = c ? z : y;
+  }
+
+  // Swaps two columns keeping the determinant.
+  static void cond_neg_swap(bool c, T &x, T &y) {
+    T z = -x;
+    x = c ? y : x;
+    y = c ? z : y;
+  }
+
+  // The quaternion (ch, sh) of the rotation which nearly zeros a21 in
+  // Q^T [a11 a21; a21 a22] Q.
+  static void approximate_givens(T a11, T a21, T a22, T &ch, T &sh) {
+    ch = 2 * (a11 - a22);
+    sh = a21;
+    bool b = kFourGammaSquared * sh * sh < ch * ch;
+    T w = rsqrt(ch * ch + sh * sh);
+    ch = b ? w * ch : kCosinePiOverEight;
+    sh = b ? w * sh : kSinePiOverEight;
+  }
+
+  // Rotates the symmetric S (lower triangle) in the plane of its first two
+  // axes, accumulates the rotation about axis z into q (x, y, z, w), and
+  // cycles the axes of S for the next plane.
+  static void jacobi_conjugation(int x,
+                                 int y,
+                                 int z,
+                                 T &s11,
+                                 T &s21,
+                                 T &s22,
+                                 T &s31,
+                                 T &s32,
+                                 T &s33,
+                                 T *q) {
+    T ch, sh;
+    approximate_givens(s11, s21, s22, ch, sh);
+    T scale = ch * ch + sh * sh;
+    T a = (ch * ch - sh * sh) / scale;
+    T b = (2 * sh * ch) / scale;
+
+    T t11 = s11, t21 = s21, t22 = s22, t31 = s31, t32 = s32, t33 = s33;
+    s11 = a * (a * t11 + b * t21) + b * (a * t21 + b * t22);
+    s21 = a * (-b * t11 + a * t21) + b * (-b * t21 + a * t22);
+    s22 = -b * (-b * t11 + a * t21) + a * (-b * t21 + a * t22);
+    s31 = a * t31 + b * t32;
+    s32 = -b * t31 + a * t32;
+    s33 = t33;
+
+    T t[3] = {q[0] * sh, q[1] * sh, q[2] * sh};
+    sh *= q[3];
+    for (int i = 0; i < 4; i++) {
+      q[i] *= ch;
+    }
+    q[z] += sh;
+    q[3] -= t[z];
+    q[x] += t[y];
+    q[y] -= t[x];
+
+    t11 = s22, t21 = s32, t22 = s33, t31 = s21, t32 = s31, t33 = s11;
+    s11 = t11, s21 = t21, s22 = t22, s31 = t31, s32 = t32, s33 = t33;
+  }
+
+  // The quaternion (ch, sh) of the rotation which zeros a2 in (a1, a2).
+  static void qr_givens(T a1, T a2, T &ch, T &sh) {
+    T rho = svd_sqrt(a1 * a1 + a2 * a2);
+    sh = rho > kEpsilon ? a2 : T(0);
+    ch = (a1 < 0 ? -a1 : a1) + (rho > kEpsilon ? rho : kEpsilon);
+    cond_swap(a1 < 0, sh, ch);
+    T w = rsqrt(ch * ch + sh * sh);
+    ch *= w;
+    sh *= w;
+  }
+
+  // u, v and a are row-major.
+  static void svd(const T *a, int iters, T *u, T *v, T *sigma) {
+    // S = A^T A
+    T s11 = a[0] * a[0] + a[3] * a[3] + a[6] * a[6];
+    T s21 = a[1] * a[0] + a[4] * a[3] + a[7] * a[6];
+    T s22 = a[1] * a[1] + a[4] * a[4] + a[7] * a[7];
+    T s31 = a[2] * a[0] + a[5] * a[3] + a[8] * a[6];
+    T s32 = a[2] * a[1] + a[5] * a[4] + a[8] * a[7];
+    T s33 = a[2] * a[2] + a[5] * a[5] + a[8] * a[8];
+
+    T q[4] = {0, 0, 0, 1};
+    for (int i = 0; i < iters; i++) {
+      jacobi_conjugation(0, 1, 2, s11, s21, s22, s31, s32, s33, q);
+      jacobi_conjugation(1, 2, 0, s11, s21, s22, s31, s32, s33, q);
+      jacobi_conjugation(2, 0, 1, s11, s21, s22, s31, s32, s33, q);
+    }
+    T norm = rsqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    T qx = q[0] * norm, qy = q[1] * norm, qz = q[2] * norm, qw = q[3] * norm;
+    v[0] = 1 - 2 * (qy * qy + qz * qz);
+    v[1] = 2 * (qx * qy - qw * qz);
+    v[2] = 2 * (qx * qz + qw * qy);
+    v[3] = 2 * (qx * qy + qw * qz);
+    v[4] = 1 - 2 * (qx * qx + qz * qz);
+    v[5] = 2 * (qy * qz - qw * qx);
+    v[6] = 2 * (qx * qz - qw * qy);
+    v[7] = 2 * (qy * qz + qw * qx);
+    v[8] = 1 - 2 * (qx * qx + qy * qy);
+
+    // B = AV
+    T b[9];
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        b[i * 3 + j] = a[i * 3] * v[j] + a[i * 3 + 1] * v[3 + j] +
+                       a[i * 3 + 2] * v[6 + j];
+      }
+    }
+
+    // Sorts the columns of B (and V) by decreasing norm.
+    T rho[3];
+    for (int j = 0; j < 3; j++) {
+      rho[j] = b[j] * b[j] + b[3 + j] * b[3 + j] + b[6 + j] * b[6 + j];
+    }
+    const int pairs[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+    for (auto &p : pairs) {
+      bool c = rho[p[0]] < rho[p[1]];
+      for (int i = 0; i < 3; i++) {
+        cond_neg_swap(c, b[i * 3 + p[0]], b[i * 3 + p[1]]);
+        cond_neg_swap(c, v[i * 3 + p[0]], v[i * 3 + p[1]]);
+      }
+      cond_swap(c, rho[p[0]], rho[p[1]]);
+    }
+
+    // B = QR with the rotations Q1 (rows 1, 2), Q2 (rows 1, 3) and
+    // Q3 (rows 2, 3), which zero b21, b31 and b32 in turn.
+    T ch, sh;
+    T c[3], s[3];
+    const int planes[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+    for (int k = 0; k < 3; k++) {
+      int r0 = planes[k][0], r1 = planes[k][1];
+      qr_givens(b[r0 * 3 + r0], b[r1 * 3 + r0], ch, sh);
+      c[k] = 1 - 2 * sh * sh;
+      s[k] = 2 * ch * sh;
+      for (int j = 0; j < 3; j++) {
+        T x = b[r0 * 3 + j], y = b[r1 * 3 + j];
+        b[r0 * 3 + j] = c[k] * x + s[k] * y;
+        b[r1 * 3 + j] = -s[k] * x + c[k] * y;
+      }
+    }
+    // U = Q1 Q2 Q3
+    u[0] = c[0] * c[1];
+    u[1] = -c[2] * s[0] - s[2] * c[0] * s[1];
+    u[2] = s[2] * s[0] - c[2] * c[0] * s[1];
+    u[3] = s[0] * c[1];
+    u[4] = c[2] * c[0] - s[2] * s[0] * s[1];
+    u[5] = -s[2] * c[0] - c[2] * s[0] * s[1];
+    u[6] = s[1];
+    u[7] = s[2] * c[1];
+    u[8] = c[2] * c[1];
+
+    sigma[0] = b[0];
+    sigma[1] = b[4];
+    sigma[2] = b[8];
+  }
+};
@@ -56,10 +56,16 @@ void StructCompilerLLVM::generate_types(SNode &snode) {
       llvm::StructType::create(*ctx, ch_types, snode.node_type_name + "_ch");
 
   snode.cell_size_bytes = tlctx_->get_type_size(ch_type);
+  for (int i = 0, k = 0; i < snode.ch.size(); i++) {
+    if (!snode.ch[i]->is_bit_level) {
+      snode.ch[i]->offset_bytes_in_parent_cell =
+          tlctx_->get_struct_element_offset(ch_type, k++);
+    }
+  }
 
   llvm::Type *body_type = nullptr, *aux_type = nullptr;
   if (type == SNodeType::dense || type == SNodeType::bitmasked) {
-    TI_ASSERT(snode._morton == false);
+    TI_ASSERT(type == SNodeType::dense || !snode._morton);
     body_type = llvm::ArrayType::get(ch_type, snode.max_num_elements());
     if (type == SNodeType::bitmasked) {
       aux_type = llvm::ArrayType::get(llvm::Type::getInt32Ty(*llvm_ctx_),
@@ -127,12 +133,26 @@ void StructCompilerLLVM::generate_types(SNode &snode) {
                                     snode.max_num_elements());
     body_type = llvm::ArrayType::get(llvm::PointerType::getInt8PtrTy(*ctx),
                                      snode.max_num_elements());
+  } else if (type == SNodeType::hash) {
+    // keys and children (see node_hash.h)
+    aux_type = llvm::ArrayType::get(llvm::Type::getInt64Ty(*ctx),
+                                    snode.hash_capacity);
+    body_type = llvm::ArrayType::get(llvm::PointerType::getInt8PtrTy(*ctx),
+                                     snode.hash_capacity);
   } else if (type == SNodeType::dynamic) {
     // mutex and n (number of elements)
     aux_type =
         llvm::StructType::get(*ctx, {llvm::PointerType::getInt32Ty(*ctx),
                                      llvm::PointerType::getInt32Ty(*ctx)});
-    body_type = llvm::PointerType::getInt8PtrTy(*ctx);
+    if (snode.chunk_table) {
+      // the pointers to all the chunks (see node_dynamic.h)
+      body_type = llvm::ArrayType::get(
+          llvm::PointerType::getInt8PtrTy(*ctx),
+          (snode.max_num_elements() + snode.chunk_size - 1) / snode.chunk_size);
+    } else {
+      // the first chunk
+      body_type = llvm::PointerType::getInt8PtrTy(*ctx);
+    }
   } else {
     TI_P(snode.type_name());
     TI_NOT_IMPLEMENTED;
@@ -192,7 +212,23 @@ void StructCompilerLLVM::generate_refine_coordinates(SNode *snode) {
   auto outp_coords = args[1];
   auto l = args[2];
 
-  if (config_->packed) {  // no dependence on POT
+  if (snode->_morton) {
+    for (int i = 0; i < taichi_max_num_indices; i++) {
+      llvm::Value *addition = tlctx_->get_constant(0);
+      for (int b = 0; b < snode->extractors[i].num_bits; b++) {
+        auto bit = builder.CreateAnd(
+            builder.CreateAShr(l, snode->morton_bit_position(i, b)), 1);
+        addition = builder.CreateOr(addition, builder.CreateShl(bit, b));
+      }
+      auto in = call(&builder, "PhysicalCoordinates_get_val", inp_coords,
+                     tlctx_->get_constant(i));
+      in = builder.CreateShl(
+          in, tlctx_->get_constant(snode->extractors[i].num_bits));
+      auto added = builder.CreateOr(in, addition);
+      call(&builder, "PhysicalCoordinates_set_val", outp_coords,
+           tlctx_->get_constant(i), added);
+    }
+  } else if (config_->packed) {  // no dependence on POT
     for (int i = 0; i < taichi_max_num_indices; i++) {
       auto addition = tlctx_->get_constant(0);
       if (snode->extractors[i].shape > 1) {
@@ -309,7 +345,11 @@ void StructCompilerLLVM::run(SNode &root) {
   auto node_type = get_llvm_node_type(module.get(), &root);
   root_size = tlctx_->get_data_layout().getTypeAllocSize(node_type);
 
-  tlctx_->set_struct_module(module);
+  tlctx_->add_struct_module(std::move(module));
+}
+
+std::vector<std::string> StructCompilerLLVM::get_called_runtime_functions() {
+  return {"PhysicalCoordinates_get_val", "PhysicalCoordinates_set_val"};
 }
 
 llvm::Type *StructCompilerLLVM::get_stub(llvm::Module *module,
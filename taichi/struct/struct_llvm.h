@@ -30,6 +30,10 @@ class StructCompilerLLVM : public StructCompiler, public LLVMModuleBuilder {
 
   static std::string type_stub_name(SNode *snode);
 
+  // The runtime functions that the generated accessors call. See
+  // TaichiLLVMContext::new_struct_module().
+  static std::vector<std::string> get_called_runtime_functions();
+
   static llvm::Type *get_stub(llvm::Module *module, SNode *snode, uint32 index);
 
   static llvm::Type *get_llvm_node_type(llvm::Module *module, SNode *snode);
@@ -0,0 +1,196 @@
+#include "taichi/system/device_memory_tracker.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "taichi/system/timeline.h"
+
+TI_NAMESPACE_BEGIN
+
+namespace {
+thread_local std::vector<DeviceMemoryTag> tag_stack;
+
+DeviceMemoryTag get_current_tag() {
+  DeviceMemoryTag tag;
+  for (auto it = tag_stack.rbegin(); it != tag_stack.rend(); ++it) {
+    if (tag.subsystem.empty() && !it->subsystem.empty()) {
+      // The name belongs to the subsystem.
+      tag.subsystem = it->subsystem;
+      tag.name = it->name;
+    }
+    if (tag.callsite.empty()) {
+      tag.callsite = it->callsite;
+    }
+  }
+  if (tag.subsystem.empty()) {
+    tag.subsystem = "untagged";
+  }
+  return tag;
+}
+
+std::string format_bytes(uint64 bytes) {
+  return fmt::format("{:.2f} MB", bytes / 1024.0 / 1024.0);
+}
+}  // namespace
+
+DeviceMemoryTracker &DeviceMemoryTracker::get_instance() {
+  static auto instance = new DeviceMemoryTracker();
+  return *instance;
+}
+
+DeviceMemoryTracker::Scope::Scope(const std::string &subsystem,
+                                  const std::string &name,
+                                  const std::string &callsite)
+    : active_(DeviceMemoryTracker::get_instance().get_enabled()) {
+  if (active_) {
+    push_tag({subsystem, name, callsite});
+  }
+}
+
+DeviceMemoryTracker::Scope::~Scope() {
+  if (active_) {
+    pop_tag();
+  }
+}
+
+void DeviceMemoryTracker::push_tag(const DeviceMemoryTag &tag) {
+  tag_stack.push_back(tag);
+}
+
+void DeviceMemoryTracker::pop_tag() {
+  TI_ASSERT(!tag_stack.empty());
+  tag_stack.pop_back();
+}
+
+void DeviceMemoryTracker::set_enabled(bool enabled) {
+  enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void DeviceMemoryTracker::clear() {
+  std::lock_guard<std::mutex> _(mut_);
+  allocations_.clear();
+  current_bytes_ = 0;
+  peak_bytes_ = 0;
+}
+
+void DeviceMemoryTracker::record_allocation(const void *owner,
+                                            uint64 id,
+                                            uint64 size,
+                                            bool nested) {
+  if (!get_enabled()) {
+    return;
+  }
+  uint64 current_bytes;
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    auto &alloc = allocations_[{owner, id}];
+    if (!alloc.nested) {
+      // Reusing the id of an allocation freed without being recorded.
+      current_bytes_ -= alloc.size;
+    }
+    alloc = {get_current_tag(), size, nested};
+    if (!nested) {
+      current_bytes_ += size;
+      peak_bytes_ = std::max(peak_bytes_, current_bytes_);
+    }
+    current_bytes = current_bytes_;
+  }
+  if (!nested) {
+    Timeline::get_this_thread_instance().insert_counter("device memory",
+                                                        current_bytes);
+  }
+}
+
+void DeviceMemoryTracker::record_deallocation(const void *owner, uint64 id) {
+  if (!get_enabled()) {
+    return;
+  }
+  uint64 current_bytes;
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    auto it = allocations_.find({owner, id});
+    if (it == allocations_.end()) {
+      return;
+    }
+    const bool nested = it->second.nested;
+    if (!nested) {
+      current_bytes_ -= it->second.size;
+    }
+    allocations_.erase(it);
+    if (nested) {
+      return;
+    }
+    current_bytes = current_bytes_;
+  }
+  Timeline::get_this_thread_instance().insert_counter("device memory",
+                                                      current_bytes);
+}
+
+void DeviceMemoryTracker::report_allocation_failure(uint64 size) {
+  if (!get_enabled()) {
+    return;
+  }
+  const auto tag = get_current_tag();
+  TI_WARN("Failed to allocate {} for {} {} {}. The live allocations:\n{}",
+          format_bytes(size), tag.subsystem, tag.name, tag.callsite,
+          get_report());
+}
+
+uint64 DeviceMemoryTracker::get_current_bytes() {
+  std::lock_guard<std::mutex> _(mut_);
+  return current_bytes_;
+}
+
+uint64 DeviceMemoryTracker::get_peak_bytes() {
+  std::lock_guard<std::mutex> _(mut_);
+  return peak_bytes_;
+}
+
+void DeviceMemoryTracker::reset_peak() {
+  std::lock_guard<std::mutex> _(mut_);
+  peak_bytes_ = current_bytes_;
+}
+
+std::vector<DeviceMemoryUsage> DeviceMemoryTracker::get_breakdown() {
+  std::lock_guard<std::mutex> _(mut_);
+  std::map<std::pair<DeviceMemoryTag, bool>, DeviceMemoryUsage> usages;
+  for (auto &[_, alloc] : allocations_) {
+    auto &usage = usages[{alloc.tag, alloc.nested}];
+    usage.tag = alloc.tag;
+    usage.nested = alloc.nested;
+    usage.bytes += alloc.size;
+    usage.count++;
+  }
+  std::vector<DeviceMemoryUsage> breakdown;
+  for (auto &[_, usage] : usages) {
+    breakdown.push_back(usage);
+  }
+  std::stable_sort(breakdown.begin(), breakdown.end(),
+                   [](const DeviceMemoryUsage &a, const DeviceMemoryUsage &b) {
+                     return a.bytes > b.bytes;
+                   });
+  return breakdown;
+}
+
+std::string DeviceMemoryTracker::get_report() {
+  const auto breakdown = get_breakdown();
+  std::stringstream ss;
+  ss << fmt::format("Device memory: {} in use, {} at the peak\n",
+                    format_bytes(get_current_bytes()),
+                    format_bytes(get_peak_bytes()));
+  for (auto &usage : breakdown) {
+    ss << fmt::format("{:>12} {:6d}x {}{}", format_bytes(usage.bytes),
+                      usage.count, usage.nested ? "  (nested) " : "",
+                      usage.tag.subsystem);
+    if (!usage.tag.name.empty()) {
+      ss << " " << usage.tag.name;
+    }
+    if (!usage.tag.callsite.empty()) {
+      ss << " at " << usage.tag.callsite;
+    }
+    ss << "\n";
+  }
+  return ss.str();
+}
+
+TI_NAMESPACE_END
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "taichi/common/core.h"
+
+TI_NAMESPACE_BEGIN
+
+// Where a device allocation comes from.
+struct DeviceMemoryTag {
+  // E.g. "snode_tree", "ndarray" or "ggui".
+  std::string subsystem;
+  // E.g. the SNode tree, or the kind of buffer.
+  std::string name;
+  // The Python line creating it, if any, as "file:line".
+  std::string callsite;
+
+  bool operator<(const DeviceMemoryTag &o) const {
+    return std::tie(subsystem, name, callsite) <
+           std::tie(o.subsystem, o.name, o.callsite);
+  }
+};
+
+// The live allocations with the same tag.
+struct DeviceMemoryUsage {
+  DeviceMemoryTag tag;
+  bool nested{false};
+  uint64 bytes{0};
+  int64 count{0};
+};
+
+/**
+ * Tracks the live device allocations with where they come from, to tell what
+ * fills the memory of a device, e.g. after running out of it.
+ *
+ * The devices record their allocations, which the code allocating tags with a
+ * Scope on the same thread: an allocation gets the subsystem and the name of
+ * the innermost Scope, and the innermost callsite, which the Python frontend
+ * sets around the fields and the ndarrays it creates.
+ *
+ * A nested allocation is carved out of another tracked one, e.g. an SNode tree
+ * out of the memory preallocated by the LLVM runtime. It is listed in the
+ * breakdown, but not counted in the totals.
+ *
+ * While the timeline is enabled, each change of the total is recorded on it as
+ * the "device memory" counter, so that the peak shows up in the trace.
+ */
+class DeviceMemoryTracker {
+ public:
+  static DeviceMemoryTracker &get_instance();
+
+  // Tags the allocations on this thread during its lifetime. Empty fields
+  // are taken from the enclosing Scopes.
+  class Scope {
+   public:
+    Scope(const std::string &subsystem,
+          const std::string &name = "",
+          const std::string &callsite = "");
+
+    ~Scope();
+
+   private:
+    bool active_;
+  };
+
+  // For the Python frontend, which cannot hold a Scope.
+  static void push_tag(const DeviceMemoryTag &tag);
+
+  static void pop_tag();
+
+  bool get_enabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  void set_enabled(bool enabled);
+
+  // Forgets the allocations, e.g. of the devices of a previous Program.
+  void clear();
+
+  // |owner| and |id| identify the allocation, e.g. a Device and an alloc_id.
+  void record_allocation(const void *owner,
+                         uint64 id,
+                         uint64 size,
+                         bool nested = false);
+
+  // Ignores the allocations that were not recorded.
+  void record_deallocation(const void *owner, uint64 id);
+
+  // Warns with the breakdown that |size| more bytes could not be allocated.
+  void report_allocation_failure(uint64 size);
+
+  uint64 get_current_bytes();
+
+  // The highest total since the last reset_peak().
+  uint64 get_peak_bytes();
+
+  void reset_peak();
+
+  // The live allocations by tag, the largest first.
+  std::vector<DeviceMemoryUsage> get_breakdown();
+
+  std::string get_report();
+
+ private:
+  struct Allocation {
+    DeviceMemoryTag tag;
+    uint64 size{0};
+    bool nested{false};
+  };
+
+  std::atomic<bool> enabled_{false};
+  std::mutex mut_;
+  std::map<std::pair<const void *, uint64>, Allocation> allocations_;
+  uint64 current_bytes_{0};
+  uint64 peak_bytes_{0};
+};
+
+TI_NAMESPACE_END
@@ -1,7 +1,12 @@
 #include "memory_pool.h"
-#include "taichi/system/timer.h"
+
+#include <algorithm>
+#include <chrono>
+
 #include "taichi/backends/cuda/cuda_driver.h"
 #include "taichi/backends/cuda/cuda_device.h"
+#include "taichi/system/device_memory_tracker.h"
+#include "taichi/util/metrics.h"
 
 TLANG_NAMESPACE_BEGIN
 
@@ -42,11 +47,22 @@ void *MemoryPool::allocate(std::size_t size, std::size_t alignment) {
   if (!ret) {
     // allocation have failed
     auto new_buffer_size = std::max(size, default_allocator_size);
+    // Mostly on the thread serving the requests of the runtime, e.g. for the
+    // chunks of the sparse SNodes.
+    DeviceMemoryTracker::Scope scope("runtime", "memory pool");
     allocators.emplace_back(
         std::make_unique<UnifiedAllocator>(new_buffer_size, arch_, device_));
     ret = allocators.back()->allocate(size, alignment);
+    static auto &reserved = metrics().counter(
+        "taichi_memory_pool_reserved_bytes",
+        "Bytes reserved by the memory pools for their allocators.");
+    reserved.add(new_buffer_size);
   }
   TI_ASSERT(ret);
+  static auto &allocated = metrics().counter(
+      "taichi_memory_pool_allocated_bytes",
+      "Bytes allocated from the memory pools, e.g. by the sparse SNodes.");
+  allocated.add(size);
   return ret;
 }
 
@@ -83,10 +99,45 @@ void MemoryPool::push(volatile T *dest, const T &val) {
   }
 }
 
+bool MemoryPool::process_requests() {
+  using tail_type = decltype(MemRequestQueue::tail);
+  auto tail = fetch<tail_type>(&queue->tail);
+  if (tail <= processed_tail) {
+    return false;
+  }
+  // The kernels requesting memory are stalled until they get it, so the
+  // requests of a burst are all served at once.
+  while (processed_tail < tail) {
+    // allocate new buffer
+    auto i = processed_tail;
+    TI_DEBUG("Processing memory alloc request {}", i);
+    auto req = fetch<MemRequest>(&queue->requests[i]);
+    if (req.size == 0 || req.alignment == 0) {
+      TI_DEBUG(" Incomplete memory alloc request {} fetched. Waiting", i);
+      break;
+    }
+    TI_DEBUG("  Allocating memory {} B (alignment {}B) ", req.size,
+             req.alignment);
+    auto ptr = allocate(req.size, req.alignment);
+    TI_DEBUG("  Allocated. Ptr = {:p}", ptr);
+    push(&queue->requests[i].ptr, (uint8 *)ptr);
+    processed_tail += 1;
+  }
+  return true;
+}
+
 void MemoryPool::daemon() {
+  // The kernels write the requests to host-visible memory without notifying
+  // the host, so the queue has to be polled. A fixed interval would stall
+  // every request for up to that long: the interval drops to the minimum
+  // once a request comes, and doubles for each poll finding none.
+  constexpr auto kMinPollInterval = std::chrono::microseconds(5);
+  constexpr auto kMaxPollInterval = std::chrono::microseconds(1000);
+  auto poll_interval = kMaxPollInterval;
+  std::unique_lock<std::mutex> lock(mut);
   while (1) {
-    Time::usleep(1000);
-    std::lock_guard<std::mutex> _(mut);
+    terminating_cv_.wait_for(lock, poll_interval,
+                             [this] { return terminating; });
     if (terminating) {
       killed = true;
       break;
@@ -96,23 +147,10 @@ void MemoryPool::daemon() {
     }
 
     // poll allocation requests.
-    using tail_type = decltype(MemRequestQueue::tail);
-    auto tail = fetch<tail_type>(&queue->tail);
-    if (tail > processed_tail) {
-      // allocate new buffer
-      auto i = processed_tail;
-      TI_DEBUG("Processing memory alloc request {}", i);
-      auto req = fetch<MemRequest>(&queue->requests[i]);
-      if (req.size == 0 || req.alignment == 0) {
-        TI_DEBUG(" Incomplete memory alloc request {} fetched. Skipping", i);
-        continue;
-      }
-      TI_DEBUG("  Allocating memory {} B (alignment {}B) ", req.size,
-               req.alignment);
-      auto ptr = allocate(req.size, req.alignment);
-      TI_DEBUG("  Allocated. Ptr = {:p}", ptr);
-      push(&queue->requests[i].ptr, (uint8 *)ptr);
-      processed_tail += 1;
+    if (process_requests()) {
+      poll_interval = kMinPollInterval;
+    } else {
+      poll_interval = std::min(poll_interval * 2, kMaxPollInterval);
     }
   }
 }
@@ -122,6 +160,7 @@ void MemoryPool::terminate() {
     std::lock_guard<std::mutex> _(mut);
     terminating = true;
   }
+  terminating_cv_.notify_all();
   th->join();
   TI_ASSERT(killed);
 #if 0 && defined(TI_WITH_CUDA)
@@ -4,6 +4,7 @@
 #define TI_RUNTIME_HOST
 #include "taichi/runtime/llvm/mem_request.h"
 #include "taichi/backends/device.h"
+#include <condition_variable>
 #include <mutex>
 #include <vector>
 #include <memory>
@@ -11,7 +12,10 @@
 
 TLANG_NAMESPACE_BEGIN
 
-// A memory pool that runs on the host
+// A memory pool that runs on the host, serving the allocation requests of the
+// kernels through the MemRequestQueue when the device memory is not
+// preallocated. The requests are polled by a daemon thread, at short intervals
+// while they keep coming, backing off when they stop.
 
 class MemoryPool {
  public:
@@ -48,7 +52,13 @@ class MemoryPool {
   ~MemoryPool();
 
  private:
+  // Serves all the requests pushed to the queue. Returns whether there were
+  // any. Called with |mut| held.
+  bool process_requests();
+
   static constexpr bool use_cuda_stream = false;
+  // Wakes up the daemon for termination.
+  std::condition_variable terminating_cv_;
   Arch arch_;
   Device *device_;
 };
@@ -0,0 +1,128 @@
+/*******************************************************************************
+    Copyright (c) The Taichi Authors (2016- ). All Rights Reserved.
+    The use of this software is governed by the LICENSE file.
+*******************************************************************************/
+
+#include "taichi/system/numa.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "taichi/system/profiler.h"
+#include "taichi/system/threading.h"
+#include "taichi/system/virtual_memory.h"
+
+#if defined(TI_PLATFORM_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+TI_NAMESPACE_BEGIN
+
+namespace {
+
+// Parses a cpulist such as "0-3,8-11".
+std::vector<int> parse_cpu_list(const std::string &list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty() || item == "\n") {
+      continue;
+    }
+    const auto dash = item.find('-');
+    try {
+      if (dash == std::string::npos) {
+        cpus.push_back(std::stoi(item));
+      } else {
+        const int first = std::stoi(item.substr(0, dash));
+        const int last = std::stoi(item.substr(dash + 1));
+        for (int i = first; i <= last; i++) {
+          cpus.push_back(i);
+        }
+      }
+    } catch (const std::exception &) {
+      return {};
+    }
+  }
+  return cpus;
+}
+
+struct FirstTouchContext {
+  char *begin;
+  std::size_t size;
+  std::size_t block_size;
+};
+
+void first_touch_task(void *ctx, int thread_id, int task_id) {
+  auto *c = (FirstTouchContext *)ctx;
+  const std::size_t begin = task_id * c->block_size;
+  const std::size_t end = std::min(begin + c->block_size, c->size);
+  for (std::size_t i = begin; i < end; i += VirtualMemoryAllocator::page_size) {
+    // A read alone would only map the shared zero page.
+    volatile char *p = c->begin + i;
+    *p = *p;
+  }
+}
+
+}  // namespace
+
+std::vector<int> get_numa_ordered_cpus() {
+  std::vector<int> cpus;
+#if defined(TI_PLATFORM_LINUX)
+  for (int node = 0;; node++) {
+    std::ifstream ifs(
+        fmt::format("/sys/devices/system/node/node{}/cpulist", node));
+    if (!ifs) {
+      break;
+    }
+    std::string list;
+    std::getline(ifs, list);
+    auto node_cpus = parse_cpu_list(list);
+    cpus.insert(cpus.end(), node_cpus.begin(), node_cpus.end());
+  }
+#endif
+  return cpus;
+}
+
+bool pin_this_thread_to_cpu(int cpu) {
+#if defined(TI_PLATFORM_LINUX)
+  if (cpu < 0 || cpu >= CPU_SETSIZE) {
+    return false;
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) ==
+         0;
+#else
+  return false;
+#endif
+}
+
+void numa_first_touch(ThreadPool *pool,
+                      void *ptr,
+                      std::size_t size,
+                      int num_threads) {
+  TI_AUTO_PROF
+  constexpr std::size_t page_size = VirtualMemoryAllocator::page_size;
+  const std::size_t num_pages = (size + page_size - 1) / page_size;
+  if (num_pages == 0) {
+    return;
+  }
+  num_threads = std::max(1, std::min(num_threads, pool->get_max_num_threads()));
+  FirstTouchContext ctx;
+  ctx.begin = (char *)ptr;
+  ctx.size = size;
+  // One contiguous block per thread, just like the static partitioning of the
+  // loops that will access the buffer.
+  const std::size_t pages_per_task =
+      (num_pages + num_threads - 1) / (std::size_t)num_threads;
+  ctx.block_size = pages_per_task * page_size;
+  const int num_tasks = (int)((num_pages + pages_per_task - 1) / pages_per_task);
+  pool->run(num_tasks, num_threads, &ctx, first_touch_task);
+}
+
+TI_NAMESPACE_END
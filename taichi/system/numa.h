@@ -0,0 +1,43 @@
+/*******************************************************************************
+    Copyright (c) The Taichi Authors (2016- ). All Rights Reserved.
+    The use of this software is governed by the LICENSE file.
+*******************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+#include "taichi/common/core.h"
+
+TI_NAMESPACE_BEGIN
+
+class ThreadPool;
+
+/**
+ * Returns the ids of the online CPUs, grouped by NUMA node (node 0 first).
+ * Threads that are pinned in this order and share a loop with contiguous
+ * partitioning hence mostly touch memory of their own node.
+ *
+ * Returns an empty vector if the topology is unknown (e.g. not on Linux).
+ */
+std::vector<int> get_numa_ordered_cpus();
+
+/**
+ * Pins the calling thread to @param cpu. Returns false on failure or if pinning
+ * is not supported on this platform.
+ */
+bool pin_this_thread_to_cpu(int cpu);
+
+/**
+ * Touches each page of [ptr, ptr + size) from the threads of @param pool,
+ * using the same contiguous partitioning as a parallel range-for over the
+ * buffer. With the first-touch policy of the OS, each page is then backed by
+ * memory of the NUMA node of the thread that will access it later. The
+ * contents of the buffer are preserved.
+ */
+void numa_first_touch(ThreadPool *pool,
+                      void *ptr,
+                      std::size_t size,
+                      int num_threads);
+
+TI_NAMESPACE_END
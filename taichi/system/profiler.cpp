@@ -1,5 +1,7 @@
 #include "taichi/system/profiler.h"
 
+#include "taichi/system/timeline.h"
+
 TI_NAMESPACE_BEGIN
 
 // A profiler's records form a tree structure
@@ -230,6 +232,12 @@ void ScopedProfiler::stop() {
     ProfilerRecords::get_this_thread_instance().insert_sample(elapsed);
   }
   ProfilerRecords::get_this_thread_instance().pop();
+  // So that the compilation phases show up with the kernels, see Timelines.
+  if (Timelines::get_instance().get_enabled()) {
+    auto &timeline = Timeline::get_this_thread_instance();
+    timeline.insert_span(name_, start_time_, start_time_ + elapsed,
+                         timeline.get_name());
+  }
 }
 
 void ScopedProfiler::disable() {
@@ -1,5 +1,6 @@
 #include "snode_tree_buffer_manager.h"
 #include "taichi/program/program.h"
+#include "taichi/system/device_memory_tracker.h"
 #ifdef TI_WITH_LLVM
 #include "taichi/llvm/llvm_program.h"
 #endif
@@ -54,6 +55,8 @@ Ptr SNodeTreeBufferManager::allocate(JITModule *runtime_jit,
         taichi_result_buffer_runtime_query_id, result_buffer);
     roots_[snode_tree_id] = ptr;
     sizes_[snode_tree_id] = size;
+    DeviceMemoryTracker::get_instance().record_allocation(
+        this, snode_tree_id, size, /*nested=*/true);
     return ptr;
   } else {
     auto x = *set_it;
@@ -66,6 +69,8 @@ Ptr SNodeTreeBufferManager::allocate(JITModule *runtime_jit,
     TI_ASSERT(x.second);
     roots_[snode_tree_id] = x.second;
     sizes_[snode_tree_id] = size;
+    DeviceMemoryTracker::get_instance().record_allocation(
+        this, snode_tree_id, size, /*nested=*/true);
     return x.second;
   }
 #else
@@ -83,6 +88,9 @@ void SNodeTreeBufferManager::destroy(SNodeTree *snode_tree) {
   }
   Ptr ptr = roots_[snode_tree_id];
   merge_and_insert(ptr, size);
+  // Guards against destroying the tree twice.
+  sizes_[snode_tree_id] = 0;
+  DeviceMemoryTracker::get_instance().record_deallocation(this, snode_tree_id);
   TI_DEBUG("SNode tree {} destroyed.", snode_tree_id);
 }
 
@@ -5,13 +5,39 @@
 
 #include "taichi/system/threading.h"
 
+#include "taichi/system/numa.h"
+#include "taichi/system/timer.h"
+
 #include <algorithm>
 #include <condition_variable>
+#include <exception>
 #include <thread>
 #include <vector>
 
+#if defined(TI_ARCH_x64)
+#include <immintrin.h>
+#endif
+
 TI_NAMESPACE_BEGIN
 
+namespace {
+
+constexpr uint64 kJobAccepting = 1ULL << 63;
+// Roughly tens of microseconds before an idle worker parks.
+constexpr int kNumSpinsBeforeParking = 1 << 14;
+
+inline void cpu_relax() {
+#if defined(TI_ARCH_x64)
+  _mm_pause();
+#elif defined(TI_ARCH_ARM)
+  __asm__ __volatile__("yield");
+#else
+  std::this_thread::yield();
+#endif
+}
+
+}  // namespace
+
 bool test_threading() {
   auto tp = ThreadPool(20);
   for (int j = 0; j < 100; j++) {
@@ -26,18 +52,48 @@ bool test_threading() {
   return true;
 }
 
-ThreadPool::ThreadPool(int max_num_threads) : max_num_threads(max_num_threads) {
-  exiting = false;
-  started = false;
-  running_threads = 0;
-  timestamp = 1;
-  last_finished = 0;
-  task_head = 0;
-  task_tail = 0;
-  thread_counter = 0;
-  threads.resize((std::size_t)max_num_threads);
-  for (int i = 0; i < max_num_threads; i++) {
-    threads[i] = std::thread([this] { this->target(); });
+float64 ThreadPool::JobProfile::get_imbalance_ratio() const {
+  // A worker arriving after all the tasks are taken did not wait for anyone.
+  float64 max_busy = 0, total_busy = 0;
+  int num_busy_threads = 0;
+  for (auto &t : threads) {
+    if (t.num_tasks > 0) {
+      max_busy = std::max(max_busy, t.end - t.start);
+      total_busy += t.end - t.start;
+      num_busy_threads++;
+    }
+  }
+  if (total_busy <= 0) {
+    return 1;
+  }
+  return max_busy * num_busy_threads / total_busy;
+}
+
+float64 ThreadPool::JobProfile::get_max_wakeup_latency() const {
+  float64 latency = 0;
+  for (auto &t : threads) {
+    // The master publishes the job, so only the workers wake up.
+    if (t.thread_id != 0) {
+      latency = std::max(latency, t.start - begin);
+    }
+  }
+  return latency;
+}
+
+ThreadPool::ThreadPool(int max_num_threads, bool pin_threads)
+    : max_num_threads_(std::max(max_num_threads, 1)) {
+  ranges_ = std::make_unique<WorkRange[]>(max_num_threads_);
+  timings_ = std::make_unique<ThreadTimingSlot[]>(max_num_threads_);
+  if (pin_threads) {
+    cpus_ = get_numa_ordered_cpus();
+    if (cpus_.empty()) {
+      TI_WARN("Unable to detect the NUMA topology, threads are not pinned.");
+    }
+  }
+  // Thread 0 is the master thread calling run().
+  threads_.reserve(max_num_threads_ - 1);
+  for (int i = 1; i < max_num_threads_; i++) {
+    threads_.emplace_back([this, i] { this->worker_loop(i); });
   }
 }
 
@@ -45,94 +101,256 @@ void ThreadPool::run(int splits,
                      int desired_num_threads,
                      void *range_for_task_context,
                      RangeForTaskFunc *func) {
-  {
-    std::lock_guard _(mutex);
-    this->range_for_task_context = range_for_task_context;
-    this->func = func;
-    this->desired_num_threads = std::min(desired_num_threads, max_num_threads);
-    TI_ASSERT(this->desired_num_threads > 0);
-    // TI_P(this->desired_num_threads);
-    started = false;
-    task_head = 0;
-    task_tail = splits;
-    timestamp++;
-    TI_ASSERT(timestamp < (1LL << 62));  // avoid overflowing here
-  }
-
-  // wake up all slaves
-  slave_cv.notify_all();
-  {
-    std::unique_lock<std::mutex> lock(mutex);
-    // TODO: the workers may have finished before master waiting on master_cv
-    master_cv.wait(lock, [this] { return started && running_threads == 0; });
+  if (splits <= 0) {
+    return;
   }
-  TI_ASSERT(task_head >= task_tail);
-}
+  // The pool runs one job at a time, and the master of a job is thread 0.
+  std::lock_guard<std::mutex> _(run_mut_);
+  desired_num_threads = std::min(desired_num_threads, max_num_threads_);
+  TI_ASSERT(desired_num_threads > 0);
+  desired_num_threads = std::min(desired_num_threads, splits);
 
-void ThreadPool::target() {
-  uint64 last_timestamp = 0;
-  int thread_id;
-  {
-    std::lock_guard<std::mutex> lock(mutex);
-    thread_id = thread_counter++;
+  const bool profile_job = profiling_.load(std::memory_order_relaxed);
+  const float64 begin_time = profile_job ? Time::get_time() : 0;
+
+  if (desired_num_threads == 1) {
+    // Not worth waking anyone up.
+    for (int i = 0; i < splits; i++) {
+      func(range_for_task_context, 0, i);
+    }
+    if (profile_job) {
+      const auto end_time = Time::get_time();
+      JobProfile profile{begin_time, end_time, splits};
+      profile.threads.push_back({0, begin_time, end_time, splits, 0});
+      std::lock_guard<std::mutex> _(profiles_mut_);
+      job_profiles_.push_back(std::move(profile));
+    }
+    return;
+  }
+
+  // No worker is inside a job at this point, see the end of this function.
+  func_ = func;
+  range_for_task_context_ = range_for_task_context;
+  desired_num_threads_ = desired_num_threads;
+  profile_job_ = profile_job;
+  if (profile_job) {
+    for (int i = 0; i < desired_num_threads; i++) {
+      timings_[i].timing = ThreadTiming{i};
+    }
   }
+  for (int i = 0; i < max_num_threads_; i++) {
+    uint32 begin = 0, end = 0;
+    if (i < desired_num_threads) {
+      begin = (uint32)((int64)splits * i / desired_num_threads);
+      end = (uint32)((int64)splits * (i + 1) / desired_num_threads);
+    }
+    ranges_[i].range.store(pack_range(begin, end), std::memory_order_relaxed);
+  }
+  remaining_tasks_.store(splits, std::memory_order_relaxed);
+
+  job_state_.fetch_or(kJobAccepting);
+  epoch_.fetch_add(1);
+  if (num_parked_.load() > 0) {
+    // Taking the lock guarantees that a worker about to park either sees the
+    // new epoch or gets notified.
+    { std::lock_guard<std::mutex> _(mut_); }
+    worker_cv_.notify_all();
+  }
+
+  // If a task throws on the master thread, keep draining the job so that no
+  // worker is left behind, and rethrow afterwards.
+  std::exception_ptr exception = nullptr;
   while (true) {
-    {
-      std::unique_lock<std::mutex> lock(mutex);
-      slave_cv.wait(lock, [this, last_timestamp, thread_id] {
-        return (timestamp > last_timestamp &&
-                thread_id < desired_num_threads) ||
-               this->exiting;
-      });
-      last_timestamp = timestamp;
-      if (exiting) {
-        break;
-      } else {
-        if (last_finished >= last_timestamp) {
-          continue;
-          // This could happen when part of the desired threads wake up and
-          // finish all the task, and then this thread wake up finding nothing
-          // to do. Should skip this task directly.
-        } else {
-          started = true;
-          running_threads++;
-        }
+    try {
+      do_work(/*thread_id=*/0);
+      break;
+    } catch (...) {
+      if (!exception) {
+        exception = std::current_exception();
       }
+      remaining_tasks_.fetch_sub(1, std::memory_order_release);
     }
+  }
 
-    while (true) {
-      // For a single parallel task
-      int task_id;
-      {
-        task_id = task_head.fetch_add(1, std::memory_order_relaxed);
-        if (task_id >= task_tail)
-          break;
+  int spins = 0;
+  while (remaining_tasks_.load(std::memory_order_acquire) > 0) {
+    if (++spins < kNumSpinsBeforeParking) {
+      cpu_relax();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  // Wait for the workers that are still looking for tasks to leave, so that
+  // the next job can safely overwrite the job description.
+  job_state_.fetch_and(~kJobAccepting);
+  while ((job_state_.load() & ~kJobAccepting) != 0) {
+    cpu_relax();
+  }
+  if (profile_job) {
+    JobProfile profile{begin_time, Time::get_time(), splits};
+    for (int i = 0; i < desired_num_threads; i++) {
+      // Not set if the thread did not get to the job before it was done.
+      if (timings_[i].timing.start > 0) {
+        profile.threads.push_back(timings_[i].timing);
       }
+    }
+    std::lock_guard<std::mutex> _(profiles_mut_);
+    job_profiles_.push_back(std::move(profile));
+  }
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
 
-      func(this->range_for_task_context, thread_id, task_id);
+bool ThreadPool::wait_for_new_epoch(uint64 last_epoch) {
+  for (int i = 0; i < kNumSpinsBeforeParking; i++) {
+    if (epoch_.load(std::memory_order_relaxed) != last_epoch ||
+        exiting_.load(std::memory_order_relaxed)) {
+      return !exiting_.load();
     }
+    cpu_relax();
+  }
+  std::unique_lock<std::mutex> lock(mut_);
+  num_parked_.fetch_add(1);
+  worker_cv_.wait(lock, [this, last_epoch] {
+    return epoch_.load() != last_epoch || exiting_.load();
+  });
+  num_parked_.fetch_sub(1);
+  return !exiting_.load();
+}
+
+bool ThreadPool::try_enter_job() {
+  auto state = job_state_.load();
+  while (state & kJobAccepting) {
+    if (job_state_.compare_exchange_weak(state, state + 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::leave_job() {
+  job_state_.fetch_sub(1);
+}
+
+void ThreadPool::pin_thread(int thread_id) {
+  if (cpus_.empty()) {
+    return;
+  }
+  const int cpu = cpus_[thread_id % cpus_.size()];
+  if (!pin_this_thread_to_cpu(cpu)) {
+    TI_WARN("Failed to pin thread {} to CPU {}", thread_id, cpu);
+  }
+}
+
+void ThreadPool::worker_loop(int thread_id) {
+  pin_thread(thread_id);
+  uint64 last_epoch = 0;
+  while (wait_for_new_epoch(last_epoch)) {
+    const auto observed_epoch = epoch_.load();
+    if (!try_enter_job()) {
+      // The job has already been finished by the other threads.
+      last_epoch = observed_epoch;
+      continue;
+    }
+    last_epoch = epoch_.load();
+    if (thread_id < desired_num_threads_) {
+      do_work(thread_id);
+    }
+    leave_job();
+  }
+}
+
+int ThreadPool::pop_task(int thread_id) {
+  auto &range = ranges_[thread_id].range;
+  auto r = range.load(std::memory_order_relaxed);
+  while (true) {
+    const uint32 begin = r >> 32;
+    const uint32 end = r & 0xffffffffu;
+    if (begin >= end) {
+      return -1;
+    }
+    if (range.compare_exchange_weak(r, pack_range(begin + 1, end),
+                                    std::memory_order_acquire,
+                                    std::memory_order_relaxed)) {
+      return (int)begin;
+    }
+  }
+}
 
-    bool all_finished = false;
-    {
-      std::lock_guard<std::mutex> lock(mutex);
-      running_threads--;
-      if (running_threads == 0) {
-        all_finished = true;
-        last_finished = last_timestamp;
+bool ThreadPool::steal_tasks(int thread_id) {
+  const int n = desired_num_threads_;
+  for (int k = 1; k < n; k++) {
+    auto &victim = ranges_[(thread_id + k) % n].range;
+    auto r = victim.load(std::memory_order_relaxed);
+    while (true) {
+      const uint32 begin = r >> 32;
+      const uint32 end = r & 0xffffffffu;
+      if (begin >= end) {
+        break;
+      }
+      const uint32 num_stolen = (end - begin + 1) / 2;
+      if (victim.compare_exchange_weak(r, pack_range(begin, end - num_stolen),
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        ranges_[thread_id].range.store(pack_range(end - num_stolen, end),
+                                       std::memory_order_release);
+        return true;
       }
     }
-    if (all_finished)
-      master_cv.notify_one();
   }
+  return false;
+}
+
+void ThreadPool::do_work(int thread_id) {
+  ThreadTiming *timing = nullptr;
+  if (profile_job_) {
+    timing = &timings_[thread_id].timing;
+    // The master re-enters after a task throws.
+    if (timing->start == 0) {
+      timing->start = Time::get_time();
+    }
+  }
+  while (true) {
+    const int task_id = pop_task(thread_id);
+    if (task_id < 0) {
+      if (!steal_tasks(thread_id)) {
+        break;
+      }
+      if (timing) {
+        timing->num_steals++;
+      }
+      continue;
+    }
+    func_(range_for_task_context_, thread_id, task_id);
+    remaining_tasks_.fetch_sub(1, std::memory_order_release);
+    if (timing) {
+      timing->num_tasks++;
+    }
+  }
+  if (timing) {
+    timing->end = Time::get_time();
+  }
+}
+
+void ThreadPool::set_profiling(bool profiling) {
+  profiling_.store(profiling, std::memory_order_relaxed);
+}
+
+std::vector<ThreadPool::JobProfile> ThreadPool::fetch_job_profiles() {
+  std::lock_guard<std::mutex> _(profiles_mut_);
+  std::vector<JobProfile> profiles;
+  std::swap(profiles, job_profiles_);
+  return profiles;
 }
 
 ThreadPool::~ThreadPool() {
   {
-    std::lock_guard<std::mutex> lg(mutex);
-    exiting = true;
+    std::lock_guard<std::mutex> _(mut_);
+    exiting_ = true;
   }
-  slave_cv.notify_all();
-  for (auto &th : threads)
+  worker_cv_.notify_all();
+  for (auto &th : threads_)
     th.join();
 }
 
@@ -7,39 +7,68 @@
 
 #include "taichi/common/core.h"
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
+#include <exception>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 TI_NAMESPACE_BEGIN
 
 using RangeForTaskFunc = void(void *, int thread_id, int i);
 using ParallelFor = void(int n, int num_threads, void *, RangeForTaskFunc func);
 
+/**
+ * A work-stealing thread pool for the parallel loops of the CPU backends.
+ *
+ * The calling (master) thread takes part in the loop as thread 0, so a pool of
+ * |max_num_threads| threads owns |max_num_threads - 1| workers. The tasks of a
+ * loop are partitioned into contiguous ranges, one per participating thread.
+ * A thread that drains its own range steals half of a non-empty range from
+ * another one. Idle workers spin for a while before parking on a condition
+ * variable, so that back-to-back launches of small loops do not pay for the
+ * wake-ups.
+ *
+ * If |pin_threads| is set, worker i is pinned to the i-th CPU in NUMA node
+ * order (see get_numa_ordered_cpus()). Contiguous ranges of tasks then stay on
+ * the same socket. The thread calling run() is left unpinned, since the
+ * threads it spawns later (and their libraries) would inherit its affinity.
+ *
+ * run() is not reentrant.
+ */
 class ThreadPool {
  public:
-  std::vector<std::thread> threads;
-  std::condition_variable slave_cv;
-  std::condition_variable master_cv;
-  std::mutex mutex;
-  std::atomic<int> task_head;
-  int task_tail;
-  int running_threads;
-  int max_num_threads;
-  int desired_num_threads;
-  uint64 timestamp;
-  uint64 last_finished;
-  bool started;
-  bool exiting;
-  RangeForTaskFunc *func;
-  void *range_for_task_context;  // Note: this is a pointer to a
-                                 // range_task_helper_context defined in the
-                                 // LLVM runtime, which is different from
-                                 // taichi::lang::Context.
-  int thread_counter;
-
-  ThreadPool(int max_num_threads);
+  // The part of a thread in a job, in seconds of Time::get_time().
+  struct ThreadTiming {
+    int thread_id{0};
+    float64 start{0};
+    float64 end{0};
+    // The tasks it executed, and how many times it stole a range of them.
+    int num_tasks{0};
+    int num_steals{0};
+  };
+
+  // A call to run(), with the threads that took part in it.
+  struct JobProfile {
+    float64 begin{0};
+    float64 end{0};
+    int num_tasks{0};
+    std::vector<ThreadTiming> threads;
+
+    // The busy time of the busiest thread over the mean one, 1 if the threads
+    // executing tasks are perfectly balanced.
+    float64 get_imbalance_ratio() const;
+
+    // The longest time a worker took to start on the job after it was
+    // published, including the wake-up if it was parked.
+    float64 get_max_wakeup_latency() const;
+  };
+
+  explicit ThreadPool(int max_num_threads, bool pin_threads = false);
 
   void run(int splits,
            int desired_num_threads,
@@ -54,9 +83,155 @@ class ThreadPool {
     return pool->run(splits, desired_num_threads, range_for_task_context, func);
   }
 
-  void target();
+  int get_max_num_threads() const {
+    return max_num_threads_;
+  }
+
+  // Records a JobProfile for each following call to run(), at the cost of
+  // reading the clock twice per thread and job.
+  void set_profiling(bool profiling);
+
+  // The jobs profiled since the last call, oldest first.
+  std::vector<JobProfile> fetch_job_profiles();
 
   ~ThreadPool();
+
+ private:
+  // [begin, end) of the task ids owned by a thread, packed into 64 bits so that
+  // the owner and the thieves can update it with a single CAS.
+  struct alignas(64) WorkRange {
+    std::atomic<uint64> range{0};
+  };
+
+  static uint64 pack_range(uint32 begin, uint32 end) {
+    return ((uint64)begin << 32) | end;
+  }
+
+  void worker_loop(int thread_id);
+
+  void pin_thread(int thread_id);
+
+  // Returns false if the pool is exiting.
+  bool wait_for_new_epoch(uint64 last_epoch);
+
+  // Executes tasks until there is nothing left to take or steal.
+  void do_work(int thread_id);
+
+  // Returns the next task id of |thread_id|, or -1 if its range is empty.
+  int pop_task(int thread_id);
+
+  // Moves half of another thread's range into the (empty) range of
+  // |thread_id|. Returns false if no work is left.
+  bool steal_tasks(int thread_id);
+
+  bool try_enter_job();
+
+  void leave_job();
+
+  int max_num_threads_;
+  std::vector<std::thread> threads_;
+  std::unique_ptr<WorkRange[]> ranges_;
+  std::vector<int> cpus_;  // Non-empty if the threads are pinned
+
+  // Describes the current job. Only written by the master while no worker is
+  // inside the job, see |job_state_|.
+  RangeForTaskFunc *func_{nullptr};
+  void *range_for_task_context_{nullptr};  // Note: this is a pointer to a
+                                           // range_task_helper_context defined
+                                           // in the LLVM runtime, which is
+                                           // different from
+                                           // taichi::lang::Context.
+  int desired_num_threads_{0};
+  bool profile_job_{false};
+
+  // Each written by its thread only, while profiling a job.
+  struct alignas(64) ThreadTimingSlot {
+    ThreadTiming timing;
+  };
+  std::unique_ptr<ThreadTimingSlot[]> timings_;
+  std::atomic<bool> profiling_{false};
+  std::mutex profiles_mut_;
+  std::vector<JobProfile> job_profiles_;
+
+  // The highest bit tells whether workers may enter the current job, and the
+  // remaining bits count the workers inside it.
+  std::atomic<uint64> job_state_{0};
+  std::atomic<uint64> epoch_{0};
+  std::atomic<int64> remaining_tasks_{0};
+  std::atomic<bool> exiting_{false};
+
+  // Serializes the jobs of the threads launching kernels concurrently.
+  std::mutex run_mut_;
+
+  // For parking idle workers
+  std::mutex mut_;
+  std::condition_variable worker_cv_;
+  std::atomic<int> num_parked_{0};
 };
 
+// Runs body(begin, end) over [0, n) in blocks of |block_size|, on |pool| if it
+// is not null and there is more than one block, and serially otherwise.
+template <typename Func>
+void parallel_for_blocks(ThreadPool *pool,
+                         int n,
+                         int block_size,
+                         const Func &body) {
+  const int num_blocks = (n + block_size - 1) / block_size;
+  if (pool == nullptr || num_blocks <= 1) {
+    body(0, n);
+    return;
+  }
+  struct Context {
+    const Func *body;
+    int n;
+    int block_size;
+  } ctx{&body, n, block_size};
+  pool->run(num_blocks, pool->get_max_num_threads(), &ctx,
+            [](void *ctx_, int thread_id, int i) {
+              auto ctx = (Context *)ctx_;
+              (*ctx->body)(i * ctx->block_size,
+                           std::min((i + 1) * ctx->block_size, ctx->n));
+            });
+}
+
+// Runs func(thread_id, i) for i in [0, n) on up to |num_threads| threads
+// spawned for the call (one per CPU if |num_threads| is not positive), and
+// rethrows the first exception thrown by |func|. Meant for coarse tasks such
+// as file I/O and compression, outside of the kernel launches that own the
+// ThreadPool.
+template <typename Func>
+void parallel_for_threads(int num_threads, int n, const Func &func) {
+  if (num_threads <= 0) {
+    num_threads = std::max(1, (int)std::thread::hardware_concurrency());
+  }
+  num_threads = std::max(1, std::min(num_threads, n));
+  std::atomic<int> next{0};
+  std::exception_ptr error;
+  std::mutex error_mut;
+  auto worker = [&](int thread_id) {
+    try {
+      for (int i = next++; i < n; i = next++) {
+        func(thread_id, i);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> _(error_mut);
+      if (!error) {
+        error = std::current_exception();
+      }
+      next = n;
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads; i++) {
+    threads.emplace_back(worker, i);
+  }
+  worker(0);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
 TI_NAMESPACE_END
@@ -1,20 +1,65 @@
 #include "taichi/system/timeline.h"
 
+#include <chrono>
+
 TI_NAMESPACE_BEGIN
 
+namespace {
+std::string escape_json(const std::string &str) {
+  std::string escaped;
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+}  // namespace
+
 std::string TimelineEvent::to_json() {
   std::string json{"{"};
   json += fmt::format("\"cat\":\"taichi\",");
   json += fmt::format("\"pid\":0,");
-  json += fmt::format("\"tid\":\"{}\",", tid);
-  json += fmt::format("\"ph\":\"{}\",", begin ? "B" : "E");
-  json += fmt::format("\"name\":\"{}\",", name);
-  json += fmt::format("\"ts\":\"{}\"", uint64(time * 1000000));
+  json += fmt::format("\"tid\":\"{}\",", escape_json(tid));
+  if (counter_value) {
+    json += fmt::format("\"ph\":\"C\",");
+    json += fmt::format("\"args\":{{\"value\":{}}},", *counter_value);
+  } else if (duration >= 0) {
+    json += fmt::format("\"ph\":\"X\",");
+    json += fmt::format("\"dur\":{:.3f},", duration * 1000000);
+  } else {
+    json += fmt::format("\"ph\":\"{}\",", begin ? "B" : "E");
+  }
+  json += fmt::format("\"name\":\"{}\",", escape_json(name));
+  // In microseconds. Perfetto requires a number, unlike chrome://tracing.
+  json += fmt::format("\"ts\":{:.3f}", time * 1000000);
   json += "}";
   return json;
 }
 
-Timeline::Timeline() : tid_("unnamed") {
+namespace {
+// How often the background thread moves the records of the threads out of
+// their ring buffers.
+constexpr auto kFlushInterval = std::chrono::milliseconds(50);
+
+// Much cheaper to read than Time::get_time() on x64, where it is the cycle
+// counter, so that a Guard costs a few nanoseconds.
+uint64 get_ticks() {
+#if defined(TI_ARCH_x64)
+  return Time::get_cycles();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+}  // namespace
+
+Timeline::Timeline()
+    : tid_("unnamed"),
+      tid_id_(Timelines::get_instance().intern(tid_)),
+      ring_(new TimelineRecord[kRingSize]) {
   Timelines::get_instance().insert_timeline(this);
 }
 
@@ -24,46 +69,117 @@ Timeline &Timeline::get_this_thread_instance() {
 }
 
 Timeline::~Timeline() {
-  Timelines::get_instance().insert_events(fetch_events());
   Timelines::get_instance().remove_timeline(this);
 }
 
+void Timeline::set_name(const std::string &tid) {
+  tid_ = tid;
+  tid_id_ = intern(tid);
+}
+
 void Timeline::clear() {
-  std::lock_guard<std::mutex> _(mut_);
-  events_.clear();
+  std::vector<TimelineRecord> dropped;
+  drain(dropped);
 }
+
+int32 Timeline::intern(const std::string &name) {
+  auto it = name_ids_.find(name);
+  if (it == name_ids_.end()) {
+    it = name_ids_.emplace(name, Timelines::get_instance().intern(name)).first;
+  }
+  return it->second;
+}
+
 void Timeline::insert_event(const TimelineEvent &e) {
   if (!Timelines::get_instance().get_enabled())
     return;
-  std::lock_guard<std::mutex> _(mut_);
-  events_.push_back(e);
+  TimelineRecord r;
+  if (e.duration >= 0) {
+    r.kind = TimelineRecord::Kind::span;
+    r.duration = e.duration;
+  } else {
+    r.kind =
+        e.begin ? TimelineRecord::Kind::begin : TimelineRecord::Kind::end;
+  }
+  r.name_id = intern(e.name);
+  r.tid_id = intern(e.tid);
+  r.time = e.time;
+  record(r);
 }
 
-std::vector<TimelineEvent> Timeline::fetch_events() {
-  std::lock_guard<std::mutex> _(mut_);
-  std::vector<TimelineEvent> fetched;
-  std::swap(fetched, events_);
-  return fetched;
+void Timeline::insert_span(const std::string &name,
+                           float64 begin,
+                           float64 end,
+                           const std::string &tid) {
+  if (!Timelines::get_instance().get_enabled())
+    return;
+  TimelineRecord r;
+  r.kind = TimelineRecord::Kind::span;
+  r.name_id = intern(name);
+  r.tid_id = intern(tid);
+  r.time = begin;
+  r.duration = end - begin;
+  record(r);
+}
+
+void Timeline::insert_counter(const std::string &name, float64 value) {
+  if (!Timelines::get_instance().get_enabled())
+    return;
+  TimelineRecord r;
+  r.kind = TimelineRecord::Kind::counter;
+  r.name_id = intern(name);
+  r.tid_id = tid_id_;
+  r.time = Time::get_time();
+  r.duration = value;
+  record(r);
+}
+
+void Timeline::record(const TimelineRecord &r) {
+  const auto head = head_.load(std::memory_order_relaxed);
+  if (head - tail_.load(std::memory_order_acquire) == kRingSize) {
+    Timelines::get_instance().flush(this);
+  }
+  ring_[head & (kRingSize - 1)] = r;
+  head_.store(head + 1, std::memory_order_release);
 }
 
-Timeline::Guard::Guard(const std::string &name) : name_(name) {
+void Timeline::drain(std::vector<TimelineRecord> &records) {
+  const auto tail = tail_.load(std::memory_order_relaxed);
+  const auto head = head_.load(std::memory_order_acquire);
+  for (auto i = tail; i < head; i++) {
+    records.push_back(ring_[i & (kRingSize - 1)]);
+  }
+  tail_.store(head, std::memory_order_release);
+}
+
+Timeline::Guard::Guard(const std::string &name) {
+  if (!Timelines::get_instance().get_enabled())
+    return;
   auto &timeline = Timeline::get_this_thread_instance();
-  timeline.insert_event({name, true, Time::get_time(), timeline.tid_});
+  name_id_ = timeline.intern(name);
+  timeline.record({TimelineRecord::Kind::begin_ticks, name_id_,
+                   timeline.tid_id_, get_ticks()});
 }
 
-Timeline::Guard::~Guard() {
+Timeline::Guard::Guard(int32 name_id) {
+  if (!Timelines::get_instance().get_enabled())
+    return;
+  name_id_ = name_id;
   auto &timeline = Timeline::get_this_thread_instance();
-  timeline.insert_event({name_, false, Time::get_time(), timeline.tid_});
+  timeline.record({TimelineRecord::Kind::begin_ticks, name_id_,
+                   timeline.tid_id_, get_ticks()});
 }
 
-void Timelines::insert_events(const std::vector<TimelineEvent> &events) {
-  std::lock_guard<std::mutex> _(mut_);
-  insert_events_without_locking(events);
+Timeline::Guard::~Guard() {
+  if (name_id_ < 0)
+    return;
+  auto &timeline = Timeline::get_this_thread_instance();
+  timeline.record({TimelineRecord::Kind::end_ticks, name_id_,
+                   timeline.tid_id_, get_ticks()});
 }
 
-void Timelines::insert_events_without_locking(
-    const std::vector<TimelineEvent> &events) {
-  events_.insert(events_.end(), events.begin(), events.end());
+Timelines::Timelines()
+    : start_ticks_(get_ticks()), start_time_(Time::get_time()) {
 }
 
 Timelines &taichi::Timelines::get_instance() {
@@ -71,29 +187,95 @@ Timelines &taichi::Timelines::get_instance() {
   return *instance;
 }
 
+int32 Timelines::intern(const std::string &name) {
+  std::lock_guard<std::mutex> _(names_mut_);
+  auto it = name_ids_.find(name);
+  if (it == name_ids_.end()) {
+    it = name_ids_.emplace(name, (int32)names_.size()).first;
+    names_.push_back(name);
+  }
+  return it->second;
+}
+
+void Timelines::flush(Timeline *timeline) {
+  std::lock_guard<std::mutex> _(mut_);
+  timeline->drain(records_);
+}
+
+void Timelines::flush_all_without_locking() {
+  for (auto timeline : timelines_) {
+    timeline->drain(records_);
+  }
+}
+
 void Timelines::clear() {
   std::lock_guard<std::mutex> _(mut_);
-  events_.clear();
+  records_.clear();
   for (auto timeline : timelines_) {
     timeline->clear();
   }
 }
 
+float64 Timelines::get_ticks_per_second() const {
+#if defined(TI_ARCH_x64)
+  // Over at least a millisecond, for a precise enough estimate.
+  uint64 ticks;
+  float64 time;
+  do {
+    ticks = get_ticks();
+    time = Time::get_time();
+  } while (time - start_time_ < 1e-3);
+  return (float64)(ticks - start_ticks_) / (time - start_time_);
+#else
+  return 1e9;
+#endif
+}
+
+TimelineEvent Timelines::to_event(const TimelineRecord &r,
+                                  float64 ticks_per_second) {
+  using Kind = TimelineRecord::Kind;
+  TimelineEvent e;
+  {
+    std::lock_guard<std::mutex> _(names_mut_);
+    e.name = names_[r.name_id];
+    e.tid = names_[r.tid_id];
+  }
+  if (r.kind == Kind::begin_ticks || r.kind == Kind::end_ticks) {
+    e.time = start_time_ +
+             (float64)(int64)(r.ticks - start_ticks_) / ticks_per_second;
+  } else {
+    e.time = r.time;
+  }
+  e.begin = r.kind == Kind::begin_ticks || r.kind == Kind::begin;
+  if (r.kind == Kind::span) {
+    e.duration = r.duration;
+  } else if (r.kind == Kind::counter) {
+    e.counter_value = r.duration;
+  }
+  return e;
+}
+
 void Timelines::save(const std::string &filename) {
   std::lock_guard<std::mutex> _(mut_);
-  std::sort(timelines_.begin(), timelines_.end(), [](Timeline *a, Timeline *b) {
-    return a->get_name() < b->get_name();
-  });
-  for (auto timeline : timelines_) {
-    insert_events_without_locking(timeline->fetch_events());
+  flush_all_without_locking();
+  const auto ticks_per_second = get_ticks_per_second();
+  std::vector<TimelineEvent> events;
+  events.reserve(records_.size());
+  for (auto &r : records_) {
+    events.push_back(to_event(r, ticks_per_second));
   }
+  // Grouped by track, keeping the order of the events on each.
+  std::stable_sort(events.begin(), events.end(),
+                   [](const TimelineEvent &a, const TimelineEvent &b) {
+                     return a.tid < b.tid;
+                   });
   if (!ends_with(filename, ".json")) {
     TI_WARN("Timeline filename {} should end with '.json'.", filename);
   }
   std::ofstream fout(filename);
   fout << "[";
   bool first = true;
-  for (auto &e : events_) {
+  for (auto &e : events) {
     if (first) {
       first = false;
     } else {
@@ -111,15 +293,31 @@ void Timelines::insert_timeline(Timeline *timeline) {
 
 void Timelines::remove_timeline(Timeline *timeline) {
   std::lock_guard<std::mutex> _(mut_);
+  timeline->drain(records_);
   trash(std::remove(timelines_.begin(), timelines_.end(), timeline));
 }
 
-bool Timelines::get_enabled() {
-  return enabled_;
-}
-
 void Timelines::set_enabled(bool enabled) {
-  enabled_ = enabled;
+  if (enabled == get_enabled())
+    return;
+  enabled_.store(enabled, std::memory_order_relaxed);
+  if (enabled) {
+    stop_flusher_ = false;
+    flusher_ = std::thread([this] {
+      std::unique_lock<std::mutex> lock(mut_);
+      while (!flusher_cv_.wait_for(lock, kFlushInterval,
+                                   [this] { return stop_flusher_; })) {
+        flush_all_without_locking();
+      }
+    });
+  } else {
+    {
+      std::lock_guard<std::mutex> _(mut_);
+      stop_flusher_ = true;
+    }
+    flusher_cv_.notify_all();
+    flusher_.join();
+  }
 }
 
 TI_NAMESPACE_END
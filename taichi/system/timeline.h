@@ -1,7 +1,13 @@
 #pragma once
 
-#include <vector>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "taichi/common/core.h"
 #include "taichi/system/timer.h"
@@ -13,10 +19,39 @@ struct TimelineEvent {
   bool begin;
   float64 time;
   std::string tid;
+  // If non-negative, the event spans |duration| seconds from |time|, and
+  // |begin| is ignored.
+  float64 duration{-1};
+  // If set, the event samples the counter |name| instead, e.g. the memory in
+  // use, which is plotted as a track of its own.
+  std::optional<float64> counter_value;
 
   std::string to_json();
 };
 
+// The compact form of a TimelineEvent in the ring buffers, with the names and
+// the tracks interned by Timelines. Recording one neither allocates nor locks.
+struct TimelineRecord {
+  enum class Kind : uint8 {
+    // Recorded by a Guard, at |ticks| of the cycle counter.
+    begin_ticks,
+    end_ticks,
+    // Recorded with a time in seconds of Time::get_time().
+    begin,
+    end,
+    span,
+    // |duration| is the value of the counter.
+    counter,
+  };
+
+  Kind kind;
+  int32 name_id;
+  int32 tid_id;
+  uint64 ticks{0};
+  float64 time{0};
+  float64 duration{0};
+};
+
 class Timeline {
  public:
   Timeline();
@@ -25,9 +60,7 @@ class Timeline {
 
   static Timeline &get_this_thread_instance();
 
-  void set_name(const std::string &tid) {
-    tid_ = tid;
-  }
+  void set_name(const std::string &tid);
 
   std::string get_name() {
     return tid_;
@@ -37,32 +70,71 @@ class Timeline {
 
   void insert_event(const TimelineEvent &e);
 
-  std::vector<TimelineEvent> fetch_events();
+  // Records |name| from |begin| to |end|, in seconds of Time::get_time(), on
+  // the track |tid|, e.g. the kernels timed on a device. Unlike a Guard, the
+  // span may be recorded after it ends.
+  void insert_span(const std::string &name,
+                   float64 begin,
+                   float64 end,
+                   const std::string &tid);
 
+  // Samples the counter |name| at the current time.
+  void insert_counter(const std::string &name, float64 value);
+
+  // The ID of |name| in Timelines, cached on this thread so that the kernel
+  // names are interned without locking.
+  int32 intern(const std::string &name);
+
+  // Records its lifetime on the timeline of this thread. Cheap if the
+  // timeline is disabled, so that it can guard every kernel launch.
   class Guard {
    public:
     Guard(const std::string &name);
 
+    // |name_id| is interned by Timelines, e.g. once for a static name.
+    Guard(int32 name_id);
+
     ~Guard();
 
    private:
-    std::string name_;
+    int32 name_id_{-1};
   };
 
  private:
+  friend class Timelines;
+
+  // Called on the owning thread only. Flushes the ring buffer itself if the
+  // background flushing does not keep up.
+  void record(const TimelineRecord &r);
+
+  // Moves the records out of the ring buffer. Called under the lock of
+  // Timelines, which serializes the consumers.
+  void drain(std::vector<TimelineRecord> &records);
+
+  // A power of two.
+  static constexpr int64 kRingSize = 4096;
+
   std::string tid_;
-  std::mutex mut_;
-  std::vector<TimelineEvent> events_;
+  int32 tid_id_;
+  std::unordered_map<std::string, int32> name_ids_;
+  // A single-producer single-consumer ring. |head_| is written by the owning
+  // thread only and |tail_| by the consumer only.
+  std::unique_ptr<TimelineRecord[]> ring_;
+  std::atomic<int64> head_{0};
+  std::atomic<int64> tail_{0};
 };
 
-// A timeline system for multi-threaded applications
+// A timeline system for multi-threaded applications. The host threads and the
+// device kernels are saved to the same trace, in the Chrome trace event format
+// (chrome://tracing or https://ui.perfetto.dev).
+//
+// Each thread records to its own Timeline, which a background thread flushes
+// here while the timeline is enabled.
 class Timelines {
  public:
   static Timelines &get_instance();
 
-  void insert_events(const std::vector<TimelineEvent> &events);
-
-  void insert_events_without_locking(const std::vector<TimelineEvent> &events);
+  int32 intern(const std::string &name);
 
   void insert_timeline(Timeline *timeline);
 
@@ -72,20 +144,51 @@ class Timelines {
 
   void save(const std::string &filename);
 
-  bool get_enabled();
+  bool get_enabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
 
   void set_enabled(bool enabled);
 
  private:
+  friend class Timeline;
+
+  Timelines();
+
+  void flush(Timeline *timeline);
+
+  void flush_all_without_locking();
+
+  TimelineEvent to_event(const TimelineRecord &r,
+                         float64 ticks_per_second);
+
+  // Calibrates the cycle counter against Time::get_time() since the start.
+  float64 get_ticks_per_second() const;
+
   std::mutex mut_;
-  std::vector<TimelineEvent> events_;
+  std::vector<TimelineRecord> records_;
   std::vector<Timeline *> timelines_;
-  bool enabled_{false};
+  std::atomic<bool> enabled_{false};
+  uint64 start_ticks_;
+  float64 start_time_;
+
+  std::mutex names_mut_;
+  std::unordered_map<std::string, int32> name_ids_;
+  std::vector<std::string> names_;
+
+  std::thread flusher_;
+  std::condition_variable flusher_cv_;
+  bool stop_flusher_{false};
 };
 
 #define TI_TIMELINE(name) \
   taichi::Timeline::Guard _timeline_guard_##__LINE__(name);
 
-#define TI_AUTO_TIMELINE TI_TIMELINE(__FUNCTION__)
+// The name is interned once per call site.
+#define TI_AUTO_TIMELINE                                            \
+  static const taichi::int32 _timeline_name_id_##__LINE__ =         \
+      taichi::Timelines::get_instance().intern(__FUNCTION__);       \
+  taichi::Timeline::Guard _timeline_guard_##__LINE__(               \
+      _timeline_name_id_##__LINE__);
 
 TI_NAMESPACE_END
@@ -3,7 +3,9 @@
 #include "taichi/common/core.h"
 
 #if defined(TI_PLATFORM_UNIX)
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <unistd.h>
 #else
 #include "taichi/platform/windows/windows.h"
 #endif
@@ -47,6 +49,52 @@ class VirtualMemoryAllocator {
                 page_size);
   }
 
+  // Backed by a file created in |dir| instead of by the swap, so that the OS
+  // reads the pages from the file on demand and writes the dirty pages back
+  // when memory runs low. The file is unlinked at once, and disappears with
+  // the mapping.
+  VirtualMemoryAllocator(size_t size, const std::string &dir) : size(size) {
+#if defined(TI_PLATFORM_UNIX)
+    std::string path = dir + "/taichi_XXXXXX";
+    int fd = mkstemp(path.data());
+    TI_ERROR_IF(fd == -1, "Failed to create a file in {}", dir);
+    unlink(path.c_str());
+    if (ftruncate(fd, size) != 0) {
+      close(fd);
+      TI_ERROR("Failed to extend a file in {} to {} B", dir, size);
+    }
+    ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    TI_ERROR_IF(ptr == MAP_FAILED, "Mapping a file of {} B failed.", size);
+#else
+    TI_ERROR("File-backed memory is only supported on Unix.");
+#endif
+  }
+
+  // Hints that the pages are accessed in address order, so that the OS reads
+  // ahead and drops the pages behind.
+  void advise_sequential() {
+#if defined(TI_PLATFORM_UNIX)
+    madvise(ptr, size, MADV_SEQUENTIAL);
+#endif
+  }
+
+  // Asks the OS to back the range with transparent huge pages (2 MB on
+  // x86-64), so that random accesses miss the TLB less often.
+  void advise_huge_pages() {
+#if defined(TI_PLATFORM_UNIX) && defined(MADV_HUGEPAGE)
+    madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+  }
+
+  // Writes the dirty pages of a file-backed allocation back to the file, or
+  // only starts to unless |wait|.
+  void write_back(bool wait) {
+#if defined(TI_PLATFORM_UNIX)
+    msync(ptr, size, wait ? MS_SYNC : MS_ASYNC);
+#endif
+  }
+
   ~VirtualMemoryAllocator() {
 #if defined(TI_PLATFORM_UNIX)
     if (munmap(ptr, size) != 0)
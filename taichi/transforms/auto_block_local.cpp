@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <set>
+
+#include "taichi/ir/ir.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/transforms/auto_block_local.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+// A field is cached in BLS if each of its elements fetched into BLS saves at
+// least this many global accesses on average.
+constexpr double kMinReuseFactor = 2.0;
+// The static shared memory of a CUDA block.
+constexpr std::size_t kCudaBlsBudgetBytes = 48 * 1024;
+
+struct Candidate {
+  SNode *snode{nullptr};
+  bool read{false};
+  bool accumulated{false};
+  // Why the field is not cached. Empty while it still may be.
+  std::string rejection;
+  // The distinct ranges of the offsets of its indices from the loop indices.
+  std::set<std::vector<std::pair<int, int>>> offsets;
+  double reuse{0};
+  std::size_t bls_size{0};
+};
+
+void auto_block_local_offload(OffloadedStmt *offload,
+                              const CompileConfig &config,
+                              const std::string &kernel_name) {
+  if (offload->task_type != OffloadedStmt::TaskType::struct_for ||
+      !offload->mem_access_opt
+           .get_snodes_with_flag(SNodeAccessFlag::block_local)
+           .empty()) {
+    // The user annotations take precedence.
+    return;
+  }
+  SNode *loop = offload->snode;
+  const int dim = loop->num_active_indices;
+  std::vector<int> block_shape(dim);
+  int block_size = 1;
+  for (int i = 0; i < dim; i++) {
+    block_shape[i] = loop->extractors[loop->physical_index_position[i]].shape;
+    block_size *= block_shape[i];
+  }
+
+  std::vector<Candidate> candidates;
+  std::unordered_map<SNode *, int> candidate_ids;
+  auto record_access = [&](GlobalPtrStmt *ptr, Stmt *user) {
+    if (ptr->width() != 1) {
+      return;
+    }
+    auto *snode = ptr->snodes[0];
+    auto [it, inserted] =
+        candidate_ids.emplace(snode, (int)candidates.size());
+    if (inserted) {
+      candidates.emplace_back().snode = snode;
+    }
+    auto &candidate = candidates[it->second];
+    if (!candidate.rejection.empty()) {
+      return;
+    }
+    if (auto *load = user->cast<GlobalLoadStmt>(); load && load->src == ptr) {
+      candidate.read = true;
+    } else if (auto *atomic = user->cast<AtomicOpStmt>();
+               atomic && atomic->op_type == AtomicOpType::add &&
+               atomic->dest == ptr) {
+      candidate.accumulated = true;
+    } else {
+      candidate.rejection = "written";
+      return;
+    }
+    if ((int)ptr->indices.size() != dim) {
+      candidate.rejection = "indexed unlike the loop";
+      return;
+    }
+    std::vector<std::pair<int, int>> offsets;
+    for (int i = 0; i < dim; i++) {
+      auto diff =
+          irpass::analysis::value_diff_loop_index(ptr->indices[i], offload, i);
+      if (!diff.related() || diff.coeff != 1) {
+        candidate.rejection = "not a stencil of the loop indices";
+        return;
+      }
+      // The high end of a DiffRange is exclusive.
+      offsets.emplace_back(diff.low, diff.high - 1);
+    }
+    candidate.offsets.insert(std::move(offsets));
+  };
+  irpass::analysis::gather_statements(offload->body.get(), [&](Stmt *stmt) {
+    for (auto *operand : stmt->get_operands()) {
+      if (operand && operand->is<GlobalPtrStmt>()) {
+        record_access(operand->as<GlobalPtrStmt>(), stmt);
+      }
+    }
+    return false;
+  });
+
+  // The traffic of a block is |block_size| accesses per distinct offset
+  // without BLS, and the size of the BLS buffer with it.
+  std::vector<Candidate *> accepted;
+  for (auto &candidate : candidates) {
+    auto *snode = candidate.snode;
+    if (!candidate.rejection.empty()) {
+      continue;
+    }
+    if (!snode->dt->is<PrimitiveType>()) {
+      candidate.rejection = "not of a primitive type";
+      continue;
+    }
+    if (candidate.read && candidate.accumulated) {
+      candidate.rejection = "both read and accumulated";
+      continue;
+    }
+    int bls_num_elements = 1;
+    for (int i = 0; i < dim; i++) {
+      const int axis = snode->physical_index_position[i];
+      if (snode->parent->extractors[axis].shape != block_shape[i]) {
+        candidate.rejection = "in blocks unlike those of the loop";
+        break;
+      }
+      int low = std::numeric_limits<int>::max();
+      int high = std::numeric_limits<int>::min();
+      for (auto &offsets : candidate.offsets) {
+        low = std::min(low, offsets[i].first);
+        high = std::max(high, offsets[i].second);
+      }
+      bls_num_elements *= block_shape[i] + high - low;
+    }
+    if (!candidate.rejection.empty()) {
+      continue;
+    }
+    candidate.reuse =
+        (double)candidate.offsets.size() * block_size / bls_num_elements;
+    candidate.bls_size = data_type_size(snode->dt) * bls_num_elements;
+    if (candidate.reuse < kMinReuseFactor) {
+      candidate.rejection =
+          fmt::format("reuse factor {:.2f} too low", candidate.reuse);
+      continue;
+    }
+    accepted.push_back(&candidate);
+  }
+
+  // The fields with the most reuse first, within the budget.
+  const std::size_t budget = arch_is_cpu(config.arch)
+                                 ? (std::size_t)config.cpu_bls_max_size_bytes
+                                 : kCudaBlsBudgetBytes;
+  std::stable_sort(
+      accepted.begin(), accepted.end(),
+      [](Candidate *a, Candidate *b) { return a->reuse > b->reuse; });
+  std::size_t total_bls_size = 0;
+  for (auto *candidate : accepted) {
+    if (total_bls_size + candidate->bls_size > budget) {
+      candidate->rejection =
+          fmt::format("{} bytes over the budget of {} bytes",
+                      candidate->bls_size, budget - total_bls_size);
+      continue;
+    }
+    total_bls_size += candidate->bls_size;
+    offload->mem_access_opt.add_flag(candidate->snode,
+                                     SNodeAccessFlag::block_local);
+  }
+
+  if (config.verbose && !candidates.empty()) {
+    std::string report;
+    for (auto &candidate : candidates) {
+      report += fmt::format("\n  {}: ",
+                            candidate.snode->get_node_type_name_hinted());
+      if (candidate.rejection.empty()) {
+        report += fmt::format("block_local, reuse factor {:.2f}, {} bytes",
+                              candidate.reuse, candidate.bls_size);
+      } else {
+        report += candidate.rejection;
+      }
+    }
+    TI_INFO("(kernel={}) Automatic BLS of the struct-for over {}:{}",
+            kernel_name, loop->get_node_type_name_hinted(), report);
+  }
+}
+
+}  // namespace
+
+const PassID AutoBlockLocalPass::id = "AutoBlockLocalPass";
+
+namespace irpass {
+
+// This pass should happen right before make_block_local
+void auto_block_local(IRNode *root,
+                      const CompileConfig &config,
+                      const AutoBlockLocalPass::Args &args) {
+  TI_AUTO_PROF;
+
+  if (auto root_block = root->cast<Block>()) {
+    for (auto &offload : root_block->statements) {
+      auto_block_local_offload(offload->as<OffloadedStmt>(), config,
+                               args.kernel_name);
+    }
+  } else {
+    auto_block_local_offload(root->as<OffloadedStmt>(), config,
+                             args.kernel_name);
+  }
+}
+
+}  // namespace irpass
+
+TLANG_NAMESPACE_END
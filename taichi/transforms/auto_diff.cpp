@@ -6,6 +6,7 @@
 #include "taichi/ir/visitors.h"
 
 #include <typeinfo>
+#include <unordered_map>
 
 TLANG_NAMESPACE_BEGIN
 
@@ -339,15 +340,18 @@ class MakeAdjoint : public IRVisitor {
   Block *current_block;
   Block *alloca_block;
   std::map<Stmt *, Stmt *> adjoint_stmt;
+  // The reversed loop generated for each primal range-for.
+  std::unordered_map<RangeForStmt *, RangeForStmt *> adjoint_loops;
 
   MakeAdjoint(Block *block) {
     current_block = nullptr;
     alloca_block = block;
   }
 
-  static void run(Block *block) {
+  static std::unordered_map<RangeForStmt *, RangeForStmt *> run(Block *block) {
     auto p = MakeAdjoint(block);
     block->accept(&p);
+    return p.adjoint_loops;
   }
 
   // TODO: current block might not be the right block to insert adjoint
@@ -581,6 +585,7 @@ class MakeAdjoint : public IRVisitor {
     auto new_for = for_stmt->clone();
     auto new_for_ptr = new_for->as<RangeForStmt>();
     new_for_ptr->reversed = !new_for_ptr->reversed;
+    adjoint_loops[for_stmt] = new_for_ptr;
     insert_back(std::move(new_for));
     const int len = new_for_ptr->body->size();
 
@@ -728,6 +733,244 @@ class MakeAdjoint : public IRVisitor {
   }
 };
 
+// Checkpoint the range-fors directly inside an independent block (revolve
+// style). Instead of keeping the values of every iteration on the AD-stacks,
+// the primal loop runs in segments of |interval| iterations and only keeps
+// the values at the end of each segment. The reversed loop restores the values
+// at the beginning of a segment, runs the segment again with all its pushes
+// and then runs the adjoint of the segment. A loop of N iterations then needs
+// about N / interval + interval entries per value instead of N, at the cost of
+// running the primal loop twice.
+//
+// Before:
+//   for i in range(begin, end): primal(i)      # pushes to the stacks S
+//   ...
+//   for i in reversed(range(begin, end)): adjoint(i)
+// After:
+//   for s in range(num_segments):
+//     push a copy of the top of each stack in S
+//     for i in segment(s): primal(i)  # pushes to S replace the top instead
+//   ...
+//   for s in reversed(range(num_segments)):
+//     load and pop the top adjoint of each stack in S
+//     for i in segment(s): primal(i)
+//     accumulate the loaded adjoints to the top of each stack in S
+//     for i in reversed(segment(s)): adjoint(i)
+class CheckpointLoops {
+ public:
+  static void run(
+      Block *block,
+      const std::unordered_map<RangeForStmt *, RangeForStmt *> &adjoint_loops,
+      int interval) {
+    std::vector<RangeForStmt *> loops;
+    for (auto &stmt : block->statements) {
+      if (auto loop = stmt->cast<RangeForStmt>();
+          loop && adjoint_loops.find(loop) != adjoint_loops.end()) {
+        loops.push_back(loop);
+      }
+    }
+    for (auto loop : loops) {
+      checkpoint(loop, adjoint_loops.at(loop), interval);
+    }
+  }
+
+ private:
+  // Returns the bounds of the segment with index |segment| of |loop|, inserted
+  // at the end of |block|.
+  static std::pair<Stmt *, Stmt *> segment_bounds(Block *block,
+                                                  RangeForStmt *loop,
+                                                  Stmt *segment,
+                                                  Stmt *interval) {
+    auto offset = block->insert(
+        Stmt::make<BinaryOpStmt>(BinaryOpType::mul, segment, interval));
+    auto begin = block->insert(
+        Stmt::make<BinaryOpStmt>(BinaryOpType::add, loop->begin, offset));
+    auto next = block->insert(
+        Stmt::make<BinaryOpStmt>(BinaryOpType::add, begin, interval));
+    auto end = block->insert(
+        Stmt::make<BinaryOpStmt>(BinaryOpType::min, next, loop->end));
+    return {begin, end};
+  }
+
+  static std::unique_ptr<RangeForStmt> make_segment_loop(RangeForStmt *loop,
+                                                         Stmt *begin,
+                                                         Stmt *end) {
+    return std::make_unique<RangeForStmt>(
+        begin, end, std::make_unique<Block>(), loop->vectorize,
+        loop->bit_vectorize, loop->num_cpu_threads, loop->block_dim,
+        loop->strictly_serialized);
+  }
+
+  static void checkpoint(RangeForStmt *loop,
+                         RangeForStmt *adjoint_loop,
+                         int interval) {
+    auto block = loop->parent;
+    TI_ASSERT(adjoint_loop->parent == block);
+    if (!loop->begin->ret_type->is_primitive(PrimitiveTypeID::i32) ||
+        !loop->end->ret_type->is_primitive(PrimitiveTypeID::i32)) {
+      return;
+    }
+    // AD-stacks allocated in the loop body are local to an iteration.
+    if (!irpass::analysis::gather_statements(loop->body.get(), [](Stmt *s) {
+           return s->is<AdStackAllocaStmt>();
+         }).empty()) {
+      return;
+    }
+    // The AD-stacks that carry values across iterations.
+    std::vector<Stmt *> stacks;
+    irpass::analysis::gather_statements(loop->body.get(), [&](Stmt *s) {
+      if (auto push = s->cast<AdStackPushStmt>()) {
+        if (std::find(stacks.begin(), stacks.end(), push->stack) ==
+            stacks.end()) {
+          stacks.push_back(push->stack);
+        }
+      }
+      return false;
+    });
+    if (stacks.empty()) {
+      return;
+    }
+
+    // num_segments = (end - begin + interval - 1) / interval
+    auto interval_stmt =
+        loop->insert_before_me(Stmt::make<ConstStmt>(TypedConstant(interval)));
+    auto interval_minus_one = loop->insert_before_me(
+        Stmt::make<ConstStmt>(TypedConstant(interval - 1)));
+    auto zero =
+        loop->insert_before_me(Stmt::make<ConstStmt>(TypedConstant(0)));
+    auto num_iterations = loop->insert_before_me(
+        Stmt::make<BinaryOpStmt>(BinaryOpType::sub, loop->end, loop->begin));
+    auto rounded_up = loop->insert_before_me(Stmt::make<BinaryOpStmt>(
+        BinaryOpType::add, num_iterations, interval_minus_one));
+    auto num_segments = loop->insert_before_me(Stmt::make<BinaryOpStmt>(
+        BinaryOpType::div, rounded_up, interval_stmt));
+
+    // The primal segments only keep the values at the end of each segment.
+    auto primal = make_segment_loop(loop, zero, num_segments);
+    primal->reversed = loop->reversed;
+    {
+      auto body = primal->body.get();
+      auto segment = body->insert(Stmt::make<LoopIndexStmt>(primal.get(), 0));
+      for (auto stack : stacks) {
+        auto top = body->insert(Stmt::make<AdStackLoadTopStmt>(stack));
+        body->insert(Stmt::make<AdStackPushStmt>(stack, top));
+      }
+      auto [begin, end] = segment_bounds(body, loop, segment, interval_stmt);
+      auto segment_loop = std::unique_ptr<Stmt>(
+          (Stmt *)irpass::analysis::clone(loop).release());
+      auto segment_loop_ptr = segment_loop->as<RangeForStmt>();
+      segment_loop_ptr->begin = begin;
+      segment_loop_ptr->end = end;
+      auto pushes = irpass::analysis::gather_statements(
+          segment_loop_ptr->body.get(),
+          [](Stmt *s) { return s->is<AdStackPushStmt>(); });
+      for (auto push : pushes) {
+        push->insert_before_me(
+            Stmt::make<AdStackPopStmt>(push->as<AdStackPushStmt>()->stack));
+      }
+      body->insert(std::move(segment_loop));
+    }
+    loop->insert_before_me(std::move(primal));
+
+    // The adjoint segments recompute their primal values first.
+    auto adjoint = make_segment_loop(loop, zero, num_segments);
+    adjoint->reversed = !loop->reversed;
+    {
+      auto body = adjoint->body.get();
+      auto segment = body->insert(Stmt::make<LoopIndexStmt>(adjoint.get(), 0));
+      auto [begin, end] = segment_bounds(body, loop, segment, interval_stmt);
+      std::vector<Stmt *> adjoints;
+      for (auto stack : stacks) {
+        adjoints.push_back(
+            body->insert(Stmt::make<AdStackLoadTopAdjStmt>(stack)));
+        body->insert(Stmt::make<AdStackPopStmt>(stack));
+      }
+      adjoint_loop->begin = begin;
+      adjoint_loop->end = end;
+      loop->begin = begin;
+      loop->end = end;
+      body->insert(block->extract(loop));
+      for (int i = 0; i < (int)stacks.size(); i++) {
+        body->insert(Stmt::make<AdStackAccAdjointStmt>(stacks[i], adjoints[i]));
+      }
+      adjoint_loop->insert_before_me(std::move(adjoint));
+      body->insert(block->extract(adjoint_loop));
+    }
+  }
+};
+
+// Update the block_local hints of the struct-fors of a gradient kernel. The
+// accesses to an adjoint mirror those to its primal (a read becomes an
+// accumulation and vice versa), so the hint of a primal SNode is propagated to
+// its adjoint, whose contributions are then reduced in BLS per block instead
+// of going through global atomics. Primal SNodes that are no longer accessed
+// lose their hint, since BLS cannot handle a buffer without any access.
+class PropagateBlockLocal : public BasicStmtVisitor {
+ public:
+  using BasicStmtVisitor::visit;
+
+  explicit PropagateBlockLocal(bool block_local_adjoint)
+      : block_local_adjoint_(block_local_adjoint) {
+  }
+
+  void visit(StructForStmt *stmt) override {
+    auto body = stmt->body.get();
+    MemoryAccessOptions mem_access_opt;
+    for (auto &[snode, flags] : stmt->mem_access_opt.get_all()) {
+      for (auto flag : flags) {
+        if (flag != SNodeAccessFlag::block_local ||
+            bls_compatible(body, snode))
+          mem_access_opt.add_flag(snode, flag);
+      }
+    }
+    if (block_local_adjoint_) {
+      for (auto snode : stmt->mem_access_opt.get_snodes_with_flag(
+               SNodeAccessFlag::block_local)) {
+        auto adjoint = snode->get_grad();
+        if (adjoint &&
+            adjoint->num_active_indices == snode->num_active_indices &&
+            bls_compatible(body, adjoint))
+          mem_access_opt.add_flag(adjoint, SNodeAccessFlag::block_local);
+      }
+    }
+    stmt->mem_access_opt = mem_access_opt;
+    body->accept(this);
+  }
+
+  static void run(IRNode *root, bool block_local_adjoint) {
+    PropagateBlockLocal pass(block_local_adjoint);
+    root->accept(&pass);
+  }
+
+ private:
+  // BLS supports either read-only or accumulation-only accesses.
+  static bool bls_compatible(Block *body, SNode *snode) {
+    auto on_snode = [&](Stmt *ptr) {
+      auto global_ptr = ptr->cast<GlobalPtrStmt>();
+      return global_ptr && global_ptr->snodes[0] == snode;
+    };
+    bool has_read = false, has_accumulate = false, has_write = false;
+    irpass::analysis::gather_statements(body, [&](Stmt *s) {
+      if (auto load = s->cast<GlobalLoadStmt>()) {
+        has_read |= on_snode(load->src);
+      } else if (auto store = s->cast<GlobalStoreStmt>()) {
+        has_write |= on_snode(store->dest);
+      } else if (auto atomic = s->cast<AtomicOpStmt>()) {
+        if (on_snode(atomic->dest)) {
+          if (atomic->op_type == AtomicOpType::add)
+            has_accumulate = true;
+          else
+            has_write = true;
+        }
+      }
+      return false;
+    });
+    return !has_write && (has_read != has_accumulate);
+  }
+
+  bool block_local_adjoint_;
+};
+
 class BackupSSA : public BasicStmtVisitor {
  public:
   using BasicStmtVisitor::visit;
@@ -822,11 +1065,308 @@ class BackupSSA : public BasicStmtVisitor {
   }
 };
 
+// Generate the dual values of forward-mode AD (Jacobian-vector products).
+// Every real primal value gets its dual value computed right after it, and
+// every real local variable gets a dual local variable, so the dual fields of
+// the inputs are propagated to the dual fields of the outputs in a single pass
+// without AD-stacks. A null dual value stands for zero.
+class MakeDual : public BasicStmtVisitor {
+ private:
+  Stmt *current_stmt_{nullptr};
+  std::unordered_map<Stmt *, Stmt *> dual_;
+  std::unordered_map<Stmt *, Stmt *> dual_alloca_;
+
+  Stmt *insert_back(std::unique_ptr<Stmt> &&stmt) {
+    current_stmt_ = current_stmt_->insert_after_me(std::move(stmt));
+    return current_stmt_;
+  }
+
+  template <typename T, typename... Args>
+  Stmt *insert(Args &&... args) {
+    return insert_back(Stmt::make<T>(args...));
+  }
+
+  Stmt *constant(float32 x) {
+    return insert<ConstStmt>(TypedConstant(x));
+  }
+
+  Stmt *zero(DataType dt) {
+    return insert<ConstStmt>(TypedConstant(dt));
+  }
+
+  Stmt *dual(Stmt *stmt) {
+    auto it = dual_.find(stmt);
+    return it == dual_.end() ? nullptr : it->second;
+  }
+
+  void set_dual(Stmt *primal, Stmt *dual) {
+    if (dual != nullptr && needs_grad(primal->ret_type)) {
+      dual_[primal] = dual;
+    }
+  }
+
+  Stmt *dual_or_zero(Stmt *stmt) {
+    auto d = dual(stmt);
+    return d ? d : zero(stmt->ret_type);
+  }
+
+  // utils
+  Stmt *unary(UnaryOpType op, Stmt *x) {
+    return insert<UnaryOpStmt>(op, x);
+  }
+
+  Stmt *binary(BinaryOpType op, Stmt *lhs, Stmt *rhs) {
+    return insert<BinaryOpStmt>(op, lhs, rhs);
+  }
+
+  // The helpers below take dual values as their first operands.
+  Stmt *add(Stmt *d1, Stmt *d2) {
+    if (!d1)
+      return d2;
+    if (!d2)
+      return d1;
+    return binary(BinaryOpType::add, d1, d2);
+  }
+
+  Stmt *sub(Stmt *d1, Stmt *d2) {
+    if (!d2)
+      return d1;
+    if (!d1)
+      return unary(UnaryOpType::neg, d2);
+    return binary(BinaryOpType::sub, d1, d2);
+  }
+
+  Stmt *mul(Stmt *d, Stmt *x) {
+    return d ? binary(BinaryOpType::mul, d, x) : nullptr;
+  }
+
+  Stmt *div(Stmt *d, Stmt *x) {
+    return d ? binary(BinaryOpType::div, d, x) : nullptr;
+  }
+
+  Stmt *dual_ptr(Stmt *ptr) {
+    auto global_ptr = ptr->cast<GlobalPtrStmt>();
+    if (!global_ptr) {
+      return nullptr;
+    }
+    TI_ASSERT(global_ptr->width() == 1);
+    auto snodes = global_ptr->snodes;
+    if (!snodes[0]->has_dual()) {
+      return nullptr;
+    }
+    snodes[0] = snodes[0]->get_dual();
+    return insert<GlobalPtrStmt>(snodes, global_ptr->indices);
+  }
+
+ public:
+  using BasicStmtVisitor::visit;
+
+  static void run(IRNode *root) {
+    MakeDual pass;
+    root->accept(&pass);
+  }
+
+  void visit(Block *block) override {
+    std::vector<Stmt *> statements;
+    // always make a copy since the list can be modified.
+    for (auto &stmt : block->statements) {
+      statements.push_back(stmt.get());
+    }
+    for (auto stmt : statements) {
+      current_stmt_ = stmt;
+      stmt->accept(this);
+    }
+  }
+
+  void visit(AllocaStmt *alloca) override {
+    TI_ASSERT(alloca->width() == 1);
+    if (needs_grad(alloca->ret_type)) {
+      dual_alloca_[alloca] = insert<AllocaStmt>(1, alloca->ret_type);
+    }
+  }
+
+  void visit(LocalLoadStmt *stmt) override {
+    TI_ASSERT(stmt->width() == 1);
+    auto it = dual_alloca_.find(stmt->src[0].var);
+    if (it != dual_alloca_.end()) {
+      set_dual(stmt, insert<LocalLoadStmt>(LocalAddress(it->second, 0)));
+    }
+  }
+
+  void visit(LocalStoreStmt *stmt) override {
+    TI_ASSERT(stmt->width() == 1);
+    auto it = dual_alloca_.find(stmt->dest);
+    if (it != dual_alloca_.end()) {
+      insert<LocalStoreStmt>(it->second, dual_or_zero(stmt->val));
+    }
+  }
+
+  void visit(UnaryOpStmt *stmt) override {
+    auto x = stmt->operand;
+    auto dx = dual(x);
+    if (!dx || !needs_grad(stmt->ret_type)) {
+      return;
+    }
+    Stmt *d = nullptr;
+    if (stmt->op_type == UnaryOpType::floor ||
+        stmt->op_type == UnaryOpType::ceil ||
+        stmt->op_type == UnaryOpType::round ||
+        stmt->op_type == UnaryOpType::sgn) {
+      // do nothing
+    } else if (stmt->op_type == UnaryOpType::neg) {
+      d = unary(UnaryOpType::neg, dx);
+    } else if (stmt->op_type == UnaryOpType::abs) {
+      d = mul(dx, unary(UnaryOpType::sgn, x));
+    } else if (stmt->op_type == UnaryOpType::sin) {
+      d = mul(dx, unary(UnaryOpType::cos, x));
+    } else if (stmt->op_type == UnaryOpType::cos) {
+      d = unary(UnaryOpType::neg, mul(dx, unary(UnaryOpType::sin, x)));
+    } else if (stmt->op_type == UnaryOpType::tan) {
+      // d tan(x) = (1 + tan(x)^2) dx
+      d = mul(dx, binary(BinaryOpType::add, constant(1),
+                         binary(BinaryOpType::mul, stmt, stmt)));
+    } else if (stmt->op_type == UnaryOpType::tanh) {
+      d = mul(dx, binary(BinaryOpType::sub, constant(1),
+                         binary(BinaryOpType::mul, stmt, stmt)));
+    } else if (stmt->op_type == UnaryOpType::asin ||
+               stmt->op_type == UnaryOpType::acos) {
+      d = div(dx, unary(UnaryOpType::sqrt,
+                        binary(BinaryOpType::sub, constant(1),
+                               binary(BinaryOpType::mul, x, x))));
+      if (stmt->op_type == UnaryOpType::acos) {
+        d = unary(UnaryOpType::neg, d);
+      }
+    } else if (stmt->op_type == UnaryOpType::exp) {
+      d = mul(dx, stmt);
+    } else if (stmt->op_type == UnaryOpType::log) {
+      d = div(dx, x);
+    } else if (stmt->op_type == UnaryOpType::sqrt) {
+      d = div(dx, binary(BinaryOpType::mul, constant(2), stmt));
+    } else if (stmt->op_type == UnaryOpType::cast_value) {
+      if (is_real(stmt->cast_type) && is_real(x->ret_type)) {
+        auto cast = Stmt::make_typed<UnaryOpStmt>(UnaryOpType::cast_value, dx);
+        cast->cast_type = stmt->cast_type;
+        d = insert_back(std::move(cast));
+      }
+    } else {
+      TI_P(unary_op_type_name(stmt->op_type));
+      TI_NOT_IMPLEMENTED
+    }
+    set_dual(stmt, d);
+  }
+
+  void visit(BinaryOpStmt *bin) override {
+    auto dl = dual(bin->lhs);
+    auto dr = dual(bin->rhs);
+    if ((!dl && !dr) || !needs_grad(bin->ret_type)) {
+      return;
+    }
+    Stmt *d = nullptr;
+    if (bin->op_type == BinaryOpType::add) {
+      d = add(dl, dr);
+    } else if (bin->op_type == BinaryOpType::sub) {
+      d = sub(dl, dr);
+    } else if (bin->op_type == BinaryOpType::mul) {
+      // d (x * y) = y * dx + x * dy
+      d = add(mul(dl, bin->rhs), mul(dr, bin->lhs));
+    } else if (bin->op_type == BinaryOpType::div) {
+      // d (x / y) = dx / y - x * dy / y^2
+      d = sub(div(dl, bin->rhs),
+              div(mul(dr, bin->lhs),
+                  binary(BinaryOpType::mul, bin->rhs, bin->rhs)));
+    } else if (bin->op_type == BinaryOpType::atan2) {
+      auto denominator = binary(BinaryOpType::add,
+                                binary(BinaryOpType::mul, bin->lhs, bin->lhs),
+                                binary(BinaryOpType::mul, bin->rhs, bin->rhs));
+      d = div(sub(mul(dl, bin->rhs), mul(dr, bin->lhs)), denominator);
+    } else if (bin->op_type == BinaryOpType::pow) {
+      // d (x ^ y) = x ^ (y-1) * (y * dx + log(x) * x * dy)
+      auto common_coeff =
+          binary(BinaryOpType::pow, bin->lhs,
+                 binary(BinaryOpType::sub, bin->rhs, constant(1)));
+      Stmt *dx_term = nullptr, *dy_term = nullptr;
+      if (dl) {
+        dx_term = mul(dl, binary(BinaryOpType::mul, bin->rhs, common_coeff));
+      }
+      if (dr) {
+        dy_term = mul(dr, binary(BinaryOpType::mul,
+                                 unary(UnaryOpType::log, bin->lhs),
+                                 binary(BinaryOpType::mul, bin->lhs,
+                                        common_coeff)));
+      }
+      d = add(dx_term, dy_term);
+    } else if (bin->op_type == BinaryOpType::min ||
+               bin->op_type == BinaryOpType::max) {
+      auto cmp = bin->op_type == BinaryOpType::min
+                     ? binary(BinaryOpType::cmp_lt, bin->lhs, bin->rhs)
+                     : binary(BinaryOpType::cmp_lt, bin->rhs, bin->lhs);
+      d = insert<TernaryOpStmt>(TernaryOpType::select, cmp,
+                                dual_or_zero(bin->lhs), dual_or_zero(bin->rhs));
+    } else if (bin->op_type == BinaryOpType::mod ||
+               bin->op_type == BinaryOpType::floordiv ||
+               is_comparison(bin->op_type) || is_bit_op(bin->op_type)) {
+      // do nothing
+    } else {
+      TI_WARN("gradient of binary op {}", binary_op_type_name(bin->op_type));
+      TI_NOT_IMPLEMENTED
+    }
+    set_dual(bin, d);
+  }
+
+  void visit(TernaryOpStmt *stmt) override {
+    TI_ASSERT(stmt->op_type == TernaryOpType::select);
+    if (!dual(stmt->op2) && !dual(stmt->op3)) {
+      return;
+    }
+    set_dual(stmt,
+             insert<TernaryOpStmt>(TernaryOpType::select, stmt->op1,
+                                   dual_or_zero(stmt->op2),
+                                   dual_or_zero(stmt->op3)));
+  }
+
+  void visit(GlobalLoadStmt *stmt) override {
+    if (!needs_grad(stmt->ret_type)) {
+      return;
+    }
+    if (auto ptr = dual_ptr(stmt->src)) {
+      set_dual(stmt, insert<GlobalLoadStmt>(ptr));
+    }
+  }
+
+  void visit(GlobalStoreStmt *stmt) override {
+    if (!needs_grad(stmt->val->ret_type)) {
+      return;
+    }
+    if (auto ptr = dual_ptr(stmt->dest)) {
+      insert<GlobalStoreStmt>(ptr, dual_or_zero(stmt->val));
+    }
+  }
+
+  void visit(AtomicOpStmt *stmt) override {
+    auto dv = dual(stmt->val);
+    if (!dv) {
+      return;
+    }
+    if (stmt->op_type != AtomicOpType::add &&
+        stmt->op_type != AtomicOpType::sub) {
+      TI_ERROR("Forward-mode autodiff only supports atomic add and sub.");
+    }
+    if (auto ptr = dual_ptr(stmt->dest)) {
+      insert<AtomicOpStmt>(stmt->op_type, ptr, dv);
+    }
+  }
+};
+
 namespace irpass {
 
-void auto_diff(IRNode *root, const CompileConfig &config, bool use_stack) {
+void auto_diff(IRNode *root,
+               const CompileConfig &config,
+               AutodiffMode autodiff_mode,
+               bool use_stack) {
   TI_AUTO_PROF;
-  if (use_stack) {
+  if (autodiff_mode == AutodiffMode::forward) {
+    MakeDual::run(root);
+  } else if (use_stack) {
     auto IB = IdentifyIndependentBlocks::run(root);
     ReverseOuterLoops::run(root, IB);
 
@@ -835,7 +1375,10 @@ void auto_diff(IRNode *root, const CompileConfig &config, bool use_stack) {
       ReplaceLocalVarWithStacks replace(config.ad_stack_size);
       ib->accept(&replace);
       type_check(root, config);
-      MakeAdjoint::run(ib);
+      auto adjoint_loops = MakeAdjoint::run(ib);
+      if (config.ad_checkpoint_interval > 0) {
+        CheckpointLoops::run(ib, adjoint_loops, config.ad_checkpoint_interval);
+      }
       type_check(root, config);
       BackupSSA::run(ib);
       irpass::analysis::verify(root);
@@ -848,6 +1391,8 @@ void auto_diff(IRNode *root, const CompileConfig &config, bool use_stack) {
       MakeAdjoint::run(ib);
     }
   }
+  if (autodiff_mode == AutodiffMode::reverse)
+    PropagateBlockLocal::run(root, config.ad_block_local_adjoint);
   type_check(root, config);
   irpass::analysis::verify(root);
 }
@@ -16,6 +16,8 @@ class BitLoopVectorize : public IRVisitor {
   bool in_struct_for_loop;
   StructForStmt *loop_stmt;
   PrimitiveType *bit_array_physical_type;
+  // The local adders and the comparisons below assume 1-bit elements.
+  int bit_array_element_num_bits;
   std::unordered_map<Stmt *, std::vector<Stmt *>> transformed_atomics;
 
   BitLoopVectorize() {
@@ -25,6 +27,7 @@ class BitLoopVectorize : public IRVisitor {
     in_struct_for_loop = false;
     loop_stmt = nullptr;
     bit_array_physical_type = nullptr;
+    bit_array_element_num_bits = 0;
   }
 
   void visit(Block *stmt_list) override {
@@ -49,76 +52,83 @@ class BitLoopVectorize : public IRVisitor {
         DataType new_ret_type(ptr_physical_type);
         ptr->ret_type = new_ret_type;
         ptr->is_bit_vectorized = true;
-        // check if j has offset
-        if (ptr->indices.size() == 2) {
-          auto diff = irpass::analysis::value_diff_loop_index(ptr->indices[1],
-                                                              loop_stmt, 1);
-          // TODO: temporarily we only support [j - 1] and [j + 1]
-          //       the general case should be easy to implement
-          if (diff.linear_related() && diff.certain() &&
-              (diff.low == 1 || diff.low == -1)) {
-            // construct ptr to x[i, j]
-            auto indices = ptr->indices;
-            indices[1] = loop_stmt->body->statements[1].get();
-            auto base_ptr =
-                std::make_unique<GlobalPtrStmt>(ptr->snodes, indices);
-            base_ptr->ret_type = new_ret_type;
-            base_ptr->is_bit_vectorized = true;
-            // load x[i, j](base)
-            DataType load_data_type(bit_array_physical_type);
-            auto load_base = std::make_unique<GlobalLoadStmt>(base_ptr.get());
-            load_base->ret_type = load_data_type;
-            // load x[i, j + 1](offsetted)
-            // since we are doing vectorization, the actual data should be x[i,
-            // j + vectorization_width]
-            auto offset_constant =
-                std::make_unique<ConstStmt>(TypedConstant(bit_vectorize));
-            auto offset_index_opcode =
-                diff.low == -1 ? BinaryOpType::sub : BinaryOpType::add;
-            auto offset_index = std::make_unique<BinaryOpStmt>(
-                offset_index_opcode, indices[1], offset_constant.get());
-            indices[1] = offset_index.get();
-            auto offset_ptr =
-                std::make_unique<GlobalPtrStmt>(ptr->snodes, indices);
-            offset_ptr->ret_type = new_ret_type;
-            offset_ptr->is_bit_vectorized = true;
-            auto load_offsetted =
-                std::make_unique<GlobalLoadStmt>(offset_ptr.get());
-            load_offsetted->ret_type = load_data_type;
-            // create bit shift and bit and operations
-            auto base_shift_offset =
-                std::make_unique<ConstStmt>(TypedConstant(load_data_type, 1));
-            auto base_shift_opcode =
-                diff.low == -1 ? BinaryOpType::bit_shl : BinaryOpType::bit_sar;
-            auto base_shift_op = std::make_unique<BinaryOpStmt>(
-                base_shift_opcode, load_base.get(), base_shift_offset.get());
+        // check if the vectorized index has an offset
+        const int axis = (int)ptr->indices.size() - 1;
+        auto bit_array_type = ptr->snodes[0]->parent->dt->cast<BitArrayType>();
+        auto loop_index = get_loop_index(axis);
+        if (axis < 0 || !bit_array_type || !loop_index) {
+          return;
+        }
+        // The number of elements and the bits of each element in a word
+        const int num_elements = bit_array_type->get_num_elements();
+        const int element_num_bits = bit_array_type->get_element_num_bits();
+        auto diff = irpass::analysis::value_diff_loop_index(ptr->indices[axis],
+                                                            loop_stmt, axis);
+        if (diff.linear_related() && diff.certain() && diff.low != 0 &&
+            std::abs(diff.low) < num_elements) {
+          const int shift = std::abs(diff.low);
+          // construct ptr to x[i, j]
+          auto indices = ptr->indices;
+          indices[axis] = loop_index;
+          auto base_ptr = std::make_unique<GlobalPtrStmt>(ptr->snodes, indices);
+          base_ptr->ret_type = new_ret_type;
+          base_ptr->is_bit_vectorized = true;
+          // load x[i, j](base)
+          DataType load_data_type(bit_array_physical_type);
+          auto load_base = std::make_unique<GlobalLoadStmt>(base_ptr.get());
+          load_base->ret_type = load_data_type;
+          // load x[i, j + shift](offsetted)
+          // since we are doing vectorization, the actual data should be the
+          // adjacent word, x[i, j + num_elements]
+          auto offset_constant =
+              std::make_unique<ConstStmt>(TypedConstant(num_elements));
+          auto offset_index_opcode =
+              diff.low < 0 ? BinaryOpType::sub : BinaryOpType::add;
+          auto offset_index = std::make_unique<BinaryOpStmt>(
+              offset_index_opcode, indices[axis], offset_constant.get());
+          indices[axis] = offset_index.get();
+          auto offset_ptr =
+              std::make_unique<GlobalPtrStmt>(ptr->snodes, indices);
+          offset_ptr->ret_type = new_ret_type;
+          offset_ptr->is_bit_vectorized = true;
+          auto load_offsetted =
+              std::make_unique<GlobalLoadStmt>(offset_ptr.get());
+          load_offsetted->ret_type = load_data_type;
+          // create bit shift and bit and operations, which move the elements
+          // by |shift| slots, taking the missing ones from the adjacent word
+          auto base_shift_offset = std::make_unique<ConstStmt>(
+              TypedConstant(load_data_type, shift * element_num_bits));
+          auto base_shift_opcode =
+              diff.low < 0 ? BinaryOpType::bit_shl : BinaryOpType::bit_sar;
+          auto base_shift_op = std::make_unique<BinaryOpStmt>(
+              base_shift_opcode, load_base.get(), base_shift_offset.get());
 
-            auto offsetted_shift_offset = std::make_unique<ConstStmt>(
-                TypedConstant(load_data_type, bit_vectorize - 1));
-            auto offsetted_shift_opcode =
-                diff.low == -1 ? BinaryOpType::bit_sar : BinaryOpType::bit_shl;
-            auto offsetted_shift_op = std::make_unique<BinaryOpStmt>(
-                offsetted_shift_opcode, load_offsetted.get(),
-                offsetted_shift_offset.get());
+          auto offsetted_shift_offset =
+              std::make_unique<ConstStmt>(TypedConstant(
+                  load_data_type, (num_elements - shift) * element_num_bits));
+          auto offsetted_shift_opcode =
+              diff.low < 0 ? BinaryOpType::bit_sar : BinaryOpType::bit_shl;
+          auto offsetted_shift_op = std::make_unique<BinaryOpStmt>(
+              offsetted_shift_opcode, load_offsetted.get(),
+              offsetted_shift_offset.get());
 
-            auto or_op = std::make_unique<BinaryOpStmt>(
-                BinaryOpType::bit_or, base_shift_op.get(),
-                offsetted_shift_op.get());
-            // modify IR
-            auto offsetted_shift_op_p = offsetted_shift_op.get();
-            stmt->insert_before_me(std::move(base_ptr));
-            stmt->insert_before_me(std::move(load_base));
-            stmt->insert_before_me(std::move(offset_constant));
-            stmt->insert_before_me(std::move(offset_index));
-            stmt->insert_before_me(std::move(offset_ptr));
-            stmt->insert_before_me(std::move(load_offsetted));
-            stmt->insert_before_me(std::move(base_shift_offset));
-            stmt->insert_before_me(std::move(base_shift_op));
-            stmt->insert_before_me(std::move(offsetted_shift_offset));
-            stmt->insert_before_me(std::move(offsetted_shift_op));
-            stmt->replace_usages_with(or_op.get());
-            offsetted_shift_op_p->insert_after_me(std::move(or_op));
-          }
+          auto or_op = std::make_unique<BinaryOpStmt>(BinaryOpType::bit_or,
+                                                      base_shift_op.get(),
+                                                      offsetted_shift_op.get());
+          // modify IR
+          auto offsetted_shift_op_p = offsetted_shift_op.get();
+          stmt->insert_before_me(std::move(base_ptr));
+          stmt->insert_before_me(std::move(load_base));
+          stmt->insert_before_me(std::move(offset_constant));
+          stmt->insert_before_me(std::move(offset_index));
+          stmt->insert_before_me(std::move(offset_ptr));
+          stmt->insert_before_me(std::move(load_offsetted));
+          stmt->insert_before_me(std::move(base_shift_offset));
+          stmt->insert_before_me(std::move(base_shift_op));
+          stmt->insert_before_me(std::move(offsetted_shift_offset));
+          stmt->insert_before_me(std::move(offsetted_shift_op));
+          stmt->replace_usages_with(or_op.get());
+          offsetted_shift_op_p->insert_after_me(std::move(or_op));
         }
       }
     }
@@ -149,17 +159,21 @@ class BitLoopVectorize : public IRVisitor {
     in_struct_for_loop = true;
     loop_stmt = stmt;
     bit_array_physical_type = stmt->snode->physical_type;
+    bit_array_element_num_bits =
+        stmt->snode->dt->as<BitArrayType>()->get_element_num_bits();
     stmt->body->accept(this);
     bit_vectorize = old_bit_vectorize;
     in_struct_for_loop = false;
     loop_stmt = nullptr;
     bit_array_physical_type = nullptr;
+    bit_array_element_num_bits = 0;
   }
 
   void visit(BinaryOpStmt *stmt) override {
     // vectorize cmp_eq and bit_and between
     // vectorized data(local adder/array elems) and constant
-    if (in_struct_for_loop && bit_vectorize != 1) {
+    if (in_struct_for_loop && bit_vectorize != 1 &&
+        bit_array_element_num_bits == 1) {
       if (stmt->op_type == BinaryOpType::bit_and) {
         // if the rhs is a bit vectorized stmt and lhs is a const 1
         // (usually generated by boolean expr), we simply replace
@@ -244,6 +258,10 @@ class BitLoopVectorize : public IRVisitor {
     DataType dt(bit_array_physical_type);
     if (in_struct_for_loop && bit_vectorize != 1 &&
         stmt->op_type == AtomicOpType::add) {
+      TI_ERROR_IF(bit_array_element_num_bits != 1,
+                  "Bit-level vectorization of {}-bit elements supports "
+                  "only copies, shifted loads and bitwise operations",
+                  bit_array_element_num_bits);
       auto it = transformed_atomics.find(stmt->dest);
       // process a transformed atomic stmt
       if (it != transformed_atomics.end()) {
@@ -266,6 +284,18 @@ class BitLoopVectorize : public IRVisitor {
     }
   }
 
+  // The index along |axis| of the loop being vectorized, i.e. the first
+  // element of the word.
+  Stmt *get_loop_index(int axis) {
+    for (auto &s : loop_stmt->body->statements) {
+      if (auto index = s->cast<LoopIndexStmt>();
+          index && index->loop == loop_stmt && index->index == axis) {
+        return index;
+      }
+    }
+    return nullptr;
+  }
+
   static void run(IRNode *node) {
     BitLoopVectorize inst;
     node->accept(&inst);
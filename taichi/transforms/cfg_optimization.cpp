@@ -2,11 +2,20 @@
 #include "taichi/ir/control_flow_graph.h"
 #include "taichi/ir/transforms.h"
 #include "taichi/ir/analysis.h"
+#include "taichi/ir/pass_profiler.h"
 #include "taichi/system/profiler.h"
 
 TLANG_NAMESPACE_BEGIN
 
 namespace irpass {
+namespace {
+// Each round of store-to-load forwarding and dead store elimination needs the
+// analyses to be redone on the whole graph. A result that is still modified
+// after this many rounds is returned as is; full_simplify() calls this pass
+// again since the IR is modified.
+constexpr int kMaxCfgOptimizationIterations = 16;
+}  // namespace
+
 bool cfg_optimization(
     IRNode *root,
     bool after_lower_access,
@@ -15,7 +24,9 @@ bool cfg_optimization(
   TI_AUTO_PROF;
   auto cfg = analysis::build_cfg(root);
   bool result_modified = false;
+  int iterations = 0;
   while (true) {
+    iterations++;
     bool modified = false;
     cfg->simplify_graph();
     if (cfg->store_to_load_forwarding(after_lower_access))
@@ -26,6 +37,14 @@ bool cfg_optimization(
       result_modified = true;
     else
       break;
+    if (iterations == kMaxCfgOptimizationIterations) {
+      TI_TRACE("cfg_optimization stopped after {} iterations", iterations);
+      break;
+    }
+  }
+  if (PassProfiler::get_instance().get_enabled()) {
+    PassProfiler::get_instance().record_iterations("cfg_optimization",
+                                                   iterations);
   }
   // TODO: implement cfg->dead_instruction_elimination()
   die(root);  // remove unused allocas
@@ -1,3 +1,4 @@
+#include "taichi/ir/analysis.h"
 #include "taichi/ir/ir.h"
 #include "taichi/ir/statements.h"
 #include "taichi/ir/transforms.h"
@@ -15,9 +16,14 @@ class CheckOutOfBound : public BasicStmtVisitor {
   std::set<int> visited;
   DelayedIRModifier modifier;
   std::string kernel_name;
-
-  explicit CheckOutOfBound(const std::string &kernel_name)
-      : BasicStmtVisitor(), visited(), kernel_name(kernel_name) {
+  // See CompileConfig::check_out_of_bound_deferred.
+  bool deferred;
+
+  CheckOutOfBound(const std::string &kernel_name, bool deferred)
+      : BasicStmtVisitor(),
+        visited(),
+        kernel_name(kernel_name),
+        deferred(deferred) {
   }
 
   bool is_done(Stmt *stmt) {
@@ -39,6 +45,13 @@ class CheckOutOfBound : public BasicStmtVisitor {
     // TODO: implement bound check here for other situations.
   }
 
+  // Whether |index| is proven to be in [0, size), in which case the access
+  // needs no check along this axis.
+  static bool is_in_bound(Stmt *index, int size) {
+    auto range = irpass::analysis::value_range(index);
+    return range.related() && range.low >= 0 && range.high <= size;
+  }
+
   void visit(GlobalPtrStmt *stmt) override {
     if (is_done(stmt))
       return;
@@ -55,25 +68,38 @@ class CheckOutOfBound : public BasicStmtVisitor {
                     snode->get_node_type_name_hinted());
     std::string offset_msg = "offset (";
     std::vector<Stmt *> args;
+    std::vector<Stmt *> checked_indices;
+    bool checked = false;
     for (int i = 0; i < stmt->indices.size(); i++) {
       int offset_i = has_offset ? snode->index_offsets[i] : 0;
 
       // Note that during lower_ast, index arguments to GlobalPtrStmt are
       // already converted to [0, +inf) range.
 
-      auto lower_bound = zero;
-      auto check_lower_bound = new_stmts.push_back<BinaryOpStmt>(
-          BinaryOpType::cmp_ge, stmt->indices[i], lower_bound);
       int size_i = snode->shape_along_axis(i);
-      int upper_bound_i = size_i;
-      auto upper_bound = new_stmts.push_back<ConstStmt>(
-          LaneAttribute<TypedConstant>(upper_bound_i));
-      auto check_upper_bound = new_stmts.push_back<BinaryOpStmt>(
-          BinaryOpType::cmp_lt, stmt->indices[i], upper_bound);
-      auto check_i = new_stmts.push_back<BinaryOpStmt>(
-          BinaryOpType::bit_and, check_lower_bound, check_upper_bound);
-      result = new_stmts.push_back<BinaryOpStmt>(BinaryOpType::bit_and, result,
-                                                 check_i);
+      checked_indices.push_back(stmt->indices[i]);
+      if (!is_in_bound(stmt->indices[i], size_i)) {
+        checked = true;
+        auto lower_bound = zero;
+        auto check_lower_bound = new_stmts.push_back<BinaryOpStmt>(
+            BinaryOpType::cmp_ge, stmt->indices[i], lower_bound);
+        int upper_bound_i = size_i;
+        auto upper_bound = new_stmts.push_back<ConstStmt>(
+            LaneAttribute<TypedConstant>(upper_bound_i));
+        auto check_upper_bound = new_stmts.push_back<BinaryOpStmt>(
+            BinaryOpType::cmp_lt, stmt->indices[i], upper_bound);
+        auto check_i = new_stmts.push_back<BinaryOpStmt>(
+            BinaryOpType::bit_and, check_lower_bound, check_upper_bound);
+        result = new_stmts.push_back<BinaryOpStmt>(BinaryOpType::bit_and,
+                                                   result, check_i);
+        if (deferred) {
+          // The thread carries on after a deferred assertion, so the access
+          // is redirected to the first element instead, like in
+          // simplify.cpp for the linearized indices.
+          checked_indices.back() = new_stmts.push_back<TernaryOpStmt>(
+              TernaryOpType::select, check_i, stmt->indices[i], zero);
+        }
+      }
       if (i > 0) {
         msg += ", ";
         offset_msg += ", ";
@@ -99,15 +125,22 @@ class CheckOutOfBound : public BasicStmtVisitor {
     }
     msg += ")";
 
-    new_stmts.push_back<AssertStmt>(result, msg, args);
-    modifier.insert_before(stmt, std::move(new_stmts));
     set_done(stmt);
+    if (!checked) {
+      return;
+    }
+    auto assert = new_stmts.push_back<AssertStmt>(result, msg, args);
+    assert->deferred = deferred;
+    modifier.insert_before(stmt, std::move(new_stmts));
+    for (int i = 0; i < stmt->indices.size(); i++) {
+      stmt->indices[i] = checked_indices[i];
+    }
   }
 
   static bool run(IRNode *node,
                   const CompileConfig &config,
                   const std::string &kernel_name) {
-    CheckOutOfBound checker(kernel_name);
+    CheckOutOfBound checker(kernel_name, config.check_out_of_bound_deferred);
     bool modified = false;
     while (true) {
       node->accept(&checker);
@@ -2,11 +2,15 @@
 #include "taichi/ir/transforms.h"
 #include "taichi/ir/analysis.h"
 #include "taichi/ir/pass.h"
+#include "taichi/ir/pass_profiler.h"
 #include "taichi/ir/visitors.h"
 #include "taichi/program/compile_config.h"
 #include "taichi/program/extension.h"
 #include "taichi/program/function.h"
 #include "taichi/program/kernel.h"
+#include "taichi/program/parallel_executor.h"
+#include "taichi/program/program.h"
+#include "taichi/system/timer.h"
 
 TLANG_NAMESPACE_BEGIN
 
@@ -15,15 +19,41 @@ namespace {
 
 std::function<void(const std::string &)>
 make_pass_printer(bool verbose, const std::string &kernel_name, IRNode *ir) {
-  if (!verbose) {
+  auto &profiler = PassProfiler::get_instance();
+  if (!verbose && !profiler.get_enabled()) {
     return [](const std::string &) {};
   }
-  return [ir, kernel_name](const std::string &pass) {
-    TI_INFO("[{}] {}:", kernel_name, pass);
-    std::cout << std::flush;
-    irpass::re_id(ir);
-    irpass::print(ir);
-    std::cout << std::flush;
+  // The time and the size of the IR at the last call, i.e. before |pass|.
+  struct Checkpoint {
+    float64 time{0};
+    int num_stmts{0};
+  };
+  auto last = std::make_shared<Checkpoint>();
+  if (profiler.get_enabled()) {
+    last->num_stmts = irpass::analysis::count_statements(ir);
+    last->time = Time::get_time();
+  }
+  return [ir, kernel_name, verbose, last](const std::string &pass) {
+    auto &profiler = PassProfiler::get_instance();
+    const bool profile = profiler.get_enabled();
+    if (profile) {
+      const auto end = Time::get_time();
+      const int num_stmts = irpass::analysis::count_statements(ir);
+      profiler.record_pass(kernel_name, pass, last->time, end,
+                           last->num_stmts, num_stmts);
+      last->num_stmts = num_stmts;
+    }
+    if (verbose) {
+      TI_INFO("[{}] {}:", kernel_name, pass);
+      std::cout << std::flush;
+      irpass::re_id(ir);
+      irpass::print(ir);
+      std::cout << std::flush;
+    }
+    if (profile) {
+      // Leave out the cost of counting and printing.
+      last->time = Time::get_time();
+    }
   };
 }
 
@@ -34,7 +64,7 @@ void compile_to_offloads(IRNode *ir,
                          Kernel *kernel,
                          bool verbose,
                          bool vectorize,
-                         bool grad,
+                         AutodiffMode autodiff_mode,
                          bool ad_use_stack,
                          bool start_from_ast) {
   TI_AUTO_PROF;
@@ -42,7 +72,7 @@ void compile_to_offloads(IRNode *ir,
   auto print = make_pass_printer(verbose, kernel->get_name(), ir);
   print("Initial IR");
 
-  if (grad) {
+  if (autodiff_mode == AutodiffMode::reverse) {
     irpass::reverse_segments(ir);
     print("Segment reversed (for autodiff)");
   }
@@ -57,7 +87,7 @@ void compile_to_offloads(IRNode *ir,
   irpass::analysis::verify(ir);
 
   if (kernel->is_evaluator) {
-    TI_ASSERT(!grad);
+    TI_ASSERT(autodiff_mode == AutodiffMode::none);
 
     irpass::demote_operations(ir, config);
     print("Operations demoted");
@@ -91,7 +121,21 @@ void compile_to_offloads(IRNode *ir,
   print("Simplified I");
   irpass::analysis::verify(ir);
 
-  if (irpass::inlining(ir, config, {})) {
+  if (config.lazy_compilation) {
+    // Inlines a level of calls at a time and simplifies in between, so that
+    // the calls in the branches made dead by the arguments of their callers
+    // are removed before the bodies of the functions are generated. See
+    // Function::set_function_body_lazily().
+    bool inlined = false;
+    while (irpass::inlining(ir, config, {/*single_level=*/true})) {
+      irpass::full_simplify(ir, config, {false, kernel->program});
+      inlined = true;
+    }
+    if (inlined) {
+      print("Functions inlined");
+      irpass::analysis::verify(ir);
+    }
+  } else if (irpass::inlining(ir, config, {})) {
     print("Functions inlined");
     irpass::analysis::verify(ir);
   }
@@ -100,12 +144,12 @@ void compile_to_offloads(IRNode *ir,
     irpass::analysis::gather_meshfor_relation_types(ir);
   }
 
-  if (grad) {
+  if (autodiff_mode != AutodiffMode::none) {
     // Remove local atomics here so that we don't have to handle their gradients
     irpass::demote_atomics(ir, config);
 
     irpass::full_simplify(ir, config, {false, kernel->program});
-    irpass::auto_diff(ir, config, ad_use_stack);
+    irpass::auto_diff(ir, config, autodiff_mode, ad_use_stack);
     irpass::full_simplify(ir, config, {false, kernel->program});
     print("Gradient");
     irpass::analysis::verify(ir);
@@ -125,6 +169,11 @@ void compile_to_offloads(IRNode *ir,
   print("Simplified II");
   irpass::analysis::verify(ir);
 
+  if (config.hoist_uniform_values && irpass::hoist_uniform_values(ir)) {
+    print("Uniform values hoisted");
+    irpass::analysis::verify(ir);
+  }
+
   irpass::offload(ir, config);
   print("Offloaded");
   irpass::analysis::verify(ir);
@@ -137,6 +186,17 @@ void compile_to_offloads(IRNode *ir,
     irpass::analysis::verify(ir);
   }
 
+  if (config.fuse_offloads && irpass::fuse_offloads(ir, config)) {
+    print("Offloads fused");
+    irpass::analysis::verify(ir);
+  }
+
+  if (config.unroll_inner_loop_factor > 1 &&
+      irpass::unroll_inner_loops(ir, config)) {
+    print("Inner loops unrolled");
+    irpass::analysis::verify(ir);
+  }
+
   irpass::flag_access(ir);
   print("Access flagged II");
 
@@ -155,6 +215,30 @@ void offload_to_executable(IRNode *ir,
                            bool make_block_local) {
   TI_AUTO_PROF;
 
+  // The offloaded tasks are independent after offloading, so that their
+  // passes may run concurrently, like the async engine runs them per task.
+  // Their IR dumps would interleave though.
+  if (auto *root = ir->cast<Block>();
+      root && root->size() > 1 && config.num_compile_threads > 1 && !verbose) {
+    ParallelExecutor workers(
+        "ir_pass_worker",
+        std::min(config.num_compile_threads, (int)root->size()));
+    for (auto &task : root->statements) {
+      TI_ASSERT(task->is<OffloadedStmt>());
+      workers.enqueue([&config, kernel, task = task.get(),
+                       determine_ad_stack_size, lower_global_access,
+                       make_thread_local, make_block_local]() {
+        offload_to_executable(task, config, kernel, /*verbose=*/false,
+                              determine_ad_stack_size, lower_global_access,
+                              make_thread_local, make_block_local);
+      });
+    }
+    workers.flush();
+    // Each task has been re-id'd on its own.
+    irpass::re_id(ir);
+    return;
+  }
+
   auto print = make_pass_printer(verbose, kernel->get_name(), ir);
 
   // TODO: This is just a proof that we can demote struct-fors after offloading.
@@ -172,12 +256,31 @@ void offload_to_executable(IRNode *ir,
     print("Detect read-only accesses");
   }
 
+  if (auto *advisor = kernel->program->layout_advisor.get();
+      advisor && !kernel->is_accessor && !kernel->is_evaluator) {
+    advisor->record_tasks(kernel, ir);
+  }
+  if (auto *report = kernel->program->access_pattern_report.get();
+      report && !kernel->is_accessor && !kernel->is_evaluator) {
+    report->record_tasks(kernel, ir);
+  }
+
+  // Before the dense struct-fors are demoted to range-fors.
+  if (!kernel->is_accessor && !kernel->is_evaluator) {
+    kernel->program->record_stencil_footprints(ir);
+  }
+
   irpass::demote_atomics(ir, config);
   print("Atomics demoted I");
   irpass::analysis::verify(ir);
 
   if (config.demote_dense_struct_fors) {
-    irpass::demote_dense_struct_fors(ir, config.packed);
+    if (arch_is_cpu(config.arch) && config.cpu_struct_for_tile_size > 0) {
+      irpass::tile_dense_struct_fors(ir, config.cpu_struct_for_tile_size);
+      print("Dense struct-for tiled");
+    }
+    irpass::demote_dense_struct_fors(ir, config.packed,
+                                     config.demote_bitmasked_struct_fors);
     irpass::type_check(ir, config);
     print("Dense struct-for demoted");
     irpass::analysis::verify(ir);
@@ -208,6 +311,10 @@ void offload_to_executable(IRNode *ir,
   }
 
   if (make_block_local) {
+    if (config.auto_block_local) {
+      irpass::auto_block_local(ir, config, {kernel->get_name()});
+      print("Auto block local");
+    }
     irpass::make_block_local(ir, config, {kernel->get_name()});
     print("Make block local");
   }
@@ -272,7 +379,7 @@ void compile_to_executable(IRNode *ir,
                            const CompileConfig &config,
                            Kernel *kernel,
                            bool vectorize,
-                           bool grad,
+                           AutodiffMode autodiff_mode,
                            bool ad_use_stack,
                            bool verbose,
                            bool lower_global_access,
@@ -281,13 +388,14 @@ void compile_to_executable(IRNode *ir,
                            bool start_from_ast) {
   TI_AUTO_PROF;
 
-  compile_to_offloads(ir, config, kernel, verbose, vectorize, grad,
+  compile_to_offloads(ir, config, kernel, verbose, vectorize, autodiff_mode,
                       ad_use_stack, start_from_ast);
 
-  offload_to_executable(ir, config, kernel, verbose,
-                        /*determine_ad_stack_size=*/grad && ad_use_stack,
-                        lower_global_access, make_thread_local,
-                        make_block_local);
+  offload_to_executable(
+      ir, config, kernel, verbose,
+      /*determine_ad_stack_size=*/autodiff_mode == AutodiffMode::reverse &&
+          ad_use_stack,
+      lower_global_access, make_thread_local, make_block_local);
 }
 
 void compile_inline_function(IRNode *ir,
@@ -75,8 +75,12 @@ void convert_to_range_for(OffloadedStmt *offloaded, bool packed) {
       for (int j = 0; j < (int)physical_indices.size(); j++) {
         auto p = physical_indices[j];
         auto ext = snode->extractors[p];
-        auto index = generate_mod_x_div_y(
-            &body_header, extracted, ext.acc_shape * ext.shape, ext.acc_shape);
+        auto index = snode->_morton
+                         ? generate_morton_decode(&body_header, snode,
+                                                  extracted, p)
+                         : generate_mod_x_div_y(&body_header, extracted,
+                                                ext.acc_shape * ext.shape,
+                                                ext.acc_shape);
         total_shape[p] /= ext.shape;
         auto multiplier =
             body_header.push_back<ConstStmt>(TypedConstant(total_shape[p]));
@@ -97,9 +101,13 @@ void convert_to_range_for(OffloadedStmt *offloaded, bool packed) {
       for (int j = 0; j < (int)physical_indices.size(); j++) {
         auto p = physical_indices[j];
         auto ext = snode->extractors[p];
-        Stmt *delta = body_header.push_back<BitExtractStmt>(
-            main_loop_var, ext.acc_offset + offset,
-            ext.acc_offset + offset + ext.num_bits);
+        Stmt *delta =
+            snode->_morton
+                ? generate_morton_decode(&body_header, snode, main_loop_var,
+                                         p, offset)
+                : body_header.push_back<BitExtractStmt>(
+                      main_loop_var, ext.acc_offset + offset,
+                      ext.acc_offset + offset + ext.num_bits);
         start_bits[p] -= ext.num_bits;
         auto multiplier =
             body_header.push_back<ConstStmt>(TypedConstant(1 << start_bits[p]));
@@ -132,6 +140,27 @@ void convert_to_range_for(OffloadedStmt *offloaded, bool packed) {
     }
   }
 
+  // The cells of the inactive `bitmasked` SNodes on the path are skipped.
+  for (auto *s : snodes) {
+    if (s->type != SNodeType::bitmasked) {
+      continue;
+    }
+    std::vector<Stmt *> indices;
+    for (int k = 0; k < s->num_active_indices; k++) {
+      auto j = std::find(physical_indices.begin(), physical_indices.end(),
+                         s->physical_index_position[k]);
+      TI_ASSERT(j != physical_indices.end());
+      indices.push_back(new_loop_vars[j - physical_indices.begin()]);
+    }
+    auto ptr = body_header.push_back<GlobalPtrStmt>(
+        LaneAttribute<SNode *>(s), indices, /*activate=*/false);
+    auto active = body_header.push_back<SNodeOpStmt>(SNodeOpType::is_active,
+                                                     s, ptr, nullptr);
+    test = body_header.push_back<BinaryOpStmt>(BinaryOpType::bit_and, test,
+                                               active);
+    has_test = true;
+  }
+
   irpass::replace_statements(
       body.get(), /*filter=*/
       [&](Stmt *s) {
@@ -167,9 +196,10 @@ void convert_to_range_for(OffloadedStmt *offloaded, bool packed) {
   offloaded->task_type = TaskType::range_for;
 }
 
-void maybe_convert(OffloadedStmt *stmt, bool packed) {
+void maybe_convert(OffloadedStmt *stmt, bool packed, bool demote_bitmasked) {
   if ((stmt->task_type == TaskType::struct_for) &&
-      stmt->snode->is_path_all_dense) {
+      (stmt->snode->is_path_all_dense ||
+       (demote_bitmasked && stmt->snode->is_path_all_dense_or_bitmasked))) {
     convert_to_range_for(stmt, packed);
   }
 }
@@ -178,15 +208,17 @@ void maybe_convert(OffloadedStmt *stmt, bool packed) {
 
 namespace irpass {
 
-void demote_dense_struct_fors(IRNode *root, bool packed) {
+void demote_dense_struct_fors(IRNode *root,
+                              bool packed,
+                              bool demote_bitmasked) {
   if (auto *block = root->cast<Block>()) {
     for (auto &s_ : block->statements) {
       if (auto *s = s_->cast<OffloadedStmt>()) {
-        maybe_convert(s, packed);
+        maybe_convert(s, packed, demote_bitmasked);
       }
     }
   } else if (auto *s = root->cast<OffloadedStmt>()) {
-    maybe_convert(s, packed);
+    maybe_convert(s, packed, demote_bitmasked);
   }
   re_id(root);
 }
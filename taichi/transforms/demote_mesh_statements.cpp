@@ -17,6 +17,12 @@ auto get_load = [](SNode *snode, Stmt *idx, VecStatement &block) {
   Stmt *globalptr =
       block.push_back<GlobalPtrStmt>(LaneAttribute<SNode *>{snode}, lane);
   Stmt *load = block.push_back<GlobalLoadStmt>(globalptr);
+  if (snode->dt != PrimitiveType::i32) {
+    // E.g. the 16-bit patch-local indices of a relation.
+    auto cast = block.push_back<UnaryOpStmt>(UnaryOpType::cast_value, load);
+    cast->cast_type = PrimitiveType::i32;
+    return (Stmt *)cast;
+  }
   return load;
 };
 
@@ -12,7 +12,44 @@ namespace irpass {
 
 namespace {
 
+// Whether |offload| may write to SNodes that gather_snode_read_writes() does
+// not see, e.g. through the PtrOffsetStmt of a ti.field_handle() argument,
+// which can alias any field of the same layout in the SNode tree.
+bool has_untracked_writes(OffloadedStmt *offload) {
+  bool untracked_writes = false;
+  irpass::analysis::gather_statements(offload, [&](Stmt *stmt) {
+    Stmt *dest = nullptr;
+    if (auto store = stmt->cast<GlobalStoreStmt>()) {
+      dest = store->dest;
+    } else if (auto atomic = stmt->cast<AtomicOpStmt>()) {
+      dest = atomic->dest;
+    } else if (auto op = stmt->cast<SNodeOpStmt>()) {
+      untracked_writes |= op->op_type != SNodeOpType::is_active &&
+                          op->op_type != SNodeOpType::length &&
+                          op->op_type != SNodeOpType::get_addr;
+    } else if (stmt->is<BitStructStoreStmt>() ||
+               stmt->is<ExternalFuncCallStmt>()) {
+      untracked_writes = true;
+    }
+    if (dest && dest->is<PtrOffsetStmt>() &&
+        dest->as<PtrOffsetStmt>()->origin->is<AllocaStmt>()) {
+      // A local matrix indexed dynamically.
+      return false;
+    }
+    if (dest && !dest->is<GlobalPtrStmt>() && !dest->is<AllocaStmt>() &&
+        !dest->is<ExternalPtrStmt>() && !dest->is<GlobalTemporaryStmt>() &&
+        !dest->is<ThreadLocalPtrStmt>() && !dest->is<BlockLocalPtrStmt>()) {
+      untracked_writes = true;
+    }
+    return false;
+  });
+  return untracked_writes;
+}
+
 void detect_read_only_in_task(OffloadedStmt *offload) {
+  if (has_untracked_writes(offload)) {
+    return;
+  }
   auto accessed = irpass::analysis::gather_snode_read_writes(offload);
   for (auto snode : accessed.first) {
     if (accessed.second.count(snode) == 0) {
@@ -0,0 +1,559 @@
+#include <unordered_map>
+#include <unordered_set>
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/ir/visitors.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+using TaskType = OffloadedStmt::TaskType;
+
+// Global accesses that are not described by gather_snode_read_writes().
+struct UntrackedAccesses {
+  bool reads_external{false};
+  bool writes_external{false};
+  bool reads_global_tmp{false};
+  bool writes_global_tmp{false};
+  // Something that blocks the fusion regardless of the other task.
+  bool unsupported{false};
+};
+
+UntrackedAccesses gather_untracked_accesses(OffloadedStmt *task) {
+  UntrackedAccesses result;
+  auto record = [&](Stmt *ptr, bool read, bool write) {
+    if (ptr->is<GlobalPtrStmt>() || ptr->is<AllocaStmt>()) {
+      // Tracked by gather_snode_read_writes(), or local.
+    } else if (ptr->is<ExternalPtrStmt>()) {
+      result.reads_external |= read;
+      result.writes_external |= write;
+    } else if (ptr->is<GlobalTemporaryStmt>()) {
+      result.reads_global_tmp |= read;
+      result.writes_global_tmp |= write;
+    } else {
+      // E.g. a PtrOffsetStmt. We can't tell which SNode it accesses.
+      result.unsupported = true;
+    }
+  };
+  irpass::analysis::gather_statements(task->body.get(), [&](Stmt *stmt) {
+    if (auto load = stmt->cast<GlobalLoadStmt>()) {
+      record(load->src, /*read=*/true, /*write=*/false);
+    } else if (auto store = stmt->cast<GlobalStoreStmt>()) {
+      record(store->dest, /*read=*/false, /*write=*/true);
+    } else if (auto atomic = stmt->cast<AtomicOpStmt>()) {
+      record(atomic->dest, /*read=*/true, /*write=*/true);
+    } else if (stmt->is<SNodeOpStmt>() || stmt->is<PrintStmt>() ||
+               stmt->is<ExternalFuncCallStmt>() ||
+               stmt->is<BitStructStoreStmt>()) {
+      // Structural changes, or side effects whose order is observable.
+      result.unsupported = true;
+    } else if (auto cont = stmt->cast<ContinueStmt>()) {
+      // Skipping the rest of the iteration would skip the next task as well.
+      if (cont->scope == task) {
+        result.unsupported = true;
+      }
+    }
+    return false;
+  });
+  return result;
+}
+
+// Tests if |x| in task |a| and |y| in task |b| compute the same value in the
+// same iteration.
+bool same_index(Stmt *x, Stmt *y, OffloadedStmt *a, OffloadedStmt *b) {
+  if (x == y) {
+    return true;
+  }
+  if (typeid(*x) != typeid(*y) || x->ret_type != y->ret_type) {
+    return false;
+  }
+  if (auto xi = x->cast<LoopIndexStmt>()) {
+    auto yi = y->as<LoopIndexStmt>();
+    return xi->loop == a && yi->loop == b && xi->index == yi->index;
+  } else if (auto xc = x->cast<ConstStmt>()) {
+    return xc->val[0] == y->as<ConstStmt>()->val[0];
+  } else if (auto xa = x->cast<ArgLoadStmt>()) {
+    auto ya = y->as<ArgLoadStmt>();
+    return !xa->is_ptr && !ya->is_ptr && xa->arg_id == ya->arg_id;
+  } else if (auto xu = x->cast<UnaryOpStmt>()) {
+    auto yu = y->as<UnaryOpStmt>();
+    return xu->same_operation(yu) &&
+           same_index(xu->operand, yu->operand, a, b);
+  } else if (auto xb = x->cast<BinaryOpStmt>()) {
+    auto yb = y->as<BinaryOpStmt>();
+    return xb->op_type == yb->op_type &&
+           same_index(xb->lhs, yb->lhs, a, b) &&
+           same_index(xb->rhs, yb->rhs, a, b);
+  } else if (auto xl = x->cast<LoopUniqueStmt>()) {
+    return same_index(xl->input, y->as<LoopUniqueStmt>()->input, a, b);
+  }
+  return false;
+}
+
+// Tests if every access to |snode| in |a| and |b| is to the same element,
+// and different iterations access different elements. Then each iteration of
+// the fused loop only depends on itself.
+bool element_wise(SNode *snode, OffloadedStmt *a, OffloadedStmt *b) {
+  std::vector<GlobalPtrStmt *> ptrs_a, ptrs_b;
+  auto gather_ptrs = [&](OffloadedStmt *task,
+                         std::vector<GlobalPtrStmt *> &ptrs) {
+    irpass::analysis::gather_statements(task->body.get(), [&](Stmt *stmt) {
+      if (auto ptr = stmt->cast<GlobalPtrStmt>()) {
+        for (auto *s : ptr->snodes.data) {
+          if (s == snode) {
+            ptrs.push_back(ptr);
+            break;
+          }
+        }
+      }
+      return false;
+    });
+  };
+  gather_ptrs(a, ptrs_a);
+  gather_ptrs(b, ptrs_b);
+  if (ptrs_a.empty() || ptrs_b.empty()) {
+    return false;
+  }
+  auto *ref = ptrs_a[0];
+  if (ref->snodes.size() != 1) {
+    return false;
+  }
+  // The reference index must be injective w.r.t. the loop indices.
+  std::unordered_set<int> loop_indices;
+  for (auto *index : ref->indices) {
+    if (auto loop_index = index->cast<LoopIndexStmt>();
+        loop_index && loop_index->loop == a) {
+      loop_indices.insert(loop_index->index);
+    }
+  }
+  const int num_loop_indices =
+      (a->task_type == TaskType::range_for) ? 1 : a->snode->num_active_indices;
+  if ((int)loop_indices.size() != num_loop_indices) {
+    return false;
+  }
+  auto same_ptr = [&](GlobalPtrStmt *ptr, OffloadedStmt *task) {
+    if (ptr->snodes.size() != 1 || ptr->snodes[0] != ref->snodes[0] ||
+        ptr->indices.size() != ref->indices.size()) {
+      return false;
+    }
+    for (int i = 0; i < (int)ptr->indices.size(); i++) {
+      if (!same_index(ref->indices[i], ptr->indices[i], a, task)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  for (auto *ptr : ptrs_a) {
+    if (!same_ptr(ptr, a)) {
+      return false;
+    }
+  }
+  for (auto *ptr : ptrs_b) {
+    if (!same_ptr(ptr, b)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool same_iteration_space(OffloadedStmt *a, OffloadedStmt *b) {
+  if (a->task_type != b->task_type || a->device != b->device) {
+    return false;
+  }
+  if (a->task_type == TaskType::serial) {
+    return true;
+  }
+  if (a->task_type == TaskType::range_for) {
+    return a->const_begin && a->const_end && b->const_begin && b->const_end &&
+           a->begin_value == b->begin_value && a->end_value == b->end_value &&
+           a->reversed == b->reversed;
+  }
+  if (a->task_type == TaskType::struct_for) {
+    // Sparse struct-fors are separated by their list generation tasks.
+    return a->snode == b->snode && a->snode->is_path_all_dense &&
+           a->index_offsets == b->index_offsets &&
+           a->block_dim == b->block_dim;
+  }
+  return false;
+}
+
+bool fusible(OffloadedStmt *a, OffloadedStmt *b) {
+  if (!same_iteration_space(a, b)) {
+    return false;
+  }
+  TI_ASSERT(!a->tls_prologue && !a->bls_prologue && !a->mesh_prologue &&
+            !b->tls_prologue && !b->bls_prologue && !b->mesh_prologue);
+  if (a->task_type == TaskType::serial) {
+    // Running the two bodies one after another is exactly what happens
+    // without fusion.
+    return true;
+  }
+  const auto untracked_a = gather_untracked_accesses(a);
+  const auto untracked_b = gather_untracked_accesses(b);
+  if (untracked_a.unsupported || untracked_b.unsupported) {
+    return false;
+  }
+  // External arrays and global temporaries are not analyzed any further.
+  if ((untracked_a.writes_external &&
+       (untracked_b.reads_external || untracked_b.writes_external)) ||
+      (untracked_a.reads_external && untracked_b.writes_external)) {
+    return false;
+  }
+  if ((untracked_a.writes_global_tmp &&
+       (untracked_b.reads_global_tmp || untracked_b.writes_global_tmp)) ||
+      (untracked_a.reads_global_tmp && untracked_b.writes_global_tmp)) {
+    return false;
+  }
+
+  const auto [reads_a, writes_a] =
+      irpass::analysis::gather_snode_read_writes(a);
+  const auto [reads_b, writes_b] =
+      irpass::analysis::gather_snode_read_writes(b);
+  std::unordered_set<SNode *> conflicts;
+  for (auto *snode : writes_a) {
+    if (reads_b.count(snode) || writes_b.count(snode)) {
+      conflicts.insert(snode);
+    }
+  }
+  for (auto *snode : reads_a) {
+    if (writes_b.count(snode)) {
+      conflicts.insert(snode);
+    }
+  }
+  for (auto *snode : conflicts) {
+    if (!element_wise(snode, a, b)) {
+      TI_TRACE("Not fusing offloads: {} is not accessed element-wise",
+               snode->get_node_type_name_hinted());
+      return false;
+    }
+  }
+  return true;
+}
+
+// Appends the body of |b| to |a|. |b| is left with an empty body.
+void fuse(OffloadedStmt *a, OffloadedStmt *b) {
+  irpass::analysis::gather_statements(b->body.get(), [&](Stmt *stmt) {
+    if (auto loop_index = stmt->cast<LoopIndexStmt>()) {
+      if (loop_index->loop == b) {
+        loop_index->loop = a;
+      }
+    } else if (auto cont = stmt->cast<ContinueStmt>()) {
+      if (cont->scope == b) {
+        cont->scope = a;
+      }
+    }
+    return false;
+  });
+  for (auto &stmt : b->body->statements) {
+    a->body->insert(std::move(stmt));
+  }
+  b->body->statements.clear();
+  irpass::replace_all_usages_with(a, b, a);
+  for (auto &options : b->mem_access_opt.get_all()) {
+    for (auto &option : options.second) {
+      a->mem_access_opt.add_flag(options.first, option);
+    }
+  }
+}
+
+// The offsets of the global temporaries accessed by a task. |pinned| holds
+// the ones used other than by a scalar load, store or atomic.
+struct GlobalTmpAccesses {
+  std::unordered_set<std::size_t> reads;
+  std::unordered_set<std::size_t> writes;
+  std::unordered_set<std::size_t> pinned;
+
+  bool accesses(std::size_t offset) const {
+    return reads.count(offset) || writes.count(offset) || pinned.count(offset);
+  }
+};
+
+GlobalTmpAccesses gather_global_tmp_accesses(OffloadedStmt *task) {
+  GlobalTmpAccesses result;
+  irpass::analysis::gather_statements(task->body.get(), [&](Stmt *stmt) {
+    for (auto *op : stmt->get_operands()) {
+      auto tmp = op ? op->cast<GlobalTemporaryStmt>() : nullptr;
+      if (!tmp) {
+        continue;
+      }
+      if (tmp->ret_type->is<TensorType>()) {
+        result.pinned.insert(tmp->offset);
+      } else if (auto load = stmt->cast<GlobalLoadStmt>();
+                 load && load->src == tmp) {
+        result.reads.insert(tmp->offset);
+      } else if (auto store = stmt->cast<GlobalStoreStmt>();
+                 store && store->dest == tmp && store->val != tmp) {
+        result.writes.insert(tmp->offset);
+      } else if (auto atomic = stmt->cast<AtomicOpStmt>();
+                 atomic && atomic->dest == tmp && atomic->val != tmp) {
+        result.reads.insert(tmp->offset);
+        result.writes.insert(tmp->offset);
+      } else {
+        result.pinned.insert(tmp->offset);
+      }
+    }
+    return false;
+  });
+  return result;
+}
+
+// Replaces the global temporaries at |offsets| in |task| with allocas, which
+// end up in registers. Each iteration of |task| must write them before
+// reading them.
+void promote_global_temporaries(
+    OffloadedStmt *task,
+    const std::unordered_set<std::size_t> &offsets) {
+  std::unordered_map<std::size_t, Stmt *> allocas;
+  std::vector<std::pair<std::size_t, DataType>> types;
+  irpass::analysis::gather_statements(task->body.get(), [&](Stmt *stmt) {
+    if (auto tmp = stmt->cast<GlobalTemporaryStmt>();
+        tmp && offsets.count(tmp->offset) && !allocas.count(tmp->offset)) {
+      allocas[tmp->offset] = nullptr;
+      types.emplace_back(tmp->offset, tmp->ret_type.ptr_removed());
+    }
+    return false;
+  });
+  for (auto &[offset, type] : types) {
+    allocas[offset] = task->body->insert(Stmt::make<AllocaStmt>(type), 0);
+  }
+  DelayedIRModifier modifier;
+  irpass::analysis::gather_statements(task->body.get(), [&](Stmt *stmt) {
+    if (auto load = stmt->cast<GlobalLoadStmt>()) {
+      if (auto tmp = load->src->cast<GlobalTemporaryStmt>();
+          tmp && allocas.count(tmp->offset)) {
+        auto local_load = Stmt::make<LocalLoadStmt>(
+            LocalAddress(allocas[tmp->offset], 0));
+        local_load->ret_type = load->ret_type;
+        modifier.replace_with(load, VecStatement(std::move(local_load)));
+      }
+    } else if (auto store = stmt->cast<GlobalStoreStmt>()) {
+      if (auto tmp = store->dest->cast<GlobalTemporaryStmt>();
+          tmp && allocas.count(tmp->offset)) {
+        modifier.replace_with(store,
+                              VecStatement(Stmt::make<LocalStoreStmt>(
+                                  allocas[tmp->offset], store->val)));
+      }
+    } else if (auto atomic = stmt->cast<AtomicOpStmt>()) {
+      if (auto tmp = atomic->dest->cast<GlobalTemporaryStmt>();
+          tmp && allocas.count(tmp->offset)) {
+        atomic->dest = allocas[tmp->offset];
+      }
+    }
+    return false;
+  });
+  modifier.modify_ir();
+  // The global temporaries are now unused, and removed by DCE.
+}
+
+// Whether |task| contains loops, random numbers or other statements that
+// should not be run by every thread of the following parallel task.
+bool has_unfoldable_statements(OffloadedStmt *task) {
+  return !irpass::analysis::gather_statements(task->body.get(), [](Stmt *stmt) {
+            return stmt->is<RangeForStmt>() || stmt->is<StructForStmt>() ||
+                   stmt->is<MeshForStmt>() || stmt->is<WhileStmt>() ||
+                   stmt->is<RandStmt>();
+          }).empty();
+}
+
+// A serial task with at most this many statements is cheap enough to be
+// recomputed by every thread of the parallel task following it.
+constexpr int kMaxFoldedStatements = 32;
+
+// Folds the small serial tasks into the parallel tasks following them, when
+// the serial tasks only compute values for those parallel tasks, which are
+// the same in every iteration. That saves a launch and the round trip of the
+// values through the global temporaries, which are promoted to registers.
+bool fold_serial_tasks(Block *block) {
+  std::vector<GlobalTmpAccesses> accesses;
+  // The offsets holding the bounds of range-fors, read at their launch.
+  std::unordered_set<std::size_t> bounds;
+  for (auto &stmt : block->statements) {
+    auto *offload = stmt->as<OffloadedStmt>();
+    accesses.push_back(gather_global_tmp_accesses(offload));
+    if (offload->task_type == TaskType::range_for) {
+      if (!offload->const_begin) {
+        bounds.insert(offload->begin_offset);
+      }
+      if (!offload->const_end) {
+        bounds.insert(offload->end_offset);
+      }
+    }
+  }
+  auto foldable = [&](int i) {
+    auto *a = block->statements[i]->as<OffloadedStmt>();
+    auto *b = block->statements[i + 1]->as<OffloadedStmt>();
+    if (a->task_type != TaskType::serial ||
+        (b->task_type != TaskType::range_for &&
+         b->task_type != TaskType::struct_for) ||
+        a->device != b->device ||
+        irpass::analysis::count_statements(a) > kMaxFoldedStatements ||
+        has_unfoldable_statements(a)) {
+      return false;
+    }
+    const auto untracked_a = gather_untracked_accesses(a);
+    const auto untracked_b = gather_untracked_accesses(b);
+    // Unlike in fuse(), an unsupported access of |b| matters too: it may
+    // write a field that |a| reads, e.g. through a PtrOffsetStmt.
+    if (untracked_a.unsupported || untracked_b.unsupported ||
+        untracked_a.writes_external ||
+        (untracked_a.reads_external && untracked_b.writes_external)) {
+      return false;
+    }
+    // |a| must not write any field, nor read one that |b| writes, since the
+    // later iterations of |b| would see the writes of the earlier ones.
+    const auto [reads_a, writes_a] =
+        irpass::analysis::gather_snode_read_writes(a);
+    const auto [reads_b, writes_b] =
+        irpass::analysis::gather_snode_read_writes(b);
+    if (!writes_a.empty()) {
+      return false;
+    }
+    for (auto *snode : reads_a) {
+      if (writes_b.count(snode)) {
+        return false;
+      }
+    }
+    // The same for the global temporaries. Those written by |a| must be used
+    // by |b| only.
+    const auto &tmp_a = accesses[i];
+    const auto &tmp_b = accesses[i + 1];
+    if (!tmp_a.pinned.empty()) {
+      return false;
+    }
+    for (auto offset : tmp_a.reads) {
+      if (tmp_b.writes.count(offset) || tmp_b.pinned.count(offset)) {
+        return false;
+      }
+    }
+    for (auto offset : tmp_a.writes) {
+      if (tmp_b.writes.count(offset) || tmp_b.pinned.count(offset) ||
+          bounds.count(offset)) {
+        return false;
+      }
+      for (int j = 0; j < (int)accesses.size(); j++) {
+        if (j != i && j != i + 1 && accesses[j].accesses(offset)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  };
+
+  bool modified = false;
+  for (int i = 0; i + 1 < (int)block->statements.size(); i++) {
+    if (!foldable(i)) {
+      continue;
+    }
+    auto *a = block->statements[i]->as<OffloadedStmt>();
+    auto *b = block->statements[i + 1]->as<OffloadedStmt>();
+    TI_TRACE("Folding serial offload {} into {}", a->task_name(),
+             b->task_name());
+    auto promoted = accesses[i].writes;
+    for (int j = 0; j < (int)a->body->statements.size(); j++) {
+      b->body->insert(std::move(a->body->statements[j]), j);
+    }
+    a->body->statements.clear();
+    irpass::replace_all_usages_with(b, a, b);
+    promote_global_temporaries(b, promoted);
+    block->statements.erase(block->statements.begin() + i);
+    accesses.erase(accesses.begin() + i);
+    accesses[i] = gather_global_tmp_accesses(b);
+    modified = true;
+  }
+  return modified;
+}
+
+// Promotes the global temporaries used by a single serial task, e.g. after
+// the serial tasks passing values through them are fused, to registers.
+bool promote_serial_global_temporaries(Block *block) {
+  std::unordered_map<std::size_t, int> num_tasks;
+  std::unordered_set<std::size_t> pinned;
+  std::vector<GlobalTmpAccesses> accesses;
+  for (auto &stmt : block->statements) {
+    auto *offload = stmt->as<OffloadedStmt>();
+    accesses.push_back(gather_global_tmp_accesses(offload));
+    const auto &task = accesses.back();
+    std::unordered_set<std::size_t> offsets = task.reads;
+    offsets.insert(task.writes.begin(), task.writes.end());
+    offsets.insert(task.pinned.begin(), task.pinned.end());
+    for (auto offset : offsets) {
+      num_tasks[offset]++;
+    }
+    pinned.insert(task.pinned.begin(), task.pinned.end());
+    if (offload->task_type == TaskType::range_for) {
+      if (!offload->const_begin) {
+        pinned.insert(offload->begin_offset);
+      }
+      if (!offload->const_end) {
+        pinned.insert(offload->end_offset);
+      }
+    }
+  }
+  bool modified = false;
+  for (int i = 0; i < (int)block->statements.size(); i++) {
+    auto *offload = block->statements[i]->as<OffloadedStmt>();
+    if (offload->task_type != TaskType::serial) {
+      continue;
+    }
+    std::unordered_set<std::size_t> promoted;
+    for (auto offset : accesses[i].writes) {
+      if (num_tasks[offset] == 1 && !pinned.count(offset)) {
+        promoted.insert(offset);
+      }
+    }
+    if (!promoted.empty()) {
+      promote_global_temporaries(offload, promoted);
+      modified = true;
+    }
+  }
+  return modified;
+}
+
+}  // namespace
+
+namespace irpass {
+
+bool fuse_offloads(IRNode *root, const CompileConfig &config) {
+  TI_AUTO_PROF;
+  auto *block = root->cast<Block>();
+  if (!block) {
+    return false;
+  }
+  std::vector<std::unique_ptr<Stmt>> new_statements;
+  OffloadedStmt *last = nullptr;
+  bool modified = false;
+  for (auto &stmt : block->statements) {
+    auto *offload = stmt->cast<OffloadedStmt>();
+    if (last && offload && fusible(last, offload)) {
+      TI_TRACE("Fusing offloads {} <- {}", last->task_name(),
+               offload->task_name());
+      fuse(last, offload);
+      modified = true;
+      // The now empty |offload| is deleted along with the old statements.
+      continue;
+    }
+    last = (offload && offload->has_body()) ? offload : nullptr;
+    new_statements.push_back(std::move(stmt));
+  }
+  block->statements = std::move(new_statements);
+  // Folding would undo hoist_uniform_values(), which moves the expensive
+  // uniform values into serial tasks on purpose.
+  if (!config.hoist_uniform_values && fold_serial_tasks(block)) {
+    modified = true;
+  }
+  if (promote_serial_global_temporaries(block)) {
+    modified = true;
+  }
+  if (modified) {
+    re_id(root);
+  }
+  return modified;
+}
+
+}  // namespace irpass
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,274 @@
+#include <unordered_map>
+#include <unordered_set>
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/ir/visitors.h"
+#include "taichi/system/profiler.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+// Worth a global temporary store in the prologue and a load in every thread.
+bool is_expensive(Stmt *stmt) {
+  if (stmt->is<GlobalLoadStmt>()) {
+    return true;
+  } else if (auto unary = stmt->cast<UnaryOpStmt>()) {
+    switch (unary->op_type) {
+      case UnaryOpType::sqrt:
+      case UnaryOpType::rsqrt:
+      case UnaryOpType::sin:
+      case UnaryOpType::asin:
+      case UnaryOpType::cos:
+      case UnaryOpType::acos:
+      case UnaryOpType::tan:
+      case UnaryOpType::tanh:
+      case UnaryOpType::exp:
+      case UnaryOpType::log:
+        return true;
+      default:
+        return false;
+    }
+  } else if (auto binary = stmt->cast<BinaryOpStmt>()) {
+    const auto op = binary->op_type;
+    return op == BinaryOpType::pow || op == BinaryOpType::atan2 ||
+           ((op == BinaryOpType::div || op == BinaryOpType::truediv) &&
+            is_real(binary->ret_type));
+  }
+  return false;
+}
+
+// Integer divisions are only hoisted when they can't trap, since the loop
+// may not run at all.
+bool may_trap(BinaryOpStmt *stmt) {
+  const auto op = stmt->op_type;
+  if (!is_integral(stmt->ret_type) ||
+      (op != BinaryOpType::div && op != BinaryOpType::truediv &&
+       op != BinaryOpType::floordiv && op != BinaryOpType::mod)) {
+    return false;
+  }
+  auto divisor = stmt->rhs->cast<ConstStmt>();
+  return !divisor || divisor->val[0].equal_value(0);
+}
+
+// Returns the SNodes read but not written by the loop with |body|, which can
+// be loaded in front of it. This is what detect_read_only() finds once the
+// loop is offloaded.
+std::unordered_set<SNode *> gather_read_only_snodes(Block *body) {
+  bool untracked_writes = false;
+  irpass::analysis::gather_statements(body, [&](Stmt *stmt) {
+    Stmt *dest = nullptr;
+    if (auto store = stmt->cast<GlobalStoreStmt>()) {
+      dest = store->dest;
+    } else if (auto atomic = stmt->cast<AtomicOpStmt>()) {
+      dest = atomic->dest;
+    } else if (stmt->is<SNodeOpStmt>() || stmt->is<BitStructStoreStmt>() ||
+               stmt->is<ExternalFuncCallStmt>() || stmt->is<FuncCallStmt>()) {
+      untracked_writes = true;
+    }
+    if (dest && !dest->is<GlobalPtrStmt>() && !dest->is<AllocaStmt>() &&
+        !dest->is<ExternalPtrStmt>()) {
+      // E.g. a PtrOffsetStmt. We can't tell which SNode it writes to.
+      untracked_writes = true;
+    }
+    return false;
+  });
+  std::unordered_set<SNode *> result;
+  if (untracked_writes) {
+    return result;
+  }
+  const auto [reads, writes] = irpass::analysis::gather_snode_read_writes(body);
+  for (auto *snode : reads) {
+    if (!writes.count(snode)) {
+      result.insert(snode);
+    }
+  }
+  return result;
+}
+
+// Moves the expensive computations at the top level of a parallel loop which
+// are the same in every iteration in front of the loop. The offloading then
+// places them in a serial task, and passes their results to the loop through
+// global temporaries.
+class HoistUniformValues {
+ private:
+  Block *body_;
+  std::unordered_set<SNode *> read_only_snodes_;
+  // The uniform statements of the loop body, and whether they depend on an
+  // expensive one.
+  std::unordered_map<Stmt *, bool> uniform_;
+
+  bool is_uniform_operand(Stmt *op) const {
+    return op->parent != body_ || uniform_.count(op);
+  }
+
+  bool is_candidate(Stmt *stmt, bool after_assert) {
+    if (stmt->is<ConstStmt>()) {
+      return true;
+    } else if (auto arg = stmt->cast<ArgLoadStmt>()) {
+      return !arg->is_ptr;
+    } else if (auto ptr = stmt->cast<GlobalPtrStmt>()) {
+      return !ptr->activate;
+    } else if (auto load = stmt->cast<GlobalLoadStmt>()) {
+      // The bound checks of debug mode guard the loads after them.
+      auto ptr = load->src->cast<GlobalPtrStmt>();
+      if (after_assert || !ptr || !uniform_.count(ptr)) {
+        return false;
+      }
+      for (auto *snode : ptr->snodes.data) {
+        if (!read_only_snodes_.count(snode)) {
+          return false;
+        }
+      }
+      return true;
+    } else if (auto binary = stmt->cast<BinaryOpStmt>()) {
+      return !may_trap(binary);
+    }
+    return stmt->is<UnaryOpStmt>() || stmt->is<TernaryOpStmt>();
+  }
+
+  // Whether the statement is cloned in front of the loop rather than moved.
+  // These are cheap, and can't be passed through global temporaries in the
+  // case of pointers.
+  static bool is_cloned(Stmt *stmt) {
+    return stmt->is<ConstStmt>() || stmt->is<ArgLoadStmt>() ||
+           stmt->is<GlobalPtrStmt>();
+  }
+
+ public:
+  explicit HoistUniformValues(Block *body) : body_(body) {
+    read_only_snodes_ = gather_read_only_snodes(body);
+  }
+
+  bool run(Stmt *loop) {
+    bool after_assert = false;
+    for (auto &s : body_->statements) {
+      Stmt *stmt = s.get();
+      if (stmt->is<AssertStmt>()) {
+        after_assert = true;
+      }
+      if (stmt->width() != 1 || !is_candidate(stmt, after_assert)) {
+        continue;
+      }
+      bool expensive = is_expensive(stmt);
+      bool uniform = true;
+      for (auto *op : stmt->get_operands()) {
+        if (!op) {
+          continue;
+        }
+        if (!is_uniform_operand(op)) {
+          uniform = false;
+          break;
+        }
+        if (auto it = uniform_.find(op); it != uniform_.end()) {
+          expensive |= it->second;
+        }
+      }
+      if (uniform) {
+        uniform_[stmt] = expensive;
+      }
+    }
+
+    // Hoist the expensive uniform values used by the rest of the loop, along
+    // with their operands.
+    std::unordered_set<Stmt *> to_hoist;
+    std::vector<Stmt *> worklist;
+    irpass::analysis::gather_statements(body_, [&](Stmt *stmt) {
+      if (uniform_.count(stmt) && stmt->parent == body_) {
+        return false;
+      }
+      for (auto *op : stmt->get_operands()) {
+        if (auto it = uniform_.find(op);
+            op && it != uniform_.end() && it->second && !is_cloned(op)) {
+          worklist.push_back(op);
+        }
+      }
+      return false;
+    });
+    while (!worklist.empty()) {
+      auto *stmt = worklist.back();
+      worklist.pop_back();
+      if (!to_hoist.insert(stmt).second) {
+        continue;
+      }
+      for (auto *op : stmt->get_operands()) {
+        if (op && uniform_.count(op)) {
+          worklist.push_back(op);
+        }
+      }
+    }
+    if (to_hoist.empty()) {
+      return false;
+    }
+
+    DelayedIRModifier modifier;
+    std::unordered_map<Stmt *, Stmt *> clones;
+    for (auto &s : body_->statements) {
+      Stmt *stmt = s.get();
+      if (!to_hoist.count(stmt)) {
+        continue;
+      }
+      auto hoisted = stmt->clone();
+      for (auto *op : stmt->get_operands()) {
+        if (auto it = clones.find(op); op && it != clones.end()) {
+          hoisted->replace_operand_with(op, it->second);
+        }
+      }
+      if (is_cloned(stmt)) {
+        // The loop keeps its own copy for the other users.
+        clones[stmt] = hoisted.get();
+      } else {
+        stmt->replace_usages_with(hoisted.get());
+        modifier.erase(stmt);
+      }
+      modifier.insert_before(loop, std::move(hoisted));
+    }
+    TI_TRACE("Hoisted {} uniform statements out of a parallel loop",
+             to_hoist.size());
+    return modifier.modify_ir();
+  }
+};
+
+}  // namespace
+
+namespace irpass {
+
+bool hoist_uniform_values(IRNode *root) {
+  TI_AUTO_PROF;
+  auto *block = root->cast<Block>();
+  if (!block) {
+    return false;
+  }
+  bool modified = false;
+  // Copied, since the hoisted statements are inserted into |block|.
+  std::vector<Stmt *> loops;
+  for (auto &stmt : block->statements) {
+    if (auto range_for = stmt->cast<RangeForStmt>()) {
+      if (!range_for->strictly_serialized && range_for->vectorize <= 1 &&
+          range_for->bit_vectorize <= 1) {
+        loops.push_back(range_for);
+      }
+    } else if (auto struct_for = stmt->cast<StructForStmt>()) {
+      if (struct_for->vectorize <= 1 && struct_for->bit_vectorize <= 1) {
+        loops.push_back(struct_for);
+      }
+    }
+  }
+  for (auto *loop : loops) {
+    Block *body = loop->is<RangeForStmt>()
+                      ? loop->as<RangeForStmt>()->body.get()
+                      : loop->as<StructForStmt>()->body.get();
+    modified |= HoistUniformValues(body).run(loop);
+  }
+  if (modified) {
+    re_id(root);
+  }
+  return modified;
+}
+
+}  // namespace irpass
+
+TLANG_NAMESPACE_END
@@ -20,6 +20,7 @@ class Inliner : public BasicStmtVisitor {
   void visit(FuncCallStmt *stmt) override {
     auto *func = stmt->func;
     TI_ASSERT(func);
+    func->materialize_body();
     TI_ASSERT(func->args.size() == stmt->args.size());
     TI_ASSERT(func->ir->is<Block>());
     TI_ASSERT(func->rets.size() <= 1);
@@ -61,7 +62,7 @@ class Inliner : public BasicStmtVisitor {
     }
   }
 
-  static bool run(IRNode *node) {
+  static bool run(IRNode *node, bool single_level) {
     Inliner inliner;
     bool modified = false;
     while (true) {
@@ -70,6 +71,8 @@ class Inliner : public BasicStmtVisitor {
         modified = true;
       else
         break;
+      if (single_level)
+        break;
     }
     return modified;
   }
@@ -86,7 +89,7 @@ bool inlining(IRNode *root,
               const CompileConfig &config,
               const InliningPass::Args &args) {
   TI_AUTO_PROF;
-  return Inliner::run(root);
+  return Inliner::run(root, args.single_level);
 }
 
 }  // namespace irpass
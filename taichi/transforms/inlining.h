@@ -9,7 +9,10 @@ class InliningPass : public Pass {
  public:
   static const PassID id;
 
-  struct Args {};
+  struct Args {
+    // Only inlines the calls in the root, not the ones in the inlined bodies.
+    bool single_level{false};
+  };
 };
 
 }  // namespace lang
@@ -126,7 +126,8 @@ class IRPrinter : public IRVisitor {
       extras += ", ";
       extras += arg->name();
     }
-    print("{} : assert {}, \"{}\"{}", assert->id, assert->cond->name(),
+    print("{} : assert{} {}, \"{}\"{}", assert->id,
+          assert->deferred ? "(deferred)" : "", assert->cond->name(),
           assert->text, extras);
   }
 
@@ -184,7 +185,8 @@ class IRPrinter : public IRVisitor {
   }
 
   void visit(RandStmt *stmt) override {
-    print("{}{} = rand()", stmt->type_hint(), stmt->name());
+    print("{}{} = {}rand()", stmt->type_hint(), stmt->name(),
+          stmt->counter_based ? "counter_based_" : "");
   }
 
   void visit(UnaryOpStmt *stmt) override {
@@ -571,12 +573,15 @@ class IRPrinter : public IRVisitor {
           scratch_pad_info(stmt->mem_access_opt));
     }
     if (stmt->task_type == OffloadedTaskType::listgen) {
+      auto source = stmt->listgen_source ? stmt->listgen_source
+                                         : stmt->snode->parent;
       print("{} = offloaded listgen {}->{}", stmt->name(),
-            stmt->snode->parent->get_node_type_name_hinted(),
+            source->get_node_type_name_hinted(),
             stmt->snode->get_node_type_name_hinted());
     } else if (stmt->task_type == OffloadedTaskType::gc) {
-      print("{} = offloaded garbage collect {}", stmt->name(),
-            stmt->snode->get_node_type_name_hinted());
+      print("{} = offloaded garbage collect {}{}", stmt->name(),
+            stmt->snode->get_node_type_name_hinted(),
+            stmt->gc_compact ? " (compacting)" : "");
     } else {
       print("{} = offloaded {} ", stmt->name(), details);
       if (stmt->tls_prologue) {
@@ -665,6 +670,13 @@ class IRPrinter : public IRVisitor {
       args += arg->name();
       first = false;
     }
+    for (auto &output : stmt->output_stmts) {
+      if (!first) {
+        args += ", ";
+      }
+      args += "out " + output->name();
+      first = false;
+    }
     print("{}{} = internal call {}({})", stmt->type_hint(), stmt->name(),
           stmt->func_name, args);
   }
@@ -704,6 +716,14 @@ class IRPrinter : public IRVisitor {
           stmt->type_hint(), stmt->name(), stmt->axis, stmt->arg_id);
   }
 
+  void visit(TextureOpStmt *stmt) override {
+    auto args = make_list<Stmt *>(
+        stmt->args, [&](Stmt *const &stmt) { return stmt->name(); }, "(");
+    print("{}{} = texture_{}{} arg_id {}, channel {}", stmt->type_hint(),
+          stmt->name(), texture_op_type_name(stmt->op), args, stmt->arg_id,
+          stmt->channel);
+  }
+
   void visit(BitStructStoreStmt *stmt) override {
     std::string ch_ids;
     std::string values;
@@ -9,6 +9,10 @@ TLANG_NAMESPACE_BEGIN
 
 namespace {
 
+// The number of elements each thread loads before storing them into BLS in
+// the prologue on CUDA, see create_batched_prologue below.
+constexpr int kBlsPrologueBatchSize = 4;
+
 void make_block_local_offload(OffloadedStmt *offload,
                               const CompileConfig &config,
                               const std::string &kernel_name) {
@@ -19,6 +23,27 @@ void make_block_local_offload(OffloadedStmt *offload,
 
   auto pads = irpass::initialize_scratch_pad(offload);
 
+  const bool is_cpu = arch_is_cpu(config.arch);
+  if (is_cpu) {
+    // On CPUs the BLS buffer is a thread-local scratch buffer, which only pays
+    // off if it stays in the (per-core) cache.
+    std::size_t total_bls_size = 0;
+    for (auto &pad : pads->pads) {
+      total_bls_size += data_type_size(pad.first->dt.ptr_removed()) *
+                        pad.second.pad_size_linear();
+    }
+    if (total_bls_size > (std::size_t)config.cpu_bls_max_size_bytes) {
+      TI_WARN(
+          "(kernel={}) BLS disabled: {} bytes of block-local storage exceed "
+          "cpu_bls_max_size_bytes={}",
+          kernel_name, total_bls_size, config.cpu_bls_max_size_bytes);
+      return;
+    }
+    // A block is processed by a single CPU thread, so that the BLS buffer is
+    // only filled once per block.
+    offload->block_dim = offload->snode->parent->max_num_elements();
+  }
+
   std::size_t bls_offset_in_bytes = 0;
 
   for (auto &pad : pads->pads) {
@@ -58,6 +83,53 @@ void make_block_local_offload(OffloadedStmt *offload,
     bls_offset_in_bytes +=
         (dtype_size - bls_offset_in_bytes % dtype_size) % dtype_size;
 
+    auto get_bls_element_offset_bytes = [&](Block *element_block,
+                                            Stmt *bls_element_id) {
+      auto bls_element_offset_bytes = element_block->push_back<BinaryOpStmt>(
+          BinaryOpType::mul, bls_element_id,
+          element_block->push_back<ConstStmt>(TypedConstant(dtype_size)));
+      return element_block->push_back<BinaryOpStmt>(
+          BinaryOpType::add, bls_element_offset_bytes,
+          element_block->push_back<ConstStmt>(
+              TypedConstant((int32)bls_offset_in_bytes)));
+    };
+
+    // Convert bls_element_id to global indices via a series of % and /,
+    // see bls_to_global below.
+    auto get_global_indices = [&](Block *element_block, Stmt *bls_element_id) {
+      std::vector<Stmt *> global_indices(dim);
+      auto bls_element_id_partial = bls_element_id;
+      for (int i = dim - 1; i >= 0; i--) {
+        auto pad_size_stmt = element_block->push_back<ConstStmt>(
+            TypedConstant(pad.second.pad_size[i]));
+
+        auto bls_coord = element_block->push_back<BinaryOpStmt>(
+            BinaryOpType::mod, bls_element_id_partial, pad_size_stmt);
+        bls_element_id_partial = element_block->push_back<BinaryOpStmt>(
+            BinaryOpType::div, bls_element_id_partial, pad_size_stmt);
+
+        auto global_index_this_dim = element_block->push_back<BinaryOpStmt>(
+            BinaryOpType::add, bls_coord,
+            element_block->push_back<ConstStmt>(
+                TypedConstant(pad.second.bounds[i].low)));
+
+        auto block_corner =
+            element_block->push_back<BlockCornerIndexStmt>(offload, i);
+        if (pad.second.coefficients[i] > 1) {
+          block_corner = element_block->push_back<BinaryOpStmt>(
+              BinaryOpType::mul, block_corner,
+              element_block->push_back<ConstStmt>(
+                  TypedConstant(pad.second.coefficients[i])));
+        }
+
+        global_index_this_dim = element_block->push_back<BinaryOpStmt>(
+            BinaryOpType::add, global_index_this_dim, block_corner);
+
+        global_indices[i] = global_index_this_dim;
+      }
+      return global_indices;
+    };
+
     // This lambda is used for both BLS prologue and epilogue creation
     auto create_xlogue =
         [&](std::unique_ptr<Block> &block,
@@ -68,6 +140,26 @@ void make_block_local_offload(OffloadedStmt *offload,
             block = std::make_unique<Block>();
             block->parent_stmt = offload;
           }
+
+          if (is_cpu) {
+            // The only thread of the block walks through the whole BLS buffer
+            // with a serial loop.
+            auto loop = block->push_back<RangeForStmt>(
+                block->push_back<ConstStmt>(TypedConstant(0)),
+                block->push_back<ConstStmt>(TypedConstant(bls_num_elements)),
+                std::make_unique<Block>(), /*vectorize=*/1,
+                /*bit_vectorize=*/1, /*num_cpu_threads=*/1, /*block_dim=*/1,
+                /*strictly_serialized=*/true);
+            auto element_block = loop->as<RangeForStmt>()->body.get();
+            auto bls_element_id =
+                element_block->push_back<LoopIndexStmt>(loop, 0);
+            operation(element_block,
+                      get_global_indices(element_block, bls_element_id),
+                      get_bls_element_offset_bytes(element_block,
+                                                   bls_element_id));
+            return;
+          }
+
           // Equivalent to CUDA threadIdx
           Stmt *thread_idx_stmt =
               block->push_back<LoopLinearIndexStmt>(offload);
@@ -112,15 +204,6 @@ void make_block_local_offload(OffloadedStmt *offload,
             auto bls_element_id_this_iteration = block->push_back<BinaryOpStmt>(
                 BinaryOpType::add, loop_offset_stmt, thread_idx_stmt);
 
-            auto bls_element_offset_bytes = block->push_back<BinaryOpStmt>(
-                BinaryOpType::mul, bls_element_id_this_iteration,
-                block->push_back<ConstStmt>(TypedConstant(dtype_size)));
-
-            bls_element_offset_bytes = block->push_back<BinaryOpStmt>(
-                BinaryOpType::add, bls_element_offset_bytes,
-                block->push_back<ConstStmt>(
-                    TypedConstant((int32)bls_offset_in_bytes)));
-
             if (loop_offset + block_dim > bls_num_elements) {
               // Need to create an IfStmt to safeguard since bls size may not be
               // a multiple of block_size, and this iteration some threads may
@@ -138,51 +221,76 @@ void make_block_local_offload(OffloadedStmt *offload,
               element_block = block.get();
             }
 
-            std::vector<Stmt *> global_indices(dim);
-
-            // Convert bls_element_id to global indices
-            // via a series of % and /.
-            auto bls_element_id_partial = bls_element_id_this_iteration;
-            for (int i = dim - 1; i >= 0; i--) {
-              auto pad_size_stmt = element_block->push_back<ConstStmt>(
-                  TypedConstant(pad.second.pad_size[i]));
-
-              auto bls_coord = element_block->push_back<BinaryOpStmt>(
-                  BinaryOpType::mod, bls_element_id_partial, pad_size_stmt);
-              bls_element_id_partial = element_block->push_back<BinaryOpStmt>(
-                  BinaryOpType::div, bls_element_id_partial, pad_size_stmt);
-
-              auto global_index_this_dim =
-                  element_block->push_back<BinaryOpStmt>(
-                      BinaryOpType::add, bls_coord,
-                      element_block->push_back<ConstStmt>(
-                          TypedConstant(pad.second.bounds[i].low)));
-
-              auto block_corner =
-                  element_block->push_back<BlockCornerIndexStmt>(offload, i);
-              if (pad.second.coefficients[i] > 1) {
-                block_corner = element_block->push_back<BinaryOpStmt>(
-                    BinaryOpType::mul, block_corner,
-                    element_block->push_back<ConstStmt>(
-                        TypedConstant(pad.second.coefficients[i])));
-              }
-
-              global_index_this_dim = element_block->push_back<BinaryOpStmt>(
-                  BinaryOpType::add, global_index_this_dim, block_corner);
-
-              global_indices[i] = global_index_this_dim;
-            }
-
-            operation(element_block, global_indices, bls_element_offset_bytes);
+            operation(element_block,
+                      get_global_indices(element_block,
+                                         bls_element_id_this_iteration),
+                      get_bls_element_offset_bytes(
+                          element_block, bls_element_id_this_iteration));
             // TODO: do not use GlobalStore for BLS ptr.
 
             loop_offset += block_dim;
           }
         };
 
+    // On CUDA, each thread fetches a batch of its elements into registers
+    // before storing them into BLS, so that the global loads of the batch are
+    // in flight together rather than each waiting for the store before it.
+    // In the last, partial iteration of the block-stride loop, the threads
+    // out of the BLS buffer load its last element and skip the store.
+    auto create_batched_prologue = [&]() {
+      auto &block = offload->bls_prologue;
+      if (block == nullptr) {
+        block = std::make_unique<Block>();
+        block->parent_stmt = offload;
+      }
+      Stmt *thread_idx_stmt = block->push_back<LoopLinearIndexStmt>(offload);
+      const int block_dim = offload->block_dim;
+      const int batch_size = block_dim * kBlsPrologueBatchSize;
+      for (int batch = 0; batch < bls_num_elements; batch += batch_size) {
+        const int batch_end = std::min(batch + batch_size, bls_num_elements);
+        std::vector<std::pair<Stmt *, Stmt *>> fetched;
+        for (int loop_offset = batch; loop_offset < batch_end;
+             loop_offset += block_dim) {
+          auto bls_element_id = block->push_back<BinaryOpStmt>(
+              BinaryOpType::add,
+              block->push_back<ConstStmt>(TypedConstant(loop_offset)),
+              thread_idx_stmt);
+          Stmt *fetched_element_id = bls_element_id;
+          if (loop_offset + block_dim > bls_num_elements) {
+            fetched_element_id = block->push_back<BinaryOpStmt>(
+                BinaryOpType::min, bls_element_id,
+                block->push_back<ConstStmt>(
+                    TypedConstant(bls_num_elements - 1)));
+          }
+          auto global_pointer = block->push_back<GlobalPtrStmt>(
+              snode, get_global_indices(block.get(), fetched_element_id));
+          auto value = block->push_back<GlobalLoadStmt>(global_pointer);
+          fetched.emplace_back(bls_element_id, value);
+        }
+        for (int i = 0; i < (int)fetched.size(); i++) {
+          auto [bls_element_id, value] = fetched[i];
+          Block *element_block = block.get();
+          if (batch + (i + 1) * block_dim > bls_num_elements) {
+            auto cond = block->push_back<BinaryOpStmt>(
+                BinaryOpType::cmp_lt, bls_element_id,
+                block->push_back<ConstStmt>(TypedConstant(bls_num_elements)));
+            auto if_stmt = block->push_back<IfStmt>(cond)->as<IfStmt>();
+            if_stmt->set_true_statements(std::make_unique<Block>());
+            element_block = if_stmt->true_statements.get();
+          }
+          auto bls_ptr = element_block->push_back<BlockLocalPtrStmt>(
+              get_bls_element_offset_bytes(element_block, bls_element_id),
+              TypeFactory::create_vector_or_scalar_type(1, data_type, true));
+          element_block->push_back<GlobalStoreStmt>(bls_ptr, value);
+        }
+      }
+    };
+
     // Step 1:
     // Fetch to BLS
-    {
+    if (!is_cpu && bls_has_read) {
+      create_batched_prologue();
+    } else {
       create_xlogue(
           offload->bls_prologue,
           [&](Block *element_block, std::vector<Stmt *> global_indices,
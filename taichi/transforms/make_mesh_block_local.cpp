@@ -35,6 +35,40 @@ void MakeMeshBlockLocal::simplify_nested_conversion() {
   }
 }
 
+bool MakeMeshBlockLocal::fits_cpu_bls(bool with_mapping) {
+  if (!arch_is_cpu(config.arch)) {
+    return true;
+  }
+  // On CPUs the BLS buffer is a thread-local buffer, which only pays off if
+  // the data of a patch stays in the cache of the core.
+  const std::size_t max_num =
+      offload->mesh->patch_max_element_num.find(element_type)->second;
+  // The sizes include the worst-case alignment padding.
+  std::size_t size = bls_offset_in_bytes;
+  if (with_mapping) {
+    size += mapping_dtype_size * (max_num + 1);
+  }
+  auto attrs = rec.find(std::make_pair(element_type, conv_type));
+  if (attrs != rec.end()) {
+    for (auto [snode, total_flags] : attrs->second) {
+      if (attr_bls_offset_in_bytes.find(snode) ==
+          attr_bls_offset_in_bytes.end()) {
+        size += data_type_size(snode->dt.ptr_removed()) * (max_num + 1);
+      }
+    }
+  }
+  if (size > (std::size_t)config.cpu_mesh_bls_max_size_bytes) {
+    TI_TRACE(
+        "{} {} not cached: {} bytes of block-local storage exceed "
+        "cpu_mesh_bls_max_size_bytes={}",
+        mesh::element_type_name(element_type),
+        mesh::conv_type_name(conv_type), size,
+        config.cpu_mesh_bls_max_size_bytes);
+    return false;
+  }
+  return true;
+}
+
 void MakeMeshBlockLocal::gather_candidate_mapping() {
   irpass::analysis::gather_statements(offload->body.get(), [&](Stmt *stmt) {
     if (auto conv = stmt->cast<MeshIndexConversionStmt>()) {
@@ -125,7 +159,7 @@ void MakeMeshBlockLocal::replace_global_ptrs(SNode *snode) {
   }
 
   // in the cpu backend, atomic op in body block could be demoted to non-atomic
-  if (config.arch != Arch::x64) {
+  if (!arch_is_cpu(config.arch)) {
     return;
   }
   std::vector<AtomicOpStmt *> atomic_ops;
@@ -163,7 +197,7 @@ Stmt *MakeMeshBlockLocal::create_xlogue(
   [[maybe_unused]] Stmt *init_val =
       block->push_back<LocalStoreStmt>(idx, start_val);
   Stmt *block_dim_val;
-  if (config.arch == Arch::x64) {
+  if (arch_is_cpu(config.arch)) {
     block_dim_val = block->push_back<ConstStmt>(TypedConstant(1));
   } else {
     block_dim_val = block->push_back<ConstStmt>(
@@ -321,7 +355,7 @@ void MakeMeshBlockLocal::fetch_mapping(
     std::function<void(Block *body, Stmt *idx_val, Stmt *mapping_val)>
         attr_callback_handler) {
   Stmt *thread_idx_stmt;
-  if (config.arch == Arch::x64) {
+  if (arch_is_cpu(config.arch)) {
     thread_idx_stmt = block->push_back<ConstStmt>(TypedConstant(0));
   } else {
     thread_idx_stmt = block->push_back<LoopLinearIndexStmt>(
@@ -445,6 +479,8 @@ MakeMeshBlockLocal::MakeMeshBlockLocal(OffloadedStmt *offload,
   }
 
   // Cache both mappings and mesh attribute
+  std::vector<std::pair<mesh::MeshElementType, mesh::ConvType>>
+      uncached_mappings;
   for (auto [element_type, conv_type] : mappings) {
     this->element_type = element_type;
     this->conv_type = conv_type;
@@ -461,6 +497,11 @@ MakeMeshBlockLocal::MakeMeshBlockLocal(OffloadedStmt *offload,
                          ->second);
     mapping_data_type = mapping_snode->dt.ptr_removed();
     mapping_dtype_size = data_type_size(mapping_data_type);
+    if (!fits_cpu_bls(/*with_mapping=*/true)) {
+      // The attributes of this mapping may still fit without it.
+      uncached_mappings.emplace_back(element_type, conv_type);
+      continue;
+    }
 
     // Ensure BLS alignment
     bls_offset_in_bytes +=
@@ -524,6 +565,10 @@ MakeMeshBlockLocal::MakeMeshBlockLocal(OffloadedStmt *offload,
     }
   }
 
+  for (auto mapping : uncached_mappings) {
+    mappings.erase(mapping);
+  }
+
   // Cache mesh attribute only
   for (auto [mapping, attr_set] : rec) {
     if (mappings.find(mapping) != mappings.end()) {
@@ -539,6 +584,9 @@ MakeMeshBlockLocal::MakeMeshBlockLocal(OffloadedStmt *offload,
                          ->second);
     mapping_data_type = mapping_snode->dt.ptr_removed();
     mapping_dtype_size = data_type_size(mapping_data_type);
+    if (!fits_cpu_bls(/*with_mapping=*/false)) {
+      continue;
+    }
 
     // Step 3-1
     // Only fetch mesh attributes to the BLS block
@@ -26,6 +26,9 @@ class MakeMeshBlockLocal : public Pass {
  private:
   void simplify_nested_conversion();
   void gather_candidate_mapping();
+  // Whether the attributes of the current mapping, and the mapping itself if
+  // |with_mapping|, fit in the BLS buffer budget of CPU tasks.
+  bool fits_cpu_bls(bool with_mapping);
   void replace_conv_statements();
   void replace_global_ptrs(SNode *snode);
 
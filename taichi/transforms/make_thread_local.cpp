@@ -95,7 +95,39 @@ std::vector<std::pair<T *, AtomicOpType>> find_global_reduction_destinations(
   return valid_reduction_values;
 }
 
-void make_thread_local_offload(OffloadedStmt *offload) {
+// Clones |ptr| (and its constant indices, which live in the loop body) to the
+// end of |block|.
+Stmt *clone_reduction_destination(Stmt *ptr, Block *block) {
+  auto cloned_ptr =
+      std::unique_ptr<Stmt>((Stmt *)irpass::analysis::clone(ptr).release());
+  if (auto global_ptr = cloned_ptr->cast<GlobalPtrStmt>()) {
+    for (auto &index : global_ptr->indices) {
+      auto cloned_index = irpass::analysis::clone(index);
+      index = block->insert(
+          std::unique_ptr<Stmt>((Stmt *)cloned_index.release()), -1);
+    }
+  }
+  return block->insert(std::move(cloned_ptr), -1);
+}
+
+// Whether the reduction into |dest| is lowered to a deterministic one, see
+// CompileConfig::deterministic_reduction.
+bool is_deterministic_reduction(OffloadedStmt *offload,
+                                const std::pair<Stmt *, AtomicOpType> &dest,
+                                const CompileConfig &config) {
+  if (!config.deterministic_reduction || !arch_uses_llvm(config.arch) ||
+      offload->task_type != OffloadedTaskType::range_for ||
+      dest.second != AtomicOpType::add) {
+    return false;
+  }
+  // The integer additions are deterministic anyway.
+  auto data_type = dest.first->ret_type.ptr_removed();
+  return data_type->is_primitive(PrimitiveTypeID::f32) ||
+         data_type->is_primitive(PrimitiveTypeID::f64);
+}
+
+void make_thread_local_offload(OffloadedStmt *offload,
+                                const CompileConfig &config) {
   if (offload->task_type != OffloadedTaskType::range_for &&
       offload->task_type != OffloadedTaskType::struct_for)
     return;
@@ -105,10 +137,15 @@ void make_thread_local_offload(OffloadedStmt *offload) {
     auto valid_global_ptrs = find_global_reduction_destinations<GlobalPtrStmt>(
         offload, [](GlobalPtrStmt *dest) {
           // We can only optimized reductions to global ptrs with form like
-          // loss[None] (0-D fields) for now.
+          // loss[None] (0-D fields) or w.grad[0, 1] (constant indices) for
+          // now. The latter are common in gradient kernels, where all the
+          // threads accumulate into the adjoint of a shared parameter.
           // No TLS on CustomInt/FloatType.
           return (dest->snodes[0]->type == SNodeType::place) &&
-                 dest->indices.empty() &&
+                 std::all_of(dest->indices.begin(), dest->indices.end(),
+                             [](Stmt *index) {
+                               return index->is<ConstStmt>();
+                             }) &&
                  dest->snodes[0]->dt->is<PrimitiveType>();
         });
     auto valid_global_tmps =
@@ -121,6 +158,7 @@ void make_thread_local_offload(OffloadedStmt *offload) {
   }
 
   std::size_t tls_offset = 0;
+  int num_deterministic_reductions = 0;
 
   // TODO: sort thread local storage variables according to dtype_size to
   // reduce buffer fragmentation.
@@ -177,13 +215,31 @@ void make_thread_local_offload(OffloadedStmt *offload) {
           TypeFactory::create_vector_or_scalar_type(1, data_type, true));
       // TODO: do not use global load from TLS.
       auto tls_load = offload->tls_epilogue->push_back<GlobalLoadStmt>(tls_ptr);
-      auto global_ptr = offload->tls_epilogue->insert(
-          std::unique_ptr<Stmt>(
-              (Stmt *)irpass::analysis::clone(dest.first).release()),
-          -1);
-      offload->tls_epilogue->insert(
-          AtomicOpStmt::make_for_reduction(dest.second, global_ptr, tls_load),
-          -1);
+      if (num_deterministic_reductions <
+              taichi_max_num_deterministic_reductions &&
+          is_deterministic_reduction(offload, dest, config)) {
+        // The partial sums are stored by task (or by warp), and the last one
+        // adds them up in order, see deterministic_reduce_add_*.
+        auto *epilogue = offload->tls_epilogue.get();
+        auto id = epilogue->push_back<ConstStmt>(
+            TypedConstant(num_deterministic_reductions++));
+        auto sum = epilogue->push_back<AllocaStmt>(data_type);
+        auto is_last = epilogue->push_back<InternalFuncStmt>(
+            "deterministic_reduce_add_" + data_type_name(data_type),
+            std::vector<Stmt *>{id, tls_load}, std::vector<Stmt *>{sum});
+        auto if_last = epilogue->push_back<IfStmt>(is_last)->as<IfStmt>();
+        if_last->set_true_statements(std::make_unique<Block>());
+        auto *add_sum = if_last->true_statements.get();
+        auto sum_load = add_sum->push_back<LocalLoadStmt>(LocalAddress{sum, 0});
+        auto global_ptr = clone_reduction_destination(dest.first, add_sum);
+        add_sum->push_back<AtomicOpStmt>(dest.second, global_ptr, sum_load);
+      } else {
+        auto *epilogue = offload->tls_epilogue.get();
+        auto global_ptr = clone_reduction_destination(dest.first, epilogue);
+        epilogue->insert(
+            AtomicOpStmt::make_for_reduction(dest.second, global_ptr, tls_load),
+            -1);
+      }
     }
 
     // allocate storage for the TLS variable
@@ -202,10 +258,10 @@ void make_thread_local(IRNode *root, const CompileConfig &config) {
   TI_AUTO_PROF;
   if (auto root_block = root->cast<Block>()) {
     for (auto &offload : root_block->statements) {
-      make_thread_local_offload(offload->cast<OffloadedStmt>());
+      make_thread_local_offload(offload->cast<OffloadedStmt>(), config);
     }
   } else {
-    make_thread_local_offload(root->as<OffloadedStmt>());
+    make_thread_local_offload(root->as<OffloadedStmt>(), config);
   }
   type_check(root, config);
 }
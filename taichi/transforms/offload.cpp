@@ -45,6 +45,72 @@ struct OffloadedRanges {
   Map end_stmts;
 };
 
+// Returns the clear_list and listgen tasks generating the element list of
+// |leaf|.
+VecStatement make_listgen_tasks(SNode *leaf, const CompileConfig &config) {
+  // make a list of nodes, from the leaf block (instead of 'place') to root
+  std::vector<SNode *> path;
+  // leaf is the place (scalar)
+  // leaf->parent is the leaf block
+  // so listgen should be invoked from the root to leaf->parent
+  for (auto p = leaf; p; p = p->parent) {
+    path.push_back(p);
+  }
+  std::reverse(path.begin(), path.end());
+
+  const auto arch = config.arch;
+  std::vector<SNode *> listgen_snodes;
+  for (int i = 1; i < path.size(); i++) {
+    auto snode_child = path[i];
+    if ((snode_child->type == SNodeType::bit_array ||
+         snode_child->type == SNodeType::bit_struct) &&
+        i == path.size() - 1) {
+      continue;
+    }
+    listgen_snodes.push_back(snode_child);
+  }
+  // The listgen of the child of the root is kept separate, since it
+  // expands a single container with more parallelism. The list of the
+  // leaf is then generated from its list in one task.
+  const int num_fused_levels = (int)listgen_snodes.size() - 1;
+  const bool fuse = config.fuse_listgen && !config.async_mode &&
+                    (arch_is_cpu(arch) || arch == Arch::cuda) &&
+                    num_fused_levels >= 2 &&
+                    num_fused_levels <= taichi_listgen_max_fused_levels;
+  VecStatement tasks;
+  for (int i = 0; i < (int)listgen_snodes.size(); i++) {
+    const bool fused = fuse && i > 0;
+    if (fused && i + 1 < (int)listgen_snodes.size()) {
+      continue;
+    }
+    auto snode_child = listgen_snodes[i];
+    // The cells of the first level are still split over the threads.
+    auto snode_split = fused ? listgen_snodes[1] : snode_child;
+    auto offloaded_clear_list = Stmt::make_typed<OffloadedStmt>(
+        OffloadedStmt::TaskType::serial, arch);
+    offloaded_clear_list->body->insert(Stmt::make<ClearListStmt>(snode_child));
+    offloaded_clear_list->grid_dim = 1;
+    offloaded_clear_list->block_dim = 1;
+    // Intentionally do not set offloaded_clear_list->snode, so that there
+    // is nothing special about this task, which could otherwise cause
+    // problems when fused with other serial tasks.
+    tasks.push_back(std::move(offloaded_clear_list));
+    auto offloaded_listgen = Stmt::make_typed<OffloadedStmt>(
+        OffloadedStmt::TaskType::listgen, arch);
+    offloaded_listgen->snode = snode_child;
+    if (fused) {
+      offloaded_listgen->listgen_source = listgen_snodes[0];
+    }
+    offloaded_listgen->grid_dim = config.saturating_grid_dim;
+    offloaded_listgen->block_dim =
+        std::min(snode_split->max_num_elements(),
+                 (int64)std::min(Program::default_block_dim(config),
+                                 config.max_block_dim));
+    tasks.push_back(std::move(offloaded_listgen));
+  }
+  return tasks;
+}
+
 // Break kernel into multiple parts and emit struct for listgens
 // For GPU backends this pass also determines the grid dim and block dims
 class Offloader {
@@ -115,7 +181,10 @@ class Offloader {
             OffloadedStmt::TaskType::mesh_for, arch);
         offloaded->grid_dim = config.saturating_grid_dim;
         if (st->block_dim == 0) {
-          offloaded->block_dim = Program::default_block_dim(config);
+          // On CPUs the block dim is the number of patches per task, which
+          // the runtime picks from the number of patches and threads.
+          offloaded->block_dim =
+              arch_is_cpu(arch) ? 0 : Program::default_block_dim(config);
         } else {
           offloaded->block_dim = st->block_dim;
         }
@@ -145,49 +214,16 @@ class Offloader {
                               const CompileConfig &config,
                               const MemoryAccessOptions &mem_access_opt) {
     auto leaf = for_stmt->snode;
-    // make a list of nodes, from the leaf block (instead of 'place') to root
-    std::vector<SNode *> path;
-    // leaf is the place (scalar)
-    // leaf->parent is the leaf block
-    // so listgen should be invoked from the root to leaf->parent
-    for (auto p = leaf; p; p = p->parent) {
-      path.push_back(p);
-    }
-    std::reverse(path.begin(), path.end());
-
+    const auto arch = config.arch;
     // If |demotable| is true, this will later be demoting into a range-for
     // task, so we don't need to generate clear/listgen tasks.
     const bool demotable =
-        (leaf->is_path_all_dense && config.demote_dense_struct_fors);
-    const auto arch = config.arch;
+        config.demote_dense_struct_fors &&
+        (leaf->is_path_all_dense ||
+         (leaf->is_path_all_dense_or_bitmasked &&
+          config.demote_bitmasked_struct_fors));
     if (!demotable) {
-      for (int i = 1; i < path.size(); i++) {
-        auto snode_child = path[i];
-        if ((snode_child->type == SNodeType::bit_array ||
-             snode_child->type == SNodeType::bit_struct) &&
-            i == path.size() - 1) {
-          continue;
-        }
-        auto offloaded_clear_list = Stmt::make_typed<OffloadedStmt>(
-            OffloadedStmt::TaskType::serial, arch);
-        offloaded_clear_list->body->insert(
-            Stmt::make<ClearListStmt>(snode_child));
-        offloaded_clear_list->grid_dim = 1;
-        offloaded_clear_list->block_dim = 1;
-        // Intentionally do not set offloaded_clear_list->snode, so that there
-        // is nothing special about this task, which could otherwise cause
-        // problems when fused with other serial tasks.
-        root_block->insert(std::move(offloaded_clear_list));
-        auto offloaded_listgen = Stmt::make_typed<OffloadedStmt>(
-            OffloadedStmt::TaskType::listgen, arch);
-        offloaded_listgen->snode = snode_child;
-        offloaded_listgen->grid_dim = config.saturating_grid_dim;
-        offloaded_listgen->block_dim =
-            std::min(snode_child->max_num_elements(),
-                     (int64)std::min(Program::default_block_dim(config),
-                                     config.max_block_dim));
-        root_block->insert(std::move(offloaded_listgen));
-      }
+      root_block->insert(make_listgen_tasks(leaf, config));
     }
 
     auto offloaded_struct_for = Stmt::make_typed<OffloadedStmt>(
@@ -665,6 +701,24 @@ class FixCrossOffloadReferences : public BasicStmtVisitor {
   std::unordered_map<Stmt *, DataType> local_to_global_vector_type_;
 };
 
+// The compaction moves the nodes referenced from the containers of |snode| in
+// its element list, which has to cover every container holding a live node.
+bool is_gc_compactable(SNode *snode, const CompileConfig &config) {
+  if (!config.compact_gc || config.async_mode ||
+      !(arch_is_cpu(config.arch) || config.arch == Arch::cuda) ||
+      snode->type != SNodeType::pointer) {
+    return false;
+  }
+  for (auto p = snode->parent; p; p = p->parent) {
+    // The inactive cells of the other SNodes can still hold live nodes.
+    if (p->type != SNodeType::root && p->type != SNodeType::dense &&
+        p->type != SNodeType::pointer) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void insert_gc(IRNode *root, const CompileConfig &config) {
   auto *b = dynamic_cast<Block *>(root);
   TI_ASSERT(b);
@@ -683,7 +737,14 @@ void insert_gc(IRNode *root, const CompileConfig &config) {
         auto gc_task = Stmt::make_typed<OffloadedStmt>(
             OffloadedStmt::TaskType::gc, config.arch);
         gc_task->snode = snode;
+        gc_task->gc_compact = is_gc_compactable(snode, config);
+        gc_task->num_cpu_threads = config.cpu_max_num_threads;
+        const bool compact = gc_task->gc_compact;
         b->insert(std::move(gc_task), i + 1);
+        if (compact) {
+          // Generates the list of the containers to walk, before the gc.
+          b->insert(make_listgen_tasks(snode, config), i + 1);
+        }
       }
     }
   }
@@ -71,6 +71,7 @@ void ScalarPointerLowerer::run() {
     }
     std::vector<Stmt *> lowered_indices;
     std::vector<int> strides;
+    std::vector<int> axes;
     // extract lowered indices
     for (int k_ = 0; k_ < (int)indices_.size(); k_++) {
       int k = leaf_snode->physical_index_position[k_];
@@ -91,8 +92,14 @@ void ScalarPointerLowerer::run() {
       }
       lowered_indices.push_back(extracted);
       strides.push_back(snode->extractors[k].shape);
+      axes.push_back(k);
     }
     // linearize
+    if (snode->_morton) {
+      lowered_indices = {
+          generate_morton_encode(lowered_, snode, lowered_indices, axes)};
+      strides = {(int)snode->max_num_elements()};
+    }
     auto *linearized =
         lowered_->push_back<LinearizeStmt>(lowered_indices, strides);
 
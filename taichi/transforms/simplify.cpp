@@ -2,6 +2,7 @@
 #include "taichi/ir/statements.h"
 #include "taichi/ir/transforms.h"
 #include "taichi/ir/analysis.h"
+#include "taichi/ir/pass_profiler.h"
 #include "taichi/ir/visitors.h"
 #include "taichi/transforms/simplify.h"
 #include "taichi/program/kernel.h"
@@ -263,6 +264,37 @@ class BasicBlockSimplify : public IRVisitor {
     return true;
   }
 
+  // Splits |stmt| into (base, offset) if it is "base + offset" or
+  // "base - offset" with a constant i32 offset. Returns (nullptr, 0) otherwise.
+  static std::pair<Stmt *, int32> split_constant_offset(Stmt *stmt) {
+    auto binary = stmt->cast<BinaryOpStmt>();
+    if (!binary || binary->width() != 1 ||
+        !binary->ret_type->is_primitive(PrimitiveTypeID::i32)) {
+      return {nullptr, 0};
+    }
+    auto get_const = [](Stmt *s) -> std::optional<int32> {
+      auto c = s->cast<ConstStmt>();
+      if (c && c->width() == 1 &&
+          c->ret_type->is_primitive(PrimitiveTypeID::i32)) {
+        return c->val[0].val_int32();
+      }
+      return std::nullopt;
+    };
+    if (binary->op_type == BinaryOpType::add) {
+      if (auto c = get_const(binary->rhs)) {
+        return {binary->lhs, *c};
+      }
+      if (auto c = get_const(binary->lhs)) {
+        return {binary->rhs, *c};
+      }
+    } else if (binary->op_type == BinaryOpType::sub) {
+      if (auto c = get_const(binary->rhs)) {
+        return {binary->lhs, (int32)(0u - (uint32)*c)};
+      }
+    }
+    return {nullptr, 0};
+  }
+
   void visit(LinearizeStmt *stmt) override {
     if (!stmt->inputs.empty() && stmt->inputs.back()->is<IntegerOffsetStmt>()) {
       auto previous_offset = stmt->inputs.back()->as<IntegerOffsetStmt>();
@@ -277,13 +309,22 @@ class BasicBlockSimplify : public IRVisitor {
       return;
     }
 
-    // Lower into a series of adds and muls.
+    // Lower into a series of adds and muls. The constant offsets of the
+    // inputs are multiplied by the strides here, so that e.g. the unrolled
+    // iterations of a loop share the products of the loop index.
     auto sum = Stmt::make<ConstStmt>(LaneAttribute<TypedConstant>(0));
     auto stride_product = 1;
+    int32 offset = 0;
     for (int i = (int)stmt->inputs.size() - 1; i >= 0; i--) {
+      auto input = stmt->inputs[i];
+      if (auto [base, input_offset] = split_constant_offset(input); base) {
+        input = base;
+        // Wraps around the same way as the products at runtime.
+        offset += (int32)((uint32)input_offset * (uint32)stride_product);
+      }
       auto stride_stmt =
           Stmt::make<ConstStmt>(LaneAttribute<TypedConstant>(stride_product));
-      auto mul = Stmt::make<BinaryOpStmt>(BinaryOpType::mul, stmt->inputs[i],
+      auto mul = Stmt::make<BinaryOpStmt>(BinaryOpType::mul, input,
                                           stride_stmt.get());
       auto newsum =
           Stmt::make<BinaryOpStmt>(BinaryOpType::add, sum.get(), mul.get());
@@ -293,6 +334,15 @@ class BasicBlockSimplify : public IRVisitor {
       modifier.insert_before(stmt, std::move(mul));
       stride_product *= stmt->strides[i];
     }
+    if (offset != 0) {
+      auto offset_stmt =
+          Stmt::make<ConstStmt>(LaneAttribute<TypedConstant>(offset));
+      auto newsum = Stmt::make<BinaryOpStmt>(BinaryOpType::add, sum.get(),
+                                             offset_stmt.get());
+      modifier.insert_before(stmt, std::move(sum));
+      sum = std::move(newsum);
+      modifier.insert_before(stmt, std::move(offset_stmt));
+    }
     // Compare the result with 0 to make sure no overflow occurs under Debug
     // Mode.
     bool debug = config.debug;
@@ -641,7 +691,9 @@ void full_simplify(IRNode *root,
   TI_AUTO_PROF;
   if (config.advanced_optimization) {
     bool first_iteration = true;
+    int iterations = 0;
     while (true) {
+      iterations++;
       bool modified = false;
       if (extract_constant(root, config))
         modified = true;
@@ -650,7 +702,7 @@ void full_simplify(IRNode *root,
       if (binary_op_simplify(root, config))
         modified = true;
       if (config.constant_folding &&
-          constant_fold(root, config, {args.program}))
+          constant_fold(root, config, {}))
         modified = true;
       if (die(root))
         modified = true;
@@ -676,10 +728,14 @@ void full_simplify(IRNode *root,
       if (!modified)
         break;
     }
+    if (PassProfiler::get_instance().get_enabled()) {
+      PassProfiler::get_instance().record_iterations("full_simplify",
+                                                     iterations);
+    }
     return;
   }
   if (config.constant_folding) {
-    constant_fold(root, config, {args.program});
+    constant_fold(root, config, {});
     die(root);
   }
   simplify(root, config);
@@ -0,0 +1,159 @@
+#include <limits>
+
+#include "taichi/ir/ir.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/ir/visitors.h"
+#include "taichi/transforms/utils.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+using TaskType = OffloadedStmt::TaskType;
+
+// Converts a dense struct-for into a range-for which visits the index space
+// tile by tile. A tile spans |tile_size| indices along each axis (or the
+// whole axis if it is shorter), and the tiles themselves are visited in
+// row-major order. Within a tile, the indices are row-major as well.
+bool tile_struct_for(OffloadedStmt *offloaded, int tile_size) {
+  TI_ASSERT(offloaded->task_type == TaskType::struct_for);
+  auto *snode = offloaded->snode;
+  const int num_loop_vars = snode->num_active_indices;
+  if (num_loop_vars < 2) {
+    // Nothing to gain in 1D.
+    return false;
+  }
+
+  std::vector<int> physical_indices(num_loop_vars);
+  std::vector<int> shape(num_loop_vars);
+  std::vector<int> tile_shape(num_loop_vars);
+  std::vector<int> num_tiles(num_loop_vars);
+  int64 tile_volume = 1;
+  int64 total_num_tiles = 1;
+  for (int i = 0; i < num_loop_vars; i++) {
+    physical_indices[i] = snode->physical_index_position[i];
+    shape[i] = snode->shape_along_axis(i);
+    tile_shape[i] = std::min(tile_size, shape[i]);
+    num_tiles[i] = (shape[i] + tile_shape[i] - 1) / tile_shape[i];
+    tile_volume *= tile_shape[i];
+    total_num_tiles *= num_tiles[i];
+  }
+  const int64 total_n = tile_volume * total_num_tiles;
+  if (total_n > std::numeric_limits<int32>::max()) {
+    TI_TRACE("Not tiling the struct-for over {}: too many iterations",
+             snode->get_node_type_name_hinted());
+    return false;
+  }
+
+  offloaded->const_begin = true;
+  offloaded->const_end = true;
+  offloaded->begin_value = 0;
+  offloaded->end_value = total_n;
+  // Each CPU task processes one whole tile.
+  offloaded->block_dim = tile_volume;
+
+  ////// Begin core transformation
+  auto body = std::move(offloaded->body);
+  VecStatement body_header;
+
+  auto main_loop_var = body_header.push_back<LoopIndexStmt>(nullptr, 0);
+  // We will set main_loop_var->loop later.
+  auto tile_id = body_header.push_back<BinaryOpStmt>(
+      BinaryOpType::div, main_loop_var,
+      body_header.push_back<ConstStmt>(TypedConstant((int32)tile_volume)));
+
+  std::vector<Stmt *> new_loop_vars(num_loop_vars);
+  Stmt *test = body_header.push_back<ConstStmt>(TypedConstant(-1));
+  bool has_test = false;
+  int64 local_stride = 1;
+  int64 tile_stride = 1;
+  for (int i = num_loop_vars - 1; i >= 0; i--) {
+    // The index within the tile. Note that tile_volume is a multiple of
+    // local_stride * tile_shape[i].
+    auto local_index = generate_mod_x_div_y(
+        &body_header, main_loop_var, (int)(local_stride * tile_shape[i]),
+        (int)local_stride);
+    auto tile_index = generate_mod_x_div_y(
+        &body_header, tile_id, (int)(tile_stride * num_tiles[i]),
+        (int)tile_stride);
+    auto tile_begin = body_header.push_back<BinaryOpStmt>(
+        BinaryOpType::mul, tile_index,
+        body_header.push_back<ConstStmt>(TypedConstant(tile_shape[i])));
+    new_loop_vars[i] = body_header.push_back<BinaryOpStmt>(
+        BinaryOpType::add, tile_begin, local_index);
+    if (shape[i] % tile_shape[i] != 0) {
+      // The last tile along this axis is partially outside the index space.
+      has_test = true;
+      auto bound = body_header.push_back<ConstStmt>(TypedConstant(shape[i]));
+      auto cmp = body_header.push_back<BinaryOpStmt>(
+          BinaryOpType::cmp_lt, new_loop_vars[i], bound);
+      test =
+          body_header.push_back<BinaryOpStmt>(BinaryOpType::bit_and, test, cmp);
+    }
+    local_stride *= tile_shape[i];
+    tile_stride *= num_tiles[i];
+  }
+
+  irpass::replace_statements(
+      body.get(), /*filter=*/
+      [&](Stmt *s) {
+        if (auto loop_index = s->cast<LoopIndexStmt>()) {
+          return loop_index->loop == offloaded;
+        } else {
+          return false;
+        }
+      },
+      /*finder=*/
+      [&](Stmt *s) {
+        auto index = std::find(physical_indices.begin(), physical_indices.end(),
+                               s->as<LoopIndexStmt>()->index);
+        TI_ASSERT(index != physical_indices.end());
+        return new_loop_vars[index - physical_indices.begin()];
+      });
+
+  if (has_test) {
+    auto if_stmt = Stmt::make_typed<IfStmt>(test);
+    if_stmt->set_true_statements(std::move(body));
+    body = std::make_unique<Block>();
+    body->insert(std::move(if_stmt));
+  }
+  body->insert(std::move(body_header), 0);
+
+  offloaded->body = std::move(body);
+  offloaded->body->parent_stmt = offloaded;
+  main_loop_var->loop = offloaded;
+  ////// End core transformation
+
+  offloaded->task_type = TaskType::range_for;
+  return true;
+}
+
+void maybe_tile(OffloadedStmt *stmt, int tile_size) {
+  if (stmt->task_type == TaskType::struct_for &&
+      stmt->snode->is_path_all_dense && !stmt->bls_prologue) {
+    tile_struct_for(stmt, tile_size);
+  }
+}
+
+}  // namespace
+
+namespace irpass {
+
+void tile_dense_struct_fors(IRNode *root, int tile_size) {
+  TI_ASSERT(tile_size > 0);
+  if (auto *block = root->cast<Block>()) {
+    for (auto &s_ : block->statements) {
+      if (auto *s = s_->cast<OffloadedStmt>()) {
+        maybe_tile(s, tile_size);
+      }
+    }
+  } else if (auto *s = root->cast<OffloadedStmt>()) {
+    maybe_tile(s, tile_size);
+  }
+  re_id(root);
+}
+
+}  // namespace irpass
+
+TLANG_NAMESPACE_END
@@ -65,6 +65,11 @@ class TypeCheck : public IRVisitor {
     } else if (auto cft = dst_type->cast<CustomFloatType>()) {
       auto cit = cft->get_digits_type()->as<CustomIntType>();
       dst_type = cit->get_physical_type();
+    } else if (dst_type->is_primitive(PrimitiveTypeID::bf16)) {
+      // The bf16 value is updated in f32 by codegen.
+      dst_type = PrimitiveType::f32;
+      if (stmt->val->ret_type != dst_type)
+        stmt->val = insert_type_cast_before(stmt, stmt->val, dst_type);
     } else if (stmt->val->ret_type != dst_type) {
       TI_WARN("[{}] Atomic {} ({} to {}) may lose precision, at\n{}",
               stmt->name(), atomic_op_type_name(stmt->op_type),
@@ -108,7 +113,8 @@ class TypeCheck : public IRVisitor {
         stmt->dest->cast<PtrOffsetStmt>()->is_local_ptr()) {
       auto dst_value_type = stmt->dest->ret_type.ptr_removed();
       if (dst_value_type->is<CustomIntType>() ||
-          dst_value_type->is<CustomFloatType>()) {
+          dst_value_type->is<CustomFloatType>() ||
+          dst_value_type->is_primitive(PrimitiveTypeID::bf16)) {
         // We force the value type to be the compute_type of the bit pointer.
         // Casting from compute_type to physical_type is handled in codegen.
         dst_value_type = dst_value_type->get_compute_type();
@@ -212,7 +218,8 @@ class TypeCheck : public IRVisitor {
   void visit(GlobalStoreStmt *stmt) override {
     auto dst_value_type = stmt->dest->ret_type.ptr_removed();
     if (dst_value_type->is<CustomIntType>() ||
-        dst_value_type->is<CustomFloatType>()) {
+        dst_value_type->is<CustomFloatType>() ||
+        dst_value_type->is_primitive(PrimitiveTypeID::bf16)) {
       // We force the value type to be the compute_type of the bit pointer.
       // Casting from compute_type to physical_type is handled in codegen.
       dst_value_type = dst_value_type->get_compute_type();
@@ -254,6 +261,10 @@ class TypeCheck : public IRVisitor {
     stmt->ret_type = stmt->operand->ret_type;
     if (stmt->is_cast()) {
       stmt->ret_type = stmt->cast_type;
+      if (stmt->cast_type->is_primitive(PrimitiveTypeID::bf16)) {
+        // Casting to bf16 rounds the value, which is still computed in f32.
+        stmt->ret_type = PrimitiveType::f32;
+      }
     }
     if (!is_real(stmt->operand->ret_type)) {
       if (is_trigonometric(stmt->op_type)) {
@@ -0,0 +1,143 @@
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/ir/visitors.h"
+#include "taichi/system/profiler.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+// Loops are not unrolled if the unrolled body would exceed this number of
+// statements.
+constexpr int kMaxUnrolledStatements = 1024;
+
+class UnrollInnerLoops : public BasicStmtVisitor {
+ private:
+  const int factor_;
+  DelayedIRModifier modifier_;
+
+ public:
+  using BasicStmtVisitor::visit;
+
+  explicit UnrollInnerLoops(int factor) : factor_(factor) {
+    allow_undefined_visitor = true;
+    invoke_default_visitor = false;
+  }
+
+  static bool is_innermost(RangeForStmt *stmt) {
+    return irpass::analysis::gather_statements(stmt->body.get(), [](Stmt *s) {
+             return s->is<RangeForStmt>() || s->is<StructForStmt>() ||
+                    s->is<MeshForStmt>() || s->is<WhileStmt>() ||
+                    s->is<ContinueStmt>();
+           }).empty();
+  }
+
+  // Appends a copy of the body of |loop| to |dest|, where the loop index is
+  // |index|.
+  static void append_iteration(VecStatement &dest,
+                               RangeForStmt *loop,
+                               Stmt *index) {
+    auto body = irpass::analysis::clone(loop->body.get());
+    irpass::replace_statements(
+        body.get(), /*filter=*/
+        [&](Stmt *s) {
+          auto loop_index = s->cast<LoopIndexStmt>();
+          return loop_index && loop_index->loop == loop;
+        },
+        /*finder=*/[&](Stmt *) { return index; });
+    for (auto &s : body->as<Block>()->statements) {
+      dest.push_back(std::move(s));
+    }
+  }
+
+  void visit(RangeForStmt *stmt) override {
+    if (!is_innermost(stmt)) {
+      stmt->body->accept(this);
+      return;
+    }
+    auto begin = stmt->begin->cast<ConstStmt>();
+    auto end = stmt->end->cast<ConstStmt>();
+    if (!begin || !end || stmt->reversed || stmt->vectorize > 1 ||
+        stmt->bit_vectorize > 1 ||
+        !begin->ret_type->is_primitive(PrimitiveTypeID::i32) ||
+        !end->ret_type->is_primitive(PrimitiveTypeID::i32)) {
+      return;
+    }
+    const int begin_value = begin->val[0].val_int32();
+    const int num_iterations = end->val[0].val_int32() - begin_value;
+    if (num_iterations <= 0) {
+      return;
+    }
+    // A loop of at most |factor_| iterations is unrolled completely.
+    const int factor = std::min(factor_, num_iterations);
+    const int num_unrolled = num_iterations / factor;
+    const int remainder = num_iterations % factor;
+    const int body_size = irpass::analysis::count_statements(stmt->body.get());
+    if ((int64)body_size * (factor + remainder) > kMaxUnrolledStatements) {
+      return;
+    }
+
+    VecStatement new_statements;
+    if (num_unrolled == 1) {
+      for (int k = 0; k < factor; k++) {
+        auto index =
+            new_statements.push_back<ConstStmt>(TypedConstant(begin_value + k));
+        append_iteration(new_statements, stmt, index);
+      }
+    } else {
+      auto zero = new_statements.push_back<ConstStmt>(TypedConstant(0));
+      auto num_unrolled_stmt =
+          new_statements.push_back<ConstStmt>(TypedConstant(num_unrolled));
+      auto body = std::make_unique<Block>();
+      auto new_loop = new_statements.push_back<RangeForStmt>(
+          zero, num_unrolled_stmt, std::move(body), stmt->vectorize,
+          stmt->bit_vectorize, stmt->num_cpu_threads, stmt->block_dim,
+          stmt->strictly_serialized);
+      VecStatement new_body;
+      // index = begin + i * factor + k
+      auto base = new_body.push_back<BinaryOpStmt>(
+          BinaryOpType::mul, new_body.push_back<LoopIndexStmt>(new_loop, 0),
+          new_body.push_back<ConstStmt>(TypedConstant(factor)));
+      for (int k = 0; k < factor; k++) {
+        auto index = new_body.push_back<BinaryOpStmt>(
+            BinaryOpType::add, base,
+            new_body.push_back<ConstStmt>(TypedConstant(begin_value + k)));
+        append_iteration(new_body, stmt, index);
+      }
+      new_loop->body->insert(std::move(new_body));
+    }
+    for (int k = 0; k < remainder; k++) {
+      auto index = new_statements.push_back<ConstStmt>(
+          TypedConstant(begin_value + num_unrolled * factor + k));
+      append_iteration(new_statements, stmt, index);
+    }
+    TI_TRACE("Unrolled a loop of {} iterations by {}", num_iterations, factor);
+    modifier_.replace_with(stmt, std::move(new_statements));
+  }
+
+  static bool run(IRNode *root, int factor) {
+    UnrollInnerLoops unroller(factor);
+    root->accept(&unroller);
+    return unroller.modifier_.modify_ir();
+  }
+};
+
+}  // namespace
+
+namespace irpass {
+
+bool unroll_inner_loops(IRNode *root, const CompileConfig &config) {
+  TI_AUTO_PROF;
+  TI_ASSERT(config.unroll_inner_loop_factor > 1);
+  if (!UnrollInnerLoops::run(root, config.unroll_inner_loop_factor)) {
+    return false;
+  }
+  type_check(root, config);
+  return true;
+}
+
+}  // namespace irpass
+
+TLANG_NAMESPACE_END
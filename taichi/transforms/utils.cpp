@@ -10,5 +10,48 @@ Stmt *generate_mod_x_div_y(VecStatement *stmts, Stmt *num, int x, int y) {
   return stmts->push_back<BinaryOpStmt>(BinaryOpType::div, mod_x, const_y);
 }
 
+namespace {
+
+// |bits| | (the bit at |from| of |num|) << |to|.
+Stmt *generate_move_bit(VecStatement *stmts,
+                        Stmt *bits,
+                        Stmt *num,
+                        int from,
+                        int to) {
+  auto bit = stmts->push_back<BitExtractStmt>(num, from, from + 1);
+  auto scale = stmts->push_back<ConstStmt>(TypedConstant(1 << to));
+  auto moved = stmts->push_back<BinaryOpStmt>(BinaryOpType::mul, bit, scale);
+  return stmts->push_back<BinaryOpStmt>(BinaryOpType::bit_or, bits, moved);
+}
+
+}  // namespace
+
+Stmt *generate_morton_encode(VecStatement *stmts,
+                             const SNode *snode,
+                             const std::vector<Stmt *> &indices,
+                             const std::vector<int> &axes) {
+  Stmt *linear = stmts->push_back<ConstStmt>(TypedConstant(0));
+  for (int k = 0; k < (int)indices.size(); k++) {
+    for (int b = 0; b < snode->extractors[axes[k]].num_bits; b++) {
+      linear = generate_move_bit(stmts, linear, indices[k], b,
+                                 snode->morton_bit_position(axes[k], b));
+    }
+  }
+  return linear;
+}
+
+Stmt *generate_morton_decode(VecStatement *stmts,
+                             const SNode *snode,
+                             Stmt *linear,
+                             int axis,
+                             int offset) {
+  Stmt *index = stmts->push_back<ConstStmt>(TypedConstant(0));
+  for (int b = 0; b < snode->extractors[axis].num_bits; b++) {
+    index = generate_move_bit(stmts, index, linear,
+                              offset + snode->morton_bit_position(axis, b), b);
+  }
+  return index;
+}
+
 }  // namespace lang
 }  // namespace taichi
@@ -5,5 +5,20 @@ namespace lang {
 
 Stmt *generate_mod_x_div_y(VecStatement *stmts, Stmt *num, int x, int y);
 
+// Interleaves |indices|, those of a cell of |snode| along the physical |axes|,
+// into the linear index of the cell in Morton order, see SNode::morton().
+Stmt *generate_morton_encode(VecStatement *stmts,
+                             const SNode *snode,
+                             const std::vector<Stmt *> &indices,
+                             const std::vector<int> &axes);
+
+// The index along the physical |axis| of the cell of |snode| whose linear
+// index in Morton order starts at bit |offset| of |linear|.
+Stmt *generate_morton_decode(VecStatement *stmts,
+                             const SNode *snode,
+                             Stmt *linear,
+                             int axis,
+                             int offset = 0);
+
 }  // namespace lang
 }  // namespace taichi
@@ -264,7 +264,8 @@ class BasicBlockVectorSplit : public IRVisitor {
 
   void visit(RandStmt *stmt) override {
     for (int i = 0; i < current_split_factor; i++) {
-      current_split[i] = Stmt::make<RandStmt>(stmt->element_type());
+      current_split[i] =
+          Stmt::make<RandStmt>(stmt->element_type(), stmt->counter_based);
     }
   }
 
@@ -9,46 +9,17 @@
 
 TLANG_NAMESPACE_BEGIN
 
-// A helper class to maintain WholeKernelCSE::visited
-class MarkUndone : public BasicStmtVisitor {
- private:
-  std::unordered_set<int> *const visited_;
-  Stmt *const modified_operand_;
-
- public:
-  using BasicStmtVisitor::visit;
-
-  MarkUndone(std::unordered_set<int> *visited, Stmt *modified_operand)
-      : visited_(visited), modified_operand_(modified_operand) {
-    allow_undefined_visitor = true;
-    invoke_default_visitor = true;
-  }
-
-  void visit(Stmt *stmt) override {
-    if (stmt->has_operand(modified_operand_)) {
-      visited_->erase(stmt->instance_id);
-    }
-  }
-
-  void preprocess_container_stmt(Stmt *stmt) override {
-    if (stmt->has_operand(modified_operand_)) {
-      visited_->erase(stmt->instance_id);
-    }
-  }
-
-  static void run(std::unordered_set<int> *visited, Stmt *modified_operand) {
-    MarkUndone marker(visited, modified_operand);
-    modified_operand->get_ir_root()->accept(&marker);
-  }
-};
-
-// Whole Kernel Common Subexpression Elimination
+// Whole Kernel Common Subexpression Elimination, implemented as a global
+// value numbering in a single sweep over the IR.
 class WholeKernelCSE : public BasicStmtVisitor {
  private:
-  std::unordered_set<int> visited_;
-  // each scope corresponds to an unordered_set
-  std::vector<std::unordered_map<std::type_index, std::unordered_set<Stmt *>>>
+  // Each scope maps the value hashes to the statements visible in it.
+  std::vector<std::unordered_map<std::size_t, std::vector<Stmt *>>>
       visible_stmts_;
+  // Maps each eliminated statement to the statement replacing it. Operands
+  // are rewritten when their user is visited, so that eliminating a
+  // statement does not scan the whole IR for its usages.
+  std::unordered_map<Stmt *, Stmt *> replacements_;
   DelayedIRModifier modifier_;
 
  public:
@@ -59,12 +30,29 @@ class WholeKernelCSE : public BasicStmtVisitor {
     invoke_default_visitor = true;
   }
 
-  bool is_done(Stmt *stmt) {
-    return visited_.find(stmt->instance_id) != visited_.end();
-  }
-
-  void set_done(Stmt *stmt) {
-    visited_.insert(stmt->instance_id);
+  // Statements with different hashes are never eliminable by each other
+  // in common_statement_eliminable(). Since the operands are visited before
+  // their users, and replaced before the users are hashed, the operands can
+  // be hashed by identity.
+  static std::size_t value_hash(Stmt *stmt) {
+    std::size_t result = std::type_index(typeid(*stmt)).hash_code();
+    auto combine = [&](std::size_t value) {
+      result ^= value + 0x9e3779b9 + (result << 6) + (result >> 2);
+    };
+    if (auto global_ptr = stmt->cast<GlobalPtrStmt>()) {
+      // The indices are compared by value in definitely_same_address().
+      for (auto *snode : global_ptr->snodes.data) {
+        combine(std::hash<SNode *>()(snode));
+      }
+      return result;
+    }
+    if (stmt->is<LoopUniqueStmt>()) {
+      return result;
+    }
+    for (int i = 0; i < stmt->num_operands(); i++) {
+      combine(std::hash<Stmt *>()(stmt->operand(i)));
+    }
+    return result;
   }
 
   static bool common_statement_eliminable(Stmt *this_stmt, Stmt *prev_stmt) {
@@ -92,31 +80,43 @@ class WholeKernelCSE : public BasicStmtVisitor {
     return irpass::analysis::same_statements(this_stmt, prev_stmt);
   }
 
+  void replace_operands(Stmt *stmt) {
+    if (replacements_.empty())
+      return;
+    for (int i = 0; i < stmt->num_operands(); i++) {
+      auto it = replacements_.find(stmt->operand(i));
+      if (it != replacements_.end()) {
+        stmt->set_operand(i, it->second);
+      }
+    }
+  }
+
   void visit(Stmt *stmt) override {
     if (!stmt->common_statement_eliminable())
       return;
     // Generic visitor for all CSE-able statements.
-    if (is_done(stmt)) {
-      visible_stmts_.back()[std::type_index(typeid(*stmt))].insert(stmt);
-      return;
-    }
+    const auto hash = value_hash(stmt);
     for (auto &scope : visible_stmts_) {
-      for (auto &prev_stmt : scope[std::type_index(typeid(*stmt))]) {
-        if (common_statement_eliminable(stmt, prev_stmt)) {
-          MarkUndone::run(&visited_, stmt);
-          stmt->replace_usages_with(prev_stmt);
+      auto it = scope.find(hash);
+      if (it == scope.end()) {
+        continue;
+      }
+      for (auto &prev_stmt : it->second) {
+        if (typeid(*prev_stmt) == typeid(*stmt) &&
+            common_statement_eliminable(stmt, prev_stmt)) {
+          replacements_[stmt] = prev_stmt;
           modifier_.erase(stmt);
           return;
         }
       }
     }
-    visible_stmts_.back()[std::type_index(typeid(*stmt))].insert(stmt);
-    set_done(stmt);
+    visible_stmts_.back()[hash].push_back(stmt);
   }
 
   void visit(Block *stmt_list) override {
     visible_stmts_.emplace_back();
     for (auto &stmt : stmt_list->statements) {
+      replace_operands(stmt.get());
       stmt->accept(this);
     }
     visible_stmts_.pop_back();
@@ -140,6 +140,12 @@ class WholeKernelCSE : public BasicStmtVisitor {
     if (if_stmt->true_statements && if_stmt->false_statements) {
       auto &true_clause = if_stmt->true_statements;
       auto &false_clause = if_stmt->false_statements;
+      // The branches are not visited yet, but the hoisted statements must
+      // not keep using eliminated ones.
+      replace_operands(true_clause->statements[0].get());
+      replace_operands(false_clause->statements[0].get());
+      replace_operands(true_clause->statements.back().get());
+      replace_operands(false_clause->statements.back().get());
       if (irpass::analysis::same_statements(
               true_clause->statements[0].get(),
               false_clause->statements[0].get())) {
@@ -177,6 +183,7 @@ class WholeKernelCSE : public BasicStmtVisitor {
     bool modified = false;
     while (true) {
       node->accept(&eliminator);
+      eliminator.replacements_.clear();
       if (eliminator.modifier_.modify_ir())
         modified = true;
       else
@@ -1,4 +1,5 @@
 #include "taichi/ui/backends/vulkan/renderable.h"
+#include "taichi/system/device_memory_tracker.h"
 #include "taichi/ui/utils/utils.h"
 
 TI_UI_NAMESPACE_BEGIN
@@ -33,6 +34,8 @@ void Renderable::init_buffers() {
   create_index_buffer();
   create_uniform_buffers();
   create_storage_buffers();
+  uploaded_vertices_ = {};
+  uploaded_indices_ = {};
 
   create_bindings();
 }
@@ -58,6 +61,45 @@ void Renderable::update_data(const RenderableInfo &info) {
   config_.vertices_count = num_vertices;
   config_.indices_count = num_indices;
 
+  int vertex_stride = 1;
+  if (info.max_drawn_vertices > 0 && num_vertices > info.max_drawn_vertices) {
+    TI_ERROR_IF(info.indices.valid,
+                "Indexed renderables cannot limit the drawn vertices");
+    // Vulkan only guarantees binding strides of up to 2048 bytes.
+    constexpr int kMaxVertexStride = 2048 / sizeof(Vertex);
+    vertex_stride = std::min<int>(
+        (num_vertices + info.max_drawn_vertices - 1) / info.max_drawn_vertices,
+        kMaxVertexStride);
+  }
+  set_vertex_stride(vertex_stride);
+
+  DevicePtr vbo_dev_ptr = get_device_ptr(&program, info.vbo.snode);
+  uint64_t vbo_size = sizeof(Vertex) * num_vertices;
+  indexed_ = info.indices.valid;
+
+  if (vbo_dev_ptr.device == &app_context_->device()) {
+    // The fields live on the graphics device, so they are bound directly
+    // instead of being copied every frame.
+    DevicePtr ibo_dev_ptr = index_buffer_.get_ptr(0);
+    if (indexed_) {
+      ibo_dev_ptr = get_device_ptr(&program, info.indices.snode);
+    }
+    if (vbo_dev_ptr != vertex_buffer_ptr_ ||
+        ibo_dev_ptr != index_buffer_ptr_) {
+      vertex_buffer_ptr_ = vbo_dev_ptr;
+      index_buffer_ptr_ = ibo_dev_ptr;
+      Renderable::create_bindings();
+    }
+    Stream *stream = app_context_->device().get_graphics_stream();
+    auto cmd_list = stream->new_command_list();
+    cmd_list->vertex_buffer_barrier(vbo_dev_ptr, vbo_size);
+    if (indexed_) {
+      cmd_list->vertex_buffer_barrier(ibo_dev_ptr, num_indices * sizeof(int));
+    }
+    stream->submit(cmd_list.get());
+    return;
+  }
+
   if (num_vertices > config_.max_vertices_count ||
       num_indices > config_.max_indices_count) {
     free_buffers();
@@ -65,13 +107,25 @@ void Renderable::update_data(const RenderableInfo &info) {
     config_.max_indices_count = num_indices;
     init_buffers();
   }
+  if (vertex_buffer_ptr_ != vertex_buffer_.get_ptr(0) ||
+      index_buffer_ptr_ != index_buffer_.get_ptr(0)) {
+    vertex_buffer_ptr_ = vertex_buffer_.get_ptr(0);
+    index_buffer_ptr_ = index_buffer_.get_ptr(0);
+    Renderable::create_bindings();
+  }
 
-  DevicePtr vbo_dev_ptr = get_device_ptr(&program, info.vbo.snode);
-  uint64_t vbo_size = sizeof(Vertex) * num_vertices;
+  auto uploaded_field = [&](SNode *snode, int count) {
+    return UploadedField{snode, count,
+                         program.get_snode_tree_write_version(
+                             snode->get_snode_tree_id())};
+  };
 
   Device::MemcpyCapability memcpy_cap = Device::check_memcpy_capability(
       vertex_buffer_.get_ptr(), vbo_dev_ptr, vbo_size);
-  if (memcpy_cap == Device::MemcpyCapability::Direct) {
+  const auto vertices = uploaded_field(info.vbo.snode, num_vertices);
+  if (vertices == uploaded_vertices_) {
+    // Unchanged.
+  } else if (memcpy_cap == Device::MemcpyCapability::Direct) {
     Device::memcpy_direct(vertex_buffer_.get_ptr(), vbo_dev_ptr, vbo_size);
   } else if (memcpy_cap == Device::MemcpyCapability::RequiresStagingBuffer) {
     Device::memcpy_via_staging(vertex_buffer_.get_ptr(),
@@ -80,12 +134,15 @@ void Renderable::update_data(const RenderableInfo &info) {
   } else {
     TI_NOT_IMPLEMENTED;
   }
+  uploaded_vertices_ = vertices;
 
-  if (info.indices.valid) {
-    indexed_ = true;
+  if (indexed_) {
     DevicePtr ibo_dev_ptr = get_device_ptr(&program, info.indices.snode);
     uint64_t ibo_size = num_indices * sizeof(int);
-    if (memcpy_cap == Device::MemcpyCapability::Direct) {
+    const auto indices = uploaded_field(info.indices.snode, num_indices);
+    if (indices == uploaded_indices_) {
+      // E.g. the static topology of a deforming mesh.
+    } else if (memcpy_cap == Device::MemcpyCapability::Direct) {
       Device::memcpy_direct(index_buffer_.get_ptr(), ibo_dev_ptr, ibo_size);
     } else if (memcpy_cap == Device::MemcpyCapability::RequiresStagingBuffer) {
       Device::memcpy_via_staging(index_buffer_.get_ptr(),
@@ -94,6 +151,7 @@ void Renderable::update_data(const RenderableInfo &info) {
     } else {
       TI_NOT_IMPLEMENTED;
     }
+    uploaded_indices_ = indices;
   }
 }
 
@@ -107,8 +165,8 @@ const Pipeline &Renderable::pipeline() const {
 
 void Renderable::create_bindings() {
   ResourceBinder *binder = pipeline_->resource_binder();
-  binder->vertex_buffer(vertex_buffer_.get_ptr(0), 0);
-  binder->index_buffer(index_buffer_.get_ptr(0), 32);
+  binder->vertex_buffer(vertex_buffer_ptr_, 0);
+  binder->index_buffer(index_buffer_ptr_, 32);
 }
 
 void Renderable::create_graphics_pipeline() {
@@ -129,7 +187,9 @@ void Renderable::create_graphics_pipeline() {
   raster_params.depth_test = true;
   raster_params.depth_write = true;
 
-  std::vector<VertexInputBinding> vertex_inputs = {{0, sizeof(Vertex), false}};
+  // Skipping vertices through the binding stride needs no shader changes.
+  std::vector<VertexInputBinding> vertex_inputs = {
+      {0, sizeof(Vertex) * config_.vertex_stride, false}};
   // TODO: consider using uint8 for colors and normals
   std::vector<VertexInputAttribute> vertex_attribs = {
       {0, 0, BufferFormat::rgb32f, offsetof(Vertex, pos)},
@@ -141,13 +201,26 @@ void Renderable::create_graphics_pipeline() {
       source, raster_params, vertex_inputs, vertex_attribs);
 }
 
+void Renderable::set_vertex_stride(int vertex_stride) {
+  if (vertex_stride == config_.vertex_stride) {
+    return;
+  }
+  config_.vertex_stride = vertex_stride;
+  // Frames are submitted synchronously, so the old pipeline is not in use.
+  pipeline_.reset();
+  create_graphics_pipeline();
+  create_bindings();
+}
+
 void Renderable::create_vertex_buffer() {
   size_t buffer_size = sizeof(Vertex) * config_.max_vertices_count;
+  DeviceMemoryTracker::Scope scope("ggui", "vertex buffer");
 
   Device::AllocParams vb_params{buffer_size, false, false,
                                 app_context_->requires_export_sharing(),
                                 AllocUsage::Vertex};
   vertex_buffer_ = app_context_->device().allocate_memory(vb_params);
+  vertex_buffer_ptr_ = vertex_buffer_.get_ptr(0);
 
   Device::AllocParams staging_vb_params{buffer_size, true, false, false,
                                         AllocUsage::Vertex};
@@ -157,11 +230,13 @@ void Renderable::create_vertex_buffer() {
 
 void Renderable::create_index_buffer() {
   size_t buffer_size = sizeof(int) * config_.max_indices_count;
+  DeviceMemoryTracker::Scope scope("ggui", "index buffer");
 
   Device::AllocParams ib_params{buffer_size, false, false,
                                 app_context_->requires_export_sharing(),
                                 AllocUsage::Index};
   index_buffer_ = app_context_->device().allocate_memory(ib_params);
+  index_buffer_ptr_ = index_buffer_.get_ptr(0);
 
   Device::AllocParams staging_ib_params{buffer_size, true, false, false,
                                         AllocUsage::Index};
@@ -177,6 +252,7 @@ void Renderable::create_uniform_buffers() {
 
   Device::AllocParams ub_params{buffer_size, true, false, false,
                                 AllocUsage::Uniform};
+  DeviceMemoryTracker::Scope scope("ggui", "uniform buffer");
   uniform_buffer_ = app_context_->device().allocate_memory(ub_params);
 }
 
@@ -188,6 +264,7 @@ void Renderable::create_storage_buffers() {
 
   Device::AllocParams sb_params{buffer_size, true, false, false,
                                 AllocUsage::Storage};
+  DeviceMemoryTracker::Scope scope("ggui", "storage buffer");
   storage_buffer_ = app_context_->device().allocate_memory(sb_params);
 }
 
@@ -217,7 +294,8 @@ void Renderable::record_this_frame_commands(CommandList *command_list) {
   if (indexed_) {
     command_list->draw_indexed(config_.indices_count, 0, 0);
   } else {
-    command_list->draw(config_.vertices_count, 0);
+    const int stride = config_.vertex_stride;
+    command_list->draw((config_.vertices_count + stride - 1) / stride, 0);
   }
 }
 
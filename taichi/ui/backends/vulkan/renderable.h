@@ -34,6 +34,8 @@ struct RenderableConfig {
   std::string vertex_shader_path;
   std::string fragment_shader_path;
   taichi::lang::TopologyType topology_type;
+  // Only every |vertex_stride|-th vertex is drawn.
+  int vertex_stride{1};
 };
 
 class Renderable {
@@ -64,11 +66,31 @@ class Renderable {
   taichi::lang::DeviceAllocation staging_vertex_buffer_;
   taichi::lang::DeviceAllocation staging_index_buffer_;
 
+  // The buffers bound for drawing: either the ones above, or the fields
+  // themselves when they live on the graphics device.
+  taichi::lang::DevicePtr vertex_buffer_ptr_;
+  taichi::lang::DevicePtr index_buffer_ptr_;
+
   taichi::lang::DeviceAllocation uniform_buffer_;
   taichi::lang::DeviceAllocation storage_buffer_;
 
   bool indexed_{false};
 
+  // The field last copied into |vertex_buffer_| or |index_buffer_|, which is
+  // not copied again until a kernel may have written it, see
+  // Program::get_snode_tree_write_version().
+  struct UploadedField {
+    taichi::lang::SNode *snode{nullptr};
+    int count{0};
+    uint64 version{0};
+
+    bool operator==(const UploadedField &o) const {
+      return snode == o.snode && count == o.count && version == o.version;
+    }
+  };
+  UploadedField uploaded_vertices_;
+  UploadedField uploaded_indices_;
+
  protected:
   void init(const RenderableConfig &config_, AppContext *app_context);
   void free_buffers();
@@ -79,6 +101,8 @@ class Renderable {
 
   void create_graphics_pipeline();
 
+  void set_vertex_stride(int vertex_stride);
+
   void create_vertex_buffer();
 
   void create_index_buffer();
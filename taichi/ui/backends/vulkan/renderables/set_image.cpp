@@ -1,5 +1,7 @@
 #include "set_image.h"
 
+#include "taichi/system/device_memory_tracker.h"
+
 #include "taichi/ui/utils/utils.h"
 
 TI_UI_NAMESPACE_BEGIN
@@ -49,16 +51,23 @@ void SetImage::update_data(const SetImageInfo &info) {
   DevicePtr img_dev_ptr = get_device_ptr(&program, img.snode);
   uint64_t img_size = pixels * 4;
 
-  Device::MemcpyCapability memcpy_cap = Device::check_memcpy_capability(
-      gpu_staging_buffer_.get_ptr(), img_dev_ptr, img_size);
-  if (memcpy_cap == Device::MemcpyCapability::Direct) {
-    Device::memcpy_direct(gpu_staging_buffer_.get_ptr(), img_dev_ptr, img_size);
-  } else if (memcpy_cap == Device::MemcpyCapability::RequiresStagingBuffer) {
-    Device::memcpy_via_staging(gpu_staging_buffer_.get_ptr(),
-                               cpu_staging_buffer_.get_ptr(), img_dev_ptr,
-                               img_size);
-  } else {
-    TI_NOT_IMPLEMENTED;
+  // On the device of the program, the texture is copied from the field
+  // itself, whose offset in the root buffer must be a multiple of the texel
+  // size. Otherwise the field goes through the staging buffers.
+  DevicePtr src_ptr = img_dev_ptr;
+  if (img_dev_ptr.device != &app_context_->device() ||
+      img_dev_ptr.offset % 4 != 0) {
+    src_ptr = gpu_staging_buffer_.get_ptr(0);
+    Device::MemcpyCapability memcpy_cap =
+        Device::check_memcpy_capability(src_ptr, img_dev_ptr, img_size);
+    if (memcpy_cap == Device::MemcpyCapability::Direct) {
+      Device::memcpy_direct(src_ptr, img_dev_ptr, img_size);
+    } else if (memcpy_cap == Device::MemcpyCapability::RequiresStagingBuffer) {
+      Device::memcpy_via_staging(src_ptr, cpu_staging_buffer_.get_ptr(),
+                                 img_dev_ptr, img_size);
+    } else {
+      TI_NOT_IMPLEMENTED;
+    }
   }
 
   BufferImageCopyParams copy_params;
@@ -68,8 +77,8 @@ void SetImage::update_data(const SetImageInfo &info) {
 
   auto stream = app_context_->device().get_graphics_stream();
   auto cmd_list = stream->new_command_list();
-  cmd_list->buffer_to_image(texture_, gpu_staging_buffer_.get_ptr(0),
-                            ImageLayout::transfer_dst, copy_params);
+  cmd_list->buffer_to_image(texture_, src_ptr, ImageLayout::transfer_dst,
+                            copy_params);
 
   cmd_list->image_transition(texture_, ImageLayout::transfer_dst,
                              ImageLayout::shader_read);
@@ -123,6 +132,7 @@ void SetImage::create_texture() {
 
   texture_ = app_context_->device().create_image(params);
 
+  DeviceMemoryTracker::Scope scope("ggui", "image staging");
   Device::AllocParams cpu_staging_buffer_params{image_size, true, false, false,
                                                 AllocUsage::Uniform};
   cpu_staging_buffer_ =
@@ -20,6 +20,11 @@ std::unique_ptr<Renderable> get_new_renderable(AppContext *app_context) {
 
 template <typename T>
 T *Renderer::get_renderable_of_type() {
+  if (next_renderable_ == 0) {
+    // The renderables keep a single copy of their buffers, which the frame
+    // submitted last may still be reading.
+    vulkan_surface().wait_for_last_frame();
+  }
   if (next_renderable_ >= renderables_.size()) {
     renderables_.push_back(get_new_renderable<T>(&app_context_));
   } else if (dynamic_cast<T *>(renderables_[next_renderable_].get()) ==
@@ -103,6 +108,7 @@ void Renderer::scene(Scene *scene) {
 }
 
 void Renderer::cleanup() {
+  vulkan_surface().wait_for_last_frame();
   for (auto &renderable : renderables_) {
     renderable->cleanup();
   }
@@ -148,7 +154,7 @@ void Renderer::draw_frame(Gui *gui) {
 
   gui->draw(cmd_list.get());
   cmd_list->end_renderpass();
-  stream->submit_synced(cmd_list.get());
+  vulkan_surface().submit_frame(std::move(cmd_list));
 }
 
 const AppContext &Renderer::app_context() const {
@@ -167,6 +173,10 @@ SwapChain &Renderer::swap_chain() {
   return swap_chain_;
 }
 
+VulkanSurface &Renderer::vulkan_surface() {
+  return static_cast<VulkanSurface &>(swap_chain_.surface());
+}
+
 }  // namespace vulkan
 
 TI_UI_NAMESPACE_END
@@ -75,6 +75,8 @@ class Renderer {
 
   template <typename T>
   T *get_renderable_of_type();
+
+  taichi::lang::vulkan::VulkanSurface &vulkan_surface();
 };
 
 }  // namespace vulkan
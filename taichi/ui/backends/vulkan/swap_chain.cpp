@@ -17,6 +17,7 @@ void SwapChain::init(class AppContext *app_context) {
   config.window_handle = app_context_->glfw_window();
   config.width = app_context_->config.width;
   config.height = app_context_->config.height;
+  config.frames_in_flight = app_context_->config.frames_in_flight;
   surface_ = app_context_->device().create_surface(config);
   auto [w, h] = surface_->get_size();
   curr_width_ = w;
@@ -0,0 +1,115 @@
+#include "taichi/ui/backends/vulkan/video_writer.h"
+
+#include "taichi/ui/backends/vulkan/app_context.h"
+#include "taichi/ui/backends/vulkan/swap_chain.h"
+
+TI_UI_NAMESPACE_BEGIN
+
+namespace vulkan {
+
+using namespace taichi::lang;
+using namespace taichi::lang::vulkan;
+
+namespace {
+FILE *open_pipe(const std::string &command) {
+#if defined(TI_PLATFORM_WINDOWS)
+  return _popen(command.c_str(), "wb");
+#else
+  return popen(command.c_str(), "w");
+#endif
+}
+
+int close_pipe(FILE *pipe) {
+#if defined(TI_PLATFORM_WINDOWS)
+  return _pclose(pipe);
+#else
+  return pclose(pipe);
+#endif
+}
+}  // namespace
+
+VideoWriter::VideoWriter(AppContext *app_context,
+                         SwapChain *swap_chain,
+                         const std::string &filename,
+                         int framerate,
+                         const std::string &encoder)
+    : app_context_(app_context), swap_chain_(swap_chain) {
+  auto &surface = swap_chain_->surface();
+  std::tie(width_, height_) = surface.get_size();
+  const auto format = surface.image_format();
+  const bool is_bgra =
+      format == BufferFormat::bgra8 || format == BufferFormat::bgra8srgb;
+  // yuv420p, which most players expect, needs even sizes.
+  const std::string command = fmt::format(
+      "ffmpeg -loglevel error -y -f rawvideo -pix_fmt {} -s {}x{} -r {} -i - "
+      "-vf \"pad=ceil(iw/2)*2:ceil(ih/2)*2\" -c:v {} -pix_fmt yuv420p \"{}\"",
+      is_bgra ? "bgra" : "rgba", width_, height_, framerate, encoder,
+      filename);
+  pipe_ = open_pipe(command);
+  TI_ERROR_IF(pipe_ == nullptr, "Failed to run [{}]", command);
+
+  auto &device = app_context_->device();
+  readbacks_.resize(kNumReadbacks);
+  for (auto &readback : readbacks_) {
+    Device::AllocParams params{(uint64_t)width_ * height_ * 4,
+                               /*host_write=*/false, /*host_read=*/true,
+                               /*export_sharing=*/false, AllocUsage::Uniform};
+    readback.buffer = device.allocate_memory(params);
+    readback.fence = vkapi::create_fence(device.vk_device(), 0);
+  }
+}
+
+VideoWriter::~VideoWriter() {
+  close();
+  for (auto &readback : readbacks_) {
+    app_context_->device().dealloc_memory(readback.buffer);
+  }
+}
+
+void VideoWriter::write_frame() {
+  TI_ERROR_IF(pipe_ == nullptr, "The video is already closed");
+  auto &surface = static_cast<VulkanSurface &>(swap_chain_->surface());
+  auto [w, h] = surface.get_size();
+  TI_ERROR_IF(w != width_ || h != height_,
+              "The window is resized to {}x{} while recording a {}x{} video",
+              w, h, width_, height_);
+  // The oldest copy, which is most likely done by now.
+  Readback &readback = readbacks_[next_readback_];
+  flush(readback);
+  readback.cmdlist = surface.copy_image_data(readback.buffer.get_ptr(),
+                                             readback.fence->fence);
+  next_readback_ = (next_readback_ + 1) % kNumReadbacks;
+}
+
+void VideoWriter::flush(Readback &readback) {
+  if (!readback.cmdlist) {
+    return;
+  }
+  auto &device = app_context_->device();
+  vkWaitForFences(device.vk_device(), 1, &readback.fence->fence, VK_TRUE,
+                  UINT64_MAX);
+  vkResetFences(device.vk_device(), 1, &readback.fence->fence);
+  readback.cmdlist = nullptr;
+
+  void *ptr = device.map(readback.buffer);
+  fwrite(ptr, 1, (size_t)width_ * height_ * 4, pipe_);
+  device.unmap(readback.buffer);
+}
+
+void VideoWriter::close() {
+  if (pipe_ == nullptr) {
+    return;
+  }
+  // In the order the frames were written.
+  for (int i = 0; i < kNumReadbacks; i++) {
+    flush(readbacks_[(next_readback_ + i) % kNumReadbacks]);
+  }
+  if (close_pipe(pipe_) != 0) {
+    TI_WARN("ffmpeg failed to encode the video");
+  }
+  pipe_ = nullptr;
+}
+
+}  // namespace vulkan
+
+TI_UI_NAMESPACE_END
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "taichi/ui/utils/utils.h"
+#include "taichi/backends/vulkan/vulkan_device.h"
+
+TI_UI_NAMESPACE_BEGIN
+
+namespace vulkan {
+
+class AppContext;
+class SwapChain;
+
+// Streams the rendered frames as raw pixels into an ffmpeg process, which
+// encodes them with |encoder|, e.g. libx264, or h264_nvenc on NVIDIA GPUs.
+// Unlike SwapChain::write_image(), the readback does not wait for the GPU:
+// each frame is copied to one of a few host readable buffers, and written to
+// ffmpeg once the copy is done, a few frames later.
+class VideoWriter {
+ public:
+  VideoWriter(AppContext *app_context,
+              SwapChain *swap_chain,
+              const std::string &filename,
+              int framerate,
+              const std::string &encoder);
+  ~VideoWriter();
+
+  // Starts reading back the image the last frame was rendered to.
+  void write_frame();
+
+  // Writes the frames still being read back, and waits for ffmpeg to finish.
+  void close();
+
+ private:
+  struct Readback {
+    taichi::lang::DeviceAllocation buffer{taichi::lang::kDeviceNullAllocation};
+    vkapi::IVkFence fence{nullptr};
+    // Alive while the copy is in flight, nullptr otherwise.
+    std::unique_ptr<taichi::lang::CommandList> cmdlist{nullptr};
+  };
+
+  void flush(Readback &readback);
+
+  static constexpr int kNumReadbacks = 3;
+
+  AppContext *app_context_{nullptr};
+  SwapChain *swap_chain_{nullptr};
+  uint32_t width_{0};
+  uint32_t height_{0};
+  FILE *pipe_{nullptr};
+
+  std::vector<Readback> readbacks_;
+  int next_readback_{0};
+};
+
+}  // namespace vulkan
+
+TI_UI_NAMESPACE_END
@@ -81,6 +81,7 @@ void Window::present_frame() {
 }
 
 Window::~Window() {
+  video_writer_.reset();
   gui_->cleanup();
   renderer_->cleanup();
   if (config_.show_window) {
@@ -98,6 +99,30 @@ void Window::write_image(const std::string &filename) {
   }
 }
 
+void Window::start_video(const std::string &filename,
+                         int framerate,
+                         const std::string &encoder) {
+  TI_ERROR_IF(video_writer_ != nullptr, "A video is already being recorded");
+  video_writer_ = std::make_unique<VideoWriter>(
+      &renderer_->app_context(), &renderer_->swap_chain(), filename, framerate,
+      encoder);
+}
+
+void Window::write_video_frame() {
+  TI_ERROR_IF(video_writer_ == nullptr, "Call start_video() first");
+  if (!drawn_frame_) {
+    draw_frame();
+  }
+  video_writer_->write_frame();
+  if (!config_.show_window) {
+    prepare_for_next_frame();
+  }
+}
+
+void Window::end_video() {
+  video_writer_.reset();
+}
+
 }  // namespace vulkan
 
 TI_UI_NAMESPACE_END
@@ -21,6 +21,7 @@
 #include "taichi/ui/backends/vulkan/renderer.h"
 #include "taichi/ui/common/window_base.h"
 #include "taichi/ui/backends/vulkan/gui.h"
+#include "taichi/ui/backends/vulkan/video_writer.h"
 
 TI_UI_NAMESPACE_BEGIN
 
@@ -36,12 +37,19 @@ class Window final : public WindowBase {
 
   void write_image(const std::string &filename) override;
 
+  void start_video(const std::string &filename,
+                   int framerate,
+                   const std::string &encoder) override;
+  void write_video_frame() override;
+  void end_video() override;
+
   ~Window();
 
  private:
   std::unique_ptr<Canvas> canvas_;
   std::unique_ptr<Gui> gui_;
   std::unique_ptr<Renderer> renderer_;
+  std::unique_ptr<VideoWriter> video_writer_;
   bool drawn_frame_{false};
 
  private:
@@ -15,6 +15,7 @@ struct AppConfig {
   std::string package_path;
   taichi::lang::Arch ti_arch;
   bool is_packed_mode{false};
+  int frames_in_flight{2};
 };
 
 TI_UI_NAMESPACE_END
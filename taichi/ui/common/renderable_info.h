@@ -8,6 +8,10 @@ struct RenderableInfo {
   FieldInfo vbo;
   FieldInfo indices;
   bool has_per_vertex_color;
+  // If positive and smaller than the number of vertices, only about this many
+  // vertices, evenly strided through |vbo|, are drawn. This is a cheap level
+  // of detail for huge particle sets. Requires invalid |indices|.
+  int max_drawn_vertices{0};
 };
 
 TI_UI_NAMESPACE_END
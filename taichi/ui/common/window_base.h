@@ -41,6 +41,12 @@ class WindowBase {
 
   virtual void write_image(const std::string &filename) = 0;
 
+  virtual void start_video(const std::string &filename,
+                           int framerate,
+                           const std::string &encoder) = 0;
+  virtual void write_video_frame() = 0;
+  virtual void end_video() = 0;
+
   virtual GuiBase *GUI();
 
   virtual ~WindowBase();
@@ -98,6 +98,14 @@ Bitset Bitset::operator~() const {
   return result;
 }
 
+bool Bitset::operator==(const Bitset &other) const {
+  return vec_ == other.vec_;
+}
+
+bool Bitset::operator!=(const Bitset &other) const {
+  return !(*this == other);
+}
+
 int Bitset::find_first_one() const {
   return lower_bound(0);
 }
@@ -174,6 +182,38 @@ Bitset::reference &Bitset::reference::flip() {
   return *this;
 }
 
+Bitset &Bitset::or_eq_prefix(const Bitset &other) {
+  const int len = other.vec_.size();
+  TI_ASSERT(len <= vec_.size());
+  for (int i = 0; i < len; i++) {
+    vec_[i] |= other.vec_[i];
+  }
+  return *this;
+}
+
+Bitset Bitset::slice(int begin, int end) const {
+  TI_ASSERT(0 <= begin && begin <= end);
+  Bitset result(end - begin);
+  const int len = vec_.size();
+  const int shift = begin % kBits;
+  for (int i = 0; i < (int)result.vec_.size(); i++) {
+    const int src = begin / kBits + i;
+    value_t value = 0;
+    if (src < len) {
+      value = vec_[src] >> shift;
+      if (shift != 0 && src + 1 < len) {
+        value |= vec_[src + 1] << (kBits - shift);
+      }
+    }
+    result.vec_[i] = value;
+  }
+  if ((end - begin) % kBits != 0) {
+    // Clear the bits from |end| on.
+    result.vec_.back() &= (((value_t)1) << ((end - begin) % kBits)) - 1;
+  }
+  return result;
+}
+
 std::ostream &operator<<(std::ostream &os, const Bitset &b) {
   for (auto &val : b.vec_)
     for (int j = 0; j < Bitset::kBits; j++)
@@ -239,6 +279,21 @@ TI_TEST("bit") {
   CHECK(reinterpret_bits<float32>(reinterpret_bits<uint32>(1.32_f32)) ==
         1.32_f32);
 
+  Bitset x(200);
+  x[3] = true;
+  x[70] = true;
+  x[130] = true;
+  auto y = x.slice(3, 131);
+  CHECK(y.size() == 128);
+  CHECK(y.find_first_one() == 0);
+  CHECK(y.lower_bound(1) == 67);
+  CHECK(y.lower_bound(68) == 127);
+  CHECK(x.slice(4, 70).none());
+  CHECK(x.slice(190, 260).none());
+  Bitset z(300);
+  z.or_eq_prefix(x);
+  CHECK(z.lower_bound(71) == 130);
+
   // float64 t = 123.456789;
   // auto e = extract(t);
   // TI_P(std::get<0>(e));
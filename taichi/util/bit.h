@@ -185,6 +185,8 @@ class Bitset {
   Bitset operator|(const Bitset &other) const;
   Bitset &operator^=(const Bitset &other);
   Bitset operator~() const;
+  bool operator==(const Bitset &other) const;
+  bool operator!=(const Bitset &other) const;
 
   // Find the place of the first "1", or return -1 if it doesn't exist.
   int find_first_one() const;
@@ -194,6 +196,13 @@ class Bitset {
 
   std::vector<int> or_eq_get_update_list(const Bitset &other);
 
+  // Same as |= but |other| may be shorter than this bitset.
+  Bitset &or_eq_prefix(const Bitset &other);
+
+  // Returns the bits in [begin, end) as a new bitset. Bits beyond size() are
+  // treated as zeros.
+  Bitset slice(int begin, int end) const;
+
   // output from the lowest bit to the highest bit
   friend std::ostream &operator<<(std::ostream &os, const Bitset &b);
 
@@ -0,0 +1,130 @@
+#include "taichi/util/metrics.h"
+
+#include <algorithm>
+#include <sstream>
+
+TI_NAMESPACE_BEGIN
+
+Histogram::Histogram(std::string name,
+                     std::string help,
+                     std::vector<float64> bounds)
+    : Metric(std::move(name), std::move(help), Type::histogram),
+      bounds_(std::move(bounds)),
+      buckets_(new std::atomic<int64>[bounds_.size() + 1]) {
+  TI_ASSERT(std::is_sorted(bounds_.begin(), bounds_.end()));
+  reset();
+}
+
+void Histogram::observe(float64 value) {
+  const auto bucket =
+      std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  auto sum = sum_.load(std::memory_order_relaxed);
+  while (!sum_.compare_exchange_weak(sum, sum + value,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+std::vector<int64> Histogram::get_bucket_counts() const {
+  std::vector<int64> counts(bounds_.size() + 1);
+  int64 total = 0;
+  for (int i = 0; i < (int)counts.size(); i++) {
+    total += buckets_[i].load(std::memory_order_relaxed);
+    counts[i] = total;
+  }
+  return counts;
+}
+
+void Histogram::reset() {
+  for (int i = 0; i <= (int)bounds_.size(); i++) {
+    buckets_[i].store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+}
+
+template <typename T, typename... Args>
+T &MetricsRegistry::get_or_register(const std::string &name, Args &&...args) {
+  std::lock_guard<std::mutex> _(mut_);
+  auto &metric = metrics_[name];
+  if (!metric) {
+    metric = std::make_unique<T>(name, std::forward<Args>(args)...);
+  }
+  auto *result = dynamic_cast<T *>(metric.get());
+  TI_ERROR_IF(!result, "Metric {} is registered with another type", name);
+  return *result;
+}
+
+Counter &MetricsRegistry::counter(const std::string &name,
+                                  const std::string &help) {
+  return get_or_register<Counter>(name, help);
+}
+
+Gauge &MetricsRegistry::gauge(const std::string &name,
+                              const std::string &help) {
+  return get_or_register<Gauge>(name, help);
+}
+
+Histogram &MetricsRegistry::histogram(const std::string &name,
+                                      const std::string &help,
+                                      const std::vector<float64> &bounds) {
+  return get_or_register<Histogram>(name, help, bounds);
+}
+
+std::map<std::string, float64> MetricsRegistry::get_values() {
+  std::lock_guard<std::mutex> _(mut_);
+  std::map<std::string, float64> values;
+  for (auto &[name, metric] : metrics_) {
+    if (auto *counter = dynamic_cast<Counter *>(metric.get())) {
+      values[name] = counter->get();
+    } else if (auto *gauge = dynamic_cast<Gauge *>(metric.get())) {
+      values[name] = gauge->get();
+    } else if (auto *hist = dynamic_cast<Histogram *>(metric.get())) {
+      values[name + "_count"] = hist->get_count();
+      values[name + "_sum"] = hist->get_sum();
+    }
+  }
+  return values;
+}
+
+std::string MetricsRegistry::to_openmetrics() {
+  std::lock_guard<std::mutex> _(mut_);
+  std::stringstream ss;
+  for (auto &[name, metric] : metrics_) {
+    ss << fmt::format("# HELP {} {}\n", name, metric->help());
+    if (auto *counter = dynamic_cast<Counter *>(metric.get())) {
+      ss << fmt::format("# TYPE {} counter\n", name);
+      ss << fmt::format("{}_total {}\n", name, counter->get());
+    } else if (auto *gauge = dynamic_cast<Gauge *>(metric.get())) {
+      ss << fmt::format("# TYPE {} gauge\n", name);
+      ss << fmt::format("{} {}\n", name, gauge->get());
+    } else if (auto *hist = dynamic_cast<Histogram *>(metric.get())) {
+      ss << fmt::format("# TYPE {} histogram\n", name);
+      const auto counts = hist->get_bucket_counts();
+      for (int i = 0; i < (int)hist->bounds().size(); i++) {
+        ss << fmt::format("{}_bucket{{le=\"{}\"}} {}\n", name,
+                          hist->bounds()[i], counts[i]);
+      }
+      ss << fmt::format("{}_bucket{{le=\"+Inf\"}} {}\n", name, counts.back());
+      ss << fmt::format("{}_sum {}\n", name, hist->get_sum());
+      ss << fmt::format("{}_count {}\n", name, hist->get_count());
+    }
+  }
+  ss << "# EOF\n";
+  return ss.str();
+}
+
+void MetricsRegistry::reset() {
+  std::lock_guard<std::mutex> _(mut_);
+  for (auto &[name, metric] : metrics_) {
+    metric->reset();
+  }
+}
+
+MetricsRegistry &metrics() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+TI_NAMESPACE_END
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "taichi/common/core.h"
+
+TI_NAMESPACE_BEGIN
+
+/**
+ * A metric of the runtime, e.g. the number of kernel launches, registered
+ * once in the global MetricsRegistry. Updates are lock-free, so that they can
+ * be done on the hot paths through a reference obtained at registration.
+ */
+class Metric {
+ public:
+  enum class Type { counter, gauge, histogram };
+
+  Metric(std::string name, std::string help, Type type)
+      : name_(std::move(name)), help_(std::move(help)), type_(type) {
+  }
+
+  virtual ~Metric() = default;
+
+  const std::string &name() const {
+    return name_;
+  }
+
+  const std::string &help() const {
+    return help_;
+  }
+
+  Type type() const {
+    return type_;
+  }
+
+  virtual void reset() = 0;
+
+ private:
+  std::string name_;
+  std::string help_;
+  Type type_;
+};
+
+// A monotonically increasing integer, e.g. a number of events or of bytes.
+class Counter : public Metric {
+ public:
+  Counter(std::string name, std::string help)
+      : Metric(std::move(name), std::move(help), Type::counter) {
+  }
+
+  void add(int64 value = 1) {
+    value_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  int64 get() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+  void reset() override {
+    value_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64> value_{0};
+};
+
+// An integer that goes up and down, e.g. a number of bytes in use.
+class Gauge : public Metric {
+ public:
+  Gauge(std::string name, std::string help)
+      : Metric(std::move(name), std::move(help), Type::gauge) {
+  }
+
+  void add(int64 value) {
+    value_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  void set(int64 value) {
+    value_.store(value, std::memory_order_relaxed);
+  }
+
+  int64 get() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+  void reset() override {
+    value_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64> value_{0};
+};
+
+// The distribution of observed values, e.g. compilation times, over buckets
+// with the given upper bounds plus an implicit +Inf one.
+class Histogram : public Metric {
+ public:
+  Histogram(std::string name, std::string help, std::vector<float64> bounds);
+
+  void observe(float64 value);
+
+  const std::vector<float64> &bounds() const {
+    return bounds_;
+  }
+
+  // The cumulative count of each bucket, the +Inf one last.
+  std::vector<int64> get_bucket_counts() const;
+
+  int64 get_count() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  float64 get_sum() const {
+    return sum_.load(std::memory_order_relaxed);
+  }
+
+  void reset() override;
+
+ private:
+  std::vector<float64> bounds_;
+  // Not cumulative. One more than |bounds_|, for +Inf.
+  std::unique_ptr<std::atomic<int64>[]> buckets_;
+  std::atomic<int64> count_{0};
+  std::atomic<float64> sum_{0};
+};
+
+/**
+ * The metrics of the runtime, exported in the OpenMetrics text format for
+ * monitoring systems such as Prometheus.
+ *
+ * Registering a metric twice returns the same one, so the call sites simply
+ * keep a function-local static reference:
+ *
+ *   static auto &launches =
+ *       metrics().counter("taichi_kernel_launches", "Kernel launches.");
+ *   launches.add();
+ */
+class MetricsRegistry {
+ public:
+  // Counters are named without the "_total" suffix of their sample.
+  Counter &counter(const std::string &name, const std::string &help);
+
+  Gauge &gauge(const std::string &name, const std::string &help);
+
+  Histogram &histogram(const std::string &name,
+                       const std::string &help,
+                       const std::vector<float64> &bounds);
+
+  // The current values of the counters and the gauges by name. The
+  // histograms contribute their "_count" and "_sum".
+  std::map<std::string, float64> get_values();
+
+  std::string to_openmetrics();
+
+  // Zeroes all the metrics, keeping them registered.
+  void reset();
+
+ private:
+  template <typename T, typename... Args>
+  T &get_or_register(const std::string &name, Args &&...args);
+
+  std::mutex mut_;
+  std::map<std::string, std::unique_ptr<Metric>> metrics_;
+};
+
+MetricsRegistry &metrics();
+
+TI_NAMESPACE_END
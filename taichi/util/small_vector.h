@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "taichi/common/core.h"
+
+TI_NAMESPACE_BEGIN
+
+/**
+ * A vector holding up to |N| elements inline, so that the common small cases
+ * need no heap allocation. It moves to the heap once it outgrows them.
+ *
+ * Used for the per-statement containers of the IR, e.g. the operands, which
+ * are created by the million when compiling large kernels.
+ */
+template <typename T, std::size_t N>
+class SmallVector {
+ public:
+  using value_type = T;
+  using iterator = T *;
+  using const_iterator = const T *;
+
+  SmallVector() = default;
+
+  SmallVector(const SmallVector &) = delete;
+  SmallVector &operator=(const SmallVector &) = delete;
+
+  ~SmallVector() {
+    clear();
+    if (!is_inline()) {
+      ::operator delete(data_);
+    }
+  }
+
+  std::size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  T &operator[](std::size_t i) {
+    return data_[i];
+  }
+
+  const T &operator[](std::size_t i) const {
+    return data_[i];
+  }
+
+  T &back() {
+    return data_[size_ - 1];
+  }
+
+  iterator begin() {
+    return data_;
+  }
+
+  iterator end() {
+    return data_ + size_;
+  }
+
+  const_iterator begin() const {
+    return data_;
+  }
+
+  const_iterator end() const {
+    return data_ + size_;
+  }
+
+  template <typename... Args>
+  T &emplace_back(Args &&... args) {
+    if (size_ == capacity_) {
+      grow();
+    }
+    new (data_ + size_) T(std::forward<Args>(args)...);
+    return data_[size_++];
+  }
+
+  void push_back(const T &value) {
+    emplace_back(value);
+  }
+
+  void push_back(T &&value) {
+    emplace_back(std::move(value));
+  }
+
+  void clear() {
+    for (std::size_t i = 0; i < size_; i++) {
+      data_[i].~T();
+    }
+    size_ = 0;
+  }
+
+ private:
+  bool is_inline() const {
+    return data_ == reinterpret_cast<const T *>(inline_storage_);
+  }
+
+  void grow() {
+    const std::size_t new_capacity = capacity_ * 2;
+    T *new_data = static_cast<T *>(::operator new(new_capacity * sizeof(T)));
+    for (std::size_t i = 0; i < size_; i++) {
+      new (new_data + i) T(std::move(data_[i]));
+      data_[i].~T();
+    }
+    if (!is_inline()) {
+      ::operator delete(data_);
+    }
+    data_ = new_data;
+    capacity_ = new_capacity;
+  }
+
+  alignas(T) unsigned char inline_storage_[N * sizeof(T)];
+  T *data_{reinterpret_cast<T *>(inline_storage_)};
+  std::size_t size_{0};
+  std::size_t capacity_{N};
+};
+
+TI_NAMESPACE_END
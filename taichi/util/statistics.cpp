@@ -5,10 +5,12 @@ TI_NAMESPACE_BEGIN
 Statistics stat;
 
 void Statistics::add(std::string key, Statistics::value_type value) {
+  std::lock_guard<std::mutex> _(mut_);
   counters_[key] += value;
 }
 
 void Statistics::print(std::string *output) {
+  std::lock_guard<std::mutex> _(mut_);
   std::vector<std::string> keys;
   for (auto const &item : counters_)
     keys.push_back(item.first);
@@ -27,6 +29,7 @@ void Statistics::print(std::string *output) {
 }
 
 void Statistics::clear() {
+  std::lock_guard<std::mutex> _(mut_);
   counters_.clear();
 }
 
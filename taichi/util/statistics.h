@@ -1,3 +1,4 @@
+#include <mutex>
 #include <unordered_map>
 
 #include "taichi/common/core.h"
@@ -23,6 +24,9 @@ class Statistics {
 
  private:
   counters_map counters_;
+  // Kernels may be compiled on multiple threads, see
+  // CompileConfig::num_compile_threads.
+  std::mutex mut_;
 };
 
 extern Statistics stat;
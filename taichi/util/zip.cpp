@@ -1,4 +1,5 @@
 #include "taichi/common/core.h"
+#include "taichi/system/threading.h"
 
 #if defined(__GNUC__)
 // Ensure we get the 64-bit variants of the CRT's file I/O calls
@@ -110,6 +111,132 @@ std::vector<uint8> read(const std::string fn, bool verbose) {
   return ret;
 }
 
+std::size_t compress_bound(std::size_t len) {
+  return mz_compressBound((mz_ulong)len);
+}
+
+std::size_t compress(const uint8 *data,
+                     std::size_t len,
+                     uint8 *dst,
+                     std::size_t dst_capacity,
+                     int level) {
+  mz_ulong dst_len = (mz_ulong)dst_capacity;
+  const int status = mz_compress2(dst, &dst_len, data, (mz_ulong)len, level);
+  TI_ERROR_IF(status != MZ_OK, "mz_compress2() failed: {}",
+              mz_error(status));
+  return dst_len;
+}
+
+void decompress(const uint8 *data,
+                std::size_t len,
+                uint8 *dst,
+                std::size_t dst_len) {
+  mz_ulong actual_len = (mz_ulong)dst_len;
+  const int status = mz_uncompress(dst, &actual_len, data, (mz_ulong)len);
+  TI_ERROR_IF(status != MZ_OK, "mz_uncompress() failed: {}",
+              mz_error(status));
+  TI_ERROR_IF(actual_len != dst_len,
+              "Decompressed {} bytes, while {} bytes are expected", actual_len,
+              dst_len);
+}
+
+namespace {
+
+constexpr char kChunkedMagic[8] = {'T', 'I', 'P', 'Z', '0', '0', '0', '1'};
+
+// [magic] [raw size] [chunk size] [number of chunks], followed by the chunks,
+// each of which is [stored size] [deflated bytes].
+struct ChunkedHeader {
+  char magic[8];
+  uint64 raw_size{0};
+  uint64 chunk_size{0};
+  uint64 num_chunks{0};
+};
+
+}  // namespace
+
+void write_chunked(const std::string &fn,
+                   const uint8 *data,
+                   std::size_t len,
+                   int level,
+                   int num_threads,
+                   std::size_t chunk_size) {
+  TI_ERROR_UNLESS(taichi::ends_with(fn, ".tcb.pz"),
+                  "Filename must end with .tcb.pz");
+  TI_ERROR_IF(chunk_size == 0, "The chunk size must be positive");
+  if (num_threads <= 0) {
+    num_threads = std::max(1, (int)std::thread::hardware_concurrency());
+  }
+  std::FILE *f = std::fopen(fn.c_str(), "wb");
+  TI_ERROR_IF(f == nullptr, "Cannot open file [{}] for writing.", fn);
+  ChunkedHeader header;
+  std::memcpy(header.magic, kChunkedMagic, sizeof(kChunkedMagic));
+  header.raw_size = len;
+  header.chunk_size = chunk_size;
+  header.num_chunks = (len + chunk_size - 1) / chunk_size;
+  bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1;
+  // Each batch compresses one chunk per thread, then appends them in order.
+  std::vector<std::vector<uint8>> buffers(num_threads);
+  std::vector<uint64> stored_sizes(num_threads);
+  for (uint64 first = 0; ok && first < header.num_chunks;
+       first += num_threads) {
+    const int batch = (int)std::min<uint64>(num_threads,
+                                            header.num_chunks - first);
+    parallel_for_threads(batch, batch, [&](int, int i) {
+      const uint64 begin = (first + i) * chunk_size;
+      const std::size_t size = std::min<uint64>(chunk_size, len - begin);
+      buffers[i].resize(compress_bound(size));
+      stored_sizes[i] = compress(data + begin, size, buffers[i].data(),
+                                 buffers[i].size(), level);
+    });
+    for (int i = 0; ok && i < batch; i++) {
+      ok = std::fwrite(&stored_sizes[i], sizeof(uint64), 1, f) == 1 &&
+           std::fwrite(buffers[i].data(), 1, stored_sizes[i], f) ==
+               stored_sizes[i];
+    }
+  }
+  ok = std::fclose(f) == 0 && ok;
+  TI_ERROR_IF(!ok, "Failed to write {}", fn);
+}
+
+std::vector<uint8> read_chunked(const std::string &fn, int num_threads) {
+  TI_ERROR_UNLESS(taichi::ends_with(fn, ".tcb.pz"),
+                  "Filename must end with .tcb.pz");
+  std::FILE *f = std::fopen(fn.c_str(), "rb");
+  TI_ERROR_IF(f == nullptr, "Cannot open file: {}", fn);
+  // The chunks are inflated from the file contents straight into the result.
+  const std::vector<uint8> file = read_data_from_file(f);
+  std::fclose(f);
+  TI_ERROR_IF(file.size() < sizeof(ChunkedHeader) ||
+                  std::memcmp(file.data(), kChunkedMagic,
+                              sizeof(kChunkedMagic)) != 0,
+              "{} is not a chunked compressed file", fn);
+  ChunkedHeader header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  std::vector<std::pair<uint64, uint64>> chunks;  // (offset, stored size)
+  uint64 offset = sizeof(header);
+  for (uint64 i = 0; i < header.num_chunks; i++) {
+    uint64 stored_size = 0;
+    TI_ERROR_IF(offset + sizeof(uint64) > file.size(), "{} is truncated",
+                fn);
+    std::memcpy(&stored_size, file.data() + offset, sizeof(uint64));
+    offset += sizeof(uint64);
+    TI_ERROR_IF(offset + stored_size > file.size(), "{} is truncated", fn);
+    chunks.emplace_back(offset, stored_size);
+    offset += stored_size;
+  }
+  TI_ERROR_IF(header.num_chunks * header.chunk_size < header.raw_size,
+              "{} is corrupted", fn);
+  std::vector<uint8> ret(header.raw_size);
+  parallel_for_threads(num_threads, (int)chunks.size(), [&](int, int i) {
+    const uint64 begin = (uint64)i * header.chunk_size;
+    decompress(file.data() + chunks[i].first, chunks[i].second,
+               ret.data() + begin,
+               std::min<uint64>(header.chunk_size, header.raw_size - begin));
+  });
+  return ret;
+}
+
 }  // namespace zip
 
 TI_NAMESPACE_END
@@ -0,0 +1,74 @@
+#include "gtest/gtest.h"
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+
+namespace taichi {
+namespace lang {
+
+namespace {
+
+// Builds:
+//   $0 = global tmp var (offset = 0 B)
+//   $1 = global load $0
+//   $2 = const [|value|]
+//   $3 = sub $1 $2 (or sub $2 $1 if |swap|)
+//   $4 = if ($2) { global store [$0 <- $3] }
+//   (or global store [$0 <- $3] after the if, if |store_after_if|)
+std::unique_ptr<Block> make_block(int value, bool swap, bool store_after_if) {
+  auto block = std::make_unique<Block>();
+  auto addr = block->push_back<GlobalTemporaryStmt>(
+      0, TypeFactory::create_vector_or_scalar_type(1, PrimitiveType::i32));
+  auto load = block->push_back<GlobalLoadStmt>(addr);
+  auto constant = block->push_back<ConstStmt>(TypedConstant(value));
+  auto sub = swap ? block->push_back<BinaryOpStmt>(BinaryOpType::sub,
+                                                   constant, load)
+                  : block->push_back<BinaryOpStmt>(BinaryOpType::sub, load,
+                                                   constant);
+  auto if_stmt = block->push_back<IfStmt>(constant)->as<IfStmt>();
+  auto true_clause = std::make_unique<Block>();
+  if (store_after_if) {
+    block->push_back<GlobalStoreStmt>(addr, sub);
+  } else {
+    true_clause->push_back<GlobalStoreStmt>(addr, sub);
+  }
+  if_stmt->set_true_statements(std::move(true_clause));
+  irpass::type_check(block.get(), CompileConfig());
+  return block;
+}
+
+}  // namespace
+
+TEST(Hash, TestSameStructure) {
+  auto block1 = make_block(1, false, false);
+  auto block2 = make_block(1, false, false);
+  // The statements of the two blocks have different ids.
+  EXPECT_NE(block1->statements[0]->id, block2->statements[0]->id);
+  const auto hash1 = irpass::analysis::hash(block1.get());
+  EXPECT_EQ(hash1, irpass::analysis::hash(block2.get()));
+  irpass::re_id(block1.get());
+  EXPECT_EQ(hash1, irpass::analysis::hash(block1.get()));
+  // Hashing a clone gives the same result.
+  auto cloned = irpass::analysis::clone(block1.get());
+  EXPECT_EQ(hash1, irpass::analysis::hash(cloned.get()));
+}
+
+TEST(Hash, TestDifferentStructure) {
+  const auto hash = irpass::analysis::hash(make_block(1, false, false).get());
+  EXPECT_NE(hash, irpass::analysis::hash(make_block(2, false, false).get()));
+  EXPECT_NE(hash, irpass::analysis::hash(make_block(1, true, false).get()));
+  EXPECT_NE(hash, irpass::analysis::hash(make_block(1, false, true).get()));
+}
+
+TEST(Hash, TestStableHash) {
+  // Must never change, or the on-disk caches are invalidated.
+  EXPECT_EQ(stable_hash(std::string("")), 0xcbf29ce484222325ULL);
+  EXPECT_EQ(stable_hash(std::string("a")), 0xaf63dc4c8601ec8cULL);
+  EXPECT_EQ(stable_hash(TypedConstant(1)), stable_hash(TypedConstant(1)));
+  EXPECT_NE(stable_hash(TypedConstant(1)), stable_hash(TypedConstant(1.0f)));
+  EXPECT_NE(stable_hash(TypedConstant(1)), stable_hash(TypedConstant(2)));
+}
+
+}  // namespace lang
+}  // namespace taichi
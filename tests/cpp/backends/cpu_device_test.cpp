@@ -0,0 +1,32 @@
+#include "gtest/gtest.h"
+
+#include "taichi/backends/cpu/cpu_device.h"
+
+namespace taichi {
+namespace lang {
+namespace cpu {
+
+TEST(CpuDevice, ReleasesImportedMemory) {
+  CpuDevice device;
+  int data[4] = {0};
+  auto alloc = device.import_memory(data, sizeof(data));
+  EXPECT_EQ(device.get_alloc_info(alloc).ptr, data);
+  EXPECT_TRUE(device.get_alloc_info(alloc).is_imported);
+
+  // The memory is owned by the caller, so it is only forgotten.
+  device.dealloc_memory(alloc);
+  EXPECT_EQ(device.get_alloc_info(alloc).ptr, nullptr);
+  EXPECT_EQ(data[0], 0);
+
+  // The released slot is reused by the next import.
+  int other[2] = {0};
+  auto reused = device.import_memory(other, sizeof(other));
+  EXPECT_EQ(reused.alloc_id, alloc.alloc_id);
+  EXPECT_EQ(device.get_alloc_info(reused).ptr, other);
+  device.release_imported_memory(reused);
+  EXPECT_EQ(device.get_alloc_info(reused).ptr, nullptr);
+}
+
+}  // namespace cpu
+}  // namespace lang
+}  // namespace taichi
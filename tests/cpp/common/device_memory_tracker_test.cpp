@@ -0,0 +1,57 @@
+#include "gtest/gtest.h"
+
+#include "taichi/system/device_memory_tracker.h"
+
+namespace taichi {
+
+TEST(DeviceMemoryTracker, AttributesAllocations) {
+  auto &tracker = DeviceMemoryTracker::get_instance();
+  tracker.set_enabled(true);
+  tracker.clear();
+  int owner = 0;
+  {
+    DeviceMemoryTracker::Scope outer("snode_tree", "tree 0", "a.py:1");
+    tracker.record_allocation(&owner, 0, 1000);
+    {
+      // The callsite is taken from the enclosing scope.
+      DeviceMemoryTracker::Scope inner("ndarray");
+      tracker.record_allocation(&owner, 1, 300);
+      tracker.record_allocation(&owner, 2, 300);
+    }
+    tracker.record_allocation(&owner, 3, 5000, /*nested=*/true);
+  }
+  tracker.record_allocation(&owner, 4, 10);
+  EXPECT_EQ(tracker.get_current_bytes(), 1610);
+
+  const auto breakdown = tracker.get_breakdown();
+  ASSERT_EQ(breakdown.size(), 4);
+  EXPECT_TRUE(breakdown[0].nested);
+  EXPECT_EQ(breakdown[0].bytes, 5000);
+  EXPECT_EQ(breakdown[1].tag.subsystem, "snode_tree");
+  EXPECT_EQ(breakdown[1].tag.name, "tree 0");
+  EXPECT_EQ(breakdown[2].tag.subsystem, "ndarray");
+  EXPECT_EQ(breakdown[2].tag.name, "");
+  EXPECT_EQ(breakdown[2].tag.callsite, "a.py:1");
+  EXPECT_EQ(breakdown[2].bytes, 600);
+  EXPECT_EQ(breakdown[2].count, 2);
+  EXPECT_EQ(breakdown[3].tag.subsystem, "untagged");
+
+  tracker.record_deallocation(&owner, 0);
+  tracker.record_deallocation(&owner, 3);
+  // Not recorded.
+  tracker.record_deallocation(&owner, 5);
+  EXPECT_EQ(tracker.get_current_bytes(), 610);
+  EXPECT_EQ(tracker.get_peak_bytes(), 1610);
+  tracker.reset_peak();
+  EXPECT_EQ(tracker.get_peak_bytes(), 610);
+  EXPECT_NE(tracker.get_report().find("ndarray at a.py:1"),
+            std::string::npos);
+
+  tracker.clear();
+  tracker.set_enabled(false);
+  tracker.record_allocation(&owner, 0, 1000);
+  EXPECT_EQ(tracker.get_current_bytes(), 0);
+  EXPECT_TRUE(tracker.get_breakdown().empty());
+}
+
+}  // namespace taichi
@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <vector>
+
+#include "taichi/util/metrics.h"
+
+namespace taichi {
+
+TEST(Metrics, Counter) {
+  MetricsRegistry registry;
+  auto &counter = registry.counter("test_events", "Events.");
+  // Registering again returns the same counter.
+  EXPECT_EQ(&registry.counter("test_events", "Events."), &counter);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&counter]() {
+      for (int j = 0; j < 1000; j++) {
+        counter.add();
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(counter.get(), 4000);
+  EXPECT_EQ(registry.get_values()["test_events"], 4000);
+  registry.reset();
+  EXPECT_EQ(counter.get(), 0);
+}
+
+TEST(Metrics, Histogram) {
+  MetricsRegistry registry;
+  auto &hist = registry.histogram("test_seconds", "Durations.", {0.1, 1});
+  hist.observe(0.05);
+  hist.observe(0.1);
+  hist.observe(0.5);
+  hist.observe(2);
+  EXPECT_EQ(hist.get_bucket_counts(), (std::vector<int64>{2, 3, 4}));
+  EXPECT_EQ(hist.get_count(), 4);
+  EXPECT_DOUBLE_EQ(hist.get_sum(), 2.65);
+}
+
+TEST(Metrics, OpenMetrics) {
+  MetricsRegistry registry;
+  registry.counter("test_launches", "Launches.").add(3);
+  registry.gauge("test_bytes", "Bytes in use.").set(64);
+  registry.histogram("test_seconds", "Durations.", {1}).observe(0.5);
+  EXPECT_EQ(registry.to_openmetrics(),
+            "# HELP test_bytes Bytes in use.\n"
+            "# TYPE test_bytes gauge\n"
+            "test_bytes 64\n"
+            "# HELP test_launches Launches.\n"
+            "# TYPE test_launches counter\n"
+            "test_launches_total 3\n"
+            "# HELP test_seconds Durations.\n"
+            "# TYPE test_seconds histogram\n"
+            "test_seconds_bucket{le=\"1\"} 1\n"
+            "test_seconds_bucket{le=\"+Inf\"} 1\n"
+            "test_seconds_sum 0.5\n"
+            "test_seconds_count 1\n"
+            "# EOF\n");
+}
+
+}  // namespace taichi
@@ -1,3 +1,5 @@
+#include <cstdio>
+#include <cstring>
 #include <optional>
 #include <string>
 #include <vector>
@@ -122,6 +124,73 @@ TEST(Serialization, Basic) {
   ts.print();
 }
 
+TEST(Serialization, StreamToFile) {
+  Parent par;
+  par.b = Parent::Child{};
+  par.b->a = 42;
+  par.c = std::string(3 << 20, 'x');
+  std::vector<float> vec(1 << 20);
+  for (int i = 0; i < vec.size(); i++) {
+    vec[i] = i * 0.5f;
+  }
+
+  BinaryOutputSerializer mem;
+  mem.initialize();
+  mem(par);
+  mem(vec);
+  mem.finalize();
+
+  std::FILE *f = std::tmpfile();
+  ASSERT_NE(f, nullptr);
+  BinaryOutputSerializer os;
+  os.initialize(f);
+  os(par);
+  os(vec);
+  os.finalize();
+  EXPECT_EQ(os.head, mem.head);
+  std::rewind(f);
+  const auto file_data = read_data_from_file(f);
+  std::fclose(f);
+  ASSERT_EQ(file_data.size(), mem.head);
+  EXPECT_EQ(std::memcmp(file_data.data(), mem.data.data(), mem.head), 0);
+
+  Parent par_res;
+  std::vector<float> vec_res;
+  BinaryInputSerializer is;
+  is.initialize((void *)file_data.data());
+  is(par_res);
+  is(vec_res);
+  is.finalize();
+  EXPECT_EQ(par_res, par);
+  EXPECT_EQ(vec_res, vec);
+}
+
+TEST(Serialization, ChunkedCompression) {
+  std::vector<int> vec(3 << 20);
+  for (int i = 0; i < vec.size(); i++) {
+    vec[i] = i % 1000;
+  }
+  for (auto ext : {".tcb", ".tcb.pz"}) {
+    const auto fn = ::testing::TempDir() + "serialization_test" + ext;
+    write_to_binary_file(vec, fn);
+    std::vector<int> res;
+    read_from_binary_file(res, fn);
+    EXPECT_EQ(res, vec);
+    std::remove(fn.c_str());
+  }
+
+  const auto fn = ::testing::TempDir() + "serialization_test.tcb.pz";
+  const auto *data = reinterpret_cast<const uint8 *>(vec.data());
+  for (std::size_t len : {std::size_t(0), std::size_t(1000), vec.size() * 4}) {
+    zip::write_chunked(fn, data, len, /*level=*/1, /*num_threads=*/4,
+                       /*chunk_size=*/1 << 20);
+    const auto res = zip::read_chunked(fn, /*num_threads=*/3);
+    ASSERT_EQ(res.size(), len);
+    EXPECT_EQ(std::memcmp(res.data(), data, len), 0);
+  }
+  std::remove(fn.c_str());
+}
+
 }  // namespace
 }  // namespace lang
 }  // namespace taichi
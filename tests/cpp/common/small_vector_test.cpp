@@ -0,0 +1,41 @@
+#include "gtest/gtest.h"
+
+#include <memory>
+
+#include "taichi/util/small_vector.h"
+
+namespace taichi {
+
+TEST(SmallVector, Basic) {
+  SmallVector<int, 2> vec;
+  EXPECT_TRUE(vec.empty());
+  for (int i = 0; i < 10; i++) {
+    vec.push_back(i);
+    EXPECT_EQ(vec.size(), i + 1);
+    EXPECT_EQ(vec.back(), i);
+  }
+  // The elements survive moving to the heap.
+  int sum = 0;
+  for (int x : vec) {
+    sum += x;
+  }
+  EXPECT_EQ(sum, 45);
+  vec[3] = 100;
+  EXPECT_EQ(vec[3], 100);
+  vec.clear();
+  EXPECT_TRUE(vec.empty());
+}
+
+TEST(SmallVector, NonTrivial) {
+  auto counter = std::make_shared<int>(0);
+  {
+    SmallVector<std::shared_ptr<int>, 4> vec;
+    for (int i = 0; i < 9; i++) {
+      vec.emplace_back(counter);
+    }
+    EXPECT_EQ(counter.use_count(), 10);
+  }
+  EXPECT_EQ(counter.use_count(), 1);
+}
+
+}  // namespace taichi
@@ -0,0 +1,139 @@
+/*******************************************************************************
+    Copyright (c) The Taichi Authors (2016- ). All Rights Reserved.
+    The use of this software is governed by the LICENSE file.
+*******************************************************************************/
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <vector>
+
+#include "taichi/system/numa.h"
+#include "taichi/system/threading.h"
+
+#if defined(TI_PLATFORM_LINUX)
+#include <pthread.h>
+#endif
+
+namespace taichi {
+namespace lang {
+
+namespace {
+
+struct ThreadPoolTestContext {
+  std::vector<std::atomic<int>> *counters{nullptr};
+  std::atomic<int> *bad_thread_ids{nullptr};
+  int max_num_threads{0};
+};
+
+void count_task(void *ctx, int thread_id, int i) {
+  auto *c = (ThreadPoolTestContext *)ctx;
+  if (thread_id < 0 || thread_id >= c->max_num_threads) {
+    c->bad_thread_ids->fetch_add(1);
+  }
+  (*c->counters)[i].fetch_add(1);
+}
+
+}  // namespace
+
+TEST(ThreadPool, EachTaskRunsOnce) {
+  constexpr int kMaxNumThreads = 8;
+  ThreadPool pool(kMaxNumThreads);
+  for (int desired : {1, 2, kMaxNumThreads, 2 * kMaxNumThreads}) {
+    for (int splits : {0, 1, 7, 1000}) {
+      for (int repeat = 0; repeat < 20; repeat++) {
+        std::vector<std::atomic<int>> counters(splits);
+        std::atomic<int> bad_thread_ids{0};
+        ThreadPoolTestContext ctx{&counters, &bad_thread_ids, kMaxNumThreads};
+        pool.run(splits, desired, &ctx, count_task);
+        EXPECT_EQ(bad_thread_ids.load(), 0);
+        for (int i = 0; i < splits; i++) {
+          EXPECT_EQ(counters[i].load(), 1);
+        }
+      }
+    }
+  }
+}
+
+TEST(ThreadPool, SingleThread) {
+  ThreadPool pool(1);
+  std::vector<std::atomic<int>> counters(100);
+  std::atomic<int> bad_thread_ids{0};
+  ThreadPoolTestContext ctx{&counters, &bad_thread_ids, 1};
+  ThreadPool::static_run(&pool, 100, 4, &ctx, count_task);
+  EXPECT_EQ(bad_thread_ids.load(), 0);
+  for (auto &c : counters) {
+    EXPECT_EQ(c.load(), 1);
+  }
+}
+
+TEST(ThreadPool, ProfilesJobs) {
+  constexpr int kMaxNumThreads = 4;
+  ThreadPool pool(kMaxNumThreads);
+  pool.set_profiling(true);
+  std::vector<std::atomic<int>> counters(1000);
+  std::atomic<int> bad_thread_ids{0};
+  ThreadPoolTestContext ctx{&counters, &bad_thread_ids, kMaxNumThreads};
+  pool.run(1000, kMaxNumThreads, &ctx, count_task);
+  pool.run(10, 1, &ctx, count_task);
+  auto profiles = pool.fetch_job_profiles();
+  ASSERT_EQ(profiles.size(), 2);
+  int num_tasks = 0;
+  for (auto &t : profiles[0].threads) {
+    EXPECT_LE(profiles[0].begin, t.start);
+    EXPECT_LE(t.start, t.end);
+    EXPECT_LE(t.end, profiles[0].end);
+    num_tasks += t.num_tasks;
+  }
+  EXPECT_EQ(num_tasks, 1000);
+  EXPECT_GE(profiles[0].get_imbalance_ratio(), 1.0);
+  EXPECT_GE(profiles[0].get_max_wakeup_latency(), 0.0);
+  // Run on the calling thread only.
+  ASSERT_EQ(profiles[1].threads.size(), 1);
+  EXPECT_EQ(profiles[1].threads[0].num_tasks, 10);
+  EXPECT_EQ(profiles[1].get_imbalance_ratio(), 1.0);
+  EXPECT_EQ(profiles[1].get_max_wakeup_latency(), 0.0);
+  EXPECT_TRUE(pool.fetch_job_profiles().empty());
+
+  pool.set_profiling(false);
+  pool.run(1000, kMaxNumThreads, &ctx, count_task);
+  EXPECT_TRUE(pool.fetch_job_profiles().empty());
+}
+
+TEST(ThreadPool, PinnedThreads) {
+#if defined(TI_PLATFORM_LINUX)
+  cpu_set_t affinity_before;
+  pthread_getaffinity_np(pthread_self(), sizeof(affinity_before),
+                         &affinity_before);
+#endif
+  ThreadPool pool(4, /*pin_threads=*/true);
+  std::vector<std::atomic<int>> counters(64);
+  std::atomic<int> bad_thread_ids{0};
+  ThreadPoolTestContext ctx{&counters, &bad_thread_ids, 4};
+  pool.run(64, 4, &ctx, count_task);
+  EXPECT_EQ(bad_thread_ids.load(), 0);
+  for (auto &c : counters) {
+    EXPECT_EQ(c.load(), 1);
+  }
+#if defined(TI_PLATFORM_LINUX)
+  // Only the workers are pinned, not the calling thread.
+  cpu_set_t affinity_after;
+  pthread_getaffinity_np(pthread_self(), sizeof(affinity_after),
+                         &affinity_after);
+  EXPECT_TRUE(CPU_EQUAL(&affinity_before, &affinity_after));
+#endif
+}
+
+TEST(ThreadPool, NumaFirstTouchPreservesContents) {
+  ThreadPool pool(4);
+  std::vector<char> buffer(5 * 4096 + 123);
+  for (std::size_t i = 0; i < buffer.size(); i++) {
+    buffer[i] = (char)(i * 7);
+  }
+  numa_first_touch(&pool, buffer.data(), buffer.size(), 4);
+  for (std::size_t i = 0; i < buffer.size(); i++) {
+    EXPECT_EQ(buffer[i], (char)(i * 7));
+  }
+}
+
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,66 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "taichi/system/timeline.h"
+
+namespace taichi {
+
+TEST(Timeline, RecordsEveryThread) {
+  auto &timelines = Timelines::get_instance();
+  timelines.set_enabled(true);
+  timelines.clear();
+  // More events than a ring buffer holds, so that the threads flush it
+  // themselves if the background flushing does not keep up.
+  constexpr int kNumThreads = 4;
+  constexpr int kNumScopes = 5000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([i]() {
+      Timeline::get_this_thread_instance().set_name(fmt::format("t{}", i));
+      for (int j = 0; j < kNumScopes; j++) {
+        TI_TIMELINE("scope");
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  Timeline::get_this_thread_instance().insert_span("span", 1.0, 2.0,
+                                                   "device");
+  const std::string fn = "timeline_test.json";
+  timelines.save(fn);
+  timelines.set_enabled(false);
+
+  std::ifstream fin(fn);
+  std::string line;
+  int begins = 0, ends = 0, spans = 0;
+  float64 last_ts = -1;
+  while (std::getline(fin, line)) {
+    if (line.find("\"ph\":\"B\"") != std::string::npos) {
+      begins++;
+    } else if (line.find("\"ph\":\"E\"") != std::string::npos) {
+      ends++;
+    } else if (line.find("\"ph\":\"X\"") != std::string::npos) {
+      spans++;
+      EXPECT_NE(line.find("\"dur\":1000000.000"), std::string::npos);
+      continue;
+    }
+    // The events of each thread are in order.
+    if (line.find("\"tid\":\"t0\"") != std::string::npos) {
+      const auto ts = std::stod(line.substr(line.find("\"ts\":") + 5));
+      EXPECT_GE(ts, last_ts);
+      last_ts = ts;
+    }
+  }
+  fin.close();
+  std::remove(fn.c_str());
+  EXPECT_EQ(begins, kNumThreads * kNumScopes);
+  EXPECT_EQ(ends, kNumThreads * kNumScopes);
+  EXPECT_EQ(spans, 1);
+}
+
+}  // namespace taichi
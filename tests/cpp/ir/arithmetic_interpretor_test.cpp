@@ -0,0 +1,102 @@
+#include "gtest/gtest.h"
+
+#include "taichi/ir/arithmetic_interpretor.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/statements.h"
+
+namespace taichi {
+namespace lang {
+
+namespace {
+
+std::optional<TypedConstant> evaluate(const ArithmeticInterpretor &interp,
+                                      BinaryOpStmt *stmt,
+                                      DataType ret_type) {
+  stmt->ret_type = ret_type;
+  return interp.evaluate(stmt, stmt->lhs->as<ConstStmt>()->val[0],
+                         stmt->rhs->as<ConstStmt>()->val[0]);
+}
+
+std::optional<TypedConstant> evaluate(const ArithmeticInterpretor &interp,
+                                      UnaryOpStmt *stmt,
+                                      DataType ret_type) {
+  stmt->ret_type = ret_type;
+  return interp.evaluate(stmt, stmt->operand->as<ConstStmt>()->val[0]);
+}
+
+}  // namespace
+
+TEST(ArithmeticInterpretor, Integral) {
+  ArithmeticInterpretor interp(Arch::x64);
+  IRBuilder builder;
+  const auto i32 = PrimitiveType::i32;
+  auto *max = builder.get_int32(std::numeric_limits<int32>::max());
+  auto *one = builder.get_int32(1);
+  auto *zero = builder.get_int32(0);
+  auto *seven = builder.get_int32(-7);
+  auto *two = builder.get_int32(2);
+
+  auto sum = evaluate(interp, builder.create_add(max, one), i32);
+  ASSERT_TRUE(sum.has_value());
+  EXPECT_EQ(sum->val_i32, std::numeric_limits<int32>::min());
+
+  auto quotient = evaluate(interp, builder.create_div(seven, two), i32);
+  ASSERT_TRUE(quotient.has_value());
+  EXPECT_EQ(quotient->val_i32, -3);
+  auto floor_quotient =
+      evaluate(interp, builder.create_floordiv(seven, two), i32);
+  ASSERT_TRUE(floor_quotient.has_value());
+  EXPECT_EQ(floor_quotient->val_i32, -4);
+
+  auto less = evaluate(interp, builder.create_cmp_lt(seven, two), i32);
+  ASSERT_TRUE(less.has_value());
+  EXPECT_EQ(less->val_i32, -1);
+
+  // Undefined in the generated code.
+  EXPECT_FALSE(evaluate(interp, builder.create_div(one, zero), i32));
+  EXPECT_FALSE(evaluate(interp, builder.create_mod(one, zero), i32));
+  EXPECT_FALSE(evaluate(interp, builder.create_shl(one, builder.get_int32(32)),
+                        i32));
+}
+
+TEST(ArithmeticInterpretor, Real) {
+  IRBuilder builder;
+  const auto f32 = PrimitiveType::f32;
+  auto *x = builder.get_float32(2.0f);
+
+  ArithmeticInterpretor cpu(Arch::x64);
+  auto root = evaluate(cpu, builder.create_sqrt(x), f32);
+  ASSERT_TRUE(root.has_value());
+  EXPECT_EQ(root->val_f32, std::sqrt(2.0f));
+  auto sine = evaluate(cpu, builder.create_sin(x), f32);
+  ASSERT_TRUE(sine.has_value());
+  EXPECT_EQ(sine->val_f32, std::sin(2.0f));
+
+  // The GPUs have their own math functions.
+  ArithmeticInterpretor gpu(Arch::cuda);
+  EXPECT_TRUE(evaluate(gpu, builder.create_sqrt(x), f32));
+  EXPECT_FALSE(evaluate(gpu, builder.create_sin(x), f32));
+}
+
+TEST(ArithmeticInterpretor, Cast) {
+  ArithmeticInterpretor interp(Arch::x64);
+  IRBuilder builder;
+  auto *x = builder.get_float32(-2.5f);
+  auto *cast = builder.create_cast(x, PrimitiveType::i32);
+  auto value = evaluate(interp, cast, PrimitiveType::i32);
+  ASSERT_TRUE(value.has_value());
+  EXPECT_EQ(value->val_i32, -2);
+
+  auto *bit_cast = builder.create_bit_cast(x, PrimitiveType::u32);
+  auto bits = evaluate(interp, bit_cast, PrimitiveType::u32);
+  ASSERT_TRUE(bits.has_value());
+  EXPECT_EQ(bits->val_u32, 0xc0200000u);
+
+  // Out of the range of the result.
+  auto *huge = builder.get_float64(1e20);
+  EXPECT_FALSE(evaluate(interp, builder.create_cast(huge, PrimitiveType::i32),
+                        PrimitiveType::i32));
+}
+
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,71 @@
+#include "gtest/gtest.h"
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/ir_serializer.h"
+#include "taichi/ir/statements.h"
+
+namespace taichi {
+namespace lang {
+
+namespace {
+
+SNode *no_snode(int) {
+  return nullptr;
+}
+
+}  // namespace
+
+TEST(IRSerializer, RoundTrip) {
+  IRBuilder builder;
+  auto *arg = builder.create_arg_load(0, PrimitiveType::f32, true);
+  auto *zero = builder.get_int32(0);
+  auto *ten = builder.get_int32(10);
+  auto *var = builder.create_local_var(PrimitiveType::f32);
+  auto *loop = builder.create_range_for(zero, ten);
+  {
+    auto _ = builder.get_loop_guard(loop);
+    auto *index = builder.get_loop_index(loop, 0);
+    auto *ptr = builder.create_external_ptr(arg, {index});
+    auto *value = builder.create_global_load(ptr);
+    auto *if_stmt = builder.create_if(builder.create_cmp_lt(index, ten));
+    {
+      auto _ = builder.get_if_guard(if_stmt, true);
+      builder.create_local_store(
+          var, builder.create_add(builder.create_local_load(var), value));
+    }
+    builder.create_print(std::string("value"), value);
+  }
+  auto ir = builder.extract_ir();
+
+  auto data = serialize_ir_binary(ir->as<Block>());
+  ASSERT_TRUE(data.has_value());
+  auto block = deserialize_ir_binary(*data, no_snode);
+  ASSERT_NE(block, nullptr);
+  EXPECT_TRUE(irpass::analysis::same_statements(ir.get(), block.get()));
+
+  // The operands point into the new IR.
+  auto *new_loop = block->statements[4]->as<RangeForStmt>();
+  EXPECT_EQ(new_loop->begin, block->statements[1].get());
+  EXPECT_EQ(new_loop->body->parent_stmt, new_loop);
+  EXPECT_EQ(new_loop->body->statements[0]->as<LoopIndexStmt>()->loop,
+            new_loop);
+}
+
+TEST(IRSerializer, Malformed) {
+  IRBuilder builder;
+  builder.create_add(builder.get_int32(1), builder.get_int32(2));
+  auto ir = builder.extract_ir();
+  auto data = serialize_ir_binary(ir->as<Block>());
+  ASSERT_TRUE(data.has_value());
+
+  auto truncated = *data;
+  truncated.pop_back();
+  EXPECT_EQ(deserialize_ir_binary(truncated, no_snode), nullptr);
+  auto wrong_version = *data;
+  wrong_version[4]++;
+  EXPECT_EQ(deserialize_ir_binary(wrong_version, no_snode), nullptr);
+}
+
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,62 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+#include "taichi/program/parallel_primitives.h"
+#include "taichi/system/threading.h"
+
+namespace taichi {
+namespace lang {
+
+TEST(ParallelPrimitives, ExclusiveScan) {
+  ThreadPool pool(4);
+  const int n = 100000;
+  std::vector<int64> data(n), expected(n);
+  std::iota(data.begin(), data.end(), 0);
+  std::exclusive_scan(data.begin(), data.end(), expected.begin(), int64(0));
+  EXPECT_EQ(exclusive_scan(&pool, data.data(), n), int64(n) * (n - 1) / 2);
+  EXPECT_EQ(data, expected);
+}
+
+TEST(ParallelPrimitives, RadixSort) {
+  ThreadPool pool(4);
+  const int n = 100000;
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float32> dist(-100, 100);
+  std::vector<float32> keys(n);
+  std::vector<uint32> values(n);
+  for (int i = 0; i < n; i++) {
+    keys[i] = dist(rng);
+    values[i] = i;
+  }
+  auto expected = values;
+  std::stable_sort(expected.begin(), expected.end(),
+                   [&](uint32 a, uint32 b) { return keys[a] < keys[b]; });
+  radix_sort(&pool, keys.data(), values.data(), n);
+  EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+  EXPECT_EQ(values, expected);
+}
+
+TEST(ParallelPrimitives, Compact) {
+  ThreadPool pool(4);
+  const int n = 100000;
+  std::vector<uint32> data(n), out(n), expected;
+  std::vector<int32> flags(n);
+  for (int i = 0; i < n; i++) {
+    data[i] = i;
+    flags[i] = i % 3 == 0;
+    if (flags[i]) {
+      expected.push_back(i);
+    }
+  }
+  const int64 count =
+      compact(&pool, data.data(), flags.data(), out.data(), n);
+  ASSERT_EQ(count, (int64)expected.size());
+  out.resize(count);
+  EXPECT_EQ(out, expected);
+}
+
+}  // namespace lang
+}  // namespace taichi
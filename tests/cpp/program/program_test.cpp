@@ -0,0 +1,31 @@
+#include "gtest/gtest.h"
+
+#include "taichi/program/program.h"
+
+namespace taichi {
+namespace lang {
+
+TEST(Program, SideBySide) {
+  auto first = std::make_unique<Program>(Arch::x64);
+  EXPECT_EQ(&get_current_program(), first.get());
+  auto second = std::make_unique<Program>(Arch::x64);
+  EXPECT_EQ(&get_current_program(), second.get());
+
+  for (auto *prog : {first.get(), second.get()}) {
+    prog->make_current();
+    EXPECT_EQ(&get_current_program(), prog);
+    prog->materialize_runtime();
+    prog->add_snode_tree(
+        std::make_unique<SNode>(/*depth=*/0, SNodeType::root),
+        /*compile_only=*/false);
+  }
+
+  // Finalizing a program which is not current keeps the current one.
+  first.reset();
+  EXPECT_EQ(&get_current_program(), second.get());
+  second.reset();
+  EXPECT_EQ(current_program, nullptr);
+}
+
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+
+#include "Eigen/SparseCholesky"
+#include "taichi/program/sparse_solver.h"
+#include "taichi/system/threading.h"
+
+namespace taichi {
+namespace lang {
+
+namespace {
+
+// The 5-point Laplacian of an n x n grid, shifted by |shift| on the diagonal.
+Eigen::SparseMatrix<float64> grid_laplacian(int n, float64 shift) {
+  std::vector<Eigen::Triplet<float64>> triplets;
+  auto id = [n](int i, int j) { return i * n + j; };
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      triplets.emplace_back(id(i, j), id(i, j), 4 + shift);
+      if (i + 1 < n) {
+        triplets.emplace_back(id(i, j), id(i + 1, j), -1);
+        triplets.emplace_back(id(i + 1, j), id(i, j), -1);
+      }
+      if (j + 1 < n) {
+        triplets.emplace_back(id(i, j), id(i, j + 1), -1);
+        triplets.emplace_back(id(i, j + 1), id(i, j), -1);
+      }
+    }
+  }
+  Eigen::SparseMatrix<float64> a(n * n, n * n);
+  a.setFromTriplets(triplets.begin(), triplets.end());
+  return a;
+}
+
+}  // namespace
+
+TEST(SparseSolver, ParallelLLTMatchesEigen) {
+  ThreadPool pool(4);
+  auto a = grid_laplacian(30, 0.1);
+  SparseMatrix<float64> sm(a, &pool);
+  Eigen::VectorXd b = Eigen::VectorXd::LinSpaced(a.rows(), -1, 1);
+  Eigen::SimplicialLLT<Eigen::SparseMatrix<float64>> reference(a);
+  const Eigen::VectorXd expected = reference.solve(b);
+
+  for (auto ordering : {"AMD", "COLAMD"}) {
+    auto solver = make_sparse_solver<float64>("ParallelLLT", ordering, &pool);
+    solver->analyze_pattern(sm);
+    solver->factorize(sm);
+    ASSERT_TRUE(solver->info());
+    EXPECT_LT((solver->solve(b) - expected).norm(), 1e-9 * expected.norm());
+  }
+
+  // The same pattern with new values only redoes the numeric factorization.
+  auto solver = make_sparse_solver<float64>("ParallelLLT", "AMD", &pool);
+  EXPECT_TRUE(solver->compute(sm));
+  sm.get_matrix() *= 2;
+  EXPECT_TRUE(solver->compute(sm));
+  EXPECT_LT((solver->solve(b) - expected / 2).norm(), 1e-9 * expected.norm());
+}
+
+TEST(SparseSolver, ParallelLLTFloat32) {
+  Eigen::SparseMatrix<float32> a = grid_laplacian(10, 1).cast<float32>();
+  SparseMatrix<float32> sm(a);
+  // Runs serially without a pool.
+  auto solver = make_sparse_solver<float32>("ParallelLLT", "AMD");
+  ASSERT_TRUE(solver->compute(sm));
+  Eigen::VectorXf b = Eigen::VectorXf::Ones(a.rows());
+  EXPECT_LT((a * solver->solve(b) - b).norm(), 1e-4f * b.norm());
+}
+
+TEST(SparseSolver, ParallelLLTNotPositiveDefinite) {
+  ThreadPool pool(4);
+  auto a = grid_laplacian(10, -8);
+  SparseMatrix<float64> sm(a, &pool);
+  auto solver = make_sparse_solver<float64>("ParallelLLT", "AMD", &pool);
+  EXPECT_FALSE(solver->compute(sm));
+  EXPECT_FALSE(solver->info());
+}
+
+}  // namespace lang
+}  // namespace taichi
@@ -27,5 +27,24 @@ TEST(SNodeTree, GetSNodeToRootMapping) {
   }
 }
 
+TEST(SNodeTree, SetSNodeTreeIdOfDescendants) {
+  constexpr bool kPacked = false;
+  const std::vector<Axis> axes = {Axis{0}};
+  // The second tree of a program, e.g. of a field created after the first
+  // kernel launch.
+  SNode root0{/*depth=*/0, /*t=*/SNodeType::root};
+  SNode root1{/*depth=*/0, /*t=*/SNodeType::root};
+  auto &leaf0 =
+      root0.dense(axes, 4, kPacked).insert_children(SNodeType::place);
+  auto &ptr_snode = root1.pointer(axes, 4, kPacked);
+  auto &leaf1 = ptr_snode.dense(axes, 4, kPacked)
+                    .insert_children(SNodeType::place);
+  root0.set_snode_tree_id(0);
+  root1.set_snode_tree_id(1);
+  EXPECT_EQ(leaf0.get_snode_tree_id(), 0);
+  EXPECT_EQ(ptr_snode.get_snode_tree_id(), 1);
+  EXPECT_EQ(leaf1.get_snode_tree_id(), 1);
+}
+
 }  // namespace lang
 }  // namespace taichi
@@ -0,0 +1,107 @@
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/snode.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/struct/struct.h"
+#include "tests/cpp/struct/fake_struct_compiler.h"
+
+namespace taichi {
+namespace lang {
+namespace {
+
+class AutoBlockLocalTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // ti.root.pointer(ti.ij, 4).dense(ti.ij, 4).place(x, y)
+    root_snode_ = std::make_unique<SNode>(/*depth=*/0, /*t=*/SNodeType::root);
+    const std::vector<Axis> axes = {Axis{0}, Axis{1}};
+    auto &pointer = root_snode_->pointer(axes, /*sizes=*/4, false);
+    block_snode_ = &(pointer.dense(axes, /*sizes=*/4, false));
+    x_ = &(block_snode_->insert_children(SNodeType::place));
+    x_->dt = PrimitiveType::f32;
+    y_ = &(block_snode_->insert_children(SNodeType::place));
+    y_->dt = PrimitiveType::f32;
+
+    FakeStructCompiler sc;
+    sc.run(*root_snode_);
+
+    for_stmt_ = std::make_unique<OffloadedStmt>(
+        /*task_type=*/OffloadedTaskType::struct_for,
+        /*arch=*/Arch::x64);
+    for_stmt_->snode = block_snode_;
+    for_stmt_->block_dim = 16;
+
+    builder_.set_insertion_point(
+        {/*block=*/for_stmt_->body.get(), /*position=*/0});
+    config_.verbose = false;
+  }
+
+  // y[i, j] = sum(x[i + di, j + dj] for di, dj in |offsets|)
+  void gather(const std::vector<std::pair<int, int>> &offsets) {
+    auto *i = builder_.get_loop_index(for_stmt_.get(), /*index=*/0);
+    auto *j = builder_.get_loop_index(for_stmt_.get(), /*index=*/1);
+    Stmt *sum = builder_.get_float32(0);
+    for (auto [di, dj] : offsets) {
+      auto *ptr = builder_.create_global_ptr(
+          x_, {builder_.create_add(i, builder_.get_int32(di)),
+               builder_.create_add(j, builder_.get_int32(dj))});
+      sum = builder_.create_add(sum, builder_.create_global_load(ptr));
+    }
+    builder_.create_global_store(builder_.create_global_ptr(y_, {i, j}), sum);
+  }
+
+  bool is_block_local(SNode *snode) const {
+    return for_stmt_->mem_access_opt.has_flag(snode,
+                                              SNodeAccessFlag::block_local);
+  }
+
+  std::unique_ptr<SNode> root_snode_{nullptr};
+  SNode *block_snode_{nullptr};
+  SNode *x_{nullptr};
+  SNode *y_{nullptr};
+  std::unique_ptr<OffloadedStmt> for_stmt_{nullptr};
+  CompileConfig config_;
+
+  IRBuilder builder_;
+};
+
+TEST_F(AutoBlockLocalTest, Stencil) {
+  // Each of the 6x6 elements of the BLS buffer of x saves 5 * 16 / 36 = 2.2
+  // global loads.
+  gather({{0, 0}, {-1, 0}, {1, 0}, {0, -1}, {0, 1}});
+  irpass::auto_block_local(for_stmt_.get(), config_,
+                           AutoBlockLocalPass::Args{});
+  EXPECT_TRUE(is_block_local(x_));
+  // Written.
+  EXPECT_FALSE(is_block_local(y_));
+}
+
+TEST_F(AutoBlockLocalTest, NoReuse) {
+  gather({{0, 0}, {1, 0}});
+  irpass::auto_block_local(for_stmt_.get(), config_,
+                           AutoBlockLocalPass::Args{});
+  EXPECT_FALSE(is_block_local(x_));
+}
+
+TEST_F(AutoBlockLocalTest, OverBudget) {
+  gather({{0, 0}, {-1, 0}, {1, 0}, {0, -1}, {0, 1}});
+  config_.cpu_bls_max_size_bytes = 64;
+  irpass::auto_block_local(for_stmt_.get(), config_,
+                           AutoBlockLocalPass::Args{});
+  EXPECT_FALSE(is_block_local(x_));
+}
+
+TEST_F(AutoBlockLocalTest, UserAnnotations) {
+  gather({{0, 0}, {-1, 0}, {1, 0}, {0, -1}, {0, 1}});
+  for_stmt_->mem_access_opt.add_flag(y_, SNodeAccessFlag::block_local);
+  irpass::auto_block_local(for_stmt_.get(), config_,
+                           AutoBlockLocalPass::Args{});
+  EXPECT_FALSE(is_block_local(x_));
+}
+
+}  // namespace
+}  // namespace lang
+}  // namespace taichi
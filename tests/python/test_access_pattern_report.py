@@ -0,0 +1,39 @@
+import taichi as ti
+
+
+@ti.test(arch=ti.cpu, access_pattern_report=True)
+def test_access_pattern_report():
+    n = 16
+    x = ti.field(ti.f32, shape=(n, n))
+    idx = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def by_rows():
+        for i, j in x:
+            x[i, j] += 1.0
+
+    @ti.kernel
+    def by_columns():
+        for i in range(n):
+            x[i, 0] += 1.0
+
+    @ti.kernel
+    def gather():
+        for i in range(n):
+            x[0, idx[i]] += 1.0
+
+    by_rows()
+    by_columns()
+    gather()
+
+    report = ti.get_access_pattern_report()
+
+    def lines_of(kernel):
+        return [line for line in report if line.startswith(kernel)]
+
+    assert 'coalesced' in lines_of('by_rows')[0]
+    assert 'strided, 8.0 bytes per useful byte' in lines_of('by_columns')[0]
+    assert any('random, 8.0 bytes per useful byte' in line
+               for line in lines_of('gather'))
+    # The kernels moving the most unused bytes are listed first.
+    assert report[-1].startswith('by_rows')
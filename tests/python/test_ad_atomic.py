@@ -26,3 +26,64 @@ def test_ad_reduce():
     assert total_loss == approx(loss[None])
     for i in range(N):
         assert x.grad[i] == approx(i * 2)
+
+
+@ti.test()
+def test_ad_reduce_to_constant_index():
+    N = 64
+
+    x = ti.field(dtype=ti.f32, shape=N)
+    w = ti.field(dtype=ti.f32, shape=4, needs_grad=True)
+    loss = ti.field(dtype=ti.f32, shape=(), needs_grad=True)
+
+    @ti.kernel
+    def func():
+        for i in x:
+            loss[None] += w[1] * x[i] + w[2]
+
+    for i in range(N):
+        x[i] = i
+    w[1] = 3
+
+    loss.grad[None] = 1
+    func()
+    func.grad()
+
+    assert w.grad[0] == 0
+    assert w.grad[1] == approx(N * (N - 1) / 2)
+    assert w.grad[2] == approx(N)
+
+
+@ti.test(require=ti.extension.bls)
+def test_ad_block_local_stencil():
+    N = 64
+    bs = 16
+
+    x = ti.field(dtype=ti.f32)
+    y = ti.field(dtype=ti.f32)
+    ti.root.dense(ti.i, N).place(x)
+    ti.root.pointer(ti.i, N // bs).dense(ti.i, bs).place(y)
+    ti.root.lazy_grad()
+
+    @ti.kernel
+    def activate():
+        for i in range(bs, N - bs):
+            y[i] = 0
+
+    @ti.kernel
+    def stencil():
+        ti.block_local(x)
+        for i in y:
+            y[i] = x[i - 1] + 2 * x[i] + x[i + 1]
+
+    activate()
+    for i in range(bs, N - bs):
+        y.grad[i] = 1
+    stencil.grad()
+
+    for i in range(N):
+        expected = 0
+        for j in (i - 1, i, i + 1):
+            if bs <= j < N - bs:
+                expected += 2 if j == i else 1
+        assert x.grad[i] == expected
@@ -1,4 +1,7 @@
+import math
+
 import taichi as ti
+from taichi import approx
 
 
 @ti.test(require=ti.extension.adstack)
@@ -399,3 +402,86 @@ def test_triple_for_loops_bls():
     for i in range(N):
         assert b.grad[i * 2] == min(min(N - i - 1, i + 1), M) * N
         assert b.grad[i * 2 + 1] == min(min(N - i - 1, i + 1), M) * N
+
+
+@ti.test(require=ti.extension.adstack, ad_checkpoint_interval=8)
+def test_ad_checkpointed_loop():
+    N = 4
+    M = 100
+    x = ti.field(ti.f32, shape=N, needs_grad=True)
+    y = ti.field(ti.f32, shape=N, needs_grad=True)
+
+    @ti.kernel
+    def integrate():
+        for i in x:
+            v = x[i]
+            for j in range(M):
+                v = ti.sin(v) + x[i] * 0.1
+            y[i] = v
+
+    for i in range(N):
+        x[i] = i * 0.5
+
+    integrate()
+
+    expected_y = []
+    expected_grad = []
+    for i in range(N):
+        v = x[i]
+        dv = 1.0
+        for j in range(M):
+            dv = math.cos(v) * dv + 0.1
+            v = math.sin(v) + x[i] * 0.1
+        expected_y.append(v)
+        expected_grad.append(dv)
+
+    for i in range(N):
+        assert y[i] == approx(expected_y[i], rel=1e-4)
+        y.grad[i] = 1
+
+    # Without checkpointing the 100 iterations overflow the AD-stacks.
+    integrate.grad()
+
+    for i in range(N):
+        assert x.grad[i] == approx(expected_grad[i], rel=1e-4)
+
+
+def _test_ad_short_loop():
+    N = 4
+    M = 4
+    x = ti.field(ti.f32, shape=N, needs_grad=True)
+    y = ti.field(ti.f32, shape=N, needs_grad=True)
+
+    @ti.kernel
+    def integrate():
+        for i in x:
+            v = x[i]
+            for j in range(M):
+                v = ti.sin(v) * (j + 1)
+            y[i] = v
+
+    for i in range(N):
+        x[i] = i * 0.5
+        y.grad[i] = 1
+
+    integrate()
+    integrate.grad()
+
+    for i in range(N):
+        v = x[i]
+        dv = 1.0
+        for j in range(M):
+            dv = math.cos(v) * (j + 1) * dv
+            v = math.sin(v) * (j + 1)
+        assert y[i] == approx(v, rel=1e-4)
+        assert x.grad[i] == approx(dv, rel=1e-4)
+
+
+@ti.test(require=ti.extension.adstack)
+def test_ad_stack_in_registers():
+    _test_ad_short_loop()
+
+
+@ti.test(require=ti.extension.adstack, ad_stack_max_size_in_registers=0)
+def test_ad_stack_in_memory():
+    _test_ad_short_loop()
@@ -0,0 +1,67 @@
+import math
+
+import numpy as np
+
+import taichi as ti
+from taichi import approx
+
+
+@ti.test()
+def test_ad_forward_unary():
+    x = ti.field(ti.f32, shape=(), needs_dual=True)
+    y = ti.field(ti.f32, shape=(), needs_dual=True)
+
+    @ti.kernel
+    def compute():
+        y[None] = ti.sin(x[None]) * ti.exp(x[None])
+
+    x[None] = 0.3
+    with ti.FwdMode(loss=y, param=x):
+        compute()
+
+    v = 0.3
+    assert y[None] == approx(math.sin(v) * math.exp(v))
+    assert y.dual[None] == approx(
+        (math.cos(v) + math.sin(v)) * math.exp(v))
+    assert x.dual[None] == 0
+
+
+@ti.test()
+def test_ad_forward_local_loop():
+    x = ti.field(ti.f32, shape=(), needs_dual=True)
+    y = ti.field(ti.f32, shape=(), needs_dual=True)
+
+    @ti.kernel
+    def compute():
+        for _ in range(1):
+            v = x[None]
+            for _ in range(3):
+                v = v * x[None]
+            y[None] = v
+
+    x[None] = 2
+    with ti.FwdMode(loss=y, param=x):
+        compute()
+
+    assert y[None] == approx(16)
+    assert y.dual[None] == approx(4 * 8)
+
+
+@ti.test()
+def test_ad_forward_seed():
+    n = 8
+    x = ti.field(ti.f32, shape=n, needs_dual=True)
+    loss = ti.field(ti.f32, shape=(), needs_dual=True)
+
+    @ti.kernel
+    def compute():
+        for i in x:
+            loss[None] += x[i]**2
+
+    x.from_numpy(np.arange(n, dtype=np.float32))
+    seed = np.zeros(n, dtype=np.float32)
+    seed[3] = 1
+    with ti.FwdMode(loss=loss, param=x, seed=seed):
+        compute()
+
+    assert loss.dual[None] == approx(2 * 3)
@@ -0,0 +1,125 @@
+import numpy as np
+import pytest
+
+import taichi as ti
+
+
+@pytest.mark.parametrize('n', [1, 1000, 100000])
+@ti.test()
+def test_exclusive_scan(n):
+    x = ti.field(ti.i32, shape=n)
+    a = np.random.randint(0, 10, n).astype(np.int32)
+    x.from_numpy(a)
+    assert ti.algorithms.exclusive_scan(x) == a.sum()
+    expected = np.concatenate([[0], np.cumsum(a)[:-1]])
+    assert np.array_equal(x.to_numpy(), expected)
+
+
+@pytest.mark.parametrize('dtype', [ti.i32, ti.f32])
+@ti.test()
+def test_sort(dtype):
+    n = 10000
+    keys = ti.field(dtype, shape=n)
+    values = ti.field(ti.i32, shape=n)
+    if dtype == ti.i32:
+        a = np.random.randint(-100, 100, n).astype(np.int32)
+    else:
+        a = (np.random.rand(n) * 200 - 100).astype(np.float32)
+    keys.from_numpy(a)
+    values.from_numpy(np.arange(n, dtype=np.int32))
+    ti.algorithms.sort(keys, values)
+    order = np.argsort(a, kind='stable')
+    assert np.array_equal(keys.to_numpy(), a[order])
+    assert np.array_equal(values.to_numpy(), order)
+
+
+@ti.test()
+def test_compact():
+    n = 5000
+    src = ti.field(ti.f32, shape=n)
+    flags = ti.field(ti.i32, shape=n)
+    dst = ti.field(ti.f32, shape=n)
+    a = np.random.rand(n).astype(np.float32)
+    f = np.random.randint(0, 2, n).astype(np.int32)
+    src.from_numpy(a)
+    flags.from_numpy(f)
+    count = ti.algorithms.compact(src, flags, dst)
+    assert count == f.sum()
+    assert np.array_equal(dst.to_numpy()[:count], a[f != 0])
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], ndarray_use_torch=False)
+def test_sort_ndarray():
+    n = 100000
+    keys = ti.ndarray(ti.u32, n)
+    a = np.random.randint(0, 1 << 30, n).astype(np.uint32)
+    keys.from_numpy(a)
+    ti.algorithms.sort(keys)
+    assert np.array_equal(keys.to_numpy(), np.sort(a))
+
+
+@ti.test()
+def test_cell_list():
+    n = 2000
+    radius = 0.05
+    x = ti.Vector.field(2, ti.f32, shape=n)
+    tag = ti.field(ti.i32, shape=n)
+    num_neighbors = ti.field(ti.i32, shape=n)
+    grid = ti.algorithms.CellList(n, (20, 20), radius)
+
+    @ti.kernel
+    def count():
+        for i in x:
+            c = grid.cell_of(x[i])
+            num_neighbors[i] = 0
+            for offset in ti.static(ti.grouped(ti.ndrange((-1, 2), (-1, 2)))):
+                r = grid.cell_range(c + offset)
+                for k in range(r[0], r[1]):
+                    j = grid.particle_ids[k]
+                    if i != j and (x[i] - x[j]).norm() < radius:
+                        num_neighbors[i] += 1
+
+    a = np.random.rand(n, 2).astype(np.float32)
+    x.from_numpy(a)
+    tag.from_numpy(np.arange(n, dtype=np.int32))
+    d = np.linalg.norm(a[:, None] - a[None], axis=2)
+    expected = (d < radius).sum(axis=1) - 1
+
+    grid.build(x)
+    count()
+    assert np.array_equal(num_neighbors.to_numpy(), expected)
+
+    # The particles of each cell are contiguous after reordering.
+    grid.reorder(x, tag)
+    assert np.array_equal(x.to_numpy(), a[tag.to_numpy()])
+    count()
+    assert np.array_equal(num_neighbors.to_numpy(), expected[tag.to_numpy()])
+    cells = np.minimum((x.to_numpy() / radius).astype(np.int32), 19)
+    cells = cells[:, 0] * 20 + cells[:, 1]
+    assert np.all(np.diff(cells) >= 0)
+
+
+@ti.test()
+def test_cell_list_morton():
+    n = 1000
+    x = ti.Vector.field(2, ti.f32, shape=n)
+    tag = ti.field(ti.i32, shape=n)
+    grid = ti.algorithms.CellList(n, (6, 8), 1.0, morton=True)
+    assert grid.num_cells == 64
+
+    a = (np.random.rand(n, 2) * [6, 8]).astype(np.float32)
+    x.from_numpy(a)
+    tag.from_numpy(np.arange(n, dtype=np.int32))
+    grid.build(x)
+    grid.reorder(x, tag)
+    assert np.array_equal(x.to_numpy(), a[tag.to_numpy()])
+
+    def morton(i, j):
+        code = 0
+        for b in range(3):
+            code |= ((j >> b) & 1) << (2 * b) | ((i >> b) & 1) << (2 * b + 1)
+        return code
+
+    cells = np.minimum(x.to_numpy().astype(np.int32), [5, 7])
+    codes = [morton(i, j) for i, j in cells]
+    assert np.all(np.diff(codes) >= 0)
@@ -59,6 +59,30 @@ def test_save():
             json.load(json_file)
 
 
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_save_llvm():
+    density = ti.field(float, shape=(4, 4))
+
+    @ti.kernel
+    def init():
+        for i, j in density:
+            density[i, j] = 1
+
+    @ti.kernel
+    def foo(n: ti.template()):
+        for i in range(n):
+            density[0, 0] += 1
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        m = ti.aot.Module(ti.cfg.arch)
+        m.add_field('density', density)
+        m.add_kernel(init)
+        with m.add_kernel_template(foo) as kt:
+            kt.instantiate(n=6)
+        m.save(tmpdir, '')
+        assert os.path.getsize(os.path.join(tmpdir, 'metadata.tcb')) > 0
+
+
 @ti.test(arch=ti.opengl)
 def test_non_dense_snode():
     n = 8
@@ -313,3 +337,35 @@ def test_mpm88_ndarray():
         m.save(tmpdir, '')
         with open(os.path.join(tmpdir, 'metadata.json')) as json_file:
             json.load(json_file)
+
+
+def _save_wasm_module():
+    x = ti.field(ti.i32, shape=16)
+
+    @ti.kernel
+    def fill():
+        for i in range(16):
+            x[i] = i * 2
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        m = ti.aot.Module(ti.wasm)
+        m.add_kernel(fill)
+        m.save(tmpdir, 'wasm_module')
+        with open(os.path.join(tmpdir, 'wasm_module.ll')) as f:
+            return f.read()
+
+
+@ti.test(arch=ti.cpu, wasm_simd128=True)
+def test_wasm_simd128():
+    assert '"target-features"="+simd128"' in _save_wasm_module()
+
+
+@ti.test(arch=ti.cpu, wasm_threads=True)
+def test_wasm_threads():
+    assert '"target-features"="+atomics,+bulk-memory"' in _save_wasm_module()
+
+
+@ti.test(arch=ti.cpu, wasm_simd128=True, wasm_threads=True)
+def test_wasm_simd128_threads():
+    ir = _save_wasm_module()
+    assert '"target-features"="+simd128,+atomics,+bulk-memory"' in ir
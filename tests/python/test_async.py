@@ -53,3 +53,119 @@ def test_listgen_opt_with_offsets():
 
     ti.sync()
     assert ti.get_kernel_stats().get_counters()['launched_tasks_list_gen'] <= 2
+
+
+@ti.test(arch=ti.cuda, async_mode=True, async_cuda_num_streams=4)
+def test_multi_stream():
+    n = 1024
+    fields = [ti.field(ti.i32, shape=n) for _ in range(4)]
+    total = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def fill(x: ti.template(), v: ti.i32):
+        for i in x:
+            x[i] = v + i
+
+    @ti.kernel
+    def accumulate(x: ti.template()):
+        for i in x:
+            total[i] += x[i]
+
+    for k in range(10):
+        # The fills are independent of each other
+        for j, x in enumerate(fields):
+            fill(x, k * 4 + j)
+        for x in fields:
+            accumulate(x)
+
+    ti.sync()
+    for i in range(n):
+        assert total[i] == sum(range(40)) + 40 * i
+
+
+@ti.test(require=ti.extension.async_mode,
+         async_mode=True,
+         async_pipeline=True,
+         async_flush_every=8)
+def test_pipelined_flush():
+    n = 256
+    x = ti.field(ti.i32, shape=n)
+    y = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def inc(a: ti.template(), v: ti.i32):
+        for i in a:
+            a[i] += v
+
+    for k in range(100):
+        inc(x, k)
+        inc(y, 2 * k)
+        if k % 10 == 0:
+            ti.async_flush()
+
+    ti.sync()
+    for i in range(n):
+        assert x[i] == sum(range(100))
+        assert y[i] == 2 * sum(range(100))
+
+
+@ti.test(require=ti.extension.async_mode,
+         async_mode=True,
+         async_memoize_schedules=True)
+def test_memoized_schedules():
+    n = 256
+    x = ti.field(ti.i32, shape=n)
+    y = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def inc(a: ti.template(), v: ti.i32):
+        for i in a:
+            a[i] += v
+
+    # Each frame launches the same tasks with other arguments.
+    for k in range(20):
+        inc(x, k)
+        inc(y, 2 * k)
+        inc(x, 1)
+        ti.async_flush()
+
+    ti.sync()
+    for i in range(n):
+        assert x[i] == sum(range(20)) + 20
+        assert y[i] == 2 * sum(range(20))
+    assert ti.get_kernel_stats().get_counters()['num_replayed_schedules'] > 0
+
+
+@ti.test(require=ti.extension.async_mode,
+         async_mode=True,
+         async_flush_every=4)
+def test_tape_backward_batch():
+    n = 64
+    x = ti.field(ti.f32, shape=n, needs_grad=True)
+    y = ti.field(ti.f32, shape=n, needs_grad=True)
+    loss = ti.field(ti.f32, shape=(), needs_grad=True)
+
+    @ti.kernel
+    def scale(a: ti.template(), b: ti.template()):
+        for i in a:
+            b[i] += a[i] * 2
+
+    @ti.kernel
+    def reduce(a: ti.template()):
+        for i in a:
+            loss[None] += a[i]
+
+    for i in range(n):
+        x[i] = i
+
+    # The backward pass is longer than async_flush_every, but is still
+    # optimized as one graph, where the adjoint kernels are fused.
+    with ti.Tape(loss):
+        for _ in range(8):
+            scale(x, y)
+        reduce(y)
+
+    assert loss[None] == 8 * 2 * sum(range(n))
+    for i in range(n):
+        assert x.grad[i] == 16
+    assert ti.get_kernel_stats().get_counters()['num_fused_tasks'] > 0
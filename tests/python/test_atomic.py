@@ -309,3 +309,41 @@ def test_atomic_xor_expr_evaled():
     func()
 
     assert c[None] == 0
+
+
+@ti.test(arch=ti.cuda, cuda_warp_aggregated_atomics=True)
+def test_warp_aggregated_atomics():
+    N = 4096
+    num_bins = 13
+    hist = ti.field(ti.i32, shape=num_bins)
+    hist_f = ti.field(ti.f32, shape=num_bins)
+    bin_min = ti.field(ti.i32, shape=num_bins)
+    bin_max = ti.field(ti.f32, shape=num_bins)
+
+    @ti.kernel
+    def fill():
+        for i in range(num_bins):
+            bin_min[i] = N
+            bin_max[i] = -1
+        for i in range(N):
+            # Lanes of the same warp hit the same bins
+            b = (i * i) % num_bins
+            hist[b] += 1
+            hist_f[b] += 0.5
+            ti.atomic_min(bin_min[b], i)
+            ti.atomic_max(bin_max[b], i)
+
+    fill()
+    expected = [0] * num_bins
+    expected_min = [N] * num_bins
+    expected_max = [-1] * num_bins
+    for i in range(N):
+        b = (i * i) % num_bins
+        expected[b] += 1
+        expected_min[b] = min(expected_min[b], i)
+        expected_max[b] = max(expected_max[b], i)
+    for b in range(num_bins):
+        assert hist[b] == expected[b]
+        assert hist_f[b] == approx(expected[b] * 0.5)
+        assert bin_min[b] == expected_min[b]
+        assert bin_max[b] == expected_max[b]
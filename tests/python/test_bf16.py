@@ -0,0 +1,110 @@
+import numpy as np
+
+import taichi as ti
+from taichi import approx
+
+archs_support_bf16 = [ti.cpu, ti.cuda]
+
+
+@ti.test(arch=archs_support_bf16)
+def test_snode_read_write():
+    x = ti.field(ti.bf16, shape=())
+    x[None] = 0.3
+    assert (x[None] == approx(0.3, rel=1e-2))
+    # bf16 keeps the exponent range of f32.
+    x[None] = 1e30
+    assert (x[None] == approx(1e30, rel=1e-2))
+
+
+@ti.test(arch=archs_support_bf16)
+def test_to_numpy():
+    n = 16
+    x = ti.field(ti.bf16, shape=n)
+
+    @ti.kernel
+    def init():
+        for i in x:
+            x[i] = i * 2
+
+    init()
+    y = x.to_numpy()
+    assert y.dtype == np.float32
+    for i in range(n):
+        assert (y[i] == 2 * i)
+
+
+@ti.test(arch=archs_support_bf16)
+def test_from_numpy():
+    n = 16
+    y = ti.field(dtype=ti.bf16, shape=n)
+    y.from_numpy(np.arange(n, dtype=np.float32))
+
+    @ti.kernel
+    def scale():
+        for i in y:
+            y[i] = y[i] * 3
+
+    scale()
+    z = y.to_numpy()
+    for i in range(n):
+        assert (z[i] == i * 3)
+
+
+@ti.test(arch=archs_support_bf16)
+def test_compute_in_f32():
+    x = ti.field(ti.bf16, shape=())
+    y = ti.field(ti.f32, shape=())
+
+    @ti.kernel
+    def foo():
+        x[None] = 1.0
+        # 1 + 2^-10 is not representable in bf16, but the sum is in f32.
+        y[None] = x[None] + 2.0**-10
+        x[None] = y[None]
+
+    foo()
+    assert y[None] == 1.0 + 2.0**-10
+    assert x[None] == 1.0
+
+
+@ti.test(arch=archs_support_bf16)
+def test_cast():
+    @ti.kernel
+    def foo(a: ti.f32) -> ti.f32:
+        return ti.cast(a, ti.bf16)
+
+    assert foo(1.0 + 2.0**-10) == 1.0
+    assert foo(3.0) == 3.0
+    assert foo(1e-3) == approx(1e-3, rel=1e-2)
+
+
+@ti.test(arch=archs_support_bf16)
+def test_atomic_add():
+    n = 64
+    x = ti.field(ti.bf16, shape=())
+
+    @ti.kernel
+    def foo():
+        for i in range(n):
+            x[None] += 1.0
+
+    foo()
+    assert x[None] == n
+
+
+@ti.test(arch=archs_support_bf16)
+def test_atomic_max_min():
+    x = ti.field(ti.bf16, shape=())
+    y = ti.field(ti.bf16, shape=())
+
+    @ti.kernel
+    def foo():
+        x[None] = -100.0
+        y[None] = 100.0
+        for i in range(10):
+            ti.atomic_max(x[None], i * 0.5)
+            ti.atomic_min(y[None], i * 0.5)
+
+    foo()
+    assert x[None] == 4.5
+    assert y[None] == 0.0
@@ -174,3 +174,46 @@ def test_evolve():
     evolve_naive(x, z)
     evolve_vectorized(x, y)
     verify()
+
+
+@ti.test(require=ti.extension.quant)
+def test_offset_load_multi_bit():
+    cu4 = ti.quant.int(4, False)
+
+    x = ti.field(dtype=cu4)
+    y = ti.field(dtype=cu4)
+
+    N = 1024
+    n_blocks = 4
+    elements = 8
+    boundary_offset = 256
+    assert boundary_offset >= N // n_blocks
+
+    block = ti.root.pointer(ti.ij, (n_blocks, n_blocks))
+    block.dense(ti.ij, (N // n_blocks, N // (elements * n_blocks))).bit_array(
+        ti.j, elements, num_bits=32).place(x)
+    block.dense(ti.ij, (N // n_blocks, N // (elements * n_blocks))).bit_array(
+        ti.j, elements, num_bits=32).place(y)
+
+    @ti.kernel
+    def init():
+        for i, j in ti.ndrange((boundary_offset, N - boundary_offset),
+                               (boundary_offset, N - boundary_offset)):
+            x[i, j] = ti.random(dtype=ti.i32) % 16
+
+    @ti.kernel
+    def assign_vectorized(dx: ti.template(), dy: ti.template()):
+        ti.bit_vectorize(elements)
+        for i, j in x:
+            y[i, j] = x[i + dx, j + dy]
+
+    @ti.kernel
+    def verify(dx: ti.template(), dy: ti.template()):
+        for i, j in ti.ndrange((boundary_offset, N - boundary_offset),
+                               (boundary_offset, N - boundary_offset)):
+            assert y[i, j] == x[i + dx, j + dy]
+
+    init()
+    for dx, dy in [(0, 0), (0, 1), (0, -1), (1, 3), (-1, -5), (0, 7)]:
+        assign_vectorized(dx, dy)
+        verify(dx, dy)
@@ -39,6 +39,11 @@ def test_basic_packed():
     _test_basic()
 
 
+@ti.test(arch=ti.opengl)
+def test_basic_opengl():
+    _test_basic()
+
+
 @ti.test(require=ti.extension.sparse)
 def test_bitmasked_then_dense():
     x = ti.field(ti.f32)
@@ -214,6 +219,11 @@ def test_sparsity_changes():
     _test_sparsity_changes()
 
 
+@ti.test(arch=ti.opengl)
+def test_sparsity_changes_opengl():
+    _test_sparsity_changes()
+
+
 @ti.test(require=[ti.extension.sparse, ti.extension.packed], packed=True)
 def test_sparsity_changes_packed():
     _test_sparsity_changes()
@@ -310,3 +320,36 @@ def test_root_deactivate():
     ti.root.deactivate_all()
     is_active()
     assert c[None] == 0
+
+
+@ti.test(require=ti.extension.sparse)
+def test_bitmasked_sparse_words():
+    x = ti.field(ti.i32)
+    n = 1000
+    # Not a multiple of the 32 cells of a mask word.
+    ti.root.bitmasked(ti.i, 10).bitmasked(ti.i, n).place(x)
+
+    cells = [0, 31, 32, 33, 63, 64, 999, 1000, 4095, 9999]
+
+    @ti.kernel
+    def activate(i: ti.i32):
+        x[i] = i + 1
+
+    @ti.kernel
+    def traverse() -> ti.i32:
+        result = 0
+        for i in x:
+            result += x[i]
+        return result
+
+    @ti.kernel
+    def count() -> ti.i32:
+        result = 0
+        for i in x:
+            result += 1
+        return result
+
+    for i in cells:
+        activate(i)
+    assert count() == len(cells)
+    assert traverse() == sum(i + 1 for i in cells)
@@ -85,12 +85,28 @@ def test_gather_2d_nonsquare():
     _test_bls_stencil(2, 128, bs=(4, 16), stencil=stencil)
 
 
+@ti.test(require=ti.extension.bls)
+def test_gather_2d_wide_halo():
+    # Each thread fetches its elements into BLS in more than one batch.
+    stencil = [(0, 0), (-8, -8), (8, 8)]
+    _test_bls_stencil(2, 128, bs=16, stencil=stencil)
+
+
 @ti.test(require=ti.extension.bls)
 def test_gather_3d():
     stencil = [(-1, -1, -1), (2, 0, 1)]
     _test_bls_stencil(3, 64, bs=(4, 8, 16), stencil=stencil)
 
 
+@ti.test(arch=ti.cuda)
+def test_gather_3d_dynamic_shared_memory():
+    if ti.core.query_int64('cuda_compute_capability') < 70:
+        return
+    # 24^3 i32 elements of BLS, more than the 48 KB of static shared memory.
+    stencil = [(-8, -8, -8), (8, 8, 8)]
+    _test_bls_stencil(3, 64, bs=(8, 8, 8), stencil=stencil)
+
+
 @ti.test(require=ti.extension.bls)
 def test_scatter_1d_trivial():
     # y[i] = x[i]
@@ -170,6 +186,43 @@ def test_bls_large_block():
     foo()
 
 
+
+@ti.test(require=ti.extension.bls, auto_block_local=True)
+def test_auto_block_local():
+    n = 64
+    block_size = 8
+
+    x = ti.field(dtype=ti.i32)
+    y = ti.field(dtype=ti.i32)
+    block = ti.root.pointer(ti.ij, n // block_size)
+    block.dense(ti.ij, block_size).place(x)
+    block.dense(ti.ij, block_size).place(y)
+
+    @ti.kernel
+    def populate():
+        # Keeps the neighbors of the active blocks in the field.
+        for i, j in ti.ndrange((block_size, n - block_size),
+                               (block_size, n - block_size)):
+            x[i, j] = i * n + j
+
+    @ti.kernel
+    def laplace():
+        # x is cached in BLS without a ti.block_local().
+        for i, j in x:
+            y[i, j] = 4 * x[i, j] - x[i - 1, j] - x[i + 1, j] - x[
+                i, j - 1] - x[i, j + 1]
+
+    populate()
+    laplace()
+
+    x_np = x.to_numpy()
+    y_np = y.to_numpy()
+    for i in range(block_size, n - block_size):
+        for j in range(block_size, n - block_size):
+            assert y_np[i, j] == 4 * x_np[i, j] - x_np[i - 1, j] - x_np[
+                i + 1, j] - x_np[i, j - 1] - x_np[i, j + 1]
+
+
 # TODO: BLS on CPU
 # TODO: BLS boundary out of bound
 # TODO: BLS with TLS
@@ -0,0 +1,76 @@
+import numpy as np
+import pytest
+
+import taichi as ti
+
+
+@ti.test()
+def test_bound_launcher():
+    n = 8
+    x = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def step(x: ti.template(), t: ti.f32, k: ti.i32,
+             v: ti.any_arr()) -> ti.i32:
+        for i in x:
+            x[i] += t * v[i] + k
+        return k * 2
+
+    v = np.arange(n, dtype=np.float32)
+    launch = step.bind(x, 0.0, 0, v)
+    for i in range(10):
+        assert launch(0.5, i, v) == i * 2
+    np.testing.assert_allclose(x.to_numpy(), v * 5 + 45)
+
+    # A different array is set again.
+    w = np.ones(n, dtype=np.float32)
+    launch(1.0, 0, w)
+    np.testing.assert_allclose(x.to_numpy(), v * 5 + 46)
+
+
+@ti.test()
+def test_bound_launcher_writes_array():
+    @ti.kernel
+    def fill(a: ti.any_arr(), k: ti.i32):
+        for i in a:
+            a[i] = i + k
+
+    a = np.zeros(4, dtype=np.int32)
+    launch = fill.bind(a, 0)
+    for k in range(3):
+        launch(a, k)
+        np.testing.assert_equal(a, np.arange(4) + k)
+
+
+@ti.test(arch=ti.cpu)
+def test_bound_launcher_non_contiguous():
+    @ti.kernel
+    def fill(a: ti.any_arr()):
+        for i in a:
+            a[i] = i
+
+    a = np.zeros(8, dtype=np.int32)
+    with pytest.raises(ValueError):
+        fill.bind(a[::2])
+
+
+@ti.test()
+def test_bound_launcher_async_return():
+    x = ti.field(ti.i32, shape=16)
+
+    @ti.kernel
+    def step(k: ti.i32) -> ti.i32:
+        s = 0
+        for i in x:
+            x[i] += k
+            s += x[i]
+        return s
+
+    launch = step.bind(0)
+    # Each launch keeps its own value, although they share a result buffer.
+    futures = [launch.launch_async(k) for k in range(4)]
+    expected = 0
+    for k, future in enumerate(futures):
+        expected += 16 * k
+        assert future.result() == expected
+        assert future.done()
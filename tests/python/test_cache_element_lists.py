@@ -0,0 +1,65 @@
+import taichi as ti
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], cache_element_lists=True)
+def test_cache_element_lists():
+    x = ti.field(ti.i32)
+    block = ti.root.pointer(ti.i, 8).bitmasked(ti.i, 4)
+    block.dense(ti.i, 2).place(x)
+
+    @ti.kernel
+    def count() -> ti.i32:
+        result = 0
+        for i in x:
+            result += 1
+        return result
+
+    @ti.kernel
+    def activate(i: ti.i32):
+        x[i] = 1
+
+    @ti.kernel
+    def deactivate_odd_blocks():
+        for i in x:
+            if i // 2 % 2 == 1:
+                ti.deactivate(block, i // 2)
+
+    assert count() == 0
+    activate(0)
+    assert count() == 2
+    # Activates a cell of an active dense block.
+    activate(1)
+    assert count() == 2
+    activate(2)
+    activate(40)
+    assert count() == 6
+    assert count() == 6
+    deactivate_odd_blocks()
+    assert count() == 4
+    ti.deactivate_all_snodes()
+    assert count() == 0
+    activate(63)
+    assert count() == 2
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], cache_element_lists=True)
+def test_cache_element_lists_dynamic():
+    x = ti.field(ti.i32)
+    ti.root.pointer(ti.i, 4).dynamic(ti.j, 64, chunk_size=8).place(x)
+
+    @ti.kernel
+    def append(i: ti.i32, n: ti.i32):
+        for k in range(n):
+            ti.append(x.parent(), i, k)
+
+    @ti.kernel
+    def count() -> ti.i32:
+        result = 0
+        for i, j in x:
+            result += 1
+        return result
+
+    append(1, 3)
+    assert count() == 3
+    append(1, 10)
+    assert count() == 13
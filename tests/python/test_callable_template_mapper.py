@@ -51,3 +51,21 @@ def test_callable_template_mapper_numpy():
                                         dtype=np.float32)))[0] == 0
     assert mapper.lookup((0, 0, np.ones(shape=(1, 2, 1),
                                         dtype=np.int32)))[0] == 1
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_callable_template_mapper_field_handle():
+    x = ti.field(ti.f32, shape=(4, 8))
+    y = ti.field(ti.f32, shape=(4, 8))
+    z = ti.field(ti.f32, shape=(8, 4))
+    w = ti.field(ti.i32, shape=(4, 8))
+    s = ti.field(ti.f32)
+    ti.root.pointer(ti.ij, (4, 8)).place(s)
+
+    mapper = TaichiCallableTemplateMapper((ti.field_handle(), ), (0, ))
+    assert mapper.lookup((x, ))[0] == 0
+    assert mapper.lookup((y, ))[0] == 0
+    assert mapper.lookup((z, ))[0] == 1
+    assert mapper.lookup((w, ))[0] == 2
+    # Taken like a template.
+    assert mapper.lookup((s, ))[0] == 3
@@ -0,0 +1,84 @@
+import os
+import tempfile
+
+import numpy as np
+import pytest
+
+import taichi as ti
+
+
+def _test_round_trip(compress):
+    x = ti.field(ti.f32, shape=(128, 64))
+    y = ti.Vector.field(3, ti.i32, shape=1000)
+    z = ti.field(ti.i32)
+    bm = ti.root.bitmasked(ti.i, 64)
+    bm.place(z)
+
+    @ti.kernel
+    def fill(k: ti.i32):
+        for i, j in x:
+            x[i, j] = i * 0.5 + j + k
+        for i in y:
+            y[i] = [i, i + k, -i]
+        for i in range(0, 64, 3):
+            z[i] = i + k
+
+    @ti.kernel
+    def count() -> ti.i32:
+        n = 0
+        for i in z:
+            n += 1
+        return n
+
+    fill(1)
+    expected_x = x.to_numpy()
+    expected_y = y.to_numpy()
+    expected_z = z.to_numpy()
+    with tempfile.TemporaryDirectory() as tmpdir:
+        filename = os.path.join(tmpdir, 'fields.tickpt')
+        ti.save_checkpoint(filename, compress=compress, num_threads=4)
+        fill(2)
+        for i in range(64):
+            ti.deactivate(bm, [i])
+        ti.load_checkpoint(filename, num_threads=4)
+    np.testing.assert_array_equal(x.to_numpy(), expected_x)
+    np.testing.assert_array_equal(y.to_numpy(), expected_y)
+    np.testing.assert_array_equal(z.to_numpy(), expected_z)
+    assert count() == 22
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_checkpoint():
+    _test_round_trip(compress=False)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_checkpoint_compressed():
+    _test_round_trip(compress=True)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_checkpoint_pointer():
+    x = ti.field(ti.f32)
+    ti.root.pointer(ti.i, 8).dense(ti.i, 8).place(x)
+    x[3] = 1
+    with tempfile.TemporaryDirectory() as tmpdir:
+        filename = os.path.join(tmpdir, 'fields.tickpt')
+        with pytest.raises(RuntimeError, match='do not support pointer'):
+            ti.save_checkpoint(filename)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_checkpoint_layout_mismatch():
+    x = ti.field(ti.f32, shape=16)
+    x[0] = 1
+    with tempfile.TemporaryDirectory() as tmpdir:
+        filename = os.path.join(tmpdir, 'fields.tickpt')
+        ti.save_checkpoint(filename)
+        arch = ti.lang.impl.current_cfg().arch
+        ti.reset()
+        ti.init(arch=arch)
+        y = ti.field(ti.f64, shape=16)
+        y[0] = 1
+        with pytest.raises(RuntimeError, match='differs'):
+            ti.load_checkpoint(filename)
@@ -1,3 +1,5 @@
+import numpy as np
+
 import taichi as ti
 
 
@@ -22,3 +24,16 @@ def test_scalar():
     assert y[0] == 1
     assert y[1] == 0
     assert y[2] == 3
+
+
+@ti.test()
+def test_copy_from_layouts():
+    x = ti.Vector.field(2, ti.f32, shape=8)
+    y = ti.Vector.field(2, ti.f32, shape=8, layout=ti.Layout.SOA)
+    z = ti.Vector.field(2, ti.f32, shape=8, layout=ti.Layout.SOA)
+
+    x.from_numpy(np.arange(16, dtype=np.float32).reshape(8, 2))
+    # Interleaved members, left to a kernel.
+    y.copy_from(x)
+    z.copy_from(y)
+    assert (z.to_numpy() == x.to_numpy()).all()
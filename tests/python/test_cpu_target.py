@@ -0,0 +1,36 @@
+import os
+import tempfile
+
+import taichi as ti
+
+
+@ti.test(arch=ti.cpu, cpu_target='generic')
+def test_generic_cpu_target():
+    n = 256
+    x = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = ti.sqrt(i) * 2.0 + 1.0
+
+    fill()
+    for i in range(n):
+        assert x[i] == ti.approx(i**0.5 * 2.0 + 1.0)
+
+
+@ti.test(arch=ti.cpu, cpu_aot_variants='generic')
+def test_save_llvm_cpu_variants():
+    density = ti.field(float, shape=(4, 4))
+
+    @ti.kernel
+    def init():
+        for i, j in density:
+            density[i, j] = 1
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        m = ti.aot.Module(ti.cpu)
+        m.add_field('density', density)
+        m.add_kernel(init)
+        m.save(tmpdir, '')
+        assert os.path.getsize(os.path.join(tmpdir, 'metadata.tcb')) > 0
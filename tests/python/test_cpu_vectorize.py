@@ -0,0 +1,47 @@
+import numpy as np
+
+import taichi as ti
+
+
+@ti.test(arch=ti.cpu, cpu_vectorize_range_for=True)
+def test_vectorized_element_wise():
+    # Not a multiple of the SIMD width, to cover the masked tail
+    n = 1003
+    x = ti.field(ti.f32, shape=n)
+    y = ti.field(ti.f32, shape=n)
+    z = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def compute():
+        for i in range(n):
+            x[i] = i * 0.5
+        for i in range(n):
+            y[i] = x[i] * 2 + 1
+            # Non-contiguous access
+            z[i] = int(x[(i * 7) % n])
+
+    compute()
+    xs = np.arange(n) * 0.5
+    np.testing.assert_allclose(y.to_numpy(), xs * 2 + 1)
+    np.testing.assert_array_equal(z.to_numpy(),
+                                  xs[(np.arange(n) * 7) % n].astype(np.int32))
+
+
+@ti.test(arch=ti.cpu, cpu_vectorize_range_for=True)
+def test_vectorized_continue_and_reduction():
+    n = 1000
+    x = ti.field(ti.i32, shape=n)
+    s = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def run():
+        for i in range(n):
+            if i % 3 == 0:
+                continue
+            x[i] = i
+            s[None] += i
+
+    run()
+    expected = [0 if i % 3 == 0 else i for i in range(n)]
+    assert x.to_numpy().tolist() == expected
+    assert s[None] == sum(expected)
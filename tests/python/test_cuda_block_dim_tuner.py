@@ -0,0 +1,51 @@
+import os
+import tempfile
+
+import taichi as ti
+
+
+def _run_kernels():
+    n = 1000
+    x = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def add(m: ti.i32):
+        for i in range(n):
+            x[i] += i
+        # A range only known on the device.
+        for i in range(m):
+            x[i] += 1
+
+    # Enough launches to go through all the candidates.
+    for _ in range(20):
+        add(n // 2)
+    for i in range(n):
+        assert x[i] == 20 * i + (20 if i < n // 2 else 0)
+
+
+@ti.test(arch=ti.cuda, cuda_tune_block_dim=True)
+def test_tune_block_dim():
+    _run_kernels()
+
+
+@ti.test(arch=ti.cuda)
+def test_tune_block_dim_persisted():
+    with tempfile.TemporaryDirectory() as tmpdir:
+        ti.init(arch=ti.cuda,
+                cuda_tune_block_dim=True,
+                offline_cache=True,
+                offline_cache_file_path=tmpdir)
+        _run_kernels()
+        ti.reset()
+        files = [
+            f for _, _, fs in os.walk(tmpdir) for f in fs
+            if f.startswith('block_dims')
+        ]
+        assert len(files) == 1
+
+        # Reuses the results, and still produces correct results.
+        ti.init(arch=ti.cuda,
+                cuda_tune_block_dim=True,
+                offline_cache=True,
+                offline_cache_file_path=tmpdir)
+        _run_kernels()
@@ -0,0 +1,51 @@
+import numpy as np
+import pytest
+
+import taichi as ti
+
+
+@ti.test(arch=ti.cuda)
+def test_cuda_graph_capture_and_replay():
+    n = 1024
+    x = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def add(d: ti.f32):
+        for i in x:
+            x[i] += d
+
+    graph = ti.CudaGraph()
+    with graph.capture():
+        for _ in range(4):
+            add(1.0)
+    assert graph.num_kernels == 4
+    assert np.allclose(x.to_numpy(), 4.0)
+
+    graph.replay()
+    graph.replay()
+    assert np.allclose(x.to_numpy(), 12.0)
+
+    with graph.update():
+        for _ in range(4):
+            add(0.5)
+    assert np.allclose(x.to_numpy(), 14.0)
+
+    graph.replay()
+    assert np.allclose(x.to_numpy(), 16.0)
+
+
+@ti.test(arch=ti.cuda)
+def test_cuda_graph_rejects_return_values():
+    x = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def get() -> ti.i32:
+        return x[None]
+
+    get()
+    graph = ti.CudaGraph()
+    with pytest.raises(RuntimeError):
+        with graph.capture():
+            get()
+    assert graph.num_kernels == 0
+    assert get() == 0
@@ -0,0 +1,31 @@
+import taichi as ti
+
+
+@ti.test(arch=ti.cuda, cuda_num_devices=2)
+def test_partitioned_dense_tree():
+    n = 1024
+    x = ti.field(ti.i32)
+    y = ti.field(ti.f32)
+    ti.root.dense(ti.i, n).dense(ti.j, 4).place(x)
+    ti.root.dense(ti.i, n).place(y)
+
+    @ti.kernel
+    def fill():
+        for i, j in x:
+            x[i, j] = i * 4 + j
+        for i in y:
+            y[i] = i * 0.5
+
+    @ti.kernel
+    def halo_sum() -> ti.i32:
+        s = 0
+        for i in range(1, n - 1):
+            s += x[i - 1, 0] + x[i + 1, 3]
+        return s
+
+    fill()
+    for i in range(0, n, 37):
+        assert x[i, 2] == i * 4 + 2
+        assert y[i] == i * 0.5
+    assert halo_sum() == sum((i - 1) * 4 + (i + 1) * 4 + 3
+                             for i in range(1, n - 1))
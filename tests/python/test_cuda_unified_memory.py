@@ -0,0 +1,53 @@
+import taichi as ti
+
+
+@ti.test(arch=ti.cuda, cuda_unified_memory=True)
+def test_unified_memory_dense_tree():
+    n = 1024
+    x = ti.field(ti.i32)
+    y = ti.field(ti.f32)
+    ti.root.dense(ti.i, n).dense(ti.j, 4).place(x)
+    ti.root.dense(ti.i, n).place(y)
+
+    @ti.kernel
+    def fill():
+        for i, j in x:
+            x[i, j] = i * 4 + j
+        for i in y:
+            y[i] = i * 0.5
+
+    @ti.kernel
+    def total() -> ti.i32:
+        s = 0
+        for i, j in x:
+            s += x[i, j]
+        return s
+
+    fill()
+    for i in range(0, n, 37):
+        assert x[i, 2] == i * 4 + 2
+        assert y[i] == i * 0.5
+    assert total() == n * 4 * (n * 4 - 1) // 2
+    x.from_numpy(x.to_numpy() + 1)
+    assert total() == n * 4 * (n * 4 + 1) // 2
+
+
+@ti.test(arch=ti.cuda, cuda_unified_memory=True)
+def test_unified_memory_sparse_tree():
+    x = ti.field(ti.i32)
+    ti.root.pointer(ti.i, 64).dense(ti.i, 16).place(x)
+
+    @ti.kernel
+    def fill():
+        for i in range(0, 1024, 3):
+            x[i] = i
+
+    @ti.kernel
+    def total() -> ti.i32:
+        s = 0
+        for i in x:
+            s += x[i]
+        return s
+
+    fill()
+    assert total() == sum(range(0, 1024, 3))
@@ -169,6 +169,42 @@ def test_negative(exponent_bits):
     assert b[None] == -123
 
 
+@ti.test(require=ti.extension.quant)
+def test_shared_exponents_parallel_decode():
+    exp = ti.quant.int(8, False)
+    cit = ti.quant.int(8, True)
+    cft = ti.type_factory.custom_float(significand_type=cit,
+                                       exponent_type=exp,
+                                       scale=1)
+    n = 64
+    a = ti.field(dtype=cft)
+    b = ti.field(dtype=cft)
+    c = ti.field(dtype=cft)
+    ti.root.dense(ti.i, n).bit_struct(num_bits=32).place(a,
+                                                         b,
+                                                         c,
+                                                         shared_exponent=True)
+    s = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def fill():
+        for i in a:
+            a[i] = i
+            b[i] = -i
+            c[i] = 2 * i
+
+    @ti.kernel
+    def reduce():
+        for i in a:
+            s[i] = a[i] + b[i] * 0.5 + c[i]
+
+    fill()
+    reduce()
+    for i in range(n):
+        assert a[i] == approx(i, rel=1e-2)
+        assert s[i] == approx(2.5 * i, rel=2e-2)
+
+
 # TODO: test precision
 # TODO: make sure unsigned has one more effective significand bit
 # TODO: test shared exponent floats with custom int in a single bit struct
@@ -130,3 +130,37 @@ def test_not_out_of_bound_with_offset():
         x[3, 7] = 2
 
     func()
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], check_out_of_bound_deferred=True)
+def test_out_of_bound_deferred():
+    ti.set_gdb_trigger(False)
+    x = ti.field(ti.i32, shape=8)
+
+    @ti.kernel
+    def func(n: ti.i32):
+        for i in range(n):
+            x[i] = i + 1
+
+    func(8)
+    ti.sync()
+    assert x.to_numpy().tolist() == list(range(1, 9))
+    func(10)
+    with pytest.raises(RuntimeError, match='Accessing field'):
+        ti.sync()
+    # The out-of-bound accesses went to the first element.
+    assert x[1] == 2
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], check_out_of_bound_deferred=True)
+def test_out_of_bound_deferred_proven_in_bound():
+    x = ti.field(ti.i32, shape=(8, 16))
+
+    @ti.kernel
+    def func():
+        for i in range(8):
+            for j in range(16):
+                x[i, j] = i * 16 + j
+
+    func()
+    assert x[7, 15] == 127
@@ -0,0 +1,24 @@
+import os
+
+import taichi as ti
+
+
+@ti.test(arch=ti.cpu, track_device_memory=True)
+def test_device_memory_breakdown():
+    ti.reset_device_memory_peak()
+    x = ti.field(ti.f32, shape=1024)
+    x[0] = 1  # Materializes the SNode tree.
+    y = ti.ndarray(ti.f32, shape=(256, 256))
+    this_file = os.path.basename(__file__)
+    breakdown = ti.get_device_memory_breakdown()
+    assert breakdown['peak_bytes'] >= breakdown['current_bytes']
+    allocs = breakdown['allocations']
+    assert all(a['callsite'] == '' or ':' in a['callsite'] for a in allocs)
+    ndarrays = [a for a in allocs if a['subsystem'] == 'ndarray']
+    assert len(ndarrays) == 1
+    assert ndarrays[0]['bytes'] >= 256 * 256 * 4
+    assert this_file in ndarrays[0]['callsite']
+    trees = [a for a in allocs if a['subsystem'] == 'snode_tree']
+    assert len(trees) >= 1
+    assert any(this_file in a['callsite'] for a in trees)
+    ti.print_device_memory_breakdown()
@@ -209,3 +209,45 @@ def test_dynamic_activate():
     assert l[0] == m
     assert l[1] == 21
     assert l[2] == 21
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_dynamic_chunk_table():
+    n = 4096
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32, shape=())
+    block = ti.root.dense(ti.i, 4)
+    pixel = block.dynamic(ti.j, n, chunk_size=16, chunk_table=True)
+    pixel.place(x)
+
+    @ti.kernel
+    def fill():
+        for i in range(4):
+            for k in range(n // (i + 1)):
+                ti.append(x.parent(), i, k * 3)
+
+    @ti.kernel
+    def total():
+        for i, j in x:
+            s[None] += x[i, j]
+
+    @ti.kernel
+    def get_len(i: ti.i32) -> ti.i32:
+        return ti.length(x.parent(), i)
+
+    fill()
+    for i in range(4):
+        m = n // (i + 1)
+        assert get_len(i) == m
+        for k in [0, 15, 16, 17, m // 2, m - 1]:
+            assert x[i, k] == k * 3
+    total()
+    assert s[None] == sum(3 * m * (m - 1) // 2 for m in [n // (i + 1)
+                                                         for i in range(4)])
+
+    x.parent().deactivate_all()
+    for i in range(4):
+        assert get_len(i) == 0
+    x[2, 100] = 7
+    assert get_len(2) == 101
+    assert x[2, 100] == 7
@@ -146,3 +146,60 @@ def test_field_name():
     for i in range(10):
         d.append(ti.field(dtype=ti.f32, shape=(2, 3), name=f'd{i}'))
         assert d[i].name == f'd{i}'
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_fields_added_after_kernel_launches():
+    fields = []
+
+    @ti.kernel
+    def fill(x: ti.template(), v: ti.i32):
+        for i in x:
+            x[i] = v + i
+
+    for k in range(8):
+        # Each field materializes a new SNode tree after the previous launch
+        x = ti.field(ti.i32, shape=16)
+        fields.append(x)
+        fill(x, k * 100)
+        for j, y in enumerate(fields):
+            assert y[3] == j * 100 + 3
+
+
+@pytest.mark.parametrize('dtype', data_types)
+@ti.test()
+def test_field_batched_accessors(dtype):
+    import numpy as np
+    x = ti.field(dtype, shape=(6, 12))
+    indices = np.array([[0, 0], [5, 11], [2, 3], [4, 7]])
+    x.write_batch(indices, [1, 2, 3, 4])
+    x.write_batch(indices[:1], 5)
+    expected = np.zeros((6, 12))
+    expected[tuple(indices.T)] = [5, 2, 3, 4]
+    assert (x.to_numpy() == expected).all()
+    assert x.read_batch(indices).tolist() == [5, 2, 3, 4]
+    assert x.read_batch(np.zeros((0, 2), dtype=np.int32)).shape == (0, )
+    with pytest.raises(ValueError):
+        x.read_batch(indices[:, :1])
+
+
+@pytest.mark.parametrize('dtype', [ti.u8, ti.i16, ti.u32, ti.i64, ti.f64])
+@ti.test(arch=ti.cpu)
+def test_field_host_accessors_interleaved(dtype):
+    # x is interleaved with y, to check the addresses computed on the host.
+    x = ti.field(dtype)
+    y = ti.field(ti.f32)
+    ti.root.dense(ti.ij, (3, 5)).place(y, x)
+
+    @ti.kernel
+    def fill():
+        for i, j in x:
+            x[i, j] = i * 5 + j
+            y[i, j] = -1
+
+    fill()
+    assert x[2, 4] == 14
+    x[1, 2] = 100
+    assert x.to_numpy()[1, 2] == 100
+    assert (y.to_numpy() == -1).all()
+    assert x[1, 3] == 8
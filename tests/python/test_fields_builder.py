@@ -174,3 +174,18 @@ def test_fields_builder_destroy():
         A(5)
     B(2)
     A(4)
+
+
+@ti.test(arch=ti.cpu)
+def test_fields_builder_destroy_large():
+    n = 2**26  # 256 MB
+    for _ in range(4):
+        fb = ti.FieldsBuilder()
+        a = ti.field(ti.i32)
+        fb.dense(ti.i, n).place(a)
+        c = fb.finalize()
+        # Not the memory of the tree destroyed before.
+        assert a[n // 2] == 0
+        a[n // 2] = 42
+        assert a[n // 2] == 42
+        c.destroy()
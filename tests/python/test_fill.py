@@ -1,3 +1,5 @@
+import numpy as np
+
 import taichi as ti
 
 
@@ -68,3 +70,29 @@ def test_fill_matrix_matrix():
             for p in range(2):
                 for q in range(3):
                     assert val[i, j][p, q] == mat(p, q)
+
+
+@ti.test(require=ti.extension.data64)
+def test_fill_dense_layouts():
+    a = ti.field(ti.f64)
+    b = ti.field(ti.u8)
+    c = ti.field(ti.i16)
+    d = ti.field(ti.f32)
+    e = ti.field(ti.i32, shape=(3, 5))
+    ti.root.dense(ti.i, 10).place(a)
+    ti.root.dense(ti.i, 10).place(b)
+    # Shares its cells with another field, so it is left to a kernel.
+    ti.root.dense(ti.i, 10).place(c, d)
+
+    a.fill(0.1)
+    b.fill(-1)
+    c.fill(7)
+    d.fill(0)
+    e.fill(2.5)
+    for i in range(10):
+        # Cast from the default float type, like in a kernel.
+        assert a[i] == float(np.float32(0.1))
+        assert b[i] == 255
+        assert c[i] == 7
+        assert d[i] == 0
+    assert (e.to_numpy() == 2).all()
@@ -286,3 +286,30 @@ def test_missing_return_annotation():
             add(30, 2)
 
         run()
+
+
+@ti.test(experimental_real_function=True)
+def test_function_in_dead_branch_not_compiled():
+    x = ti.field(ti.i32, shape=())
+
+    @ti.func
+    def unreachable(val: ti.i32):
+        # Fails if the body is ever generated.
+        x[None] += undefined_name  # noqa: F821
+
+    @ti.func
+    def dispatch(val: ti.i32, kind: ti.i32):
+        if kind == 1:
+            unreachable(val)
+        else:
+            x[None] += val
+
+    @ti.kernel
+    def run(val: ti.i32):
+        # The branch calling unreachable() is only found dead once dispatch()
+        # is inlined.
+        dispatch(val, 0)
+
+    x[None] = 0
+    run(42)
+    assert x[None] == 42
@@ -0,0 +1,38 @@
+import taichi as ti
+
+
+def _test_deep_struct_for():
+    x = ti.field(ti.i32)
+    block = ti.root.pointer(ti.ij, 4).pointer(ti.ij, 4)
+    block.bitmasked(ti.ij, 4).dense(ti.ij, 2).place(x)
+    coords = [(0, 0), (1, 0), (17, 100), (127, 127), (64, 3), (64, 5)]
+    for i, j in coords:
+        x[i, j] = i * 1000 + j
+
+    @ti.kernel
+    def count() -> ti.i32:
+        result = 0
+        for i, j in x:
+            result += 1
+        return result
+
+    @ti.kernel
+    def total() -> ti.i32:
+        result = 0
+        for i, j in x:
+            result += x[i, j]
+        return result
+
+    # Only (0, 0) and (1, 0) share a 2x2 dense block.
+    assert count() == 4 * (len(coords) - 1)
+    assert total() == sum(i * 1000 + j for i, j in coords)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], fuse_listgen=True)
+def test_fuse_listgen():
+    _test_deep_struct_for()
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], fuse_listgen=False)
+def test_no_fuse_listgen():
+    _test_deep_struct_for()
@@ -0,0 +1,112 @@
+import taichi as ti
+
+
+@ti.test(fuse_offloads=True)
+def test_fuse_element_wise():
+    n = 1024
+    x = ti.field(ti.i32, shape=n)
+    y = ti.field(ti.i32, shape=n)
+    z = ti.field(ti.i32, shape=(n, 4))
+
+    @ti.kernel
+    def run(k: ti.i32):
+        for i in range(n):
+            x[i] = i * k
+        for i in range(n):
+            y[i] = x[i] + 1
+        for i in range(n):
+            x[i] += y[i]
+        for i, j in z:
+            z[i, j] = i + j
+        for i, j in z:
+            z[i, j] *= 2
+
+    run(3)
+    for i in range(n):
+        assert y[i] == i * 3 + 1
+        assert x[i] == i * 6 + 1
+    for j in range(4):
+        assert z[5, j] == (5 + j) * 2
+
+
+@ti.test(fuse_offloads=True)
+def test_no_fuse_across_elements():
+    n = 1024
+    x = ti.field(ti.i32, shape=n + 1)
+    y = ti.field(ti.i32, shape=n)
+    s = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def run():
+        for i in range(n + 1):
+            x[i] = i
+        for i in range(n):
+            y[i] = x[(i + 1) % (n + 1)]
+        for i in range(n):
+            s[None] += y[i]
+        for i in range(n):
+            y[i] = s[None]
+
+    run()
+    total = sum(range(1, n + 1))
+    assert s[None] == total
+    for i in range(n):
+        assert y[i] == total
+
+
+@ti.test(fuse_offloads=True)
+def test_fold_serial_into_parallel():
+    n = 1024
+    x = ti.field(ti.i32, shape=n)
+    s = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def run(k: ti.i32):
+        # A serial task computing a uniform value for the range-for, which
+        # recomputes it in each iteration instead.
+        a = k * 2 + s[None]
+        for i in range(n):
+            x[i] = i + a
+
+    @ti.kernel
+    def reduce():
+        total = 0
+        for i in range(n):
+            total += x[i]
+        # Reads the reduction of the range-for, so not folded.
+        s[None] = total
+
+    s[None] = 5
+    ti.get_kernel_stats().clear()
+    run(3)
+    assert ti.get_kernel_stats().get_counters().get('launched_tasks_serial',
+                                                    0) == 0
+    for i in range(n):
+        assert x[i] == i + 11
+    reduce()
+    assert s[None] == sum(range(n)) + 11 * n
+
+
+@ti.test(require=ti.extension.dynamic_index,
+         dynamic_index=True,
+         fuse_offloads=True)
+def test_no_fold_serial_into_dynamic_index_writes():
+    n = 16
+    v = ti.Vector.field(2, ti.i32, shape=())
+    x = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def run(k: ti.i32):
+        a = v[None][0] + 1
+        for i in range(n):
+            x[i] = a
+            # Writes what the serial task reads, through a PtrOffsetStmt.
+            if i == 0:
+                v[None][k] = 100
+
+    ti.get_kernel_stats().clear()
+    run(0)
+    assert ti.get_kernel_stats().get_counters().get('launched_tasks_serial',
+                                                    0) == 1
+    for i in range(n):
+        assert x[i] == 1
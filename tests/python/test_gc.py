@@ -132,3 +132,43 @@ def test_fuse_allocator_state():
     for i, y in enumerate(ys):
         expected = N if i == N else 0
         assert y == expected
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], compact_gc=True)
+def test_compact_gc():
+    N = 64
+    x = ti.field(dtype=ti.i32)
+
+    block = ti.root.pointer(ti.i, N)
+    block.dense(ti.i, 16).place(x)
+
+    @ti.kernel
+    def activate():
+        for i in range(N):
+            x[i * 16 + 3] = i
+
+    @ti.kernel
+    def deactivate(keep: ti.i32):
+        for i in range(N):
+            if i % keep != 0:
+                ti.deactivate(block, i)
+
+    @ti.kernel
+    def total() -> ti.i32:
+        result = 0
+        for i in x:
+            result += x[i]
+        return result
+
+    activate()
+    assert block.num_dynamically_allocated == N
+    deactivate(8)
+    # The blocks left are moved to the front, and the rest is released.
+    assert block.num_dynamically_allocated == N // 8
+    assert total() == sum(range(0, N, 8))
+    for i in range(0, N, 8):
+        assert x[i * 16 + 3] == i
+
+    activate()
+    assert block.num_dynamically_allocated == N
+    assert total() == sum(range(N))
@@ -279,3 +279,59 @@ def test_imgui():
     render()
     verify_image(window, 'test_imgui')
     window.destroy()
+
+
+@ti.test()
+def test_set_image_tone_mapping():
+    from taichi.ui.staging_buffer import to_u8_rgba
+
+    img = ti.Vector.field(4, ti.f32, (4, 4))
+    img.fill(0.5)
+    img[0, 0] = [3.0, 1.0, 0.0, 0.5]
+
+    staging_img = to_u8_rgba(img, exposure=2.0, gamma=2.0, tone_map=True)
+    # c -> (c * 2 / (1 + c * 2)) ** (1 / 2) for the colors.
+    expected = [(6 / 7)**0.5, (2 / 3)**0.5, 0.0]
+    for k in range(3):
+        assert staging_img[0, 0][k] == int(expected[k] * 255)
+    assert staging_img[0, 0][3] == int(0.5 * 255)
+    assert staging_img[1, 1][0] == int(0.5**0.5 * 255)
+
+    # The defaults keep the colors.
+    staging_img = to_u8_rgba(img)
+    assert staging_img[1, 1][0] == int(0.5 * 255)
+
+
+@ti.test()
+def test_vbo_skips_unchanged_sources():
+    from taichi.ui.staging_buffer import (get_field_version, get_vbo_field,
+                                          mark_vbo_up_to_date,
+                                          vbo_is_up_to_date)
+
+    vertices = ti.Vector.field(3, ti.f32, 4)
+    colors = ti.Vector.field(3, ti.f32, 4)
+    vbo = get_vbo_field(vertices)
+    sources = (vertices, colors)
+    assert not vbo_is_up_to_date(vbo, sources)
+    mark_vbo_up_to_date(vbo, sources)
+    assert vbo_is_up_to_date(vbo, sources)
+    # Other sources for the same VBO.
+    assert not vbo_is_up_to_date(vbo, (vertices, None))
+
+    @ti.kernel
+    def read() -> ti.f32:
+        return vertices[0][0]
+
+    version = get_field_version(vertices)
+    read()
+    assert get_field_version(vertices) == version
+    assert vbo_is_up_to_date(vbo, sources)
+
+    @ti.kernel
+    def move():
+        for i in vertices:
+            vertices[i] += 1
+
+    move()
+    assert get_field_version(vertices) > version
+    assert not vbo_is_up_to_date(vbo, sources)
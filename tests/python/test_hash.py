@@ -0,0 +1,106 @@
+import taichi as ti
+
+
+def _place_hash(x, capacity):
+    # 2^28 cells, far more than a pointer SNode could afford.
+    block = ti.root.hash(ti.ij, (4096, 4096), capacity)
+    block.dense(ti.ij, 4).place(x)
+    return block
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_struct_for():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32, shape=())
+    _place_hash(x, 64)
+
+    coords = [(0, 0), (5, 7), (16383, 16383), (8000, 12)]
+    for i, j in coords:
+        x[i, j] = i + j
+
+    @ti.kernel
+    def count():
+        for i, j in x:
+            s[None] += 1
+
+    @ti.kernel
+    def total() -> ti.i32:
+        result = 0
+        for i, j in x:
+            result += x[i, j]
+        return result
+
+    count()
+    # Each distinct block has 16 cells.
+    assert s[None] == 16 * len(coords)
+    assert total() == sum(i + j for i, j in coords)
+    assert x[1, 1] == 0
+    assert x[5, 7] == 12
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_parallel_activate():
+    x = ti.field(ti.i32)
+    _place_hash(x, 1024)
+    n = 256
+
+    @ti.kernel
+    def activate():
+        # Many threads activate the same blocks at the same time.
+        for k in range(n * 16):
+            i = k % n * 61
+            ti.atomic_add(x[i, i], 1)
+
+    @ti.kernel
+    def count_blocks(b: ti.template()) -> ti.i32:
+        result = 0
+        for I in ti.grouped(b):
+            result += 1
+        return result
+
+    @ti.kernel
+    def is_active(b: ti.template(), i: ti.i32) -> ti.i32:
+        return ti.is_active(b, [i, i])
+
+    activate()
+    block = x.parent().parent()
+    assert count_blocks(block) == n
+    for k in range(n):
+        i = k * 61
+        assert x[i, i] == 16
+        assert is_active(block, i // 4)
+    assert not is_active(block, 4)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_deactivate():
+    x = ti.field(ti.i32)
+    block = _place_hash(x, 16)
+
+    @ti.kernel
+    def count() -> ti.i32:
+        result = 0
+        for i, j in x:
+            result += 1
+        return result
+
+    @ti.kernel
+    def deactivate():
+        # The block of x[4, 4] to x[7, 7].
+        ti.deactivate(block, [1, 1])
+
+    x[4, 4] = 1
+    x[100, 100] = 2
+    assert count() == 32
+    deactivate()
+    assert count() == 16
+    assert x[4, 4] == 0
+    assert x[100, 100] == 2
+
+    # Reactivates the deactivated cell.
+    x[5, 5] = 3
+    assert count() == 32
+    assert x[5, 5] == 3
+
+    block.deactivate_all()
+    assert count() == 0
@@ -0,0 +1,64 @@
+import math
+
+import taichi as ti
+
+
+@ti.test(hoist_uniform_values=True)
+def test_hoist_uniform_values():
+    n = 16
+    x = ti.field(ti.f32, shape=n)
+    scale = ti.field(ti.f32, shape=())
+
+    @ti.kernel
+    def fill(a: ti.f32, m: ti.i32):
+        for i in range(m):
+            # Uniform, and reads a field the loop doesn't write to.
+            s = ti.sqrt(scale[None] * a) + 1.0
+            x[i] = s * i
+
+    scale[None] = 4.0
+    fill(4.0, n)
+    for i in range(n):
+        assert x[i] == ti.approx(5.0 * i)
+    # The loop doesn't run at all.
+    fill(1.0, 0)
+    assert x[1] == ti.approx(5.0)
+
+
+@ti.test(hoist_uniform_values=True)
+def test_hoist_uniform_values_written_field():
+    n = 16
+    x = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def scan():
+        for i in range(1, n):
+            # x[0] is written by the loop, so it stays in the loop.
+            x[i] = ti.sqrt(x[0]) + i
+            x[0] = 4.0
+
+    x[0] = 4.0
+    scan()
+    for i in range(1, n):
+        assert x[i] == ti.approx(2.0 + i)
+
+
+@ti.test(hoist_uniform_values=True)
+def test_hoist_uniform_values_struct_for():
+    x = ti.field(ti.f32)
+    ti.root.pointer(ti.i, 4).dense(ti.i, 4).place(x)
+
+    @ti.kernel
+    def activate():
+        x[1] = 0.0
+        x[9] = 0.0
+
+    @ti.kernel
+    def fill(a: ti.f32):
+        for i in x:
+            x[i] = ti.exp(a) * i
+
+    activate()
+    fill(1.0)
+    assert x[1] == ti.approx(math.e)
+    assert x[9] == ti.approx(math.e * 9)
@@ -0,0 +1,68 @@
+import taichi as ti
+
+
+@ti.test(arch=[ti.cpu, ti.cuda, ti.vulkan, ti.metal], kernel_profiler=True)
+def test_query_kernel_profile_info():
+    x = ti.field(ti.f32, shape=1024)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i
+
+    @ti.kernel
+    def double():
+        for i in x:
+            x[i] *= 2
+
+    ti.clear_kernel_profile_info()
+    for _ in range(10):
+        fill()
+        double()
+    result = ti.query_kernel_profile_info(fill.__name__)
+    assert result.counter == 10
+    assert 0 <= result.min <= result.avg <= result.max
+    assert ti.query_kernel_profile_info(double.__name__).counter == 10
+
+
+@ti.test(arch=ti.cuda, kernel_profiler=True)
+def test_query_kernel_attributes():
+    x = ti.field(ti.f32, shape=1024)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i
+
+    ti.clear_kernel_profile_info()
+    fill()
+    attributes = ti.query_kernel_attributes()
+    tasks = [name for name in attributes if name.startswith(fill.__name__)]
+    assert tasks
+    for name in tasks:
+        assert attributes[name]['registers'] > 0
+        assert attributes[name]['local_mem'] >= 0
+        assert 0 < attributes[name]['occupancy'] <= 1
+
+
+@ti.test(arch=ti.cpu, kernel_profiler=True, cpu_max_num_threads=4)
+def test_query_kernel_thread_stats():
+    x = ti.field(ti.f32, shape=1024 * 64)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i
+
+    ti.clear_kernel_profile_info()
+    for _ in range(3):
+        fill()
+    stats = ti.query_kernel_thread_stats()
+    tasks = [name for name in stats if name.startswith(fill.__name__)]
+    assert tasks
+    for name in tasks:
+        assert stats[name]['launches'] == 3
+        assert 1 <= stats[name]['threads'] <= 4
+        assert 1 <= stats[name]['imbalance'] <= stats[name]['max_imbalance']
+        assert 0 <= stats[name]['wakeup_latency'] <= stats[name][
+            'max_wakeup_latency']
@@ -0,0 +1,27 @@
+import taichi as ti
+
+
+@ti.test(arch=[ti.cpu, ti.cuda, ti.metal], kernel_specialization_launches=2)
+def test_specialize_scalar_args():
+    n = 16
+    x = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def add(m: ti.i32, v: ti.f32) -> ti.i32:
+        for i in range(m):
+            x[i] += v
+        return m * 2
+
+    ti.get_kernel_stats().clear()
+    # The second identical launch onwards runs the specialized variant.
+    for _ in range(4):
+        assert add(8, 0.5) == 16
+    # Different values fall back to the generic kernel.
+    assert add(16, 1.0) == 32
+    assert add(8, 0.5) == 16
+    counters = ti.get_kernel_stats().get_counters()
+    # Compiled once, at the second launch, and reused by the later ones.
+    assert counters.get('compiled_specializations', 0) == 1
+    assert counters.get('launched_specializations', 0) == 4
+    for i in range(n):
+        assert x[i] == (3.5 if i < 8 else 1.0)
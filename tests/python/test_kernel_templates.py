@@ -126,3 +126,60 @@ def test_func_template2():
     for i in range(16):
         for j in range(16):
             assert b[i, j] == 1.0
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_kernel_field_handle():
+    n = 8
+    x = ti.field(ti.f32, shape=n)
+    y = ti.field(ti.f32, shape=n)
+    u = ti.Vector.field(2, ti.i32, shape=n)
+    v = ti.Vector.field(2, ti.i32, shape=n)
+
+    @ti.kernel
+    def scale(a: ti.field_handle(), k: ti.f32):
+        for i in a:
+            a[i] = (a[i] + i) * k
+
+    @ti.kernel
+    def add(a: ti.field_handle(), b: ti.field_handle()):
+        for i in a:
+            a[i] += b[i] + ti.Vector([i, a.n])
+
+    scale(x, 2)
+    scale(y, 3)
+    scale.bind(y, 0)(1)
+    add(u, v)
+    add(v, u)
+    add(u, u)
+    for i in range(n):
+        assert x[i] == i * 2
+        assert y[i] == i * 3 + i
+        assert u[i][0] == i * 3 and u[i][1] == 6
+        assert v[i][0] == i * 2 and v[i][1] == 4
+    # Compiled once per layout.
+    assert len(scale._primal.mapper.mapping) == 1
+    assert len(add._primal.mapper.mapping) == 1
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_kernel_field_handle_aliasing():
+    n = 8
+    x = ti.field(ti.i32, shape=n)
+    y = ti.field(ti.i32, shape=n)
+    z = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def inc(a: ti.field_handle()):
+        for i in range(n):
+            a[i] += i + 1
+            # x is not read-only: the handle may be x.
+            y[i] = x[i]
+
+    inc(z)
+    inc(x)
+    for i in range(n):
+        assert x[i] == i + 1
+        assert y[i] == i + 1
+        assert z[i] == i + 1
+    assert len(inc._primal.mapper.mapping) == 1
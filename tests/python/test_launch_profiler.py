@@ -0,0 +1,29 @@
+import taichi as ti
+
+
+@ti.test(arch=ti.cpu, launch_profiler=2)
+def test_launch_profiler():
+    x = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def add(k: ti.i32) -> ti.i32:
+        x[None] += k
+        return x[None]
+
+    for i in range(20):
+        add(i)
+    result = ti.query_launch_profile_info()
+    # The first launch, which compiles the kernel, is left out.
+    assert result['total']['count'] == 9
+    for stage in ['lookup', 'set_args', 'launch', 'return', 'total']:
+        stats = result[stage]
+        assert 0 <= stats['p50'] <= stats['p90'] <= stats['p99'] <= stats[
+            'max']
+
+    ti.clear_launch_profile_info()
+    assert ti.query_launch_profile_info()['total']['count'] == 0
+
+
+@ti.test(arch=ti.cpu)
+def test_launch_profiler_off():
+    assert ti.query_launch_profile_info() == {}
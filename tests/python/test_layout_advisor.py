@@ -0,0 +1,52 @@
+import taichi as ti
+
+
+@ti.test(arch=ti.cpu, layout_advisor=True)
+def test_layout_advisor():
+    n = 16
+    # Accessed together, but placed apart.
+    pos = ti.field(ti.f32, shape=n)
+    vel = ti.field(ti.f32, shape=n)
+    # Placed together, but accessed apart.
+    mass = ti.field(ti.f32)
+    color = ti.field(ti.f32)
+    ti.root.dense(ti.i, n).place(mass, color)
+
+    @ti.kernel
+    def advance():
+        for i in range(n):
+            pos[i] += vel[i]
+
+    @ti.kernel
+    def scale_mass():
+        for i in range(n):
+            mass[i] *= 2.0
+
+    @ti.kernel
+    def paint():
+        for i in range(n):
+            color[i] = 1.0
+
+    for _ in range(10):
+        advance()
+        scale_mass()
+    paint()
+
+    advice = ti.get_layout_advice()
+    assert len(advice) == 2
+    assert 'same SNode (AoS)' in advice[0]
+    assert 'separate SNodes (SoA)' in advice[1]
+
+
+@ti.test(arch=ti.cpu, layout_advisor=True)
+def test_layout_advisor_no_advice():
+    n = 16
+    x = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def fill():
+        for i in range(n):
+            x[i] = i
+
+    fill()
+    assert ti.get_layout_advice() == []
@@ -466,3 +466,31 @@ def test_diag():
                 assert m1[None][i, j] == approx(1.4)
             else:
                 assert m1[None][i, j] == 0.0
+
+
+@ti.test(arch=ti.cuda)
+def test_warp_mma_16x16x16():
+    if ti.core.query_int64('cuda_compute_capability') < 70:
+        return
+    n = 48
+    a = ti.field(ti.f16, shape=(n, n))
+    b = ti.field(ti.f16, shape=(n, n))
+    c = ti.field(ti.f32, shape=(n, n))
+
+    @ti.kernel
+    def matmul():
+        ti.block_dim(64)
+        for w, lane in ti.ndrange((n // 16)**2, 32):
+            i, j = w // (n // 16) * 16, w % (n // 16) * 16
+            for k in range(0, n, 16):
+                ti.warp_mma_16x16x16(c, a, b, [i, j], [i, k], [k, j])
+
+    np_a = np.random.randint(-4, 5, (n, n)).astype(np.float16)
+    np_b = np.random.randint(-4, 5, (n, n)).astype(np.float16)
+    np_c = np.random.randint(-4, 5, (n, n)).astype(np.float32)
+    a.from_numpy(np_a)
+    b.from_numpy(np_b)
+    c.from_numpy(np_c)
+    matmul()
+    expected = np_a.astype(np.float32) @ np_b.astype(np.float32) + np_c
+    assert np.array_equal(c.to_numpy(), expected)
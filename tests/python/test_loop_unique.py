@@ -156,3 +156,58 @@ def test_loop_unique_ndrange():
     for i in range(a):
         for j in range(b + 1):
             assert z[i, j] == (0 if j == 0 else 10)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], print_ir=True, cpu_max_num_threads=4)
+def test_loop_unique_affine(capfd):
+    n = 64
+    # One field per access, since the atomics of an SNode are only demoted
+    # when all of its accesses in the loop share the same pointer.
+    x = ti.field(ti.i32, shape=n * 2)
+    y = ti.field(ti.i32, shape=n * 4)
+    z = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def scatter():
+        for i in range(n):
+            x[i * 2 + 1] += 1  # Injective, demoted to a plain add.
+            y[(i << 1) + n * 2] += 2  # Same.
+            z[i // 2] += 1  # Not injective, stays atomic.
+
+    scatter()
+    out, err = capfd.readouterr()
+    ir = (out + err).split('Atomics demoted II:')[-1]
+    ir = ir.split('Remove range assumption:')[0]
+    assert ir.count('atomic add(') == 1
+
+    for i in range(n * 2):
+        assert x[i] == i % 2
+    for i in range(n * 4):
+        assert y[i] == (2 if i % 2 == 0 and n * 2 <= i else 0)
+    for i in range(n):
+        assert z[i] == (2 if i < n // 2 else 0)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], print_ir=True, cpu_max_num_threads=4)
+def test_loop_unique_scaling_without_range(capfd):
+    n = 64
+    x = ti.field(ti.i32, shape=n * 3)
+    y = ti.field(ti.i32, shape=n * 2)
+
+    @ti.kernel
+    def scatter(m: ti.i32):
+        # The bound of i is not known at compile time.
+        for i in range(m):
+            x[i * 3] += 1  # Odd, so injective even if it wraps around.
+            y[i * 2] += 1  # Could wrap around, stays atomic.
+
+    scatter(n)
+    out, err = capfd.readouterr()
+    ir = (out + err).split('Atomics demoted II:')[-1]
+    ir = ir.split('Remove range assumption:')[0]
+    assert ir.count('atomic add(') == 1
+
+    for i in range(n * 3):
+        assert x[i] == (1 if i % 3 == 0 else 0)
+    for i in range(n * 2):
+        assert y[i] == (1 if i % 2 == 0 else 0)
@@ -243,6 +243,27 @@ def test_matrix_non_constant_index():
     func4(10)
 
 
+@ti.test(require=ti.extension.dynamic_index, dynamic_index=True)
+def test_matrix_non_constant_index_matmul():
+    n = 16
+    a = ti.Matrix.field(3, 3, ti.f32, n)
+    b = ti.Matrix.field(3, 3, ti.f32, n)
+
+    @ti.kernel
+    def func(k: ti.i32):
+        for i in range(n):
+            tmp = ti.Matrix([[i, 1, 2], [3, i, 4], [5, 6, i]], ti.f32)
+            tmp[k, k] += 1.0
+            a[i] = tmp @ tmp
+            b[i] = tmp
+
+    func(1)
+    for i in range(n):
+        tmp = b[i].to_numpy()
+        assert tmp[1, 1] == i + 1
+        assert np.allclose(a[i].to_numpy(), tmp @ tmp)
+
+
 @ti.test(arch=ti.cpu)
 def test_matrix_constant_index():
     m = ti.Matrix.field(2, 2, ti.i32, 5)
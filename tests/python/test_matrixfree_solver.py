@@ -0,0 +1,64 @@
+import pytest
+
+import taichi as ti
+
+n = 64
+
+
+def make_tridiagonal(lower, diag, upper):
+    @ti.kernel
+    def matvec(x: ti.template(), Ax: ti.template()):
+        for i in x:
+            Ax[i] = diag * x[i]
+            if i > 0:
+                Ax[i] += lower * x[i - 1]
+            if i < n - 1:
+                Ax[i] += upper * x[i + 1]
+
+    return ti.linalg.LinearOperator(matvec)
+
+
+def check_residual(A, b, x):
+    Ax = ti.field(ti.f32, shape=n)
+    A.matvec(x, Ax)
+    for i in range(n):
+        assert Ax[i] == ti.approx(b[i], abs=1e-3)
+
+
+@pytest.mark.parametrize("preconditioned", [False, True])
+@ti.test()
+def test_matrixfree_cg(preconditioned):
+    A = make_tridiagonal(-1.0, 2.5, -1.0)
+    b = ti.field(ti.f32, shape=n)
+    x = ti.field(ti.f32, shape=n)
+    diag = ti.field(ti.f32, shape=n)
+    for i in range(n):
+        b[i] = i % 5 - 2
+        diag[i] = 2.5
+
+    M = ti.linalg.JacobiPreconditioner(diag) if preconditioned else None
+    solver = ti.linalg.CG(A, tol=1e-6, M=M)
+    assert solver.solve(b, x)
+    assert 0 < solver.num_iterations <= n
+    check_residual(A, b, x)
+
+    # A second solve reuses the work vectors and converges immediately.
+    assert solver.solve(b, x)
+    assert solver.num_iterations <= 1
+
+
+@pytest.mark.parametrize("preconditioned", [False, True])
+@ti.test()
+def test_matrixfree_bicgstab(preconditioned):
+    A = make_tridiagonal(-1.0, 3.0, -0.5)
+    b = ti.field(ti.f32, shape=n)
+    x = ti.field(ti.f32, shape=n)
+    diag = ti.field(ti.f32, shape=n)
+    for i in range(n):
+        b[i] = i % 3 + 1
+        diag[i] = 3.0
+
+    M = ti.linalg.JacobiPreconditioner(diag) if preconditioned else None
+    solver = ti.linalg.BiCGSTAB(A, tol=1e-6, M=M)
+    assert solver.solve(b, x)
+    check_residual(A, b, x)
@@ -1,3 +1,5 @@
+import tempfile
+
 import taichi as ti
 
 
@@ -7,3 +9,39 @@ def test_memory_allocate():
     x = ti.field(ti.i32, shape=(HUGE_SIZE, ))
     for i in range(10):
         x[i] = i
+
+
+@ti.test(arch=ti.cpu, cpu_snode_tree_file_dir=tempfile.gettempdir())
+def test_file_backed_snode_trees():
+    x = ti.field(ti.i32, shape=1024**2)
+    y = ti.field(ti.i32)
+    ti.root.pointer(ti.i, 16).dense(ti.i, 16).place(y)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i
+        for i in range(100):
+            y[i] = i * 2
+
+    fill()
+    ti.write_back_snode_trees()
+    assert x[12345] == 12345
+    assert y[99] == 198
+    assert y.to_numpy()[100] == 0
+
+
+@ti.test(arch=ti.cpu, cpu_huge_pages=True)
+def test_huge_page_coverage():
+    x = ti.field(ti.i32, shape=1024**2)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i
+
+    fill()
+    assert x[12345] == 12345
+    coverage = ti.query_huge_page_coverage()
+    assert coverage['total_bytes'] >= 1024**2 * 4
+    assert 0 <= coverage['huge_page_bytes'] <= coverage['total_bytes']
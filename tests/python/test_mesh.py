@@ -1,4 +1,5 @@
 import os
+import tempfile
 
 import numpy as np
 
@@ -224,3 +225,140 @@ def test_mesh_local():
         assert res1[i] == res2[i]
         assert res1[i] == res3[i]
         assert res1[i] == res4[i]
+
+
+def _tet_grid(n):
+    # Each cube of an n^3 grid is split into 6 tetrahedra.
+    def vert(i, j, k):
+        return (i * (n + 1) + j) * (n + 1) + k
+
+    cells = []
+    axes = ((1, 0, 0), (0, 1, 0), (0, 0, 1))
+    for i in range(n):
+        for j in range(n):
+            for k in range(n):
+                for a, b in ((0, 1), (0, 2), (1, 0), (1, 2), (2, 0), (2, 1)):
+                    p = (i, j, k)
+                    q = tuple(x + y for x, y in zip(p, axes[a]))
+                    r = tuple(x + y for x, y in zip(q, axes[b]))
+                    cells.append([
+                        vert(*p),
+                        vert(*q),
+                        vert(*r),
+                        vert(i + 1, j + 1, k + 1)
+                    ])
+    x = np.array([[i, j, k] for i in range(n + 1) for j in range(n + 1)
+                  for k in range(n + 1)],
+                 dtype=np.float32)
+    return np.array(cells, dtype=np.int32), x
+
+
+@ti.test(require=ti.extension.mesh)
+def test_mesh_generate_meta():
+    cells, x = _tet_grid(3)
+    with tempfile.TemporaryDirectory() as tmp:
+        cache_file = os.path.join(tmp, 'grid.tcb')
+        meta = ti.Mesh.generate_meta(ti.MeshTopology.Tetrahedron,
+                                     cells,
+                                     x,
+                                     max_elements_per_patch=16,
+                                     cache_file=cache_file)
+        assert os.path.exists(cache_file)
+        cached = ti.Mesh.load_meta(cache_file)
+    assert meta.num_patches == cached.num_patches
+    np.testing.assert_array_equal(meta.attrs['x'], cached.attrs['x'])
+    # Small patches store their relations with 16-bit local indices.
+    for fields in cached.relation_fields.values():
+        assert fields['value'].dtype == ti.u16
+
+    mesh_builder = ti.Mesh.Tet()
+    mesh_builder.verts.place({'n': ti.i32})
+    mesh_builder.cells.place({'s': ti.i32})
+    mesh_builder.cells.link(mesh_builder.verts)
+    mesh_builder.verts.link(mesh_builder.cells)
+    model = mesh_builder.build(cached)
+    assert len(model.cells) == len(cells)
+    edges = {
+        tuple(sorted((c[a], c[b])))
+        for c in cells.tolist() for a in range(4) for b in range(a + 1, 4)
+    }
+    assert len(model.edges) == len(edges)
+
+    @ti.kernel
+    def foo():
+        for c in model.cells:
+            for i in range(c.verts.size):
+                c.s += c.verts[i].id
+        for v in model.verts:
+            v.n = v.cells.size
+
+    foo()
+    np.testing.assert_array_equal(model.cells.s.to_numpy(), cells.sum(axis=1))
+    np.testing.assert_array_equal(model.verts.n.to_numpy(),
+                                  np.bincount(cells.reshape(-1)))
+
+
+@ti.test(require=ti.extension.mesh)
+def test_mesh_generate_meta_sfc_order():
+    cells, x = _tet_grid(4)
+    # Shuffled, so that the input order carries no locality.
+    perm = np.random.permutation(len(cells))
+    cells = cells[perm]
+    meta = ti.Mesh.generate_meta(ti.MeshTopology.Tetrahedron,
+                                 cells,
+                                 x,
+                                 max_elements_per_patch=32,
+                                 sfc_order=True)
+
+    mesh_builder = ti.Mesh.Tet()
+    mesh_builder.cells.place({'s': ti.i32}, reorder=True)
+    mesh_builder.cells.link(mesh_builder.verts)
+    model = mesh_builder.build(meta)
+
+    @ti.kernel
+    def foo():
+        for c in model.cells:
+            for i in range(c.verts.size):
+                c.s += c.verts[i].id
+
+    foo()
+    np.testing.assert_array_equal(model.cells.s.to_numpy(), cells.sum(axis=1))
+    # The owned cells of each patch follow the Morton curve through their
+    # centroids, on a grid of 2^10 cells per axis over the bounding box.
+    grid = np.minimum(x[cells].mean(axis=1) / 4 * 1024, 1023).astype(int)
+    codes = np.zeros(len(cells), dtype=np.int64)
+    for b in range(10):
+        for d in range(3):
+            codes |= ((grid[:, d] >> b) & 1) << (b * 3 + 2 - d)
+    element = meta.element_fields[ti.lang.mesh.MeshElementType.Cell]
+    owned = element['owned'].to_numpy()
+    total = element['total'].to_numpy()
+    l2g = element['l2g'].to_numpy()
+    for p in range(meta.num_patches):
+        owned_cells = l2g[total[p]:total[p] + owned[p + 1] - owned[p]]
+        assert np.all(np.diff(codes[owned_cells]) >= 0)
+
+
+@ti.test(arch=ti.cpu, cpu_mesh_bls_max_size_bytes=256)
+def test_mesh_local_cpu_bls_budget():
+    # The mappings and attributes exceeding the budget are read from the
+    # fields.
+    mesh_builder = ti.Mesh.Tet()
+    mesh_builder.verts.place({'a': ti.i32, 'b': ti.i32})
+    mesh_builder.faces.link(mesh_builder.verts)
+    model = mesh_builder.build(ti.Mesh.load_meta(model_file_path))
+    ext_a = ti.field(ti.i32, shape=len(model.verts))
+
+    @ti.kernel
+    def foo():
+        ti.mesh_local(model.verts.a, model.verts.b)
+        for f in model.faces:
+            m = f.verts[0].id + f.verts[1].id + f.verts[2].id
+            for i in ti.static(range(3)):
+                f.verts[i].a += m
+                f.verts[i].b += 1
+                ext_a[f.verts[i].id] += m
+
+    foo()
+    np.testing.assert_array_equal(model.verts.a.to_numpy(), ext_a.to_numpy())
+    assert model.verts.b.to_numpy().sum() == 3 * len(model.faces)
@@ -0,0 +1,22 @@
+import taichi as ti
+
+
+@ti.test()
+def test_metrics():
+    x = ti.field(ti.i32, shape=4)
+
+    @ti.kernel
+    def inc():
+        for i in x:
+            x[i] += 1
+
+    inc()
+    ti.reset_metrics()
+    for _ in range(3):
+        inc()
+    metrics = ti.get_metrics()
+    assert metrics['taichi_kernel_launches'] == 3
+    exposition = ti.export_metrics()
+    assert '# TYPE taichi_kernel_launches counter' in exposition
+    assert 'taichi_kernel_launches_total 3' in exposition
+    assert exposition.endswith('# EOF\n')
@@ -692,3 +692,120 @@ def test_different_shape():
     y = ti.ndarray(dtype=ti.f32, shape=(n2, n2))
     init(3, y)
     assert (y.to_numpy() == (np.ones(shape=(n2, n2)) * 3)).all()
+
+
+@ti.test(arch=ti.cuda, ndarray_use_torch=False)
+def test_ndarray_caching_allocator_reuse():
+    a = ti.ndarray(dtype=ti.f32, shape=(1024, 1024))
+    stats = ti.get_caching_allocator_stats()
+    assert stats['allocated_bytes'] >= 1024 * 1024 * 4
+    del a
+    import gc
+    gc.collect()
+    old_misses = ti.get_caching_allocator_stats()['num_cache_misses']
+    for _ in range(10):
+        b = ti.ndarray(dtype=ti.f32, shape=(512, 1024))
+        del b
+        gc.collect()
+    stats = ti.get_caching_allocator_stats()
+    assert stats['num_cache_misses'] == old_misses
+    assert stats['num_cache_hits'] >= 10
+    assert stats['allocated_bytes'] == 0
+    assert stats['fragmentation'] == 0
+
+
+@pytest.mark.skipif(not ti.has_pytorch(), reason='Pytorch not installed.')
+@ti.test(arch=[ti.cpu, ti.cuda], ndarray_use_torch=False)
+def test_ndarray_from_dlpack_zero_copy():
+    import torch
+    device = 'cuda' if ti.cfg.arch == ti.cuda else 'cpu'
+    t = torch.zeros((4, 8), dtype=torch.int32, device=device)
+    x = ti.from_dlpack(t)
+
+    @ti.kernel
+    def fill(d: ti.i32, arr: ti.any_arr()):
+        for i, j in arr:
+            arr[i, j] = d + i * 8 + j
+
+    for d in range(3):
+        fill(d, x)
+        expected = np.arange(32).reshape(4, 8) + d
+        assert (t.cpu().numpy() == expected).all()
+
+
+@pytest.mark.skipif(not ti.has_pytorch(), reason='Pytorch not installed.')
+@ti.test(arch=[ti.cpu, ti.cuda], ndarray_use_torch=False)
+def test_ndarray_to_dlpack_zero_copy():
+    import torch
+    x = ti.ndarray(ti.f32, shape=(3, 5))
+
+    @ti.kernel
+    def fill(arr: ti.any_arr()):
+        for i, j in arr:
+            arr[i, j] = i * 5 + j
+
+    fill(x)
+    t = torch.utils.dlpack.from_dlpack(x.__dlpack__())
+    assert tuple(t.shape) == (3, 5)
+    assert (t.cpu().numpy() == np.arange(15).reshape(3, 5)).all()
+    t.zero_()
+    assert (x.to_numpy() == 0).all()
+    # A round trip is another view of the same memory.
+    y = ti.from_dlpack(x)
+    fill(y)
+    assert (x.to_numpy() == np.arange(15).reshape(3, 5)).all()
+
+
+@ti.test(arch=[ti.cuda], ndarray_use_torch=False, cpu_gpu_co_execution=True)
+def test_ndarray_cpu_gpu_co_execution():
+    n = 1 << 20
+    x = ti.ndarray(ti.i32, shape=n)
+
+    @ti.kernel
+    def fill(d: ti.i32, arr: ti.any_arr()):
+        for i in range(arr.shape[0]):
+            arr[i] = i % 1000 + d
+
+    # The split between the GPU and the CPU changes across the launches.
+    for d in range(8):
+        fill(d, x)
+        assert (x.to_numpy() == np.arange(n) % 1000 + d).all()
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], ndarray_use_torch=False)
+def test_ndarray_strided_view():
+    x = ti.ndarray(ti.i32, shape=(6, 8))
+
+    @ti.kernel
+    def fill(arr: ti.any_arr(), d: ti.i32):
+        for i, j in arr:
+            arr[i, j] = i * 10 + j + d
+
+    x.fill(0)
+    fill(x[1:5, ::3], 100)
+    expected = np.zeros((6, 8), dtype=np.int32)
+    for i in range(4):
+        for j in range(3):
+            expected[1 + i, 3 * j] = i * 10 + j + 100
+    assert (x.to_numpy() == expected).all()
+    assert x[1:5, ::3][2, 1] == 121
+    assert x[::2, 3].shape == (3, )
+    assert (x[::2, 3].to_numpy() == expected[::2, 3]).all()
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], ndarray_use_torch=False)
+def test_vector_ndarray_strided_view():
+    x = ti.Vector.ndarray(2, ti.f32, shape=(4, 4))
+
+    @ti.kernel
+    def fill(arr: ti.any_arr(element_dim=1)):
+        for i, j in arr:
+            arr[i, j] = ti.Vector([i, j])
+
+    x.fill(-1)
+    fill(x[2:, 1::2])
+    expected = np.full((4, 4, 2), -1, dtype=np.float32)
+    for i in range(2):
+        for j in range(2):
+            expected[2 + i, 1 + 2 * j] = [i, j]
+    assert (x.to_numpy() == expected).all()
@@ -218,3 +218,35 @@ def test_numpy_struct_for():
     func2(n)
     for i, j, k in ti.ndrange(98, 76, 54):
         assert n[i, j, k] == i + j + k
+
+
+@ti.test(arch=ti.cpu)
+def test_numpy_same_array_twice():
+    # The external arrays may alias each other.
+    @ti.kernel
+    def shift(a: ti.ext_arr(), b: ti.ext_arr()):
+        for _ in range(1):
+            for i in range(1, 16):
+                b[i] = a[i - 1] + 1
+
+    arr = np.zeros(16, dtype=np.int32)
+    shift(arr, arr)
+    for i in range(16):
+        assert arr[i] == i
+
+
+@ti.test()
+def test_numpy_gather_read_only():
+    x = ti.field(ti.f32, shape=16)
+
+    # |a| and |idx| are read through the read-only cache on CUDA.
+    @ti.kernel
+    def gather(a: ti.ext_arr(), idx: ti.ext_arr()):
+        for i in x:
+            x[i] = a[idx[i]] * 2
+
+    a = np.arange(16, dtype=np.float32)
+    idx = np.arange(16, dtype=np.int32)[::-1].copy()
+    gather(a, idx)
+    for i in range(16):
+        assert x[i] == (15 - i) * 2
@@ -159,3 +159,15 @@ def test_numpy_io_example():
     assert arr.shape == (n, m, 3, 4)
 
     # For PyTorch tensors, use to_torch/from_torch instead
+
+
+@ti.test()
+def test_numpy_io_large():
+    # Several chunks of the staged host<->device copies on CUDA, the last of
+    # which is partial.
+    n = (9 << 20) // 4 + 123
+    x = ti.field(ti.i32, shape=n)
+    arr = np.arange(n, dtype=np.int32)
+    x.from_numpy(arr)
+    assert x[n - 1] == n - 1
+    np.testing.assert_array_equal(x.to_numpy(), arr)
@@ -0,0 +1,199 @@
+import importlib
+import os
+import sys
+import tempfile
+
+import taichi as ti
+
+
+def _run_kernel():
+    x = ti.field(ti.i32, shape=16)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i * 2
+
+    fill()
+    for i in range(16):
+        assert x[i] == i * 2
+
+
+def _list_entries(path):
+    entries = []
+    for root, _, files in os.walk(path):
+        entries += [f for f in files if f.endswith('.tic')]
+    return entries
+
+
+@ti.test(arch=[ti.cpu, ti.cuda, ti.vulkan])
+def test_offline_cache():
+    arch = ti.cfg.arch
+    with tempfile.TemporaryDirectory() as tmpdir:
+        ti.init(arch=arch, offline_cache=True, offline_cache_file_path=tmpdir)
+        _run_kernel()
+        entries = _list_entries(tmpdir)
+        assert len(entries) > 0
+
+        # The second run should be served from the cache without adding new
+        # entries, and still produce correct results.
+        ti.init(arch=arch, offline_cache=True, offline_cache_file_path=tmpdir)
+        _run_kernel()
+        assert sorted(_list_entries(tmpdir)) == sorted(entries)
+        ti.reset()
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_offline_cache_shared():
+    arch = ti.cfg.arch
+    with tempfile.TemporaryDirectory() as tmpdir:
+        ti.init(arch=arch,
+                offline_cache=True,
+                offline_cache_file_path=tmpdir,
+                offline_cache_shared=True)
+        _run_kernel()
+        entries = _list_entries(tmpdir)
+        assert len(entries) > 0
+        # The locks are released once the entries are stored.
+        assert not any(f.endswith('.lock')
+                       for _, _, files in os.walk(tmpdir) for f in files)
+
+        ti.init(arch=arch,
+                offline_cache=True,
+                offline_cache_file_path=tmpdir,
+                offline_cache_shared=True)
+        _run_kernel()
+        assert sorted(_list_entries(tmpdir)) == sorted(entries)
+        ti.reset()
+
+
+@ti.test(arch=ti.vulkan)
+def test_offline_cache_vulkan_pipeline_cache():
+    with tempfile.TemporaryDirectory() as tmpdir:
+        ti.init(arch=ti.vulkan,
+                offline_cache=True,
+                offline_cache_file_path=tmpdir)
+        _run_kernel()
+        # The pipeline cache is saved when the program is destroyed.
+        ti.reset()
+        assert any('pipeline_cache.bin' in files
+                   for _, _, files in os.walk(tmpdir))
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_offline_cache_eviction():
+    arch = ti.cfg.arch
+    with tempfile.TemporaryDirectory() as tmpdir:
+        # Entries get evicted to stay within the budget, but kernels must keep
+        # working.
+        ti.init(arch=arch,
+                offline_cache=True,
+                offline_cache_file_path=tmpdir,
+                offline_cache_max_size_MB=1)
+        _run_kernel()
+        total = sum(
+            os.path.getsize(os.path.join(root, f))
+            for root, _, files in os.walk(tmpdir) for f in files
+            if f.endswith('.tic'))
+        assert total <= 1024 * 1024
+        ti.reset()
+
+
+@ti.test(arch=ti.cuda)
+def test_offline_cache_cubin():
+    def has_cubin(path):
+        for root, _, files in os.walk(path):
+            for f in files:
+                with open(os.path.join(root, f), 'rb') as entry:
+                    if f.endswith('.tic') and b'\x7fELF' in entry.read():
+                        return True
+        return False
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        ti.init(arch=ti.cuda,
+                offline_cache=True,
+                offline_cache_file_path=tmpdir)
+        _run_kernel()
+        # The PTX is compiled to a cubin once, which is loaded afterwards.
+        assert has_cubin(tmpdir)
+        entries = _list_entries(tmpdir)
+        ti.init(arch=ti.cuda,
+                offline_cache=True,
+                offline_cache_file_path=tmpdir)
+        _run_kernel()
+        assert sorted(_list_entries(tmpdir)) == sorted(entries)
+        ti.reset()
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_offline_cache_frontend():
+    arch = ti.cfg.arch
+    with tempfile.TemporaryDirectory() as tmpdir:
+        frontend_dir = os.path.join(tmpdir, 'frontend')
+        ti.init(arch=arch, offline_cache=True, offline_cache_file_path=tmpdir)
+        _run_kernel()
+        entries = os.listdir(frontend_dir)
+        assert len(entries) == 1
+
+        # The kernel is restored from its lowered IR.
+        ti.init(arch=arch, offline_cache=True, offline_cache_file_path=tmpdir)
+        _run_kernel()
+        assert os.listdir(frontend_dir) == entries
+        ti.reset()
+
+
+_FUNCS_SOURCE = '''
+import taichi as ti
+
+
+@ti.func
+def f():
+    return 1
+
+
+@ti.func
+def g():
+    return {}
+'''
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_offline_cache_frontend_func_edit():
+    arch = ti.cfg.arch
+    with tempfile.TemporaryDirectory() as tmpdir:
+        module_path = os.path.join(tmpdir, 'ti_cache_test_funcs.py')
+        with open(module_path, 'w') as f:
+            f.write(_FUNCS_SOURCE.format(2))
+        sys.path.insert(0, tmpdir)
+        try:
+            funcs = importlib.import_module('ti_cache_test_funcs')
+
+            @ti.kernel
+            def call_f() -> ti.i32:
+                return funcs.f()
+
+            @ti.kernel
+            def call_g() -> ti.i32:
+                return funcs.g()
+
+            frontend_dir = os.path.join(tmpdir, 'cache', 'frontend')
+            ti.init(arch=arch,
+                    offline_cache=True,
+                    offline_cache_file_path=os.path.join(tmpdir, 'cache'))
+            assert call_f() == 1 and call_g() == 2
+            entries = set(os.listdir(frontend_dir))
+            assert len(entries) == 2
+
+            # Only the kernel calling the edited function is lowered again.
+            with open(module_path, 'w') as f:
+                f.write(_FUNCS_SOURCE.format(20))
+            importlib.reload(funcs)
+            ti.init(arch=arch,
+                    offline_cache=True,
+                    offline_cache_file_path=os.path.join(tmpdir, 'cache'))
+            assert call_f() == 1 and call_g() == 20
+            assert len(set(os.listdir(frontend_dir)) - entries) == 1
+        finally:
+            sys.path.remove(tmpdir)
+            sys.modules.pop('ti_cache_test_funcs', None)
+        ti.reset()
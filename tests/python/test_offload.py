@@ -81,3 +81,77 @@ def test_reduce_merged():
         assert b.grad[i] == 1
     for i in range(16):
         assert a.grad[i] == 1
+
+
+@ti.test(num_compile_threads=4)
+def test_parallel_compilation():
+    n = 8
+    x = ti.field(ti.i32, shape=(n, n))
+    s = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def many_offloads():
+        for i in range(n):
+            x[i, 0] = i
+        for i in range(n):
+            x[i, 1] = x[i, 0] * 2
+        s[None] = 1  # serial task in between
+        for i, j in ti.ndrange(n, (2, n)):
+            x[i, j] = x[i, 1] + j
+        for i in range(n):
+            s[None] += x[i, n - 1]
+
+    many_offloads()
+    assert s[None] == 1 + sum(i * 2 + n - 1 for i in range(n))
+    for i in range(n):
+        assert x[i, 0] == i
+        assert x[i, 1] == i * 2
+
+
+@ti.test(num_compile_threads=4)
+def test_parallel_passes():
+    n = 64
+    x = ti.field(ti.f32)
+    ti.root.pointer(ti.i, 8).dense(ti.i, n // 8).place(x)
+    total = ti.field(ti.f32, shape=())
+    count = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def reduce():
+        for i in range(0, n, 2):
+            x[i] = i
+        for i in x:
+            total[None] += x[i]  # thread-local storage
+        for i in x:
+            count[None] += 1
+        for i in range(n):
+            x[i] = x[i] * 2
+
+    reduce()
+    assert total[None] == sum(range(0, n, 2))
+    assert count[None] == n
+    assert x[2] == 4
+
+
+@ti.test(arch=ti.cuda, cuda_pack_small_tasks=True)
+def test_packed_small_tasks():
+    n = 256
+    a = ti.field(ti.i32, shape=n)
+    b = ti.field(ti.i32, shape=n)
+    s = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def chain():
+        # Each task reads what the previous one wrote.
+        for i in range(n):
+            a[i] = i
+        for i in range(n):
+            b[i] = a[n - 1 - i] * 2
+        s[None] = b[0]
+        for i in range(n):
+            a[i] = b[i] + s[None]
+
+    for _ in range(3):
+        chain()
+    for i in range(n):
+        assert a[i] == 2 * (n - 1 - i) + 2 * (n - 1)
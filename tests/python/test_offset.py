@@ -51,6 +51,29 @@ def test_struct_for_negative():
             assert a[i, j] == i + j * 10
 
 
+@ti.test()
+def test_offset_host_access():
+    a = ti.field(dtype=ti.i32, shape=32, offset=-16)
+
+    @ti.kernel
+    def fill():
+        for i in a:
+            a[i] = i * 10
+
+    @ti.kernel
+    def read(i: ti.i32) -> ti.i32:
+        return a[i]
+
+    fill()
+    for i in range(-16, 16):
+        assert a[i] == i * 10
+
+    for i in range(-16, 16):
+        a[i] = i + 100
+    for i in range(-16, 16):
+        assert read(i) == i + 100
+
+
 @ti.test()
 def test_offset_for_var():
     a = ti.field(dtype=ti.i32, shape=16, offset=-48)
@@ -0,0 +1,43 @@
+import taichi as ti
+
+
+def run_kernel():
+    x = ti.field(ti.i32, shape=8)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i * 2
+
+    fill()
+    for i in range(8):
+        assert x[i] == i * 2
+
+
+@ti.test(arch=ti.cpu, profile_passes=True)
+def test_pass_profiler():
+    ti.clear_pass_profile_info()
+    run_kernel()
+    info = ti.query_pass_profile_info()
+    passes = info['passes']
+    for name in ['Typechecked', 'Offloaded', 'Simplified I']:
+        assert passes[name]['count'] > 0
+        assert passes[name]['stmts_after'] > 0
+    assert all(rec['total_time'] >= 0 for rec in passes.values())
+    backend = [
+        rec for name, rec in info['stages'].items()
+        if name.startswith('backend (')
+    ]
+    assert backend and all(rec['count'] > 0 for rec in backend)
+
+    ti.clear_pass_profile_info()
+    info = ti.query_pass_profile_info()
+    assert not info['passes'] and not info['stages']
+
+
+@ti.test(arch=ti.cpu, profile_passes=False)
+def test_pass_profiler_disabled():
+    ti.clear_pass_profile_info()
+    run_kernel()
+    info = ti.query_pass_profile_info()
+    assert not info['passes'] and not info['stages']
@@ -155,3 +155,22 @@ def test_print_fstring():
 
     func(123, 4.56)
     ti.sync()
+
+
+@ti.test(arch=ti.cuda, cuda_print_buffer_MB=1)
+def test_print_buffer(capfd):
+    n = 1000
+
+    @ti.kernel
+    def func(x: ti.f32):
+        for i in range(n):
+            print('value', i, x, ti.cast(i, ti.i64) * 1000000000, i % 2 == 0)
+
+    func(0.5)
+    ti.sync()
+    out, _ = capfd.readouterr()
+    lines = sorted(line for line in out.splitlines()
+                   if line.startswith('value'))
+    expected = sorted(f'value {i} 0.500000 {i * 1000000000} {int(i % 2 == 0)}'
+                      for i in range(n))
+    assert lines == expected
@@ -171,3 +171,75 @@ def test_randn():
         moments = [0.0, 1.0, 0.0, 3.0]
         for i in range(4):
             assert (X**(i + 1)).mean() == approx(moments[i], abs=3e-2)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], counter_based_rand=True)
+def test_counter_based_random_dist():
+    n = 1024
+    x = ti.field(ti.f32, shape=(n, n))
+
+    @ti.kernel
+    def fill():
+        for i, j in x:
+            x[i, j] = ti.random() * ti.random()
+
+    fill()
+    X = x.to_numpy()
+    assert X.mean() == approx(1 / 4, rel=1e-2)
+    assert (X**2).mean() == approx(1 / 9, rel=1e-2)
+
+
+@ti.test(arch=ti.cpu)
+def test_counter_based_random_reproducible():
+    import numpy as np
+    n = 4096
+    result = []
+    for num_threads in [1, 4]:
+        ti.init(arch=ti.cpu,
+                counter_based_rand=True,
+                cpu_max_num_threads=num_threads)
+        x = ti.field(ti.f32, shape=n)
+        y = ti.field(ti.i32, shape=(64, 64))
+
+        @ti.kernel
+        def gen():
+            for i in range(n):
+                x[i] = ti.random()
+            for i, j in y:
+                for _ in range(3):
+                    y[i, j] += ti.random(ti.i32) % 100
+
+        gen()
+        gen()
+        result.append((x.to_numpy(), y.to_numpy()))
+        ti.reset()
+
+    assert np.array_equal(result[0][0], result[1][0])
+    assert np.array_equal(result[0][1], result[1][1])
+    assert len(np.unique(result[0][0])) > n * 0.99
+
+
+@ti.test(exclude=ti.metal)
+def test_fill_random():
+    x = ti.field(ti.f32, shape=(1000, 999))
+    x.fill_random()
+    X = x.to_numpy()
+    assert X.min() >= 0 and X.max() < 1
+    for i in range(1, 4):
+        assert (X**i).mean() == approx(1 / (i + 1), rel=1e-2)
+
+    x.fill_random('normal')
+    X = x.to_numpy()
+    moments = [0.0, 1.0, 0.0, 3.0]
+    for i in range(4):
+        assert (X**(i + 1)).mean() == approx(moments[i], abs=3e-2)
+
+
+@ti.test(exclude=ti.metal)
+def test_fill_random_matrix():
+    import numpy as np
+    v = ti.Vector.field(3, ti.f32, shape=100000)
+    v.fill_random('normal')
+    V = v.to_numpy()
+    assert np.abs(V.mean(axis=0)).max() < 3e-2
+    assert np.abs(np.cov(V.T) - np.eye(3)).max() < 3e-2
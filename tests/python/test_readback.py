@@ -0,0 +1,68 @@
+import numpy as np
+
+import taichi as ti
+
+
+@ti.test()
+def test_to_numpy_async():
+    n = 1000
+    x = ti.field(ti.f32, shape=(n, 3))
+
+    @ti.kernel
+    def fill(k: ti.f32):
+        for i, j in x:
+            x[i, j] = i * 3 + j + k
+
+    fill(0)
+    readback = x.to_numpy_async()
+    # Kernels launched afterwards do not change the result.
+    fill(1)
+    expected = np.arange(n * 3, dtype=np.float32).reshape(n, 3)
+    np.testing.assert_array_equal(readback.result(), expected)
+    assert readback.done()
+    np.testing.assert_array_equal(readback.result(), expected)
+    np.testing.assert_array_equal(x.to_numpy(), expected + 1)
+
+
+@ti.test()
+def test_to_numpy_async_dtype():
+    x = ti.field(ti.i32, shape=16)
+    for i in range(16):
+        x[i] = i * 2
+    arr = x.to_numpy_async(dtype=np.float64).result()
+    assert arr.dtype == np.float64
+    np.testing.assert_array_equal(arr, np.arange(16) * 2)
+
+
+@ti.test()
+def test_matrix_to_numpy_async():
+    v = ti.Vector.field(3, ti.i32, shape=8)
+    m = ti.Matrix.field(2, 2, ti.f32, shape=(4, 5))
+
+    @ti.kernel
+    def fill():
+        for i in v:
+            v[i] = [i, i * 2, i * 3]
+        for i, j in m:
+            m[i, j] = [[i, j], [i + j, i - j]]
+
+    fill()
+    readbacks = [
+        v.to_numpy_async(),
+        v.to_numpy_async(keep_dims=True),
+        m.to_numpy_async()
+    ]
+    expected = [v.to_numpy(), v.to_numpy(keep_dims=True), m.to_numpy()]
+    for readback, arr in zip(readbacks, expected):
+        result = readback.result()
+        assert result.shape == arr.shape
+        np.testing.assert_array_equal(result, arr)
+
+
+@ti.test()
+def test_to_numpy_async_dropped():
+    x = ti.field(ti.f32, shape=1 << 16)
+    for _ in range(4):
+        x.to_numpy_async()
+    x[0] = 1
+    assert x.to_numpy_async().result()[0] == 1
@@ -143,3 +143,67 @@ def test_reduction_any_arr():
     n = 1024
     x = np.ones(n, dtype=np.int32)
     assert reduce(x) == -n
+
+
+@ti.test()
+def test_reduction_grid_stride():
+    # More iterations than threads, so that each thread accumulates several
+    # of them in its thread-local storage.
+    a = ti.field(ti.i32, shape=1024 * 1024)
+    tot = ti.field(ti.i32, shape=())
+    largest = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def fill():
+        for i in a:
+            a[i] = i % 7
+
+    @ti.kernel
+    def reduce(n: ti.i32):
+        for i in range(n):
+            tot[None] += a[i]
+            ti.atomic_max(largest[None], a[i] * 3 - i % 5)
+
+    fill()
+    for n in [1, 1000, 1024 * 1024]:
+        tot[None] = 0
+        largest[None] = -100
+        reduce(n)
+        expected = np.arange(n) % 7
+        assert tot[None] == expected.sum()
+        assert largest[None] == (expected * 3 - np.arange(n) % 5).max()
+
+
+@pytest.mark.parametrize('dtype', [ti.f32, ti.f64])
+@ti.test(arch=[ti.cpu, ti.cuda],
+         require=ti.extension.data64,
+         deterministic_reduction=True)
+def test_deterministic_reduction(dtype):
+    a = ti.field(dtype, shape=1024 * 1024)
+    tot = ti.field(dtype, shape=())
+
+    @ti.kernel
+    def reduce(n: ti.i32):
+        for i in range(n):
+            tot[None] += a[i]
+
+    @ti.kernel
+    def reduce_ret() -> dtype:
+        s = ti.cast(0, dtype)
+        for i in a:
+            s += a[i]
+        return s
+
+    values = np.random.rand(1024 * 1024) * 1e4
+    a.from_numpy(values)
+    for n in [1, 1000, 1024 * 1024]:
+        results = []
+        for _ in range(4):
+            tot[None] = 0
+            reduce(n)
+            results.append(tot[None])
+        # Bitwise reproducible
+        assert len(set(results)) == 1
+        assert results[0] == approx(values[:n].sum(), rel=1e-4)
+    results = set(reduce_ret() for _ in range(4))
+    assert len(results) == 1
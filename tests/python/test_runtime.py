@@ -160,3 +160,21 @@ def test_supported_log_levels(level):
     spec_cfg = ti.init(_test_mode=True)
     ti.set_logging_level(level)
     assert ti.is_logging_effective(level)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_soft_reset():
+    arch = ti.cfg.arch
+
+    @ti.kernel
+    def accumulate(x: ti.template(), v: ti.i32):
+        for i in x:
+            x[i] += v
+
+    # The second program reuses the JITted kernels of the first one, on
+    # fields starting from zero again.
+    for n in [4, 4, 6]:
+        ti.init(arch=arch, soft_reset=True)
+        x = ti.field(ti.i32, n)
+        accumulate(x, n)
+        assert x.to_numpy().tolist() == [n] * n
@@ -122,3 +122,61 @@ def test_global_tmp_value_state():
     x.from_numpy(np.arange(0, n, dtype=np.float32))
     mean = compute_mean_of_boundary_edges()
     assert ti.approx(mean) == 33
+
+
+@ti.test(require=ti.extension.async_mode, async_mode=True)
+def test_sfg_discard():
+    n = 32
+
+    x = ti.field(dtype=float, shape=n)
+    tmp = ti.field(dtype=float, shape=n)
+    y = ti.field(dtype=float, shape=n)
+
+    @ti.kernel
+    def compute():
+        for i in x:
+            tmp[i] = x[i] * 2
+            y[i] = x[i] + 1
+
+    x.from_numpy(np.arange(n, dtype=np.float32))
+    ti.sync()
+
+    stats = ti.get_kernel_stats()
+    stats.clear()
+
+    compute()
+    ti.discard(tmp)
+    ti.sync()
+    counters = stats.get_counters()
+
+    # The stores to tmp should be DSE'ed
+    assert counters['sfg_dse_tasks'] > 0
+    assert np.allclose(y.to_numpy(), np.arange(n) + 1)
+
+
+@ti.test(require=[ti.extension.async_mode, ti.extension.sparse],
+         async_mode=True)
+def test_discard_deactivates():
+    n = 16
+    x = ti.field(ti.i32)
+    y = ti.field(ti.i32)
+    ti.root.pointer(ti.i, n).place(x)
+    ti.root.pointer(ti.i, n).place(y)
+
+    @ti.kernel
+    def fill():
+        for i in range(n):
+            x[i] = i
+            y[i] = i
+
+    @ti.kernel
+    def count_active() -> ti.i32:
+        c = 0
+        for i in x:
+            c += 1
+        return c
+
+    fill()
+    ti.discard(x)
+    assert count_active() == 0
+    assert np.array_equal(y.to_numpy(), np.arange(n))
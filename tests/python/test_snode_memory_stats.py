@@ -0,0 +1,54 @@
+import taichi as ti
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_pointer_memory_stats():
+    x = ti.field(ti.i32)
+    block = ti.root.pointer(ti.i, 16)
+    block.dense(ti.i, 8).place(x)
+
+    @ti.kernel
+    def activate():
+        for i in range(12):
+            x[i * 8] = 1
+
+    @ti.kernel
+    def deactivate():
+        for i in range(4):
+            ti.deactivate(block, i)
+
+    stats = block.memory_stats()
+    assert stats['num_live'] == 0
+    assert stats['occupancy'] == [1] + [0] * 9
+
+    activate()
+    stats = block.memory_stats(num_bins=4)
+    assert stats['num_live'] == 12
+    assert stats['num_free'] == 0
+    assert stats['num_chunks'] == 1
+    assert stats['allocated_bytes'] == (stats['elements_per_chunk'] *
+                                        stats['element_size'])
+    assert 0 < stats['fragmentation'] < 1
+    # 12 of the 16 cells of the single node are active.
+    assert stats['occupancy'] == [0, 0, 0, 1]
+
+    deactivate()
+    stats = block.memory_stats()
+    assert stats['num_live'] == 8
+    assert stats['num_free'] + stats['num_recycled'] == 4
+
+
+@ti.test(require=ti.extension.sparse)
+def test_bitmasked_occupancy():
+    x = ti.field(ti.i32)
+    block = ti.root.dense(ti.i, 4).bitmasked(ti.i, 8)
+    block.place(x)
+
+    for i in range(9):
+        x[i] = 1
+    for i in range(16, 20):
+        x[i] = 1
+
+    stats = block.memory_stats(num_bins=4)
+    # Nodes with 8, 1, 4 and 0 of their 8 cells active.
+    assert stats['occupancy'] == [2, 0, 1, 1]
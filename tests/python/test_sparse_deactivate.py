@@ -215,3 +215,51 @@ def test_dynamic():
     fetch_length()
     for i in range(n):
         assert s[i] == i * i * 4
+
+
+@ti.test(arch=ti.vulkan)
+def test_pointer_emulated_vulkan():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32, shape=())
+
+    n = 16
+
+    ptr = ti.root.pointer(ti.i, n)
+    ptr.place(x)
+
+    @ti.kernel
+    def activate():
+        for i in range(n):
+            if i % 3 == 0:
+                x[i] = i + 1
+
+    @ti.kernel
+    def func():
+        for i in x:
+            s[None] += x[i]
+
+    @ti.kernel
+    def deactivate():
+        ti.deactivate(ptr, 3)
+
+    @ti.kernel
+    def reactivate():
+        ti.activate(ptr, 3)
+
+    @ti.kernel
+    def is_active() -> ti.i32:
+        return ti.is_active(ptr, 3)
+
+    activate()
+    func()
+    assert s[None] == sum(i + 1 for i in range(n) if i % 3 == 0)
+
+    deactivate()
+    assert is_active() == 0
+    s[None] = 0
+    func()
+    assert s[None] == sum(i + 1 for i in range(n) if i % 3 == 0 and i != 3)
+
+    # A deactivated cell is cleared
+    reactivate()
+    assert x[3] == 0
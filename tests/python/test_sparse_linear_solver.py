@@ -29,11 +29,15 @@ res = np.array([
 ])
 
 
-@pytest.mark.parametrize("solver_type", ["LLT", "LDLT", "LU"])
+@pytest.mark.parametrize("dtype", [ti.f32, ti.f64])
+@pytest.mark.parametrize("solver_type", ["LLT", "LDLT", "LU", "ParallelLLT"])
 @ti.test(arch=ti.cpu)
-def test_sparse_LLT_solver(solver_type):
+def test_sparse_LLT_solver(dtype, solver_type):
     n = 4
-    Abuilder = ti.linalg.SparseMatrixBuilder(n, n, max_num_triplets=100)
+    Abuilder = ti.linalg.SparseMatrixBuilder(n,
+                                             n,
+                                             max_num_triplets=100,
+                                             dtype=dtype)
     b = ti.field(ti.f32, shape=n)
 
     @ti.kernel
@@ -46,9 +50,105 @@ def test_sparse_LLT_solver(solver_type):
 
     fill(Abuilder, Aarray, b)
     A = Abuilder.build()
-    solver = ti.linalg.SparseSolver(solver_type=solver_type)
+    solver = ti.linalg.SparseSolver(dtype=dtype, solver_type=solver_type)
     solver.analyze_pattern(A)
     solver.factorize(A)
     x = solver.solve(b)
     for i in range(n):
         assert x[i] == ti.approx(res[i])
+
+
+@ti.test(arch=ti.cpu)
+def test_sparse_solver_rebuild():
+    n = 4
+    Abuilder = ti.linalg.SparseMatrixBuilder(n, n, max_num_triplets=100)
+    b = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def fill(Abuilder: ti.linalg.sparse_matrix_builder(),
+             InputArray: ti.ext_arr(), scale: ti.f32):
+        for i, j in ti.ndrange(n, n):
+            Abuilder[i, j] += InputArray[i, j] * scale
+
+    for i in range(n):
+        b[i] = i + 1
+    fill(Abuilder, Aarray, 1)
+    A = Abuilder.build()
+    pattern_hash = A.matrix.pattern_hash()
+    solver = ti.linalg.SparseSolver(solver_type="LLT")
+    solver.compute(A)
+    x = solver.solve(b)
+    for i in range(n):
+        assert x[i] == ti.approx(res[i])
+
+    # The pattern is the same, so only the values are updated.
+    fill(Abuilder, Aarray, 2)
+    assert Abuilder.rebuild(A) is A
+    assert A.matrix.pattern_hash() == pattern_hash
+    solver.compute(A)
+    x = solver.solve(b)
+    for i in range(n):
+        assert x[i] == ti.approx(res[i] / 2)
+
+
+@ti.test(arch=ti.cuda)
+def test_sparse_cg_solver_cuda():
+    n = 4
+    Abuilder = ti.linalg.SparseMatrixBuilder(n, n, max_num_triplets=100)
+    b = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def fill(Abuilder: ti.linalg.sparse_matrix_builder(),
+             InputArray: ti.ext_arr(), b: ti.template()):
+        # Each entry is inserted twice to exercise the duplicated triplets.
+        for i, j in ti.ndrange(n, n):
+            Abuilder[i, j] += InputArray[i, j] * 0.5
+            Abuilder[i, j] += InputArray[i, j] * 0.5
+        for i in range(n):
+            b[i] = i + 1
+
+    fill(Abuilder, Aarray, b)
+    A = Abuilder.build()
+    assert A @ res == pytest.approx(np.arange(1, n + 1), rel=1e-4)
+    solver = ti.linalg.SparseSolver(solver_type="LLT")
+    solver.analyze_pattern(A)
+    solver.factorize(A)
+    x = solver.solve(b)
+    assert solver.info()
+    for i in range(n):
+        assert x[i] == pytest.approx(res[i], rel=1e-4)
+
+
+@ti.test(arch=ti.cpu)
+def test_sparse_parallel_llt_solver():
+    # The 5-point Laplacian of an n x n grid, whose elimination tree has many
+    # independent columns.
+    n = 16
+    N = n * n
+    Abuilder = ti.linalg.SparseMatrixBuilder(N,
+                                             N,
+                                             max_num_triplets=5 * N,
+                                             dtype=ti.f64)
+
+    @ti.kernel
+    def fill(Abuilder: ti.linalg.sparse_matrix_builder()):
+        for i, j in ti.ndrange(n, n):
+            k = i * n + j
+            Abuilder[k, k] += 4.1
+            if i > 0:
+                Abuilder[k, k - n] += -1
+            if i < n - 1:
+                Abuilder[k, k + n] += -1
+            if j > 0:
+                Abuilder[k, k - 1] += -1
+            if j < n - 1:
+                Abuilder[k, k + 1] += -1
+
+    fill(Abuilder)
+    A = Abuilder.build()
+    b = np.linspace(-1, 1, N)
+    solver = ti.linalg.SparseSolver(dtype=ti.f64, solver_type="ParallelLLT")
+    solver.compute(A)
+    assert solver.info()
+    x = solver.solve(b)
+    np.testing.assert_allclose(A @ x, b, atol=1e-9)
@@ -18,6 +18,28 @@ def test_sparse_matrix_builder():
             assert A[i, j] == i + j
 
 
+@ti.test(arch=ti.cpu)
+def test_sparse_matrix_builder_f64():
+    n = 8
+    Abuilder = ti.linalg.SparseMatrixBuilder(n,
+                                             n,
+                                             max_num_triplets=100,
+                                             dtype=ti.f64)
+
+    @ti.kernel
+    def fill(Abuilder: ti.linalg.sparse_matrix_builder()):
+        for i, j in ti.ndrange(n, n):
+            Abuilder[i, j] += ti.cast(i + j, ti.f64) / 3
+
+    fill(Abuilder)
+    A = Abuilder.build()
+    B = A + A
+    for i in range(n):
+        for j in range(n):
+            assert A[i, j] == (i + j) / 3
+            assert B[i, j] == 2 * (i + j) / 3
+
+
 @ti.test(arch=ti.cpu)
 def test_sparse_matrix_element_access():
     n = 8
@@ -68,3 +68,36 @@ def test_sparse_matrix_vector_multiplication3():
     res = np.array([28, 36, 44, 52, 60, 68, 76, 84])
     for i in range(n):
         assert x[i] == res[i]
+
+
+@ti.test(arch=ti.cpu)
+def test_sparse_matrix_parallel_spmv_spgemm():
+    # Large enough to be split into several tasks of the thread pool.
+    n = 5000
+    Abuilder = ti.linalg.SparseMatrixBuilder(n, n, max_num_triplets=3 * n)
+    b = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def fill(Abuilder: ti.linalg.sparse_matrix_builder(), b: ti.template()):
+        for i in range(n):
+            Abuilder[i, i] += 2
+            if i > 0:
+                Abuilder[i, i - 1] += -1
+            if i < n - 1:
+                Abuilder[i, i + 1] += -1
+            b[i] = i
+
+    fill(Abuilder, b)
+    A = Abuilder.build()
+    x = A @ b
+    assert x[0] == -1
+    assert x[n - 1] == n
+    for i in range(1, n - 1):
+        assert x[i] == 0
+
+    C = A @ A
+    for i in range(2, n - 2):
+        assert C[i, i] == 6
+        assert C[i, i + 1] == -4
+        assert C[i, i + 2] == 1
+        assert C[i, i + 3] == 0
@@ -22,3 +22,33 @@ def test_simple():
     for i in range(n - 1):
         assert x[i] == 1
         assert y[i + 1] == 2
+
+
+@ti.test()
+def test_stencil_footprint():
+    x = ti.field(ti.f32, shape=(16, 16))
+    y = ti.field(ti.f32, shape=(16, 16))
+    z = ti.field(ti.f32, shape=(16, 16))
+
+    @ti.kernel
+    def laplace():
+        for i, j in y:
+            y[i, j] = x[i - 1, j] + x[i + 1, j] + x[i, j - 2] - 4 * x[i, j]
+
+    @ti.kernel
+    def shift():
+        for i, j in y:
+            y[i, j] += x[i, j + 1]
+
+    @ti.kernel
+    def transpose():
+        for i, j in y:
+            y[i, j] += z[j, i]
+
+    assert ti.get_stencil_footprint(x) is None
+    laplace()
+    assert ti.get_stencil_footprint(x) == [(-1, 1), (-2, 0)]
+    shift()
+    assert ti.get_stencil_footprint(x) == [(-1, 1), (-2, 1)]
+    transpose()
+    assert ti.get_stencil_footprint(z) is None
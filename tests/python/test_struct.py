@@ -1,3 +1,5 @@
+import numpy as np
+
 import taichi as ti
 
 
@@ -77,3 +79,33 @@ def test_2d_nested():
     for i in range(n * 2):
         for j in range(n):
             assert x[i, j] == i + j * 10
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_morton():
+    x = ti.field(ti.i32)
+    y = ti.field(ti.i32)
+    ti.root.dense(ti.ijk, 3).dense(ti.ijk, (8, 4, 2), morton=True).place(x)
+    ti.root.pointer(ti.ij, 2).dense(ti.ij, 4, morton=True).place(y)
+
+    @ti.kernel
+    def fill():
+        for i, j, k in x:
+            x[i, j, k] = i * 10000 + j * 100 + k
+        for i, j in ti.ndrange(8, 8):
+            if i < 4:
+                y[i, j] = i * 100 + j
+
+    @ti.kernel
+    def double():
+        for i, j in y:
+            y[i, j] *= 2
+
+    fill()
+    double()
+    assert x[17, 9, 5] == 170905
+    for i, j, k in [(0, 0, 0), (23, 11, 5), (9, 3, 1)]:
+        assert x[i, j, k] == i * 10000 + j * 100 + k
+    assert (x.to_numpy()[:, 1, 1] == np.arange(24) * 10000 + 101).all()
+    assert y[3, 6] == 612
+    assert y[5, 6] == 0
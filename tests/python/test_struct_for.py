@@ -312,3 +312,64 @@ def test_struct_for_continue():
     init()
     assert struct_for_continue() == n * (n - 1)
     assert range_for_continue() == n * (n - 1)
+
+
+def _test_tiled_3d_non_POT():
+    x = ti.field(ti.i32)
+    n, m, p = 13, 6, 9
+    ti.root.dense(ti.ijk, (n, m, p)).place(x)
+
+    @ti.kernel
+    def fill():
+        for i, j, k in x:
+            x[i, j, k] += i * 100 + j * 10 + k
+
+    fill()
+    xs = x.to_numpy()
+    for i in range(n):
+        for j in range(m):
+            for k in range(p):
+                assert xs[i, j, k] == i * 100 + j * 10 + k
+
+
+@ti.test(arch=ti.cpu, cpu_struct_for_tile_size=4)
+def test_tiled_3d_non_POT():
+    _test_tiled_3d_non_POT()
+
+
+@ti.test(arch=ti.cpu, cpu_struct_for_tile_size=4, packed=True)
+def test_tiled_3d_non_POT_packed():
+    _test_tiled_3d_non_POT()
+
+
+def _test_sparse_struct_for_prefetch():
+    x = ti.field(ti.i32)
+    n = 1024
+    ti.root.pointer(ti.i, n // 8).dense(ti.i, 8).place(x)
+
+    @ti.kernel
+    def activate():
+        for i in range(n):
+            if i % 24 < 8:
+                x[i] = i
+
+    @ti.kernel
+    def total() -> ti.i32:
+        s = 0
+        for i in x:
+            s += x[i]
+        return s
+
+    activate()
+    assert total() == sum(i for i in range(n) if i % 24 < 8)
+
+
+@ti.test(arch=ti.cpu, cpu_struct_for_prefetch_distance=0)
+def test_sparse_struct_for_no_prefetch():
+    _test_sparse_struct_for_prefetch()
+
+
+@ti.test(arch=ti.cpu, cpu_struct_for_prefetch_distance=64)
+def test_sparse_struct_for_prefetch_past_end():
+    # Farther than the number of active cells.
+    _test_sparse_struct_for_prefetch()
@@ -45,3 +45,33 @@ def test_dense_dynamic():
     for i in range(n):
         for j in range(i):
             assert x[i, j] == j * 2
+
+
+@ti.test(arch=ti.cuda, cuda_dynamic_struct_for=True)
+def test_skewed_dense_dynamic_balanced():
+    n = 64
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32, shape=n)
+
+    ti.root.dense(ti.i, n).dynamic(ti.j, 4096, 128).place(x)
+
+    @ti.kernel
+    def append():
+        for i in range(n):
+            # A few lists are far longer than the others.
+            length = 4000 if i % 16 == 0 else i
+            for j in range(length):
+                ti.append(x.parent(), i, j)
+
+    @ti.kernel
+    def accumulate():
+        for i, j in x:
+            s[i] += x[i, j] + 1
+
+    append()
+    # The work queue is reset for the next launches.
+    for k in range(3):
+        accumulate()
+    for i in range(n):
+        length = 4000 if i % 16 == 0 else i
+        assert s[i] == 3 * length * (length + 1) // 2
@@ -87,3 +87,35 @@ def test_transpose_no_loop():
 
     run()
     # As long as it passes compilation we are good
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], fast_math=False)
+def test_svd_batched():
+    # Many matrices at once, through the precompiled runtime function.
+    n = 1024
+    A = ti.Matrix.field(3, 3, dtype=ti.f32, shape=n)
+    U = ti.Matrix.field(3, 3, dtype=ti.f32, shape=n)
+    sigma = ti.Matrix.field(3, 3, dtype=ti.f32, shape=n)
+    V = ti.Matrix.field(3, 3, dtype=ti.f32, shape=n)
+
+    @ti.kernel
+    def run():
+        for i in A:
+            U[i], sigma[i], V[i] = ti.svd(A[i], ti.f32)
+
+    a = np.random.uniform(-1, 1, (n, 3, 3)).astype(np.float32)
+    # Rank-deficient ones too.
+    a[::7, :, 2] = 0
+    A.from_numpy(a)
+    run()
+
+    u, s, v = U.to_numpy(), sigma.to_numpy(), V.to_numpy()
+    for i in range(n):
+        assert mat_equal(u[i] @ s[i] @ v[i].T, a[i], tol=1e-4)
+        assert mat_equal(u[i].T @ u[i], np.eye(3), tol=1e-4)
+        assert mat_equal(v[i].T @ v[i], np.eye(3), tol=1e-4)
+        assert np.linalg.det(u[i]) == approx(1, abs=1e-4)
+        assert np.linalg.det(v[i]) == approx(1, abs=1e-4)
+        d = np.diag(s[i])
+        assert abs(d[0]) >= abs(d[1]) - 1e-5
+        assert abs(d[1]) >= abs(d[2]) - 1e-5
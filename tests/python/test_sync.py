@@ -24,3 +24,69 @@ def test_kernel_sync():
     # These [] calls are on CPU. They should be smart enough to sync only once.
     for i in range(n):
         assert y[i] == x[i % 3]
+
+
+@ti.test()
+def test_batched_launches_with_args():
+    n = 64
+    x = ti.field(ti.i32, shape=(n, ))
+
+    @ti.kernel
+    def add(k: ti.i32):
+        for i in x:
+            x[i] += k
+
+    @ti.kernel
+    def scale(k: ti.i32):
+        for i in x:
+            x[i] *= k
+
+    # Launches that don't return anything may be deferred. Each of them must
+    # still see its own arguments and the results of the earlier ones.
+    for k in range(10):
+        add(k)
+        scale(2)
+    expected = 0
+    for k in range(10):
+        expected = (expected + k) * 2
+    for i in range(n):
+        assert x[i] == expected
+
+
+@ti.test(arch=ti.cuda, cuda_fine_grained_host_sync=True)
+def test_fine_grained_host_sync():
+    n = 1024
+    x = ti.field(ti.i32, shape=n)
+    fb = ti.FieldsBuilder()
+    y = ti.field(ti.f32)
+    fb.dense(ti.i, n).place(y)
+    fb.finalize()
+
+    @ti.kernel
+    def fill_x(k: ti.i32):
+        for i in x:
+            x[i] = i + k
+
+    @ti.kernel
+    def fill_y(k: ti.i32):
+        for i in y:
+            y[i] = x[i] * 0.5 + k
+
+    @ti.kernel
+    def total() -> ti.i32:
+        s = 0
+        for i in range(n):
+            s += x[i]
+        return s
+
+    # The reads must see the last writes to their own tree, whatever the
+    # writes to the other one still in flight.
+    for k in range(3):
+        fill_x(k)
+        fill_y(k)
+        assert x[n - 1] == n - 1 + k
+        assert (x.to_numpy() == [i + k for i in range(n)]).all()
+        assert total() == n * (n - 1) // 2 + n * k
+        fill_x(k + 1)
+        assert (y.to_numpy() == [(i + k) * 0.5 + k for i in range(n)]).all()
+        assert y[1] == 0.5 + k * 1.5
@@ -0,0 +1,77 @@
+import numpy as np
+import pytest
+
+import taichi as ti
+
+
+@ti.test(arch=ti.vulkan)
+def test_texture_from_to_numpy():
+    tex = ti.Texture(ti.f32, 2, (8, 4))
+    arr = np.random.rand(8, 4, 2).astype(np.float32)
+    tex.from_numpy(arr)
+    assert np.array_equal(tex.to_numpy(), arr)
+
+
+@ti.test(arch=ti.vulkan)
+def test_texture_fetch():
+    n = 16
+    tex = ti.Texture(ti.f32, 1, (n, n))
+    arr = np.random.rand(n, n).astype(np.float32)
+    tex.from_numpy(arr)
+    x = ti.Vector.field(4, ti.f32, shape=(n, n))
+
+    @ti.kernel
+    def fetch(t: ti.texture(num_dimensions=2)):
+        for i, j in x:
+            x[i, j] = t.fetch(ti.Vector([i, j]), 0)
+
+    fetch(tex)
+    result = x.to_numpy()
+    assert np.array_equal(result[:, :, 0], arr)
+    assert np.all(result[:, :, 1:3] == 0)
+    assert np.all(result[:, :, 3] == 1)
+
+
+@ti.test(arch=ti.vulkan)
+def test_texture_sample_lod():
+    n = 8
+    tex = ti.Texture(ti.f32, 1, (n, ))
+    arr = np.arange(n, dtype=np.float32)
+    tex.from_numpy(arr)
+    x = ti.field(ti.f32, shape=2 * n - 1)
+
+    @ti.kernel
+    def sample(t: ti.texture(num_dimensions=1)):
+        for i in x:
+            # Between the centers of the texels i // 2 and (i + 1) // 2.
+            x[i] = t.sample_lod((i * 0.5 + 0.5) / n, 0.0)[0]
+
+    sample(tex)
+    # The hardware interpolates with a few bits of precision.
+    assert np.allclose(x.to_numpy(), np.arange(2 * n - 1) * 0.5, atol=1e-2)
+
+
+@ti.test(arch=ti.vulkan)
+def test_texture_clamp_to_edge():
+    tex = ti.Texture(ti.f32, 1, (4, 4))
+    tex.from_numpy(np.full((4, 4), 3.0, dtype=np.float32))
+    x = ti.field(ti.f32, shape=())
+
+    @ti.kernel
+    def sample(t: ti.texture(num_dimensions=2)):
+        x[None] = t.sample_lod(ti.Vector([-1.0, 2.0]), 0.0)[0]
+
+    sample(tex)
+    assert x[None] == pytest.approx(3.0)
+
+
+@ti.test(arch=ti.vulkan)
+def test_texture_wrong_dimensions():
+    tex = ti.Texture(ti.f32, 1, (4, 4))
+
+    @ti.kernel
+    def sample(t: ti.texture(num_dimensions=3)):
+        pass
+
+    with pytest.raises(ValueError):
+        sample(tex)
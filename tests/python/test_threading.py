@@ -1,6 +1,40 @@
+import threading
+
 import taichi as ti
 
 
 @ti.test(arch=ti.get_host_arch_list())
 def test_while():
     assert ti.core.test_threading()
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_concurrent_launches():
+    x = ti.field(ti.i32, shape=8)
+
+    @ti.kernel
+    def add(i: ti.i32, v: ti.i32) -> ti.i32:
+        ti.atomic_add(x[i], v)
+        return v * 2
+
+    num_threads = 8
+    num_launches = 100
+    errors = []
+
+    def launch(i):
+        for v in range(num_launches):
+            if add(i, v) != v * 2:
+                errors.append((i, v))
+
+    threads = [
+        threading.Thread(target=launch, args=(i, ))
+        for i in range(num_threads)
+    ]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    assert not errors
+    expected = num_launches * (num_launches - 1) // 2
+    for i in range(num_threads):
+        assert x[i] == expected
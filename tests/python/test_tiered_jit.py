@@ -0,0 +1,32 @@
+import time
+
+import taichi as ti
+
+
+@ti.test(arch=ti.cpu, cpu_tiered_jit_launches=2)
+def test_tiered_jit():
+    n = 1024
+    x = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def fill(k: ti.f32):
+        for i in x:
+            x[i] = ti.sqrt(i * k)
+
+    @ti.kernel
+    def total() -> ti.f32:
+        s = 0.0
+        for i in x:
+            s += x[i]
+        return s
+
+    fill(4.0)
+    expected = total()
+    # The second launch starts the background compilation. The results must
+    # be the same before and after the optimized version is swapped in.
+    for _ in range(20):
+        fill(4.0)
+        assert total() == ti.approx(expected)
+        time.sleep(0.01)
+    for i in range(n):
+        assert x[i] == ti.approx((i * 4.0)**0.5)
@@ -0,0 +1,31 @@
+import json
+import os
+import tempfile
+
+import taichi as ti
+
+
+@ti.test(timeline=True)
+def test_timeline_save():
+    x = ti.field(ti.f32, shape=16)
+
+    @ti.kernel
+    def timeline_kernel(k: ti.f32):
+        for i in x:
+            x[i] = k
+
+    ti.timeline_clear()
+    timeline_kernel(1.0)
+    ti.sync()
+    with tempfile.TemporaryDirectory() as tmpdir:
+        fn = os.path.join(tmpdir, 'timeline.json')
+        ti.timeline_save(fn)
+        with open(fn) as f:
+            events = json.load(f)
+    names = [e['name'] for e in events]
+    assert all(isinstance(e['ts'], float) for e in events)
+    # The host launch, with the time spent setting its arguments.
+    assert any(n.startswith('timeline_kernel') for n in names)
+    assert any(n.endswith('(set args)') for n in names)
+    # Compiled on the first launch.
+    assert any(e['ph'] == 'X' and e['name'] == 'compile' for e in events)
@@ -267,3 +267,39 @@ def test_torch_zero():
     test_torch(torch.zeros((0), dtype=torch.int32))
     test_torch(torch.zeros((0, 5), dtype=torch.int32))
     test_torch(torch.zeros((5, 0, 5), dtype=torch.int32))
+
+
+@pytest.mark.skipif(not ti.has_pytorch(), reason='Pytorch not installed.')
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_field_to_dlpack_strided():
+    x = ti.field(ti.i32)
+    y = ti.field(ti.f32)
+    # x and y are interleaved, so that x is viewed with strides.
+    ti.root.dense(ti.ij, (4, 6)).place(x, y)
+
+    @ti.kernel
+    def fill():
+        for i, j in x:
+            x[i, j] = i * 10 + j
+            y[i, j] = -1
+
+    fill()
+    t = torch.utils.dlpack.from_dlpack(x.__dlpack__())
+    assert tuple(t.shape) == (4, 6)
+    assert t.stride() == (12, 2)
+    expected = np.arange(4)[:, None] * 10 + np.arange(6)[None, :]
+    assert (t.cpu().numpy() == expected).all()
+
+    # Writes through the view are visible to Taichi.
+    t.fill_(3)
+    assert (x.to_numpy() == 3).all()
+    assert (y.to_numpy() == -1).all()
+
+
+@pytest.mark.skipif(not ti.has_pytorch(), reason='Pytorch not installed.')
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_field_to_dlpack_unsupported():
+    x = ti.field(ti.f32)
+    ti.root.pointer(ti.i, 4).dense(ti.i, 4).place(x)
+    with pytest.raises(RuntimeError):
+        x.__dlpack__()
@@ -0,0 +1,26 @@
+import taichi as ti
+
+
+@ti.test(unroll_inner_loop_factor=4)
+def test_unroll_inner_loops():
+    n = 16
+    a = ti.field(ti.i32, shape=(n, 10))
+    s = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def run():
+        for i in range(n):
+            # Partially unrolled, with a remainder of 2 iterations
+            for j in range(10):
+                a[i, j] = i * 10 + j
+            # Completely unrolled
+            acc = 0
+            for j in range(1, 4):
+                acc += a[i, j + 1] - j
+            s[i] = acc
+
+    run()
+    for i in range(n):
+        for j in range(10):
+            assert a[i, j] == i * 10 + j
+        assert s[i] == sum(i * 10 + j + 1 - j for j in range(1, 4))